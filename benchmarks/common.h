@@ -0,0 +1,103 @@
+#ifndef B0__BENCHMARKS__COMMON_H__INCLUDED
+#define B0__BENCHMARKS__COMMON_H__INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include <b0/b0.h>
+#include <b0/exceptions.h>
+#include <b0/resolver/resolver.h>
+
+namespace bench
+{
+
+//! Options common to the benchmarks
+struct Options
+{
+    std::string transport = "tcp";
+    bool resolver = false;
+    std::vector<int> sizes;
+    std::vector<std::string> compression;
+};
+
+inline void addOptions(Options &o)
+{
+    b0::addOptionString("transport,x", "inproc (same process), ipc (same host) or tcp", &o.transport, false, "tcp");
+    b0::addOption("p2p,P", "connect publishers and subscribers directly, instead of through the resolver's proxy");
+    b0::addOption("resolver,r", "run a resolver in this process");
+    b0::addOptionIntVector("size,s", "message sizes to test (can be repeated)", &o.sizes, false,
+            {64, 1024, 16 * 1024, 256 * 1024, 4 * 1024 * 1024, 64 * 1024 * 1024});
+    b0::addOptionStringVector("compression,z", "compression algorithms to test (can be repeated, \"none\" for no compression)", &o.compression, false, {"none"});
+}
+
+//! Apply the transport options; must be called after b0::init()
+inline void applyOptions(Options &o)
+{
+    if(o.transport != "inproc" && o.transport != "ipc" && o.transport != "tcp")
+        throw b0::exception::ArgumentError(o.transport, "transport");
+    b0::setIntraProcess(o.transport == "inproc");
+    b0::setIPC(o.transport == "ipc");
+    b0::setPeerToPeer(b0::hasOption("p2p"));
+    o.resolver = b0::hasOption("resolver");
+    for(auto &c : o.compression)
+        if(c == "none") c = "";
+}
+
+inline void resolverThread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+//! Start a resolver in a background thread, if requested, and give it time to bind
+inline void startResolver(const Options &o)
+{
+    if(!o.resolver) return;
+    boost::thread(&resolverThread).detach();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+}
+
+//! Return a monotonic time, in microseconds
+inline int64_t nowUSec()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! Return a payload of the given size, about half compressible
+inline std::string makePayload(size_t size)
+{
+    std::string payload(size, '\0');
+    uint32_t x = 12345;
+    for(auto &c : payload)
+    {
+        x = x * 1103515245 + 12345;
+        c = "abcdefghijklmnop"[(x >> 16) & 0x0f];
+    }
+    return payload;
+}
+
+//! Return the number of iterations for a message size, bounded by a byte budget
+inline int iterations(int count, int64_t max_bytes, size_t size)
+{
+    int64_t n = max_bytes / int64_t(size);
+    return int(std::max<int64_t>(10, std::min<int64_t>(count, n)));
+}
+
+//! Common fields of a result line (a JSON object, without its closing brace)
+inline std::string result(const std::string &benchmark, const Options &o, size_t size, const std::string &compression)
+{
+    boost::format fmt("{\"benchmark\": \"%s\", \"transport\": \"%s\", \"p2p\": %s, \"size\": %d, \"compression\": \"%s\"");
+    return (fmt % benchmark % o.transport % (b0::hasOption("p2p") ? "true" : "false")
+            % size % (compression.empty() ? "none" : compression)).str();
+}
+
+} // namespace bench
+
+#endif // B0__BENCHMARKS__COMMON_H__INCLUDED
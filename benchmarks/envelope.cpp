@@ -0,0 +1,177 @@
+/*
+ * Microbenchmarks of the per-message paths: envelope serialization and parsing (by number
+ * of parts, number of headers, part size and wire format), and compression/decompression
+ * (by algorithm and size). Each case runs for at least --min-time seconds, and prints one
+ * JSON object per line with ns/op, bytes/op and allocations/op.
+ *
+ * bench_envelope --filter parse
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/function.hpp>
+
+#include <b0/b0.h>
+#include <b0/compress/compress.h>
+#include <b0/message/message_envelope.h>
+
+#include "common.h"
+
+// count the allocations of the whole program, to report allocations/op
+static std::atomic<uint64_t> allocations{0};
+
+void * operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+double min_time = 0.5;
+std::string filter;
+
+//! Run an operation enough times to last min_time, and print its costs
+void run(const std::string &name, size_t bytes, const boost::function<void()> &op)
+{
+    if(name.find(filter) == std::string::npos) return;
+
+    op(); // warm-up (first-use allocations, caches)
+
+    uint64_t n = 1;
+    for(;;)
+    {
+        uint64_t a0 = allocations.load();
+        int64_t t0 = bench::nowUSec();
+        for(uint64_t i = 0; i < n; i++) op();
+        int64_t dt = bench::nowUSec() - t0;
+        uint64_t a = allocations.load() - a0;
+        if(dt >= min_time * 1e6 || n >= (uint64_t(1) << 40))
+        {
+            boost::format fmt("{\"benchmark\": \"%s\", \"iterations\": %d, \"ns_per_op\": %.1f, \"bytes_per_op\": %d, \"bytes_per_sec\": %.1f, \"allocs_per_op\": %.2f}");
+            std::cout << (fmt % name % n % (dt * 1e3 / n) % bytes % (dt ? bytes * n / (dt / 1e6) : 0.0) % (double(a) / n)).str() << std::endl;
+            return;
+        }
+        // aim at min_time, growing at most 10x at a time
+        n = dt > 0 ? std::min(n * 10, uint64_t(n * min_time * 1.2e6 / dt) + 1) : n * 10;
+    }
+}
+
+b0::message::MessageEnvelope makeEnvelope(int num_parts, int num_headers, size_t part_size)
+{
+    b0::message::MessageEnvelope env;
+    env.header0 = "bench/topic";
+    for(int i = 0; i < num_parts; i++)
+    {
+        b0::message::MessagePart part;
+        part.content_type = "bench::Type";
+        part.compression_level = 0;
+        part.payload = bench::makePayload(part_size);
+        env.parts.push_back(part);
+    }
+    for(int i = 0; i < num_headers; i++)
+        env.headers["X-Header-" + std::to_string(i)] = std::to_string(1000000 + i);
+    return env;
+}
+
+void envelopeBenchmarks()
+{
+    for(auto format : {b0::message::EnvelopeFormat::Text, b0::message::EnvelopeFormat::Binary})
+    {
+        std::string f = format == b0::message::EnvelopeFormat::Text ? "text" : "binary";
+        for(int num_parts : {1, 4, 16})
+        {
+            for(int num_headers : {0, 4, 16})
+            {
+                for(size_t part_size : {64, 4096, 1024 * 1024})
+                {
+                    b0::message::MessageEnvelope env = makeEnvelope(num_parts, num_headers, part_size);
+                    std::string args = (boost::format("%s/parts:%d/headers:%d/size:%d") % f % num_parts % num_headers % part_size).str();
+
+                    std::string wire;
+                    serialize(env, wire, format);
+                    size_t bytes = wire.size();
+
+                    run("serialize/" + args, bytes, [&]() {
+                        serialize(env, wire, format);
+                    });
+
+                    b0::message::EnvelopeSerializer serializer;
+                    std::vector<char> buffer;
+                    run("serializer/" + args, bytes, [&]() {
+                        buffer.resize(serializer.prepare(env, format));
+                        serializer.write(buffer.data());
+                    });
+
+                    b0::message::MessageEnvelope parsed;
+                    run("parse/" + args, bytes, [&]() {
+                        parse(parsed, wire.data(), wire.size());
+                    });
+
+                    b0::message::MessageEnvelopeView view;
+                    run("parse_view/" + args, bytes, [&]() {
+                        parse(view, wire.data(), wire.size());
+                    });
+                }
+            }
+        }
+    }
+}
+
+void compressionBenchmarks()
+{
+    b0::compress::Context context;
+    for(std::string algorithm : {"zlib", "lz4", "lz4f", "zstd"})
+    {
+        try
+        {
+            b0::compress::compress(algorithm, "test");
+        }
+        catch(std::exception &)
+        {
+            continue; // not compiled in
+        }
+
+        for(size_t size : {64, 4096, 65536, 1024 * 1024})
+        {
+            std::string data = bench::makePayload(size), compressed, decompressed;
+            std::string args = (boost::format("%s/size:%d") % algorithm % size).str();
+
+            run("compress/" + args, size, [&]() {
+                context.compress(algorithm, data.data(), data.size(), compressed);
+            });
+
+            context.compress(algorithm, data.data(), data.size(), compressed);
+            run("decompress/" + args, size, [&]() {
+                context.decompress(algorithm, compressed.data(), compressed.size(), decompressed, size);
+            });
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    b0::addOptionDouble("min-time,t", "minimum seconds per benchmark", &min_time, false, 0.5);
+    b0::addOptionString("filter,f", "run only the benchmarks whose name contains this", &filter);
+    b0::init(argc, argv);
+
+    envelopeBenchmarks();
+    compressionBenchmarks();
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Ping-pong latency: the ping node publishes a message, the pong node publishes it back
+ * (with the same compression), and the round trip time is recorded, for each message size
+ * and compression algorithm. Prints one JSON object per line.
+ *
+ * Same process:  bench_pubsub_latency -r -x inproc
+ * Same host:     bench_pubsub_latency --role pong -x ipc & bench_pubsub_latency --role ping -x ipc
+ * Remote:        run the pong role on another host, with B0_RESOLVER pointing to the same resolver
+ */
+
+#include <iostream>
+#include <string>
+
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/utils/metrics.h>
+
+#include "common.h"
+
+void pong()
+{
+    b0::Node node("bench_pong");
+    b0::Publisher pub(&node, "bench/pong");
+    std::string compression;
+    b0::Subscriber sub(&node, "bench/ping", b0::Subscriber::CallbackRawType([&](const std::string &payload, const std::string &type) {
+        // the ping node sends the compression algorithm as content type
+        if(type != compression)
+        {
+            compression = type;
+            pub.setCompression(compression);
+        }
+        pub.publish(payload, type);
+    }));
+    node.init();
+    node.spin();
+    node.cleanup();
+}
+
+int main(int argc, char **argv)
+{
+    bench::Options o;
+    std::string role = "both";
+    int count = 1000, max_mb = 256;
+    bench::addOptions(o);
+    b0::addOptionString("role", "ping, pong, or both (in this process)", &role, false, "both");
+    b0::addOptionInt("count,n", "round trips per message size", &count, false, 1000);
+    b0::addOptionInt("max-mb,m", "maximum MiB sent per message size (fewer round trips for large messages)", &max_mb, false, 256);
+    b0::init(argc, argv);
+    bench::applyOptions(o);
+    bench::startResolver(o);
+
+    if(role == "pong")
+    {
+        pong();
+        return 0;
+    }
+    if(role != "ping" && role != "both")
+        throw b0::exception::ArgumentError(role, "role");
+    if(role == "both")
+    {
+        boost::thread(&pong).detach();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    }
+
+    b0::Node node("bench_ping");
+    b0::Publisher pub(&node, "bench/ping");
+    b0::Subscriber sub(&node, "bench/pong");
+    node.init();
+
+    for(auto &compression : o.compression)
+    {
+        pub.setCompression(compression);
+        for(int size : o.sizes)
+        {
+            std::string payload = bench::makePayload(size), reply, type;
+
+            // wait for the pong node to be connected, then drop the replies of the warm-up
+            bool connected = false;
+            for(int i = 0; i < 100 && !connected; i++)
+            {
+                pub.publish(payload, compression);
+                connected = sub.poll(100);
+            }
+            if(!connected)
+                throw b0::exception::Exception("no reply from the pong node");
+            while(sub.poll(50))
+                sub.readRaw(reply, type);
+
+            b0::LatencyHistogram rtt;
+            int n = bench::iterations(count, int64_t(max_mb) * 1024 * 1024, size), lost = 0;
+            int64_t start = node.hardwareTimeUSec();
+            for(int i = 0; i < n && !node.shutdownRequested(); i++)
+            {
+                int64_t t0 = node.hardwareTimeUSec();
+                pub.publish(payload, compression);
+                if(!sub.poll(5000))
+                {
+                    lost++;
+                    continue;
+                }
+                sub.readRaw(reply, type);
+                rtt.record(node.hardwareTimeUSec() - t0);
+            }
+            double elapsed = (node.hardwareTimeUSec() - start) / 1e6;
+
+            boost::format fmt("%s, \"round_trips\": %d, \"lost\": %d, \"rtt_mean_us\": %.1f, \"rtt_p50_us\": %d, \"rtt_p90_us\": %d, \"rtt_p99_us\": %d, \"rtt_max_us\": %d, \"round_trips_per_sec\": %.1f}");
+            std::cout << (fmt % bench::result("pubsub_latency", o, size, compression) % rtt.count() % lost
+                    % (rtt.count() ? double(rtt.total()) / rtt.count() : 0.0)
+                    % rtt.percentile(50) % rtt.percentile(90) % rtt.percentile(99) % rtt.max()
+                    % (rtt.count() / elapsed)).str() << std::endl;
+        }
+    }
+
+    node.cleanup();
+    return 0;
+}
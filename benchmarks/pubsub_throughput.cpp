@@ -0,0 +1,150 @@
+/*
+ * Maximum throughput: the publisher sends messages as fast as it can for some time, for
+ * each message size and compression algorithm, and each subscriber reports the rate at
+ * which it received them. Prints one JSON object per line (one for the publisher, and one
+ * per subscriber).
+ *
+ * Same process:  bench_pubsub_throughput -r -x inproc --subscribers 4
+ * Other hosts:   bench_pubsub_throughput --role sub (one or more), then --role pub
+ */
+
+#include <iostream>
+#include <string>
+
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+#include "common.h"
+
+bench::Options o;
+
+boost::mutex output_mutex;
+
+//! A run is tagged by the content type of its messages: "<compression>:<size>"
+static std::string tag(const std::string &compression, size_t size)
+{
+    return (compression.empty() ? "none" : compression) + ":" + std::to_string(size);
+}
+
+void sub(int index)
+{
+    b0::Node node("bench_sub");
+    std::string current;
+    bool reported = true;
+    uint64_t received = 0, bytes = 0;
+    int64_t first = 0, last = 0;
+    b0::Subscriber sub(&node, "bench/data", b0::Subscriber::CallbackRawType([&](const std::string &payload, const std::string &type) {
+        if(type == "warmup") return;
+        if(type.compare(0, 4, "end:") == 0)
+        {
+            if(reported || type.substr(4) != current) return;
+            reported = true;
+            double elapsed = (last - first) / 1e6;
+            uint64_t sent = boost::lexical_cast<uint64_t>(payload);
+            size_t colon = current.rfind(':');
+            std::string compression = current.substr(0, colon);
+            size_t size = boost::lexical_cast<size_t>(current.substr(colon + 1));
+            boost::format fmt("%s, \"role\": \"sub\", \"subscriber\": %d, \"sent\": %d, \"received\": %d, \"msgs_per_sec\": %.1f, \"bytes_per_sec\": %.1f}");
+            boost::mutex::scoped_lock lock(output_mutex);
+            std::cout << (fmt % bench::result("pubsub_throughput", o, size, compression == "none" ? "" : compression)
+                    % index % sent % received
+                    % (elapsed > 0 ? (received - 1) / elapsed : 0.0)
+                    % (elapsed > 0 ? double(bytes) * (received - 1) / received / elapsed : 0.0)).str() << std::endl;
+            return;
+        }
+        int64_t now = node.hardwareTimeUSec();
+        if(type != current)
+        {
+            current = type;
+            reported = false;
+            received = bytes = 0;
+            first = now;
+        }
+        received++;
+        bytes += payload.size();
+        last = now;
+    }));
+    node.init();
+    node.spin();
+    node.cleanup();
+}
+
+int main(int argc, char **argv)
+{
+    std::string role = "both";
+    int subscribers = 1;
+    double duration = 2.0;
+    bench::addOptions(o);
+    b0::addOptionString("role", "pub, sub, or both (in this process)", &role, false, "both");
+    b0::addOptionInt("subscribers,S", "number of subscribers (with role both)", &subscribers, false, 1);
+    b0::addOptionDouble("duration,d", "seconds of publishing per message size", &duration, false, 2.0);
+    b0::init(argc, argv);
+    bench::applyOptions(o);
+    bench::startResolver(o);
+
+    if(role == "sub")
+    {
+        sub(0);
+        return 0;
+    }
+    if(role != "pub" && role != "both")
+        throw b0::exception::ArgumentError(role, "role");
+    if(role == "both")
+    {
+        for(int i = 0; i < subscribers; i++)
+            boost::thread(&sub, i).detach();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    }
+
+    b0::Node node("bench_pub");
+    b0::Publisher pub(&node, "bench/data");
+    node.init();
+
+    for(auto &compression : o.compression)
+    {
+        pub.setCompression(compression);
+        for(int size : o.sizes)
+        {
+            std::string payload = bench::makePayload(size), t = tag(compression, size);
+
+            // let the subscribers connect
+            int64_t end = node.hardwareTimeUSec() + 500000;
+            while(node.hardwareTimeUSec() < end)
+            {
+                pub.publish("", "warmup");
+                node.sleepUSec(10000);
+            }
+
+            uint64_t sent = 0;
+            int64_t start = node.hardwareTimeUSec();
+            end = start + int64_t(duration * 1e6);
+            while(node.hardwareTimeUSec() < end && !node.shutdownRequested())
+            {
+                pub.publish(payload, t);
+                sent++;
+            }
+            double elapsed = (node.hardwareTimeUSec() - start) / 1e6;
+
+            // sent on the same topic, so that it arrives after the data; repeated in case of drops
+            for(int i = 0; i < 3; i++)
+            {
+                node.sleepUSec(200000);
+                pub.publish(std::to_string(sent), "end:" + t);
+            }
+
+            boost::format fmt("%s, \"role\": \"pub\", \"sent\": %d, \"msgs_per_sec\": %.1f, \"bytes_per_sec\": %.1f}");
+            boost::mutex::scoped_lock lock(output_mutex);
+            std::cout << (fmt % bench::result("pubsub_throughput", o, size, compression)
+                    % sent % (sent / elapsed) % (double(sent) * size / elapsed)).str() << std::endl;
+        }
+    }
+
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    node.cleanup();
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * Resolver under mass-announce load: thousands of nodes, each with a publisher, are
+ * initialized (announcing the node and its topic to the resolver) from concurrent threads,
+ * then cleaned up. Prints one JSON object with the rates and latency percentiles.
+ *
+ * bench_resolver_announce -r --nodes 2000 --threads 32
+ */
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/utils/metrics.h>
+
+#include "common.h"
+
+struct NodeWithPublisher
+{
+    NodeWithPublisher(int i)
+        : node((boost::format("bench_node_%d") % i).str()),
+          pub(&node, (boost::format("bench/topic_%d") % (i % 100)).str())
+    {
+    }
+
+    b0::Node node;
+    b0::Publisher pub;
+};
+
+void worker(int first, int count, std::vector<std::unique_ptr<NodeWithPublisher>> &nodes, b0::LatencyHistogram &announce, boost::barrier &barrier, b0::LatencyHistogram &cleanup)
+{
+    for(int i = first; i < first + count; i++)
+    {
+        nodes[i].reset(new NodeWithPublisher(i));
+        int64_t t0 = bench::nowUSec();
+        nodes[i]->node.init();
+        announce.record(bench::nowUSec() - t0);
+    }
+    barrier.wait();
+    for(int i = first; i < first + count; i++)
+    {
+        int64_t t0 = bench::nowUSec();
+        nodes[i]->node.cleanup();
+        cleanup.record(bench::nowUSec() - t0);
+        nodes[i].reset();
+    }
+}
+
+static std::string stats(const std::string &name, const b0::LatencyHistogram &h, double elapsed)
+{
+    boost::format fmt("\"%s_per_sec\": %.1f, \"%s_p50_us\": %d, \"%s_p99_us\": %d, \"%s_p999_us\": %d, \"%s_max_us\": %d");
+    return (fmt % name % (h.count() / elapsed) % name % h.percentile(50) % name % h.percentile(99)
+            % name % h.percentile(99.9) % name % h.max()).str();
+}
+
+int main(int argc, char **argv)
+{
+    bench::Options o;
+    int num_nodes = 1000, num_threads = 16;
+    bench::addOptions(o);
+    b0::addOptionInt("nodes,N", "number of nodes", &num_nodes, false, 1000);
+    b0::addOptionInt("threads,T", "number of threads initializing the nodes", &num_threads, false, 16);
+    b0::init(argc, argv);
+    bench::applyOptions(o);
+    bench::startResolver(o);
+
+    if(num_nodes < 1 || num_threads < 1)
+        throw b0::exception::ArgumentError(std::to_string(num_nodes) + "/" + std::to_string(num_threads), "nodes/threads");
+    num_threads = std::min(num_threads, num_nodes);
+
+    std::vector<std::unique_ptr<NodeWithPublisher>> nodes(num_nodes);
+    b0::LatencyHistogram announce, cleanup;
+    // the main thread also waits, to time the phases
+    boost::barrier barrier(num_threads + 1);
+    boost::thread_group group;
+    int64_t start = bench::nowUSec();
+    for(int t = 0, first = 0; t < num_threads; t++)
+    {
+        int count = num_nodes / num_threads + (t < num_nodes % num_threads ? 1 : 0);
+        group.create_thread(boost::bind(&worker, first, count, boost::ref(nodes), boost::ref(announce), boost::ref(barrier), boost::ref(cleanup)));
+        first += count;
+    }
+    barrier.wait();
+    int64_t announced = bench::nowUSec();
+    group.join_all();
+    int64_t end = bench::nowUSec();
+
+    boost::format fmt("{\"benchmark\": \"resolver_announce\", \"transport\": \"%s\", \"p2p\": %s, \"nodes\": %d, \"threads\": %d, %s, %s}");
+    std::cout << (fmt % o.transport % (b0::hasOption("p2p") ? "true" : "false") % num_nodes % num_threads
+            % stats("announce", announce, (announced - start) / 1e6)
+            % stats("cleanup", cleanup, (end - announced) / 1e6)).str() << std::endl;
+    return 0;
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+# Run the benchmarks in a single host, sweeping transport, routing and number of subscribers.
+# Usage: run.sh <build-dir> [extra options...] > results.jsonl
+# Remote runs need the roles to be started by hand on each host (see the benchmark sources).
+
+set -e
+BIN="${1:-build}/benchmarks"
+shift || true
+
+for routing in "" "--p2p"; do
+    "$BIN/bench_pubsub_latency" -r -x inproc $routing -z none -z lz4 "$@"
+    for transport in ipc tcp; do
+        "$BIN/bench_pubsub_latency" -r --role pong -x $transport $routing >/dev/null 2>&1 &
+        PONG=$!
+        sleep 1
+        "$BIN/bench_pubsub_latency" --role ping -x $transport $routing -z none -z lz4 "$@"
+        kill $PONG
+        wait $PONG 2>/dev/null || true
+    done
+    for subscribers in 1 4 16; do
+        "$BIN/bench_pubsub_throughput" -r -x tcp $routing -S $subscribers -z none -z lz4 "$@"
+    done
+    for workers in 0 4; do
+        "$BIN/bench_service" -r -x tcp $routing -w $workers -s 64 -s 16384 -s 1048576
+    done
+done
+
+"$BIN/bench_resolver_announce" -r -N 2000 -T 32
+"$BIN/bench_envelope"
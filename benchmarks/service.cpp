@@ -0,0 +1,132 @@
+/*
+ * Service calls: concurrent clients call a service with a handler of configurable cost, for
+ * each request size, compression algorithm (of the requests) and number of clients. Prints one JSON object per line with calls/s and
+ * latency percentiles.
+ *
+ * Same process:  bench_service -r -x inproc --clients 1 --clients 8
+ * Other hosts:   bench_service --role server, then bench_service --role client
+ */
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+#include <b0/utils/metrics.h>
+
+#include "common.h"
+
+std::atomic<int64_t> handler_usec{0};
+
+void server(int workers)
+{
+    b0::Node node("bench_server");
+    b0::ServiceServer srv(&node, "bench/service", b0::ServiceServer::CallbackRaw([&](const std::string &req, std::string &rep) {
+        // simulated handler cost, busy-waiting (sleeping would not load the server)
+        int64_t end = bench::nowUSec() + handler_usec.load();
+        while(bench::nowUSec() < end) {}
+        rep = req;
+    }));
+    srv.setWorkerThreads(workers);
+    node.init();
+    node.spin();
+    node.cleanup();
+}
+
+void client(const std::string &payload, const std::string &compression, int64_t end, b0::LatencyHistogram &latency, std::atomic<uint64_t> &errors)
+{
+    b0::Node node("bench_client");
+    b0::ServiceClient cli(&node, "bench/service");
+    cli.setCompression(compression);
+    node.init();
+    std::string rep;
+    cli.call(payload, rep); // warm-up
+    while(bench::nowUSec() < end)
+    {
+        int64_t t0 = bench::nowUSec();
+        try
+        {
+            cli.call(payload, rep);
+            latency.record(bench::nowUSec() - t0);
+        }
+        catch(b0::exception::Exception &)
+        {
+            errors++;
+        }
+    }
+    node.cleanup();
+}
+
+int main(int argc, char **argv)
+{
+    bench::Options o;
+    std::string role = "both";
+    std::vector<int> clients, handler_costs;
+    int workers = 0;
+    double duration = 2.0;
+    bench::addOptions(o);
+    b0::addOptionString("role", "server, client, or both (in this process)", &role, false, "both");
+    b0::addOptionIntVector("clients,C", "numbers of concurrent clients to test (can be repeated)", &clients, false, {1, 4, 16});
+    b0::addOptionIntVector("handler-usec,H", "handler costs to test, in microseconds (can be repeated)", &handler_costs, false, {0, 100});
+    b0::addOptionInt("workers,w", "worker threads of the server (0 = calls served by spinOnce())", &workers, false, 0);
+    b0::addOptionDouble("duration,d", "seconds of calls per configuration", &duration, false, 2.0);
+    b0::init(argc, argv);
+    bench::applyOptions(o);
+    bench::startResolver(o);
+
+    if(role == "server")
+    {
+        handler_usec = handler_costs.empty() ? 0 : handler_costs[0];
+        server(workers);
+        return 0;
+    }
+    if(role != "client" && role != "both")
+        throw b0::exception::ArgumentError(role, "role");
+    if(role == "both")
+    {
+        boost::thread(&server, workers).detach();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    }
+    else
+    {
+        // the handler cost is set by the server's own options
+        handler_costs.resize(1);
+    }
+
+    for(int cost : handler_costs)
+    {
+        handler_usec = cost;
+        for(int size : o.sizes)
+        {
+            std::string payload = bench::makePayload(size);
+            for(auto &compression : o.compression)
+            {
+                for(int n : clients)
+                {
+                    b0::LatencyHistogram latency;
+                    std::atomic<uint64_t> errors{0};
+                    int64_t start = bench::nowUSec(), end = start + int64_t(duration * 1e6);
+                    boost::thread_group group;
+                    for(int i = 0; i < n; i++)
+                        group.create_thread(boost::bind(&client, boost::cref(payload), boost::cref(compression), end, boost::ref(latency), boost::ref(errors)));
+                    group.join_all();
+                    double elapsed = (bench::nowUSec() - start) / 1e6;
+
+                    boost::format fmt("%s, \"clients\": %d, \"workers\": %d, \"handler_usec\": %d, \"calls\": %d, \"errors\": %d, \"calls_per_sec\": %.1f, \"latency_mean_us\": %.1f, \"latency_p50_us\": %d, \"latency_p99_us\": %d, \"latency_p999_us\": %d, \"latency_max_us\": %d}");
+                    std::cout << (fmt % bench::result("service", o, size, compression) % n % workers % cost
+                            % latency.count() % errors.load() % (latency.count() / elapsed)
+                            % (latency.count() ? double(latency.total()) / latency.count() : 0.0)
+                            % latency.percentile(50) % latency.percentile(99) % latency.percentile(99.9) % latency.max()).str() << std::endl;
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,864 @@
+// C# bindings of the C API of BlueZero (see include/b0/bindings/c.h), with payloads as spans
+//
+// Unlike the SWIG bindings (bluezero.i), the payloads are not marshalled into byte[]:
+//  - received payloads are ReadOnlySpan<byte> over the native buffers, lent until the
+//    Message is disposed (Subscriber.ReadLend(), Subscriber.ReadBatch()) or, in the
+//    callbacks, until the callback returns;
+//  - published payloads are read in place from a ReadOnlySpan<byte> or a pinned
+//    ReadOnlyMemory<byte> (the library copies them once, after the envelope headers), or
+//    written directly in the frame sent (Publisher.NewFrame()), without any copy.
+//
+// Needs .NET Standard 2.1 (e.g. .NET Core 3.0 or later, Unity 2021.2 or later) and unsafe
+// code (csc -unsafe, or AllowUnsafeBlocks). The native library is libb0.so / b0.dll.
+//
+// With IL2CPP, native code can only call static methods: use the polling functions
+// (Subscriber.Poll() and ReadLend()) instead of the callbacks.
+
+using System;
+using System.Buffers;
+using System.Runtime.InteropServices;
+
+namespace BlueZero
+{
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct MessageRef
+    {
+        public IntPtr data;
+        public UIntPtr size;
+        public IntPtr type;
+    }
+
+    internal static class Native
+    {
+        private const string Lib = "b0";
+
+        // (the C long arguments are passed as IntPtr, which has their size on the 64-bit
+        // platforms, Windows included, in the argument registers, and on the 32-bit ones)
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate void SubscriberCallback(IntPtr data, UIntPtr size);
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate IntPtr ServiceServerCallback(IntPtr data, UIntPtr size, out UIntPtr outSize);
+
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_init(ref int argc, string[] argv);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_is_initialized();
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_quit_requested();
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_quit();
+
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr b0_buffer_new(UIntPtr size);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void b0_buffer_delete(IntPtr buffer);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void b0_message_release(IntPtr msg);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void b0_frame_delete(IntPtr frame);
+
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr b0_node_new(string name);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void b0_node_delete(IntPtr node);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_node_init(IntPtr node);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_node_shutdown(IntPtr node);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_node_shutdown_requested(IntPtr node);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_node_spin_once(IntPtr node);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_node_spin(IntPtr node);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_node_cleanup(IntPtr node);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr b0_node_get_name(IntPtr node);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern long b0_node_time_usec(IntPtr node);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_node_log(IntPtr node, int level, string message);
+
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr b0_publisher_new_ex(IntPtr node, string topic, int managed, int notifyGraph);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void b0_publisher_delete(IntPtr pub);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_publisher_init(IntPtr pub);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_publisher_cleanup(IntPtr pub);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern unsafe int b0_publisher_publish_owned(IntPtr pub, void *data, UIntPtr size, IntPtr freeFn, IntPtr hint);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr b0_publisher_frame_new(IntPtr pub, UIntPtr size, out IntPtr data);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_publisher_publish_frame(IntPtr pub, IntPtr frame);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_publisher_set_option(IntPtr pub, int option, int value);
+
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr b0_subscriber_new_ex(IntPtr node, string topic, SubscriberCallback callback, int managed, int notifyGraph);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void b0_subscriber_delete(IntPtr sub);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_subscriber_init(IntPtr sub);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_subscriber_cleanup(IntPtr sub);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_subscriber_poll(IntPtr sub, IntPtr timeout);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr b0_subscriber_read_lend(IntPtr sub, out IntPtr data, out UIntPtr size);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern unsafe IntPtr b0_subscriber_read_batch(IntPtr sub, MessageRef *msgs, UIntPtr maxCount, out UIntPtr count, IntPtr timeout);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_subscriber_set_option(IntPtr sub, int option, int value);
+
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr b0_service_client_new_ex(IntPtr node, string service, int managed, int notifyGraph);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void b0_service_client_delete(IntPtr cli);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_service_client_init(IntPtr cli);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_service_client_cleanup(IntPtr cli);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern unsafe IntPtr b0_service_client_call(IntPtr cli, void *data, UIntPtr size, out UIntPtr outSize);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern unsafe int b0_service_client_call_into(IntPtr cli, void *data, UIntPtr size, void *buffer, UIntPtr capacity, out UIntPtr outSize);
+
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr b0_service_server_new_ex(IntPtr node, string service, ServiceServerCallback callback, int managed, int notifyGraph);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void b0_service_server_delete(IntPtr srv);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_service_server_init(IntPtr srv);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_service_server_cleanup(IntPtr srv);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int b0_service_server_poll(IntPtr srv, IntPtr timeout);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr b0_service_server_read_lend(IntPtr srv, out IntPtr data, out UIntPtr size);
+        [DllImport(Lib, CallingConvention = CallingConvention.Cdecl)]
+        public static extern unsafe int b0_service_server_write(IntPtr srv, void *data, UIntPtr size);
+
+        // the C functions return 1 on success, 0 if an exception was caught
+        public static void Check(int ret, string function)
+        {
+            if(ret == 0)
+                throw new BlueZeroException(function + " failed");
+        }
+    }
+
+    /// <summary>An error reported by the native library</summary>
+    public class BlueZeroException : Exception
+    {
+        public BlueZeroException(string message) : base(message) {}
+    }
+
+    /// <summary>Socket options (see B0_SOCK_OPT_* in c.h)</summary>
+    public enum SocketOption
+    {
+        LingerPeriod = 1,
+        Backlog = 2,
+        ReadTimeout = 3,
+        WriteTimeout = 4,
+        Immediate = 5,
+        Conflate = 6,
+        ReadHWM = 7,
+        WriteHWM = 8,
+    }
+
+    /// <summary>Log levels (see B0_FATAL... in c.h)</summary>
+    public enum LogLevel
+    {
+        Trace = 100,
+        Debug = 200,
+        Info = 300,
+        Warn = 400,
+        Error = 500,
+        Fatal = 600,
+    }
+
+    public static class Global
+    {
+        /// <summary>Initialize the library (see b0::init()), once, before creating the nodes</summary>
+        public static void Init(string[] args = null)
+        {
+            if(Native.b0_is_initialized() != 0) return;
+            string[] argv = new string[(args == null ? 0 : args.Length) + 1];
+            argv[0] = "b0csharp";
+            if(args != null) Array.Copy(args, 0, argv, 1, args.Length);
+            int argc = argv.Length;
+            Native.Check(Native.b0_init(ref argc, argv), "b0_init");
+        }
+
+        public static bool QuitRequested()
+        {
+            return Native.b0_quit_requested() != 0;
+        }
+
+        public static void Quit()
+        {
+            Native.b0_quit();
+        }
+    }
+
+    /// <summary>
+    /// A received message lent by the library: its payload points into the received buffer,
+    /// and is valid until Dispose()
+    /// </summary>
+    public sealed class Message : IDisposable
+    {
+        private IntPtr msg_;
+        private readonly IntPtr data_;
+        private readonly int size_;
+
+        internal Message(IntPtr msg, IntPtr data, UIntPtr size)
+        {
+            msg_ = msg;
+            data_ = data;
+            size_ = checked((int)size.ToUInt64());
+        }
+
+        ~Message()
+        {
+            Release();
+        }
+
+        /// <summary>The payload (not to be used after Dispose())</summary>
+        public unsafe ReadOnlySpan<byte> Payload
+        {
+            get
+            {
+                if(msg_ == IntPtr.Zero) throw new ObjectDisposedException("Message");
+                return new ReadOnlySpan<byte>(data_.ToPointer(), size_);
+            }
+        }
+
+        public int Length
+        {
+            get { return size_; }
+        }
+
+        /// <summary>Give the buffer back to the library</summary>
+        public void Dispose()
+        {
+            Release();
+            GC.SuppressFinalize(this);
+        }
+
+        private void Release()
+        {
+            if(msg_ == IntPtr.Zero) return;
+            Native.b0_message_release(msg_);
+            msg_ = IntPtr.Zero;
+        }
+    }
+
+    /// <summary>
+    /// Messages read at once (see Subscriber.ReadBatch()), lent by the library until Dispose()
+    /// </summary>
+    public sealed class MessageBatch : IDisposable
+    {
+        private IntPtr msg_;
+        private readonly MessageRef[] refs_;
+        private readonly int count_;
+
+        internal MessageBatch(IntPtr msg, MessageRef[] refs, int count)
+        {
+            msg_ = msg;
+            refs_ = refs;
+            count_ = count;
+        }
+
+        ~MessageBatch()
+        {
+            Release();
+        }
+
+        public int Count
+        {
+            get { return count_; }
+        }
+
+        /// <summary>The payload of the i-th message (not to be used after Dispose())</summary>
+        public unsafe ReadOnlySpan<byte> this[int i]
+        {
+            get
+            {
+                if(msg_ == IntPtr.Zero) throw new ObjectDisposedException("MessageBatch");
+                if(i < 0 || i >= count_) throw new IndexOutOfRangeException();
+                return new ReadOnlySpan<byte>(refs_[i].data.ToPointer(), checked((int)refs_[i].size.ToUInt64()));
+            }
+        }
+
+        /// <summary>The content type of the i-th message</summary>
+        public string ContentType(int i)
+        {
+            if(i < 0 || i >= count_) throw new IndexOutOfRangeException();
+            return refs_[i].type == IntPtr.Zero ? "" : Marshal.PtrToStringAnsi(refs_[i].type);
+        }
+
+        public void Dispose()
+        {
+            Release();
+            GC.SuppressFinalize(this);
+        }
+
+        private void Release()
+        {
+            if(msg_ == IntPtr.Zero) return;
+            Native.b0_message_release(msg_);
+            msg_ = IntPtr.Zero;
+        }
+    }
+
+    /// <summary>A buffer allocated by the library (e.g. a service reply), freed by Dispose()</summary>
+    public sealed class NativeBuffer : IDisposable
+    {
+        private IntPtr data_;
+        private readonly int size_;
+
+        internal NativeBuffer(IntPtr data, UIntPtr size)
+        {
+            data_ = data;
+            size_ = checked((int)size.ToUInt64());
+        }
+
+        ~NativeBuffer()
+        {
+            Release();
+        }
+
+        public unsafe ReadOnlySpan<byte> Data
+        {
+            get
+            {
+                if(data_ == IntPtr.Zero && size_ > 0) throw new ObjectDisposedException("NativeBuffer");
+                return new ReadOnlySpan<byte>(data_.ToPointer(), size_);
+            }
+        }
+
+        public void Dispose()
+        {
+            Release();
+            GC.SuppressFinalize(this);
+        }
+
+        private void Release()
+        {
+            if(data_ == IntPtr.Zero) return;
+            Native.b0_buffer_delete(data_);
+            data_ = IntPtr.Zero;
+        }
+    }
+
+    public class Node : IDisposable
+    {
+        internal IntPtr handle_;
+
+        public Node(string name = "node")
+        {
+            handle_ = Native.b0_node_new(name);
+        }
+
+        ~Node()
+        {
+            Delete();
+        }
+
+        public void Init()
+        {
+            Native.Check(Native.b0_node_init(handle_), "b0_node_init");
+        }
+
+        public void Shutdown()
+        {
+            Native.Check(Native.b0_node_shutdown(handle_), "b0_node_shutdown");
+        }
+
+        public bool ShutdownRequested()
+        {
+            return Native.b0_node_shutdown_requested(handle_) != 0;
+        }
+
+        public void SpinOnce()
+        {
+            Native.Check(Native.b0_node_spin_once(handle_), "b0_node_spin_once");
+        }
+
+        public void Spin()
+        {
+            Native.Check(Native.b0_node_spin(handle_), "b0_node_spin");
+        }
+
+        public void Cleanup()
+        {
+            Native.Check(Native.b0_node_cleanup(handle_), "b0_node_cleanup");
+        }
+
+        public string Name
+        {
+            get { return Marshal.PtrToStringAnsi(Native.b0_node_get_name(handle_)); }
+        }
+
+        public long TimeUSec()
+        {
+            return Native.b0_node_time_usec(handle_);
+        }
+
+        public void Log(LogLevel level, string message)
+        {
+            Native.Check(Native.b0_node_log(handle_, (int)level, message), "b0_node_log");
+        }
+
+        /// <summary>Delete the native node (its sockets must have been disposed first)</summary>
+        public void Dispose()
+        {
+            Delete();
+            GC.SuppressFinalize(this);
+        }
+
+        private void Delete()
+        {
+            if(handle_ == IntPtr.Zero) return;
+            Native.b0_node_delete(handle_);
+            handle_ = IntPtr.Zero;
+        }
+    }
+
+    /// <summary>
+    /// A payload written directly in the frame sent by a publisher (see Publisher.NewFrame())
+    /// </summary>
+    public sealed class Frame : IDisposable
+    {
+        private readonly Publisher pub_;
+        private IntPtr frame_;
+        private readonly IntPtr data_;
+        private readonly int size_;
+
+        internal Frame(Publisher pub, IntPtr frame, IntPtr data, int size)
+        {
+            pub_ = pub;
+            frame_ = frame;
+            data_ = data;
+            size_ = size;
+        }
+
+        ~Frame()
+        {
+            Release();
+        }
+
+        /// <summary>The payload to write (not to be used after Publish() or Dispose())</summary>
+        public unsafe Span<byte> Data
+        {
+            get
+            {
+                if(frame_ == IntPtr.Zero) throw new ObjectDisposedException("Frame");
+                return new Span<byte>(data_.ToPointer(), size_);
+            }
+        }
+
+        /// <summary>Send the frame, without copying the payload</summary>
+        public void Publish()
+        {
+            if(frame_ == IntPtr.Zero) throw new ObjectDisposedException("Frame");
+            IntPtr frame = frame_;
+            frame_ = IntPtr.Zero;
+            GC.SuppressFinalize(this);
+            // (the frame is deleted by the library, also on failure)
+            Native.Check(Native.b0_publisher_publish_frame(pub_.handle_, frame), "b0_publisher_publish_frame");
+        }
+
+        /// <summary>Drop the frame without sending it</summary>
+        public void Dispose()
+        {
+            Release();
+            GC.SuppressFinalize(this);
+        }
+
+        private void Release()
+        {
+            if(frame_ == IntPtr.Zero) return;
+            Native.b0_frame_delete(frame_);
+            frame_ = IntPtr.Zero;
+        }
+    }
+
+    public class Publisher : IDisposable
+    {
+        internal IntPtr handle_;
+        // (keeps the node alive while this socket exists)
+        private readonly Node node_;
+
+        public Publisher(Node node, string topic, bool managed = true, bool notifyGraph = true)
+        {
+            node_ = node;
+            handle_ = Native.b0_publisher_new_ex(node.handle_, topic, managed ? 1 : 0, notifyGraph ? 1 : 0);
+        }
+
+        ~Publisher()
+        {
+            Delete();
+        }
+
+        public void Init()
+        {
+            Native.Check(Native.b0_publisher_init(handle_), "b0_publisher_init");
+        }
+
+        public void Cleanup()
+        {
+            Native.Check(Native.b0_publisher_cleanup(handle_), "b0_publisher_cleanup");
+        }
+
+        public void SetOption(SocketOption option, int value)
+        {
+            Native.Check(Native.b0_publisher_set_option(handle_, (int)option, value), "b0_publisher_set_option");
+        }
+
+        /// <summary>Publish a payload, read in place (copied once by the library, after the envelope headers)</summary>
+        public unsafe void Publish(ReadOnlySpan<byte> payload)
+        {
+            fixed(byte *p = payload)
+            {
+                Native.Check(Native.b0_publisher_publish_owned(handle_, p, (UIntPtr)payload.Length, IntPtr.Zero, IntPtr.Zero), "b0_publisher_publish_owned");
+            }
+        }
+
+        /// <summary>Publish a payload, pinned while it is read in place (e.g. a slice of a pooled array)</summary>
+        public unsafe void Publish(ReadOnlyMemory<byte> payload)
+        {
+            using(MemoryHandle pin = payload.Pin())
+            {
+                Native.Check(Native.b0_publisher_publish_owned(handle_, pin.Pointer, (UIntPtr)payload.Length, IntPtr.Zero, IntPtr.Zero), "b0_publisher_publish_owned");
+            }
+        }
+
+        /// <summary>
+        /// Return a frame of size bytes to write the payload into, sent by Frame.Publish()
+        /// without any copy (the envelope headers are written in front of it)
+        /// </summary>
+        public Frame NewFrame(int size)
+        {
+            if(size < 0) throw new ArgumentOutOfRangeException("size");
+            IntPtr data;
+            IntPtr frame = Native.b0_publisher_frame_new(handle_, (UIntPtr)size, out data);
+            if(frame == IntPtr.Zero)
+                throw new BlueZeroException("b0_publisher_frame_new failed");
+            return new Frame(this, frame, data, size);
+        }
+
+        public void Dispose()
+        {
+            Delete();
+            GC.SuppressFinalize(this);
+        }
+
+        private void Delete()
+        {
+            if(handle_ == IntPtr.Zero) return;
+            Native.b0_publisher_delete(handle_);
+            handle_ = IntPtr.Zero;
+        }
+    }
+
+    /// <summary>Called with a payload lent only until the callback returns</summary>
+    public delegate void PayloadCallback(ReadOnlySpan<byte> payload);
+
+    public class Subscriber : IDisposable
+    {
+        internal IntPtr handle_;
+        // (keeps the node alive while this socket exists)
+        private readonly Node node_;
+        // (referenced here so that it is not collected while the native code can call it)
+        private readonly Native.SubscriberCallback native_callback_;
+        private MessageRef[] batch_refs_;
+
+        /// <summary>A subscriber read with ReadLend() or ReadBatch() (callback null), or calling back on spin</summary>
+        public Subscriber(Node node, string topic, PayloadCallback callback = null, bool managed = true, bool notifyGraph = true)
+        {
+            node_ = node;
+            if(callback != null)
+            {
+                native_callback_ = (data, size) =>
+                {
+                    unsafe
+                    {
+                        callback(new ReadOnlySpan<byte>(data.ToPointer(), checked((int)size.ToUInt64())));
+                    }
+                };
+            }
+            handle_ = Native.b0_subscriber_new_ex(node.handle_, topic, native_callback_, managed ? 1 : 0, notifyGraph ? 1 : 0);
+        }
+
+        ~Subscriber()
+        {
+            Delete();
+        }
+
+        public void Init()
+        {
+            Native.Check(Native.b0_subscriber_init(handle_), "b0_subscriber_init");
+        }
+
+        public void Cleanup()
+        {
+            Native.Check(Native.b0_subscriber_cleanup(handle_), "b0_subscriber_cleanup");
+        }
+
+        public void SetOption(SocketOption option, int value)
+        {
+            Native.Check(Native.b0_subscriber_set_option(handle_, (int)option, value), "b0_subscriber_set_option");
+        }
+
+        /// <summary>Wait up to timeout ms (0: do not wait, -1: forever) for a message</summary>
+        public bool Poll(int timeout = 0)
+        {
+            return Native.b0_subscriber_poll(handle_, (IntPtr)timeout) != 0;
+        }
+
+        /// <summary>Read a message, lent until disposed (no copy of the payload)</summary>
+        public Message ReadLend()
+        {
+            IntPtr data;
+            UIntPtr size;
+            IntPtr msg = Native.b0_subscriber_read_lend(handle_, out data, out size);
+            if(msg == IntPtr.Zero)
+                throw new BlueZeroException("b0_subscriber_read_lend failed");
+            return new Message(msg, data, size);
+        }
+
+        /// <summary>
+        /// Read up to maxCount messages, waiting up to timeout ms for the first one (lent until
+        /// the batch is disposed; the batch must be disposed before the next call)
+        /// </summary>
+        public unsafe MessageBatch ReadBatch(int maxCount, int timeout = 0)
+        {
+            if(maxCount <= 0) throw new ArgumentOutOfRangeException("maxCount");
+            if(batch_refs_ == null || batch_refs_.Length < maxCount)
+                batch_refs_ = new MessageRef[maxCount];
+            MessageRef[] refs = batch_refs_;
+            UIntPtr count;
+            IntPtr msg;
+            fixed(MessageRef *p = refs)
+            {
+                msg = Native.b0_subscriber_read_batch(handle_, p, (UIntPtr)maxCount, out count, (IntPtr)timeout);
+            }
+            if(msg == IntPtr.Zero)
+                throw new BlueZeroException("b0_subscriber_read_batch failed");
+            // (a new array for the next batch, since this one is kept by the returned batch)
+            batch_refs_ = null;
+            return new MessageBatch(msg, refs, (int)count.ToUInt64());
+        }
+
+        public void Dispose()
+        {
+            Delete();
+            GC.SuppressFinalize(this);
+        }
+
+        private void Delete()
+        {
+            if(handle_ == IntPtr.Zero) return;
+            Native.b0_subscriber_delete(handle_);
+            handle_ = IntPtr.Zero;
+        }
+    }
+
+    public class ServiceClient : IDisposable
+    {
+        internal IntPtr handle_;
+        // (keeps the node alive while this socket exists)
+        private readonly Node node_;
+
+        public ServiceClient(Node node, string service, bool managed = true, bool notifyGraph = true)
+        {
+            node_ = node;
+            handle_ = Native.b0_service_client_new_ex(node.handle_, service, managed ? 1 : 0, notifyGraph ? 1 : 0);
+        }
+
+        ~ServiceClient()
+        {
+            Delete();
+        }
+
+        public void Init()
+        {
+            Native.Check(Native.b0_service_client_init(handle_), "b0_service_client_init");
+        }
+
+        public void Cleanup()
+        {
+            Native.Check(Native.b0_service_client_cleanup(handle_), "b0_service_client_cleanup");
+        }
+
+        /// <summary>Call the service; the reply is in a native buffer, freed when disposed</summary>
+        public unsafe NativeBuffer Call(ReadOnlySpan<byte> request)
+        {
+            UIntPtr size;
+            IntPtr reply;
+            fixed(byte *p = request)
+            {
+                reply = Native.b0_service_client_call(handle_, p, (UIntPtr)request.Length, out size);
+            }
+            if(reply == IntPtr.Zero)
+                throw new BlueZeroException("b0_service_client_call failed");
+            return new NativeBuffer(reply, size);
+        }
+
+        /// <summary>
+        /// Call the service, with the reply copied in reply (truncated if too small);
+        /// return the size of the reply
+        /// </summary>
+        public unsafe int Call(ReadOnlySpan<byte> request, Span<byte> reply)
+        {
+            UIntPtr size;
+            fixed(byte *p = request)
+            fixed(byte *r = reply)
+            {
+                Native.Check(Native.b0_service_client_call_into(handle_, p, (UIntPtr)request.Length, r, (UIntPtr)reply.Length, out size), "b0_service_client_call_into");
+            }
+            return checked((int)size.ToUInt64());
+        }
+
+        public void Dispose()
+        {
+            Delete();
+            GC.SuppressFinalize(this);
+        }
+
+        private void Delete()
+        {
+            if(handle_ == IntPtr.Zero) return;
+            Native.b0_service_client_delete(handle_);
+            handle_ = IntPtr.Zero;
+        }
+    }
+
+    /// <summary>A reply written by a ServiceHandler</summary>
+    public interface IReplyWriter
+    {
+        /// <summary>Return a buffer of size bytes for the reply (written in place)</summary>
+        Span<byte> GetBuffer(int size);
+    }
+
+    /// <summary>Called with a request lent until the handler returns</summary>
+    public delegate void ServiceHandler(ReadOnlySpan<byte> request, IReplyWriter reply);
+
+    public class ServiceServer : IDisposable
+    {
+        internal IntPtr handle_;
+        // (keeps the node alive while this socket exists)
+        private readonly Node node_;
+        // (referenced here so that it is not collected while the native code can call it)
+        private readonly Native.ServiceServerCallback native_callback_;
+
+        // the reply of the native callback, in a buffer of the library (which frees it)
+        private sealed class ReplyWriter : IReplyWriter
+        {
+            public IntPtr data = IntPtr.Zero;
+            public int size = 0;
+
+            public unsafe Span<byte> GetBuffer(int size)
+            {
+                if(data != IntPtr.Zero) throw new InvalidOperationException("the reply buffer was already requested");
+                if(size < 0) throw new ArgumentOutOfRangeException("size");
+                // (at least one byte, since a null buffer means no reply)
+                data = Native.b0_buffer_new((UIntPtr)Math.Max(size, 1));
+                this.size = size;
+                return new Span<byte>(data.ToPointer(), size);
+            }
+        }
+
+        /// <summary>A server read with Poll() and ReadLend() (handler null), or calling back on spin</summary>
+        public ServiceServer(Node node, string service, ServiceHandler handler = null, bool managed = true, bool notifyGraph = true)
+        {
+            node_ = node;
+            if(handler != null)
+            {
+                native_callback_ = (IntPtr data, UIntPtr size, out UIntPtr outSize) =>
+                {
+                    ReplyWriter writer = new ReplyWriter();
+                    try
+                    {
+                        unsafe
+                        {
+                            handler(new ReadOnlySpan<byte>(data.ToPointer(), checked((int)size.ToUInt64())), writer);
+                        }
+                    }
+                    catch(Exception)
+                    {
+                        // (exceptions cannot cross into the native code: an empty reply)
+                        if(writer.data != IntPtr.Zero) Native.b0_buffer_delete(writer.data);
+                        writer.data = IntPtr.Zero;
+                        writer.size = 0;
+                    }
+                    if(writer.data == IntPtr.Zero)
+                        writer.GetBuffer(0);
+                    outSize = (UIntPtr)writer.size;
+                    return writer.data;
+                };
+            }
+            handle_ = Native.b0_service_server_new_ex(node.handle_, service, native_callback_, managed ? 1 : 0, notifyGraph ? 1 : 0);
+        }
+
+        ~ServiceServer()
+        {
+            Delete();
+        }
+
+        public void Init()
+        {
+            Native.Check(Native.b0_service_server_init(handle_), "b0_service_server_init");
+        }
+
+        public void Cleanup()
+        {
+            Native.Check(Native.b0_service_server_cleanup(handle_), "b0_service_server_cleanup");
+        }
+
+        /// <summary>Wait up to timeout ms (0: do not wait, -1: forever) for a request</summary>
+        public bool Poll(int timeout = 0)
+        {
+            return Native.b0_service_server_poll(handle_, (IntPtr)timeout) != 0;
+        }
+
+        /// <summary>Read a request, lent until disposed; the reply must be sent with Write()</summary>
+        public Message ReadLend()
+        {
+            IntPtr data;
+            UIntPtr size;
+            IntPtr msg = Native.b0_service_server_read_lend(handle_, out data, out size);
+            if(msg == IntPtr.Zero)
+                throw new BlueZeroException("b0_service_server_read_lend failed");
+            return new Message(msg, data, size);
+        }
+
+        /// <summary>Send the reply to the request read</summary>
+        public unsafe void Write(ReadOnlySpan<byte> reply)
+        {
+            fixed(byte *p = reply)
+            {
+                Native.Check(Native.b0_service_server_write(handle_, p, (UIntPtr)reply.Length), "b0_service_server_write");
+            }
+        }
+
+        public void Dispose()
+        {
+            Delete();
+            GC.SuppressFinalize(this);
+        }
+
+        private void Delete()
+        {
+            if(handle_ == IntPtr.Zero) return;
+            Native.b0_service_server_delete(handle_);
+            handle_ = IntPtr.Zero;
+        }
+    }
+}
@@ -0,0 +1,36 @@
+using System;
+using BlueZero;
+
+// publishes point clouds written in place, and reads them back without copies
+public class test_bluezero_span {
+    static void Main(string[] args) {
+        Global.Init(args);
+        using(Node node = new Node("csharp-span-node"))
+        using(Publisher pub = new Publisher(node, "points"))
+        using(Subscriber sub = new Subscriber(node, "points"))
+        {
+            node.Init();
+            int received = 0;
+            for(int i = 0; i < 100 && !node.ShutdownRequested(); i++)
+            {
+                using(Frame frame = pub.NewFrame(12 * 1000))
+                {
+                    Span<byte> points = frame.Data;
+                    points.Fill((byte)i);
+                    frame.Publish();
+                }
+                while(sub.Poll(10))
+                {
+                    using(Message msg = sub.ReadLend())
+                    {
+                        ReadOnlySpan<byte> points = msg.Payload;
+                        Console.WriteLine("received {0} bytes ({1})", points.Length, points[0]);
+                        received++;
+                    }
+                }
+            }
+            node.Cleanup();
+            Console.WriteLine("received {0} messages", received);
+        }
+    }
+}
@@ -65,6 +65,37 @@ JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0PublisherPublish(JNIEnv *env,
     env->ReleaseByteArrayElements(data,bufferPtr,0);
 }
 
+/*
+ * The *Direct functions take and return java.nio direct ByteBuffers, whose memory is read
+ * and written in place: no copy through a Java byte[].
+ */
+
+JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0PublisherPublishDirect(JNIEnv *env, jobject obj, jlong pub, jobject buffer, jint offset, jint length)
+{
+    char* bufferPtr=(char*)env->GetDirectBufferAddress(buffer);
+    if(!bufferPtr) return;
+    b0_publisher_publish((b0_publisher*)pub, bufferPtr+offset, length);
+}
+
+JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0PublisherPublishBatchDirect(JNIEnv *env, jobject obj, jlong pub, jobjectArray buffers, jintArray lengths)
+{
+    // sent as one batch envelope (see b0_publisher_publish_batch())
+    jsize n=env->GetArrayLength(buffers);
+    jint* lengthsPtr=env->GetIntArrayElements(lengths,0);
+    b0_message_ref* msgs=new b0_message_ref[n];
+    for(jsize i=0;i<n;i++)
+    {
+        jobject buffer=env->GetObjectArrayElement(buffers,i);
+        msgs[i].data=env->GetDirectBufferAddress(buffer);
+        msgs[i].size=msgs[i].data?lengthsPtr[i]:0;
+        msgs[i].type=0;
+        env->DeleteLocalRef(buffer);
+    }
+    b0_publisher_publish_batch((b0_publisher*)pub, msgs, n);
+    delete[] msgs;
+    env->ReleaseIntArrayElements(lengths,lengthsPtr,JNI_ABORT);
+}
+
 JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0PublisherSetOption(JNIEnv *env, jobject obj, jlong pub, jlong option, jlong value)
 {
     b0_publisher_set_option((b0_publisher*)pub, option, value);
@@ -104,6 +135,92 @@ JNIEXPORT jbyteArray JNICALL Java_coppelia_b0RemoteApi_b0SubscriberRead(JNIEnv *
     return(jarray);
 }
 
+JNIEXPORT jobject JNICALL Java_coppelia_b0RemoteApi_b0SubscriberReadDirect(JNIEnv *env, jobject obj, jlong sub, jlongArray message)
+{
+    // the buffer points into the received message, valid until b0MessageRelease(message[0])
+    const void* data;
+    size_t l;
+    b0_message* msg=b0_subscriber_read_lend((b0_subscriber*)sub,&data,&l);
+    if(!msg) return(0);
+    jlong handle=(jlong)msg;
+    env->SetLongArrayRegion(message,0,1,&handle);
+    return(env->NewDirectByteBuffer((void*)data,l));
+}
+
+JNIEXPORT jint JNICALL Java_coppelia_b0RemoteApi_b0SubscriberReadInto(JNIEnv *env, jobject obj, jlong sub, jobject buffer)
+{
+    // return the size of the message (truncated if larger than the buffer capacity), or -1
+    void* bufferPtr=env->GetDirectBufferAddress(buffer);
+    jlong capacity=env->GetDirectBufferCapacity(buffer);
+    if(!bufferPtr || capacity<0) return(-1);
+    size_t l;
+    if(!b0_subscriber_read_into((b0_subscriber*)sub,bufferPtr,(size_t)capacity,&l)) return(-1);
+    return((jint)l);
+}
+
+// read a batch, as direct ByteBuffers into buffers[0..count-1]; return count, or -1
+static jint readBatchDirect(JNIEnv *env, b0_subscriber *sub, jobjectArray buffers, jsize maxCount, b0_message **msg, jlong timeout)
+{
+    b0_message_ref* msgs=new b0_message_ref[maxCount];
+    size_t count=0;
+    *msg=b0_subscriber_read_batch(sub,msgs,maxCount,&count,(long)timeout);
+    if(*msg)
+    {
+        for(size_t i=0;i<count;i++)
+        {
+            jobject buffer=env->NewDirectByteBuffer((void*)msgs[i].data,msgs[i].size);
+            env->SetObjectArrayElement(buffers,i,buffer);
+            env->DeleteLocalRef(buffer);
+        }
+    }
+    delete[] msgs;
+    return(*msg?(jint)count:-1);
+}
+
+JNIEXPORT jint JNICALL Java_coppelia_b0RemoteApi_b0SubscriberReadBatchDirect(JNIEnv *env, jobject obj, jlong sub, jobjectArray buffers, jlongArray message, jlong timeout)
+{
+    // up to buffers.length messages, valid until b0MessageRelease(message[0])
+    b0_message* msg;
+    jint count=readBatchDirect(env,(b0_subscriber*)sub,buffers,env->GetArrayLength(buffers),&msg,timeout);
+    jlong handle=(jlong)msg;
+    env->SetLongArrayRegion(message,0,1,&handle);
+    return(count);
+}
+
+JNIEXPORT jint JNICALL Java_coppelia_b0RemoteApi_b0SubscriberDispatchBatch(JNIEnv *env, jobject obj, jlong sub, jobject callback, jint maxCount, jlong timeout)
+{
+    // one call to callback.onMessages(ByteBuffer[]) for up to maxCount messages (if any),
+    // whose buffers are valid only until it returns; return the number of messages, or -1
+    jclass bufferClass=env->FindClass("java/nio/ByteBuffer");
+    jmethodID onMessages=env->GetMethodID(env->GetObjectClass(callback),"onMessages","([Ljava/nio/ByteBuffer;)V");
+    if(!bufferClass || !onMessages) return(-1);
+    jobjectArray buffers=env->NewObjectArray(maxCount,bufferClass,0);
+    b0_message* msg;
+    jint count=readBatchDirect(env,(b0_subscriber*)sub,buffers,maxCount,&msg,timeout);
+    if(count>0)
+    {
+        jobjectArray batch=buffers;
+        if(count<maxCount)
+        {
+            batch=env->NewObjectArray(count,bufferClass,0);
+            for(jint i=0;i<count;i++)
+            {
+                jobject buffer=env->GetObjectArrayElement(buffers,i);
+                env->SetObjectArrayElement(batch,i,buffer);
+                env->DeleteLocalRef(buffer);
+            }
+        }
+        env->CallVoidMethod(callback,onMessages,batch);
+    }
+    if(msg) b0_message_release(msg);
+    return(count);
+}
+
+JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0MessageRelease(JNIEnv *env, jobject obj, jlong message)
+{
+    b0_message_release((b0_message*)message);
+}
+
 JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0SubscriberSetOption(JNIEnv *env, jobject obj, jlong sub, jlong option, jlong value)
 {
     b0_subscriber_set_option((b0_subscriber*)sub, option, value);
@@ -12,6 +12,8 @@ JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0PublisherDelete(JNIEnv *env,
 jlong pub);
 JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0PublisherInit(JNIEnv *env, jobject obj, jlong pub);
 JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0PublisherPublish(JNIEnv *env, jobject obj, jlong pub, jbyteArray data);
+JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0PublisherPublishDirect(JNIEnv *env, jobject obj, jlong pub, jobject buffer, jint offset, jint length);
+JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0PublisherPublishBatchDirect(JNIEnv *env, jobject obj, jlong pub, jobjectArray buffers, jintArray lengths);
 JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0PublisherSetOption(JNIEnv *env, jobject obj, jlong pub, jlong option, jlong value);
 
 JNIEXPORT jlong JNICALL Java_coppelia_b0RemoteApi_b0SubscriberNewEx(JNIEnv *env, jobject obj, jlong node, jstring topicName, jint managed, jint notifyGraph);
@@ -19,6 +21,11 @@ JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0SubscriberDelete(JNIEnv *env,
 JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0SubscriberInit(JNIEnv *env, jobject obj, jlong sub);
 JNIEXPORT jint JNICALL Java_coppelia_b0RemoteApi_b0SubscriberPoll(JNIEnv *env, jobject obj, jlong sub, jlong timeout);
 JNIEXPORT jbyteArray JNICALL Java_coppelia_b0RemoteApi_b0SubscriberRead(JNIEnv *env, jobject obj, jlong sub);
+JNIEXPORT jobject JNICALL Java_coppelia_b0RemoteApi_b0SubscriberReadDirect(JNIEnv *env, jobject obj, jlong sub, jlongArray message);
+JNIEXPORT jint JNICALL Java_coppelia_b0RemoteApi_b0SubscriberReadInto(JNIEnv *env, jobject obj, jlong sub, jobject buffer);
+JNIEXPORT jint JNICALL Java_coppelia_b0RemoteApi_b0SubscriberReadBatchDirect(JNIEnv *env, jobject obj, jlong sub, jobjectArray buffers, jlongArray message, jlong timeout);
+JNIEXPORT jint JNICALL Java_coppelia_b0RemoteApi_b0SubscriberDispatchBatch(JNIEnv *env, jobject obj, jlong sub, jobject callback, jint maxCount, jlong timeout);
+JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0MessageRelease(JNIEnv *env, jobject obj, jlong message);
 JNIEXPORT void JNICALL Java_coppelia_b0RemoteApi_b0SubscriberSetOption(JNIEnv *env, jobject obj, jlong sub, jlong option, jlong value);
 
 JNIEXPORT jlong JNICALL Java_coppelia_b0RemoteApi_b0ServiceClientNewEx(JNIEnv *env, jobject obj, jlong node, jstring serviceName, jint managed, jint notifyGraph);
@@ -4,6 +4,12 @@ extern "C" {
 #include "lauxlib.h"
 }
 
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <b0/bindings/c.h>
+
 #define B0_INIT_COMMAND "b0.init"
 int B0_INIT_CALLBACK(lua_State* L)
 {
@@ -303,6 +309,173 @@ int B0_SUBSCRIBER_READ_CALLBACK(lua_State* L)
 	return(retValCnt);
 }
 
+/*
+ * Message views: a userdata referencing a received message (lent by the library, see
+ * b0_subscriber_read_lend()), so that no Lua string is created unless asked for.
+ * The fields are read on access: view:size() (or #view), view:byte(i), view:sub(i, j),
+ * view:uint8/int32/uint32/float/double(i) (native byte order, 1-based offsets), and
+ * view:data() for the whole payload as a string.
+ *
+ * Passing a view to b0.subscriber_read_view() reads the next message into it, so that a loop
+ * on a high-rate topic allocates no new object per message.
+ */
+#define B0_MESSAGE_VIEW_METATABLE "b0.message_view"
+
+struct MessageView
+{
+	b0_message* msg;
+	const char* data;
+	size_t size;
+};
+
+static void messageViewRelease(MessageView* view)
+{
+	if (view->msg != NULL)
+		b0_message_release(view->msg);
+	view->msg = NULL;
+	view->data = NULL;
+	view->size = 0;
+}
+
+static MessageView* checkMessageView(lua_State* L, int index)
+{
+	return (MessageView*)luaL_checkudata(L, index, B0_MESSAGE_VIEW_METATABLE);
+}
+
+// return the address of n bytes at the 1-based offset of argument 2, or raise an error
+static const char* messageViewAt(lua_State* L, MessageView* view, size_t n)
+{
+	lua_Integer offset = luaL_checkinteger(L, 2);
+	if (offset < 1 || (size_t)offset - 1 + n > view->size)
+		luaL_error(L, "offset %d out of range", (int)offset);
+	return view->data + offset - 1;
+}
+
+template<typename T>
+static int messageViewNumber(lua_State* L)
+{
+	MessageView* view = checkMessageView(L, 1);
+	T value;
+	std::memcpy(&value, messageViewAt(L, view, sizeof(T)), sizeof(T));
+	lua_pushnumber(L, (lua_Number)value);
+	return(1);
+}
+
+static int messageViewSize(lua_State* L)
+{
+	lua_pushinteger(L, (lua_Integer)checkMessageView(L, 1)->size);
+	return(1);
+}
+
+static int messageViewByte(lua_State* L)
+{
+	MessageView* view = checkMessageView(L, 1);
+	lua_pushinteger(L, (unsigned char)*messageViewAt(L, view, 1));
+	return(1);
+}
+
+static int messageViewSub(lua_State* L)
+{
+	// same semantics as string.sub()
+	MessageView* view = checkMessageView(L, 1);
+	lua_Integer len = (lua_Integer)view->size;
+	lua_Integer i = luaL_optinteger(L, 2, 1);
+	lua_Integer j = luaL_optinteger(L, 3, -1);
+	if (i < 0) i += len + 1;
+	if (j < 0) j += len + 1;
+	if (i < 1) i = 1;
+	if (j > len) j = len;
+	if (i > j)
+		lua_pushliteral(L, "");
+	else
+		lua_pushlstring(L, view->data + i - 1, (size_t)(j - i + 1));
+	return(1);
+}
+
+static int messageViewData(lua_State* L)
+{
+	MessageView* view = checkMessageView(L, 1);
+	lua_pushlstring(L, view->data != NULL ? view->data : "", view->size);
+	return(1);
+}
+
+static int messageViewGC(lua_State* L)
+{
+	messageViewRelease(checkMessageView(L, 1));
+	return(0);
+}
+
+static void registerMessageView(lua_State* L)
+{
+	static const luaL_Reg methods[] = {
+		{"size", messageViewSize},
+		{"byte", messageViewByte},
+		{"sub", messageViewSub},
+		{"data", messageViewData},
+		{"uint8", messageViewNumber<unsigned char>},
+		{"int32", messageViewNumber<int32_t>},
+		{"uint32", messageViewNumber<uint32_t>},
+		{"float", messageViewNumber<float>},
+		{"double", messageViewNumber<double>},
+		{"release", messageViewGC},
+		{NULL, NULL}
+	};
+	luaL_newmetatable(L, B0_MESSAGE_VIEW_METATABLE);
+	lua_newtable(L);
+	for (const luaL_Reg* m = methods; m->name != NULL; m++)
+	{
+		lua_pushcfunction(L, m->func);
+		lua_setfield(L, -2, m->name);
+	}
+	lua_setfield(L, -2, "__index");
+	lua_pushcfunction(L, messageViewSize);
+	lua_setfield(L, -2, "__len");
+	lua_pushcfunction(L, messageViewGC);
+	lua_setfield(L, -2, "__gc");
+	lua_pop(L, 1);
+}
+
+#define B0_SUBSCRIBER_READ_VIEW_COMMAND "b0.subscriber_read_view"
+int B0_SUBSCRIBER_READ_VIEW_CALLBACK(lua_State* L)
+{
+	// b0.subscriber_read_view(sub [, view]): return the view of the next message, reusing view if given
+	int argCnt = lua_gettop(L);
+	int retValCnt = 0;
+	if ((argCnt >= 1) && lua_islightuserdata(L, 1))
+	{
+		b0_subscriber* ptr = (b0_subscriber*)lua_touserdata(L, 1);
+		MessageView* view;
+		if ((argCnt >= 2) && !lua_isnil(L, 2))
+		{
+			view = checkMessageView(L, 2);
+			messageViewRelease(view);
+			lua_pushvalue(L, 2);
+		}
+		else
+		{
+			view = (MessageView*)lua_newuserdata(L, sizeof(MessageView));
+			view->msg = NULL;
+			view->data = NULL;
+			view->size = 0;
+			luaL_getmetatable(L, B0_MESSAGE_VIEW_METATABLE);
+			lua_setmetatable(L, -2);
+		}
+		const void* data;
+		view->msg = b0_subscriber_read_lend(ptr, &data, &view->size);
+		if (view->msg != NULL)
+		{
+			view->data = (const char*)data;
+			retValCnt = 1;
+		}
+		else
+		{
+			view->size = 0;
+			lua_pop(L, 1);
+		}
+	}
+	return(retValCnt);
+}
+
 void lua_registerN(lua_State* L, char const* funcName, lua_CFunction functionCallback)
 {
 	std::string name(funcName);
@@ -358,6 +531,9 @@ int luaopen_b0(lua_State *L)
 	lua_registerN(L, B0_SUBSCRIBER_INIT_COMMAND, B0_SUBSCRIBER_INIT_CALLBACK);
 	lua_registerN(L, B0_SUBSCRIBER_POLL_COMMAND, B0_SUBSCRIBER_POLL_CALLBACK);
 	lua_registerN(L, B0_SUBSCRIBER_READ_COMMAND, B0_SUBSCRIBER_READ_CALLBACK);
+	lua_registerN(L, B0_SUBSCRIBER_READ_VIEW_COMMAND, B0_SUBSCRIBER_READ_VIEW_CALLBACK);
+
+	registerMessageView(L);
 
 	return 1;
 }
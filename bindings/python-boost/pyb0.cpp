@@ -8,76 +8,218 @@
 
 using namespace boost::python;
 
+/*
+ * The GIL is released during the calls which can block (spinning, service calls, resolving
+ * names...), so that the other Python threads can run meanwhile, and taken again only to
+ * run the Python callbacks.
+ */
+
+//! Release the GIL for the current scope
+class GILRelease
+{
+public:
+    GILRelease() : state_(PyEval_SaveThread()) {}
+    ~GILRelease() {PyEval_RestoreThread(state_);}
+    GILRelease(const GILRelease &) = delete;
+    GILRelease & operator=(const GILRelease &) = delete;
+
+private:
+    PyThreadState *state_;
+};
+
+//! Take the GIL for the current scope (in a callback called by the library)
+class GILAcquire
+{
+public:
+    GILAcquire() : state_(PyGILState_Ensure()) {}
+    ~GILAcquire() {PyGILState_Release(state_);}
+    GILAcquire(const GILAcquire &) = delete;
+    GILAcquire & operator=(const GILAcquire &) = delete;
+
+private:
+    PyGILState_STATE state_;
+};
+
+//! Call a method without holding the GIL
+template<class T, void (T::*Method)()>
+void withoutGIL(T *obj)
+{
+    GILRelease nogil;
+    (obj->*Method)();
+}
+
 void Node_spin(b0::Node *node)
 {
+    GILRelease nogil;
     node->spin();
 }
 
+list Node_get_event_fds(b0::Node *node)
+{
+    list fds;
+    for(int64_t fd : node->getEventFileDescriptors())
+        fds.append(fd);
+    return fds;
+}
+
+//! Release a memoryview, so that it cannot be used after its memory is gone
+void releaseView(object &view)
+{
+#if PY_MAJOR_VERSION >= 3
+    if(!PyObject_HasAttrString(view.ptr(), "release")) return;
+    try
+    {
+        view.attr("release")();
+    }
+    catch(error_already_set &)
+    {
+        // still exported (e.g. to a numpy array kept by the callback): nothing more can be done
+        PyErr_Clear();
+    }
+#endif
+}
+
+/*
+ * Return the contents of a buffer-protocol object (bytes, bytearray, memoryview, numpy
+ * arrays...) or of a string, read directly from its memory
+ */
+std::string bufferToString(const object &data)
+{
+#if PY_MAJOR_VERSION >= 3
+    if(PyObject_CheckBuffer(data.ptr()))
+    {
+        Py_buffer view;
+        if(PyObject_GetBuffer(data.ptr(), &view, PyBUF_CONTIG_RO) != 0)
+            throw_error_already_set();
+        std::string s(static_cast<const char *>(view.buf), view.len);
+        PyBuffer_Release(&view);
+        return s;
+    }
+#endif
+    return extract<std::string>(data)();
+}
+
+void Publisher_publish(b0::Publisher *pub, const object &data)
+{
+    // the payload buffer is moved into the envelope: this is the only copy
+    std::string payload = bufferToString(data);
+    GILRelease nogil;
+    pub->publish(std::move(payload));
+}
+
 b0::Subscriber * Subscriber_new(b0::Node *node, std::string topic_name, object const &callback)
 {
     return new b0::Subscriber(node, topic_name,
-            [=](const std::string &payload)
+            static_cast<b0::Subscriber::CallbackRaw>([=](const std::string &payload)
             {
+                GILAcquire gil;
                 callback(payload);
-            }
+            })
+        );
+}
+
+/*
+ * With zero_copy, the callback receives a read-only memoryview of the received payload
+ * (e.g. for numpy.frombuffer()), which is released when the callback returns: it must be
+ * copied (e.g. with bytes()) to be kept.
+ */
+b0::Subscriber * Subscriber_new_zero_copy(b0::Node *node, std::string topic_name, object const &callback, bool zero_copy)
+{
+    if(!zero_copy)
+        return Subscriber_new(node, topic_name, callback);
+    return new b0::Subscriber(node, topic_name,
+            static_cast<b0::Subscriber::CallbackPartsView>([=](const std::vector<b0::message::MessagePartView> &parts)
+            {
+                GILAcquire gil;
+                const b0::message::MessagePartView &part = parts.at(0);
+#if PY_MAJOR_VERSION >= 3
+                object view(handle<>(PyMemoryView_FromMemory(const_cast<char *>(part.data), part.size, PyBUF_READ)));
+#else
+                object view(handle<>(PyBuffer_FromMemory(const_cast<char *>(part.data), part.size)));
+#endif
+                try
+                {
+                    callback(view);
+                }
+                catch(...)
+                {
+                    releaseView(view);
+                    throw;
+                }
+                releaseView(view);
+            })
         );
 }
 
 std::string ServiceClient_call(b0::ServiceClient *cli, const std::string &req)
 {
     std::string rep;
-    cli->call(req, rep);
+    {
+        GILRelease nogil;
+        cli->call(req, rep);
+    }
     return rep;
 }
 
 b0::ServiceServer * ServiceServer_new(b0::Node *node, std::string service_name, object const &callback)
 {
     return new b0::ServiceServer(node, service_name,
-            [=](const std::string &req, std::string &rep)
+            static_cast<b0::ServiceServer::CallbackRaw>([=](const std::string &req, std::string &rep)
             {
+                GILAcquire gil;
                 object rep_obj = callback(req);
                 rep = extract<std::string>(str(rep_obj))();
-            }
+            })
         );
 }
 
 BOOST_PYTHON_MODULE(pyb0)
 {
+#if PY_MAJOR_VERSION < 3 || PY_MINOR_VERSION < 7
+    // needed for PyGILState_Ensure() in the threads of the library (implicit since 3.7)
+    PyEval_InitThreads();
+#endif
+
     class_<b0::Node, boost::noncopyable>
         ("Node", init<std::string>())
-        .def("init", &b0::Node::init)
-        .def("cleanup", &b0::Node::cleanup)
-        .def("spin_once", &b0::Node::spinOnce)
+        .def("init", &withoutGIL<b0::Node, &b0::Node::init>)
+        .def("cleanup", &withoutGIL<b0::Node, &b0::Node::cleanup>)
+        .def("spin_once", &withoutGIL<b0::Node, &b0::Node::spinOnce>)
         .def("spin", &Node_spin)
+        .def("get_event_fds", &Node_get_event_fds)
+        .def("has_pending_events", &b0::Node::hasPendingEvents)
+        .def("next_timer_usec", &b0::Node::nextTimerUSec)
+        .def("wake_up", &b0::Node::wakeUp)
         .def("time_usec", &b0::Node::timeUSec)
         .def("hardware_time_usec", &b0::Node::hardwareTimeUSec)
     ;
     class_<b0::Publisher, boost::noncopyable>
         ("Publisher", init<b0::Node*, std::string>())
-        .def("init", &b0::Publisher::init)
-        .def("cleanup", &b0::Publisher::cleanup)
+        .def("init", &withoutGIL<b0::Publisher, &b0::Publisher::init>)
+        .def("cleanup", &withoutGIL<b0::Publisher, &b0::Publisher::cleanup>)
         .def("get_topic_name", &b0::Publisher::getTopicName)
-        .def("publish", &b0::Publisher::publish)
+        .def("publish", &Publisher_publish)
     ;
     class_<b0::Subscriber, boost::noncopyable>
         ("Subscriber", no_init)
         .def("__init__", make_constructor(&Subscriber_new))
-        .def("init", &b0::Subscriber::init)
-        .def("cleanup", &b0::Subscriber::cleanup)
+        .def("__init__", make_constructor(&Subscriber_new_zero_copy))
+        .def("init", &withoutGIL<b0::Subscriber, &b0::Subscriber::init>)
+        .def("cleanup", &withoutGIL<b0::Subscriber, &b0::Subscriber::cleanup>)
         .def("get_topic_name", &b0::Subscriber::getTopicName)
     ;
     class_<b0::ServiceClient, boost::noncopyable>
         ("ServiceClient", init<b0::Node*, std::string>())
-        .def("init", &b0::ServiceClient::init)
-        .def("cleanup", &b0::ServiceClient::cleanup)
+        .def("init", &withoutGIL<b0::ServiceClient, &b0::ServiceClient::init>)
+        .def("cleanup", &withoutGIL<b0::ServiceClient, &b0::ServiceClient::cleanup>)
         .def("get_service_name", &b0::ServiceClient::getServiceName)
         .def("call", &ServiceClient_call)
     ;
     class_<b0::ServiceServer, boost::noncopyable>
         ("ServiceServer", no_init)
         .def("__init__", make_constructor(&ServiceServer_new))
-        .def("init", &b0::ServiceServer::init)
-        .def("cleanup", &b0::ServiceServer::cleanup)
+        .def("init", &withoutGIL<b0::ServiceServer, &b0::ServiceServer::init>)
+        .def("cleanup", &withoutGIL<b0::ServiceServer, &b0::ServiceServer::cleanup>)
         .def("get_service_name", &b0::ServiceServer::getServiceName)
     ;
 }
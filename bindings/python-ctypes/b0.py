@@ -3,6 +3,7 @@ import struct
 import sys
 import os
 import ctypes as ct
+import weakref
 
 libb0 = None
 prefix, suffix = 'lib', '.so'
@@ -20,6 +21,9 @@ for path in ('.', 'build', '../../build'):
 if libb0 is None:
     raise RuntimeError('%sb0%s not found' % (prefix, suffix))
 
+class _MessageRef(ct.Structure):
+    _fields_ = [('data', ct.c_void_p), ('size', ct.c_size_t), ('type', ct.c_char_p)]
+
 def _(n, ret, *args):
     # perform encoding/decoding for char* argument (use str to enable conversion)
     def _enc(v, t): return v.encode('ascii') if t == str else v
@@ -33,6 +37,7 @@ def _(n, ret, *args):
 _("b0_init", ct.c_void_p, ct.POINTER(ct.c_int), ct.POINTER(ct.c_char_p))
 _("b0_buffer_new", ct.c_void_p, ct.c_size_t)
 _("b0_buffer_delete", None, ct.c_void_p)
+_("b0_message_release", None, ct.c_void_p)
 _("b0_node_new", ct.c_void_p, str)
 _("b0_node_delete", None, ct.c_void_p)
 _("b0_node_init", None, ct.c_void_p)
@@ -48,6 +53,10 @@ _("b0_node_hardware_time_usec", ct.c_longlong, ct.c_void_p)
 _("b0_node_time_usec", ct.c_longlong, ct.c_void_p)
 _("b0_node_sleep_usec", None, ct.c_void_p, ct.c_longlong)
 _("b0_node_log", None, ct.c_void_p, ct.c_int, str)
+_("b0_node_get_event_fds", ct.c_int, ct.c_void_p, ct.POINTER(ct.c_int64), ct.c_size_t, ct.POINTER(ct.c_size_t))
+_("b0_node_has_pending_events", ct.c_int, ct.c_void_p)
+_("b0_node_next_timer_usec", ct.c_longlong, ct.c_void_p)
+_("b0_node_wake_up", None, ct.c_void_p)
 _("b0_publisher_new_ex", ct.c_void_p, ct.c_void_p, str, ct.c_int, ct.c_int)
 _("b0_publisher_new", ct.c_void_p, ct.c_void_p, str)
 _("b0_publisher_delete", None, ct.c_void_p)
@@ -56,6 +65,7 @@ _("b0_publisher_cleanup", None, ct.c_void_p)
 _("b0_publisher_spin_once", None, ct.c_void_p)
 _("b0_publisher_get_topic_name", str, ct.c_void_p)
 _("b0_publisher_publish", None, ct.c_void_p, ct.c_void_p, ct.c_size_t)
+_("b0_publisher_publish_batch", ct.c_int, ct.c_void_p, ct.POINTER(_MessageRef), ct.c_size_t)
 _("b0_publisher_log", None, ct.c_void_p, ct.c_int, str)
 _("b0_publisher_set_option", ct.c_void_p, ct.c_int, ct.c_int)
 _("b0_subscriber_new_ex", ct.c_void_p, ct.c_void_p, str, ct.c_void_p, ct.c_int, ct.c_int)
@@ -68,6 +78,8 @@ _("b0_subscriber_get_topic_name", str, ct.c_void_p)
 _("b0_subscriber_log", None, ct.c_void_p, ct.c_int, str)
 _("b0_subscriber_poll", ct.c_int, ct.c_void_p, ct.c_long)
 _("b0_subscriber_read", ct.c_void_p, ct.c_void_p, ct.POINTER(ct.c_size_t))
+_("b0_subscriber_read_lend", ct.c_void_p, ct.c_void_p, ct.POINTER(ct.c_void_p), ct.POINTER(ct.c_size_t))
+_("b0_subscriber_read_batch", ct.c_void_p, ct.c_void_p, ct.POINTER(_MessageRef), ct.c_size_t, ct.POINTER(ct.c_size_t), ct.c_long)
 _("b0_subscriber_set_option", ct.c_void_p, ct.c_int, ct.c_int)
 _("b0_service_client_new_ex", ct.c_void_p, ct.c_void_p, str, ct.c_int, ct.c_int)
 _("b0_service_client_new", ct.c_void_p, ct.c_void_p, str)
@@ -89,6 +101,50 @@ _("b0_service_server_get_service_name", str, ct.c_void_p)
 _("b0_service_server_log", None, ct.c_void_p, ct.c_int, str)
 _("b0_service_server_set_option", ct.c_void_p, ct.c_int, ct.c_int)
 
+def _buffer_arg(data):
+    # pointer to the memory of a buffer-protocol object (bytes, bytearray, memoryview,
+    # numpy arrays...), without copying it; the returned object must be kept alive
+    if isinstance(data, bytes):
+        return ct.c_char_p(data), len(data)
+    if isinstance(data, str):
+        data = data.encode('utf-8')
+        return ct.c_char_p(data), len(data)
+    mv = memoryview(data)
+    if not mv.contiguous:
+        mv = memoryview(mv.tobytes())
+    mv = mv.cast('B')
+    if mv.readonly:
+        # ctypes cannot point into read-only memory
+        b = mv.tobytes()
+        return ct.c_char_p(b), len(b)
+    return (ct.c_char * mv.nbytes).from_buffer(mv), mv.nbytes
+
+def _view(data, size):
+    # memoryview of memory owned by libb0 (valid only during a callback)
+    if size == 0:
+        return memoryview(b'')
+    return memoryview((ct.c_ubyte * size).from_address(data)).cast('B')
+
+def _release(view):
+    try:
+        view.release()
+    except (BufferError, AttributeError):
+        # still exported (e.g. to a numpy array kept by the callback)
+        pass
+
+def _owned_buffer(buf, size, zero_copy):
+    # payload in a b0_buffer: wrapped in a memoryview which frees it when collected
+    # (zero_copy), or copied into a bytearray
+    if not buf:
+        return memoryview(b'') if zero_copy else bytearray()
+    arr = (ct.c_ubyte * size).from_address(buf)
+    if not zero_copy:
+        ret = bytearray(arr)
+        b0_buffer_delete(buf)
+        return ret
+    weakref.finalize(arr, b0_buffer_delete, buf)
+    return memoryview(arr).cast('B')
+
 def init():
     argc = 1
     argv = ['b0python']
@@ -119,6 +175,23 @@ class Node:
     def cleanup(self):
         b0_node_cleanup(self._node)
 
+    def get_event_fds(self):
+        # edge-triggered: when one is readable, spin_once() while has_pending_events()
+        count = ct.c_size_t()
+        b0_node_get_event_fds(self._node, None, 0, ct.byref(count))
+        fds = (ct.c_int64 * count.value)()
+        b0_node_get_event_fds(self._node, fds, count.value, ct.byref(count))
+        return list(fds[:count.value])
+
+    def has_pending_events(self):
+        return bool(b0_node_has_pending_events(self._node))
+
+    def next_timer_usec(self):
+        return b0_node_next_timer_usec(self._node)
+
+    def wake_up(self):
+        b0_node_wake_up(self._node)
+
     def get_name(self):
         return b0_node_get_name(self._node)
 
@@ -160,8 +233,18 @@ class Publisher:
         return b0_publisher_get_topic_name(self._pub)
 
     def publish(self, data):
-        buf = ct.c_char_p(data)
-        b0_publisher_publish(self._pub, buf, len(data))
+        # data can be any buffer-protocol object; its memory is passed without copying
+        buf, size = _buffer_arg(data)
+        b0_publisher_publish(self._pub, buf, size)
+
+    def publish_batch(self, messages):
+        # send several payloads (buffer-protocol objects) in one call, as a single batch envelope
+        keep = [_buffer_arg(m) for m in messages]
+        refs = (_MessageRef * len(keep))()
+        for ref, (buf, size) in zip(refs, keep):
+            ref.data = ct.cast(buf, ct.c_void_p)
+            ref.size = size
+        b0_publisher_publish_batch(self._pub, refs, len(keep))
 
     def log(self, level, message):
         b0_publisher_log(self._pub, level, message)
@@ -170,10 +253,18 @@ class Publisher:
         b0_publisher_set_option(self._pub, option, value)
 
 class Subscriber:
-    def __init__(self, node, topic_name, callback, managed=1, notify_graph=1):
+    def __init__(self, node, topic_name, callback, managed=1, notify_graph=1, zero_copy=False):
+        # with zero_copy, callback receives a memoryview of the payload (e.g. for
+        # numpy.frombuffer), valid only until it returns: copy it (e.g. bytes()) to keep it
         def w(data, size):
-            data_bytes = bytearray(ct.cast(data, ct.POINTER(ct.c_ubyte * size)).contents)
-            return callback(data_bytes)
+            if not zero_copy:
+                data_bytes = bytearray(ct.cast(data, ct.POINTER(ct.c_ubyte * size)).contents)
+                return callback(data_bytes)
+            view = _view(data, size)
+            try:
+                callback(view)
+            finally:
+                _release(view)
         self._cb = ct.CFUNCTYPE(None, ct.c_void_p, ct.c_size_t)(w)
         self._sub = b0_subscriber_new_ex(node._node, topic_name, self._cb, managed, notify_graph)
 
@@ -198,12 +289,35 @@ class Subscriber:
     def poll(self, timeout):
         return b0_subscriber_poll(self._sub, timeout)
         
-    def read(self):
+    def read(self, zero_copy=False):
+        # with zero_copy, return a memoryview of the received message itself (released
+        # when collected)
         outsz = ct.c_size_t()
+        if zero_copy:
+            data = ct.c_void_p()
+            msg = b0_subscriber_read_lend(self._sub, ct.byref(data), ct.byref(outsz))
+            if not msg:
+                return memoryview(b'')
+            if not outsz.value:
+                b0_message_release(msg)
+                return memoryview(b'')
+            arr = (ct.c_ubyte * outsz.value).from_address(data.value)
+            weakref.finalize(arr, b0_message_release, msg)
+            return memoryview(arr).cast('B')
         outbuf = b0_subscriber_read(self._sub, ct.byref(outsz))
-        outarr = ct.cast(outbuf, ct.POINTER(ct.c_ubyte * outsz.value))
-        rep_bytes = bytearray(outarr.contents)
-        return rep_bytes
+        return _owned_buffer(outbuf, outsz.value, False)
+
+    def read_batch(self, max_count=64, timeout=0):
+        # read up to max_count messages in one call, waiting at most timeout ms for the first
+        refs = (_MessageRef * max_count)()
+        count = ct.c_size_t()
+        msg = b0_subscriber_read_batch(self._sub, refs, max_count, ct.byref(count), timeout)
+        if not msg:
+            return []
+        try:
+            return [ct.string_at(refs[i].data, refs[i].size) if refs[i].size else b'' for i in range(count.value)]
+        finally:
+            b0_message_release(msg)
 
     def set_option(self, option, value):
         b0_subscriber_set_option(self._sub, option, value)
@@ -227,14 +341,13 @@ class ServiceClient:
     def get_service_name(self):
         return b0_service_client_get_service_name(self._cli)
 
-    def call(self, data):
-        buf = ct.c_char_p(data)
-        sz = len(data)
+    def call(self, data, zero_copy=False):
+        # data can be any buffer-protocol object; with zero_copy, return a memoryview of
+        # the reply (freed when collected)
+        buf, sz = _buffer_arg(data)
         outsz = ct.c_size_t()
         outbuf = b0_service_client_call(self._cli, buf, sz, ct.byref(outsz))
-        outarr = ct.cast(outbuf, ct.POINTER(ct.c_ubyte * outsz.value))
-        rep_bytes = bytearray(outarr.contents)
-        return rep_bytes
+        return _owned_buffer(outbuf, outsz.value, zero_copy)
 
     def log(self, level, message):
         b0_service_client_log(self._cli, level, message)
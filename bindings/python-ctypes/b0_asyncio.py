@@ -0,0 +1,97 @@
+# -*- coding: utf-8 -*-
+"""
+Run b0 nodes in an asyncio event loop, without polling.
+
+The file descriptors of the node's sockets (see Node.get_event_fds()) are registered with
+the event loop, so that the callbacks run only when messages arrive, and the timers of the
+node are scheduled with loop.call_later(). A slow housekeeping tick still calls spin_once(),
+for the work which is not triggered by a socket (e.g. flushing the batched log entries).
+
+It works with the nodes of both the python-ctypes (b0.py) and the python-boost (pyb0)
+bindings. On Windows, add_reader() requires a selector event loop.
+
+Example:
+
+    node = b0.Node('python-subscriber')
+    sub = b0.Subscriber(node, 'A', callback)
+    node.init()
+    asyncio.run(b0_asyncio.spin(node))
+    node.cleanup()
+"""
+import asyncio
+
+class NodeAdapter:
+    def __init__(self, node, loop=None, max_batch=100, tick=1.0):
+        # max_batch: spin_once() calls in a row, before yielding to the other tasks
+        self._node = node
+        self._loop = loop or asyncio.get_event_loop()
+        self._max_batch = max_batch
+        self._tick = tick
+        self._fds = []
+        self._timer_handle = None
+        self._tick_handle = None
+
+    def start(self):
+        # call after node.init(), and after start() again if sockets are added (see refresh())
+        self.refresh()
+        if self._tick:
+            self._tick_handle = self._loop.call_later(self._tick, self._on_tick)
+        # messages which arrived before the registration did not trigger the fds:
+        self._loop.call_soon(self._process)
+
+    def refresh(self):
+        for fd in self._fds:
+            self._loop.remove_reader(fd)
+        self._fds = self._node.get_event_fds()
+        for fd in self._fds:
+            self._loop.add_reader(fd, self._process)
+
+    def stop(self):
+        for fd in self._fds:
+            self._loop.remove_reader(fd)
+        self._fds = []
+        for h in (self._timer_handle, self._tick_handle):
+            if h is not None:
+                h.cancel()
+        self._timer_handle = self._tick_handle = None
+
+    def _process(self):
+        # the fds are edge-triggered: spin until no socket has incoming messages
+        n = 0
+        while self._node.has_pending_events():
+            self._node.spin_once()
+            n += 1
+            if n >= self._max_batch:
+                self._loop.call_soon(self._process)
+                break
+        self._schedule_timer()
+
+    def _schedule_timer(self):
+        if self._timer_handle is not None:
+            self._timer_handle.cancel()
+            self._timer_handle = None
+        t = self._node.next_timer_usec()
+        if t >= 0:
+            self._timer_handle = self._loop.call_later(t / 1e6, self._on_timer)
+
+    def _on_timer(self):
+        self._timer_handle = None
+        # spin_once() runs the timers which are due:
+        self._node.spin_once()
+        self._process()
+
+    def _on_tick(self):
+        self._node.spin_once()
+        self._process()
+        self._tick_handle = self._loop.call_later(self._tick, self._on_tick)
+
+async def spin(node, max_batch=100, tick=1.0):
+    """Process the node's messages and timers until its shutdown is requested (or cancelled)"""
+    adapter = NodeAdapter(node, asyncio.get_event_loop(), max_batch, tick)
+    adapter.start()
+    shutdown_requested = getattr(node, 'shutdown_requested', lambda: False)
+    try:
+        while not shutdown_requested():
+            await asyncio.sleep(0.1)
+    finally:
+        adapter.stop()
@@ -0,0 +1,14 @@
+# -*- coding: utf-8 -*-
+import asyncio
+import b0
+import b0_asyncio
+
+def callback(msg):
+    msg_str = msg.decode('utf-8')
+    print('Received message "%s"' % msg_str)
+node = b0.Node('python-asyncio-subscriber')
+sub = b0.Subscriber(node, 'A', callback)
+node.init()
+print('Subscribed to topic "%s"...' % sub.get_topic_name())
+asyncio.get_event_loop().run_until_complete(b0_asyncio.spin(node))
+node.cleanup()
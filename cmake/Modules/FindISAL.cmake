@@ -0,0 +1,21 @@
+# Finds the Intel(R) Intelligent Storage Acceleration Library (igzip).
+#
+# This module defines:
+# ISAL_FOUND
+# ISAL_INCLUDE_DIR
+# ISAL_LIBRARY
+#
+
+find_path(ISAL_INCLUDE_DIR NAMES isa-l/igzip_lib.h)
+find_library(ISAL_LIBRARY NAMES isal)
+
+include(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(
+    ISAL DEFAULT_MSG
+    ISAL_LIBRARY ISAL_INCLUDE_DIR)
+
+if (ISAL_FOUND)
+  message(STATUS "Found ISA-L: ${ISAL_LIBRARY}")
+endif (ISAL_FOUND)
+
+mark_as_advanced(ISAL_INCLUDE_DIR ISAL_LIBRARY)
@@ -0,0 +1,35 @@
+# Finds libzstd.
+#
+# This module defines:
+# ZSTD_FOUND
+# ZSTD_INCLUDE_DIR
+# ZSTD_LIBRARY
+#
+
+find_path(ZSTD_INCLUDE_DIR NAMES zstd.h zdict.h)
+find_library(ZSTD_LIBRARY NAMES zstd)
+
+# We require ZSTD_getFrameContentSize() which was added in v1.3.0
+if (ZSTD_LIBRARY)
+  include(CheckCSourceRuns)
+  set(CMAKE_REQUIRED_INCLUDES ${ZSTD_INCLUDE_DIR})
+  set(CMAKE_REQUIRED_LIBRARIES ${ZSTD_LIBRARY})
+  check_c_source_runs("
+#include <zstd.h>
+int main() {
+  return !(ZSTD_VERSION_NUMBER >= 10300);
+}" ZSTD_GOOD_VERSION)
+  set(CMAKE_REQUIRED_INCLUDES)
+  set(CMAKE_REQUIRED_LIBRARIES)
+endif()
+
+include(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(
+    ZSTD DEFAULT_MSG
+    ZSTD_LIBRARY ZSTD_INCLUDE_DIR ZSTD_GOOD_VERSION)
+
+if (ZSTD_FOUND)
+  message(STATUS "Found ZSTD: ${ZSTD_LIBRARY}")
+endif (ZSTD_FOUND)
+
+mark_as_advanced(ZSTD_INCLUDE_DIR ZSTD_LIBRARY)
@@ -0,0 +1,122 @@
+#include <b0/node.h>
+#include <b0/subscriber.h>
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+/*! \example event_loop/asio_subscriber_node.cpp
+ * This is an example of a node run by a boost::asio event loop, instead of b0::Node::spin()
+ */
+
+//! \cond HIDDEN_SYMBOLS
+
+void callback(const std::string &msg)
+{
+    std::cout << "Received: " << msg << std::endl;
+}
+
+class AsioNode
+{
+public:
+    AsioNode(boost::asio::io_context &io, b0::Node &node)
+        : io_(io),
+          node_(node),
+          timer_(io)
+    {
+        /*
+         * Watch the file descriptors of the node's sockets (call after node.init())
+         */
+        for(int64_t fd : node_.getEventFileDescriptors())
+        {
+            descriptors_.emplace_back(new boost::asio::posix::stream_descriptor(io_, fd));
+            wait(*descriptors_.back());
+        }
+        /*
+         * Messages which arrived before the descriptors were watched are not signaled
+         */
+        process({});
+        tick();
+    }
+
+    ~AsioNode()
+    {
+        /*
+         * The descriptors belong to ZeroMQ: do not close them
+         */
+        for(auto &d : descriptors_)
+            d->release();
+    }
+
+private:
+    void wait(boost::asio::posix::stream_descriptor &d)
+    {
+        d.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+            [this, &d](const boost::system::error_code &ec)
+            {
+                if(ec) return;
+                process({d.native_handle()});
+                wait(d);
+            });
+    }
+
+    void process(const std::vector<int64_t> &fds)
+    {
+        /*
+         * The descriptors are edge-triggered: if messages are left, process them again
+         * later, after the other handlers of the loop
+         */
+        if(node_.processReadySockets(fds))
+            boost::asio::post(io_, [this, fds]() { process(fds); });
+    }
+
+    void tick()
+    {
+        /*
+         * Run the timers and the housekeeping of the node from time to time
+         */
+        if(node_.shutdownRequested())
+        {
+            io_.stop();
+            return;
+        }
+        node_.spinOnce();
+        // spinOnce() may have left messages, which the descriptors would not signal again:
+        process(node_.getEventFileDescriptors());
+        int64_t usec = node_.nextTimerUSec();
+        if(usec < 0 || usec > 100000) usec = 100000;
+        timer_.expires_after(std::chrono::microseconds(usec));
+        timer_.async_wait([this](const boost::system::error_code &ec) { if(!ec) tick(); });
+    }
+
+    boost::asio::io_context &io_;
+    b0::Node &node_;
+    boost::asio::steady_timer timer_;
+    std::vector<std::unique_ptr<boost::asio::posix::stream_descriptor> > descriptors_;
+};
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    b0::Node node("asio-subscriber");
+    b0::Subscriber sub(&node, "A", &callback);
+    node.init();
+
+    /*
+     * Run the application's event loop, which also processes the node's messages
+     */
+    boost::asio::io_context io;
+    {
+        AsioNode asio_node(io, node);
+        io.run();
+    }
+
+    node.cleanup();
+
+    return 0;
+}
+
+//! \endcond
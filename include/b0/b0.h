@@ -91,6 +91,52 @@
  * Thus, every node's non-thread-safe methods must be accessed always from the same thread which
  * created the node.
  *
+ * \section realtime_threads Real-time threads
+ *
+ * The threads of the nodes can be pinned to CPUs and given a real-time scheduling policy,
+ * per role (see b0::ThreadConfig), e.g. to run the spin loop and the ZeroMQ I/O threads
+ * with SCHED_FIFO on isolated CPUs while the logging stays on the others:
+ *
+ * ~~~
+ * export B0_THREAD_SPIN_CPUS=2 B0_THREAD_SPIN_POLICY=fifo B0_THREAD_SPIN_PRIORITY=80
+ * export B0_THREAD_IO_CPUS=3 B0_THREAD_IO_POLICY=fifo B0_THREAD_IO_PRIORITY=70
+ * export B0_THREAD_LOG_CPUS=0-1
+ * ~~~
+ *
+ * Real-time policies usually need privileges (CAP_SYS_NICE or an rtprio limit).
+ *
+ * On multi-socket machines, the threads of the data path (spin, callback and I/O) and the
+ * buffer pool (see b0::BufferPool) can instead be bound to a NUMA node, e.g. the one local
+ * to the NIC receiving the messages:
+ *
+ * ~~~
+ * export B0_NUMA_INTERFACE=eth2 B0_BUFFER_POOL=1
+ * ~~~
+ *
+ * (or B0_NUMA_NODE=1 for a given node; B0_THREAD_<ROLE>_NUMA_NODE and
+ * B0_THREAD_<ROLE>_NUMA_INTERFACE override them for a role, and B0_BUFFER_POOL_NUMA_NODE
+ * for the buffer pool).
+ *
+ * \section event_loops Integrating nodes in other applications
+ *
+ * A node is usually a member of an application class, created before and initialized
+ * together with it. If the application has no main loop of its own, b0::Node::spin() can
+ * be its main loop, with the application's periodic work in the callback of spin().
+ * Otherwise, the application's loop has to let the node process its messages:
+ *
+ * - calling b0::Node::spinOnce() periodically (e.g. from a timer of the loop) is the simplest
+ *   way, at the cost of the latency and of the idle wake-ups of polling;
+ * - event loops watching file descriptors (Qt's QSocketNotifier, libuv's uv_poll_t,
+ *   boost::asio's stream_descriptor, Python's asyncio) can instead watch the descriptors
+ *   returned by b0::Node::getEventFileDescriptors(), and call b0::Node::processReadySockets()
+ *   with the ones reported readable. The descriptors are edge-triggered (they are the ZMQ_FD
+ *   of the sockets): when processReadySockets() returns true, it has to be called again
+ *   from the loop, since the messages left will not be signaled again. b0::Node::spinOnce()
+ *   still has to be called from time to time, and when the timers are due (see
+ *   b0::Node::nextTimerUSec()).
+ *
+ * See the example \ref event_loop/asio_subscriber_node.cpp, and bindings/python-ctypes/b0_asyncio.py.
+ *
  * \section resolver_intro Resolver
  *
  * The most important part of the network is the resolver node.
@@ -174,6 +220,32 @@
  *
  * When B0_RESOLVER is not specified it defaults to "tcp://localhost:22000".
  *
+ * \subsection standby_resolver Standby resolver
+ *
+ * A second resolver can run as a standby of the first one, by setting B0_RESOLVER_PRIMARY
+ * to the address of the first resolver when launching it (see b0::resolver::Resolver::setPrimary()).
+ * It copies the state of the primary, and takes over when the primary stops responding.
+ * The nodes are given both addresses, and switch to the second one when the first does
+ * not respond:
+ *
+ * ~~~
+ * export B0_RESOLVER="tcp://resolver-a.local:22000,tcp://resolver-b.local:22000"
+ * ~~~
+ *
+ * The topics sent through the proxy of the failed resolver are not moved to the proxy of
+ * the standby; use peer-to-peer topics (B0_PEER_TO_PEER) for them to keep flowing.
+ *
+ * \subsection decentralized Decentralized discovery
+ *
+ * The nodes can also run without a resolver, by setting B0_DECENTRALIZED=1 in every
+ * process (see b0::setDecentralized()). Each process then broadcasts the services and
+ * topics of its nodes in UDP beacons (to B0_DISCOVERY_ADDRESS, port B0_DISCOVERY_PORT,
+ * every B0_DISCOVERY_INTERVAL milliseconds), and the nodes resolve names from the beacons
+ * received from the other processes. Topics are always peer-to-peer in this mode.
+ *
+ * Without a resolver, node names are not made unique, the time is not synchronized, and
+ * compression dictionaries must be registered locally.
+ *
  * \section reaching_nodes Reaching every other node
  *
  * Nodes also need to be able to reach each other node.
@@ -377,6 +449,13 @@
  *
  * \mscfile node-lifetime.msc
  *
+ * If the resolver gives a heartbeat_topic in its b0::message::resolv::AnnounceNodeResponse,
+ * the heartbeats are published (MessagePack-encoded b0::message::resolv::HeartbeatRequest)
+ * on that topic through the proxy, and not replied to. Only one heartbeat every
+ * B0_HEARTBEAT_TIME_SYNC_INTERVAL (default: 10) is sent as a request, to get the time of the
+ * resolver for the time synchronization. This is not done when more than one resolver is
+ * given for failover.
+ *
  * \subsection node_lifetime_topics Topics
  *
  * When a node wants to publish to some topic, it has to use the XPUB address given by resolver
@@ -402,6 +481,14 @@
  *
  * \mscfile service-call.msc
  *
+ * \subsection node_lifetime_parameters Parameters
+ *
+ * The resolver serves parameters (named string values). A node fetches the parameters under
+ * a prefix with the b0::message::resolv::GetParamsRequest message, and changes one with the
+ * b0::message::resolv::SetParamRequest message. Every change is published by the resolver on
+ * the "param" topic (b0::message::resolv::ParamUpdate), with a version number incremented at
+ * each change, so that the nodes keep a local copy up to date (see b0::Node::addParameterPrefix()).
+ *
  * \section node_shutdown Node shutdown
  *
  * When a node is shutdown, it will send a b0::message::resolv::ShutdownNodeRequest message to inform the resolver node about that.
@@ -425,6 +512,13 @@
  *
  * \mscfile graph-get.msc
  *
+ * At each change, the resolver publishes the changes (b0::message::graph::GraphDelta) on the
+ * "graph_delta" topic. The deltas carry consecutive version numbers, which are also in the
+ * graph returned by b0::message::graph::GetGraphResponse, so a client can keep a copy of the
+ * graph up to date, and request the whole graph only if it has missed a delta
+ * (see b0::graph::GraphTracker). The whole graph is also published on the "graph" topic,
+ * unless disabled with b0::resolver::Resolver::setGraphSnapshots().
+ *
  * The program b0_graph_console (and also gui/b0_graph_console_gui) included in BlueZero is
  * an example of displaying such graph, while whatching for changes to it in realtime.
  *
@@ -537,6 +631,10 @@
  * called before b0::init() or after b0::init(), it can provide a different default (recommended),
  * or completely override any env var or command line switch setting.
  *
+ * Similarly, the level of the messages sent to the `log` topic can be controlled by the
+ * `B0_REMOTE_LOGLEVEL` environment variable, or by the b0::setRemoteLogLevel() function.
+ * Messages below both levels are discarded before being formatted.
+ *
  *
  * \page cmdline_args Parsing command line arguments
  *
@@ -569,6 +667,7 @@
  *                                         remap a service name
  *   -L [ --console-loglevel ] arg (=info) specify the console loglevel
  *   -F [ --spin-rate ] arg (=10)          specify the default spin rate
+ *   --io-threads arg (=1)                 specify the number of ZeroMQ I/O threads
  *   -n [ --fancy-name ] arg               a string arg
  *   -x [ --lucky-number ] arg (=23)       an int arg with default
  *   -f [ --file ] arg                     file arg
@@ -586,6 +685,12 @@ namespace b0
 
 class Node;
 
+struct ThreadConfig;
+
+struct SocketProfile;
+
+class BufferAllocator;
+
 class Global final
 {
 private:
@@ -606,6 +711,8 @@ public:
 
     void addServiceRemapings(const std::vector<std::string> &raw_arg);
 
+    void addSocketProfilePatterns(const std::vector<std::string> &raw_arg);
+
     void addRemaping(const std::string &orig_name, const std::string &new_name);
 
     void addNodeRemaping(const std::string &orig_name, const std::string &new_name);
@@ -676,10 +783,130 @@ public:
 
     void setConsoleLogLevel(logger::Level level);
 
+    logger::Level getRemoteLogLevel();
+
+    void setRemoteLogLevel(logger::Level level);
+
     double getSpinRate();
 
     void setSpinRate(double rate);
 
+    int getIOThreads();
+
+    void setIOThreads(int n);
+
+    bool getPriorityIOThread();
+
+    void setPriorityIOThread(bool reserved);
+
+    bool getSharedContext();
+
+    void setSharedContext(bool shared);
+
+    bool getIntraProcess();
+
+    void setIntraProcess(bool enabled);
+
+    bool getPeerToPeer();
+
+    void setPeerToPeer(bool enabled);
+
+    bool getIPC();
+
+    void setIPC(bool enabled);
+
+    std::string getIPCDirectory();
+
+    void setIPCDirectory(const std::string &dir);
+
+    bool getAsyncLogging();
+
+    void setAsyncLogging(bool enabled);
+
+    bool getHierarchicalLogTopics();
+
+    void setHierarchicalLogTopics(bool enabled);
+
+    int getCompressionThreads();
+
+    void setCompressionThreads(int n);
+
+    bool getInPlaceJSONDecoding();
+
+    void setInPlaceJSONDecoding(bool enabled);
+
+    int getLingerPeriod();
+
+    void setLingerPeriod(int period);
+
+    int getSpinBudget();
+
+    void setSpinBudget(int max_messages);
+
+    bool getServiceCache();
+
+    void setServiceCache(bool enabled);
+
+    int getServiceClientPool();
+
+    void setServiceClientPool(int max_idle);
+
+    bool getHeartbeatCoalescing();
+
+    void setHeartbeatCoalescing(bool enabled);
+
+    bool getProcessAgent();
+
+    void setProcessAgent(bool enabled);
+
+    bool getInlineHeartbeats();
+
+    void setInlineHeartbeats(bool enabled);
+
+    bool getEmbeddedProfile();
+
+    void setEmbeddedProfile(bool enabled);
+
+    std::shared_ptr<BufferAllocator> getBufferAllocator();
+
+    void setBufferAllocator(std::shared_ptr<BufferAllocator> allocator);
+
+    bool getMemoryAccounting();
+
+    void setMemoryAccounting(bool enabled);
+
+    bool getHeartbeatStats();
+
+    void setHeartbeatStats(bool enabled);
+
+    bool getConnectionMonitor();
+
+    void setConnectionMonitor(bool enabled);
+
+    bool getConnectionMonitorWarnings();
+
+    void setConnectionMonitorWarnings(bool enabled);
+
+    bool getSimulatedTime();
+
+    void setSimulatedTime(bool enabled);
+
+    bool getDecentralized();
+
+    void setDecentralized(bool enabled);
+
+    ThreadConfig getThreadConfig(const std::string &role);
+
+    void setThreadConfig(const std::string &role, const ThreadConfig &config);
+
+    SocketProfile getSocketProfile(const std::string &name);
+
+    void setSocketProfile(const std::string &name, const SocketProfile &profile);
+
+    void addSocketProfilePattern(const std::string &pattern, const std::string &profile);
+
+    std::vector<std::pair<std::string, std::string> > getSocketProfilePatterns();
+
     bool quitRequested();
 
     void quit();
@@ -900,6 +1127,19 @@ logger::Level getConsoleLogLevel();
  */
 void setConsoleLogLevel(logger::Level level);
 
+/*!
+ * Get the remote logging level, i.e. the minimum level of the messages sent to the `log` topic.
+ * This can be changed also by the B0_REMOTE_LOGLEVEL env var. The default is trace.
+ */
+logger::Level getRemoteLogLevel();
+
+/*!
+ * Set the remote logging level. This can be changed also by the B0_REMOTE_LOGLEVEL env var.
+ *
+ * Messages below both the console and the remote logging levels are discarded before formatting.
+ */
+void setRemoteLogLevel(logger::Level level);
+
 /*!
  * Get the default spin rate (can be changed by the --spin-rate= command line option)
  */
@@ -910,6 +1150,499 @@ double getSpinRate();
  */
 void setSpinRate(double rate);
 
+/*!
+ * Get the number of ZeroMQ I/O threads of the contexts created by nodes (can be changed
+ * by the B0_IO_THREADS env var, or by the --io-threads= command line option)
+ */
+int getIOThreads();
+
+/*!
+ * Set the number of ZeroMQ I/O threads of the contexts created by nodes (can be changed
+ * by the B0_IO_THREADS env var, or by the --io-threads= command line option)
+ *
+ * Only affects the nodes created afterwards.
+ */
+void setIOThreads(int n);
+
+/*!
+ * Return true if the contexts created by nodes have an I/O thread reserved to the
+ * high-priority sockets (can be changed by the B0_PRIORITY_IO_THREAD env var)
+ */
+bool getPriorityIOThread();
+
+/*!
+ * Reserve an I/O thread to the high-priority sockets (see b0::Socket::setHighPriority()),
+ * in addition to the ones given by setIOThreads() (can be changed by the B0_PRIORITY_IO_THREAD
+ * env var)
+ *
+ * The other sockets are then kept off that thread, so that a large message being sent or
+ * received does not delay the high-priority ones. Only affects the nodes created afterwards.
+ */
+void setPriorityIOThread(bool reserved);
+
+/*!
+ * Return true if all the nodes of this process share one ZeroMQ context (can be changed
+ * by the B0_SHARED_CONTEXT env var)
+ */
+bool getSharedContext();
+
+/*!
+ * Make all the nodes of this process share one ZeroMQ context, instead of creating one
+ * context per node (can be changed by the B0_SHARED_CONTEXT env var)
+ *
+ * The shared context is created by the first node, and destroyed with the last node.
+ * Only affects the nodes created afterwards.
+ */
+void setSharedContext(bool shared);
+
+/*!
+ * Return true if the intra-process transport is enabled (can be changed by the
+ * B0_INTRAPROCESS env var)
+ */
+bool getIntraProcess();
+
+/*!
+ * Enable the intra-process transport (can be changed by the B0_INTRAPROCESS env var)
+ *
+ * When enabled, messages published on a topic are handed over directly (without
+ * serialization) to the subscribers of the same process, which are connected to the
+ * same resolver. Subscribers in other processes still receive them through the network.
+ *
+ * Must be set before the sockets are initialized.
+ */
+void setIntraProcess(bool enabled);
+
+/*!
+ * Return true if topics are routed peer-to-peer (can be changed by the B0_PEER_TO_PEER env var)
+ */
+bool getPeerToPeer();
+
+/*!
+ * Route topics peer-to-peer (can be changed by the B0_PEER_TO_PEER env var)
+ *
+ * When enabled, publishers bind to their own address and announce it to the resolver,
+ * instead of connecting to the resolver's XSUB/XPUB proxy, and subscribers connect
+ * directly to the publishers of their topic (as well as to the proxy, for publishers
+ * which are not in peer-to-peer mode). The resolver is then no longer in the data path.
+ *
+ * Subscribers periodically ask the resolver for new publishers.
+ * All the nodes publishing with this mode enabled require subscribers with this mode enabled.
+ *
+ * Must be set before the sockets are initialized.
+ */
+void setPeerToPeer(bool enabled);
+
+/*!
+ * Return true if IPC endpoints are used between nodes of the same host (can be changed by the B0_IPC env var)
+ */
+bool getIPC();
+
+/*!
+ * Use IPC endpoints between nodes of the same host (can be changed by the B0_IPC env var)
+ *
+ * When enabled, the sockets which bind a TCP port (the resolver's proxies, service servers,
+ * and publishers in peer-to-peer mode) also bind an ipc:// endpoint (a Unix domain socket,
+ * see b0::setIPCDirectory()), which is advertised along with the TCP address. The nodes
+ * running on the same host (see b0::Node::hostname()) then connect to the IPC endpoint,
+ * which has a lower latency and CPU usage than the TCP loopback; the others use TCP.
+ *
+ * The default is enabled, except on Windows. Must be set before the nodes are initialized.
+ */
+void setIPC(bool enabled);
+
+/*!
+ * Return the directory of the IPC endpoints (can be changed by the B0_IPC_DIR env var)
+ */
+std::string getIPCDirectory();
+
+/*!
+ * Set the directory of the IPC endpoints (can be changed by the B0_IPC_DIR env var, default: /tmp)
+ *
+ * It must be writable, and the same for all the nodes of a host.
+ */
+void setIPCDirectory(const std::string &dir);
+
+/*!
+ * Return true if nodes log asynchronously (can be changed by the B0_ASYNC_LOGGING env var)
+ */
+bool getAsyncLogging();
+
+/*!
+ * Make nodes log asynchronously (can be changed by the B0_ASYNC_LOGGING env var)
+ *
+ * When enabled, log messages are put in a bounded lock-free queue, and printed to the
+ * console and sent to the `log` topic by a background thread, so that the logging thread
+ * never waits for the console or the network.
+ *
+ * The size of the queue is given by the B0_ASYNC_LOGGING_QUEUE_SIZE env var (default 4096,
+ * rounded up to a power of two, at most 1048576).
+ * When the queue is full, messages are dropped (and counted, see
+ * b0::logger::Logger::getDroppedCount()), unless the B0_ASYNC_LOGGING_BLOCK env var is set,
+ * in which case the logging thread waits for some room in the queue.
+ *
+ * Must be set before the nodes are created.
+ */
+void setAsyncLogging(bool enabled);
+
+/*!
+ * Return true if nodes log to the subtopics of the `log` topic (can be changed by the
+ * B0_HIERARCHICAL_LOG_TOPICS env var)
+ */
+bool getHierarchicalLogTopics();
+
+/*!
+ * Make nodes log to the subtopics of the `log` topic (can be changed by the
+ * B0_HIERARCHICAL_LOG_TOPICS env var)
+ *
+ * When enabled, each log entry is sent to the subtopic `<level>/<node>` of the `log` topic
+ * (see b0::Publisher::setSubtopic()), e.g. `log/warn/camera`, so that the subscribers select
+ * the levels and nodes they want (see b0::Subscriber::setSubtopicFilters(),
+ * b0::logger::logSubtopicFilters()) and the other entries are dropped by the proxy. The
+ * subscribers of the `log` topic alone do not receive them.
+ *
+ * The default is disabled. Must be set before the nodes are created.
+ */
+void setHierarchicalLogTopics(bool enabled);
+
+/*!
+ * Return the number of threads used to compress the parts of a message in parallel
+ * (can be changed by the B0_COMPRESSION_THREADS env var)
+ */
+int getCompressionThreads();
+
+/*!
+ * Set the number of threads used to compress the parts of a message in parallel
+ * (can be changed by the B0_COMPRESSION_THREADS env var)
+ *
+ * When greater than zero, the compressed parts of a multipart message are compressed
+ * (and decompressed, on the receiving side) concurrently by a shared pool of worker
+ * threads, with the calling thread taking part in the work. This is done only for
+ * messages with at least two compressed parts and enough data to be worth the hand-off.
+ *
+ * The default (0) compresses the parts one after another on the calling thread.
+ */
+void setCompressionThreads(int n);
+
+/*!
+ * Return true if the JSON messages are decoded in place (can be changed by the
+ * B0_IN_PLACE_JSON_DECODING env var)
+ */
+bool getInPlaceJSONDecoding();
+
+/*!
+ * Enable or disable the decoding of JSON messages in place (can be changed by the
+ * B0_IN_PLACE_JSON_DECODING env var)
+ *
+ * When enabled (the default), b0::message::parse() decodes the JSON payloads of the message
+ * types with a field description (see b0::message::msgpack) in one pass over the buffer,
+ * directly into the message (see b0::message::json_decoder), instead of with the
+ * spotify::json codec, which is still used for the payloads the decoder rejects.
+ */
+void setInPlaceJSONDecoding(bool enabled);
+
+/*!
+ * Return the linger period of new sockets, in milliseconds (can be changed by the B0_LINGER_PERIOD env var)
+ */
+int getLingerPeriod();
+
+/*!
+ * Set the linger period of new sockets, in milliseconds, -1 for no timeout (can be changed by the
+ * B0_LINGER_PERIOD env var)
+ *
+ * This is how long a closed socket keeps trying to send its outgoing messages, blocking the
+ * termination of the node's context. The default is 5000. Short-lived tools use a much shorter
+ * period; see also b0::Node::setShutdownTimeout() for a deadline shared by all the sockets of a node.
+ *
+ * Must be set before the sockets are created.
+ */
+void setLingerPeriod(int period);
+
+/*!
+ * Return the default spin budget of new sockets, in messages (can be changed by the B0_SPIN_BUDGET env var)
+ */
+int getSpinBudget();
+
+/*!
+ * Set the default spin budget of new sockets: the maximum number of messages one spinOnce() of a
+ * socket processes, 0 for no limit (can be changed by the B0_SPIN_BUDGET env var)
+ *
+ * The default is 0: a socket is drained at each spin. See b0::Socket::setSpinBudget().
+ *
+ * Must be set before the sockets are created.
+ */
+void setSpinBudget(int max_messages);
+
+/*!
+ * Return true if service resolutions are cached (can be changed by the B0_SERVICE_CACHE env var)
+ */
+bool getServiceCache();
+
+/*!
+ * Cache the service resolutions (can be changed by the B0_SERVICE_CACHE env var)
+ *
+ * When enabled, the addresses of a service resolved by a node are remembered by the
+ * process, and the service clients of this process which are initialized later do
+ * not ask the resolver again. The cache is cleared when the resolver announces a
+ * change of the graph (on the "graph_delta" topic), which the nodes check before resolving
+ * a service, and an entry is also resolved again after 30 seconds.
+ */
+void setServiceCache(bool enabled);
+
+/*!
+ * Return the number of idle connections kept per service (can be changed by the B0_SERVICE_CLIENT_POOL env var)
+ */
+int getServiceClientPool();
+
+/*!
+ * Keep the connections of the service clients for the next ones (can be changed by the B0_SERVICE_CLIENT_POOL env var)
+ *
+ * When a service client is cleaned up, its connected socket is kept by the process, up to
+ * max_idle sockets per service (0, the default, disables the pool), and handed over to the
+ * next client of the same service initialized by a node sharing its ZeroMQ context: that
+ * client then neither resolves the service nor connects again, so that short-lived clients
+ * (e.g. one per request) cost microseconds instead of a resolution and a TCP handshake. The
+ * sockets kept for a context are closed when a node using it is destroyed.
+ *
+ * Clients balancing their requests by least outstanding requests (see
+ * b0::ServiceClient::setLoadBalancing()) are not pooled.
+ */
+void setServiceClientPool(int max_idle);
+
+/*!
+ * Return true if the heartbeats of the nodes of this process are coalesced (can be changed by the B0_HEARTBEAT_COALESCING env var)
+ */
+bool getHeartbeatCoalescing();
+
+/*!
+ * Coalesce the heartbeats of the nodes of this process (can be changed by the B0_HEARTBEAT_COALESCING env var)
+ *
+ * When enabled, only one of the nodes of this process connected to the same resolver
+ * sends heartbeats, on behalf of all of them, so the load on the resolver grows with the
+ * number of processes instead of the number of nodes. The other nodes get the time
+ * synchronization from the shared heartbeat. Needs a resolver which accepts coalesced
+ * heartbeats (BlueZero 2.0 or later).
+ */
+void setHeartbeatCoalescing(bool enabled);
+
+/*!
+ * Return true if the nodes of this process share a process agent (can be changed by the B0_PROCESS_AGENT env var)
+ */
+bool getProcessAgent();
+
+/*!
+ * Make the nodes of this process share a process agent (can be changed by the B0_PROCESS_AGENT env var)
+ *
+ * The agent (see b0::ProcessAgent) holds, for all the nodes of this process connected to
+ * the same resolver, the connection to the resolver, the heartbeat thread and the
+ * publisher of the remote log. The number of threads and connections, and the load on the
+ * resolver, then grow with the number of processes instead of the number of nodes. The
+ * nodes also share one ZeroMQ context (see setSharedContext()).
+ *
+ * The agent appears to the resolver as an ephemeral node (see b0::Node::setEphemeral()),
+ * which sends coalesced heartbeats (see setHeartbeatCoalescing()). Only affects the nodes
+ * created afterwards.
+ */
+void setProcessAgent(bool enabled);
+
+/*!
+ * Return true if the nodes send their heartbeats from spinOnce() (can be changed by the B0_INLINE_HEARTBEATS env var)
+ */
+bool getInlineHeartbeats();
+
+/*!
+ * Make the nodes send their heartbeats from spinOnce() instead of a thread (can be changed by the B0_INLINE_HEARTBEATS env var)
+ *
+ * This is the default of b0::Node::setInlineHeartbeat(). Only affects the nodes created
+ * afterwards.
+ */
+void setInlineHeartbeats(bool enabled);
+
+/*!
+ * Return true if the embedded profile is used (can be changed by the B0_EMBEDDED_PROFILE env var)
+ */
+bool getEmbeddedProfile();
+
+/*!
+ * Use the settings of the embedded profile (can be changed by the B0_EMBEDDED_PROFILE env var)
+ *
+ * The profile minimizes the threads and the memory of the nodes, for small targets: the
+ * heartbeats are sent by spinOnce() (see setInlineHeartbeats()), so that, besides the one
+ * I/O thread of ZeroMQ, a node spun from the main thread starts no thread unless asked to
+ * (async logging, the process agent, heartbeat coalescing and compression threads are
+ * disabled), and the messages sent use a b0::FixedBufferPool, unless another allocator is
+ * set: B0_EMBEDDED_BUFFERS buffers (default: 16) of B0_EMBEDDED_BUFFER_SIZE bytes (default:
+ * 65536), allocated once.
+ *
+ * With the env var, the other env vars (e.g. B0_ASYNC_LOGGING) override the settings of the
+ * profile. Disabling the profile only turns the inline heartbeats off. Only affects the
+ * nodes created afterwards.
+ *
+ * The BUILD_EMBEDDED_LIB CMake option builds a reduced static library (b0-embedded),
+ * without the resolver, the bag files, the graph tools and the C bindings.
+ */
+void setEmbeddedProfile(bool enabled);
+
+/*!
+ * Return the allocator of the buffers of the messages sent, or null for the one of ZeroMQ (can be set by the B0_BUFFER_POOL env var)
+ */
+std::shared_ptr<BufferAllocator> getBufferAllocator();
+
+/*!
+ * Set the allocator of the buffers of the messages sent (null for the one of ZeroMQ)
+ *
+ * The sockets allocate with it the ZeroMQ messages they send (the serialized envelopes, the
+ * chunks of a chunked envelope and the frames of a multipart envelope), which ZeroMQ gives
+ * back once sent. With a b0::BufferPool, the buffers of the big messages are reused instead
+ * of being mapped and faulted in for each message.
+ *
+ * With the B0_BUFFER_POOL env var set, a b0::BufferPool is used, with huge pages if the
+ * B0_BUFFER_POOL_HUGE_PAGES env var is set too, and bound to the NUMA node given by the
+ * B0_BUFFER_POOL_NUMA_NODE env var, or else by B0_NUMA_NODE or B0_NUMA_INTERFACE.
+ * Only affects the sockets created afterwards.
+ * The allocators set are kept until the process exits, since the messages allocated with
+ * them can outlive their sockets.
+ */
+void setBufferAllocator(std::shared_ptr<BufferAllocator> allocator);
+
+/*!
+ * Return true if the sockets account the buffers they allocate (can be changed by the B0_MEMORY_ACCOUNTING env var)
+ */
+bool getMemoryAccounting();
+
+/*!
+ * Make the sockets account the buffers they allocate (can be changed by the B0_MEMORY_ACCOUNTING env var)
+ *
+ * This is the default of b0::Socket::setMemoryAccounting(), and only affects the sockets
+ * created afterwards.
+ */
+void setMemoryAccounting(bool enabled);
+
+/*!
+ * Return true if the nodes of this process report their resource usage in the heartbeats (can be changed by the B0_HEARTBEAT_STATS env var)
+ */
+bool getHeartbeatStats();
+
+/*!
+ * Report the resource usage of the nodes of this process in the heartbeats (can be changed by the B0_HEARTBEAT_STATS env var)
+ *
+ * When enabled, the heartbeats carry the CPU time and resident memory of the process,
+ * and the message rates and spin overruns of each node (see b0::message::graph::NodeStats).
+ * The resolver keeps the last ones received, and returns them in the graph
+ * (b0::message::graph::GraphNode::stats), so the busy nodes can be spotted with
+ * b0_node_list or the graph monitors.
+ */
+void setHeartbeatStats(bool enabled);
+
+/*!
+ * Return true if new sockets monitor their connections (can be changed by the B0_CONNECTION_MONITOR env var)
+ */
+bool getConnectionMonitor();
+
+/*!
+ * Monitor the connections of new sockets (can be changed by the B0_CONNECTION_MONITOR env var)
+ *
+ * See b0::Socket::setConnectionMonitor(). The default is false.
+ */
+void setConnectionMonitor(bool enabled);
+
+/*!
+ * Return true if the monitored connections log their failures as warnings (can be changed by the B0_CONNECTION_MONITOR_WARN env var)
+ */
+bool getConnectionMonitorWarnings();
+
+/*!
+ * Log the disconnections, reconnections and failed handshakes of the monitored connections
+ * as warnings (can be changed by the B0_CONNECTION_MONITOR_WARN env var)
+ *
+ * Otherwise they are logged at debug level. The default is false.
+ */
+void setConnectionMonitorWarnings(bool enabled);
+
+/*!
+ * Return true if new nodes follow a simulated clock (can be changed by the B0_SIMULATED_TIME env var)
+ */
+bool getSimulatedTime();
+
+/*!
+ * Make the new nodes follow the simulated clock published on the "clock" topic, instead of
+ * the computer's clock (can be changed by the B0_SIMULATED_TIME env var)
+ *
+ * See b0::Node::setSimulatedTime(). The resolver always follows the computer's clock.
+ * The default is false.
+ */
+void setSimulatedTime(bool enabled);
+
+/*!
+ * Return true if the nodes discover each other without a resolver (can be changed by the B0_DECENTRALIZED env var)
+ */
+bool getDecentralized();
+
+/*!
+ * Discover the other nodes without a resolver (can be changed by the B0_DECENTRALIZED env var)
+ *
+ * When enabled, each process announces the services and topics of its nodes with UDP
+ * beacons (see b0::resolver::Discovery), and the nodes resolve the names from the beacons
+ * they receive. Topics are routed peer-to-peer (see b0::setPeerToPeer()).
+ *
+ * Must be set before the nodes are initialized.
+ */
+void setDecentralized(bool enabled);
+
+/*!
+ * Return the CPU affinity and scheduling of the threads of a role (see b0::ThreadConfig)
+ */
+ThreadConfig getThreadConfig(const std::string &role);
+
+/*!
+ * Set the CPU affinity and scheduling of the threads of a role (can be changed by the
+ * B0_THREAD_<ROLE>_CPUS, B0_THREAD_<ROLE>_POLICY, B0_THREAD_<ROLE>_PRIORITY,
+ * B0_THREAD_<ROLE>_NUMA_NODE and B0_THREAD_<ROLE>_NUMA_INTERFACE env vars; the NUMA node
+ * of the "spin", "callback" and "io" roles defaults to B0_NUMA_NODE or B0_NUMA_INTERFACE)
+ *
+ * The configuration is applied when the threads start (for the "spin" role, when
+ * b0::Node::spin() is called), so it must be set before. A configuration which cannot
+ * be applied (e.g. SCHED_FIFO without the privileges) is reported as a warning.
+ *
+ * Include b0/utils/thread_config.h to use this function.
+ */
+void setThreadConfig(const std::string &role, const ThreadConfig &config);
+
+/*!
+ * Return the socket profile with the given name (see b0::SocketProfile)
+ *
+ * Throw b0::exception::ArgumentError if there is no such profile.
+ *
+ * Include b0/utils/socket_profile.h to use this function.
+ */
+SocketProfile getSocketProfile(const std::string &name);
+
+/*!
+ * Add a socket profile, or redefine one (also a built-in one)
+ *
+ * The sockets already created keep the options they have.
+ *
+ * Include b0/utils/socket_profile.h to use this function.
+ */
+void setSocketProfile(const std::string &name, const SocketProfile &profile);
+
+/*!
+ * Apply a profile to the sockets matching a pattern (see b0::Socket::matchesPattern())
+ *
+ * The profile is applied when the socket is created, so the patterns see the names given
+ * to the constructors (before any remapping), and the options set on the socket afterwards
+ * win. The first matching pattern is used. Can be given also with the B0_SOCKET_PROFILES env
+ * var, e.g. "*.joint_commands=low-latency;camera.*=bulk", or with the --socket-profile
+ * command line option, e.g. "--socket-profile *.images=bulk".
+ *
+ * Throw b0::exception::ArgumentError if there is no such profile.
+ */
+void addSocketProfilePattern(const std::string &pattern, const std::string &profile);
+
+/*!
+ * Return the patterns and profiles added by b0::addSocketProfilePattern(), in order
+ */
+std::vector<std::pair<std::string, std::string> > getSocketProfilePatterns();
+
 /*!
  * Return wether quit has requested (by b0::quit() method or by pressing CTRL-C)
  *
@@ -0,0 +1,319 @@
+#ifndef B0__BAG__BAG_H__INCLUDED
+#define B0__BAG__BAG_H__INCLUDED
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_ref.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message_envelope.h>
+
+namespace b0
+{
+
+namespace compress
+{
+
+class Context;
+
+} // namespace compress
+
+//! \brief Recording of topics into files, and their replay (see b0_topic_record and b0_topic_replay)
+namespace bag
+{
+
+/*!
+ * \brief Messages of one topic in a chunk of a bag file
+ */
+struct ChunkTopicInfo
+{
+    //! The topic
+    std::string topic;
+
+    //! Number of messages of the topic in the chunk
+    uint32_t count;
+
+    //! Offset of the first record of the topic in the (uncompressed) data of the chunk
+    uint64_t first_offset;
+
+    //! Receive time of the first message of the topic in the chunk
+    int64_t first_time;
+
+    //! Receive time of the last message of the topic in the chunk
+    int64_t last_time;
+};
+
+/*!
+ * \brief Location, time span and topics of a chunk of a bag file
+ */
+struct ChunkInfo
+{
+    //! Offset of the chunk header in the file
+    uint64_t offset;
+
+    //! Number of messages in the chunk
+    uint32_t count;
+
+    //! Receive time of the first message of the chunk
+    int64_t first_time;
+
+    //! Receive time of the last message of the chunk
+    int64_t last_time;
+
+    //! The topics of the chunk
+    std::vector<ChunkTopicInfo> topics;
+};
+
+/*!
+ * \brief A message read from a bag file
+ */
+struct Record
+{
+    //! Receive time, in microseconds (see b0::Node::timeUSec())
+    int64_t time;
+
+    //! The topic, i.e. the header0 of the envelope
+    boost::string_ref topic;
+
+    //! The serialized envelope, byte-for-byte as received (parse it with b0::message::parse())
+    boost::string_ref wire;
+};
+
+/*!
+ * \brief Writes an append-only bag file
+ *
+ * The file starts with an 8 bytes magic ("B0BAG002"), followed by chunks of messages. The
+ * data of a chunk, i.e. its records, can be compressed as a whole:
+ *
+ *     chunk:  "CHNK" count(4) stored-size(8) size(8) first-time(8) last-time(8)
+ *             algorithm-length(1) algorithm data
+ *     record: time(8) size(4) envelope
+ *
+ * On close() the index is appended: the number of messages of each topic, and the chunks
+ * (as in ChunkInfo, topics referenced by their position in the topic table), followed by a
+ * trailer giving its offset:
+ *
+ *     index:   "INDX" topic-count(4) [name-length(2) name message-count(8)]...
+ *              chunk-count(4) [offset(8) count(4) first-time(8) last-time(8) topic-count(4)
+ *                              [topic(4) count(4) first-offset(8) first-time(8) last-time(8)]...]...
+ *     trailer: index-offset(8) "B0BAGIDX"
+ *
+ * Integers are little-endian. A chunk is written at once, when it reaches the chunk size, so
+ * that a file whose recording was interrupted is still readable up to its last chunk.
+ * The envelopes are stored without being parsed.
+ */
+class Writer
+{
+public:
+    /*!
+     * \brief Create (or truncate) a bag file
+     *
+     * If compression_algorithm is not empty, the chunks are compressed with it (see
+     * b0::compress::compress()), e.g. "lz4" or "zstd".
+     */
+    Writer(const std::string &path, size_t chunk_size = 4 * 1024 * 1024, const std::string &compression_algorithm = "", int compression_level = -1);
+
+    //! Close the file, if not closed yet
+    ~Writer();
+
+    //! Append a serialized envelope received at time_usec (it must start with its header0 line)
+    void write(int64_t time_usec, const char *wire, size_t size);
+
+    //! Serialize and append an envelope
+    void write(int64_t time_usec, const b0::message::MessageEnvelope &env, b0::message::EnvelopeFormat format = b0::message::EnvelopeFormat::Text);
+
+    //! Write the current chunk to the file
+    void flush();
+
+    //! Write the current chunk and the index, and close the file
+    void close();
+
+    //! Return the number of messages written
+    uint64_t getMessageCount() const;
+
+    //! Return the number of envelope bytes written
+    uint64_t getByteCount() const;
+
+private:
+    //! Write the whole buffer to the file
+    void writeFile(const char *data, size_t size);
+
+    //! The file
+    std::FILE *file_;
+
+    //! Size at which a chunk is written
+    size_t chunk_size_;
+
+    //! Compression algorithm of the chunks
+    std::string compression_algorithm_;
+
+    //! Compression level of the chunks
+    int compression_level_;
+
+    //! Compression state, reused across chunks
+    std::unique_ptr<b0::compress::Context> compress_context_;
+
+    //! The records of the current chunk
+    std::string chunk_;
+
+    //! The current chunk's information
+    ChunkInfo chunk_info_;
+
+    //! The topics of the current chunk
+    std::map<std::string, ChunkTopicInfo> chunk_topics_;
+
+    //! Scratch buffers for the chunk header, the compressed chunks and the serialized envelopes
+    std::string header_, compressed_, serialized_;
+
+    //! Offset of the end of the file
+    uint64_t offset_;
+
+    //! The chunks written
+    std::vector<ChunkInfo> chunks_;
+
+    //! Number of messages by topic
+    std::map<std::string, uint64_t> topics_;
+
+    //! Number of messages written
+    uint64_t message_count_{0};
+
+    //! Number of envelope bytes written
+    uint64_t byte_count_{0};
+};
+
+/*!
+ * \brief Writes a sequence of bag files, from a background thread
+ *
+ * The messages passed to write() are queued, and written by a background thread (which also
+ * compresses the chunks), so that the callers never wait for the compression nor the disk.
+ * The queue is not bounded: no message is dropped, however late the disk gets.
+ *
+ * A new file is started when the current one holds max_size bytes of envelopes, or when its
+ * first message is older than max_duration_usec (0 for no limit). The files are named
+ * after prefix and the time they were created, e.g. "log-20240131-235959-000.bag"; if
+ * max_files is not 0, the oldest ones are deleted so that at most max_files remain. The
+ * current chunk is written at least every second, so the last messages of a file are readable.
+ *
+ * The errors of the background thread are thrown by the next call to write(), flush() or close().
+ */
+class RotatingWriter
+{
+private:
+    //! \cond HIDDEN_SYMBOLS
+
+    struct Private;
+
+    //! \endcond
+
+public:
+    /*!
+     * \brief Start the background thread; the first file is created by the first message
+     *
+     * The chunks are as in Writer.
+     */
+    RotatingWriter(const std::string &prefix, uint64_t max_size = 256 * 1024 * 1024, int64_t max_duration_usec = 0, size_t max_files = 0, size_t chunk_size = 4 * 1024 * 1024, const std::string &compression_algorithm = "", int compression_level = -1);
+
+    //! Close the files, if not closed yet
+    ~RotatingWriter();
+
+    //! Queue a serialized envelope received at time_usec (thread-safe, see Writer::write())
+    void write(int64_t time_usec, const char *wire, size_t size);
+
+    //! Wait until the messages queued are written to the file
+    void flush();
+
+    //! Write the messages queued, close the current file, and stop the background thread
+    void close();
+
+    //! Return the paths of the files written and not deleted, the oldest first
+    std::vector<std::string> getFiles() const;
+
+    //! Return the number of messages written (not only queued)
+    uint64_t getMessageCount() const;
+
+    //! Return the number of envelope bytes written (not only queued)
+    uint64_t getByteCount() const;
+
+private:
+    //! Code of the background thread
+    void writeLoop();
+
+    std::unique_ptr<Private> private_;
+};
+
+/*!
+ * \brief Reads a bag file, mapped in memory
+ *
+ * The index is used to go straight to a time (see seekTime()) or to the chunks containing
+ * some topics (see setTopics()), without reading the rest of the file. A file without index
+ * (whose recording was interrupted) is scanned when opened, up to its last complete chunk.
+ *
+ * The records of uncompressed chunks point into the mapping: they are valid while the reader
+ * exists, and the envelopes can be published without being copied. The records of compressed
+ * chunks are valid until next() moves to another chunk.
+ */
+class Reader
+{
+private:
+    //! \cond HIDDEN_SYMBOLS
+
+    struct Private;
+
+    //! \endcond
+
+public:
+    //! Map a bag file, throwing exception::Exception if it is not valid
+    explicit Reader(const std::string &path);
+
+    ~Reader();
+
+    //! Return true if the file has an index (i.e. the recording was closed properly)
+    bool isIndexed() const;
+
+    //! Return the chunks of the file
+    const std::vector<ChunkInfo> & getChunks() const;
+
+    //! Return the number of messages of each topic
+    const std::map<std::string, uint64_t> & getTopics() const;
+
+    //! Return the total number of messages
+    uint64_t getMessageCount() const;
+
+    //! Return the receive time of the first message (0 if none)
+    int64_t getStartTime() const;
+
+    //! Return the receive time of the last message (0 if none)
+    int64_t getEndTime() const;
+
+    /*!
+     * \brief Read only the messages of these topics (all of them if empty)
+     *
+     * The chunks without any of these topics are skipped, and the others are read from the
+     * first record of these topics.
+     */
+    void setTopics(const std::set<std::string> &topics);
+
+    //! Read the next message, in the order they were recorded; return false at the end
+    bool next(Record &record);
+
+    //! Go to the first message received at or after time_usec
+    void seekTime(int64_t time_usec);
+
+    //! Go back to the first message
+    void rewind();
+
+private:
+    std::unique_ptr<Private> private_;
+};
+
+} // namespace bag
+
+} // namespace b0
+
+#endif // B0__BAG__BAG_H__INCLUDED
@@ -53,6 +53,22 @@ typedef struct b0_service_client b0_service_client;
 struct b0_service_server;
 typedef struct b0_service_server b0_service_server;
 
+// a received message, whose payload is lent by the *_read_lend() functions until b0_message_release():
+struct b0_message;
+typedef struct b0_message b0_message;
+
+// a message being built in a buffer owned by the library (see b0_publisher_frame_new()):
+struct b0_frame;
+typedef struct b0_frame b0_frame;
+
+// a payload and its content type, for the batch functions:
+typedef struct b0_message_ref
+{
+    const void *data;
+    size_t size;
+    const char *type;
+} b0_message_ref;
+
 B0_EXPORT int b0_init(int *argc, char **argv);
 B0_EXPORT int b0_is_initialized();
 B0_EXPORT int b0_add_option(const char *name, const char *descr);
@@ -84,6 +100,9 @@ B0_EXPORT int b0_quit();
 B0_EXPORT void * b0_buffer_new(size_t size);
 B0_EXPORT void b0_buffer_delete(void *buffer);
 
+B0_EXPORT void b0_message_release(b0_message *msg);
+B0_EXPORT void b0_frame_delete(b0_frame *frame);
+
 B0_EXPORT b0_node * b0_node_new(const char *name);
 B0_EXPORT void b0_node_delete(b0_node *node);
 B0_EXPORT int b0_node_init(b0_node *node);
@@ -99,6 +118,13 @@ B0_EXPORT int64_t b0_node_hardware_time_usec(b0_node *node);
 B0_EXPORT int64_t b0_node_time_usec(b0_node *node);
 B0_EXPORT void b0_node_sleep_usec(b0_node *node, int64_t usec);
 B0_EXPORT int b0_node_log(b0_node *node, int level, const char *message);
+// for external event loops: the fds are edge-triggered, spin while b0_node_has_pending_events() (*count is the full count):
+B0_EXPORT int b0_node_get_event_fds(b0_node *node, int64_t *fds, size_t max_count, size_t *count);
+B0_EXPORT int b0_node_has_pending_events(b0_node *node);
+// process only the sockets of the readable fds; *remaining is set if they must be processed again:
+B0_EXPORT int b0_node_process_ready_sockets(b0_node *node, const int64_t *fds, size_t count, int *remaining);
+B0_EXPORT int64_t b0_node_next_timer_usec(b0_node *node);
+B0_EXPORT void b0_node_wake_up(b0_node *node);
 
 B0_EXPORT b0_publisher * b0_publisher_new_ex(b0_node *node, const char *topic_name, int managed, int notify_graph);
 B0_EXPORT b0_publisher * b0_publisher_new(b0_node *node, const char *topic_name);
@@ -108,6 +134,13 @@ B0_EXPORT int b0_publisher_cleanup(b0_publisher *pub);
 B0_EXPORT int b0_publisher_spin_once(b0_publisher *pub);
 B0_EXPORT const char * b0_publisher_get_topic_name(b0_publisher *pub);
 B0_EXPORT int b0_publisher_publish(b0_publisher *pub, const void *data, size_t size);
+// takes ownership of data: free_fn(data, hint) is called once the library does not need it (even on failure):
+B0_EXPORT int b0_publisher_publish_owned(b0_publisher *pub, void *data, size_t size, void (*free_fn)(void *, void *), void *hint);
+// the payload is written by the caller in *data, and sent without copies by b0_publisher_publish_frame():
+B0_EXPORT b0_frame * b0_publisher_frame_new(b0_publisher *pub, size_t size, void **data);
+B0_EXPORT int b0_publisher_publish_frame(b0_publisher *pub, b0_frame *frame);
+// sent as a single batch envelope (see b0::Publisher::publishBatch()); type may be NULL:
+B0_EXPORT int b0_publisher_publish_batch(b0_publisher *pub, const b0_message_ref *msgs, size_t count);
 B0_EXPORT int b0_publisher_log(b0_publisher *pub, int level, const char *message);
 B0_EXPORT int b0_publisher_set_option(b0_publisher *pub, int option, int value);
 
@@ -121,6 +154,11 @@ B0_EXPORT const char * b0_subscriber_get_topic_name(b0_subscriber *sub);
 B0_EXPORT int b0_subscriber_log(b0_subscriber *sub, int level, const char *message);
 B0_EXPORT int b0_subscriber_poll(b0_subscriber *sub, long timeout);
 B0_EXPORT void * b0_subscriber_read(b0_subscriber *sub, size_t *size);
+B0_EXPORT b0_message * b0_subscriber_read_lend(b0_subscriber *sub, const void **data, size_t *size);
+// *size is the size of the message, which is truncated if larger than capacity:
+B0_EXPORT int b0_subscriber_read_into(b0_subscriber *sub, void *buffer, size_t capacity, size_t *size);
+// read up to max_count messages, waiting at most timeout ms for the first one; the payloads are lent until b0_message_release():
+B0_EXPORT b0_message * b0_subscriber_read_batch(b0_subscriber *sub, b0_message_ref *msgs, size_t max_count, size_t *count, long timeout);
 B0_EXPORT int b0_subscriber_set_option(b0_subscriber *sub, int option, int value);
 
 B0_EXPORT b0_service_client * b0_service_client_new_ex(b0_node *node, const char *service_name, int managed, int notify_graph);
@@ -131,6 +169,7 @@ B0_EXPORT int b0_service_client_cleanup(b0_service_client *cli);
 B0_EXPORT int b0_service_client_spin_once(b0_service_client *cli);
 B0_EXPORT const char * b0_service_client_get_service_name(b0_service_client *cli);
 B0_EXPORT void * b0_service_client_call(b0_service_client *cli, const void *data, size_t size, size_t *out_size);
+B0_EXPORT int b0_service_client_call_into(b0_service_client *cli, const void *data, size_t size, void *buffer, size_t capacity, size_t *out_size);
 B0_EXPORT int b0_service_client_log(b0_service_client *cli, int level, const char *message);
 B0_EXPORT int b0_service_client_set_option(b0_service_client *cli, int option, int value);
 
@@ -144,6 +183,8 @@ B0_EXPORT const char * b0_service_server_get_service_name(b0_service_server *srv
 B0_EXPORT int b0_service_server_log(b0_service_server *srv, int level, const char *message);
 B0_EXPORT int b0_service_server_poll(b0_service_server *srv, long timeout);
 B0_EXPORT void * b0_service_server_read(b0_service_server *srv, size_t *size);
+B0_EXPORT b0_message * b0_service_server_read_lend(b0_service_server *srv, const void **data, size_t *size);
+B0_EXPORT int b0_service_server_read_into(b0_service_server *srv, void *buffer, size_t capacity, size_t *size);
 B0_EXPORT int b0_service_server_write(b0_service_server *srv, const void *msg, size_t size);
 B0_EXPORT int b0_service_server_set_option(b0_service_server *srv, int option, int value);
 
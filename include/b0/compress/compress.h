@@ -1,7 +1,11 @@
 #ifndef B0__COMPRESS__COMPRESS_H__INCLUDED
 #define B0__COMPRESS__COMPRESS_H__INCLUDED
 
+#include <memory>
 #include <string>
+#include <vector>
+
+#include <boost/function.hpp>
 
 #include <b0/b0.h>
 
@@ -11,8 +15,140 @@ namespace b0
 namespace compress
 {
 
-std::string compress(const std::string &algorithm, const std::string &str, int level = -1);
-std::string decompress(const std::string &algorithm, const std::string &str, size_t size = 0);
+/*!
+ * \brief Compress a payload with the given algorithm and level
+ *
+ * If dictionary is not empty, it is the id of a compression dictionary (see addDictionary()),
+ * which is supported only by the "zstd" algorithm.
+ */
+std::string compress(const std::string &algorithm, const std::string &str, int level = -1, const std::string &dictionary = "");
+
+/*!
+ * \brief Compress a payload into out, reusing its capacity
+ */
+void compress(const std::string &algorithm, const char *data, size_t len, std::string &out, int level = -1, const std::string &dictionary = "");
+
+/*!
+ * \brief Decompress a payload (see compress())
+ */
+std::string decompress(const std::string &algorithm, const std::string &str, size_t size = 0, const std::string &dictionary = "");
+
+/*!
+ * \brief Decompress a payload (see compress())
+ */
+std::string decompress(const std::string &algorithm, const char *data, size_t len, size_t size = 0, const std::string &dictionary = "");
+
+/*!
+ * \brief Decompress a payload into out, reusing its capacity
+ */
+void decompress(const std::string &algorithm, const char *data, size_t len, std::string &out, size_t size = 0, const std::string &dictionary = "");
+
+/*!
+ * \brief Result of tryDecompress()
+ */
+enum class DecompressStatus
+{
+    //! The payload has been decompressed
+    Ok,
+    //! The algorithm is not supported by this build (decompress() throws exception::UnsupportedCompressionAlgorithm)
+    UnsupportedAlgorithm,
+    //! The payload is corrupt, or the dictionary is not available (decompress() throws exception::Exception)
+    Error
+};
+
+/*!
+ * \brief Decompress a payload into out, without throwing
+ *
+ * On failure, the reason is stored in error, if given. Meant for the receive path, where a
+ * bad message is dropped, and an exception would cost much more than the message itself.
+ */
+DecompressStatus tryDecompress(const std::string &algorithm, const char *data, size_t len, std::string &out, size_t size = 0, const std::string &dictionary = "", std::string *error = nullptr);
+
+/*!
+ * \brief Compression state of all the algorithms, reused across payloads
+ *
+ * Keeps the compression and decompression contexts of each algorithm (created when first
+ * used), so that they are reset instead of set up again for every payload, and the scratch
+ * buffers for the compressed payloads of a message.
+ *
+ * Each b0::Socket owns one; the free compress() and decompress() functions use one per thread.
+ * Not thread safe.
+ */
+class Context
+{
+public:
+    Context();
+    ~Context();
+
+    //! Compress a payload into out, reusing its capacity (see b0::compress::compress())
+    void compress(const std::string &algorithm, const char *data, size_t len, std::string &out, int level = -1, const std::string &dictionary = "");
+
+    //! Decompress a payload into out, reusing its capacity (see b0::compress::decompress())
+    void decompress(const std::string &algorithm, const char *data, size_t len, std::string &out, size_t size = 0, const std::string &dictionary = "");
+
+    //! Decompress a payload into out, returning false instead of throwing (see b0::compress::tryDecompress())
+    DecompressStatus tryDecompress(const std::string &algorithm, const char *data, size_t len, std::string &out, size_t size = 0, const std::string &dictionary = "", std::string *error = nullptr);
+
+    //! Scratch buffers for the compressed payloads of a message
+    std::vector<std::string> & buffers();
+
+private:
+    struct Private;
+    std::unique_ptr<Private> private_;
+};
+
+/*!
+ * \brief Train a compression dictionary for the given algorithm from a set of sample payloads
+ *
+ * Only the "zstd" algorithm supports dictionaries. The samples should be representative
+ * of the messages of a topic (e.g. captured with a Subscriber).
+ */
+std::string trainDictionary(const std::string &algorithm, const std::vector<std::string> &samples, size_t max_size = 16384);
+
+/*!
+ * \brief Register a compression dictionary under the given id
+ *
+ * Dictionary ids are meant to be immutable: a retrained dictionary must be registered
+ * under a new id, since the compressors cache the dictionaries they have already used.
+ */
+void addDictionary(const std::string &id, const std::string &data);
+
+/*!
+ * \brief Return the compression dictionary with the given id
+ *
+ * If the dictionary was not registered with addDictionary(), the dictionary providers
+ * are asked for it (see addDictionaryProvider()), and the result is registered.
+ *
+ * \return false if no dictionary with that id could be found
+ */
+bool getDictionary(const std::string &id, std::string &data);
+
+//! \brief Alias for dictionary provider function
+using DictionaryProvider = boost::function<bool(const std::string&, std::string&)>;
+
+/*!
+ * \brief Add a function to ask for compression dictionaries which are not registered yet
+ *
+ * b0::Node installs a provider which fetches the dictionaries from the resolver.
+ * The key identifies the provider, for removeDictionaryProvider().
+ */
+void addDictionaryProvider(const void *key, DictionaryProvider provider);
+
+/*!
+ * \brief Remove a provider added with addDictionaryProvider()
+ */
+void removeDictionaryProvider(const void *key);
+
+/*!
+ * \brief Run a set of compression tasks, in parallel if enabled (see b0::setCompressionThreads())
+ *
+ * The tasks are run by a shared pool of worker threads, with the calling thread taking part
+ * in the work, and this function returns when all of them have completed. If some task throws
+ * an exception, the first one is rethrown after all tasks have completed.
+ *
+ * If parallel compression is disabled, the tasks are run one after another on the calling thread.
+ */
+void runTasks(std::vector<boost::function<void()> > &tasks);
 
 } // namespace compress
 
@@ -0,0 +1,40 @@
+#ifndef B0__COMPRESS__DELTA_H__INCLUDED
+#define B0__COMPRESS__DELTA_H__INCLUDED
+
+#include <string>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+namespace compress
+{
+
+/*!
+ * \brief Encode a payload as a delta against the previous one (base) into out
+ *
+ * The methods are:
+ *  - "xor": the payload XORed with the base, which must have the same size; the bytes which
+ *    did not change are zeroes, which the compression of the envelope removes
+ *  - "ranges": only the byte ranges which changed, for payloads whose size can change too
+ *
+ * Return false if the payload cannot be encoded against this base (i.e. it must be sent whole).
+ * Throws exception::ArgumentError if the method is unknown.
+ *
+ * \sa b0::Publisher::setDeltaEncoding()
+ */
+bool encodeDelta(const std::string &method, const std::string &base, const char *data, size_t len, std::string &out);
+
+/*!
+ * \brief Decode a delta made by encodeDelta() against the same base into out, without throwing
+ *
+ * On failure (unknown method, corrupt delta or wrong base), the reason is stored in error, if given.
+ */
+bool decodeDelta(const std::string &method, const std::string &base, const char *delta, size_t len, std::string &out, std::string *error = nullptr);
+
+} // namespace compress
+
+} // namespace b0
+
+#endif // B0__COMPRESS__DELTA_H__INCLUDED
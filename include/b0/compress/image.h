@@ -0,0 +1,49 @@
+#ifndef B0__COMPRESS__IMAGE_H__INCLUDED
+#define B0__COMPRESS__IMAGE_H__INCLUDED
+
+#include <string>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+namespace compress
+{
+
+/*!
+ * \brief Return true if the algorithm is one of the lossless image codecs
+ *
+ * The image codecs are always available, and select the format of the raw pixels with
+ * their name (see b0::Socket::setCompression()):
+ *  - "qoi-rgb", "qoi-rgba": 8-bit RGB or RGBA pixels, with the QOI algorithm (runs, a cache
+ *    of recent pixels and small differences), which does not depend on the width of the image
+ *  - "depth16/<width>": 16-bit little-endian samples (e.g. depth images, in millimeters) of
+ *    rows of <width> samples, predicted from their left, upper and upper-left neighbors (the
+ *    median edge detector of LOCO-I), with the residuals coded by adaptive Rice codes
+ *  - "depth16": the same, predicted from the left neighbor only, when the width is unknown
+ *
+ * A payload whose size is not a multiple of the pixel size keeps its last bytes as they are.
+ * The codecs take no level and no dictionary.
+ */
+bool isImageAlgorithm(const std::string &algorithm);
+
+/*!
+ * \brief Compress raw pixels into out (whose capacity is reused) with an image codec
+ *
+ * Throws exception::UnsupportedCompressionAlgorithm if the algorithm is not an image codec.
+ */
+void imageCompress(const std::string &algorithm, const char *data, size_t len, std::string &out);
+
+/*!
+ * \brief Decompress a payload of imageCompress() into out, without throwing
+ *
+ * size is the uncompressed size, if known. On failure, the reason is stored in error, if given.
+ */
+bool imageTryDecompress(const std::string &algorithm, const char *data, size_t len, std::string &out, size_t size = 0, std::string *error = nullptr);
+
+} // namespace compress
+
+} // namespace b0
+
+#endif // B0__COMPRESS__IMAGE_H__INCLUDED
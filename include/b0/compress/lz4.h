@@ -1,6 +1,7 @@
 #ifndef B0__COMPRESS__LZ4_H__INCLUDED
 #define B0__COMPRESS__LZ4_H__INCLUDED
 
+#include <memory>
 #include <string>
 
 #include <b0/b0.h>
@@ -13,8 +14,65 @@ namespace compress
 
 #ifdef LZ4_FOUND
 
+/*!
+ * \brief LZ4 compression states and LZ4 frame contexts, reused across calls
+ *
+ * Not thread safe: each thread (or socket) must use its own context.
+ * See lz4_compress() and lz4f_compress() for the meaning of the levels.
+ */
+class LZ4Context
+{
+public:
+    LZ4Context();
+    ~LZ4Context();
+
+    //! Compress len bytes as a raw LZ4 block into out (whose capacity is reused)
+    void compress(const char *data, size_t len, std::string &out, int level = -1);
+
+    //! Decompress a raw LZ4 block into out (whose capacity is reused); size is the uncompressed size, if known
+    void decompress(const char *data, size_t len, std::string &out, size_t size = 0);
+
+    //! As decompress(), but return false (and the reason in error, if given) instead of throwing
+    bool tryDecompress(const char *data, size_t len, std::string &out, size_t size = 0, std::string *error = nullptr);
+
+    //! Compress len bytes as an LZ4 frame into out (whose capacity is reused)
+    void compressFrame(const char *data, size_t len, std::string &out, int level = -1);
+
+    //! Decompress an LZ4 frame into out (whose capacity is reused)
+    void decompressFrame(const char *data, size_t len, std::string &out, size_t size = 0);
+
+    //! As decompressFrame(), but return false (and the reason in error, if given) instead of throwing
+    bool tryDecompressFrame(const char *data, size_t len, std::string &out, size_t size = 0, std::string *error = nullptr);
+
+private:
+    struct Private;
+    std::unique_ptr<Private> private_;
+};
+
+/*!
+ * \brief Compress a payload with LZ4
+ *
+ * The level selects the mode: -1, 0 and 1 use the default mode, lower levels use the fast
+ * mode with an acceleration factor of -level (faster, lower ratio), and higher levels use
+ * the high compression mode (LZ4 HC) with that level, clamped to the range supported by LZ4 HC.
+ */
 std::string lz4_compress(const std::string &str, int level = -1);
 std::string lz4_decompress(const std::string &str, size_t size = 0);
+std::string lz4_decompress(const char *data, size_t len, size_t size = 0);
+
+/*!
+ * \brief Compress a payload with the LZ4 frame format
+ *
+ * The frame carries the uncompressed size, so decompression never has to guess it.
+ * Levels follow LZ4F: 0 or -1 for the default, negative for fast mode, 3 and above for LZ4 HC.
+ */
+std::string lz4f_compress(const std::string &str, int level = -1);
+
+/*!
+ * \brief Decompress a payload in the LZ4 frame format, block by block into a single allocation
+ */
+std::string lz4f_decompress(const std::string &str, size_t size = 0);
+std::string lz4f_decompress(const char *data, size_t len, size_t size = 0);
 
 #endif
 
@@ -1,6 +1,7 @@
 #ifndef B0__COMPRESS__ZLIB_H__INCLUDED
 #define B0__COMPRESS__ZLIB_H__INCLUDED
 
+#include <memory>
 #include <string>
 
 #include <b0/b0.h>
@@ -13,8 +14,44 @@ namespace compress
 
 #ifdef ZLIB_FOUND
 
+/*!
+ * \brief Deflate and inflate streams, which are reset and reused across calls
+ *
+ * Not thread safe: each thread (or socket) must use its own context.
+ */
+class ZlibContext
+{
+public:
+    ZlibContext();
+    ~ZlibContext();
+
+    //! Compress len bytes into out (whose capacity is reused)
+    void compress(const char *data, size_t len, std::string &out, int level = -1);
+
+    //! Decompress len bytes into out (whose capacity is reused); size is the uncompressed size, if known
+    void decompress(const char *data, size_t len, std::string &out, size_t size = 0);
+
+    //! As decompress(), but return false (and the reason in error, if given) instead of throwing
+    bool tryDecompress(const char *data, size_t len, std::string &out, size_t size = 0, std::string *error = nullptr);
+
+private:
+    struct Private;
+    std::unique_ptr<Private> private_;
+};
+
 std::string zlib_compress(const std::string &str, int level = -1);
 std::string zlib_decompress(const std::string &str, size_t size = 0);
+std::string zlib_decompress(const char *data, size_t len, size_t size = 0);
+
+/*!
+ * \brief Return the implementation of the "zlib" algorithm: "isal" or "zlib"
+ *
+ * If built with ISA-L (see the ENABLE_ISAL CMake option), the zlib streams are written and
+ * read by its igzip functions, which are several times faster, falling back to zlib for what
+ * they cannot do; the streams are the same, so the peers need not use the same backend.
+ * Setting the B0_ZLIB_BACKEND environment variable to "zlib" disables ISA-L.
+ */
+std::string zlib_backend();
 
 #endif
 
@@ -0,0 +1,54 @@
+#ifndef B0__COMPRESS__ZSTD_H__INCLUDED
+#define B0__COMPRESS__ZSTD_H__INCLUDED
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+namespace compress
+{
+
+#ifdef ZSTD_FOUND
+
+/*!
+ * \brief Zstandard compression and decompression contexts, reused across calls
+ *
+ * Not thread safe: each thread (or socket) must use its own context.
+ */
+class ZstdContext
+{
+public:
+    ZstdContext();
+    ~ZstdContext();
+
+    //! Compress len bytes into out (whose capacity is reused), optionally with a dictionary
+    void compress(const char *data, size_t len, std::string &out, int level = -1, const std::string &dictionary = "");
+
+    //! Decompress len bytes into out (whose capacity is reused); size is the uncompressed size, if known
+    void decompress(const char *data, size_t len, std::string &out, size_t size = 0, const std::string &dictionary = "");
+
+    //! As decompress(), but return false (and the reason in error, if given) instead of throwing
+    bool tryDecompress(const char *data, size_t len, std::string &out, size_t size = 0, const std::string &dictionary = "", std::string *error = nullptr);
+
+private:
+    struct Private;
+    std::unique_ptr<Private> private_;
+};
+
+std::string zstd_compress(const std::string &str, int level = -1, const std::string &dictionary = "");
+std::string zstd_decompress(const std::string &str, size_t size = 0, const std::string &dictionary = "");
+std::string zstd_decompress(const char *data, size_t len, size_t size = 0, const std::string &dictionary = "");
+std::string zstd_train_dictionary(const std::vector<std::string> &samples, size_t max_size = 16384);
+
+#endif
+
+} // namespace compress
+
+} // namespace b0
+
+#endif // B0__COMPRESS__ZSTD_H__INCLUDED
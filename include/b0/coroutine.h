@@ -0,0 +1,352 @@
+#ifndef B0__COROUTINE_H__INCLUDED
+#define B0__COROUTINE_H__INCLUDED
+
+#if defined(__has_include)
+#if __has_include(<coroutine>) && ((defined(_MSVC_LANG) && _MSVC_LANG >= 202002L) || __cplusplus >= 202002L)
+#define B0_HAVE_COROUTINES
+#endif
+#endif
+
+#ifdef B0_HAVE_COROUTINES
+
+#include <b0/b0.h>
+#include <b0/exceptions.h>
+#include <b0/service_client.h>
+#include <b0/subscriber.h>
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace b0
+{
+
+/*!
+ * \brief C++20 coroutines on top of the asynchronous service calls and of subscribers
+ *
+ * A coroutine returning a Task can `co_await b0::coro::call<TRep>(client, req)` and
+ * `co_await sub.next()` (see b0::coro::Subscriber), which suspend it without blocking
+ * the thread. It is resumed from the callbacks of the node, i.e. from b0::Node::spinOnce()
+ * (or b0::Node::spin()) in the thread of the node, so that many coroutines, each with its
+ * requests in flight, run on that single thread. Start the outermost one with spawn().
+ *
+ * Only available when compiling with C++20 (B0_HAVE_COROUTINES is then defined); the
+ * library itself does not need it.
+ *
+ * \code
+ * b0::coro::Task<> run(b0::ServiceClient &cli)
+ * {
+ *     Point p = co_await b0::coro::call<Point>(cli, Query{"a"});
+ *     Path path = co_await b0::coro::call<Path>(cli, Query{p.name});
+ * }
+ *
+ * b0::coro::spawn(run(cli));
+ * node.spin();
+ * \endcode
+ */
+namespace coro
+{
+
+template<class T = void>
+class Task;
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace detail
+{
+
+struct TaskPromiseBase
+{
+    //! The coroutine awaiting the task, resumed when it completes
+    std::coroutine_handle<> continuation;
+
+    //! The exception which escaped the coroutine
+    std::exception_ptr exception;
+
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept {return false;}
+
+        template<class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+        {
+            std::coroutine_handle<> c = h.promise().continuation;
+            return c ? c : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept {return {};}
+
+    FinalAwaiter final_suspend() const noexcept {return {};}
+
+    void unhandled_exception() {exception = std::current_exception();}
+};
+
+template<class T>
+struct TaskPromise : TaskPromiseBase
+{
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+
+    template<class U>
+    void return_value(U &&v) {value.emplace(std::forward<U>(v));}
+
+    T result()
+    {
+        if(exception) std::rethrow_exception(exception);
+        return std::move(*value);
+    }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase
+{
+    Task<void> get_return_object();
+
+    void return_void() {}
+
+    void result()
+    {
+        if(exception) std::rethrow_exception(exception);
+    }
+};
+
+//! A coroutine which starts immediately, and frees itself when it ends
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() const noexcept {return {};}
+        std::suspend_never initial_suspend() const noexcept {return {};}
+        std::suspend_never final_suspend() const noexcept {return {};}
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept {std::terminate();}
+    };
+};
+
+} // namespace detail
+
+//! \endcond
+
+/*!
+ * \brief The result of a coroutine, which runs when it is awaited (or spawned)
+ *
+ * Awaiting the task returns the value returned by the coroutine, or rethrows the
+ * exception which escaped it.
+ */
+template<class T>
+class Task
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+    Task & operator=(Task &&other) noexcept
+    {
+        if(this != &other)
+        {
+            if(handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task & operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        if(handle_) handle_.destroy();
+    }
+
+    bool await_ready() const noexcept {return !handle_ || handle_.done();}
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+
+    T await_resume() {return handle_.promise().result();}
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+//! \cond HIDDEN_SYMBOLS
+
+template<class T>
+Task<T> detail::TaskPromise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T> >::from_promise(*this));
+}
+
+inline Task<void> detail::TaskPromise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void> >::from_promise(*this));
+}
+
+namespace detail
+{
+
+inline Detached runDetached(Task<void> task, std::function<void(std::exception_ptr)> error)
+{
+    try
+    {
+        co_await task;
+    }
+    catch(...)
+    {
+        if(!error) throw;
+        error(std::current_exception());
+    }
+}
+
+} // namespace detail
+
+//! \endcond
+
+/*!
+ * \brief Start a task, which runs until its first suspension and is then resumed by the node
+ *
+ * The task frees itself when it completes. An exception escaping it is passed to error,
+ * or terminates the program if error is empty (as for a std::thread).
+ */
+inline void spawn(Task<void> task, std::function<void(std::exception_ptr)> error = {})
+{
+    detail::runDetached(std::move(task), std::move(error));
+}
+
+/*!
+ * \brief Awaitable of a service call, see call()
+ */
+template<class TRep, class TReq>
+class CallAwaiter
+{
+public:
+    CallAwaiter(ServiceClient &client, const TReq &req) : client_(client), req_(req) {}
+
+    bool await_ready() const noexcept {return false;}
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        // the request is written now: req_ is still alive, being part of the co_await expression
+        client_.template callAsync<TRep>(req_,
+            [this, h](TRep &rep) {rep_.emplace(std::move(rep)); h.resume();},
+            [this, h](std::exception_ptr ex) {exception_ = ex; h.resume();});
+    }
+
+    TRep await_resume()
+    {
+        if(exception_) std::rethrow_exception(exception_);
+        return std::move(*rep_);
+    }
+
+private:
+    ServiceClient &client_;
+    const TReq &req_;
+    std::optional<TRep> rep_;
+    std::exception_ptr exception_;
+};
+
+/*!
+ * \brief Call a service without blocking: `TRep rep = co_await call<TRep>(client, req);`
+ *
+ * The request is written with ServiceClient::callAsync(), and the coroutine is resumed when
+ * the reply is read by the client's spinOnce(). A reply which cannot be parsed, or the deadline
+ * of the call passing (see ServiceClient::setCallDeadline()), throws from the co_await.
+ */
+template<class TRep, class TReq>
+CallAwaiter<TRep, TReq> call(ServiceClient &client, const TReq &req)
+{
+    return CallAwaiter<TRep, TReq>(client, req);
+}
+
+/*!
+ * \brief A subscriber whose messages are awaited: `TMsg msg = co_await sub.next();`
+ *
+ * The messages arriving while no coroutine awaits are queued (the oldest ones are dropped
+ * beyond max_queue_size, if not 0). Only one coroutine at a time can await next().
+ * The object must not be moved, since the callback of the subscriber refers to it.
+ */
+template<class TMsg>
+class Subscriber
+{
+public:
+    class NextAwaiter
+    {
+    public:
+        explicit NextAwaiter(Subscriber &sub) : sub_(sub) {}
+
+        bool await_ready() const noexcept {return !sub_.queue_.empty();}
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            if(sub_.waiting_)
+                throw exception::Exception("b0::coro::Subscriber: next() is already awaited");
+            sub_.waiting_ = h;
+        }
+
+        TMsg await_resume()
+        {
+            TMsg msg = std::move(sub_.queue_.front());
+            sub_.queue_.pop_front();
+            return msg;
+        }
+
+    private:
+        Subscriber &sub_;
+    };
+
+    //! Construct the subscriber, child of the node (see b0::Subscriber)
+    Subscriber(Node *node, const std::string &topic_name, size_t max_queue_size = 0, bool managed = true, bool notify_graph = true)
+        : sub_(node, topic_name, b0::Subscriber::CallbackMsg<TMsg>([this](const TMsg &msg) {onMessage(msg);}), managed, notify_graph),
+          max_queue_size_(max_queue_size)
+    {
+    }
+
+    Subscriber(const Subscriber &) = delete;
+    Subscriber & operator=(const Subscriber &) = delete;
+
+    //! Return an awaitable of the next message
+    NextAwaiter next() {return NextAwaiter(*this);}
+
+    //! Return the number of messages received and not awaited yet
+    size_t getQueueSize() const {return queue_.size();}
+
+    //! Return the underlying subscriber, e.g. to set its options
+    b0::Subscriber & getSubscriber() {return sub_;}
+
+private:
+    void onMessage(const TMsg &msg)
+    {
+        queue_.push_back(msg);
+        if(max_queue_size_ && queue_.size() > max_queue_size_)
+            queue_.pop_front();
+        if(waiting_)
+            std::exchange(waiting_, {}).resume();
+    }
+
+    b0::Subscriber sub_;
+    size_t max_queue_size_;
+    std::deque<TMsg> queue_;
+    std::coroutine_handle<> waiting_;
+};
+
+} // namespace coro
+
+} // namespace b0
+
+#endif // B0_HAVE_COROUTINES
+
+#endif // B0__COROUTINE_H__INCLUDED
@@ -0,0 +1,29 @@
+#ifndef B0__EXCEPTION__DEADLINE_EXCEEDED_H__INCLUDED
+#define B0__EXCEPTION__DEADLINE_EXCEEDED_H__INCLUDED
+
+#include <b0/b0.h>
+#include <b0/exception/exception.h>
+
+namespace b0
+{
+
+namespace exception
+{
+
+/*!
+ * \brief An exception thrown when a service call has not been answered before its deadline
+ */
+class DeadlineExceeded : public Exception
+{
+public:
+    /*!
+     * \brief Construct a DeadlineExceeded exception
+     */
+    DeadlineExceeded(std::string name = "");
+};
+
+} // namespace exception
+
+} // namespace b0
+
+#endif // B0__EXCEPTION__DEADLINE_EXCEEDED_H__INCLUDED
@@ -70,6 +70,18 @@ public:
     EnvelopeDecodeError();
 };
 
+/*!
+ * \brief An exception thrown when the payload of a part does not match its checksum
+ */
+class ChecksumMismatch : public MessageUnpackError
+{
+public:
+    /*!
+     * \brief Construct a ChecksumMismatch exception
+     */
+    ChecksumMismatch(std::string part);
+};
+
 /*!
  * \brief An exception thrown when reading from socket fails
  */
@@ -0,0 +1,31 @@
+#ifndef B0__EXCEPTION__SERVER_BUSY_H__INCLUDED
+#define B0__EXCEPTION__SERVER_BUSY_H__INCLUDED
+
+#include <b0/b0.h>
+#include <b0/exception/exception.h>
+
+namespace b0
+{
+
+namespace exception
+{
+
+/*!
+ * \brief An exception thrown when a service server rejects a call because it is overloaded
+ *
+ * The request has not been served, so it can be sent again later, or to another server.
+ */
+class ServerBusy : public Exception
+{
+public:
+    /*!
+     * \brief Construct a ServerBusy exception
+     */
+    ServerBusy(std::string name = "");
+};
+
+} // namespace exception
+
+} // namespace b0
+
+#endif // B0__EXCEPTION__SERVER_BUSY_H__INCLUDED
@@ -1,6 +1,8 @@
 #include <b0/exception/argument_error.h>
+#include <b0/exception/deadline_exceeded.h>
 #include <b0/exception/invalid_state_transition.h>
 #include <b0/exception/message_pack_error.h>
 #include <b0/exception/message_unpack_error.h>
 #include <b0/exception/name_resolution_error.h>
+#include <b0/exception/server_busy.h>
 #include <b0/exception/unsupported_compression_algorithm.h>
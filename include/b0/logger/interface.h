@@ -25,12 +25,21 @@ public:
      */
     virtual void log(Level level, const std::string &message) const = 0;
 
+    /*!
+     * \brief Return false if messages of the given level would be discarded
+     *
+     * This is checked before formatting a message.
+     */
+    virtual bool isLevelEnabled(Level level) const;
+
     /*!
      * \brief Log a message using a format string
      */
     template<typename... Arguments>
     void log(Level level, std::string const &fmt, Arguments&&... args) const
     {
+        if(!isLevelEnabled(level)) return;
+
         try
         {
             boost::format format(fmt);
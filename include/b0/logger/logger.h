@@ -4,8 +4,13 @@
 #include <b0/b0.h>
 #include <b0/logger/interface.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <sstream>
+#include <vector>
 #include <boost/thread.hpp>
 #include <boost/format.hpp>
 
@@ -13,6 +18,7 @@ namespace b0
 {
 
 class Node;
+class ProcessAgent;
 
 namespace logger
 {
@@ -36,12 +42,32 @@ public:
      */
     virtual void log(Level level, const std::string &message) const override;
 
+    /*!
+     * Return true if the level is not below the console log level
+     */
+    virtual bool isLevelEnabled(Level level) const override;
+
+    /*!
+     * Set the console log level of this logger (initially b0::getConsoleLogLevel())
+     */
+    virtual void setOutputLevel(Level level);
+
+    /*!
+     * Return the console log level of this logger
+     */
+    Level getOutputLevel() const;
+
 protected:
+    /*!
+     * Print a message with the given timestamp to the console
+     */
+    void print(Level level, const std::string &message, std::chrono::system_clock::time_point time) const;
+
     //! The node
     b0::Node *node_;
 
     //! The output log level.
-    Level outputLevel_;
+    std::atomic<Level> outputLevel_;
 
     //! Flag to indicate if terminal supports ANSI escapes sequences for text color
     bool color_;
@@ -79,18 +105,94 @@ public:
      */
     void connect(const std::string &addr);
 
+    /*!
+     * Publish the log entries through the agent of the process, instead of a socket of this logger
+     *
+     * \sa b0::setProcessAgent()
+     */
+    void connect(std::shared_ptr<ProcessAgent> agent);
+
     void log(Level level, const std::string &message) const override;
 
+    /*!
+     * Return true if the level is not below the console or the remote log level
+     */
+    bool isLevelEnabled(Level level) const override;
+
+    void setOutputLevel(Level level) override;
+
+    /*!
+     * Set the remote log level of this logger (initially b0::getRemoteLogLevel())
+     */
+    void setRemoteOutputLevel(Level level);
+
+    /*!
+     * Return the remote log level of this logger
+     */
+    Level getRemoteOutputLevel() const;
+
+    /*!
+     * Return the number of messages dropped because the asynchronous logging queue was full
+     *
+     * \sa b0::setAsyncLogging()
+     */
+    uint64_t getDroppedCount() const;
+
+    /*!
+     * Send the log entries waiting to be sent in a batch
+     *
+     * If the B0_LOG_BATCH_SIZE env var is greater than 1, entries sent to the `log` topic are
+     * grouped in a b0::message::log::LogEntryBatch message, which is sent when it contains
+     * B0_LOG_BATCH_SIZE entries, or when its oldest entry is older than B0_LOG_BATCH_INTERVAL
+     * milliseconds (default 100).
+     */
+    void flush() const;
+
+    /*!
+     * Send the log entries waiting to be sent in a batch, if the oldest is older than B0_LOG_BATCH_INTERVAL
+     *
+     * This is called periodically by the node, in Node::spinOnce().
+     */
+    void flushIfDue() const;
+
 protected:
+    //! The remote output log level
+    std::atomic<Level> remoteOutputLevel_;
+
+    //! The lowest of the console and remote output log levels
+    std::atomic<Level> minOutputLevel_;
+
     /*!
      * Log a message to the remote logger (i.e. using the log publisher)
      */
     virtual void remoteLog(Level level, const std::string &message) const;
 
+    /*!
+     * Log a message with the given timestamp to the remote logger
+     */
+    void remoteLog(Level level, const std::string &message, int64_t time_usec) const;
+
 private:
+    /*!
+     * Code of the background thread of the asynchronous logging mode
+     */
+    void asyncLoop() const;
+
     mutable std::unique_ptr<Private> private_;
 };
 
+/*!
+ * \brief Return the subtopic of the `log` topic of the entries of a level and a node (see b0::setHierarchicalLogTopics())
+ */
+std::string logSubtopic(Level level, const std::string &node_name);
+
+/*!
+ * \brief Return the subtopic filters selecting the log entries of min_level and above (see b0::Subscriber::setSubtopicFilters())
+ *
+ * If node_names is not empty, only the entries of the nodes whose name starts with one of them are selected.
+ */
+std::vector<std::string> logSubtopicFilters(Level min_level, const std::vector<std::string> &node_names = {});
+
 } // namespace logger
 
 } // namespace b0
@@ -0,0 +1,70 @@
+#ifndef B0__MESSAGE__CONTENT_TYPE_IDS_H__INCLUDED
+#define B0__MESSAGE__CONTENT_TYPE_IDS_H__INCLUDED
+
+#include <cstdint>
+#include <string>
+
+#include <boost/function.hpp>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+/*!
+ * \brief Register the integer id of a content type
+ *
+ * The ids are assigned by the resolver (see b0::message::resolv::ContentTypeIdRequest), and
+ * let EnvelopeFormat::BinaryIds envelopes carry a content type in two bytes instead of its
+ * name. An id is meant to be immutable for the lifetime of the resolver.
+ */
+void addContentTypeId(const std::string &content_type, int64_t id);
+
+/*!
+ * \brief Return the id of the given content type
+ *
+ * If the content type has no id registered with addContentTypeId(), the content type id
+ * providers are asked for one (see addContentTypeIdProvider()), and the result is registered.
+ *
+ * \return false if the content type has no id
+ */
+bool getContentTypeId(const std::string &content_type, int64_t &id);
+
+/*!
+ * \brief Return the content type of the given id
+ *
+ * As with getContentTypeId(), unknown ids are asked to the providers.
+ *
+ * \return false if the id is not known
+ */
+bool getContentType(int64_t id, std::string &content_type);
+
+/*!
+ * \brief Alias for content type id provider function
+ *
+ * If the content type is not empty, the provider returns its id (assigning one if needed),
+ * otherwise it returns the content type of the id.
+ */
+using ContentTypeIdProvider = boost::function<bool(std::string&, int64_t&)>;
+
+/*!
+ * \brief Add a function to ask for the content type ids which are not registered yet
+ *
+ * b0::Node installs a provider which gets the ids from the resolver.
+ * The key identifies the provider, for removeContentTypeIdProvider().
+ */
+void addContentTypeIdProvider(const void *key, ContentTypeIdProvider provider);
+
+/*!
+ * \brief Remove a provider added with addContentTypeIdProvider()
+ */
+void removeContentTypeIdProvider(const void *key);
+
+} // namespace message
+
+} // namespace b0
+
+#endif // B0__MESSAGE__CONTENT_TYPE_IDS_H__INCLUDED
@@ -1,6 +1,8 @@
 #ifndef B0__MESSAGE__GRAPH__GET_GRAPH_REQUEST_H__INCLUDED
 #define B0__MESSAGE__GRAPH__GET_GRAPH_REQUEST_H__INCLUDED
 
+#include <string>
+
 #include <b0/b0.h>
 #include <b0/message/message.h>
 
@@ -14,7 +16,13 @@ namespace graph
 {
 
 /*!
- * \brief Sent by node to resolver, for getting the full graph
+ * \brief Sent by node to resolver, for getting the full graph, or a part of it
+ *
+ * The filters select a part of the graph: the links of the nodes matching node_name, to
+ * the topics matching topic_name and to the services matching service_name, of the type
+ * link_type, and the nodes of those links. The patterns are names where a `*` matches any
+ * sequence of characters; an empty pattern matches all. A topic pattern without a service
+ * pattern selects only topic links, and vice versa. Without filters, the whole graph is sent.
  *
  * \mscfile graph-get.msc
  *
@@ -23,9 +31,69 @@ namespace graph
 class GetGraphRequest : public Message
 {
 public:
+    //! If not negative, the version of the graph the node already has: the graph is not sent again unless its version differs
+    int64_t if_newer_than_version{-1};
+
+    //! If not empty, the pattern of the names of the nodes
+    std::string node_name;
+
+    //! If not empty, the pattern of the names of the topics
+    std::string topic_name;
+
+    //! If not empty, the pattern of the names of the services
+    std::string service_name;
+
+    //! If not empty, the type of the links: "topic", "service", "publishes", "subscribes", "offers" or "uses"
+    std::string link_type;
+
+    //! Return true if a filter is set
+    bool filtered() const {return !node_name.empty() || !topic_name.empty() || !service_name.empty() || !link_type.empty();}
+
+    //! Return true if the name matches the pattern (see above)
+    static bool matches(const std::string &pattern, const std::string &name)
+    {
+        if(pattern.empty()) return true;
+        // greedy match of the pieces between the '*', the last one anchored at the end
+        size_t p = 0, n = 0, star = std::string::npos, mark = 0;
+        while(n < name.size())
+        {
+            if(p < pattern.size() && pattern[p] == '*')
+            {
+                star = p++;
+                mark = n;
+            }
+            else if(p < pattern.size() && pattern[p] == name[n])
+            {
+                p++;
+                n++;
+            }
+            else if(star != std::string::npos)
+            {
+                p = star + 1;
+                n = ++mark;
+            }
+            else return false;
+        }
+        while(p < pattern.size() && pattern[p] == '*') p++;
+        return p == pattern.size();
+    }
+
+    //! Return true if the topic (or service) links are selected, on the publisher (or server) side unless reversed
+    bool selects(bool topic, bool reversed) const
+    {
+        if(topic ? (topic_name.empty() && !service_name.empty()) : (service_name.empty() && !topic_name.empty()))
+            return false;
+        if(link_type.empty()) return true;
+        if(topic)
+            return link_type == "topic" || link_type == (reversed ? "subscribes" : "publishes");
+        else
+            return link_type == "service" || link_type == (reversed ? "uses" : "offers");
+    }
 
 public:
-    std::string type() const override {return "b0.message.graph.GetGraphRequest";}
+    static constexpr const char *b0_type = "b0.message.graph.GetGraphRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace graph
@@ -47,9 +115,20 @@ using b0::message::graph::GetGraphRequest;
 template <>
 struct default_codec_t<GetGraphRequest>
 {
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.optional("if_newer_than_version", &GetGraphRequest::if_newer_than_version);
+        codec.optional("node_name", &GetGraphRequest::node_name);
+        codec.optional("topic_name", &GetGraphRequest::topic_name);
+        codec.optional("service_name", &GetGraphRequest::service_name);
+        codec.optional("link_type", &GetGraphRequest::link_type);
+    }
+
     static codec::object_t<GetGraphRequest> codec()
     {
         auto codec = codec::object<GetGraphRequest>();
+        describe(codec);
         return codec;
     }
 };
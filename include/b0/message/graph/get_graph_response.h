@@ -24,11 +24,16 @@ namespace graph
 class GetGraphResponse : public Message
 {
 public:
-    //! The graph of the network
+    //! The graph of the network (only its version if not_modified)
     Graph graph;
 
+    //! True if the version of the graph is the one of the request (see GetGraphRequest::if_newer_than_version)
+    bool not_modified{false};
+
 public:
-    std::string type() const override {return "b0.message.graph.GetGraphResponse";}
+    static constexpr const char *b0_type = "b0.message.graph.GetGraphResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace graph
@@ -50,10 +55,17 @@ using b0::message::graph::GetGraphResponse;
 template <>
 struct default_codec_t<GetGraphResponse>
 {
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("graph", &GetGraphResponse::graph);
+        codec.optional("not_modified", &GetGraphResponse::not_modified);
+    }
+
     static codec::object_t<GetGraphResponse> codec()
     {
         auto codec = codec::object<GetGraphResponse>();
-        codec.required("graph", &GetGraphResponse::graph);
+        describe(codec);
         return codec;
     }
 };
@@ -35,8 +35,13 @@ public:
     //! List of service links
     std::vector<GraphLink> node_service;
 
+    //! Version of the graph (see GraphDelta), 0 if unknown
+    int64_t version{0};
+
 public:
-    std::string type() const override {return "b0.message.graph.Graph";}
+    static constexpr const char *b0_type = "b0.message.graph.Graph";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace graph
@@ -58,12 +63,19 @@ using b0::message::graph::Graph;
 template <>
 struct default_codec_t<Graph>
 {
-    static codec::object_t<Graph> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<Graph>();
         codec.required("nodes", &Graph::nodes);
         codec.required("node_topic", &Graph::node_topic);
         codec.required("node_service", &Graph::node_service);
+        codec.optional("version", &Graph::version);
+    }
+
+    static codec::object_t<Graph> codec()
+    {
+        auto codec = codec::object<Graph>();
+        describe(codec);
         return codec;
     }
 };
@@ -0,0 +1,105 @@
+#ifndef B0__MESSAGE__GRAPH__GRAPH_DELTA_H__INCLUDED
+#define B0__MESSAGE__GRAPH__GRAPH_DELTA_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/graph/graph_node.h>
+#include <b0/message/graph/graph_link.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace graph
+{
+
+/*!
+ * \brief The changes to the graph of the network since the previous version
+ *
+ * Published by the resolver on the "graph_delta" topic. The versions are consecutive:
+ * if a version is missed, the subscriber should get a new snapshot of
+ * the graph (b0::message::graph::GetGraphRequest) and apply the later deltas on it.
+ *
+ * \sa Graph, b0::graph::GraphTracker, \ref protocol, \ref graph
+ */
+class GraphDelta : public Message
+{
+public:
+    //! The version of the graph after applying this delta
+    int64_t version;
+
+    //! Nodes which have joined the network
+    std::vector<GraphNode> nodes_added;
+
+    //! Names of the nodes which have left the network
+    std::vector<std::string> nodes_removed;
+
+    //! New topic links
+    std::vector<GraphLink> node_topic_added;
+
+    //! Removed topic links
+    std::vector<GraphLink> node_topic_removed;
+
+    //! New service links
+    std::vector<GraphLink> node_service_added;
+
+    //! Removed service links
+    std::vector<GraphLink> node_service_removed;
+
+public:
+    static constexpr const char *b0_type = "b0.message.graph.GraphDelta";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace graph
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::graph::GraphDelta;
+
+template <>
+struct default_codec_t<GraphDelta>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("version", &GraphDelta::version);
+        codec.optional("nodes_added", &GraphDelta::nodes_added);
+        codec.optional("nodes_removed", &GraphDelta::nodes_removed);
+        codec.optional("node_topic_added", &GraphDelta::node_topic_added);
+        codec.optional("node_topic_removed", &GraphDelta::node_topic_removed);
+        codec.optional("node_service_added", &GraphDelta::node_service_added);
+        codec.optional("node_service_removed", &GraphDelta::node_service_removed);
+    }
+
+    static codec::object_t<GraphDelta> codec()
+    {
+        auto codec = codec::object<GraphDelta>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__GRAPH__GRAPH_DELTA_H__INCLUDED
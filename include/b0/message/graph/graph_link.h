@@ -33,7 +33,9 @@ public:
     bool reversed;
 
 public:
-    std::string type() const override {return "b0.message.graph.GraphLink";}
+    static constexpr const char *b0_type = "b0.message.graph.GraphLink";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace graph
@@ -55,12 +57,18 @@ using b0::message::graph::GraphLink;
 template <>
 struct default_codec_t<GraphLink>
 {
-    static codec::object_t<GraphLink> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<GraphLink>();
         codec.required("node_name", &GraphLink::node_name);
         codec.required("other_name", &GraphLink::other_name);
         codec.required("reversed", &GraphLink::reversed);
+    }
+
+    static codec::object_t<GraphLink> codec()
+    {
+        auto codec = codec::object<GraphLink>();
+        describe(codec);
         return codec;
     }
 };
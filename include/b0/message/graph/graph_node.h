@@ -1,10 +1,12 @@
 #ifndef B0__MESSAGE__GRAPH__GRAPH_NODE_H__INCLUDED
 #define B0__MESSAGE__GRAPH__GRAPH_NODE_H__INCLUDED
 
+#include <boost/optional.hpp>
 #include <boost/serialization/string.hpp>
 
 #include <b0/b0.h>
 #include <b0/message/message.h>
+#include <b0/message/graph/node_stats.h>
 
 namespace b0
 {
@@ -32,8 +34,13 @@ public:
     //! The name of the node
     std::string node_name;
 
+    //! The last resource usage reported by the node, if it reports it (see b0::setHeartbeatStats())
+    boost::optional<NodeStats> stats;
+
 public:
-    std::string type() const override {return "b0.message.graph.GraphNode";}
+    static constexpr const char *b0_type = "b0.message.graph.GraphNode";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace graph
@@ -55,12 +62,19 @@ using b0::message::graph::GraphNode;
 template <>
 struct default_codec_t<GraphNode>
 {
-    static codec::object_t<GraphNode> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<GraphNode>();
         codec.required("host_id", &GraphNode::host_id);
         codec.required("process_id", &GraphNode::process_id);
         codec.required("node_name", &GraphNode::node_name);
+        codec.optional("stats", &GraphNode::stats);
+    }
+
+    static codec::object_t<GraphNode> codec()
+    {
+        auto codec = codec::object<GraphNode>();
+        describe(codec);
         return codec;
     }
 };
@@ -38,7 +38,9 @@ public:
     bool active;
 
 public:
-    std::string type() const override {return "b0.message.graph.NodeServiceRequest";}
+    static constexpr const char *b0_type = "b0.message.graph.NodeServiceRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace graph
@@ -60,13 +62,19 @@ using b0::message::graph::NodeServiceRequest;
 template <>
 struct default_codec_t<NodeServiceRequest>
 {
-    static codec::object_t<NodeServiceRequest> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<NodeServiceRequest>();
         codec.required("node_name", &NodeServiceRequest::node_name);
         codec.required("service_name", &NodeServiceRequest::service_name);
         codec.required("reverse", &NodeServiceRequest::reverse);
         codec.required("active", &NodeServiceRequest::active);
+    }
+
+    static codec::object_t<NodeServiceRequest> codec()
+    {
+        auto codec = codec::object<NodeServiceRequest>();
+        describe(codec);
         return codec;
     }
 };
@@ -25,7 +25,9 @@ class NodeServiceResponse : public Message
 public:
 
 public:
-    std::string type() const override {return "b0.message.graph.NodeServiceResponse";}
+    static constexpr const char *b0_type = "b0.message.graph.NodeServiceResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace graph
@@ -47,9 +49,15 @@ using b0::message::graph::NodeServiceResponse;
 template <>
 struct default_codec_t<NodeServiceResponse>
 {
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+    }
+
     static codec::object_t<NodeServiceResponse> codec()
     {
         auto codec = codec::object<NodeServiceResponse>();
+        describe(codec);
         return codec;
     }
 };
@@ -0,0 +1,101 @@
+#ifndef B0__MESSAGE__GRAPH__NODE_STATS_H__INCLUDED
+#define B0__MESSAGE__GRAPH__NODE_STATS_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace graph
+{
+
+/*!
+ * \brief Resource usage of a node, reported in its heartbeats
+ *
+ * The CPU and memory figures are those of the whole process containing the node.
+ * The rates are averaged over the time since the previous report.
+ *
+ * \sa GraphNode::stats, b0::setHeartbeatStats(), \ref protocol, \ref graph
+ */
+class NodeStats : public Message
+{
+public:
+    //! The name of the node
+    std::string node_name;
+
+    //! CPU time (user and system) used by the process so far (in microseconds)
+    int64_t cpu_time_usec{0};
+
+    //! CPU usage of the process (1.0 = one CPU fully used)
+    double cpu_usage{0};
+
+    //! Resident set size of the process (in bytes, 0 if unknown)
+    int64_t rss{0};
+
+    //! Messages sent per second, by all the sockets of the node
+    double messages_sent_rate{0};
+
+    //! Messages received per second, by all the sockets of the node
+    double messages_received_rate{0};
+
+    //! Number of iterations of spin() which overran the period (see b0::Node::getSpinCounters())
+    uint64_t spin_overruns{0};
+
+public:
+    static constexpr const char *b0_type = "b0.message.graph.NodeStats";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace graph
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::graph::NodeStats;
+
+template <>
+struct default_codec_t<NodeStats>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("node_name", &NodeStats::node_name);
+        codec.required("cpu_time_usec", &NodeStats::cpu_time_usec);
+        codec.required("cpu_usage", &NodeStats::cpu_usage);
+        codec.required("rss", &NodeStats::rss);
+        codec.required("messages_sent_rate", &NodeStats::messages_sent_rate);
+        codec.required("messages_received_rate", &NodeStats::messages_received_rate);
+        codec.required("spin_overruns", &NodeStats::spin_overruns);
+    }
+
+    static codec::object_t<NodeStats> codec()
+    {
+        auto codec = codec::object<NodeStats>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__GRAPH__NODE_STATS_H__INCLUDED
@@ -38,7 +38,9 @@ public:
     bool active;
 
 public:
-    std::string type() const override {return "b0.message.graph.NodeTopicRequest";}
+    static constexpr const char *b0_type = "b0.message.graph.NodeTopicRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace graph
@@ -60,13 +62,19 @@ using b0::message::graph::NodeTopicRequest;
 template <>
 struct default_codec_t<NodeTopicRequest>
 {
-    static codec::object_t<NodeTopicRequest> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<NodeTopicRequest>();
         codec.required("node_name", &NodeTopicRequest::node_name);
         codec.required("topic_name", &NodeTopicRequest::topic_name);
         codec.required("reverse", &NodeTopicRequest::reverse);
         codec.required("active", &NodeTopicRequest::active);
+    }
+
+    static codec::object_t<NodeTopicRequest> codec()
+    {
+        auto codec = codec::object<NodeTopicRequest>();
+        describe(codec);
         return codec;
     }
 };
@@ -25,7 +25,9 @@ class NodeTopicResponse : public Message
 public:
 
 public:
-    std::string type() const override {return "b0.message.graph.NodeTopicResponse";}
+    static constexpr const char *b0_type = "b0.message.graph.NodeTopicResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace graph
@@ -47,9 +49,15 @@ using b0::message::graph::NodeTopicResponse;
 template <>
 struct default_codec_t<NodeTopicResponse>
 {
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+    }
+
     static codec::object_t<NodeTopicResponse> codec()
     {
         auto codec = codec::object<NodeTopicResponse>();
+        describe(codec);
         return codec;
     }
 };
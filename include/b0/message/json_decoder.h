@@ -0,0 +1,502 @@
+#ifndef B0__MESSAGE__JSON_DECODER_H__INCLUDED
+#define B0__MESSAGE__JSON_DECODER_H__INCLUDED
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <spotify/json.hpp>
+
+#include <b0/b0.h>
+#include <b0/exception/message_unpack_error.h>
+#include <b0/message/msgpack.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+/*!
+ * \brief Decoding of JSON messages in place, in one pass over the received buffer
+ *
+ * The fields are decoded from the same field descriptions used by the MessagePack codec
+ * (see b0::message::msgpack), straight into the message: the keys are compared with the
+ * field names without building strings, the strings without escapes are assigned from the
+ * buffer, the values of unknown fields are skipped without being decoded, and the strings
+ * and vectors of the message keep their capacity (see b0::message::reset()).
+ *
+ * This is used by b0::message::parse() for the message types which have a describe() method
+ * (see b0::setInPlaceJSONDecoding()); a payload it rejects is handed to the spotify::json
+ * codec, so that any payload accepted by the codec is still accepted. The decoder itself is
+ * more lenient: e.g. null is accepted for an optional field, and control characters in strings.
+ */
+namespace json_decoder
+{
+
+//! \cond HIDDEN_SYMBOLS
+
+//! Reads JSON values from a buffer
+class Reader
+{
+public:
+    Reader(const char *data, size_t size) : p_(data), end_(data + size) {}
+
+    bool atEnd() {skipSpace(); return p_ == end_;}
+
+    char peek() {skipSpace(); need(1); return *p_;}
+
+    //! Consume the given character if it is the next one
+    bool consume(char c)
+    {
+        if(peek() != c) return false;
+        p_++;
+        return true;
+    }
+
+    void expect(char c) {if(!consume(c)) error();}
+
+    bool isNull() {return peek() == 'n';}
+
+    void null() {literal("null");}
+
+    bool boolean()
+    {
+        if(peek() == 't') {literal("true"); return true;}
+        literal("false");
+        return false;
+    }
+
+    int64_t integer()
+    {
+        bool negative = consume('-');
+        uint64_t v = digits();
+        if(negative)
+        {
+            if(v > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1) error();
+            return static_cast<int64_t>(0 - v);
+        }
+        if(v > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) error();
+        return static_cast<int64_t>(v);
+    }
+
+    uint64_t uinteger()
+    {
+        if(peek() == '-') error();
+        return digits();
+    }
+
+    double real()
+    {
+        skipSpace();
+        const char *begin = p_;
+        bool negative = p_ != end_ && *p_ == '-';
+        if(negative) p_++;
+        // the mantissa and exponent, for the exact conversion of the short numbers:
+        uint64_t mantissa = 0;
+        int num_digits = 0, exponent = 0;
+        const char *int_begin = p_;
+        for(; p_ != end_ && isDigit(*p_); p_++, num_digits++)
+            mantissa = mantissa * 10 + (*p_ - '0');
+        if(p_ == int_begin || (*int_begin == '0' && p_ - int_begin > 1)) error();
+        if(p_ != end_ && *p_ == '.')
+        {
+            const char *frac_begin = ++p_;
+            for(; p_ != end_ && isDigit(*p_); p_++, num_digits++, exponent--)
+                mantissa = mantissa * 10 + (*p_ - '0');
+            if(p_ == frac_begin) error();
+        }
+        if(p_ != end_ && (*p_ == 'e' || *p_ == 'E'))
+        {
+            p_++;
+            bool exp_negative = p_ != end_ && *p_ == '-';
+            if(p_ != end_ && (*p_ == '-' || *p_ == '+')) p_++;
+            const char *exp_begin = p_;
+            int e = 0;
+            for(; p_ != end_ && isDigit(*p_); p_++)
+                if(e < 10000) e = e * 10 + (*p_ - '0');
+            if(p_ == exp_begin) error();
+            exponent += exp_negative ? -e : e;
+        }
+        // an integer below 2^53 and a power of ten up to 1e22 are exact doubles, so a single
+        // multiplication or division is correctly rounded; the other numbers go through the stream
+        static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        if(num_digits <= 15 && exponent >= -22 && exponent <= 22)
+        {
+            double v = static_cast<double>(mantissa);
+            v = exponent < 0 ? v / powers[-exponent] : v * powers[exponent];
+            return negative ? -v : v;
+        }
+        std::istringstream ss(std::string(begin, p_));
+        ss.imbue(std::locale::classic());
+        double v;
+        if(!(ss >> v)) error();
+        return v;
+    }
+
+    /*!
+     * Read a string: the returned reference points into the buffer if the string has no
+     * escapes, otherwise into scratch, where it is unescaped.
+     */
+    boost::string_ref stringRef(std::string &scratch)
+    {
+        expect('"');
+        const char *begin = p_;
+        const char *quote = static_cast<const char*>(std::memchr(p_, '"', end_ - p_));
+        if(!quote) error();
+        const char *backslash = static_cast<const char*>(std::memchr(begin, '\\', quote - begin));
+        if(!backslash)
+        {
+            p_ = quote + 1;
+            return boost::string_ref(begin, quote - begin);
+        }
+        scratch.assign(begin, backslash);
+        p_ = backslash;
+        while(true)
+        {
+            need(1);
+            char c = *p_++;
+            if(c == '"') break;
+            if(c != '\\')
+            {
+                scratch.push_back(c);
+                continue;
+            }
+            need(1);
+            switch(*p_++)
+            {
+            case '"': scratch.push_back('"'); break;
+            case '\\': scratch.push_back('\\'); break;
+            case '/': scratch.push_back('/'); break;
+            case 'b': scratch.push_back('\b'); break;
+            case 'f': scratch.push_back('\f'); break;
+            case 'n': scratch.push_back('\n'); break;
+            case 'r': scratch.push_back('\r'); break;
+            case 't': scratch.push_back('\t'); break;
+            case 'u': unicode(scratch); break;
+            default: error();
+            }
+        }
+        return boost::string_ref(scratch);
+    }
+
+    void string(std::string &v)
+    {
+        std::string scratch;
+        boost::string_ref s = stringRef(scratch);
+        if(s.data() == scratch.data()) v.swap(scratch);
+        else v.assign(s.data(), s.size());
+    }
+
+    //! Skip a value of any type (e.g. the value of an unknown field)
+    void skip(int depth = 0)
+    {
+        if(depth > 64) error();
+        switch(peek())
+        {
+        case '"':
+            skipString();
+            return;
+        case '{':
+            p_++;
+            if(consume('}')) return;
+            do
+            {
+                skipSpace();
+                if(p_ == end_ || *p_ != '"') error();
+                skipString();
+                expect(':');
+                skip(depth + 1);
+            }
+            while(consume(','));
+            expect('}');
+            return;
+        case '[':
+            p_++;
+            if(consume(']')) return;
+            do skip(depth + 1);
+            while(consume(','));
+            expect(']');
+            return;
+        case 't': literal("true"); return;
+        case 'f': literal("false"); return;
+        case 'n': literal("null"); return;
+        }
+        real();
+    }
+
+    [[noreturn]] static void error()
+    {
+        throw exception::MessageUnpackError("json parse error");
+    }
+
+private:
+    static bool isDigit(char c) {return c >= '0' && c <= '9';}
+
+    void need(size_t n) const {if(n > static_cast<size_t>(end_ - p_)) error();}
+
+    void skipSpace()
+    {
+        while(p_ != end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) p_++;
+    }
+
+    void literal(const char *s)
+    {
+        size_t n = std::strlen(s);
+        skipSpace();
+        need(n);
+        if(std::memcmp(p_, s, n) != 0) error();
+        p_ += n;
+    }
+
+    uint64_t digits()
+    {
+        skipSpace();
+        const char *begin = p_;
+        uint64_t v = 0;
+        for(; p_ != end_ && isDigit(*p_); p_++)
+        {
+            uint64_t d = *p_ - '0';
+            if(v > (std::numeric_limits<uint64_t>::max() - d) / 10) error();
+            v = v * 10 + d;
+        }
+        if(p_ == begin || (*begin == '0' && p_ - begin > 1)) error();
+        // an integer field does not accept a fraction or an exponent
+        if(p_ != end_ && (*p_ == '.' || *p_ == 'e' || *p_ == 'E')) error();
+        return v;
+    }
+
+    unsigned hex4()
+    {
+        need(4);
+        unsigned v = 0;
+        for(int i = 0; i < 4; i++)
+        {
+            char c = *p_++;
+            v <<= 4;
+            if(c >= '0' && c <= '9') v |= c - '0';
+            else if(c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+            else if(c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+            else error();
+        }
+        return v;
+    }
+
+    //! Append the UTF-8 encoding of a \\u escape (and of the low surrogate following a high one)
+    void unicode(std::string &s)
+    {
+        unsigned cp = hex4();
+        if(cp >= 0xd800 && cp < 0xdc00)
+        {
+            need(2);
+            if(p_[0] != '\\' || p_[1] != 'u') error();
+            p_ += 2;
+            unsigned low = hex4();
+            if(low < 0xdc00 || low >= 0xe000) error();
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+        }
+        else if(cp >= 0xdc00 && cp < 0xe000) error();
+        if(cp < 0x80) s.push_back(static_cast<char>(cp));
+        else if(cp < 0x800)
+        {
+            s.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+        }
+        else if(cp < 0x10000)
+        {
+            s.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+        }
+        else
+        {
+            s.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+        }
+    }
+
+    //! Skip a string, finding the closing quote with memchr (a quote is escaped by an odd number of backslashes)
+    void skipString()
+    {
+        p_++;
+        while(true)
+        {
+            const char *quote = static_cast<const char*>(std::memchr(p_, '"', end_ - p_));
+            if(!quote) error();
+            const char *q = quote;
+            while(q != p_ && q[-1] == '\\') q--;
+            p_ = quote + 1;
+            if((quote - q) % 2 == 0) return;
+        }
+    }
+
+    const char *p_;
+    const char *end_;
+};
+
+// declared first, as messages can be nested in vectors and optionals
+template<typename T>
+typename std::enable_if<msgpack::has_describe<T>::value>::type decode(Reader &r, T &v);
+
+inline void decode(Reader &r, std::string &v) {r.string(v);}
+
+inline void decode(Reader &r, bool &v) {v = r.boolean();}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type decode(Reader &r, T &v)
+{
+    int64_t x = r.integer();
+    if(x < std::numeric_limits<T>::min() || x > std::numeric_limits<T>::max()) Reader::error();
+    v = static_cast<T>(x);
+}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value>::type decode(Reader &r, T &v)
+{
+    uint64_t x = r.uinteger();
+    if(x > std::numeric_limits<T>::max()) Reader::error();
+    v = static_cast<T>(x);
+}
+
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type decode(Reader &r, T &v) {v = static_cast<T>(r.real());}
+
+template<typename T>
+void decode(Reader &r, boost::optional<T> &v)
+{
+    if(r.isNull())
+    {
+        r.null();
+        v = boost::none;
+        return;
+    }
+    if(!v) v = T();
+    decode(r, *v);
+}
+
+template<typename T>
+void decode(Reader &r, std::vector<T> &v)
+{
+    r.expect('[');
+    // as with MessagePack, the elements already there are decoded in place
+    size_t n = 0;
+    if(!r.consume(']'))
+    {
+        do
+        {
+            if(n < v.size()) decode(r, v[n]);
+            else
+            {
+                v.emplace_back();
+                decode(r, v.back());
+            }
+            n++;
+        }
+        while(r.consume(','));
+        r.expect(']');
+    }
+    v.resize(n);
+}
+
+//! Decodes the value of the field with the given key (if any), and tracks the required fields seen
+template<typename T>
+struct FieldDecoder
+{
+    Reader *r;
+    T *obj;
+    boost::string_ref key;
+    bool found;
+    size_t index;
+    uint64_t required_seen;
+    uint64_t required_all;
+
+    template<typename N, typename M>
+    void required(const N &name, M T::*member)
+    {
+        uint64_t bit = index < 64 ? uint64_t(1) << index : 0;
+        index++;
+        required_all |= bit;
+        if(found || key != boost::string_ref(name)) return;
+        decode(*r, obj->*member);
+        found = true;
+        required_seen |= bit;
+    }
+
+    template<typename N, typename M>
+    void optional(const N &name, M T::*member)
+    {
+        index++;
+        if(found || key != boost::string_ref(name)) return;
+        decode(*r, obj->*member);
+        found = true;
+    }
+};
+
+template<typename T>
+typename std::enable_if<msgpack::has_describe<T>::value>::type decode(Reader &r, T &v)
+{
+    r.expect('{');
+    FieldDecoder<T> decoder{&r, &v, boost::string_ref(), false, 0, 0, 0};
+    // only the keys with escapes are copied
+    std::string scratch;
+    if(!r.consume('}'))
+    {
+        do
+        {
+            decoder.key = r.stringRef(scratch);
+            r.expect(':');
+            decoder.found = false;
+            decoder.index = 0;
+            spotify::json::default_codec_t<T>::describe(decoder);
+            if(!decoder.found) r.skip();
+        }
+        while(r.consume(','));
+        r.expect('}');
+    }
+    if(decoder.index == 0)
+    {
+        // the message has no fields, or the object was empty: still compute the set of required ones
+        decoder.key = boost::string_ref();
+        decoder.found = true;
+        spotify::json::default_codec_t<T>::describe(decoder);
+    }
+    if((decoder.required_seen & decoder.required_all) != decoder.required_all)
+        throw exception::MessageUnpackError("json parse error: missing required field");
+}
+
+//! \endcond
+
+/*!
+ * \brief Decode a JSON message in place
+ *
+ * The fields of msg are reset first (keeping the capacity of its strings and vectors), so
+ * the fields missing from the payload get their default value, as with spotify::json.
+ */
+template<typename T>
+void decode(T &msg, const char *data, size_t size)
+{
+    static const T proto{};
+    msgpack::FieldResetter<T> resetter{&msg, &proto};
+    spotify::json::default_codec_t<T>::describe(resetter);
+    Reader r(data, size);
+    decode(r, msg);
+    if(!r.atEnd())
+        Reader::error();
+}
+
+} // namespace json_decoder
+
+} // namespace message
+
+} // namespace b0
+
+#endif // B0__MESSAGE__JSON_DECODER_H__INCLUDED
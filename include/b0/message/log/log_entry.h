@@ -34,7 +34,9 @@ public:
     int64_t time_usec;
 
 public:
-    std::string type() const override {return "b0.message.log.LogEntry";}
+    static constexpr const char *b0_type = "b0.message.log.LogEntry";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace log
@@ -56,13 +58,19 @@ using b0::message::log::LogEntry;
 template <>
 struct default_codec_t<LogEntry>
 {
-    static codec::object_t<LogEntry> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<LogEntry>();
         codec.required("node_name", &LogEntry::node_name);
         codec.required("level", &LogEntry::level);
         codec.required("message", &LogEntry::message);
         codec.required("time_usec", &LogEntry::time_usec);
+    }
+
+    static codec::object_t<LogEntry> codec()
+    {
+        auto codec = codec::object<LogEntry>();
+        describe(codec);
         return codec;
     }
 };
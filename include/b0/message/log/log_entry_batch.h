@@ -0,0 +1,76 @@
+#ifndef B0__MESSAGE__LOG__LOG_ENTRY_BATCH_H__INCLUDED
+#define B0__MESSAGE__LOG__LOG_ENTRY_BATCH_H__INCLUDED
+
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/log/log_entry.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace log
+{
+
+/*!
+ * \brief A batch of log messages sent by node to the 'log' topic
+ *
+ * Sent in place of individual LogEntry messages when log batching is enabled
+ * (see the B0_LOG_BATCH_SIZE env var).
+ */
+class LogEntryBatch : public Message
+{
+public:
+    //! The log messages, in order
+    std::vector<LogEntry> entries;
+
+public:
+    static constexpr const char *b0_type = "b0.message.log.LogEntryBatch";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace log
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::log::LogEntryBatch;
+
+template <>
+struct default_codec_t<LogEntryBatch>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("entries", &LogEntryBatch::entries);
+    }
+
+    static codec::object_t<LogEntryBatch> codec()
+    {
+        auto codec = codec::object<LogEntryBatch>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__LOG__LOG_ENTRY_BATCH_H__INCLUDED
@@ -2,12 +2,20 @@
 #define B0__MESSAGE__MESSAGE_H__INCLUDED
 
 #include <string>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
 #include <boost/format.hpp>
+#include <boost/utility/string_ref.hpp>
 #include <spotify/json.hpp>
 #include <spotify/json/codec/boost.hpp>
 
 #include <b0/b0.h>
 #include <b0/exception/message_unpack_error.h>
+#include <b0/message/message_part.h>
+#include <b0/message/msgpack.h>
+#include <b0/message/json_decoder.h>
 
 namespace b0
 {
@@ -31,25 +39,213 @@ public:
 };
 
 /*!
- * \brief Parse a message from a string
+ * \brief FNV-1a hash of a message type name, computed at compile time
+ */
+constexpr uint64_t typeHash(const char *s, uint64_t h = 14695981039346656037ull)
+{
+    return *s ? typeHash(s + 1, (h ^ static_cast<unsigned char>(*s)) * 1099511628211ull) : h;
+}
+
+/*!
+ * \brief FNV-1a hash of a content type, equal to the compile-time one of the same name
+ */
+inline uint64_t typeHash(boost::string_ref s)
+{
+    uint64_t h = 14695981039346656037ull;
+    for(char c : s)
+        h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    return h;
+}
+
+//! \cond HIDDEN_SYMBOLS
+
+constexpr size_t typeLength(const char *s, size_t n = 0)
+{
+    return *s ? typeLength(s + 1, n + 1) : n;
+}
+
+//! \endcond
+
+/*!
+ * \brief The type of a message class, known at compile time
+ *
+ * The message class declares its type with a `static constexpr const char *b0_type` member
+ * (also returned by Message::type()). This lets the typed sockets check and write the content
+ * type without a virtual call, or building a string.
  */
 template<class TMsg>
-void parse(TMsg &msg, const std::string &s)
+struct MessageType
+{
+    //! The type name
+    static constexpr const char * name() {return TMsg::b0_type;}
+
+    //! The length of the type name
+    static constexpr size_t length() {return typeLength(TMsg::b0_type);}
+
+    //! The hash of the type name (see typeHash())
+    static constexpr uint64_t hash() {return typeHash(TMsg::b0_type);}
+};
+
+/*!
+ * \brief True if TMsg declares its type at compile time (see MessageType)
+ */
+template<class TMsg>
+class has_static_type
+{
+    template<typename U>
+    static std::true_type test(typename std::enable_if<std::is_convertible<decltype(U::b0_type), const char*>::value>::type*);
+
+    template<typename U>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<TMsg>(nullptr))::value;
+};
+
+//! \cond HIDDEN_SYMBOLS
+
+//! Suffix of the content type of messages encoded with MessagePack
+static const char msgpack_content_type_suffix[] = "+msgpack";
+
+static const size_t msgpack_content_type_suffix_length = sizeof(msgpack_content_type_suffix) - 1;
+
+//! How a content type matches a message type
+enum class ContentTypeMatch {None, JSON, MsgPack};
+
+inline ContentTypeMatch matchContentType(const std::string &type, const char *msg_type, size_t msg_type_length)
+{
+    // the length alone rules out most mismatches
+    if(type.size() == msg_type_length)
+        return std::memcmp(type.data(), msg_type, msg_type_length) == 0 ? ContentTypeMatch::JSON : ContentTypeMatch::None;
+    if(type.size() == msg_type_length + msgpack_content_type_suffix_length
+            && std::memcmp(type.data(), msg_type, msg_type_length) == 0
+            && std::memcmp(type.data() + msg_type_length, msgpack_content_type_suffix, msgpack_content_type_suffix_length) == 0)
+        return ContentTypeMatch::MsgPack;
+    return ContentTypeMatch::None;
+}
+
+template<class TMsg>
+typename std::enable_if<has_static_type<TMsg>::value, ContentTypeMatch>::type matchContentType(const TMsg &, const std::string &type)
+{
+    return matchContentType(type, MessageType<TMsg>::name(), MessageType<TMsg>::length());
+}
+
+template<class TMsg>
+typename std::enable_if<!has_static_type<TMsg>::value, ContentTypeMatch>::type matchContentType(const TMsg &msg, const std::string &type)
 {
+    const std::string msg_type = msg.type();
+    return matchContentType(type, msg_type.data(), msg_type.size());
+}
+
+template<class TMsg>
+typename std::enable_if<has_static_type<TMsg>::value>::type assignContentType(const TMsg &, std::string &type)
+{
+    type.assign(MessageType<TMsg>::name(), MessageType<TMsg>::length());
+}
+
+template<class TMsg>
+typename std::enable_if<!has_static_type<TMsg>::value>::type assignContentType(const TMsg &msg, std::string &type)
+{
+    type = msg.type();
+}
+
+//! True if the payload is a MessagePack map (a JSON payload never starts with these bytes)
+inline bool isMsgPackPayload(const std::string &s)
+{
+    if(s.empty()) return false;
+    unsigned char b = static_cast<unsigned char>(s[0]);
+    return (b & 0xf0) == 0x80 || b == 0xde || b == 0xdf;
+}
+
+template<class TMsg>
+typename std::enable_if<msgpack::has_describe<TMsg>::value>::type parseMsgPack(TMsg &msg, const std::string &s)
+{
+    msgpack::decode(msg, s.data(), s.size());
+}
+
+template<class TMsg>
+typename std::enable_if<!msgpack::has_describe<TMsg>::value>::type parseMsgPack(TMsg &msg, const std::string &s)
+{
+    throw exception::MessageUnpackError((boost::format("message type %s does not support msgpack") % msg.type()).str());
+}
+
+template<class TMsg>
+typename std::enable_if<msgpack::has_describe<TMsg>::value>::type parseJSON(TMsg &msg, const std::string &s)
+{
+    if(b0::getInPlaceJSONDecoding())
+    {
+        try
+        {
+            json_decoder::decode(msg, s.data(), s.size());
+            return;
+        }
+        catch(exception::MessageUnpackError &)
+        {
+            // e.g. a payload the decoder is stricter about: the codec has the last word
+        }
+    }
     if(!spotify::json::try_decode(msg, s))
         throw exception::MessageUnpackError("json parse error");
 }
 
+template<class TMsg>
+typename std::enable_if<!msgpack::has_describe<TMsg>::value>::type parseJSON(TMsg &msg, const std::string &s)
+{
+    if(!spotify::json::try_decode(msg, s))
+        throw exception::MessageUnpackError("json parse error");
+}
+
+// appends to s
+template<class TMsg>
+typename std::enable_if<msgpack::has_describe<TMsg>::value, bool>::type serializeMsgPack(const TMsg &msg, std::string &s)
+{
+    msgpack::Writer w(s);
+    msgpack::encode(w, msg);
+    return true;
+}
+
+template<class TMsg>
+typename std::enable_if<!msgpack::has_describe<TMsg>::value, bool>::type serializeMsgPack(const TMsg &, std::string &)
+{
+    return false;
+}
+
+//! \endcond
+
 /*!
  * \brief Parse a message from a string
+ *
+ * The encoding (JSON or MessagePack) is detected from the payload.
+ */
+template<class TMsg>
+void parse(TMsg &msg, const std::string &s)
+{
+    if(isMsgPackPayload(s))
+        parseMsgPack(msg, s);
+    else
+        parseJSON(msg, s);
+}
+
+/*!
+ * \brief Parse a message from a string
+ *
+ * The content type must be the message type, or the message type followed by "+msgpack"
+ * if the message has been encoded with MessagePack.
  */
 template<class TMsg>
 void parse(TMsg &msg, const std::string &s, const std::string &type)
 {
-    if(type != msg.type())
+    switch(matchContentType(msg, type))
+    {
+    case ContentTypeMatch::JSON:
+        parseJSON(msg, s);
+        break;
+    case ContentTypeMatch::MsgPack:
+        parseMsgPack(msg, s);
+        break;
+    default:
         throw exception::MessageUnpackError((boost::format("bad content type: got %s, expected %s") % type % msg.type()).str());
-    if(!spotify::json::try_decode(msg, s))
-        throw exception::MessageUnpackError("json parse error");
+    }
 }
 
 /*!
@@ -68,7 +264,98 @@ template<class TMsg>
 void serialize(const TMsg &msg, std::string &s, std::string &type)
 {
     s = spotify::json::encode(msg);
-    type = msg.type();
+    assignContentType(msg, type);
+}
+
+/*!
+ * \brief Serialize a message to a string, with the given codec
+ *
+ * With MessageCodec::MsgPack the content type is the message type followed by "+msgpack".
+ * Message types which do not support MessagePack are serialized to JSON.
+ */
+template<class TMsg>
+void serialize(const TMsg &msg, std::string &s, std::string &type, MessageCodec codec)
+{
+    s.clear();
+    if(codec == MessageCodec::MsgPack && serializeMsgPack(msg, s))
+    {
+        assignContentType(msg, type);
+        type += msgpack_content_type_suffix;
+    }
+    else
+        serialize(msg, s, type);
+}
+
+/*!
+ * \brief Serialize a message with the given codec, appending it to a string
+ *
+ * MessagePack is encoded in place at the end of the string; JSON is encoded separately, and appended.
+ */
+template<class TMsg>
+void serializeAppend(const TMsg &msg, std::string &s, std::string &type, MessageCodec codec)
+{
+    if(codec == MessageCodec::MsgPack && serializeMsgPack(msg, s))
+    {
+        assignContentType(msg, type);
+        type += msgpack_content_type_suffix;
+        return;
+    }
+    s += spotify::json::encode(msg);
+    assignContentType(msg, type);
+}
+
+//! \cond HIDDEN_SYMBOLS
+
+//! True if TMsg has a clear() method
+template<class TMsg>
+class has_clear
+{
+    template<class U>
+    static std::true_type test(decltype(std::declval<U&>().clear()) *);
+
+    template<class U>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<TMsg>(nullptr))::value;
+};
+
+template<class TMsg>
+typename std::enable_if<has_clear<TMsg>::value>::type resetMsg(TMsg &msg, int)
+{
+    msg.clear();
+}
+
+template<class TMsg>
+typename std::enable_if<!has_clear<TMsg>::value && msgpack::has_describe<TMsg>::value>::type resetMsg(TMsg &msg, long)
+{
+    static const TMsg proto{};
+    msgpack::FieldResetter<TMsg> resetter{&msg, &proto};
+    spotify::json::default_codec_t<TMsg>::describe(resetter);
+}
+
+template<class TMsg>
+void resetMsg(TMsg &msg, ...)
+{
+    msg = TMsg();
+}
+
+//! \endcond
+
+/*!
+ * \brief Reset a message to its default state, keeping the capacity of its strings and vectors where possible
+ *
+ * This calls msg.clear() if the message defines it; otherwise the fields of a message with a
+ * describe() codec are assigned from a default-constructed instance, which keeps the buffers
+ * of the strings and vectors (but not of their elements); otherwise a new instance is assigned.
+ *
+ * Parsing from MessagePack into an existing message decodes its strings and vectors in place,
+ * reusing their buffers; so does parsing from JSON, with b0::setInPlaceJSONDecoding().
+ */
+template<class TMsg>
+void reset(TMsg &msg)
+{
+    resetMsg(msg, 0);
 }
 
 } // namespace message
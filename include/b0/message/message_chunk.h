@@ -0,0 +1,157 @@
+#ifndef B0__MESSAGE__MESSAGE_CHUNK_H__INCLUDED
+#define B0__MESSAGE__MESSAGE_CHUNK_H__INCLUDED
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+/*!
+ * \brief A fragment of a serialized MessageEnvelope that has been split for transmission
+ *
+ * A serialized envelope bigger than the chunk size of the socket (see b0::Socket::setChunkSize())
+ * is sent as several ZeroMQ messages, so that the messages of other senders can be
+ * interleaved with them, instead of waiting behind the whole transfer.
+ *
+ * Each chunk starts with the header0 line of the envelope (so the routing and the
+ * subscriptions work as for the whole envelope), followed by a marker byte, and a
+ * fixed-size binary header:
+ *
+ *     topic\n
+ *     \x01 version(1) sender(8) seq(8) index(4) count(4) total(8)
+ *     ...data...
+ *
+ * where sender identifies the sending socket, seq the envelope among those it sent,
+ * index and count the position of this chunk, and total the size of the whole envelope.
+ * Integers are little-endian. The chunks of an envelope are sent in order.
+ */
+struct MessageChunk
+{
+    //! Id of the sending socket
+    uint64_t sender;
+
+    //! Sequence number of the envelope, for the sending socket
+    uint64_t seq;
+
+    //! Index of this chunk
+    uint32_t index;
+
+    //! Number of chunks of the envelope
+    uint32_t count;
+
+    //! Size of the whole serialized envelope
+    uint64_t total;
+
+    //! The fragment of the serialized envelope carried by this chunk
+    const char *data;
+
+    //! Size of the fragment
+    size_t size;
+};
+
+/*!
+ * \brief Return true if the ZeroMQ message in data is a chunk (see MessageChunk)
+ */
+bool isChunk(const char *data, size_t size);
+
+/*!
+ * \brief Return the size of the chunk headers, for the given header0
+ */
+size_t chunkHeaderSize(const std::string &header0);
+
+/*!
+ * \brief Write the chunk headers into dst (which must have room for chunkHeaderSize()), and return their size
+ *
+ * The chunk data and size fields are ignored: the fragment is to be copied right after the headers.
+ */
+size_t writeChunkHeader(char *dst, const std::string &header0, const MessageChunk &chunk);
+
+/*!
+ * \brief Parse a chunk, throwing exception::EnvelopeDecodeError if it is malformed
+ *
+ * The data of the chunk points into the given buffer.
+ */
+void parseChunk(MessageChunk &chunk, const char *data, size_t size);
+
+/*!
+ * \brief Parse a chunk, returning false instead of throwing if it is malformed (see parseChunk())
+ */
+bool tryParseChunk(MessageChunk &chunk, const char *data, size_t size);
+
+/*!
+ * \brief Reassembles the chunks of the envelopes received by a socket
+ *
+ * One envelope per sender can be in progress. A chunk out of sequence (e.g. after a
+ * chunk has been dropped by ZeroMQ for exceeding the high-water mark) discards the
+ * envelope it belongs to.
+ *
+ * The memory used by the envelopes being reassembled is capped: an envelope bigger
+ * than the cap is discarded, and the oldest envelopes in progress are discarded to make
+ * room for new ones.
+ */
+class ChunkReassembler
+{
+public:
+    /*!
+     * \brief Add a received chunk (see parseChunk())
+     *
+     * Return the whole serialized envelope if this was its last chunk, or an empty pointer.
+     */
+    std::shared_ptr<std::string> add(const char *data, size_t size);
+
+    /*!
+     * \brief Add a received chunk, returning false instead of throwing if it is malformed (see add())
+     *
+     * envelope is set to the whole serialized envelope if this was its last chunk, or reset.
+     */
+    bool tryAdd(const char *data, size_t size, std::shared_ptr<std::string> &envelope);
+
+    //! Set the maximum memory used by the envelopes being reassembled
+    void setMaxSize(size_t max_size);
+
+    //! Get the maximum memory used by the envelopes being reassembled
+    size_t getMaxSize() const;
+
+    //! Return the memory currently used by the envelopes being reassembled
+    size_t getBufferedSize() const;
+
+    //! Return the number of envelopes which have been discarded
+    uint64_t getDiscardedCount() const;
+
+private:
+    struct Partial
+    {
+        uint64_t seq;
+        uint32_t next_index;
+        uint32_t count;
+        uint64_t total;
+        uint64_t started;
+        std::shared_ptr<std::string> data;
+    };
+
+    //! Discard the envelope in progress for the given sender
+    void discard(std::map<uint64_t, Partial>::iterator it);
+
+    //! Discard the oldest envelopes in progress until size more bytes fit
+    void makeRoom(size_t size);
+
+    std::map<uint64_t, Partial> partials_;
+    size_t max_size_{512 * 1024 * 1024};
+    size_t buffered_size_{0};
+    uint64_t discarded_{0};
+    uint64_t started_{0};
+};
+
+} // namespace message
+
+} // namespace b0
+
+#endif // B0__MESSAGE__MESSAGE_CHUNK_H__INCLUDED
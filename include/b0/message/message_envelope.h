@@ -1,13 +1,18 @@
 #ifndef B0__MESSAGE__MESSAGE_ENVELOPE_H__INCLUDED
 #define B0__MESSAGE__MESSAGE_ENVELOPE_H__INCLUDED
 
+#include <deque>
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
+#include <boost/function.hpp>
 #include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
 
 #include <b0/b0.h>
 #include <b0/message/message_part.h>
+#include <b0/compress/compress.h>
 
 namespace b0
 {
@@ -15,6 +20,22 @@ namespace b0
 namespace message
 {
 
+/*!
+ * \brief Wire format of a serialized MessageEnvelope
+ *
+ * Both formats start with the header0 line, so prefix-based routing works the same.
+ * The format is detected automatically when parsing.
+ */
+enum class EnvelopeFormat
+{
+    //! Human-readable headers, one per line (the default)
+    Text,
+    //! Compact varint-encoded headers, with well-known content types and compression algorithms encoded as small integers
+    Binary,
+    //! As Binary, with the other content types encoded as the integer ids assigned by the resolver (see b0::message::getContentTypeId())
+    BinaryIds
+};
+
 /*!
  * \brief A message envelope used to wrap (optionally: compress) the real message payload(s)
  *
@@ -22,6 +43,7 @@ namespace message
  * a blank line and by a sequence of payloads.
  *
  * The first line is an address used for prefix-based routing (typically in topics).
+ * Subscribers include the line terminator in their subscription, for an exact match.
  *
  * The `Part-count` header tells how many MessagePart are contained in the message.
  *
@@ -43,7 +65,19 @@ namespace message
  * The only mandatory fields are `Part-count` and `Content-length-#` which are required
  * to disassemble the individual message parts. The payload size (15) is the sum of the
  * individual (compressed) payloads. When a part is compressed, a Compression-algorithm-#
- * header will be present.
+ * header will be present, and a Compression-dictionary-# header if it has been compressed
+ * with a dictionary (see b0::compress::addDictionary()).
+ *
+ * With EnvelopeFormat::Binary, the header0 line is followed by a NUL byte, a version
+ * byte, and the same information encoded with varints, followed by the payloads.
+ * With EnvelopeFormat::BinaryIds, the content types which have an id (see
+ * b0::message::getContentTypeId()) are encoded with it; an envelope with an id the
+ * receiver cannot resolve fails to parse.
+ *
+ * With a checksum (see EnvelopeSerializer::setChecksum()), each part has a
+ * `Checksum-#` header with the CRC-32C of its payload as sent (i.e. compressed),
+ * in hexadecimal, which is verified by the parser before decompressing the part.
+ * In the binary formats it is a customized header, so that older receivers ignore it.
  */
 class MessageEnvelope
 {
@@ -58,16 +92,270 @@ public:
     std::map<std::string, std::string> headers;
 };
 
+/*!
+ * \brief A message envelope whose parts reference the received buffer instead of owning a copy
+ *
+ * The buffer the envelope has been parsed from is kept alive by this object, so the
+ * MessagePartView::data pointers remain valid for the lifetime of the envelope.
+ * Compressed parts are decompressed into storage owned by the envelope.
+ *
+ * \sa MessageEnvelope
+ */
+class MessageEnvelopeView
+{
+public:
+    //! The very first line of the message envelope, used for routing (topics, services)
+    std::string header0;
+
+    //! The message parts
+    std::vector<MessagePartView> parts;
+
+    /*!
+     * \brief Additional customized headers
+     *
+     * They are parsed from the buffer on first use, since most receivers never look at them.
+     */
+    const std::map<std::string, std::string> & getHeaders() const;
+
+    //! \copydoc getHeaders() const
+    std::map<std::string, std::string> & getHeaders();
+
+    /*!
+     * \brief Look up a single customized header, without parsing all of them
+     *
+     * The returned value points into the buffer, and is valid as long as the envelope.
+     */
+    boost::optional<boost::string_ref> findHeader(boost::string_ref key) const;
+
+    //! Keeps alive the buffer referenced by the parts
+    std::shared_ptr<const void> buffer;
+
+    //! Storage for the payloads of the parts which were compressed
+    std::deque<std::string> decompressed_payloads;
+
+    /*!
+     * \brief Leave the compressed parts compressed until their payload is read (see MessagePartView::payload())
+     *
+     * A receiver which only reads some parts (e.g. a small metadata part next to large images)
+     * then does not pay for decompressing the others. Applies to the next parses into this
+     * envelope. The default is disabled: all the parts are decompressed by parse().
+     */
+    void setLazyDecompression(bool enabled) {lazy_decompression_ = enabled;}
+
+    //! Return true if the compressed parts are decompressed on demand (see setLazyDecompression())
+    bool getLazyDecompression() const {return lazy_decompression_;}
+
+    //! \cond HIDDEN_SYMBOLS
+
+    //! Set the header block the customized headers are parsed from (called by parse())
+    void setRawHeaders(boost::string_ref raw_headers, bool binary);
+
+    //! \endcond
+
+private:
+    boost::string_ref raw_headers_;
+    bool raw_headers_binary_{false};
+    mutable bool headers_parsed_{false};
+    mutable std::map<std::string, std::string> headers_;
+    bool lazy_decompression_{false};
+};
+
+/*!
+ * \brief Serializer writing a message envelope directly into a buffer of the exact size
+ *
+ * prepare() compresses the parts (if needed) and computes the exact size of the serialized
+ * envelope, then write() writes it into a buffer of that size (e.g. a ZeroMQ message), without
+ * intermediate strings. The output is identical to serialize().
+ *
+ * The envelope (and the compression context, if any) must not change between prepare() and
+ * write(). The serializer can be reused across messages, keeping its scratch buffers.
+ */
+class EnvelopeSerializer
+{
+public:
+    //! Compress the parts and return the size of the serialized envelope
+    size_t prepare(const MessageEnvelope &env, EnvelopeFormat format, b0::compress::Context *context = nullptr);
+
+    /*!
+     * \brief Prepare an envelope whose last part payload is given separately, and return the size of its headers
+     *
+     * The payload of the last part of env is ignored: the given payload is sent instead, and must not
+     * be compressed. This allows a payload encoded in place, right after a space left for the headers
+     * in the outgoing buffer, to be sent without copying it: writeHeaders() then writes the headers just
+     * before the payload, provided the other parts are empty.
+     */
+    size_t prepareHeaders(const MessageEnvelope &env, EnvelopeFormat format, boost::string_ref payload, b0::compress::Context *context = nullptr);
+
+    //! Write the envelope prepared with prepare() into dst, which must have room for its size
+    void write(char *dst) const;
+
+    //! Write only the headers of the envelope prepared with prepare() or prepareHeaders() into dst
+    void writeHeaders(char *dst) const;
+
+    //! The size of the headers of the prepared envelope (everything before the payloads)
+    size_t getHeaderSize() const {return header_size_;}
+
+    //! The length of each (compressed) part payload of the prepared envelope
+    const std::vector<size_t> & getContentLengths() const;
+
+    /*!
+     * \brief The (compressed) payload of each part of the prepared envelope
+     *
+     * They reference the parts of the envelope, or the scratch buffers of the serializer for
+     * the compressed ones, and are valid until the next prepare(). Sent after the headers written
+     * by writeHeaders(), each in its own buffer, they can be parsed with the parse() overloads taking
+     * the payloads separately.
+     */
+    const std::vector<boost::string_ref> & getPayloads() const;
+
+    /*!
+     * \brief Add a Checksum-# header with the CRC-32C of each part payload (default: false)
+     *
+     * The checksums are computed by prepare() (see b0::crc32c()), and verified by any parser
+     * (see ParseStatus::ChecksumMismatch).
+     */
+    void setChecksum(bool enabled) {checksum_ = enabled;}
+
+    //! Return true if the prepared envelopes have a checksum per part (see setChecksum())
+    bool getChecksum() const {return checksum_;}
+
+private:
+    //! Compute the sizes of the prepared envelope
+    void measure();
+
+    const MessageEnvelope *env_{nullptr};
+    EnvelopeFormat format_{EnvelopeFormat::Text};
+    size_t size_{0};
+    size_t header_size_{0};
+    size_t total_length_{0};
+    std::vector<std::string> compressed_payloads_;
+    std::vector<boost::string_ref> payloads_;
+    std::vector<size_t> content_lengths_;
+    //! With EnvelopeFormat::BinaryIds, the content type id of each part (or -1), resolved once for measure() and write()
+    std::vector<int64_t> content_type_ids_;
+    bool checksum_{false};
+    //! With setChecksum(), the CRC-32C of each payload
+    std::vector<uint32_t> checksums_;
+};
+
 /*!
  * \brief Parse a message envelope from a string
  */
 void parse(MessageEnvelope &env, const std::string &s);
 
+/*!
+ * \brief Parse a message envelope from a buffer
+ */
+void parse(MessageEnvelope &env, const char *data, size_t size);
+
+/*!
+ * \brief Parse a message envelope view from a buffer
+ *
+ * The parts of the resulting envelope will point into the given buffer, which must
+ * outlive the envelope (see MessageEnvelopeView::buffer).
+ */
+void parse(MessageEnvelopeView &env, const char *data, size_t size);
+
+/*!
+ * \brief Parse a message envelope from a buffer, decompressing the parts with the given context
+ */
+void parse(MessageEnvelope &env, const char *data, size_t size, b0::compress::Context &context);
+
+/*!
+ * \brief Parse a message envelope view from a buffer, decompressing the parts with the given context
+ */
+void parse(MessageEnvelopeView &env, const char *data, size_t size, b0::compress::Context &context);
+
+/*!
+ * \brief Parse a message envelope from its headers, with the payload of each part in its own buffer
+ *
+ * data holds only the headers (as written by EnvelopeSerializer::writeHeaders()), and there must
+ * be exactly one payload per part, of the size given in the headers.
+ */
+void parse(MessageEnvelope &env, const char *data, size_t size, const std::vector<boost::string_ref> &payloads, b0::compress::Context &context);
+
+/*!
+ * \brief Predicate on the header0 and the customized headers of an envelope (see findHeader())
+ */
+using HeaderFilter = boost::function<bool(const MessageEnvelopeView &)>;
+
+/*!
+ * \brief Parse a message envelope view, going on with the parts only if the filter accepts its headers
+ *
+ * The filter is called right after the headers are parsed, before the parts are decompressed
+ * or even located, so a rejected envelope costs little more than its header lines. Return
+ * false if the envelope was rejected, in which case the parts of env are not valid.
+ */
+bool parse(MessageEnvelopeView &env, const char *data, size_t size, b0::compress::Context &context, const HeaderFilter &filter);
+
+/*!
+ * \brief Parse a message envelope view from its headers, with the payload of each part in its own buffer
+ *
+ * The parts point into the given payloads, without copying them (see the MessageEnvelope overload).
+ * Return false if the envelope was rejected by the filter (if given).
+ */
+bool parse(MessageEnvelopeView &env, const char *data, size_t size, const std::vector<boost::string_ref> &payloads, b0::compress::Context &context, const HeaderFilter &filter = HeaderFilter());
+
+/*!
+ * \brief Result of tryParse()
+ */
+enum class ParseStatus
+{
+    //! The envelope has been parsed
+    Ok,
+    //! The envelope was rejected by the filter (its parts are not valid)
+    Filtered,
+    //! The envelope is malformed (parse() throws exception::EnvelopeDecodeError)
+    DecodeError,
+    //! A part is compressed with an algorithm not supported by this build (parse() throws exception::UnsupportedCompressionAlgorithm)
+    UnsupportedCompression,
+    //! A part cannot be decompressed (parse() throws exception::Exception)
+    DecompressError,
+    //! The payload of a part does not match its checksum (parse() throws exception::ChecksumMismatch)
+    ChecksumMismatch
+};
+
+/*!
+ * \brief Parse a message envelope view, returning a status instead of throwing
+ *
+ * Same as the parse() overloads, which are wrappers throwing the exception matching the
+ * status: the context, the filter and the separate payloads are optional. For
+ * ParseStatus::DecompressError the reason is stored in error, if given, and for
+ * ParseStatus::UnsupportedCompression the algorithm, and for ParseStatus::ChecksumMismatch
+ * the part.
+ *
+ * The receive path of the sockets uses this, so that dropping bad or unwanted messages
+ * does not cost an exception each.
+ */
+ParseStatus tryParse(MessageEnvelopeView &env, const char *data, size_t size, b0::compress::Context *context = nullptr, const HeaderFilter &filter = HeaderFilter(), const std::vector<boost::string_ref> *payloads = nullptr, std::string *error = nullptr);
+
+/*!
+ * \brief Parse a message envelope, returning a status instead of throwing (see above)
+ */
+ParseStatus tryParse(MessageEnvelope &env, const char *data, size_t size, b0::compress::Context *context = nullptr, const std::vector<boost::string_ref> *payloads = nullptr, std::string *error = nullptr);
+
 /*!
  * \brief Serialize a message envelope to a string
  */
 void serialize(const MessageEnvelope &msg, std::string &s);
 
+/*!
+ * \brief Serialize a message envelope to a string, using the specified wire format
+ */
+void serialize(const MessageEnvelope &msg, std::string &s, EnvelopeFormat format);
+
+/*!
+ * \brief Serialize a message envelope to a string, using the specified wire format, and
+ *        report the length of each (compressed) part payload in content_lengths
+ */
+void serialize(const MessageEnvelope &msg, std::string &s, EnvelopeFormat format, std::vector<size_t> &content_lengths);
+
+/*!
+ * \brief Serialize a message envelope to a string (see above), compressing the parts with
+ *        the given context and its scratch buffers
+ */
+void serialize(const MessageEnvelope &msg, std::string &s, EnvelopeFormat format, std::vector<size_t> &content_lengths, b0::compress::Context &context);
+
 } // namespace message
 
 } // namespace b0
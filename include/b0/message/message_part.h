@@ -3,6 +3,8 @@
 
 #include <string>
 
+#include <boost/utility/string_ref.hpp>
+
 #include <b0/b0.h>
 
 namespace b0
@@ -11,6 +13,17 @@ namespace b0
 namespace message
 {
 
+/*!
+ * \brief Encoding of the message payloads
+ */
+enum class MessageCodec
+{
+    //! JSON, via spotify-json (the default)
+    JSON,
+    //! MessagePack, for the message types which describe their fields (see b0::message::msgpack); others fall back to JSON
+    MsgPack
+};
+
 /*!
  * \brief A structure to represent a message part
  *
@@ -27,10 +40,70 @@ struct MessagePart
     //! \brief Compression level, or 0 if no compression
     int compression_level;
 
+    //! \brief Id of the compression dictionary, or blank if no dictionary (see b0::compress::addDictionary())
+    std::string compression_dictionary;
+
     //! \brief The payload
     std::string payload;
 };
 
+/*!
+ * \brief A non-owning view of a message part
+ *
+ * The payload is referenced by pointer and size, and is only valid as long as the
+ * MessageEnvelopeView which contains this part is alive.
+ *
+ * If the envelope was parsed with lazy decompression (see
+ * MessageEnvelopeView::setLazyDecompression()), a compressed part is only decompressed by
+ * payload(): until then, data and size are those of the compressed bytes (see isCompressed()).
+ *
+ * \sa MessageEnvelopeView
+ */
+struct MessagePartView
+{
+    //! \brief An optional string indicating the type of the payload
+    std::string content_type;
+
+    //! \brief Compression algorithm name, or blank if no compression
+    std::string compression_algorithm;
+
+    //! \brief Compression level, or 0 if no compression
+    int compression_level;
+
+    //! \brief Id of the compression dictionary, or blank if no dictionary (see b0::compress::addDictionary())
+    std::string compression_dictionary;
+
+    //! \brief Pointer to the (uncompressed, unless isCompressed()) payload
+    mutable const char *data;
+
+    //! \brief Size of the (uncompressed, unless isCompressed()) payload
+    mutable size_t size;
+
+    /*!
+     * \brief Return the uncompressed payload, decompressing it first if needed
+     *
+     * Throws exception::UnsupportedCompressionAlgorithm or exception::Exception if the part
+     * cannot be decompressed.
+     */
+    boost::string_ref payload() const;
+
+    //! \brief Return true if the payload has not been decompressed yet (see payload())
+    bool isCompressed() const {return decompress_buffer_ != nullptr;}
+
+    //! \brief Return a copy of the (uncompressed) payload as a string
+    std::string str() const {boost::string_ref p = payload(); return std::string(p.data(), p.size());}
+
+    //! \cond HIDDEN_SYMBOLS
+
+    //! Where payload() decompresses the part, owned by the envelope (null once decompressed)
+    mutable std::string *decompress_buffer_{nullptr};
+
+    //! Size of the uncompressed payload, if known (0 otherwise)
+    size_t uncompressed_size_{0};
+
+    //! \endcond
+};
+
 } // namespace message
 
 } // namespace b0
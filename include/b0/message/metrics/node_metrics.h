@@ -0,0 +1,148 @@
+#ifndef B0__MESSAGE__METRICS__NODE_METRICS_H__INCLUDED
+#define B0__MESSAGE__METRICS__NODE_METRICS_H__INCLUDED
+
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/metrics/socket_metrics.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace metrics
+{
+
+/*!
+ * \brief Time since the last heartbeat of a node, as seen by the resolver
+ *
+ * \sa NodeMetrics::heartbeats
+ */
+class HeartbeatMetrics : public Message
+{
+public:
+    //! The name of the node
+    std::string node_name;
+
+    //! Time since the last heartbeat of the node (in microseconds, with a resolution of one second)
+    int64_t age_usec{0};
+
+public:
+    static constexpr const char *b0_type = "b0.message.metrics.HeartbeatMetrics";
+
+    std::string type() const override {return b0_type;}
+};
+
+/*!
+ * \brief Snapshot of the traffic counters of all the sockets of a node, and of its spin loop
+ *
+ * Returned by the `<node name>.metrics` service (see the B0_METRICS_SERVICE env var).
+ *
+ * \sa SocketMetrics, b0::Node::getMetrics()
+ */
+class NodeMetrics : public Message
+{
+public:
+    //! The name of the node
+    std::string node_name;
+
+    //! Time of the snapshot (see b0::Node::timeUSec())
+    int64_t time_usec;
+
+    //! The counters of each socket
+    std::vector<SocketMetrics> sockets;
+
+    //! Number of iterations of spin() in fixed-rate mode (see b0::Node::getSpinCounters())
+    uint64_t spin_iterations{0};
+
+    //! Number of iterations of spin() which overran the period
+    uint64_t spin_overruns{0};
+
+    //! 50th percentile of the lateness of the iterations of spin() (in microseconds)
+    int64_t spin_jitter_p50_usec{0};
+
+    //! 99th percentile of the lateness of the iterations of spin() (in microseconds)
+    int64_t spin_jitter_p99_usec{0};
+
+    //! Maximum lateness of the iterations of spin() (in microseconds)
+    int64_t spin_jitter_max_usec{0};
+
+    //! Heartbeats of the nodes (only in the metrics of the resolver, see b0::resolver::Resolver::getMetrics())
+    std::vector<HeartbeatMetrics> heartbeats;
+
+public:
+    static constexpr const char *b0_type = "b0.message.metrics.NodeMetrics";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace metrics
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::metrics::HeartbeatMetrics;
+using b0::message::metrics::NodeMetrics;
+
+template <>
+struct default_codec_t<HeartbeatMetrics>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("node_name", &HeartbeatMetrics::node_name);
+        codec.required("age_usec", &HeartbeatMetrics::age_usec);
+    }
+
+    static codec::object_t<HeartbeatMetrics> codec()
+    {
+        auto codec = codec::object<HeartbeatMetrics>();
+        describe(codec);
+        return codec;
+    }
+};
+
+template <>
+struct default_codec_t<NodeMetrics>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("node_name", &NodeMetrics::node_name);
+        codec.required("time_usec", &NodeMetrics::time_usec);
+        codec.required("sockets", &NodeMetrics::sockets);
+        codec.optional("spin_iterations", &NodeMetrics::spin_iterations);
+        codec.optional("spin_overruns", &NodeMetrics::spin_overruns);
+        codec.optional("spin_jitter_p50_usec", &NodeMetrics::spin_jitter_p50_usec);
+        codec.optional("spin_jitter_p99_usec", &NodeMetrics::spin_jitter_p99_usec);
+        codec.optional("spin_jitter_max_usec", &NodeMetrics::spin_jitter_max_usec);
+        codec.optional("heartbeats", &NodeMetrics::heartbeats);
+    }
+
+    static codec::object_t<NodeMetrics> codec()
+    {
+        auto codec = codec::object<NodeMetrics>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__METRICS__NODE_METRICS_H__INCLUDED
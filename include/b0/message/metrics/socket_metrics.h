@@ -0,0 +1,239 @@
+#ifndef B0__MESSAGE__METRICS__SOCKET_METRICS_H__INCLUDED
+#define B0__MESSAGE__METRICS__SOCKET_METRICS_H__INCLUDED
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace metrics
+{
+
+/*!
+ * \brief Snapshot of the traffic counters of a socket
+ *
+ * The compression ratio can be computed as payload_bytes_sent / bytes_sent
+ * (resp. payload_bytes_received / bytes_received).
+ *
+ * \sa NodeMetrics, b0::SocketCounters
+ */
+class SocketMetrics : public Message
+{
+public:
+    //! The name of the socket (topic or service name)
+    std::string name;
+
+    //! The kind of socket (publisher, subscriber, service_client, service_server or socket)
+    std::string socket_type;
+
+    //! Number of messages sent
+    uint64_t messages_sent;
+
+    //! Number of bytes sent (serialized envelopes, after compression)
+    uint64_t bytes_sent;
+
+    //! Number of payload bytes sent (before compression)
+    uint64_t payload_bytes_sent;
+
+    //! Number of messages dropped because they could not be queued (see b0::Publisher::setBackpressure())
+    uint64_t messages_dropped{0};
+
+    //! Number of messages received
+    uint64_t messages_received;
+
+    //! Number of bytes received (serialized envelopes, before decompression)
+    uint64_t bytes_received;
+
+    //! Number of payload bytes received (after decompression)
+    uint64_t payload_bytes_received;
+
+    //! Number of received messages which could not be read (see b0::Socket::tryReadRaw())
+    uint64_t read_errors{0};
+
+    //! Compression algorithm of the sent payloads (see b0::Socket::setCompression())
+    std::string compression_algorithm;
+
+    //! True if the compression is adaptive (see b0::Socket::setAdaptiveCompression())
+    bool compression_adaptive;
+
+    //! Last measured compression ratio of the adaptive compression (0 if not measured)
+    double compression_ratio;
+
+    //! Number of payloads left uncompressed by the adaptive compression
+    uint64_t compression_skipped;
+
+    //! Number of callback invocations
+    uint64_t callback_count;
+
+    //! Total time spent in callbacks (in microseconds)
+    int64_t callback_total_usec;
+
+    //! Maximum duration of a callback (in microseconds)
+    int64_t callback_max_usec;
+
+    //! Median duration of the callbacks (in microseconds)
+    int64_t callback_p50_usec;
+
+    //! 90th percentile of the duration of the callbacks (in microseconds)
+    int64_t callback_p90_usec;
+
+    //! 99th percentile of the duration of the callbacks (in microseconds)
+    int64_t callback_p99_usec;
+
+    //! Total CPU time spent in callbacks (in microseconds, 0 unless built with ENABLE_PROFILING)
+    int64_t callback_cpu_total_usec{0};
+
+    //! Maximum CPU time of a callback (in microseconds, 0 unless built with ENABLE_PROFILING)
+    int64_t callback_cpu_max_usec{0};
+
+    //! 99th percentile of the CPU time of the callbacks (in microseconds, 0 unless built with ENABLE_PROFILING)
+    int64_t callback_cpu_p99_usec{0};
+
+    //! Number of messages or calls waiting in a queue of the socket (see b0::Socket::getQueueDepth())
+    uint64_t queue_depth{0};
+
+    //! Number of connections established or accepted (only with b0::Socket::setConnectionMonitor())
+    uint64_t connects{0};
+
+    //! Number of connections lost
+    uint64_t disconnects{0};
+
+    //! Number of connections established again after being lost
+    uint64_t reconnects{0};
+
+    //! Number of connection attempts retried
+    uint64_t connect_retries{0};
+
+    //! Number of failed handshakes
+    uint64_t handshake_failures{0};
+
+    //! Maximum time to (re)connect (in microseconds)
+    int64_t connect_max_usec{0};
+
+    //! 99th percentile of the time to (re)connect (in microseconds)
+    int64_t connect_p99_usec{0};
+
+    //! 99th percentile of the duration of the handshakes (in microseconds)
+    int64_t handshake_p99_usec{0};
+
+    //! Number of buffers allocated to receive messages (only with b0::Socket::setMemoryAccounting())
+    uint64_t receive_allocations{0};
+
+    //! Number of bytes allocated to receive messages
+    uint64_t receive_allocated_bytes{0};
+
+    //! Number of buffers allocated to decode messages
+    uint64_t decode_allocations{0};
+
+    //! Number of bytes allocated to decode messages
+    uint64_t decode_allocated_bytes{0};
+
+    //! Number of buffers allocated to send messages
+    uint64_t send_allocations{0};
+
+    //! Number of bytes allocated to send messages
+    uint64_t send_allocated_bytes{0};
+
+    //! Payload bytes waiting to be dispatched (see b0::SocketCounters::receive_queue)
+    uint64_t receive_queue_bytes{0};
+
+    //! Peak of receive_queue_bytes
+    uint64_t receive_queue_peak_bytes{0};
+
+    //! Bytes waiting in the write queue (see b0::Socket::setWriteQueueLimit())
+    uint64_t write_queue_bytes{0};
+
+    //! Peak of write_queue_bytes
+    uint64_t write_queue_peak_bytes{0};
+
+public:
+    static constexpr const char *b0_type = "b0.message.metrics.SocketMetrics";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace metrics
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::metrics::SocketMetrics;
+
+template <>
+struct default_codec_t<SocketMetrics>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("name", &SocketMetrics::name);
+        codec.required("socket_type", &SocketMetrics::socket_type);
+        codec.required("messages_sent", &SocketMetrics::messages_sent);
+        codec.required("bytes_sent", &SocketMetrics::bytes_sent);
+        codec.required("payload_bytes_sent", &SocketMetrics::payload_bytes_sent);
+        codec.required("messages_received", &SocketMetrics::messages_received);
+        codec.required("bytes_received", &SocketMetrics::bytes_received);
+        codec.required("payload_bytes_received", &SocketMetrics::payload_bytes_received);
+        codec.required("compression_algorithm", &SocketMetrics::compression_algorithm);
+        codec.required("compression_adaptive", &SocketMetrics::compression_adaptive);
+        codec.required("compression_ratio", &SocketMetrics::compression_ratio);
+        codec.required("compression_skipped", &SocketMetrics::compression_skipped);
+        codec.required("callback_count", &SocketMetrics::callback_count);
+        codec.required("callback_total_usec", &SocketMetrics::callback_total_usec);
+        codec.required("callback_max_usec", &SocketMetrics::callback_max_usec);
+        codec.required("callback_p50_usec", &SocketMetrics::callback_p50_usec);
+        codec.required("callback_p90_usec", &SocketMetrics::callback_p90_usec);
+        codec.required("callback_p99_usec", &SocketMetrics::callback_p99_usec);
+        codec.optional("messages_dropped", &SocketMetrics::messages_dropped);
+        codec.optional("read_errors", &SocketMetrics::read_errors);
+        codec.optional("callback_cpu_total_usec", &SocketMetrics::callback_cpu_total_usec);
+        codec.optional("callback_cpu_max_usec", &SocketMetrics::callback_cpu_max_usec);
+        codec.optional("callback_cpu_p99_usec", &SocketMetrics::callback_cpu_p99_usec);
+        codec.optional("queue_depth", &SocketMetrics::queue_depth);
+        codec.optional("connects", &SocketMetrics::connects);
+        codec.optional("disconnects", &SocketMetrics::disconnects);
+        codec.optional("reconnects", &SocketMetrics::reconnects);
+        codec.optional("connect_retries", &SocketMetrics::connect_retries);
+        codec.optional("handshake_failures", &SocketMetrics::handshake_failures);
+        codec.optional("connect_max_usec", &SocketMetrics::connect_max_usec);
+        codec.optional("connect_p99_usec", &SocketMetrics::connect_p99_usec);
+        codec.optional("handshake_p99_usec", &SocketMetrics::handshake_p99_usec);
+        codec.optional("receive_allocations", &SocketMetrics::receive_allocations);
+        codec.optional("receive_allocated_bytes", &SocketMetrics::receive_allocated_bytes);
+        codec.optional("decode_allocations", &SocketMetrics::decode_allocations);
+        codec.optional("decode_allocated_bytes", &SocketMetrics::decode_allocated_bytes);
+        codec.optional("send_allocations", &SocketMetrics::send_allocations);
+        codec.optional("send_allocated_bytes", &SocketMetrics::send_allocated_bytes);
+        codec.optional("receive_queue_bytes", &SocketMetrics::receive_queue_bytes);
+        codec.optional("receive_queue_peak_bytes", &SocketMetrics::receive_queue_peak_bytes);
+        codec.optional("write_queue_bytes", &SocketMetrics::write_queue_bytes);
+        codec.optional("write_queue_peak_bytes", &SocketMetrics::write_queue_peak_bytes);
+    }
+
+    static codec::object_t<SocketMetrics> codec()
+    {
+        auto codec = codec::object<SocketMetrics>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__METRICS__SOCKET_METRICS_H__INCLUDED
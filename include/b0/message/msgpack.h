@@ -0,0 +1,555 @@
+#ifndef B0__MESSAGE__MSGPACK_H__INCLUDED
+#define B0__MESSAGE__MSGPACK_H__INCLUDED
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <spotify/json.hpp>
+
+#include <b0/b0.h>
+#include <b0/exception/message_unpack_error.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+/*!
+ * \brief MessagePack encoding of the messages
+ *
+ * Messages are encoded as MessagePack maps, from the same field descriptions used for their
+ * JSON codec: a message type supports MessagePack if its spotify::json::default_codec_t
+ * specialization has a static `describe(codec)` template method, which calls
+ * `codec.required(name, member)` and `codec.optional(name, member)` for each field, and
+ * which is also used to build the JSON codec. See b0::message::MessageCodec.
+ *
+ * Supported field types are std::string, bool, integers, floating point numbers,
+ * std::vector and boost::optional of supported types, and messages with a describe() method.
+ */
+namespace msgpack
+{
+
+//! \cond HIDDEN_SYMBOLS
+
+//! Appends MessagePack values to a string
+class Writer
+{
+public:
+    explicit Writer(std::string &s) : s_(s) {}
+
+    void nil() {put(0xc0);}
+
+    void boolean(bool v) {put(v ? 0xc3 : 0xc2);}
+
+    void integer(int64_t v)
+    {
+        if(v >= 0) uinteger(static_cast<uint64_t>(v));
+        else if(v >= -32) put(static_cast<uint8_t>(v));
+        else if(v >= std::numeric_limits<int8_t>::min()) {put(0xd0); putBE(static_cast<uint64_t>(v), 1);}
+        else if(v >= std::numeric_limits<int16_t>::min()) {put(0xd1); putBE(static_cast<uint64_t>(v), 2);}
+        else if(v >= std::numeric_limits<int32_t>::min()) {put(0xd2); putBE(static_cast<uint64_t>(v), 4);}
+        else {put(0xd3); putBE(static_cast<uint64_t>(v), 8);}
+    }
+
+    void uinteger(uint64_t v)
+    {
+        if(v < 0x80) put(static_cast<uint8_t>(v));
+        else if(v <= 0xff) {put(0xcc); putBE(v, 1);}
+        else if(v <= 0xffff) {put(0xcd); putBE(v, 2);}
+        else if(v <= 0xffffffffu) {put(0xce); putBE(v, 4);}
+        else {put(0xcf); putBE(v, 8);}
+    }
+
+    void real(double v)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        put(0xcb);
+        putBE(bits, 8);
+    }
+
+    void string(boost::string_ref v)
+    {
+        size_t n = v.size();
+        if(n < 32) put(static_cast<uint8_t>(0xa0 | n));
+        else if(n <= 0xff) {put(0xd9); putBE(n, 1);}
+        else if(n <= 0xffff) {put(0xda); putBE(n, 2);}
+        else {put(0xdb); putBE(n, 4);}
+        s_.append(v.data(), n);
+    }
+
+    void arrayHeader(size_t n)
+    {
+        if(n < 16) put(static_cast<uint8_t>(0x90 | n));
+        else if(n <= 0xffff) {put(0xdc); putBE(n, 2);}
+        else {put(0xdd); putBE(n, 4);}
+    }
+
+    void mapHeader(size_t n)
+    {
+        if(n < 16) put(static_cast<uint8_t>(0x80 | n));
+        else if(n <= 0xffff) {put(0xde); putBE(n, 2);}
+        else {put(0xdf); putBE(n, 4);}
+    }
+
+private:
+    void put(uint8_t b) {s_.push_back(static_cast<char>(b));}
+
+    void putBE(uint64_t v, int bytes)
+    {
+        for(int i = bytes - 1; i >= 0; i--)
+            put(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    std::string &s_;
+};
+
+//! Reads MessagePack values from a buffer
+class Reader
+{
+public:
+    Reader(const char *data, size_t size) : p_(reinterpret_cast<const uint8_t*>(data)), end_(p_ + size) {}
+
+    bool atEnd() const {return p_ == end_;}
+
+    uint8_t peek() const {need(1); return *p_;}
+
+    bool isNil() const {return peek() == 0xc0;}
+
+    void nil() {if(get() != 0xc0) error();}
+
+    bool boolean()
+    {
+        uint8_t b = get();
+        if(b == 0xc2) return false;
+        if(b == 0xc3) return true;
+        error();
+        return false;
+    }
+
+    int64_t integer()
+    {
+        uint8_t b = peek();
+        if(b >= 0xe0) {p_++; return static_cast<int8_t>(b);}
+        switch(b)
+        {
+        case 0xd0: p_++; return static_cast<int8_t>(getBE(1));
+        case 0xd1: p_++; return static_cast<int16_t>(getBE(2));
+        case 0xd2: p_++; return static_cast<int32_t>(getBE(4));
+        case 0xd3: p_++; return static_cast<int64_t>(getBE(8));
+        }
+        uint64_t v = uinteger();
+        if(v > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) error();
+        return static_cast<int64_t>(v);
+    }
+
+    uint64_t uinteger()
+    {
+        uint8_t b = get();
+        if(b < 0x80) return b;
+        switch(b)
+        {
+        case 0xcc: return getBE(1);
+        case 0xcd: return getBE(2);
+        case 0xce: return getBE(4);
+        case 0xcf: return getBE(8);
+        }
+        error();
+        return 0;
+    }
+
+    double real()
+    {
+        uint8_t b = peek();
+        if(b == 0xca)
+        {
+            p_++;
+            uint32_t bits = static_cast<uint32_t>(getBE(4));
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+        if(b == 0xcb)
+        {
+            p_++;
+            uint64_t bits = getBE(8);
+            double d;
+            std::memcpy(&d, &bits, sizeof(d));
+            return d;
+        }
+        if(b >= 0xe0 || (b >= 0xd0 && b <= 0xd3)) return static_cast<double>(integer());
+        return static_cast<double>(uinteger());
+    }
+
+    boost::string_ref string()
+    {
+        uint8_t b = get();
+        size_t n;
+        if((b & 0xe0) == 0xa0) n = b & 0x1f;
+        else if(b == 0xd9) n = getBE(1);
+        else if(b == 0xda) n = getBE(2);
+        else if(b == 0xdb) n = getBE(4);
+        else {error(); n = 0;}
+        need(n);
+        boost::string_ref ret(reinterpret_cast<const char*>(p_), n);
+        p_ += n;
+        return ret;
+    }
+
+    size_t arrayHeader()
+    {
+        uint8_t b = get();
+        if((b & 0xf0) == 0x90) return b & 0x0f;
+        if(b == 0xdc) return getBE(2);
+        if(b == 0xdd) return getBE(4);
+        error();
+        return 0;
+    }
+
+    size_t mapHeader()
+    {
+        uint8_t b = get();
+        if((b & 0xf0) == 0x80) return b & 0x0f;
+        if(b == 0xde) return getBE(2);
+        if(b == 0xdf) return getBE(4);
+        error();
+        return 0;
+    }
+
+    //! Skip a value of any type (e.g. the value of an unknown field)
+    void skip(int depth = 0)
+    {
+        if(depth > 64) error();
+        uint8_t b = peek();
+        if(b < 0x80 || b >= 0xe0) {p_++; return;}
+        if((b & 0xf0) == 0x80 || b == 0xde || b == 0xdf)
+        {
+            size_t n = mapHeader();
+            for(size_t i = 0; i < 2 * n; i++) skip(depth + 1);
+            return;
+        }
+        if((b & 0xf0) == 0x90 || b == 0xdc || b == 0xdd)
+        {
+            size_t n = arrayHeader();
+            for(size_t i = 0; i < n; i++) skip(depth + 1);
+            return;
+        }
+        if((b & 0xe0) == 0xa0 || (b >= 0xd9 && b <= 0xdb)) {string(); return;}
+        p_++;
+        switch(b)
+        {
+        case 0xc0: case 0xc2: case 0xc3: return;
+        case 0xcc: case 0xd0: advance(1); return;
+        case 0xcd: case 0xd1: advance(2); return;
+        case 0xca: case 0xce: case 0xd2: advance(4); return;
+        case 0xcb: case 0xcf: case 0xd3: advance(8); return;
+        case 0xc4: advance(getBE(1)); return;
+        case 0xc5: advance(getBE(2)); return;
+        case 0xc6: advance(getBE(4)); return;
+        case 0xd4: advance(2); return;
+        case 0xd5: advance(3); return;
+        case 0xd6: advance(5); return;
+        case 0xd7: advance(9); return;
+        case 0xd8: advance(17); return;
+        case 0xc7: advance(getBE(1) + 1); return;
+        case 0xc8: advance(getBE(2) + 1); return;
+        case 0xc9: advance(getBE(4) + 1); return;
+        }
+        error();
+    }
+
+    [[noreturn]] static void error()
+    {
+        throw exception::MessageUnpackError("msgpack parse error");
+    }
+
+private:
+    void need(size_t n) const {if(n > static_cast<size_t>(end_ - p_)) error();}
+
+    void advance(size_t n) {need(n); p_ += n;}
+
+    uint8_t get() {need(1); return *p_++;}
+
+    uint64_t getBE(int bytes)
+    {
+        need(bytes);
+        uint64_t v = 0;
+        for(int i = 0; i < bytes; i++)
+            v = (v << 8) | *p_++;
+        return v;
+    }
+
+    const uint8_t *p_;
+    const uint8_t *end_;
+};
+
+template<typename T>
+struct FieldCounter;
+
+//! True if T has a field description usable by the MessagePack codec
+template<typename T>
+class has_describe
+{
+    template<typename U>
+    static std::true_type test(decltype(&spotify::json::default_codec_t<U>::template describe<FieldCounter<U> >));
+
+    template<typename U>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<T>(nullptr))::value;
+};
+
+// declared first, as messages can be nested in vectors and optionals
+template<typename T>
+typename std::enable_if<has_describe<T>::value>::type encode(Writer &w, const T &v);
+
+template<typename T>
+typename std::enable_if<has_describe<T>::value>::type decode(Reader &r, T &v);
+
+inline void encode(Writer &w, const std::string &v) {w.string(v);}
+
+inline void encode(Writer &w, bool v) {w.boolean(v);}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type encode(Writer &w, T v) {w.integer(v);}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value>::type encode(Writer &w, T v) {w.uinteger(v);}
+
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type encode(Writer &w, T v) {w.real(v);}
+
+template<typename T>
+void encode(Writer &w, const boost::optional<T> &v)
+{
+    if(v) encode(w, *v);
+    else w.nil();
+}
+
+template<typename T>
+void encode(Writer &w, const std::vector<T> &v)
+{
+    w.arrayHeader(v.size());
+    for(auto &x : v) encode(w, x);
+}
+
+inline void decode(Reader &r, std::string &v) {boost::string_ref s = r.string(); v.assign(s.data(), s.size());}
+
+inline void decode(Reader &r, bool &v) {v = r.boolean();}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type decode(Reader &r, T &v)
+{
+    int64_t x = r.integer();
+    if(x < std::numeric_limits<T>::min() || x > std::numeric_limits<T>::max()) Reader::error();
+    v = static_cast<T>(x);
+}
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value>::type decode(Reader &r, T &v)
+{
+    uint64_t x = r.uinteger();
+    if(x > std::numeric_limits<T>::max()) Reader::error();
+    v = static_cast<T>(x);
+}
+
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type decode(Reader &r, T &v) {v = static_cast<T>(r.real());}
+
+template<typename T>
+void decode(Reader &r, boost::optional<T> &v)
+{
+    if(r.isNil())
+    {
+        r.nil();
+        v = boost::none;
+        return;
+    }
+    if(!v) v = T();
+    decode(r, *v);
+}
+
+template<typename T>
+void decode(Reader &r, std::vector<T> &v)
+{
+    size_t n = r.arrayHeader();
+    // the elements already there are decoded in place, keeping the capacity of their own
+    // strings and vectors (see b0::message::reset())
+    size_t reused = n < v.size() ? n : v.size();
+    for(size_t i = 0; i < reused; i++)
+        decode(r, v[i]);
+    v.resize(reused);
+    if(reused == n) return;
+    v.reserve(n < 1024 ? n : 1024);
+    for(size_t i = reused; i < n; i++)
+    {
+        v.emplace_back();
+        decode(r, v.back());
+    }
+}
+
+// optional fields which hold no value are left out of the encoded map
+template<typename M>
+inline bool hasValue(const M &) {return true;}
+
+template<typename M>
+inline bool hasValue(const boost::optional<M> &v) {return static_cast<bool>(v);}
+
+//! Counts the fields to encode
+template<typename T>
+struct FieldCounter
+{
+    const T *obj;
+    size_t count;
+
+    template<typename N, typename M>
+    void required(const N &, M T::*) {count++;}
+
+    template<typename N, typename M>
+    void optional(const N &, M T::*member) {if(hasValue(obj->*member)) count++;}
+};
+
+//! Encodes the fields as map entries
+template<typename T>
+struct FieldEncoder
+{
+    Writer *w;
+    const T *obj;
+
+    template<typename N, typename M>
+    void required(const N &name, M T::*member)
+    {
+        w->string(name);
+        encode(*w, obj->*member);
+    }
+
+    template<typename N, typename M>
+    void optional(const N &name, M T::*member)
+    {
+        if(!hasValue(obj->*member)) return;
+        w->string(name);
+        encode(*w, obj->*member);
+    }
+};
+
+//! Decodes the value of the field with the given key (if any), and tracks the required fields seen
+template<typename T>
+struct FieldDecoder
+{
+    Reader *r;
+    T *obj;
+    boost::string_ref key;
+    bool found;
+    size_t index;
+    uint64_t required_seen;
+    uint64_t required_all;
+
+    template<typename N, typename M>
+    void required(const N &name, M T::*member)
+    {
+        uint64_t bit = index < 64 ? uint64_t(1) << index : 0;
+        index++;
+        required_all |= bit;
+        if(found || key != boost::string_ref(name)) return;
+        decode(*r, obj->*member);
+        found = true;
+        required_seen |= bit;
+    }
+
+    template<typename N, typename M>
+    void optional(const N &name, M T::*member)
+    {
+        index++;
+        if(found || key != boost::string_ref(name)) return;
+        decode(*r, obj->*member);
+        found = true;
+    }
+};
+
+//! Assigns the fields from a default-constructed instance (copy assignment keeps the capacity)
+template<typename T>
+struct FieldResetter
+{
+    T *obj;
+    const T *proto;
+
+    template<typename N, typename M>
+    void required(const N &, M T::*member) {obj->*member = proto->*member;}
+
+    template<typename N, typename M>
+    void optional(const N &, M T::*member) {obj->*member = proto->*member;}
+};
+
+template<typename T>
+typename std::enable_if<has_describe<T>::value>::type encode(Writer &w, const T &v)
+{
+    FieldCounter<T> counter{&v, 0};
+    spotify::json::default_codec_t<T>::describe(counter);
+    w.mapHeader(counter.count);
+    FieldEncoder<T> encoder{&w, &v};
+    spotify::json::default_codec_t<T>::describe(encoder);
+}
+
+template<typename T>
+typename std::enable_if<has_describe<T>::value>::type decode(Reader &r, T &v)
+{
+    size_t n = r.mapHeader();
+    FieldDecoder<T> decoder{&r, &v, boost::string_ref(), false, 0, 0, 0};
+    for(size_t i = 0; i < n; i++)
+    {
+        decoder.key = r.string();
+        decoder.found = false;
+        decoder.index = 0;
+        spotify::json::default_codec_t<T>::describe(decoder);
+        if(!decoder.found) r.skip();
+    }
+    if(decoder.index == 0)
+    {
+        // the message has no fields: still compute the set of required ones
+        decoder.key = boost::string_ref();
+        decoder.found = true;
+        spotify::json::default_codec_t<T>::describe(decoder);
+    }
+    if((decoder.required_seen & decoder.required_all) != decoder.required_all)
+        throw exception::MessageUnpackError("msgpack parse error: missing required field");
+}
+
+//! \endcond
+
+/*!
+ * \brief Encode a message with MessagePack
+ */
+template<typename T>
+void encode(const T &msg, std::string &s)
+{
+    s.clear();
+    Writer w(s);
+    encode(w, msg);
+}
+
+/*!
+ * \brief Decode a message encoded with MessagePack
+ */
+template<typename T>
+void decode(T &msg, const char *data, size_t size)
+{
+    Reader r(data, size);
+    decode(r, msg);
+    if(!r.atEnd())
+        Reader::error();
+}
+
+} // namespace msgpack
+
+} // namespace message
+
+} // namespace b0
+
+#endif // B0__MESSAGE__MSGPACK_H__INCLUDED
@@ -36,8 +36,13 @@ public:
     //! The name of the node
     std::string node_name;
 
+    //! If true, the node only makes lookups: it is not added to the graph, and its name is not made unique
+    bool ephemeral{false};
+
 public:
-    std::string type() const override {return "b0.message.resolv.AnnounceNodeRequest";}
+    static constexpr const char *b0_type = "b0.message.resolv.AnnounceNodeRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -59,12 +64,19 @@ using b0::message::resolv::AnnounceNodeRequest;
 template <>
 struct default_codec_t<AnnounceNodeRequest>
 {
-    static codec::object_t<AnnounceNodeRequest> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<AnnounceNodeRequest>();
         codec.required("host_id", &AnnounceNodeRequest::host_id);
         codec.required("process_id", &AnnounceNodeRequest::process_id);
         codec.required("node_name", &AnnounceNodeRequest::node_name);
+        codec.optional("ephemeral", &AnnounceNodeRequest::ephemeral);
+    }
+
+    static codec::object_t<AnnounceNodeRequest> codec()
+    {
+        auto codec = codec::object<AnnounceNodeRequest>();
+        describe(codec);
         return codec;
     }
 };
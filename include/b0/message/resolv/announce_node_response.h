@@ -2,9 +2,11 @@
 #define B0__MESSAGE__RESOLV__ANNOUNCE_NODE_RESPONSE_H__INCLUDED
 
 #include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include <b0/b0.h>
 #include <b0/message/message.h>
+#include <b0/message/resolv/topic_proxy.h>
 
 namespace b0
 {
@@ -22,6 +24,21 @@ namespace resolv
  *
  * It assigns node's final name and gives the socket addresses for XPUB/XSUB proxies.
  *
+ * If the resolver runs more than one proxy, the addresses of all the proxies are listed in
+ * xsub_sock_addrs and xpub_sock_addrs (the first being the same as xsub_sock_addr and
+ * xpub_sock_addr). A topic uses the proxy given in topic_proxies, or otherwise the proxy
+ * selected by the hash of its name (see b0::Node::getXPUBSocketAddress()).
+ *
+ * If the resolver binds IPC endpoints too (see b0::setIPC()), xsub_ipc_addrs and
+ * xpub_ipc_addrs list them for all the proxies, for the nodes on the same host.
+ *
+ * The proxies reserved to the high-priority topics (see b0::Socket::setHighPriority()) are
+ * listed apart, in xsub_priority_sock_addrs and xpub_priority_sock_addrs (and their IPC
+ * endpoints), so that the hash of the other topics does not depend on them.
+ *
+ * If heartbeat_topic is set, the heartbeats which do not need the time of the resolver can
+ * be published on that topic (through the proxy) instead of being sent as requests.
+ *
  * \sa AnnounceNodeRequest, \ref protocol
  */
 class AnnounceNodeResponse : public Message
@@ -42,8 +59,40 @@ public:
     //! Minimum heartbeat interval (in usec), or 0 if not required
     int64_t minimum_heartbeat_interval;
 
+    //! Addresses of the XSUB zmq sockets of all the proxies
+    std::vector<std::string> xsub_sock_addrs;
+
+    //! Addresses of the XPUB zmq sockets of all the proxies
+    std::vector<std::string> xpub_sock_addrs;
+
+    //! IPC endpoints of the XSUB zmq sockets of all the proxies (empty if none)
+    std::vector<std::string> xsub_ipc_addrs;
+
+    //! IPC endpoints of the XPUB zmq sockets of all the proxies (empty if none)
+    std::vector<std::string> xpub_ipc_addrs;
+
+    //! Explicit assignments of topics to proxies
+    std::vector<TopicProxy> topic_proxies;
+
+    //! Addresses of the XSUB zmq sockets of the high-priority proxies (empty if none)
+    std::vector<std::string> xsub_priority_sock_addrs;
+
+    //! Addresses of the XPUB zmq sockets of the high-priority proxies (empty if none)
+    std::vector<std::string> xpub_priority_sock_addrs;
+
+    //! IPC endpoints of the XSUB zmq sockets of the high-priority proxies (empty if none)
+    std::vector<std::string> xsub_priority_ipc_addrs;
+
+    //! IPC endpoints of the XPUB zmq sockets of the high-priority proxies (empty if none)
+    std::vector<std::string> xpub_priority_ipc_addrs;
+
+    //! Topic on which the resolver accepts heartbeats without replying (empty if not supported)
+    std::string heartbeat_topic;
+
 public:
-    std::string type() const override {return "b0.message.resolv.AnnounceNodeResponse";}
+    static constexpr const char *b0_type = "b0.message.resolv.AnnounceNodeResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -65,14 +114,30 @@ using b0::message::resolv::AnnounceNodeResponse;
 template <>
 struct default_codec_t<AnnounceNodeResponse>
 {
-    static codec::object_t<AnnounceNodeResponse> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<AnnounceNodeResponse>();
         codec.required("ok", &AnnounceNodeResponse::ok);
         codec.required("node_name", &AnnounceNodeResponse::node_name);
         codec.required("xsub_sock_addr", &AnnounceNodeResponse::xsub_sock_addr);
         codec.required("xpub_sock_addr", &AnnounceNodeResponse::xpub_sock_addr);
         codec.required("minimum_heartbeat_interval", &AnnounceNodeResponse::minimum_heartbeat_interval);
+        codec.optional("xsub_sock_addrs", &AnnounceNodeResponse::xsub_sock_addrs);
+        codec.optional("xpub_sock_addrs", &AnnounceNodeResponse::xpub_sock_addrs);
+        codec.optional("topic_proxies", &AnnounceNodeResponse::topic_proxies);
+        codec.optional("heartbeat_topic", &AnnounceNodeResponse::heartbeat_topic);
+        codec.optional("xsub_ipc_addrs", &AnnounceNodeResponse::xsub_ipc_addrs);
+        codec.optional("xpub_ipc_addrs", &AnnounceNodeResponse::xpub_ipc_addrs);
+        codec.optional("xsub_priority_sock_addrs", &AnnounceNodeResponse::xsub_priority_sock_addrs);
+        codec.optional("xpub_priority_sock_addrs", &AnnounceNodeResponse::xpub_priority_sock_addrs);
+        codec.optional("xsub_priority_ipc_addrs", &AnnounceNodeResponse::xsub_priority_ipc_addrs);
+        codec.optional("xpub_priority_ipc_addrs", &AnnounceNodeResponse::xpub_priority_ipc_addrs);
+    }
+
+    static codec::object_t<AnnounceNodeResponse> codec()
+    {
+        auto codec = codec::object<AnnounceNodeResponse>();
+        describe(codec);
         return codec;
     }
 };
@@ -20,7 +20,8 @@ namespace resolv
  *
  * \mscfile node-startup-service.msc
  *
- * The service name must be unique.
+ * Several servers can announce the same service name, at different addresses: the
+ * clients then distribute their requests among them.
  *
  * \sa AnnounceServiceResponse, \ref protocol
  */
@@ -36,8 +37,13 @@ public:
     //! The address of the zmq socket
     std::string sock_addr;
 
+    //! The IPC endpoint of the zmq socket, for the nodes on the same host (optional)
+    std::string ipc_addr;
+
 public:
-    std::string type() const override {return "b0.message.resolv.AnnounceServiceRequest";}
+    static constexpr const char *b0_type = "b0.message.resolv.AnnounceServiceRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -59,12 +65,19 @@ using b0::message::resolv::AnnounceServiceRequest;
 template <>
 struct default_codec_t<AnnounceServiceRequest>
 {
-    static codec::object_t<AnnounceServiceRequest> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<AnnounceServiceRequest>();
         codec.required("node_name", &AnnounceServiceRequest::node_name);
         codec.required("service_name", &AnnounceServiceRequest::service_name);
         codec.required("sock_addr", &AnnounceServiceRequest::sock_addr);
+        codec.optional("ipc_addr", &AnnounceServiceRequest::ipc_addr);
+    }
+
+    static codec::object_t<AnnounceServiceRequest> codec()
+    {
+        auto codec = codec::object<AnnounceServiceRequest>();
+        describe(codec);
         return codec;
     }
 };
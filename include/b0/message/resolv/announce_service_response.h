@@ -27,7 +27,9 @@ public:
     bool ok;
 
 public:
-    std::string type() const override {return "b0.message.resolv.AnnounceServiceResponse";}
+    static constexpr const char *b0_type = "b0.message.resolv.AnnounceServiceResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -49,10 +51,16 @@ using b0::message::resolv::AnnounceServiceResponse;
 template <>
 struct default_codec_t<AnnounceServiceResponse>
 {
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("ok", &AnnounceServiceResponse::ok);
+    }
+
     static codec::object_t<AnnounceServiceResponse> codec()
     {
         auto codec = codec::object<AnnounceServiceResponse>();
-        codec.required("ok", &AnnounceServiceResponse::ok);
+        describe(codec);
         return codec;
     }
 };
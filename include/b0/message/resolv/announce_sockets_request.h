@@ -0,0 +1,101 @@
+#ifndef B0__MESSAGE__RESOLV__ANNOUNCE_SOCKETS_REQUEST_H__INCLUDED
+#define B0__MESSAGE__RESOLV__ANNOUNCE_SOCKETS_REQUEST_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/resolv/announce_service_request.h>
+#include <b0/message/resolv/announce_topic_request.h>
+#include <b0/message/graph/node_topic_request.h>
+#include <b0/message/graph/node_service_request.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Sent by node to announce the services, topics and graph links of all its sockets at once
+ *
+ * During Node::init() the announcements and graph notifications of the sockets are
+ * collected, and sent with this single request, instead of one request each.
+ * The resolver handles them as if they were sent one by one, in this order: services,
+ * topics, node topics, node services.
+ *
+ * \sa AnnounceSocketsResponse, AnnounceServiceRequest, AnnounceTopicRequest,
+ *     graph::NodeTopicRequest, graph::NodeServiceRequest, \ref protocol
+ */
+class AnnounceSocketsRequest : public Message
+{
+public:
+    //! The name of the node
+    std::string node_name;
+
+    //! The services announced
+    std::vector<AnnounceServiceRequest> services;
+
+    //! The topics announced
+    std::vector<AnnounceTopicRequest> topics;
+
+    //! The topics published or subscribed
+    std::vector<graph::NodeTopicRequest> node_topics;
+
+    //! The services offered or used
+    std::vector<graph::NodeServiceRequest> node_services;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.AnnounceSocketsRequest";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::AnnounceSocketsRequest;
+
+template <>
+struct default_codec_t<AnnounceSocketsRequest>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("node_name", &AnnounceSocketsRequest::node_name);
+        codec.optional("services", &AnnounceSocketsRequest::services);
+        codec.optional("topics", &AnnounceSocketsRequest::topics);
+        codec.optional("node_topics", &AnnounceSocketsRequest::node_topics);
+        codec.optional("node_services", &AnnounceSocketsRequest::node_services);
+    }
+
+    static codec::object_t<AnnounceSocketsRequest> codec()
+    {
+        auto codec = codec::object<AnnounceSocketsRequest>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__ANNOUNCE_SOCKETS_REQUEST_H__INCLUDED
@@ -0,0 +1,79 @@
+#ifndef B0__MESSAGE__RESOLV__ANNOUNCE_SOCKETS_RESPONSE_H__INCLUDED
+#define B0__MESSAGE__RESOLV__ANNOUNCE_SOCKETS_RESPONSE_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Response to AnnounceSocketsRequest message
+ *
+ * \sa AnnounceSocketsRequest, \ref protocol
+ */
+class AnnounceSocketsResponse : public Message
+{
+public:
+    //! True if all the announcements were successful
+    bool ok;
+
+    //! The names of the services and topics whose announcement failed
+    std::vector<std::string> failed;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.AnnounceSocketsResponse";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::AnnounceSocketsResponse;
+
+template <>
+struct default_codec_t<AnnounceSocketsResponse>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("ok", &AnnounceSocketsResponse::ok);
+        codec.optional("failed", &AnnounceSocketsResponse::failed);
+    }
+
+    static codec::object_t<AnnounceSocketsResponse> codec()
+    {
+        auto codec = codec::object<AnnounceSocketsResponse>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__ANNOUNCE_SOCKETS_RESPONSE_H__INCLUDED
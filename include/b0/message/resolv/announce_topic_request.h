@@ -0,0 +1,90 @@
+#ifndef B0__MESSAGE__RESOLV__ANNOUNCE_TOPIC_REQUEST_H__INCLUDED
+#define B0__MESSAGE__RESOLV__ANNOUNCE_TOPIC_REQUEST_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Sent by a Publisher in peer-to-peer mode to announce the address it is bound to
+ *
+ * Publishers are bound to their own address only in peer-to-peer mode (see
+ * b0::setPeerToPeer()), otherwise they connect to the resolver's XSUB socket.
+ * Many publishers can announce the same topic.
+ *
+ * \sa AnnounceTopicResponse, \ref protocol
+ */
+class AnnounceTopicRequest : public Message
+{
+public:
+    //! The name of the node
+    std::string node_name;
+
+    //! The name of the topic
+    std::string topic_name;
+
+    //! The address of the zmq socket
+    std::string sock_addr;
+
+    //! The IPC endpoint of the zmq socket, for the nodes on the same host (optional)
+    std::string ipc_addr;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.AnnounceTopicRequest";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::AnnounceTopicRequest;
+
+template <>
+struct default_codec_t<AnnounceTopicRequest>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("node_name", &AnnounceTopicRequest::node_name);
+        codec.required("topic_name", &AnnounceTopicRequest::topic_name);
+        codec.required("sock_addr", &AnnounceTopicRequest::sock_addr);
+        codec.optional("ipc_addr", &AnnounceTopicRequest::ipc_addr);
+    }
+
+    static codec::object_t<AnnounceTopicRequest> codec()
+    {
+        auto codec = codec::object<AnnounceTopicRequest>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__ANNOUNCE_TOPIC_REQUEST_H__INCLUDED
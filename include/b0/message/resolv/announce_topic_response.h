@@ -0,0 +1,72 @@
+#ifndef B0__MESSAGE__RESOLV__ANNOUNCE_TOPIC_RESPONSE_H__INCLUDED
+#define B0__MESSAGE__RESOLV__ANNOUNCE_TOPIC_RESPONSE_H__INCLUDED
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Response to AnnounceTopicRequest message
+ *
+ * \sa AnnounceTopicRequest, \ref protocol
+ */
+class AnnounceTopicResponse : public Message
+{
+public:
+    //! True if successful, false if error
+    bool ok;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.AnnounceTopicResponse";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::AnnounceTopicResponse;
+
+template <>
+struct default_codec_t<AnnounceTopicResponse>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("ok", &AnnounceTopicResponse::ok);
+    }
+
+    static codec::object_t<AnnounceTopicResponse> codec()
+    {
+        auto codec = codec::object<AnnounceTopicResponse>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__ANNOUNCE_TOPIC_RESPONSE_H__INCLUDED
@@ -0,0 +1,81 @@
+#ifndef B0__MESSAGE__RESOLV__CONTENT_TYPE_ID_REQUEST_H__INCLUDED
+#define B0__MESSAGE__RESOLV__CONTENT_TYPE_ID_REQUEST_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Sent by a node to get the integer id of a content type, or the content type of an id
+ *
+ * If content_type is not empty, the resolver returns its id, assigning the next free one
+ * if the content type is new; otherwise it returns the content type of the given id.
+ *
+ * \sa ContentTypeIdResponse, b0::message::getContentTypeId(), \ref protocol
+ */
+class ContentTypeIdRequest : public Message
+{
+public:
+    //! The content type to register (or empty, to look up id)
+    std::string content_type;
+
+    //! The id to look up (if content_type is empty)
+    int64_t id{-1};
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.ContentTypeIdRequest";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::ContentTypeIdRequest;
+
+template <>
+struct default_codec_t<ContentTypeIdRequest>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.optional("content_type", &ContentTypeIdRequest::content_type);
+        codec.optional("id", &ContentTypeIdRequest::id);
+    }
+
+    static codec::object_t<ContentTypeIdRequest> codec()
+    {
+        auto codec = codec::object<ContentTypeIdRequest>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__CONTENT_TYPE_ID_REQUEST_H__INCLUDED
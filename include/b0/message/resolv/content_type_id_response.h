@@ -0,0 +1,82 @@
+#ifndef B0__MESSAGE__RESOLV__CONTENT_TYPE_ID_RESPONSE_H__INCLUDED
+#define B0__MESSAGE__RESOLV__CONTENT_TYPE_ID_RESPONSE_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Response to ContentTypeIdRequest message
+ *
+ * \sa ContentTypeIdRequest, \ref protocol
+ */
+class ContentTypeIdResponse : public Message
+{
+public:
+    //! True if successful, false if the resolver does not know the id
+    bool ok;
+
+    //! The content type
+    std::string content_type;
+
+    //! The id of the content type
+    int64_t id{-1};
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.ContentTypeIdResponse";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::ContentTypeIdResponse;
+
+template <>
+struct default_codec_t<ContentTypeIdResponse>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("ok", &ContentTypeIdResponse::ok);
+        codec.optional("content_type", &ContentTypeIdResponse::content_type);
+        codec.optional("id", &ContentTypeIdResponse::id);
+    }
+
+    static codec::object_t<ContentTypeIdResponse> codec()
+    {
+        auto codec = codec::object<ContentTypeIdResponse>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__CONTENT_TYPE_ID_RESPONSE_H__INCLUDED
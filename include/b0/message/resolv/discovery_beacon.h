@@ -0,0 +1,101 @@
+#ifndef B0__MESSAGE__RESOLV__DISCOVERY_BEACON_H__INCLUDED
+#define B0__MESSAGE__RESOLV__DISCOVERY_BEACON_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/graph/graph.h>
+#include <b0/message/resolv/announce_service_request.h>
+#include <b0/message/resolv/announce_topic_request.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Broadcast periodically over UDP by each process in decentralized mode
+ *
+ * It contains the nodes of the process, with the services and the peer-to-peer
+ * publishers they announced. A process stopping sends a last beacon with leaving set.
+ *
+ * \sa b0::resolver::Discovery, b0::setDecentralized(), \ref protocol
+ */
+class DiscoveryBeacon : public Message
+{
+public:
+    //! The hostname of the process
+    std::string host_id;
+
+    //! The process id
+    int process_id;
+
+    //! True if the process is stopping (the other fields are empty then)
+    bool leaving{false};
+
+    //! The nodes of the process and the links between them, topics and services
+    b0::message::graph::Graph graph;
+
+    //! The services, each with the node offering it and its address
+    std::vector<AnnounceServiceRequest> services;
+
+    //! The peer-to-peer publishers, each with the node and its address
+    std::vector<AnnounceTopicRequest> topics;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.DiscoveryBeacon";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::DiscoveryBeacon;
+
+template <>
+struct default_codec_t<DiscoveryBeacon>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("host_id", &DiscoveryBeacon::host_id);
+        codec.required("process_id", &DiscoveryBeacon::process_id);
+        codec.optional("leaving", &DiscoveryBeacon::leaving);
+        codec.optional("graph", &DiscoveryBeacon::graph);
+        codec.optional("services", &DiscoveryBeacon::services);
+        codec.optional("topics", &DiscoveryBeacon::topics);
+    }
+
+    static codec::object_t<DiscoveryBeacon> codec()
+    {
+        auto codec = codec::object<DiscoveryBeacon>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__DISCOVERY_BEACON_H__INCLUDED
@@ -0,0 +1,86 @@
+#ifndef B0__MESSAGE__RESOLV__FEDERATION_ENTRY_H__INCLUDED
+#define B0__MESSAGE__RESOLV__FEDERATION_ENTRY_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief A service or a topic of a site of a federation of resolvers
+ *
+ * For a service, the addresses are the ones of its servers; for a topic, the address is
+ * the one of the XPUB proxy of the site the topic is published to.
+ *
+ * \sa SyncDirectoryRequest, SyncDirectoryResponse, \ref protocol
+ */
+class FederationEntry : public Message
+{
+public:
+    //! The name of the service or topic
+    std::string name;
+
+    //! The address of the resolver of the site
+    std::string site;
+
+    //! The addresses of the servers (service), or of the XPUB proxy (topic)
+    std::vector<std::string> sock_addrs;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.FederationEntry";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::FederationEntry;
+
+template <>
+struct default_codec_t<FederationEntry>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("name", &FederationEntry::name);
+        codec.required("site", &FederationEntry::site);
+        codec.required("sock_addrs", &FederationEntry::sock_addrs);
+    }
+
+    static codec::object_t<FederationEntry> codec()
+    {
+        auto codec = codec::object<FederationEntry>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__FEDERATION_ENTRY_H__INCLUDED
@@ -0,0 +1,74 @@
+#ifndef B0__MESSAGE__RESOLV__GET_COMPRESSION_DICTIONARY_REQUEST_H__INCLUDED
+#define B0__MESSAGE__RESOLV__GET_COMPRESSION_DICTIONARY_REQUEST_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Sent by a node to fetch a compression dictionary it has not seen yet
+ *
+ * \sa GetCompressionDictionaryResponse, \ref protocol
+ */
+class GetCompressionDictionaryRequest : public Message
+{
+public:
+    //! The id of the dictionary (as in the Compression-dictionary-# envelope header)
+    std::string dictionary_id;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.GetCompressionDictionaryRequest";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::GetCompressionDictionaryRequest;
+
+template <>
+struct default_codec_t<GetCompressionDictionaryRequest>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("dictionary_id", &GetCompressionDictionaryRequest::dictionary_id);
+    }
+
+    static codec::object_t<GetCompressionDictionaryRequest> codec()
+    {
+        auto codec = codec::object<GetCompressionDictionaryRequest>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__GET_COMPRESSION_DICTIONARY_REQUEST_H__INCLUDED
@@ -0,0 +1,78 @@
+#ifndef B0__MESSAGE__RESOLV__GET_COMPRESSION_DICTIONARY_RESPONSE_H__INCLUDED
+#define B0__MESSAGE__RESOLV__GET_COMPRESSION_DICTIONARY_RESPONSE_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Response to GetCompressionDictionaryRequest message
+ *
+ * \sa GetCompressionDictionaryRequest, \ref protocol
+ */
+class GetCompressionDictionaryResponse : public Message
+{
+public:
+    //! True if successful, false if the resolver does not know the dictionary
+    bool ok;
+
+    //! The content of the dictionary, hex-encoded
+    std::string data;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.GetCompressionDictionaryResponse";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::GetCompressionDictionaryResponse;
+
+template <>
+struct default_codec_t<GetCompressionDictionaryResponse>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("ok", &GetCompressionDictionaryResponse::ok);
+        codec.required("data", &GetCompressionDictionaryResponse::data);
+    }
+
+    static codec::object_t<GetCompressionDictionaryResponse> codec()
+    {
+        auto codec = codec::object<GetCompressionDictionaryResponse>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__GET_COMPRESSION_DICTIONARY_RESPONSE_H__INCLUDED
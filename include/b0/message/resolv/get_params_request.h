@@ -0,0 +1,74 @@
+#ifndef B0__MESSAGE__RESOLV__GET_PARAMS_REQUEST_H__INCLUDED
+#define B0__MESSAGE__RESOLV__GET_PARAMS_REQUEST_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Sent by a node to fetch the parameters whose name starts with a prefix
+ *
+ * \sa GetParamsResponse, \ref protocol
+ */
+class GetParamsRequest : public Message
+{
+public:
+    //! The prefix of the names of the parameters (empty for all of them)
+    std::string prefix;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.GetParamsRequest";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::GetParamsRequest;
+
+template <>
+struct default_codec_t<GetParamsRequest>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("prefix", &GetParamsRequest::prefix);
+    }
+
+    static codec::object_t<GetParamsRequest> codec()
+    {
+        auto codec = codec::object<GetParamsRequest>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__GET_PARAMS_REQUEST_H__INCLUDED
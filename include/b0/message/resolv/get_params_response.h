@@ -0,0 +1,84 @@
+#ifndef B0__MESSAGE__RESOLV__GET_PARAMS_RESPONSE_H__INCLUDED
+#define B0__MESSAGE__RESOLV__GET_PARAMS_RESPONSE_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/resolv/param.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Response to GetParamsRequest message
+ *
+ * \sa GetParamsRequest, \ref protocol
+ */
+class GetParamsResponse : public Message
+{
+public:
+    //! True if successful
+    bool ok;
+
+    //! The version of the parameters (see ParamUpdate)
+    int64_t version;
+
+    //! The parameters matching the prefix
+    std::vector<Param> params;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.GetParamsResponse";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::GetParamsResponse;
+
+template <>
+struct default_codec_t<GetParamsResponse>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("ok", &GetParamsResponse::ok);
+        codec.required("version", &GetParamsResponse::version);
+        codec.required("params", &GetParamsResponse::params);
+    }
+
+    static codec::object_t<GetParamsResponse> codec()
+    {
+        auto codec = codec::object<GetParamsResponse>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__GET_PARAMS_RESPONSE_H__INCLUDED
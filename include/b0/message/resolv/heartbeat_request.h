@@ -2,9 +2,11 @@
 #define B0__MESSAGE__RESOLV__HEARTBEAT_REQUEST_H__INCLUDED
 
 #include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include <b0/b0.h>
 #include <b0/message/message.h>
+#include <b0/message/graph/node_stats.h>
 
 namespace b0
 {
@@ -28,8 +30,16 @@ public:
     //! The name of the node
     std::string node_name;
 
+    //! The names of the other nodes of the same process, when the heartbeats are coalesced
+    std::vector<std::string> other_node_names;
+
+    //! The resource usage of the node and of the other nodes (only if enabled, see b0::setHeartbeatStats())
+    std::vector<b0::message::graph::NodeStats> stats;
+
 public:
-    std::string type() const override {return "b0.message.resolv.HeartbeatRequest";}
+    static constexpr const char *b0_type = "b0.message.resolv.HeartbeatRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -51,10 +61,18 @@ using b0::message::resolv::HeartbeatRequest;
 template <>
 struct default_codec_t<HeartbeatRequest>
 {
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("node_name", &HeartbeatRequest::node_name);
+        codec.optional("other_node_names", &HeartbeatRequest::other_node_names);
+        codec.optional("stats", &HeartbeatRequest::stats);
+    }
+
     static codec::object_t<HeartbeatRequest> codec()
     {
         auto codec = codec::object<HeartbeatRequest>();
-        codec.required("node_name", &HeartbeatRequest::node_name);
+        describe(codec);
         return codec;
     }
 };
@@ -30,7 +30,9 @@ public:
     int64_t time_usec;
 
 public:
-    std::string type() const override {return "b0.message.resolv.HeartbeatResponse";}
+    static constexpr const char *b0_type = "b0.message.resolv.HeartbeatResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -52,11 +54,17 @@ using b0::message::resolv::HeartbeatResponse;
 template <>
 struct default_codec_t<HeartbeatResponse>
 {
-    static codec::object_t<HeartbeatResponse> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<HeartbeatResponse>();
         codec.required("ok", &HeartbeatResponse::ok);
         codec.required("time_usec", &HeartbeatResponse::time_usec);
+    }
+
+    static codec::object_t<HeartbeatResponse> codec()
+    {
+        auto codec = codec::object<HeartbeatResponse>();
+        describe(codec);
         return codec;
     }
 };
@@ -0,0 +1,78 @@
+#ifndef B0__MESSAGE__RESOLV__PARAM_H__INCLUDED
+#define B0__MESSAGE__RESOLV__PARAM_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief A parameter, with its value
+ *
+ * \sa GetParamsResponse, ParamUpdate, \ref protocol
+ */
+class Param : public Message
+{
+public:
+    //! The name of the parameter
+    std::string name;
+
+    //! The value of the parameter
+    std::string value;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.Param";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::Param;
+
+template <>
+struct default_codec_t<Param>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("name", &Param::name);
+        codec.required("value", &Param::value);
+    }
+
+    static codec::object_t<Param> codec()
+    {
+        auto codec = codec::object<Param>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__PARAM_H__INCLUDED
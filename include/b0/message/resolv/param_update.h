@@ -0,0 +1,87 @@
+#ifndef B0__MESSAGE__RESOLV__PARAM_UPDATE_H__INCLUDED
+#define B0__MESSAGE__RESOLV__PARAM_UPDATE_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/resolv/param.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Published by the resolver on the "param" topic when parameters change
+ *
+ * Each change increments the version of the parameters; a node which fetched the parameters
+ * with GetParamsRequest ignores the updates older than the version of the response.
+ *
+ * \sa SetParamRequest, \ref protocol
+ */
+class ParamUpdate : public Message
+{
+public:
+    //! The version of the parameters after this change
+    int64_t version;
+
+    //! The parameters set, with their new value
+    std::vector<Param> params;
+
+    //! The names of the parameters removed
+    std::vector<std::string> removed;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.ParamUpdate";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::ParamUpdate;
+
+template <>
+struct default_codec_t<ParamUpdate>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("version", &ParamUpdate::version);
+        codec.required("params", &ParamUpdate::params);
+        codec.required("removed", &ParamUpdate::removed);
+    }
+
+    static codec::object_t<ParamUpdate> codec()
+    {
+        auto codec = codec::object<ParamUpdate>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__PARAM_UPDATE_H__INCLUDED
@@ -9,10 +9,19 @@
 #include <b0/message/resolv/shutdown_node_request.h>
 #include <b0/message/resolv/announce_service_request.h>
 #include <b0/message/resolv/resolve_service_request.h>
+#include <b0/message/resolv/announce_topic_request.h>
+#include <b0/message/resolv/resolve_topic_request.h>
 #include <b0/message/resolv/heartbeat_request.h>
 #include <b0/message/graph/node_topic_request.h>
 #include <b0/message/graph/node_service_request.h>
 #include <b0/message/graph/get_graph_request.h>
+#include <b0/message/resolv/get_compression_dictionary_request.h>
+#include <b0/message/resolv/announce_sockets_request.h>
+#include <b0/message/resolv/sync_state_request.h>
+#include <b0/message/resolv/get_params_request.h>
+#include <b0/message/resolv/set_param_request.h>
+#include <b0/message/resolv/content_type_id_request.h>
+#include <b0/message/resolv/sync_directory_request.h>
 
 namespace b0
 {
@@ -43,6 +52,12 @@ public:
     //! \brief Message for the ResolveServiceRequest
     boost::optional<ResolveServiceRequest> resolve_service;
 
+    //! \brief Message for the AnnounceTopicRequest
+    boost::optional<AnnounceTopicRequest> announce_topic;
+
+    //! \brief Message for the ResolveTopicRequest
+    boost::optional<ResolveTopicRequest> resolve_topic;
+
     //! \brief Message for the HeartbeatRequest
     boost::optional<HeartbeatRequest> heartbeat;
 
@@ -55,8 +70,31 @@ public:
     //! \brief Message for the GetGraphRequest
     boost::optional<graph::GetGraphRequest> get_graph;
 
+    //! \brief Message for the GetCompressionDictionaryRequest
+    boost::optional<GetCompressionDictionaryRequest> get_compression_dictionary;
+
+    //! \brief Message for the AnnounceSocketsRequest
+    boost::optional<AnnounceSocketsRequest> announce_sockets;
+
+    //! \brief Message for the SyncStateRequest
+    boost::optional<SyncStateRequest> sync_state;
+
+    //! \brief Message for the GetParamsRequest
+    boost::optional<GetParamsRequest> get_params;
+
+    //! \brief Message for the SetParamRequest
+    boost::optional<SetParamRequest> set_param;
+
+    //! \brief Message for the ContentTypeIdRequest
+    boost::optional<ContentTypeIdRequest> content_type_id;
+
+    //! \brief Message for the SyncDirectoryRequest
+    boost::optional<SyncDirectoryRequest> sync_directory;
+
 public:
-    std::string type() const override {return "b0.message.resolv.Request";}
+    static constexpr const char *b0_type = "b0.message.resolv.Request";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -78,17 +116,32 @@ using b0::message::resolv::Request;
 template <>
 struct default_codec_t<Request>
 {
-    static codec::object_t<Request> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<Request>();
         codec.optional("announce_node", &Request::announce_node);
         codec.optional("shutdown_node", &Request::shutdown_node);
         codec.optional("announce_service", &Request::announce_service);
         codec.optional("resolve_service", &Request::resolve_service);
+        codec.optional("announce_topic", &Request::announce_topic);
+        codec.optional("resolve_topic", &Request::resolve_topic);
         codec.optional("heartbeat", &Request::heartbeat);
         codec.optional("node_topic", &Request::node_topic);
         codec.optional("node_service", &Request::node_service);
         codec.optional("get_graph", &Request::get_graph);
+        codec.optional("get_compression_dictionary", &Request::get_compression_dictionary);
+        codec.optional("announce_sockets", &Request::announce_sockets);
+        codec.optional("sync_state", &Request::sync_state);
+        codec.optional("get_params", &Request::get_params);
+        codec.optional("set_param", &Request::set_param);
+        codec.optional("content_type_id", &Request::content_type_id);
+        codec.optional("sync_directory", &Request::sync_directory);
+    }
+
+    static codec::object_t<Request> codec()
+    {
+        auto codec = codec::object<Request>();
+        describe(codec);
         return codec;
     }
 };
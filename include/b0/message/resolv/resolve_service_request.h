@@ -29,7 +29,9 @@ public:
     std::string service_name;
 
 public:
-    std::string type() const override {return "b0.message.resolv.ResolveServiceRequest";}
+    static constexpr const char *b0_type = "b0.message.resolv.ResolveServiceRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -51,10 +53,16 @@ using b0::message::resolv::ResolveServiceRequest;
 template <>
 struct default_codec_t<ResolveServiceRequest>
 {
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("service_name", &ResolveServiceRequest::service_name);
+    }
+
     static codec::object_t<ResolveServiceRequest> codec()
     {
         auto codec = codec::object<ResolveServiceRequest>();
-        codec.required("service_name", &ResolveServiceRequest::service_name);
+        describe(codec);
         return codec;
     }
 };
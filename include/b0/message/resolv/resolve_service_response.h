@@ -2,6 +2,7 @@
 #define B0__MESSAGE__RESOLV__RESOLVE_SERVICE_RESPONSE_H__INCLUDED
 
 #include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include <b0/b0.h>
 #include <b0/message/message.h>
@@ -31,8 +32,16 @@ public:
     //! The name of the zmq socket
     std::string sock_addr;
 
+    //! The names of the zmq sockets of all the servers of the service (sock_addr is the first)
+    std::vector<std::string> sock_addrs;
+
+    //! The IPC endpoints of the servers, parallel to sock_addrs (empty strings if none)
+    std::vector<std::string> ipc_addrs;
+
 public:
-    std::string type() const override {return "ResolveServiceResponse";}
+    static constexpr const char *b0_type = "ResolveServiceResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -54,11 +63,19 @@ using b0::message::resolv::ResolveServiceResponse;
 template <>
 struct default_codec_t<ResolveServiceResponse>
 {
-    static codec::object_t<ResolveServiceResponse> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<ResolveServiceResponse>();
         codec.required("ok", &ResolveServiceResponse::ok);
         codec.required("sock_addr", &ResolveServiceResponse::sock_addr);
+        codec.optional("sock_addrs", &ResolveServiceResponse::sock_addrs);
+        codec.optional("ipc_addrs", &ResolveServiceResponse::ipc_addrs);
+    }
+
+    static codec::object_t<ResolveServiceResponse> codec()
+    {
+        auto codec = codec::object<ResolveServiceResponse>();
+        describe(codec);
         return codec;
     }
 };
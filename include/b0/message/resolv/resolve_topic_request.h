@@ -0,0 +1,75 @@
+#ifndef B0__MESSAGE__RESOLV__RESOLVE_TOPIC_REQUEST_H__INCLUDED
+#define B0__MESSAGE__RESOLV__RESOLVE_TOPIC_REQUEST_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Sent by a Subscriber in peer-to-peer mode to resolve a topic name to the
+ *        addresses of the publishers bound to it
+ *
+ * \sa ResolveTopicResponse, \ref protocol
+ */
+class ResolveTopicRequest : public Message
+{
+public:
+    //! The name of the topic to be resolved
+    std::string topic_name;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.ResolveTopicRequest";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::ResolveTopicRequest;
+
+template <>
+struct default_codec_t<ResolveTopicRequest>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("topic_name", &ResolveTopicRequest::topic_name);
+    }
+
+    static codec::object_t<ResolveTopicRequest> codec()
+    {
+        auto codec = codec::object<ResolveTopicRequest>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__RESOLVE_TOPIC_REQUEST_H__INCLUDED
@@ -0,0 +1,83 @@
+#ifndef B0__MESSAGE__RESOLV__RESOLVE_TOPIC_RESPONSE_H__INCLUDED
+#define B0__MESSAGE__RESOLV__RESOLVE_TOPIC_RESPONSE_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Response to ResolveTopicRequest message
+ *
+ * \sa ResolveTopicRequest, \ref protocol
+ */
+class ResolveTopicResponse : public Message
+{
+public:
+    //! True if successful, false if error
+    bool ok;
+
+    //! The addresses of the zmq sockets of the publishers (can be empty)
+    std::vector<std::string> sock_addr;
+
+    //! The IPC endpoints of the publishers, parallel to sock_addr (empty strings if none)
+    std::vector<std::string> ipc_addrs;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.ResolveTopicResponse";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::ResolveTopicResponse;
+
+template <>
+struct default_codec_t<ResolveTopicResponse>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("ok", &ResolveTopicResponse::ok);
+        codec.required("sock_addr", &ResolveTopicResponse::sock_addr);
+        codec.optional("ipc_addrs", &ResolveTopicResponse::ipc_addrs);
+    }
+
+    static codec::object_t<ResolveTopicResponse> codec()
+    {
+        auto codec = codec::object<ResolveTopicResponse>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__RESOLVE_TOPIC_RESPONSE_H__INCLUDED
@@ -0,0 +1,84 @@
+#ifndef B0__MESSAGE__RESOLV__RESOLVER_SNAPSHOT_H__INCLUDED
+#define B0__MESSAGE__RESOLV__RESOLVER_SNAPSHOT_H__INCLUDED
+
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/resolv/sync_state_response.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief The state of a resolver, saved to its state file (see b0::Resolver::setStateFile())
+ *
+ * It is the state copied by a standby (see SyncStateResponse), and the ports of the
+ * proxies, which the restarted resolver binds again, since the nodes stay connected to them.
+ */
+class ResolverSnapshot : public Message
+{
+public:
+    //! The nodes, services, topics, graph and parameters
+    SyncStateResponse state;
+
+    //! The ports of the XSUB sockets of the proxies
+    std::vector<int> xsub_proxy_ports;
+
+    //! The ports of the XPUB sockets of the proxies
+    std::vector<int> xpub_proxy_ports;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.ResolverSnapshot";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::ResolverSnapshot;
+
+template <>
+struct default_codec_t<ResolverSnapshot>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("state", &ResolverSnapshot::state);
+        codec.optional("xsub_proxy_ports", &ResolverSnapshot::xsub_proxy_ports);
+        codec.optional("xpub_proxy_ports", &ResolverSnapshot::xpub_proxy_ports);
+    }
+
+    static codec::object_t<ResolverSnapshot> codec()
+    {
+        auto codec = codec::object<ResolverSnapshot>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__RESOLVER_SNAPSHOT_H__INCLUDED
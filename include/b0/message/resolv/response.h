@@ -9,10 +9,19 @@
 #include <b0/message/resolv/shutdown_node_response.h>
 #include <b0/message/resolv/announce_service_response.h>
 #include <b0/message/resolv/resolve_service_response.h>
+#include <b0/message/resolv/announce_topic_response.h>
+#include <b0/message/resolv/resolve_topic_response.h>
 #include <b0/message/resolv/heartbeat_response.h>
 #include <b0/message/graph/node_topic_response.h>
 #include <b0/message/graph/node_service_response.h>
 #include <b0/message/graph/get_graph_response.h>
+#include <b0/message/resolv/get_compression_dictionary_response.h>
+#include <b0/message/resolv/announce_sockets_response.h>
+#include <b0/message/resolv/sync_state_response.h>
+#include <b0/message/resolv/get_params_response.h>
+#include <b0/message/resolv/set_param_response.h>
+#include <b0/message/resolv/content_type_id_response.h>
+#include <b0/message/resolv/sync_directory_response.h>
 
 namespace b0
 {
@@ -43,6 +52,12 @@ public:
     //! \brief Message for the ResolveServiceResponse
     boost::optional<ResolveServiceResponse> resolve_service;
 
+    //! \brief Message for the AnnounceTopicResponse
+    boost::optional<AnnounceTopicResponse> announce_topic;
+
+    //! \brief Message for the ResolveTopicResponse
+    boost::optional<ResolveTopicResponse> resolve_topic;
+
     //! \brief Message for the HeartbeatResponse
     boost::optional<HeartbeatResponse> heartbeat;
 
@@ -55,8 +70,31 @@ public:
     //! \brief Message for the GetGraphResponse
     boost::optional<graph::GetGraphResponse> get_graph;
 
+    //! \brief Message for the GetCompressionDictionaryResponse
+    boost::optional<GetCompressionDictionaryResponse> get_compression_dictionary;
+
+    //! \brief Message for the AnnounceSocketsResponse
+    boost::optional<AnnounceSocketsResponse> announce_sockets;
+
+    //! \brief Message for the SyncStateResponse
+    boost::optional<SyncStateResponse> sync_state;
+
+    //! \brief Message for the GetParamsResponse
+    boost::optional<GetParamsResponse> get_params;
+
+    //! \brief Message for the SetParamResponse
+    boost::optional<SetParamResponse> set_param;
+
+    //! \brief Message for the ContentTypeIdResponse
+    boost::optional<ContentTypeIdResponse> content_type_id;
+
+    //! \brief Message for the SyncDirectoryResponse
+    boost::optional<SyncDirectoryResponse> sync_directory;
+
 public:
-    std::string type() const override {return "b0.message.resolv.Response";}
+    static constexpr const char *b0_type = "b0.message.resolv.Response";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -78,17 +116,32 @@ using b0::message::resolv::Response;
 template <>
 struct default_codec_t<Response>
 {
-    static codec::object_t<Response> codec()
+    template<typename Codec>
+    static void describe(Codec &codec)
     {
-        auto codec = codec::object<Response>();
         codec.optional("announce_node", &Response::announce_node);
         codec.optional("shutdown_node", &Response::shutdown_node);
         codec.optional("announce_service", &Response::announce_service);
         codec.optional("resolve_service", &Response::resolve_service);
+        codec.optional("announce_topic", &Response::announce_topic);
+        codec.optional("resolve_topic", &Response::resolve_topic);
         codec.optional("heartbeat", &Response::heartbeat);
         codec.optional("node_topic", &Response::node_topic);
         codec.optional("node_service", &Response::node_service);
         codec.optional("get_graph", &Response::get_graph);
+        codec.optional("get_compression_dictionary", &Response::get_compression_dictionary);
+        codec.optional("announce_sockets", &Response::announce_sockets);
+        codec.optional("sync_state", &Response::sync_state);
+        codec.optional("get_params", &Response::get_params);
+        codec.optional("set_param", &Response::set_param);
+        codec.optional("content_type_id", &Response::content_type_id);
+        codec.optional("sync_directory", &Response::sync_directory);
+    }
+
+    static codec::object_t<Response> codec()
+    {
+        auto codec = codec::object<Response>();
+        describe(codec);
         return codec;
     }
 };
@@ -0,0 +1,84 @@
+#ifndef B0__MESSAGE__RESOLV__SET_PARAM_REQUEST_H__INCLUDED
+#define B0__MESSAGE__RESOLV__SET_PARAM_REQUEST_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Sent by a node to set (or remove) a parameter
+ *
+ * The resolver publishes the change on the "param" topic (see ParamUpdate).
+ *
+ * \sa SetParamResponse, \ref protocol
+ */
+class SetParamRequest : public Message
+{
+public:
+    //! The name of the parameter
+    std::string name;
+
+    //! The new value of the parameter
+    std::string value;
+
+    //! If true, the parameter is removed (value is ignored)
+    bool remove{false};
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.SetParamRequest";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::SetParamRequest;
+
+template <>
+struct default_codec_t<SetParamRequest>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("name", &SetParamRequest::name);
+        codec.required("value", &SetParamRequest::value);
+        codec.optional("remove", &SetParamRequest::remove);
+    }
+
+    static codec::object_t<SetParamRequest> codec()
+    {
+        auto codec = codec::object<SetParamRequest>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__SET_PARAM_REQUEST_H__INCLUDED
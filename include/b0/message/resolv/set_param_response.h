@@ -0,0 +1,78 @@
+#ifndef B0__MESSAGE__RESOLV__SET_PARAM_RESPONSE_H__INCLUDED
+#define B0__MESSAGE__RESOLV__SET_PARAM_RESPONSE_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Response to SetParamRequest message
+ *
+ * \sa SetParamRequest, \ref protocol
+ */
+class SetParamResponse : public Message
+{
+public:
+    //! True if successful
+    bool ok;
+
+    //! The version of the parameters after the change
+    int64_t version;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.SetParamResponse";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::SetParamResponse;
+
+template <>
+struct default_codec_t<SetParamResponse>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("ok", &SetParamResponse::ok);
+        codec.required("version", &SetParamResponse::version);
+    }
+
+    static codec::object_t<SetParamResponse> codec()
+    {
+        auto codec = codec::object<SetParamResponse>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__SET_PARAM_RESPONSE_H__INCLUDED
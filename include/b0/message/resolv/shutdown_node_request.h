@@ -31,7 +31,9 @@ public:
     std::string node_name;
 
 public:
-    std::string type() const override {return "b0.message.resolv.ShutdownNodeRequest";}
+    static constexpr const char *b0_type = "b0.message.resolv.ShutdownNodeRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -53,10 +55,16 @@ using b0::message::resolv::ShutdownNodeRequest;
 template <>
 struct default_codec_t<ShutdownNodeRequest>
 {
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("node_name", &ShutdownNodeRequest::node_name);
+    }
+
     static codec::object_t<ShutdownNodeRequest> codec()
     {
         auto codec = codec::object<ShutdownNodeRequest>();
-        codec.required("node_name", &ShutdownNodeRequest::node_name);
+        describe(codec);
         return codec;
     }
 };
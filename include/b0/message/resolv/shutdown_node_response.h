@@ -27,7 +27,9 @@ public:
     bool ok;
 
 public:
-    std::string type() const override {return "b0.message.resolv.ShutdownNodeResponse";}
+    static constexpr const char *b0_type = "b0.message.resolv.ShutdownNodeResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace resolv
@@ -49,10 +51,16 @@ using b0::message::resolv::ShutdownNodeResponse;
 template <>
 struct default_codec_t<ShutdownNodeResponse>
 {
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("ok", &ShutdownNodeResponse::ok);
+    }
+
     static codec::object_t<ShutdownNodeResponse> codec()
     {
         auto codec = codec::object<ShutdownNodeResponse>();
-        codec.required("ok", &ShutdownNodeResponse::ok);
+        describe(codec);
         return codec;
     }
 };
@@ -0,0 +1,87 @@
+#ifndef B0__MESSAGE__RESOLV__SYNC_DIRECTORY_REQUEST_H__INCLUDED
+#define B0__MESSAGE__RESOLV__SYNC_DIRECTORY_REQUEST_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/resolv/federation_entry.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Sent by a resolver to its parent resolver, with the services and topics of its site
+ *
+ * The entries of the children of the sender, if any, are included, so that the directory
+ * reaches the whole federation.
+ *
+ * \sa SyncDirectoryResponse, b0::resolver::Resolver::setParent(), \ref protocol
+ */
+class SyncDirectoryRequest : public Message
+{
+public:
+    //! The address of the resolver sending the request
+    std::string site;
+
+    //! The services of the site of the sender (and of its children)
+    std::vector<FederationEntry> services;
+
+    //! The topics published at the site of the sender (and at its children)
+    std::vector<FederationEntry> topics;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.SyncDirectoryRequest";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::SyncDirectoryRequest;
+
+template <>
+struct default_codec_t<SyncDirectoryRequest>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("site", &SyncDirectoryRequest::site);
+        codec.required("services", &SyncDirectoryRequest::services);
+        codec.required("topics", &SyncDirectoryRequest::topics);
+    }
+
+    static codec::object_t<SyncDirectoryRequest> codec()
+    {
+        auto codec = codec::object<SyncDirectoryRequest>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__SYNC_DIRECTORY_REQUEST_H__INCLUDED
@@ -0,0 +1,87 @@
+#ifndef B0__MESSAGE__RESOLV__SYNC_DIRECTORY_RESPONSE_H__INCLUDED
+#define B0__MESSAGE__RESOLV__SYNC_DIRECTORY_RESPONSE_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/resolv/federation_entry.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Response to SyncDirectoryRequest message
+ *
+ * Contains the services and topics of all the sites of the federation, except the ones
+ * of the sender of the request.
+ *
+ * \sa SyncDirectoryRequest, \ref protocol
+ */
+class SyncDirectoryResponse : public Message
+{
+public:
+    //! True if successful
+    bool ok;
+
+    //! The services of the other sites
+    std::vector<FederationEntry> services;
+
+    //! The topics published at the other sites
+    std::vector<FederationEntry> topics;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.SyncDirectoryResponse";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::SyncDirectoryResponse;
+
+template <>
+struct default_codec_t<SyncDirectoryResponse>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("ok", &SyncDirectoryResponse::ok);
+        codec.required("services", &SyncDirectoryResponse::services);
+        codec.required("topics", &SyncDirectoryResponse::topics);
+    }
+
+    static codec::object_t<SyncDirectoryResponse> codec()
+    {
+        auto codec = codec::object<SyncDirectoryResponse>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__SYNC_DIRECTORY_RESPONSE_H__INCLUDED
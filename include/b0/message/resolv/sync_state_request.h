@@ -0,0 +1,72 @@
+#ifndef B0__MESSAGE__RESOLV__SYNC_STATE_REQUEST_H__INCLUDED
+#define B0__MESSAGE__RESOLV__SYNC_STATE_REQUEST_H__INCLUDED
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Sent by a standby resolver to the primary resolver, to copy its state
+ *
+ * \sa SyncStateResponse, b0::resolver::Resolver::setPrimary(), \ref protocol
+ */
+class SyncStateRequest : public Message
+{
+public:
+    //! The version of the state the standby has already (-1 if none)
+    int64_t version;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.SyncStateRequest";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::SyncStateRequest;
+
+template <>
+struct default_codec_t<SyncStateRequest>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("version", &SyncStateRequest::version);
+    }
+
+    static codec::object_t<SyncStateRequest> codec()
+    {
+        auto codec = codec::object<SyncStateRequest>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__SYNC_STATE_REQUEST_H__INCLUDED
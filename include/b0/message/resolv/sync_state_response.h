@@ -0,0 +1,114 @@
+#ifndef B0__MESSAGE__RESOLV__SYNC_STATE_RESPONSE_H__INCLUDED
+#define B0__MESSAGE__RESOLV__SYNC_STATE_RESPONSE_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/graph/graph.h>
+#include <b0/message/resolv/announce_service_request.h>
+#include <b0/message/resolv/announce_topic_request.h>
+#include <b0/message/resolv/param.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief Response to SyncStateRequest message
+ *
+ * Unless the state has not changed since the version given in the request, it
+ * contains the whole state of the primary resolver.
+ *
+ * \sa SyncStateRequest, \ref protocol
+ */
+class SyncStateResponse : public Message
+{
+public:
+    //! True if successful
+    bool ok;
+
+    //! The version of the state of the primary resolver
+    int64_t version;
+
+    //! False if the state has not changed since the version of the request (the other fields are empty then)
+    bool changed;
+
+    //! The nodes and the links between nodes, topics and services
+    b0::message::graph::Graph graph;
+
+    //! The services, each with the node offering it and its address
+    std::vector<AnnounceServiceRequest> services;
+
+    //! The peer-to-peer publishers, each with the node and its address
+    std::vector<AnnounceTopicRequest> topics;
+
+    //! The parameters (see GetParamsRequest)
+    std::vector<Param> params;
+
+    //! The version of the parameters
+    int64_t params_version{0};
+
+    //! The content types with an id (see ContentTypeIdRequest), the index being the id
+    std::vector<std::string> content_types;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.SyncStateResponse";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::SyncStateResponse;
+
+template <>
+struct default_codec_t<SyncStateResponse>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("ok", &SyncStateResponse::ok);
+        codec.required("version", &SyncStateResponse::version);
+        codec.required("changed", &SyncStateResponse::changed);
+        codec.optional("graph", &SyncStateResponse::graph);
+        codec.optional("services", &SyncStateResponse::services);
+        codec.optional("topics", &SyncStateResponse::topics);
+        codec.optional("params", &SyncStateResponse::params);
+        codec.optional("params_version", &SyncStateResponse::params_version);
+        codec.optional("content_types", &SyncStateResponse::content_types);
+    }
+
+    static codec::object_t<SyncStateResponse> codec()
+    {
+        auto codec = codec::object<SyncStateResponse>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__SYNC_STATE_RESPONSE_H__INCLUDED
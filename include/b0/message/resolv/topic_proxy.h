@@ -0,0 +1,78 @@
+#ifndef B0__MESSAGE__RESOLV__TOPIC_PROXY_H__INCLUDED
+#define B0__MESSAGE__RESOLV__TOPIC_PROXY_H__INCLUDED
+
+#include <boost/serialization/string.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace resolv
+{
+
+/*!
+ * \brief An explicit assignment of a topic to one of the resolver's XSUB/XPUB proxies
+ *
+ * \sa AnnounceNodeResponse, \ref protocol
+ */
+class TopicProxy : public Message
+{
+public:
+    //! The name of the topic
+    std::string topic_name;
+
+    //! Index of the proxy in AnnounceNodeResponse::xsub_sock_addrs and AnnounceNodeResponse::xpub_sock_addrs
+    int proxy;
+
+public:
+    static constexpr const char *b0_type = "b0.message.resolv.TopicProxy";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace resolv
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::resolv::TopicProxy;
+
+template <>
+struct default_codec_t<TopicProxy>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("topic_name", &TopicProxy::topic_name);
+        codec.required("proxy", &TopicProxy::proxy);
+    }
+
+    static codec::object_t<TopicProxy> codec()
+    {
+        auto codec = codec::object<TopicProxy>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__RESOLV__TOPIC_PROXY_H__INCLUDED
@@ -0,0 +1,72 @@
+#ifndef B0__MESSAGE__SIM__CLOCK_H__INCLUDED
+#define B0__MESSAGE__SIM__CLOCK_H__INCLUDED
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+
+namespace b0
+{
+
+namespace message
+{
+
+namespace sim
+{
+
+/*!
+ * \brief The time of a simulated clock, sent to the 'clock' topic
+ *
+ * \sa b0::Node::setSimulatedTime()
+ */
+class Clock : public Message
+{
+public:
+    //! The simulated time, in microseconds
+    int64_t time_usec;
+
+public:
+    static constexpr const char *b0_type = "b0.message.sim.Clock";
+
+    std::string type() const override {return b0_type;}
+};
+
+} // namespace sim
+
+} // namespace message
+
+} // namespace b0
+
+//! \cond HIDDEN_SYMBOLS
+
+namespace spotify
+{
+
+namespace json
+{
+
+using b0::message::sim::Clock;
+
+template <>
+struct default_codec_t<Clock>
+{
+    template<typename Codec>
+    static void describe(Codec &codec)
+    {
+        codec.required("time_usec", &Clock::time_usec);
+    }
+
+    static codec::object_t<Clock> codec()
+    {
+        auto codec = codec::object<Clock>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+//! \endcond
+
+#endif // B0__MESSAGE__SIM__CLOCK_H__INCLUDED
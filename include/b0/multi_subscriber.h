@@ -0,0 +1,146 @@
+#ifndef B0__MULTI_SUBSCRIBER_H__INCLUDED
+#define B0__MULTI_SUBSCRIBER_H__INCLUDED
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include <b0/b0.h>
+#include <b0/socket.h>
+#include <b0/message/message_envelope.h>
+
+namespace b0
+{
+
+class Node;
+
+/*!
+ * \brief A subscriber of several topics, through a single SUB socket
+ *
+ * Each subscription is either a topic name, matched exactly, or a pattern ending with '*',
+ * matching all the topics starting with what precedes it (e.g. "sensors/imu/*"). The
+ * messages are dispatched by their topic (the header0 of the envelope) to the callbacks
+ * of all the matching subscriptions.
+ *
+ * Compared to one b0::Subscriber per topic, this uses one socket, one connection per proxy,
+ * and one poll item, whatever the number of topics.
+ *
+ * The messages are received through the resolver's proxies only: peer-to-peer publishers
+ * (see b0::setPeerToPeer()) are not reached, nor intra-process delivery used. With more than
+ * one proxy, the exact topics are received from the proxy serving each of them, and the
+ * patterns from the default proxy (see b0::Node::getXPUBSocketAddress()).
+ *
+ * \sa b0::Subscriber
+ */
+class MultiSubscriber : public Socket
+{
+public:
+    using logger::LogInterface::log;
+
+    //! \brief Callback getting the topic and the payload of the first part of a message
+    using CallbackRaw = boost::function<void(const std::string &topic, const std::string &payload)>;
+
+    //! \brief Callback getting the topic and the part views of a message (zero-copy)
+    using CallbackPartsView = boost::function<void(const std::string &topic, const std::vector<b0::message::MessagePartView> &parts)>;
+
+    /*!
+     * \brief Construct a MultiSubscriber child of the specified Node
+     *
+     * The name is only used in the logs and metrics of this socket.
+     */
+    MultiSubscriber(Node *node, const std::string &name, bool managed = true, bool notify_graph = true);
+
+    /*!
+     * \brief MultiSubscriber destructor
+     */
+    virtual ~MultiSubscriber();
+
+    /*!
+     * \brief Log a message using node's logger, prepending this subscriber informations
+     */
+    void log(logger::Level level, const std::string &message) const override;
+
+    /*!
+     * \brief Add a subscription to a topic or a pattern (see above), before init()
+     */
+    void subscribe(const std::string &pattern, CallbackRaw callback);
+
+    /*!
+     * \brief Add a subscription to a topic or a pattern (see above), before init()
+     *
+     * The views passed to the callback are valid only for the duration of the callback.
+     */
+    void subscribeParts(const std::string &pattern, CallbackPartsView callback);
+
+    /*!
+     * \brief Connect to the proxies, subscribe, and notify the graph of the exact topics
+     */
+    virtual void init() override;
+
+    /*!
+     * \brief Unsubscribe, disconnect, and notify the graph
+     */
+    virtual void cleanup() override;
+
+    /*!
+     * \brief Read and dispatch the incoming messages
+     */
+    virtual void spinOnce() override;
+
+    /*!
+     * \brief Return true if there is some subscription
+     */
+    virtual bool hasCallback() const override;
+
+protected:
+    /*!
+     * \brief Accept the envelopes of the topics matching some subscription
+     */
+    virtual bool acceptsHeader0(const std::string &header0) const override;
+
+    //! A subscription and its callback
+    struct Subscription
+    {
+        //! The topic name (remapped), or the prefix of a pattern
+        std::string topic;
+
+        //! True if topic is the prefix of a pattern
+        bool prefix;
+
+        //! Callback, if set with subscribe()
+        CallbackRaw callback_raw;
+
+        //! Callback, if set with subscribeParts()
+        CallbackPartsView callback_parts;
+
+        //! Return true if a topic matches this subscription
+        bool matches(const std::string &topic_name) const;
+    };
+
+    //! Add a subscription
+    void add(const std::string &pattern, const CallbackRaw &callback_raw, const CallbackPartsView &callback_parts);
+
+    //! Return the ZMQ_SUBSCRIBE filter of a subscription
+    static std::string filter(const Subscription &subscription);
+
+    //! The subscriptions
+    std::vector<Subscription> subscriptions_;
+
+    //! The addresses of the proxies connected to
+    std::set<std::string> remote_addrs_;
+
+    //! If false this socket will not send announcement to resolv (i.e. it will be "invisible")
+    const bool notify_graph_;
+
+    //! Envelope the messages read from the socket are parsed into
+    b0::message::MessageEnvelopeView receive_envelope_;
+
+    //! Payload passed to the raw callbacks
+    std::string dispatch_payload_;
+};
+
+} // namespace b0
+
+#endif // B0__MULTI_SUBSCRIBER_H__INCLUDED
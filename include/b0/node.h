@@ -9,15 +9,39 @@
 #include <b0/utils/time_sync.h>
 
 #include <atomic>
+#include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/lexical_cast.hpp>
 
 namespace b0
 {
 
+namespace message
+{
+
+namespace metrics
+{
+
+class NodeMetrics;
+
+} // namespace metrics
+
+namespace graph
+{
+
+class Graph;
+class GetGraphRequest;
+class NodeStats;
+
+} // namespace graph
+
+} // namespace message
+
 namespace logger
 {
 
@@ -25,6 +49,27 @@ class Logger;
 
 } // namespace logger
 
+namespace resolver
+{
+
+class Client;
+
+} // namespace resolver
+
+class Subscriber;
+class StartupTrace;
+
+/*!
+ * \brief The spin policy of a Node (see b0::Node::spin())
+ */
+enum class SpinMode
+{
+    //! Call spinOnce() at a fixed rate, sleeping in between
+    FixedRate,
+    //! Block waiting for incoming messages, and call spinOnce() as soon as they arrive
+    EventDriven
+};
+
 /*!
  * \brief The abstraction for a node in the network.
  *
@@ -69,6 +114,8 @@ public:
 
     /*!
      * \brief Specify a different value for the resolver address. Otherwise B0_RESOLVER env var is used.
+     *
+     * A comma separated list of resolvers enables the failover, see b0::resolver::Client::setResolverAddress().
      */
     void setResolverAddress(const std::string &addr);
 
@@ -106,6 +153,10 @@ public:
      * This method will call b0::Subscriber::spinOnce() and b0::ServiceServer::spinOnce()
      * on the subscribers and service servers that belong to this node.
      *
+     * All the sockets are polled with a single call, and only the sockets which have
+     * incoming messages are spun, so the cost of an idle spin does not grow with the
+     * number of sockets.
+     *
      * Warning: every message sent on a topic which has no registered callback will be discarded.
      */
     virtual void spinOnce();
@@ -118,16 +169,171 @@ public:
      * If the spinRate parameter is not specified, the value returned by b0::Node::getSpinRate()
      * will be used.
      *
+     * In SpinMode::EventDriven mode (see b0::Node::setSpinMode()), spinOnce() is also
+     * called as soon as a message arrives on any socket of this node, without waiting
+     * for the end of the period, while the callback is still called at the specified rate.
+     *
+     * In both modes, the timers (see createTimer()) are run when they are due, between the
+     * periods. In SpinMode::FixedRate mode, a timer created by another thread is only
+     * noticed at the next period.
+     *
      * \param callback a callback to be called each time after spinOnce()
      * \param spinRate the approximate frequency (in Hz) at which spinOnce() will be called
      */
     virtual void spin(boost::function<void(void)> callback = {}, double spinRate = -1);
 
+    /*!
+     * \brief Set the spin mode used by spin()
+     *
+     * \param mode the spin mode
+     * \param maxSpinRate in SpinMode::EventDriven mode, limit the frequency (in Hz) at which
+     *        spinOnce() is called when messages arrive continuously (-1 for no limit)
+     */
+    void setSpinMode(SpinMode mode, double maxSpinRate = -1);
+
+    /*!
+     * \brief Get the spin mode used by spin()
+     */
+    SpinMode getSpinMode() const;
+
+    /*!
+     * \brief Sleep until the deadlines of spin() with clock_nanosleep() on the monotonic clock
+     *
+     * The absolute sleep wakes up closer to the deadline than the default sleep, which is
+     * useful together with a real-time scheduling policy. Only available where
+     * clock_nanosleep() is, otherwise ignored. The default is the B0_REALTIME_SLEEP env var.
+     */
+    void setRealtimeSleep(bool enabled);
+
+    /*!
+     * \brief Return true if spin() sleeps with clock_nanosleep() (see setRealtimeSleep())
+     */
+    bool getRealtimeSleep() const;
+
+    /*!
+     * \brief Return the counters of the overruns and the jitter of spin() in SpinMode::FixedRate mode
+     *
+     * An iteration overruns when spinOnce() and the callback end after the next deadline.
+     * The counters can be read (and reset) from any thread.
+     */
+    SpinCounters & getSpinCounters();
+
+    /*!
+     * \brief Wake up a spin() which is waiting for incoming messages
+     *
+     * This method is thread-safe.
+     */
+    void wakeUp();
+
+    /*!
+     * \brief Return the file descriptors to watch for running the node from an external event loop
+     *
+     * These are the ZMQ_FD of the sockets which have a callback, and of the wakeup channel
+     * (see wakeUp()). They are edge-triggered: when one becomes readable, call spinOnce()
+     * as long as hasPendingEvents() returns true, otherwise later notifications can be missed.
+     * The timers have to be scheduled by the event loop as well (see nextTimerUSec()).
+     *
+     * The list changes only when sockets are added or removed.
+     */
+    std::vector<int64_t> getEventFileDescriptors();
+
+    /*!
+     * \brief Return true if some socket with a callback has incoming messages, i.e. if spinOnce() has work to do
+     *
+     * This reads the ZMQ_EVENTS of the sockets, which re-arms the notifications of the file
+     * descriptors returned by getEventFileDescriptors(), and drains the wakeup channel.
+     */
+    bool hasPendingEvents();
+
+    /*!
+     * \brief Process the incoming messages of the sockets whose file descriptors the host event loop reported as readable
+     *
+     * Unlike spinOnce(), this does not poll all the sockets, nor run the timers. Each socket
+     * is spun until it has no more incoming messages (its events are read, which re-arms its
+     * descriptor), but at most a fixed number of times, so that a busy socket does not starve
+     * the host loop. The sockets with intra-process messages, signaled through the wakeup
+     * channel, are processed as well.
+     *
+     * \param fds readable descriptors, among the ones returned by getEventFileDescriptors()
+     * \return true if some messages are left, in which case it has to be called again soon
+     *         (the descriptors will not signal them again)
+     */
+    bool processReadySockets(const std::vector<int64_t> &fds);
+
+    /*!
+     * \brief Dispatch the callbacks of this node's sockets on a pool of worker threads
+     *
+     * With n > 0, spinOnce() hands the sockets which have incoming messages to a pool
+     * of n threads, so that a slow callback does not stall the other sockets.
+     * A socket is never processed by two threads at the same time, and sockets with
+     * the same strand (see b0::Socket::setStrand()) are never processed concurrently.
+     *
+     * Callbacks can use the node's logging methods, which are serialized.
+     *
+     * Must be called before init(). The default is 0 (callbacks run in the spin thread).
+     */
+    void setCallbackThreads(int n);
+
+    /*!
+     * \brief Get the number of callback executor threads
+     */
+    int getCallbackThreads() const;
+
+    //! Callback of a timer (see createTimer())
+    using TimerCallback = boost::function<void(void)>;
+
+    /*!
+     * \brief Create a timer calling the callback every period_usec microseconds (or once, if one_shot)
+     *
+     * The timers are run by spinOnce() on the spin thread, and spin() waits for the next
+     * timer together with the incoming messages, so timers at different rates do not need
+     * threads of their own, nor are they rounded to the spin rate. A late timer is not
+     * called again to catch up.
+     *
+     * The times are measured with hardwareTimeUSec(), or with timeUSec() if synchronized
+     * is true (e.g. for timers which must fire at the same time on different nodes).
+     *
+     * This method is thread-safe. It returns the id to pass to cancelTimer().
+     */
+    int createTimer(int64_t period_usec, TimerCallback callback, bool one_shot = false, bool synchronized = false);
+
+    /*!
+     * \brief Cancel a timer (one-shot timers are removed after they fire)
+     *
+     * This method is thread-safe.
+     */
+    void cancelTimer(int id);
+
     /*!
      * \brief Node cleanup: stop all threads, send a shutdown notification to resolver, and so on...
      */
     virtual void cleanup();
 
+    /*!
+     * \brief Set a deadline for the outgoing messages at shutdown, in milliseconds (-1 for none)
+     *
+     * By default each socket keeps sending its outgoing messages for its own linger period
+     * (see b0::setLingerPeriod()) after it is closed, so a node with unreachable peers can take
+     * that long, per socket, to exit. With a shutdown timeout, cleanup() sets the linger period
+     * of all the sockets to the time left until the deadline, counted from the start of cleanup(),
+     * so that the pending messages are flushed within that time overall, and the rest is dropped.
+     *
+     * The default is -1, unless the B0_SHUTDOWN_TIMEOUT environment variable is set.
+     */
+    void setShutdownTimeout(int timeout);
+
+    //! Return the deadline for the outgoing messages at shutdown (see setShutdownTimeout())
+    int getShutdownTimeout() const;
+
+    /*!
+     * \brief Return the number of calls dropped by cleanup()
+     *
+     * These are the calls of the service clients (children of this node) still waiting for a
+     * reply. ZeroMQ does not tell how many of the outgoing messages lingering past the deadline
+     * are lost; cleanup() logs a warning when the deadline had already passed.
+     */
+    uint64_t getShutdownDroppedCount() const;
+
 protected:
     /*!
      * \brief Start the heartbeat thread
@@ -142,12 +348,38 @@ protected:
      */
     virtual void stopHeartbeatThread();
 
+    /*!
+     * \brief Return the client of the resolver of this node
+     */
+    resolver::Client & resolverClient();
+
+private:
+    //! Start the callback executor threads
+    void startExecutorThreads();
+
+    //! Stop the callback executor threads
+    void stopExecutorThreads();
+
+    //! The callback executor loop (run in its own threads)
+    void executorLoop();
+
+protected:
 public:
     /*!
      * \brief Log a message to the default logger of this node
      */
     void log(logger::Level level, const std::string &message) const override;
 
+    /*!
+     * \brief Return false if messages of the given level would be discarded by the logger of this node
+     */
+    bool isLevelEnabled(logger::Level level) const override;
+
+    /*!
+     * \brief Return true if called from the node's thread or from one of its callback threads
+     */
+    bool isNodeThread() const;
+
     /*!
      * \brief Get the name assigned by resolver to this node
      */
@@ -175,6 +407,110 @@ public:
      */
     virtual std::string getXSUBSocketAddress() const;
 
+    /*!
+     * \brief Retrieve address of the XPUB socket of the proxy serving the given topic
+     *
+     * If the resolver runs more than one proxy, a topic uses the proxy explicitly
+     * assigned to it by the resolver, or otherwise the proxy selected by the hash
+     * of its name.
+     */
+    virtual std::string getXPUBSocketAddress(const std::string &topic_name) const;
+
+    /*!
+     * \brief Retrieve address of the XSUB socket of the proxy serving the given topic
+     *
+     * \sa getXPUBSocketAddress(const std::string &topic_name) const
+     */
+    virtual std::string getXSUBSocketAddress(const std::string &topic_name) const;
+
+    /*!
+     * \brief Retrieve address of the XPUB socket of the high-priority proxy serving the given topic
+     *
+     * The topics of the high-priority sockets (see Socket::setHighPriority()) go through the
+     * proxies the resolver reserves to them (see Resolver::setNumPriorityProxies()), selected
+     * by the hash of their name, or through the usual one if the resolver has none.
+     */
+    virtual std::string getPriorityXPUBSocketAddress(const std::string &topic_name) const;
+
+    /*!
+     * \brief Retrieve address of the XSUB socket of the high-priority proxy serving the given topic
+     *
+     * \sa getPriorityXPUBSocketAddress()
+     */
+    virtual std::string getPriorityXSUBSocketAddress(const std::string &topic_name) const;
+
+    /*!
+     * \brief Toggle the debug dump of the sockets of this node matching a pattern
+     *
+     * The request is in the form `<pattern> [on|off|extended]`, with the same patterns of
+     * B0_DEBUG_SOCKET (see b0::Socket::matchesPattern()).
+     *
+     * If the B0_DEBUG_SOCKET_SERVICE env var is set, this is offered by the node
+     * as the `<nodeName>.debug_socket` service, so that dumping can be enabled at runtime.
+     */
+    void handleDebugSocket(const std::string &req, std::string &rep);
+
+    /*!
+     * \brief Fill a snapshot of the traffic counters of the sockets matching a pattern
+     *
+     * \sa b0::Socket::getCounters(), b0::Socket::matchesPattern()
+     */
+    virtual void getMetrics(b0::message::metrics::NodeMetrics &metrics, const std::string &pattern = "*");
+
+    /*!
+     * \brief Reply with a b0::message::metrics::NodeMetrics snapshot of the sockets matching
+     *        the pattern given in the request (all sockets if the request is empty)
+     *
+     * If the B0_METRICS_SERVICE env var is set, this is offered by the node
+     * as the `<nodeName>.metrics` service.
+     */
+    void handleMetrics(const std::string &req, const std::string &reqtype, std::string &rep, std::string &reptype);
+
+    /*!
+     * \brief Change the settings of this node at runtime
+     *
+     * The request is one of the commands:
+     *
+     * - `spin-rate <rate>`: set the default spin rate (see setSpinRate()), which spin() adopts
+     *   at its next iteration if no rate was given to it
+     * - `console-loglevel <level>`, `remote-loglevel <level>`: set the log levels of this node's
+     *   logger, and the defaults of the process (see b0::setConsoleLogLevel() and b0::setRemoteLogLevel())
+     * - `read-hwm <pattern> <n>`, `write-hwm <pattern> <n>`: set the high-water marks of the sockets
+     *   matching the pattern (ZeroMQ 4.2 or later applies them to the existing connections)
+     * - `conflate <pattern> on|off`: set the conflate option of the subscribers matching the pattern,
+     *   which are reconnected (messages can be lost meanwhile)
+     * - `compression <pattern> <algorithm>|none [<level>]`: set the compression of the sockets
+     *   matching the pattern (see b0::Socket::setCompression())
+     * - `memory-accounting <pattern> on|off`: account the buffers allocated by the sockets
+     *   matching the pattern (see b0::Socket::setMemoryAccounting())
+     * - `metrics [<pattern>]`: reply with the JSON b0::message::metrics::NodeMetrics snapshot
+     *
+     * The patterns are the ones of B0_DEBUG_SOCKET (see b0::Socket::matchesPattern()).
+     * The reply starts with "ok" or "error: ".
+     *
+     * If the B0_CONTROL_SERVICE env var is set, this is offered by the node
+     * as the `<nodeName>.control` service.
+     */
+    void handleControl(const std::string &req, std::string &rep);
+
+protected:
+    /*!
+     * \brief Return the index of the proxy serving the given topic
+     *
+     * The hash function is stable across processes and platforms, as every node must
+     * make the same choice.
+     */
+    static size_t topicProxyIndex(const std::string &topic_name, const std::map<std::string, int> &topic_proxy, size_t num_proxies);
+
+    /*!
+     * \brief Return the I/O thread affinity of the sockets of this node (see Socket::setAffinity())
+     *
+     * If the context has a thread reserved to the high-priority sockets (see
+     * b0::setPriorityIOThread()), that is the mask of this thread for them, and the mask
+     * of the other threads for the others; otherwise it is 0 (any thread).
+     */
+    uint64_t ioThreadAffinity(bool high_priority) const;
+
 private:
     /*!
      * Register a socket for this node. Do not call this directly. Called by Socket class.
@@ -204,9 +540,18 @@ public:
 
     /*!
      * \brief Find and return an available TCP port
+     *
+     * The port may be taken by another process before it is bound; sockets binding to a
+     * port of their own use b0::Socket::bindEphemeralPort() instead.
      */
     virtual int freeTCPPort();
 
+    /*!
+     * \brief Return the IPC endpoint advertised along with a TCP port bound by this process,
+     *        or an empty string if IPC is disabled (see b0::setIPC())
+     */
+    virtual std::string ipcAddress(int port);
+
     /*!
      * \brief Notify topic publishing/subscription start or end
      */
@@ -218,20 +563,201 @@ public:
     virtual void notifyService(const std::string &service_name, bool reverse, bool active);
 
     /*!
-     * \brief Announce service address
+     * \brief Announce service address, and optionally its IPC endpoint (see ipcAddress())
      */
-    virtual void announceService(const std::string &service_name, const std::string &addr);
+    virtual void announceService(const std::string &service_name, const std::string &addr, const std::string &ipc_addr = "");
 
     /*!
      * \brief Resolve service address by name
      */
     virtual void resolveService(const std::string &service_name, std::string &addr);
 
+    /*!
+     * \brief Resolve the addresses of all the servers of a service by name
+     */
+    virtual void resolveService(const std::string &service_name, std::vector<std::string> &addrs);
+
+    /*!
+     * \brief Announce the address of a publisher in peer-to-peer mode, and optionally its IPC endpoint (see ipcAddress())
+     */
+    virtual void announceTopic(const std::string &topic_name, const std::string &addr, const std::string &ipc_addr = "");
+
+    /*!
+     * \brief Resolve the addresses of the publishers of a topic in peer-to-peer mode
+     */
+    virtual void resolveTopic(const std::string &topic_name, std::vector<std::string> &addrs);
+
+    /*!
+     * \brief Fetch the graph of the network (nodes, and their topics and services) from the resolver
+     */
+    virtual void getGraph(b0::message::graph::Graph &graph);
+
+    /*!
+     * \brief Fetch the graph from the resolver, unless its version is if_newer_than_version (then return false)
+     *
+     * \sa b0::resolver::Client::getGraph()
+     */
+    virtual bool getGraph(b0::message::graph::Graph &graph, int64_t if_newer_than_version);
+
+    /*!
+     * \brief Fetch the part of the graph selected by the filters of the query
+     *
+     * \sa b0::resolver::Client::getGraph(), b0::message::graph::GetGraphRequest
+     */
+    virtual bool getGraph(b0::message::graph::Graph &graph, const b0::message::graph::GetGraphRequest &query);
+
+    /*!
+     * \brief Fetch a compression dictionary from the resolver
+     *
+     * This is installed as a dictionary provider (see b0::compress::addDictionaryProvider())
+     * during initialization, so that the dictionaries used by a socket or referenced by a
+     * received message are fetched automatically.
+     *
+     * \return false if the resolver does not know the dictionary
+     */
+    virtual bool getCompressionDictionary(const std::string &id, std::string &data);
+
+    /*!
+     * \brief Get the id of a content type from the resolver, or the content type of an id if content_type is empty
+     *
+     * This is installed as a content type id provider (see b0::message::addContentTypeIdProvider())
+     * during initialization, for the sockets using b0::message::EnvelopeFormat::BinaryIds.
+     *
+     * \return false if the resolver does not know the id
+     */
+    virtual bool getContentTypeId(std::string &content_type, int64_t &id);
+
+    /*!
+     * \brief Cache the parameters whose name starts with prefix (must be called before init())
+     *
+     * The parameters are served by the resolver (see b0::resolver::Resolver::setParameter()).
+     * init() fetches the parameters of all the prefixes added, one request per prefix, and
+     * then the changes are pushed by the resolver on the "param" topic and applied by
+     * spinOnce(), so that getParameter() is a lookup in local memory. An empty prefix caches
+     * all the parameters.
+     *
+     * A change made while the subscription to the "param" topic is being established
+     * (i.e. right after init()) can be missed, as any message published to a new subscriber.
+     */
+    void addParameterPrefix(const std::string &prefix);
+
+    /*!
+     * \brief Read a parameter from the local cache (see addParameterPrefix())
+     *
+     * This method is thread-safe.
+     *
+     * \return false if the parameter does not exist, or is not under a cached prefix
+     */
+    bool getParameter(const std::string &name, std::string &value) const;
+
+    /*!
+     * \brief Read a parameter from the local cache, converted with boost::lexical_cast
+     *
+     * \return default_value if the parameter does not exist, or is not under a cached prefix
+     */
+    template<class T>
+    T getParameter(const std::string &name, const T &default_value) const
+    {
+        std::string value;
+        if(!getParameter(name, value)) return default_value;
+        return boost::lexical_cast<T>(value);
+    }
+
+    /*!
+     * \brief Set a parameter for all the nodes (a call to the resolver)
+     *
+     * The local cache is updated at once, if the parameter is under a cached prefix.
+     */
+    void setParameter(const std::string &name, const std::string &value);
+
+    /*!
+     * \brief Remove a parameter for all the nodes (a call to the resolver)
+     */
+    void removeParameter(const std::string &name);
+
+    /*!
+     * \brief Callback of the changes of the cached parameters: value is nullptr if the parameter was removed
+     */
+    using ParameterCallback = boost::function<void(const std::string &name, const std::string *value)>;
+
+    /*!
+     * \brief Set the callback called by spinOnce() when a cached parameter is changed by another node
+     */
+    void setParameterCallback(ParameterCallback callback);
+
     /*!
      * \brief Set the timeout for the announce phase. See b0::resolver::Client::setAnnounceTimeout()
      */
     virtual void setAnnounceTimeout(int timeout = -1);
 
+    /*!
+     * \brief Make this node ephemeral (must be called before init())
+     *
+     * An ephemeral node uses the resolver only for lookups, which suits short-lived tools and
+     * scripts: it does not join the graph, sends no heartbeat, and does not connect the remote
+     * logger. It can use service clients, publishers and subscribers, but cannot offer services.
+     * The default is given by the B0_EPHEMERAL_NODE environment variable.
+     *
+     * \sa b0::resolver::Client::setEphemeral()
+     */
+    void setEphemeral(bool enabled);
+
+    //! Return true if this node is ephemeral (see setEphemeral())
+    bool getEphemeral() const;
+
+    /*!
+     * \brief Share the agent of the process (must be called before init())
+     *
+     * The default is given by b0::getProcessAgent(). Ephemeral nodes (see setEphemeral()) and
+     * nodes without a resolver (see b0::setDecentralized()) do not use the agent.
+     *
+     * \sa b0::ProcessAgent
+     */
+    void setProcessAgent(bool enabled);
+
+    //! Return true if this node shares the agent of the process (see setProcessAgent())
+    bool getProcessAgent() const;
+
+    /*!
+     * \brief Send the heartbeats from spinOnce() instead of a thread (must be called before init())
+     *
+     * The node then starts no heartbeat thread: spinOnce() sends a heartbeat when one is due,
+     * with the resolver client of the node, so the node must be spun at least every third of
+     * the heartbeat interval of the resolver (1.7 s by default) to stay online. Every few
+     * heartbeats (see B0_HEARTBEAT_TIME_SYNC_INTERVAL) wait for the resolver time, up to a
+     * third of the interval. The default is given by b0::getInlineHeartbeats(). The nodes
+     * sharing the agent of the process (see setProcessAgent()) are not affected.
+     */
+    void setInlineHeartbeat(bool enabled);
+
+    //! Return true if the heartbeats of this node are sent by spinOnce() (see setInlineHeartbeat())
+    bool getInlineHeartbeat() const;
+
+    /*!
+     * \brief Record the durations of the phases of init() (must be called before init())
+     *
+     * The phases of init() and of the init() of each socket are recorded (see
+     * b0::StartupTrace), and logged at the debug level at the end of init(). The default is
+     * given by the B0_STARTUP_TRACE environment variable. If the B0_STARTUP_TRACE_FILE
+     * environment variable is set, tracing is enabled and the phases are also appended to
+     * that file as a Chrome trace, with one row per node, to be opened in chrome://tracing
+     * or Perfetto.
+     */
+    void setStartupTracing(bool enabled);
+
+    //! Return true if the phases of init() are recorded (see setStartupTracing())
+    bool getStartupTracing() const;
+
+    //! Return the phases of the last init() (empty unless startup tracing is enabled)
+    const StartupTrace & getStartupTrace() const;
+
+    /*!
+     * \brief Return the trace the phases of init() are recorded in, or null if not tracing or not initializing
+     *
+     * Used by the sockets to record the phases of their init().
+     */
+    StartupTrace * startupTrace();
+
 protected:
     /*!
      * \brief Find and return an available tcp address, e.g. tcp://hostname:portnumber
@@ -243,6 +769,11 @@ protected:
      */
     virtual void announceNode();
 
+    /*!
+     * \brief Log the phases of init() (see setStartupTracing()), and append them to the B0_STARTUP_TRACE_FILE
+     */
+    void reportStartupTrace();
+
     /*!
      * \brief Notify resolver of this node shutdown
      */
@@ -253,6 +784,31 @@ protected:
      */
     virtual void heartbeatLoop();
 
+    /*!
+     * \brief Send the heartbeat of the group of this node, if this node is the group's first
+     *
+     * The other nodes of the group only get the resolver time, and the round-trip time it
+     * was measured with. If sync is false, the heartbeat does not wait for the resolver time.
+     * Return false if there is no time.
+     *
+     * \sa b0::setHeartbeatCoalescing()
+     */
+    bool coalescedHeartbeat(resolver::Client &resolv_cli, int64_t &time_usec, int64_t &delay_usec, bool sync = true);
+
+    /*!
+     * \brief Send the heartbeat of this node if it is due (called by spinOnce(), see setInlineHeartbeat())
+     */
+    void inlineHeartbeat();
+
+    /*!
+     * \brief Fill the resource usage of this node reported in the heartbeats
+     *
+     * The rates are averaged since the previous call.
+     *
+     * \sa b0::setHeartbeatStats()
+     */
+    void heartbeatStats(b0::message::graph::NodeStats &stats);
+
 public:
     /*!
      * \brief Return this computer's clock time in microseconds
@@ -282,6 +838,31 @@ public:
      */
     void responsiveSleepUSec(int64_t usec);
 
+    /*!
+     * \brief Sleep until the given hardwareTimeUSec(), but be responsive of shutdown event
+     *
+     * \sa setRealtimeSleep()
+     */
+    void responsiveSleepUntilUSec(int64_t until);
+
+    /*!
+     * \brief Wait until a socket has incoming messages, or until the timeout expires,
+     * but be responsive of shutdown event and of wakeUp()
+     *
+     * \return true if some socket has incoming messages
+     */
+    bool waitForMessagesUSec(int64_t usec);
+
+    /*!
+     * \brief Call the callbacks of the timers which are due (see createTimer())
+     */
+    void runTimers();
+
+    /*!
+     * \brief Return the time in microseconds until the next timer is due (0 if late), or -1 if there is no timer
+     */
+    int64_t nextTimerUSec();
+
     /*!
      * \brief Set the default spin rate
      */
@@ -300,10 +881,57 @@ public:
      */
     void setTimesyncMaxSlope(double max_slope);
 
+    /*!
+     * \brief Set the clock used by hardwareTimeUSec() (see b0::TimeSync::setClockSource())
+     */
+    void setClockSource(ClockSource source);
+
+    /*!
+     * \brief Follow a simulated clock, published on a topic, instead of this computer's clock
+     *
+     * The time of the clock (b0::message::sim::Clock messages, e.g. sent by b0_sim_clock) is
+     * then returned by hardwareTimeUSec() and timeUSec(), and drives spin(), the timers and
+     * the sleeps, so that a run can go faster (or slower) than real time, and be paused.
+     * The time is 0 until the first message, and never goes back. It advances by the steps
+     * of the clock, which are also the resolution of the timers.
+     *
+     * Call this before init(). The default is b0::getSimulatedTime().
+     */
+    void setSimulatedTime(bool enabled, const std::string &clock_topic = "clock");
+
+    /*!
+     * \brief Return true if the node follows a simulated clock (see setSimulatedTime())
+     */
+    bool getSimulatedTime() const;
+
 private:
     std::unique_ptr<Private> private_;
     std::unique_ptr<Private2> private2_;
 
+    //! Append the ZeroMQ sockets which spinOnce() would consume, and the wakeup channel last (see b0::Spinner)
+    void appendPollSockets(std::vector<void*> &sockets);
+
+    //! Discard the messages of the wakeup channel (see b0::Spinner)
+    void drainWakeUp();
+
+    //! Set the node spun by the calling thread of a b0::Spinner (nullptr when done), see isNodeThread()
+    static void setSpinnerNode(Node *node);
+
+    //! Connect the subscriber from spinOnce() when its topic has a publisher (see b0::Subscriber::setLazy())
+    void addLazySubscriber(Subscriber *sub);
+
+    //! Forget a lazy subscriber which has not been connected
+    void removeLazySubscriber(Subscriber *sub);
+
+    //! Connect the lazy subscribers whose topic has a publisher in the graph of the network
+    void connectLazySubscribers();
+
+    //! Read the changes published on the graph_delta topic (with the graph mutex held)
+    void readGraphDeltas();
+
+    //! Read the simulated clock, in a thread of its own (see setSimulatedTime())
+    void clockLoop();
+
 protected:
     //! Target address of resolver client
     std::string resolv_addr_;
@@ -345,11 +973,29 @@ private:
     //! Time synchronization object
     TimeSync time_sync_;
 
-    //! Node's default spin rate
-    double spin_rate_;
+    //! Node's default spin rate (can be changed at runtime, see handleControl())
+    std::atomic<double> spin_rate_;
+
+    //! Spin mode used by spin()
+    SpinMode spin_mode_;
+
+    //! Maximum rate of spinOnce() calls in SpinMode::EventDriven mode
+    double max_spin_rate_;
+
+    //! If true, spin() sleeps with clock_nanosleep()
+    bool realtime_sleep_;
+
+    //! Overruns and jitter of spin() in SpinMode::FixedRate mode
+    SpinCounters spin_counters_;
+
+    //! Number of callback executor threads
+    int num_callback_threads_;
 
 public:
     friend class Socket;
+    friend class Spinner;
+    friend class Subscriber;
+    friend class ProcessAgent;
 };
 
 } // namespace b0
@@ -0,0 +1,153 @@
+#ifndef B0__PROCESS_AGENT_H__INCLUDED
+#define B0__PROCESS_AGENT_H__INCLUDED
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+class Node;
+
+namespace message
+{
+
+namespace log
+{
+
+class LogEntry;
+class LogEntryBatch;
+
+} // namespace log
+
+namespace resolv
+{
+
+class Request;
+class Response;
+
+} // namespace resolv
+
+} // namespace message
+
+/*!
+ * \brief The resolver connection, heartbeats and remote log shared by the nodes of a process
+ *
+ * Without an agent, each node has its own connection to the resolver, heartbeat thread and
+ * log publisher. With an agent (see b0::setProcessAgent()), the nodes of the process
+ * connected to the same resolver send their resolver requests through one connection, the
+ * heartbeats of all of them are sent by one thread, and their log entries are published by
+ * one socket.
+ *
+ * The agent is created by the first node using it, and destroyed with the last one. It
+ * owns an ephemeral node (see b0::Node::setEphemeral()), which gets the addresses of the
+ * proxies from the resolver but does not appear in the graph.
+ *
+ * This class is used by b0::Node, b0::resolver::Client and b0::logger::Logger; it is not
+ * needed to use it directly.
+ */
+class ProcessAgent
+{
+public:
+    /*!
+     * \brief Return the agent of the nodes of this process using this resolver, creating it if there is none
+     */
+    static std::shared_ptr<ProcessAgent> get(const std::string &resolver_addr);
+
+    /*!
+     * \brief Return the number of agents of this process
+     */
+    static size_t getInstanceCount();
+
+    /*!
+     * \brief ProcessAgent destructor
+     */
+    virtual ~ProcessAgent();
+
+    /*!
+     * \brief Send a request to the resolver, with the given read timeout (in milliseconds, -1 for none)
+     *
+     * The requests of the nodes are serialized.
+     */
+    void callResolver(const b0::message::resolv::Request &rq, b0::message::resolv::Response &rsp, int timeout);
+
+    /*!
+     * \brief Send the heartbeats of the node (with the ones of the other nodes of the agent)
+     */
+    void addNode(Node *node);
+
+    /*!
+     * \brief Stop sending the heartbeats of the node
+     */
+    void removeNode(Node *node);
+
+    /*!
+     * \brief Return the number of nodes whose heartbeats are sent by this agent
+     */
+    size_t getNodeCount();
+
+    /*!
+     * \brief Publish a log entry to the given subtopic of the log topic
+     */
+    void publishLog(const std::string &subtopic, const b0::message::log::LogEntry &entry);
+
+    /*!
+     * \brief Publish a batch of log entries to the given subtopic of the log topic
+     */
+    void publishLog(const std::string &subtopic, const b0::message::log::LogEntryBatch &batch);
+
+    /*!
+     * \brief Return the address of the resolver of this agent
+     */
+    std::string getResolverAddress() const;
+
+protected:
+    /*!
+     * \brief Construct the agent (see get()), and announce its node to the resolver
+     */
+    ProcessAgent(const std::string &resolver_addr);
+
+    /*!
+     * \brief The heartbeat loop (run in its own thread)
+     */
+    void heartbeatLoop();
+
+private:
+    //! The resolver address, identifying this agent in the process
+    const std::string resolver_addr_;
+
+    //! Serializes the requests to the resolver
+    boost::mutex resolver_mutex_;
+
+    //! Protects nodes_
+    boost::mutex nodes_mutex_;
+
+    //! Serializes the log entries
+    boost::mutex log_mutex_;
+
+    //! The nodes whose heartbeats are sent, in the order they started
+    std::vector<Node*> nodes_;
+
+    //! Thread sending the heartbeats
+    boost::thread heartbeat_thread_;
+
+    //! \cond HIDDEN_SYMBOLS
+
+    struct Private;
+
+    //! \endcond
+
+    //! The node of the agent, its resolver client and its log publisher
+    std::unique_ptr<Private> private_;
+};
+
+} // namespace b0
+
+#endif // B0__PROCESS_AGENT_H__INCLUDED
@@ -26,6 +26,9 @@ namespace protobuf
  * You can directly read requests and write replies from the underlying socket, by using
  * ServiceServer::poll(), ServiceServer::read() and ServiceServer::write().
  *
+ * The request and the reply passed to the callback are allocated on an arena (see MessageArena),
+ * which is reset after each request.
+ *
  * \sa b0::ServiceClient, b0::ServiceServer, b0::AbstractServiceClient, b0::AbstractServiceServer
  */
 template<typename TReq, typename TRep>
@@ -36,7 +39,7 @@ public:
      * \brief Construct a ServiceServer child of a specific Node, using a boost::function as callback
      */
     ServiceServer(Node *node, std::string service_name, boost::function<void(const TReq&, TRep&)> callback = 0, bool managed = true, bool notify_graph = true)
-        : b0::ServiceServer(node, service_name, 0, managed, notify_graph),
+        : b0::ServiceServer(node, service_name, callback ? CallbackParts(boost::bind(&ServiceServer::handle, this, _1, _2)) : CallbackParts(), managed, notify_graph),
           callback_(callback)
     {
     }
@@ -61,28 +64,36 @@ public:
         // delegate constructor. leave empty
     }
 
+protected:
     /*!
-     * \brief Poll and read incoming messages, and dispatch them (called by b0::Node::spinOnce())
+     * \brief Parse the request, call the callback and serialize the reply (called by b0::ServiceServer::spinOnce())
      */
-    virtual void spinOnce() override
+    void handle(const std::vector<b0::message::MessagePart> &reqparts, std::vector<b0::message::MessagePart> &repparts)
     {
-        if(callback_.empty()) return;
-
-        while(poll())
+        try
         {
-            TReq req;
-            TRep rep;
-            read(this, req);
-            callback_(req, rep);
-            write(this, rep);
+            TReq *req = arena_.create<TReq>();
+            TRep *rep = arena_.create<TRep>();
+            parse(reqparts.at(0), *req);
+            callback_(*req, *rep);
+            repparts.resize(1);
+            serialize(*rep, repparts[0]);
         }
+        catch(...)
+        {
+            arena_.reset();
+            throw;
+        }
+        arena_.reset();
     }
 
-protected:
     /*!
      * \brief Callback which will be called when a new message is read from the socket
      */
     boost::function<void(const TReq&, TRep&)> callback_;
+
+    //! Arena the requests and replies are allocated on
+    MessageArena arena_;
 };
 
 } // namespace protobuf
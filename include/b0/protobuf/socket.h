@@ -1,9 +1,15 @@
 #ifndef B0__PROTOBUF__SOCKET_H__INCLUDED
 #define B0__PROTOBUF__SOCKET_H__INCLUDED
 
+#include <string>
+#include <vector>
+
 #include <b0/socket.h>
+#include <b0/message/message_part.h>
+#include <b0/message/message_envelope.h>
 #include <b0/exception/message_pack_error.h>
 
+#include <google/protobuf/arena.h>
 #include <google/protobuf/message.h>
 
 namespace b0
@@ -12,6 +18,42 @@ namespace b0
 namespace protobuf
 {
 
+/*!
+ * \brief Arena the received messages are allocated on
+ *
+ * It is reset after each message. Its first block is kept across resets, so that small
+ * messages are decoded without any heap allocation.
+ */
+class MessageArena
+{
+public:
+    //! Construct an arena, whose first block has the given size
+    explicit MessageArena(size_t initial_block_size = 8192);
+
+    //! Create a message on the arena
+    template<typename TMsg>
+    TMsg * create()
+    {
+        return google::protobuf::Arena::CreateMessage<TMsg>(&arena_);
+    }
+
+    //! Destroy all the messages created on the arena
+    void reset();
+
+private:
+    //! First block of the arena (declared before arena_, which uses it)
+    std::vector<char> initial_block_;
+
+    //! The arena
+    google::protobuf::Arena arena_;
+};
+
+/*!
+ * \brief Mixin class for reading and writing google::protobuf::Message
+ *
+ * Payloads are parsed directly from the received buffer, and the message part content type is
+ * the full name of the message type (google::protobuf::Message::GetTypeName()).
+ */
 class SocketProtobuf
 {
 public:
@@ -20,10 +62,42 @@ public:
      */
     virtual void read(Socket *socket, google::protobuf::Message &msg);
 
+    /*!
+     * \brief Read a message of type TMsg from the underlying ZeroMQ socket, allocated on the given arena
+     *
+     * The returned message is valid until the arena is reset.
+     */
+    template<typename TMsg>
+    TMsg * read(Socket *socket, MessageArena &arena)
+    {
+        TMsg *msg = arena.create<TMsg>();
+        read(socket, *msg);
+        return msg;
+    }
+
     /*!
      * \brief Write a google::protobuf::Message
      */
     virtual void write(Socket *socket, const google::protobuf::Message &msg);
+
+    /*!
+     * \brief Parse a google::protobuf::Message from a message part, checking its content type
+     */
+    static void parse(const b0::message::MessagePartView &part, google::protobuf::Message &msg);
+
+    /*!
+     * \brief Parse a google::protobuf::Message from a message part, checking its content type
+     */
+    static void parse(const b0::message::MessagePart &part, google::protobuf::Message &msg);
+
+    /*!
+     * \brief Serialize a google::protobuf::Message into a message part
+     */
+    static void serialize(const google::protobuf::Message &msg, b0::message::MessagePart &part);
+
+private:
+    //! Envelope the messages are read into, reused across messages
+    b0::message::MessageEnvelopeView envelope_;
 };
 
 } // namespace protobuf
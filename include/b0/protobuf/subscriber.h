@@ -24,6 +24,10 @@ namespace protobuf
  * Important when using a callback: you must call b0::Node::spin(), or periodically call
  * b0::Node::spinOnce(), otherwise no message will be delivered.
  *
+ * Messages delivered to the callback are parsed directly from the received buffer, and are
+ * allocated on an arena (see MessageArena), which is reset after each message: the callback must
+ * copy the message if it needs it afterwards.
+ *
  * Otherwise, you can directly read from the SUB socket, by using Subscriber::read().
  * Note: read operation is blocking. If you do not want to block, use Subscriber::poll() first.
  *
@@ -63,25 +67,40 @@ public:
     }
 
     /*!
-     * \brief Poll and read incoming messages, and dispatch them (called by b0::Node::spinOnce())
+     * \brief Return true if a callback has been set
      */
-    void spinOnce() override
+    bool hasCallback() const override
     {
-        if(callback_.empty()) return;
+        return !callback_.empty();
+    }
 
-        while(poll())
+protected:
+    /*!
+     * \brief Parse the message from the received parts, and call the callback
+     */
+    void dispatch(const std::vector<b0::message::MessagePartView> &parts) override
+    {
+        TMsg *msg = arena_.create<TMsg>();
+        try
         {
-            TMsg msg;
-            read(this, msg);
-            callback_(msg);
+            parse(parts.at(0), *msg);
+            callback_(*msg);
         }
+        catch(...)
+        {
+            arena_.reset();
+            throw;
+        }
+        arena_.reset();
     }
- 
-protected:
+
     /*!
      * \brief Callback which will be called when a new message is read from the socket
      */
-    boost::function<void(TMsg&)> callback_;
+    boost::function<void(const TMsg&)> callback_;
+
+    //! Arena the received messages are allocated on
+    MessageArena arena_;
 };
 
 } // namespace protobuf
@@ -1,8 +1,20 @@
 #ifndef B0__PUBLISHER_H__INCLUDED
 #define B0__PUBLISHER_H__INCLUDED
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
 
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/function.hpp>
+
 #include <b0/b0.h>
 #include <b0/socket.h>
 #include <b0/message/message_part.h>
@@ -10,8 +22,40 @@
 namespace b0
 {
 
+namespace shm
+{
+
+class Pool;
+
+} // namespace shm
+
 class Node;
 
+/*!
+ * \brief A message serialized (and compressed) once, to be published many times (see Publisher::prepare())
+ *
+ * It is immutable, and its copies share the serialized envelope, so it can be kept and
+ * published by several publishers, from several threads.
+ */
+class PreparedMessage
+{
+public:
+    //! Construct an empty prepared message (see Publisher::prepare())
+    PreparedMessage() {}
+
+    //! Return true if this holds a message
+    bool valid() const {return bool(wire_);}
+
+    //! Return the serialized envelope (see Socket::readWire())
+    boost::string_ref wire() const {return wire_ ? boost::string_ref(*wire_) : boost::string_ref();}
+
+private:
+    friend class Publisher;
+
+    //! The serialized envelope, starting with the header0 of the topic it was prepared for
+    std::shared_ptr<const std::string> wire_;
+};
+
 /*!
  * \brief The publisher class
  *
@@ -25,6 +69,8 @@ class Publisher : public Socket
 public:
     using logger::LogInterface::log;
 
+    using Socket::writeRaw;
+
     /*!
      * \brief Construct an Publisher child of the specified Node
      */
@@ -60,17 +106,35 @@ public:
      */
     virtual void publish(const std::vector<b0::message::MessagePart> &parts);
 
+    /*!
+     * \brief Publish a raw multipart message, taking ownership of the parts (no payload copy)
+     */
+    virtual void publish(std::vector<b0::message::MessagePart> &&parts);
+
     /*!
      * \brief Publish a raw message
      */
     virtual void publish(const std::string &msg, const std::string &type = "");
 
+    /*!
+     * \brief Publish a raw message, taking ownership of the payload buffer (no payload copy)
+     */
+    virtual void publish(std::string &&msg, const std::string &type = "");
+
     /*!
      * \brief Publish a message
      */
     template<class TMsg>
     void publish(const TMsg &msg)
     {
+        if(skip()) return;
+        if(async_running_.load())
+        {
+            // a copy, serialized by the thread (see setAsync())
+            std::shared_ptr<TMsg> copy = std::make_shared<TMsg>(msg);
+            enqueueAsync(b0::message::MessageEnvelope(), [this, copy]() {writeMsg(*copy);});
+            return;
+        }
         writeMsg(msg);
     }
 
@@ -80,9 +144,471 @@ public:
     template<class TMsg>
     void publish(const TMsg &msg, const std::vector<b0::message::MessagePart> &parts)
     {
+        if(skip()) return;
+        if(async_running_.load())
+        {
+            std::shared_ptr<TMsg> copy = std::make_shared<TMsg>(msg);
+            std::shared_ptr<std::vector<b0::message::MessagePart> > parts_copy = std::make_shared<std::vector<b0::message::MessagePart> >(parts);
+            enqueueAsync(b0::message::MessageEnvelope(), [this, copy, parts_copy]() {writeMsg(*copy, *parts_copy);});
+            return;
+        }
         writeMsg(msg, parts);
     }
 
+    /*!
+     * \brief Publish a serialized envelope received on another topic, as it is (e.g. in a relay)
+     *
+     * The wire is an envelope as returned by Socket::readWire(). Only its header0 line is
+     * replaced, with this publisher's topic (or subtopic, see setSubtopic()): the headers and
+     * the parts are sent without being parsed, decompressed nor compressed again, so that
+     * forwarding costs little more than a copy. A relay thus reads with readWire() and
+     * publishes with forward(), on the same topic of another resolver or on another topic.
+     *
+     * Nothing is added to the envelope (no stamping, time to live, delta encoding nor batching),
+     * and it is not delivered intra-process nor through shared memory. It is skipped as by
+     * publish() without subscribers (see setSkipUnsubscribed()).
+     */
+    void forward(boost::string_ref wire);
+
+    /*!
+     * \brief Serialize and compress a raw multipart message once, to publish it many times
+     *
+     * The envelope is built as by publish(), for the current topic (or subtopic) of this
+     * publisher, with its envelope format, checksum setting, and the compression of the parts.
+     * Publishing the result with publish(const PreparedMessage &) then costs only the send,
+     * which suits the messages sent over and over (keep-alives, static transforms), or the
+     * same message sent to several topics.
+     *
+     * As with forward(), nothing is added to the envelope when it is published: it is not
+     * stamped, and has no time to live nor delta encoding.
+     */
+    PreparedMessage prepare(const std::vector<b0::message::MessagePart> &parts);
+
+    /*!
+     * \brief Serialize and compress a raw message once, to publish it many times (see above)
+     */
+    PreparedMessage prepare(const std::string &msg, const std::string &type = "");
+
+    /*!
+     * \brief Serialize and compress a message once, to publish it many times (see above)
+     */
+    template<class TMsg>
+    PreparedMessage prepare(const TMsg &msg)
+    {
+        std::string payload, type;
+        serialize(msg, payload, type, getMessageCodec());
+        return prepare(payload, type);
+    }
+
+    /*!
+     * \brief Publish a prepared message (see prepare()), on the current topic of this publisher
+     *
+     * On the topic (and subtopic) it was prepared for, the serialized envelope is handed over
+     * to ZeroMQ without being copied. It can also be published by another publisher, or after
+     * setSubtopic(): only its header0 line is replaced then, as with forward().
+     */
+    void publish(const PreparedMessage &msg);
+
+    /*!
+     * \brief Add a raw message to the current batch, publishing the batch if the policy says so
+     *
+     * The messages of a batch are sent as the parts of a single envelope, with a Batch header,
+     * and subscribers deliver them to their callbacks one at a time, in order. This amortizes the
+     * framing, the headers and the system calls over many small messages.
+     *
+     * \sa setBatchPolicy(), flush()
+     */
+    void publishBatch(const std::string &msg, const std::string &type = "");
+
+    /*!
+     * \brief Set when the current batch is published (see publishBatch())
+     *
+     * The batch is published as soon as it holds max_count messages, or max_bytes bytes of
+     * payloads, or when its first message has waited max_delay_usec microseconds; a zero
+     * disables the corresponding limit. The delay is checked by spinOnce(), i.e. when the node
+     * spins; flush() publishes the batch at once.
+     *
+     * The default is 64 messages, 64 KiB, or 10 milliseconds.
+     */
+    void setBatchPolicy(size_t max_count, size_t max_bytes = 0, int64_t max_delay_usec = 0);
+
+    /*!
+     * \brief Publish the current batch now, if not empty (see publishBatch())
+     */
+    void flush();
+
+    /*!
+     * \brief Enable or disable the stamping of the published messages
+     *
+     * If enabled, the envelopes built by this publisher carry a Send-time header (the time
+     * of Node::timeUSec() when the message was sent, thus time-synced with the resolver),
+     * a Seq header (a per-publisher sequence number starting from 1) and a Publisher header
+     * (uniquely identifying this publisher), which subscribers use to measure latency and
+     * detect dropped messages (see Subscriber::getStatistics()).
+     *
+     * The default is disabled, unless the B0_STAMP_MESSAGES environment variable is set.
+     */
+    void setStampMessages(bool enabled);
+
+    //! Return true if the published messages are stamped (see setStampMessages())
+    bool getStampMessages() const;
+
+    /*!
+     * \brief Send the next messages to a subtopic of the topic (empty for the topic itself, the default)
+     *
+     * The messages are sent with "<topic>/<subtopic>" as header0, so that only the
+     * subscribers selecting the subtopic (see b0::Subscriber::setSubtopicFilters()) receive
+     * them, the subscriptions being matched by ZeroMQ at the proxy (or at this publisher).
+     * The topic of the graph and of the proxy is still the topic itself. The messages of a
+     * subtopic are not delivered intra-process (see b0::setIntraProcess()).
+     *
+     * Not synchronized with the messages being published by other threads.
+     */
+    void setSubtopic(const std::string &subtopic);
+
+    //! Return the subtopic of the published messages (see setSubtopic())
+    const std::string & getSubtopic() const;
+
+    /*!
+     * \brief Set the time to live of the published messages, in microseconds (0 for none, the default)
+     *
+     * If not 0, the envelopes carry an Expires header (the time of Node::timeUSec() when the
+     * message was sent, plus usec), and the subscribers which drop expired messages (see
+     * Subscriber::setDropExpired()) discard them instead of calling their callback once that
+     * time has passed, e.g. when they fall behind. Both nodes must be time-synced with the resolver.
+     *
+     * The default is taken from the B0_PUBLISHER_TTL environment variable, if set.
+     */
+    void setTimeToLive(int64_t usec);
+
+    //! Return the time to live of the published messages, in microseconds (see setTimeToLive())
+    int64_t getTimeToLive() const;
+
+    /*!
+     * \brief Enable or disable the shared-memory transport of large messages
+     *
+     * If enabled, envelopes with at least min_size bytes of payloads are serialized into a
+     * shared-memory segment of slot_count slots of slot_size bytes (see b0::shm::Pool), and only
+     * a small descriptor is sent through ZeroMQ. The subscribers map the segment and read the
+     * envelope in place, without copying it.
+     *
+     * This is done only while all the subscribers of the topic are on the same host as this
+     * publisher (see b0::Node::hostname()), which is checked in the resolver's graph every two
+     * seconds; otherwise, and for envelopes which do not fit in a slot, or when all the slots
+     * are in use, the messages are sent as usual. Subscribers which do not notify the graph
+     * are not taken into account.
+     *
+     * The default is disabled, unless the B0_SHARED_MEMORY environment variable is set.
+     */
+    void setSharedMemory(bool enabled, size_t slot_size = 16 * 1024 * 1024, size_t slot_count = 8, size_t min_size = 64 * 1024);
+
+    //! Return true if the shared-memory transport is enabled (see setSharedMemory())
+    bool getSharedMemory() const;
+
+    /*!
+     * \brief Enable or disable latching (must be called before init())
+     *
+     * A latched publisher keeps its last message and sends it again when a subscriber
+     * subscribes, so that subscribers joining late get the current value without waiting
+     * for the next message (e.g. for configuration topics published only on change).
+     * See setHistory() to keep more than the last message.
+     *
+     * The messages are always stamped (see setStampMessages()) and carry a Latched header;
+     * subscribers use the Seq header to drop the copies of a message they already got.
+     * The subscriptions are processed by spinOnce(), so the node must be spinning.
+     *
+     * Needs a resolver proxy which forwards every subscription (BlueZero 2.0 or later).
+     */
+    void setLatched(bool enabled);
+
+    //! Return true if this publisher is latched (see setLatched())
+    bool getLatched() const;
+
+    /*!
+     * \brief Keep the last messages and replay them to the new subscribers (must be called before init())
+     *
+     * Like latching (see setLatched()), of which this is the generalization, but the
+     * subscribers joining late get the history of the topic (e.g. the recent poses of a
+     * trajectory) rather than only its last message. The history is bounded by max_messages,
+     * and optionally by max_bytes (the total size of the payloads) and max_age (in seconds),
+     * 0 meaning no bound; the newest message is always kept. The messages are replayed in
+     * order; the subscribers already connected drop them (from the Seq header).
+     *
+     * The subscribers must receive all the messages: their rate limits, decimation and
+     * keep-latest (see Subscriber::setMaxRate(), Subscriber::setKeepLatest()) also apply to
+     * the replayed ones. A max_messages of 0 disables the history, and latching.
+     */
+    void setHistory(size_t max_messages, size_t max_bytes = 0, double max_age = 0);
+
+    //! Return the maximum number of messages of the history (see setHistory())
+    size_t getHistoryLimit() const;
+
+    //! Return the number of messages currently in the history (see setHistory())
+    size_t getHistorySize();
+
+    /*!
+     * \brief Send the messages as deltas against the previous one (must be called before init())
+     *
+     * The method is "xor", for payloads of constant size (e.g. occupancy grids or state
+     * vectors), or "ranges", for payloads whose size can change (see b0::compress::encodeDelta());
+     * an empty method disables delta encoding (the default). The deltas of slowly changing data
+     * are mostly zeroes or small, and are best combined with compression (see setCompression()).
+     *
+     * Every keyframe_interval messages, and when a message cannot be encoded against the
+     * previous one (e.g. the number of parts or, for "xor", the size changed), the message is
+     * sent whole as a keyframe (with a Keyframe header); the others carry a Delta header (the
+     * method) and a Delta-base header (the Seq of the message they apply to). The messages are
+     * always stamped (see setStampMessages()).
+     *
+     * b0::Subscriber reconstructs the messages before calling its callback. When it misses one
+     * (seen from the Seq header), it drops the deltas until the next keyframe, and asks this
+     * publisher for one through a subscription message, which spinOnce() reads: the node must
+     * be spinning. A new subscription triggers a keyframe too. A subscriber must thus receive
+     * all the messages: its rate limits, decimation and keep-latest (see
+     * Subscriber::setMaxRate(), Subscriber::setKeepLatest()) would make most of them useless.
+     *
+     * Not compatible with latching (see setLatched()). Not synchronized with the messages
+     * being published by other threads.
+     */
+    void setDeltaEncoding(const std::string &method, unsigned keyframe_interval = 100);
+
+    /*!
+     * \brief Send the messages again to the subscribers which missed them (must be called before init())
+     *
+     * The last messages are kept in a retransmission buffer, of at most max_messages messages
+     * and, if not 0, max_bytes of payloads. The messages are always stamped (see
+     * setStampMessages()): a b0::Subscriber in reliable mode (see Subscriber::setReliable())
+     * detects the messages it missed from the gaps in their Seq header (e.g. dropped by a full
+     * queue, or while reconnecting), and asks this publisher for them through a subscription
+     * message, which spinOnce() reads: the node must be spinning. The messages still in the
+     * buffer are sent again, with a Retransmitted header.
+     *
+     * This gives at-least-once delivery of the messages to the reliable subscribers, as long as
+     * the missed ones are asked for before they leave the buffer, at the throughput of
+     * pub/sub: the messages received are never acknowledged. The messages sent again come
+     * after the newer ones. The other subscribers drop them.
+     *
+     * Only the messages stamped by this publisher are kept: not the ones of forward() nor the
+     * prepared messages (see prepare()). A max_messages of 0 disables it (the default).
+     * Not compatible with delta encoding (see setDeltaEncoding()).
+     */
+    void setReliable(size_t max_messages, size_t max_bytes = 0);
+
+    //! Return the maximum number of messages kept for retransmission, or 0 (see setReliable())
+    size_t getReliable() const;
+
+    //! Return the number of messages sent again to the subscribers which missed them (see setReliable())
+    uint64_t getRetransmittedCount() const;
+
+    //! Return the method of delta encoding, or an empty string (see setDeltaEncoding())
+    const std::string & getDeltaEncoding() const;
+
+    /*!
+     * \brief Publish through a multicast group instead of the resolver proxy (must be called before init())
+     *
+     * The address is a ZeroMQ PGM endpoint, "epgm://<interface>;<group>:<port>" (PGM over
+     * UDP) or "pgm://..." (raw PGM, needs privileges), e.g. "epgm://eth0;239.192.1.1:5555".
+     * It is announced to the resolver, and the subscribers which enable multicast (see
+     * b0::Subscriber::setMulticast()) join the group, so that one transmission reaches all the
+     * subscribers of a network segment, whatever their number.
+     *
+     * rate_kbps is the maximum sending rate (ZMQ_RATE), which must fit the bandwidth of the topic.
+     * Needs a ZeroMQ library built with OpenPGM support. An empty address disables multicast.
+     */
+    void setMulticast(const std::string &address, int rate_kbps = 100000);
+
+    //! Return the multicast address of this publisher, or an empty string (see setMulticast())
+    std::string getMulticast() const;
+
+    /*!
+     * \brief What happens to a message when the outgoing queue of a subscriber is full
+     *
+     * \sa Publisher::setBackpressure()
+     */
+    enum class Backpressure
+    {
+        //! The message is dropped silently by ZeroMQ (the default)
+        Drop,
+        //! The message is dropped, counted, and the publisher is congested (see getCongested())
+        Count,
+        //! publish() waits for room, up to the write timeout (see setWriteTimeout()); then as Count
+        Block,
+        //! The message waits in a queue bounded in bytes (see setQueueLimit()), written again by
+        //! spinOnce() and by the next publish(); the oldest messages are dropped and counted when it is full
+        Queue
+    };
+
+    /*!
+     * \brief Set the behavior when the outgoing queue (see setWriteHWM()) is full (must be called before init())
+     *
+     * With Backpressure::Count, a producer can check getCongested() after publishing, and
+     * slow down or lower the quality of the data instead of losing messages unnoticed.
+     *
+     * With Backpressure::Queue, the memory taken by a burst is bounded in bytes rather than
+     * in messages: set a small write HWM (see setWriteHWM()), and the limit of the queue of the
+     * publisher with setQueueLimit().
+     *
+     * The queues are per subscriber in peer-to-peer mode (see b0::setPeerToPeer()): a message
+     * is dropped, or publish() blocks, as soon as one of them is full. Through the resolver
+     * proxy there is only the queue to the proxy, which itself still drops silently towards
+     * slow subscribers. Needs ZeroMQ 4.1 or later for Count and Block.
+     *
+     * The default is Drop, unless the B0_PUBLISHER_BACKPRESSURE environment variable is set
+     * (to "drop", "count", "block" or "queue").
+     */
+    void setBackpressure(Backpressure mode);
+
+    //! Return the behavior when the outgoing queue is full (see setBackpressure())
+    Backpressure getBackpressure() const;
+
+    //! Return true if the last message could not be queued (see setBackpressure())
+    bool getCongested() const;
+
+    //! Return the number of messages dropped because they could not be queued (see setBackpressure())
+    uint64_t getDroppedCount() const;
+
+    /*!
+     * \brief Set the maximum size of the messages waiting in the queue of the publisher (see Backpressure::Queue)
+     *
+     * The size is the one of the serialized messages. A message bigger than the limit is
+     * still queued, alone. The default is 16 MiB, unless the B0_PUBLISHER_QUEUE_LIMIT
+     * environment variable is set (in bytes).
+     */
+    void setQueueLimit(size_t max_bytes);
+
+    //! Return the maximum size of the queue of the publisher (see setQueueLimit())
+    size_t getQueueLimit() const;
+
+    //! Return the size of the messages waiting in the queue of the publisher (see Backpressure::Queue)
+    size_t getQueueBytes() const;
+
+    /*!
+     * \brief Allow publishing from any thread (must be called before init())
+     *
+     * Normally, as for any socket, publish() must be called from the thread of the node.
+     * A thread-safe publisher can be used by worker threads directly: each thread other than
+     * the node's gets its own PUB socket, created when the thread first publishes and connected
+     * to the same XSUB socket of the resolver's proxy, so that the threads do not wait for each
+     * other. The messages of a thread arrive in order, but there is no order between threads,
+     * and the first messages of a new thread can be lost while its socket connects (as with a
+     * new publisher).
+     *
+     * The features which need the single socket of the publisher (peer-to-peer mode, multicast,
+     * latching, backpressure, shared memory, splitting into chunks, intra-process delivery) write
+     * it from the calling thread, serialized by a mutex. For this reason the node does not poll
+     * the socket of a thread-safe publisher (see isReadInBackground()): the new subscriptions are
+     * read at the next spin of the node, instead of waking it up. The adaptive compression (see
+     * Socket::setAdaptiveCompression()) must not be used from several threads. The threads must
+     * stop publishing before cleanup(), which closes their sockets.
+     *
+     * The default is disabled, unless the B0_PUBLISHER_THREAD_SAFE environment variable is set.
+     */
+    void setThreadSafe(bool enabled);
+
+    //! Return true if publish() can be called from any thread (see setThreadSafe())
+    bool getThreadSafe() const;
+
+    /*!
+     * \brief Skip the messages published while the topic has no subscribers (must be called before init())
+     *
+     * If enabled, publish() and publishBatch() return at once when hasSubscribers() is false,
+     * before serializing and compressing the message: topics which are only looked at from
+     * time to time (e.g. for debugging or visualization) then cost almost nothing. The skipped
+     * messages are counted (see getSkippedCount()).
+     *
+     * The subscriptions are those seen by the publisher's socket (an XPUB socket): they take
+     * a moment to arrive after init() and after a subscriber connects, and the messages
+     * published in between are skipped. Through the resolver proxy, a topic which had several
+     * subscribers at once may keep looking subscribed after they have all gone (the proxy
+     * forwards only the last unsubscription), so it is never skipped wrongly, but can be sent
+     * for nobody. Latched publishers (see setLatched()) never skip.
+     *
+     * The default is disabled, unless the B0_PUBLISHER_SKIP_UNSUBSCRIBED environment variable is set.
+     */
+    void setSkipUnsubscribed(bool enabled);
+
+    //! Return true if the messages published without subscribers are skipped (see setSkipUnsubscribed())
+    bool getSkipUnsubscribed() const;
+
+    /*!
+     * \brief Return true if the topic has subscribers, as far as this publisher knows
+     *
+     * The subscriptions are tracked when the publisher reads them (see setSkipUnsubscribed(),
+     * setLatched(), setBackpressure(), setDeltaEncoding()); otherwise, and for multicast, this
+     * is always true. The subscribers of this process (see b0::setIntraProcess()) count too.
+     * The caller can use it to avoid building a message nobody will receive.
+     */
+    bool hasSubscribers();
+
+    //! Return the number of messages skipped for lack of subscribers (see setSkipUnsubscribed())
+    uint64_t getSkippedCount() const;
+
+    /*!
+     * \brief What happens to a message published asynchronously when the queue is full
+     *
+     * \sa Publisher::setAsync()
+     */
+    enum class AsyncOverflow
+    {
+        //! The oldest message waiting is dropped, and counted (see getDroppedCount())
+        Drop,
+        //! publish() waits for room
+        Block
+    };
+
+    /*!
+     * \brief Encode, compress and send the messages in a background thread (must be called before init())
+     *
+     * If queue_size is not 0, init() starts a thread of the publisher, and publish() only
+     * queues the messages for it: the raw payloads and parts are moved into the queue (with
+     * the overloads taking rvalues) or copied, the typed messages are copied, and the thread
+     * serializes, stamps, delta-encodes and compresses them, then writes them, in order. The
+     * caller then spends little more than a copy per message, even for large compressed ones.
+     *
+     * When queue_size messages are waiting, publish() drops the oldest of them
+     * (AsyncOverflow::Drop) or waits for room (AsyncOverflow::Block). A message which fails
+     * to be written is dropped and counted as well. The batches (see publishBatch()) go
+     * through the queue too, but forward() writes at once. cleanup() writes the messages still
+     * waiting before stopping the thread.
+     *
+     * The default is 0 (disabled), unless the B0_PUBLISHER_ASYNC environment variable is set to
+     * the queue size, with the overflow policy in B0_PUBLISHER_ASYNC_OVERFLOW ("drop" or "block").
+     */
+    void setAsync(size_t queue_size, AsyncOverflow overflow = AsyncOverflow::Drop);
+
+    //! Return the size of the queue of the background thread (0 if disabled, see setAsync())
+    size_t getAsync() const;
+
+    //! Return what happens to a message when the queue of the background thread is full (see setAsync())
+    AsyncOverflow getAsyncOverflow() const;
+
+    //! Return the number of messages waiting for the background thread (see setAsync())
+    size_t getAsyncQueueSize() const;
+
+    /*!
+     * \brief Read the subscriptions, and send the history again to the new subscribers if latched
+     */
+    virtual void spinOnce() override;
+
+    /*!
+     * \brief Return true if the subscriptions are read by spinOnce() (latched, with backpressure,
+     *        delta encoding, or skipping the messages without subscribers)
+     */
+    virtual bool hasCallback() const override;
+
+    /*!
+     * \brief Return true if the current batch has waited longer than allowed (see setBatchPolicy()),
+     *        or if a thread-safe publisher has subscriptions to read (see isReadInBackground())
+     */
+    virtual bool hasPendingMessages() const override;
+
+    /*!
+     * \brief Return true if the publisher is thread-safe (see setThreadSafe())
+     *
+     * Its socket can be written by other threads at any time, so b0::Node does not poll it.
+     */
+    virtual bool isReadInBackground() const override;
+
 protected:
     /*!
      * \brief Connect to the remote address
@@ -94,8 +620,330 @@ protected:
      */
     virtual void disconnect();
 
+    /*!
+     * \brief Bind to a free TCP port and announce it to the resolver (peer-to-peer mode)
+     */
+    virtual void bind();
+
+    //! Address this socket is bound to in peer-to-peer mode (empty otherwise)
+    std::string bind_addr_;
+
     //! If false this socket will not send announcement to resolv (i.e. it will be "invisible")
     const bool notify_graph_;
+
+    /*!
+     * \brief Add the Send-time, Seq and Publisher headers, if stamping is enabled
+     */
+    virtual void prepareEnvelope(b0::message::MessageEnvelope &env) override;
+
+    /*!
+     * \brief Messages delivered intra-process or through shared memory are not written in place (see Socket::writeFrame())
+     */
+    virtual bool canWriteFrameInPlace(size_t payload_size) const override;
+
+    /*!
+     * \brief Write an envelope through shared memory, if enabled and possible (see setSharedMemory())
+     *
+     * \return false if the envelope must be written as usual
+     */
+    bool writeSharedMemory(const b0::message::MessageEnvelope &env);
+
+    /*!
+     * \brief Return true if all the subscribers of the topic are on the host of this node
+     */
+    bool subscribersAreLocal();
+
+public:
+    /*!
+     * \brief Write a MessageEnvelope, handing it over to the subscribers of this process
+     *        if the intra-process transport is enabled (see b0::setIntraProcess())
+     */
+    virtual void writeRaw(const b0::message::MessageEnvelope &env) override;
+
+private:
+    //! Intra-process delivery key (empty if intra-process transport is not used)
+    std::string intra_process_key_;
+
+    //! If true, published messages are stamped
+    //! \sa Publisher::setStampMessages()
+    bool stamp_messages_;
+
+    //! Subtopic of the published messages, or empty
+    //! \sa Publisher::setSubtopic()
+    std::string subtopic_;
+
+    //! Time to live of the published messages, in microseconds
+    //! \sa Publisher::setTimeToLive()
+    int64_t ttl_usec_;
+
+    //! Sequence number of the last stamped message
+    std::atomic<uint64_t> seq_{0};
+
+    //! Value of the Publisher header of the stamped messages
+    std::string publisher_id_;
+
+    //! If true, large messages are written through shared memory
+    //! \sa Publisher::setSharedMemory()
+    bool shared_memory_;
+
+    //! Size of the shared-memory slots
+    size_t shm_slot_size_{16 * 1024 * 1024};
+
+    //! Number of shared-memory slots
+    size_t shm_slot_count_{8};
+
+    //! Smaller messages are not written through shared memory
+    size_t shm_min_size_{64 * 1024};
+
+    //! Shared-memory segment, created when first used
+    std::unique_ptr<shm::Pool> shm_pool_;
+
+    //! True if all the subscribers were on this host at the last check
+    bool shm_subscribers_local_{false};
+
+    //! Time of the next check of the subscribers' hosts
+    std::chrono::steady_clock::time_point next_shm_check_;
+
+    //! Serializer of the envelopes written through shared memory
+    b0::message::EnvelopeSerializer shm_serializer_;
+
+    //! Descriptor frame, reused across messages
+    std::string shm_frame_;
+
+    //! Multicast address, if publishing through multicast
+    //! \sa Publisher::setMulticast()
+    std::string multicast_addr_;
+
+    //! If true, the last message is sent again to new subscribers
+    //! \sa Publisher::setLatched()
+    bool latched_{false};
+
+    //! Behavior when the outgoing queue is full
+    //! \sa Publisher::setBackpressure()
+    Backpressure backpressure_{Backpressure::Drop};
+
+    //! Maximum size of the queue, with Backpressure::Queue
+    //! \sa Publisher::setQueueLimit()
+    size_t queue_limit_;
+
+    //! Use an XPUB socket and set its options, as needed for latching and backpressure
+    void updateSocketType();
+
+    //! A message kept for the new subscribers
+    struct HistoryEntry
+    {
+        //! The message, as written
+        b0::message::MessageEnvelope env;
+
+        //! The total size of its payloads
+        size_t bytes;
+
+        //! The time it was written at (see Node::timeUSec())
+        int64_t time_usec;
+    };
+
+    //! The last messages written, if latched, oldest first
+    std::deque<HistoryEntry> history_;
+
+    //! Maximum number of messages in history_
+    //! \sa Publisher::setHistory()
+    size_t history_max_messages_{0};
+
+    //! Maximum total size of the payloads in history_, or 0
+    size_t history_max_bytes_{0};
+
+    //! Maximum age of the messages in history_, or 0
+    int64_t history_max_age_usec_{0};
+
+    //! Total size of the payloads in history_
+    size_t history_bytes_{0};
+
+    //! Remove the messages exceeding the bounds of the history, but the newest one
+    void trimHistory(int64_t now_usec);
+
+    //! Method of delta encoding, or empty
+    //! \sa Publisher::setDeltaEncoding()
+    std::string delta_method_;
+
+    //! Number of messages from a keyframe to the next
+    unsigned delta_keyframe_interval_{100};
+
+    //! Number of messages sent since the last keyframe (0: the next one is a keyframe)
+    unsigned delta_count_{0};
+
+    //! Set by spinOnce() when a subscriber asks for a keyframe
+    std::atomic<bool> delta_keyframe_requested_{false};
+
+    //! Payloads of the last message, which the next one is encoded against
+    std::vector<std::string> delta_base_;
+
+    //! Seq header of the last message
+    uint64_t delta_base_seq_{0};
+
+    //! Deltas being encoded, reused across messages
+    std::vector<std::string> delta_scratch_;
+
+    //! Replace the payloads of a message with their deltas, or mark it as a keyframe
+    void encodeDelta(b0::message::MessageEnvelope &env, uint64_t seq);
+
+    //! A message kept for retransmission
+    struct RetransmitEntry
+    {
+        //! Its Seq header
+        uint64_t seq;
+
+        //! The message, as written
+        b0::message::MessageEnvelope env;
+
+        //! The total size of its payloads
+        size_t bytes;
+    };
+
+    //! Maximum number of messages in retransmit_buffer_, or 0
+    //! \sa Publisher::setReliable()
+    size_t reliable_max_messages_{0};
+
+    //! Maximum total size of the payloads in retransmit_buffer_, or 0
+    size_t reliable_max_bytes_{0};
+
+    //! The last messages written, if reliable, by increasing Seq (protected by write_mutex_)
+    std::deque<RetransmitEntry> retransmit_buffer_;
+
+    //! Total size of the payloads in retransmit_buffer_
+    size_t retransmit_bytes_{0};
+
+    //! The ranges of Seq asked for by the subscribers, read by readSubscriptions()
+    std::vector<std::pair<uint64_t, uint64_t> > retransmit_requests_;
+
+    //! Number of messages sent again
+    std::atomic<uint64_t> retransmitted_{0};
+
+    //! Keep a message written for retransmission (write_mutex_ must be locked)
+    void keepForRetransmission(const b0::message::MessageEnvelope &env);
+
+    //! Send again the messages asked for by the subscribers (write_mutex_ must be locked)
+    void retransmit();
+
+    //! Serializes the writes with the reads of the subscriptions by spinOnce() (see hasCallback())
+    mutable boost::mutex write_mutex_;
+
+    //! The messages of the current batch
+    //! \sa Publisher::publishBatch()
+    std::vector<b0::message::MessagePart> batch_;
+
+    //! Total payload size of the current batch
+    size_t batch_bytes_{0};
+
+    //! Time the current batch must be published by
+    std::chrono::steady_clock::time_point batch_deadline_;
+
+    //! Maximum number of messages in a batch (0: unlimited)
+    size_t batch_max_count_{64};
+
+    //! Maximum payload size of a batch (0: unlimited)
+    size_t batch_max_bytes_{64 * 1024};
+
+    //! Maximum delay of the first message of a batch (0: unlimited)
+    int64_t batch_max_delay_usec_{10000};
+
+    //! Protects the current batch
+    mutable boost::mutex batch_mutex_;
+
+    //! Publish the current batch (batch_mutex_ must be locked)
+    void flushBatch();
+
+    //! If true, publish() can be called from any thread
+    //! \sa Publisher::setThreadSafe()
+    bool thread_safe_;
+
+    //! If true, the messages published without subscribers are skipped
+    //! \sa Publisher::setSkipUnsubscribed()
+    bool skip_unsubscribed_;
+
+    //! The filters of the current subscriptions to this topic (protected by write_mutex_)
+    std::set<std::string> subscriptions_;
+
+    //! True if subscriptions_ is not empty
+    std::atomic<bool> has_subscribers_{false};
+
+    //! Number of messages skipped for lack of subscribers
+    std::atomic<uint64_t> skipped_{0};
+
+    //! Read the subscription messages of the XPUB socket (write_mutex_ must be locked)
+    //! \return true if a new subscription to this topic arrived
+    bool readSubscriptions();
+
+    //! Return true (and count it) if the message being published is to be skipped
+    bool skip();
+
+    //! Return true if the writes lock write_mutex_ (see hasCallback(), setThreadSafe(), setAsync())
+    bool lockedWrites() const;
+
+    //! Maximum number of messages waiting for async_thread_ (0: synchronous publishing)
+    //! \sa Publisher::setAsync()
+    size_t async_size_;
+
+    //! \sa Publisher::setAsync()
+    AsyncOverflow async_overflow_{AsyncOverflow::Drop};
+
+    //! A message waiting for async_thread_: an envelope to prepare and write, or a typed message to serialize
+    struct AsyncMessage
+    {
+        b0::message::MessageEnvelope env;
+        boost::function<void()> write;
+    };
+
+    //! The messages waiting for async_thread_
+    std::deque<AsyncMessage> async_queue_;
+
+    //! Protects async_queue_ and async_stop_
+    mutable boost::mutex async_mutex_;
+
+    //! Signaled when a message is queued, or the thread must stop
+    boost::condition_variable async_cond_;
+
+    //! Signaled when async_queue_ has room again
+    boost::condition_variable async_room_cond_;
+
+    //! Set by cleanup() to stop async_thread_, once the queue is empty
+    bool async_stop_{false};
+
+    //! True while async_thread_ runs, i.e. publish() queues the messages
+    std::atomic<bool> async_running_{false};
+
+    //! Thread preparing and writing the queued messages
+    boost::thread async_thread_;
+
+    //! Body of async_thread_
+    void asyncLoop();
+
+    //! Queue a message for async_thread_ (see AsyncMessage)
+    void enqueueAsync(b0::message::MessageEnvelope &&env, const boost::function<void()> &write = boost::function<void()>());
+
+    //! Write the messages waiting, and stop async_thread_
+    void stopAsync();
+
+    //! Build the envelope of a raw message, as Socket::writeRaw() does, to queue it
+    b0::message::MessageEnvelope makeEnvelope(std::string &&msg, const std::string &type);
+
+    //! \cond HIDDEN_SYMBOLS
+
+    struct ThreadSocket;
+
+    //! \endcond
+
+    //! The sockets of the threads other than the node's (see setThreadSafe())
+    std::map<boost::thread::id, std::unique_ptr<ThreadSocket> > thread_sockets_;
+
+    //! Protects thread_sockets_ (shared for the lookups)
+    boost::shared_mutex thread_sockets_mutex_;
+
+    //! Return true if the envelope can be written through the socket of the calling thread
+    bool canWriteThreadSocket(const b0::message::MessageEnvelope &env) const;
+
+    //! Write an envelope through the socket of the calling thread, creating it if needed
+    //! \return false if the envelope must be written through the publisher's socket
+    bool writeThreadSocket(const b0::message::MessageEnvelope &env);
 };
 
 } // namespace b0
@@ -3,15 +3,39 @@
 
 #include <b0/b0.h>
 #include <b0/service_client.h>
+#include <b0/publisher.h>
 #include <b0/message/graph/graph.h>
+#include <b0/message/graph/graph_delta.h>
+#include <b0/message/graph/get_graph_request.h>
+#include <b0/message/resolv/announce_sockets_request.h>
 
 #include <cstdint>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace b0
 {
 
 class Node;
+class ProcessAgent;
+
+namespace message
+{
+
+namespace resolv
+{
+
+class Request;
+class Response;
+class SyncStateResponse;
+class SyncDirectoryRequest;
+class SyncDirectoryResponse;
+
+} // namespace resolv
+
+} // namespace message
 
 namespace resolver
 {
@@ -34,6 +58,19 @@ public:
      */
     virtual ~Client();
 
+    /*!
+     * \brief Set the address of the resolver, or a comma separated list of resolvers for failover
+     *
+     * With more than one resolver (e.g. a primary and its standby, see
+     * b0::resolver::Resolver::setPrimary()), the requests go to the first one until it does
+     * not respond within the read timeout (B0_RESOLVER_FAILOVER_TIMEOUT milliseconds, if not
+     * set), then the request is sent again to the next one. The switch is shared by all the
+     * resolver clients of this process using the same list.
+     *
+     * The default is the B0_RESOLVER environment variable.
+     */
+    void setResolverAddress(const std::string &addrs);
+
     /*!
      * \brief Set a timeout for the read in the announce phase. Use -1 for no timeout.
      * A timeout will cause the announce phase to abort if a response from the resolver
@@ -41,21 +78,120 @@ public:
      */
     void setAnnounceTimeout(int timeout = -1);
 
+    /*!
+     * \brief Send the requests through the agent of the process, instead of a connection of this client (must be called before init())
+     *
+     * \sa b0::setProcessAgent()
+     */
+    void setProcessAgent(std::shared_ptr<ProcessAgent> agent);
+
+    /*!
+     * \brief Connect to the resolver, unless the requests go through the agent of the process
+     */
+    virtual void init() override;
+
+    /*!
+     * \brief Disconnect from the resolver, unless the requests go through the agent of the process
+     */
+    virtual void cleanup() override;
+
+    /*!
+     * \brief Make the node ephemeral: it only makes lookups (see b0::Node::setEphemeral())
+     *
+     * The node is announced only to get the addresses of the proxies, and does not join the
+     * graph: the notifications of its sockets and of its shutdown are not sent, and it sends
+     * no heartbeats. It cannot announce services nor topics.
+     */
+    void setEphemeral(bool enabled);
+
+    //! Return true if the node is ephemeral (see setEphemeral())
+    bool getEphemeral() const;
+
     /*!
      * \brief Announce this node to resolver
      */
     virtual void announceNode(const std::string &host_id, int process_id, std::string &node_name, std::string &xpub_sock_addr, std::string &xsub_sock_addr, int64_t &minimum_heartbeat_interval);
 
+    /*!
+     * \brief Announce this node to resolver, retrieving the addresses of all the resolver's proxies
+     */
+    virtual void announceNode(const std::string &host_id, int process_id, std::string &node_name, std::vector<std::string> &xpub_sock_addrs, std::vector<std::string> &xsub_sock_addrs, std::map<std::string, int> &topic_proxy, int64_t &minimum_heartbeat_interval);
+
     /*!
      * \brief Notify resolver of this node shutdown
      */
     virtual void notifyShutdown();
 
+    /*!
+     * \brief Start collecting the announcements, to send them in a single request
+     *
+     * Until endAnnounceBatch(), the calls to announceService(), announceTopic(),
+     * notifyTopic() and notifyService() are collected instead of being sent. They are
+     * sent (as an AnnounceSocketsRequest) by endAnnounceBatch(), or before a lookup
+     * (resolveService(), resolveTopic()) which may depend on them.
+     */
+    void beginAnnounceBatch();
+
+    /*!
+     * \brief Send the collected announcements, and stop collecting them
+     */
+    void endAnnounceBatch();
+
+    /*!
+     * \brief Send the collected announcements (if any), and keep collecting
+     */
+    void flushAnnounceBatch();
+
     /*!
      * \brief Send a heartbeat to resolver
      */
     virtual void sendHeartbeat(int64_t *time_usec = nullptr);
 
+    /*!
+     * \brief Send a heartbeat to resolver, also on behalf of other nodes of this process
+     *
+     * If the heartbeat channel is open (see openHeartbeatChannel()) and time_usec is null,
+     * the heartbeat is published on it, without waiting for a reply. The resource usage
+     * of the nodes, if given, is piggy-backed on the heartbeat.
+     *
+     * The resolver time is the time of the reply plus half the round-trip time, which is
+     * stored in delay_usec, if given (see b0::TimeSync::updateTime()).
+     *
+     * An ephemeral node (see setEphemeral()) is not known to the resolver: its heartbeat is
+     * only on behalf of the other nodes, the first of which is named as the sender.
+     *
+     * \sa b0::setHeartbeatCoalescing(), b0::setHeartbeatStats()
+     */
+    virtual void sendHeartbeat(int64_t *time_usec, const std::vector<std::string> &other_node_names, const std::vector<b0::message::graph::NodeStats> &stats = {}, int64_t *delay_usec = nullptr);
+
+    /*!
+     * \brief Return the topic the resolver accepts heartbeats on, as of the last announceNode() (empty if none)
+     */
+    std::string getHeartbeatTopic() const;
+
+    /*!
+     * \brief Return the addresses of the XPUB sockets of the high-priority proxies, as of the last announceNode() (empty if none)
+     */
+    std::vector<std::string> getPriorityXPUBSocketAddresses() const;
+
+    /*!
+     * \brief Return the addresses of the XSUB sockets of the high-priority proxies, as of the last announceNode() (empty if none)
+     */
+    std::vector<std::string> getPriorityXSUBSocketAddresses() const;
+
+    /*!
+     * \brief Publish the heartbeats which do not need a reply on the given topic (see getHeartbeatTopic())
+     *
+     * Does nothing if the topic is empty, or if there is more than one resolver, since after
+     * a failover the heartbeats would still go to the proxy of the failed resolver.
+     */
+    void openHeartbeatChannel(const std::string &topic);
+
+    /*!
+     * \brief Return true if the heartbeat channel is open
+     */
+    bool hasHeartbeatChannel() const;
+
     /*!
      * \brief Notify topic publishing/subscription start or end
      */
@@ -67,22 +203,165 @@ public:
     virtual void notifyService(std::string service_name, bool reverse, bool active);
 
     /*!
-     * \brief Announce a service name and address
+     * \brief Announce a service name and address, and optionally its IPC endpoint
      */
-    virtual void announceService(std::string name, std::string addr);
+    virtual void announceService(std::string name, std::string addr, std::string ipc_addr = "");
 
     /*!
      * \brief Resolve a service name
      */
     virtual void resolveService(std::string name, std::string &addr);
 
+    /*!
+     * \brief Resolve a service name to the addresses of all its servers
+     */
+    virtual void resolveService(std::string name, std::vector<std::string> &addrs);
+
+    /*!
+     * \brief Drop the service resolutions cached by this process (see b0::setServiceCache())
+     */
+    static void clearServiceCache();
+
+    /*!
+     * \brief Drop the service resolutions cached by this process if the services offered in the graph have changed
+     *
+     * Only the changes to the services offered by the nodes are considered, since the
+     * clients using a service (which come and go) do not change its resolution. If a
+     * delta has been missed, the cache is dropped as well.
+     */
+    static void updateServiceCache(const b0::message::graph::GraphDelta &delta);
+
+    /*!
+     * \brief Announce the address of a publisher in peer-to-peer mode, and optionally its IPC endpoint
+     */
+    virtual void announceTopic(std::string name, std::string addr, std::string ipc_addr = "");
+
+    /*!
+     * \brief Resolve a topic name to the addresses of its publishers in peer-to-peer mode
+     */
+    virtual void resolveTopic(std::string name, std::vector<std::string> &addrs);
+
+    /*!
+     * \brief Fetch a compression dictionary from the resolver
+     *
+     * \return false if the resolver does not know the dictionary
+     */
+    virtual bool getCompressionDictionary(std::string id, std::string &data);
+
+    /*!
+     * \brief Get the id of a content type (assigned if new), or the content type of an id if content_type is empty
+     *
+     * \return false if the resolver does not know the id
+     */
+    virtual bool getContentTypeId(std::string &content_type, int64_t &id);
+
     /*!
      * \brief Request the node sockets graph
      */
     virtual void getGraph(b0::message::graph::Graph &graph);
 
+    /*!
+     * \brief Request the node sockets graph, unless its version is if_newer_than_version
+     *
+     * Return false, leaving graph untouched, if the graph has not changed. The node stats
+     * (see b0::setHeartbeatStats()) are not versioned: fetch the graph unconditionally for them.
+     */
+    virtual bool getGraph(b0::message::graph::Graph &graph, int64_t if_newer_than_version);
+
+    /*!
+     * \brief Request the part of the graph selected by the filters of the query (see b0::message::graph::GetGraphRequest)
+     *
+     * The filters are evaluated by the resolver, so the size of the response is the one of the
+     * answer (in decentralized mode, the discovered graph is filtered locally). Return false,
+     * leaving graph untouched, if the graph is at query.if_newer_than_version.
+     */
+    virtual bool getGraph(b0::message::graph::Graph &graph, const b0::message::graph::GetGraphRequest &query);
+
+    /*!
+     * \brief Request the state of the resolver (used by a standby resolver)
+     *
+     * If the state is at the given version already, rsp.changed is false and the state is not sent.
+     */
+    virtual void syncState(int64_t version, b0::message::resolv::SyncStateResponse &rsp);
+
+    /*!
+     * \brief Send the directory of a site to the parent resolver, and get the directory of the other sites (used by a federated resolver)
+     *
+     * \sa b0::resolver::Resolver::setParent()
+     */
+    virtual void syncDirectory(const b0::message::resolv::SyncDirectoryRequest &rq, b0::message::resolv::SyncDirectoryResponse &rsp);
+
+    /*!
+     * \brief Fetch the parameters whose name starts with prefix
+     *
+     * \return the version of the parameters (see b0::message::resolv::ParamUpdate)
+     */
+    virtual int64_t getParams(const std::string &prefix, std::map<std::string, std::string> &params);
+
+    /*!
+     * \brief Set a parameter, or remove it if remove is true
+     *
+     * \return the version of the parameters after the change
+     */
+    virtual int64_t setParam(const std::string &name, const std::string &value, bool remove = false);
+
+protected:
+    /*!
+     * \brief Send a request to the resolver in use, failing over to the next one if it does not respond
+     */
+    void callResolver(const b0::message::resolv::Request &rq, b0::message::resolv::Response &rsp);
+
+    /*!
+     * \brief Return the resolver in use by this process
+     */
+    std::string activeResolver() const;
+
+    /*!
+     * \brief Switch this process from a resolver which does not respond to the next one, and return it
+     */
+    std::string failover(const std::string &failed_addr);
+
+    /*!
+     * \brief Connect to another resolver
+     */
+    void switchResolver(const std::string &addr);
+
+    /*!
+     * \brief Replace the TCP addresses of the sockets on the host of this node with their IPC endpoints
+     *
+     * ipc_addrs is parallel to addrs (an empty string when a socket has no IPC endpoint), or
+     * empty if the resolver did not send any. Does nothing if IPC is disabled (see b0::setIPC()).
+     */
+    void preferIPC(std::vector<std::string> &addrs, const std::vector<std::string> &ipc_addrs) const;
+
 private:
     int announce_timeout_;
+
+    //! If true, the node only makes lookups (see setEphemeral())
+    bool ephemeral_;
+
+    //! The resolvers, in order of preference
+    std::vector<std::string> resolver_addrs_;
+
+    //! The list of resolvers, identifying the failover state shared in this process
+    std::string resolver_addrs_key_;
+
+    //! The announcements collected since beginAnnounceBatch() (null if not collecting)
+    std::unique_ptr<b0::message::resolv::AnnounceSocketsRequest> batch_;
+
+    //! The heartbeat topic given by the resolver in reply to announceNode()
+    std::string heartbeat_topic_;
+
+    //! The addresses of the high-priority proxies given by the resolver in reply to announceNode()
+    std::vector<std::string> xpub_priority_sock_addrs_, xsub_priority_sock_addrs_;
+
+    //! Publisher of the heartbeats not needing a reply (null if the channel is not open)
+    std::unique_ptr<b0::Publisher> heartbeat_pub_;
+
+    //! The agent the requests are sent through (null if sent by this client, see setProcessAgent())
+    std::shared_ptr<ProcessAgent> agent_;
+
+    friend class b0::ProcessAgent;
 };
 
 } // namespace resolver
@@ -0,0 +1,106 @@
+#ifndef B0__RESOLVER__DISCOVERY_H__INCLUDED
+#define B0__RESOLVER__DISCOVERY_H__INCLUDED
+
+#include <b0/b0.h>
+#include <b0/message/graph/graph.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace b0
+{
+
+namespace resolver
+{
+
+/*!
+ * \brief Name resolution without a resolver (decentralized mode)
+ *
+ * There is one instance per process, shared by its nodes. It broadcasts the services and
+ * the peer-to-peer publishers of the nodes of this process in a UDP beacon (see
+ * b0::message::resolv::DiscoveryBeacon), and keeps the beacons received from the other
+ * processes, which expire when not repeated within three intervals.
+ *
+ * The beacons are sent to B0_DISCOVERY_ADDRESS (default: 255.255.255.255) on port
+ * B0_DISCOVERY_PORT (default: 22001), every B0_DISCOVERY_INTERVAL milliseconds (default:
+ * 1000), and immediately after a change or when a new process is heard.
+ *
+ * It is used by b0::resolver::Client when b0::getDecentralized() is true.
+ */
+class Discovery
+{
+private:
+    Discovery();
+
+public:
+    /*!
+     * \brief Send the last beacon, and stop
+     */
+    ~Discovery();
+
+    /*!
+     * \brief Return the instance of this process, starting it on first use
+     */
+    static Discovery & getInstance();
+
+    /*!
+     * \brief Add a node of this process
+     */
+    void addNode(const std::string &host_id, int process_id, const std::string &node_name);
+
+    /*!
+     * \brief Remove a node of this process, with its services, topics and links
+     */
+    void removeNode(const std::string &node_name);
+
+    /*!
+     * \brief Record a service offered by a node of this process
+     */
+    void announceService(const std::string &node_name, const std::string &service_name, const std::string &addr);
+
+    /*!
+     * \brief Record a peer-to-peer publisher of a node of this process
+     */
+    void announceTopic(const std::string &node_name, const std::string &topic_name, const std::string &addr);
+
+    /*!
+     * \brief Record a topic publishing/subscription start or end (for the graph)
+     */
+    void notifyTopic(const std::string &node_name, const std::string &topic_name, bool reverse, bool active);
+
+    /*!
+     * \brief Record a service advertising/use start or end (for the graph)
+     */
+    void notifyService(const std::string &node_name, const std::string &service_name, bool reverse, bool active);
+
+    /*!
+     * \brief Find the addresses of the servers of a service, the ones of this process first
+     *
+     * Shortly after start, waits for the beacons of the other processes if the service
+     * is not known yet. Return false if the service is not found.
+     */
+    bool resolveService(const std::string &service_name, std::vector<std::string> &addrs);
+
+    /*!
+     * \brief Find the addresses of the peer-to-peer publishers of a topic
+     *
+     * An empty list is not an error (there may be no publisher yet).
+     */
+    void resolveTopic(const std::string &topic_name, std::vector<std::string> &addrs);
+
+    /*!
+     * \brief Build the graph of the nodes of all the processes heard
+     */
+    void getGraph(b0::message::graph::Graph &graph);
+
+private:
+    struct Private;
+    std::unique_ptr<Private> private_;
+};
+
+} // namespace resolver
+
+} // namespace b0
+
+#endif // B0__RESOLVER__DISCOVERY_H__INCLUDED
@@ -5,14 +5,23 @@
 #include <b0/node.h>
 #include <b0/service_server.h>
 #include <b0/publisher.h>
+#include <b0/subscriber.h>
 #include <b0/message/resolv/request.h>
 #include <b0/message/resolv/response.h>
+#include <b0/message/resolv/resolver_snapshot.h>
+#include <b0/message/resolv/param_update.h>
 #include <b0/message/graph/graph.h>
+#include <b0/message/graph/graph_delta.h>
 
+#include <atomic>
+#include <map>
 #include <string>
 #include <vector>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <boost/thread.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <boost/format.hpp>
 
 namespace b0
@@ -33,6 +42,42 @@ struct NodeEntry
     std::string name;
     boost::posix_time::ptime last_heartbeat;
     std::vector<ServiceEntry*> services;
+    std::unordered_set<std::string> topics;
+    std::string base_name;
+    int name_suffix{0};
+    std::multimap<boost::posix_time::ptime, NodeEntry*>::iterator expiry;
+    bool has_expiry{false};
+    //! The last resource usage reported in a heartbeat (see b0::setHeartbeatStats())
+    boost::optional<b0::message::graph::NodeStats> stats;
+};
+
+//! The graph edges of one node
+struct NodeLinks
+{
+    std::unordered_set<std::string> publishes_topic;
+    std::unordered_set<std::string> subscribes_topic;
+    std::unordered_set<std::string> offers_service;
+    std::unordered_set<std::string> uses_service;
+
+    bool empty() const {return publishes_topic.empty() && subscribes_topic.empty() && offers_service.empty() && uses_service.empty();}
+};
+
+//! The numeric suffixes given to the nodes with the same requested name
+struct NodeNameSuffixes
+{
+    //! The next suffix never given
+    int next{1};
+
+    //! Suffixes given before and released by nodes which have left
+    std::set<int> free;
+};
+
+//! The directory a child resolver sent in its last SyncDirectoryRequest
+struct FederationSite
+{
+    std::vector<b0::message::resolv::FederationEntry> services;
+    std::vector<b0::message::resolv::FederationEntry> topics;
+    int64_t last_sync_usec{0};
 };
 
 struct ServiceEntry
@@ -79,6 +124,8 @@ protected:
  */
 class Resolver : public b0::Node
 {
+    friend class ResolverServiceServer;
+
 public:
     /*!
      * \brief Construct a resolver node
@@ -100,6 +147,16 @@ public:
      */
     void cleanup() override;
 
+    using Node::log;
+
+    /*!
+     * \brief Log a message
+     *
+     * From a thread other than the node's (e.g. the workers of setServiceThreads()), the
+     * message is queued, and written by spinOnce().
+     */
+    void log(logger::Level level, const std::string &message) const override;
+
     /*!
      * \brief Retrieve address of the proxy's XPUB socket
      */
@@ -110,11 +167,270 @@ public:
      */
     virtual std::string getXSUBSocketAddress() const override;
 
+    /*!
+     * \brief Retrieve address of the XPUB socket of the proxy serving the given topic
+     */
+    virtual std::string getXPUBSocketAddress(const std::string &topic_name) const override;
+
+    /*!
+     * \brief Retrieve address of the XSUB socket of the proxy serving the given topic
+     */
+    virtual std::string getXSUBSocketAddress(const std::string &topic_name) const override;
+
+    /*!
+     * \brief Retrieve address of the XPUB socket of the high-priority proxy serving the given topic
+     */
+    virtual std::string getPriorityXPUBSocketAddress(const std::string &topic_name) const override;
+
+    /*!
+     * \brief Retrieve address of the XSUB socket of the high-priority proxy serving the given topic
+     */
+    virtual std::string getPriorityXSUBSocketAddress(const std::string &topic_name) const override;
+
+    /*!
+     * \brief Set the number of XSUB/XPUB proxies to run (otherwise B0_RESOLVER_PROXIES will be used)
+     *
+     * Each proxy runs in its own thread. Topics are assigned to proxies by the hash of their
+     * name, unless explicitly assigned with setTopicProxy(), so that high-rate topics do not
+     * delay the others. Call before initialization.
+     */
+    void setNumProxies(int num_proxies);
+
+    /*!
+     * \brief Set the number of proxies reserved to the high-priority topics (otherwise B0_RESOLVER_PRIORITY_PROXIES will be used)
+     *
+     * The topics of the sockets set to high priority (see b0::Socket::setHighPriority()) go
+     * through these proxies, in their own threads and on their own connections, so that a
+     * large message in flight on another topic does not delay them. The default is 1; with 0
+     * the high-priority topics share the proxies of the others. Call before initialization.
+     */
+    void setNumPriorityProxies(int num_proxies);
+
+    /*!
+     * \brief Return the number of proxies reserved to the high-priority topics
+     */
+    int getNumPriorityProxies() const;
+
+    /*!
+     * \brief Set the number of threads serving the resolv service (otherwise B0_RESOLVER_THREADS will be used)
+     *
+     * The lookups (ResolveService, ResolveTopic, GetGraph, GetCompressionDictionary) are
+     * served concurrently, while the requests changing the state of the resolver (announces,
+     * heartbeats, graph notifications) are applied one at a time. With 0 threads (the
+     * default), all the requests are served in turn by spinOnce(). Call before initialization.
+     *
+     * With worker threads, the handle*() and on*() methods overridden by a subclass are
+     * called from the worker threads too, and must be thread-safe. Their log messages, and the
+     * publications of the graph and of the parameters, are left to the node's thread (see
+     * flushDeferred()).
+     */
+    void setServiceThreads(int num_threads);
+
+    /*!
+     * \brief Return the number of threads serving the resolv service
+     */
+    int getServiceThreads() const;
+
+    /*!
+     * \brief Run as the standby of the resolver at the given address (otherwise B0_RESOLVER_PRIMARY will be used)
+     *
+     * The standby copies the nodes, services, topics and graph of the primary, polling it
+     * three times per heartbeat interval. It takes over (becomes active) when the primary
+     * does not respond for a heartbeat interval, or as soon as a node sends it a request
+     * other than a lookup, since the node has then found the primary unresponsive (see
+     * b0::resolver::Client::setResolverAddress()). Call before initialization.
+     */
+    void setPrimary(const std::string &addr);
+
+    /*!
+     * \brief Return the address of the primary resolver, if this is a standby
+     */
+    std::string getPrimary() const;
+
+    /*!
+     * \brief Return true if this resolver is a standby which has not taken over
+     */
+    bool isStandby() const;
+
+    /*!
+     * \brief Join a federation of resolvers, as a child of the resolver at the given address (otherwise B0_RESOLVER_PARENT will be used)
+     *
+     * Each resolver of a federation serves the nodes of its site: their announces,
+     * heartbeats and topics stay local. Once per federation interval (see
+     * setFederationInterval()), a child sends the services and topics of its site (and of
+     * its own children) to its parent, and gets back the ones of the other sites. A parent
+     * can be the child of another resolver, making a tree of sites.
+     *
+     * A service not offered at the site of a node is then resolved to the servers of
+     * another site, which the node connects to directly. A topic subscribed to at a site
+     * and not published there, but published at another site, is bridged on demand: the
+     * resolver forwards its messages from the proxy of the other site to its own proxy.
+     * The addresses of the services and proxies must be reachable from the other sites.
+     * Call before initialization.
+     */
+    void setParent(const std::string &addr);
+
+    /*!
+     * \brief Return the address of the parent resolver, if this resolver is the child of a federation
+     */
+    std::string getParent() const;
+
+    /*!
+     * \brief Set the interval of the synchronizations with the parent resolver in microseconds (the default is B0_RESOLVER_FEDERATION_INTERVAL milliseconds, or 1 second)
+     *
+     * The sites not heard from for three intervals are forgotten. Call before initialization.
+     */
+    void setFederationInterval(int64_t interval);
+
+    /*!
+     * \brief Return the interval of the synchronizations with the parent resolver in microseconds
+     */
+    int64_t getFederationInterval() const;
+
+    /*!
+     * \brief Return the topics bridged from other sites of the federation (see setParent())
+     */
+    std::vector<std::string> getBridgedTopics() const;
+
+    /*!
+     * \brief Save the state of the resolver to a file, to restart without losing it (otherwise B0_RESOLVER_STATE_FILE will be used)
+     *
+     * The nodes, services, topics, graph and parameters, and the ports of the proxies, are
+     * written to the file (replacing it atomically) at most once per second when they change.
+     * On startup, the resolver loads the file, if it exists, and binds the same ports: the
+     * running nodes keep their connections, and do not have to announce themselves again.
+     * The nodes loaded are given a heartbeat interval to send a heartbeat, and are removed
+     * otherwise. Call before initialization.
+     */
+    void setStateFile(const std::string &path);
+
+    /*!
+     * \brief Return the file where the state of the resolver is saved (empty if none)
+     */
+    std::string getStateFile() const;
+
+    /*!
+     * \brief Return the number of XSUB/XPUB proxies
+     */
+    int getNumProxies() const;
+
+    /*!
+     * \brief Explicitly assign a topic to a proxy (call before initialization)
+     */
+    void setTopicProxy(const std::string &topic_name, int proxy);
+
+    /*!
+     * \brief A connection of a subscriber to a proxy (see getProxyConsumers())
+     */
+    struct ProxyConsumer
+    {
+        //! Index of the proxy
+        int proxy;
+
+        //! Address of the subscriber (host:port, empty if unknown)
+        std::string address;
+
+        //! Bytes written to the connection and not acknowledged by the subscriber yet, at the last check
+        long backlog_bytes;
+
+        //! True if the backlog stayed over the threshold for two checks (see setSlowConsumerThreshold())
+        bool slow;
+    };
+
+    /*!
+     * \brief Return the connections of the subscribers to the proxies, checked every second
+     *
+     * Each subscriber has its own queue in the proxy, bounded by B0_RESOLVER_PROXY_HWM
+     * messages (1000 by default), beyond which only its messages are dropped: a subscriber
+     * on a bad link does not delay the others. The backlog of its connection (only measured
+     * on Linux, 0 elsewhere) tells how far behind it is. This method is thread-safe.
+     */
+    std::vector<ProxyConsumer> getProxyConsumers() const;
+
+    /*!
+     * \brief Set the backlog in bytes over which a subscriber is reported as slow (call before initialization)
+     *
+     * The subscribers becoming slow, and recovering, are logged as warnings. The default is
+     * 64 KiB, unless the B0_RESOLVER_SLOW_CONSUMER_BYTES environment variable is set.
+     */
+    void setSlowConsumerThreshold(long bytes);
+
+    /*!
+     * \brief Set the minimum interval between two publications of the changes of the graph, in microseconds
+     *
+     * The changes made within the interval (e.g. by many nodes starting together) are
+     * published together at its end, as one delta and one snapshot: the monitors do not
+     * handle them one by one. Meanwhile, the graph served (see handleGetGraph()) is the one
+     * last published. The default is 0 (each change is published at once), unless the
+     * B0_RESOLVER_GRAPH_INTERVAL environment variable is set (in milliseconds).
+     */
+    void setGraphChangeInterval(int64_t interval);
+
+    /*!
+     * \brief Return the minimum interval between two publications of the changes of the graph
+     */
+    int64_t getGraphChangeInterval() const;
+
+    /*!
+     * \brief Add a compression dictionary to be distributed to the nodes (call before initialization)
+     *
+     * Nodes fetch the dictionary the first time they compress or decompress a payload
+     * with it (see b0::Socket::setCompression()).
+     * The dictionary is also registered for this process (see b0::compress::addDictionary()).
+     */
+    void addCompressionDictionary(const std::string &id, const std::string &data);
+
+    /*!
+     * \brief Set a parameter, served to the nodes (see b0::Node::addParameterPrefix())
+     *
+     * The change is published on the "param" topic, as when a node sets it
+     * (see b0::Node::setParameter()). This method is thread-safe.
+     */
+    void setParameter(const std::string &name, const std::string &value);
+
+    /*!
+     * \brief Remove a parameter (see setParameter())
+     */
+    void removeParameter(const std::string &name);
+
     /*!
      * \brief Hijack announceNode step
      */
     virtual void announceNode() override;
 
+    /*!
+     * \brief Announce a service of the resolver node, e.g. its metrics service (handled directly)
+     */
+    virtual void announceService(const std::string &service_name, const std::string &addr, const std::string &ipc_addr = "") override;
+
+    /*!
+     * \brief Announce a peer-to-peer publisher of the resolver node (handled directly)
+     */
+    virtual void announceTopic(const std::string &topic_name, const std::string &addr, const std::string &ipc_addr = "") override;
+
+    /*!
+     * \brief Resolve the peer-to-peer publishers of a topic (handled directly)
+     */
+    virtual void resolveTopic(const std::string &topic_name, std::vector<std::string> &addrs) override;
+
+    /*!
+     * \brief Fetch a compression dictionary (handled directly)
+     */
+    virtual bool getCompressionDictionary(const std::string &id, std::string &data) override;
+
+    /*!
+     * \brief Look up the content type of an id (handled directly)
+     *
+     * The sockets of the resolver itself send the content types by name: assigning an id
+     * is a change of the state, which may be in progress while they publish.
+     */
+    virtual bool getContentTypeId(std::string &content_type, int64_t &id) override;
+
+    /*!
+     * \brief Fill the metrics of the resolver node, and the time since the last heartbeat of each node
+     */
+    virtual void getMetrics(b0::message::metrics::NodeMetrics &metrics, const std::string &pattern = "*") override;
+
     /*!
      * \brief Hijack notifyShutdown step
      */
@@ -187,8 +503,20 @@ public:
 
     /*!
      * \brief The XSUB/XPUB proxy (will be started in a separate thread)
+     *
+     * The sockets are also bound to the IPC endpoints, if given. The connections of the
+     * subscribers are monitored, for getProxyConsumers().
+     */
+    void pubProxy(int index, int xsub_proxy_port, int xpub_proxy_port, std::string xsub_ipc_addr, std::string xpub_ipc_addr);
+
+    /*!
+     * \brief Measure the backlog of the connections of the subscribers of a proxy, and publish them for getProxyConsumers()
+     *
+     * Called every second by the thread of the proxy, with its connections by file descriptor,
+     * and the number of consecutive checks they were over the slow consumer threshold.
+     * The changes are logged to the logger of the thread.
      */
-    void pubProxy(int xsub_proxy_port, int xpub_proxy_port);
+    void checkProxyConsumers(int index, std::map<int, std::pair<ProxyConsumer, int> > &consumers, b0::logger::LogInterface &logger);
 
     /*!
      * \brief Checks wether a node with this name exists in the connected nodes list
@@ -216,7 +544,7 @@ public:
     virtual resolver::NodeEntry * nodeByName(std::string node_name);
 
     /*!
-     * \brief Get the ServiceEntry given the service name
+     * \brief Get the ServiceEntry given the service name (the first one, if there are several servers)
      */
     virtual resolver::ServiceEntry * serviceByName(std::string service_name);
 
@@ -225,15 +553,37 @@ public:
      */
     virtual void heartbeat(resolver::NodeEntry *node_entry);
 
+    /*!
+     * \brief Find the nodes which have not sent a heartbeat within the minimum interval
+     *
+     * Only the expired nodes are visited, as the nodes are kept ordered by last heartbeat.
+     */
+    std::set<std::string> expiredNodes();
+
     /*!
      * \brief Handle a service on the resolv service
      */
     virtual void handle(const b0::message::resolv::Request &rq, b0::message::resolv::Response &rsp);
 
+    /*!
+     * \brief Return true if the request only reads the state of the resolver
+     */
+    static bool isLookup(const b0::message::resolv::Request &rq);
+
     /*!
      * \brief Adjust nodeName such that it is unique in the network (amongst the list of connected nodes)
+     *
+     * If the name is taken, a numeric suffix is appended: the lowest one released by a node
+     * which has left, or the next one never given, so the cost does not grow with the number
+     * of nodes with the same name. The suffix (0 if none) is stored in suffix, if not null,
+     * and should be given back with releaseNodeName() when the node leaves.
      */
-    std::string makeUniqueNodeName(std::string nodeName);
+    std::string makeUniqueNodeName(std::string nodeName, int *suffix = nullptr);
+
+    /*!
+     * \brief Make a suffix given by makeUniqueNodeName() available again
+     */
+    void releaseNodeName(const std::string &baseName, int suffix);
 
     /*!
      * \brief Handle the AnnounceNode request
@@ -255,11 +605,46 @@ public:
      */
     virtual void handleResolveService(const b0::message::resolv::ResolveServiceRequest &rq, b0::message::resolv::ResolveServiceResponse &rsp);
 
+    /*!
+     * \brief Handle the AnnounceTopic request
+     */
+    virtual void handleAnnounceTopic(const b0::message::resolv::AnnounceTopicRequest &rq, b0::message::resolv::AnnounceTopicResponse &rsp);
+
+    /*!
+     * \brief Handle the ResolveTopic request
+     */
+    virtual void handleResolveTopic(const b0::message::resolv::ResolveTopicRequest &rq, b0::message::resolv::ResolveTopicResponse &rsp);
+
+    /*!
+     * \brief Handle the GetCompressionDictionary request
+     */
+    virtual void handleGetCompressionDictionary(const b0::message::resolv::GetCompressionDictionaryRequest &rq, b0::message::resolv::GetCompressionDictionaryResponse &rsp);
+
+    /*!
+     * \brief Handle the ContentTypeId request
+     */
+    virtual void handleContentTypeId(const b0::message::resolv::ContentTypeIdRequest &rq, b0::message::resolv::ContentTypeIdResponse &rsp);
+
+    /*!
+     * \brief Handle the GetParams request
+     */
+    virtual void handleGetParams(const b0::message::resolv::GetParamsRequest &rq, b0::message::resolv::GetParamsResponse &rsp);
+
+    /*!
+     * \brief Handle the SetParam request, publishing the change on the "param" topic
+     */
+    virtual void handleSetParam(const b0::message::resolv::SetParamRequest &rq, b0::message::resolv::SetParamResponse &rsp);
+
     /*!
      * \brief Handle the Heartbeat request
      */
     virtual void handleHeartbeat(const b0::message::resolv::HeartbeatRequest &rq, b0::message::resolv::HeartbeatResponse &rsp);
 
+    /*!
+     * \brief Handle a heartbeat received on the heartbeat topic (not replied to)
+     */
+    virtual void onHeartbeatMessage(const b0::message::resolv::HeartbeatRequest &rq);
+
     /*!
      * \brief Handle the NodeTopic request
      */
@@ -270,8 +655,86 @@ public:
      */
     void handleNodeService(const b0::message::graph::NodeServiceRequest &req, b0::message::graph::NodeServiceResponse &resp);
 
+    /*!
+     * \brief Handle the AnnounceSockets request
+     *
+     * Handle each announcement and notification as the corresponding request, publishing
+     * the graph once at the end.
+     */
+    virtual void handleAnnounceSockets(const b0::message::resolv::AnnounceSocketsRequest &rq, b0::message::resolv::AnnounceSocketsResponse &rsp);
+
+    /*!
+     * \brief Handle a SyncState request (from a standby), see b0::message::resolv::SyncStateRequest
+     */
+    virtual void handleSyncState(const b0::message::resolv::SyncStateRequest &rq, b0::message::resolv::SyncStateResponse &rsp);
+
+    /*!
+     * \brief Handle a SyncDirectory request (from a child resolver), see b0::message::resolv::SyncDirectoryRequest
+     */
+    virtual void handleSyncDirectory(const b0::message::resolv::SyncDirectoryRequest &rq, b0::message::resolv::SyncDirectoryResponse &rsp);
+
+    /*!
+     * \brief Fill the services and topics of the site of this resolver (state_mutex_ must be locked)
+     */
+    void localDirectory(std::vector<b0::message::resolv::FederationEntry> &services, std::vector<b0::message::resolv::FederationEntry> &topics) const;
+
+    /*!
+     * \brief Find a service or topic among the ones of the other sites (state_mutex_ must be locked)
+     */
+    const b0::message::resolv::FederationEntry * remoteEntry(const std::string &name, bool topic) const;
+
+    /*!
+     * \brief Start the federation and bridge threads, if not started yet
+     */
+    void startFederation();
+
+    /*!
+     * \brief Code to run in the federation thread (synchronize with the parent, and choose the topics to bridge)
+     */
+    void federationLoop();
+
+    /*!
+     * \brief Code to run in the bridge thread (forward the bridged topics from the other sites)
+     */
+    void bridgeLoop();
+
+    /*!
+     * \brief Replace the state of this resolver with the state of the primary
+     */
+    void applyState(const b0::message::resolv::SyncStateResponse &state);
+
+    /*!
+     * \brief Read the state file, returning false if there is none or it is not valid
+     */
+    bool loadState(b0::message::resolv::ResolverSnapshot &snapshot);
+
+    /*!
+     * \brief Apply the state read from the state file, except the entries of this node
+     */
+    void restoreState(const b0::message::resolv::ResolverSnapshot &snapshot);
+
+    /*!
+     * \brief Write the state to the state file, if it changed since the last time (called by spinOnce())
+     */
+    void saveState();
+
+    /*!
+     * \brief Stop being a standby, and serve the nodes
+     */
+    void promote();
+
+    /*!
+     * \brief Code to run in the standby thread (copy the state of the primary, and watch it)
+     */
+    void standbyLoop();
+
     /*!
      * \brief Handle the GetGraph request
+     *
+     * The graph is built once per change (see onGraphChanged()) and copied from the cache for
+     * each request, so that the monitors polling it cost little. A request with the version
+     * the node already has gets only not_modified. A request with filters is answered from the
+     * indices instead (see getGraph(const b0::message::graph::GetGraphRequest&, b0::message::graph::Graph&)).
      */
     void handleGetGraph(const b0::message::graph::GetGraphRequest &req, b0::message::graph::GetGraphResponse &resp);
 
@@ -280,14 +743,83 @@ public:
      */
     void getGraph(b0::message::graph::Graph &graph);
 
+    /*!
+     * \brief Retrieve the part of the graph selected by the filters of the request
+     *
+     * A pattern without `*` is looked up in node_links_ (for a node) or in links_by_other_
+     * (for a topic or a service), so that the work is proportional to the answer.
+     */
+    void getGraph(const b0::message::graph::GetGraphRequest &req, b0::message::graph::Graph &graph);
+
+    /*!
+     * \brief Discard the cached graph (see handleGetGraph()); state_mutex_ must be locked exclusively
+     */
+    void invalidateGraphCache();
+
     /*!
      * \brief Called when the global graph changes
      *
      * Due to a node publishing or subscribing a topic, or offering or using a service.
      *
+     * Publishes the changes since the previous call on the "graph_delta" topic, and the
+     * full graph on the "graph" topic (unless disabled with setGraphSnapshots()), or, if
+     * the previous publication is more recent than the interval set with
+     * setGraphChangeInterval(), leaves them to flushGraphChanges().
      */
     void onGraphChanged();
 
+    /*!
+     * \brief Publish the changes of the graph now (state_mutex_ must be locked exclusively)
+     */
+    void publishGraphChanges();
+
+    /*!
+     * \brief Publish the changes left by onGraphChanged(), once the interval has elapsed (called by spinOnce())
+     */
+    void flushGraphChanges();
+
+    /*!
+     * \brief Write the log messages and publish the parameter changes left by the other threads (called by spinOnce())
+     *
+     * The sockets of the node are only used by its thread; the changes of the graph made by
+     * the other threads are likewise left to flushGraphChanges().
+     */
+    void flushDeferred();
+
+    /*!
+     * \brief Make a link of the graph
+     */
+    static b0::message::graph::GraphLink graphLink(const std::string &node_name, const std::string &other_name, bool reversed);
+
+    /*!
+     * \brief Add an edge to the graph, return false if it exists already
+     */
+    bool addLink(const std::string &node_name, std::unordered_set<std::string> resolver::NodeLinks::*links, const std::string &other_name);
+
+    /*!
+     * \brief Remove an edge from the graph, return false if it does not exist
+     */
+    bool removeLink(const std::string &node_name, std::unordered_set<std::string> resolver::NodeLinks::*links, const std::string &other_name);
+
+public:
+    /*!
+     * \brief Enable or disable publishing the full graph on the "graph" topic at each change
+     *
+     * The changes are always published as b0::message::graph::GraphDelta on the
+     * "graph_delta" topic, which is all that is needed by clients using a
+     * b0::graph::GraphTracker. The full graph, which grows with the network, is only
+     * needed by older clients. Can be changed also with the B0_RESOLVER_GRAPH_SNAPSHOTS
+     * environment variable (default: enabled).
+     */
+    void setGraphSnapshots(bool enabled);
+
+    /*!
+     * \brief Return true if the full graph is published at each change
+     */
+    bool getGraphSnapshots() const;
+
+protected:
+
     /*!
      * \brief Code to run in the heartbeat sweeper thread
      */
@@ -306,47 +838,230 @@ protected:
     //! The ServiceServer serving the requests for the resolv protocol
     ResolverServiceServer resolv_server_;
 
-    //! Public address of the XSUB socket of the ZeroMQ proxy
+    //! Public address of the XSUB socket of the (first) ZeroMQ proxy
     std::string xsub_proxy_addr_;
 
-    //! Public address of the XPUB socket of the ZeroMQ proxy
+    //! Public address of the XPUB socket of the (first) ZeroMQ proxy
     std::string xpub_proxy_addr_;
 
-    //! The thread running the ZeroMQ XSUB/XPUB proxy
-    boost::thread pub_proxy_thread_;
+    //! Public addresses of the XSUB sockets of all the ZeroMQ proxies
+    std::vector<std::string> xsub_proxy_addrs_;
+
+    //! Public addresses of the XPUB sockets of all the ZeroMQ proxies
+    std::vector<std::string> xpub_proxy_addrs_;
+
+    //! IPC endpoints of the XSUB sockets of all the ZeroMQ proxies (empty if IPC is disabled)
+    std::vector<std::string> xsub_proxy_ipc_addrs_;
+
+    //! IPC endpoints of the XPUB sockets of all the ZeroMQ proxies (empty if IPC is disabled)
+    std::vector<std::string> xpub_proxy_ipc_addrs_;
+
+    //! The threads running the ZeroMQ XSUB/XPUB proxies
+    std::vector<boost::thread> pub_proxy_threads_;
+
+    //! Number of ZeroMQ XSUB/XPUB proxies
+    int num_proxies_;
+
+    //! Number of ZeroMQ XSUB/XPUB proxies reserved to the high-priority topics
+    int num_priority_proxies_;
+
+    //! Public addresses of the XSUB sockets of the high-priority proxies
+    std::vector<std::string> xsub_priority_addrs_;
+
+    //! Public addresses of the XPUB sockets of the high-priority proxies
+    std::vector<std::string> xpub_priority_addrs_;
+
+    //! IPC endpoints of the XSUB sockets of the high-priority proxies (empty if IPC is disabled)
+    std::vector<std::string> xsub_priority_ipc_addrs_;
+
+    //! IPC endpoints of the XPUB sockets of the high-priority proxies (empty if IPC is disabled)
+    std::vector<std::string> xpub_priority_ipc_addrs_;
+
+    //! Backlog over which a subscriber of a proxy is slow
+    //! \sa Resolver::setSlowConsumerThreshold()
+    long slow_consumer_bytes_;
+
+    //! Protects proxy_consumers_
+    mutable boost::mutex proxy_consumers_mutex_;
+
+    //! The connections of the subscribers, by proxy, updated by the proxy threads
+    std::vector<std::vector<ProxyConsumer> > proxy_consumers_;
+
+    //! Protects the state of the resolver: shared by the lookups, exclusive for the changes
+    mutable boost::shared_mutex state_mutex_;
+
+    //! Explicit assignments of topics to proxies
+    std::map<std::string, int> topic_proxy_;
+
+    //! Compression dictionaries distributed to the nodes, by id
+    std::map<std::string, std::string> compression_dictionaries_;
+
+    //! Protects content_type_ids_ and content_types_, also read by getContentTypeId() without state_mutex_
+    mutable boost::mutex content_types_mutex_;
+
+    //! The ids assigned to the content types (see handleContentTypeId())
+    std::map<std::string, int64_t> content_type_ids_;
+
+    //! The content types with an id, the index being the id
+    std::vector<std::string> content_types_;
+
+    //! The parameters served to the nodes, by name
+    std::map<std::string, std::string> params_;
+
+    //! Version of the parameters, incremented by each change
+    int64_t params_version_{0};
+
+    //! Set or remove a parameter, and publish the change (state_mutex_ must be locked)
+    void changeParameter(const std::string &name, const std::string &value, bool remove);
 
     //! The heartbeat sweeper thread
     boost::thread heartbeat_sweeper_thread_;
 
+    //! Address of the primary resolver, if this is a standby
+    std::string primary_addr_;
+
+    //! True while this is a standby which has not taken over
+    std::atomic<bool> standby_{false};
+
+    //! Thread copying the state of the primary
+    boost::thread standby_thread_;
+
+    //! Address of the parent resolver, if this is the child of a federation
+    std::string parent_addr_;
+
+    //! Interval of the synchronizations with the parent resolver
+    int64_t federation_interval_;
+
+    //! The address of this resolver, identifying its site in the federation
+    std::string site_;
+
+    //! The directories of the child resolvers, by site
+    std::map<std::string, resolver::FederationSite> child_sites_;
+
+    //! The directory of the other sites, as of the last synchronization with the parent
+    resolver::FederationSite parent_site_;
+
+    //! True once the federation and bridge threads are started
+    std::atomic<bool> federation_started_{false};
+
+    //! Thread synchronizing with the parent resolver
+    boost::thread federation_thread_;
+
+    //! Thread forwarding the bridged topics
+    boost::thread bridge_thread_;
+
+    //! Protects bridges_
+    mutable boost::mutex bridges_mutex_;
+
+    //! The topics to bridge, with the address of the XPUB proxy of the site publishing them
+    std::map<std::string, std::string> bridges_;
+
+    //! Version of the state (nodes, services, topics, graph), changed by every request other than a lookup or a heartbeat
+    int64_t state_version_{0};
+
+    //! File where the state is saved
+    //! \sa Resolver::setStateFile()
+    std::string state_file_;
+
+    //! Version of the state last written to state_file_
+    int64_t saved_state_version_{-1};
+
+    //! Time of the last write to state_file_
+    int64_t last_state_save_usec_{0};
+
     //! Map of nodes by name
     std::map<std::string, resolver::NodeEntry*> nodes_by_name_;
 
     //! Map of nodes by key
     std::map<std::string, resolver::NodeEntry*> nodes_by_key_;
 
-    //! Map of services by name
-    std::map<std::string, resolver::ServiceEntry*> services_by_name_;
+    //! The suffixes given to the node names, by requested name
+    std::map<std::string, resolver::NodeNameSuffixes> node_name_suffixes_;
+
+    //! The nodes ordered by time of last heartbeat, oldest first
+    std::multimap<boost::posix_time::ptime, resolver::NodeEntry*> heartbeat_expiry_;
+
+    //! Map of services by name (the servers of each service, in the order they were announced)
+    std::map<std::string, std::vector<resolver::ServiceEntry*> > services_by_name_;
 
-    //! Graph edges node --> topic
-    std::set<std::pair<std::string, std::string> > node_publishes_topic_;
+    //! Addresses of the peer-to-peer publishers, by topic name (as node name, address pairs)
+    std::map<std::string, std::set<std::pair<std::string, std::string> > > topic_publishers_;
 
-    //! Graph edges node <-- topic
-    std::set<std::pair<std::string, std::string> > node_subscribes_topic_;
+    //! IPC endpoints announced along with the addresses of services and peer-to-peer publishers, by address
+    std::map<std::string, std::string> ipc_addrs_;
 
-    //! Graph edges node --> service
-    std::set<std::pair<std::string, std::string> > node_offers_service_;
+    //! Record (or forget, if empty) the IPC endpoint announced with an address
+    void setIPCAddress(const std::string &addr, const std::string &ipc_addr);
 
-    //! Graph edges node <-- service
-    std::set<std::pair<std::string, std::string> > node_uses_service_;
+    //! Return the IPC endpoint announced with an address, or an empty string
+    std::string getIPCAddress(const std::string &addr) const;
+
+    //! Graph edges (node --> topic, node <-- topic, node --> service, node <-- service), by node name
+    std::unordered_map<std::string, resolver::NodeLinks> node_links_;
+
+    //! The same edges by topic or service name (e.g. links_by_other_[t].publishes_topic are the publishers of t)
+    std::unordered_map<std::string, resolver::NodeLinks> links_by_other_;
 
     //! Publisher of the Graph message
     b0::Publisher graph_pub_;
 
+    //! Publisher of the GraphDelta message
+    b0::Publisher graph_delta_pub_;
+
+    //! Publisher of the ParamUpdate message
+    b0::Publisher param_pub_;
+
+    //! Subscriber of the heartbeats which need no reply (see AnnounceNodeResponse::heartbeat_topic)
+    b0::Subscriber heartbeat_sub_;
+
+    //! The changes to the graph not yet published
+    b0::message::graph::GraphDelta graph_delta_;
+
+    //! Version of the graph, incremented at each change
+    int64_t graph_version_{0};
+
+    //! If true, the full graph is also published at each change
+    bool graph_snapshots_;
+
+    //! Protects graph_cache_ and graph_cache_valid_, filled by the lookups (which share state_mutex_)
+    boost::mutex graph_cache_mutex_;
+
+    //! The graph served by handleGetGraph(), if graph_cache_valid_
+    b0::message::graph::Graph graph_cache_;
+
+    //! False if graph_cache_ must be built again
+    bool graph_cache_valid_{false};
+
     //! The minimum interval in which the node has to send a heartbeat message.
     //! If the node fails to send a heartmeat message at least once in every interval,
     //! it will be considered as dead.
     //! A value of zero will disable online monitoring.
     int64_t minimum_heartbeat_interval_resolver_;
+
+    //! While true, onGraphChanged() only records that the graph has changed
+    bool defer_graph_changes_{false};
+
+    //! True if the graph has changed while defer_graph_changes_ was true
+    bool graph_changed_{false};
+
+    //! Minimum interval between two publications of the changes of the graph
+    //! \sa Resolver::setGraphChangeInterval()
+    int64_t graph_change_interval_{0};
+
+    //! Time of the last publication of the changes of the graph (read by flushGraphChanges() without the lock)
+    std::atomic<int64_t> last_graph_publish_usec_{0};
+
+    //! True if changes of the graph wait for flushGraphChanges()
+    std::atomic<bool> graph_publish_pending_{false};
+
+    //! Protects deferred_log_ and deferred_param_updates_
+    mutable boost::mutex deferred_mutex_;
+
+    //! Log messages of the other threads, written by flushDeferred()
+    mutable std::vector<std::pair<logger::Level, std::string> > deferred_log_;
+
+    //! Changes of the parameters made by the other threads, published by flushDeferred()
+    std::vector<b0::message::resolv::ParamUpdate> deferred_param_updates_;
 };
 
 } // namespace resolver
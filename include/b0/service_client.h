@@ -1,22 +1,60 @@
 #ifndef B0__SERVICE_CLIENT_H__INCLUDED
 #define B0__SERVICE_CLIENT_H__INCLUDED
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
 #include <string>
 
+#include <boost/thread/recursive_mutex.hpp>
+
 #include <b0/b0.h>
 #include <b0/socket.h>
 #include <b0/message/message_part.h>
+#include <b0/utils/metrics.h>
+#include <b0/utils/response_cache.h>
+#include <b0/utils/tracing.h>
 
 namespace b0
 {
 
 class Node;
 
+/*!
+ * \brief How a ServiceClient distributes its requests among the servers of a service
+ *
+ * \sa ServiceClient::setLoadBalancing()
+ */
+enum class LoadBalancing
+{
+    //! Send the requests to each server in turn
+    RoundRobin,
+    //! Send each request to the server with the fewest requests in flight
+    LeastOutstanding
+};
+
 /*!
  * \brief The service client class
  *
- * This class wraps a REQ socket. It will automatically resolve the address
- * of service name.
+ * This class wraps a DEALER socket, talking to the ROUTER socket of the server. It will
+ * automatically resolve the address of service name.
+ *
+ * Besides the blocking call(), requests can be sent with callAsync(), which returns
+ * immediately: several requests (also to the same service, over the same connection) can
+ * then be in flight at the same time. The replies are read by spinOnce() (i.e. by
+ * b0::Node::spinOnce()) or by waitReplies(), and matched to the requests by the
+ * Correlation-id header, so they can arrive in any order.
+ *
+ * If several servers have announced the service, the client connects to all of them,
+ * and distributes its requests among them (see setLoadBalancing()).
+ *
+ * A call rejected by an overloaded server (see ServiceServer::setAdmissionLimit()) throws
+ * exception::ServerBusy, or fails with it if asynchronous; the request was not served, so it
+ * can be sent again.
  *
  * \sa b0::ServiceClient, b0::ServiceServer
  */
@@ -25,6 +63,21 @@ class ServiceClient : public Socket
 public:
     using logger::LogInterface::log;
 
+    //! \brief Alias for function
+    template<typename T> using function = boost::function<T>;
+
+    //! \brief Alias for the callback of an asynchronous call, receiving the raw reply parts
+    using CallbackParts = function<void(const std::vector<b0::message::MessagePart>&)>;
+
+    //! \brief Alias for the callback of an asynchronous call, receiving the reply message
+    template<class TRep> using CallbackMsg = function<void(const TRep&)>;
+
+    //! \brief Alias for the callback of an asynchronous call which fails (bad reply, or deadline passed)
+    using CallbackError = function<void(std::exception_ptr)>;
+
+    //! \brief Alias for the callback of a streaming call, receiving the parts of each chunk
+    using CallbackStreamChunk = function<void(const std::vector<b0::message::MessagePart>&)>;
+
     /*!
      * \brief Construct an ServiceClient child of the specified Node
      */
@@ -56,45 +109,365 @@ public:
     std::string getServiceName();
 
     /*!
-     * \brief Write a request and read a reply from the underlying ZeroMQ REQ socket
+     * \brief Write a request and read a reply from the underlying ZeroMQ socket
      * \sa ServiceServer::read(), ServiceServer::write()
      */
     virtual void call(const std::string &req, std::string &rep);
 
     /*!
-     * \brief Write a request and read a reply from the underlying ZeroMQ REQ socket
+     * \brief Write a request and read a reply from the underlying ZeroMQ socket
      * \sa ServiceServer::read(), ServiceServer::write()
      */
     virtual void call(const std::string &req, const std::string &reqtype, std::string &rep, std::string &reptype);
 
     /*!
-     * \brief Write a request and read a reply from the underlying ZeroMQ REQ socket
+     * \brief Write a request and read a reply from the underlying ZeroMQ socket
      * \sa ServiceServer::read(), ServiceServer::write()
      */
     virtual void call(const std::vector<b0::message::MessagePart> &reqparts, std::vector<b0::message::MessagePart> &repparts);
 
     /*!
-     * \brief Write a request and read a reply from the underlying ZeroMQ REQ socket
+     * \brief Write a request and read a reply from the underlying ZeroMQ socket
      * \sa ServiceServer::read(), ServiceServer::write()
      */
     template<class TReq, class TRep>
     void call(const TReq &req, TRep &rep)
     {
+        if(response_cache_.enabled())
+        {
+            std::vector<b0::message::MessagePart> reqparts(1), repparts;
+            serialize(req, reqparts[0].payload, reqparts[0].content_type, getMessageCodec());
+            callCached(reqparts, repparts);
+            parse(rep, repparts.at(0).payload, repparts.at(0).content_type);
+            return;
+        }
+        if(ServiceClient *replica = pickReplica()) {replica->call(req, rep); return;}
+        boost::recursive_mutex::scoped_lock lock(mutex_);
         writeMsg(req);
-        readMsg(rep);
+        std::vector<b0::message::MessagePart> parts;
+        readReply(parts);
+        parse(rep, parts[0].payload, parts[0].content_type);
     }
 
     /*!
-     * \brief Write a request and read a reply from the underlying ZeroMQ REQ socket
+     * \brief Write a request and read a reply from the underlying ZeroMQ socket
      * \sa ServiceServer::read(), ServiceServer::write()
      */
     template<class TReq, class TRep>
     void call(const TReq &req, const std::vector<b0::message::MessagePart> &reqparts, TRep &rep, std::vector<b0::message::MessagePart> &repparts)
     {
+        if(response_cache_.enabled())
+        {
+            std::vector<b0::message::MessagePart> reqparts1(1);
+            serialize(req, reqparts1[0].payload, reqparts1[0].content_type, getMessageCodec());
+            reqparts1.insert(reqparts1.end(), reqparts.begin(), reqparts.end());
+            callCached(reqparts1, repparts);
+            parse(rep, repparts.at(0).payload, repparts.at(0).content_type);
+            repparts.erase(repparts.begin());
+            return;
+        }
+        if(ServiceClient *replica = pickReplica()) {replica->call(req, reqparts, rep, repparts); return;}
+        boost::recursive_mutex::scoped_lock lock(mutex_);
         writeMsg(req, reqparts);
-        readMsg(rep, repparts);
+        readReply(repparts);
+        parse(rep, repparts[0].payload, repparts[0].content_type);
+        repparts.erase(repparts.begin());
     }
 
+    /*!
+     * \brief Write several requests in a single envelope, and read their replies
+     *
+     * Each request is a part, and the server replies with a part for each of them, in the
+     * same order, so that many small calls cost a single round-trip.
+     * Throw an exception::Exception if the server does not serve batched requests.
+     * \sa ServiceServer::setBatchCallback()
+     */
+    virtual void callBatch(const std::vector<b0::message::MessagePart> &reqs, std::vector<b0::message::MessagePart> &reps);
+
+    /*!
+     * \brief Write several request messages in a single envelope, and read their replies
+     * \sa callBatch()
+     */
+    template<class TReq, class TRep>
+    void callBatch(const std::vector<TReq> &reqs, std::vector<TRep> &reps)
+    {
+        std::vector<b0::message::MessagePart> reqparts(reqs.size()), repparts;
+        for(size_t i = 0; i < reqs.size(); i++)
+        {
+            serialize(reqs[i], reqparts[i].payload, reqparts[i].content_type, getMessageCodec());
+            setPartCompression(reqparts[i]);
+        }
+        callBatch(reqparts, repparts);
+        reps.resize(repparts.size());
+        for(size_t i = 0; i < repparts.size(); i++)
+            parse(reps[i], repparts[i].payload, repparts[i].content_type);
+    }
+
+    /*!
+     * \brief Write a request, and return immediately
+     *
+     * The callback is called with the reply parts by spinOnce() or waitReplies().
+     */
+    virtual void callAsync(const std::vector<b0::message::MessagePart> &reqparts, CallbackParts callback);
+
+    /*!
+     * \brief Write a request, and return a future of the reply parts
+     *
+     * The future is made ready by spinOnce() or waitReplies(), so it must not be waited
+     * on from the thread which is supposed to call them.
+     */
+    virtual std::future<std::vector<b0::message::MessagePart> > callAsync(const std::vector<b0::message::MessagePart> &reqparts);
+
+    /*!
+     * \brief Write a request message, and return immediately
+     *
+     * The callback is called with the reply message by spinOnce() or waitReplies().
+     * If the reply cannot be parsed, an error is logged and the callback is not called.
+     */
+    template<class TRep, class TReq>
+    void callAsync(const TReq &req, CallbackMsg<TRep> callback)
+    {
+        if(ServiceClient *replica = pickReplica()) {replica->callAsync<TRep>(req, callback); return;}
+        boost::recursive_mutex::scoped_lock lock(mutex_);
+        writeMsg(req);
+        addPendingCall(PendingCall{last_correlation_id_, [this, callback](std::vector<b0::message::MessagePart> &parts) {
+            TRep rep;
+            try
+            {
+                parse(rep, parts.at(0).payload, parts.at(0).content_type);
+            }
+            catch(std::exception &ex)
+            {
+                error("Bad reply: %s", ex.what());
+                return;
+            }
+            callback(rep);
+        }});
+    }
+
+    /*!
+     * \brief Write a request message, and return immediately
+     *
+     * Exactly one of the callbacks is called by spinOnce() or waitReplies(): callback with the
+     * reply message (which it can move from), or error if the reply cannot be parsed or the
+     * deadline of the call passes (see setCallDeadline()).
+     */
+    template<class TRep, class TReq>
+    void callAsync(const TReq &req, function<void(TRep&)> callback, CallbackError error)
+    {
+        if(ServiceClient *replica = pickReplica()) {replica->callAsync<TRep>(req, callback, error); return;}
+        boost::recursive_mutex::scoped_lock lock(mutex_);
+        writeMsg(req);
+        addPendingCall(PendingCall{last_correlation_id_, [callback, error](std::vector<b0::message::MessagePart> &parts) {
+            TRep rep;
+            try
+            {
+                parse(rep, parts.at(0).payload, parts.at(0).content_type);
+            }
+            catch(...)
+            {
+                error(std::current_exception());
+                return;
+            }
+            callback(rep);
+        }, {}, error});
+    }
+
+    /*!
+     * \brief Write a request message, and return a future of the reply message
+     *
+     * The future is made ready by spinOnce() or waitReplies(), and holds an exception
+     * if the reply cannot be parsed.
+     */
+    template<class TRep, class TReq>
+    std::future<TRep> callAsync(const TReq &req)
+    {
+        if(ServiceClient *replica = pickReplica()) return replica->callAsync<TRep>(req);
+        std::shared_ptr<std::promise<TRep> > promise = std::make_shared<std::promise<TRep> >();
+        boost::recursive_mutex::scoped_lock lock(mutex_);
+        writeMsg(req);
+        addPendingCall(PendingCall{last_correlation_id_, [promise](std::vector<b0::message::MessagePart> &parts) {
+            try
+            {
+                TRep rep;
+                parse(rep, parts.at(0).payload, parts.at(0).content_type);
+                promise->set_value(std::move(rep));
+            }
+            catch(...)
+            {
+                promise->set_exception(std::current_exception());
+            }
+        }, {}, [promise](std::exception_ptr ex) {promise->set_exception(ex);}});
+        return promise->get_future();
+    }
+
+    /*!
+     * \brief Write a request, and read the reply as a stream of chunks
+     *
+     * Block until the server has sent its last chunk, calling the callback with each chunk
+     * as it arrives. The server sends at most window chunks ahead of the ones consumed by the
+     * callback, so a slow consumer keeps at most window chunks buffered.
+     *
+     * A server which does not stream (see ServiceServer::setStreamCallback()) answers with a
+     * single reply, which is passed to the callback as the only chunk.
+     * If the callback throws, the stream is cancelled and the exception is rethrown; if the
+     * server fails producing a chunk, an exception::Exception is thrown.
+     */
+    virtual void callStream(const std::vector<b0::message::MessagePart> &reqparts, CallbackStreamChunk callback, size_t window = 8);
+
+    /*!
+     * \brief Return the number of requests whose reply has not been read yet
+     */
+    size_t getPendingCalls() const;
+
+    /*!
+     * \brief Set the deadline of the calls, in milliseconds from when they are written (-1 for none)
+     *
+     * The deadline is sent to the server in the Deadline header (in node time, see
+     * Node::timeUSec()), so that the server drops the requests which have already expired
+     * instead of serving them. A synchronous call not answered by the deadline throws
+     * exception::DeadlineExceeded; an asynchronous one is dropped (its future holds a
+     * exception::DeadlineExceeded). Unlike a read timeout, the socket stays usable afterwards:
+     * a late reply is discarded.
+     */
+    void setCallDeadline(long ms);
+
+    /*!
+     * \brief Get the deadline of the calls, in milliseconds (-1 for none)
+     */
+    long getCallDeadline() const;
+
+    /*!
+     * \brief Enable hedged requests
+     *
+     * If a synchronous call is not answered by the 95th percentile of the latencies of the
+     * previous calls, the request is sent once more, which the ZeroMQ socket delivers to
+     * another server of the service, and the first reply is taken. This cuts the tail
+     * latency due to occasionally slow servers, at the cost of some duplicate requests, so
+     * it is meant for requests which are safe to serve twice.
+     *
+     * It has effect only with LoadBalancing::RoundRobin, several servers, and after enough
+     * calls to estimate the latency.
+     */
+    void setHedging(bool enabled);
+
+    /*!
+     * \brief Return true if hedged requests are enabled
+     */
+    bool getHedging() const;
+
+    /*!
+     * \brief Return the latencies of the synchronous calls (in microseconds)
+     */
+    const LatencyHistogram & getCallLatency() const;
+
+    /*!
+     * \brief Return the number of requests sent again by hedging
+     */
+    uint64_t getHedgedRequests() const;
+
+    /*!
+     * \brief Cache the replies of the synchronous calls
+     *
+     * Only the replies of a server with a response cache (see ServiceServer::setResponseCache())
+     * are cached, since they carry a validation token (the Etag header). At most max_entries
+     * replies (0 disables it) of max_bytes of payload in total (0 for no limit) are kept.
+     * A reply younger than ttl milliseconds (-1 for no limit) is used without asking the
+     * server; an older one is validated by sending its token with the request
+     * (If-none-match), to which the server answers with an empty reply if it is unchanged.
+     */
+    void setResponseCache(size_t max_entries, long ttl = 0, size_t max_bytes = 0);
+
+    /*!
+     * \brief Return the cache of the replies
+     */
+    const ResponseCache & getResponseCache() const;
+
+    using Socket::writeRaw;
+
+    /*!
+     * \brief Write a request, keeping a copy of it if it may be hedged
+     */
+    virtual void writeRaw(const b0::message::MessageEnvelope &env) override;
+
+    /*!
+     * \brief Set how the requests are distributed among the servers of the service
+     *
+     * Several servers can announce the same service name; the client connects to all of
+     * them when initialized. With LoadBalancing::RoundRobin (the default) the requests are
+     * sent to each server in turn, by the ZeroMQ socket. With LoadBalancing::LeastOutstanding
+     * the client keeps a connection per server, and sends each request to the one with the
+     * fewest requests in flight; its replies are then read by waitReplies(), or at the node's
+     * spin rate.
+     *
+     * Must be called before init().
+     */
+    void setLoadBalancing(LoadBalancing mode);
+
+    /*!
+     * \brief Get how the requests are distributed among the servers of the service
+     */
+    LoadBalancing getLoadBalancing() const;
+
+    /*!
+     * \brief Return the addresses of the servers this client is connected to
+     */
+    std::vector<std::string> getRemoteAddresses() const;
+
+    /*!
+     * \brief Resolve and connect on the first call instead of in init() (must be called before init())
+     *
+     * A client of a service which is seldom called then costs no resolution and no connection
+     * until it is used, and the service needs not exist at init(). The first call throws
+     * the errors of the resolution (e.g. if the service does not exist), and
+     * getRemoteAddresses() is empty until then.
+     *
+     * The default is disabled, unless the B0_LAZY_CONNECT environment variable is set
+     * (the clients which do not notify the graph, e.g. those of the library, are not
+     * made lazy by it).
+     */
+    void setLazy(bool lazy);
+
+    /*!
+     * \brief Return true if the client connects on its first call (see setLazy())
+     */
+    bool getLazy() const;
+
+    /*!
+     * \brief Return false while a lazy client has not made its first call (see setLazy())
+     */
+    bool isConnected() const;
+
+    /*!
+     * \brief Close the connections kept for the clients of the nodes using a ZeroMQ context (see b0::setServiceClientPool())
+     *
+     * Called by b0::Node when destroyed, since the context cannot be terminated while they are open.
+     */
+    static void closePooledConnections(void *context);
+
+    /*!
+     * \brief Read the replies of the asynchronous calls, completing them
+     *
+     * Wait at most timeout milliseconds (-1 to wait indefinitely) for all the pending calls to
+     * complete. Return true if there are no pending calls left.
+     */
+    bool waitReplies(long timeout = -1);
+
+    /*!
+     * \brief Read the replies which have arrived, completing the asynchronous calls
+     */
+    virtual void spinOnce() override;
+
+    /*!
+     * \brief Return true if there are pending calls
+     */
+    virtual bool hasCallback() const override;
+
+    /*!
+     * \brief Return the number of calls whose reply has not been read yet (see getPendingCalls())
+     */
+    virtual size_t getQueueDepth() const override;
+
 protected:
     /*!
      * \brief Perform service address resolution
@@ -113,6 +486,174 @@ protected:
 
     //! If false this socket will not send announcement to resolv (i.e. it will be "invisible")
     const bool notify_graph_;
+
+    /*!
+     * \brief Return the connection to send the next request to, or nullptr to send it through this socket
+     *
+     * With LoadBalancing::LeastOutstanding and several servers, this is the connection to
+     * the server with the fewest requests in flight. A lazy client is connected first.
+     */
+    ServiceClient * pickReplica();
+
+    /*!
+     * \brief Resolve the service and connect to it, if not done yet (see setLazy())
+     */
+    void connectNow();
+
+    //! Take over a connection of the pool (see b0::setServiceClientPool()); return false if there is none
+    bool acquirePooledConnection();
+
+    //! Give the connection to the pool (see b0::setServiceClientPool()); return false if it is not pooled
+    bool releasePooledConnection();
+
+    /*!
+     * \brief Add the Correlation-id header to the requests
+     */
+    virtual void prepareEnvelope(b0::message::MessageEnvelope &env) override;
+
+    /*!
+     * \brief Make a synchronous call through the response cache
+     */
+    void callCached(const std::vector<b0::message::MessagePart> &reqparts, std::vector<b0::message::MessagePart> &repparts);
+
+    /*!
+     * \brief Write all the requests through writeRaw() while hedging, so that they can be copied
+     */
+    virtual bool canWriteFrameInPlace(size_t payload_size) const override;
+
+    //! A completion of a pending call, called with the reply parts
+    using Completion = function<void(std::vector<b0::message::MessagePart>&)>;
+
+    //! A call whose reply has not been read yet
+    struct PendingCall
+    {
+        //! Correlation id of the request
+        uint64_t id;
+
+        //! Completion of the call (empty for a synchronous call)
+        Completion completion;
+
+        //! Deadline of the call (the epoch if it has none)
+        std::chrono::steady_clock::time_point deadline;
+
+        //! Called when the deadline passes (optional)
+        function<void(std::exception_ptr)> fail;
+
+        //! Span of the call, ended when the call is removed
+        tracing::Span span;
+    };
+
+    /*!
+     * \brief Read the reply of the synchronous call just written
+     *
+     * The replies of the other calls arriving in the meantime complete those calls.
+     * The caller must hold mutex_.
+     */
+    void readReply(std::vector<b0::message::MessagePart> &parts);
+
+    /*!
+     * \brief Read one reply, and complete the pending call it answers. The caller must hold mutex_.
+     */
+    void readPendingReply();
+
+    /*!
+     * \brief Read one reply, and return the pending call it answers, or pending_.end() if none
+     *
+     * The call is matched by the Correlation-id header of the reply; a server which does not
+     * send it back (such as a REP socket of an older version) answers in order, so the reply
+     * is matched to the oldest pending call.
+     */
+    std::deque<PendingCall>::iterator readAnyReply(std::vector<b0::message::MessagePart> &parts);
+
+    //! Write a stream control message (credit or cancel) for a streaming call. The caller must hold mutex_.
+    void writeStreamControl(uint64_t id, const std::string &header, const std::string &value);
+
+    /*!
+     * \brief Wait until a reply can be read, or until the given time
+     *
+     * Return false if the time has come first. With a time of the epoch return true at once,
+     * leaving the wait to the read. The caller must hold mutex_.
+     */
+    bool waitReply(std::chrono::steady_clock::time_point until);
+
+    //! Drop the pending calls whose deadline has passed. The caller must hold mutex_.
+    void expirePendingCalls();
+
+    //! Return the milliseconds left until the earliest deadline of the pending calls (-1 if none)
+    long timeToNextDeadline() const;
+
+    //! Add a pending call, with the deadline of the calls if none is given. The caller must hold mutex_.
+    void addPendingCall(PendingCall &&call);
+
+    //! Remove a pending call. The caller must hold mutex_.
+    void removePendingCall(std::deque<PendingCall>::iterator it);
+
+    //! The calls whose reply has not been read yet, in the order they have been written
+    std::deque<PendingCall> pending_;
+
+    //! The Stream-window header of the request being written (0 for a plain request)
+    size_t stream_window_{0};
+
+    //! The Batch header of the next request written (0 for a plain request)
+    size_t batch_size_{0};
+
+    //! The If-none-match header of the next request written (empty for none)
+    std::string if_none_match_;
+
+    //! Span of the last request written, moved to its pending call
+    tracing::Span request_span_;
+
+    //! Cache of the replies (see setResponseCache())
+    ResponseCache response_cache_;
+
+    //! Size of pending_, readable without holding mutex_
+    std::atomic<size_t> num_pending_{0};
+
+    //! Correlation id of the last request written
+    uint64_t last_correlation_id_{0};
+
+    //! How the requests are distributed among the servers
+    LoadBalancing load_balancing_{LoadBalancing::RoundRobin};
+
+    //! The addresses of the servers of the service
+    std::vector<std::string> remote_addrs_;
+
+    //! A connection per server, with LoadBalancing::LeastOutstanding and several servers
+    std::vector<std::unique_ptr<ServiceClient> > replicas_;
+
+    //! Where pickReplica() starts looking, so that idle servers are used in turn
+    size_t next_replica_{0};
+
+    //! Deadline of the calls in milliseconds (-1 for none)
+    long call_deadline_{-1};
+
+    //! If true, slow synchronous calls are sent again
+    bool hedging_{false};
+
+    //! If true, the client is resolved and connected by its first call
+    //! \sa ServiceClient::setLazy()
+    bool lazy_;
+
+    //! False until a lazy client is connected
+    std::atomic<bool> connected_{false};
+
+    //! Key of the connection in the pool: the service name and the address given, if any
+    std::string pool_key_;
+
+    //! The last request written, kept while hedging
+    b0::message::MessageEnvelope last_request_;
+
+    //! Latencies of the synchronous calls (in microseconds)
+    LatencyHistogram call_latency_;
+
+    //! Number of requests sent again by hedging
+    std::atomic<uint64_t> hedged_requests_{0};
+
+    //! Envelope the replies are read into, reused across replies
+    b0::message::MessageEnvelope reply_envelope_;
+
+    //! Serializes the access to the socket and to pending_ (recursive, since completions can make calls)
+    mutable boost::recursive_mutex mutex_;
 };
 
 } // namespace b0
@@ -1,26 +1,97 @@
 #ifndef B0__SERVICE_SERVER_H__INCLUDED
 #define B0__SERVICE_SERVER_H__INCLUDED
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 #include <b0/b0.h>
 #include <b0/socket.h>
+#include <b0/message/message.h>
 #include <b0/message/message_part.h>
+#include <b0/utils/response_cache.h>
+#include <b0/utils/tracing.h>
 
 namespace b0
 {
 
 class Node;
 
+//! \cond HIDDEN_SYMBOLS
+
+/*!
+ * \brief Request and reply messages kept between the calls of a typed callback (see ServiceServer::setReuseMessages())
+ *
+ * There is one pair per callback running at the same time (i.e. at most one per worker thread).
+ */
+template<class TReq, class TRep>
+class ReusedMessages
+{
+public:
+    struct Pair
+    {
+        TReq req;
+        TRep rep;
+    };
+
+    //! A pair taken from the pool, given back when destroyed
+    class Lease
+    {
+    public:
+        explicit Lease(ReusedMessages &pool) : pool_(pool), pair_(pool.acquire()) {}
+        ~Lease() {pool_.release(std::move(pair_));}
+        Lease(const Lease &) = delete;
+        Lease & operator=(const Lease &) = delete;
+        Pair * operator->() {return pair_.get();}
+
+    private:
+        ReusedMessages &pool_;
+        std::unique_ptr<Pair> pair_;
+    };
+
+private:
+    std::unique_ptr<Pair> acquire()
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        if(free_.empty()) return std::unique_ptr<Pair>(new Pair);
+        std::unique_ptr<Pair> pair = std::move(free_.back());
+        free_.pop_back();
+        return pair;
+    }
+
+    void release(std::unique_ptr<Pair> pair)
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        free_.push_back(std::move(pair));
+    }
+
+    boost::mutex mutex_;
+    std::vector<std::unique_ptr<Pair> > free_;
+};
+
+//! \endcond
+
 /*!
  * \brief The service server class
  *
- * This class wraps a REP socket. It will automatically
+ * This class wraps a ROUTER socket, serving both REQ and DEALER clients. It will automatically
  * announce the socket name to resolver.
  *
+ * The requests are served one at a time by spinOnce(), or by a pool of worker threads
+ * (see setWorkerThreads()). The Correlation-id header of a request, if any, is copied to
+ * its reply, so that a client with several requests in flight can tell which one it answers.
+ *
  * \sa b0::ServiceClient, b0::ServiceServer
  */
 class ServiceServer : public Socket
@@ -46,6 +117,12 @@ public:
     //! \brief Alias for callback message class + raw extra parts
     template<class TReq, class TRep> using CallbackMsgParts = function<void(const TReq&, const std::vector<b0::message::MessagePart>&, TRep&, std::vector<b0::message::MessagePart>&)>;
 
+    //! \brief Alias for the producer of a streamed reply: fills the next chunk and returns true, or returns false at the end
+    using StreamProducer = function<bool(std::vector<b0::message::MessagePart>&)>;
+
+    //! \brief Alias for callback returning the producer of a streamed reply
+    using CallbackStream = function<StreamProducer(const std::vector<b0::message::MessagePart>&)>;
+
     /*!
      * \brief Construct an ServiceServer child of the specified Node, without a callback
      */
@@ -160,6 +237,174 @@ public:
      */
     virtual void spinOnce() override;
 
+    /*!
+     * \brief Return true if a callback has been set, and more requests can be read
+     *
+     * With worker threads, no more requests are read while max_queued requests are
+     * waiting for a worker (see setWorkerThreads()).
+     */
+    virtual bool hasCallback() const override;
+
+    /*!
+     * \brief Return true if worker threads have finished requests whose reply is to be written
+     */
+    virtual bool hasPendingMessages() const override;
+
+    /*!
+     * \brief Return the number of requests waiting for a worker thread (or read ahead, see setAdmissionLimit())
+     */
+    virtual size_t getQueueDepth() const override;
+
+    /*!
+     * \brief Call the callback from a pool of n worker threads (0 to call it from spinOnce())
+     *
+     * With n > 0, spinOnce() reads the requests and queues them for the worker threads,
+     * so that up to n requests are served at the same time, and the callback must be
+     * thread-safe. The replies are written by spinOnce() as the requests are done; the
+     * workers wake up the node (see b0::Node::wakeUp()) so that, with SpinMode::EventDriven,
+     * this happens immediately.
+     *
+     * At most max_queued requests (0 for n) are read and waiting for a worker: the next
+     * ones wait in the socket queue until a worker is free.
+     *
+     * Must be called before init().
+     */
+    void setWorkerThreads(int n, size_t max_queued = 0);
+
+    /*!
+     * \brief Get the number of worker threads
+     */
+    int getWorkerThreads() const;
+
+    /*!
+     * \brief Get the maximum number of requests read and waiting for a worker thread
+     */
+    size_t getMaxQueuedRequests() const;
+
+    /*!
+     * \brief Keep the request and reply messages of the typed callbacks between the calls
+     *
+     * By default, a typed callback gets a new request and reply message for every call.
+     * When enabled, the messages are kept and reset (see b0::message::reset(), which calls
+     * their clear() method if they have one) before each call, so that their strings and
+     * vectors keep their capacity: with MessagePack, handling a request of a steady size
+     * then does not allocate to parse it nor to build the reply. The reply given to the
+     * callback is the reset one, not a fresh instance.
+     */
+    void setReuseMessages(bool enabled);
+
+    /*!
+     * \brief Return true if the typed callbacks reuse their messages (see setReuseMessages())
+     */
+    bool getReuseMessages() const;
+
+    /*!
+     * \brief Return the number of requests dropped because their deadline had passed
+     *
+     * A client can set a deadline to its calls (see ServiceClient::setCallDeadline()). A
+     * request whose deadline has passed when it is read, or when a worker thread picks it up,
+     * is dropped without calling the callback and without a reply, since the client has
+     * given up on it already.
+     */
+    uint64_t getExpiredRequests() const;
+
+    /*!
+     * \brief Reject the requests beyond max_pending accepted and not answered yet (0 for no limit, the default)
+     *
+     * Without a limit, the requests an overloaded server cannot keep up with wait in the
+     * socket queue, and many of their clients time out after the server has served them. With
+     * a limit, spinOnce() reads the requests as they arrive, and answers the ones beyond it at
+     * once with an empty reply carrying the Busy header, for which ServiceClient throws
+     * exception::ServerBusy: the client can try again later, or another server. The goodput
+     * then stays close to the capacity of the server as the load grows.
+     *
+     * The requests pending are the ones waiting for a worker thread or being served by one
+     * (this replaces the max_queued limit of setWorkerThreads()), or, without worker threads,
+     * the ones read by spinOnce() and not served yet. A request whose deadline has passed (see
+     * getExpiredRequests()) is dropped when read, and again right before being served.
+     */
+    void setAdmissionLimit(size_t max_pending);
+
+    /*!
+     * \brief Return the maximum number of requests pending (see setAdmissionLimit())
+     */
+    size_t getAdmissionLimit() const;
+
+    /*!
+     * \brief Return the number of requests rejected with a Busy reply (see setAdmissionLimit())
+     */
+    uint64_t getRejectedRequests() const;
+
+    /*!
+     * \brief Serve identical requests arriving at the same time with a single call of the callback
+     *
+     * With worker threads (see setWorkerThreads()), a request identical to one waiting for a
+     * worker or being served (same payloads and content types) is not queued: it waits for
+     * that one to be done, and gets a copy of its reply. A burst of identical requests to an
+     * expensive callback then costs a single call, which a cache of the replies (see
+     * setResponseCache()) cannot do until the first one is done. The callback must give the
+     * same reply to identical requests. Batched requests are not coalesced.
+     *
+     * Must be called before init().
+     */
+    void setCoalescing(bool enabled);
+
+    /*!
+     * \brief Return true if identical concurrent requests are coalesced (see setCoalescing())
+     */
+    bool getCoalescing() const;
+
+    /*!
+     * \brief Return the number of requests answered with the reply of an identical one (see setCoalescing())
+     */
+    uint64_t getCoalescedRequests() const;
+
+    /*!
+     * \brief Reply to the requests with a stream of chunks (see ServiceClient::callStream())
+     *
+     * The callback is called with each request, and returns a producer, which is then
+     * called by spinOnce() for each chunk of the reply, until it returns false. A chunk
+     * is produced only when the client has room for it (it grants a window of chunks,
+     * and more as it consumes them), so neither side has to hold the whole reply.
+     *
+     * The streams are served from spinOnce(), also with worker threads. To a client
+     * which does not read streams, the chunks are sent as the parts of a single reply.
+     * A stream whose client has not asked for more chunks in 30 seconds is dropped.
+     *
+     * This replaces the callback given to the constructor, if any.
+     */
+    void setStreamCallback(CallbackStream callback);
+
+    /*!
+     * \brief Serve the batched requests (see ServiceClient::callBatch()) with a single call
+     *
+     * The callback is called with the items of a batch, one part each, and must fill the
+     * reply with one part per item. Without it, the callback given to the constructor is
+     * called for each item in turn. The requests which are not batched are still served by
+     * the callback given to the constructor.
+     */
+    void setBatchCallback(CallbackParts callback);
+
+    /*!
+     * \brief Cache the replies, for a service which always gives the same reply to the same request
+     *
+     * The replies are kept in an LRU cache keyed by the request payloads and content types,
+     * of at most max_entries replies (0 disables it) and max_bytes of payload (0 for no limit),
+     * for ttl milliseconds each (-1 for no limit). A request found in it is answered without
+     * calling the callback, nor serializing the reply again.
+     *
+     * The cached replies carry a validation token (the Etag header), which lets a client
+     * with its own cache (see ServiceClient::setResponseCache()) ask for the reply only if
+     * it has changed: a request with a matching If-none-match header is answered by an
+     * empty reply with the Not-modified header.
+     */
+    void setResponseCache(size_t max_entries, long ttl = -1, size_t max_bytes = 0);
+
+    /*!
+     * \brief Return the cache of the replies
+     */
+    const ResponseCache & getResponseCache() const;
+
     /*!
      * \brief Return the name of this server's service
      */
@@ -170,6 +415,28 @@ public:
      */
     virtual void bind(const std::string &address);
 
+    using Socket::readRaw;
+
+    /*!
+     * \brief Read a request, remembering its correlation id for the reply
+     */
+    virtual void readRaw(b0::message::MessageEnvelope &env) override;
+
+    /*!
+     * \brief Read a request, remembering its correlation id for the reply
+     */
+    virtual void readRaw(b0::message::MessageEnvelopeView &env) override;
+
+    /*!
+     * \brief Callback returning the producer of a streamed reply
+     */
+    CallbackStream callback_stream_;
+
+    /*!
+     * \brief Callback serving the batched requests at once (optional)
+     */
+    CallbackParts callback_batch_;
+
 protected:
     /*!
      * \brief Bind socket to the address
@@ -189,6 +456,9 @@ protected:
     //! The ZeroMQ address to bind the service socket on
     std::string bind_addr_;
 
+    //! The IPC endpoint also bound, for the clients on the same host (empty if none)
+    std::string ipc_addr_;
+
     //! If false this socket will not send announcement to resolv (i.e. it will be "invisible")
     const bool notify_graph_;
 
@@ -206,37 +476,305 @@ protected:
      * \brief Callback which will be called when a new message is read from the socket (raw multipart)
      */
     CallbackParts callback_multipart_;
+
+    /*!
+     * \brief Copy the correlation id of the request being served to its reply
+     */
+    virtual void prepareEnvelope(b0::message::MessageEnvelope &env) override;
+
+private:
+    //! A request being served, and its reply
+    struct Call
+    {
+        //! Routing frames of the request (see Socket::getRoute())
+        std::vector<std::string> route;
+
+        //! Correlation id of the request (empty if it has none)
+        std::string correlation_id;
+
+        //! The request parts
+        std::vector<b0::message::MessagePart> reqparts;
+
+        //! The reply parts (multipart callback)
+        std::vector<b0::message::MessagePart> repparts;
+
+        //! The reply payload and type (raw callbacks)
+        std::string rep, reptype;
+
+        //! Deadline of the request, in node time (0 if it has none)
+        int64_t deadline{0};
+
+        //! Number of items of a batched request (0 if it is not batched)
+        size_t batch{0};
+
+        //! If-none-match header of the request (empty if absent)
+        std::string if_none_match;
+
+        //! Validation token of the reply (empty if not cacheable)
+        std::string etag;
+
+        //! Trace context of the request (not valid if it has none)
+        tracing::TraceContext trace;
+
+        //! Key of the request, if coalesced with the identical ones (see setCoalescing())
+        std::string coalescing_key;
+
+        //! The identical requests waiting for the reply of this one
+        std::vector<std::unique_ptr<Call> > followers;
+    };
+
+    //! A streamed reply in progress
+    struct Stream
+    {
+        //! Routing frames of the request
+        std::vector<std::string> route;
+
+        //! Correlation id of the request
+        std::string correlation_id;
+
+        //! Producer of the chunks
+        StreamProducer producer;
+
+        //! Number of chunks the client has room for
+        size_t credit;
+
+        //! Sequence number of the next chunk
+        uint64_t seq;
+
+        //! Last time the client asked for chunks
+        std::chrono::steady_clock::time_point last_credit;
+    };
+
+    //! Return true if a callback has been set
+    bool hasHandler() const;
+
+    //! Remember the headers of a request which matter to this server
+    void readHeaders(const std::map<std::string, std::string> &headers);
+
+    //! Read a request for the dispatch loops; return false if it has been dropped (see Socket::tryReadRaw())
+    bool readRequest(std::vector<b0::message::MessagePart> &parts);
+
+    //! The envelope of the last request read by readRequest() (reused, as is its storage)
+    b0::message::MessageEnvelope request_envelope_;
+
+    //! Read a request into a new call; return nullptr if there is nothing to serve (dropped, expired, stream control or stream)
+    std::unique_ptr<Call> readCall();
+
+    //! Answer the request just read with a Busy reply (see setAdmissionLimit())
+    void reject();
+
+    //! Serve the requests read ahead by spinOnce() without worker threads (see setAdmissionLimit())
+    void serveBacklog();
+
+    //! Serve the items of a batched request
+    void handleBatch(Call &call);
+
+    //! Call the callback on a (not batched) request
+    void invokeCallback(Call &call);
+
+    //! Return the parts of the reply of a call
+    std::vector<b0::message::MessagePart> replyParts(const Call &call) const;
+
+    //! Return true (and account it) if the deadline of a request has passed
+    bool expired(int64_t deadline);
+
+    //! Handle a message of a client about a streamed reply (more chunks, or cancellation); return false if it is a request
+    bool handleStreamControl();
+
+    //! Start a streamed reply to the request just read
+    void startStream(const std::vector<b0::message::MessagePart> &reqparts);
+
+    //! Produce and write the chunks of the streams the client has room for
+    void pumpStreams();
+
+    //! Write a chunk (or the end) of a stream
+    void writeStreamFrame(Stream &stream, std::vector<b0::message::MessagePart> &&parts, bool end, const std::string &error = "");
+
+    //! Call the callback set on a request
+    void handle(Call &call);
+
+    //! Write the reply of a request handled with handle()
+    void writeReply(Call &call);
+
+    //! Write the replies of the requests done by the worker threads, and queue the new requests
+    void dispatchRequests();
+
+    //! The worker loop (run in its own threads)
+    void workerLoop();
+
+    //! Stop the worker threads, discarding the queued requests
+    void stopWorkerThreads();
+
+    //! Record the duration of a callback started at t0 in the socket counters
+    void recordCallbackDuration(std::chrono::steady_clock::time_point t0);
+
+    //! Correlation id of the request being served (empty if it has none)
+    std::string correlation_id_;
+
+    //! Deadline header of the last request read, in node time (0 if absent)
+    int64_t request_deadline_{0};
+
+    //! Batch header of the last request read (0 if absent)
+    size_t request_batch_{0};
+
+    //! Number of items of the reply being written, if it answers a batched request
+    size_t reply_batch_{0};
+
+    //! If-none-match header of the last request read (empty if absent)
+    std::string request_if_none_match_;
+
+    //! Trace context of the last request read (not valid if absent)
+    tracing::TraceContext request_trace_;
+
+    //! Etag header of the reply being written (empty if none)
+    std::string reply_etag_;
+
+    //! True if the reply being written is a Not-modified one
+    bool reply_not_modified_{false};
+
+    //! Cache of the replies (see setResponseCache())
+    ResponseCache response_cache_;
+
+    //! Number of requests dropped because their deadline had passed
+    std::atomic<uint64_t> expired_requests_{0};
+
+    //! Maximum number of requests pending, or 0 (see setAdmissionLimit())
+    size_t admission_limit_{0};
+
+    //! Number of requests rejected with a Busy reply
+    std::atomic<uint64_t> rejected_requests_{0};
+
+    //! True if the reply being written is a Busy one
+    bool reply_busy_{false};
+
+    //! The requests read ahead and not served yet, without worker threads (see setAdmissionLimit())
+    std::deque<std::unique_ptr<Call> > backlog_;
+
+    //! If true, the typed callbacks reuse their messages (see setReuseMessages())
+    bool reuse_messages_{false};
+
+    //! Wrap a typed callback (message class) into a raw multipart one
+    template<class TReq, class TRep>
+    static CallbackParts msgCallback(ServiceServer *self, CallbackMsg<TReq, TRep> callback, std::shared_ptr<ReusedMessages<TReq, TRep> > reused);
+
+    //! Wrap a typed callback (message class + raw extra parts) into a raw multipart one
+    template<class TReq, class TRep>
+    static CallbackParts msgCallback(ServiceServer *self, CallbackMsgParts<TReq, TRep> callback, std::shared_ptr<ReusedMessages<TReq, TRep> > reused);
+
+    //! Number of worker threads (0 to call the callback from spinOnce())
+    int num_worker_threads_{0};
+
+    //! Maximum number of requests waiting for a worker thread
+    size_t max_queued_requests_{0};
+
+    //! The worker threads
+    std::vector<boost::thread> worker_threads_;
+
+    //! Protects the queues of the worker threads
+    mutable boost::mutex worker_mutex_;
+
+    //! Signaled when a request is queued, or the worker threads are to stop
+    boost::condition_variable worker_cond_;
+
+    //! The requests waiting for a worker thread
+    std::deque<std::unique_ptr<Call> > requests_;
+
+    //! The requests done, whose reply is to be written
+    std::deque<std::unique_ptr<Call> > replies_;
+
+    //! Number of requests being served by the worker threads
+    size_t in_flight_{0};
+
+    //! If true, identical requests are served once (see setCoalescing())
+    bool coalescing_{false};
+
+    //! The requests waiting for a worker or being served, by coalescing key
+    std::map<std::string, Call*> coalescing_leaders_;
+
+    //! Number of requests answered with the reply of an identical one
+    std::atomic<uint64_t> coalesced_requests_{0};
+
+    //! Hand the reply of a coalesced request over to the identical ones (with worker_mutex_ held)
+    void completeFollowers(Call &call);
+
+    //! If true, the worker threads exit
+    bool worker_stop_{false};
+
+    //! The streamed replies in progress
+    std::list<Stream> streams_;
+
+    //! True if some stream has chunks to write, readable from other threads
+    std::atomic<bool> streams_ready_{false};
+
+    //! Stream-window header of the last request read (0 if absent)
+    size_t stream_window_{0};
+
+    //! Stream-credit header of the last message read (0 if absent)
+    size_t stream_credit_{0};
+
+    //! True if the last message read cancels a stream
+    bool stream_cancel_{false};
 };
 
 template<class TReq, class TRep>
 ServiceServer::ServiceServer(Node *node, const std::string &service_name, CallbackMsg<TReq, TRep> callback, bool managed, bool notify_graph)
-    : ServiceServer(node, service_name,
-            static_cast<CallbackParts>([&, callback](const std::vector<b0::message::MessagePart> &reqparts, std::vector<b0::message::MessagePart> &repparts) {
-                TReq req; TRep rep;
-                parse(req, reqparts[0].payload, reqparts[0].content_type);
-                callback(req, rep);
-                repparts.resize(1);
-                serialize(rep, repparts[0].payload, repparts[0].content_type);
-            }), managed, notify_graph)
+    : ServiceServer(node, service_name, msgCallback(this, callback, std::make_shared<ReusedMessages<TReq, TRep> >()), managed, notify_graph)
 {}
 
 template<class TReq, class TRep>
 ServiceServer::ServiceServer(Node *node, const std::string &service_name, CallbackMsgParts<TReq, TRep> callback, bool managed, bool notify_graph)
-    : ServiceServer(node, service_name,
-            static_cast<CallbackParts>([&, callback](const std::vector<b0::message::MessagePart> &reqparts, std::vector<b0::message::MessagePart> &repparts) {
-                std::vector<b0::message::MessagePart> reqparts1(reqparts);
-                TReq req;
-                parse(req, reqparts1[0].payload, reqparts1[0].content_type);
-                reqparts1.erase(reqparts1.begin());
-                TRep rep;
-                std::vector<b0::message::MessagePart> repparts1;
-                callback(req, reqparts1, rep, repparts);
-                b0::message::MessagePart reppart0;
-                serialize(rep, reppart0.payload, reppart0.content_type);
-                repparts.insert(repparts.begin(), reppart0);
-            }), managed, notify_graph)
+    : ServiceServer(node, service_name, msgCallback(this, callback, std::make_shared<ReusedMessages<TReq, TRep> >()), managed, notify_graph)
 {}
 
+template<class TReq, class TRep>
+ServiceServer::CallbackParts ServiceServer::msgCallback(ServiceServer *self, CallbackMsg<TReq, TRep> callback, std::shared_ptr<ReusedMessages<TReq, TRep> > reused)
+{
+    return [self, callback, reused](const std::vector<b0::message::MessagePart> &reqparts, std::vector<b0::message::MessagePart> &repparts) {
+        repparts.resize(1);
+        if(self->reuse_messages_)
+        {
+            typename ReusedMessages<TReq, TRep>::Lease m(*reused);
+            b0::message::reset(m->req);
+            b0::message::reset(m->rep);
+            parse(m->req, reqparts[0].payload, reqparts[0].content_type);
+            callback(m->req, m->rep);
+            serialize(m->rep, repparts[0].payload, repparts[0].content_type, self->getMessageCodec());
+            return;
+        }
+        TReq req; TRep rep;
+        parse(req, reqparts[0].payload, reqparts[0].content_type);
+        callback(req, rep);
+        serialize(rep, repparts[0].payload, repparts[0].content_type, self->getMessageCodec());
+    };
+}
+
+template<class TReq, class TRep>
+ServiceServer::CallbackParts ServiceServer::msgCallback(ServiceServer *self, CallbackMsgParts<TReq, TRep> callback, std::shared_ptr<ReusedMessages<TReq, TRep> > reused)
+{
+    return [self, callback, reused](const std::vector<b0::message::MessagePart> &reqparts, std::vector<b0::message::MessagePart> &repparts) {
+        std::vector<b0::message::MessagePart> reqparts1(reqparts.begin() + 1, reqparts.end());
+        b0::message::MessagePart reppart0;
+        if(self->reuse_messages_)
+        {
+            typename ReusedMessages<TReq, TRep>::Lease m(*reused);
+            b0::message::reset(m->req);
+            b0::message::reset(m->rep);
+            parse(m->req, reqparts[0].payload, reqparts[0].content_type);
+            callback(m->req, reqparts1, m->rep, repparts);
+            serialize(m->rep, reppart0.payload, reppart0.content_type, self->getMessageCodec());
+        }
+        else
+        {
+            TReq req;
+            parse(req, reqparts[0].payload, reqparts[0].content_type);
+            TRep rep;
+            callback(req, reqparts1, rep, repparts);
+            serialize(rep, reppart0.payload, reppart0.content_type, self->getMessageCodec());
+        }
+        repparts.insert(repparts.begin(), std::move(reppart0));
+    };
+}
+
 template<class TReq, class TRep>
 ServiceServer::ServiceServer(Node *node, const std::string &service_name, void (*callback)(const TReq&, TRep&), bool managed, bool notify_graph)
     : ServiceServer(node, service_name, static_cast<CallbackMsg<TReq, TRep> >(callback), managed, notify_graph)
@@ -0,0 +1,156 @@
+#ifndef B0__SHM__SHARED_MEMORY_H__INCLUDED
+#define B0__SHM__SHARED_MEMORY_H__INCLUDED
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+//! \brief Shared-memory transport of large envelopes between the nodes of a host
+namespace shm
+{
+
+/*!
+ * \brief Reference to a serialized envelope stored in a shared-memory segment
+ *
+ * A publisher using shared memory (see b0::Publisher::setSharedMemory()) serializes a large
+ * envelope into a slot of its segment, and sends only a descriptor through ZeroMQ. It starts
+ * with the header0 line of the envelope (so routing and subscriptions are unaffected), followed
+ * by a marker byte, and:
+ *
+ *     \x02 version(1) token(8) slot(4) generation(8) size(8) host-length(2) host segment-length(2) segment
+ *
+ * Integers are little-endian.
+ */
+struct Descriptor
+{
+    //! Host of the publisher (b0::Node::hostname()); the segment can only be mapped on that host
+    std::string host;
+
+    //! Name of the shared-memory segment
+    std::string segment;
+
+    //! Random token of the segment, also stored in the segment itself
+    uint64_t token;
+
+    //! Index of the slot storing the envelope
+    uint32_t slot;
+
+    //! Generation of the slot, which changes every time the slot is written
+    uint64_t generation;
+
+    //! Size of the serialized envelope
+    uint64_t size;
+};
+
+/*!
+ * \brief Return true if the ZeroMQ message in data is a shared-memory descriptor
+ */
+bool isDescriptor(const char *data, size_t size);
+
+/*!
+ * \brief Serialize a descriptor, with the given header0, into out
+ */
+void serializeDescriptor(const std::string &header0, const Descriptor &desc, std::string &out);
+
+/*!
+ * \brief Parse a descriptor, throwing exception::EnvelopeDecodeError if it is malformed
+ */
+void parseDescriptor(Descriptor &desc, const char *data, size_t size);
+
+/*!
+ * \brief Parse a descriptor, returning false instead of throwing if it is malformed
+ */
+bool tryParseDescriptor(Descriptor &desc, const char *data, size_t size);
+
+/*!
+ * \brief A shared-memory segment made of fixed-size slots, written by one publisher
+ *
+ * Each slot stores one serialized envelope, and counts the readers currently using it
+ * (see Reader::pin()). A slot is written only when no reader pins it, otherwise the next
+ * slot is tried; an unread envelope is simply overwritten, and the readers coming late
+ * notice it from the slot generation.
+ *
+ * The segment is removed when the pool is destroyed; readers which still map it keep their
+ * mapping until they release it.
+ */
+class Pool
+{
+private:
+    //! \cond HIDDEN_SYMBOLS
+
+    struct Private;
+
+    //! \endcond
+
+public:
+    //! Create a segment with slot_count slots of slot_size bytes each
+    Pool(const std::string &host, size_t slot_size, size_t slot_count);
+
+    //! Remove the segment
+    ~Pool();
+
+    //! The maximum size of an envelope stored in a slot
+    size_t getSlotSize() const;
+
+    //! The number of slots
+    size_t getSlotCount() const;
+
+    /*!
+     * \brief Acquire a free slot to write size bytes into
+     *
+     * Return nullptr if size exceeds the slot size, or all slots are pinned by readers.
+     * Otherwise the envelope must be written into the returned buffer, and then made
+     * visible to the readers with commit(desc).
+     */
+    char * acquire(size_t size, Descriptor &desc);
+
+    //! Make the envelope written into the slot of desc visible to the readers
+    void commit(const Descriptor &desc);
+
+private:
+    std::unique_ptr<Private> private_;
+};
+
+/*!
+ * \brief Maps the segments of the publishers of the same host, to read the envelopes in place
+ */
+class Reader
+{
+private:
+    //! \cond HIDDEN_SYMBOLS
+
+    struct Private;
+
+    //! \endcond
+
+public:
+    Reader();
+
+    ~Reader();
+
+    /*!
+     * \brief Pin the envelope referenced by a descriptor, so that it is not overwritten while in use
+     *
+     * data is set to point to the envelope in the segment. The envelope is unpinned when the
+     * returned object (and all its copies) are destroyed.
+     *
+     * Return an empty pointer if the envelope is not available anymore (the slot has been
+     * written again), or the segment cannot be mapped (e.g. because it has been removed).
+     */
+    std::shared_ptr<const void> pin(const Descriptor &desc, const char *&data);
+
+private:
+    std::unique_ptr<Private> private_;
+};
+
+} // namespace shm
+
+} // namespace b0
+
+#endif // B0__SHM__SHARED_MEMORY_H__INCLUDED
@@ -1,7 +1,10 @@
 #ifndef B0__SOCKET_H__INCLUDED
 #define B0__SOCKET_H__INCLUDED
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <b0/b0.h>
 #include <b0/user_data.h>
@@ -9,15 +12,63 @@
 #include <b0/message/message_part.h>
 #include <b0/message/message_envelope.h>
 #include <b0/exception/message_unpack_error.h>
+#include <b0/utils/metrics.h>
 
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
 
+namespace zmq
+{
+
+class message_t;
+class socket_t;
+
+} // namespace zmq
+
 namespace b0
 {
 
+namespace message
+{
+
+namespace metrics
+{
+
+class SocketMetrics;
+
+} // namespace metrics
+
+} // namespace message
+
 class Node;
 
+struct SocketProfile;
+
+/*!
+ * \brief Result of Socket::tryReadRaw()
+ */
+enum class ReadStatus
+{
+    //! The envelope has been read
+    Ok,
+    //! The envelope was rejected by the filter (its parts are not valid)
+    Filtered,
+    //! The envelope is not for this socket (readRaw() throws exception::HeaderMismatch)
+    HeaderMismatch,
+    //! Nothing could be read from the ZeroMQ socket (readRaw() throws exception::SocketReadError)
+    ReadError,
+    //! The envelope or its framing is malformed (readRaw() throws exception::EnvelopeDecodeError)
+    DecodeError,
+    //! A part is compressed with an algorithm not supported by this build (readRaw() throws exception::UnsupportedCompressionAlgorithm)
+    UnsupportedCompression,
+    //! A part cannot be decompressed (readRaw() throws exception::Exception)
+    DecompressError,
+    //! The payload of a part does not match its checksum (readRaw() throws exception::ChecksumMismatch)
+    ChecksumMismatch,
+    //! Only a chunk of an envelope not complete yet, or a discarded shared memory descriptor, has been read (readRaw() waits for the next message)
+    Incomplete
+};
+
 /*!
  * \brief The Socket class
  *
@@ -55,6 +106,13 @@ public:
      */
     void log(logger::Level level, const std::string &message) const override;
 
+    /*!
+     * \brief Return false if messages of the given level would be discarded
+     *
+     * Messages are discarded also when logging from a thread not owned by the node.
+     */
+    bool isLevelEnabled(logger::Level level) const override;
+
     /*!
      * \brief Perform initialization (resolve name, connect socket, set subscription)
      */
@@ -70,6 +128,129 @@ public:
      */
     virtual void spinOnce();
 
+    /*!
+     * \brief Return true if spinOnce() consumes the incoming messages of this socket
+     *
+     * Used by b0::Node to decide which sockets to wait on in SpinMode::EventDriven mode.
+     */
+    virtual bool hasCallback() const;
+
+    /*!
+     * \brief Return true if there are messages waiting to be processed which did not arrive
+     * through the ZeroMQ socket (e.g. intra-process messages)
+     */
+    virtual bool hasPendingMessages() const;
+
+    /*!
+     * \brief Return true if the ZeroMQ socket is read by a thread of its own (see
+     * Subscriber::setPrefetch()), or written by other threads (see Publisher::setThreadSafe()),
+     * in which case b0::Node does not poll it, and relies on hasPendingMessages() instead
+     */
+    virtual bool isReadInBackground() const;
+
+    /*!
+     * \brief Return the file descriptor of the underlying ZeroMQ socket (ZMQ_FD), for external event loops
+     *
+     * It signals (as readable) the changes of getEvents(), not the incoming messages: it is
+     * edge-triggered, and its notifications are re-armed only by reading getEvents().
+     * See b0::Node::processReadySockets().
+     */
+    int64_t getFileDescriptor() const;
+
+    /*!
+     * \brief Return the events of the underlying ZeroMQ socket (ZMQ_EVENTS), a combination of ZMQ_POLLIN and ZMQ_POLLOUT
+     */
+    int getEvents() const;
+
+    /*!
+     * \brief Return the number of messages or calls waiting in a queue of this socket
+     *        (outside of ZeroMQ), reported as SocketMetrics::queue_depth
+     */
+    virtual size_t getQueueDepth() const;
+
+    /*!
+     * \brief Account the buffers allocated by this socket (default: b0::getMemoryAccounting())
+     *
+     * The buffers of the receive path (the ZeroMQ frames received, the envelopes reassembled
+     * from chunks), of the decode path (the part payloads whose storage grows, as it is reused
+     * across messages, and the decompressed payloads of envelope views) and of the send path
+     * (the ZeroMQ messages and frames written) are counted in SocketCounters, and reported in
+     * SocketMetrics. The buffers of the small ZeroMQ messages, stored in the message itself,
+     * are not counted. This only counts the requests: the buffers may come from a pool (see
+     * b0::setBufferAllocator()).
+     *
+     * Can be changed at runtime, e.g. with the `memory-accounting` command of
+     * b0::Node::handleControl().
+     */
+    void setMemoryAccounting(bool enabled);
+
+    //! Return true if the buffers allocated by this socket are accounted (see setMemoryAccounting())
+    bool getMemoryAccounting() const;
+
+    /*!
+     * \brief Set the strand of this socket
+     *
+     * When the node uses a callback executor (see b0::Node::setCallbackThreads()), the
+     * callbacks of sockets with the same (non-empty) strand are never run concurrently.
+     */
+    void setStrand(const std::string &strand);
+
+    /*!
+     * \brief Get the strand of this socket
+     */
+    const std::string & getStrand() const;
+
+    /*!
+     * \brief Set the budget of one spinOnce() of this socket
+     *
+     * spinOnce() processes at most max_messages incoming messages (0: no limit), and stops
+     * after max_time seconds spent on them (0: no limit), leaving the others for the next spin.
+     * Thus a topic arriving faster than its callback runs does not keep b0::Node::spinOnce()
+     * from the other sockets. The message budget is multiplied by the priority (see setSpinPriority()).
+     * Note that with a fixed spin rate a socket then processes at most max_messages times that
+     * rate messages per second: a time budget, or SpinMode::EventDriven, does not limit the throughput.
+     *
+     * The default is the global default (see b0::setSpinBudget()), with no time limit.
+     */
+    void setSpinBudget(int max_messages, double max_time = 0);
+
+    //! Get the maximum number of messages of one spinOnce() (see setSpinBudget())
+    int getSpinBudgetMessages() const;
+
+    //! Get the maximum time of one spinOnce(), in seconds (see setSpinBudget())
+    double getSpinBudgetTime() const;
+
+    /*!
+     * \brief Set the priority of this socket in b0::Node::spinOnce() (the default is 1)
+     *
+     * The sockets are spun by decreasing priority, and those of the same priority in turn (the
+     * first of them changes at each spin). With budgets, a socket of priority n processes up to
+     * n times its message budget, so giving control topics and services a higher priority than
+     * the bulk topics bounds their latency to one round of the budgets of the others.
+     */
+    void setSpinPriority(int priority);
+
+    //! Get the priority of this socket in b0::Node::spinOnce() (see setSpinPriority())
+    int getSpinPriority() const;
+
+    /*!
+     * \brief Put this socket in the high-priority lane, e.g. for safety-critical commands
+     *
+     * A high-priority socket is spun before all the others in b0::Node::spinOnce(), whatever
+     * their spin priority, and uses the I/O thread reserved to such sockets, if any (see
+     * b0::setPriorityIOThread()). The topic of a high-priority publisher or subscriber goes
+     * through the high-priority proxies of the resolver (see
+     * b0::resolver::Resolver::setNumPriorityProxies()), on connections of its own, so that a
+     * large message of another topic, being forwarded or in flight, does not delay it.
+     *
+     * As the proxy depends on it, all the publishers and subscribers of a topic must agree.
+     * Must be called before init().
+     */
+    void setHighPriority(bool high_priority);
+
+    //! Return true if this socket is in the high-priority lane (see setHighPriority())
+    bool isHighPriority() const;
+
     /*!
      * \brief Set the remote address the socket will connect to
      */
@@ -96,10 +277,88 @@ public:
      */
     bool matchesPattern(const std::string &pattern) const;
 
+    /*!
+     * \brief Enable or disable the dump of the payloads sent and received by this socket
+     *
+     * By default the dump is enabled if the socket matches one of the patterns in the
+     * B0_DEBUG_SOCKET env var (and is extended if B0_DEBUG_SOCKET_EXTENDED is set), which
+     * is evaluated only once, when the first payload is sent or received.
+     *
+     * This can be called from any thread, also while the socket is in use.
+     *
+     * \sa matchesPattern(), b0::Node::handleDebugSocket()
+     */
+    void setDebugDump(bool enabled, bool extended = false);
+
+    /*!
+     * \brief Return true if the dump of the payloads is enabled for this socket
+     */
+    bool getDebugDump() const;
+
+    /*!
+     * \brief Return the traffic counters of this socket
+     *
+     * The counters are updated lock-free by readRaw() and writeRaw(), and can be read
+     * from any thread.
+     */
+    SocketCounters & getCounters();
+
+    /*!
+     * \brief Return the traffic counters of this socket
+     */
+    const SocketCounters & getCounters() const;
+
+    /*!
+     * \brief Fill a snapshot of the traffic counters of this socket
+     */
+    void getMetrics(b0::message::metrics::SocketMetrics &metrics) const;
+
+    /*!
+     * \brief Monitor the connections of this socket (with zmq_socket_monitor())
+     *
+     * The connections, disconnections, reconnections, retries and failed handshakes are
+     * counted, and the time to (re)connect and to complete the handshakes are measured, in
+     * the socket counters (see getCounters()). The disconnections, reconnections and failed
+     * handshakes are logged at debug level, or as warnings if warnings is true.
+     *
+     * The default is the global default (see b0::setConnectionMonitor() and
+     * b0::setConnectionMonitorWarnings()). Must be called before init().
+     */
+    void setConnectionMonitor(bool enabled, bool warnings = false);
+
+    //! Return true if the connections of this socket are monitored (see setConnectionMonitor())
+    bool getConnectionMonitor() const;
+
+    /*!
+     * \brief Process the pending events of the connection monitor, if enabled
+     *
+     * Called by b0::Node::spinOnce(); must be called from the thread using the socket.
+     */
+    void pollConnectionEvents();
+
 private:
+    //! Account an event of the connection monitor
+    void connectionEvent(int event, const std::string &endpoint);
+
+    /*!
+     * \brief Return the debug dump mode (0: off, 1: on, 2: extended), evaluating B0_DEBUG_SOCKET the first time
+     */
+    int debugDumpMode() const;
+
+    //! Dump the payload frames of an envelope received as a multipart message, and return the size of all its frames
+    size_t dumpFrames(boost::string_ref headers, const std::vector<boost::string_ref> &payloads) const;
+
+    //! Write the frames of an envelope as one multipart message (see setMultipartFraming())
+    void writeFrames(std::vector<zmq::message_t> &frames, size_t payload_bytes);
+
     std::unique_ptr<Private> private_;
 
 protected:
+    /*!
+     * \brief Dump a payload to stdout, if enabled (see setDebugDump())
+     */
+    void dumpPayload(const char *op, const char *payload, size_t size) const;
+
     //! The Node owning this Socket
     Node &node_;
 
@@ -115,12 +374,99 @@ protected:
     //! The address of the ZeroMQ socket to connect to (will skip name resolution if given)
     std::string remote_addr_;
 
+    //! Strand of this socket
+    //! \sa Socket::setStrand()
+    std::string strand_;
+
+    //! Start the budget of a spinOnce() (see setSpinBudget())
+    void startSpinBudget();
+
+    //! Count one more message of the current spinOnce(), and return false if the budget is spent
+    bool spinBudgetLeft();
+
+    //! Log a message dropped by a dispatch loop because tryReadRaw() failed with the given status
+    void readFailed(ReadStatus status, const std::string &error);
+
+    //! Reason of the last failed tryReadRaw() of a dispatch loop (reused, to not allocate per message)
+    std::string read_error_;
+
+private:
+    //! Maximum number of messages of one spinOnce(), or 0
+    //! \sa Socket::setSpinBudget()
+    int spin_budget_messages_{0};
+
+    //! Maximum time of one spinOnce(), in microseconds, or 0
+    //! \sa Socket::setSpinBudget()
+    int64_t spin_budget_usec_{0};
+
+    //! Priority of this socket
+    //! \sa Socket::setSpinPriority()
+    int spin_priority_{1};
+
+    //! True if this socket is in the high-priority lane
+    //! \sa Socket::setHighPriority()
+    bool high_priority_{false};
+
+    //! Number of messages processed by the current spinOnce()
+    int spin_count_{0};
+
+    //! Start of the current spinOnce(), if it has a time budget
+    int64_t spin_deadline_{0};
+
 public:
     /*!
      * \brief Read a MessageEnvelope from the underlying ZeroMQ socket
      */
     virtual void readRaw(b0::message::MessageEnvelope &env);
 
+    /*!
+     * \brief Read a MessageEnvelopeView from the underlying ZeroMQ socket
+     *
+     * The parts of the envelope reference the received ZeroMQ message, which is kept
+     * alive by the envelope itself, thus avoiding any copy of the payloads.
+     */
+    virtual void readRaw(b0::message::MessageEnvelopeView &env);
+
+    /*!
+     * \brief Read a MessageEnvelopeView, parsing its parts only if the filter accepts its headers
+     *
+     * Return false if the envelope was rejected (see b0::message::parse()).
+     */
+    bool readRaw(b0::message::MessageEnvelopeView &env, const b0::message::HeaderFilter &filter);
+
+    /*!
+     * \brief Read a MessageEnvelope, returning a status instead of throwing
+     *
+     * The readRaw() methods are wrappers throwing the exception matching the status. On
+     * failure, error is set (if given) to the header0 of the envelope for
+     * ReadStatus::HeaderMismatch, to the algorithm for ReadStatus::UnsupportedCompression,
+     * and to the reason for ReadStatus::DecompressError (see b0::message::tryParse()).
+     *
+     * The dispatch loops of spinOnce() use this, and drop the messages which cannot be read,
+     * which are counted in SocketCounters::read_errors.
+     *
+     * Only the frame available is read: after a chunk of a bigger envelope (see
+     * setChunkSize()) this returns ReadStatus::Incomplete, and the envelope is returned by
+     * the call reading its last chunk, so a lost chunk does not block the caller. So does a
+     * shared memory descriptor from another host, or of an envelope overwritten already.
+     */
+    ReadStatus tryReadRaw(b0::message::MessageEnvelope &env, std::string *error = nullptr);
+
+    /*!
+     * \brief Read a MessageEnvelopeView, returning a status instead of throwing (see above)
+     */
+    ReadStatus tryReadRaw(b0::message::MessageEnvelopeView &env, const b0::message::HeaderFilter &filter = b0::message::HeaderFilter(), std::string *error = nullptr);
+
+    /*!
+     * \brief Read the next message as a serialized envelope, without parsing nor decompressing it
+     *
+     * The chunked messages are reassembled, and the envelopes sent through shared memory are
+     * read in place. The returned bytes, starting with the header0 line, stay valid while
+     * buffer is kept (it is reused by the next call). They can be written as they are to
+     * another socket with writeWire().
+     */
+    boost::string_ref readWire(std::shared_ptr<const void> &buffer);
+
     /*!
      * \brief Read a raw multipart payload from the underlying ZeroMQ socket
      */
@@ -174,22 +520,77 @@ public:
      */
     virtual void writeRaw(const std::vector<b0::message::MessagePart> &parts);
 
+    /*!
+     * \brief Write a raw multipart payload to the underlying ZeroMQ socket
+     *
+     * The parts are moved into the outgoing envelope, which avoids copying their payloads.
+     */
+    virtual void writeRaw(std::vector<b0::message::MessagePart> &&parts);
+
     /*!
      * \brief Write a raw payload to the underlying ZeroMQ socket
      */
     virtual void writeRaw(const std::string &msg, const std::string &type = "");
 
+    /*!
+     * \brief Write a raw payload to the underlying ZeroMQ socket
+     *
+     * The payload buffer is moved into the outgoing envelope, which avoids copying it.
+     */
+    virtual void writeRaw(std::string &&msg, const std::string &type = "");
+
+    /*!
+     * \brief Write a serialized envelope (e.g. as returned by readWire()) as it is
+     *
+     * It is split in chunks if larger than the chunk size (see setChunkSize()). Nothing is
+     * added to it (no stamping, nor intra-process or shared-memory delivery).
+     */
+    void writeWire(const char *data, size_t size);
+
+    /*!
+     * \brief Write a serialized envelope, replacing its header0 line (see writeWire())
+     *
+     * Only the routing line changes: the headers and the (possibly compressed) parts are
+     * copied as they are, without being parsed.
+     */
+    void writeWire(const char *data, size_t size, const std::string &header0);
+
+    /*!
+     * \brief Write a serialized envelope held in a shared buffer, without copying it (see writeWire())
+     *
+     * The buffer is referenced by the outgoing ZeroMQ message until it has been sent.
+     */
+    void writeWire(const std::shared_ptr<const std::string> &wire);
+
     /*!
      * \brief Write a Message to the underlying ZeroMQ socket
+     *
+     * The message is encoded directly into the buffer of the outgoing ZeroMQ message, after
+     * some space left for the envelope headers (see writeFrame()).
      */
     template<class TMsg>
     void writeMsg(const TMsg &msg)
     {
-        std::string str, type;
-        serialize(msg, str, type);
-        writeRaw(str, type);
+        size_t header_space;
+        std::unique_ptr<std::string> frame = newFrame(header_space);
+        std::string type;
+        serializeAppend(msg, *frame, type, message_codec_);
+        writeFrame(std::move(frame), header_space, type);
     }
 
+    //! Allocate a buffer for writeFrame(), with the space to leave for the envelope headers
+    std::unique_ptr<std::string> newFrame(size_t &header_space);
+
+    /*!
+     * \brief Write a payload encoded after some space left for the envelope headers
+     *
+     * The first header_space bytes of frame are free, and are followed by the payload.
+     * If the envelope headers fit in that space, and the payload is not to be compressed,
+     * the headers are written just before the payload, and the buffer is handed over to
+     * ZeroMQ: the payload is sent without being copied. Otherwise it is sent as with writeRaw().
+     */
+    void writeFrame(std::unique_ptr<std::string> frame, size_t header_space, const std::string &type);
+
     /*!
      * \brief Write a (multipart) Message to the underlying ZeroMQ socket
      */
@@ -198,13 +599,57 @@ public:
     {
         std::vector<b0::message::MessagePart> parts1(parts);
         b0::message::MessagePart part0;
-        serialize(msg, part0.payload, part0.content_type);
-        part0.compression_algorithm = compression_algorithm_;
-        part0.compression_level = compression_level_;
-        parts1.insert(parts1.begin(), part0);
-        writeRaw(parts1);
+        serialize(msg, part0.payload, part0.content_type, message_codec_);
+        setPartCompression(part0);
+        parts1.insert(parts1.begin(), std::move(part0));
+        writeRaw(std::move(parts1));
     }
 
+protected:
+    /*!
+     * \brief Called on the envelopes built by this socket, just before they are written
+     *
+     * Subclasses can override this to add headers to the outgoing envelopes (e.g. the
+     * Publisher adds the Send-time and Seq headers). The default implementation does nothing.
+     */
+    virtual void prepareEnvelope(b0::message::MessageEnvelope &env);
+
+    /*!
+     * \brief Return true if writeFrame() can write directly into the frame a payload of the given size
+     *
+     * Otherwise writeFrame() builds the envelope and writes it with writeRaw(), which
+     * subclasses override (e.g. the Publisher, which also delivers it intra-process).
+     */
+    virtual bool canWriteFrameInPlace(size_t payload_size) const;
+
+    /*!
+     * \brief Return true if a received envelope with the given header0 is for this socket
+     *
+     * Otherwise readRaw() throws exception::HeaderMismatch (and tryReadRaw() returns
+     * ReadStatus::HeaderMismatch). The default implementation
+     * accepts only the name of the socket (e.g. b0::MultiSubscriber accepts several topics).
+     */
+    virtual bool acceptsHeader0(const std::string &header0) const;
+
+    /*!
+     * \brief Write a frame which is not a serialized envelope (e.g. a shared-memory descriptor) as it is
+     *
+     * The frame must start with the header0 line of the envelope it stands for, and
+     * payload_bytes is the size of the payloads of that envelope, for the socket counters.
+     */
+    void writeControlFrame(const std::string &frame, size_t payload_bytes);
+
+    /*!
+     * \brief Get the routing frames of the last request read by a ROUTER socket
+     *
+     * The reply is sent back with the routing frames of the last request read, so a
+     * server writing the replies in a different order saves them with each request,
+     * and restores them with setRoute() before writing its reply.
+     */
+    void getRoute(std::vector<std::string> &route) const;
+
+    //! Set the routing frames the next message of a ROUTER socket is sent with (see getRoute())
+    void setRoute(const std::vector<std::string> &route);
 
 public:
     /*!
@@ -213,10 +658,62 @@ public:
      * The messages sent with this socket will be compressed using the specified algorithm.
      * This has no effect on received messages, which will be automatically decompressed
      * using the algorithm specified in the message envelope.
+     *
+     * If dictionary is given, payloads are compressed with the compression dictionary
+     * with that id (only supported by the "zstd" algorithm). The dictionary is looked up
+     * in the dictionaries registered in this process, or fetched from the resolver (see
+     * b0::compress::getDictionary()), and its id is sent in the envelope so that the
+     * receivers can do the same.
+     *
+     * For raw images, the lossless image codecs "qoi-rgb", "qoi-rgba" and "depth16/<width>"
+     * compress much better than the general purpose algorithms (see b0::compress::isImageAlgorithm()).
      */
-    void setCompression(const std::string &algorithm, int level = -1);
+    void setCompression(const std::string &algorithm, int level = -1, const std::string &dictionary = "");
+
+    /*!
+     * \brief Enable or disable adaptive compression
+     *
+     * With adaptive compression, the algorithm set with setCompression() is applied only to
+     * payloads of at least min_size bytes, and is suspended while the measured compression
+     * ratio (compressed size / uncompressed size, averaged over the recent messages) is above
+     * max_ratio, e.g. for already compressed images. While suspended, one message out of
+     * probe_interval is compressed again to measure the ratio.
+     *
+     * This applies to the payloads encoded by this socket (writeRaw() of a single payload,
+     * writeMsg()). The decisions are reported in the socket counters (see getCounters()).
+     */
+    void setAdaptiveCompression(bool enabled, size_t min_size = 256, double max_ratio = 0.9, int probe_interval = 100);
+
+    //! Return true if adaptive compression is enabled (see setAdaptiveCompression())
+    bool getAdaptiveCompression() const;
+
+protected:
+    //! Set the compression of a part encoded by this socket, making the adaptive compression decision
+    void setPartCompression(b0::message::MessagePart &part);
 
 private:
+    //! Update the measured compression ratio after a message has been serialized
+    void updateCompressionRatio(const b0::message::MessageEnvelope &env, const std::vector<size_t> &content_lengths);
+
+    //! If true, compression is adaptive
+    //! \sa Socket::setAdaptiveCompression()
+    bool adaptive_compression_{false};
+
+    //! Payloads smaller than this are never compressed, in adaptive mode
+    size_t adaptive_min_size_{256};
+
+    //! Compression is suspended while the measured ratio is above this, in adaptive mode
+    double adaptive_max_ratio_{0.9};
+
+    //! While compression is suspended, one message out of this many is compressed, in adaptive mode
+    int adaptive_probe_interval_{100};
+
+    //! Number of messages left before the next probe, in adaptive mode
+    int adaptive_probe_countdown_{0};
+
+    //! Measured compression ratio (moving average), or a negative value if not measured yet
+    double adaptive_ratio_{-1};
+
     //! If set, payloads will be encoded using the specified compression algorithm
     //! \sa WriteSocket::setCompression()
     std::string compression_algorithm_;
@@ -225,6 +722,128 @@ private:
     //! \sa WriteSocket::setCompression()
     int compression_level_;
 
+    //! If a compression algorithm is set, payloads will be encoded using the compression dictionary with this id
+    //! \sa WriteSocket::setCompression()
+    std::string compression_dictionary_;
+
+public:
+    /*!
+     * \brief Set the wire format of the message envelopes sent with this socket
+     *
+     * The default is b0::message::EnvelopeFormat::Text, unless the B0_ENVELOPE_FORMAT
+     * environment variable is set to "binary" (or "binary_ids" for
+     * b0::message::EnvelopeFormat::BinaryIds).
+     * Received messages are always decoded regardless of their format.
+     */
+    void setEnvelopeFormat(b0::message::EnvelopeFormat format);
+
+    //! Get the wire format of the message envelopes sent with this socket
+    b0::message::EnvelopeFormat getEnvelopeFormat() const;
+
+private:
+    //! Wire format of sent message envelopes
+    //! \sa Socket::setEnvelopeFormat()
+    b0::message::EnvelopeFormat envelope_format_;
+
+public:
+    /*!
+     * \brief Set the encoding of the messages sent with this socket
+     *
+     * The default is b0::message::MessageCodec::JSON, unless the B0_MESSAGE_CODEC
+     * environment variable is set to "msgpack".
+     * Received messages are always decoded regardless of their encoding.
+     */
+    void setMessageCodec(b0::message::MessageCodec codec);
+
+    //! Get the encoding of the messages sent with this socket
+    b0::message::MessageCodec getMessageCodec() const;
+
+private:
+    //! Encoding of sent messages
+    //! \sa Socket::setMessageCodec()
+    b0::message::MessageCodec message_codec_;
+
+public:
+    /*!
+     * \brief Set the maximum size of the ZeroMQ messages sent by this socket
+     *
+     * Serialized envelopes bigger than this are sent as several chunks of at most this size
+     * (see b0::message::MessageChunk), so that the messages of other publishers are not
+     * held up behind a large transfer, e.g. in the resolver's proxy. Chunks are reassembled
+     * on reading, by any socket.
+     *
+     * Only publishers split envelopes, since a service request or reply must be a single
+     * ZeroMQ message. A size of 0 (the default, unless the B0_CHUNK_SIZE environment variable
+     * is set) disables chunking.
+     */
+    void setChunkSize(size_t size);
+
+    //! Get the maximum size of the ZeroMQ messages sent by this socket (see setChunkSize())
+    size_t getChunkSize() const;
+
+    /*!
+     * \brief Set the maximum memory used for reassembling the chunked envelopes received by this socket
+     *
+     * Envelopes bigger than this are discarded, and so are the oldest envelopes being reassembled
+     * when a new one does not fit. The default is 512 MiB, unless the B0_MAX_REASSEMBLY_SIZE
+     * environment variable is set.
+     */
+    void setMaxReassemblySize(size_t size);
+
+    //! Get the maximum memory used for reassembling chunked envelopes (see setMaxReassemblySize())
+    size_t getMaxReassemblySize() const;
+
+private:
+    //! Maximum size of the sent ZeroMQ messages, or 0
+    //! \sa Socket::setChunkSize()
+    size_t chunk_size_{0};
+
+public:
+    /*!
+     * \brief Send the headers and each part of the envelopes as separate frames of a ZeroMQ multipart message
+     *
+     * The payload of each part is then sent from its own buffer: the payload encoded by
+     * writeMsg() and the one moved into writeRaw() are handed over to ZeroMQ without being
+     * copied, if not compressed. On the receiving side, the parts of a MessageEnvelopeView point
+     * into the received frames. The headers are the same as in the single frame, so the frames
+     * put one after the other are the envelope serialized as usual (which is what readWire() returns).
+     *
+     * The default is false, unless the B0_MULTIPART_FRAMING environment variable is set.
+     * Multipart envelopes are never split into chunks (see setChunkSize()), and cannot be used
+     * with setConflate(). Received messages are decoded in both framings, but the receivers
+     * must be of a version which knows multipart framing.
+     */
+    void setMultipartFraming(bool enabled);
+
+    //! Return true if envelopes are sent as multipart messages (see setMultipartFraming())
+    bool getMultipartFraming() const;
+
+private:
+    //! If true, the headers and the parts of the envelopes are sent as separate frames
+    //! \sa Socket::setMultipartFraming()
+    bool multipart_framing_{false};
+
+public:
+    /*!
+     * \brief Add a CRC-32C checksum of each part to the envelopes sent with this socket
+     *
+     * The receivers drop the messages whose payload does not match (see
+     * b0::message::ParseStatus::ChecksumMismatch), which catches the corruptions the
+     * transport does not, e.g. in the memory of a proxy or of a shared-memory segment. The
+     * checksums use the CRC32 instructions of the CPU when available (see b0::crc32c()).
+     * Received checksums are always verified, whatever this setting.
+     *
+     * The default is false, unless the B0_CHECKSUM environment variable is set.
+     */
+    void setChecksum(bool enabled);
+
+    //! Return true if the envelopes sent have a checksum per part (see setChecksum())
+    bool getChecksum() const;
+
+private:
+    //! \sa Socket::setChecksum()
+    bool checksum_{false};
+
 public:
     //! (low-level socket option) Get read timeout (in milliseconds, -1 for no timeout)
     int getReadTimeout() const;
@@ -259,7 +878,7 @@ public:
     //! (low-level socket option) Get conflate flag
     bool getConflate() const;
 
-    //! (low-level socket option) Set conflate flag
+    //! (low-level socket option) Set conflate flag (not for multipart or chunked messages; see Subscriber::setKeepLatest())
     void setConflate(bool conflate);
 
     //! (low-level socket option) Get read high-water-mark
@@ -274,6 +893,29 @@ public:
     //! (low-level socket option) Set write high-water-mark
     void setWriteHWM(int n);
 
+    //! (low-level socket option) Get I/O thread affinity (bitmask of the context's I/O threads, 0 for any)
+    uint64_t getAffinity() const;
+
+    //! (low-level socket option) Set I/O thread affinity (bitmask of the context's I/O threads, 0 for any), effective for subsequent connect/bind
+    void setAffinity(uint64_t affinity);
+
+    /*!
+     * \brief Apply a named bundle of socket options (see b0::SocketProfile)
+     *
+     * By default a socket gets the profile of the first pattern it matches (see
+     * b0::addSocketProfilePattern()), if any. Like the other low-level options, it is
+     * effective for subsequent connect/bind, and the options set afterwards win.
+     *
+     * Throw exception::ArgumentError if there is no such profile.
+     */
+    void setProfile(const std::string &name);
+
+    //! Return the name of the profile applied to this socket, or an empty string (see setProfile())
+    std::string getProfile() const;
+
+    //! Apply the options of a profile which has no name (see setProfile())
+    void applyProfile(const SocketProfile &profile);
+
 protected:
     //! Wrapper to zmq::socket_t::connect
     void connect(const std::string &addr);
@@ -287,6 +929,69 @@ protected:
     //! Wrapper to zmq::socket_t::unbind
     void unbind(const std::string &addr);
 
+    /*!
+     * \brief Bind to an ephemeral TCP port chosen by the system, and return it
+     *
+     * The port is read back from ZMQ_LAST_ENDPOINT, so there is no window in which another
+     * socket could take it (unlike binding to a port from b0::Node::freeTCPPort()).
+     */
+    int bindEphemeralPort();
+
+    /*!
+     * \brief Also bind the IPC endpoint of a TCP port bound by this socket (see b0::Node::ipcAddress())
+     *
+     * \return the endpoint, or an empty string if IPC is disabled or it could not be bound
+     */
+    std::string bindIPC(int port);
+
+    //! Return true if addr is a multicast (PGM) endpoint, e.g. "epgm://eth0;239.192.1.1:5555"
+    static bool isMulticastAddress(const std::string &addr);
+
+    /*!
+     * \brief Replace the underlying ZeroMQ socket with one of another type (before init())
+     *
+     * The linger period, high-water marks and timeouts already set are carried over.
+     */
+    void setSocketType(int type);
+
+    /*!
+     * \brief Exchange the underlying ZeroMQ socket with another one of the same type
+     *
+     * The other socket, created in the context of the node, keeps its connections (e.g. one
+     * kept connected by the pool of b0::setServiceClientPool()). The linger period, high-water
+     * marks and timeouts of this socket are carried over to it.
+     */
+    void swapZMQSocket(zmq::socket_t &socket);
+
+    /*!
+     * \brief Drop and count the messages which cannot be queued (see SocketCounters::messages_dropped)
+     *
+     * Otherwise, a write which times out (see setWriteTimeout()) throws exception::SocketWriteError.
+     */
+    void setCountWriteDrops(bool enabled);
+
+    //! Return true if the last message written was dropped (see setCountWriteDrops())
+    bool getLastWriteDropped() const;
+
+    /*!
+     * \brief Keep the messages which ZeroMQ cannot queue in a queue of at most max_bytes (0 to disable)
+     *
+     * Only for PUB and XPUB sockets, with ZMQ_XPUB_NODROP so that a full queue of a subscriber
+     * fails the write. The messages wait, in order, until flushWriteQueue() or the next write
+     * can hand them over to ZeroMQ. When the queue is full, its oldest messages are dropped
+     * (see SocketCounters::messages_dropped); the message being written is always kept.
+     */
+    void setWriteQueueLimit(size_t max_bytes);
+
+    //! Return the maximum size of the write queue (see setWriteQueueLimit())
+    size_t getWriteQueueLimit() const;
+
+    //! Return the size of the frames waiting in the write queue (see setWriteQueueLimit())
+    size_t getWriteQueueBytes() const;
+
+    //! Write the frames of the write queue which ZeroMQ accepts; return true if it is empty
+    bool flushWriteQueue();
+
     //! Wrapper to zmq::socket_t::setsockopt
     void setsockopt(int option, const void *optval, size_t optvallen);
 
@@ -298,6 +1003,12 @@ protected:
 
     //! High level wrapper for getsockopt
     int getIntOption(int option) const;
+
+    //! Return the handle of the underlying ZeroMQ socket (as used by zmq_poll)
+    void * getZMQSocket() const;
+
+public:
+    friend class Node;
 };
 
 } // namespace b0
@@ -0,0 +1,155 @@
+#ifndef B0__SPINNER_H__INCLUDED
+#define B0__SPINNER_H__INCLUDED
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+class Node;
+
+/*!
+ * \brief Spins a set of nodes of the process from a pool of threads
+ *
+ * Instead of one thread per node calling b0::Node::spin(), or hand-written round robin
+ * calls of b0::Node::spinOnce(), the sockets of all the nodes are polled with a single call,
+ * and the nodes which have incoming messages, timers due (see b0::Node::createTimer()), or
+ * whose spin period (see b0::Node::getSpinRate()) has elapsed, are spun by the threads of
+ * the pool. The number of busy threads then follows the load, not the number of nodes.
+ *
+ * A node is spun by one thread at a time, so its callbacks need no more synchronization
+ * than with b0::Node::spin(); callbacks of different nodes run concurrently (unless there
+ * is only one thread). The nodes must be initialized before spin(), and must not be used
+ * from other threads while the spinner runs, except for their thread-safe methods
+ * (e.g. b0::Node::shutdown()). A node whose shutdown is requested is not spun anymore.
+ *
+ * Example:
+ *
+ * \code
+ * b0::Spinner spinner(2);
+ * spinner.addNode(&node1);
+ * spinner.addNode(&node2);
+ * spinner.spin();
+ * \endcode
+ */
+class Spinner
+{
+public:
+    /*!
+     * \brief Construct a spinner with a pool of num_threads threads
+     *
+     * With one thread, the nodes are spun by the thread which calls spin(), as it polls them.
+     */
+    Spinner(int num_threads = 1);
+
+    /*!
+     * \brief Destruct the spinner, stopping it if it is running
+     */
+    ~Spinner();
+
+    /*!
+     * \brief Add a node to spin (before spin())
+     */
+    void addNode(Node *node);
+
+    /*!
+     * \brief Set the number of threads of the pool (before spin())
+     */
+    void setNumThreads(int num_threads);
+
+    /*!
+     * \brief Get the number of threads of the pool
+     */
+    int getNumThreads() const;
+
+    /*!
+     * \brief Spin the nodes until all of them are shut down, or stop() is called
+     *
+     * The calling thread polls the sockets. An exception thrown by the spinOnce() of a node
+     * stops the spinner, and is rethrown.
+     */
+    void spin();
+
+    /*!
+     * \brief Make spin() return, after the nodes being spun are done
+     *
+     * This method is thread-safe.
+     */
+    void stop();
+
+protected:
+    //! \cond HIDDEN_SYMBOLS
+
+    struct NodeEntry
+    {
+        Node *node;
+
+        //! Spin period of the node, in microseconds
+        int64_t period;
+
+        //! Time of the next periodic spin, in hardware time
+        int64_t next_spin;
+
+        //! True while queued or being spun by a thread of the pool
+        bool busy;
+    };
+
+    //! \endcond
+
+    //! Spin a node, and schedule its next periodic spin
+    void spinNode(NodeEntry &entry);
+
+    //! Loop of the threads of the pool
+    void workerLoop();
+
+    //! Wake up the polling thread
+    void wakeUp();
+
+private:
+    //! The nodes to spin
+    std::vector<NodeEntry> nodes_;
+
+    //! Number of threads of the pool
+    int num_threads_;
+
+    //! Set by stop()
+    std::atomic<bool> stop_{false};
+
+    //! The threads of the pool (none with one thread)
+    std::vector<boost::thread> threads_;
+
+    //! Protects queue_, the busy flags of nodes_, error_ and the socket of wakeUp()
+    boost::mutex mutex_;
+
+    //! Signaled when a node is queued, or the threads are to stop
+    boost::condition_variable cond_;
+
+    //! The nodes waiting for a thread of the pool
+    std::deque<NodeEntry*> queue_;
+
+    //! The first exception thrown by a spin
+    std::exception_ptr error_;
+
+    //! \cond HIDDEN_SYMBOLS
+
+    struct Private;
+
+    //! \endcond
+
+    //! The channel waking up the polling thread when a node is done
+    std::unique_ptr<Private> private_;
+};
+
+} // namespace b0
+
+#endif // B0__SPINNER_H__INCLUDED
@@ -1,14 +1,25 @@
 #ifndef B0__SUBSCRIBER_H__INCLUDED
 #define B0__SUBSCRIBER_H__INCLUDED
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
 
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 #include <b0/b0.h>
 #include <b0/socket.h>
 #include <b0/message/message_part.h>
+#include <b0/utils/decimator.h>
 
 namespace b0
 {
@@ -21,11 +32,9 @@ class Node;
  * This class wraps a SUB socket. It will automatically connect to the
  * XPUB socket of the proxy (note: the proxy is started by the resolver node).
  *
- * In order to receive some message, you must set a topic subscription with Subscriber::subscribe.
- * You can set multiple subscription, and the incoming messages will match any of those.
- *
- * The subscription topics are strings and are matched on a prefix basis.
- * (i.e. if the topic of the incoming message is "AAA", a subscription for "A" will match it)
+ * The topic is matched exactly: the subscription includes the newline terminating the
+ * header0 line of the envelope, so that a subscriber of "A" does not receive (and does not
+ * have to download and parse) the messages of topic "AAA".
  *
  * \sa b0::Publisher, b0::Subscriber
  */
@@ -46,6 +55,12 @@ public:
     //! \brief Alias for callback raw message parts
     using CallbackParts = function<void(const std::vector<b0::message::MessagePart>&)>;
 
+    //! \brief Alias for callback raw message part views (zero-copy)
+    using CallbackPartsView = function<void(const std::vector<b0::message::MessagePartView>&)>;
+
+    //! \brief Alias for callback of a batch of raw multipart messages (see setCallbackBatchSize())
+    using CallbackPartsBatch = function<void(const std::vector<std::vector<b0::message::MessagePart> >&)>;
+
     //! \brief Alias for callback message class
     template<class TMsg> using CallbackMsg = function<void(const TMsg&)>;
 
@@ -72,6 +87,23 @@ public:
      */
     Subscriber(Node *node, const std::string &topic_name, CallbackParts callback, bool managed = true, bool notify_graph = true);
 
+    /*!
+     * \brief Construct an Subscriber child of the specified Node, using a function as callback (raw message part views)
+     *
+     * The views passed to the callback reference the received message buffer, and are valid
+     * only for the duration of the callback.
+     */
+    Subscriber(Node *node, const std::string &topic_name, CallbackPartsView callback, bool managed = true, bool notify_graph = true);
+
+    /*!
+     * \brief Construct an Subscriber child of the specified Node, using a function as callback (batch of raw multipart messages)
+     *
+     * The callback receives the messages dispatched by one spinOnce(), in order, at most
+     * getCallbackBatchSize() at a time (see setCallbackBatchSize()), so that the per-message
+     * costs of the callback (locking, queuing, ...) are paid once per batch.
+     */
+    Subscriber(Node *node, const std::string &topic_name, CallbackPartsBatch callback, bool managed = true, bool notify_graph = true);
+
     /*!
      * \brief Construct an Subscriber child of the specified Node, using a function as callback (message class)
      */
@@ -99,6 +131,16 @@ public:
      */
     Subscriber(Node *node, const std::string &topic_name, void (*callback)(const std::vector<b0::message::MessagePart>&), bool managed = true, bool notify_graph = true);
 
+    /*!
+     * \brief Construct an Subscriber child of the specified Node, using a function ptr as callback (raw message part views)
+     */
+    Subscriber(Node *node, const std::string &topic_name, void (*callback)(const std::vector<b0::message::MessagePartView>&), bool managed = true, bool notify_graph = true);
+
+    /*!
+     * \brief Construct an Subscriber child of the specified Node, using a function ptr as callback (batch of raw multipart messages)
+     */
+    Subscriber(Node *node, const std::string &topic_name, void (*callback)(const std::vector<std::vector<b0::message::MessagePart> >&), bool managed = true, bool notify_graph = true);
+
     /*!
      * \brief Construct an Subscriber child of the specified Node, using a function ptr as callback (message class)
      */
@@ -129,6 +171,18 @@ public:
     template<class T>
     Subscriber(Node *node, const std::string &topic_name, void (T::*callback)(const std::vector<b0::message::MessagePart>&), T *obj, bool managed = true, bool notify_graph = true);
 
+    /*!
+     * \brief Construct an Subscriber child of the specified Node, using a method ptr as callback (raw message part views)
+     */
+    template<class T>
+    Subscriber(Node *node, const std::string &topic_name, void (T::*callback)(const std::vector<b0::message::MessagePartView>&), T *obj, bool managed = true, bool notify_graph = true);
+
+    /*!
+     * \brief Construct an Subscriber child of the specified Node, using a method ptr as callback (batch of raw multipart messages)
+     */
+    template<class T>
+    Subscriber(Node *node, const std::string &topic_name, void (T::*callback)(const std::vector<std::vector<b0::message::MessagePart> >&), T *obj, bool managed = true, bool notify_graph = true);
+
     /*!
      * \brief Construct an Subscriber child of the specified Node, using a method ptr as callback (message class)
      */
@@ -166,12 +220,348 @@ public:
      */
     virtual void spinOnce() override;
 
+    /*!
+     * \brief Return true if a callback has been set
+     */
+    virtual bool hasCallback() const override;
+
+    /*!
+     * \brief Return true if there are intra-process messages waiting to be processed,
+     *        or if the publishers of the topic must be resolved again (peer-to-peer mode, multicast)
+     */
+    virtual bool hasPendingMessages() const override;
+
+    /*!
+     * \brief Return true if the socket is read by the thread of the subscriber (see setPrefetch())
+     */
+    virtual bool isReadInBackground() const override;
+
+    /*!
+     * \brief Return the number of intra-process and buffered messages waiting to be dispatched
+     */
+    virtual size_t getQueueDepth() const override;
+
     /*!
      * \brief Return the name of this subscriber's topic
      */
     std::string getTopicName();
 
+    /*!
+     * \brief Dispatch only the newest messages (0 to dispatch all, the default)
+     *
+     * If count is not 0, spinOnce() reads all the messages waiting in the socket first, and
+     * calls the callback only for the last count of them; the others are discarded (see
+     * Statistics::discarded). A slow callback then always gets the most recent data instead
+     * of falling behind.
+     *
+     * Unlike setConflate() (ZMQ_CONFLATE), this works with any message: multipart, chunked
+     * (see b0::Socket::setChunkSize()) or compressed. It only applies to the messages
+     * dispatched by spinOnce(), not to the ones read with readRaw() or readMsg().
+     */
+    void setKeepLatest(size_t count);
+
+    //! Return the number of newest messages dispatched by spinOnce() (see setKeepLatest())
+    size_t getKeepLatest() const;
+
+    /*!
+     * \brief Bound the size of the messages buffered ahead of the callbacks (0 for no bound, the default)
+     *
+     * If not 0, spinOnce() drains the socket into a buffer before each callback, and discards
+     * the oldest messages of the buffer (see Statistics::discarded) while their payloads total
+     * more than max_bytes; the newest message is always kept. The messages thus do not pile up
+     * in the queue of the socket, which is bounded in messages (see setReadHWM()), and the
+     * memory of a subscriber of both small and large messages stays bounded in bytes during a burst.
+     *
+     * It can be combined with setKeepLatest(), and applies to the same messages. A spinOnce()
+     * dispatches at most the messages buffered when it starts, so that it returns under load.
+     */
+    void setBufferLimit(size_t max_bytes);
+
+    //! Return the bound of the size of the messages buffered ahead of the callbacks (see setBufferLimit())
+    size_t getBufferLimit() const;
+
+    /*!
+     * \brief Also receive from the multicast publishers of the topic (must be called before init())
+     *
+     * If enabled, the subscriber asks the resolver for the multicast groups announced by the
+     * publishers of the topic (see b0::Publisher::setMulticast()), at init() and then every
+     * two seconds, and joins them; the other publishers are still received as usual.
+     *
+     * The default is disabled, unless the B0_SUBSCRIBER_MULTICAST environment variable is set.
+     */
+    void setMulticast(bool enabled);
+
+    //! Return true if the multicast publishers of the topic are received (see setMulticast())
+    bool getMulticast() const;
+
+    /*!
+     * \brief Receive at most max_rate messages of the topic per second (0 for no limit, the default; must be called before init())
+     *
+     * The messages beyond the rate are dropped by the proxy of the resolver before being sent
+     * to this subscriber (see b0::Decimator), so that a low-rate consumer of a high-rate topic
+     * wastes neither network nor CPU. The messages forwarded are at least 1/max_rate seconds
+     * apart. If the subscriber does not receive only from the proxy (peer-to-peer, multicast or
+     * decentralized mode, or a remote address set), they are dropped by spinOnce() instead, as
+     * by the header filter (see Statistics::filtered).
+     *
+     * The default is taken from the B0_SUBSCRIBER_MAX_RATE environment variable, if set.
+     */
+    void setMaxRate(double max_rate);
+
+    //! Return the maximum rate of the messages received, in Hz (see setMaxRate())
+    double getMaxRate() const;
+
+    /*!
+     * \brief Receive only one message of the topic out of every (0 or 1 for all, the default; must be called before init())
+     *
+     * The messages are dropped as for setMaxRate(), with which it can be combined (the rate
+     * then applies to the messages left by the decimation).
+     */
+    void setDecimation(unsigned every);
+
+    //! Return the decimation factor of the messages received (see setDecimation())
+    unsigned getDecimation() const;
+
+    /*!
+     * \brief Receive only some parts of the multipart messages (empty for all, the default; must be called before init())
+     *
+     * Each element of parts is either the index of a part (e.g. "0") or a content type; the
+     * callbacks get the parts selected, in their original order. The other parts are removed
+     * by the proxy of the resolver before the message is sent (see b0::Decimator), so that e.g.
+     * a consumer of the metadata part does not receive the large payload parts. As for
+     * setMaxRate(), if the subscriber does not receive only from the proxy, the parts are
+     * removed by spinOnce() instead. The parts of a batch (see b0::Publisher::publishBatch())
+     * are messages on their own, and are all kept.
+     */
+    void setParts(const std::vector<std::string> &parts);
+
+    //! Return the parts of the messages received (see setParts())
+    std::vector<std::string> getParts() const;
+
+    /*!
+     * \brief Connect only when the topic has a publisher (must be called before init())
+     *
+     * A lazy subscriber does not connect in init(): the node follows the graph of the network
+     * (see b0::message::graph::GraphDelta) and connects it from spinOnce() when a publisher of
+     * the topic is reported by the resolver, so that the subscriptions to idle topics cost no
+     * connection. The messages published before that are not received. It has no effect on a
+     * subscriber with a remote address, nor without a resolver (see b0::setDecentralized()).
+     *
+     * The default is disabled, unless the B0_LAZY_CONNECT environment variable is set
+     * (the subscribers which do not notify the graph, e.g. those of the library, are not
+     * made lazy by it).
+     */
+    void setLazy(bool lazy);
+
+    //! Return true if the subscriber connects when the topic has a publisher (see setLazy())
+    bool getLazy() const;
+
+    //! Return false while a lazy subscriber waits for a publisher of its topic (see setLazy())
+    bool isConnected() const;
+
+    /*!
+     * \brief Dispatch only the messages whose headers are accepted by filter (an empty filter accepts all)
+     *
+     * The filter is called by spinOnce() right after the headers of a message are parsed,
+     * before its parts are decompressed or copied, so the messages rejected cost almost
+     * nothing (see Statistics::filtered). It gets the envelope, of which only header0 and the
+     * customized headers (findHeader(), getHeaders()) are valid, e.g.:
+     *
+     * ~~~
+     * sub.setHeaderFilter([](const b0::message::MessageEnvelopeView &env) {
+     *     auto id = env.findHeader("Sensor-id");
+     *     return id && *id == "imu-left";
+     * });
+     * ~~~
+     */
+    void setHeaderFilter(const b0::message::HeaderFilter &filter);
+
+    /*!
+     * \brief Drop the messages whose Expires header has passed, instead of dispatching them
+     *
+     * The Expires header is set by the publishers with a time to live (see
+     * b0::Publisher::setTimeToLive()). The messages are checked by spinOnce() right after their
+     * headers are parsed, as by the header filter (see setHeaderFilter()), and again before the
+     * callback if they were buffered (see setKeepLatest(), setBufferLimit()); the ones dropped
+     * are counted in Statistics::expired. Both nodes must be time-synced with the resolver.
+     *
+     * The default is disabled, unless the B0_SUBSCRIBER_DROP_EXPIRED environment variable is set.
+     */
+    void setDropExpired(bool enabled);
+
+    //! Return true if the expired messages are dropped (see setDropExpired())
+    bool getDropExpired() const;
+
+    /*!
+     * \brief Ask the publishers for the messages missed, for an at-least-once delivery
+     *
+     * The publishers must be in reliable mode (see b0::Publisher::setReliable()). The messages
+     * missing from the sequence of a publisher (seen from the Seq header) are asked for by
+     * spinOnce() right away, then every 100 milliseconds until they arrive, or are given up
+     * on after timeout_usec microseconds (counted in Statistics::lost). The ones received
+     * again are dispatched, after the newer ones (counted in Statistics::recovered), and the
+     * copies of the messages already dispatched are dropped (Statistics::duplicates).
+     *
+     * The losses are detected from the next message received: the last messages of a
+     * publisher which stops are not asked for. This works for the messages dispatched to the
+     * callback by spinOnce(); the node must be spinning. The default is disabled.
+     */
+    void setReliable(bool enabled, int64_t timeout_usec = 2000000);
+
+    //! Return true if the missed messages are asked for again (see setReliable())
+    bool getReliable() const;
+
+    /*!
+     * \brief Decompress the parts of the messages only when the callback reads them
+     *
+     * If enabled, the compressed parts of the messages are left compressed until their payload
+     * is read with b0::message::MessagePartView::payload(): a callback taking part views (see
+     * CallbackPartsView) which reads only some of the parts, e.g. a small metadata part next to
+     * large images, then does not pay for decompressing the others. The other callbacks read
+     * all the parts they get, as do delta encoding (see b0::Publisher::setDeltaEncoding()) and
+     * the messages received intra-process, which are never compressed. An error decompressing
+     * a part is thrown by payload(), instead of being counted by the subscriber.
+     *
+     * The default is disabled, unless the B0_SUBSCRIBER_LAZY_DECOMPRESSION environment variable is set.
+     */
+    void setLazyDecompression(bool enabled);
+
+    //! Return true if the parts are decompressed only when read (see setLazyDecompression())
+    bool getLazyDecompression() const;
+
+    /*!
+     * \brief Receive and decode the messages in a background thread (must be called before init())
+     *
+     * If queue_size is not 0, init() starts a thread of the subscriber which reads the messages
+     * from the socket, parses their envelopes, decompresses their parts (unless lazily, see
+     * setLazyDecompression()) and applies the header filter, then queues them, ready for the
+     * callback: spinOnce() only dispatches them. The receiving and decoding of large messages
+     * then overlaps with the callbacks, instead of adding to their time.
+     *
+     * When queue_size messages are waiting, the thread stops reading and the messages wait in
+     * the socket (see setReadHWM()), unless setKeepLatest() is set, in which case the oldest
+     * queued messages are discarded. setBufferLimit() does not apply, and intra-process delivery
+     * (see b0::setIntraProcess()) is not used. The socket belongs to the thread: it must not be
+     * read with readRaw() or readMsg(), and b0::Node does not poll it.
+     *
+     * Only for the subscribers with a callback. The default is 0 (disabled), unless the
+     * B0_SUBSCRIBER_PREFETCH environment variable is set to the queue size.
+     */
+    void setPrefetch(size_t queue_size);
+
+    //! Return the size of the queue of the background thread (0 if disabled, see setPrefetch())
+    size_t getPrefetch() const;
+
+    /*!
+     * \brief Set the maximum number of messages passed at once to a batch callback (0 for no limit, the default)
+     *
+     * Only for the subscribers constructed with a CallbackPartsBatch. Without a limit, a batch
+     * holds all the messages dispatched by one spinOnce(), which its spin budget bounds (see
+     * setSpinBudget()); with a limit, a spinOnce() can call the callback several times.
+     */
+    void setCallbackBatchSize(size_t max_count);
+
+    //! Return the maximum number of messages passed at once to a batch callback (see setCallbackBatchSize())
+    size_t getCallbackBatchSize() const;
+
+    /*!
+     * \brief Also receive the messages of the subtopics of the topic selected by filters
+     *
+     * A publisher can send its messages to a subtopic (see b0::Publisher::setSubtopic()),
+     * i.e. with "<topic>/<subtopic>" as header0, e.g. the log of the nodes (see
+     * b0::setHierarchicalLogTopics()). The subscriber receives, besides the messages of the
+     * topic itself, those of the subtopics starting with one of the filters (an empty filter
+     * selects all of them): the other ones are dropped by ZeroMQ at the proxy (or at the
+     * publisher), and never reach this socket. The default is no filter.
+     *
+     * Can be called at any time from the node's thread, the subscriptions being updated at
+     * once; messages of the former filters already queued may still be received. The rate
+     * limits and the parts selection (see setMaxRate(), setDecimation(), setParts()) are
+     * applied by spinOnce() instead of the proxy, if filters are set before init().
+     */
+    void setSubtopicFilters(const std::vector<std::string> &filters);
+
+    //! Return the filters of the subtopics received (see setSubtopicFilters())
+    const std::vector<std::string> & getSubtopicFilters() const;
+
+    /*!
+     * \brief Statistics of the stamped messages received by a subscriber
+     *
+     * \sa Publisher::setStampMessages(), Subscriber::getStatistics()
+     */
+    struct Statistics
+    {
+        //! Number of stamped messages received
+        uint64_t received{0};
+
+        //! Number of messages missing from the sequence of their publisher (e.g. dropped due to HWM or conflate)
+        uint64_t gaps{0};
+
+        //! Latency of the last message (in microseconds)
+        int64_t last_latency{0};
+
+        //! Maximum latency (in microseconds)
+        int64_t max_latency{0};
+
+        //! Sum of the latencies (in microseconds), divide by received to get the average
+        int64_t total_latency{0};
+
+        //! Number of messages (stamped or not) discarded in favor of newer ones (see setKeepLatest())
+        uint64_t discarded{0};
+
+        //! Number of messages (stamped or not) rejected by the header filter (see setHeaderFilter())
+        uint64_t filtered{0};
+
+        //! Number of messages dropped because their Expires header had passed (see setDropExpired())
+        uint64_t expired{0};
+
+        //! Number of deltas dropped because the message they apply to was missed (see Publisher::setDeltaEncoding())
+        uint64_t delta_dropped{0};
+
+        //! Number of missed messages received again from their publisher (see setReliable())
+        uint64_t recovered{0};
+
+        //! Number of missed messages given up on (see setReliable())
+        uint64_t lost{0};
+
+        //! Number of copies of messages already received, dropped (see setReliable())
+        uint64_t duplicates{0};
+    };
+
+    /*!
+     * \brief Return the statistics of the stamped messages received so far
+     *
+     * Latency is computed as the difference between Node::timeUSec() on reception and the
+     * Send-time header, so it is meaningful when both nodes are time-synced with the resolver.
+     * Messages without the Send-time and Seq headers are not accounted.
+     */
+    Statistics getStatistics() const;
+
+    /*!
+     * \brief Reset the statistics (see getStatistics())
+     */
+    void resetStatistics();
+
+    /*!
+     * \brief Return the Send-time header of the message being dispatched (-1 if not stamped)
+     *
+     * Meant to be called from within the callback.
+     */
+    int64_t getLastSendTime() const;
+
+    /*!
+     * \brief Return the Seq header of the message being dispatched (0 if not stamped)
+     *
+     * Meant to be called from within the callback.
+     */
+    uint64_t getLastSeq() const;
+
 protected:
+    /*!
+     * \brief Call the callbacks with the given message parts
+     */
+    virtual void dispatch(const std::vector<b0::message::MessagePartView> &parts);
+
     /*!
      * \brief Connect to the remote address
      */
@@ -182,6 +572,11 @@ protected:
      */
     virtual void disconnect();
 
+    /*!
+     * \brief Accept the topic, or the channel subscribed to if rate-limited by the proxy (see setMaxRate())
+     */
+    virtual bool acceptsHeader0(const std::string &header0) const override;
+
     //! If false this socket will not send announcement to resolv (i.e. it will be "invisible")
     const bool notify_graph_;
 
@@ -199,6 +594,349 @@ protected:
      * \brief Callback which will be called when a new message is read from the socket (raw multipart)
      */
     CallbackParts callback_multipart_;
+
+    /*!
+     * \brief Callback which will be called when a new message is read from the socket (raw multipart views)
+     */
+    CallbackPartsView callback_multipart_view_;
+
+    /*!
+     * \brief Callback which will be called with the messages read by a spinOnce() (batch of raw multipart)
+     */
+    CallbackPartsBatch callback_batch_;
+
+    /*!
+     * \brief Read the Send-time and Seq headers of a received message, and update the statistics
+     *
+     * Return false if the message is a copy of a latched message already received (see
+     * b0::Publisher::setLatched()), which must not be dispatched.
+     */
+    virtual bool processHeaders(const std::map<std::string, std::string> &headers);
+
+private:
+    //! Call dispatch(), once per message if batched, recording its duration in the socket counters
+    void timedDispatch(const std::map<std::string, std::string> &headers, const std::vector<b0::message::MessagePartView> &parts);
+
+    //! Return true if the message was published by this process, and already delivered intra-process
+    bool isOwnIntraProcessMessage(const b0::message::MessageEnvelopeView &env);
+
+    //! Count messages discarded in favor of newer ones
+    void discarded(uint64_t n);
+
+    //! Count messages rejected by the header filter (or expired, see readFilter())
+    void filtered();
+
+    //! Return true if the Expires header of a message has passed
+    bool isExpired(const b0::message::MessageEnvelopeView &env);
+
+    //! Return true (and count it) if a buffered message expired while waiting for the callback
+    bool droppedExpired(const b0::message::MessageEnvelopeView &env);
+
+    //! Return the filter of the messages read from the socket: the header filter, the expiry check and the rate limit if enabled
+    const b0::message::HeaderFilter & readFilter();
+
+    //! Return true if the header filter accepts an intra-process message
+    bool acceptIntraProcess(const b0::message::MessageEnvelope &env);
+
+    //! Protects stats_
+    mutable boost::mutex stats_mutex_;
+
+    //! Statistics of the received stamped messages
+    Statistics stats_;
+
+    //! Last sequence number received from each publisher (by Publisher header)
+    std::map<std::string, uint64_t> last_seq_;
+
+    //! Send-time header of the message being dispatched
+    int64_t last_send_time_{-1};
+
+    //! Seq header of the message being dispatched
+    uint64_t last_seq_value_{0};
+
+    //! Last message reconstructed from the deltas of a publisher (see Publisher::setDeltaEncoding())
+    struct DeltaBase
+    {
+        //! Seq header of the message (0 if missed: the next deltas are dropped until a keyframe)
+        uint64_t seq{0};
+
+        //! Payloads of the message
+        std::vector<std::string> payloads;
+
+        //! Time of the last keyframe request
+        std::chrono::steady_clock::time_point last_request;
+    };
+
+    //! The last message of each delta-encoding publisher (by Publisher header)
+    std::map<std::string, DeltaBase> delta_bases_;
+
+    //! Payloads being decoded, reused across messages
+    std::vector<std::string> delta_scratch_;
+
+    //! Views of the reconstructed payloads
+    std::vector<b0::message::MessagePartView> delta_parts_;
+
+    //! Number of keyframe requests sent
+    uint64_t keyframe_requests_{0};
+
+    /*!
+     * \brief Reconstruct a message from its delta (see Publisher::setDeltaEncoding())
+     *
+     * Return the parts to dispatch: the same parts if the message is not a delta, or nullptr
+     * (and request a keyframe) if the message it applies to was missed.
+     */
+    const std::vector<b0::message::MessagePartView> * decodeDelta(const std::map<std::string, std::string> &headers, const std::vector<b0::message::MessagePartView> &parts);
+
+    //! Ask the publishers of the topic for a keyframe, at most every 100 milliseconds
+    void requestKeyframe(DeltaBase &base);
+
+    //! Prefix of the subscriptions asking the publishers of a topic for a keyframe (no header0 starts with \x7f)
+    static std::string keyframeRequestFilter(const std::string &topic);
+
+    //! If true, the messages missed are asked for again
+    //! \sa Subscriber::setReliable()
+    bool reliable_{false};
+
+    //! Time after which a missed message is given up on, in microseconds
+    int64_t reliable_timeout_usec_{2000000};
+
+    //! The messages missed from a publisher, being asked for again
+    struct MissingMessages
+    {
+        //! The Seq of each message, and when it is given up on
+        std::map<uint64_t, std::chrono::steady_clock::time_point> seqs;
+
+        //! Time of the last request
+        std::chrono::steady_clock::time_point last_request;
+    };
+
+    //! The messages missed from each publisher (by Publisher header; protected by stats_mutex_)
+    std::map<std::string, MissingMessages> missing_;
+
+    //! Number of retransmission requests sent
+    uint64_t retransmit_requests_{0};
+
+    //! Record the messages missed from a publisher (stats_mutex_ must be locked)
+    void missed(const std::string &publisher, uint64_t first, uint64_t last);
+
+    //! Ask the publishers for the messages missed, at most every 100 milliseconds (see setReliable())
+    void requestMissing();
+
+    //! Prefix of the subscriptions asking the publishers of a topic for the messages missed (see keyframeRequestFilter())
+    static std::string retransmitRequestFilter(const std::string &topic);
+
+    //! Register this subscriber for intra-process delivery under the given key
+    void registerIntraProcess(const std::string &key);
+
+    /*!
+     * \brief Resolve the publishers of the topic and connect to the new ones (peer-to-peer mode, or multicast groups)
+     */
+    void connectToPeers();
+
+    //! True if the publishers of the topic are resolved periodically (peer-to-peer or multicast)
+    bool resolvesPeers() const;
+
+    //! True if this subscriber connects directly to the publishers (see b0::setPeerToPeer())
+    bool peer_to_peer_{false};
+
+    //! True if this subscriber joins the multicast groups of the publishers
+    //! \sa Subscriber::setMulticast()
+    bool multicast_;
+
+    //! Maximum rate of the messages received
+    //! \sa Subscriber::setMaxRate()
+    double max_rate_;
+
+    //! Decimation factor of the messages received
+    //! \sa Subscriber::setDecimation()
+    unsigned decimation_{0};
+
+    //! Parts of the messages received
+    //! \sa Subscriber::setParts()
+    std::vector<std::string> parts_;
+
+    //! Filters of the subtopics received
+    //! \sa Subscriber::setSubtopicFilters()
+    std::vector<std::string> subtopic_filters_;
+
+    //! Subscribe to (or unsubscribe from) the subtopics selected by subtopic_filters_
+    void subscribeSubtopics(int option);
+
+    //! Channel of the topic subscribed to when rate-limited (or with parts selected) by the proxy (see b0::Decimator), or empty
+    std::string channel_;
+
+    //! Parts selected by timedDispatch(), when not selected by the proxy
+    std::vector<b0::message::MessagePartView> selected_parts_;
+
+    //! Rate limit applied by spinOnce() when not rate-limited by the proxy
+    RateLimit rate_limit_;
+
+    //! Addresses of the publishers (or multicast groups) this subscriber is connected to
+    std::set<std::string> peer_addrs_;
+
+    //! Time of the next resolution of the publishers in peer-to-peer mode
+    std::chrono::steady_clock::time_point next_peers_refresh_;
+
+    //! Unregister this subscriber from intra-process delivery
+    void unregisterIntraProcess();
+
+    //! Connect to the proxy (and to the peers), called by init() or by the node for a lazy subscriber
+    void connectNow();
+
+    //! True if the subscriber connects when the topic has a publisher
+    //! \sa Subscriber::setLazy()
+    bool lazy_;
+
+    //! False while a lazy subscriber waits for a publisher
+    std::atomic<bool> connected_{false};
+
+    //! Queue a message published in this process, and wake up the node
+    void deliverIntraProcess(const std::shared_ptr<const b0::message::MessageEnvelope> &env);
+
+    //! Return true if some subscriber of this process is registered under the given key
+    static bool hasIntraProcessSubscribers(const std::string &key);
+
+    //! Deliver a message to all the subscribers of this process registered under the given key
+    static void publishIntraProcess(const std::string &key, const std::shared_ptr<const b0::message::MessageEnvelope> &env);
+
+    //! Value of the Source-process header, identifying messages published by this process
+    static const std::string & intraProcessSource(Node &node);
+
+    //! Intra-process registration key (empty if not registered)
+    std::string intra_process_key_;
+
+    //! Protects intra_process_queue_
+    boost::mutex intra_process_mutex_;
+
+    //! Messages published in this process, waiting to be dispatched
+    std::deque<std::shared_ptr<const b0::message::MessageEnvelope> > intra_process_queue_;
+
+    //! Number of messages in intra_process_queue_
+    std::atomic<size_t> intra_process_pending_{0};
+
+    /*
+     * Storage reused across received messages, so that receiving at a steady rate does not
+     * allocate (only used by the thread spinning this subscriber).
+     */
+
+    //! Envelope the messages read from the socket are parsed into
+    b0::message::MessageEnvelopeView receive_envelope_;
+
+    //! The part of a batch being dispatched (see Publisher::publishBatch())
+    std::vector<b0::message::MessagePartView> batch_part_;
+
+    //! Number of newest messages dispatched (0: all)
+    //! \sa Subscriber::setKeepLatest()
+    size_t keep_latest_{0};
+
+    //! Messages read from the socket, of which only the newest are kept (the elements are
+    //! never moved, as the part views point into them)
+    std::deque<b0::message::MessageEnvelopeView> keep_latest_queue_;
+
+    //! Maximum payload size of keep_latest_queue_ (0: unlimited)
+    //! \sa Subscriber::setBufferLimit()
+    size_t buffer_limit_{0};
+
+    //! Payload size of keep_latest_queue_
+    size_t buffered_bytes_{0};
+
+    //! Number of messages in keep_latest_queue_, readable from other threads
+    std::atomic<size_t> buffered_messages_{0};
+
+    //! Read the messages waiting in the socket into keep_latest_queue_, discarding the oldest beyond the limits
+    void bufferMessages();
+
+    //! Predicate on the headers of the messages to dispatch
+    //! \sa Subscriber::setHeaderFilter()
+    b0::message::HeaderFilter header_filter_;
+
+    //! If true, the messages whose Expires header has passed are dropped
+    //! \sa Subscriber::setDropExpired()
+    bool drop_expired_;
+
+    //! If true, the compressed parts are decompressed only when read
+    //! \sa Subscriber::setLazyDecompression()
+    bool lazy_decompression_;
+
+    //! Maximum number of messages queued by prefetch_thread_ (0: no prefetching)
+    //! \sa Subscriber::setPrefetch()
+    size_t prefetch_size_;
+
+    //! Thread reading and decoding the messages into prefetch_queue_
+    boost::thread prefetch_thread_;
+
+    //! Serializes the use of the ZeroMQ socket by prefetch_thread_ and the node's thread (connections, keyframe requests)
+    boost::mutex prefetch_socket_mutex_;
+
+    //! Protects prefetch_queue_ and prefetch_free_
+    boost::mutex prefetch_mutex_;
+
+    //! Signaled when prefetch_queue_ has room again
+    boost::condition_variable prefetch_cond_;
+
+    //! Messages decoded by prefetch_thread_, ready for the callback (a list, so that they move
+    //! between the queues without being moved in memory, as the part views point into them)
+    std::list<b0::message::MessageEnvelopeView> prefetch_queue_;
+
+    //! Messages of prefetch_queue_ being dispatched by spinOnce()
+    std::list<b0::message::MessageEnvelopeView> prefetch_dispatch_queue_;
+
+    //! Dispatched messages, reused by prefetch_thread_ with their buffers
+    std::list<b0::message::MessageEnvelopeView> prefetch_free_;
+
+    //! Number of messages in prefetch_queue_ and prefetch_dispatch_queue_
+    std::atomic<size_t> prefetch_pending_{0};
+
+    //! Payload size of the messages of prefetch_queue_ and prefetch_dispatch_queue_ (protected by prefetch_mutex_)
+    size_t prefetch_bytes_{0};
+
+    //! Body of prefetch_thread_
+    void prefetchLoop();
+
+    //! Dispatch the messages of prefetch_dispatch_queue_, within the spin budget
+    void dispatchPrefetched();
+
+    //! Stop prefetch_thread_, and drop the messages it queued
+    void stopPrefetch();
+
+    //! Filter checking the expiry, then header_filter_, then rate_limit_ (built by readFilter())
+    b0::message::HeaderFilter read_filter_;
+
+    //! Set by expiry_filter_ when it rejects an expired message, so that filtered() counts it as such
+    bool last_expired_{false};
+
+    //! Envelope the headers of the intra-process messages are checked in
+    b0::message::MessageEnvelopeView filter_envelope_;
+
+    //! Messages of intra_process_queue_ being dispatched
+    std::deque<std::shared_ptr<const b0::message::MessageEnvelope> > intra_process_dispatch_queue_;
+
+    //! Part views of the intra-process message being dispatched
+    std::vector<b0::message::MessagePartView> intra_process_parts_;
+
+    //! Payload passed to the raw callbacks
+    std::string dispatch_payload_;
+
+    //! Parts passed to the multipart callback
+    std::vector<b0::message::MessagePart> dispatch_parts_;
+
+    //! Maximum number of messages of callback_batch_parts_ (0: unlimited)
+    //! \sa Subscriber::setCallbackBatchSize()
+    size_t callback_batch_size_{0};
+
+    //! Messages passed to the batch callback
+    std::vector<std::vector<b0::message::MessagePart> > callback_batch_parts_;
+
+    //! Messages already passed to the batch callback, reused with their buffers
+    std::vector<std::vector<b0::message::MessagePart> > callback_batch_free_;
+
+    //! Call the batch callback with the messages of callback_batch_parts_, if any
+    void flushCallbackBatch();
+
+    //! The part of spinOnce() which reads and dispatches the messages
+    void dispatchMessages();
+
+    friend class Publisher;
+    friend class Node;
 };
 
 template<class TMsg>
@@ -215,10 +953,9 @@ template<class TMsg>
 Subscriber::Subscriber(Node *node, const std::string &topic_name, CallbackMsgParts<TMsg> callback, bool managed, bool notify_graph)
     : Subscriber(node, topic_name,
             static_cast<CallbackParts>([&, callback](const std::vector<b0::message::MessagePart> &parts) {
-                std::vector<b0::message::MessagePart> parts1(parts);
+                std::vector<b0::message::MessagePart> parts1(parts.begin() + 1, parts.end());
                 TMsg msg;
-                parse(msg, parts1[0].payload, parts1[0].content_type);
-                parts1.erase(parts1.begin());
+                parse(msg, parts[0].payload, parts[0].content_type);
                 callback(msg, parts1);
             }), managed, notify_graph)
 {}
@@ -248,6 +985,16 @@ Subscriber::Subscriber(Node *node, const std::string &topic_name, void (T::*call
     : Subscriber(node, topic_name, static_cast<CallbackRawType>(boost::bind(callback, obj, _1, _2)))
 {}
 
+template<class T>
+Subscriber::Subscriber(Node *node, const std::string &topic_name, void (T::*callback)(const std::vector<b0::message::MessagePartView>&), T *obj, bool managed, bool notify_graph)
+    : Subscriber(node, topic_name, static_cast<CallbackPartsView>(boost::bind(callback, obj, _1)), managed, notify_graph)
+{}
+
+template<class T>
+Subscriber::Subscriber(Node *node, const std::string &topic_name, void (T::*callback)(const std::vector<std::vector<b0::message::MessagePart> >&), T *obj, bool managed, bool notify_graph)
+    : Subscriber(node, topic_name, static_cast<CallbackPartsBatch>(boost::bind(callback, obj, _1)), managed, notify_graph)
+{}
+
 template<class T, class TMsg>
 Subscriber::Subscriber(Node *node, const std::string &topic_name, void (T::*callback)(const TMsg&), T *obj, bool managed, bool notify_graph)
     : Subscriber(node, topic_name, static_cast<CallbackMsg<TMsg> >(boost::bind(callback, obj, _1)))
@@ -0,0 +1,298 @@
+#ifndef B0__UTILS__BUFFER_POOL_H__INCLUDED
+#define B0__UTILS__BUFFER_POOL_H__INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+/*!
+ * \brief The allocator of the buffers of the ZeroMQ messages sent by the sockets
+ *
+ * By default ZeroMQ allocates the buffer of each message with malloc(), and frees it once
+ * sent (in one of its I/O threads). For messages of several megabytes, each such buffer is
+ * mapped fresh by the C library, and its pages are faulted in as the message is written.
+ * An allocator can keep the buffers instead (see b0::BufferPool).
+ *
+ * deallocate() can be called from any thread, including the I/O threads of ZeroMQ.
+ *
+ * \sa b0::setBufferAllocator()
+ */
+class BufferAllocator
+{
+public:
+    //! Destructor
+    virtual ~BufferAllocator();
+
+    /*!
+     * \brief Return a buffer of at least size bytes, aligned to 16 bytes, or nullptr to let ZeroMQ allocate it
+     */
+    virtual void * allocate(size_t size) = 0;
+
+    /*!
+     * \brief Give back a buffer returned by allocate(size)
+     */
+    virtual void deallocate(void *data, size_t size) = 0;
+};
+
+/*!
+ * \brief A BufferAllocator keeping the freed buffers for reuse, by size class
+ *
+ * The buffers from getMinimumSize() to getMaximumSize() bytes are rounded up to a size class
+ * (four classes per power of two, so at most 19% of a buffer is unused), and the freed
+ * buffers of each class are kept for the next allocations of that class: in a cache of the
+ * thread which freed them (up to getThreadCacheSize() per class), then in a cache shared by
+ * all the threads (up to getMaximumCachedBytes() in total). The smaller and the bigger
+ * buffers are left to ZeroMQ.
+ *
+ * In the steady state of a stream of messages of similar sizes, the buffers are reused, so
+ * that sending a message causes neither a page fault nor a call to the C allocator. The
+ * thread caches avoid the lock of the shared cache most of the time.
+ *
+ * With huge pages (see setHugePages()), the buffers of 2 MB and more are rounded up to 2 MB
+ * and mapped with huge pages: from the reserved pool of the kernel if there are some
+ * (MAP_HUGETLB), otherwise as transparent huge pages (madvise(MADV_HUGEPAGE)). This is only
+ * implemented on Linux. The new buffers are faulted in when allocated.
+ *
+ * With a NUMA node (see setNUMANode()), the new buffers are bound to the memory of that
+ * node, e.g. the one local to the NIC sending the messages (Linux only).
+ *
+ * A pool, once in use, must live as long as the messages sent with its buffers: a pool set
+ * with b0::setBufferAllocator() is kept until the process exits.
+ */
+class BufferPool : public BufferAllocator
+{
+public:
+    //! Reuse statistics of a pool
+    struct Stats
+    {
+        //! Number of buffers allocated by the pool (not counting the ones left to ZeroMQ)
+        uint64_t allocations{0};
+
+        //! Number of allocations served from the thread caches
+        uint64_t thread_cache_hits{0};
+
+        //! Number of allocations served from the shared cache
+        uint64_t shared_cache_hits{0};
+
+        //! Number of allocations of new memory (allocations - reuses)
+        uint64_t fresh_allocations{0};
+
+        //! Number of new buffers mapped with huge pages
+        uint64_t huge_page_allocations{0};
+
+        //! Number of buffers freed because a cache was full
+        uint64_t releases{0};
+
+        //! Bytes in the buffers in use
+        uint64_t bytes_in_use{0};
+
+        //! Bytes in the buffers kept in the caches
+        uint64_t bytes_cached{0};
+    };
+
+    /*!
+     * \brief Construct a pool for the buffers of min_size to max_size bytes
+     */
+    BufferPool(size_t min_size = 65536, size_t max_size = 256 << 20);
+
+    /*!
+     * \brief Destructor (all the buffers must have been given back)
+     */
+    virtual ~BufferPool();
+
+    void * allocate(size_t size) override;
+
+    void deallocate(void *data, size_t size) override;
+
+    //! Return the smallest size of the buffers of the pool
+    size_t getMinimumSize() const;
+
+    //! Return the biggest size of the buffers of the pool
+    size_t getMaximumSize() const;
+
+    /*!
+     * \brief Map the buffers of 2 MB and more with huge pages (Linux only; default: false)
+     *
+     * Must be called before the first allocation.
+     */
+    void setHugePages(bool enabled);
+
+    //! Return true if the buffers of 2 MB and more are mapped with huge pages
+    bool getHugePages() const;
+
+    /*!
+     * \brief Bind the new buffers to the memory of a NUMA node (Linux only; default: -1, no binding)
+     *
+     * Must be called before the first allocation.
+     */
+    void setNUMANode(int node);
+
+    //! Return the NUMA node the new buffers are bound to, or -1
+    int getNUMANode() const;
+
+    /*!
+     * \brief Set the number of buffers of each size class kept by each thread (default: 2, 0 disables the thread caches)
+     */
+    void setThreadCacheSize(size_t count);
+
+    //! Return the number of buffers of each size class kept by each thread
+    size_t getThreadCacheSize() const;
+
+    /*!
+     * \brief Set the maximum number of bytes kept in the shared cache (default: 256 MB)
+     */
+    void setMaximumCachedBytes(size_t bytes);
+
+    //! Return the maximum number of bytes kept in the shared cache
+    size_t getMaximumCachedBytes() const;
+
+    //! Return the reuse statistics
+    Stats getStats() const;
+
+    //! Free the buffers of the shared cache (the ones in the thread caches are kept)
+    void trim();
+
+protected:
+    //! Return the index of the size class of a buffer of size bytes, or -1 if not pooled
+    int sizeClass(size_t size) const;
+
+    //! Return the size of the buffers of a class
+    size_t classSize(int cls) const;
+
+    //! Return the size of the mapping of the buffers of a class (with huge pages, rounded up to 2 MB)
+    size_t mappingSize(int cls) const;
+
+    //! Map a new buffer of the size of a class
+    void * newBuffer(int cls);
+
+    //! Bind a new mapping to the NUMA node, if any, and fault its pages in
+    void populate(char *data, size_t size);
+
+    //! Unmap a buffer of the size of a class
+    void freeBuffer(void *data, int cls);
+
+    //! Take a buffer from the shared cache, or return nullptr
+    void * takeShared(int cls);
+
+    //! Put a buffer in the shared cache, or free it if full
+    void putShared(void *data, int cls);
+
+    //! The thread caches, which give their buffers back to the pools when the thread exits
+    friend struct ThreadBufferCache;
+
+    //! The sizes of the classes, increasing
+    std::vector<size_t> class_sizes_;
+
+    //! Smallest and biggest sizes pooled
+    const size_t min_size_, max_size_;
+
+    //! Protects shared_
+    mutable boost::mutex mutex_;
+
+    //! The shared cache, by class
+    std::vector<std::vector<void*> > shared_;
+
+    //! Bytes in the shared cache
+    size_t shared_bytes_{0};
+
+    std::atomic<bool> huge_pages_{false};
+    std::atomic<int> numa_node_{-1};
+    std::atomic<size_t> thread_cache_size_{2};
+    std::atomic<size_t> max_cached_bytes_{256 << 20};
+
+    //! Counters of Stats
+    std::atomic<uint64_t> allocations_{0}, thread_cache_hits_{0}, shared_cache_hits_{0}, fresh_allocations_{0}, huge_page_allocations_{0}, releases_{0};
+    std::atomic<int64_t> bytes_in_use_{0}, bytes_in_thread_caches_{0};
+
+    //! Identifies the pool in the thread caches (unlike its address, never reused)
+    const uint64_t id_;
+};
+
+/*!
+ * \brief A BufferAllocator with a fixed number of buffers of one size, allocated once
+ *
+ * The memory of all the buffers is allocated (and faulted in) by the constructor, after
+ * which the pool never allocates nor frees memory: the buffers from getMinimumSize() to
+ * getBufferSize() bytes are served from the free ones, and the others, or all of them while
+ * none is free, are left to ZeroMQ (counted as misses). This bounds the memory used by the
+ * messages sent, which suits small targets (see b0::setEmbeddedProfile()).
+ *
+ * Like a b0::BufferPool, a pool once in use must live as long as the messages sent with its
+ * buffers.
+ */
+class FixedBufferPool : public BufferAllocator
+{
+public:
+    //! Usage statistics of a pool
+    struct Stats
+    {
+        //! Number of buffers served by the pool
+        uint64_t allocations{0};
+
+        //! Number of buffers of a pooled size left to ZeroMQ, because none was free or they were too big
+        uint64_t misses{0};
+
+        //! Number of buffers in use
+        uint64_t buffers_in_use{0};
+
+        //! Highest number of buffers in use at once
+        uint64_t peak_buffers_in_use{0};
+    };
+
+    /*!
+     * \brief Construct a pool of count buffers of buffer_size bytes, for the buffers of min_size bytes or more
+     */
+    FixedBufferPool(size_t buffer_size = 65536, size_t count = 16, size_t min_size = 256);
+
+    /*!
+     * \brief Destructor (all the buffers must have been given back)
+     */
+    virtual ~FixedBufferPool();
+
+    void * allocate(size_t size) override;
+
+    void deallocate(void *data, size_t size) override;
+
+    //! Return the size of the buffers of the pool
+    size_t getBufferSize() const;
+
+    //! Return the number of buffers of the pool
+    size_t getBufferCount() const;
+
+    //! Return the smallest size of the buffers served by the pool
+    size_t getMinimumSize() const;
+
+    //! Return the usage statistics
+    Stats getStats() const;
+
+protected:
+    //! Size of the buffers, count, and smallest size served
+    const size_t buffer_size_, count_, min_size_;
+
+    //! Size of the slot of a buffer in memory_ (rounded up to 64 bytes)
+    const size_t slot_size_;
+
+    //! The memory of all the buffers
+    char *memory_{nullptr};
+
+    //! Protects free_ and the stats
+    mutable boost::mutex mutex_;
+
+    //! The free buffers
+    std::vector<void*> free_;
+
+    //! Counters of Stats
+    uint64_t allocations_{0}, misses_{0}, peak_in_use_{0};
+};
+
+} // namespace b0
+
+#endif // B0__UTILS__BUFFER_POOL_H__INCLUDED
@@ -0,0 +1,31 @@
+#ifndef B0__UTILS__CRC32C_H__INCLUDED
+#define B0__UTILS__CRC32C_H__INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+/*!
+ * \brief Compute the CRC-32C (Castagnoli) of a buffer
+ *
+ * Uses the CRC32 instructions of the CPU when available (SSE 4.2 on x86-64, the CRC
+ * extension of ARMv8), detected at run time, otherwise a table-driven implementation
+ * (slicing by 8). The result of a previous call can be given as crc to continue the
+ * computation over several buffers.
+ *
+ * \sa b0::Socket::setChecksum()
+ */
+uint32_t crc32c(const void *data, size_t size, uint32_t crc = 0);
+
+/*!
+ * \brief Return true if crc32c() uses the CRC32 instructions of the CPU
+ */
+bool crc32cHardware();
+
+} // namespace b0
+
+#endif // B0__UTILS__CRC32C_H__INCLUDED
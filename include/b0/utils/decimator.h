@@ -0,0 +1,163 @@
+#ifndef B0__UTILS__DECIMATOR_H__INCLUDED
+#define B0__UTILS__DECIMATOR_H__INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <b0/b0.h>
+#include <b0/compress/compress.h>
+#include <b0/message/message_chunk.h>
+#include <b0/message/message_envelope.h>
+
+namespace b0
+{
+
+/*!
+ * \brief Admits at most max_rate messages per second, and one message out of every
+ *
+ * A limit of 0 is no limit. The first message is always admitted.
+ */
+class RateLimit
+{
+public:
+    //! Set the limits, and reset the state
+    void setLimits(double max_rate, unsigned every);
+
+    //! Return true if any limit is set
+    bool enabled() const;
+
+    //! Return true if the next message is admitted, updating the state
+    bool admit();
+
+private:
+    //! Minimum interval between two messages (0 for no limit)
+    std::chrono::steady_clock::duration interval_{0};
+
+    //! Decimation factor (0 or 1 for no limit)
+    unsigned every_{0};
+
+    //! Time from which the next message is admitted
+    std::chrono::steady_clock::time_point next_;
+
+    //! Number of messages passed to admit() (the decimation admits the first of each every)
+    uint64_t count_{0};
+};
+
+/*!
+ * \brief Decimation and part selection of the messages of the topics, for the subscribers which ask for it
+ *
+ * A rate-limited subscriber (see b0::Subscriber::setMaxRate(), b0::Subscriber::setDecimation()),
+ * or one which wants only some parts of the messages (see b0::Subscriber::setParts()),
+ * subscribes to a channel of the topic, named after the topic and its options (see
+ * channelName()), instead of to the topic itself. The proxy of the resolver turns the
+ * subscriptions to channels into subscriptions to their topics (see subscription()), and
+ * forwards, together with each message of a topic, a copy with the name of the channel as
+ * header0 to each channel admitting it (see select()): ZeroMQ then sends to each subscriber
+ * only the messages of the topic or channel it subscribed to.
+ *
+ * The chunks of an envelope (see b0::message::MessageChunk) are forwarded to the channels
+ * which admitted its first chunk. For the channels selecting parts, the envelopes are
+ * reassembled, parsed and serialized again with the selected parts only (envelopes which
+ * cannot be parsed, e.g. shared-memory descriptors, are not forwarded to them).
+ *
+ * Not thread-safe: each proxy has its own.
+ */
+class Decimator
+{
+public:
+    /*!
+     * \brief Return the name of the channel of a topic with the given limits (see RateLimit) and parts (see selectsPart())
+     */
+    static std::string channelName(const std::string &topic, double max_rate, unsigned every, const std::vector<std::string> &parts = {});
+
+    /*!
+     * \brief Parse the name of a channel (see channelName()), returning false if name is not one
+     */
+    static bool parseChannelName(const std::string &name, std::string &topic, double &max_rate, unsigned &every, std::vector<std::string> &parts);
+
+    /*!
+     * \brief Return true if the part of the given index and content type is one of parts (indices or content types)
+     *
+     * An empty list selects all the parts.
+     */
+    static bool selectsPart(const std::vector<std::string> &parts, size_t index, const std::string &content_type);
+
+    /*!
+     * \brief A copy of a message to forward to a channel (see select())
+     */
+    struct Copy
+    {
+        //! The name of the channel
+        const std::string *channel;
+
+        //! The serialized envelope to forward, or null to forward the message with its header0 replaced by the channel
+        const std::string *data;
+    };
+
+    /*!
+     * \brief Process a subscription message of the subscribers (\\x01 or \\x00 followed by the filter)
+     *
+     * Return the subscription message to pass to the publishers: the same one, or the
+     * (un)subscription of its topic if the filter is a channel.
+     */
+    std::string subscription(const char *data, size_t size);
+
+    /*!
+     * \brief Return true if no channel is subscribed
+     */
+    bool empty() const;
+
+    /*!
+     * \brief Fill copies with the copies of a message of the publishers to forward to the channels
+     *
+     * The copies are valid until the next call.
+     */
+    void select(const char *data, size_t size, std::vector<Copy> &copies);
+
+private:
+    struct Channel
+    {
+        //! The name of the channel, i.e. the header0 of the copies
+        std::string name;
+
+        //! The limits of the channel
+        RateLimit limit;
+
+        //! Sequence number of the chunked envelope being copied, by sender
+        std::map<uint64_t, uint64_t> chunked;
+
+        //! The parts selected (empty for all)
+        std::vector<std::string> parts;
+
+        //! The last copy with the selected parts
+        std::string buffer;
+    };
+
+    //! Serialize into the buffer of the channel a copy of the parsed envelope with the selected parts, if any
+    bool selectParts(Channel &channel, bool binary);
+
+    //! The subscribed channels, by topic
+    std::map<std::string, std::vector<Channel> > channels_;
+
+    //! The chunked envelopes being reassembled for the channels selecting parts, by topic
+    std::map<std::string, b0::message::ChunkReassembler> reassemblers_;
+
+    //! The envelope being copied to the channels selecting parts
+    b0::message::MessageEnvelopeView envelope_;
+
+    //! The copy being serialized
+    b0::message::MessageEnvelope copy_;
+
+    //! Content lengths of the copy being serialized
+    std::vector<size_t> content_lengths_;
+
+    //! Compression state and buffers of the parsing and serialization
+    b0::compress::Context compression_context_;
+};
+
+} // namespace b0
+
+#endif // B0__UTILS__DECIMATOR_H__INCLUDED
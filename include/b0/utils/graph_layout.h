@@ -0,0 +1,128 @@
+#ifndef B0__UTILS__GRAPH_LAYOUT_H__INCLUDED
+#define B0__UTILS__GRAPH_LAYOUT_H__INCLUDED
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <b0/b0.h>
+#include <b0/message/graph/graph.h>
+
+namespace b0
+{
+
+namespace graph
+{
+
+/*!
+ * \brief A vertex of the drawing of the graph: a node, a topic or a service
+ */
+struct LayoutVertex
+{
+    enum class Kind
+    {
+        Node,
+        Topic,
+        Service
+    };
+
+    //! What the vertex stands for
+    Kind kind;
+
+    //! The name of the node, topic or service
+    std::string name;
+
+    //! The host of a node (empty for the others)
+    std::string host;
+
+    //! Position of the center of the vertex, in points
+    double x{0}, y{0};
+};
+
+/*!
+ * \brief Positions of the vertices of the graph of the network, updated incrementally
+ *
+ * Each update() compares the graph with the previous one: the vertices which stay keep
+ * their position, the new ones are placed next to their neighbors (or next to the nodes
+ * of their host), and only these and their neighbors are moved by a few iterations of a
+ * force-directed layout, the repulsion being computed from the vertices of the nearby cells
+ * of a grid. So the cost of an update depends on the size of the change, not of the graph,
+ * and the drawing does not jump around when a node joins or leaves.
+ *
+ * The positions can be given to Graphviz (see GraphvizOutputOptions::setLayout()), or drawn
+ * directly (e.g. by b0_gui_graph_monitor, which redraws only the vertices changed()).
+ */
+class GraphLayout
+{
+public:
+    /*!
+     * \brief Update the vertices and the edges after a change of the graph
+     *
+     * Return true if some vertex or edge was added or removed.
+     */
+    bool update(const b0::message::graph::Graph &graph);
+
+    /*!
+     * \brief Return the vertices, by id (see vertexId())
+     */
+    const std::map<std::string, LayoutVertex> & vertices() const;
+
+    /*!
+     * \brief Return the edges (from and to vertex ids), in the direction of the messages
+     */
+    const std::set<std::pair<std::string, std::string> > & edges() const;
+
+    /*!
+     * \brief Return the ids of the vertices added or moved by the last update()
+     */
+    const std::set<std::string> & changed() const;
+
+    /*!
+     * \brief Return the ids of the vertices removed by the last update()
+     */
+    const std::set<std::string> & removed() const;
+
+    /*!
+     * \brief Return the id of a vertex
+     */
+    static std::string vertexId(LayoutVertex::Kind kind, const std::string &name);
+
+    /*!
+     * \brief Set the ideal length of the edges, in points (the default is 90)
+     */
+    void setEdgeLength(double length);
+
+    /*!
+     * \brief Set the number of iterations of the force-directed layout, for an update (the default is 60)
+     */
+    void setIterations(int iterations);
+
+private:
+    //! Place a new vertex next to its neighbors already placed
+    void place(const std::string &id, LayoutVertex &v, const std::set<std::string> &placed);
+
+    //! Move the active vertices with a force-directed layout
+    void relax(const std::set<std::string> &active);
+
+    std::map<std::string, LayoutVertex> vertices_;
+    std::set<std::pair<std::string, std::string> > edges_;
+
+    //! The neighbors of each vertex
+    std::map<std::string, std::set<std::string> > neighbors_;
+
+    std::set<std::string> changed_, removed_;
+
+    //! Number of vertices placed away from the others (see place())
+    int spiral_{0};
+
+    double edge_length_{90};
+    int iterations_{60};
+};
+
+} // namespace graph
+
+} // namespace b0
+
+#endif // B0__UTILS__GRAPH_LAYOUT_H__INCLUDED
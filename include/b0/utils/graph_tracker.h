@@ -0,0 +1,68 @@
+#ifndef B0__UTILS__GRAPH_TRACKER_H__INCLUDED
+#define B0__UTILS__GRAPH_TRACKER_H__INCLUDED
+
+#include <cstdint>
+
+#include <b0/b0.h>
+#include <b0/message/graph/graph.h>
+#include <b0/message/graph/graph_delta.h>
+
+namespace b0
+{
+
+namespace graph
+{
+
+/*!
+ * \brief Keeps a copy of the graph of the network up to date with the deltas published by the resolver
+ *
+ * Typical use is to subscribe to the "graph_delta" topic, and pass each delta to apply().
+ * When it returns false (no snapshot yet, or a version was missed), get a snapshot of the
+ * graph with b0::Node::getGraph() and pass it to reset().
+ *
+ * \sa b0::message::graph::GraphDelta
+ */
+class GraphTracker
+{
+public:
+    /*!
+     * \brief Replace the graph with a snapshot
+     */
+    void reset(const b0::message::graph::Graph &graph);
+
+    /*!
+     * \brief Apply a delta to the graph
+     *
+     * Deltas older than the graph are ignored. Return false if there is no graph yet, or
+     * if the delta does not follow the current version, in which case a snapshot is needed.
+     */
+    bool apply(const b0::message::graph::GraphDelta &delta);
+
+    /*!
+     * \brief Return true if a snapshot has been received
+     */
+    bool valid() const;
+
+    /*!
+     * \brief Return the current version of the graph
+     */
+    int64_t version() const;
+
+    /*!
+     * \brief Return the current graph
+     */
+    const b0::message::graph::Graph & graph() const;
+
+private:
+    //! The current graph
+    b0::message::graph::Graph graph_;
+
+    //! True if reset() has been called
+    bool valid_{false};
+};
+
+} // namespace graph
+
+} // namespace b0
+
+#endif // B0__UTILS__GRAPH_TRACKER_H__INCLUDED
@@ -5,6 +5,7 @@
 
 #include <b0/b0.h>
 #include <b0/message/graph/graph.h>
+#include <b0/utils/graph_layout.h>
 
 namespace b0
 {
@@ -18,6 +19,10 @@ struct GraphvizOutputOptions
     std::string topic_color{"blue"};
     std::string service_color{"red"};
     bool cluster_hosts{true};
+    bool show_stats{true};
+    std::string hot_color{"orange"};
+    double hot_cpu_usage{0.8};
+    const GraphLayout *layout{nullptr};
 
     inline GraphvizOutputOptions & setOutlineColor(const std::string &c)
     {
@@ -42,6 +47,33 @@ struct GraphvizOutputOptions
         cluster_hosts = c;
         return *this;
     }
+
+    //! Show the resource usage reported by the nodes (see b0::setHeartbeatStats()) in their labels
+    inline GraphvizOutputOptions & setShowStats(bool s)
+    {
+        show_stats = s;
+        return *this;
+    }
+
+    //! Color of the nodes whose process uses at least hot_cpu_usage of a CPU
+    inline GraphvizOutputOptions & setHotColor(const std::string &c)
+    {
+        hot_color = c;
+        return *this;
+    }
+
+    inline GraphvizOutputOptions & setHotCPUUsage(double u)
+    {
+        hot_cpu_usage = u;
+        return *this;
+    }
+
+    //! Pin the vertices at the positions of this layout (render with GraphvizRenderOptions::setPinned())
+    inline GraphvizOutputOptions & setLayout(const GraphLayout *l)
+    {
+        layout = l;
+        return *this;
+    }
 };
 
 void toGraphviz(const b0::message::graph::Graph &graph, const std::string &filename, const GraphvizOutputOptions &opts = {});
@@ -50,6 +82,7 @@ struct GraphvizRenderOptions
 {
     std::string output_format{"png"};
     std::string program{"dot"};
+    bool pinned{false};
 
     inline GraphvizRenderOptions & setOutputFormat(const std::string &f)
     {
@@ -62,6 +95,14 @@ struct GraphvizRenderOptions
         program = p;
         return *this;
     }
+
+    //! Keep the positions given in the input (see GraphvizOutputOptions::setLayout()) instead of computing a layout
+    inline GraphvizRenderOptions & setPinned(bool p)
+    {
+        pinned = p;
+        if(p) program = "neato";
+        return *this;
+    }
 };
 
 int renderGraphviz(const std::string &input, const std::string &output, const GraphvizRenderOptions &opts = {});
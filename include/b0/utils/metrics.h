@@ -0,0 +1,239 @@
+#ifndef B0__UTILS__METRICS_H__INCLUDED
+#define B0__UTILS__METRICS_H__INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+/*!
+ * \brief A lock-free histogram of durations (in microseconds)
+ *
+ * Values are recorded in log-linear buckets (HDR-style): each power of two is divided
+ * in 8 sub-buckets, so that percentiles are reported with a relative error below 12.5%
+ * over the whole int64 range, using a fixed amount of memory.
+ *
+ * Recording is wait-free and safe to call concurrently with the readers, which however
+ * may observe a snapshot which is not consistent across buckets.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    //! Record a value (negative values are recorded as 0)
+    void record(int64_t value);
+
+    //! Return the number of recorded values
+    uint64_t count() const;
+
+    //! Return the sum of the recorded values
+    int64_t total() const;
+
+    //! Return the maximum recorded value
+    int64_t max() const;
+
+    //! Return the value at the given percentile (0-100), rounded down to its bucket
+    int64_t percentile(double p) const;
+
+    //! Clear the histogram
+    void reset();
+
+private:
+    //! Return the bucket of the given value
+    static size_t bucketIndex(uint64_t value);
+
+    //! Return the smallest value falling in the given bucket
+    static int64_t bucketValue(size_t index);
+
+    //! 8 linear buckets for values below 8, then 8 sub-buckets for each remaining power of two
+    static const size_t num_buckets_ = 8 + 61 * 8;
+
+    std::atomic<uint64_t> buckets_[num_buckets_];
+
+    std::atomic<uint64_t> count_;
+
+    std::atomic<int64_t> total_;
+
+    std::atomic<int64_t> max_;
+};
+
+/*!
+ * \brief Lock-free counter of the buffers allocated by a path of a Socket
+ *
+ * \sa Socket::setMemoryAccounting()
+ */
+class AllocationCounter
+{
+public:
+    AllocationCounter();
+
+    //! Account a buffer of the given size
+    void add(size_t size);
+
+    //! Clear the counter
+    void reset();
+
+    //! Number of buffers allocated
+    std::atomic<uint64_t> allocations;
+
+    //! Number of bytes allocated
+    std::atomic<uint64_t> bytes;
+};
+
+/*!
+ * \brief Lock-free gauge of the bytes waiting in a queue of a Socket, with its peak
+ */
+class QueueGauge
+{
+public:
+    QueueGauge();
+
+    //! Set the current size of the queue, raising the peak if above
+    void set(size_t size);
+
+    //! Clear the peak (to the current size)
+    void reset();
+
+    //! Bytes in the queue
+    std::atomic<uint64_t> bytes;
+
+    //! Maximum of bytes since the last reset()
+    std::atomic<uint64_t> peak_bytes;
+};
+
+/*!
+ * \brief Lock-free counters of the traffic of a Socket
+ *
+ * Updated by Socket::readRaw() and Socket::writeRaw(), by the spinOnce() dispatch
+ * loops of Subscriber and ServiceServer for the callback durations, and by the
+ * connection monitor (see Socket::setConnectionMonitor()).
+ *
+ * \sa Socket::getCounters(), Node::getMetrics()
+ */
+class SocketCounters
+{
+public:
+    SocketCounters();
+
+    //! Account a sent message, with its size on the wire and its uncompressed payload size
+    void messageSent(size_t wire_bytes, size_t payload_bytes);
+
+    //! Account a message which could not be sent (see Socket::setCountWriteDrops())
+    void messageDropped();
+
+    //! Account a received message, with its size on the wire and its uncompressed payload size
+    void messageReceived(size_t wire_bytes, size_t payload_bytes);
+
+    //! Account a received message which could not be read (see Socket::tryReadRaw())
+    void readError();
+
+    //! Account a connection established (or accepted) after connect_usec, which may be a reconnection
+    void connected(int64_t connect_usec, bool reconnected);
+
+    //! Clear all the counters
+    void reset();
+
+    //! Number of messages sent
+    std::atomic<uint64_t> messages_sent;
+
+    //! Number of bytes sent (serialized envelopes, after compression)
+    std::atomic<uint64_t> bytes_sent;
+
+    //! Number of payload bytes sent (before compression)
+    std::atomic<uint64_t> payload_bytes_sent;
+
+    //! Number of messages dropped because they could not be queued (see Socket::setCountWriteDrops())
+    std::atomic<uint64_t> messages_dropped;
+
+    //! Number of messages received
+    std::atomic<uint64_t> messages_received;
+
+    //! Number of bytes received (serialized envelopes, before decompression)
+    std::atomic<uint64_t> bytes_received;
+
+    //! Number of payload bytes received (after decompression)
+    std::atomic<uint64_t> payload_bytes_received;
+
+    //! Number of received messages which could not be read (malformed, not for the socket, or not decompressible)
+    std::atomic<uint64_t> read_errors;
+
+    //! Number of payloads left uncompressed by the adaptive compression (see Socket::setAdaptiveCompression())
+    std::atomic<uint64_t> compression_skipped;
+
+    //! Last measured compression ratio of the adaptive compression (0 if not measured)
+    std::atomic<double> compression_ratio;
+
+    //! Number of connections established or accepted (see Socket::setConnectionMonitor())
+    std::atomic<uint64_t> connects;
+
+    //! Number of connections lost
+    std::atomic<uint64_t> disconnects;
+
+    //! Number of connections established again after being lost
+    std::atomic<uint64_t> reconnects;
+
+    //! Number of connection attempts retried
+    std::atomic<uint64_t> connect_retries;
+
+    //! Number of failed ZMTP handshakes
+    std::atomic<uint64_t> handshake_failures;
+
+    //! Time from connect() (or from the loss of the connection) to the connection (in microseconds)
+    LatencyHistogram connect_time;
+
+    //! Time from the connection to the end of the ZMTP handshake (in microseconds)
+    LatencyHistogram handshake_time;
+
+    //! Durations of the callbacks (in microseconds)
+    LatencyHistogram callback_duration;
+
+    //! CPU time of the callbacks (in microseconds), measured only with ENABLE_PROFILING
+    LatencyHistogram callback_cpu;
+
+    //! Buffers allocated to receive the messages (frames, reassembled chunks), only with Socket::setMemoryAccounting()
+    AllocationCounter receive_allocations;
+
+    //! Buffers allocated to decode the messages (grown part payloads, decompressed payloads), only with Socket::setMemoryAccounting()
+    AllocationCounter decode_allocations;
+
+    //! Buffers allocated to send the messages (ZeroMQ messages, frames), only with Socket::setMemoryAccounting()
+    AllocationCounter send_allocations;
+
+    //! Payload bytes waiting to be dispatched (see b0::Subscriber::setKeepLatest(), setBufferLimit() and setPrefetch())
+    QueueGauge receive_queue;
+
+    //! Frames waiting to be handed over to ZeroMQ (see Socket::setWriteQueueLimit())
+    QueueGauge write_queue;
+};
+
+/*!
+ * \brief Lock-free counters of the fixed-rate spin loop of a Node
+ *
+ * \sa Node::getSpinCounters()
+ */
+class SpinCounters
+{
+public:
+    SpinCounters();
+
+    //! Clear all the counters
+    void reset();
+
+    //! Number of iterations of the spin loop
+    std::atomic<uint64_t> iterations;
+
+    //! Number of iterations (spinOnce() and the callback) which ended after the next deadline
+    std::atomic<uint64_t> overruns;
+
+    //! Lateness of the start of the iterations with respect to their deadline (in microseconds)
+    LatencyHistogram jitter;
+};
+
+} // namespace b0
+
+#endif // B0__UTILS__METRICS_H__INCLUDED
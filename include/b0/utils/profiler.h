@@ -0,0 +1,85 @@
+#ifndef B0__UTILS__PROFILER_H__INCLUDED
+#define B0__UTILS__PROFILER_H__INCLUDED
+
+#include <b0/b0.h>
+
+#include <cstdint>
+
+namespace b0
+{
+
+class Socket;
+
+/*!
+ * \brief Hook notified around each callback dispatch, for external profilers
+ *
+ * Meant to label the callback regions in profilers such as perf (markers), Tracy or
+ * ITT: beginCallback() and endCallback() are called on the thread running the callback,
+ * right before and after it. They must be cheap and must not throw.
+ *
+ * The hooks are called only if the library was built with ENABLE_PROFILING.
+ *
+ * \sa setProfilerHook()
+ */
+class ProfilerHook
+{
+public:
+    virtual ~ProfilerHook();
+
+    //! Called before a callback of the given socket
+    virtual void beginCallback(const Socket &socket) = 0;
+
+    //! Called after a callback of the given socket, with its wall and CPU time (in microseconds)
+    virtual void endCallback(const Socket &socket, int64_t wall_usec, int64_t cpu_usec) = 0;
+};
+
+/*!
+ * \brief Set the hook notified around each callback dispatch (nullptr to remove it)
+ *
+ * The hook is process-wide and not owned: it must stay valid until removed.
+ */
+void setProfilerHook(ProfilerHook *hook);
+
+//! Return the hook set with setProfilerHook(), or nullptr
+ProfilerHook * getProfilerHook();
+
+//! Return the CPU time of the calling thread, in microseconds (0 if not supported)
+int64_t threadCPUTimeUSec();
+
+//! Return the CPU time of the calling process, in microseconds (0 if not supported)
+int64_t processCPUTimeUSec();
+
+//! Return the resident set size of the calling process, in bytes (0 if not supported)
+int64_t processRSS();
+
+//! \cond HIDDEN_SYMBOLS
+
+/*!
+ * \brief Scope of a callback dispatch: measures its CPU time and calls the profiler hook
+ *
+ * The CPU time is recorded in SocketCounters::callback_cpu. Without ENABLE_PROFILING
+ * this is an empty object, and compiles away.
+ */
+class CallbackProfiler
+{
+public:
+#ifdef ENABLE_PROFILING
+    explicit CallbackProfiler(Socket &socket);
+
+    ~CallbackProfiler();
+
+private:
+    Socket &socket_;
+    ProfilerHook *hook_;
+    int64_t wall0_;
+    int64_t cpu0_;
+#else
+    explicit CallbackProfiler(Socket &) {}
+#endif
+};
+
+//! \endcond
+
+} // namespace b0
+
+#endif // B0__UTILS__PROFILER_H__INCLUDED
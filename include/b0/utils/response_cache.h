@@ -0,0 +1,118 @@
+#ifndef B0__UTILS__RESPONSE_CACHE_H__INCLUDED
+#define B0__UTILS__RESPONSE_CACHE_H__INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include <b0/b0.h>
+#include <b0/message/message_part.h>
+
+namespace b0
+{
+
+/*!
+ * \brief A thread-safe LRU cache of service replies, keyed by the request
+ *
+ * The entries are bounded in number and in total payload size, and expire after a time
+ * to live. Each entry has a validation token (see etag()), which identifies the content
+ * of the reply across processes.
+ *
+ * \sa ServiceServer::setResponseCache(), ServiceClient::setResponseCache()
+ */
+class ResponseCache
+{
+public:
+    //! A cached reply
+    struct Entry
+    {
+        //! The reply parts
+        std::vector<b0::message::MessagePart> parts;
+
+        //! The validation token of the reply
+        std::string etag;
+
+        //! When the entry was stored, or last validated
+        std::chrono::steady_clock::time_point stored;
+    };
+
+    /*!
+     * \brief Set the limits of the cache, emptying it
+     *
+     * At most max_entries replies (0 disables the cache) of max_bytes in total (0 for no
+     * limit) are kept, for ttl milliseconds each (-1 for no limit).
+     */
+    void setLimits(size_t max_entries, long ttl = -1, size_t max_bytes = 0);
+
+    //! Return true if the cache is enabled
+    bool enabled() const;
+
+    /*!
+     * \brief Look up the reply to a request
+     *
+     * Return false if there is none. Otherwise copy it to entry, and set fresh to false if
+     * it is older than the time to live (i.e. must be validated before use).
+     */
+    bool find(const std::string &key, Entry &entry, bool &fresh);
+
+    //! Store the reply to a request, evicting the least recently used ones if over the limits
+    void insert(const std::string &key, std::vector<b0::message::MessagePart> parts, const std::string &etag);
+
+    //! Mark the reply to a request as validated now
+    void touch(const std::string &key);
+
+    //! Remove all the entries
+    void clear();
+
+    //! Return the number of entries
+    size_t size() const;
+
+    //! Return the number of lookups which found a fresh entry
+    uint64_t hits() const;
+
+    //! Return the number of lookups which did not
+    uint64_t misses() const;
+
+    //! Return the key of a request (its payloads and content types)
+    static std::string key(const std::vector<b0::message::MessagePart> &parts);
+
+    //! Return the validation token of a reply (a 64-bit FNV-1a hash, stable across platforms)
+    static std::string etag(const std::vector<b0::message::MessagePart> &parts);
+
+private:
+    //! Remove the least recently used entries while over the limits. The caller must hold mutex_.
+    void evict();
+
+    using LRUList = std::list<std::pair<std::string, Entry> >;
+
+    //! The entries, most recently used first
+    LRUList lru_;
+
+    //! The entries by key
+    std::unordered_map<std::string, LRUList::iterator> index_;
+
+    //! Total size of the payloads of the entries
+    size_t bytes_{0};
+
+    size_t max_entries_{0};
+
+    long ttl_{-1};
+
+    size_t max_bytes_{0};
+
+    std::atomic<uint64_t> hits_{0};
+
+    std::atomic<uint64_t> misses_{0};
+
+    mutable boost::mutex mutex_;
+};
+
+} // namespace b0
+
+#endif // B0__UTILS__RESPONSE_CACHE_H__INCLUDED
@@ -0,0 +1,70 @@
+#ifndef B0__UTILS__SOCKET_PROFILE_H__INCLUDED
+#define B0__UTILS__SOCKET_PROFILE_H__INCLUDED
+
+#include <b0/b0.h>
+
+#include <map>
+#include <string>
+
+#include <boost/optional.hpp>
+
+namespace b0
+{
+
+/*!
+ * \brief A named bundle of ZeroMQ and OS socket options, for a kind of traffic
+ *
+ * The built-in profiles are:
+ *  - "default": changes nothing
+ *  - "low-latency": small queues (HWM 100), immediate, no linger, TCP keepalive, DSCP EF
+ *  - "bulk": large queues (HWM 100000) and kernel buffers (4 MiB), DSCP AF11
+ *  - "lossy-latest": queues of one message (the newest wins), immediate, no linger, DSCP AF41
+ *  - "background": DSCP CS1 (lower than best effort)
+ *
+ * The DSCP marking is set with ZMQ_TOS, and applies to the TCP connections made after it.
+ * "lossy-latest" uses HWMs rather than ZMQ_CONFLATE, which breaks multipart and chunked
+ * envelopes (see b0::Subscriber::setKeepLatest() for the same on the receiving side).
+ *
+ * A profile is applied with b0::Socket::setProfile(), or by pattern to all the matching
+ * sockets (see b0::addSocketProfilePattern()). Profiles can be added or redefined with
+ * b0::setSocketProfile().
+ */
+struct SocketProfile
+{
+    //! ZMQ_RCVHWM (unset: unchanged)
+    boost::optional<int> read_hwm;
+
+    //! ZMQ_SNDHWM (unset: unchanged)
+    boost::optional<int> write_hwm;
+
+    //! ZMQ_IMMEDIATE (unset: unchanged)
+    boost::optional<bool> immediate;
+
+    //! ZMQ_CONFLATE (unset: unchanged; not for multipart or chunked messages)
+    boost::optional<bool> conflate;
+
+    //! ZMQ_LINGER, in milliseconds (unset: unchanged)
+    boost::optional<int> linger;
+
+    //! ZMQ_SNDBUF, the kernel send buffer in bytes (unset: unchanged)
+    boost::optional<int> send_buffer;
+
+    //! ZMQ_RCVBUF, the kernel receive buffer in bytes (unset: unchanged)
+    boost::optional<int> receive_buffer;
+
+    //! ZMQ_TCP_KEEPALIVE: 1 to enable, 0 to disable (unset: unchanged)
+    boost::optional<int> tcp_keepalive;
+
+    //! ZMQ_TCP_KEEPALIVE_IDLE, in seconds (unset: unchanged)
+    boost::optional<int> tcp_keepalive_idle;
+
+    //! ZMQ_TOS, the IP type-of-service byte, i.e. the DSCP shifted left by 2 (unset: unchanged)
+    boost::optional<int> tos;
+
+    //! The built-in profiles, by name
+    static const std::map<std::string, SocketProfile> & builtins();
+};
+
+} // namespace b0
+
+#endif // B0__UTILS__SOCKET_PROFILE_H__INCLUDED
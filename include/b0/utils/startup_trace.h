@@ -0,0 +1,97 @@
+#ifndef B0__UTILS__STARTUP_TRACE_H__INCLUDED
+#define B0__UTILS__STARTUP_TRACE_H__INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <b0/b0.h>
+
+namespace b0
+{
+
+/*!
+ * \brief The durations of the phases of the initialization of a node
+ *
+ * b0::Node::init() records its phases (resolver client, node announcement, heartbeat,
+ * sockets...) and, for each socket, the phases of its init() (remapping, resolution of the
+ * proxy addresses, bind or connect, announcement, graph notification), nested in the phase
+ * which runs them.
+ *
+ * \sa b0::Node::setStartupTrace(), b0::Node::getStartupTrace()
+ */
+class StartupTrace
+{
+public:
+    //! A phase of the initialization
+    struct Phase
+    {
+        //! The name of the phase
+        std::string name;
+
+        //! The name of the socket, for the phases of a socket
+        std::string socket;
+
+        //! Nesting level (0 for the phases of Node::init() itself)
+        int depth{0};
+
+        //! Start time (in microseconds since the epoch)
+        int64_t start_usec{0};
+
+        //! Duration (in microseconds)
+        int64_t duration_usec{0};
+    };
+
+    /*!
+     * \brief Record the duration of a phase, from construction to destruction
+     *
+     * Does nothing if trace is null.
+     */
+    class Scope
+    {
+    public:
+        Scope(StartupTrace *trace, const std::string &name, const std::string &socket = "");
+
+        ~Scope();
+
+    private:
+        StartupTrace *trace_;
+        size_t index_;
+        int64_t start_;
+    };
+
+    //! Clear the phases
+    void clear();
+
+    //! Return the recorded phases, in the order they started
+    const std::vector<Phase> & getPhases() const;
+
+    //! Return the total duration (of the phases at depth 0, in microseconds)
+    int64_t getTotalDuration() const;
+
+    /*!
+     * \brief Return the phases as the events of a Chrome trace (the trace event format of chrome://tracing and Perfetto)
+     *
+     * The events are "complete" events of the given process and thread ids, preceded by a
+     * metadata event naming the thread, separated by commas, without the enclosing brackets.
+     */
+    std::string toChromeTraceEvents(int pid, int tid, const std::string &thread_name) const;
+
+    /*!
+     * \brief Append the phases to a Chrome trace file in the JSON array format
+     *
+     * The file is started with "[" if empty; the closing bracket is left out, which the
+     * format allows, so that the nodes of several processes can append to the same file.
+     */
+    void appendChromeTrace(const std::string &path, int pid, int tid, const std::string &thread_name) const;
+
+private:
+    std::vector<Phase> phases_;
+
+    //! Depth of the next phase
+    int depth_{0};
+};
+
+} // namespace b0
+
+#endif // B0__UTILS__STARTUP_TRACE_H__INCLUDED
@@ -0,0 +1,92 @@
+#ifndef B0__UTILS__THREAD_CONFIG_H__INCLUDED
+#define B0__UTILS__THREAD_CONFIG_H__INCLUDED
+
+#include <b0/b0.h>
+
+#include <string>
+#include <vector>
+
+namespace b0
+{
+
+/*!
+ * \brief CPU affinity and scheduling of the threads of a role
+ *
+ * The roles are:
+ *  - "spin": the thread calling b0::Node::spin()
+ *  - "heartbeat": the heartbeat thread of the nodes
+ *  - "callback": the callback threads (see b0::Node::setCallbackThreads())
+ *  - "service": the worker threads of b0::ServiceServer
+ *  - "log": the asynchronous logging thread
+ *  - "io": the ZeroMQ I/O threads (applied when the context is created)
+ *
+ * Instead of a list of CPUs, the threads can be bound to a NUMA node, given by its number or
+ * as the node local to a network interface (e.g. the NIC receiving the messages of an ingest
+ * process, so that the I/O threads and the spin loop run on its socket). The threads then run
+ * on the CPUs of that node, and (except the I/O threads, which are created by ZeroMQ) prefer
+ * its memory for their allocations. NUMA is only supported on Linux.
+ *
+ * See b0::setThreadConfig().
+ */
+struct ThreadConfig
+{
+    //! The CPUs the threads may run on (empty: unchanged)
+    std::vector<int> cpus;
+
+    //! Scheduling policy: "other", "fifo" or "rr" (empty: unchanged)
+    std::string policy;
+
+    //! Priority, for the "fifo" and "rr" policies
+    int priority{0};
+
+    //! The NUMA node the threads run on, if cpus is empty (-1: none)
+    int numa_node{-1};
+
+    //! The network interface whose local NUMA node the threads run on, if cpus is empty and numa_node is -1
+    std::string numa_interface;
+
+    //! Return true if this configuration changes nothing
+    bool empty() const;
+
+    //! Return the NUMA node given by numa_node or numa_interface, or -1 if none or unknown
+    int resolvedNUMANode() const;
+
+    //! Return the CPUs the threads may run on: cpus, or the CPUs of the NUMA node (empty: unchanged)
+    std::vector<int> resolvedCPUs() const;
+
+    //! Throw b0::exception::ArgumentError if the policy or the priority are not valid
+    void validate() const;
+
+    //! Parse a list of CPUs such as "0,2-3"
+    static std::vector<int> parseCPUList(const std::string &list);
+
+    //! Return the NUMA node local to a network interface, or -1 if unknown
+    static int numaNodeOfInterface(const std::string &interface_name);
+
+    //! Return the CPUs of a NUMA node, or an empty list if unknown
+    static std::vector<int> numaNodeCPUs(int node);
+
+    //! The known thread roles
+    static const std::vector<std::string> & roles();
+};
+
+/*!
+ * \brief Apply the configuration of a role (see b0::setThreadConfig()) to the calling thread
+ *
+ * \return an error message if it could not be applied (e.g. missing privileges for
+ * SCHED_FIFO, or an unknown NUMA node), or an empty string
+ */
+std::string applyThreadConfig(const std::string &role);
+
+/*!
+ * \brief Apply the configuration of the "io" role to the I/O threads of a ZeroMQ context
+ *
+ * Must be called before the first socket of the context is created. The NUMA memory policy
+ * is not applied to the I/O threads.
+ * Needs ZeroMQ 4.3 or later; ignored otherwise.
+ */
+void configureIOThreads(void *zmq_context);
+
+} // namespace b0
+
+#endif // B0__UTILS__THREAD_CONFIG_H__INCLUDED
@@ -1,9 +1,13 @@
 #ifndef B0__UTILS__TIMESYNC_H__INCLUDED
 #define B0__UTILS__TIMESYNC_H__INCLUDED
 
+#include <atomic>
 #include <cstdint>
+#include <deque>
+#include <utility>
 
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 #include <b0/b0.h>
 
@@ -32,6 +36,11 @@
  *
  *  Each time a new time is received from master clock (tipically in the heartbeat message) the method Node::updateTime() is called, and a new offset is computed.
  *
+ *  The time of the master clock is measured as in NTP: the time in the reply to the heartbeat,
+ *  plus half the round-trip time of the request. The error is then at most half the round-trip
+ *  time, which grows when the request waits in a queue. So the offset used is the one measured
+ *  with the smallest round-trip time among the last few heartbeats (see TimeSync::updateTime()).
+ *
  * \image html timesync_plot2.png "Example time series of the offset, which is computed as the difference between local time and remote time. Note that is not required that the offset is received at fixed intervals, and in fact in this example it is not the case." width=500pt
  *
  *  If we look at the offset as a function of time we see that is discontinuous.
@@ -49,11 +58,31 @@
  *
  * \image html timesync_plot5.png "The resulting adjusted time" width=500pt
  *
+ *  A node can instead follow a simulated clock, published on a topic (see Node::setSimulatedTime()
+ *  and the b0_sim_clock tool), e.g. to run a simulation faster than real time. All the nodes
+ *  following it then have the same time, and no synchronization is done.
+ *
  */
 
 namespace b0
 {
 
+/*!
+ * \brief The clock used as hardware clock by TimeSync
+ *
+ * All the sources count microseconds since the Unix epoch, so that nodes
+ * using different sources can still be synchronized.
+ */
+enum class ClockSource
+{
+    //! The system real time clock (clock_gettime(CLOCK_REALTIME), where available)
+    Realtime,
+    //! A faster, lower resolution (typically 1-4 ms) real time clock (CLOCK_REALTIME_COARSE, Linux only)
+    RealtimeCoarse,
+    //! A monotonic clock not subject to NTP adjustments (CLOCK_MONOTONIC_RAW), anchored to the real time clock when selected
+    MonotonicRaw
+};
+
 /*!
  * \brief The TimeSync class
  *
@@ -78,6 +107,47 @@ public:
      */
     void setMaxSlope(double max_slope);
 
+    /*!
+     * \brief Set the clock used by hardwareTimeUSec() (otherwise B0_CLOCK_SOURCE will be used)
+     *
+     * The B0_CLOCK_SOURCE env var can be set to realtime (the default), realtime_coarse
+     * or monotonic_raw. Sources not available on this platform fall back to Realtime.
+     * Call this before using the node.
+     */
+    void setClockSource(ClockSource source);
+
+    /*!
+     * \brief Return the clock used by hardwareTimeUSec()
+     */
+    ClockSource getClockSource() const;
+
+    /*!
+     * \brief Follow a simulated clock instead of this computer's clock
+     *
+     * While simulated, hardwareTimeUSec() and timeUSec() return the last time given to
+     * setSimulatedTimeUSec() (0 until then), and updateTime() is ignored.
+     */
+    void setSimulated(bool simulated);
+
+    /*!
+     * \brief Return true if following a simulated clock (see setSimulated())
+     */
+    bool isSimulated() const;
+
+    /*!
+     * \brief Advance the simulated clock (an earlier time is ignored, so that time never goes back)
+     *
+     * This method is thread-safe.
+     */
+    void setSimulatedTimeUSec(int64_t time_usec);
+
+    /*!
+     * \brief Wait until the simulated clock reaches the given time, or for at most max_wait_usec of real time
+     *
+     * Return true if the time was reached. This method is thread-safe.
+     */
+    bool waitUntilUSec(int64_t until, int64_t max_wait_usec);
+
     /*!
      * \brief Return this computer's clock time in microseconds
      *
@@ -107,16 +177,66 @@ public:
      */
     virtual void updateTime(int64_t remoteTime);
 
+    /*!
+     * Update the time offset with a time from remote server, measured with a round trip of delay microseconds
+     *
+     * The remote time is the one of the reply plus half the round-trip time. Of the last samples
+     * (8, unless B0_TIMESYNC_WINDOW is set), the one with the smallest delay (the most recent one
+     * in case of a tie) gives the offset, since a longer delay means a larger error.
+     *
+     * This method is thread-safe.
+     */
+    virtual void updateTime(int64_t remoteTime, int64_t delay);
+
+    /*!
+     * Return the round-trip time of the sample giving the offset: the offset is accurate within half of it
+     *
+     * This method is thread-safe.
+     */
+    int64_t getDelay() const;
+
 private:
     /*
      * State variables related to time synchronization
+     *
+     * They are published with a seqlock: writers (serialized by mutex_) make seq_ odd
+     * while updating them, and readers retry if seq_ was odd or changed while reading,
+     * so that timeUSec() never blocks.
      */
-    int64_t target_offset_;
+    std::atomic<int64_t> target_offset_;
     int64_t max_acceptable_offset_;
-    int64_t last_offset_time_;
-    int64_t last_offset_value_;
-    double max_slope_;
+    std::atomic<int64_t> last_offset_time_;
+    std::atomic<int64_t> last_offset_value_;
+    std::atomic<double> max_slope_;
+    std::atomic<uint32_t> seq_;
     boost::mutex mutex_;
+
+    //! The last samples of the offset, with their round-trip time (protected by mutex_)
+    std::deque<std::pair<int64_t, int64_t> > samples_;
+
+    //! Number of samples kept in samples_
+    size_t window_;
+
+    //! Round-trip time of the sample giving target_offset_
+    std::atomic<int64_t> delay_;
+
+    //! The clock used by hardwareTimeUSec()
+    ClockSource clock_source_;
+
+    //! Offset to add to the monotonic clock to get the time since the epoch (ClockSource::MonotonicRaw)
+    int64_t monotonic_base_;
+
+    //! If true, the time is the one of the simulated clock
+    std::atomic<bool> simulated_;
+
+    //! The time of the simulated clock
+    std::atomic<int64_t> simulated_time_;
+
+    //! Protects the waits on the simulated clock
+    boost::mutex simulated_mutex_;
+
+    //! Notified when the simulated clock advances
+    boost::condition_variable simulated_cond_;
 };
 
 } // namespace b0
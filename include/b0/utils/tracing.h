@@ -0,0 +1,243 @@
+#ifndef B0__UTILS__TRACING_H__INCLUDED
+#define B0__UTILS__TRACING_H__INCLUDED
+
+#include <b0/b0.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_ref.hpp>
+
+namespace b0
+{
+
+class Socket;
+
+namespace message
+{
+
+class MessageEnvelopeView;
+
+} // namespace message
+
+/*!
+ * \brief Distributed tracing: propagation of a trace context through messages and service calls
+ *
+ * The trace context travels in the "Traceparent" header of the envelopes, in the W3C Trace
+ * Context format (`00-<trace id>-<span id>-<flags>`), so it interoperates with OpenTelemetry.
+ *
+ * While a subscriber or service callback runs, the context of the message or request it
+ * received is the current context of the thread (see currentContext()): the messages published
+ * and the calls made from inside the callback carry it, so that the causal chain can be followed
+ * across nodes. Receiving, handling, publishing and calling each make a span.
+ *
+ * Spans are recorded only if an exporter is set (see setExporter(), or the B0_TRACE_FILE
+ * environment variable), which also starts new traces for the messages and calls made outside
+ * of any context, subject to the sample ratio (see setSampleRatio()). Recorded spans are queued
+ * and exported in batches from a background thread, off the hot path. Without an exporter, the
+ * contexts received are still propagated.
+ */
+namespace tracing
+{
+
+//! Name of the envelope header carrying the trace context
+constexpr const char *header_name = "Traceparent";
+
+/*!
+ * \brief Identifies a span within a trace
+ */
+struct TraceContext
+{
+    //! High 64 bits of the trace id
+    uint64_t trace_id_high{0};
+
+    //! Low 64 bits of the trace id
+    uint64_t trace_id_low{0};
+
+    //! The span id
+    uint64_t span_id{0};
+
+    //! True if the spans of the trace are recorded
+    bool sampled{false};
+
+    //! Return true if this is an actual trace context
+    bool isValid() const;
+
+    //! Return the trace id as 32 hex digits
+    std::string traceIdHex() const;
+
+    //! Return the span id as 16 hex digits
+    std::string spanIdHex() const;
+
+    //! Format as the value of a Traceparent header
+    std::string toTraceparent() const;
+
+    //! Parse the value of a Traceparent header; return false if it is not valid
+    static bool fromTraceparent(boost::string_ref value, TraceContext &context);
+};
+
+//! \brief Kind of a span (same values as OpenTelemetry's SpanKind)
+enum class SpanKind
+{
+    //! Internal operation
+    Internal = 1,
+    //! Handling of a service request
+    Server = 2,
+    //! Service call, from the request to the reply
+    Client = 3,
+    //! Publishing of a message
+    Producer = 4,
+    //! Subscriber callback
+    Consumer = 5
+};
+
+/*!
+ * \brief A recorded span
+ */
+struct Span
+{
+    //! Trace and span ids
+    TraceContext context;
+
+    //! Id of the parent span (0 for the root of a trace)
+    uint64_t parent_span_id{0};
+
+    //! Name: the topic or service of the socket
+    std::string name;
+
+    //! Kind of the span
+    SpanKind kind{SpanKind::Internal};
+
+    //! Name of the node of the socket
+    std::string node_name;
+
+    //! Start time, in microseconds since the Unix epoch (0 if not recorded)
+    int64_t start_time{0};
+
+    //! End time, in microseconds since the Unix epoch
+    int64_t end_time{0};
+};
+
+/*!
+ * \brief Receives the recorded spans, in batches, from the background thread
+ */
+class SpanExporter
+{
+public:
+    virtual ~SpanExporter();
+
+    //! Export a batch of spans; exceptions are caught and logged
+    virtual void exportSpans(const std::vector<Span> &spans) = 0;
+};
+
+/*!
+ * \brief Exporter appending the spans to a file, in the OpenTelemetry (OTLP) JSON format
+ *
+ * Each batch is written as one line, an ExportTraceServiceRequest object, as written by the
+ * OpenTelemetry collector's file exporter, which can read it back (otlpjsonfile receiver).
+ */
+class FileSpanExporter : public SpanExporter
+{
+public:
+    //! Open the file for appending; service_name is the service.name resource attribute
+    FileSpanExporter(const std::string &path, const std::string &service_name = "bluezero");
+
+    ~FileSpanExporter();
+
+    void exportSpans(const std::vector<Span> &spans) override;
+
+private:
+    //! The file
+    std::FILE *file_;
+
+    //! The service.name resource attribute
+    std::string service_name_;
+};
+
+/*!
+ * \brief Set the exporter of the recorded spans (nullptr to stop recording spans)
+ *
+ * Removing or replacing the exporter exports the queued spans first.
+ */
+void setExporter(std::shared_ptr<SpanExporter> exporter);
+
+//! Return true if spans are recorded, i.e. an exporter is set
+bool isEnabled();
+
+/*!
+ * \brief Set the fraction of the new traces whose spans are recorded (between 0 and 1, default 1)
+ *
+ * The decision is taken where a trace starts, and followed by all the nodes it goes through.
+ * It can also be set with the B0_TRACE_SAMPLE_RATIO environment variable.
+ */
+void setSampleRatio(double ratio);
+
+//! Return the sample ratio (see setSampleRatio())
+double getSampleRatio();
+
+//! Export the queued spans now, from the calling thread
+void flush();
+
+//! Return the number of spans dropped because the export queue was full
+uint64_t getDroppedSpanCount();
+
+//! Return the trace context of the callback running in this thread (not valid if none)
+TraceContext currentContext();
+
+//! \cond HIDDEN_SYMBOLS
+
+/*!
+ * \brief Start a span of a socket, child of parent (or of the current context if not valid)
+ *
+ * If there is no parent, a new trace is started if tracing is enabled. The span is recorded
+ * only if its trace is sampled and tracing is enabled; otherwise its context is the parent's.
+ * Return false if the span has no valid context (i.e. there is nothing to propagate).
+ */
+bool startSpan(Span &span, SpanKind kind, const Socket &socket, const TraceContext &parent = TraceContext());
+
+//! End a span started with startSpan(), and queue it for export if it is recorded
+void endSpan(Span &span);
+
+//! Set the Traceparent header of an outgoing envelope to the context of a span, if valid
+void inject(std::map<std::string, std::string> &headers, const Span &span);
+
+//! Read the Traceparent header of an incoming envelope; return false if absent or not valid
+bool extract(const std::map<std::string, std::string> &headers, TraceContext &context);
+
+//! Read the Traceparent header of an incoming envelope, without parsing the other headers
+bool extract(const b0::message::MessageEnvelopeView &env, TraceContext &context);
+
+/*!
+ * \brief Span of a callback, whose context is the current context of the thread while it exists
+ */
+class Scope
+{
+public:
+    //! Start the span (see startSpan()) and make it current
+    Scope(SpanKind kind, const Socket &socket, const TraceContext &parent);
+
+    //! End the span and restore the previous current context
+    ~Scope();
+
+private:
+    //! The span of the callback
+    Span span_;
+
+    //! The current context before this scope
+    TraceContext previous_;
+
+    //! True if this scope changed the current context
+    bool active_;
+};
+
+//! \endcond
+
+} // namespace tracing
+
+} // namespace b0
+
+#endif // B0__UTILS__TRACING_H__INCLUDED
@@ -0,0 +1,344 @@
+#ifndef B0__WORK_QUEUE_H__INCLUDED
+#define B0__WORK_QUEUE_H__INCLUDED
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include <b0/b0.h>
+#include <b0/socket.h>
+#include <b0/message/message_part.h>
+
+namespace b0
+{
+
+class Node;
+
+/*!
+ * \brief The producer of a work queue, whose jobs are spread over competing workers
+ *
+ * Unlike a topic, where every subscriber receives every message, each job pushed to a work
+ * queue is delivered to one of its workers (see b0::WorkQueueWorker). The workers ask for
+ * jobs by granting credits to the producer: a job is only sent to a worker with a credit
+ * left, and a worker gives a credit back when it is done with a job. The jobs thus go to the
+ * idle workers, and the job stream scales with the number of workers.
+ *
+ * This class wraps a ROUTER socket. It binds to a free port and announces it to resolver as
+ * a service with the name of the queue (the names of the services and of the work queues are
+ * shared). The jobs waiting for a worker are queued by the producer (see setQueueLimit()).
+ *
+ * A worker which is not heard from for a few seconds is forgotten, with its credits. The jobs
+ * it was sent are lost, i.e. each job is delivered at most once.
+ *
+ * \sa b0::WorkQueueWorker
+ */
+class WorkQueueProducer : public Socket
+{
+public:
+    using logger::LogInterface::log;
+
+    /*!
+     * \brief Construct a WorkQueueProducer child of the specified Node
+     */
+    WorkQueueProducer(Node *node, const std::string &queue_name, bool managed = true, bool notify_graph = true);
+
+    /*!
+     * \brief WorkQueueProducer destructor
+     */
+    virtual ~WorkQueueProducer();
+
+    /*!
+     * \brief Log a message using node's logger, prepending this producer informations
+     */
+    void log(logger::Level level, const std::string &message) const override;
+
+    /*!
+     * \brief Perform initialization (bind and announce the queue) and optionally send graph notify
+     */
+    virtual void init() override;
+
+    /*!
+     * \brief Perform cleanup and optionally send graph notify
+     */
+    virtual void cleanup() override;
+
+    /*!
+     * \brief Read the credits of the workers, and send them the jobs waiting
+     */
+    virtual void spinOnce() override;
+
+    /*!
+     * \brief Return true, as the credits of the workers are read by spinOnce()
+     */
+    virtual bool hasCallback() const override;
+
+    /*!
+     * \brief Return true if jobs are waiting while a worker has a credit left
+     */
+    virtual bool hasPendingMessages() const override;
+
+    /*!
+     * \brief Return the name of the queue
+     */
+    std::string getQueueName();
+
+    /*!
+     * \brief Push a raw multipart job
+     *
+     * The job is sent at once if a worker has a credit left, otherwise it waits in the queue
+     * of the producer for spinOnce() to send it.
+     *
+     * \return false if the queue is full (see setQueueLimit()), and the job was dropped
+     */
+    bool push(std::vector<b0::message::MessagePart> &&parts);
+
+    /*!
+     * \brief Push a raw job (see push(std::vector<b0::message::MessagePart>&&))
+     */
+    bool push(const std::string &job, const std::string &type = "");
+
+    /*!
+     * \brief Push a job (see push(std::vector<b0::message::MessagePart>&&))
+     */
+    template<class TMsg>
+    bool push(const TMsg &job)
+    {
+        std::vector<b0::message::MessagePart> parts(1);
+        serialize(job, parts[0].payload, parts[0].content_type, getMessageCodec());
+        return push(std::move(parts));
+    }
+
+    /*!
+     * \brief Set the maximum number of jobs waiting for a worker (default: 1000)
+     */
+    void setQueueLimit(size_t max_jobs);
+
+    //! Return the maximum number of jobs waiting for a worker (see setQueueLimit())
+    size_t getQueueLimit() const;
+
+    //! Return the number of jobs waiting for a worker
+    size_t getQueueSize() const;
+
+    //! Return the number of workers heard from recently
+    size_t getWorkerCount() const;
+
+    //! Return the number of jobs sent to the workers
+    uint64_t getSentCount() const;
+
+    //! Return the number of jobs dropped because the queue was full (see setQueueLimit())
+    uint64_t getDroppedCount() const;
+
+protected:
+    //! Send the jobs waiting to the workers with credits left
+    void sendJobs();
+
+    //! Send a job to a worker with a credit left, if any
+    //! \return false if no worker has a credit left
+    bool sendJob(std::vector<b0::message::MessagePart> &parts);
+
+    //! Read the credit and heartbeat messages of the workers
+    void readCredits();
+
+    //! Forget the workers not heard from for too long
+    void expireWorkers();
+
+    //! If false this socket will not send announcement to resolv (i.e. it will be "invisible")
+    const bool notify_graph_;
+
+    //! The state of a worker, as known by the producer
+    struct Worker
+    {
+        //! Routing frames of the worker (see Socket::getRoute())
+        std::vector<std::string> route;
+
+        //! Number of jobs the worker can be sent
+        unsigned credit{0};
+
+        //! Last time a message of the worker arrived
+        std::chrono::steady_clock::time_point last_seen;
+    };
+
+    //! The known workers, by their routing frames
+    std::map<std::vector<std::string>, Worker> workers_;
+
+    //! The worker the last job was sent to, where the next search for a credit starts
+    std::vector<std::string> last_worker_;
+
+    //! The jobs waiting for a worker
+    std::deque<std::vector<b0::message::MessagePart> > jobs_;
+
+    //! Maximum number of jobs in jobs_
+    size_t queue_limit_{1000};
+
+    //! Number of jobs sent
+    uint64_t sent_{0};
+
+    //! Number of jobs dropped
+    uint64_t dropped_{0};
+
+    //! Address the socket is bound to
+    std::string bind_addr_;
+
+    //! Address announced to resolver
+    std::string remote_addr_;
+
+    //! IPC endpoint announced to resolver (see Socket::bindIPC())
+    std::string ipc_addr_;
+
+    //! Envelope the messages of the workers are read into
+    b0::message::MessageEnvelope read_envelope_;
+};
+
+/*!
+ * \brief A worker of a work queue, receiving its share of the jobs (see b0::WorkQueueProducer)
+ *
+ * This class wraps a DEALER socket. It resolves the address of the producer through the
+ * resolver, connects to it, and grants it setCredit() credits: the producer sends at most that
+ * many jobs ahead of the callback. spinOnce() calls the callback for each job received, then
+ * gives its credit back. The worker also sends heartbeats while the queue is idle, which make
+ * a restarted producer learn its credits again.
+ *
+ * \sa b0::WorkQueueProducer
+ */
+class WorkQueueWorker : public Socket
+{
+public:
+    using logger::LogInterface::log;
+
+    //! \brief Alias for function
+    template<typename T> using function = boost::function<T>;
+
+    //! \brief Alias for callback raw without type
+    using CallbackRaw = function<void(const std::string&)>;
+
+    //! \brief Alias for callback raw message parts
+    using CallbackParts = function<void(const std::vector<b0::message::MessagePart>&)>;
+
+    //! \brief Alias for callback message class
+    template<class TMsg> using CallbackMsg = function<void(const TMsg&)>;
+
+    /*!
+     * \brief Construct a WorkQueueWorker child of the specified Node, using a function as callback (raw without type)
+     */
+    WorkQueueWorker(Node *node, const std::string &queue_name, CallbackRaw callback, bool managed = true, bool notify_graph = true);
+
+    /*!
+     * \brief Construct a WorkQueueWorker child of the specified Node, using a function as callback (raw message parts)
+     */
+    WorkQueueWorker(Node *node, const std::string &queue_name, CallbackParts callback, bool managed = true, bool notify_graph = true);
+
+    /*!
+     * \brief Construct a WorkQueueWorker child of the specified Node, using a function as callback (message class)
+     */
+    template<class TMsg>
+    WorkQueueWorker(Node *node, const std::string &queue_name, CallbackMsg<TMsg> callback, bool managed = true, bool notify_graph = true)
+        : WorkQueueWorker(node, queue_name,
+                static_cast<CallbackParts>([&, callback](const std::vector<b0::message::MessagePart> &parts) {
+                    TMsg msg;
+                    parse(msg, parts[0].payload, parts[0].content_type);
+                    callback(msg);
+                }), managed, notify_graph)
+    {}
+
+    /*!
+     * \brief WorkQueueWorker destructor
+     */
+    virtual ~WorkQueueWorker();
+
+    /*!
+     * \brief Log a message using node's logger, prepending this worker informations
+     */
+    void log(logger::Level level, const std::string &message) const override;
+
+    /*!
+     * \brief Perform initialization (resolve the queue, connect and grant the credits) and optionally send graph notify
+     */
+    virtual void init() override;
+
+    /*!
+     * \brief Perform cleanup and optionally send graph notify
+     */
+    virtual void cleanup() override;
+
+    /*!
+     * \brief Call the callback for the jobs received, and give the credits back
+     */
+    virtual void spinOnce() override;
+
+    /*!
+     * \brief Return true if a callback has been set
+     */
+    virtual bool hasCallback() const override;
+
+    /*!
+     * \brief Return true if a heartbeat is due
+     */
+    virtual bool hasPendingMessages() const override;
+
+    /*!
+     * \brief Return the name of the queue
+     */
+    std::string getQueueName();
+
+    /*!
+     * \brief Set the number of jobs the producer can send ahead of the callback (must be called before init())
+     *
+     * With 1, the default, a job goes to a worker only when it is idle, which spreads the jobs
+     * best over workers of different speeds. More credits hide the latency of the network
+     * between the jobs, at the cost of jobs waiting for a busy worker while another is idle.
+     */
+    void setCredit(unsigned credit);
+
+    //! Return the number of jobs the producer can send ahead of the callback (see setCredit())
+    unsigned getCredit() const;
+
+    //! Return the number of jobs processed
+    uint64_t getProcessedCount() const;
+
+    /*!
+     * \brief Set the address of the producer, skipping the resolution (must be called before init())
+     */
+    void setRemoteAddress(const std::string &addr);
+
+protected:
+    //! Send a credit message: an increment, or the whole credit if absolute
+    void sendCredit(unsigned credit, bool absolute);
+
+    //! If false this socket will not send announcement to resolv (i.e. it will be "invisible")
+    const bool notify_graph_;
+
+    //! Callback called with each job
+    CallbackRaw callback_;
+
+    //! Callback called with each job (raw message parts)
+    CallbackParts callback_multipart_;
+
+    //! Number of jobs the producer can send ahead of the callback
+    unsigned credit_{1};
+
+    //! Number of jobs processed
+    uint64_t processed_{0};
+
+    //! Time of the next heartbeat
+    std::chrono::steady_clock::time_point next_heartbeat_;
+
+    //! True if a job arrived since the last heartbeat
+    bool busy_{false};
+
+    //! Addresses of the producers
+    std::vector<std::string> remote_addrs_;
+
+    //! The address set with setRemoteAddress(), if any
+    std::string remote_addr_;
+
+    //! Envelope the jobs are read into
+    b0::message::MessageEnvelope read_envelope_;
+};
+
+} // namespace b0
+
+#endif // B0__WORK_QUEUE_H__INCLUDED
@@ -1,5 +1,10 @@
 #include <b0/b0.h>
 #include <b0/utils/env.h>
+#include <b0/utils/thread_config.h>
+#include <b0/utils/socket_profile.h>
+#include <b0/exception/argument_error.h>
+#include <b0/utils/tracing.h>
+#include <b0/utils/buffer_pool.h>
 #include <b0/node.h>
 #include <b0/logger/logger.h>
 
@@ -12,6 +17,7 @@
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string_regex.hpp>
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
@@ -53,11 +59,72 @@ struct Global::Private
     std::map<std::string, std::string> remap_topic_;
     std::map<std::string, std::string> remap_service_;
     logger::Level console_log_level_{logger::Level::info};
+    logger::Level remote_log_level_{logger::Level::trace};
     boost::program_options::options_description options_description_{"Allowed options"};
     boost::program_options::positional_options_description positional_options_description_;
     boost::program_options::variables_map variables_map_;
     std::atomic<bool> quit_flag_{false};
     double spin_rate_{10.0};
+    int io_threads_{1};
+    bool priority_io_thread_{false};
+    bool shared_context_{false};
+    bool intra_process_{false};
+    bool peer_to_peer_{false};
+#ifdef _WIN32
+    bool ipc_{false};
+#else
+    bool ipc_{true};
+#endif
+    std::string ipc_directory_{"/tmp"};
+    bool async_logging_{false};
+    bool hierarchical_log_topics_{false};
+    int compression_threads_{0};
+    bool in_place_json_decoding_{true};
+    int linger_period_{5000};
+    int spin_budget_{0};
+    bool service_cache_{false};
+    int service_client_pool_{0};
+    bool heartbeat_coalescing_{false};
+    bool process_agent_{false};
+    bool inline_heartbeats_{false};
+    bool embedded_profile_{false};
+    bool memory_accounting_{false};
+    boost::mutex buffer_allocator_mutex_;
+    std::shared_ptr<BufferAllocator> buffer_allocator_;
+    //! The allocators set before, kept for the messages they allocated
+    std::vector<std::shared_ptr<BufferAllocator> > old_buffer_allocators_;
+    bool heartbeat_stats_{false};
+    bool connection_monitor_{false};
+    bool connection_monitor_warnings_{false};
+    bool simulated_time_{false};
+    bool decentralized_{false};
+    std::map<std::string, ThreadConfig> thread_configs_;
+    std::map<std::string, SocketProfile> socket_profiles_{SocketProfile::builtins()};
+    std::vector<std::pair<std::string, std::string> > socket_profile_patterns_;
+
+    //! Set the defaults of the embedded profile (see b0::setEmbeddedProfile())
+    void applyEmbeddedProfile()
+    {
+        io_threads_ = 1;
+        priority_io_thread_ = false;
+        async_logging_ = false;
+        compression_threads_ = 0;
+        heartbeat_coalescing_ = false;
+        process_agent_ = false;
+        inline_heartbeats_ = true;
+    }
+
+    //! The pool of the embedded profile, sized by the B0_EMBEDDED_BUFFER_SIZE and B0_EMBEDDED_BUFFERS env vars
+    std::shared_ptr<BufferAllocator> embeddedBufferPool()
+    {
+        int size = b0::env::getInt("B0_EMBEDDED_BUFFER_SIZE", 65536);
+        int count = b0::env::getInt("B0_EMBEDDED_BUFFERS", 16);
+        if(size <= 0)
+            throw exception::ArgumentError(std::to_string(size), "B0_EMBEDDED_BUFFER_SIZE");
+        if(count < 0)
+            throw exception::ArgumentError(std::to_string(count), "B0_EMBEDDED_BUFFERS");
+        return std::make_shared<FixedBufferPool>(size_t(size), size_t(count));
+    }
 
     void init(Global &g, po::command_line_parser &parser, const std::string &argv0)
     {
@@ -72,6 +139,81 @@ struct Global::Private
         {
             console_log_level_ = logger::levelInfo(console_loglevel).level;
         }
+        std::string remote_loglevel = b0::env::get("B0_REMOTE_LOGLEVEL");
+        if(remote_loglevel != "")
+        {
+            remote_log_level_ = logger::levelInfo(remote_loglevel).level;
+        }
+        // (the other env vars override the defaults of the profile)
+        embedded_profile_ = b0::env::getBool("B0_EMBEDDED_PROFILE", embedded_profile_);
+        if(embedded_profile_)
+            applyEmbeddedProfile();
+        io_threads_ = b0::env::getInt("B0_IO_THREADS", io_threads_);
+        priority_io_thread_ = b0::env::getBool("B0_PRIORITY_IO_THREAD", priority_io_thread_);
+        shared_context_ = b0::env::getBool("B0_SHARED_CONTEXT", shared_context_);
+        intra_process_ = b0::env::getBool("B0_INTRAPROCESS", intra_process_);
+        peer_to_peer_ = b0::env::getBool("B0_PEER_TO_PEER", peer_to_peer_);
+        ipc_ = b0::env::getBool("B0_IPC", ipc_);
+        ipc_directory_ = b0::env::get("B0_IPC_DIR", ipc_directory_);
+        async_logging_ = b0::env::getBool("B0_ASYNC_LOGGING", async_logging_);
+        hierarchical_log_topics_ = b0::env::getBool("B0_HIERARCHICAL_LOG_TOPICS", hierarchical_log_topics_);
+        compression_threads_ = b0::env::getInt("B0_COMPRESSION_THREADS", compression_threads_);
+        in_place_json_decoding_ = b0::env::getBool("B0_IN_PLACE_JSON_DECODING", in_place_json_decoding_);
+        linger_period_ = b0::env::getInt("B0_LINGER_PERIOD", linger_period_);
+        spin_budget_ = b0::env::getInt("B0_SPIN_BUDGET", spin_budget_);
+        service_cache_ = b0::env::getBool("B0_SERVICE_CACHE", service_cache_);
+        service_client_pool_ = b0::env::getInt("B0_SERVICE_CLIENT_POOL", service_client_pool_);
+        heartbeat_coalescing_ = b0::env::getBool("B0_HEARTBEAT_COALESCING", heartbeat_coalescing_);
+        process_agent_ = b0::env::getBool("B0_PROCESS_AGENT", process_agent_);
+        inline_heartbeats_ = b0::env::getBool("B0_INLINE_HEARTBEATS", inline_heartbeats_);
+        memory_accounting_ = b0::env::getBool("B0_MEMORY_ACCOUNTING", memory_accounting_);
+        if(b0::env::getBool("B0_BUFFER_POOL"))
+        {
+            std::shared_ptr<BufferPool> pool = std::make_shared<BufferPool>();
+            pool->setHugePages(b0::env::getBool("B0_BUFFER_POOL_HUGE_PAGES"));
+            ThreadConfig numa;
+            numa.numa_node = b0::env::getInt("B0_NUMA_NODE", -1);
+            numa.numa_interface = b0::env::get("B0_NUMA_INTERFACE");
+            pool->setNUMANode(b0::env::getInt("B0_BUFFER_POOL_NUMA_NODE", numa.resolvedNUMANode()));
+            g.setBufferAllocator(pool);
+        }
+        else if(embedded_profile_ && !g.getBufferAllocator())
+            g.setBufferAllocator(embeddedBufferPool());
+        heartbeat_stats_ = b0::env::getBool("B0_HEARTBEAT_STATS", heartbeat_stats_);
+        connection_monitor_ = b0::env::getBool("B0_CONNECTION_MONITOR", connection_monitor_);
+        connection_monitor_warnings_ = b0::env::getBool("B0_CONNECTION_MONITOR_WARN", connection_monitor_warnings_);
+        simulated_time_ = b0::env::getBool("B0_SIMULATED_TIME", simulated_time_);
+        decentralized_ = b0::env::getBool("B0_DECENTRALIZED", decentralized_);
+        tracing::setSampleRatio(b0::env::getDouble("B0_TRACE_SAMPLE_RATIO", tracing::getSampleRatio()));
+        std::string trace_file = b0::env::get("B0_TRACE_FILE");
+        if(trace_file != "")
+        {
+            std::string service_name = boost::filesystem::path(argv0).filename().string();
+            tracing::setExporter(std::make_shared<tracing::FileSpanExporter>(trace_file, service_name.empty() ? "bluezero" : service_name));
+        }
+        int numa_node = b0::env::getInt("B0_NUMA_NODE", -1);
+        std::string numa_interface = b0::env::get("B0_NUMA_INTERFACE");
+        for(const std::string &role : ThreadConfig::roles())
+        {
+            std::string prefix = "B0_THREAD_" + boost::algorithm::to_upper_copy(role) + "_";
+            ThreadConfig &c = thread_configs_[role];
+            std::string cpus = b0::env::get(prefix + "CPUS");
+            if(cpus != "") c.cpus = ThreadConfig::parseCPUList(cpus);
+            c.policy = b0::env::get(prefix + "POLICY", c.policy);
+            c.priority = b0::env::getInt(prefix + "PRIORITY", c.priority);
+            // (the B0_NUMA_* defaults are for the threads of the data path)
+            bool data_path = role == "spin" || role == "io" || role == "callback";
+            c.numa_node = b0::env::getInt(prefix + "NUMA_NODE", data_path ? numa_node : c.numa_node);
+            c.numa_interface = b0::env::get(prefix + "NUMA_INTERFACE", data_path ? numa_interface : c.numa_interface);
+            c.validate();
+        }
+        std::string socket_profiles = b0::env::get("B0_SOCKET_PROFILES");
+        if(socket_profiles != "")
+        {
+            std::vector<std::string> assignments;
+            boost::split(assignments, socket_profiles, boost::is_any_of(":;"));
+            g.addSocketProfilePatterns(assignments);
+        }
 
         // process arguments:
         using str_vec = std::vector<std::string>;
@@ -81,8 +223,10 @@ struct Global::Private
             ("remap-node,N", po::value<str_vec>()->value_name("oldName=newName")->multitoken()->notifier(boost::bind(&Global::addNodeRemapings, &g, _1)), "remap a node name")
             ("remap-topic,T", po::value<str_vec>()->value_name("oldName=newName")->multitoken()->notifier(boost::bind(&Global::addTopicRemapings, &g, _1)), "remap a topic name")
             ("remap-service,S", po::value<str_vec>()->value_name("oldName=newName")->multitoken()->notifier(boost::bind(&Global::addServiceRemapings, &g, _1)), "remap a service name")
+            ("socket-profile", po::value<str_vec>()->value_name("pattern=profile")->multitoken()->notifier(boost::bind(&Global::addSocketProfilePatterns, &g, _1)), "apply a socket profile to the matching sockets")
             ("console-loglevel,L", po::value<std::string>()->default_value(logger::levelInfo(console_log_level_).str), "specify the console loglevel")
             ("spin-rate,F", po::value<double>()->default_value(spin_rate_), "specify the default spin rate")
+            ("io-threads", po::value<int>()->default_value(io_threads_), "specify the number of ZeroMQ I/O threads")
         ;
         try
         {
@@ -114,6 +258,11 @@ struct Global::Private
             spin_rate_ = variables_map_["spin-rate"].as<double>();
         }
 
+        if(variables_map_.count("io-threads"))
+        {
+            io_threads_ = variables_map_["io-threads"].as<int>();
+        }
+
         initialized_ = true;
     }
 };
@@ -181,6 +330,16 @@ void Global::addServiceRemapings(const std::vector<std::string> &raw_arg)
     }
 }
 
+void Global::addSocketProfilePatterns(const std::vector<std::string> &raw_arg)
+{
+    for(auto &s : raw_arg)
+    {
+        if(s.empty()) continue;
+        auto x = splitAssignment(s);
+        addSocketProfilePattern(x[0], x[1]);
+    }
+}
+
 void Global::addRemaping(const std::string &orig_name, const std::string &new_name)
 {
     addNodeRemaping(orig_name, new_name);
@@ -450,6 +609,16 @@ void Global::setConsoleLogLevel(logger::Level level)
     private_->console_log_level_ = level;
 }
 
+logger::Level Global::getRemoteLogLevel()
+{
+    return private_->remote_log_level_;
+}
+
+void Global::setRemoteLogLevel(logger::Level level)
+{
+    private_->remote_log_level_ = level;
+}
+
 double Global::getSpinRate()
 {
     return private_->spin_rate_;
@@ -462,6 +631,318 @@ void Global::setSpinRate(double rate)
     private_->spin_rate_ = rate;
 }
 
+int Global::getIOThreads()
+{
+    return private_->io_threads_;
+}
+
+void Global::setIOThreads(int n)
+{
+    if(n < 0)
+        throw std::range_error("Number of I/O threads must not be negative");
+    private_->io_threads_ = n;
+}
+
+bool Global::getPriorityIOThread()
+{
+    return private_->priority_io_thread_;
+}
+
+void Global::setPriorityIOThread(bool reserved)
+{
+    private_->priority_io_thread_ = reserved;
+}
+
+bool Global::getSharedContext()
+{
+    return private_->shared_context_;
+}
+
+void Global::setSharedContext(bool shared)
+{
+    private_->shared_context_ = shared;
+}
+
+bool Global::getIntraProcess()
+{
+    return private_->intra_process_;
+}
+
+void Global::setIntraProcess(bool enabled)
+{
+    private_->intra_process_ = enabled;
+}
+
+bool Global::getPeerToPeer()
+{
+    // without a resolver there is no proxy
+    return private_->peer_to_peer_ || private_->decentralized_;
+}
+
+void Global::setPeerToPeer(bool enabled)
+{
+    private_->peer_to_peer_ = enabled;
+}
+
+bool Global::getIPC()
+{
+    return private_->ipc_;
+}
+
+void Global::setIPC(bool enabled)
+{
+    private_->ipc_ = enabled;
+}
+
+std::string Global::getIPCDirectory()
+{
+    return private_->ipc_directory_;
+}
+
+void Global::setIPCDirectory(const std::string &dir)
+{
+    private_->ipc_directory_ = dir;
+}
+
+bool Global::getAsyncLogging()
+{
+    return private_->async_logging_;
+}
+
+void Global::setAsyncLogging(bool enabled)
+{
+    private_->async_logging_ = enabled;
+}
+
+bool Global::getHierarchicalLogTopics()
+{
+    return private_->hierarchical_log_topics_;
+}
+
+void Global::setHierarchicalLogTopics(bool enabled)
+{
+    private_->hierarchical_log_topics_ = enabled;
+}
+
+int Global::getCompressionThreads()
+{
+    return private_->compression_threads_;
+}
+
+void Global::setCompressionThreads(int n)
+{
+    private_->compression_threads_ = n;
+}
+
+bool Global::getInPlaceJSONDecoding()
+{
+    return private_->in_place_json_decoding_;
+}
+
+void Global::setInPlaceJSONDecoding(bool enabled)
+{
+    private_->in_place_json_decoding_ = enabled;
+}
+
+int Global::getLingerPeriod()
+{
+    return private_->linger_period_;
+}
+
+void Global::setLingerPeriod(int period)
+{
+    private_->linger_period_ = period;
+}
+
+int Global::getSpinBudget()
+{
+    return private_->spin_budget_;
+}
+
+void Global::setSpinBudget(int max_messages)
+{
+    private_->spin_budget_ = max_messages;
+}
+
+bool Global::getServiceCache()
+{
+    return private_->service_cache_;
+}
+
+void Global::setServiceCache(bool enabled)
+{
+    private_->service_cache_ = enabled;
+}
+
+int Global::getServiceClientPool()
+{
+    return private_->service_client_pool_;
+}
+
+void Global::setServiceClientPool(int max_idle)
+{
+    private_->service_client_pool_ = max_idle;
+}
+
+bool Global::getHeartbeatCoalescing()
+{
+    return private_->heartbeat_coalescing_;
+}
+
+void Global::setHeartbeatCoalescing(bool enabled)
+{
+    private_->heartbeat_coalescing_ = enabled;
+}
+
+bool Global::getProcessAgent()
+{
+    return private_->process_agent_;
+}
+
+void Global::setProcessAgent(bool enabled)
+{
+    private_->process_agent_ = enabled;
+}
+
+bool Global::getInlineHeartbeats()
+{
+    return private_->inline_heartbeats_;
+}
+
+void Global::setInlineHeartbeats(bool enabled)
+{
+    private_->inline_heartbeats_ = enabled;
+}
+
+bool Global::getEmbeddedProfile()
+{
+    return private_->embedded_profile_;
+}
+
+void Global::setEmbeddedProfile(bool enabled)
+{
+    private_->embedded_profile_ = enabled;
+    if(!enabled)
+    {
+        private_->inline_heartbeats_ = false;
+        return;
+    }
+    private_->applyEmbeddedProfile();
+    if(!getBufferAllocator())
+        setBufferAllocator(private_->embeddedBufferPool());
+}
+
+std::shared_ptr<BufferAllocator> Global::getBufferAllocator()
+{
+    boost::mutex::scoped_lock lock(private_->buffer_allocator_mutex_);
+    return private_->buffer_allocator_;
+}
+
+void Global::setBufferAllocator(std::shared_ptr<BufferAllocator> allocator)
+{
+    boost::mutex::scoped_lock lock(private_->buffer_allocator_mutex_);
+    if(private_->buffer_allocator_)
+        private_->old_buffer_allocators_.push_back(private_->buffer_allocator_);
+    private_->buffer_allocator_ = allocator;
+}
+
+bool Global::getMemoryAccounting()
+{
+    return private_->memory_accounting_;
+}
+
+void Global::setMemoryAccounting(bool enabled)
+{
+    private_->memory_accounting_ = enabled;
+}
+
+bool Global::getHeartbeatStats()
+{
+    return private_->heartbeat_stats_;
+}
+
+void Global::setHeartbeatStats(bool enabled)
+{
+    private_->heartbeat_stats_ = enabled;
+}
+
+bool Global::getConnectionMonitor()
+{
+    return private_->connection_monitor_;
+}
+
+void Global::setConnectionMonitor(bool enabled)
+{
+    private_->connection_monitor_ = enabled;
+}
+
+bool Global::getConnectionMonitorWarnings()
+{
+    return private_->connection_monitor_warnings_;
+}
+
+void Global::setConnectionMonitorWarnings(bool enabled)
+{
+    private_->connection_monitor_warnings_ = enabled;
+}
+
+bool Global::getSimulatedTime()
+{
+    return private_->simulated_time_;
+}
+
+void Global::setSimulatedTime(bool enabled)
+{
+    private_->simulated_time_ = enabled;
+}
+
+bool Global::getDecentralized()
+{
+    return private_->decentralized_;
+}
+
+void Global::setDecentralized(bool enabled)
+{
+    private_->decentralized_ = enabled;
+}
+
+ThreadConfig Global::getThreadConfig(const std::string &role)
+{
+    auto it = private_->thread_configs_.find(role);
+    return it == private_->thread_configs_.end() ? ThreadConfig() : it->second;
+}
+
+void Global::setThreadConfig(const std::string &role, const ThreadConfig &config)
+{
+    config.validate();
+    private_->thread_configs_[role] = config;
+}
+
+SocketProfile Global::getSocketProfile(const std::string &name)
+{
+    auto it = private_->socket_profiles_.find(name);
+    if(it == private_->socket_profiles_.end())
+        throw exception::ArgumentError(name, "profile");
+    return it->second;
+}
+
+void Global::setSocketProfile(const std::string &name, const SocketProfile &profile)
+{
+    private_->socket_profiles_[name] = profile;
+}
+
+void Global::addSocketProfilePattern(const std::string &pattern, const std::string &profile)
+{
+    if(!private_->socket_profiles_.count(profile))
+        throw exception::ArgumentError(profile, "profile");
+    private_->socket_profile_patterns_.push_back(std::make_pair(pattern, profile));
+}
+
+std::vector<std::pair<std::string, std::string> > Global::getSocketProfilePatterns()
+{
+    return private_->socket_profile_patterns_;
+}
+
 bool Global::quitRequested()
 {
     return private_->quit_flag_.load();
@@ -613,6 +1094,16 @@ void setConsoleLogLevel(logger::Level level)
     Global::getInstance().setConsoleLogLevel(level);
 }
 
+logger::Level getRemoteLogLevel()
+{
+    return Global::getInstance().getRemoteLogLevel();
+}
+
+void setRemoteLogLevel(logger::Level level)
+{
+    Global::getInstance().setRemoteLogLevel(level);
+}
+
 double getSpinRate()
 {
     return Global::getInstance().getSpinRate();
@@ -623,6 +1114,296 @@ void setSpinRate(double rate)
     Global::getInstance().setSpinRate(rate);
 }
 
+int getIOThreads()
+{
+    return Global::getInstance().getIOThreads();
+}
+
+void setIOThreads(int n)
+{
+    Global::getInstance().setIOThreads(n);
+}
+
+bool getPriorityIOThread()
+{
+    return Global::getInstance().getPriorityIOThread();
+}
+
+void setPriorityIOThread(bool reserved)
+{
+    Global::getInstance().setPriorityIOThread(reserved);
+}
+
+bool getSharedContext()
+{
+    return Global::getInstance().getSharedContext();
+}
+
+void setSharedContext(bool shared)
+{
+    Global::getInstance().setSharedContext(shared);
+}
+
+bool getIntraProcess()
+{
+    return Global::getInstance().getIntraProcess();
+}
+
+void setIntraProcess(bool enabled)
+{
+    Global::getInstance().setIntraProcess(enabled);
+}
+
+bool getPeerToPeer()
+{
+    return Global::getInstance().getPeerToPeer();
+}
+
+void setPeerToPeer(bool enabled)
+{
+    Global::getInstance().setPeerToPeer(enabled);
+}
+
+bool getIPC()
+{
+    return Global::getInstance().getIPC();
+}
+
+void setIPC(bool enabled)
+{
+    Global::getInstance().setIPC(enabled);
+}
+
+std::string getIPCDirectory()
+{
+    return Global::getInstance().getIPCDirectory();
+}
+
+void setIPCDirectory(const std::string &dir)
+{
+    Global::getInstance().setIPCDirectory(dir);
+}
+
+bool getAsyncLogging()
+{
+    return Global::getInstance().getAsyncLogging();
+}
+
+void setAsyncLogging(bool enabled)
+{
+    Global::getInstance().setAsyncLogging(enabled);
+}
+
+bool getHierarchicalLogTopics()
+{
+    return Global::getInstance().getHierarchicalLogTopics();
+}
+
+void setHierarchicalLogTopics(bool enabled)
+{
+    Global::getInstance().setHierarchicalLogTopics(enabled);
+}
+
+int getCompressionThreads()
+{
+    return Global::getInstance().getCompressionThreads();
+}
+
+void setCompressionThreads(int n)
+{
+    Global::getInstance().setCompressionThreads(n);
+}
+
+bool getInPlaceJSONDecoding()
+{
+    return Global::getInstance().getInPlaceJSONDecoding();
+}
+
+void setInPlaceJSONDecoding(bool enabled)
+{
+    Global::getInstance().setInPlaceJSONDecoding(enabled);
+}
+
+int getLingerPeriod()
+{
+    return Global::getInstance().getLingerPeriod();
+}
+
+void setLingerPeriod(int period)
+{
+    Global::getInstance().setLingerPeriod(period);
+}
+
+int getSpinBudget()
+{
+    return Global::getInstance().getSpinBudget();
+}
+
+void setSpinBudget(int max_messages)
+{
+    Global::getInstance().setSpinBudget(max_messages);
+}
+
+bool getServiceCache()
+{
+    return Global::getInstance().getServiceCache();
+}
+
+void setServiceCache(bool enabled)
+{
+    Global::getInstance().setServiceCache(enabled);
+}
+
+int getServiceClientPool()
+{
+    return Global::getInstance().getServiceClientPool();
+}
+
+void setServiceClientPool(int max_idle)
+{
+    Global::getInstance().setServiceClientPool(max_idle);
+}
+
+bool getHeartbeatCoalescing()
+{
+    return Global::getInstance().getHeartbeatCoalescing();
+}
+
+void setHeartbeatCoalescing(bool enabled)
+{
+    Global::getInstance().setHeartbeatCoalescing(enabled);
+}
+
+bool getProcessAgent()
+{
+    return Global::getInstance().getProcessAgent();
+}
+
+void setProcessAgent(bool enabled)
+{
+    Global::getInstance().setProcessAgent(enabled);
+}
+
+bool getInlineHeartbeats()
+{
+    return Global::getInstance().getInlineHeartbeats();
+}
+
+void setInlineHeartbeats(bool enabled)
+{
+    Global::getInstance().setInlineHeartbeats(enabled);
+}
+
+bool getEmbeddedProfile()
+{
+    return Global::getInstance().getEmbeddedProfile();
+}
+
+void setEmbeddedProfile(bool enabled)
+{
+    Global::getInstance().setEmbeddedProfile(enabled);
+}
+
+std::shared_ptr<BufferAllocator> getBufferAllocator()
+{
+    return Global::getInstance().getBufferAllocator();
+}
+
+void setBufferAllocator(std::shared_ptr<BufferAllocator> allocator)
+{
+    Global::getInstance().setBufferAllocator(allocator);
+}
+
+bool getMemoryAccounting()
+{
+    return Global::getInstance().getMemoryAccounting();
+}
+
+void setMemoryAccounting(bool enabled)
+{
+    Global::getInstance().setMemoryAccounting(enabled);
+}
+
+bool getHeartbeatStats()
+{
+    return Global::getInstance().getHeartbeatStats();
+}
+
+void setHeartbeatStats(bool enabled)
+{
+    Global::getInstance().setHeartbeatStats(enabled);
+}
+
+bool getConnectionMonitor()
+{
+    return Global::getInstance().getConnectionMonitor();
+}
+
+void setConnectionMonitor(bool enabled)
+{
+    Global::getInstance().setConnectionMonitor(enabled);
+}
+
+bool getConnectionMonitorWarnings()
+{
+    return Global::getInstance().getConnectionMonitorWarnings();
+}
+
+void setConnectionMonitorWarnings(bool enabled)
+{
+    Global::getInstance().setConnectionMonitorWarnings(enabled);
+}
+
+bool getSimulatedTime()
+{
+    return Global::getInstance().getSimulatedTime();
+}
+
+void setSimulatedTime(bool enabled)
+{
+    Global::getInstance().setSimulatedTime(enabled);
+}
+
+bool getDecentralized()
+{
+    return Global::getInstance().getDecentralized();
+}
+
+void setDecentralized(bool enabled)
+{
+    Global::getInstance().setDecentralized(enabled);
+}
+
+ThreadConfig getThreadConfig(const std::string &role)
+{
+    return Global::getInstance().getThreadConfig(role);
+}
+
+void setThreadConfig(const std::string &role, const ThreadConfig &config)
+{
+    Global::getInstance().setThreadConfig(role, config);
+}
+
+SocketProfile getSocketProfile(const std::string &name)
+{
+    return Global::getInstance().getSocketProfile(name);
+}
+
+void setSocketProfile(const std::string &name, const SocketProfile &profile)
+{
+    Global::getInstance().setSocketProfile(name, profile);
+}
+
+void addSocketProfilePattern(const std::string &pattern, const std::string &profile)
+{
+    Global::getInstance().addSocketProfilePattern(pattern, profile);
+}
+
+std::vector<std::pair<std::string, std::string> > getSocketProfilePatterns()
+{
+    return Global::getInstance().getSocketProfilePatterns();
+}
+
 bool quitRequested()
 {
     return Global::getInstance().quitRequested();
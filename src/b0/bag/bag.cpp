@@ -0,0 +1,824 @@
+#include <b0/bag/bag.h>
+#include <b0/exceptions.h>
+#include <b0/compress/compress.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <exception>
+
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace b0
+{
+
+namespace bag
+{
+
+namespace bip = boost::interprocess;
+
+static const char file_magic[] = "B0BAG002";
+
+static const char chunk_magic[] = "CHNK";
+
+static const char index_magic[] = "INDX";
+
+static const char trailer_magic[] = "B0BAGIDX";
+
+static const size_t file_header_size = 8;
+
+//! Size of the chunk header, without the algorithm name
+static const size_t chunk_header_size = 41;
+
+static const size_t record_header_size = 12;
+
+static const size_t trailer_size = 16;
+
+static void putLE(char *dst, uint64_t value, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+        dst[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+static uint64_t getLE(const char *src, size_t size)
+{
+    uint64_t value = 0;
+    for(size_t i = 0; i < size; i++)
+        value |= uint64_t(static_cast<unsigned char>(src[i])) << (8 * i);
+    return value;
+}
+
+static void appendLE(std::string &dst, uint64_t value, size_t size)
+{
+    char buf[8];
+    putLE(buf, value, size);
+    dst.append(buf, size);
+}
+
+static boost::string_ref header0(const char *wire, size_t size)
+{
+    const char *eol = static_cast<const char*>(std::memchr(wire, '\n', size));
+    return eol ? boost::string_ref(wire, eol - wire) : boost::string_ref();
+}
+
+Writer::Writer(const std::string &path, size_t chunk_size, const std::string &compression_algorithm, int compression_level)
+    : file_(nullptr),
+      chunk_size_(chunk_size),
+      compression_algorithm_(compression_algorithm),
+      compression_level_(compression_level),
+      compress_context_(new b0::compress::Context),
+      offset_(0)
+{
+    if(compression_algorithm.size() > 255)
+        throw exception::ArgumentError(compression_algorithm, "compression_algorithm");
+    file_ = std::fopen(path.c_str(), "wb");
+    if(!file_)
+        throw exception::Exception("cannot create " + path + ": " + std::strerror(errno));
+    chunk_.reserve(chunk_size_);
+    writeFile(file_magic, file_header_size);
+}
+
+Writer::~Writer()
+{
+    try
+    {
+        close();
+    }
+    catch(std::exception &)
+    {
+    }
+}
+
+void Writer::write(int64_t time_usec, const char *wire, size_t size)
+{
+    boost::string_ref topic = header0(wire, size);
+    if(topic.empty() || size > UINT32_MAX)
+        throw exception::ArgumentError("<" + std::to_string(size) + " bytes>", "wire");
+
+    if(chunk_.empty())
+    {
+        chunk_info_ = ChunkInfo();
+        chunk_info_.offset = offset_;
+        chunk_info_.count = 0;
+        chunk_info_.first_time = time_usec;
+        chunk_topics_.clear();
+    }
+    chunk_info_.count++;
+    chunk_info_.last_time = time_usec;
+
+    ChunkTopicInfo &t = chunk_topics_[topic.to_string()];
+    if(t.count == 0)
+    {
+        t.topic = topic.to_string();
+        t.first_offset = chunk_.size();
+        t.first_time = time_usec;
+    }
+    t.count++;
+    t.last_time = time_usec;
+
+    appendLE(chunk_, static_cast<uint64_t>(time_usec), 8);
+    appendLE(chunk_, size, 4);
+    chunk_.append(wire, size);
+
+    topics_[t.topic]++;
+    message_count_++;
+    byte_count_ += size;
+
+    if(chunk_.size() >= chunk_size_)
+        flush();
+}
+
+void Writer::write(int64_t time_usec, const b0::message::MessageEnvelope &env, b0::message::EnvelopeFormat format)
+{
+    b0::message::serialize(env, serialized_, format);
+    write(time_usec, serialized_.data(), serialized_.size());
+}
+
+void Writer::flush()
+{
+    if(!file_ || chunk_.empty()) return;
+
+    const std::string *data = &chunk_;
+    if(!compression_algorithm_.empty())
+    {
+        compress_context_->compress(compression_algorithm_, chunk_.data(), chunk_.size(), compressed_, compression_level_);
+        data = &compressed_;
+    }
+
+    header_.clear();
+    header_.append(chunk_magic, 4);
+    appendLE(header_, chunk_info_.count, 4);
+    appendLE(header_, data->size(), 8);
+    appendLE(header_, chunk_.size(), 8);
+    appendLE(header_, static_cast<uint64_t>(chunk_info_.first_time), 8);
+    appendLE(header_, static_cast<uint64_t>(chunk_info_.last_time), 8);
+    appendLE(header_, compression_algorithm_.size(), 1);
+    header_.append(compression_algorithm_);
+    writeFile(header_.data(), header_.size());
+    writeFile(data->data(), data->size());
+    std::fflush(file_);
+
+    for(auto &t : chunk_topics_)
+        chunk_info_.topics.push_back(t.second);
+    chunks_.push_back(std::move(chunk_info_));
+    chunk_.clear();
+}
+
+void Writer::close()
+{
+    if(!file_) return;
+
+    flush();
+
+    std::string index;
+    index.append(index_magic, 4);
+    appendLE(index, topics_.size(), 4);
+    std::map<std::string, uint32_t> topic_ids;
+    for(auto &t : topics_)
+    {
+        size_t n = std::min<size_t>(t.first.size(), UINT16_MAX);
+        appendLE(index, n, 2);
+        index.append(t.first.data(), n);
+        appendLE(index, t.second, 8);
+        topic_ids[t.first] = static_cast<uint32_t>(topic_ids.size());
+    }
+    appendLE(index, chunks_.size(), 4);
+    for(auto &c : chunks_)
+    {
+        appendLE(index, c.offset, 8);
+        appendLE(index, c.count, 4);
+        appendLE(index, static_cast<uint64_t>(c.first_time), 8);
+        appendLE(index, static_cast<uint64_t>(c.last_time), 8);
+        appendLE(index, c.topics.size(), 4);
+        for(auto &t : c.topics)
+        {
+            appendLE(index, topic_ids[t.topic], 4);
+            appendLE(index, t.count, 4);
+            appendLE(index, t.first_offset, 8);
+            appendLE(index, static_cast<uint64_t>(t.first_time), 8);
+            appendLE(index, static_cast<uint64_t>(t.last_time), 8);
+        }
+    }
+    appendLE(index, offset_, 8);
+    index.append(trailer_magic, 8);
+    writeFile(index.data(), index.size());
+
+    std::FILE *file = file_;
+    file_ = nullptr;
+    if(std::fclose(file) != 0)
+        throw exception::Exception(std::string("cannot write bag file: ") + std::strerror(errno));
+}
+
+uint64_t Writer::getMessageCount() const
+{
+    return message_count_;
+}
+
+uint64_t Writer::getByteCount() const
+{
+    return byte_count_;
+}
+
+void Writer::writeFile(const char *data, size_t size)
+{
+    if(std::fwrite(data, 1, size, file_) != size)
+        throw exception::Exception(std::string("cannot write bag file: ") + std::strerror(errno));
+    offset_ += size;
+}
+
+struct RotatingWriter::Private
+{
+    std::string prefix_;
+    uint64_t max_size_;
+    int64_t max_duration_usec_;
+    size_t max_files_;
+    size_t chunk_size_;
+    std::string compression_algorithm_;
+    int compression_level_;
+
+    //! Protects the members below
+    mutable boost::mutex mutex_;
+
+    //! Signals the background thread that there are messages queued, or a flush or close to do
+    boost::condition_variable queued_;
+
+    //! Signals flush() that the background thread flushed
+    boost::condition_variable flushed_;
+
+    //! The records queued (as in a chunk: time(8) size(4) envelope)
+    std::string queue_;
+
+    //! Number of flushes requested, and done by the background thread
+    uint64_t flush_requested_{0}, flush_done_{0};
+
+    //! Set by close()
+    bool stop_{false};
+
+    //! Error of the background thread, thrown by the next call
+    std::exception_ptr error_;
+
+    //! The files written and not deleted
+    std::vector<std::string> files_;
+
+    //! Number of messages and envelope bytes written, in the files closed and in the current one
+    uint64_t message_count_{0}, byte_count_{0};
+
+    //! The current file (only used by the background thread)
+    std::unique_ptr<Writer> writer_;
+
+    //! Receive time of the first message of the current file
+    int64_t writer_start_{0};
+
+    //! Number of files created in the same second as the last one
+    int same_second_{0};
+
+    //! Creation time of the last file, formatted
+    std::string last_stamp_;
+
+    //! The background thread
+    boost::thread thread_;
+
+    //! Throw the error of the background thread, if any (mutex_ must be locked)
+    void checkError()
+    {
+        if(error_)
+            std::rethrow_exception(error_);
+    }
+
+    //! Create the next file
+    void openFile(int64_t time_usec)
+    {
+        char stamp[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+        same_second_ = stamp == last_stamp_ ? same_second_ + 1 : 0;
+        last_stamp_ = stamp;
+        std::string path = (boost::format("%s-%s-%03d.bag") % prefix_ % stamp % same_second_).str();
+        writer_.reset(new Writer(path, chunk_size_, compression_algorithm_, compression_level_));
+        writer_start_ = time_usec;
+
+        std::vector<std::string> deleted;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            files_.push_back(path);
+            while(max_files_ && files_.size() > max_files_)
+            {
+                deleted.push_back(files_.front());
+                files_.erase(files_.begin());
+            }
+        }
+        for(auto &file : deleted)
+            std::remove(file.c_str());
+    }
+
+    //! Close the current file, if any
+    void closeFile()
+    {
+        if(!writer_) return;
+        std::unique_ptr<Writer> writer(std::move(writer_));
+        writer->close();
+    }
+
+    //! Write the records of a queue, rotating the files when needed
+    void writeRecords(const std::string &records)
+    {
+        for(size_t pos = 0; pos + record_header_size <= records.size(); )
+        {
+            int64_t time = static_cast<int64_t>(getLE(records.data() + pos, 8));
+            size_t size = getLE(records.data() + pos + 8, 4);
+            const char *wire = records.data() + pos + record_header_size;
+            pos += record_header_size + size;
+
+            if(writer_ && (writer_->getByteCount() >= max_size_ || (max_duration_usec_ > 0 && time - writer_start_ >= max_duration_usec_)))
+                closeFile();
+            if(!writer_)
+                openFile(time);
+            writer_->write(time, wire, size);
+
+            boost::mutex::scoped_lock lock(mutex_);
+            message_count_++;
+            byte_count_ += size;
+        }
+    }
+};
+
+RotatingWriter::RotatingWriter(const std::string &prefix, uint64_t max_size, int64_t max_duration_usec, size_t max_files, size_t chunk_size, const std::string &compression_algorithm, int compression_level)
+    : private_(new Private)
+{
+    if(compression_algorithm.size() > 255)
+        throw exception::ArgumentError(compression_algorithm, "compression_algorithm");
+    if(max_duration_usec < 0)
+        throw exception::ArgumentError(std::to_string(max_duration_usec), "max_duration_usec");
+    private_->prefix_ = prefix;
+    private_->max_size_ = max_size;
+    private_->max_duration_usec_ = max_duration_usec;
+    private_->max_files_ = max_files;
+    private_->chunk_size_ = chunk_size;
+    private_->compression_algorithm_ = compression_algorithm;
+    private_->compression_level_ = compression_level;
+    private_->thread_ = boost::thread(&RotatingWriter::writeLoop, this);
+}
+
+RotatingWriter::~RotatingWriter()
+{
+    try
+    {
+        close();
+    }
+    catch(std::exception &)
+    {
+    }
+}
+
+void RotatingWriter::write(int64_t time_usec, const char *wire, size_t size)
+{
+    if(header0(wire, size).empty() || size > UINT32_MAX)
+        throw exception::ArgumentError("<" + std::to_string(size) + " bytes>", "wire");
+
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    private_->checkError();
+    if(private_->stop_)
+        throw exception::Exception("write() called after close()");
+    bool was_empty = private_->queue_.empty();
+    appendLE(private_->queue_, static_cast<uint64_t>(time_usec), 8);
+    appendLE(private_->queue_, size, 4);
+    private_->queue_.append(wire, size);
+    if(was_empty)
+        private_->queued_.notify_one();
+}
+
+void RotatingWriter::flush()
+{
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    if(private_->stop_) return;
+    uint64_t request = ++private_->flush_requested_;
+    private_->queued_.notify_one();
+    while(private_->flush_done_ < request && !private_->error_)
+        private_->flushed_.wait(lock);
+    private_->checkError();
+}
+
+void RotatingWriter::close()
+{
+    {
+        boost::mutex::scoped_lock lock(private_->mutex_);
+        private_->stop_ = true;
+        private_->queued_.notify_one();
+    }
+    if(private_->thread_.joinable())
+        private_->thread_.join();
+
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    private_->checkError();
+}
+
+std::vector<std::string> RotatingWriter::getFiles() const
+{
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    return private_->files_;
+}
+
+uint64_t RotatingWriter::getMessageCount() const
+{
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    return private_->message_count_;
+}
+
+uint64_t RotatingWriter::getByteCount() const
+{
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    return private_->byte_count_;
+}
+
+void RotatingWriter::writeLoop()
+{
+    Private &p = *private_;
+    std::string records;
+    auto last_flush = std::chrono::steady_clock::now();
+    while(true)
+    {
+        uint64_t flush_request;
+        bool stop;
+        {
+            boost::mutex::scoped_lock lock(p.mutex_);
+            if(p.queue_.empty() && !p.stop_ && p.flush_done_ == p.flush_requested_)
+                p.queued_.wait_for(lock, boost::chrono::seconds{1});
+            records.swap(p.queue_);
+            flush_request = p.flush_requested_;
+            stop = p.stop_;
+        }
+
+        try
+        {
+            p.writeRecords(records);
+            // at least every second, so that the last messages are readable:
+            auto now = std::chrono::steady_clock::now();
+            if(stop)
+                p.closeFile();
+            else if(p.writer_ && (flush_request != p.flush_done_ || now - last_flush >= std::chrono::seconds(1)))
+            {
+                p.writer_->flush();
+                last_flush = now;
+            }
+        }
+        catch(...)
+        {
+            boost::mutex::scoped_lock lock(p.mutex_);
+            p.error_ = std::current_exception();
+            p.flushed_.notify_all();
+            return;
+        }
+        records.clear();
+
+        {
+            boost::mutex::scoped_lock lock(p.mutex_);
+            p.flush_done_ = flush_request;
+            p.flushed_.notify_all();
+        }
+        if(stop)
+            return;
+    }
+}
+
+namespace
+{
+
+//! Bounds-checked reading of little-endian integers from a buffer
+class Cursor
+{
+public:
+    Cursor(const char *begin, const char *end) : p_(begin), end_(end) {}
+
+    bool has(uint64_t size) const { return uint64_t(end_ - p_) >= size; }
+
+    uint64_t get(size_t size) { uint64_t v = getLE(p_, size); p_ += size; return v; }
+
+    bool getString(size_t size, std::string &s) { if(!has(size)) return false; s.assign(p_, size); p_ += size; return true; }
+
+private:
+    const char *p_, *end_;
+};
+
+} // namespace
+
+struct Reader::Private
+{
+    bip::file_mapping mapping_;
+    bip::mapped_region region_;
+    const char *data_{nullptr};
+    size_t size_{0};
+    bool indexed_{false};
+    std::vector<ChunkInfo> chunks_;
+    std::map<std::string, uint64_t> topics_;
+    uint64_t message_count_{0};
+
+    //! Topics to read (all if empty)
+    std::set<std::string> filter_;
+
+    //! Records received before this time are skipped (see seekTime())
+    int64_t seek_time_{INT64_MIN};
+
+    //! Index of the next chunk to read
+    size_t next_chunk_{0};
+
+    //! Data of the current chunk (in the mapping, or in buffer_ if compressed), and position in it
+    const char *chunk_data_{nullptr};
+    uint64_t chunk_size_{0};
+    uint64_t pos_{0};
+
+    //! Decompression state and buffer
+    b0::compress::Context context_;
+    std::string buffer_;
+
+    //! A chunk header, and the location of the chunk data
+    struct ChunkHeader
+    {
+        ChunkInfo info;
+        uint64_t stored_size;
+        uint64_t size;
+        std::string algorithm;
+        uint64_t data_offset;
+    };
+
+    //! Return true if a complete chunk starts at offset, and read its header
+    bool readChunkHeader(uint64_t offset, ChunkHeader &h) const
+    {
+        if(offset > size_) return false;
+        Cursor c(data_ + offset, data_ + size_);
+        if(!c.has(chunk_header_size) || std::memcmp(data_ + offset, chunk_magic, 4) != 0) return false;
+        c.get(4);
+        h.info.offset = offset;
+        h.info.count = static_cast<uint32_t>(c.get(4));
+        h.stored_size = c.get(8);
+        h.size = c.get(8);
+        h.info.first_time = static_cast<int64_t>(c.get(8));
+        h.info.last_time = static_cast<int64_t>(c.get(8));
+        if(!c.getString(c.get(1), h.algorithm)) return false;
+        h.data_offset = offset + chunk_header_size + h.algorithm.size();
+        return h.stored_size <= size_ - h.data_offset && (!h.algorithm.empty() || h.size == h.stored_size);
+    }
+
+    //! Make a chunk the current one, decompressing it if needed
+    void loadChunk(const ChunkHeader &h)
+    {
+        if(h.algorithm.empty())
+        {
+            chunk_data_ = data_ + h.data_offset;
+        }
+        else
+        {
+            context_.decompress(h.algorithm, data_ + h.data_offset, h.stored_size, buffer_, h.size);
+            if(buffer_.size() != h.size)
+                throw exception::Exception("corrupted bag file (bad chunk size)");
+            chunk_data_ = buffer_.data();
+        }
+        chunk_size_ = h.size;
+        pos_ = 0;
+    }
+
+    //! Return true if the chunk has some of the topics to read, and set pos to the first one
+    bool wanted(const ChunkInfo &c, uint64_t &pos) const
+    {
+        if(filter_.empty())
+        {
+            pos = 0;
+            return true;
+        }
+        bool found = false;
+        for(auto &t : c.topics)
+        {
+            if(!filter_.count(t.topic)) continue;
+            pos = found ? std::min(pos, t.first_offset) : t.first_offset;
+            found = true;
+        }
+        return found;
+    }
+
+    bool readIndex()
+    {
+        if(size_ < file_header_size + trailer_size) return false;
+        const char *t = data_ + size_ - trailer_size;
+        if(std::memcmp(t + 8, trailer_magic, 8) != 0) return false;
+        uint64_t offset = getLE(t, 8);
+        if(offset < file_header_size || offset > size_ - trailer_size) return false;
+
+        Cursor c(data_ + offset, t);
+        if(!c.has(8) || std::memcmp(data_ + offset, index_magic, 4) != 0) return false;
+        c.get(4);
+        uint64_t n = c.get(4);
+        if(!c.has(n * 10)) return false;
+        std::vector<std::string> names(n);
+        for(auto &name : names)
+        {
+            if(!c.has(2) || !c.getString(c.get(2), name) || !c.has(8)) return false;
+            topics_[name] = c.get(8);
+        }
+        if(!c.has(4)) return false;
+        n = c.get(4);
+        for(uint64_t i = 0; i < n; i++)
+        {
+            if(!c.has(32)) return false;
+            ChunkInfo info;
+            info.offset = c.get(8);
+            info.count = static_cast<uint32_t>(c.get(4));
+            info.first_time = static_cast<int64_t>(c.get(8));
+            info.last_time = static_cast<int64_t>(c.get(8));
+            uint64_t topic_count = c.get(4);
+            if(!c.has(topic_count * 32)) return false;
+            info.topics.resize(topic_count);
+            for(auto &ti : info.topics)
+            {
+                if(!c.has(32)) return false;
+                uint64_t id = c.get(4);
+                if(id >= names.size()) return false;
+                ti.topic = names[id];
+                ti.count = static_cast<uint32_t>(c.get(4));
+                ti.first_offset = c.get(8);
+                ti.first_time = static_cast<int64_t>(c.get(8));
+                ti.last_time = static_cast<int64_t>(c.get(8));
+            }
+            chunks_.push_back(std::move(info));
+        }
+        return true;
+    }
+
+    void scan()
+    {
+        // the index is missing: rebuild it from the chunks, up to the last complete one
+        chunks_.clear();
+        topics_.clear();
+        uint64_t offset = file_header_size;
+        ChunkHeader h;
+        while(readChunkHeader(offset, h))
+        {
+            try
+            {
+                loadChunk(h);
+            }
+            catch(exception::Exception &)
+            {
+                break;
+            }
+            std::map<std::string, ChunkTopicInfo> topics;
+            for(uint32_t i = 0; i < h.info.count; i++)
+            {
+                if(chunk_size_ - pos_ < record_header_size) break;
+                int64_t time = static_cast<int64_t>(getLE(chunk_data_ + pos_, 8));
+                uint64_t size = getLE(chunk_data_ + pos_ + 8, 4);
+                if(chunk_size_ - pos_ - record_header_size < size) break;
+                std::string topic = header0(chunk_data_ + pos_ + record_header_size, size).to_string();
+                ChunkTopicInfo &t = topics[topic];
+                if(t.count == 0)
+                {
+                    t.topic = topic;
+                    t.first_offset = pos_;
+                    t.first_time = time;
+                }
+                t.count++;
+                t.last_time = time;
+                topics_[topic]++;
+                pos_ += record_header_size + size;
+            }
+            for(auto &t : topics)
+                h.info.topics.push_back(t.second);
+            chunks_.push_back(h.info);
+            offset = h.data_offset + h.stored_size;
+            h.info.topics.clear();
+        }
+    }
+};
+
+Reader::Reader(const std::string &path)
+    : private_(new Private)
+{
+    try
+    {
+        private_->mapping_ = bip::file_mapping(path.c_str(), bip::read_only);
+        private_->region_ = bip::mapped_region(private_->mapping_, bip::read_only);
+    }
+    catch(bip::interprocess_exception &ex)
+    {
+        throw exception::Exception("cannot map " + path + ": " + ex.what());
+    }
+    private_->data_ = static_cast<const char*>(private_->region_.get_address());
+    private_->size_ = private_->region_.get_size();
+    if(private_->size_ < file_header_size || std::memcmp(private_->data_, file_magic, file_header_size) != 0)
+        throw exception::Exception(path + " is not a bag file (or not of this version)");
+
+    private_->region_.advise(bip::mapped_region::advice_sequential);
+
+    private_->indexed_ = private_->readIndex();
+    if(!private_->indexed_)
+        private_->scan();
+    for(auto &c : private_->chunks_)
+        private_->message_count_ += c.count;
+    rewind();
+}
+
+Reader::~Reader()
+{
+}
+
+bool Reader::isIndexed() const
+{
+    return private_->indexed_;
+}
+
+const std::vector<ChunkInfo> & Reader::getChunks() const
+{
+    return private_->chunks_;
+}
+
+const std::map<std::string, uint64_t> & Reader::getTopics() const
+{
+    return private_->topics_;
+}
+
+uint64_t Reader::getMessageCount() const
+{
+    return private_->message_count_;
+}
+
+int64_t Reader::getStartTime() const
+{
+    return private_->chunks_.empty() ? 0 : private_->chunks_.front().first_time;
+}
+
+int64_t Reader::getEndTime() const
+{
+    return private_->chunks_.empty() ? 0 : private_->chunks_.back().last_time;
+}
+
+void Reader::setTopics(const std::set<std::string> &topics)
+{
+    private_->filter_ = topics;
+    rewind();
+}
+
+bool Reader::next(Record &record)
+{
+    Private &p = *private_;
+    for(;;)
+    {
+        if(p.chunk_size_ - p.pos_ < record_header_size)
+        {
+            // next chunk with some of the topics
+            uint64_t pos;
+            while(p.next_chunk_ < p.chunks_.size() && !p.wanted(p.chunks_[p.next_chunk_], pos))
+                p.next_chunk_++;
+            if(p.next_chunk_ >= p.chunks_.size()) return false;
+            Private::ChunkHeader h;
+            if(!p.readChunkHeader(p.chunks_[p.next_chunk_++].offset, h))
+                throw exception::Exception("corrupted bag file (bad chunk)");
+            p.loadChunk(h);
+            if(pos > p.chunk_size_)
+                throw exception::Exception("corrupted bag file (bad index)");
+            p.pos_ = pos;
+            continue;
+        }
+
+        const char *r = p.chunk_data_ + p.pos_;
+        uint64_t size = getLE(r + 8, 4);
+        if(p.chunk_size_ - p.pos_ - record_header_size < size)
+            throw exception::Exception("corrupted bag file (bad record)");
+        record.time = static_cast<int64_t>(getLE(r, 8));
+        record.wire = boost::string_ref(r + record_header_size, size);
+        record.topic = header0(record.wire.data(), record.wire.size());
+        p.pos_ += record_header_size + size;
+
+        if(record.time < p.seek_time_) continue;
+        if(!p.filter_.empty() && !p.filter_.count(record.topic.to_string())) continue;
+        p.seek_time_ = INT64_MIN;
+        return true;
+    }
+}
+
+void Reader::seekTime(int64_t time_usec)
+{
+    // the chunks are in the order they were recorded: skip those ending before time_usec
+    auto it = std::partition_point(private_->chunks_.begin(), private_->chunks_.end(), [=](const ChunkInfo &c) {
+        return c.last_time < time_usec;
+    });
+    private_->next_chunk_ = it - private_->chunks_.begin();
+    private_->chunk_size_ = 0;
+    private_->pos_ = 0;
+    private_->seek_time_ = time_usec;
+}
+
+void Reader::rewind()
+{
+    private_->next_chunk_ = 0;
+    private_->chunk_size_ = 0;
+    private_->pos_ = 0;
+    private_->seek_time_ = INT64_MIN;
+}
+
+} // namespace bag
+
+} // namespace b0
@@ -5,6 +5,13 @@
 #include <b0/service_client.h>
 #include <b0/service_server.h>
 #include <b0/bindings/c.h>
+#include <b0/message/message_envelope.h>
+
+#include <boost/thread/mutex.hpp>
+
+#include <cstring>
+#include <map>
+#include <memory>
 
 #define B0_EXCEPTIONS_CATCH(name) catch(b0::exception::Exception &name)
 #define B0_SUCCESS 1
@@ -31,6 +38,49 @@
         return ret;                        \
     }
 
+struct b0_message
+{
+    //! Own the buffers the lent payloads point into
+    std::vector<std::shared_ptr<b0::message::MessageEnvelopeView> > envs;
+};
+
+//! The rest of a batch envelope which did not fit in a b0_subscriber_read_batch() call, by subscriber
+struct b0_pending_batch
+{
+    std::shared_ptr<b0::message::MessageEnvelopeView> env;
+    size_t next_part;
+};
+static std::map<b0_subscriber*, b0_pending_batch> pending_batches;
+static boost::mutex pending_batches_mutex;
+
+struct b0_frame
+{
+    //! The envelope headers are written in front of the payload (see b0::Socket::writeFrame())
+    std::unique_ptr<std::string> buffer;
+    size_t header_space;
+};
+
+// read a message as a view of the received buffer, and lend the first part's payload
+static b0_message * b0_socket_read_lend(b0::Socket *psock, const void **data, size_t *size)
+{
+    std::unique_ptr<b0_message> msg(new b0_message);
+    msg->envs.emplace_back(new b0::message::MessageEnvelopeView);
+    psock->readRaw(*msg->envs.back());
+    const b0::message::MessagePartView &part = msg->envs.back()->parts.at(0);
+    if(data) *data = part.data;
+    if(size) *size = part.size;
+    return msg.release();
+}
+
+static void b0_socket_read_into(b0::Socket *psock, void *buffer, size_t capacity, size_t *size)
+{
+    b0::message::MessageEnvelopeView env;
+    psock->readRaw(env);
+    const b0::message::MessagePartView &part = env.parts.at(0);
+    std::memcpy(buffer, part.data, std::min(part.size, capacity));
+    if(size) *size = part.size;
+}
+
 static void b0_socket_set_option(b0::Socket *psock, int option, int value)
 {
     switch(option)
@@ -336,6 +386,16 @@ void b0_buffer_delete(void *buffer)
     delete reinterpret_cast<char*>(buffer);
 }
 
+void b0_message_release(b0_message *msg)
+{
+    delete msg;
+}
+
+void b0_frame_delete(b0_frame *frame)
+{
+    delete frame;
+}
+
 b0_node * b0_node_new(const char *name)
 {
     return reinterpret_cast<b0_node*>(new b0::Node(name));
@@ -423,6 +483,43 @@ int b0_node_log(b0_node *node, int level, const char *message)
     B0_EXCEPTIONS_WRAPPER_END();
 }
 
+int b0_node_get_event_fds(b0_node *node, int64_t *fds, size_t max_count, size_t *count)
+{
+    B0_EXCEPTIONS_WRAPPER_BEGIN();
+    std::vector<int64_t> v = reinterpret_cast<b0::Node*>(node)->getEventFileDescriptors();
+    // like b0_subscriber_read_into(), the full count is returned even if fds is too small:
+    for(size_t i = 0; i < v.size() && i < max_count; i++)
+        fds[i] = v[i];
+    *count = v.size();
+    B0_EXCEPTIONS_WRAPPER_END();
+}
+
+int b0_node_has_pending_events(b0_node *node)
+{
+    B0_EXCEPTIONS_WRAPPER_BEGIN_RET();
+    return reinterpret_cast<b0::Node*>(node)->hasPendingEvents();
+    B0_EXCEPTIONS_WRAPPER_END_RET(0);
+}
+
+int b0_node_process_ready_sockets(b0_node *node, const int64_t *fds, size_t count, int *remaining)
+{
+    B0_EXCEPTIONS_WRAPPER_BEGIN();
+    std::vector<int64_t> v(fds, fds + count);
+    bool r = reinterpret_cast<b0::Node*>(node)->processReadySockets(v);
+    if(remaining) *remaining = r;
+    B0_EXCEPTIONS_WRAPPER_END();
+}
+
+int64_t b0_node_next_timer_usec(b0_node *node)
+{
+    return reinterpret_cast<b0::Node*>(node)->nextTimerUSec();
+}
+
+void b0_node_wake_up(b0_node *node)
+{
+    reinterpret_cast<b0::Node*>(node)->wakeUp();
+}
+
 b0_publisher * b0_publisher_new_ex(b0_node *node, const char *topic_name, int managed, int notify_graph)
 {
     return reinterpret_cast<b0_publisher*>(new b0::Publisher(reinterpret_cast<b0::Node*>(node), topic_name, managed, notify_graph));
@@ -468,7 +565,56 @@ int b0_publisher_publish(b0_publisher *pub, const void *data, size_t size)
 {
     B0_EXCEPTIONS_WRAPPER_BEGIN();
     std::string msg((const char *)data, size);
-    reinterpret_cast<b0::Publisher*>(pub)->publish(msg);
+    reinterpret_cast<b0::Publisher*>(pub)->publish(std::move(msg));
+    B0_EXCEPTIONS_WRAPPER_END();
+}
+
+int b0_publisher_publish_owned(b0_publisher *pub, void *data, size_t size, void (*free_fn)(void *, void *), void *hint)
+{
+    // the envelope headers go in front of the payload, in the same frame: the payload is
+    // copied after them (once), and the caller's buffer freed right away
+    struct Owned
+    {
+        ~Owned() {if(free_fn) free_fn(data, hint);}
+        void *data;
+        void (*free_fn)(void *, void *);
+        void *hint;
+    } owned{data, free_fn, hint};
+    B0_EXCEPTIONS_WRAPPER_BEGIN();
+    b0::Publisher *p = reinterpret_cast<b0::Publisher*>(pub);
+    size_t header_space;
+    std::unique_ptr<std::string> frame = p->newFrame(header_space);
+    frame->append(static_cast<const char *>(data), size);
+    p->writeFrame(std::move(frame), header_space, "");
+    B0_EXCEPTIONS_WRAPPER_END();
+}
+
+b0_frame * b0_publisher_frame_new(b0_publisher *pub, size_t size, void **data)
+{
+    B0_EXCEPTIONS_WRAPPER_BEGIN_RET();
+    std::unique_ptr<b0_frame> frame(new b0_frame);
+    frame->buffer = reinterpret_cast<b0::Publisher*>(pub)->newFrame(frame->header_space);
+    frame->buffer->resize(frame->header_space + size);
+    *data = &(*frame->buffer)[frame->header_space];
+    return frame.release();
+    B0_EXCEPTIONS_WRAPPER_END_RET(NULL);
+}
+
+int b0_publisher_publish_frame(b0_publisher *pub, b0_frame *frame)
+{
+    std::unique_ptr<b0_frame> f(frame);
+    B0_EXCEPTIONS_WRAPPER_BEGIN();
+    reinterpret_cast<b0::Publisher*>(pub)->writeFrame(std::move(f->buffer), f->header_space, "");
+    B0_EXCEPTIONS_WRAPPER_END();
+}
+
+int b0_publisher_publish_batch(b0_publisher *pub, const b0_message_ref *msgs, size_t count)
+{
+    B0_EXCEPTIONS_WRAPPER_BEGIN();
+    b0::Publisher *p = reinterpret_cast<b0::Publisher*>(pub);
+    for(size_t i = 0; i < count; i++)
+        p->publishBatch(std::string(static_cast<const char *>(msgs[i].data), msgs[i].size), msgs[i].type ? msgs[i].type : "");
+    p->flush();
     B0_EXCEPTIONS_WRAPPER_END();
 }
 
@@ -506,6 +652,10 @@ b0_subscriber * b0_subscriber_new(b0_node *node, const char *topic_name, void (*
 
 void b0_subscriber_delete(b0_subscriber *sub)
 {
+    {
+        boost::mutex::scoped_lock lock(pending_batches_mutex);
+        pending_batches.erase(sub);
+    }
     delete reinterpret_cast<b0::Subscriber*>(sub);
 }
 
@@ -560,6 +710,74 @@ void * b0_subscriber_read(b0_subscriber *sub, size_t *size)
     B0_EXCEPTIONS_WRAPPER_END_RET(NULL);
 }
 
+b0_message * b0_subscriber_read_lend(b0_subscriber *sub, const void **data, size_t *size)
+{
+    B0_EXCEPTIONS_WRAPPER_BEGIN_RET();
+    return b0_socket_read_lend(reinterpret_cast<b0::Subscriber*>(sub), data, size);
+    B0_EXCEPTIONS_WRAPPER_END_RET(NULL);
+}
+
+int b0_subscriber_read_into(b0_subscriber *sub, void *buffer, size_t capacity, size_t *size)
+{
+    B0_EXCEPTIONS_WRAPPER_BEGIN();
+    b0_socket_read_into(reinterpret_cast<b0::Subscriber*>(sub), buffer, capacity, size);
+    B0_EXCEPTIONS_WRAPPER_END();
+}
+
+// lend the messages of env from part first on, in msgs[n...]; return the new count
+static size_t b0_read_batch_parts(b0_message *msg, const std::shared_ptr<b0::message::MessageEnvelopeView> &env, size_t first, b0_message_ref *msgs, size_t max_count, size_t n, b0_subscriber *sub)
+{
+    msg->envs.push_back(env);
+    // the parts of a batch are messages on their own (see b0::Publisher::publishBatch())
+    size_t end = env->findHeader("Batch") ? env->parts.size() : std::min<size_t>(1, env->parts.size());
+    size_t i = first;
+    for(; i < end && n < max_count; i++, n++)
+    {
+        msgs[n].data = env->parts[i].data;
+        msgs[n].size = env->parts[i].size;
+        msgs[n].type = env->parts[i].content_type.c_str();
+    }
+    // the rest of a batch larger than what is left is returned by the next call
+    if(i < end)
+    {
+        boost::mutex::scoped_lock lock(pending_batches_mutex);
+        pending_batches[sub] = b0_pending_batch{env, i};
+    }
+    return n;
+}
+
+b0_message * b0_subscriber_read_batch(b0_subscriber *sub, b0_message_ref *msgs, size_t max_count, size_t *count, long timeout)
+{
+    B0_EXCEPTIONS_WRAPPER_BEGIN_RET();
+    b0::Subscriber *s = reinterpret_cast<b0::Subscriber*>(sub);
+    std::unique_ptr<b0_message> msg(new b0_message);
+    size_t n = 0;
+
+    b0_pending_batch pending;
+    {
+        boost::mutex::scoped_lock lock(pending_batches_mutex);
+        auto it = pending_batches.find(sub);
+        if(it != pending_batches.end())
+        {
+            pending = it->second;
+            pending_batches.erase(it);
+        }
+    }
+    if(pending.env)
+        n = b0_read_batch_parts(msg.get(), pending.env, pending.next_part, msgs, max_count, n, sub);
+
+    // only the messages already received after the first one
+    while(n < max_count && s->poll(n ? 0 : timeout))
+    {
+        std::shared_ptr<b0::message::MessageEnvelopeView> env(new b0::message::MessageEnvelopeView);
+        s->readRaw(*env);
+        n = b0_read_batch_parts(msg.get(), env, 0, msgs, max_count, n, sub);
+    }
+    if(count) *count = n;
+    return msg.release();
+    B0_EXCEPTIONS_WRAPPER_END_RET(NULL);
+}
+
 int b0_subscriber_set_option(b0_subscriber *sub, int option, int value)
 {
     B0_EXCEPTIONS_WRAPPER_BEGIN();
@@ -622,6 +840,17 @@ void * b0_service_client_call(b0_service_client *cli, const void *data, size_t s
     B0_EXCEPTIONS_WRAPPER_END_RET(NULL);
 }
 
+int b0_service_client_call_into(b0_service_client *cli, const void *data, size_t size, void *buffer, size_t capacity, size_t *out_size)
+{
+    B0_EXCEPTIONS_WRAPPER_BEGIN();
+    std::string req((const char *)data, size);
+    std::string rep;
+    reinterpret_cast<b0::ServiceClient*>(cli)->call(req, rep);
+    std::memcpy(buffer, rep.data(), std::min(rep.size(), capacity));
+    if(out_size) *out_size = rep.size();
+    B0_EXCEPTIONS_WRAPPER_END();
+}
+
 int b0_service_client_log(b0_service_client *cli, int level, const char *message)
 {
     B0_EXCEPTIONS_WRAPPER_BEGIN();
@@ -713,6 +942,20 @@ void * b0_service_server_read(b0_service_server *srv, size_t *size)
     B0_EXCEPTIONS_WRAPPER_END_RET(NULL);
 }
 
+b0_message * b0_service_server_read_lend(b0_service_server *srv, const void **data, size_t *size)
+{
+    B0_EXCEPTIONS_WRAPPER_BEGIN_RET();
+    return b0_socket_read_lend(reinterpret_cast<b0::ServiceServer*>(srv), data, size);
+    B0_EXCEPTIONS_WRAPPER_END_RET(NULL);
+}
+
+int b0_service_server_read_into(b0_service_server *srv, void *buffer, size_t capacity, size_t *size)
+{
+    B0_EXCEPTIONS_WRAPPER_BEGIN();
+    b0_socket_read_into(reinterpret_cast<b0::ServiceServer*>(srv), buffer, capacity, size);
+    B0_EXCEPTIONS_WRAPPER_END();
+}
+
 int b0_service_server_write(b0_service_server *srv, const void *msg, size_t size)
 {
     B0_EXCEPTIONS_WRAPPER_BEGIN();
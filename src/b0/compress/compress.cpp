@@ -1,7 +1,20 @@
-
+#include <b0/compress/compress.h>
 #include <b0/exceptions.h>
 #include <b0/compress/zlib.h>
 #include <b0/compress/lz4.h>
+#include <b0/compress/zstd.h>
+#include <b0/compress/image.h>
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace b0
 {
@@ -9,49 +22,364 @@ namespace b0
 namespace compress
 {
 
-std::string compress(const std::string &algorithm, const std::string &str, int level = -1)
+struct DictionaryRegistry
+{
+    boost::mutex mutex_;
+    std::map<std::string, std::string> dictionaries_;
+    std::vector<std::pair<const void*, DictionaryProvider> > providers_;
+};
+
+static DictionaryRegistry & dictionaryRegistry()
+{
+    static DictionaryRegistry *registry = new DictionaryRegistry;
+    return *registry;
+}
+
+/*
+ * A batch of tasks submitted to the worker pool with runTasks().
+ * All the fields are protected by the pool mutex.
+ */
+struct TaskBatch
+{
+    std::vector<boost::function<void()> > *tasks_;
+    size_t next_;
+    size_t pending_;
+    std::exception_ptr error_;
+    boost::condition_variable done_;
+};
+
+struct WorkerPool
+{
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+    std::deque<TaskBatch*> batches_;
+    int num_workers_{0};
+
+    // take the next task of the first batch in the queue; must be called with the lock held
+    bool takeTask(TaskBatch *&batch, size_t &index)
+    {
+        if(batches_.empty()) return false;
+        batch = batches_.front();
+        index = batch->next_++;
+        if(batch->next_ == batch->tasks_->size())
+            batches_.pop_front();
+        return true;
+    }
+
+    // run a task taken with takeTask(); must be called with the lock held, which is released meanwhile
+    void runTask(boost::mutex::scoped_lock &lock, TaskBatch *batch, size_t index)
+    {
+        std::exception_ptr error;
+        lock.unlock();
+        try
+        {
+            (*batch->tasks_)[index]();
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+        if(error && !batch->error_)
+            batch->error_ = error;
+        if(--batch->pending_ == 0)
+            batch->done_.notify_all();
+    }
+
+    void work()
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        while(true)
+        {
+            TaskBatch *batch;
+            size_t index;
+            while(!takeTask(batch, index))
+                cond_.wait(lock);
+            runTask(lock, batch, index);
+        }
+    }
+
+    void run(std::vector<boost::function<void()> > &tasks, int num_threads)
+    {
+        TaskBatch batch;
+        batch.tasks_ = &tasks;
+        batch.next_ = 0;
+        batch.pending_ = tasks.size();
+
+        boost::mutex::scoped_lock lock(mutex_);
+        // workers are started on demand, and live until the process exits
+        for(; num_workers_ < num_threads; num_workers_++)
+            boost::thread(boost::bind(&WorkerPool::work, this)).detach();
+        batches_.push_back(&batch);
+        cond_.notify_all();
+
+        // the calling thread works on its own batch too, while tasks are left:
+        while(batch.next_ < tasks.size())
+        {
+            size_t index = batch.next_++;
+            if(batch.next_ == tasks.size())
+                batches_.erase(std::find(batches_.begin(), batches_.end(), &batch));
+            runTask(lock, &batch, index);
+        }
+        while(batch.pending_ > 0)
+            batch.done_.wait(lock);
+
+        if(batch.error_)
+            std::rethrow_exception(batch.error_);
+    }
+};
+
+static WorkerPool & workerPool()
+{
+    static WorkerPool *pool = new WorkerPool;
+    return *pool;
+}
+
+static void checkNoDictionary(const std::string &algorithm, const std::string &dictionary)
+{
+    if(!dictionary.empty())
+        throw exception::Exception("compression algorithm '" + algorithm + "' does not support dictionaries");
+}
+
+static bool noDictionary(const std::string &algorithm, const std::string &dictionary, std::string *error)
+{
+    if(dictionary.empty()) return true;
+    if(error) *error = "compression algorithm '" + algorithm + "' does not support dictionaries";
+    return false;
+}
+
+struct Context::Private
+{
+#ifdef ZLIB_FOUND
+    std::unique_ptr<ZlibContext> zlib_;
+#endif
+#ifdef LZ4_FOUND
+    std::unique_ptr<LZ4Context> lz4_;
+#endif
+#ifdef ZSTD_FOUND
+    std::unique_ptr<ZstdContext> zstd_;
+#endif
+    std::vector<std::string> buffers_;
+};
+
+// the contexts of each algorithm are created when first used
+template<typename T>
+static T & lazy(std::unique_ptr<T> &ptr)
+{
+    if(!ptr) ptr.reset(new T);
+    return *ptr;
+}
+
+Context::Context()
+    : private_(new Private)
+{
+}
+
+Context::~Context()
+{
+}
+
+void Context::compress(const std::string &algorithm, const char *data, size_t len, std::string &out, int level, const std::string &dictionary)
 {
     if(algorithm == "")
     {
-        return str;
+        out.assign(data, len);
     }
 #ifdef ZLIB_FOUND
     else if(algorithm == "zlib")
     {
-        return zlib_compress(str, level);
+        checkNoDictionary(algorithm, dictionary);
+        lazy(private_->zlib_).compress(data, len, out, level);
     }
 #endif
 #ifdef LZ4_FOUND
     else if(algorithm == "lz4")
     {
-        return lz4_compress(str, level);
+        checkNoDictionary(algorithm, dictionary);
+        lazy(private_->lz4_).compress(data, len, out, level);
+    }
+    else if(algorithm == "lz4f")
+    {
+        checkNoDictionary(algorithm, dictionary);
+        lazy(private_->lz4_).compressFrame(data, len, out, level);
     }
 #endif
+#ifdef ZSTD_FOUND
+    else if(algorithm == "zstd")
+    {
+        lazy(private_->zstd_).compress(data, len, out, level, dictionary);
+    }
+#endif
+    else if(isImageAlgorithm(algorithm))
+    {
+        checkNoDictionary(algorithm, dictionary);
+        imageCompress(algorithm, data, len, out);
+    }
     else throw exception::UnsupportedCompressionAlgorithm(algorithm);
 }
 
-std::string decompress(const std::string &algorithm, const std::string &str, size_t size = 0)
+void Context::decompress(const std::string &algorithm, const char *data, size_t len, std::string &out, size_t size, const std::string &dictionary)
 {
-    if(algorithm == "")
+    std::string error;
+    switch(tryDecompress(algorithm, data, len, out, size, dictionary, &error))
     {
-        return str;
+    case DecompressStatus::Ok: return;
+    case DecompressStatus::UnsupportedAlgorithm: throw exception::UnsupportedCompressionAlgorithm(algorithm);
+    case DecompressStatus::Error: throw exception::Exception(error);
     }
-#ifdef ZLIB_FOUND
-    else if(algorithm == "zlib")
+}
+
+static DecompressStatus status(bool ok)
+{
+    return ok ? DecompressStatus::Ok : DecompressStatus::Error;
+}
+
+DecompressStatus Context::tryDecompress(const std::string &algorithm, const char *data, size_t len, std::string &out, size_t size, const std::string &dictionary, std::string *error)
+{
+    if(algorithm == "")
     {
-        return zlib_decompress(str, size);
+        out.assign(data, len);
+        return DecompressStatus::Ok;
     }
+#ifdef ZLIB_FOUND
+    if(algorithm == "zlib")
+        return status(noDictionary(algorithm, dictionary, error) && lazy(private_->zlib_).tryDecompress(data, len, out, size, error));
 #endif
 #ifdef LZ4_FOUND
-    else if(algorithm == "lz4")
+    if(algorithm == "lz4")
+        return status(noDictionary(algorithm, dictionary, error) && lazy(private_->lz4_).tryDecompress(data, len, out, size, error));
+    if(algorithm == "lz4f")
+        return status(noDictionary(algorithm, dictionary, error) && lazy(private_->lz4_).tryDecompressFrame(data, len, out, size, error));
+#endif
+#ifdef ZSTD_FOUND
+    if(algorithm == "zstd")
+        return status(lazy(private_->zstd_).tryDecompress(data, len, out, size, dictionary, error));
+#endif
+    if(isImageAlgorithm(algorithm))
+        return status(noDictionary(algorithm, dictionary, error) && imageTryDecompress(algorithm, data, len, out, size, error));
+    if(error) *error = "unsupported compression algorithm '" + algorithm + "'";
+    return DecompressStatus::UnsupportedAlgorithm;
+}
+
+std::vector<std::string> & Context::buffers()
+{
+    return private_->buffers_;
+}
+
+static Context & threadContext()
+{
+    static thread_local Context context;
+    return context;
+}
+
+std::string compress(const std::string &algorithm, const std::string &str, int level, const std::string &dictionary)
+{
+    if(algorithm == "") return str;
+    std::string ret;
+    threadContext().compress(algorithm, str.data(), str.size(), ret, level, dictionary);
+    return ret;
+}
+
+void compress(const std::string &algorithm, const char *data, size_t len, std::string &out, int level, const std::string &dictionary)
+{
+    threadContext().compress(algorithm, data, len, out, level, dictionary);
+}
+
+std::string decompress(const std::string &algorithm, const std::string &str, size_t size, const std::string &dictionary)
+{
+    return decompress(algorithm, str.data(), str.size(), size, dictionary);
+}
+
+std::string decompress(const std::string &algorithm, const char *data, size_t len, size_t size, const std::string &dictionary)
+{
+    std::string ret;
+    threadContext().decompress(algorithm, data, len, ret, size, dictionary);
+    return ret;
+}
+
+void decompress(const std::string &algorithm, const char *data, size_t len, std::string &out, size_t size, const std::string &dictionary)
+{
+    threadContext().decompress(algorithm, data, len, out, size, dictionary);
+}
+
+DecompressStatus tryDecompress(const std::string &algorithm, const char *data, size_t len, std::string &out, size_t size, const std::string &dictionary, std::string *error)
+{
+    return threadContext().tryDecompress(algorithm, data, len, out, size, dictionary, error);
+}
+
+std::string trainDictionary(const std::string &algorithm, const std::vector<std::string> &samples, size_t max_size)
+{
+#ifdef ZSTD_FOUND
+    if(algorithm == "zstd")
+        return zstd_train_dictionary(samples, max_size);
+#endif
+    throw exception::UnsupportedCompressionAlgorithm(algorithm);
+}
+
+void addDictionary(const std::string &id, const std::string &data)
+{
+    DictionaryRegistry &registry = dictionaryRegistry();
+    boost::mutex::scoped_lock lock(registry.mutex_);
+    registry.dictionaries_[id] = data;
+}
+
+bool getDictionary(const std::string &id, std::string &data)
+{
+    DictionaryRegistry &registry = dictionaryRegistry();
+    std::vector<std::pair<const void*, DictionaryProvider> > providers;
     {
-        return lz4_decompress(str, size);
+        boost::mutex::scoped_lock lock(registry.mutex_);
+        auto it = registry.dictionaries_.find(id);
+        if(it != registry.dictionaries_.end())
+        {
+            data = it->second;
+            return true;
+        }
+        providers = registry.providers_;
     }
-#endif
-    else throw exception::UnsupportedCompressionAlgorithm(algorithm);
+
+    // providers may do network requests, so they are called without holding the lock:
+    for(auto &provider : providers)
+    {
+        if(provider.second(id, data))
+        {
+            addDictionary(id, data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void addDictionaryProvider(const void *key, DictionaryProvider provider)
+{
+    DictionaryRegistry &registry = dictionaryRegistry();
+    boost::mutex::scoped_lock lock(registry.mutex_);
+    registry.providers_.push_back(std::make_pair(key, provider));
+}
+
+void removeDictionaryProvider(const void *key)
+{
+    DictionaryRegistry &registry = dictionaryRegistry();
+    boost::mutex::scoped_lock lock(registry.mutex_);
+    for(auto it = registry.providers_.begin(); it != registry.providers_.end(); )
+    {
+        if(it->first == key) it = registry.providers_.erase(it);
+        else ++it;
+    }
+}
+
+void runTasks(std::vector<boost::function<void()> > &tasks)
+{
+    int num_threads = b0::getCompressionThreads();
+    if(num_threads <= 0 || tasks.size() < 2)
+    {
+        for(auto &task : tasks)
+            task();
+        return;
+    }
+    workerPool().run(tasks, num_threads);
 }
 
 } // namespace compress
 
 } // namespace b0
-
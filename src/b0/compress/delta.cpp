@@ -0,0 +1,147 @@
+#include <b0/compress/delta.h>
+#include <b0/exceptions.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace b0
+{
+
+namespace compress
+{
+
+//! Ranges separated by fewer equal bytes are merged (a record costs about as much)
+static const size_t RANGE_MERGE_GAP = 8;
+
+static void putVarint(std::string &out, uint64_t value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(char(value));
+}
+
+static bool getVarint(const char *&p, const char *end, uint64_t &value)
+{
+    value = 0;
+    for(int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        uint8_t byte = uint8_t(*p++);
+        value |= uint64_t(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static void encodeXor(const std::string &base, const char *data, size_t len, std::string &out)
+{
+    out.resize(len);
+    for(size_t i = 0; i < len; i++)
+        out[i] = char(data[i] ^ base[i]);
+}
+
+/*
+ * The "ranges" format is the size of the payload, followed by records of:
+ *  - the number of bytes unchanged since the end of the previous record
+ *  - the number of bytes of the record
+ *  - the bytes
+ * all numbers being LEB128 varints. The bytes beyond the size of the base are always in a record.
+ */
+static void encodeRanges(const std::string &base, const char *data, size_t len, std::string &out)
+{
+    out.clear();
+    putVarint(out, len);
+    size_t common = std::min(base.size(), len), last_end = 0, i = 0;
+    while(i < len)
+    {
+        while(i < common && data[i] == base[i]) i++;
+        if(i >= len) break;
+        size_t start = i, end = i, equal = 0;
+        for(; i < len; i++)
+        {
+            if(i < common && data[i] == base[i])
+            {
+                if(++equal > RANGE_MERGE_GAP) break;
+            }
+            else
+            {
+                equal = 0;
+                end = i + 1;
+            }
+        }
+        putVarint(out, start - last_end);
+        putVarint(out, end - start);
+        out.append(data + start, end - start);
+        last_end = end;
+        i = end;
+    }
+}
+
+static bool decodeRanges(const std::string &base, const char *delta, size_t len, std::string &out, std::string *error)
+{
+    const char *p = delta, *end = delta + len;
+    uint64_t size = 0;
+    // the bytes beyond the base are all in the delta:
+    if(!getVarint(p, end, size) || size > base.size() + len)
+    {
+        if(error) *error = "invalid size";
+        return false;
+    }
+    out.assign(base, 0, std::min<size_t>(base.size(), size));
+    out.resize(size);
+    uint64_t pos = 0;
+    while(p < end)
+    {
+        uint64_t skip = 0, count = 0;
+        if(!getVarint(p, end, skip) || !getVarint(p, end, count) || skip > size - pos || count > size - pos - skip || count > uint64_t(end - p))
+        {
+            if(error) *error = "invalid range";
+            return false;
+        }
+        pos += skip;
+        std::copy(p, p + count, &out[pos]);
+        p += count;
+        pos += count;
+    }
+    return true;
+}
+
+bool encodeDelta(const std::string &method, const std::string &base, const char *data, size_t len, std::string &out)
+{
+    if(method == "xor")
+    {
+        if(base.size() != len) return false;
+        encodeXor(base, data, len, out);
+        return true;
+    }
+    if(method == "ranges")
+    {
+        encodeRanges(base, data, len, out);
+        return true;
+    }
+    throw exception::ArgumentError(method, "delta method");
+}
+
+bool decodeDelta(const std::string &method, const std::string &base, const char *delta, size_t len, std::string &out, std::string *error)
+{
+    if(method == "xor")
+    {
+        if(base.size() != len)
+        {
+            if(error) *error = "size differs from the base";
+            return false;
+        }
+        encodeXor(base, delta, len, out);
+        return true;
+    }
+    if(method == "ranges")
+        return decodeRanges(base, delta, len, out, error);
+    if(error) *error = "unknown delta method: " + method;
+    return false;
+}
+
+} // namespace compress
+
+} // namespace b0
@@ -0,0 +1,466 @@
+#include <b0/compress/image.h>
+#include <b0/exceptions.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <boost/format.hpp>
+
+namespace b0
+{
+
+namespace compress
+{
+
+enum class ImageFormat
+{
+    None,
+    RGB,
+    RGBA,
+    Depth16
+};
+
+//! Parse the name of an image codec, and the width of the rows for "depth16/<width>"
+static ImageFormat imageFormat(const std::string &algorithm, size_t &width)
+{
+    width = 0;
+    if(algorithm == "qoi-rgb") return ImageFormat::RGB;
+    if(algorithm == "qoi-rgba") return ImageFormat::RGBA;
+    if(algorithm == "depth16") return ImageFormat::Depth16;
+    static const std::string depth16 = "depth16/";
+    if(algorithm.compare(0, depth16.size(), depth16) != 0 || algorithm.size() == depth16.size() || algorithm.size() > depth16.size() + 9)
+        return ImageFormat::None;
+    for(size_t i = depth16.size(); i < algorithm.size(); i++)
+    {
+        if(algorithm[i] < '0' || algorithm[i] > '9') return ImageFormat::None;
+        width = width * 10 + (algorithm[i] - '0');
+    }
+    return width > 0 ? ImageFormat::Depth16 : ImageFormat::None;
+}
+
+bool isImageAlgorithm(const std::string &algorithm)
+{
+    size_t width;
+    return imageFormat(algorithm, width) != ImageFormat::None;
+}
+
+static bool failed(std::string *error, const std::string &what)
+{
+    if(error) *error = what;
+    return false;
+}
+
+static void putVarint(std::string &out, uint64_t value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(char(value));
+}
+
+static bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value)
+{
+    value = 0;
+    for(int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        uint8_t byte = *p++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+/*
+ * QOI (https://qoiformat.org), on a stream of pixels without the file header.
+ * Unlike the reference codec, the encoder puts every pixel in the index, as the decoder does.
+ */
+
+struct Pixel
+{
+    uint8_t r, g, b, a;
+
+    bool operator==(const Pixel &o) const {return r == o.r && g == o.g && b == o.b && a == o.a;}
+    bool operator!=(const Pixel &o) const {return !(*this == o);}
+};
+
+static const uint8_t QOI_OP_INDEX = 0x00, QOI_OP_DIFF = 0x40, QOI_OP_LUMA = 0x80, QOI_OP_RUN = 0xc0, QOI_OP_RGB = 0xfe, QOI_OP_RGBA = 0xff;
+
+static inline int qoiHash(const Pixel &px)
+{
+    return (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) & 63;
+}
+
+static void qoiEncode(const uint8_t *data, size_t num_pixels, int channels, std::string &out)
+{
+    Pixel index[64] = {};
+    Pixel prev = {0, 0, 0, 255};
+    int run = 0;
+    for(size_t i = 0; i < num_pixels; i++, data += channels)
+    {
+        Pixel px = {data[0], data[1], data[2], uint8_t(channels == 4 ? data[3] : 255)};
+        if(px == prev)
+        {
+            if(++run == 62)
+            {
+                out.push_back(char(QOI_OP_RUN | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+        if(run > 0)
+        {
+            out.push_back(char(QOI_OP_RUN | (run - 1)));
+            run = 0;
+        }
+        int h = qoiHash(px);
+        if(index[h] == px)
+        {
+            out.push_back(char(QOI_OP_INDEX | h));
+        }
+        else if(px.a == prev.a)
+        {
+            int8_t vr = int8_t(px.r - prev.r), vg = int8_t(px.g - prev.g), vb = int8_t(px.b - prev.b);
+            int8_t vg_r = int8_t(vr - vg), vg_b = int8_t(vb - vg);
+            if(vr >= -2 && vr <= 1 && vg >= -2 && vg <= 1 && vb >= -2 && vb <= 1)
+            {
+                out.push_back(char(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+            }
+            else if(vg >= -32 && vg <= 31 && vg_r >= -8 && vg_r <= 7 && vg_b >= -8 && vg_b <= 7)
+            {
+                out.push_back(char(QOI_OP_LUMA | (vg + 32)));
+                out.push_back(char((vg_r + 8) << 4 | (vg_b + 8)));
+            }
+            else
+            {
+                char op[4] = {char(QOI_OP_RGB), char(px.r), char(px.g), char(px.b)};
+                out.append(op, 4);
+            }
+        }
+        else
+        {
+            char op[5] = {char(QOI_OP_RGBA), char(px.r), char(px.g), char(px.b), char(px.a)};
+            out.append(op, 5);
+        }
+        index[h] = px;
+        prev = px;
+    }
+    if(run > 0)
+        out.push_back(char(QOI_OP_RUN | (run - 1)));
+}
+
+static bool qoiDecode(const uint8_t *&p, const uint8_t *end, size_t num_pixels, int channels, uint8_t *dst, std::string *error)
+{
+    Pixel index[64] = {};
+    Pixel px = {0, 0, 0, 255};
+    int run = 0;
+    for(size_t i = 0; i < num_pixels; i++, dst += channels)
+    {
+        if(run > 0)
+        {
+            run--;
+        }
+        else
+        {
+            if(p >= end) return failed(error, "qoi: truncated payload");
+            uint8_t b1 = *p++;
+            if(b1 == QOI_OP_RGB)
+            {
+                if(end - p < 3) return failed(error, "qoi: truncated payload");
+                px.r = p[0]; px.g = p[1]; px.b = p[2];
+                p += 3;
+            }
+            else if(b1 == QOI_OP_RGBA)
+            {
+                if(end - p < 4) return failed(error, "qoi: truncated payload");
+                px.r = p[0]; px.g = p[1]; px.b = p[2]; px.a = p[3];
+                p += 4;
+            }
+            else if((b1 & 0xc0) == QOI_OP_INDEX)
+            {
+                px = index[b1];
+            }
+            else if((b1 & 0xc0) == QOI_OP_DIFF)
+            {
+                px.r += ((b1 >> 4) & 3) - 2;
+                px.g += ((b1 >> 2) & 3) - 2;
+                px.b += (b1 & 3) - 2;
+            }
+            else if((b1 & 0xc0) == QOI_OP_LUMA)
+            {
+                if(p >= end) return failed(error, "qoi: truncated payload");
+                uint8_t b2 = *p++;
+                int vg = (b1 & 0x3f) - 32;
+                px.r += vg - 8 + ((b2 >> 4) & 0x0f);
+                px.g += vg;
+                px.b += vg - 8 + (b2 & 0x0f);
+            }
+            else
+            {
+                run = b1 & 0x3f;
+            }
+        }
+        index[qoiHash(px)] = px;
+        dst[0] = px.r;
+        dst[1] = px.g;
+        dst[2] = px.b;
+        if(channels == 4) dst[3] = px.a;
+    }
+    if(run > 0) return failed(error, "qoi: run beyond the end of the image");
+    return true;
+}
+
+/*
+ * Lossless coding of 16-bit samples: the residual of the prediction of each sample,
+ * zigzag-mapped to an unsigned number, is coded with a Rice code whose parameter follows
+ * the running mean of the residuals (as in LOCO-I / JPEG-LS). Residuals too large for the
+ * unary part are escaped and written on 16 bits.
+ */
+
+//! Longest unary part of a Rice code, beyond which the residual is escaped
+static const unsigned RICE_LIMIT = 24;
+
+class BitWriter
+{
+public:
+    explicit BitWriter(std::string &out) : out_(out) {}
+
+    //! Write the n (at most 32) low bits of value, most significant first
+    void put(uint32_t value, unsigned n)
+    {
+        acc_ = (acc_ << n) | (value & ((uint64_t(1) << n) - 1));
+        bits_ += n;
+        while(bits_ >= 8)
+        {
+            bits_ -= 8;
+            out_.push_back(char(acc_ >> bits_));
+        }
+    }
+
+    void flush()
+    {
+        if(bits_ > 0) put(0, 8 - bits_);
+    }
+
+private:
+    std::string &out_;
+    uint64_t acc_{0};
+    unsigned bits_{0};
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t *p, const uint8_t *end) : p_(p), end_(end) {}
+
+    //! Read n (at most 32) bits; return false past the end of the data
+    bool get(unsigned n, uint32_t &value)
+    {
+        while(bits_ < n)
+        {
+            if(p_ >= end_) return false;
+            acc_ = (acc_ << 8) | *p_++;
+            bits_ += 8;
+        }
+        bits_ -= n;
+        value = uint32_t(acc_ >> bits_) & uint32_t((uint64_t(1) << n) - 1);
+        return true;
+    }
+
+    //! Count the 0 bits before the next 1 bit (at most limit)
+    bool unary(unsigned limit, unsigned &count)
+    {
+        uint32_t bit = 0;
+        for(count = 0; count <= limit; count++)
+        {
+            if(!get(1, bit)) return false;
+            if(bit) return true;
+        }
+        return false;
+    }
+
+    const uint8_t * position() const {return p_;}
+
+private:
+    const uint8_t *p_, *end_;
+    uint64_t acc_{0};
+    unsigned bits_{0};
+};
+
+//! Running mean of the residuals, giving the parameter of the Rice code
+struct RiceState
+{
+    uint32_t sum{16}, count{1};
+
+    unsigned k() const
+    {
+        unsigned k = 0;
+        while((count << k) < sum && k < 15) k++;
+        return k;
+    }
+
+    void update(uint32_t z)
+    {
+        sum += z;
+        if(++count >= 64)
+        {
+            sum >>= 1;
+            count >>= 1;
+        }
+    }
+};
+
+static inline uint16_t sample(const uint8_t *data, size_t i)
+{
+    return uint16_t(data[2 * i] | (data[2 * i + 1] << 8));
+}
+
+//! Median edge detector of LOCO-I, from the left (a), upper (b) and upper-left (c) samples
+static inline int predictMED(int a, int b, int c)
+{
+    int mn = std::min(a, b), mx = std::max(a, b);
+    return c >= mx ? mn : (c <= mn ? mx : a + b - c);
+}
+
+static inline uint16_t zigzag(uint16_t residual)
+{
+    return uint16_t((residual << 1) ^ (int16_t(residual) >> 15));
+}
+
+static inline uint16_t unzigzag(uint16_t z)
+{
+    return uint16_t((z >> 1) ^ (0u - (z & 1)));
+}
+
+static void depthEncode(const uint8_t *data, size_t n, size_t width, std::string &out)
+{
+    // the residuals first, in a pass without dependencies between samples (vectorized by the compiler):
+    std::vector<uint16_t> z(n);
+    size_t w = width ? width : n;
+    for(size_t row = 0; row < n; row += w)
+    {
+        size_t row_end = std::min(n, row + w);
+        if(row == 0 || !width)
+        {
+            z[row] = zigzag(uint16_t(sample(data, row) - (row ? sample(data, row - 1) : 0)));
+            for(size_t i = row + 1; i < row_end; i++)
+                z[i] = zigzag(uint16_t(sample(data, i) - sample(data, i - 1)));
+            continue;
+        }
+        z[row] = zigzag(uint16_t(sample(data, row) - sample(data, row - w)));
+        for(size_t i = row + 1; i < row_end; i++)
+            z[i] = zigzag(uint16_t(sample(data, i) - predictMED(sample(data, i - 1), sample(data, i - w), sample(data, i - w - 1))));
+    }
+
+    BitWriter writer(out);
+    RiceState state;
+    for(size_t i = 0; i < n; i++)
+    {
+        unsigned k = state.k();
+        uint32_t q = z[i] >> k;
+        if(q < RICE_LIMIT)
+        {
+            writer.put(1, q + 1);
+            writer.put(z[i], k);
+        }
+        else
+        {
+            writer.put(1, RICE_LIMIT + 1);
+            writer.put(z[i], 16);
+        }
+        state.update(z[i]);
+    }
+    writer.flush();
+}
+
+static bool depthDecode(const uint8_t *&p, const uint8_t *end, size_t n, size_t width, uint8_t *dst, std::string *error)
+{
+    BitReader reader(p, end);
+    RiceState state;
+    std::vector<uint16_t> s(n);
+    for(size_t i = 0; i < n; i++)
+    {
+        unsigned k = state.k(), q = 0;
+        uint32_t z = 0, low = 0;
+        if(!reader.unary(RICE_LIMIT, q))
+            return failed(error, "depth16: truncated payload");
+        if(q == RICE_LIMIT)
+        {
+            if(!reader.get(16, z)) return failed(error, "depth16: truncated payload");
+        }
+        else
+        {
+            if(!reader.get(k, low)) return failed(error, "depth16: truncated payload");
+            z = (q << k) | low;
+            if(z > 0xffff) return failed(error, "depth16: invalid residual");
+        }
+        state.update(z);
+
+        int pred;
+        if(!width || i < width)
+            pred = i ? s[i - 1] : 0;
+        else if(i % width == 0)
+            pred = s[i - width];
+        else
+            pred = predictMED(s[i - 1], s[i - width], s[i - width - 1]);
+        s[i] = uint16_t(pred + unzigzag(uint16_t(z)));
+        dst[2 * i] = uint8_t(s[i]);
+        dst[2 * i + 1] = uint8_t(s[i] >> 8);
+    }
+    p = reader.position();
+    return true;
+}
+
+void imageCompress(const std::string &algorithm, const char *data, size_t len, std::string &out)
+{
+    size_t width;
+    ImageFormat format = imageFormat(algorithm, width);
+    if(format == ImageFormat::None)
+        throw exception::UnsupportedCompressionAlgorithm(algorithm);
+
+    const uint8_t *src = reinterpret_cast<const uint8_t*>(data);
+    size_t pixel_size = format == ImageFormat::RGB ? 3 : format == ImageFormat::RGBA ? 4 : 2;
+    size_t n = len / pixel_size, tail = len % pixel_size;
+    out.clear();
+    putVarint(out, len);
+    if(format == ImageFormat::Depth16)
+        depthEncode(src, n, width, out);
+    else
+        qoiEncode(src, n, int(pixel_size), out);
+    out.append(data + len - tail, tail);
+}
+
+bool imageTryDecompress(const std::string &algorithm, const char *data, size_t len, std::string &out, size_t size, std::string *error)
+{
+    size_t width;
+    ImageFormat format = imageFormat(algorithm, width);
+    if(format == ImageFormat::None)
+        return failed(error, "unsupported compression algorithm '" + algorithm + "'");
+
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(data), *end = p + len;
+    uint64_t total = 0;
+    if(!getVarint(p, end, total) || (size && total != size))
+        return failed(error, algorithm + ": invalid size");
+    // the densest code is a run of 62 pixels in a byte, or 8 samples in a byte:
+    size_t pixel_size = format == ImageFormat::RGB ? 3 : format == ImageFormat::RGBA ? 4 : 2;
+    if(total / pixel_size > uint64_t(end - p) * (format == ImageFormat::Depth16 ? 8 : 62))
+        return failed(error, algorithm + ": invalid size");
+
+    size_t n = size_t(total) / pixel_size, tail = size_t(total) % pixel_size;
+    out.resize(size_t(total));
+    uint8_t *dst = reinterpret_cast<uint8_t*>(&out[0]);
+    bool ok = format == ImageFormat::Depth16
+        ? depthDecode(p, end, n, width, dst, error)
+        : qoiDecode(p, end, n, int(pixel_size), dst, error);
+    if(!ok) return false;
+    if(size_t(end - p) != tail)
+        return failed(error, (boost::format("%s: %d bytes left after the image") % algorithm % (end - p)).str());
+    std::copy(p, end, dst + n * pixel_size);
+    return true;
+}
+
+} // namespace compress
+
+} // namespace b0
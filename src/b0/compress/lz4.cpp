@@ -1,4 +1,7 @@
 #include <stdexcept>
+#include <algorithm>
+#include <memory>
+#include <vector>
 #include <cstring>
 
 #include <boost/format.hpp>
@@ -9,6 +12,8 @@
 #ifdef LZ4_FOUND
 
 #include <lz4.h>
+#include <lz4hc.h>
+#include <lz4frame.h>
 
 namespace b0
 {
@@ -16,25 +21,236 @@ namespace b0
 namespace compress
 {
 
-std::string lz4_compress(const std::string &str, int level)
+struct LZ4Context::Private
 {
-    std::string ret;
-    ret.reserve(LZ4_compressBound(str.size()));
-    int bytesWritten = LZ4_compress_default(str.data(), (char*)ret.data(), str.size(), ret.capacity());
+    ~Private()
+    {
+        if(cctx_) LZ4F_freeCompressionContext(cctx_);
+        if(dctx_) LZ4F_freeDecompressionContext(dctx_);
+    }
+
+    //! State of the default and fast modes
+    std::vector<char> state_;
+    //! State of the high compression mode (which is quite big)
+    std::vector<char> state_hc_;
+    //! Frame compression context
+    LZ4F_cctx *cctx_{nullptr};
+    //! Frame decompression context
+    LZ4F_dctx *dctx_{nullptr};
+};
+
+static void lz4fCheck(size_t err, const char *method)
+{
+    if(LZ4F_isError(err))
+        throw exception::Exception((boost::format("lz4f %s failed: %s") % method % LZ4F_getErrorName(err)).str());
+}
+
+static bool failed(std::string *error, const std::string &what)
+{
+    if(error) *error = what;
+    return false;
+}
+
+static bool lz4fFailed(std::string *error, size_t err, const char *method)
+{
+    return failed(error, (boost::format("lz4f %s failed: %s") % method % LZ4F_getErrorName(err)).str());
+}
+
+LZ4Context::LZ4Context()
+    : private_(new Private)
+{
+}
+
+LZ4Context::~LZ4Context()
+{
+}
+
+void LZ4Context::compress(const char *data, size_t len, std::string &out, int level)
+{
+    out.resize(LZ4_compressBound(len));
+    int bytesWritten;
+    if(level > 1)
+    {
+        // high compression mode
+        std::vector<char> &state = private_->state_hc_;
+        if(state.empty()) state.resize(LZ4_sizeofStateHC());
+        int hc_level = std::max(LZ4HC_CLEVEL_MIN, std::min(LZ4HC_CLEVEL_MAX, level));
+        bytesWritten = LZ4_compress_HC_extStateHC(state.data(), data, &out[0], len, out.size(), hc_level);
+    }
+    else
+    {
+        // fast mode (the acceleration factor trades compression ratio for speed), or default mode
+        std::vector<char> &state = private_->state_;
+        if(state.empty()) state.resize(LZ4_sizeofState());
+        int acceleration = level < -1 ? -level : 1;
+        bytesWritten = LZ4_compress_fast_extState(state.data(), data, &out[0], len, out.size(), acceleration);
+    }
     if(!bytesWritten)
         throw exception::Exception("lz4 compress failed");
-    ret.assign(ret.data(), bytesWritten);
+    out.resize(bytesWritten);
+}
+
+void LZ4Context::decompress(const char *data, size_t len, std::string &out, size_t size)
+{
+    std::string error;
+    if(!tryDecompress(data, len, out, size, &error))
+        throw exception::Exception(error);
+}
+
+bool LZ4Context::tryDecompress(const char *data, size_t len, std::string &out, size_t size, std::string *error)
+{
+    if(size)
+    {
+        // the uncompressed size is known (it is always sent in the envelope): single exact allocation
+        out.resize(size);
+        int bytesWritten = LZ4_decompress_safe(data, &out[0], len, out.size());
+        if(bytesWritten < 0)
+            return failed(error, "lz4 decompress failed");
+        out.resize(bytesWritten);
+        return true;
+    }
+
+    // otherwise grow the buffer until the block fits, up to the maximum lz4 ratio (255:1)
+    size_t max_size = len * 255 + 16;
+    for(size_t capacity = std::min(max_size, std::max(len * 4, size_t(64))); ; capacity = std::min(max_size, capacity * 2))
+    {
+        out.resize(capacity);
+        int bytesWritten = LZ4_decompress_safe(data, &out[0], len, out.size());
+        if(bytesWritten >= 0)
+        {
+            out.resize(bytesWritten);
+            return true;
+        }
+        if(capacity == max_size)
+            return failed(error, "lz4 decompress failed");
+    }
+}
+
+void LZ4Context::compressFrame(const char *data, size_t len, std::string &out, int level)
+{
+    if(!private_->cctx_)
+        lz4fCheck(LZ4F_createCompressionContext(&private_->cctx_, LZ4F_VERSION), "compress");
+
+    LZ4F_preferences_t prefs;
+    memset(&prefs, 0, sizeof(prefs));
+    prefs.frameInfo.contentSize = len;
+    prefs.compressionLevel = level == -1 ? 0 : level;
+    prefs.autoFlush = 1;
+    // same steps as LZ4F_compressFrame(), but without creating a new context each time
+    out.resize(LZ4F_compressFrameBound(len, &prefs));
+    char *dst = &out[0], *dst_end = dst + out.size();
+    size_t ret = LZ4F_compressBegin(private_->cctx_, dst, dst_end - dst, &prefs);
+    lz4fCheck(ret, "compress");
+    dst += ret;
+    ret = LZ4F_compressUpdate(private_->cctx_, dst, dst_end - dst, data, len, nullptr);
+    lz4fCheck(ret, "compress");
+    dst += ret;
+    ret = LZ4F_compressEnd(private_->cctx_, dst, dst_end - dst, nullptr);
+    lz4fCheck(ret, "compress");
+    dst += ret;
+    out.resize(dst - out.data());
+}
+
+void LZ4Context::decompressFrame(const char *data, size_t len, std::string &out, size_t size)
+{
+    std::string error;
+    if(!tryDecompressFrame(data, len, out, size, &error))
+        throw exception::Exception(error);
+}
+
+bool LZ4Context::tryDecompressFrame(const char *data, size_t len, std::string &out, size_t size, std::string *error)
+{
+    LZ4F_dctx *&dctx = private_->dctx_;
+    if(!dctx)
+    {
+        size_t err = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+        if(LZ4F_isError(err))
+        {
+            dctx = nullptr;
+            return lz4fFailed(error, err, "decompress");
+        }
+    }
+    else
+        LZ4F_resetDecompressionContext(dctx);
+
+    const char *src = data, *src_end = data + len;
+
+    // the frame header carries the content size: use it to do a single exact allocation
+    LZ4F_frameInfo_t info;
+    size_t src_size = len;
+    size_t err = LZ4F_getFrameInfo(dctx, &info, src, &src_size);
+    if(LZ4F_isError(err))
+        return lz4fFailed(error, err, "decompress");
+    src += src_size;
+    if(!size) size = info.contentSize;
+
+    // stream the blocks into the output buffer, which grows only if the size is unknown
+    bool grow = size == 0;
+    out.resize(size ? size : std::max(len * 4, size_t(65536)));
+    size_t dst_pos = 0;
+    while(err != 0)
+    {
+        if(grow && dst_pos == out.size())
+            out.resize(out.size() * 2);
+        size_t dst_size = out.size() - dst_pos;
+        src_size = src_end - src;
+        err = LZ4F_decompress(dctx, &out[dst_pos], &dst_size, src, &src_size, nullptr);
+        if(LZ4F_isError(err))
+            return lz4fFailed(error, err, "decompress");
+        src += src_size;
+        dst_pos += dst_size;
+        if(err != 0 && src_size == 0 && dst_size == 0)
+        {
+            // leave the context in a clean state for the next frame
+            LZ4F_resetDecompressionContext(dctx);
+            return failed(error, "lz4f decompress failed: truncated frame or wrong content size");
+        }
+    }
+    out.resize(dst_pos);
+    return true;
+}
+
+static LZ4Context & lz4Context()
+{
+    static thread_local LZ4Context context;
+    return context;
+}
+
+std::string lz4_compress(const std::string &str, int level)
+{
+    std::string ret;
+    lz4Context().compress(str.data(), str.size(), ret, level);
     return ret;
 }
 
 std::string lz4_decompress(const std::string &str, size_t size)
+{
+    return lz4_decompress(str.data(), str.size(), size);
+}
+
+std::string lz4_decompress(const char *data, size_t len, size_t size)
+{
+    std::string ret;
+    lz4Context().decompress(data, len, ret, size);
+    return ret;
+}
+
+std::string lz4f_compress(const std::string &str, int level)
+{
+    std::string ret;
+    lz4Context().compressFrame(str.data(), str.size(), ret, level);
+    return ret;
+}
+
+std::string lz4f_decompress(const std::string &str, size_t size)
+{
+    return lz4f_decompress(str.data(), str.size(), size);
+}
+
+std::string lz4f_decompress(const char *data, size_t len, size_t size)
 {
     std::string ret;
-    ret.reserve(size ? size : str.size() * 10);
-    int bytesWritten = LZ4_decompress_safe(str.data(), (char*)ret.data(), str.size(), ret.capacity());
-    if(bytesWritten < 0)
-        throw exception::Exception("lz4 decompress failed");
-    ret.assign(ret.data(), bytesWritten);
+    lz4Context().decompressFrame(data, len, ret, size);
     return ret;
 }
 
@@ -1,60 +1,243 @@
 #include <stdexcept>
+#include <algorithm>
+#include <cstdint>
 #include <cstring>
+#include <vector>
 
 #include <boost/format.hpp>
 
 #include <b0/exceptions.h>
 #include <b0/compress/zlib.h>
+#include <b0/utils/env.h>
 
 #ifdef ZLIB_FOUND
 
 #include <zlib.h>
 
+#ifdef ENABLE_ISAL
+#include <isa-l/igzip_lib.h>
+#endif
+
 namespace b0
 {
 
 namespace compress
 {
 
-std::string zlib_wrapper(const std::string &str, bool compress, int level, size_t size)
+struct ZlibContext::Private
+{
+    ~Private()
+    {
+        if(deflate_init_) deflateEnd(&deflate_);
+        if(inflate_init_) inflateEnd(&inflate_);
+    }
+
+    z_stream deflate_;
+    bool deflate_init_{false};
+    int deflate_level_{0};
+    z_stream inflate_;
+    bool inflate_init_{false};
+#ifdef ENABLE_ISAL
+    //! Working memory of the ISA-L compression level in use
+    std::vector<uint8_t> isal_level_buf_;
+#endif
+};
+
+#ifdef ENABLE_ISAL
+
+static bool isalEnabled()
+{
+    static const bool enabled = b0::env::get("B0_ZLIB_BACKEND", "isal") != "zlib";
+    return enabled;
+}
+
+/*
+ * ISA-L (igzip) writes the same zlib streams as zlib, several times faster, with levels 1
+ * to 3 instead of 1 to 9. Whatever it cannot do (level 0, an output which does not fit the
+ * buffer, a stream with a preset dictionary, ...) is left to zlib.
+ */
+
+static bool isalCompress(std::vector<uint8_t> &level_buf, const char *data, size_t len, std::string &out, int level)
+{
+    if(level <= 0 || len > UINT32_MAX / 2) return false;
+    int isal_level = level <= 2 ? 1 : level <= 5 ? 2 : 3;
+    size_t level_buf_size = isal_level == 1 ? ISAL_DEF_LVL1_DEFAULT : isal_level == 2 ? ISAL_DEF_LVL2_DEFAULT : ISAL_DEF_LVL3_DEFAULT;
+    if(level_buf.size() < level_buf_size) level_buf.resize(level_buf_size);
+
+    struct isal_zstream zs;
+    isal_deflate_stateless_init(&zs);
+    zs.level = isal_level;
+    zs.level_buf = level_buf.data();
+    zs.level_buf_size = uint32_t(level_buf.size());
+    zs.gzip_flag = IGZIP_ZLIB;
+    zs.end_of_stream = 1;
+    zs.flush = NO_FLUSH;
+    // a bit more than deflateBound(): stored blocks with the zlib header and trailer
+    out.resize(len + len / 16 + 256);
+    zs.next_in = reinterpret_cast<uint8_t*>(const_cast<char*>(data));
+    zs.avail_in = uint32_t(len);
+    zs.next_out = reinterpret_cast<uint8_t*>(&out[0]);
+    zs.avail_out = uint32_t(out.size());
+    if(isal_deflate_stateless(&zs) != COMP_OK) return false;
+    out.resize(zs.total_out);
+    return true;
+}
+
+static bool isalDecompress(const char *data, size_t len, std::string &out, size_t size)
+{
+    // ISA-L's one-shot inflate needs the exact size, which the envelopes always carry
+    if(size == 0 || size > UINT32_MAX || len > UINT32_MAX) return false;
+    struct inflate_state state;
+    isal_inflate_init(&state);
+    state.crc_flag = ISAL_ZLIB;
+    out.resize(size);
+    state.next_in = reinterpret_cast<uint8_t*>(const_cast<char*>(data));
+    state.avail_in = uint32_t(len);
+    state.next_out = reinterpret_cast<uint8_t*>(&out[0]);
+    state.avail_out = uint32_t(size);
+    return isal_inflate_stateless(&state) == ISAL_DECOMP_OK && state.total_out == size;
+}
+
+#endif // ENABLE_ISAL
+
+static std::string zlibErrorString(const char *method, int ret, const z_stream &zs)
+{
+    return (boost::format("zlib %s error %d%s%s") % method % ret % (zs.msg ? ": " : "") % (zs.msg ? zs.msg : "")).str();
+}
+
+static void zlibError(const char *method, int ret, const z_stream &zs)
+{
+    throw exception::Exception(zlibErrorString(method, ret, zs));
+}
+
+static bool failed(std::string *error, const std::string &what)
+{
+    if(error) *error = what;
+    return false;
+}
+
+ZlibContext::ZlibContext()
+    : private_(new Private)
+{
+}
+
+ZlibContext::~ZlibContext()
+{
+}
+
+void ZlibContext::compress(const char *data, size_t len, std::string &out, int level)
 {
     if(level == -1) level = Z_BEST_COMPRESSION;
-    const char *method = compress ? "deflate" : "inflate";
-    int ret;
-    z_stream zs;
-    memset(&zs, 0, sizeof(zs));
-    if(compress) ret = deflateInit(&zs, level); else ret = inflateInit(&zs);
-    if(ret != Z_OK)
-        throw exception::Exception((boost::format("%sInit failed") % method).str());;
-    zs.next_in = (Bytef*)(str.data());
-    zs.avail_in = str.size();
-    if(size == 0) size = str.size() * (compress ? 2 : 10);
-    char *outbuf = new char[size];
-    std::string outstr;
-    do
+#ifdef ENABLE_ISAL
+    if(isalEnabled() && isalCompress(private_->isal_level_buf_, data, len, out, level))
+        return;
+#endif
+    z_stream &zs = private_->deflate_;
+    if(private_->deflate_init_ && private_->deflate_level_ != level)
+    {
+        deflateEnd(&zs);
+        private_->deflate_init_ = false;
+    }
+    if(!private_->deflate_init_)
     {
-        zs.next_out = reinterpret_cast<Bytef*>(outbuf);
-        zs.avail_out = sizeof(outbuf);
-        ret = compress ? deflate(&zs, Z_FINISH) : inflate(&zs, 0);
-        if(outstr.size() < zs.total_out)
-            outstr.append(outbuf, zs.total_out - outstr.size());
+        memset(&zs, 0, sizeof(zs));
+        if(deflateInit(&zs, level) != Z_OK)
+            throw exception::Exception("deflateInit failed");
+        private_->deflate_init_ = true;
+        private_->deflate_level_ = level;
     }
-    while(ret == Z_OK);
-    if(compress) deflateEnd(&zs); else inflateEnd(&zs);
-    delete[] outbuf;
+    else if(deflateReset(&zs) != Z_OK)
+        throw exception::Exception("deflateReset failed");
+
+    // deflateBound() is large enough for a single deflate() call
+    out.resize(deflateBound(&zs, len));
+    zs.next_in = (Bytef*)(data);
+    zs.avail_in = len;
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = out.size();
+    int ret = deflate(&zs, Z_FINISH);
     if(ret != Z_STREAM_END)
-        throw exception::Exception((boost::format("zlib %s error %d%s%s") % method % ret % (zs.msg ? ": " : "") % (zs.msg ? zs.msg : "")).str());
-    return outstr;
+        zlibError("deflate", ret, zs);
+    out.resize(zs.total_out);
+}
+
+void ZlibContext::decompress(const char *data, size_t len, std::string &out, size_t size)
+{
+    std::string error;
+    if(!tryDecompress(data, len, out, size, &error))
+        throw exception::Exception(error);
+}
+
+bool ZlibContext::tryDecompress(const char *data, size_t len, std::string &out, size_t size, std::string *error)
+{
+#ifdef ENABLE_ISAL
+    if(isalEnabled() && isalDecompress(data, len, out, size))
+        return true;
+#endif
+    z_stream &zs = private_->inflate_;
+    if(!private_->inflate_init_)
+    {
+        memset(&zs, 0, sizeof(zs));
+        if(inflateInit(&zs) != Z_OK)
+            return failed(error, "inflateInit failed");
+        private_->inflate_init_ = true;
+    }
+    else if(inflateReset(&zs) != Z_OK)
+        return failed(error, "inflateReset failed");
+
+    // the uncompressed size is known (it is always sent in the envelope): single exact allocation,
+    // otherwise grow the buffer as needed
+    out.resize(size ? size : std::max(len * 4, size_t(64)));
+    zs.next_in = (Bytef*)(data);
+    zs.avail_in = len;
+    int ret;
+    while(true)
+    {
+        zs.next_out = reinterpret_cast<Bytef*>(&out[zs.total_out]);
+        zs.avail_out = out.size() - zs.total_out;
+        ret = inflate(&zs, Z_FINISH);
+        if(ret == Z_STREAM_END) break;
+        if(ret != Z_BUF_ERROR && ret != Z_OK)
+            return failed(error, zlibErrorString("inflate", ret, zs));
+        if(zs.avail_out != 0)
+            return failed(error, zlibErrorString("inflate", Z_DATA_ERROR, zs)); // truncated input
+        out.resize(out.size() * 2);
+    }
+    out.resize(zs.total_out);
+    return true;
+}
+
+std::string zlib_backend()
+{
+#ifdef ENABLE_ISAL
+    if(isalEnabled()) return "isal";
+#endif
+    return "zlib";
+}
+
+static ZlibContext & zlibContext()
+{
+    static thread_local ZlibContext context;
+    return context;
 }
 
 std::string zlib_compress(const std::string &str, int level)
 {
-    return zlib_wrapper(str, true, level, 0);
+    std::string ret;
+    zlibContext().compress(str.data(), str.size(), ret, level);
+    return ret;
 }
 
 std::string zlib_decompress(const std::string &str, size_t size)
 {
-    return zlib_wrapper(str, false, 0, size);
+    return zlib_decompress(str.data(), str.size(), size);
+}
+
+std::string zlib_decompress(const char *data, size_t len, size_t size)
+{
+    std::string ret;
+    zlibContext().decompress(data, len, ret, size);
+    return ret;
 }
 
 } // namespace compress
@@ -0,0 +1,222 @@
+#include <stdexcept>
+#include <cstring>
+
+#include <boost/format.hpp>
+
+#include <b0/exceptions.h>
+#include <b0/compress/compress.h>
+#include <b0/compress/zstd.h>
+
+#ifdef ZSTD_FOUND
+
+#include <map>
+#include <memory>
+
+#include <boost/thread/mutex.hpp>
+
+#include <zstd.h>
+#include <zdict.h>
+
+namespace b0
+{
+
+namespace compress
+{
+
+struct ZstdContext::Private
+{
+    Private() : cctx(ZSTD_createCCtx()), dctx(ZSTD_createDCtx()) {}
+    ~Private() {ZSTD_freeCCtx(cctx); ZSTD_freeDCtx(dctx);}
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+};
+
+//! A dictionary digested for compression (for each level) and for decompression
+struct ZstdDictionary
+{
+    ~ZstdDictionary()
+    {
+        for(auto &p : cdicts) ZSTD_freeCDict(p.second);
+        if(ddict) ZSTD_freeDDict(ddict);
+    }
+    std::string data;
+    boost::mutex mutex;
+    std::map<int, ZSTD_CDict*> cdicts;
+    ZSTD_DDict *ddict{nullptr};
+};
+
+//! Return the digested dictionary with the given id, or null if it cannot be found
+static std::shared_ptr<ZstdDictionary> findZstdDictionary(const std::string &id)
+{
+    static boost::mutex mutex;
+    static std::map<std::string, std::shared_ptr<ZstdDictionary> > *cache = new std::map<std::string, std::shared_ptr<ZstdDictionary> >;
+
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        auto it = cache->find(id);
+        if(it != cache->end()) return it->second;
+    }
+
+    std::shared_ptr<ZstdDictionary> dict = std::make_shared<ZstdDictionary>();
+    if(!getDictionary(id, dict->data))
+        return nullptr;
+
+    boost::mutex::scoped_lock lock(mutex);
+    auto r = cache->insert(std::make_pair(id, dict));
+    return r.first->second;
+}
+
+static std::shared_ptr<ZstdDictionary> zstdDictionary(const std::string &id)
+{
+    std::shared_ptr<ZstdDictionary> dict = findZstdDictionary(id);
+    if(!dict)
+        throw exception::Exception((boost::format("unknown zstd dictionary '%s'") % id).str());
+    return dict;
+}
+
+static bool failed(std::string *error, const std::string &what)
+{
+    if(error) *error = what;
+    return false;
+}
+
+static inline int zstdLevel(int level)
+{
+    // -1 means default (which is 3 for zstd)
+    return level == -1 ? 3 : level;
+}
+
+ZstdContext::ZstdContext()
+    : private_(new Private)
+{
+}
+
+ZstdContext::~ZstdContext()
+{
+}
+
+void ZstdContext::compress(const char *data, size_t len, std::string &out, int level, const std::string &dictionary)
+{
+    level = zstdLevel(level);
+    out.resize(ZSTD_compressBound(len));
+    ZSTD_CCtx *cctx = private_->cctx;
+    size_t bytesWritten;
+    if(dictionary.empty())
+    {
+        bytesWritten = ZSTD_compressCCtx(cctx, &out[0], out.size(), data, len, level);
+    }
+    else
+    {
+        std::shared_ptr<ZstdDictionary> dict = zstdDictionary(dictionary);
+        ZSTD_CDict *cdict;
+        {
+            boost::mutex::scoped_lock lock(dict->mutex);
+            ZSTD_CDict *&c = dict->cdicts[level];
+            if(!c) c = ZSTD_createCDict(dict->data.data(), dict->data.size(), level);
+            cdict = c;
+        }
+        if(!cdict)
+            throw exception::Exception("zstd dictionary load failed");
+        bytesWritten = ZSTD_compress_usingCDict(cctx, &out[0], out.size(), data, len, cdict);
+    }
+    if(ZSTD_isError(bytesWritten))
+        throw exception::Exception((boost::format("zstd compress failed: %s") % ZSTD_getErrorName(bytesWritten)).str());
+    out.resize(bytesWritten);
+}
+
+void ZstdContext::decompress(const char *data, size_t len, std::string &out, size_t size, const std::string &dictionary)
+{
+    std::string error;
+    if(!tryDecompress(data, len, out, size, dictionary, &error))
+        throw exception::Exception(error);
+}
+
+bool ZstdContext::tryDecompress(const char *data, size_t len, std::string &out, size_t size, const std::string &dictionary, std::string *error)
+{
+    if(size == 0)
+    {
+        // the content size is always stored in the frames written by zstd_compress()
+        unsigned long long content_size = ZSTD_getFrameContentSize(data, len);
+        if(content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size == ZSTD_CONTENTSIZE_ERROR)
+            return failed(error, "zstd decompress failed: unknown content size");
+        size = content_size;
+    }
+
+    out.resize(size);
+    ZSTD_DCtx *dctx = private_->dctx;
+    size_t bytesWritten;
+    if(dictionary.empty())
+    {
+        bytesWritten = ZSTD_decompressDCtx(dctx, &out[0], out.size(), data, len);
+    }
+    else
+    {
+        std::shared_ptr<ZstdDictionary> dict = findZstdDictionary(dictionary);
+        if(!dict)
+            return failed(error, (boost::format("unknown zstd dictionary '%s'") % dictionary).str());
+        ZSTD_DDict *ddict;
+        {
+            boost::mutex::scoped_lock lock(dict->mutex);
+            if(!dict->ddict) dict->ddict = ZSTD_createDDict(dict->data.data(), dict->data.size());
+            ddict = dict->ddict;
+        }
+        if(!ddict)
+            return failed(error, "zstd dictionary load failed");
+        bytesWritten = ZSTD_decompress_usingDDict(dctx, &out[0], out.size(), data, len, ddict);
+    }
+    if(ZSTD_isError(bytesWritten))
+        return failed(error, (boost::format("zstd decompress failed: %s") % ZSTD_getErrorName(bytesWritten)).str());
+    out.resize(bytesWritten);
+    return true;
+}
+
+static ZstdContext & zstdContext()
+{
+    static thread_local ZstdContext context;
+    return context;
+}
+
+std::string zstd_compress(const std::string &str, int level, const std::string &dictionary)
+{
+    std::string ret;
+    zstdContext().compress(str.data(), str.size(), ret, level, dictionary);
+    return ret;
+}
+
+std::string zstd_decompress(const std::string &str, size_t size, const std::string &dictionary)
+{
+    return zstd_decompress(str.data(), str.size(), size, dictionary);
+}
+
+std::string zstd_decompress(const char *data, size_t len, size_t size, const std::string &dictionary)
+{
+    std::string ret;
+    zstdContext().decompress(data, len, ret, size, dictionary);
+    return ret;
+}
+
+std::string zstd_train_dictionary(const std::vector<std::string> &samples, size_t max_size)
+{
+    std::string buffer;
+    std::vector<size_t> sizes;
+    sizes.reserve(samples.size());
+    for(auto &sample : samples)
+    {
+        buffer.append(sample);
+        sizes.push_back(sample.size());
+    }
+
+    std::string ret;
+    ret.resize(max_size);
+    size_t dict_size = ZDICT_trainFromBuffer(&ret[0], ret.size(), buffer.data(), sizes.data(), sizes.size());
+    if(ZDICT_isError(dict_size))
+        throw exception::Exception((boost::format("zstd dictionary training failed: %s") % ZDICT_getErrorName(dict_size)).str());
+    ret.resize(dict_size);
+    return ret;
+}
+
+} // namespace compress
+
+} // namespace b0
+
+#endif // ZSTD_FOUND
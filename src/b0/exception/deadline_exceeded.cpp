@@ -0,0 +1,18 @@
+#include <b0/exception/deadline_exceeded.h>
+
+#include <boost/format.hpp>
+
+namespace b0
+{
+
+namespace exception
+{
+
+DeadlineExceeded::DeadlineExceeded(std::string name)
+    : Exception((boost::format("Call to '%s' not answered before its deadline") % name).str())
+{
+}
+
+} // namespace exception
+
+} // namespace b0
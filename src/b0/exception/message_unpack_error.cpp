@@ -33,6 +33,11 @@ EnvelopeDecodeError::EnvelopeDecodeError()
 {
 }
 
+ChecksumMismatch::ChecksumMismatch(std::string part)
+    : MessageUnpackError((boost::format("Checksum mismatch (%s)") % part).str())
+{
+}
+
 SocketReadError::SocketReadError()
     : MessageUnpackError("Socket read error (recv() failed)")
 {
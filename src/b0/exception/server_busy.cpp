@@ -0,0 +1,18 @@
+#include <b0/exception/server_busy.h>
+
+#include <boost/format.hpp>
+
+namespace b0
+{
+
+namespace exception
+{
+
+ServerBusy::ServerBusy(std::string name)
+    : Exception((boost::format("Call to '%s' rejected: the server is busy") % name).str())
+{
+}
+
+} // namespace exception
+
+} // namespace b0
@@ -1,14 +1,18 @@
 #include <b0/logger/logger.h>
 #include <b0/publisher.h>
+#include <b0/process_agent.h>
 #include <b0/message/log/log_entry.h>
+#include <b0/message/log/log_entry_batch.h>
 #include <b0/node.h>
 #include <b0/exception/argument_error.h>
 #include <b0/utils/thread_name.h>
+#include <b0/utils/thread_config.h>
 #include <b0/utils/env.h>
 
 #include <iostream>
 #include <iomanip>
 #include <chrono>
+#include <algorithm>
 
 #include <boost/lexical_cast.hpp>
 
@@ -18,6 +22,11 @@ namespace b0
 namespace logger
 {
 
+bool LogInterface::isLevelEnabled(Level level) const
+{
+    return true;
+}
+
 void LogInterface::log_helper(Level level, boost::format &format) const
 {
     return log(level, format.str());
@@ -37,15 +46,34 @@ LocalLogger::~LocalLogger()
 {
 }
 
+bool LocalLogger::isLevelEnabled(Level level) const
+{
+    return level >= outputLevel_;
+}
+
+void LocalLogger::setOutputLevel(Level level)
+{
+    outputLevel_ = level;
+}
+
+Level LocalLogger::getOutputLevel() const
+{
+    return outputLevel_;
+}
+
 void LocalLogger::log(Level level, const std::string &message) const
 {
     if(level < outputLevel_) return;
 
-    LevelInfo info = levelInfo(level);
+    print(level, message, std::chrono::system_clock::now());
+}
+
+void LocalLogger::print(Level level, const std::string &message, std::chrono::system_clock::time_point now) const
+{
+    const LevelInfo &info = levelInfo(level);
     std::stringstream ss;
     if(color_) ss << info.ansiEscape();
 
-    auto now = std::chrono::system_clock::now();
     std::time_t time = std::chrono::system_clock::to_time_t(now);
     ss << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S ");
 
@@ -64,6 +92,98 @@ void LocalLogger::log(Level level, const std::string &message) const
     std::cout << ss.str() << std::endl;
 }
 
+//! \cond HIDDEN_SYMBOLS
+
+struct LogRecord
+{
+    Level level;
+    std::string message;
+    std::chrono::system_clock::time_point time;
+    int64_t time_usec;
+};
+
+/*!
+ * Bounded lock-free queue of log records (multi-producer, see D. Vyukov's bounded MPMC queue)
+ */
+class LogRingBuffer
+{
+public:
+    //! The largest capacity, which also keeps the rounding to a power of two from overflowing
+    static const size_t max_capacity = size_t(1) << 20;
+
+    LogRingBuffer(size_t capacity)
+    {
+        size_t n = 2;
+        while(n < capacity && n < max_capacity) n <<= 1;
+        cells_.reset(new Cell[n]);
+        mask_ = n - 1;
+        for(size_t i = 0; i < n; i++)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        enqueue_pos_.store(0, std::memory_order_relaxed);
+        dequeue_pos_.store(0, std::memory_order_relaxed);
+    }
+
+    bool tryPush(LogRecord &&record)
+    {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while(true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if(diff == 0)
+            {
+                if(enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if(diff < 0)
+                return false; // full
+            else
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+        cell->record = std::move(record);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(LogRecord &record)
+    {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while(true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+            if(diff == 0)
+            {
+                if(dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if(diff < 0)
+                return false; // empty
+            else
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+        }
+        record = std::move(cell->record);
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        LogRecord record;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    std::atomic<size_t> enqueue_pos_;
+    std::atomic<size_t> dequeue_pos_;
+};
+
 struct Logger::Private
 {
     Private(Node *node)
@@ -72,45 +192,298 @@ struct Logger::Private
     }
 
     Publisher pub_;
+
+    //! The agent publishing the entries instead of pub_ (see b0::setProcessAgent())
+    std::shared_ptr<ProcessAgent> agent_;
+
+    //! Protects pub_ (which is used by the background thread in the asynchronous logging mode) and batch_
+    boost::mutex pub_mutex_;
+
+    //! Maximum number of entries in a batch (batching is disabled if less than 2)
+    size_t batch_size_{1};
+
+    //! Maximum time an entry waits in the batch before being sent
+    std::chrono::steady_clock::duration batch_interval_;
+
+    //! The entries waiting to be sent
+    b0::message::log::LogEntryBatch batch_;
+
+    //! Time of the first entry in batch_
+    std::chrono::steady_clock::time_point batch_start_;
+
+    //! True if batch_ is not empty (checked without locking)
+    std::atomic<bool> batch_pending_{false};
+
+    //! If true the entries are sent to the subtopics of their level and node (see b0::setHierarchicalLogTopics())
+    bool hierarchical_{false};
+
+    //! The subtopic of the entries in batch_
+    std::string batch_subtopic_;
+
+    //! Publish an entry or a batch of entries (pub_mutex_ must be locked)
+    template<class TMsg>
+    void publish(const std::string &subtopic, const TMsg &msg)
+    {
+        if(agent_)
+        {
+            agent_->publishLog(subtopic, msg);
+            return;
+        }
+        pub_.setSubtopic(subtopic);
+        pub_.publish(msg);
+    }
+
+    //! Send the batched entries (pub_mutex_ must be locked)
+    void sendBatch()
+    {
+        if(batch_.entries.empty()) return;
+        publish(batch_subtopic_, batch_);
+        batch_.entries.clear();
+        batch_pending_.store(false);
+    }
+
+    //! Queue of the asynchronous logging mode (null if logging synchronously)
+    std::unique_ptr<LogRingBuffer> queue_;
+
+    //! If true wait for room in the queue, otherwise drop the message
+    bool block_{false};
+
+    //! Number of messages dropped because the queue was full
+    std::atomic<uint64_t> dropped_{0};
+
+    //! Set to stop the background thread
+    std::atomic<bool> stop_{false};
+
+    //! The background thread of the asynchronous logging mode
+    boost::thread thread_;
 };
 
+//! \endcond
+
 Logger::Logger(b0::Node *node)
     : LocalLogger(node),
+      remoteOutputLevel_(getRemoteLogLevel()),
+      minOutputLevel_(std::min(outputLevel_.load(), remoteOutputLevel_.load())),
       private_(new Private(node))
 {
+    private_->batch_size_ = std::max(1, b0::env::getInt("B0_LOG_BATCH_SIZE", 1));
+    private_->batch_interval_ = std::chrono::milliseconds(b0::env::getInt("B0_LOG_BATCH_INTERVAL", 100));
+    if(private_->batch_size_ > 1)
+        private_->batch_.entries.reserve(private_->batch_size_);
+    private_->hierarchical_ = getHierarchicalLogTopics();
+
+    if(getAsyncLogging())
+    {
+        // a negative or zero size falls back to the default (and LogRingBuffer limits the largest):
+        int queue_size = b0::env::getInt("B0_ASYNC_LOGGING_QUEUE_SIZE", 4096);
+        private_->queue_.reset(new LogRingBuffer(queue_size > 0 ? queue_size : 4096));
+        private_->block_ = b0::env::getBool("B0_ASYNC_LOGGING_BLOCK");
+        private_->thread_ = boost::thread(&Logger::asyncLoop, this);
+    }
 }
 
 Logger::~Logger()
 {
+    if(private_->thread_.joinable())
+    {
+        // the background thread drains the queue before exiting:
+        private_->stop_.store(true);
+        private_->thread_.join();
+    }
+
+    boost::mutex::scoped_lock lock(private_->pub_mutex_);
+    private_->sendBatch();
+}
+
+void Logger::flush() const
+{
+    if(!private_->batch_pending_.load()) return;
+
+    boost::mutex::scoped_lock lock(private_->pub_mutex_);
+    private_->sendBatch();
+}
+
+void Logger::flushIfDue() const
+{
+    if(!private_->batch_pending_.load()) return;
+
+    boost::mutex::scoped_lock lock(private_->pub_mutex_);
+    if(std::chrono::steady_clock::now() - private_->batch_start_ >= private_->batch_interval_)
+        private_->sendBatch();
+}
+
+uint64_t Logger::getDroppedCount() const
+{
+    return private_->dropped_.load();
 }
 
 void Logger::connect(const std::string &addr)
 {
+    boost::mutex::scoped_lock lock(private_->pub_mutex_);
     private_->pub_.setRemoteAddress(addr);
     private_->pub_.init();
 }
 
+void Logger::connect(std::shared_ptr<ProcessAgent> agent)
+{
+    boost::mutex::scoped_lock lock(private_->pub_mutex_);
+    private_->agent_ = agent;
+}
+
+bool Logger::isLevelEnabled(Level level) const
+{
+    return level >= minOutputLevel_;
+}
+
+void Logger::setOutputLevel(Level level)
+{
+    LocalLogger::setOutputLevel(level);
+    minOutputLevel_ = std::min(level, remoteOutputLevel_.load());
+}
+
+void Logger::setRemoteOutputLevel(Level level)
+{
+    remoteOutputLevel_ = level;
+    minOutputLevel_ = std::min(outputLevel_.load(), level);
+}
+
+Level Logger::getRemoteOutputLevel() const
+{
+    return remoteOutputLevel_;
+}
+
 void Logger::log(Level level, const std::string &message) const
 {
+    if(private_->queue_)
+    {
+        if(level < minOutputLevel_) return;
+
+        LogRecord record{level, message, std::chrono::system_clock::now(), node_ ? node_->timeUSec() : 0};
+        while(!private_->queue_->tryPush(std::move(record)))
+        {
+            if(!private_->block_ || private_->stop_.load())
+            {
+                private_->dropped_++;
+                return;
+            }
+            boost::this_thread::yield();
+        }
+        return;
+    }
+
     LocalLogger::log(level, message);
 
-    remoteLog(level, message);
+    if(level >= remoteOutputLevel_)
+        remoteLog(level, message);
 }
 
 void Logger::remoteLog(Level level, const std::string &message) const
+{
+    remoteLog(level, message, node_ ? node_->timeUSec() : 0);
+}
+
+void Logger::remoteLog(Level level, const std::string &message, int64_t time_usec) const
 {
     b0::message::log::LogEntry e;
 
     if(node_)
     {
         e.node_name = node_->getName();
-        e.time_usec = node_->timeUSec();
+        e.time_usec = time_usec;
     }
 
     e.level = levelInfo(level).str;
     e.message = message;
 
-    private_->pub_.publish(e);
+    std::string subtopic;
+    if(private_->hierarchical_)
+        subtopic = logSubtopic(level, e.node_name);
+
+    boost::mutex::scoped_lock lock(private_->pub_mutex_);
+    if(private_->batch_size_ < 2)
+    {
+        private_->publish(subtopic, e);
+        return;
+    }
+
+    // the entries of a batch are sent to the same subtopic:
+    if(subtopic != private_->batch_subtopic_)
+        private_->sendBatch();
+
+    auto now = std::chrono::steady_clock::now();
+    if(private_->batch_.entries.empty())
+    {
+        private_->batch_start_ = now;
+        private_->batch_pending_.store(true);
+        private_->batch_subtopic_ = subtopic;
+    }
+    private_->batch_.entries.push_back(std::move(e));
+    if(private_->batch_.entries.size() >= private_->batch_size_ || now - private_->batch_start_ >= private_->batch_interval_)
+        private_->sendBatch();
+}
+
+void Logger::asyncLoop() const
+{
+    set_thread_name("LOG");
+
+    // not logged through the queue consumed by this thread:
+    std::string thread_config_error = applyThreadConfig("log");
+    if(!thread_config_error.empty())
+        std::cerr << "LOG: thread configuration: " << thread_config_error << std::endl;
+
+    uint64_t dropped_reported = 0;
+    LogRecord record;
+    while(true)
+    {
+        bool empty = true;
+        while(private_->queue_->tryPop(record))
+        {
+            empty = false;
+            if(record.level >= outputLevel_)
+                print(record.level, record.message, record.time);
+            if(record.level >= remoteOutputLevel_)
+                remoteLog(record.level, record.message, record.time_usec);
+        }
+
+        uint64_t dropped = private_->dropped_.load();
+        if(dropped != dropped_reported)
+        {
+            std::string msg = (boost::format("%d log messages dropped (queue full)") % (dropped - dropped_reported)).str();
+            dropped_reported = dropped;
+            if(Level::warn >= outputLevel_)
+                print(Level::warn, msg, std::chrono::system_clock::now());
+            if(Level::warn >= remoteOutputLevel_)
+                remoteLog(Level::warn, msg);
+        }
+
+        flushIfDue();
+
+        if(empty)
+        {
+            if(private_->stop_.load()) break;
+            boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+        }
+    }
+}
+
+std::string logSubtopic(Level level, const std::string &node_name)
+{
+    return levelInfo(level).str + "/" + node_name;
+}
+
+std::vector<std::string> logSubtopicFilters(Level min_level, const std::vector<std::string> &node_names)
+{
+    static const Level levels[] = {Level::trace, Level::debug, Level::info, Level::warn, Level::error, Level::fatal};
+    std::vector<std::string> filters;
+    for(Level level : levels)
+    {
+        if(level < min_level) continue;
+        if(node_names.empty())
+            filters.push_back(logSubtopic(level, ""));
+        for(auto &node_name : node_names)
+            filters.push_back(logSubtopic(level, node_name));
+    }
+    return filters;
 }
 
 } // namespace logger
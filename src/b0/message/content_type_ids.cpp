@@ -0,0 +1,128 @@
+#include <b0/message/content_type_ids.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+namespace b0
+{
+
+namespace message
+{
+
+struct ContentTypeIdRegistry
+{
+    //! Taken shared by the lookups, which are done for every binary envelope
+    boost::shared_mutex mutex_;
+    std::map<std::string, int64_t> ids_;
+    //! The content types, the index being the id (empty for an unknown id)
+    std::vector<std::string> content_types_;
+    std::vector<std::pair<const void*, ContentTypeIdProvider> > providers_;
+};
+
+static ContentTypeIdRegistry & contentTypeIdRegistry()
+{
+    static ContentTypeIdRegistry *registry = new ContentTypeIdRegistry;
+    return *registry;
+}
+
+//! Ask the providers, without holding the lock since they may do network requests
+static bool askProviders(const std::vector<std::pair<const void*, ContentTypeIdProvider> > &providers, std::string &content_type, int64_t &id)
+{
+    for(auto &provider : providers)
+    {
+        std::string c = content_type;
+        int64_t i = id;
+        if(provider.second(c, i) && i >= 0 && !c.empty())
+        {
+            addContentTypeId(c, i);
+            content_type = c;
+            id = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void addContentTypeId(const std::string &content_type, int64_t id)
+{
+    if(id < 0 || content_type.empty()) return;
+    ContentTypeIdRegistry &registry = contentTypeIdRegistry();
+    boost::unique_lock<boost::shared_mutex> lock(registry.mutex_);
+    registry.ids_[content_type] = id;
+    if(registry.content_types_.size() <= static_cast<size_t>(id))
+        registry.content_types_.resize(id + 1);
+    registry.content_types_[id] = content_type;
+}
+
+bool getContentTypeId(const std::string &content_type, int64_t &id)
+{
+    if(content_type.empty()) return false;
+    ContentTypeIdRegistry &registry = contentTypeIdRegistry();
+    std::vector<std::pair<const void*, ContentTypeIdProvider> > providers;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(registry.mutex_);
+        auto it = registry.ids_.find(content_type);
+        if(it != registry.ids_.end())
+        {
+            id = it->second;
+            return true;
+        }
+        providers = registry.providers_;
+    }
+
+    std::string c = content_type;
+    int64_t i = -1;
+    if(!askProviders(providers, c, i) || c != content_type)
+        return false;
+    id = i;
+    return true;
+}
+
+bool getContentType(int64_t id, std::string &content_type)
+{
+    if(id < 0) return false;
+    ContentTypeIdRegistry &registry = contentTypeIdRegistry();
+    std::vector<std::pair<const void*, ContentTypeIdProvider> > providers;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(registry.mutex_);
+        if(static_cast<uint64_t>(id) < registry.content_types_.size() && !registry.content_types_[id].empty())
+        {
+            content_type = registry.content_types_[id];
+            return true;
+        }
+        providers = registry.providers_;
+    }
+
+    std::string c;
+    int64_t i = id;
+    if(!askProviders(providers, c, i) || i != id)
+        return false;
+    content_type = c;
+    return true;
+}
+
+void addContentTypeIdProvider(const void *key, ContentTypeIdProvider provider)
+{
+    ContentTypeIdRegistry &registry = contentTypeIdRegistry();
+    boost::unique_lock<boost::shared_mutex> lock(registry.mutex_);
+    registry.providers_.push_back(std::make_pair(key, provider));
+}
+
+void removeContentTypeIdProvider(const void *key)
+{
+    ContentTypeIdRegistry &registry = contentTypeIdRegistry();
+    boost::unique_lock<boost::shared_mutex> lock(registry.mutex_);
+    for(auto it = registry.providers_.begin(); it != registry.providers_.end(); )
+    {
+        if(it->first == key) it = registry.providers_.erase(it);
+        else ++it;
+    }
+}
+
+} // namespace message
+
+} // namespace b0
@@ -0,0 +1,189 @@
+#include <b0/message/message_chunk.h>
+#include <b0/exception/message_unpack_error.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace b0
+{
+
+namespace message
+{
+
+static const char chunk_marker = '\x01';
+
+static const char chunk_version = 1;
+
+static const size_t chunk_fixed_header_size = 2 + 8 + 8 + 4 + 4 + 8;
+
+static char * putInt(char *p, uint64_t v, int bytes)
+{
+    for(int i = 0; i < bytes; i++, v >>= 8)
+        *p++ = static_cast<char>(v & 0xff);
+    return p;
+}
+
+static uint64_t getInt(const char *&p, int bytes)
+{
+    uint64_t v = 0;
+    for(int i = 0; i < bytes; i++)
+        v |= uint64_t(static_cast<unsigned char>(*p++)) << (8 * i);
+    return v;
+}
+
+bool isChunk(const char *data, size_t size)
+{
+    const char *header0_end = static_cast<const char*>(std::memchr(data, '\n', size));
+    return header0_end && header0_end + 1 != data + size && header0_end[1] == chunk_marker;
+}
+
+size_t chunkHeaderSize(const std::string &header0)
+{
+    return header0.size() + 1 + chunk_fixed_header_size;
+}
+
+size_t writeChunkHeader(char *dst, const std::string &header0, const MessageChunk &chunk)
+{
+    char *p = dst;
+    std::memcpy(p, header0.data(), header0.size());
+    p += header0.size();
+    *p++ = '\n';
+    *p++ = chunk_marker;
+    *p++ = chunk_version;
+    p = putInt(p, chunk.sender, 8);
+    p = putInt(p, chunk.seq, 8);
+    p = putInt(p, chunk.index, 4);
+    p = putInt(p, chunk.count, 4);
+    p = putInt(p, chunk.total, 8);
+    return p - dst;
+}
+
+void parseChunk(MessageChunk &chunk, const char *data, size_t size)
+{
+    if(!tryParseChunk(chunk, data, size))
+        throw exception::EnvelopeDecodeError();
+}
+
+bool tryParseChunk(MessageChunk &chunk, const char *data, size_t size)
+{
+    const char *end = data + size;
+    const char *p = static_cast<const char*>(std::memchr(data, '\n', size));
+    if(!p || size_t(end - p) < 1 + chunk_fixed_header_size || p[1] != chunk_marker || p[2] != chunk_version)
+        return false;
+    p += 3;
+    chunk.sender = getInt(p, 8);
+    chunk.seq = getInt(p, 8);
+    chunk.index = static_cast<uint32_t>(getInt(p, 4));
+    chunk.count = static_cast<uint32_t>(getInt(p, 4));
+    chunk.total = getInt(p, 8);
+    chunk.data = p;
+    chunk.size = end - p;
+    return chunk.count != 0 && chunk.index < chunk.count && chunk.size <= chunk.total;
+}
+
+std::shared_ptr<std::string> ChunkReassembler::add(const char *data, size_t size)
+{
+    std::shared_ptr<std::string> envelope;
+    if(!tryAdd(data, size, envelope))
+        throw exception::EnvelopeDecodeError();
+    return envelope;
+}
+
+bool ChunkReassembler::tryAdd(const char *data, size_t size, std::shared_ptr<std::string> &envelope)
+{
+    envelope.reset();
+    MessageChunk chunk;
+    if(!tryParseChunk(chunk, data, size))
+        return false;
+
+    auto it = partials_.find(chunk.sender);
+    if(chunk.index == 0)
+    {
+        // a new envelope from this sender: the previous one, if any, will never complete
+        if(it != partials_.end())
+            discard(it);
+        if(chunk.total > max_size_)
+        {
+            discarded_++;
+            return true;
+        }
+        makeRoom(chunk.total);
+        Partial &partial = partials_[chunk.sender];
+        partial.seq = chunk.seq;
+        partial.next_index = 0;
+        partial.count = chunk.count;
+        partial.total = chunk.total;
+        partial.started = started_++;
+        partial.data = std::make_shared<std::string>();
+        partial.data->reserve(chunk.total);
+        buffered_size_ += chunk.total;
+        it = partials_.find(chunk.sender);
+    }
+    // the remaining chunks of an envelope already discarded are ignored
+    else if(it == partials_.end())
+        return true;
+
+    Partial &partial = it->second;
+    if(chunk.seq != partial.seq || chunk.index != partial.next_index || chunk.count != partial.count
+            || chunk.total != partial.total || partial.data->size() + chunk.size > partial.total)
+    {
+        discard(it);
+        return true;
+    }
+
+    partial.data->append(chunk.data, chunk.size);
+    if(++partial.next_index < partial.count)
+        return true;
+
+    if(partial.data->size() != partial.total)
+    {
+        discard(it);
+        return true;
+    }
+    envelope = std::move(partial.data);
+    buffered_size_ -= partial.total;
+    partials_.erase(it);
+    return true;
+}
+
+void ChunkReassembler::setMaxSize(size_t max_size)
+{
+    max_size_ = max_size;
+    makeRoom(0);
+}
+
+size_t ChunkReassembler::getMaxSize() const
+{
+    return max_size_;
+}
+
+size_t ChunkReassembler::getBufferedSize() const
+{
+    return buffered_size_;
+}
+
+uint64_t ChunkReassembler::getDiscardedCount() const
+{
+    return discarded_;
+}
+
+void ChunkReassembler::discard(std::map<uint64_t, Partial>::iterator it)
+{
+    buffered_size_ -= it->second.total;
+    partials_.erase(it);
+    discarded_++;
+}
+
+void ChunkReassembler::makeRoom(size_t size)
+{
+    while(!partials_.empty() && buffered_size_ + size > max_size_)
+    {
+        auto oldest = std::min_element(partials_.begin(), partials_.end(),
+            [](const std::pair<const uint64_t, Partial> &a, const std::pair<const uint64_t, Partial> &b) {return a.second.started < b.second.started;});
+        discard(oldest);
+    }
+}
+
+} // namespace message
+
+} // namespace b0
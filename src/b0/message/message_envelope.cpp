@@ -1,11 +1,18 @@
 #include <b0/message/message_envelope.h>
+#include <b0/message/content_type_ids.h>
 #include <b0/exception/message_unpack_error.h>
+#include <b0/exception/argument_error.h>
+#include <b0/exception/unsupported_compression_algorithm.h>
 #include <b0/compress/compress.h>
+#include <b0/utils/crc32c.h>
 
 #include <vector>
-#include <boost/format.hpp>
-#include <boost/lexical_cast.hpp>
-#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
 
 namespace b0
 {
@@ -15,117 +22,1220 @@ namespace message
 
 void parse(MessageEnvelope &env, const std::string &s)
 {
-    size_t content_begin = s.find("\n\n");
-    if(content_begin == std::string::npos)
-        throw exception::EnvelopeDecodeError();
-    std::string message_headers = s.substr(0, content_begin);
-    std::string payload = s.substr(content_begin + 2);
-    std::vector<std::string> headers_split;
-    boost::split(headers_split, message_headers, boost::is_any_of("\n"));
-    env.header0 = headers_split.at(0);
-    headers_split.erase(headers_split.begin());
-    for(auto &header_line : headers_split)
+    parse(env, s.data(), s.size());
+}
+
+static ParseStatus parseView(MessageEnvelopeView &env, const char *data, size_t size, b0::compress::Context *context, const HeaderFilter *filter, const std::vector<boost::string_ref> *payloads, std::string *error);
+
+static bool throwParseError(ParseStatus status, const std::string &error);
+
+static ParseStatus parseEnvelope(MessageEnvelope &env, const char *data, size_t size, b0::compress::Context *context, const std::vector<boost::string_ref> *payloads = nullptr, std::string *error = nullptr)
+{
+    // the strings are copied rather than moved, so that both envelopes keep their storage
+    static thread_local MessageEnvelopeView view;
+    ParseStatus status = parseView(view, data, size, context, nullptr, payloads, error);
+    if(status != ParseStatus::Ok) return status;
+    env.header0 = view.header0;
+    env.headers = std::move(view.getHeaders());
+    env.parts.resize(view.parts.size());
+    for(size_t i = 0; i < view.parts.size(); i++)
+    {
+        MessagePartView &v = view.parts[i];
+        MessagePart &p = env.parts[i];
+        p.content_type = v.content_type;
+        p.compression_algorithm = v.compression_algorithm;
+        p.compression_level = v.compression_level;
+        p.compression_dictionary = v.compression_dictionary;
+        p.payload.assign(v.data, v.size);
+    }
+    return ParseStatus::Ok;
+}
+
+void parse(MessageEnvelope &env, const char *data, size_t size)
+{
+    std::string error;
+    throwParseError(parseEnvelope(env, data, size, nullptr, nullptr, &error), error);
+}
+
+void parse(MessageEnvelope &env, const char *data, size_t size, b0::compress::Context &context)
+{
+    std::string error;
+    throwParseError(parseEnvelope(env, data, size, &context, nullptr, &error), error);
+}
+
+void parse(MessageEnvelope &env, const char *data, size_t size, const std::vector<boost::string_ref> &payloads, b0::compress::Context &context)
+{
+    std::string error;
+    throwParseError(parseEnvelope(env, data, size, &context, &payloads, &error), error);
+}
+
+ParseStatus tryParse(MessageEnvelope &env, const char *data, size_t size, b0::compress::Context *context, const std::vector<boost::string_ref> *payloads, std::string *error)
+{
+    return parseEnvelope(env, data, size, context, payloads, error);
+}
+
+/*
+ * Content types which are encoded as a small integer in the binary envelope.
+ * Entries must only ever be appended to this table, never removed or reordered.
+ */
+static const char *well_known_content_types[] = {
+    "b0.message.resolv.Request",
+    "b0.message.resolv.Response",
+    "b0.message.log.LogEntry",
+    "b0.message.graph.Graph",
+    "b0.message.log.LogEntryBatch",
+    "b0.message.resolv.Request+msgpack",
+    "b0.message.resolv.Response+msgpack",
+    "b0.message.log.LogEntry+msgpack",
+    "b0.message.log.LogEntryBatch+msgpack",
+};
+
+static const size_t num_well_known_content_types = sizeof(well_known_content_types) / sizeof(well_known_content_types[0]);
+
+/*
+ * Content type codes from this one on are a content type id (see getContentTypeId()) plus
+ * this base: the codes below are kept for the table above.
+ */
+static const uint64_t content_type_id_base = 1024;
+
+static const char binary_envelope_marker = '\0';
+
+static const char binary_envelope_version = 1;
+
+// the readers below return false on malformed input, which the parser turns into ParseStatus::DecodeError
+
+static bool readVarint(const char *&p, const char *end, uint64_t &v)
+{
+    v = 0;
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+        if(p == end)
+            return false;
+        uint8_t b = static_cast<uint8_t>(*p++);
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if(!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// (lengths go through a uint64_t, as size_t is narrower on 32-bit targets, or another type)
+static bool readSize(const char *&p, const char *end, size_t &v)
+{
+    uint64_t v64;
+    if(!readVarint(p, end, v64) || v64 > std::numeric_limits<size_t>::max())
+        return false;
+    v = static_cast<size_t>(v64);
+    return true;
+}
+
+static bool readStringRef(const char *&p, const char *end, boost::string_ref &s)
+{
+    uint64_t len;
+    if(!readVarint(p, end, len) || len > static_cast<uint64_t>(end - p))
+        return false;
+    s = boost::string_ref(p, len);
+    p += len;
+    return true;
+}
+
+static bool readString(const char *&p, const char *end, std::string &s)
+{
+    boost::string_ref ref;
+    if(!readStringRef(p, end, ref))
+        return false;
+    s.assign(ref.data(), ref.size());
+    return true;
+}
+
+// parse a non-negative decimal number, without locale or allocations
+static bool parseDecimal(boost::string_ref s, uint64_t &v)
+{
+    if(s.empty() || s.size() > 18)
+        return false;
+    v = 0;
+    for(char c : s)
+    {
+        if(c < '0' || c > '9')
+            return false;
+        v = v * 10 + (c - '0');
+    }
+    return true;
+}
+
+// parse the 32-bit hexadecimal value of a Checksum header
+static bool parseHex32(boost::string_ref s, uint32_t &v)
+{
+    if(s.empty() || s.size() > 8)
+        return false;
+    v = 0;
+    for(char c : s)
+    {
+        int d;
+        if(c >= '0' && c <= '9') d = c - '0';
+        else if(c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else return false;
+        v = (v << 4) | d;
+    }
+    return true;
+}
+
+//! The headers of the text envelope which are consumed by the parser
+enum class TextHeader
+{
+    Unknown,
+    PartCount,
+    ContentLength,
+    PartContentLength,
+    PartContentType,
+    PartCompressionAlgorithm,
+    PartCompressionLevel,
+    PartCompressionDictionary,
+    PartUncompressedContentLength,
+    //! Also consumed in the binary format, where it is a customized header
+    PartChecksum
+};
+
+static TextHeader classifyTextHeader(boost::string_ref key, size_t &index)
+{
+    static const struct {boost::string_ref prefix; TextHeader header;} part_headers[] = {
+        {"Content-length-", TextHeader::PartContentLength},
+        {"Content-type-", TextHeader::PartContentType},
+        {"Compression-algorithm-", TextHeader::PartCompressionAlgorithm},
+        {"Compression-level-", TextHeader::PartCompressionLevel},
+        {"Compression-dictionary-", TextHeader::PartCompressionDictionary},
+        {"Uncompressed-content-length-", TextHeader::PartUncompressedContentLength},
+        {"Checksum-", TextHeader::PartChecksum},
+    };
+
+    if(key == "Part-count") return TextHeader::PartCount;
+    if(key == "Content-length") return TextHeader::ContentLength;
+    for(auto &h : part_headers)
+    {
+        if(key.size() <= h.prefix.size() || !key.starts_with(h.prefix)) continue;
+        boost::string_ref digits = key.substr(h.prefix.size());
+        uint64_t i;
+        if(digits.size() > 9 || !parseDecimal(digits, i))
+            return TextHeader::Unknown;
+        index = i;
+        return h.header;
+    }
+    return TextHeader::Unknown;
+}
+
+// split a "Key: value" header line
+static bool splitTextHeader(const char *line, const char *line_end, boost::string_ref &key, boost::string_ref &value)
+{
+    static const char delim[] = ": ";
+    const char *delim_pos = std::search(line, line_end, delim, delim + 2);
+    if(delim_pos == line_end)
+        return false;
+    key = boost::string_ref(line, delim_pos - line);
+    value = boost::string_ref(delim_pos + 2, line_end - delim_pos - 2);
+    return true;
+}
+
+/*
+ * Call f(key, value) for each customized header of a header block, skipping those
+ * consumed by the parser (text format, or checksums). The block has already been validated by parse().
+ */
+template<typename F>
+static void forEachHeader(boost::string_ref raw, bool binary, F f)
+{
+    if(raw.empty()) return;
+    const char *p = raw.data(), *end = raw.data() + raw.size();
+    if(binary)
+    {
+        uint64_t header_count = 0;
+        readVarint(p, end, header_count);
+        for(size_t i = 0; i < header_count; i++)
+        {
+            boost::string_ref key, value;
+            if(!readStringRef(p, end, key) || !readStringRef(p, end, value)) return;
+            size_t index;
+            if(classifyTextHeader(key, index) != TextHeader::PartChecksum)
+                f(key, value);
+        }
+        return;
+    }
+
+    // the block is a sequence of "\nKey: value" lines
+    while(p < end)
+    {
+        const char *line = p + 1;
+        const char *line_end = std::find(line, end, '\n');
+        boost::string_ref key, value;
+        size_t index;
+        if(splitTextHeader(line, line_end, key, value) && classifyTextHeader(key, index) == TextHeader::Unknown)
+            f(key, value);
+        p = line_end;
+    }
+}
+
+const std::map<std::string, std::string> & MessageEnvelopeView::getHeaders() const
+{
+    if(!headers_parsed_)
+    {
+        std::map<std::string, std::string> &headers = headers_;
+        forEachHeader(raw_headers_, raw_headers_binary_, [&headers](boost::string_ref key, boost::string_ref value) {
+            headers[std::string(key.data(), key.size())] = std::string(value.data(), value.size());
+        });
+        headers_parsed_ = true;
+    }
+    return headers_;
+}
+
+std::map<std::string, std::string> & MessageEnvelopeView::getHeaders()
+{
+    static_cast<const MessageEnvelopeView*>(this)->getHeaders();
+    return headers_;
+}
+
+boost::optional<boost::string_ref> MessageEnvelopeView::findHeader(boost::string_ref key) const
+{
+    if(headers_parsed_)
     {
-        size_t delim_pos = header_line.find(": ");
-        if(delim_pos == std::string::npos)
-            throw exception::EnvelopeDecodeError();
-        std::string key = header_line.substr(0, delim_pos),
-            value = header_line.substr(delim_pos + 2);
-        env.headers[key] = value;
+        auto it = headers_.find(std::string(key.data(), key.size()));
+        if(it == headers_.end()) return boost::none;
+        return boost::string_ref(it->second);
     }
-    try
+
+    // the last occurrence wins, as in getHeaders()
+    boost::optional<boost::string_ref> ret;
+    forEachHeader(raw_headers_, raw_headers_binary_, [&key, &ret](boost::string_ref k, boost::string_ref v) {
+        if(k == key) ret = v;
+    });
+    return ret;
+}
+
+void MessageEnvelopeView::setRawHeaders(boost::string_ref raw_headers, bool binary)
+{
+    raw_headers_ = raw_headers;
+    raw_headers_binary_ = binary;
+    headers_parsed_ = false;
+    headers_.clear();
+}
+
+/*
+ * Minimum amount of data in the compressed parts of a message for compressing
+ * (or decompressing) them in parallel, below which the hand-off costs more than it saves.
+ */
+static const size_t parallel_compression_min_size = 65536;
+
+static void compressPart(const MessagePart *part, std::string *out, b0::compress::Context *context)
+{
+    if(context)
+        context->compress(part->compression_algorithm, part->payload.data(), part->payload.size(), *out, part->compression_level, part->compression_dictionary);
+    else
+        b0::compress::compress(part->compression_algorithm, part->payload.data(), part->payload.size(), *out, part->compression_level, part->compression_dictionary);
+}
+
+/*
+ * Compress the parts which need it, and fill payloads with the data to send for each part.
+ * Return the total length of the payloads.
+ *
+ * The parts are compressed into the context's scratch buffers, if a context is given,
+ * and into compressed_payloads otherwise. When compressing in parallel, the workers use
+ * their own per-thread contexts.
+ */
+static size_t compressParts(const MessageEnvelope &env, b0::compress::Context *context, std::vector<std::string> &compressed_payloads, std::vector<boost::string_ref> &payloads)
+{
+    std::vector<std::string> &buffers = context ? context->buffers() : compressed_payloads;
+    if(buffers.size() < env.parts.size())
+        buffers.resize(env.parts.size());
+    payloads.resize(env.parts.size());
+    size_t parts_size = 0, num_compressed = 0;
+    for(size_t i = 0; i < env.parts.size(); i++)
     {
-        auto part_count_it = env.headers.find("Part-count");
-        if(part_count_it == env.headers.end()) throw;
-        int part_count = boost::lexical_cast<int>(part_count_it->second);
-        env.headers.erase(part_count_it);
-        env.parts.resize(part_count);
+        if(env.parts[i].compression_algorithm != "")
+        {
+            parts_size += env.parts[i].payload.size();
+            num_compressed++;
+        }
     }
-    catch(...) {throw exception::EnvelopeDecodeError();}
-    int part_start = 0;
-    for(int i = 0; i < env.parts.size(); i++)
+
+    bool parallel = num_compressed >= 2 && parts_size >= parallel_compression_min_size;
+    std::vector<boost::function<void()> > tasks;
+    for(size_t i = 0; i < env.parts.size(); i++)
     {
-        auto content_type_it = env.headers.find((boost::format("Content-type-%d") % i).str());
-        if(content_type_it != env.headers.end())
+        if(env.parts[i].compression_algorithm != "")
         {
-            env.parts[i].content_type = content_type_it->second;
-            env.headers.erase(content_type_it);
+            if(parallel)
+                tasks.push_back(boost::bind(&compressPart, &env.parts[i], &buffers[i], nullptr));
+            else
+                compressPart(&env.parts[i], &buffers[i], context);
         }
+        else payloads[i] = env.parts[i].payload;
+    }
+    if(parallel)
+        b0::compress::runTasks(tasks);
+
+    size_t total_length = 0;
+    for(size_t i = 0; i < env.parts.size(); i++)
+    {
+        // the compressed buffers are only complete now
+        if(env.parts[i].compression_algorithm != "")
+            payloads[i] = buffers[i];
+        total_length += payloads[i].size();
+    }
+    return total_length;
+}
+
+/*
+ * The parsers reuse the storage of the envelope they parse into (part strings and
+ * decompression buffers), so that an envelope parsed over and over keeps its capacity.
+ */
+static void resetPart(MessagePartView &part)
+{
+    part.content_type.clear();
+    part.compression_algorithm.clear();
+    part.compression_level = 0;
+    part.compression_dictionary.clear();
+    part.data = nullptr;
+    part.size = 0;
+    part.decompress_buffer_ = nullptr;
+    part.uncompressed_size_ = 0;
+}
+
+//! Return the next decompression buffer of the envelope, reusing the ones of previous messages
+static std::string & nextDecompressBuffer(MessageEnvelopeView &env, size_t &used)
+{
+    if(used == env.decompressed_payloads.size())
+        env.decompressed_payloads.emplace_back();
+    return env.decompressed_payloads[used++];
+}
+
+struct PartInfo
+{
+    size_t content_length;
+    size_t uncompressed_content_length;
+    bool has_checksum;
+    uint32_t checksum;
+};
+
+//! Check the payload of a part as received (before decompressing it) against its Checksum header, if any
+static bool verifyChecksum(const PartInfo &info, const char *data, size_t size, size_t i, std::string *error)
+{
+    if(!info.has_checksum || crc32c(data, size) == info.checksum)
+        return true;
+    if(error)
+        *error = "part " + std::to_string(i);
+    return false;
+}
+
+struct DecompressTask
+{
+    MessagePartView *part;
+    const char *data;
+    size_t len;
+    size_t size;
+    std::string *out;
+    b0::compress::Context *context;
+    //! Where the task stores its result (the tasks are copied when run in parallel)
+    b0::compress::DecompressStatus *status;
+    //! Where the task stores the reason of a failure, if wanted
+    std::string *error;
+
+    void operator()() const
+    {
+        if(context)
+            *status = context->tryDecompress(part->compression_algorithm, data, len, *out, size, part->compression_dictionary, error);
+        else
+            *status = b0::compress::tryDecompress(part->compression_algorithm, data, len, *out, size, part->compression_dictionary, error);
+    }
+};
+
+//! Point a part view to its compressed data, to be decompressed by MessagePartView::payload()
+static void deferDecompression(MessagePartView &part, const char *data, size_t len, size_t size, std::string &out)
+{
+    part.data = data;
+    part.size = len;
+    part.uncompressed_size_ = size;
+    part.decompress_buffer_ = &out;
+}
+
+boost::string_ref MessagePartView::payload() const
+{
+    if(decompress_buffer_)
+    {
+        std::string error;
+        b0::compress::DecompressStatus status = b0::compress::tryDecompress(compression_algorithm, data, size, *decompress_buffer_, uncompressed_size_, compression_dictionary, &error);
+        if(status == b0::compress::DecompressStatus::UnsupportedAlgorithm)
+            throw exception::UnsupportedCompressionAlgorithm(compression_algorithm);
+        if(status != b0::compress::DecompressStatus::Ok)
+            throw exception::Exception(error);
+        data = decompress_buffer_->data();
+        size = decompress_buffer_->size();
+        decompress_buffer_ = nullptr;
+    }
+    return boost::string_ref(data, size);
+}
 
-        auto compression_algorithm_it = env.headers.find((boost::format("Compression-algorithm-%d") % i).str());
-        if(compression_algorithm_it != env.headers.end())
+/*
+ * Decompress the parts collected while parsing, and point the part views to the decompressed data.
+ */
+static ParseStatus decompressParts(MessageEnvelopeView &env, std::vector<DecompressTask> &decompress_tasks, size_t buffers_used, std::string *error)
+{
+    env.decompressed_payloads.resize(buffers_used);
+    if(decompress_tasks.empty()) return ParseStatus::Ok;
+
+    static thread_local std::vector<b0::compress::DecompressStatus> statuses;
+    static thread_local std::vector<std::string> errors;
+    statuses.assign(decompress_tasks.size(), b0::compress::DecompressStatus::Ok);
+    if(error) errors.resize(decompress_tasks.size());
+    size_t parts_size = 0;
+    for(size_t i = 0; i < decompress_tasks.size(); i++)
+    {
+        DecompressTask &task = decompress_tasks[i];
+        task.status = &statuses[i];
+        task.error = error ? &errors[i] : nullptr;
+        parts_size += std::max(task.len, task.size);
+    }
+
+    if(decompress_tasks.size() >= 2 && parts_size >= parallel_compression_min_size)
+    {
+        // the workers use their own per-thread contexts
+        std::vector<boost::function<void()> > tasks;
+        for(auto &task : decompress_tasks)
         {
-            env.parts[i].compression_algorithm = compression_algorithm_it->second;
-            env.headers.erase(compression_algorithm_it);
+            task.context = nullptr;
+            tasks.push_back(task);
         }
+        b0::compress::runTasks(tasks);
+    }
+    else
+        for(auto &task : decompress_tasks) task();
 
-        auto compression_level_it = env.headers.find((boost::format("Compression-level-%d") % i).str());
-        if(compression_level_it != env.headers.end())
+    for(size_t i = 0; i < decompress_tasks.size(); i++)
+    {
+        if(statuses[i] == b0::compress::DecompressStatus::Ok) continue;
+        if(statuses[i] == b0::compress::DecompressStatus::UnsupportedAlgorithm)
         {
-            env.parts[i].compression_level = boost::lexical_cast<int>(compression_level_it->second);
-            env.headers.erase(compression_level_it);
+            // (the algorithm, for exception::UnsupportedCompressionAlgorithm)
+            if(error) *error = decompress_tasks[i].part->compression_algorithm;
+            return ParseStatus::UnsupportedCompression;
         }
+        if(error) error->swap(errors[i]);
+        return ParseStatus::DecompressError;
+    }
+    for(auto &task : decompress_tasks)
+    {
+        task.part->data = task.out->data();
+        task.part->size = task.out->size();
+    }
+    return ParseStatus::Ok;
+}
+
+/*
+ * Locate the payload of a part: in the buffer after the headers, or in its own buffer
+ * if the payloads have been received separately (see EnvelopeSerializer::getPayloads()).
+ * Return null if the payload does not fit.
+ */
+static const char * locatePayload(size_t i, size_t content_length, const char *payload, size_t payload_size, size_t part_start, const std::vector<boost::string_ref> *payloads)
+{
+    if(payloads)
+    {
+        if(content_length != (*payloads)[i].size())
+            return nullptr;
+        return (*payloads)[i].data();
+    }
+    if(content_length > payload_size - part_start)
+        return nullptr;
+    return payload + part_start;
+}
+
+static ParseStatus parseBinary(MessageEnvelopeView &env, const char *data, const char *end, b0::compress::Context *context, const HeaderFilter *filter, const std::vector<boost::string_ref> *payloads, std::string *error)
+{
+    const ParseStatus decode_error = ParseStatus::DecodeError;
+    const char *p = data;
+    if(p == end || *p++ != binary_envelope_marker)
+        return decode_error;
+    if(p == end || *p++ != binary_envelope_version)
+        return decode_error;
+
+    uint64_t part_count;
+    if(!readVarint(p, end, part_count) || part_count > static_cast<uint64_t>(end - p))
+        return decode_error;
+    static thread_local std::vector<PartInfo> info;
+    info.resize(part_count);
+    env.parts.resize(part_count);
+    for(size_t i = 0; i < part_count; i++)
+    {
+        MessagePartView &part = env.parts[i];
+        resetPart(part);
+        info[i].uncompressed_content_length = 0;
+        info[i].has_checksum = false;
 
-        auto uncompressed_content_length_it = env.headers.find((boost::format("Uncompressed-content-length-%d") % i).str());
-        int uncompressed_content_length = -1;
-        if(uncompressed_content_length_it != env.headers.end())
+        uint64_t content_type;
+        if(!readVarint(p, end, content_type))
+            return decode_error;
+        if(content_type == 1)
+        {
+            if(!readString(p, end, part.content_type))
+                return decode_error;
+        }
+        else if(content_type >= content_type_id_base)
+        {
+            if(!getContentType(static_cast<int64_t>(content_type - content_type_id_base), part.content_type))
+                return decode_error;
+        }
+        else if(content_type >= 2)
         {
-            uncompressed_content_length = boost::lexical_cast<int>(uncompressed_content_length_it->second);
-            env.headers.erase(uncompressed_content_length_it);
+            if(content_type - 2 >= num_well_known_content_types)
+                return decode_error;
+            part.content_type = well_known_content_types[content_type - 2];
         }
 
-        auto content_length_it = env.headers.find((boost::format("Content-length-%d") % i).str());
-        int content_length = -1;
-        if(content_length_it != env.headers.end())
+        uint64_t compression;
+        if(!readVarint(p, end, compression))
+            return decode_error;
+        bool ok = true;
+        switch(compression)
         {
-            content_length = boost::lexical_cast<int>(content_length_it->second);
-            env.headers.erase(content_length_it);
+        case 0: break;
+        case 1: ok = readString(p, end, part.compression_algorithm); break;
+        case 2: part.compression_algorithm = "zlib"; break;
+        case 3: part.compression_algorithm = "lz4"; break;
+        case 4: part.compression_algorithm = "zstd"; break;
+        case 5: part.compression_algorithm = "zstd"; ok = readString(p, end, part.compression_dictionary); break;
+        case 6: part.compression_algorithm = "lz4f"; break;
+        default: ok = false;
+        }
+        if(!ok)
+            return decode_error;
+        if(compression)
+        {
+            uint64_t level;
+            if(!readVarint(p, end, level) || !readSize(p, end, info[i].uncompressed_content_length))
+                return decode_error;
+            part.compression_level = static_cast<int>(level);
         }
 
-        if(content_length == -1)
-            throw exception::EnvelopeDecodeError();
+        if(!readSize(p, end, info[i].content_length))
+            return decode_error;
+    }
 
-        env.parts[i].payload = b0::compress::decompress(env.parts[i].compression_algorithm, payload.substr(part_start, content_length), uncompressed_content_length);
+    // the customized headers are only skipped here, and parsed on demand (except the checksums)
+    const char *headers_begin = p;
+    uint64_t header_count;
+    if(!readVarint(p, end, header_count))
+        return decode_error;
+    for(size_t i = 0; i < header_count; i++)
+    {
+        boost::string_ref key, value;
+        if(!readStringRef(p, end, key) || !readStringRef(p, end, value))
+            return decode_error;
+        size_t index;
+        if(classifyTextHeader(key, index) == TextHeader::PartChecksum)
+        {
+            if(index >= part_count || !parseHex32(value, info[index].checksum))
+                return decode_error;
+            info[index].has_checksum = true;
+        }
+    }
+    env.setRawHeaders(header_count ? boost::string_ref(headers_begin, p - headers_begin) : boost::string_ref(), true);
+
+    // rejected before touching (or decompressing) the payloads
+    if(filter && !(*filter)(env))
+        return ParseStatus::Filtered;
+
+    size_t payload_size = end - p;
+    if(payloads && (payloads->size() != part_count || payload_size != 0))
+        return decode_error;
+    size_t part_start = 0;
+    static thread_local std::vector<DecompressTask> decompress_tasks;
+    decompress_tasks.clear();
+    size_t buffers_used = 0;
+    for(size_t i = 0; i < part_count; i++)
+    {
+        MessagePartView &part = env.parts[i];
+        const char *part_data = locatePayload(i, info[i].content_length, p, payload_size, part_start, payloads);
+        if(!part_data)
+            return decode_error;
+        if(!verifyChecksum(info[i], part_data, info[i].content_length, i, error))
+            return ParseStatus::ChecksumMismatch;
+        if(part.compression_algorithm == "")
+        {
+            part.data = part_data;
+            part.size = info[i].content_length;
+        }
+        else if(env.getLazyDecompression())
+            deferDecompression(part, part_data, info[i].content_length, info[i].uncompressed_content_length, nextDecompressBuffer(env, buffers_used));
+        else
+        {
+            std::string &out = nextDecompressBuffer(env, buffers_used);
+            decompress_tasks.push_back({&part, part_data, info[i].content_length, info[i].uncompressed_content_length, &out, context, nullptr, nullptr});
+        }
+        part_start += info[i].content_length;
+    }
+    return decompressParts(env, decompress_tasks, buffers_used, error);
+}
+
+//! Turn the status of a parse into the exceptions of the throwing API; return false if filtered
+static bool throwParseError(ParseStatus status, const std::string &error)
+{
+    switch(status)
+    {
+    case ParseStatus::Ok: return true;
+    case ParseStatus::Filtered: return false;
+    case ParseStatus::DecodeError: throw exception::EnvelopeDecodeError();
+    case ParseStatus::UnsupportedCompression: throw exception::UnsupportedCompressionAlgorithm(error);
+    case ParseStatus::ChecksumMismatch: throw exception::ChecksumMismatch(error);
+    case ParseStatus::DecompressError: break;
+    }
+    throw exception::Exception(error);
+}
+
+void parse(MessageEnvelopeView &env, const char *data, size_t size)
+{
+    std::string error;
+    throwParseError(parseView(env, data, size, nullptr, nullptr, nullptr, &error), error);
+}
+
+void parse(MessageEnvelopeView &env, const char *data, size_t size, b0::compress::Context &context)
+{
+    std::string error;
+    throwParseError(parseView(env, data, size, &context, nullptr, nullptr, &error), error);
+}
+
+bool parse(MessageEnvelopeView &env, const char *data, size_t size, b0::compress::Context &context, const HeaderFilter &filter)
+{
+    std::string error;
+    return throwParseError(parseView(env, data, size, &context, filter ? &filter : nullptr, nullptr, &error), error);
+}
+
+bool parse(MessageEnvelopeView &env, const char *data, size_t size, const std::vector<boost::string_ref> &payloads, b0::compress::Context &context, const HeaderFilter &filter)
+{
+    std::string error;
+    return throwParseError(parseView(env, data, size, &context, filter ? &filter : nullptr, &payloads, &error), error);
+}
+
+ParseStatus tryParse(MessageEnvelopeView &env, const char *data, size_t size, b0::compress::Context *context, const HeaderFilter &filter, const std::vector<boost::string_ref> *payloads, std::string *error)
+{
+    return parseView(env, data, size, context, filter ? &filter : nullptr, payloads, error);
+}
+
+static ParseStatus parseView(MessageEnvelopeView &env, const char *data, size_t size, b0::compress::Context *context, const HeaderFilter *filter, const std::vector<boost::string_ref> *payloads, std::string *error)
+{
+    const ParseStatus decode_error = ParseStatus::DecodeError;
+    const char *end = data + size;
+
+    // a binary envelope has an empty header block right after the routing header
+    const char *header0_end = std::find(data, end, '\n');
+    if(header0_end != end && header0_end + 1 != end && header0_end[1] == binary_envelope_marker)
+    {
+        env.header0.assign(data, header0_end);
+        return parseBinary(env, header0_end + 1, end, context, filter, payloads, error);
+    }
+
+    const char *content_begin = std::search(data, end, "\n\n", "\n\n" + 2);
+    if(content_begin == end)
+        return decode_error;
+    const char *payload = content_begin + 2;
+    size_t payload_size = end - payload;
+
+    header0_end = std::find(data, content_begin, '\n');
+    env.header0.assign(data, header0_end);
+
+    // single pass over the header lines: the headers describing the parts are consumed,
+    // the customized headers are only validated, and parsed on demand (see getHeaders())
+    static thread_local std::vector<PartInfo> info;
+    info.clear();
+    size_t part_count = 0, parts_seen = 0;
+    bool has_part_count = false, has_unknown_headers = false;
+    // every part needs its own header line, which bounds the number of parts
+    size_t max_parts = content_begin - header0_end;
+    for(const char *p = header0_end; p < content_begin; )
+    {
+        const char *line = p + 1;
+        const char *line_end = std::find(line, content_begin, '\n');
+        p = line_end;
+
+        boost::string_ref key, value;
+        if(!splitTextHeader(line, line_end, key, value))
+            return decode_error;
+        size_t i = 0;
+        uint64_t v = 0;
+        TextHeader header = classifyTextHeader(key, i);
+        switch(header)
+        {
+        case TextHeader::Unknown:
+            has_unknown_headers = true;
+            continue;
+        case TextHeader::PartCount:
+            if(!parseDecimal(value, v) || v > max_parts)
+                return decode_error;
+            part_count = v;
+            has_part_count = true;
+            continue;
+        case TextHeader::ContentLength:
+            continue;
+        default:
+            break;
+        }
+
+        if(i >= max_parts)
+            return decode_error;
+        if(i >= parts_seen)
+        {
+            if(env.parts.size() < i + 1)
+                env.parts.resize(i + 1);
+            info.resize(i + 1);
+            for(size_t j = parts_seen; j <= i; j++)
+            {
+                resetPart(env.parts[j]);
+                info[j].content_length = std::string::npos;
+                info[j].uncompressed_content_length = 0;
+                info[j].has_checksum = false;
+            }
+            parts_seen = i + 1;
+        }
+        MessagePartView &part = env.parts[i];
+        switch(header)
+        {
+        case TextHeader::PartContentLength:
+            if(!parseDecimal(value, v))
+                return decode_error;
+            info[i].content_length = v;
+            break;
+        case TextHeader::PartContentType:
+            part.content_type.assign(value.data(), value.size());
+            break;
+        case TextHeader::PartCompressionAlgorithm:
+            part.compression_algorithm.assign(value.data(), value.size());
+            break;
+        case TextHeader::PartCompressionLevel:
+            if(!parseDecimal(value, v))
+                return decode_error;
+            part.compression_level = static_cast<int>(v);
+            break;
+        case TextHeader::PartCompressionDictionary:
+            part.compression_dictionary.assign(value.data(), value.size());
+            break;
+        case TextHeader::PartUncompressedContentLength:
+            if(!parseDecimal(value, v))
+                return decode_error;
+            info[i].uncompressed_content_length = v;
+            break;
+        case TextHeader::PartChecksum:
+            if(!parseHex32(value, info[i].checksum))
+                return decode_error;
+            info[i].has_checksum = true;
+            break;
+        default:
+            break;
+        }
+    }
+    if(!has_part_count || parts_seen > part_count)
+        return decode_error;
+    env.setRawHeaders(has_unknown_headers ? boost::string_ref(header0_end, content_begin - header0_end) : boost::string_ref(), false);
+
+    // rejected before touching (or decompressing) the payloads
+    if(filter && !(*filter)(env))
+        return ParseStatus::Filtered;
+
+    // parts without any header have no Content-length, and are rejected below
+    env.parts.resize(part_count);
+    info.resize(part_count);
+    for(size_t j = parts_seen; j < part_count; j++)
+    {
+        resetPart(env.parts[j]);
+        info[j].content_length = std::string::npos;
+        info[j].has_checksum = false;
+    }
+
+    if(payloads && (payloads->size() != part_count || payload_size != 0))
+        return decode_error;
+    size_t part_start = 0;
+    static thread_local std::vector<DecompressTask> decompress_tasks;
+    decompress_tasks.clear();
+    size_t buffers_used = 0;
+    for(size_t i = 0; i < part_count; i++)
+    {
+        MessagePartView &part = env.parts[i];
+        size_t content_length = info[i].content_length;
+        if(content_length == std::string::npos)
+            return decode_error;
+        const char *part_data = locatePayload(i, content_length, payload, payload_size, part_start, payloads);
+        if(!part_data)
+            return decode_error;
+        if(!verifyChecksum(info[i], part_data, content_length, i, error))
+            return ParseStatus::ChecksumMismatch;
+
+        if(part.compression_algorithm == "")
+        {
+            part.data = part_data;
+            part.size = content_length;
+        }
+        else if(env.getLazyDecompression())
+            deferDecompression(part, part_data, content_length, info[i].uncompressed_content_length, nextDecompressBuffer(env, buffers_used));
+        else
+        {
+            std::string &out = nextDecompressBuffer(env, buffers_used);
+            decompress_tasks.push_back({&part, part_data, content_length, info[i].uncompressed_content_length, &out, context, nullptr, nullptr});
+        }
         part_start += content_length;
     }
+    return decompressParts(env, decompress_tasks, buffers_used, error);
 }
 
-void serialize(const MessageEnvelope &env, std::string &s)
+/*
+ * The serializers run twice over the envelope: once with a SizeCounter to compute the
+ * exact size of the output, and once with a BufferWriter to write it.
+ */
+struct SizeCounter
+{
+    size_t size{0};
+    void put(char c) {size++;}
+    void put(const char *data, size_t len) {size += len;}
+};
+
+struct BufferWriter
+{
+    char *p;
+    void put(char c) {*p++ = c;}
+    void put(const char *data, size_t len) {std::memcpy(p, data, len); p += len;}
+};
+
+template<typename Sink>
+static inline void putString(Sink &sink, const std::string &str)
+{
+    sink.put(str.data(), str.size());
+}
+
+template<typename Sink, size_t N>
+static inline void putLiteral(Sink &sink, const char (&str)[N])
+{
+    sink.put(str, N - 1);
+}
+
+template<typename Sink>
+static void putDecimal(Sink &sink, uint64_t v)
+{
+    char buf[20];
+    char *p = buf + sizeof(buf);
+    do
+    {
+        *--p = static_cast<char>('0' + v % 10);
+        v /= 10;
+    }
+    while(v);
+    sink.put(p, buf + sizeof(buf) - p);
+}
+
+template<typename Sink>
+static void putVarint(Sink &sink, uint64_t v)
 {
-    std::stringstream ss;
+    while(v >= 0x80)
+    {
+        sink.put(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    sink.put(static_cast<char>(v));
+}
 
-    ss << env.header0 << std::endl;
-    ss << "Part-count: " << env.parts.size() << std::endl;
-    std::vector<std::string> compressed_payloads;
-    int total_length = 0;
+template<typename Sink>
+static void putVarintString(Sink &sink, const std::string &str)
+{
+    putVarint(sink, str.size());
+    putString(sink, str);
+}
+
+template<typename Sink>
+static void putHex32(Sink &sink, uint32_t v)
+{
+    static const char digits[] = "0123456789abcdef";
+    char buf[8];
+    for(int i = 7; i >= 0; i--, v >>= 4)
+        buf[i] = digits[v & 0xf];
+    sink.put(buf, sizeof(buf));
+}
+
+// the Checksum-# customized header of a binary envelope
+template<typename Sink>
+static void putBinaryChecksum(Sink &sink, size_t i, uint32_t checksum)
+{
+    SizeCounter digits;
+    putDecimal(digits, i);
+    putVarint(sink, 9 + digits.size);
+    putLiteral(sink, "Checksum-");
+    putDecimal(sink, i);
+    putVarint(sink, 8);
+    putHex32(sink, checksum);
+}
+
+/*
+ * The serializers write everything up to the payloads, which are written after them
+ * (see EnvelopeSerializer::write()).
+ */
+template<typename Sink>
+static void serializeBinary(Sink &sink, const MessageEnvelope &env, const std::vector<boost::string_ref> &payloads, const std::vector<int64_t> &content_type_ids, const std::vector<uint32_t> &checksums)
+{
+    putString(sink, env.header0);
+    sink.put('\n');
+    sink.put(binary_envelope_marker);
+    sink.put(binary_envelope_version);
+    putVarint(sink, env.parts.size());
     for(size_t i = 0; i < env.parts.size(); i++)
     {
-        std::string compressed_payload = b0::compress::compress(env.parts[i].compression_algorithm, env.parts[i].payload, env.parts[i].compression_level);
-        compressed_payloads.push_back(compressed_payload);
-        total_length += compressed_payload.size();
+        const MessagePart &part = env.parts[i];
 
-        ss << "Content-length-" << i << ": " << compressed_payload.size() << std::endl;
-        if(env.parts[i].content_type != "")
-            ss << "Content-type-" << i << ": " << env.parts[i].content_type << std::endl;
-        if(env.parts[i].compression_algorithm != "")
+        if(part.content_type == "")
+            putVarint(sink, 0);
+        else
+        {
+            const char **wk_end = well_known_content_types + num_well_known_content_types;
+            const char **wk = std::find(well_known_content_types, wk_end, part.content_type);
+            if(wk != wk_end)
+                putVarint(sink, 2 + (wk - well_known_content_types));
+            else if(i < content_type_ids.size() && content_type_ids[i] >= 0)
+                putVarint(sink, content_type_id_base + content_type_ids[i]);
+            else
+            {
+                putVarint(sink, 1);
+                putVarintString(sink, part.content_type);
+            }
+        }
+
+        if(part.compression_algorithm == "")
+            putVarint(sink, 0);
+        else
+        {
+            if(part.compression_algorithm == "zlib")
+                putVarint(sink, 2);
+            else if(part.compression_algorithm == "lz4")
+                putVarint(sink, 3);
+            else if(part.compression_algorithm == "lz4f")
+                putVarint(sink, 6);
+            else if(part.compression_algorithm == "zstd" && part.compression_dictionary == "")
+                putVarint(sink, 4);
+            else if(part.compression_algorithm == "zstd")
+            {
+                putVarint(sink, 5);
+                putVarintString(sink, part.compression_dictionary);
+            }
+            else
+            {
+                putVarint(sink, 1);
+                putVarintString(sink, part.compression_algorithm);
+            }
+            putVarint(sink, part.compression_level > 0 ? part.compression_level : 0);
+            putVarint(sink, part.payload.size());
+        }
+
+        putVarint(sink, payloads[i].size());
+    }
+
+    putVarint(sink, checksums.size() + env.headers.size());
+    for(size_t i = 0; i < checksums.size(); i++)
+        putBinaryChecksum(sink, i, checksums[i]);
+    for(auto &pair : env.headers)
+    {
+        putVarintString(sink, pair.first);
+        putVarintString(sink, pair.second);
+    }
+}
+
+template<typename Sink>
+static void serializeText(Sink &sink, const MessageEnvelope &env, const std::vector<boost::string_ref> &payloads, size_t total_length, const std::vector<uint32_t> &checksums)
+{
+    putString(sink, env.header0);
+    sink.put('\n');
+    putLiteral(sink, "Part-count: ");
+    putDecimal(sink, env.parts.size());
+    sink.put('\n');
+    for(size_t i = 0; i < env.parts.size(); i++)
+    {
+        const MessagePart &part = env.parts[i];
+
+        putLiteral(sink, "Content-length-");
+        putDecimal(sink, i);
+        putLiteral(sink, ": ");
+        putDecimal(sink, payloads[i].size());
+        sink.put('\n');
+        if(i < checksums.size())
+        {
+            putLiteral(sink, "Checksum-");
+            putDecimal(sink, i);
+            putLiteral(sink, ": ");
+            putHex32(sink, checksums[i]);
+            sink.put('\n');
+        }
+        if(part.content_type != "")
+        {
+            putLiteral(sink, "Content-type-");
+            putDecimal(sink, i);
+            putLiteral(sink, ": ");
+            putString(sink, part.content_type);
+            sink.put('\n');
+        }
+        if(part.compression_algorithm != "")
         {
-            ss << "Compression-algorithm-" << i << ": " << env.parts[i].compression_algorithm << std::endl;
-            ss << "Uncompressed-content-length-" << i << ": " << env.parts[i].payload.size() << std::endl;
-            if(env.parts[i].compression_level > 0)
-                ss << "Compression-level-" << i << ": " << env.parts[i].compression_level << std::endl;
+            putLiteral(sink, "Compression-algorithm-");
+            putDecimal(sink, i);
+            putLiteral(sink, ": ");
+            putString(sink, part.compression_algorithm);
+            sink.put('\n');
+            putLiteral(sink, "Uncompressed-content-length-");
+            putDecimal(sink, i);
+            putLiteral(sink, ": ");
+            putDecimal(sink, part.payload.size());
+            sink.put('\n');
+            if(part.compression_level > 0)
+            {
+                putLiteral(sink, "Compression-level-");
+                putDecimal(sink, i);
+                putLiteral(sink, ": ");
+                putDecimal(sink, part.compression_level);
+                sink.put('\n');
+            }
+            if(part.compression_dictionary != "")
+            {
+                putLiteral(sink, "Compression-dictionary-");
+                putDecimal(sink, i);
+                putLiteral(sink, ": ");
+                putString(sink, part.compression_dictionary);
+                sink.put('\n');
+            }
         }
     }
-    ss << "Content-length: " << total_length << std::endl;
+    putLiteral(sink, "Content-length: ");
+    putDecimal(sink, total_length);
+    sink.put('\n');
 
     for(auto &pair : env.headers)
-        ss << pair.first << ": " << pair.second << std::endl;
+    {
+        putString(sink, pair.first);
+        putLiteral(sink, ": ");
+        putString(sink, pair.second);
+        sink.put('\n');
+    }
+
+    sink.put('\n');
+}
 
-    ss << std::endl;
+size_t EnvelopeSerializer::prepare(const MessageEnvelope &env, EnvelopeFormat format, b0::compress::Context *context)
+{
+    env_ = &env;
+    format_ = format;
+    // uncompressed parts are referenced directly, to avoid copying the payload more than once
+    total_length_ = compressParts(env, context, compressed_payloads_, payloads_);
+    measure();
+    return size_;
+}
 
-    for(auto &payload : compressed_payloads)
-        ss << payload;
+size_t EnvelopeSerializer::prepareHeaders(const MessageEnvelope &env, EnvelopeFormat format, boost::string_ref payload, b0::compress::Context *context)
+{
+    if(env.parts.empty())
+        throw exception::ArgumentError("no parts", "env");
+    if(env.parts.back().compression_algorithm != "")
+        throw exception::ArgumentError("compressed last part", "env");
+    env_ = &env;
+    format_ = format;
+    total_length_ = compressParts(env, context, compressed_payloads_, payloads_);
+    total_length_ += payload.size() - payloads_.back().size();
+    payloads_.back() = payload;
+    measure();
+    return header_size_;
+}
 
-    s = ss.str();
+void EnvelopeSerializer::measure()
+{
+    content_lengths_.resize(payloads_.size());
+    for(size_t i = 0; i < payloads_.size(); i++)
+        content_lengths_[i] = payloads_[i].size();
+
+    content_type_ids_.clear();
+    if(format_ == EnvelopeFormat::BinaryIds)
+    {
+        content_type_ids_.resize(env_->parts.size(), -1);
+        const char **wk_end = well_known_content_types + num_well_known_content_types;
+        for(size_t i = 0; i < env_->parts.size(); i++)
+        {
+            const std::string &content_type = env_->parts[i].content_type;
+            if(content_type != "" && std::find(well_known_content_types, wk_end, content_type) == wk_end)
+                if(!getContentTypeId(content_type, content_type_ids_[i]))
+                    content_type_ids_[i] = -1;
+        }
+    }
+
+    // (over the payloads as sent, so that corrupted data is caught before decompressing it)
+    checksums_.clear();
+    if(checksum_)
+    {
+        checksums_.resize(payloads_.size());
+        for(size_t i = 0; i < payloads_.size(); i++)
+            checksums_[i] = crc32c(payloads_[i].data(), payloads_[i].size());
+    }
+
+    SizeCounter counter;
+    if(format_ == EnvelopeFormat::Binary || format_ == EnvelopeFormat::BinaryIds)
+        serializeBinary(counter, *env_, payloads_, content_type_ids_, checksums_);
+    else
+        serializeText(counter, *env_, payloads_, total_length_, checksums_);
+    header_size_ = counter.size;
+    size_ = header_size_ + total_length_;
+}
+
+void EnvelopeSerializer::write(char *dst) const
+{
+    writeHeaders(dst);
+    dst += header_size_;
+    for(auto &payload : payloads_)
+    {
+        if(payload.empty()) continue;
+        std::memcpy(dst, payload.data(), payload.size());
+        dst += payload.size();
+    }
+}
+
+void EnvelopeSerializer::writeHeaders(char *dst) const
+{
+    BufferWriter writer{dst};
+    if(format_ == EnvelopeFormat::Binary || format_ == EnvelopeFormat::BinaryIds)
+        serializeBinary(writer, *env_, payloads_, content_type_ids_, checksums_);
+    else
+        serializeText(writer, *env_, payloads_, total_length_, checksums_);
+}
+
+const std::vector<size_t> & EnvelopeSerializer::getContentLengths() const
+{
+    return content_lengths_;
+}
+
+const std::vector<boost::string_ref> & EnvelopeSerializer::getPayloads() const
+{
+    return payloads_;
+}
+
+static void serializeToString(const MessageEnvelope &env, std::string &s, EnvelopeFormat format, std::vector<size_t> *content_lengths, b0::compress::Context *context)
+{
+    EnvelopeSerializer serializer;
+    s.resize(serializer.prepare(env, format, context));
+    if(!s.empty())
+        serializer.write(&s[0]);
+    if(content_lengths)
+        *content_lengths = serializer.getContentLengths();
+}
+
+void serialize(const MessageEnvelope &env, std::string &s, EnvelopeFormat format)
+{
+    serializeToString(env, s, format, nullptr, nullptr);
+}
+
+void serialize(const MessageEnvelope &env, std::string &s, EnvelopeFormat format, std::vector<size_t> &content_lengths)
+{
+    serializeToString(env, s, format, &content_lengths, nullptr);
+}
+
+void serialize(const MessageEnvelope &env, std::string &s, EnvelopeFormat format, std::vector<size_t> &content_lengths, b0::compress::Context &context)
+{
+    serializeToString(env, s, format, &content_lengths, &context);
+}
+
+void serialize(const MessageEnvelope &env, std::string &s)
+{
+    serializeToString(env, s, EnvelopeFormat::Text, nullptr, nullptr);
 }
 
 } // namespace message
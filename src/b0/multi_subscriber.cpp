@@ -0,0 +1,178 @@
+#include <b0/multi_subscriber.h>
+#include <b0/node.h>
+#include <b0/exceptions.h>
+#include <b0/utils/profiler.h>
+#include <b0/utils/tracing.h>
+
+#include <chrono>
+
+#include <boost/format.hpp>
+
+#include <zmq.hpp>
+
+namespace b0
+{
+
+bool MultiSubscriber::Subscription::matches(const std::string &topic_name) const
+{
+    if(!prefix) return topic_name == topic;
+    return topic_name.compare(0, topic.size(), topic) == 0;
+}
+
+MultiSubscriber::MultiSubscriber(Node *node, const std::string &name, bool managed, bool notify_graph)
+    : Socket(node, ZMQ_SUB, name, managed),
+      notify_graph_(notify_graph)
+{
+}
+
+MultiSubscriber::~MultiSubscriber()
+{
+}
+
+void MultiSubscriber::log(logger::Level level, const std::string &message) const
+{
+    boost::format fmt("MultiSubscriber(%s): %s");
+    Socket::log(level, (fmt % name_ % message).str());
+}
+
+void MultiSubscriber::subscribe(const std::string &pattern, CallbackRaw callback)
+{
+    add(pattern, callback, CallbackPartsView{});
+}
+
+void MultiSubscriber::subscribeParts(const std::string &pattern, CallbackPartsView callback)
+{
+    add(pattern, CallbackRaw{}, callback);
+}
+
+void MultiSubscriber::add(const std::string &pattern, const CallbackRaw &callback_raw, const CallbackPartsView &callback_parts)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("subscribe() must be called before init()");
+
+    size_t star = pattern.find('*');
+    if(pattern.empty() || (star != std::string::npos && star != pattern.size() - 1))
+        throw exception::ArgumentError(pattern, "pattern");
+
+    Subscription s;
+    s.prefix = star != std::string::npos;
+    s.topic = s.prefix ? pattern.substr(0, star) : pattern;
+    s.callback_raw = callback_raw;
+    s.callback_parts = callback_parts;
+    subscriptions_.push_back(s);
+}
+
+std::string MultiSubscriber::filter(const Subscription &subscription)
+{
+    // an exact topic includes the newline terminating header0 (see Subscriber::connect())
+    return subscription.prefix ? subscription.topic : subscription.topic + "\n";
+}
+
+void MultiSubscriber::init()
+{
+    if(Global::getInstance().getDecentralized())
+        throw exception::Exception("MultiSubscriber needs the proxy of a resolver");
+
+    for(auto &s : subscriptions_)
+    {
+        std::string addr;
+        if(s.prefix)
+        {
+            addr = node_.getXPUBSocketAddress();
+        }
+        else
+        {
+            std::string orig_topic = s.topic;
+            if(Global::getInstance().remapTopicName(getNode(), orig_topic, s.topic))
+                info("Topic name '%s' remapped to '%s'", orig_topic, s.topic);
+            addr = node_.getXPUBSocketAddress(s.topic);
+        }
+
+        if(remote_addrs_.insert(addr).second)
+        {
+            trace("Connecting to %s...", addr);
+            Socket::connect(addr);
+        }
+        std::string f = filter(s);
+        Socket::setsockopt(ZMQ_SUBSCRIBE, f.data(), f.size());
+
+        if(notify_graph_ && !s.prefix)
+            node_.notifyTopic(s.topic, true, true);
+    }
+}
+
+void MultiSubscriber::cleanup()
+{
+    for(auto &s : subscriptions_)
+    {
+        std::string f = filter(s);
+        Socket::setsockopt(ZMQ_UNSUBSCRIBE, f.data(), f.size());
+
+        if(notify_graph_ && !s.prefix)
+            node_.notifyTopic(s.topic, true, false);
+    }
+
+    for(auto &addr : remote_addrs_)
+    {
+        trace("Disconnecting from %s...", addr);
+        Socket::disconnect(addr);
+    }
+    remote_addrs_.clear();
+}
+
+void MultiSubscriber::spinOnce()
+{
+    startSpinBudget();
+    while(spinBudgetLeft() && poll())
+    {
+        b0::message::MessageEnvelopeView &env = receive_envelope_;
+        ReadStatus status = tryReadRaw(env, b0::message::HeaderFilter(), &read_error_);
+        if(status != ReadStatus::Ok)
+        {
+            readFailed(status, read_error_);
+            continue;
+        }
+        tracing::TraceContext trace;
+        tracing::extract(env, trace);
+
+        for(auto &s : subscriptions_)
+        {
+            if(!s.matches(env.header0)) continue;
+
+            auto t0 = std::chrono::steady_clock::now();
+            {
+                CallbackProfiler profiler(*this);
+                tracing::Scope scope(tracing::SpanKind::Consumer, *this, trace);
+                if(s.callback_parts)
+                {
+                    s.callback_parts(env.header0, env.parts);
+                }
+                else if(s.callback_raw)
+                {
+                    if(env.parts.empty())
+                        dispatch_payload_.clear();
+                    else
+                        dispatch_payload_.assign(env.parts[0].data, env.parts[0].size);
+                    s.callback_raw(env.header0, dispatch_payload_);
+                }
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            getCounters().callback_duration.record(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+        }
+    }
+}
+
+bool MultiSubscriber::hasCallback() const
+{
+    return !subscriptions_.empty();
+}
+
+bool MultiSubscriber::acceptsHeader0(const std::string &header0) const
+{
+    for(auto &s : subscriptions_)
+        if(s.matches(header0))
+            return true;
+    return false;
+}
+
+} // namespace b0
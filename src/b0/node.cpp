@@ -6,29 +6,279 @@
 #include <b0/exceptions.h>
 #include <b0/logger/logger.h>
 #include <b0/utils/thread_name.h>
+#include <b0/utils/thread_config.h>
+#include <b0/utils/profiler.h>
 #include <b0/utils/env.h>
 #include <b0/resolver/client.h>
+#include <b0/process_agent.h>
+#include <b0/message/metrics/node_metrics.h>
+#include <b0/compress/compress.h>
+#include <b0/message/content_type_ids.h>
+#include <b0/message/resolv/param_update.h>
+#include <b0/message/sim/clock.h>
+#include <b0/utils/graph_tracker.h>
+#include <b0/utils/startup_trace.h>
 
 #include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
+#include <algorithm>
 #include <boost/chrono.hpp>
 #include <boost/thread.hpp>
 #include <boost/asio.hpp>
 #include <boost/format.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
 
 #include <zmq.hpp>
 
+#ifdef HAVE_CLOCK_NANOSLEEP
+#include <time.h>
+#endif
+
 namespace b0
 {
 
+//! Maximum number of spinOnce() of one socket in a Node::processReadySockets() call
+static const int max_ready_spins = 64;
+
+static std::shared_ptr<zmq::context_t> newContext(int io_threads, bool priority_io_thread)
+{
+    // the thread reserved to the high-priority sockets comes after the others:
+    auto context = std::make_shared<zmq::context_t>(io_threads + (priority_io_thread ? 1 : 0));
+    // the I/O threads start with the first socket:
+    configureIOThreads(static_cast<void*>(*context));
+    return context;
+}
+
+//! Create (or share) a context; io_threads and priority_io_thread are set to those of the shared context
+static std::shared_ptr<zmq::context_t> makeContext(int &io_threads, bool &priority_io_thread, bool shared)
+{
+    // (the affinity is a 64-bit mask, and the other sockets need a thread of their own)
+    if(io_threads < 1 || io_threads > 63) priority_io_thread = false;
+
+    if(!shared)
+        return newContext(io_threads, priority_io_thread);
+
+    // the shared context lives as long as some node is using it:
+    static boost::mutex mutex;
+    static std::weak_ptr<zmq::context_t> shared_context;
+    static int shared_io_threads;
+    static bool shared_priority_io_thread;
+    boost::mutex::scoped_lock lock(mutex);
+    std::shared_ptr<zmq::context_t> context = shared_context.lock();
+    if(!context)
+    {
+        context = newContext(io_threads, priority_io_thread);
+        shared_context = context;
+        shared_io_threads = io_threads;
+        shared_priority_io_thread = priority_io_thread;
+    }
+    io_threads = shared_io_threads;
+    priority_io_thread = shared_priority_io_thread;
+    return context;
+}
+
 struct Node::Private
 {
-    Private(Node *node, int io_threads)
-        : context_(io_threads)
+    Private(Node *node, int io_threads, bool priority_io_thread, bool shared_context)
+        : io_threads_(io_threads),
+          priority_io_thread_(priority_io_thread),
+          context_(makeContext(io_threads_, priority_io_thread_, shared_context)),
+          wakeup_rx_(*context_, ZMQ_PULL),
+          wakeup_tx_(*context_, ZMQ_PUSH),
+          poll_items_dirty_(true),
+          executor_stop_(false)
+    {
+        std::string addr = (boost::format("inproc://b0-node-wakeup-%p") % node).str();
+        int linger = 0;
+        wakeup_rx_.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+        wakeup_tx_.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+        wakeup_rx_.bind(addr);
+        wakeup_tx_.connect(addr);
+    }
+
+    void updatePollItems(const std::set<Socket*> &sockets)
+    {
+        if(!poll_items_dirty_) return;
+        poll_items_.clear();
+        poll_sockets_.clear();
+        for(auto socket : sockets)
+        {
+            zmq::pollitem_t item = {socket->getZMQSocket(), 0, ZMQ_POLLIN, 0};
+            // a socket read by a thread of its own must not be touched, not even by zmq_poll(): it
+            // is replaced by an item which never fires, and only has pending messages
+            if(socket->isReadInBackground())
+                item = {static_cast<void*>(wakeup_rx_), 0, 0, 0};
+            poll_items_.push_back(item);
+            poll_sockets_.push_back(socket);
+        }
+        // the wakeup socket is always the last item:
+        zmq::pollitem_t item = {static_cast<void*>(wakeup_rx_), 0, ZMQ_POLLIN, 0};
+        poll_items_.push_back(item);
+        poll_items_dirty_ = false;
+    }
+
+    //! Read ZMQ_EVENTS of the wakeup channel (to re-arm its ZMQ_FD), and discard the wakeup messages
+    void drainWakeup()
+    {
+        int events = 0;
+        size_t size = sizeof(events);
+        wakeup_rx_.getsockopt(ZMQ_EVENTS, &events, &size);
+        if(!(events & ZMQ_POLLIN)) return;
+        zmq::message_t msg;
+        while(wakeup_rx_.recv(&msg, ZMQ_DONTWAIT)) {}
+    }
+
+    //! Number of I/O threads of the context, not counting the one reserved to the high-priority sockets
+    int io_threads_;
+
+    //! True if the context has an I/O thread reserved to the high-priority sockets (see b0::setPriorityIOThread())
+    bool priority_io_thread_;
+
+    //! The ZeroMQ context, possibly shared with other nodes (see b0::setSharedContext())
+    std::shared_ptr<zmq::context_t> context_;
+
+    //! Receiving end of the wakeup channel, polled together with the node's sockets
+    zmq::socket_t wakeup_rx_;
+
+    //! Sending end of the wakeup channel
+    zmq::socket_t wakeup_tx_;
+
+    //! Protects wakeup_tx_, which can be used from any thread
+    boost::mutex wakeup_mutex_;
+
+    //! Poll items of all managed sockets, polled together in Node::spinOnce()
+    std::vector<zmq::pollitem_t> poll_items_;
+
+    //! Sockets corresponding to the items in poll_items_
+    std::vector<Socket*> poll_sockets_;
+
+    //! The poll items of Node::spinOnce() with the callback executor (reused across spins)
+    std::vector<zmq::pollitem_t> executor_poll_items_;
+
+    //! Replace the items of the sockets being processed by the callback executor with items which never fire (executor_mutex_ must be locked)
+    void maskBusySockets(std::vector<zmq::pollitem_t> &items)
+    {
+        // zmq_poll() processes the commands of every socket of the array, even without events,
+        // which a worker thread using the socket at the same time does too
+        for(size_t i = 0; i < poll_sockets_.size(); i++)
+            if(isBusy(poll_sockets_[i]))
+                items[i] = {static_cast<void*>(wakeup_rx_), 0, 0, 0};
+    }
+
+    //! Set when the list of sockets changes, to rebuild poll_items_
+    bool poll_items_dirty_;
+
+    //! Indices of poll_sockets_ in the order of the last Node::spinOnce() (see spinOrder())
+    std::vector<size_t> spin_order_;
+
+    //! Number of spinOnce(), which rotates the sockets of the same priority
+    size_t spin_round_{0};
+
+    //! Return the order of the sockets in spinOnce(): by decreasing priority, those of the same priority in turn
+    const std::vector<size_t> & spinOrder()
+    {
+        size_t n = poll_sockets_.size();
+        spin_order_.resize(n);
+        for(size_t i = 0; i < n; i++)
+            spin_order_[i] = (i + spin_round_) % n;
+        spin_round_++;
+        // the high-priority sockets first (see Socket::setHighPriority()):
+        std::stable_sort(spin_order_.begin(), spin_order_.end(), [this](size_t a, size_t b) {
+            Socket *sa = poll_sockets_[a], *sb = poll_sockets_[b];
+            if(sa->isHighPriority() != sb->isHighPriority())
+                return sa->isHighPriority();
+            return sa->getSpinPriority() > sb->getSpinPriority();
+        });
+        return spin_order_;
+    }
+
+    //! Return true if the socket (or its strand) is being processed by the callback executor
+    bool isBusy(Socket *socket)
+    {
+        const std::string &strand = socket->getStrand();
+        return executor_busy_sockets_.count(socket) ||
+            (!strand.empty() && executor_busy_strands_.count(strand));
+    }
+
+    //! Hand over a socket to the worker threads, unless busy (executor_mutex_ must be locked)
+    bool queueForExecutor(Socket *socket)
+    {
+        if(isBusy(socket))
+            return false;
+        executor_busy_sockets_.insert(socket);
+        if(!socket->getStrand().empty())
+            executor_busy_strands_.insert(socket->getStrand());
+        executor_queue_.push_back(socket);
+        return true;
+    }
+
+    //! Return true if the calling thread is one of the callback executor threads
+    bool isExecutorThread() const
     {
+        auto id = boost::this_thread::get_id();
+        return std::find(executor_thread_ids_.begin(), executor_thread_ids_.end(), id) != executor_thread_ids_.end();
     }
 
-    zmq::context_t context_;
+    //! Callback executor worker threads
+    std::vector<boost::thread> executor_threads_;
+
+    //! Ids of the executor threads (not modified after the threads are started)
+    std::vector<boost::thread::id> executor_thread_ids_;
+
+    //! Protects the executor queue and the busy sets
+    boost::mutex executor_mutex_;
+
+    //! Signaled when sockets are queued, or when the executor is stopped
+    boost::condition_variable executor_cond_;
+
+    //! Sockets with incoming messages, waiting for a worker thread
+    std::deque<Socket*> executor_queue_;
+
+    //! Sockets queued or being processed by a worker thread
+    std::set<Socket*> executor_busy_sockets_;
+
+    //! Strands of the sockets in executor_busy_sockets_
+    std::set<std::string> executor_busy_strands_;
+
+    //! Set to stop the executor threads
+    bool executor_stop_;
+
+    //! Serializes logging from the node thread and from the executor threads
+    mutable boost::mutex log_mutex_;
+};
+
+//! The nodes of this process connected to the same resolver, when the heartbeats are coalesced
+struct HeartbeatGroup
+{
+    //! The nodes, in the order they started; the first one sends the heartbeats for all
+    std::vector<Node*> nodes;
+
+    //! Offset of the resolver's time from the local hardware time, as of the last heartbeat
+    int64_t time_offset{0};
+
+    //! Round-trip time of the last heartbeat
+    int64_t time_delay{0};
+
+    //! True once a heartbeat has been sent
+    bool has_time{false};
+};
+
+static boost::mutex heartbeat_groups_mutex;
+
+//! The heartbeat groups, by resolver address
+static std::map<std::string, HeartbeatGroup> heartbeat_groups;
+
+//! A timer of a node (see Node::createTimer())
+struct NodeTimer
+{
+    int64_t period;
+    Node::TimerCallback callback;
+    bool one_shot;
+    bool synchronized;
+    int64_t deadline;
 };
 
 struct Node::Private2
@@ -39,10 +289,173 @@ struct Node::Private2
     }
 
     resolver::Client resolv_cli_;
+
+    //! If true, use the agent of the process (see Node::setProcessAgent())
+    bool process_agent_{false};
+
+    //! If true, record the phases of Node::init() (see Node::setStartupTracing())
+    bool startup_tracing_{false};
+
+    //! The phases of the last Node::init()
+    StartupTrace startup_trace_;
+
+    //! True while Node::init() runs
+    bool initializing_{false};
+
+    //! The agent of the process in use (null if none)
+    std::shared_ptr<ProcessAgent> agent_;
+
+    //! Addresses of the XPUB sockets of all the resolver's proxies
+    std::vector<std::string> xpub_sock_addrs_;
+
+    //! Addresses of the XSUB sockets of all the resolver's proxies
+    std::vector<std::string> xsub_sock_addrs_;
+
+    //! Explicit assignments of topics to proxies
+    std::map<std::string, int> topic_proxy_;
+
+    //! Addresses of the XPUB sockets of the resolver's high-priority proxies (empty if none)
+    std::vector<std::string> xpub_priority_sock_addrs_;
+
+    //! Addresses of the XSUB sockets of the resolver's high-priority proxies (empty if none)
+    std::vector<std::string> xsub_priority_sock_addrs_;
+
+    //! Service for toggling the debug dump of sockets at runtime (see B0_DEBUG_SOCKET_SERVICE)
+    std::unique_ptr<ServiceServer> debug_srv_;
+
+    //! Service returning the traffic counters of the sockets (see B0_METRICS_SERVICE)
+    std::unique_ptr<ServiceServer> metrics_srv_;
+
+    //! Service changing the settings of the node at runtime (see B0_CONTROL_SERVICE)
+    std::unique_ptr<ServiceServer> control_srv_;
+
+    //! Subscriber of the resolver's graph changes, which invalidate the service resolution cache
+    //! and tell when the topics of the lazy subscribers have publishers
+    std::unique_ptr<Subscriber> graph_sub_;
+
+    //! Protects graph_sub_ and lazy_graph_
+    boost::mutex graph_mutex_;
+
+    //! Subscribers waiting for a publisher of their topic (see b0::Subscriber::setLazy())
+    std::set<Subscriber*> lazy_subs_;
+
+    //! The graph of the network, followed while there are lazy subscribers
+    graph::GraphTracker lazy_graph_;
+
+    //! Time of the next snapshot of the graph, while there are lazy subscribers
+    std::chrono::steady_clock::time_point lazy_graph_refresh_;
+
+    //! Serializes the topic resolutions, which can happen in the callback threads
+    boost::mutex resolv_mutex_;
+
+    //! The resolver address identifying the heartbeat group of this node (empty if not coalescing)
+    std::string heartbeat_group_;
+
+    //! The topic the resolver accepts heartbeats on without replying (empty if not supported)
+    std::string heartbeat_topic_;
+
+    //! If true, the heartbeats are sent by spinOnce() instead of a thread (see Node::setInlineHeartbeat())
+    bool inline_heartbeat_{b0::getInlineHeartbeats()};
+
+    //! Hardware time of the next inline heartbeat
+    int64_t next_heartbeat_{0};
+
+    //! Number of inline heartbeats sent (the resolver time is requested every few of them)
+    int64_t heartbeat_count_{0};
+
+    //! Time of the previous heartbeat stats (see Node::heartbeatStats()), 0 if none yet
+    int64_t stats_time_{0};
+
+    //! CPU time of the process at the previous heartbeat stats
+    int64_t stats_cpu_time_{0};
+
+    //! Messages sent and received by the sockets at the previous heartbeat stats
+    uint64_t stats_sent_{0}, stats_received_{0};
+
+    //! Protects the timers, which can be created from any thread
+    boost::mutex timers_mutex_;
+
+    //! The timers, by id
+    std::map<int, NodeTimer> timers_;
+
+    //! The deadlines of the timers (with their ids), on the hardware and on the synchronized clock
+    std::set<std::pair<int64_t, int> > hardware_deadlines_, synchronized_deadlines_;
+
+    //! The id of the next timer
+    int next_timer_id_{1};
+
+    //! Deadline for the outgoing messages at shutdown, in milliseconds (-1 for none)
+    int shutdown_timeout_{b0::env::getInt("B0_SHUTDOWN_TIMEOUT", -1)};
+
+    //! Number of messages dropped by cleanup()
+    uint64_t shutdown_dropped_{0};
+
+    //! The prefixes of the cached parameters (see Node::addParameterPrefix())
+    std::vector<std::string> param_prefixes_;
+
+    //! Protects the cached parameters, which are read from any thread
+    mutable boost::mutex params_mutex_;
+
+    //! The cached parameters, by name
+    std::map<std::string, std::string> params_;
+
+    //! The version of the cached parameters (older updates are ignored)
+    int64_t params_version_{0};
+
+    //! Subscriber of the parameter changes, created by init() if some prefix is cached
+    std::unique_ptr<Subscriber> param_sub_;
+
+    //! Called when a cached parameter is changed
+    Node::ParameterCallback param_callback_;
+
+    //! If true, the node follows the simulated clock (see Node::setSimulatedTime())
+    bool simulated_time_{b0::getSimulatedTime()};
+
+    //! The topic of the simulated clock
+    std::string clock_topic_{"clock"};
+
+    //! Subscriber of the simulated clock, read by clock_thread_ (not managed)
+    std::unique_ptr<Subscriber> clock_sub_;
+
+    //! The thread reading the simulated clock
+    boost::thread clock_thread_;
+
+    //! Return true if the parameter is under a cached prefix
+    bool isCachedParameter(const std::string &name) const
+    {
+        for(const std::string &prefix : param_prefixes_)
+            if(boost::starts_with(name, prefix)) return true;
+        return false;
+    }
+
+    //! Apply a change pushed by the resolver
+    void onParamUpdate(const b0::message::resolv::ParamUpdate &update)
+    {
+        std::vector<std::pair<std::string, const std::string*> > changes;
+        {
+            boost::mutex::scoped_lock lock(params_mutex_);
+            if(update.version <= params_version_) return;
+            params_version_ = update.version;
+            for(auto &p : update.params)
+            {
+                if(!isCachedParameter(p.name)) continue;
+                params_[p.name] = p.value;
+                changes.emplace_back(p.name, &p.value);
+            }
+            for(auto &name : update.removed)
+            {
+                if(params_.erase(name))
+                    changes.emplace_back(name, nullptr);
+            }
+        }
+        if(param_callback_)
+            for(auto &c : changes)
+                param_callback_(c.first, c.second);
+    }
 };
 
 Node::Node(const std::string &nodeName)
-    : private_(new Private(this, 1)),
+    : private_(new Private(this, Global::getInstance().getIOThreads(), Global::getInstance().getPriorityIOThread(), Global::getInstance().getSharedContext() || Global::getInstance().getProcessAgent())),
       private2_(new Private2(this)),
       name_(Global::getInstance().getRemappedNodeName(*this, nodeName)),
       orig_name_(nodeName),
@@ -51,16 +464,36 @@ Node::Node(const std::string &nodeName)
       p_logger_(new logger::Logger(this)),
       shutdown_flag_(false),
       minimum_heartbeat_interval_(0),
-      spin_rate_(-1)
+      spin_rate_(-1),
+      spin_mode_(SpinMode::FixedRate),
+      max_spin_rate_(-1),
+      realtime_sleep_(b0::env::getBool("B0_REALTIME_SLEEP")),
+      num_callback_threads_(0)
 {
     set_thread_name("main");
 
     if(!Global::getInstance().isInitialized())
         throw std::runtime_error("b0::init() must be called first");
+
+    private2_->process_agent_ = Global::getInstance().getProcessAgent();
+    private2_->startup_tracing_ = b0::env::getBool("B0_STARTUP_TRACE") || !b0::env::get("B0_STARTUP_TRACE_FILE").empty();
 }
 
 Node::~Node()
 {
+    // the service must be removed while the sockets list is still alive:
+    private2_->debug_srv_.reset();
+    private2_->metrics_srv_.reset();
+    private2_->control_srv_.reset();
+    private2_->param_sub_.reset();
+    private2_->graph_sub_.reset();
+
+    b0::compress::removeDictionaryProvider(this);
+    b0::message::removeContentTypeIdProvider(this);
+
+    // the context cannot be terminated while the sockets of the pool are open:
+    ServiceClient::closePooledConnections(getContext());
+
     if(logger::Logger *p_logger = dynamic_cast<logger::Logger*>(p_logger_))
         delete p_logger;
 }
@@ -71,7 +504,7 @@ void Node::setResolverAddress(const std::string &addr)
     // but can be used to connect to a different resolver as well.
     // Use this before Node::init().
     resolv_addr_ = addr;
-    if(!resolv_addr_.empty()) private2_->resolv_cli_.setRemoteAddress(resolv_addr_);
+    if(!resolv_addr_.empty()) private2_->resolv_cli_.setResolverAddress(resolv_addr_);
 }
 
 void Node::init()
@@ -80,24 +513,120 @@ void Node::init()
     if(state != NodeState::Created)
         throw exception::InvalidStateTransition("init", state);
 
-    if(Global::getInstance().remapNodeName(*this, orig_name_, name_))
-        info("Node name '%s' remapped to '%s'", orig_name_, name_);
+    private2_->startup_trace_.clear();
+    private2_->initializing_ = true;
+    struct Initializing
+    {
+        bool &flag;
+        ~Initializing() {flag = false;}
+    } initializing{private2_->initializing_};
+    StartupTrace *startup_trace = startupTrace();
+
+    {
+        StartupTrace::Scope scope(startup_trace, "remap");
+        if(Global::getInstance().remapNodeName(*this, orig_name_, name_))
+            info("Node name '%s' remapped to '%s'", orig_name_, name_);
+    }
 
     debug("Initialization...");
 
-    private2_->resolv_cli_.init(); // resolv_cli_ is not managed
+    if(private2_->process_agent_ && !getEphemeral() && !Global::getInstance().getDecentralized())
+    {
+        StartupTrace::Scope scope(startup_trace, "process agent");
+        std::string resolv_addr = resolv_addr_.empty() ? b0::env::get("B0_RESOLVER", "tcp://localhost:22000") : resolv_addr_;
+        private2_->agent_ = ProcessAgent::get(resolv_addr);
+        private2_->resolv_cli_.setProcessAgent(private2_->agent_);
+    }
+
+    {
+        StartupTrace::Scope scope(startup_trace, "resolver client");
+        private2_->resolv_cli_.init(); // resolv_cli_ is not managed
+    }
 
     announceNode();
 
+    b0::compress::removeDictionaryProvider(this);
+    b0::compress::addDictionaryProvider(this, boost::bind(&Node::getCompressionDictionary, this, _1, _2));
+    b0::message::removeContentTypeIdProvider(this);
+    b0::message::addContentTypeIdProvider(this, boost::bind(&Node::getContentTypeId, this, _1, _2));
+
+    // (an ephemeral node cannot offer services)
+    if(!getEphemeral())
+    {
+        if(b0::env::getBool("B0_DEBUG_SOCKET_SERVICE") && !private2_->debug_srv_)
+            private2_->debug_srv_.reset(new ServiceServer(this, name_ + ".debug_socket", &Node::handleDebugSocket, this, true, false));
+
+        if(b0::env::getBool("B0_METRICS_SERVICE") && !private2_->metrics_srv_)
+            private2_->metrics_srv_.reset(new ServiceServer(this, name_ + ".metrics", &Node::handleMetrics, this, true, false));
+
+        if(b0::env::getBool("B0_CONTROL_SERVICE") && !private2_->control_srv_)
+            private2_->control_srv_.reset(new ServiceServer(this, name_ + ".control", &Node::handleControl, this, true, false));
+    }
+
+    if(!private2_->param_prefixes_.empty() && !private2_->param_sub_)
+        private2_->param_sub_.reset(new Subscriber(this, "param", Subscriber::CallbackMsg<b0::message::resolv::ParamUpdate>(boost::bind(&Private2::onParamUpdate, private2_.get(), _1)), true, false));
+
+    if(private2_->simulated_time_)
+    {
+        StartupTrace::Scope scope(startup_trace, "simulated time");
+        time_sync_.setSimulated(true);
+        private2_->clock_sub_.reset(new Subscriber(this, private2_->clock_topic_, false, false));
+        private2_->clock_sub_->init(); // clock_sub_ is not managed
+        private2_->clock_thread_ = boost::thread(&Node::clockLoop, this);
+    }
+
     if(minimum_heartbeat_interval_ > 0)
+    {
+        StartupTrace::Scope scope(startup_trace, "heartbeat");
         startHeartbeatThread();
+    }
 
     debug("Initializing sockets...");
-    for(auto socket : sockets_)
-        socket->init();
+    {
+        StartupTrace::Scope scope(startup_trace, "sockets");
+        // the announcements of the sockets are sent to the resolver in one request
+        private2_->resolv_cli_.beginAnnounceBatch();
+        try
+        {
+            for(auto socket : sockets_)
+            {
+                StartupTrace::Scope socket_scope(startup_trace, "init", socket->getName());
+                socket->init();
+            }
+        }
+        catch(...)
+        {
+            private2_->resolv_cli_.endAnnounceBatch();
+            throw;
+        }
+        StartupTrace::Scope batch_scope(startup_trace, "announce sockets");
+        private2_->resolv_cli_.endAnnounceBatch();
+    }
+
+    // after the subscription to the changes, so that no change is missed in between
+    // (but for the time the subscription takes to be established):
+    for(const std::string &prefix : private2_->param_prefixes_)
+    {
+        StartupTrace::Scope scope(startup_trace, "params", prefix);
+        std::map<std::string, std::string> params;
+        int64_t version = private2_->resolv_cli_.getParams(prefix, params);
+        boost::mutex::scoped_lock lock(private2_->params_mutex_);
+        for(auto &p : params)
+            private2_->params_[p.first] = p.second;
+        private2_->params_version_ = std::max(private2_->params_version_, version);
+    }
+
+    if(num_callback_threads_ > 0)
+    {
+        StartupTrace::Scope scope(startup_trace, "callback threads");
+        startExecutorThreads();
+    }
 
     state_.store(NodeState::Ready);
 
+    if(startup_trace)
+        reportStartupTrace();
+
     debug("Initialization complete.");
 }
 
@@ -111,6 +640,8 @@ void Node::shutdown()
 
     shutdown_flag_.store(true);
 
+    wakeUp();
+
     debug("Shutting complete.");
 }
 
@@ -125,9 +656,64 @@ void Node::spinOnce()
     if(state != NodeState::Ready)
         throw exception::InvalidStateTransition("spinOnce", state);
 
-    // spin sockets:
+    // send the batched log entries which have waited too long:
+    if(logger::Logger *p_logger = dynamic_cast<logger::Logger*>(p_logger_))
+        p_logger->flushIfDue();
+
+    runTimers();
+
+    if(private2_->inline_heartbeat_ && minimum_heartbeat_interval_ > 0 && !private2_->agent_)
+        inlineHeartbeat();
+
+    if(!private2_->lazy_subs_.empty())
+        connectLazySubscribers();
+
     for(auto socket : sockets_)
-        socket->spinOnce();
+        socket->pollConnectionEvents();
+
+    // poll all sockets at once, and spin only those with incoming messages:
+    private_->updatePollItems(sockets_);
+
+    size_t num_sockets = private_->poll_sockets_.size();
+    if(num_sockets == 0) return;
+
+    if(private_->executor_threads_.empty())
+    {
+        zmq::poll(&private_->poll_items_[0], num_sockets, 0);
+
+        // each socket stops at its budget (see Socket::setSpinBudget()), so all of them get their turn:
+        for(size_t i : private_->spinOrder())
+        {
+            if((private_->poll_items_[i].revents & ZMQ_POLLIN) || private_->poll_sockets_[i]->hasPendingMessages())
+                private_->poll_sockets_[i]->spinOnce();
+        }
+        return;
+    }
+
+    // with the callback executor, ready sockets are handed over to the worker threads,
+    // and sockets already being processed by a worker are not polled:
+    boost::mutex::scoped_lock lock(private_->executor_mutex_);
+    std::vector<zmq::pollitem_t> &items = private_->executor_poll_items_;
+    items.assign(private_->poll_items_.begin(), private_->poll_items_.end());
+    private_->maskBusySockets(items);
+
+    zmq::poll(&items[0], num_sockets, 0);
+
+    bool queued = false;
+    for(size_t i : private_->spinOrder())
+    {
+        Socket *socket = private_->poll_sockets_[i];
+        if(private_->isBusy(socket))
+            continue;
+        if(!(items[i].revents & ZMQ_POLLIN) && !socket->hasPendingMessages())
+            continue;
+        if(private_->queueForExecutor(socket))
+            queued = true;
+    }
+    lock.unlock();
+
+    if(queued)
+        private_->executor_cond_.notify_all();
 }
 
 void Node::spin(boost::function<void(void)> callback, double spinRate)
@@ -136,41 +722,112 @@ void Node::spin(boost::function<void(void)> callback, double spinRate)
     if(state != NodeState::Ready)
         throw exception::InvalidStateTransition("spin", state);
 
-    if(spinRate <= 0)
+    // without an explicit rate, follow the node's rate, which can change at runtime (see handleControl()):
+    bool follow_rate = spinRate <= 0;
+    if(follow_rate)
         spinRate = getSpinRate();
 
     info("Node spinning...");
 
-    while(!shutdownRequested())
+    std::string thread_config_error = applyThreadConfig("spin");
+    if(!thread_config_error.empty())
+        warn("spin thread configuration: %s", thread_config_error);
+
+    if(spin_mode_ == SpinMode::EventDriven)
     {
-        int64_t sleep_period = 1000000. / spinRate;
+        int64_t period = 1000000. / spinRate;
+        int64_t min_interval = max_spin_rate_ > 0 ? 1000000. / max_spin_rate_ : 0;
+        int64_t next_tick = hardwareTimeUSec();
 
-        auto checkSpinRate = [=](const char *what, int64_t last_time, int64_t current_time = -1)
+        while(!shutdownRequested())
         {
-            if(current_time == -1)
-                current_time = hardwareTimeUSec();
-            if(current_time - last_time > sleep_period)
-                warn("%s took more than %ldusec. Failing to achieve desired "
-                        "spin rate of %fHz!", what, sleep_period, spinRate);
-            return current_time;
-        };
+            int64_t t0 = hardwareTimeUSec();
+
+            if(follow_rate && getSpinRate() != spinRate)
+            {
+                spinRate = getSpinRate();
+                period = 1000000. / spinRate;
+            }
+
+            spinOnce();
+
+            if(t0 >= next_tick)
+            {
+                if(!callback.empty())
+                    callback();
+
+                next_tick += period;
+                // don't try to catch up if we are late:
+                if(next_tick < t0)
+                    next_tick = t0 + period;
+            }
+
+            int64_t elapsed = hardwareTimeUSec() - t0;
+            if(elapsed < min_interval)
+                responsiveSleepUSec(min_interval - elapsed);
+
+            int64_t timeout = next_tick - hardwareTimeUSec();
+            int64_t timer = nextTimerUSec();
+            if(timer >= 0 && timer < timeout)
+                timeout = timer;
+            if(timeout > 0)
+                waitForMessagesUSec(timeout);
+        }
+
+        info("spin() finished");
+        return;
+    }
+
+    // the iterations are scheduled on absolute deadlines, so that the errors do not build up:
+    int64_t period = 1000000. / spinRate;
+    int64_t next_tick = hardwareTimeUSec();
+    bool warned = false;
+
+    while(!shutdownRequested())
+    {
+        if(follow_rate && getSpinRate() != spinRate)
+        {
+            spinRate = getSpinRate();
+            period = 1000000. / spinRate;
+            next_tick = hardwareTimeUSec();
+        }
 
         int64_t t0 = hardwareTimeUSec();
+        spin_counters_.iterations.fetch_add(1, std::memory_order_relaxed);
+        spin_counters_.jitter.record(t0 - next_tick);
 
         spinOnce();
 
-        int64_t t1 = checkSpinRate("spinOnce()", t0);
-
         if(!callback.empty())
             callback();
 
-        int64_t t2 = checkSpinRate("spin()'s callback", t1);
-
-        // compensate for time spent in spin and callbacks:
-        sleep_period -= t2 - t0;
-        checkSpinRate("spinOnce() together with spin()'s callback", t0, t2);
+        next_tick += period;
+        int64_t t1 = hardwareTimeUSec();
+        if(t1 > next_tick)
+        {
+            spin_counters_.overruns.fetch_add(1, std::memory_order_relaxed);
+            // warning at each overrun would only make it worse:
+            if(!warned)
+                warn("spinOnce() together with spin()'s callback took %ldusec. Failing to achieve desired "
+                        "spin rate of %fHz! (further overruns are counted in getSpinCounters())", t1 - t0, spinRate);
+            warned = true;
+            // skip the missed deadlines, keeping the phase:
+            next_tick += ((t1 - next_tick) / period + 1) * period;
+        }
 
-        responsiveSleepUSec(sleep_period);
+        // run the timers due before the next deadline at their time:
+        while(!shutdownRequested())
+        {
+            int64_t now = hardwareTimeUSec();
+            int64_t timer = nextTimerUSec();
+            if(timer < 0 || now + timer >= next_tick)
+            {
+                responsiveSleepUntilUSec(next_tick);
+                break;
+            }
+            responsiveSleepUntilUSec(now + timer);
+            runTimers();
+        }
     }
 
     info("spin() finished");
@@ -184,11 +841,24 @@ void Node::cleanup()
 
     shutdown_flag_.store(true);
 
+    int64_t drain_deadline = hardwareTimeUSec() + int64_t(private2_->shutdown_timeout_) * 1000;
+
     // stop the heartbeat_thread so that the last zmq socket will be destroyed
     // and we avoid an unclean exit (zmq::error_t: Context was terminated)
     if(minimum_heartbeat_interval_ > 0)
         stopHeartbeatThread();
 
+    if(!private_->executor_threads_.empty())
+        stopExecutorThreads();
+
+    if(private2_->clock_sub_)
+    {
+        private2_->clock_thread_.interrupt();
+        private2_->clock_thread_.join();
+        private2_->clock_sub_->cleanup(); // clock_sub_ is not managed
+        private2_->clock_sub_.reset();
+    }
+
     debug("Cleanup sockets...");
     for(auto socket : sockets_)
         socket->cleanup();
@@ -196,50 +866,412 @@ void Node::cleanup()
     // inform resolver that we are shutting down
     notifyShutdown();
 
+    if(private2_->graph_sub_)
+        private2_->graph_sub_->cleanup(); // graph_sub_ is not managed
+    private2_->graph_sub_.reset();
+
     private2_->resolv_cli_.cleanup(); // resolv_cli_ is not managed
 
+    // the calls left unanswered are lost:
+    uint64_t dropped = 0;
+    for(auto socket : sockets_)
+        if(ServiceClient *cli = dynamic_cast<ServiceClient*>(socket))
+            dropped += cli->getPendingCalls();
+    private2_->shutdown_dropped_ = dropped;
+
+    if(private2_->shutdown_timeout_ >= 0)
+    {
+        // the sockets are closed after this, and share what is left of the deadline:
+        int64_t left = drain_deadline - hardwareTimeUSec();
+        int linger = int(std::max<int64_t>(0, left / 1000));
+        for(auto socket : sockets_)
+            socket->setLingerPeriod(linger);
+        private2_->resolv_cli_.setLingerPeriod(linger);
+        if(left <= 0)
+            warn("Shutdown deadline passed during cleanup: outgoing messages still queued will be dropped");
+    }
+    if(dropped)
+        info("Shutdown: %d pending calls dropped", dropped);
+
     state_.store(NodeState::Terminated);
 }
 
-void Node::log(logger::Level level, const std::string &message) const
+void Node::setShutdownTimeout(int timeout)
 {
-    if(boost::this_thread::get_id() != thread_id_)
-        throw exception::Exception("cannot call Node::log() from another thread");
-
-    p_logger_->log(level, message);
+    private2_->shutdown_timeout_ = timeout < 0 ? -1 : timeout;
 }
 
-void Node::startHeartbeatThread()
+int Node::getShutdownTimeout() const
 {
-    trace("Starting heartbeat thread...");
-    heartbeat_thread_ = boost::thread(&Node::heartbeatLoop, this);
+    return private2_->shutdown_timeout_;
 }
 
-void Node::stopHeartbeatThread()
+uint64_t Node::getShutdownDroppedCount() const
 {
-    trace("Stopping heartbeat thread...");
-    heartbeat_thread_.interrupt();
-    heartbeat_thread_.join();
+    return private2_->shutdown_dropped_;
 }
 
-std::string Node::getName() const
+void Node::handleDebugSocket(const std::string &req, std::string &rep)
 {
-    // return this node's name, used to address sockets (together with the socket name).
-    // we get this value from the resolver node, during the announceNode() phase.
-    return name_;
+    std::vector<std::string> args;
+    boost::split(args, req, boost::is_any_of(" \t"), boost::token_compress_on);
+    if(args.empty() || args[0].empty() || args.size() > 2)
+    {
+        rep = "error: usage: <pattern> [on|off|extended]";
+        return;
+    }
+    std::string mode = args.size() > 1 ? args[1] : "on";
+    if(mode != "on" && mode != "off" && mode != "extended")
+    {
+        rep = "error: invalid mode: " + mode;
+        return;
+    }
+
+    int count = 0;
+    for(auto socket : sockets_)
+    {
+        if(!socket->matchesPattern(args[0])) continue;
+        socket->setDebugDump(mode != "off", mode == "extended");
+        count++;
+    }
+    if(private2_->resolv_cli_.matchesPattern(args[0]))
+    {
+        private2_->resolv_cli_.setDebugDump(mode != "off", mode == "extended");
+        count++;
+    }
+    rep = (boost::format("ok: %d sockets") % count).str();
+    info("Debug dump %s for %d sockets matching '%s'", mode, count, args[0]);
 }
 
-NodeState Node::getState() const
+void Node::getMetrics(b0::message::metrics::NodeMetrics &metrics, const std::string &pattern)
 {
-    return state_.load();
+    metrics.node_name = name_;
+    metrics.time_usec = timeUSec();
+    metrics.sockets.clear();
+    for(auto socket : sockets_)
+    {
+        if(!socket->matchesPattern(pattern)) continue;
+        metrics.sockets.emplace_back();
+        socket->getMetrics(metrics.sockets.back());
+    }
+    if(private2_->resolv_cli_.matchesPattern(pattern))
+    {
+        metrics.sockets.emplace_back();
+        private2_->resolv_cli_.getMetrics(metrics.sockets.back());
+    }
+    metrics.spin_iterations = spin_counters_.iterations.load();
+    metrics.spin_overruns = spin_counters_.overruns.load();
+    metrics.spin_jitter_p50_usec = spin_counters_.jitter.percentile(50);
+    metrics.spin_jitter_p99_usec = spin_counters_.jitter.percentile(99);
+    metrics.spin_jitter_max_usec = spin_counters_.jitter.max();
 }
 
-void * Node::getContext()
+void Node::handleMetrics(const std::string &req, const std::string &reqtype, std::string &rep, std::string &reptype)
 {
-    return &private_->context_;
+    std::string pattern = boost::trim_copy(req);
+    b0::message::metrics::NodeMetrics metrics;
+    getMetrics(metrics, pattern.empty() ? "*" : pattern);
+    serialize(metrics, rep, reptype);
 }
 
-std::string Node::getXPUBSocketAddress() const
+void Node::handleControl(const std::string &req, std::string &rep)
+{
+    std::vector<std::string> args;
+    std::string trimmed = boost::trim_copy(req);
+    boost::split(args, trimmed, boost::is_any_of(" \t"), boost::token_compress_on);
+    const std::string &cmd = args[0];
+
+    try
+    {
+        if(cmd == "spin-rate" && args.size() == 2)
+        {
+            double rate = boost::lexical_cast<double>(args[1]);
+            if(rate <= 0)
+                throw exception::ArgumentError(args[1], "rate");
+            setSpinRate(rate);
+            rep = "ok";
+        }
+        else if((cmd == "console-loglevel" || cmd == "remote-loglevel") && args.size() == 2)
+        {
+            logger::Level level = logger::levelInfo(args[1]).level;
+            if(cmd == "console-loglevel")
+            {
+                b0::setConsoleLogLevel(level);
+                if(logger::LocalLogger *l = dynamic_cast<logger::LocalLogger*>(p_logger_))
+                    l->setOutputLevel(level);
+            }
+            else
+            {
+                b0::setRemoteLogLevel(level);
+                if(logger::Logger *l = dynamic_cast<logger::Logger*>(p_logger_))
+                    l->setRemoteOutputLevel(level);
+            }
+            rep = "ok";
+        }
+        else if((cmd == "read-hwm" || cmd == "write-hwm") && args.size() == 3)
+        {
+            int n = boost::lexical_cast<int>(args[2]);
+            int count = 0;
+            for(auto socket : sockets_)
+            {
+                if(!socket->matchesPattern(args[1])) continue;
+                if(cmd == "read-hwm")
+                    socket->setReadHWM(n);
+                else
+                    socket->setWriteHWM(n);
+                count++;
+            }
+            rep = (boost::format("ok: %d sockets") % count).str();
+        }
+        else if(cmd == "conflate" && args.size() == 3 && (args[2] == "on" || args[2] == "off"))
+        {
+            int count = 0;
+            for(auto socket : sockets_)
+            {
+                Subscriber *sub = dynamic_cast<Subscriber*>(socket);
+                if(!sub || !socket->matchesPattern(args[1])) continue;
+                // the option applies to new connections only:
+                sub->cleanup();
+                sub->setConflate(args[2] == "on");
+                sub->init();
+                count++;
+            }
+            rep = (boost::format("ok: %d subscribers") % count).str();
+        }
+        else if(cmd == "compression" && (args.size() == 3 || args.size() == 4))
+        {
+            std::string algorithm = args[2] == "none" ? "" : args[2];
+            int level = args.size() == 4 ? boost::lexical_cast<int>(args[3]) : -1;
+            int count = 0;
+            for(auto socket : sockets_)
+            {
+                if(!socket->matchesPattern(args[1])) continue;
+                socket->setCompression(algorithm, level);
+                count++;
+            }
+            rep = (boost::format("ok: %d sockets") % count).str();
+        }
+        else if(cmd == "memory-accounting" && args.size() == 3 && (args[2] == "on" || args[2] == "off"))
+        {
+            int count = 0;
+            for(auto socket : sockets_)
+            {
+                if(!socket->matchesPattern(args[1])) continue;
+                socket->setMemoryAccounting(args[2] == "on");
+                count++;
+            }
+            rep = (boost::format("ok: %d sockets") % count).str();
+        }
+        else if(cmd == "metrics" && args.size() <= 2)
+        {
+            b0::message::metrics::NodeMetrics metrics;
+            getMetrics(metrics, args.size() == 2 ? args[1] : "*");
+            std::string payload, type;
+            serialize(metrics, payload, type);
+            rep = "ok\n" + payload;
+        }
+        else
+        {
+            rep = "error: usage: spin-rate <rate> | console-loglevel <level> | remote-loglevel <level>"
+                " | read-hwm <pattern> <n> | write-hwm <pattern> <n> | conflate <pattern> on|off"
+                " | compression <pattern> <algorithm>|none [<level>] | memory-accounting <pattern> on|off"
+                " | metrics [<pattern>]";
+            return;
+        }
+    }
+    catch(std::exception &ex)
+    {
+        rep = std::string("error: ") + ex.what();
+        return;
+    }
+
+    if(cmd != "metrics")
+        info("Control: %s (%s)", trimmed, rep);
+}
+
+void Node::log(logger::Level level, const std::string &message) const
+{
+    if(!isNodeThread())
+        throw exception::Exception("cannot call Node::log() from another thread");
+
+    boost::mutex::scoped_lock lock(private_->log_mutex_);
+    p_logger_->log(level, message);
+}
+
+bool Node::isLevelEnabled(logger::Level level) const
+{
+    return p_logger_->isLevelEnabled(level);
+}
+
+//! The node being spun by this thread of a b0::Spinner, if any
+static thread_local Node *spinner_node = nullptr;
+
+bool Node::isNodeThread() const
+{
+    return boost::this_thread::get_id() == thread_id_ || private_->isExecutorThread() || spinner_node == this;
+}
+
+void Node::setSpinnerNode(Node *node)
+{
+    spinner_node = node;
+}
+
+void Node::setCallbackThreads(int n)
+{
+    NodeState state = state_.load();
+    if(state != NodeState::Created)
+        throw exception::Exception("Cannot set the number of callback threads of an already initialized node");
+
+    num_callback_threads_ = n;
+}
+
+int Node::getCallbackThreads() const
+{
+    return num_callback_threads_;
+}
+
+void Node::startExecutorThreads()
+{
+    trace("Starting %d callback executor threads...", num_callback_threads_);
+    private_->executor_stop_ = false;
+    for(int i = 0; i < num_callback_threads_; i++)
+    {
+        private_->executor_threads_.push_back(boost::thread(&Node::executorLoop, this));
+        private_->executor_thread_ids_.push_back(private_->executor_threads_.back().get_id());
+    }
+}
+
+void Node::stopExecutorThreads()
+{
+    trace("Stopping callback executor threads...");
+    {
+        boost::mutex::scoped_lock lock(private_->executor_mutex_);
+        private_->executor_stop_ = true;
+    }
+    private_->executor_cond_.notify_all();
+    for(auto &thread : private_->executor_threads_)
+        thread.join();
+    private_->executor_threads_.clear();
+    private_->executor_thread_ids_.clear();
+}
+
+void Node::executorLoop()
+{
+    set_thread_name("CB");
+
+    std::string thread_config_error = applyThreadConfig("callback");
+    if(!thread_config_error.empty())
+        b0::logger::LocalLogger(this).warn("CB: thread configuration: %s", thread_config_error);
+
+    while(true)
+    {
+        Socket *socket;
+        {
+            boost::mutex::scoped_lock lock(private_->executor_mutex_);
+            while(private_->executor_queue_.empty() && !private_->executor_stop_)
+                private_->executor_cond_.wait(lock);
+            if(private_->executor_stop_)
+                return;
+            socket = private_->executor_queue_.front();
+            private_->executor_queue_.pop_front();
+        }
+
+        try
+        {
+            socket->spinOnce();
+        }
+        catch(std::exception &ex)
+        {
+            error("Exception in callback of socket %s: %s", socket->getName(), ex.what());
+        }
+
+        {
+            boost::mutex::scoped_lock lock(private_->executor_mutex_);
+            private_->executor_busy_sockets_.erase(socket);
+            if(!socket->getStrand().empty())
+                private_->executor_busy_strands_.erase(socket->getStrand());
+        }
+
+        // let an event-driven spin() poll this socket again:
+        wakeUp();
+    }
+}
+
+void Node::startHeartbeatThread()
+{
+    if(private2_->agent_)
+    {
+        trace("Heartbeats sent by the agent of the process");
+        private2_->agent_->addNode(this);
+        return;
+    }
+
+    if(private2_->inline_heartbeat_)
+    {
+        trace("Heartbeats sent by spinOnce()");
+        private2_->resolv_cli_.openHeartbeatChannel(private2_->heartbeat_topic_);
+        private2_->next_heartbeat_ = 0;
+        return;
+    }
+
+    if(Global::getInstance().getHeartbeatCoalescing())
+    {
+        std::string &group = private2_->heartbeat_group_;
+        group = resolv_addr_.empty() ? b0::env::get("B0_RESOLVER", "tcp://localhost:22000") : resolv_addr_;
+        boost::mutex::scoped_lock lock(heartbeat_groups_mutex);
+        heartbeat_groups[group].nodes.push_back(this);
+    }
+
+    trace("Starting heartbeat thread...");
+    heartbeat_thread_ = boost::thread(&Node::heartbeatLoop, this);
+}
+
+void Node::stopHeartbeatThread()
+{
+    if(private2_->agent_)
+    {
+        private2_->agent_->removeNode(this);
+        return;
+    }
+
+    if(private2_->inline_heartbeat_)
+        return;
+
+    trace("Stopping heartbeat thread...");
+    heartbeat_thread_.interrupt();
+    heartbeat_thread_.join();
+
+    std::string &group = private2_->heartbeat_group_;
+    if(!group.empty())
+    {
+        // the next node of the group takes over sending the heartbeats
+        boost::mutex::scoped_lock lock(heartbeat_groups_mutex);
+        auto &nodes = heartbeat_groups[group].nodes;
+        nodes.erase(std::remove(nodes.begin(), nodes.end(), this), nodes.end());
+        if(nodes.empty())
+            heartbeat_groups.erase(group);
+        group.clear();
+    }
+}
+
+std::string Node::getName() const
+{
+    // return this node's name, used to address sockets (together with the socket name).
+    // we get this value from the resolver node, during the announceNode() phase.
+    return name_;
+}
+
+NodeState Node::getState() const
+{
+    return state_.load();
+}
+
+void * Node::getContext()
+{
+    return private_->context_.get();
+}
+
+std::string Node::getXPUBSocketAddress() const
 {
     return xpub_sock_addr_;
 }
@@ -249,6 +1281,57 @@ std::string Node::getXSUBSocketAddress() const
     return xsub_sock_addr_;
 }
 
+std::string Node::getXPUBSocketAddress(const std::string &topic_name) const
+{
+    const std::vector<std::string> &addrs = private2_->xpub_sock_addrs_;
+    if(addrs.size() < 2) return getXPUBSocketAddress();
+    return addrs[topicProxyIndex(topic_name, private2_->topic_proxy_, addrs.size())];
+}
+
+std::string Node::getXSUBSocketAddress(const std::string &topic_name) const
+{
+    const std::vector<std::string> &addrs = private2_->xsub_sock_addrs_;
+    if(addrs.size() < 2) return getXSUBSocketAddress();
+    return addrs[topicProxyIndex(topic_name, private2_->topic_proxy_, addrs.size())];
+}
+
+std::string Node::getPriorityXPUBSocketAddress(const std::string &topic_name) const
+{
+    const std::vector<std::string> &addrs = private2_->xpub_priority_sock_addrs_;
+    if(addrs.empty()) return getXPUBSocketAddress(topic_name);
+    return addrs[topicProxyIndex(topic_name, {}, addrs.size())];
+}
+
+std::string Node::getPriorityXSUBSocketAddress(const std::string &topic_name) const
+{
+    const std::vector<std::string> &addrs = private2_->xsub_priority_sock_addrs_;
+    if(addrs.empty()) return getXSUBSocketAddress(topic_name);
+    return addrs[topicProxyIndex(topic_name, {}, addrs.size())];
+}
+
+uint64_t Node::ioThreadAffinity(bool high_priority) const
+{
+    if(!private_->priority_io_thread_) return 0;
+    uint64_t reserved = uint64_t(1) << private_->io_threads_;
+    return high_priority ? reserved : reserved - 1;
+}
+
+size_t Node::topicProxyIndex(const std::string &topic_name, const std::map<std::string, int> &topic_proxy, size_t num_proxies)
+{
+    auto it = topic_proxy.find(topic_name);
+    if(it != topic_proxy.end() && it->second >= 0 && size_t(it->second) < num_proxies)
+        return it->second;
+
+    // 32-bit FNV-1a
+    uint32_t h = 2166136261u;
+    for(unsigned char c : topic_name)
+    {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h % num_proxies;
+}
+
 void Node::addSocket(Socket *socket)
 {
     NodeState state = state_.load();
@@ -256,11 +1339,13 @@ void Node::addSocket(Socket *socket)
         throw exception::Exception("Cannot create a socket with an already initialized node");
 
     sockets_.insert(socket);
+    private_->poll_items_dirty_ = true;
 }
 
 void Node::removeSocket(Socket *socket)
 {
     sockets_.erase(socket);
+    private_->poll_items_dirty_ = true;
 }
 
 std::string Node::hostname() const
@@ -299,16 +1384,209 @@ void Node::notifyService(const std::string &service_name, bool reverse, bool act
     resolv_cli_.notifyService(service_name, reverse, active);
 }
 
-void Node::announceService(const std::string &service_name, const std::string &addr)
+void Node::announceService(const std::string &service_name, const std::string &addr, const std::string &ipc_addr)
 {
     resolver::Client &resolv_cli_ = private2_->resolv_cli_;
-    resolv_cli_.announceService(service_name, addr);
+    resolv_cli_.announceService(service_name, addr, ipc_addr);
 }
 
 void Node::resolveService(const std::string &service_name, std::string &addr)
 {
+    std::vector<std::string> addrs;
+    resolveService(service_name, addrs);
+    addr = addrs[0];
+}
+
+void Node::resolveService(const std::string &service_name, std::vector<std::string> &addrs)
+{
+    // without a resolver there is no cache, and no graph_delta topic
+    if(Global::getInstance().getServiceCache() && !Global::getInstance().getDecentralized())
+    {
+        // the graph changes are read here, so that the cache is invalidated even if the node
+        // does not spin; the subscriber is created on the first resolution, and the changes
+        // until it is connected are only caught by the age limit of the cache entries
+        boost::mutex::scoped_lock lock(private2_->graph_mutex_);
+        readGraphDeltas();
+    }
+
     resolver::Client &resolv_cli_ = private2_->resolv_cli_;
-    resolv_cli_.resolveService(service_name, addr);
+    resolv_cli_.resolveService(service_name, addrs);
+}
+
+void Node::readGraphDeltas()
+{
+    std::unique_ptr<Subscriber> &graph_sub = private2_->graph_sub_;
+    if(!graph_sub)
+    {
+        graph_sub.reset(new Subscriber(this, "graph_delta", false, false));
+        graph_sub->init(); // graph_sub_ is not managed
+    }
+
+    bool service_cache = Global::getInstance().getServiceCache();
+    graph::GraphTracker &tracker = private2_->lazy_graph_;
+    while(graph_sub->poll())
+    {
+        b0::message::graph::GraphDelta delta;
+        graph_sub->readMsg(delta);
+        if(service_cache)
+            resolver::Client::updateServiceCache(delta);
+        // a missed version makes connectLazySubscribers() take a new snapshot:
+        if(tracker.valid() && !tracker.apply(delta))
+            tracker = graph::GraphTracker();
+    }
+}
+
+void Node::addLazySubscriber(Subscriber *sub)
+{
+    private2_->lazy_subs_.insert(sub);
+}
+
+void Node::removeLazySubscriber(Subscriber *sub)
+{
+    private2_->lazy_subs_.erase(sub);
+}
+
+void Node::connectLazySubscribers()
+{
+    Private2 &p = *private2_;
+    boost::mutex::scoped_lock lock(p.graph_mutex_);
+    readGraphDeltas();
+
+    // the changes made while the subscription to graph_delta is being established are
+    // missed, so the graph is fetched again every few seconds while a subscriber waits:
+    auto now = std::chrono::steady_clock::now();
+    if(!p.lazy_graph_.valid() || now >= p.lazy_graph_refresh_)
+    {
+        p.lazy_graph_refresh_ = now + std::chrono::seconds(5);
+        b0::message::graph::Graph graph;
+        try
+        {
+            // nothing to reset if the graph is at the version of the copy
+            if(getGraph(graph, p.lazy_graph_.valid() ? p.lazy_graph_.graph().version : -1))
+                p.lazy_graph_.reset(graph);
+        }
+        catch(exception::Exception &ex)
+        {
+            warn("Failed to get the graph for the lazy subscribers: %s", ex.what());
+            return;
+        }
+    }
+
+    std::set<std::string> published;
+    for(auto &link : p.lazy_graph_.graph().node_topic)
+        if(!link.reversed)
+            published.insert(link.other_name);
+
+    for(auto it = p.lazy_subs_.begin(); it != p.lazy_subs_.end(); )
+    {
+        Subscriber *sub = *it;
+        if(!published.count(sub->getTopicName()))
+        {
+            ++it;
+            continue;
+        }
+        sub->debug("Connecting, the topic has a publisher");
+        sub->connectNow();
+        it = p.lazy_subs_.erase(it);
+    }
+
+    // stop following the graph:
+    if(p.lazy_subs_.empty())
+        p.lazy_graph_ = graph::GraphTracker();
+}
+
+void Node::announceTopic(const std::string &topic_name, const std::string &addr, const std::string &ipc_addr)
+{
+    boost::mutex::scoped_lock lock(private2_->resolv_mutex_);
+    resolver::Client &resolv_cli_ = private2_->resolv_cli_;
+    resolv_cli_.announceTopic(topic_name, addr, ipc_addr);
+}
+
+void Node::resolveTopic(const std::string &topic_name, std::vector<std::string> &addrs)
+{
+    boost::mutex::scoped_lock lock(private2_->resolv_mutex_);
+    resolver::Client &resolv_cli_ = private2_->resolv_cli_;
+    resolv_cli_.resolveTopic(topic_name, addrs);
+}
+
+void Node::getGraph(b0::message::graph::Graph &graph)
+{
+    boost::mutex::scoped_lock lock(private2_->resolv_mutex_);
+    resolver::Client &resolv_cli_ = private2_->resolv_cli_;
+    resolv_cli_.getGraph(graph);
+}
+
+bool Node::getGraph(b0::message::graph::Graph &graph, int64_t if_newer_than_version)
+{
+    boost::mutex::scoped_lock lock(private2_->resolv_mutex_);
+    resolver::Client &resolv_cli_ = private2_->resolv_cli_;
+    return resolv_cli_.getGraph(graph, if_newer_than_version);
+}
+
+bool Node::getGraph(b0::message::graph::Graph &graph, const b0::message::graph::GetGraphRequest &query)
+{
+    boost::mutex::scoped_lock lock(private2_->resolv_mutex_);
+    resolver::Client &resolv_cli_ = private2_->resolv_cli_;
+    return resolv_cli_.getGraph(graph, query);
+}
+
+bool Node::getCompressionDictionary(const std::string &id, std::string &data)
+{
+    boost::mutex::scoped_lock lock(private2_->resolv_mutex_);
+    resolver::Client &resolv_cli_ = private2_->resolv_cli_;
+    return resolv_cli_.getCompressionDictionary(id, data);
+}
+
+bool Node::getContentTypeId(std::string &content_type, int64_t &id)
+{
+    boost::mutex::scoped_lock lock(private2_->resolv_mutex_);
+    resolver::Client &resolv_cli_ = private2_->resolv_cli_;
+    return resolv_cli_.getContentTypeId(content_type, id);
+}
+
+void Node::addParameterPrefix(const std::string &prefix)
+{
+    NodeState state = state_.load();
+    if(state != NodeState::Created)
+        throw exception::Exception("addParameterPrefix() must be called before init()");
+
+    private2_->param_prefixes_.push_back(prefix);
+}
+
+bool Node::getParameter(const std::string &name, std::string &value) const
+{
+    boost::mutex::scoped_lock lock(private2_->params_mutex_);
+    auto it = private2_->params_.find(name);
+    if(it == private2_->params_.end()) return false;
+    value = it->second;
+    return true;
+}
+
+void Node::setParameter(const std::string &name, const std::string &value)
+{
+    {
+        boost::mutex::scoped_lock lock(private2_->resolv_mutex_);
+        private2_->resolv_cli_.setParam(name, value);
+    }
+    // the version is not advanced: the updates of other nodes may still be on their way
+    if(!private2_->isCachedParameter(name)) return;
+    boost::mutex::scoped_lock lock(private2_->params_mutex_);
+    private2_->params_[name] = value;
+}
+
+void Node::removeParameter(const std::string &name)
+{
+    {
+        boost::mutex::scoped_lock lock(private2_->resolv_mutex_);
+        private2_->resolv_cli_.setParam(name, "", true);
+    }
+    boost::mutex::scoped_lock lock(private2_->params_mutex_);
+    private2_->params_.erase(name);
+}
+
+void Node::setParameterCallback(ParameterCallback callback)
+{
+    private2_->param_callback_ = callback;
 }
 
 void Node::setAnnounceTimeout(int timeout)
@@ -317,6 +1595,106 @@ void Node::setAnnounceTimeout(int timeout)
     resolv_cli_.setAnnounceTimeout(timeout);
 }
 
+void Node::setEphemeral(bool enabled)
+{
+    NodeState state = state_.load();
+    if(state != NodeState::Created)
+        throw exception::Exception("setEphemeral() must be called before init()");
+    private2_->resolv_cli_.setEphemeral(enabled);
+}
+
+bool Node::getEphemeral() const
+{
+    return private2_->resolv_cli_.getEphemeral();
+}
+
+void Node::setInlineHeartbeat(bool enabled)
+{
+    NodeState state = state_.load();
+    if(state != NodeState::Created)
+        throw exception::Exception("setInlineHeartbeat() must be called before init()");
+    private2_->inline_heartbeat_ = enabled;
+}
+
+bool Node::getInlineHeartbeat() const
+{
+    return private2_->inline_heartbeat_;
+}
+
+void Node::setProcessAgent(bool enabled)
+{
+    NodeState state = state_.load();
+    if(state != NodeState::Created)
+        throw exception::Exception("setProcessAgent() must be called before init()");
+    private2_->process_agent_ = enabled;
+}
+
+bool Node::getProcessAgent() const
+{
+    return private2_->process_agent_;
+}
+
+void Node::setStartupTracing(bool enabled)
+{
+    NodeState state = state_.load();
+    if(state != NodeState::Created)
+        throw exception::Exception("setStartupTracing() must be called before init()");
+    private2_->startup_tracing_ = enabled;
+}
+
+bool Node::getStartupTracing() const
+{
+    return private2_->startup_tracing_;
+}
+
+const StartupTrace & Node::getStartupTrace() const
+{
+    return private2_->startup_trace_;
+}
+
+StartupTrace * Node::startupTrace()
+{
+    return private2_->startup_tracing_ && private2_->initializing_ ? &private2_->startup_trace_ : nullptr;
+}
+
+//! Row of the next node in the startup trace file of this process
+static std::atomic<int> next_startup_trace_row{1};
+
+void Node::reportStartupTrace()
+{
+    const StartupTrace &trace = private2_->startup_trace_;
+    for(auto &phase : trace.getPhases())
+        debug("Startup: %s%s%s: %.3f ms", std::string(2 * phase.depth, ' '), phase.name, phase.socket.empty() ? "" : " " + phase.socket, phase.duration_usec / 1000.0);
+    debug("Startup: total %.3f ms", trace.getTotalDuration() / 1000.0);
+
+    std::string path = b0::env::get("B0_STARTUP_TRACE_FILE");
+    if(path.empty()) return;
+    try
+    {
+        trace.appendChromeTrace(path, pid(), next_startup_trace_row++, name_);
+    }
+    catch(exception::Exception &ex)
+    {
+        warn("%s", ex.what());
+    }
+}
+
+resolver::Client & Node::resolverClient()
+{
+    return private2_->resolv_cli_;
+}
+
+std::string Node::ipcAddress(int port)
+{
+    // the TCP port makes it unique among the processes of the host, the pid among the containers
+    if(!Global::getInstance().getIPC()) return "";
+#ifdef ZMQ_HAS_CAPABILITIES
+    if(!zmq_has("ipc")) return "";
+#endif
+    boost::format fmt("ipc://%s/b0-%d-%d");
+    return (fmt % Global::getInstance().getIPCDirectory() % pid() % port).str();
+}
+
 std::string Node::freeTCPAddress()
 {
     boost::format fmt("tcp://%s:%d");
@@ -325,10 +1703,26 @@ std::string Node::freeTCPAddress()
 
 void Node::announceNode()
 {
-    private2_->resolv_cli_.announceNode(hostname(), pid(), name_, xpub_sock_addr_, xsub_sock_addr_, minimum_heartbeat_interval_);
+    StartupTrace *startup_trace = startupTrace();
+    StartupTrace::Scope scope(startup_trace, "announce node");
+    private2_->resolv_cli_.announceNode(hostname(), pid(), name_, private2_->xpub_sock_addrs_, private2_->xsub_sock_addrs_, private2_->topic_proxy_, minimum_heartbeat_interval_);
+    private2_->heartbeat_topic_ = private2_->resolv_cli_.getHeartbeatTopic();
+    private2_->xpub_priority_sock_addrs_ = private2_->resolv_cli_.getPriorityXPUBSocketAddresses();
+    private2_->xsub_priority_sock_addrs_ = private2_->resolv_cli_.getPriorityXSUBSocketAddresses();
+    xpub_sock_addr_ = private2_->xpub_sock_addrs_.at(0);
+    xsub_sock_addr_ = private2_->xsub_sock_addrs_.at(0);
+
+    // an ephemeral node's log stays local
+    if(getEphemeral()) return;
 
     if(logger::Logger *p_logger = dynamic_cast<logger::Logger*>(p_logger_))
-        p_logger->connect(xsub_sock_addr_);
+    {
+        StartupTrace::Scope logger_scope(startup_trace, "logger connect");
+        if(private2_->agent_)
+            p_logger->connect(private2_->agent_);
+        else
+            p_logger->connect(getXSUBSocketAddress("log"));
+    }
 }
 
 void Node::notifyShutdown()
@@ -342,20 +1736,45 @@ void Node::heartbeatLoop()
     b0::logger::LocalLogger logger(this);
     logger.trace("HB: started");
 
+    std::string thread_config_error = applyThreadConfig("heartbeat");
+    if(!thread_config_error.empty())
+        logger.warn("HB: thread configuration: %s", thread_config_error);
+
+    int time_sync_every = std::max(1, b0::env::getInt("B0_HEARTBEAT_TIME_SYNC_INTERVAL", 10));
+
     while(!shutdownRequested())
     {
         try
         {
             resolver::Client resolv_cli(this);
+            if(!resolv_addr_.empty()) resolv_cli.setResolverAddress(resolv_addr_);
             resolv_cli.setReadTimeout(minimum_heartbeat_interval_ / 3000);
             resolv_cli.init();
+            resolv_cli.openHeartbeatChannel(private2_->heartbeat_topic_);
 
-            while(!shutdownRequested())
+            const std::string &group = private2_->heartbeat_group_;
+            for(int64_t i = 0; !shutdownRequested(); i++)
             {
-                int64_t time_usec;
-                resolv_cli.sendHeartbeat(&time_usec);
-                time_sync_.updateTime(time_usec);
-                sleepUSec(minimum_heartbeat_interval_ / 3);
+                // on the heartbeat channel, the resolver time is only requested every few heartbeats
+                bool sync = !resolv_cli.hasHeartbeatChannel() || i % time_sync_every == 0;
+                int64_t time_usec, delay_usec = 0;
+                bool has_time = sync;
+                if(group.empty())
+                {
+                    std::vector<b0::message::graph::NodeStats> stats;
+                    if(b0::getHeartbeatStats())
+                    {
+                        stats.emplace_back();
+                        heartbeatStats(stats.back());
+                    }
+                    resolv_cli.sendHeartbeat(sync ? &time_usec : nullptr, {}, stats, &delay_usec);
+                }
+                else
+                    has_time = coalescedHeartbeat(resolv_cli, time_usec, delay_usec, sync);
+                if(has_time)
+                    time_sync_.updateTime(time_usec, delay_usec);
+                // (on the computer's clock, also with a simulated time)
+                boost::this_thread::sleep_for(boost::chrono::microseconds{minimum_heartbeat_interval_ / 3});
             }
 
             resolv_cli.cleanup();
@@ -363,13 +1782,124 @@ void Node::heartbeatLoop()
         catch(std::exception &ex)
         {
             logger.error("HB: %s", ex.what());
-            sleepUSec(minimum_heartbeat_interval_ / 3);
+            boost::this_thread::sleep_for(boost::chrono::microseconds{minimum_heartbeat_interval_ / 3});
         }
     }
 
     logger.trace("HB: finished");
 }
 
+void Node::inlineHeartbeat()
+{
+    int64_t now = hardwareTimeUSec();
+    if(now < private2_->next_heartbeat_) return;
+    private2_->next_heartbeat_ = now + minimum_heartbeat_interval_ / 3;
+
+    static const int time_sync_every = std::max(1, b0::env::getInt("B0_HEARTBEAT_TIME_SYNC_INTERVAL", 10));
+
+    // (the resolver client is shared with the topic resolutions of the callback threads)
+    boost::mutex::scoped_lock lock(private2_->resolv_mutex_);
+    resolver::Client &resolv_cli = private2_->resolv_cli_;
+    int old_timeout = resolv_cli.getReadTimeout();
+    resolv_cli.setReadTimeout(int(minimum_heartbeat_interval_ / 3000));
+    try
+    {
+        // on the heartbeat channel, the resolver time is only requested every few heartbeats
+        bool sync = !resolv_cli.hasHeartbeatChannel() || private2_->heartbeat_count_ % time_sync_every == 0;
+        private2_->heartbeat_count_++;
+        int64_t time_usec, delay_usec = 0;
+        std::vector<b0::message::graph::NodeStats> stats;
+        if(b0::getHeartbeatStats())
+        {
+            stats.emplace_back();
+            heartbeatStats(stats.back());
+        }
+        resolv_cli.sendHeartbeat(sync ? &time_usec : nullptr, {}, stats, &delay_usec);
+        if(sync)
+            time_sync_.updateTime(time_usec, delay_usec);
+    }
+    catch(std::exception &ex)
+    {
+        error("Heartbeat: %s", ex.what());
+    }
+    resolv_cli.setReadTimeout(old_timeout);
+}
+
+bool Node::coalescedHeartbeat(resolver::Client &resolv_cli, int64_t &time_usec, int64_t &delay_usec, bool sync)
+{
+    std::vector<std::string> others;
+    std::vector<b0::message::graph::NodeStats> stats;
+    {
+        boost::mutex::scoped_lock lock(heartbeat_groups_mutex);
+        HeartbeatGroup &g = heartbeat_groups[private2_->heartbeat_group_];
+        if(g.nodes.empty() || g.nodes[0] != this)
+        {
+            // another node sends the heartbeat; only take the time from it
+            if(!g.has_time) return false;
+            time_usec = hardwareTimeUSec() + g.time_offset;
+            delay_usec = g.time_delay;
+            return true;
+        }
+        for(size_t i = 1; i < g.nodes.size(); i++)
+            others.push_back(g.nodes[i]->getName());
+        // the stats of the others are taken here too, serialized by the lock
+        if(b0::getHeartbeatStats())
+        {
+            stats.resize(g.nodes.size());
+            for(size_t i = 0; i < g.nodes.size(); i++)
+                g.nodes[i]->heartbeatStats(stats[i]);
+        }
+    }
+
+    if(!sync)
+    {
+        resolv_cli.sendHeartbeat(nullptr, others, stats);
+        return false;
+    }
+
+    resolv_cli.sendHeartbeat(&time_usec, others, stats, &delay_usec);
+
+    boost::mutex::scoped_lock lock(heartbeat_groups_mutex);
+    HeartbeatGroup &g = heartbeat_groups[private2_->heartbeat_group_];
+    g.time_offset = time_usec - hardwareTimeUSec();
+    g.time_delay = delay_usec;
+    g.has_time = true;
+    return true;
+}
+
+void Node::heartbeatStats(b0::message::graph::NodeStats &stats)
+{
+    // the (managed) sockets are added before the heartbeat thread starts, and their counters
+    // are atomic
+    uint64_t sent = 0, received = 0;
+    for(auto socket : sockets_)
+    {
+        const SocketCounters &c = socket->getCounters();
+        sent += c.messages_sent.load(std::memory_order_relaxed);
+        received += c.messages_received.load(std::memory_order_relaxed);
+    }
+    int64_t now = hardwareTimeUSec();
+    int64_t cpu_time = processCPUTimeUSec();
+
+    stats.node_name = name_;
+    stats.cpu_time_usec = cpu_time;
+    stats.rss = processRSS();
+    stats.spin_overruns = spin_counters_.overruns.load();
+    Private2 &p = *private2_;
+    if(p.stats_time_ && now > p.stats_time_)
+    {
+        double dt = double(now - p.stats_time_);
+        stats.cpu_usage = double(cpu_time - p.stats_cpu_time_) / dt;
+        // the counters go back to zero when they are reset
+        stats.messages_sent_rate = sent >= p.stats_sent_ ? double(sent - p.stats_sent_) * 1e6 / dt : 0;
+        stats.messages_received_rate = received >= p.stats_received_ ? double(received - p.stats_received_) * 1e6 / dt : 0;
+    }
+    p.stats_time_ = now;
+    p.stats_cpu_time_ = cpu_time;
+    p.stats_sent_ = sent;
+    p.stats_received_ = received;
+}
+
 int64_t Node::hardwareTimeUSec() const
 {
     return time_sync_.hardwareTimeUSec();
@@ -385,8 +1915,62 @@ void Node::setTimesyncMaxSlope(double max_slope)
     time_sync_.setMaxSlope(max_slope);
 }
 
+void Node::setClockSource(ClockSource source)
+{
+    time_sync_.setClockSource(source);
+}
+
+void Node::setSimulatedTime(bool enabled, const std::string &clock_topic)
+{
+    NodeState state = state_.load();
+    if(state != NodeState::Created)
+        throw exception::InvalidStateTransition("setSimulatedTime", state);
+
+    private2_->simulated_time_ = enabled;
+    private2_->clock_topic_ = clock_topic;
+}
+
+bool Node::getSimulatedTime() const
+{
+    return private2_->simulated_time_;
+}
+
+void Node::clockLoop()
+{
+    set_thread_name("clock");
+    b0::logger::LocalLogger logger(this);
+    logger.trace("clock: started");
+
+    Subscriber &sub = *private2_->clock_sub_;
+    b0::message::sim::Clock clock;
+    while(!boost::this_thread::interruption_requested())
+    {
+        try
+        {
+            if(!sub.poll(100)) continue;
+            sub.readMsg(clock);
+        }
+        catch(exception::Exception &ex)
+        {
+            logger.warn("clock: %s", ex.what());
+            continue;
+        }
+        time_sync_.setSimulatedTimeUSec(clock.time_usec);
+        // an event-driven spin() waiting for the time must look again:
+        wakeUp();
+    }
+
+    logger.trace("clock: finished");
+}
+
 void Node::sleepUSec(int64_t usec)
 {
+    if(time_sync_.isSimulated())
+    {
+        int64_t until = hardwareTimeUSec() + usec;
+        while(!time_sync_.waitUntilUSec(until, 100000)) {}
+        return;
+    }
     boost::this_thread::sleep_for(boost::chrono::microseconds{usec});
 }
 
@@ -394,6 +1978,11 @@ void Node::responsiveSleepUSec(int64_t usec)
 {
     int64_t until = hardwareTimeUSec() + usec;
     int64_t max_sleep = 100000; // 100ms
+    if(time_sync_.isSimulated())
+    {
+        while(!shutdownRequested() && !time_sync_.waitUntilUSec(until, max_sleep)) {}
+        return;
+    }
     while(1)
     {
         if(shutdownRequested()) return;
@@ -404,6 +1993,354 @@ void Node::responsiveSleepUSec(int64_t usec)
     }
 }
 
+void Node::responsiveSleepUntilUSec(int64_t until)
+{
+#ifdef HAVE_CLOCK_NANOSLEEP
+    if(realtime_sleep_ && !time_sync_.isSimulated())
+    {
+        auto monotonicUSec = [] {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+        };
+        int64_t mono_until = monotonicUSec() + (until - hardwareTimeUSec());
+        int64_t max_sleep = 100000; // 100ms
+        while(!shutdownRequested())
+        {
+            int64_t mono_now = monotonicUSec();
+            if(mono_now >= mono_until) return;
+            int64_t t = std::min(mono_until, mono_now + max_sleep);
+            struct timespec ts;
+            ts.tv_sec = t / 1000000;
+            ts.tv_nsec = (t % 1000000) * 1000;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+        return;
+    }
+#endif
+    responsiveSleepUSec(until - hardwareTimeUSec());
+}
+
+bool Node::waitForMessagesUSec(int64_t usec)
+{
+    private_->updatePollItems(sockets_);
+
+    // wait only on the sockets which will consume their messages in spinOnce(),
+    // otherwise a pending message would make this return immediately forever:
+    // (likewise for the sockets being processed by the callback executor)
+    std::vector<zmq::pollitem_t> items(private_->poll_items_);
+    size_t num_sockets = private_->poll_sockets_.size();
+    {
+        boost::mutex::scoped_lock lock(private_->executor_mutex_);
+        for(size_t i = 0; i < num_sockets; i++)
+        {
+            Socket *socket = private_->poll_sockets_[i];
+            items[i].events = socket->hasCallback() && !socket->isReadInBackground() ? ZMQ_POLLIN : 0;
+        }
+        private_->maskBusySockets(items);
+    }
+    int64_t until = hardwareTimeUSec() + usec;
+    int64_t max_wait = 100000; // 100ms, to be responsive of CTRL-C
+    while(!shutdownRequested())
+    {
+        int64_t remaining = until - hardwareTimeUSec();
+        if(remaining <= 0) break;
+        long timeout_ms = (std::min(max_wait, remaining) + 999) / 1000;
+        if(zmq::poll(&items[0], items.size(), timeout_ms) > 0)
+        {
+            if(items[num_sockets].revents & ZMQ_POLLIN)
+            {
+                // drain wakeup messages:
+                zmq::message_t msg;
+                while(private_->wakeup_rx_.recv(&msg, ZMQ_DONTWAIT)) {}
+            }
+            for(size_t i = 0; i < num_sockets; i++)
+                if(items[i].revents & ZMQ_POLLIN)
+                    return true;
+            return false;
+        }
+    }
+    return false;
+}
+
+int Node::createTimer(int64_t period_usec, TimerCallback callback, bool one_shot, bool synchronized)
+{
+    if(period_usec <= 0)
+        throw exception::ArgumentError(std::to_string(period_usec), "period_usec");
+
+    int64_t now = synchronized ? timeUSec() : hardwareTimeUSec();
+    int id;
+    {
+        boost::mutex::scoped_lock lock(private2_->timers_mutex_);
+        id = private2_->next_timer_id_++;
+        NodeTimer &t = private2_->timers_[id];
+        t.period = period_usec;
+        t.callback = callback;
+        t.one_shot = one_shot;
+        t.synchronized = synchronized;
+        t.deadline = now + period_usec;
+        (synchronized ? private2_->synchronized_deadlines_ : private2_->hardware_deadlines_).insert(std::make_pair(t.deadline, id));
+    }
+
+    // a spin() waiting for messages must wait for this timer too:
+    wakeUp();
+    return id;
+}
+
+void Node::cancelTimer(int id)
+{
+    boost::mutex::scoped_lock lock(private2_->timers_mutex_);
+    auto it = private2_->timers_.find(id);
+    if(it == private2_->timers_.end()) return;
+    (it->second.synchronized ? private2_->synchronized_deadlines_ : private2_->hardware_deadlines_).erase(std::make_pair(it->second.deadline, id));
+    private2_->timers_.erase(it);
+}
+
+void Node::runTimers()
+{
+    int64_t hw_now = hardwareTimeUSec(), sync_now = -1;
+    std::vector<int> due;
+    {
+        boost::mutex::scoped_lock lock(private2_->timers_mutex_);
+        if(private2_->timers_.empty()) return;
+        if(!private2_->synchronized_deadlines_.empty())
+            sync_now = timeUSec();
+        auto collect = [&](std::set<std::pair<int64_t, int> > &deadlines, int64_t now) {
+            while(!deadlines.empty() && deadlines.begin()->first <= now)
+            {
+                int id = deadlines.begin()->second;
+                deadlines.erase(deadlines.begin());
+                due.push_back(id);
+                NodeTimer &t = private2_->timers_[id];
+                if(t.one_shot) continue;
+                t.deadline += t.period;
+                // don't try to catch up if we are late:
+                if(t.deadline <= now)
+                    t.deadline = now + t.period;
+                deadlines.insert(std::make_pair(t.deadline, id));
+            }
+        };
+        collect(private2_->hardware_deadlines_, hw_now);
+        collect(private2_->synchronized_deadlines_, sync_now);
+    }
+
+    for(int id : due)
+    {
+        TimerCallback callback;
+        {
+            // it may have been cancelled by a previous callback
+            boost::mutex::scoped_lock lock(private2_->timers_mutex_);
+            auto it = private2_->timers_.find(id);
+            if(it == private2_->timers_.end()) continue;
+            callback = it->second.callback;
+            if(it->second.one_shot)
+                private2_->timers_.erase(it);
+        }
+        callback();
+    }
+}
+
+int64_t Node::nextTimerUSec()
+{
+    boost::mutex::scoped_lock lock(private2_->timers_mutex_);
+    int64_t next = -1;
+    if(!private2_->hardware_deadlines_.empty())
+        next = std::max<int64_t>(0, private2_->hardware_deadlines_.begin()->first - hardwareTimeUSec());
+    if(!private2_->synchronized_deadlines_.empty())
+    {
+        int64_t s = std::max<int64_t>(0, private2_->synchronized_deadlines_.begin()->first - timeUSec());
+        if(next < 0 || s < next) next = s;
+    }
+    return next;
+}
+
+void Node::setSpinMode(SpinMode mode, double maxSpinRate)
+{
+    spin_mode_ = mode;
+    max_spin_rate_ = maxSpinRate;
+}
+
+SpinMode Node::getSpinMode() const
+{
+    return spin_mode_;
+}
+
+void Node::setRealtimeSleep(bool enabled)
+{
+    realtime_sleep_ = enabled;
+}
+
+bool Node::getRealtimeSleep() const
+{
+    return realtime_sleep_;
+}
+
+SpinCounters & Node::getSpinCounters()
+{
+    return spin_counters_;
+}
+
+void Node::wakeUp()
+{
+    boost::mutex::scoped_lock lock(private_->wakeup_mutex_);
+    zmq::message_t msg;
+    private_->wakeup_tx_.send(msg, ZMQ_DONTWAIT);
+}
+
+std::vector<int64_t> Node::getEventFileDescriptors()
+{
+    private_->updatePollItems(sockets_);
+
+    std::vector<int64_t> fds;
+    size_t num_sockets = private_->poll_sockets_.size();
+    for(size_t i = 0; i <= num_sockets; i++)
+    {
+        // sockets without a callback keep their messages, and are not worth watching:
+        if(i < num_sockets)
+        {
+            // (the sockets read by a thread of their own signal through the wakeup channel)
+            if(private_->poll_sockets_[i]->hasCallback() && !private_->poll_sockets_[i]->isReadInBackground())
+                fds.push_back(private_->poll_sockets_[i]->getFileDescriptor());
+            continue;
+        }
+#ifdef _WIN32
+        SOCKET fd;
+#else
+        int fd;
+#endif
+        size_t size = sizeof(fd);
+        private_->wakeup_rx_.getsockopt(ZMQ_FD, &fd, &size);
+        fds.push_back(static_cast<int64_t>(fd));
+    }
+    return fds;
+}
+
+bool Node::hasPendingEvents()
+{
+    private_->updatePollItems(sockets_);
+
+    // reading ZMQ_EVENTS of every socket is required to re-arm their ZMQ_FD (except for the
+    // sockets used by another thread, which must not be touched; their descriptors are not
+    // watched, or are re-armed by the next call once the worker is done):
+    size_t num_sockets = private_->poll_sockets_.size();
+    private_->drainWakeup();
+
+    bool pending = false;
+    boost::mutex::scoped_lock lock(private_->executor_mutex_);
+    for(size_t i = 0; i < num_sockets; i++)
+    {
+        Socket *socket = private_->poll_sockets_[i];
+        if(private_->isBusy(socket))
+            continue;
+        int events = socket->isReadInBackground() ? 0 : socket->getEvents();
+        if(!socket->hasCallback())
+            continue;
+        if((events & ZMQ_POLLIN) || socket->hasPendingMessages())
+            pending = true;
+    }
+    return pending;
+}
+
+void Node::appendPollSockets(std::vector<void*> &sockets)
+{
+    private_->updatePollItems(sockets_);
+
+    // same selection as waitForMessagesUSec():
+    size_t num_sockets = private_->poll_sockets_.size();
+    {
+        boost::mutex::scoped_lock lock(private_->executor_mutex_);
+        for(size_t i = 0; i < num_sockets; i++)
+        {
+            Socket *socket = private_->poll_sockets_[i];
+            if(socket->hasCallback() && !private_->isBusy(socket) && !socket->isReadInBackground())
+                sockets.push_back(private_->poll_items_[i].socket);
+        }
+    }
+    sockets.push_back(private_->poll_items_[num_sockets].socket);
+}
+
+void Node::drainWakeUp()
+{
+    private_->drainWakeup();
+}
+
+bool Node::processReadySockets(const std::vector<int64_t> &fds)
+{
+    NodeState state = state_.load();
+    if(state != NodeState::Ready)
+        throw exception::InvalidStateTransition("processReadySockets", state);
+
+    private_->updatePollItems(sockets_);
+    private_->drainWakeup();
+
+    std::set<int64_t> ready(fds.begin(), fds.end());
+    size_t num_sockets = private_->poll_sockets_.size();
+    bool remaining = false;
+
+    if(!private_->executor_threads_.empty())
+    {
+        boost::mutex::scoped_lock lock(private_->executor_mutex_);
+        bool queued = false;
+        for(size_t i = 0; i < num_sockets; i++)
+        {
+            Socket *socket = private_->poll_sockets_[i];
+            if(!socket->hasCallback())
+                continue;
+            if(private_->isBusy(socket))
+            {
+                // used by a worker thread, so its events cannot be read: it is left for a later call
+                if(!socket->isReadInBackground() && ready.count(socket->getFileDescriptor()))
+                    remaining = true;
+                continue;
+            }
+            if(socket->isReadInBackground())
+            {
+                if(!socket->hasPendingMessages())
+                    continue;
+            }
+            else
+            {
+                if(!ready.count(socket->getFileDescriptor()))
+                    continue;
+                // the events must be read anyway, to re-arm the descriptor:
+                if(!(socket->getEvents() & ZMQ_POLLIN) && !socket->hasPendingMessages())
+                    continue;
+            }
+            if(private_->queueForExecutor(socket))
+                queued = true;
+            else
+                remaining = true;
+        }
+        lock.unlock();
+        if(queued)
+            private_->executor_cond_.notify_all();
+        return remaining;
+    }
+
+    // intra-process messages are signaled through the wakeup channel, not by their socket:
+    for(size_t i = 0; i < num_sockets; i++)
+    {
+        Socket *socket = private_->poll_sockets_[i];
+        if(!socket->hasCallback())
+            continue;
+        bool background = socket->isReadInBackground();
+        if((background || !ready.count(socket->getFileDescriptor())) && !socket->hasPendingMessages())
+            continue;
+        // bounded, so that a busy socket does not starve the host loop:
+        int spins = 0;
+        while((!background && (socket->getEvents() & ZMQ_POLLIN)) || socket->hasPendingMessages())
+        {
+            if(spins++ == max_ready_spins)
+            {
+                remaining = true;
+                break;
+            }
+            socket->spinOnce();
+        }
+    }
+    return remaining;
+}
+
 void Node::setSpinRate(double rate)
 {
     spin_rate_ = rate;
@@ -411,7 +2348,8 @@ void Node::setSpinRate(double rate)
 
 double Node::getSpinRate()
 {
-    return spin_rate_ > 0 ? spin_rate_ : b0::getSpinRate();
+    double rate = spin_rate_.load();
+    return rate > 0 ? rate : b0::getSpinRate();
 }
 
 } // namespace b0
@@ -0,0 +1,233 @@
+#include <b0/process_agent.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/exceptions.h>
+#include <b0/logger/logger.h>
+#include <b0/resolver/client.h>
+#include <b0/message/graph/node_stats.h>
+#include <b0/message/log/log_entry.h>
+#include <b0/message/log/log_entry_batch.h>
+#include <b0/message/resolv/request.h>
+#include <b0/message/resolv/response.h>
+#include <b0/utils/thread_name.h>
+#include <b0/utils/thread_config.h>
+#include <b0/utils/env.h>
+
+#include <algorithm>
+#include <map>
+
+#include <boost/chrono.hpp>
+
+namespace b0
+{
+
+//! \cond HIDDEN_SYMBOLS
+
+struct ProcessAgent::Private
+{
+    Private()
+        : node_("b0_agent"),
+          log_pub_(&node_, "log", false, false)
+    {
+    }
+
+    Node node_;
+
+    Publisher log_pub_;
+};
+
+//! \endcond
+
+static boost::mutex agents_mutex;
+
+//! The agents of this process, by resolver address
+static std::map<std::string, std::weak_ptr<ProcessAgent> > agents;
+
+std::shared_ptr<ProcessAgent> ProcessAgent::get(const std::string &resolver_addr)
+{
+    boost::mutex::scoped_lock lock(agents_mutex);
+    std::shared_ptr<ProcessAgent> agent = agents[resolver_addr].lock();
+    if(!agent)
+    {
+        agent.reset(new ProcessAgent(resolver_addr));
+        agents[resolver_addr] = agent;
+    }
+    return agent;
+}
+
+size_t ProcessAgent::getInstanceCount()
+{
+    boost::mutex::scoped_lock lock(agents_mutex);
+    size_t count = 0;
+    for(auto &a : agents)
+        if(!a.second.expired()) count++;
+    return count;
+}
+
+ProcessAgent::ProcessAgent(const std::string &resolver_addr)
+    : resolver_addr_(resolver_addr),
+      private_(new Private)
+{
+    Node &node = private_->node_;
+    node.setEphemeral(true);
+    node.setProcessAgent(false);
+    node.setResolverAddress(resolver_addr_);
+    node.init();
+
+    resolver::Client &resolv_cli = node.resolverClient();
+    resolv_cli.openHeartbeatChannel(resolv_cli.getHeartbeatTopic());
+
+    private_->log_pub_.setRemoteAddress(node.getXSUBSocketAddress("log"));
+    private_->log_pub_.init();
+
+    heartbeat_thread_ = boost::thread(&ProcessAgent::heartbeatLoop, this);
+}
+
+ProcessAgent::~ProcessAgent()
+{
+    heartbeat_thread_.interrupt();
+    heartbeat_thread_.join();
+
+    private_->log_pub_.cleanup();
+    private_->node_.cleanup();
+
+    boost::mutex::scoped_lock lock(agents_mutex);
+    auto it = agents.find(resolver_addr_);
+    // (another agent may have been created for this resolver in the meantime)
+    if(it != agents.end() && it->second.expired())
+        agents.erase(it);
+}
+
+void ProcessAgent::callResolver(const b0::message::resolv::Request &rq, b0::message::resolv::Response &rsp, int timeout)
+{
+    boost::mutex::scoped_lock lock(resolver_mutex_);
+    resolver::Client &resolv_cli = private_->node_.resolverClient();
+    int old_timeout = resolv_cli.getReadTimeout();
+    resolv_cli.setReadTimeout(timeout);
+    try
+    {
+        resolv_cli.callResolver(rq, rsp);
+    }
+    catch(...)
+    {
+        resolv_cli.setReadTimeout(old_timeout);
+        throw;
+    }
+    resolv_cli.setReadTimeout(old_timeout);
+}
+
+void ProcessAgent::addNode(Node *node)
+{
+    boost::mutex::scoped_lock lock(nodes_mutex_);
+    nodes_.push_back(node);
+}
+
+void ProcessAgent::removeNode(Node *node)
+{
+    // once this returns, the heartbeat thread does not use the node anymore
+    boost::mutex::scoped_lock lock(nodes_mutex_);
+    nodes_.erase(std::remove(nodes_.begin(), nodes_.end(), node), nodes_.end());
+}
+
+size_t ProcessAgent::getNodeCount()
+{
+    boost::mutex::scoped_lock lock(nodes_mutex_);
+    return nodes_.size();
+}
+
+void ProcessAgent::publishLog(const std::string &subtopic, const b0::message::log::LogEntry &entry)
+{
+    boost::mutex::scoped_lock lock(log_mutex_);
+    private_->log_pub_.setSubtopic(subtopic);
+    private_->log_pub_.publish(entry);
+}
+
+void ProcessAgent::publishLog(const std::string &subtopic, const b0::message::log::LogEntryBatch &batch)
+{
+    boost::mutex::scoped_lock lock(log_mutex_);
+    private_->log_pub_.setSubtopic(subtopic);
+    private_->log_pub_.publish(batch);
+}
+
+std::string ProcessAgent::getResolverAddress() const
+{
+    return resolver_addr_;
+}
+
+void ProcessAgent::heartbeatLoop()
+{
+    set_thread_name("HB");
+    Node &agent_node = private_->node_;
+    b0::logger::LocalLogger logger(&agent_node);
+    logger.trace("HB: started");
+
+    std::string thread_config_error = applyThreadConfig("heartbeat");
+    if(!thread_config_error.empty())
+        logger.warn("HB: thread configuration: %s", thread_config_error);
+
+    int time_sync_every = std::max(1, b0::env::getInt("B0_HEARTBEAT_TIME_SYNC_INTERVAL", 10));
+    resolver::Client &resolv_cli = agent_node.resolverClient();
+
+    for(int64_t i = 0; ; i++)
+    {
+        // the nodes may come and go between two heartbeats
+        std::vector<std::string> node_names;
+        std::vector<b0::message::graph::NodeStats> stats;
+        int64_t interval = 0;
+        {
+            boost::mutex::scoped_lock lock(nodes_mutex_);
+            for(Node *node : nodes_)
+            {
+                node_names.push_back(node->getName());
+                if(interval == 0 || node->minimum_heartbeat_interval_ < interval)
+                    interval = node->minimum_heartbeat_interval_;
+                if(b0::getHeartbeatStats())
+                {
+                    stats.emplace_back();
+                    node->heartbeatStats(stats.back());
+                }
+            }
+        }
+
+        if(!node_names.empty())
+        {
+            try
+            {
+                // on the heartbeat channel, the resolver time is only requested every few heartbeats
+                bool sync = !resolv_cli.hasHeartbeatChannel() || i % time_sync_every == 0;
+                int64_t time_usec, delay_usec = 0;
+                {
+                    boost::mutex::scoped_lock lock(resolver_mutex_);
+                    int old_timeout = resolv_cli.getReadTimeout();
+                    resolv_cli.setReadTimeout(int(interval / 3000));
+                    try
+                    {
+                        resolv_cli.sendHeartbeat(sync ? &time_usec : nullptr, node_names, stats, &delay_usec);
+                    }
+                    catch(...)
+                    {
+                        resolv_cli.setReadTimeout(old_timeout);
+                        throw;
+                    }
+                    resolv_cli.setReadTimeout(old_timeout);
+                }
+                if(sync)
+                {
+                    boost::mutex::scoped_lock lock(nodes_mutex_);
+                    for(Node *node : nodes_)
+                        node->time_sync_.updateTime(time_usec, delay_usec);
+                }
+            }
+            catch(std::exception &ex)
+            {
+                logger.error("HB: %s", ex.what());
+            }
+        }
+
+        // (on the computer's clock, also with a simulated time; stopped by the interruption)
+        if(interval <= 0) interval = 300000;
+        boost::this_thread::sleep_for(boost::chrono::microseconds{interval / 3});
+    }
+}
+
+} // namespace b0
@@ -2,30 +2,75 @@
 #include <b0/exceptions.h>
 #include <b0/config.h>
 
+#include <limits>
+
 namespace b0
 {
 
 namespace protobuf
 {
 
+static google::protobuf::ArenaOptions arenaOptions(std::vector<char> &initial_block)
+{
+    google::protobuf::ArenaOptions options;
+    if(!initial_block.empty())
+    {
+        options.initial_block = initial_block.data();
+        options.initial_block_size = initial_block.size();
+    }
+    return options;
+}
+
+MessageArena::MessageArena(size_t initial_block_size)
+    : initial_block_(initial_block_size),
+      arena_(arenaOptions(initial_block_))
+{
+}
+
+void MessageArena::reset()
+{
+    arena_.Reset();
+}
+
 void SocketProtobuf::read(Socket *socket, google::protobuf::Message &msg)
 {
-    std::string payload, type;
-    socket->readRaw(payload, type);
-    if(!msg.ParseFromString(payload))
+    socket->readRaw(envelope_);
+    if(envelope_.parts.empty())
         throw exception::ProtobufParseError();
+    parse(envelope_.parts[0], msg);
+}
+
+void SocketProtobuf::write(Socket *socket, const google::protobuf::Message &msg)
+{
+    b0::message::MessagePart part;
+    serialize(msg, part);
+    socket->writeRaw(std::move(part.payload), part.content_type);
+}
+
+static void parseFromArray(const char *data, size_t size, const std::string &type, google::protobuf::Message &msg)
+{
     std::string expected_type = msg.GetTypeName();
     if(type != expected_type)
         throw exception::MessageTypeMismatch(type, expected_type);
+    if(size > static_cast<size_t>(std::numeric_limits<int>::max()) || !msg.ParseFromArray(data, static_cast<int>(size)))
+        throw exception::ProtobufParseError();
 }
 
-void SocketProtobuf::write(Socket *socket, const google::protobuf::Message &msg)
+void SocketProtobuf::parse(const b0::message::MessagePartView &part, google::protobuf::Message &msg)
 {
-    std::string payload;
-    if(!msg.SerializeToString(&payload))
+    parseFromArray(part.data, part.size, part.content_type, msg);
+}
+
+void SocketProtobuf::parse(const b0::message::MessagePart &part, google::protobuf::Message &msg)
+{
+    parseFromArray(part.payload.data(), part.payload.size(), part.content_type, msg);
+}
+
+void SocketProtobuf::serialize(const google::protobuf::Message &msg, b0::message::MessagePart &part)
+{
+    if(!msg.SerializeToString(&part.payload))
         throw exception::ProtobufSerializeError();
-    std::string type = msg.GetTypeName();
-    socket->writeRaw(payload, type);
+    part.content_type = msg.GetTypeName();
 }
 
 } // namespace protobuf
@@ -46,4 +91,3 @@ ProtobufParseError::ProtobufParseError()
 } // namespace exception
 
 } // namespace b0
-
@@ -1,19 +1,84 @@
 #include <b0/publisher.h>
+#include <b0/subscriber.h>
 #include <b0/node.h>
+#include <b0/utils/env.h>
+#include <b0/utils/tracing.h>
+#include <b0/exceptions.h>
+#include <b0/message/graph/graph.h>
+#include <b0/shm/shared_memory.h>
+#include <b0/compress/compress.h>
+#include <b0/compress/delta.h>
+#include <b0/utils/startup_trace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+
+#include <boost/format.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
 #include <zmq.hpp>
 
 namespace b0
 {
 
+struct Publisher::ThreadSocket
+{
+    ThreadSocket(zmq::context_t &context)
+        : socket_(context, ZMQ_PUB)
+    {
+    }
+
+    zmq::socket_t socket_;
+
+    //! Envelope serializer, reused across the messages of the thread
+    b0::message::EnvelopeSerializer serializer_;
+
+    //! Compression state and buffers, reused across the messages of the thread
+    b0::compress::Context compression_context_;
+};
+
 Publisher::Publisher(Node *node, const std::string &topic_name, bool managed, bool notify_graph)
     : Socket(node, ZMQ_PUB, topic_name, managed),
-      notify_graph_(notify_graph)
+      notify_graph_(notify_graph),
+      stamp_messages_(b0::env::getBool("B0_STAMP_MESSAGES")),
+      ttl_usec_(b0::env::getInt("B0_PUBLISHER_TTL", 0)),
+      shared_memory_(b0::env::getBool("B0_SHARED_MEMORY")),
+      thread_safe_(b0::env::getBool("B0_PUBLISHER_THREAD_SAFE")),
+      skip_unsubscribed_(b0::env::getBool("B0_PUBLISHER_SKIP_UNSUBSCRIBED")),
+      async_size_(std::max(0, b0::env::getInt("B0_PUBLISHER_ASYNC")))
 {
+    static std::atomic<unsigned> next_id{0};
+    publisher_id_ = (boost::format("%s/%d/%d") % node_.hostname() % node_.pid() % next_id++).str();
+
+    int queue_limit = b0::env::getInt("B0_PUBLISHER_QUEUE_LIMIT", 16 * 1024 * 1024);
+    if(queue_limit <= 0)
+        throw exception::ArgumentError(std::to_string(queue_limit), "B0_PUBLISHER_QUEUE_LIMIT");
+    queue_limit_ = queue_limit;
+
+    std::string backpressure = b0::env::get("B0_PUBLISHER_BACKPRESSURE");
+    if(boost::iequals(backpressure, "count"))
+        setBackpressure(Backpressure::Count);
+    else if(boost::iequals(backpressure, "block"))
+        setBackpressure(Backpressure::Block);
+    else if(boost::iequals(backpressure, "queue"))
+        setBackpressure(Backpressure::Queue);
+    else if(backpressure != "" && !boost::iequals(backpressure, "drop"))
+        throw exception::ArgumentError(backpressure, "B0_PUBLISHER_BACKPRESSURE");
+
+    std::string async_overflow = b0::env::get("B0_PUBLISHER_ASYNC_OVERFLOW");
+    if(boost::iequals(async_overflow, "block"))
+        async_overflow_ = AsyncOverflow::Block;
+    else if(async_overflow != "" && !boost::iequals(async_overflow, "drop"))
+        throw exception::ArgumentError(async_overflow, "B0_PUBLISHER_ASYNC_OVERFLOW");
+
+    if(skip_unsubscribed_)
+        updateSocketType();
 }
 
 Publisher::~Publisher()
 {
+    stopAsync();
 }
 
 void Publisher::log(logger::Level level, const std::string &message) const
@@ -24,20 +89,70 @@ void Publisher::log(logger::Level level, const std::string &message) const
 
 void Publisher::init()
 {
-    if(Global::getInstance().remapTopicName(getNode(), orig_name_, name_))
-        info("Topic name '%s' remapped to '%s'", orig_name_, name_);
+    StartupTrace *startup_trace = node_.startupTrace();
+    {
+        StartupTrace::Scope scope(startup_trace, "remap", orig_name_);
+        if(Global::getInstance().remapTopicName(getNode(), orig_name_, name_))
+            info("Topic name '%s' remapped to '%s'", orig_name_, name_);
+    }
+
+    // a multicast publisher sends only to its group (no proxy, no intra-process delivery):
+    if(!multicast_addr_.empty())
+        remote_addr_ = multicast_addr_;
+
+    // intra-process delivery is only possible when connected to the resolver's proxy:
+    if(remote_addr_.empty() && Global::getInstance().getIntraProcess())
+        intra_process_key_ = (isHighPriority() ? node_.getPriorityXPUBSocketAddress(name_) : node_.getXPUBSocketAddress(name_)) + "|" + name_;
+
+    if(remote_addr_.empty() && Global::getInstance().getPeerToPeer())
+    {
+        // bind to our own address and let subscribers connect directly to it:
+        StartupTrace::Scope scope(startup_trace, "bind", name_);
+        bind();
+    }
+    else
+    {
+        if(remote_addr_.empty())
+            remote_addr_ = isHighPriority() ? node_.getPriorityXSUBSocketAddress(name_) : node_.getXSUBSocketAddress(name_);
+        StartupTrace::Scope scope(startup_trace, "connect", name_);
+        connect();
+    }
 
-    if(remote_addr_.empty())
-        remote_addr_ = node_.getXSUBSocketAddress();
-    connect();
+    if(!multicast_addr_.empty())
+    {
+        StartupTrace::Scope scope(startup_trace, "announce", name_);
+        trace("Announcing %s to resolver...", multicast_addr_);
+        node_.announceTopic(name_, multicast_addr_);
+    }
+
+    if(async_size_ > 0)
+    {
+        async_stop_ = false;
+        async_running_.store(true);
+        async_thread_ = boost::thread(&Publisher::asyncLoop, this);
+    }
 
     if(notify_graph_)
+    {
+        StartupTrace::Scope scope(startup_trace, "notify", name_);
         node_.notifyTopic(name_, false, true);
+    }
 }
 
 void Publisher::cleanup()
 {
-    disconnect();
+    flush();
+    stopAsync();
+    // a last chance for the messages waiting in the queue (see Backpressure::Queue):
+    flushWriteQueue();
+
+    {
+        boost::unique_lock<boost::shared_mutex> lock(thread_sockets_mutex_);
+        thread_sockets_.clear();
+    }
+
+    if(bind_addr_.empty())
+        disconnect();
 
     if(notify_graph_)
         node_.notifyTopic(name_, false, false);
@@ -50,12 +165,934 @@ std::string Publisher::getTopicName()
 
 void Publisher::publish(const std::vector<b0::message::MessagePart> &parts)
 {
-    writeRaw(parts);
+    if(skip()) return;
+    if(async_running_.load())
+        publish(std::vector<b0::message::MessagePart>(parts));
+    else
+        writeRaw(parts);
+}
+
+void Publisher::publish(std::vector<b0::message::MessagePart> &&parts)
+{
+    if(skip()) return;
+    if(async_running_.load())
+    {
+        b0::message::MessageEnvelope env;
+        env.parts = std::move(parts);
+        env.header0 = name_;
+        enqueueAsync(std::move(env));
+        return;
+    }
+    writeRaw(std::move(parts));
 }
 
 void Publisher::publish(const std::string &msg, const std::string &type)
 {
-    writeRaw(msg, type);
+    if(skip()) return;
+    if(async_running_.load())
+        enqueueAsync(makeEnvelope(std::string(msg), type));
+    else
+        writeRaw(msg, type);
+}
+
+void Publisher::publish(std::string &&msg, const std::string &type)
+{
+    if(skip()) return;
+    if(async_running_.load())
+        enqueueAsync(makeEnvelope(std::move(msg), type));
+    else
+        writeRaw(std::move(msg), type);
+}
+
+b0::message::MessageEnvelope Publisher::makeEnvelope(std::string &&msg, const std::string &type)
+{
+    b0::message::MessageEnvelope env;
+    env.parts.resize(1);
+    env.parts[0].payload = std::move(msg);
+    env.parts[0].content_type = type;
+    setPartCompression(env.parts[0]);
+    env.header0 = name_;
+    return env;
+}
+
+void Publisher::enqueueAsync(b0::message::MessageEnvelope &&env, const boost::function<void()> &write)
+{
+    boost::mutex::scoped_lock lock(async_mutex_);
+    if(async_overflow_ == AsyncOverflow::Block)
+    {
+        while(async_queue_.size() >= async_size_)
+            async_room_cond_.wait(lock);
+    }
+    else if(async_queue_.size() >= async_size_)
+    {
+        async_queue_.pop_front();
+        getCounters().messageDropped();
+    }
+    async_queue_.emplace_back();
+    async_queue_.back().env = std::move(env);
+    async_queue_.back().write = write;
+    lock.unlock();
+    async_cond_.notify_one();
+}
+
+void Publisher::asyncLoop()
+{
+    AsyncMessage msg;
+    while(true)
+    {
+        {
+            boost::mutex::scoped_lock lock(async_mutex_);
+            while(async_queue_.empty() && !async_stop_)
+                async_cond_.wait(lock);
+            if(async_queue_.empty()) return;
+            msg = std::move(async_queue_.front());
+            async_queue_.pop_front();
+        }
+        async_room_cond_.notify_one();
+
+        try
+        {
+            if(msg.write)
+            {
+                msg.write();
+            }
+            else
+            {
+                prepareEnvelope(msg.env);
+                writeRaw(msg.env);
+            }
+        }
+        catch(exception::Exception &)
+        {
+            getCounters().messageDropped();
+        }
+        msg.write.clear();
+    }
+}
+
+void Publisher::stopAsync()
+{
+    if(!async_thread_.joinable()) return;
+    // from here on, publish() writes at once:
+    async_running_.store(false);
+    {
+        boost::mutex::scoped_lock lock(async_mutex_);
+        async_stop_ = true;
+    }
+    async_cond_.notify_one();
+    async_thread_.join();
+}
+
+void Publisher::forward(boost::string_ref wire)
+{
+    if(skip()) return;
+
+    const std::string &header0 = subtopic_.empty() ? name_ : name_ + "/" + subtopic_;
+    boost::mutex::scoped_lock lock(write_mutex_, boost::defer_lock);
+    if(lockedWrites())
+        lock.lock();
+    writeWire(wire.data(), wire.size(), header0);
+}
+
+PreparedMessage Publisher::prepare(const std::vector<b0::message::MessagePart> &parts)
+{
+    b0::message::MessageEnvelope env;
+    env.header0 = subtopic_.empty() ? name_ : name_ + "/" + subtopic_;
+    env.parts = parts;
+
+    b0::message::EnvelopeSerializer serializer;
+    serializer.setChecksum(getChecksum());
+    std::shared_ptr<std::string> wire = std::make_shared<std::string>();
+    wire->resize(serializer.prepare(env, getEnvelopeFormat()));
+    serializer.write(&(*wire)[0]);
+
+    PreparedMessage msg;
+    msg.wire_ = std::move(wire);
+    return msg;
+}
+
+PreparedMessage Publisher::prepare(const std::string &msg, const std::string &type)
+{
+    std::vector<b0::message::MessagePart> parts(1);
+    parts[0].payload = msg;
+    parts[0].content_type = type;
+    setPartCompression(parts[0]);
+    return prepare(parts);
+}
+
+void Publisher::publish(const PreparedMessage &msg)
+{
+    if(!msg.valid())
+        throw exception::ArgumentError("empty prepared message", "msg");
+    if(skip()) return;
+
+    const std::string &header0 = subtopic_.empty() ? name_ : name_ + "/" + subtopic_;
+    boost::mutex::scoped_lock lock(write_mutex_, boost::defer_lock);
+    if(lockedWrites())
+        lock.lock();
+    const std::string &wire = *msg.wire_;
+    if(wire.size() > header0.size() && wire[header0.size()] == '\n' && wire.compare(0, header0.size(), header0) == 0)
+        writeWire(msg.wire_);
+    else
+        writeWire(wire.data(), wire.size(), header0);
+}
+
+void Publisher::publishBatch(const std::string &msg, const std::string &type)
+{
+    if(skip()) return;
+
+    boost::mutex::scoped_lock lock(batch_mutex_);
+    if(batch_.empty())
+        batch_deadline_ = std::chrono::steady_clock::now() + std::chrono::microseconds(batch_max_delay_usec_);
+    batch_.emplace_back();
+    b0::message::MessagePart &part = batch_.back();
+    part.payload = msg;
+    part.content_type = type;
+    setPartCompression(part);
+    batch_bytes_ += msg.size();
+
+    if((batch_max_count_ && batch_.size() >= batch_max_count_) || (batch_max_bytes_ && batch_bytes_ >= batch_max_bytes_))
+        flushBatch();
+}
+
+void Publisher::setBatchPolicy(size_t max_count, size_t max_bytes, int64_t max_delay_usec)
+{
+    if(max_delay_usec < 0)
+        throw exception::ArgumentError(std::to_string(max_delay_usec), "max_delay_usec");
+
+    boost::mutex::scoped_lock lock(batch_mutex_);
+    batch_max_count_ = max_count;
+    batch_max_bytes_ = max_bytes;
+    batch_max_delay_usec_ = max_delay_usec;
+}
+
+void Publisher::flush()
+{
+    boost::mutex::scoped_lock lock(batch_mutex_);
+    flushBatch();
+}
+
+void Publisher::flushBatch()
+{
+    if(batch_.empty()) return;
+
+    b0::message::MessageEnvelope env;
+    env.header0 = name_;
+    env.headers["Batch"] = std::to_string(batch_.size());
+    env.parts.swap(batch_);
+    batch_.clear();
+    batch_bytes_ = 0;
+    if(async_running_.load())
+    {
+        enqueueAsync(std::move(env));
+        return;
+    }
+    prepareEnvelope(env);
+    writeRaw(env);
+}
+
+bool Publisher::hasPendingMessages() const
+{
+    if(getWriteQueueBytes() > 0)
+        return true;
+
+    // the node does not poll a thread-safe publisher, which is checked here instead,
+    // unless another thread is writing it:
+    if(thread_safe_ && hasCallback())
+    {
+        boost::mutex::scoped_lock lock(write_mutex_, boost::try_to_lock);
+        if(lock.owns_lock() && (getEvents() & ZMQ_POLLIN))
+            return true;
+    }
+
+    boost::mutex::scoped_lock lock(batch_mutex_);
+    return !batch_.empty() && batch_max_delay_usec_ > 0 && std::chrono::steady_clock::now() >= batch_deadline_;
+}
+
+void Publisher::setStampMessages(bool enabled)
+{
+    stamp_messages_ = enabled;
+}
+
+bool Publisher::getStampMessages() const
+{
+    return stamp_messages_;
+}
+
+void Publisher::setSubtopic(const std::string &subtopic)
+{
+    subtopic_ = subtopic;
+}
+
+const std::string & Publisher::getSubtopic() const
+{
+    return subtopic_;
+}
+
+void Publisher::setTimeToLive(int64_t usec)
+{
+    if(usec < 0)
+        throw exception::ArgumentError(std::to_string(usec), "usec");
+    ttl_usec_ = usec;
+}
+
+int64_t Publisher::getTimeToLive() const
+{
+    return ttl_usec_;
+}
+
+void Publisher::setSharedMemory(bool enabled, size_t slot_size, size_t slot_count, size_t min_size)
+{
+    shared_memory_ = enabled;
+    if(slot_size != shm_slot_size_ || slot_count != shm_slot_count_)
+        shm_pool_.reset();
+    shm_slot_size_ = slot_size;
+    shm_slot_count_ = slot_count > 0 ? slot_count : 1;
+    shm_min_size_ = min_size;
+    next_shm_check_ = std::chrono::steady_clock::time_point();
+}
+
+bool Publisher::getSharedMemory() const
+{
+    return shared_memory_;
+}
+
+void Publisher::setLatched(bool enabled)
+{
+    if(enabled == latched_) return;
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setLatched() must be called before init()");
+
+    if(enabled && !delta_method_.empty())
+        throw exception::Exception("latching is not compatible with delta encoding");
+
+    latched_ = enabled;
+    history_max_messages_ = enabled ? 1 : 0;
+    history_max_bytes_ = 0;
+    history_max_age_usec_ = 0;
+    updateSocketType();
+}
+
+bool Publisher::getLatched() const
+{
+    return latched_;
+}
+
+void Publisher::setHistory(size_t max_messages, size_t max_bytes, double max_age)
+{
+    if(max_age < 0)
+        throw exception::ArgumentError(std::to_string(max_age), "max_age");
+
+    setLatched(max_messages > 0);
+    if(max_messages > 0)
+    {
+        history_max_messages_ = max_messages;
+        history_max_bytes_ = max_bytes;
+        history_max_age_usec_ = int64_t(max_age * 1e6);
+    }
+}
+
+size_t Publisher::getHistoryLimit() const
+{
+    return history_max_messages_;
+}
+
+size_t Publisher::getHistorySize()
+{
+    boost::mutex::scoped_lock lock(write_mutex_);
+    return history_.size();
+}
+
+void Publisher::trimHistory(int64_t now_usec)
+{
+    while(history_.size() > 1)
+    {
+        const HistoryEntry &oldest = history_.front();
+        if(history_.size() <= history_max_messages_
+                && (!history_max_bytes_ || history_bytes_ <= history_max_bytes_)
+                && (!history_max_age_usec_ || now_usec - oldest.time_usec <= history_max_age_usec_))
+            break;
+        history_bytes_ -= oldest.bytes;
+        history_.pop_front();
+    }
+}
+
+void Publisher::setDeltaEncoding(const std::string &method, unsigned keyframe_interval)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setDeltaEncoding() must be called before init()");
+    if(!method.empty() && method != "xor" && method != "ranges")
+        throw exception::ArgumentError(method, "delta method");
+    if(!method.empty() && latched_)
+        throw exception::Exception("delta encoding is not compatible with latching");
+    if(!method.empty() && reliable_max_messages_)
+        throw exception::Exception("delta encoding is not compatible with the reliable mode");
+
+    delta_method_ = method;
+    delta_keyframe_interval_ = std::max(1u, keyframe_interval);
+    delta_count_ = 0;
+    delta_base_.clear();
+    updateSocketType();
+}
+
+const std::string & Publisher::getDeltaEncoding() const
+{
+    return delta_method_;
+}
+
+void Publisher::setReliable(size_t max_messages, size_t max_bytes)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setReliable() must be called before init()");
+    if(max_messages && !delta_method_.empty())
+        throw exception::Exception("the reliable mode is not compatible with delta encoding");
+
+    reliable_max_messages_ = max_messages;
+    reliable_max_bytes_ = max_bytes;
+    retransmit_buffer_.clear();
+    retransmit_bytes_ = 0;
+    updateSocketType();
+}
+
+size_t Publisher::getReliable() const
+{
+    return reliable_max_messages_;
+}
+
+uint64_t Publisher::getRetransmittedCount() const
+{
+    return retransmitted_.load();
+}
+
+void Publisher::keepForRetransmission(const b0::message::MessageEnvelope &env)
+{
+    auto it = env.headers.find("Seq");
+    if(it == env.headers.end()) return;
+
+    size_t bytes = 0;
+    for(const b0::message::MessagePart &part : env.parts)
+        bytes += part.payload.size();
+    retransmit_buffer_.push_back(RetransmitEntry{std::stoull(it->second), env, bytes});
+    retransmit_bytes_ += bytes;
+    while(retransmit_buffer_.size() > 1 && (retransmit_buffer_.size() > reliable_max_messages_ || (reliable_max_bytes_ && retransmit_bytes_ > reliable_max_bytes_)))
+    {
+        retransmit_bytes_ -= retransmit_buffer_.front().bytes;
+        retransmit_buffer_.pop_front();
+    }
+}
+
+void Publisher::retransmit()
+{
+    for(auto &range : retransmit_requests_)
+    {
+        auto it = std::lower_bound(retransmit_buffer_.begin(), retransmit_buffer_.end(), range.first, [](const RetransmitEntry &entry, uint64_t seq) {return entry.seq < seq;});
+        size_t count = 0;
+        for(; it != retransmit_buffer_.end() && it->seq <= range.second; ++it, count++)
+        {
+            b0::message::MessageEnvelope env = it->env;
+            env.headers["Retransmitted"] = "1";
+            Socket::writeRaw(env);
+        }
+        retransmitted_.fetch_add(count, std::memory_order_relaxed);
+        trace("Sent again %d of the messages %d to %d", count, range.first, range.second);
+    }
+    retransmit_requests_.clear();
+}
+
+void Publisher::setMulticast(const std::string &address, int rate_kbps)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setMulticast() must be called before init()");
+    if(!address.empty() && !isMulticastAddress(address))
+        throw exception::ArgumentError(address, "address");
+    if(rate_kbps <= 0)
+        throw exception::ArgumentError(std::to_string(rate_kbps), "rate_kbps");
+
+    multicast_addr_ = address;
+    if(!address.empty())
+        setIntOption(ZMQ_RATE, rate_kbps);
+}
+
+std::string Publisher::getMulticast() const
+{
+    return multicast_addr_;
+}
+
+void Publisher::setBackpressure(Backpressure mode)
+{
+    if(mode == backpressure_) return;
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setBackpressure() must be called before init()");
+#ifndef ZMQ_XPUB_NODROP
+    if(mode != Backpressure::Drop)
+        throw exception::Exception("backpressure needs ZeroMQ 4.1 or later");
+#endif
+
+    if(backpressure_ == Backpressure::Count || backpressure_ == Backpressure::Queue)
+        setWriteTimeout(-1);
+    backpressure_ = mode;
+    updateSocketType();
+    if(mode == Backpressure::Count || mode == Backpressure::Queue)
+        setWriteTimeout(0);
+    setCountWriteDrops(mode != Backpressure::Drop);
+    setWriteQueueLimit(mode == Backpressure::Queue ? queue_limit_ : 0);
+}
+
+void Publisher::setQueueLimit(size_t max_bytes)
+{
+    if(max_bytes == 0)
+        throw exception::ArgumentError("0", "max_bytes");
+
+    boost::mutex::scoped_lock lock(write_mutex_);
+    queue_limit_ = max_bytes;
+    if(backpressure_ == Backpressure::Queue)
+        setWriteQueueLimit(max_bytes);
+}
+
+size_t Publisher::getQueueLimit() const
+{
+    return queue_limit_;
+}
+
+size_t Publisher::getQueueBytes() const
+{
+    return getWriteQueueBytes();
+}
+
+void Publisher::setThreadSafe(bool enabled)
+{
+    if(enabled == thread_safe_) return;
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setThreadSafe() must be called before init()");
+
+    thread_safe_ = enabled;
+}
+
+bool Publisher::getThreadSafe() const
+{
+    return thread_safe_;
+}
+
+void Publisher::setSkipUnsubscribed(bool enabled)
+{
+    if(enabled == skip_unsubscribed_) return;
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setSkipUnsubscribed() must be called before init()");
+
+    skip_unsubscribed_ = enabled;
+    updateSocketType();
+}
+
+bool Publisher::getSkipUnsubscribed() const
+{
+    return skip_unsubscribed_;
+}
+
+bool Publisher::hasSubscribers()
+{
+    // a PUB socket does not see the subscriptions, and a multicast group has no subscriptions:
+    if(!hasCallback() || !multicast_addr_.empty())
+        return true;
+
+    if(!intra_process_key_.empty() && Subscriber::hasIntraProcessSubscribers(intra_process_key_))
+        return true;
+
+    // the latched message must be kept, and sent again to the new subscribers, by spinOnce():
+    if(!latched_)
+    {
+        boost::mutex::scoped_lock lock(write_mutex_);
+        readSubscriptions();
+    }
+    return has_subscribers_.load();
+}
+
+uint64_t Publisher::getSkippedCount() const
+{
+    return skipped_.load();
+}
+
+bool Publisher::skip()
+{
+    if(!skip_unsubscribed_ || latched_ || hasSubscribers())
+        return false;
+    skipped_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool Publisher::isReadInBackground() const
+{
+    return thread_safe_;
+}
+
+bool Publisher::lockedWrites() const
+{
+    return hasCallback() || thread_safe_ || async_size_ > 0;
+}
+
+void Publisher::setAsync(size_t queue_size, AsyncOverflow overflow)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setAsync() must be called before init()");
+
+    async_size_ = queue_size;
+    async_overflow_ = overflow;
+}
+
+size_t Publisher::getAsync() const
+{
+    return async_size_;
+}
+
+Publisher::AsyncOverflow Publisher::getAsyncOverflow() const
+{
+    return async_overflow_;
+}
+
+size_t Publisher::getAsyncQueueSize() const
+{
+    boost::mutex::scoped_lock lock(async_mutex_);
+    return async_queue_.size();
+}
+
+Publisher::Backpressure Publisher::getBackpressure() const
+{
+    return backpressure_;
+}
+
+bool Publisher::getCongested() const
+{
+    return getLastWriteDropped() || getWriteQueueBytes() > 0;
+}
+
+uint64_t Publisher::getDroppedCount() const
+{
+    return getCounters().messages_dropped.load();
+}
+
+void Publisher::updateSocketType()
+{
+    // an XPUB socket receives the subscriptions, which spinOnce() reads
+    bool xpub = hasCallback();
+    setSocketType(xpub ? ZMQ_XPUB : ZMQ_PUB);
+    if(!xpub) return;
+    // verbose, to get the repeated subscriptions too
+    setIntOption(ZMQ_XPUB_VERBOSE, latched_ ? 1 : 0);
+#ifdef ZMQ_XPUB_NODROP
+    // fail the send instead of dropping silently when a queue is full
+    setIntOption(ZMQ_XPUB_NODROP, backpressure_ != Backpressure::Drop ? 1 : 0);
+#endif
+}
+
+void Publisher::spinOnce()
+{
+    if(hasPendingMessages())
+        flush();
+
+    if(!hasCallback()) return;
+
+    boost::mutex::scoped_lock lock(write_mutex_);
+    flushWriteQueue();
+
+    bool subscribed = readSubscriptions();
+
+    if(!retransmit_requests_.empty())
+        retransmit();
+
+    if(subscribed && !history_.empty())
+    {
+        trimHistory(node_.timeUSec());
+        trace("New subscriber, sending the last %d messages again", history_.size());
+        for(const HistoryEntry &entry : history_)
+            Socket::writeRaw(entry.env);
+    }
+}
+
+bool Publisher::readSubscriptions()
+{
+    zmq_msg_t msg;
+    zmq_msg_init(&msg);
+    bool subscribed = false;
+    const std::string keyframe_request = Subscriber::keyframeRequestFilter(name_);
+    const std::string retransmit_request = Subscriber::retransmitRequestFilter(name_);
+    while(zmq_msg_recv(&msg, getZMQSocket(), ZMQ_DONTWAIT) >= 0)
+    {
+        // a subscription message is \x01 followed by the topic filter, \x00 for an unsubscription
+        const char *data = static_cast<const char*>(zmq_msg_data(&msg));
+        size_t size = zmq_msg_size(&msg);
+        if(size == 0 || (data[0] != 0 && data[0] != 1)) continue;
+        boost::string_ref filter(data + 1, size - 1);
+        if(size > 1 && data[1] == keyframe_request[0])
+        {
+            // a keyframe request (see setDeltaEncoding()), maybe for another topic
+            if(data[0] == 1 && filter.starts_with(keyframe_request))
+                delta_keyframe_requested_ = true;
+            // a retransmission request (see setReliable()): "<publisher> <first seq> <last seq> <unique id>"
+            if(data[0] == 1 && reliable_max_messages_ && filter.starts_with(retransmit_request))
+            {
+                std::istringstream request(filter.substr(retransmit_request.size()).to_string());
+                std::string publisher;
+                uint64_t first, last;
+                if(request >> publisher >> first >> last && publisher == publisher_id_ && first <= last)
+                    retransmit_requests_.emplace_back(first, last);
+            }
+            continue;
+        }
+        // the proxy forwards the subscriptions to all the topics:
+        const std::string header0 = name_ + "\n";
+        if(!boost::string_ref(header0).starts_with(filter) && !filter.starts_with(name_ + "/"))
+            continue;
+        if(data[0] == 1)
+        {
+            subscriptions_.insert(filter.to_string());
+            subscribed = true;
+        }
+        else subscriptions_.erase(filter.to_string());
+    }
+    zmq_msg_close(&msg);
+    has_subscribers_.store(!subscriptions_.empty());
+
+    if(subscribed && !delta_method_.empty())
+        delta_keyframe_requested_ = true;
+
+    return subscribed;
+}
+
+bool Publisher::hasCallback() const
+{
+    return latched_ || backpressure_ != Backpressure::Drop || !delta_method_.empty() || skip_unsubscribed_ || reliable_max_messages_;
+}
+
+void Publisher::prepareEnvelope(b0::message::MessageEnvelope &env)
+{
+    if(!subtopic_.empty() && env.header0 == name_)
+        env.header0 = name_ + "/" + subtopic_;
+
+    tracing::Span span;
+    if(tracing::startSpan(span, tracing::SpanKind::Producer, *this))
+    {
+        tracing::inject(env.headers, span);
+        tracing::endSpan(span);
+    }
+
+    if(ttl_usec_ > 0)
+        env.headers["Expires"] = std::to_string(node_.timeUSec() + ttl_usec_);
+
+    // latched and retransmitted messages need the Seq and Publisher headers to be recognized when sent again,
+    // and deltas to be matched with the message they apply to
+    if(!stamp_messages_ && !latched_ && delta_method_.empty() && !reliable_max_messages_) return;
+
+    uint64_t seq = ++seq_;
+    env.headers["Send-time"] = std::to_string(node_.timeUSec());
+    env.headers["Seq"] = std::to_string(seq);
+    env.headers["Publisher"] = publisher_id_;
+    if(latched_)
+        env.headers["Latched"] = "1";
+    if(!delta_method_.empty())
+        encodeDelta(env, seq);
+}
+
+void Publisher::encodeDelta(b0::message::MessageEnvelope &env, uint64_t seq)
+{
+    std::vector<b0::message::MessagePart> &parts = env.parts;
+    bool keyframe = delta_keyframe_requested_.exchange(false) || delta_count_ == 0 || delta_count_ >= delta_keyframe_interval_ || parts.size() != delta_base_.size();
+    std::vector<std::string> &deltas = delta_scratch_;
+    deltas.resize(parts.size());
+    for(size_t i = 0; i < parts.size() && !keyframe; i++)
+        keyframe = !compress::encodeDelta(delta_method_, delta_base_[i], parts[i].payload.data(), parts[i].payload.size(), deltas[i]);
+
+    if(keyframe)
+    {
+        delta_base_.resize(parts.size());
+        for(size_t i = 0; i < parts.size(); i++)
+            delta_base_[i] = parts[i].payload;
+        env.headers["Keyframe"] = "1";
+        delta_count_ = 1;
+    }
+    else
+    {
+        // the payload becomes the base, and the delta is sent in its place:
+        for(size_t i = 0; i < parts.size(); i++)
+        {
+            delta_base_[i].swap(parts[i].payload);
+            parts[i].payload.swap(deltas[i]);
+        }
+        env.headers["Delta"] = delta_method_;
+        env.headers["Delta-base"] = std::to_string(delta_base_seq_);
+        delta_count_++;
+    }
+    delta_base_seq_ = seq;
+}
+
+void Publisher::writeRaw(const b0::message::MessageEnvelope &env)
+{
+    if(thread_safe_ && !node_.isNodeThread() && canWriteThreadSocket(env) && writeThreadSocket(env))
+        return;
+
+    boost::mutex::scoped_lock lock(write_mutex_, boost::defer_lock);
+    if(lockedWrites())
+        lock.lock();
+    if(latched_)
+    {
+        size_t bytes = 0;
+        for(const b0::message::MessagePart &part : env.parts)
+            bytes += part.payload.size();
+        int64_t now = node_.timeUSec();
+        history_.push_back(HistoryEntry{env, bytes, now});
+        history_bytes_ += bytes;
+        trimHistory(now);
+    }
+    if(reliable_max_messages_)
+        keepForRetransmission(env);
+
+    // the subscribers of this process receive the topic itself (see setSubtopic()):
+    if(intra_process_key_.empty() || env.header0 != name_ || !Subscriber::hasIntraProcessSubscribers(intra_process_key_))
+    {
+        if(!writeSharedMemory(env))
+            Socket::writeRaw(env);
+        return;
+    }
+
+    // hand over a copy to the subscribers of this process, and mark the message so
+    // that they will discard it when it comes back from the proxy:
+    std::shared_ptr<b0::message::MessageEnvelope> local_env = std::make_shared<b0::message::MessageEnvelope>(env);
+    local_env->headers["Source-process"] = Subscriber::intraProcessSource(node_);
+    Subscriber::publishIntraProcess(intra_process_key_, local_env);
+    if(!writeSharedMemory(*local_env))
+        Socket::writeRaw(*local_env);
+}
+
+bool Publisher::canWriteFrameInPlace(size_t payload_size) const
+{
+    // writeRaw() keeps the history of a latched publisher, and serializes the
+    // writes with the reads of spinOnce() and with the other threads
+    if(lockedWrites())
+        return false;
+    if(shared_memory_ && shm_subscribers_local_ && payload_size >= shm_min_size_)
+        return false;
+    return intra_process_key_.empty() || !Subscriber::hasIntraProcessSubscribers(intra_process_key_);
+}
+
+bool Publisher::canWriteThreadSocket(const b0::message::MessageEnvelope &env) const
+{
+    // only a publisher connected to the proxy can have more sockets sending on its behalf:
+    if(!bind_addr_.empty() || !multicast_addr_.empty() || hasCallback())
+        return false;
+    if(shared_memory_)
+        return false;
+    return intra_process_key_.empty() || !Subscriber::hasIntraProcessSubscribers(intra_process_key_);
+}
+
+bool Publisher::writeThreadSocket(const b0::message::MessageEnvelope &env)
+{
+    boost::thread::id id = boost::this_thread::get_id();
+    ThreadSocket *ts = nullptr;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(thread_sockets_mutex_);
+        auto it = thread_sockets_.find(id);
+        if(it != thread_sockets_.end())
+            ts = it->second.get();
+    }
+    if(!ts)
+    {
+        std::unique_ptr<ThreadSocket> new_ts(new ThreadSocket(*reinterpret_cast<zmq::context_t*>(node_.getContext())));
+        {
+            // the options of the publisher's socket are read while the node's thread does not write to it
+            boost::mutex::scoped_lock lock(write_mutex_);
+            new_ts->socket_.setsockopt<int>(ZMQ_LINGER, getLingerPeriod());
+            new_ts->socket_.setsockopt<int>(ZMQ_SNDHWM, getWriteHWM());
+        }
+        new_ts->socket_.connect(remote_addr_);
+        ts = new_ts.get();
+        boost::unique_lock<boost::shared_mutex> lock(thread_sockets_mutex_);
+        thread_sockets_[id] = std::move(new_ts);
+    }
+
+    ts->serializer_.setChecksum(getChecksum());
+    size_t wire_bytes = ts->serializer_.prepare(env, getEnvelopeFormat(), &ts->compression_context_);
+    // splitting into chunks needs the chunk sequence of the publisher's socket:
+    if(getChunkSize() && wire_bytes > getChunkSize())
+        return false;
+    zmq::message_t msg_payload(wire_bytes);
+    ts->serializer_.write(static_cast<char*>(msg_payload.data()));
+    dumpPayload("send", static_cast<const char*>(msg_payload.data()), wire_bytes);
+    if(!ts->socket_.send(msg_payload))
+        throw exception::SocketWriteError();
+
+    size_t payload_bytes = 0;
+    for(auto &part : env.parts) payload_bytes += part.payload.size();
+    getCounters().messageSent(wire_bytes, payload_bytes);
+    return true;
+}
+
+bool Publisher::writeSharedMemory(const b0::message::MessageEnvelope &env)
+{
+    if(!shared_memory_) return false;
+
+    size_t payload_bytes = 0;
+    for(auto &part : env.parts) payload_bytes += part.payload.size();
+    if(payload_bytes < shm_min_size_) return false;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(now >= next_shm_check_)
+    {
+        next_shm_check_ = now + std::chrono::seconds{2};
+        shm_subscribers_local_ = subscribersAreLocal();
+    }
+    if(!shm_subscribers_local_) return false;
+
+    if(!shm_pool_)
+    {
+        try
+        {
+            shm_pool_.reset(new shm::Pool(node_.hostname(), shm_slot_size_, shm_slot_count_));
+        }
+        catch(std::exception &ex)
+        {
+            error("Cannot create shared-memory segment: %s", ex.what());
+            shared_memory_ = false;
+            return false;
+        }
+    }
+
+    shm_serializer_.setChecksum(getChecksum());
+    size_t wire_bytes = shm_serializer_.prepare(env, getEnvelopeFormat());
+    shm::Descriptor desc;
+    char *dst = shm_pool_->acquire(wire_bytes, desc);
+    if(!dst) return false;
+    shm_serializer_.write(dst);
+    shm_pool_->commit(desc);
+
+    shm::serializeDescriptor(env.header0, desc, shm_frame_);
+    writeControlFrame(shm_frame_, payload_bytes);
+    return true;
+}
+
+bool Publisher::subscribersAreLocal()
+{
+    b0::message::graph::Graph graph;
+    try
+    {
+        node_.getGraph(graph);
+    }
+    catch(exception::Exception &ex)
+    {
+        warn("Cannot get the graph: %s", ex.what());
+        return false;
+    }
+
+    std::map<std::string, std::string> host_by_node;
+    for(auto &node : graph.nodes)
+        host_by_node[node.node_name] = node.host_id;
+
+    std::string host = node_.hostname();
+    bool any = false;
+    for(auto &link : graph.node_topic)
+    {
+        if(!link.reversed || link.other_name != name_) continue;
+        if(host_by_node[link.node_name] != host) return false;
+        any = true;
+    }
+    return any;
 }
 
 void Publisher::connect()
@@ -64,6 +1101,20 @@ void Publisher::connect()
     Socket::connect(remote_addr_);
 }
 
+void Publisher::bind()
+{
+    boost::format fmt("tcp://%s:%d");
+    std::string host = node_.hostname();
+    int port = bindEphemeralPort();
+    bind_addr_ = (fmt % "*" % port).str();
+    std::string addr = (fmt % host % port).str();
+    debug("Bound to %s", bind_addr_);
+    std::string ipc_addr = bindIPC(port);
+
+    trace("Announcing %s to resolver...", addr);
+    node_.announceTopic(name_, addr, ipc_addr);
+}
+
 void Publisher::disconnect()
 {
     trace("Disconnecting from %s...", remote_addr_);
@@ -1,10 +1,20 @@
 #include <b0/resolver/client.h>
+#include <b0/resolver/discovery.h>
+#include <b0/process_agent.h>
 #include <b0/message/resolv/request.h>
 #include <b0/message/resolv/response.h>
 #include <b0/node.h>
 #include <b0/exceptions.h>
 #include <b0/utils/env.h>
 
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <set>
+#include <boost/algorithm/string.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include <zmq.hpp>
 
 namespace b0
@@ -15,17 +25,109 @@ namespace resolver
 
 Client::Client(b0::Node *node)
     : ServiceClient(node, "resolv", false, false),
-      announce_timeout_(-1)
+      announce_timeout_(-1),
+      ephemeral_(b0::env::getBool("B0_EPHEMERAL_NODE"))
 {
     if(!node)
         throw exception::Exception("node cannot be null");
 
-    std::string resolver_addr = b0::env::get("B0_RESOLVER", "tcp://localhost:22000");
-    setRemoteAddress(resolver_addr);
+    setResolverAddress(b0::env::get("B0_RESOLVER", "tcp://localhost:22000"));
+}
+
+static boost::mutex failover_mutex;
+
+//! The resolver in use by this process, by list of resolver addresses
+static std::map<std::string, std::string> active_resolver;
+
+//! True if there is no resolver, and the names are resolved by b0::resolver::Discovery
+static bool decentralized()
+{
+    return Global::getInstance().getDecentralized();
+}
+
+void Client::setResolverAddress(const std::string &addrs)
+{
+    resolver_addrs_.clear();
+    boost::split(resolver_addrs_, addrs, boost::is_any_of(","));
+    for(auto &addr : resolver_addrs_)
+        boost::trim(addr);
+    resolver_addrs_.erase(std::remove(resolver_addrs_.begin(), resolver_addrs_.end(), ""), resolver_addrs_.end());
+    if(resolver_addrs_.empty())
+        throw exception::ArgumentError(addrs, "resolver address");
+    resolver_addrs_key_ = boost::algorithm::join(resolver_addrs_, ",");
+
+    // without a read timeout a dead resolver would not be noticed
+    if(resolver_addrs_.size() > 1 && getReadTimeout() < 0)
+        setReadTimeout(b0::env::getInt("B0_RESOLVER_FAILOVER_TIMEOUT", 2000));
+
+    setRemoteAddress(activeResolver());
+}
+
+std::string Client::activeResolver() const
+{
+    boost::mutex::scoped_lock lock(failover_mutex);
+    auto it = active_resolver.find(resolver_addrs_key_);
+    return it == active_resolver.end() ? resolver_addrs_[0] : it->second;
+}
+
+std::string Client::failover(const std::string &failed_addr)
+{
+    boost::mutex::scoped_lock lock(failover_mutex);
+    std::string &active = active_resolver[resolver_addrs_key_];
+    if(active.empty()) active = resolver_addrs_[0];
+    // another client of this process may have failed over already
+    if(active == failed_addr)
+    {
+        auto it = std::find(resolver_addrs_.begin(), resolver_addrs_.end(), failed_addr);
+        size_t i = it == resolver_addrs_.end() ? 0 : (it - resolver_addrs_.begin() + 1) % resolver_addrs_.size();
+        active = resolver_addrs_[i];
+    }
+    return active;
+}
+
+void Client::switchResolver(const std::string &addr)
+{
+    if(addr == remote_addr_) return;
+    disconnect();
+    remote_addr_ = addr;
+    remote_addrs_.assign(1, addr);
+    connect();
+}
+
+void Client::callResolver(const b0::message::resolv::Request &rq, b0::message::resolv::Response &rsp)
+{
+    if(agent_)
+    {
+        agent_->callResolver(rq, rsp, getReadTimeout());
+        return;
+    }
+
+    if(resolver_addrs_.size() < 2)
+    {
+        call(rq, rsp);
+        return;
+    }
+
+    // follow the failovers done by the other clients of this process
+    switchResolver(activeResolver());
+    std::string addr = remote_addr_;
+    try
+    {
+        call(rq, rsp);
+    }
+    catch(exception::SocketReadError &ex)
+    {
+        std::string next = failover(addr);
+        warn("Resolver %s is not responding, switching to %s", addr, next);
+        switchResolver(next);
+        call(rq, rsp);
+    }
 }
 
 Client::~Client()
 {
+    if(heartbeat_pub_)
+        heartbeat_pub_->cleanup();
 }
 
 void Client::setAnnounceTimeout(int timeout)
@@ -33,10 +135,63 @@ void Client::setAnnounceTimeout(int timeout)
     announce_timeout_ = timeout;
 }
 
+void Client::setProcessAgent(std::shared_ptr<ProcessAgent> agent)
+{
+    agent_ = agent;
+}
+
+void Client::init()
+{
+    if(agent_) return;
+
+    ServiceClient::init();
+}
+
+void Client::cleanup()
+{
+    if(agent_) return;
+
+    ServiceClient::cleanup();
+}
+
+void Client::setEphemeral(bool enabled)
+{
+    ephemeral_ = enabled;
+}
+
+bool Client::getEphemeral() const
+{
+    return ephemeral_;
+}
+
 void Client::announceNode(const std::string &host_id, int process_id, std::string &node_name, std::string &xpub_sock_addr, std::string &xsub_sock_addr, int64_t &minimum_heartbeat_interval)
 {
+    std::vector<std::string> xpub_sock_addrs, xsub_sock_addrs;
+    std::map<std::string, int> topic_proxy;
+    announceNode(host_id, process_id, node_name, xpub_sock_addrs, xsub_sock_addrs, topic_proxy, minimum_heartbeat_interval);
+    xpub_sock_addr = xpub_sock_addrs.at(0);
+    xsub_sock_addr = xsub_sock_addrs.at(0);
+}
+
+void Client::announceNode(const std::string &host_id, int process_id, std::string &node_name, std::vector<std::string> &xpub_sock_addrs, std::vector<std::string> &xsub_sock_addrs, std::map<std::string, int> &topic_proxy, int64_t &minimum_heartbeat_interval)
+{
+    if(decentralized())
+    {
+        // the name is kept as is, and there is no proxy nor heartbeat
+        Discovery::getInstance().addNode(host_id, process_id, node_name);
+        xpub_sock_addrs.assign(1, "");
+        xsub_sock_addrs.assign(1, "");
+        topic_proxy.clear();
+        xpub_priority_sock_addrs_.clear();
+        xsub_priority_sock_addrs_.clear();
+        minimum_heartbeat_interval = 0;
+        return;
+    }
+
     int old_timeout = getReadTimeout();
-    setReadTimeout(announce_timeout_);
+    // with more than one resolver, the read timeout is needed for the failover
+    if(announce_timeout_ >= 0 || resolver_addrs_.size() < 2)
+        setReadTimeout(announce_timeout_);
 
     trace("Announcing node '%s' to resolver...", node_name);
     b0::message::resolv::Request rq0;
@@ -45,12 +200,13 @@ void Client::announceNode(const std::string &host_id, int process_id, std::strin
     rq.host_id = host_id;
     rq.process_id = process_id;
     rq.node_name = node_name;
+    rq.ephemeral = ephemeral_;
 
     b0::message::resolv::Response rsp0;
     rsp0.announce_node.emplace();
     b0::message::resolv::AnnounceNodeResponse &rsp = *rsp0.announce_node;
     trace("Waiting for response from resolver...");
-    call(rq0, rsp0);
+    callResolver(rq0, rsp0);
 
     setReadTimeout(old_timeout);
 
@@ -63,17 +219,55 @@ void Client::announceNode(const std::string &host_id, int process_id, std::strin
     }
     node_name = rsp.node_name;
 
-    xpub_sock_addr = rsp.xpub_sock_addr;
-    trace("Proxy's XPUB socket address: %s", xpub_sock_addr);
+    // resolvers running a single proxy may not send the lists of addresses:
+    if(rsp.xpub_sock_addrs.empty() || rsp.xsub_sock_addrs.size() != rsp.xpub_sock_addrs.size())
+    {
+        rsp.xpub_sock_addrs.assign(1, rsp.xpub_sock_addr);
+        rsp.xsub_sock_addrs.assign(1, rsp.xsub_sock_addr);
+    }
+
+    xpub_sock_addrs = rsp.xpub_sock_addrs;
+    xsub_sock_addrs = rsp.xsub_sock_addrs;
+    preferIPC(xpub_sock_addrs, rsp.xpub_ipc_addrs);
+    preferIPC(xsub_sock_addrs, rsp.xsub_ipc_addrs);
+    for(size_t i = 0; i < xpub_sock_addrs.size(); i++)
+    {
+        trace("Proxy %d's XPUB socket address: %s", i, xpub_sock_addrs[i]);
+        trace("Proxy %d's XSUB socket address: %s", i, xsub_sock_addrs[i]);
+    }
+
+    topic_proxy.clear();
+    for(auto &x : rsp.topic_proxies)
+    {
+        if(x.proxy >= 0 && x.proxy < int(xpub_sock_addrs.size()))
+            topic_proxy[x.topic_name] = x.proxy;
+    }
 
-    xsub_sock_addr = rsp.xsub_sock_addr;
-    trace("Proxy's XSUB socket address: %s", xsub_sock_addr);
+    xpub_priority_sock_addrs_.clear();
+    xsub_priority_sock_addrs_.clear();
+    if(rsp.xsub_priority_sock_addrs.size() == rsp.xpub_priority_sock_addrs.size())
+    {
+        xpub_priority_sock_addrs_ = rsp.xpub_priority_sock_addrs;
+        xsub_priority_sock_addrs_ = rsp.xsub_priority_sock_addrs;
+        preferIPC(xpub_priority_sock_addrs_, rsp.xpub_priority_ipc_addrs);
+        preferIPC(xsub_priority_sock_addrs_, rsp.xsub_priority_ipc_addrs);
+    }
 
-    minimum_heartbeat_interval = rsp.minimum_heartbeat_interval;
+    // an ephemeral node is not tracked by the resolver, hence needs no heartbeat:
+    minimum_heartbeat_interval = ephemeral_ ? 0 : rsp.minimum_heartbeat_interval;
+    heartbeat_topic_ = rsp.heartbeat_topic;
 }
 
 void Client::notifyShutdown()
 {
+    if(decentralized())
+    {
+        Discovery::getInstance().removeNode(node_.getName());
+        return;
+    }
+
+    if(ephemeral_) return;
+
     b0::message::resolv::Request rq0;
     rq0.shutdown_node.emplace();
     b0::message::resolv::ShutdownNodeRequest &rq = *rq0.shutdown_node;
@@ -82,7 +276,7 @@ void Client::notifyShutdown()
     b0::message::resolv::Response rsp0;
     rsp0.shutdown_node.emplace();
     b0::message::resolv::ShutdownNodeResponse &rsp = *rsp0.shutdown_node;
-    call(rq0, rsp0);
+    callResolver(rq0, rsp0);
 
     if(!rsp.ok)
         throw exception::Exception("notifyShutdown failed");
@@ -90,16 +284,46 @@ void Client::notifyShutdown()
 
 void Client::sendHeartbeat(int64_t *time_usec)
 {
+    sendHeartbeat(time_usec, {});
+}
+
+void Client::sendHeartbeat(int64_t *time_usec, const std::vector<std::string> &other_node_names, const std::vector<b0::message::graph::NodeStats> &stats, int64_t *delay_usec)
+{
+    if(decentralized())
+    {
+        if(time_usec) *time_usec = node_.hardwareTimeUSec();
+        if(delay_usec) *delay_usec = 0;
+        return;
+    }
+
     b0::message::resolv::Request rq0;
     rq0.heartbeat.emplace();
     b0::message::resolv::HeartbeatRequest &rq = *rq0.heartbeat;
-    rq.node_name = node_.getName();
+    if(ephemeral_)
+    {
+        if(other_node_names.empty())
+            throw exception::Exception("An ephemeral node cannot send heartbeats of its own");
+        rq.node_name = other_node_names[0];
+        rq.other_node_names.assign(other_node_names.begin() + 1, other_node_names.end());
+    }
+    else
+    {
+        rq.node_name = node_.getName();
+        rq.other_node_names = other_node_names;
+    }
+    rq.stats = stats;
+
+    if(heartbeat_pub_ && !time_usec)
+    {
+        heartbeat_pub_->publish(rq);
+        return;
+    }
     int64_t sendTime = node_.hardwareTimeUSec();
 
     b0::message::resolv::Response rsp0;
     rsp0.heartbeat.emplace();
     b0::message::resolv::HeartbeatResponse &rsp = *rsp0.heartbeat;
-    call(rq0, rsp0);
+    callResolver(rq0, rsp0);
 
     if(!rsp.ok)
         throw exception::Exception("sendHeartbeat failed");
@@ -109,11 +333,101 @@ void Client::sendHeartbeat(int64_t *time_usec)
         int64_t recvTime = node_.hardwareTimeUSec();
         int64_t rtt = recvTime - sendTime;
         *time_usec = rsp.time_usec + rtt / 2;
+        if(delay_usec) *delay_usec = rtt;
     }
 }
 
+std::string Client::getHeartbeatTopic() const
+{
+    return heartbeat_topic_;
+}
+
+std::vector<std::string> Client::getPriorityXPUBSocketAddresses() const
+{
+    return xpub_priority_sock_addrs_;
+}
+
+std::vector<std::string> Client::getPriorityXSUBSocketAddresses() const
+{
+    return xsub_priority_sock_addrs_;
+}
+
+void Client::openHeartbeatChannel(const std::string &topic)
+{
+    if(topic.empty() || resolver_addrs_.size() > 1) return;
+
+    heartbeat_pub_.reset(new b0::Publisher(&node_, topic, false, false));
+    // always through the proxy (also in peer-to-peer mode), which the resolver subscribes to
+    heartbeat_pub_->setRemoteAddress(node_.getXSUBSocketAddress(topic));
+    heartbeat_pub_->setMessageCodec(b0::message::MessageCodec::MsgPack);
+    heartbeat_pub_->init();
+}
+
+bool Client::hasHeartbeatChannel() const
+{
+    return bool(heartbeat_pub_);
+}
+
+void Client::beginAnnounceBatch()
+{
+    // the announcements are only local
+    if(decentralized()) return;
+
+    if(!batch_)
+        batch_.reset(new b0::message::resolv::AnnounceSocketsRequest);
+}
+
+void Client::endAnnounceBatch()
+{
+    flushAnnounceBatch();
+    batch_.reset();
+}
+
+void Client::flushAnnounceBatch()
+{
+    if(!batch_ || (batch_->services.empty() && batch_->topics.empty() && batch_->node_topics.empty() && batch_->node_services.empty()))
+        return;
+
+    // take the batch out first, so that the fallback below sends the requests one by one
+    std::unique_ptr<b0::message::resolv::AnnounceSocketsRequest> batch(new b0::message::resolv::AnnounceSocketsRequest);
+    batch.swap(batch_);
+
+    b0::message::resolv::Request rq0;
+    rq0.announce_sockets.emplace(*batch);
+    rq0.announce_sockets->node_name = node_.getName();
+
+    b0::message::resolv::Response rsp0;
+    callResolver(rq0, rsp0);
+
+    if(!rsp0.announce_sockets)
+    {
+        // a resolver of an older version
+        debug("Resolver does not handle AnnounceSocketsRequest, sending the announcements one by one");
+        std::unique_ptr<b0::message::resolv::AnnounceSocketsRequest> collecting;
+        collecting.swap(batch_);
+        // the order of the resolver's handler
+        for(auto &rq : batch->services) announceService(rq.service_name, rq.sock_addr, rq.ipc_addr);
+        for(auto &rq : batch->topics) announceTopic(rq.topic_name, rq.sock_addr, rq.ipc_addr);
+        for(auto &rq : batch->node_topics) notifyTopic(rq.topic_name, rq.reverse, rq.active);
+        for(auto &rq : batch->node_services) notifyService(rq.service_name, rq.reverse, rq.active);
+        collecting.swap(batch_);
+        return;
+    }
+
+    if(!rsp0.announce_sockets->ok)
+        throw exception::Exception("announce failed for: " + boost::algorithm::join(rsp0.announce_sockets->failed, ", "));
+}
+
 void Client::notifyTopic(std::string topic_name, bool reverse, bool active)
 {
+    if(decentralized())
+    {
+        Discovery::getInstance().notifyTopic(node_.getName(), topic_name, reverse, active);
+        return;
+    }
+
+    if(ephemeral_) return;
+
     b0::message::resolv::Request rq0;
     rq0.node_topic.emplace();
     b0::message::graph::NodeTopicRequest &rq = *rq0.node_topic;
@@ -122,14 +436,28 @@ void Client::notifyTopic(std::string topic_name, bool reverse, bool active)
     rq.reverse = reverse;
     rq.active = active;
 
+    if(batch_)
+    {
+        batch_->node_topics.push_back(rq);
+        return;
+    }
+
     b0::message::resolv::Response rsp0;
     rsp0.node_topic.emplace();
     b0::message::graph::NodeTopicResponse &rsp = *rsp0.node_topic;
-    call(rq0, rsp0);
+    callResolver(rq0, rsp0);
 }
 
 void Client::notifyService(std::string service_name, bool reverse, bool active)
 {
+    if(decentralized())
+    {
+        Discovery::getInstance().notifyService(node_.getName(), service_name, reverse, active);
+        return;
+    }
+
+    if(ephemeral_) return;
+
     b0::message::resolv::Request rq0;
     rq0.node_service.emplace();
     b0::message::graph::NodeServiceRequest &rq = *rq0.node_service;
@@ -138,25 +466,47 @@ void Client::notifyService(std::string service_name, bool reverse, bool active)
     rq.reverse = reverse;
     rq.active = active;
 
+    if(batch_)
+    {
+        batch_->node_services.push_back(rq);
+        return;
+    }
+
     b0::message::resolv::Response rsp0;
     rsp0.node_service.emplace();
     b0::message::graph::NodeServiceResponse &rsp = *rsp0.node_service;
-    call(rq0, rsp0);
+    callResolver(rq0, rsp0);
 }
 
-void Client::announceService(std::string name, std::string addr)
+void Client::announceService(std::string name, std::string addr, std::string ipc_addr)
 {
+    if(decentralized())
+    {
+        Discovery::getInstance().announceService(node_.getName(), name, addr);
+        return;
+    }
+
+    if(ephemeral_)
+        throw exception::Exception("An ephemeral node cannot announce services");
+
     b0::message::resolv::Request rq0;
     rq0.announce_service.emplace();
     b0::message::resolv::AnnounceServiceRequest &rq = *rq0.announce_service;
     rq.node_name = node_.getName();
     rq.service_name = name;
     rq.sock_addr = addr;
+    rq.ipc_addr = ipc_addr;
+
+    if(batch_)
+    {
+        batch_->services.push_back(rq);
+        return;
+    }
 
     b0::message::resolv::Response rsp0;
     rsp0.announce_service.emplace();
     b0::message::resolv::AnnounceServiceResponse &rsp = *rsp0.announce_service;
-    call(rq0, rsp0);
+    callResolver(rq0, rsp0);
 
     if(!rsp.ok)
         throw exception::Exception("announceService failed");
@@ -164,6 +514,75 @@ void Client::announceService(std::string name, std::string addr)
 
 void Client::resolveService(std::string name, std::string &addr)
 {
+    std::vector<std::string> addrs;
+    resolveService(name, addrs);
+    addr = addrs[0];
+}
+
+//! An entry of the service resolution cache
+struct ServiceCacheEntry
+{
+    std::vector<std::string> addrs;
+    std::chrono::steady_clock::time_point time;
+};
+
+//! Age after which a cached resolution is resolved again, should an invalidation be missed
+static const std::chrono::seconds service_cache_max_age{30};
+
+static boost::mutex service_cache_mutex;
+
+//! Cached resolutions, by resolver address and service name
+static std::map<std::pair<std::string, std::string>, ServiceCacheEntry> service_cache;
+
+//! The version of the last graph delta seen
+static int64_t service_cache_version = 0;
+
+void Client::clearServiceCache()
+{
+    boost::mutex::scoped_lock lock(service_cache_mutex);
+    service_cache.clear();
+}
+
+void Client::updateServiceCache(const b0::message::graph::GraphDelta &delta)
+{
+    boost::mutex::scoped_lock lock(service_cache_mutex);
+
+    // a missed delta (or the first one) could hide a change of the services
+    bool changed = delta.version != service_cache_version + 1;
+    for(auto &link : delta.node_service_added)
+        if(!link.reversed) changed = true;
+    for(auto &link : delta.node_service_removed)
+        if(!link.reversed) changed = true;
+    if(changed)
+        service_cache.clear();
+    service_cache_version = delta.version;
+}
+
+void Client::resolveService(std::string name, std::vector<std::string> &addrs)
+{
+    if(decentralized())
+    {
+        if(!Discovery::getInstance().resolveService(name, addrs))
+            throw exception::NameResolutionError(name);
+        return;
+    }
+
+    // the service may be among the announcements not sent yet
+    flushAnnounceBatch();
+
+    bool use_cache = Global::getInstance().getServiceCache();
+    auto key = std::make_pair(remote_addr_, name);
+    if(use_cache)
+    {
+        boost::mutex::scoped_lock lock(service_cache_mutex);
+        auto it = service_cache.find(key);
+        if(it != service_cache.end() && std::chrono::steady_clock::now() - it->second.time < service_cache_max_age)
+        {
+            addrs = it->second.addrs;
+            return;
+        }
+    }
+
     b0::message::resolv::Request rq0;
     rq0.resolve_service.emplace();
     b0::message::resolv::ResolveServiceRequest &rq = *rq0.resolve_service;
@@ -172,29 +591,305 @@ void Client::resolveService(std::string name, std::string &addr)
     b0::message::resolv::Response rsp0;
     rsp0.resolve_service.emplace();
     b0::message::resolv::ResolveServiceResponse &rsp = *rsp0.resolve_service;
-    call(rq0, rsp0);
+    callResolver(rq0, rsp0);
 
     if(!rsp.ok)
         throw exception::NameResolutionError(name);
 
-    addr = rsp.sock_addr;
+    // a resolver of an older version only returns one address
+    addrs = rsp.sock_addrs;
+    if(addrs.empty())
+        addrs.push_back(rsp.sock_addr);
+    preferIPC(addrs, rsp.ipc_addrs);
+
+    if(use_cache)
+    {
+        boost::mutex::scoped_lock lock(service_cache_mutex);
+        ServiceCacheEntry &entry = service_cache[key];
+        entry.addrs = addrs;
+        entry.time = std::chrono::steady_clock::now();
+    }
+}
+
+void Client::announceTopic(std::string name, std::string addr, std::string ipc_addr)
+{
+    if(decentralized())
+    {
+        Discovery::getInstance().announceTopic(node_.getName(), name, addr);
+        return;
+    }
+
+    if(ephemeral_)
+        throw exception::Exception("An ephemeral node cannot announce topics");
+
+    b0::message::resolv::Request rq0;
+    rq0.announce_topic.emplace();
+    b0::message::resolv::AnnounceTopicRequest &rq = *rq0.announce_topic;
+    rq.node_name = node_.getName();
+    rq.topic_name = name;
+    rq.sock_addr = addr;
+    rq.ipc_addr = ipc_addr;
+
+    if(batch_)
+    {
+        batch_->topics.push_back(rq);
+        return;
+    }
+
+    b0::message::resolv::Response rsp0;
+    rsp0.announce_topic.emplace();
+    b0::message::resolv::AnnounceTopicResponse &rsp = *rsp0.announce_topic;
+    rsp.ok = false;
+    callResolver(rq0, rsp0);
+
+    if(!rsp0.announce_topic || !rsp0.announce_topic->ok)
+        throw exception::Exception("announceTopic failed");
+}
+
+void Client::resolveTopic(std::string name, std::vector<std::string> &addrs)
+{
+    if(decentralized())
+    {
+        Discovery::getInstance().resolveTopic(name, addrs);
+        return;
+    }
+
+    flushAnnounceBatch();
+
+    b0::message::resolv::Request rq0;
+    rq0.resolve_topic.emplace();
+    b0::message::resolv::ResolveTopicRequest &rq = *rq0.resolve_topic;
+    rq.topic_name = name;
+
+    b0::message::resolv::Response rsp0;
+    rsp0.resolve_topic.emplace();
+    b0::message::resolv::ResolveTopicResponse &rsp = *rsp0.resolve_topic;
+    rsp.ok = false;
+    callResolver(rq0, rsp0);
+
+    if(!rsp0.resolve_topic || !rsp0.resolve_topic->ok)
+        throw exception::NameResolutionError(name);
+
+    addrs = rsp0.resolve_topic->sock_addr;
+    preferIPC(addrs, rsp0.resolve_topic->ipc_addrs);
+}
+
+void Client::preferIPC(std::vector<std::string> &addrs, const std::vector<std::string> &ipc_addrs) const
+{
+    if(!Global::getInstance().getIPC() || ipc_addrs.size() != addrs.size()) return;
+
+    // a TCP address is "tcp://<hostname>:<port>", with the hostname() of the node which bound it
+    std::string prefix = "tcp://" + node_.hostname() + ":";
+    for(size_t i = 0; i < addrs.size(); i++)
+    {
+        if(ipc_addrs[i].empty() || !boost::algorithm::starts_with(addrs[i], prefix)) continue;
+        trace("Using %s instead of %s (same host)", ipc_addrs[i], addrs[i]);
+        addrs[i] = ipc_addrs[i];
+    }
+}
+
+static int hexDigit(char c)
+{
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    throw exception::Exception("invalid hex digit in compression dictionary");
+}
+
+bool Client::getCompressionDictionary(std::string id, std::string &data)
+{
+    // without a resolver, only the dictionaries registered in this process are known
+    if(decentralized()) return false;
+
+    b0::message::resolv::Request rq0;
+    rq0.get_compression_dictionary.emplace();
+    b0::message::resolv::GetCompressionDictionaryRequest &rq = *rq0.get_compression_dictionary;
+    rq.dictionary_id = id;
+
+    b0::message::resolv::Response rsp0;
+    rsp0.get_compression_dictionary.emplace();
+    b0::message::resolv::GetCompressionDictionaryResponse &rsp = *rsp0.get_compression_dictionary;
+    rsp.ok = false;
+    callResolver(rq0, rsp0);
+
+    if(!rsp0.get_compression_dictionary || !rsp0.get_compression_dictionary->ok)
+        return false;
+
+    const std::string &hex = rsp0.get_compression_dictionary->data;
+    if(hex.size() % 2)
+        throw exception::Exception("invalid compression dictionary");
+    data.resize(hex.size() / 2);
+    for(size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<char>(hexDigit(hex[2 * i]) << 4 | hexDigit(hex[2 * i + 1]));
+    return true;
+}
+
+bool Client::getContentTypeId(std::string &content_type, int64_t &id)
+{
+    // without a resolver, there are no ids, and the content types are sent by name
+    if(decentralized()) return false;
+
+    b0::message::resolv::Request rq0;
+    rq0.content_type_id.emplace();
+    b0::message::resolv::ContentTypeIdRequest &rq = *rq0.content_type_id;
+    rq.content_type = content_type;
+    rq.id = id;
+
+    b0::message::resolv::Response rsp0;
+    rsp0.content_type_id.emplace();
+    b0::message::resolv::ContentTypeIdResponse &rsp = *rsp0.content_type_id;
+    rsp.ok = false;
+    callResolver(rq0, rsp0);
+
+    if(!rsp0.content_type_id || !rsp0.content_type_id->ok)
+        return false;
+
+    content_type = rsp0.content_type_id->content_type;
+    id = rsp0.content_type_id->id;
+    return true;
 }
 
 void Client::getGraph(b0::message::graph::Graph &graph)
 {
+    getGraph(graph, -1);
+}
+
+bool Client::getGraph(b0::message::graph::Graph &graph, int64_t if_newer_than_version)
+{
+    b0::message::graph::GetGraphRequest query;
+    query.if_newer_than_version = if_newer_than_version;
+    return getGraph(graph, query);
+}
+
+bool Client::getGraph(b0::message::graph::Graph &graph, const b0::message::graph::GetGraphRequest &query)
+{
+    static const std::set<std::string> link_types{"", "topic", "service", "publishes", "subscribes", "offers", "uses"};
+    if(!link_types.count(query.link_type))
+        throw exception::ArgumentError(query.link_type, "link_type");
+
+    if(decentralized())
+    {
+        b0::message::graph::Graph full;
+        Discovery::getInstance().getGraph(full);
+        if(!query.filtered())
+        {
+            graph = std::move(full);
+            return true;
+        }
+        graph = b0::message::graph::Graph();
+        graph.version = full.version;
+        std::set<std::string> nodes;
+        auto filter = [&](const std::vector<b0::message::graph::GraphLink> &links, bool topic, std::vector<b0::message::graph::GraphLink> &out) {
+            const std::string &pattern = topic ? query.topic_name : query.service_name;
+            for(auto &l : links)
+            {
+                if(query.selects(topic, l.reversed) && b0::message::graph::GetGraphRequest::matches(query.node_name, l.node_name) && b0::message::graph::GetGraphRequest::matches(pattern, l.other_name))
+                {
+                    out.push_back(l);
+                    nodes.insert(l.node_name);
+                }
+            }
+        };
+        filter(full.node_topic, true, graph.node_topic);
+        filter(full.node_service, false, graph.node_service);
+        bool links_only = !query.topic_name.empty() || !query.service_name.empty() || !query.link_type.empty();
+        for(auto &n : full.nodes)
+            if(links_only ? nodes.count(n.node_name) > 0 : b0::message::graph::GetGraphRequest::matches(query.node_name, n.node_name))
+                graph.nodes.push_back(n);
+        return true;
+    }
+
     b0::message::resolv::Request rq0;
-    rq0.get_graph.emplace();
-    b0::message::graph::GetGraphRequest &rq = *rq0.get_graph;
+    rq0.get_graph.emplace(query);
 
     b0::message::resolv::Response rsp0;
     rsp0.get_graph.emplace();
     b0::message::graph::GetGraphResponse &rsp = *rsp0.get_graph;
-    call(rq0, rsp0);
+    callResolver(rq0, rsp0);
 
-    graph = rsp.graph;
+    if(rsp.not_modified)
+        return false;
+    graph = std::move(rsp.graph);
+    return true;
+}
+
+int64_t Client::getParams(const std::string &prefix, std::map<std::string, std::string> &params)
+{
+    if(decentralized())
+        throw exception::Exception("getParams: there is no resolver in decentralized mode");
+
+    b0::message::resolv::Request rq0;
+    rq0.get_params.emplace();
+    rq0.get_params->prefix = prefix;
+
+    b0::message::resolv::Response rsp0;
+    rsp0.get_params.emplace();
+    callResolver(rq0, rsp0);
+
+    if(!rsp0.get_params || !rsp0.get_params->ok)
+        throw exception::Exception("getParams failed");
+    for(auto &p : rsp0.get_params->params)
+        params[p.name] = p.value;
+    return rsp0.get_params->version;
+}
+
+int64_t Client::setParam(const std::string &name, const std::string &value, bool remove)
+{
+    if(decentralized())
+        throw exception::Exception("setParam: there is no resolver in decentralized mode");
+
+    b0::message::resolv::Request rq0;
+    rq0.set_param.emplace();
+    b0::message::resolv::SetParamRequest &rq = *rq0.set_param;
+    rq.name = name;
+    rq.value = value;
+    rq.remove = remove;
+
+    b0::message::resolv::Response rsp0;
+    rsp0.set_param.emplace();
+    callResolver(rq0, rsp0);
+
+    if(!rsp0.set_param || !rsp0.set_param->ok)
+        throw exception::Exception("setParam failed");
+    return rsp0.set_param->version;
+}
+
+void Client::syncState(int64_t version, b0::message::resolv::SyncStateResponse &rsp)
+{
+    if(decentralized())
+        throw exception::Exception("syncState: there is no resolver in decentralized mode");
+
+    b0::message::resolv::Request rq0;
+    rq0.sync_state.emplace();
+    b0::message::resolv::SyncStateRequest &rq = *rq0.sync_state;
+    rq.version = version;
+
+    b0::message::resolv::Response rsp0;
+    rsp0.sync_state.emplace();
+    callResolver(rq0, rsp0);
+
+    if(!rsp0.sync_state->ok)
+        throw exception::Exception("syncState failed");
+    rsp = *rsp0.sync_state;
+}
+
+void Client::syncDirectory(const b0::message::resolv::SyncDirectoryRequest &rq, b0::message::resolv::SyncDirectoryResponse &rsp)
+{
+    if(decentralized())
+        throw exception::Exception("syncDirectory: there is no resolver in decentralized mode");
+
+    b0::message::resolv::Request rq0;
+    rq0.sync_directory = rq;
+
+    b0::message::resolv::Response rsp0;
+    rsp0.sync_directory.emplace();
+    callResolver(rq0, rsp0);
+
+    if(!rsp0.sync_directory->ok)
+        throw exception::Exception("syncDirectory failed");
+    rsp = *rsp0.sync_directory;
 }
 
 } // namespace resolver
 
 } // namespace b0
-
@@ -0,0 +1,362 @@
+#include <b0/resolver/discovery.h>
+#include <b0/message/resolv/discovery_beacon.h>
+#include <b0/exceptions.h>
+#include <b0/utils/env.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <map>
+
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+namespace b0
+{
+
+namespace resolver
+{
+
+using b0::message::graph::GraphLink;
+using b0::message::graph::GraphNode;
+using b0::message::resolv::AnnounceServiceRequest;
+using b0::message::resolv::AnnounceTopicRequest;
+using b0::message::resolv::DiscoveryBeacon;
+
+//! The last beacon received from another process
+struct DiscoveryPeer
+{
+    DiscoveryBeacon beacon;
+    std::chrono::steady_clock::time_point last_seen;
+};
+
+static bool sameLink(const GraphLink &a, const GraphLink &b)
+{
+    return a.node_name == b.node_name && a.other_name == b.other_name && a.reversed == b.reversed;
+}
+
+static void updateLink(std::vector<GraphLink> &links, const std::string &node_name, const std::string &other_name, bool reverse, bool active)
+{
+    GraphLink l;
+    l.node_name = node_name;
+    l.other_name = other_name;
+    l.reversed = reverse;
+    auto it = std::find_if(links.begin(), links.end(), [&](const GraphLink &x) {return sameLink(x, l);});
+    if(active && it == links.end())
+        links.push_back(l);
+    else if(!active && it != links.end())
+        links.erase(it);
+}
+
+template<typename T>
+static void removeByNode(std::vector<T> &v, const std::string &node_name)
+{
+    v.erase(std::remove_if(v.begin(), v.end(), [&](const T &x) {return x.node_name == node_name;}), v.end());
+}
+
+struct Discovery::Private
+{
+    boost::asio::io_service io_service_;
+    boost::asio::ip::udp::socket socket_{io_service_};
+    boost::asio::deadline_timer timer_{io_service_};
+    boost::asio::ip::udp::endpoint beacon_endpoint_;
+    boost::asio::ip::udp::endpoint sender_endpoint_;
+    std::array<char, 65536> buffer_;
+    boost::thread thread_;
+
+    //! Interval between the beacons
+    int interval_;
+
+    //! Time of start, to wait for the first beacons of the other processes when resolving
+    std::chrono::steady_clock::time_point start_time_;
+
+    boost::mutex mutex_;
+
+    //! Notified when a beacon is received, or the nodes of this process change
+    boost::condition_variable changed_;
+
+    //! The beacon of this process
+    DiscoveryBeacon beacon_;
+
+    //! The host_id:process_id of this process
+    std::string key_;
+
+    //! The other processes, by host_id:process_id
+    std::map<std::string, DiscoveryPeer> peers_;
+
+    Private()
+    {
+        interval_ = b0::env::getInt("B0_DISCOVERY_INTERVAL", 1000);
+        if(interval_ <= 0)
+            throw exception::ArgumentError(std::to_string(interval_), "B0_DISCOVERY_INTERVAL");
+        int port = b0::env::getInt("B0_DISCOVERY_PORT", 22001);
+        std::string addr = b0::env::get("B0_DISCOVERY_ADDRESS", "255.255.255.255");
+        beacon_endpoint_ = boost::asio::ip::udp::endpoint(boost::asio::ip::address::from_string(addr), port);
+
+        // many processes of the same host listen on the same port:
+        socket_.open(boost::asio::ip::udp::v4());
+        socket_.set_option(boost::asio::ip::udp::socket::reuse_address(true));
+        socket_.set_option(boost::asio::socket_base::broadcast(true));
+        socket_.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::any(), port));
+
+        start_time_ = std::chrono::steady_clock::now();
+        receive();
+        scheduleBeacon(0);
+        thread_ = boost::thread([this] {io_service_.run();});
+    }
+
+    ~Private()
+    {
+        io_service_.stop();
+        thread_.join();
+        sendBeacon(true);
+    }
+
+    void receive()
+    {
+        socket_.async_receive_from(boost::asio::buffer(buffer_), sender_endpoint_, boost::bind(&Private::onReceive, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
+    }
+
+    void onReceive(const boost::system::error_code &ec, std::size_t size)
+    {
+        if(ec == boost::asio::error::operation_aborted) return;
+
+        DiscoveryBeacon beacon;
+        bool valid = !ec;
+        if(valid)
+        {
+            try
+            {
+                parse(beacon, std::string(buffer_.data(), size));
+            }
+            catch(std::exception &)
+            {
+                // not a beacon
+                valid = false;
+            }
+        }
+
+        bool new_peer = false;
+        if(valid)
+        {
+            std::string key = beacon.host_id + ":" + std::to_string(beacon.process_id);
+            boost::mutex::scoped_lock lock(mutex_);
+            if(key != key_)
+            {
+                if(beacon.leaving)
+                {
+                    peers_.erase(key);
+                }
+                else
+                {
+                    new_peer = peers_.find(key) == peers_.end();
+                    DiscoveryPeer &peer = peers_[key];
+                    peer.beacon = beacon;
+                    peer.last_seen = std::chrono::steady_clock::now();
+                }
+                changed_.notify_all();
+            }
+        }
+
+        // let the new process know this one without waiting for the next beacon
+        if(new_peer)
+            sendBeacon(false);
+
+        receive();
+    }
+
+    void scheduleBeacon(int delay)
+    {
+        timer_.expires_from_now(boost::posix_time::milliseconds(delay));
+        timer_.async_wait(boost::bind(&Private::onTimer, this, boost::asio::placeholders::error));
+    }
+
+    void onTimer(const boost::system::error_code &ec)
+    {
+        if(ec == boost::asio::error::operation_aborted) return;
+
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            auto expiry = std::chrono::steady_clock::now() - 3 * std::chrono::milliseconds(interval_);
+            for(auto it = peers_.begin(); it != peers_.end(); )
+            {
+                if(it->second.last_seen < expiry)
+                    it = peers_.erase(it);
+                else
+                    ++it;
+            }
+        }
+
+        sendBeacon(false);
+        scheduleBeacon(interval_);
+    }
+
+    void sendBeacon(bool leaving)
+    {
+        std::string payload;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            // nothing to announce until a node is added
+            if(key_.empty()) return;
+            if(leaving)
+            {
+                DiscoveryBeacon beacon;
+                beacon.host_id = beacon_.host_id;
+                beacon.process_id = beacon_.process_id;
+                beacon.leaving = true;
+                b0::message::serializeMsgPack(beacon, payload);
+            }
+            else
+            {
+                b0::message::serializeMsgPack(beacon_, payload);
+            }
+        }
+
+        // the other processes may not be there (yet); the beacon is repeated anyway
+        boost::system::error_code ec;
+        socket_.send_to(boost::asio::buffer(payload), beacon_endpoint_, 0, ec);
+    }
+
+    //! Announce a change of the nodes of this process (with the mutex locked)
+    void onChanged()
+    {
+        changed_.notify_all();
+        // sent from the thread of the io_service, which owns the socket
+        io_service_.post(boost::bind(&Private::sendBeacon, this, false));
+    }
+};
+
+Discovery::Discovery()
+    : private_(new Private)
+{
+}
+
+Discovery::~Discovery()
+{
+}
+
+Discovery & Discovery::getInstance()
+{
+    static Discovery discovery;
+    return discovery;
+}
+
+void Discovery::addNode(const std::string &host_id, int process_id, const std::string &node_name)
+{
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    DiscoveryBeacon &beacon = private_->beacon_;
+    beacon.host_id = host_id;
+    beacon.process_id = process_id;
+    private_->key_ = host_id + ":" + std::to_string(process_id);
+    removeByNode(beacon.graph.nodes, node_name);
+    GraphNode n;
+    n.host_id = host_id;
+    n.process_id = process_id;
+    n.node_name = node_name;
+    beacon.graph.nodes.push_back(n);
+    private_->onChanged();
+}
+
+void Discovery::removeNode(const std::string &node_name)
+{
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    DiscoveryBeacon &beacon = private_->beacon_;
+    removeByNode(beacon.graph.nodes, node_name);
+    removeByNode(beacon.graph.node_topic, node_name);
+    removeByNode(beacon.graph.node_service, node_name);
+    removeByNode(beacon.services, node_name);
+    removeByNode(beacon.topics, node_name);
+    private_->onChanged();
+}
+
+void Discovery::announceService(const std::string &node_name, const std::string &service_name, const std::string &addr)
+{
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    AnnounceServiceRequest s;
+    s.node_name = node_name;
+    s.service_name = service_name;
+    s.sock_addr = addr;
+    private_->beacon_.services.push_back(s);
+    private_->onChanged();
+}
+
+void Discovery::announceTopic(const std::string &node_name, const std::string &topic_name, const std::string &addr)
+{
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    AnnounceTopicRequest t;
+    t.node_name = node_name;
+    t.topic_name = topic_name;
+    t.sock_addr = addr;
+    private_->beacon_.topics.push_back(t);
+    private_->onChanged();
+}
+
+void Discovery::notifyTopic(const std::string &node_name, const std::string &topic_name, bool reverse, bool active)
+{
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    updateLink(private_->beacon_.graph.node_topic, node_name, topic_name, reverse, active);
+    private_->onChanged();
+}
+
+void Discovery::notifyService(const std::string &node_name, const std::string &service_name, bool reverse, bool active)
+{
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    updateLink(private_->beacon_.graph.node_service, node_name, service_name, reverse, active);
+    private_->onChanged();
+}
+
+bool Discovery::resolveService(const std::string &service_name, std::vector<std::string> &addrs)
+{
+    auto find = [&] {
+        addrs.clear();
+        for(auto &s : private_->beacon_.services)
+            if(s.service_name == service_name) addrs.push_back(s.sock_addr);
+        for(auto &p : private_->peers_)
+            for(auto &s : p.second.beacon.services)
+                if(s.service_name == service_name) addrs.push_back(s.sock_addr);
+        return !addrs.empty();
+    };
+
+    // the beacons of the other processes may not have been received yet
+    auto deadline = private_->start_time_ + 2 * std::chrono::milliseconds(private_->interval_);
+
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    while(!find())
+    {
+        auto now = std::chrono::steady_clock::now();
+        if(now >= deadline) return false;
+        private_->changed_.wait_for(lock, boost::chrono::milliseconds(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1));
+    }
+    return true;
+}
+
+void Discovery::resolveTopic(const std::string &topic_name, std::vector<std::string> &addrs)
+{
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    addrs.clear();
+    for(auto &t : private_->beacon_.topics)
+        if(t.topic_name == topic_name) addrs.push_back(t.sock_addr);
+    for(auto &p : private_->peers_)
+        for(auto &t : p.second.beacon.topics)
+            if(t.topic_name == topic_name) addrs.push_back(t.sock_addr);
+}
+
+void Discovery::getGraph(b0::message::graph::Graph &graph)
+{
+    auto append = [&](const b0::message::graph::Graph &g) {
+        graph.nodes.insert(graph.nodes.end(), g.nodes.begin(), g.nodes.end());
+        graph.node_topic.insert(graph.node_topic.end(), g.node_topic.begin(), g.node_topic.end());
+        graph.node_service.insert(graph.node_service.end(), g.node_service.begin(), g.node_service.end());
+    };
+
+    boost::mutex::scoped_lock lock(private_->mutex_);
+    graph = b0::message::graph::Graph();
+    append(private_->beacon_.graph);
+    for(auto &p : private_->peers_)
+        append(p.second.beacon.graph);
+}
+
+} // namespace resolver
+
+} // namespace b0
@@ -1,27 +1,115 @@
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <set>
+#include <algorithm>
 
 #include <boost/asio.hpp>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/format.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <b0/resolver/resolver.h>
 #include <b0/resolver/client.h>
 #include <b0/logger/logger.h>
+#include <b0/exception/argument_error.h>
 #include <b0/utils/env.h>
 #include <b0/utils/thread_name.h>
+#include <b0/utils/decimator.h>
+#include <b0/compress/compress.h>
+#include <b0/message/metrics/node_metrics.h>
+#include <b0/message/resolv/param_update.h>
 
 #include <zmq.hpp>
 
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#endif
+
 namespace b0
 {
 
 namespace resolver
 {
 
+//! Return the address (host:port) of the peer of a TCP connection, or an empty string
+static std::string peerAddress(int fd)
+{
+#ifdef __linux__
+    sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    if(getpeername(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) return "";
+    char host[INET6_ADDRSTRLEN] = "";
+    int port = 0;
+    if(addr.ss_family == AF_INET)
+    {
+        sockaddr_in *a = reinterpret_cast<sockaddr_in*>(&addr);
+        inet_ntop(AF_INET, &a->sin_addr, host, sizeof(host));
+        port = ntohs(a->sin_port);
+    }
+    else if(addr.ss_family == AF_INET6)
+    {
+        sockaddr_in6 *a = reinterpret_cast<sockaddr_in6*>(&addr);
+        inet_ntop(AF_INET6, &a->sin6_addr, host, sizeof(host));
+        port = ntohs(a->sin6_port);
+    }
+    else return "";
+    return (boost::format("%s:%d") % host % port).str();
+#else
+    return "";
+#endif
+}
+
+//! Return the bytes written to a connection and not acknowledged by the peer yet (0 if unknown)
+static long connectionBacklog(int fd)
+{
+#ifdef __linux__
+    int n = 0;
+    if(ioctl(fd, SIOCOUTQ, &n) == 0) return n;
+#endif
+    return 0;
+}
+
+//! Return true if a TCP port can be bound (see Resolver::setStateFile())
+static bool tcpPortAvailable(int port)
+{
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::acceptor acceptor(io_service);
+    boost::system::error_code ec;
+    acceptor.open(boost::asio::ip::tcp::v4(), ec);
+    if(!ec) acceptor.bind(boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port), ec);
+    return !ec;
+}
+
+//! Record the removal of a link in a delta, dropping its addition by the same delta, if any
+static void recordRemoval(std::vector<b0::message::graph::GraphLink> &removed, std::vector<b0::message::graph::GraphLink> &added, const b0::message::graph::GraphLink &link)
+{
+    added.erase(std::remove_if(added.begin(), added.end(), [&](const b0::message::graph::GraphLink &l) {
+        return l.node_name == link.node_name && l.other_name == link.other_name && l.reversed == link.reversed;
+    }), added.end());
+    removed.push_back(link);
+}
+
+//! Return the port of a tcp:// address
+static int addressPort(const std::string &addr)
+{
+    return std::atoi(addr.c_str() + addr.rfind(':') + 1);
+}
+
 ResolverServiceServer::ResolverServiceServer(Resolver *resolver)
     : ServiceServer(resolver, "resolv", &Resolver::handle, resolver, true, false),
       resolver_(resolver)
@@ -36,6 +124,7 @@ void ResolverServiceServer::announce()
     rq.service_name = name_;
     rq.sock_addr = remote_addr_;
     b0::message::resolv::AnnounceServiceResponse rsp;
+    boost::unique_lock<boost::shared_mutex> lock(resolver_->state_mutex_);
     resolver_->handleAnnounceService(rq, rsp);
     resolver_->onNodeServiceOfferStart(resolver_->getName(), name_);
 }
@@ -57,31 +146,104 @@ Resolver::Resolver()
     : Node("resolver"),
       resolv_server_(this),
       graph_pub_(this, "graph", true, false),
-      minimum_heartbeat_interval_resolver_(5000000)
+      graph_delta_pub_(this, "graph_delta", true, false),
+      param_pub_(this, "param", true, false),
+      heartbeat_sub_(this, "heartbeat", b0::Subscriber::CallbackMsg<b0::message::resolv::HeartbeatRequest>(boost::bind(&Resolver::onHeartbeatMessage, this, _1)), true, false),
+      num_proxies_(b0::env::getInt("B0_RESOLVER_PROXIES", 1)),
+      num_priority_proxies_(b0::env::getInt("B0_RESOLVER_PRIORITY_PROXIES", 1)),
+      slow_consumer_bytes_(b0::env::getInt("B0_RESOLVER_SLOW_CONSUMER_BYTES", 64 * 1024)),
+      graph_snapshots_(b0::env::getBool("B0_RESOLVER_GRAPH_SNAPSHOTS", true)),
+      minimum_heartbeat_interval_resolver_(5000000),
+      primary_addr_(b0::env::get("B0_RESOLVER_PRIMARY")),
+      parent_addr_(b0::env::get("B0_RESOLVER_PARENT")),
+      federation_interval_(int64_t(b0::env::getInt("B0_RESOLVER_FEDERATION_INTERVAL", 1000)) * 1000),
+      state_file_(b0::env::get("B0_RESOLVER_STATE_FILE"))
 {
+    // the resolver is the reference of the time synchronization:
+    setSimulatedTime(false);
+    // and the agent of the process would need the resolver to be running:
+    setProcessAgent(false);
+    setGraphChangeInterval(int64_t(b0::env::getInt("B0_RESOLVER_GRAPH_INTERVAL", 0)) * 1000);
+    // (opt-in: the handlers of the subclasses would run on the worker threads)
+    resolv_server_.setWorkerThreads(b0::env::getInt("B0_RESOLVER_THREADS", 0));
 }
 
 Resolver::~Resolver()
 {
     heartbeat_sweeper_thread_.interrupt();
-    pub_proxy_thread_.interrupt();
+    standby_thread_.interrupt();
+    federation_thread_.interrupt();
+    bridge_thread_.interrupt();
+    for(auto &t : pub_proxy_threads_)
+        t.interrupt();
     //pub_proxy_thread_.join(); // FIXME: this makes the process hang on quit
 }
 
 void Resolver::init()
 {
-    setResolverAddress(address(hostname(), resolv_server_.port()));
+    site_ = address(hostname(), resolv_server_.port());
+    setResolverAddress(site_);
+
+    // the state saved by a previous run (a standby copies the primary instead)
+    b0::message::resolv::ResolverSnapshot snapshot;
+    bool restored = primary_addr_.empty() && loadState(snapshot);
 
     // setup XPUB-XSUB proxy addresses
     // those will be sent to nodes in response to announce
-    int xsub_proxy_port_ = freeTCPPort();
-    xsub_proxy_addr_ = address(hostname(), xsub_proxy_port_);
-    trace("XSUB address is %s", xsub_proxy_addr_);
-    int xpub_proxy_port_ = freeTCPPort();
-    xpub_proxy_addr_ = address(hostname(), xpub_proxy_port_);
-    trace("XPUB address is %s", xpub_proxy_addr_);
-    // run XPUB-XSUB proxy:
-    pub_proxy_thread_ = boost::thread(&Resolver::pubProxy, this, xsub_proxy_port_, xpub_proxy_port_);
+    // (the high-priority proxies come after the others)
+    if(num_proxies_ < 1) num_proxies_ = 1;
+    if(num_priority_proxies_ < 0) num_priority_proxies_ = 0;
+    proxy_consumers_.resize(num_proxies_ + num_priority_proxies_);
+    for(int i = 0; i < num_proxies_ + num_priority_proxies_; i++)
+    {
+        bool priority = i >= num_proxies_;
+        // the restored nodes are still connected to the ports of the previous run:
+        int xsub_proxy_port_, xpub_proxy_port_;
+        size_t j = i;
+        if(restored && j < snapshot.xsub_proxy_ports.size() && j < snapshot.xpub_proxy_ports.size() &&
+                tcpPortAvailable(snapshot.xsub_proxy_ports[j]) && tcpPortAvailable(snapshot.xpub_proxy_ports[j]))
+        {
+            xsub_proxy_port_ = snapshot.xsub_proxy_ports[j];
+            xpub_proxy_port_ = snapshot.xpub_proxy_ports[j];
+        }
+        else
+        {
+            if(restored)
+                warn("Cannot bind the previous ports of proxy %d: its nodes have to be restarted", i);
+            xsub_proxy_port_ = freeTCPPort();
+            xpub_proxy_port_ = freeTCPPort();
+        }
+        std::vector<std::string> &xsub_addrs = priority ? xsub_priority_addrs_ : xsub_proxy_addrs_;
+        std::vector<std::string> &xpub_addrs = priority ? xpub_priority_addrs_ : xpub_proxy_addrs_;
+        xsub_addrs.push_back(address(hostname(), xsub_proxy_port_));
+        trace("XSUB address of proxy %d is %s%s", i, xsub_addrs.back(), priority ? " (high priority)" : "");
+        xpub_addrs.push_back(address(hostname(), xpub_proxy_port_));
+        trace("XPUB address of proxy %d is %s%s", i, xpub_addrs.back(), priority ? " (high priority)" : "");
+        std::string xsub_ipc_addr = ipcAddress(xsub_proxy_port_), xpub_ipc_addr = ipcAddress(xpub_proxy_port_);
+        if(!xsub_ipc_addr.empty())
+        {
+            (priority ? xsub_priority_ipc_addrs_ : xsub_proxy_ipc_addrs_).push_back(xsub_ipc_addr);
+            (priority ? xpub_priority_ipc_addrs_ : xpub_proxy_ipc_addrs_).push_back(xpub_ipc_addr);
+            trace("IPC endpoints of proxy %d are %s, %s", i, xsub_ipc_addr, xpub_ipc_addr);
+        }
+        // run XPUB-XSUB proxy:
+        pub_proxy_threads_.push_back(boost::thread(&Resolver::pubProxy, this, i, xsub_proxy_port_, xpub_proxy_port_, xsub_ipc_addr, xpub_ipc_addr));
+    }
+    xsub_proxy_addr_ = xsub_proxy_addrs_[0];
+    xpub_proxy_addr_ = xpub_proxy_addrs_[0];
+
+    // directly to the proxy: resolving its publishers would be a request to ourselves
+    heartbeat_sub_.setRemoteAddress(xpub_proxy_addrs_[topicProxyIndex(heartbeat_sub_.getTopicName(), topic_proxy_, xpub_proxy_addrs_.size())]);
+
+    // write the replies of the worker threads as soon as they are done
+    if(getServiceThreads() > 0)
+        setSpinMode(SpinMode::EventDriven);
+
+    if(restored)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+        restoreState(snapshot);
+    }
 
     Node::init();
 
@@ -91,23 +253,56 @@ void Resolver::init()
     if(minimum_heartbeat_interval_resolver_ > 0)
         heartbeat_sweeper_thread_ = boost::thread(&Resolver::heartbeatSweeper, this);
 
-    // we have to manually notify that 'resolver' is publishing on the 'graph' topic,
-    // because the graph_pub_ socket doesn't send graph notify:
+    // we have to manually notify that 'resolver' is publishing on the 'graph' topics,
+    // because the graph_pub_ sockets don't send graph notify:
     // (has to be disabled because resolver is a special kind of node)
+    boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
     onNodeTopicPublishStart(getName(), graph_pub_.getTopicName());
+    onNodeTopicPublishStart(getName(), graph_delta_pub_.getTopicName());
+    onNodeTopicPublishStart(getName(), param_pub_.getTopicName());
+
+    // a restarted resolver must not reuse the versions of its previous run
+    state_version_ = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    // the nodes ignore the parameter updates older than the version they have fetched
+    params_version_ = state_version_;
+
+    if(!parent_addr_.empty())
+    {
+        startFederation();
+        info("Federated as a child of %s", parent_addr_);
+    }
+
+    if(!primary_addr_.empty())
+    {
+        standby_ = true;
+        standby_thread_ = boost::thread(&Resolver::standbyLoop, this);
+        info("Ready (standby of %s).", primary_addr_);
+        return;
+    }
 
     info("Ready.");
 }
 
 void Resolver::cleanup()
 {
+    // the bridges are closed before the context
+    if(federation_started_)
+    {
+        federation_thread_.interrupt();
+        bridge_thread_.interrupt();
+        federation_thread_.join();
+        bridge_thread_.join();
+    }
+
     Node::cleanup();
 
     // stop auxiliary threads
     if(minimum_heartbeat_interval_resolver_ > 0)
         heartbeat_sweeper_thread_.interrupt();
-    pub_proxy_thread_.interrupt(); // XXX: this will have no effect; anyway we'll use
-                                   //      each time different port numbers, so, alas.
+    standby_thread_.interrupt();
+    for(auto &t : pub_proxy_threads_)
+        t.interrupt(); // XXX: this will have no effect; anyway we'll use
+                       //      each time different port numbers, so, alas.
 }
 
 std::string Resolver::getXPUBSocketAddress() const
@@ -120,6 +315,140 @@ std::string Resolver::getXSUBSocketAddress() const
     return xsub_proxy_addr_;
 }
 
+std::string Resolver::getXPUBSocketAddress(const std::string &topic_name) const
+{
+    if(xpub_proxy_addrs_.size() < 2) return getXPUBSocketAddress();
+    return xpub_proxy_addrs_[topicProxyIndex(topic_name, topic_proxy_, xpub_proxy_addrs_.size())];
+}
+
+std::string Resolver::getXSUBSocketAddress(const std::string &topic_name) const
+{
+    if(xsub_proxy_addrs_.size() < 2) return getXSUBSocketAddress();
+    return xsub_proxy_addrs_[topicProxyIndex(topic_name, topic_proxy_, xsub_proxy_addrs_.size())];
+}
+
+std::string Resolver::getPriorityXPUBSocketAddress(const std::string &topic_name) const
+{
+    if(xpub_priority_addrs_.empty()) return getXPUBSocketAddress(topic_name);
+    return xpub_priority_addrs_[topicProxyIndex(topic_name, {}, xpub_priority_addrs_.size())];
+}
+
+std::string Resolver::getPriorityXSUBSocketAddress(const std::string &topic_name) const
+{
+    if(xsub_priority_addrs_.empty()) return getXSUBSocketAddress(topic_name);
+    return xsub_priority_addrs_[topicProxyIndex(topic_name, {}, xsub_priority_addrs_.size())];
+}
+
+void Resolver::setNumProxies(int num_proxies)
+{
+    num_proxies_ = num_proxies;
+}
+
+int Resolver::getNumProxies() const
+{
+    return num_proxies_;
+}
+
+void Resolver::setNumPriorityProxies(int num_proxies)
+{
+    num_priority_proxies_ = num_proxies;
+}
+
+int Resolver::getNumPriorityProxies() const
+{
+    return num_priority_proxies_;
+}
+
+std::vector<Resolver::ProxyConsumer> Resolver::getProxyConsumers() const
+{
+    boost::mutex::scoped_lock lock(proxy_consumers_mutex_);
+    std::vector<ProxyConsumer> ret;
+    for(auto &consumers : proxy_consumers_)
+        ret.insert(ret.end(), consumers.begin(), consumers.end());
+    return ret;
+}
+
+void Resolver::setSlowConsumerThreshold(long bytes)
+{
+    slow_consumer_bytes_ = bytes;
+}
+
+void Resolver::setStateFile(const std::string &path)
+{
+    if(getState() != NodeState::Created)
+        throw exception::Exception("setStateFile() must be called before init()");
+    state_file_ = path;
+}
+
+std::string Resolver::getStateFile() const
+{
+    return state_file_;
+}
+
+void Resolver::setServiceThreads(int num_threads)
+{
+    resolv_server_.setWorkerThreads(num_threads);
+}
+
+int Resolver::getServiceThreads() const
+{
+    return resolv_server_.getWorkerThreads();
+}
+
+void Resolver::setTopicProxy(const std::string &topic_name, int proxy)
+{
+    topic_proxy_[topic_name] = proxy;
+}
+
+void Resolver::addCompressionDictionary(const std::string &id, const std::string &data)
+{
+    boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+    compression_dictionaries_[id] = data;
+    b0::compress::addDictionary(id, data);
+}
+
+void Resolver::setParameter(const std::string &name, const std::string &value)
+{
+    boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+    changeParameter(name, value, false);
+}
+
+void Resolver::removeParameter(const std::string &name)
+{
+    boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+    changeParameter(name, "", true);
+}
+
+void Resolver::changeParameter(const std::string &name, const std::string &value, bool remove)
+{
+    b0::message::resolv::ParamUpdate update;
+    if(remove)
+    {
+        if(!params_.erase(name)) return;
+        update.removed.push_back(name);
+    }
+    else
+    {
+        auto it = params_.find(name);
+        if(it != params_.end() && it->second == value) return;
+        params_[name] = value;
+        update.params.emplace_back();
+        update.params.back().name = name;
+        update.params.back().value = value;
+    }
+    update.version = ++params_version_;
+    state_version_++;
+    if(getState() != NodeState::Ready)
+        return;
+    if(isNodeThread())
+        param_pub_.publish(update);
+    else
+    {
+        boost::mutex::scoped_lock lock(deferred_mutex_);
+        deferred_param_updates_.push_back(update);
+    }
+}
+
 void Resolver::announceNode()
 {
     // directly route this call to the handler, otherwise it will cause a deadlock
@@ -128,10 +457,90 @@ void Resolver::announceNode()
     rq.process_id = pid();
     rq.node_name = getName();
     b0::message::resolv::AnnounceNodeResponse rsp;
-    handleAnnounceNode(rq, rsp);
+    {
+        boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+        handleAnnounceNode(rq, rsp);
+    }
 
     if(logger::Logger *p_logger = dynamic_cast<logger::Logger*>(p_logger_))
-        p_logger->connect(xsub_proxy_addr_);
+        p_logger->connect(getXSUBSocketAddress("log"));
+}
+
+void Resolver::announceService(const std::string &service_name, const std::string &addr, const std::string &ipc_addr)
+{
+    // directly route this call to the handler, otherwise it will cause a deadlock
+    b0::message::resolv::AnnounceServiceRequest rq;
+    rq.node_name = getName();
+    rq.service_name = service_name;
+    rq.sock_addr = addr;
+    rq.ipc_addr = ipc_addr;
+    b0::message::resolv::AnnounceServiceResponse rsp;
+    boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+    handleAnnounceService(rq, rsp);
+    if(!rsp.ok)
+        throw exception::Exception("announceService failed");
+}
+
+void Resolver::announceTopic(const std::string &topic_name, const std::string &addr, const std::string &ipc_addr)
+{
+    // directly route this call to the handler, otherwise it will cause a deadlock
+    b0::message::resolv::AnnounceTopicRequest rq;
+    rq.node_name = getName();
+    rq.topic_name = topic_name;
+    rq.sock_addr = addr;
+    rq.ipc_addr = ipc_addr;
+    b0::message::resolv::AnnounceTopicResponse rsp;
+    boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+    handleAnnounceTopic(rq, rsp);
+}
+
+void Resolver::resolveTopic(const std::string &topic_name, std::vector<std::string> &addrs)
+{
+    // directly route this call to the handler, otherwise it will cause a deadlock
+    b0::message::resolv::ResolveTopicRequest rq;
+    rq.topic_name = topic_name;
+    b0::message::resolv::ResolveTopicResponse rsp;
+    boost::shared_lock<boost::shared_mutex> lock(state_mutex_);
+    handleResolveTopic(rq, rsp);
+    addrs = rsp.sock_addr;
+}
+
+bool Resolver::getCompressionDictionary(const std::string &id, std::string &data)
+{
+    // directly look up the dictionary, otherwise it will cause a deadlock
+    boost::shared_lock<boost::shared_mutex> lock(state_mutex_);
+    auto it = compression_dictionaries_.find(id);
+    if(it == compression_dictionaries_.end())
+        return false;
+    data = it->second;
+    return true;
+}
+
+bool Resolver::getContentTypeId(std::string &content_type, int64_t &id)
+{
+    if(!content_type.empty()) return false;
+    boost::mutex::scoped_lock lock(content_types_mutex_);
+    if(id < 0 || static_cast<uint64_t>(id) >= content_types_.size())
+        return false;
+    content_type = content_types_[id];
+    return true;
+}
+
+void Resolver::getMetrics(b0::message::metrics::NodeMetrics &metrics, const std::string &pattern)
+{
+    Node::getMetrics(metrics, pattern);
+
+    metrics.heartbeats.clear();
+    auto now = boost::posix_time::second_clock::local_time();
+    boost::shared_lock<boost::shared_mutex> lock(state_mutex_);
+    for(auto &x : nodes_by_name_)
+    {
+        if(x.second->name == getName() || x.second->last_heartbeat.is_not_a_date_time()) continue;
+        metrics.heartbeats.emplace_back();
+        b0::message::metrics::HeartbeatMetrics &hb = metrics.heartbeats.back();
+        hb.node_name = x.second->name;
+        hb.age_usec = (now - x.second->last_heartbeat).total_microseconds();
+    }
 }
 
 void Resolver::notifyShutdown()
@@ -160,6 +569,9 @@ void Resolver::spinOnce()
     try
     {
         Node::spinOnce();
+        flushGraphChanges();
+        flushDeferred();
+        saveState();
     }
     catch(std::exception &ex)
     {
@@ -176,31 +588,44 @@ void Resolver::onNodeDisconnected(std::string name)
     resolver::NodeEntry *e = nodeByName(name);
 
     for(resolver::ServiceEntry *s : e->services)
-        services_by_name_.erase(s->name);
+    {
+        std::vector<resolver::ServiceEntry*> &servers = services_by_name_[s->name];
+        servers.erase(std::remove(servers.begin(), servers.end(), s), servers.end());
+        if(servers.empty())
+            services_by_name_.erase(s->name);
+    }
     nodes_by_name_.erase(name);
+    releaseNodeName(e->base_name, e->name_suffix);
+    if(e->has_expiry)
+        heartbeat_expiry_.erase(e->expiry);
+    e->has_expiry = false;
+    // a node added and removed between two publications is not announced:
+    auto &added = graph_delta_.nodes_added;
+    added.erase(std::remove_if(added.begin(), added.end(), [&](const b0::message::graph::GraphNode &n) {return n.node_name == name;}), added.end());
+    graph_delta_.nodes_removed.push_back(name);
+
+    // only the topics and the edges of this node are visited
+    for(auto &topic_name : e->topics)
+    {
+        auto it = topic_publishers_.find(topic_name);
+        if(it == topic_publishers_.end()) continue;
+        for(auto it2 = it->second.begin(); it2 != it->second.end(); )
+        {
+            if(it2->first == name) it2 = it->second.erase(it2);
+            else ++it2;
+        }
+        if(it->second.empty()) topic_publishers_.erase(it);
+    }
 
-    std::set<std::pair<std::string, std::string> > npt, nst, nos, nus;
-
-    for(auto x : node_publishes_topic_)
-        if(x.first == name)
-            npt.insert(x);
-
-    for(auto x : node_subscribes_topic_)
-        if(x.first == name)
-            nst.insert(x);
-
-    for(auto x : node_offers_service_)
-        if(x.first == name)
-            nos.insert(x);
-
-    for(auto x : node_uses_service_)
-        if(x.first == name)
-            nus.insert(x);
-
-    for(auto x : npt) onNodeTopicPublishStop(x.first, x.second);
-    for(auto x : nst) onNodeTopicSubscribeStop(x.first, x.second);
-    for(auto x : nos) onNodeServiceOfferStop(x.first, x.second);
-    for(auto x : nus) onNodeServiceUseStop(x.first, x.second);
+    auto it = node_links_.find(name);
+    if(it != node_links_.end())
+    {
+        resolver::NodeLinks links = it->second;
+        for(auto &x : links.publishes_topic) onNodeTopicPublishStop(name, x);
+        for(auto &x : links.subscribes_topic) onNodeTopicSubscribeStop(name, x);
+        for(auto &x : links.offers_service) onNodeServiceOfferStop(name, x);
+        for(auto &x : links.uses_service) onNodeServiceUseStop(name, x);
+    }
 
     onGraphChanged();
 }
@@ -208,52 +633,73 @@ void Resolver::onNodeDisconnected(std::string name)
 void Resolver::onNodeTopicPublishStart(std::string node_name, std::string topic_name)
 {
     info("Graph: node '%s' publishes on topic '%s'", node_name, topic_name);
-    node_publishes_topic_.insert(std::make_pair(node_name, topic_name));
+    if(addLink(node_name, &resolver::NodeLinks::publishes_topic, topic_name))
+        graph_delta_.node_topic_added.push_back(graphLink(node_name, topic_name, false));
 }
 
 void Resolver::onNodeTopicPublishStop(std::string node_name, std::string topic_name)
 {
+    auto it = topic_publishers_.find(topic_name);
+    if(it != topic_publishers_.end())
+    {
+        for(auto it2 = it->second.begin(); it2 != it->second.end(); )
+        {
+            if(it2->first == node_name) it2 = it->second.erase(it2);
+            else ++it2;
+        }
+        if(it->second.empty()) topic_publishers_.erase(it);
+    }
+    resolver::NodeEntry *ne = nodeByName(node_name);
+    if(ne) ne->topics.erase(topic_name);
+
     info("Graph: node '%s' stops publishing on topic '%s'", node_name, topic_name);
-    node_publishes_topic_.erase(std::make_pair(node_name, topic_name));
+    if(removeLink(node_name, &resolver::NodeLinks::publishes_topic, topic_name))
+        recordRemoval(graph_delta_.node_topic_removed, graph_delta_.node_topic_added, graphLink(node_name, topic_name, false));
 }
 
 void Resolver::onNodeTopicSubscribeStart(std::string node_name, std::string topic_name)
 {
     info("Graph: node '%s' subscribes to topic '%s'", node_name, topic_name);
-    node_subscribes_topic_.insert(std::make_pair(node_name, topic_name));
+    if(addLink(node_name, &resolver::NodeLinks::subscribes_topic, topic_name))
+        graph_delta_.node_topic_added.push_back(graphLink(node_name, topic_name, true));
 }
 
 void Resolver::onNodeTopicSubscribeStop(std::string node_name, std::string topic_name)
 {
     info("Graph: node '%s' stops subscribing to topic '%s'", node_name, topic_name);
-    node_subscribes_topic_.erase(std::make_pair(node_name, topic_name));
+    if(removeLink(node_name, &resolver::NodeLinks::subscribes_topic, topic_name))
+        recordRemoval(graph_delta_.node_topic_removed, graph_delta_.node_topic_added, graphLink(node_name, topic_name, true));
 }
 
 void Resolver::onNodeServiceOfferStart(std::string node_name, std::string service_name)
 {
     info("Graph: node '%s' offers service '%s'", node_name, service_name);
-    node_offers_service_.insert(std::make_pair(node_name, service_name));
+    if(addLink(node_name, &resolver::NodeLinks::offers_service, service_name))
+        graph_delta_.node_service_added.push_back(graphLink(node_name, service_name, false));
 }
 
 void Resolver::onNodeServiceOfferStop(std::string node_name, std::string service_name)
 {
     info("Graph: node '%s' stops offering service '%s'", node_name, service_name);
-    node_offers_service_.erase(std::make_pair(node_name, service_name));
+    if(removeLink(node_name, &resolver::NodeLinks::offers_service, service_name))
+        recordRemoval(graph_delta_.node_service_removed, graph_delta_.node_service_added, graphLink(node_name, service_name, false));
 }
 
 void Resolver::onNodeServiceUseStart(std::string node_name, std::string service_name)
 {
     info("Graph: node '%s' connects to service '%s'", node_name, service_name);
-    node_uses_service_.insert(std::make_pair(node_name, service_name));
+    if(addLink(node_name, &resolver::NodeLinks::uses_service, service_name))
+        graph_delta_.node_service_added.push_back(graphLink(node_name, service_name, true));
 }
 
 void Resolver::onNodeServiceUseStop(std::string node_name, std::string service_name)
 {
     info("Graph: node '%s' disconnects from service '%s'", node_name, service_name);
-    node_uses_service_.erase(std::make_pair(node_name, service_name));
+    if(removeLink(node_name, &resolver::NodeLinks::uses_service, service_name))
+        recordRemoval(graph_delta_.node_service_removed, graph_delta_.node_service_added, graphLink(node_name, service_name, true));
 }
 
-void Resolver::pubProxy(int xsub_proxy_port, int xpub_proxy_port)
+void Resolver::pubProxy(int index, int xsub_proxy_port, int xpub_proxy_port, std::string xsub_ipc_addr, std::string xpub_ipc_addr)
 {
     set_thread_name("XPROXY");
     b0::logger::LocalLogger logger(this);
@@ -261,21 +707,156 @@ void Resolver::pubProxy(int xsub_proxy_port, int xpub_proxy_port)
 
     zmq::context_t &context_ = *reinterpret_cast<zmq::context_t*>(getContext());
 
+    // the high-priority proxies on the I/O thread reserved to them, if any:
+    uint64_t affinity = ioThreadAffinity(index >= num_proxies_);
+
     zmq::socket_t proxy_in_sock_(context_, ZMQ_XSUB);
+    if(affinity)
+        proxy_in_sock_.setsockopt(ZMQ_AFFINITY, &affinity, sizeof(affinity));
     std::string xsub_proxy_addr = address(xsub_proxy_port);
     proxy_in_sock_.bind(xsub_proxy_addr);
 
     zmq::socket_t proxy_out_sock_(context_, ZMQ_XPUB);
+    if(affinity)
+        proxy_out_sock_.setsockopt(ZMQ_AFFINITY, &affinity, sizeof(affinity));
+    // pass every subscription to the publishers, for latched ones (see Publisher::setLatched()):
+    proxy_out_sock_.setsockopt<int>(ZMQ_XPUB_VERBOSE, 1);
+    // the queue of each subscriber, beyond which only its messages are dropped:
+    int hwm = b0::env::getInt("B0_RESOLVER_PROXY_HWM", 0);
+    if(hwm > 0)
+        proxy_out_sock_.setsockopt<int>(ZMQ_SNDHWM, hwm);
     std::string xpub_proxy_addr = address(xpub_proxy_port);
     proxy_out_sock_.bind(xpub_proxy_addr);
 
+    if(!xsub_ipc_addr.empty())
+    {
+        try
+        {
+            proxy_in_sock_.bind(xsub_ipc_addr);
+            proxy_out_sock_.bind(xpub_ipc_addr);
+        }
+        catch(zmq::error_t &ex)
+        {
+            logger.error("XPROXY: cannot bind the IPC endpoints (see B0_IPC_DIR): %s", ex.what());
+        }
+    }
+
+    // the connections of the subscribers, by file descriptor, with the number of checks they were over the threshold:
+    std::string monitor_addr = (boost::format("inproc://b0-proxy-monitor-%p-%d") % this % index).str();
+    zmq_socket_monitor(static_cast<void*>(proxy_out_sock_), monitor_addr.c_str(), ZMQ_EVENT_ACCEPTED | ZMQ_EVENT_DISCONNECTED | ZMQ_EVENT_CLOSED);
+    zmq::socket_t monitor_sock(context_, ZMQ_PAIR);
+    monitor_sock.connect(monitor_addr);
+    std::map<int, std::pair<ProxyConsumer, int> > consumers;
+    auto next_check = std::chrono::steady_clock::now() + std::chrono::seconds{1};
+
+    // as zmq::proxy(), plus the copies of the messages for the rate-limited (or part-selecting) subscribers:
+    Decimator decimator;
+    std::vector<Decimator::Copy> copies;
+    std::vector<zmq::message_t> frames;
+    std::string joined;
     try
     {
-#ifdef __GNUC__
-        zmq::proxy(static_cast<void*>(proxy_in_sock_), static_cast<void*>(proxy_out_sock_), nullptr);
-#else
-        zmq::proxy(proxy_in_sock_, proxy_out_sock_, nullptr);
-#endif
+        zmq::pollitem_t items[] = {
+            {static_cast<void*>(proxy_in_sock_), 0, ZMQ_POLLIN, 0},
+            {static_cast<void*>(proxy_out_sock_), 0, ZMQ_POLLIN, 0},
+            {static_cast<void*>(monitor_sock), 0, ZMQ_POLLIN, 0}
+        };
+        while(true)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if(now >= next_check)
+            {
+                checkProxyConsumers(index, consumers, logger);
+                next_check = now + std::chrono::seconds{1};
+            }
+            zmq::poll(&items[0], 3, long(std::chrono::duration_cast<std::chrono::milliseconds>(next_check - now).count()) + 1);
+
+            if(items[2].revents & ZMQ_POLLIN)
+            {
+                // an event is its id and value (the file descriptor), then the endpoint:
+                zmq::message_t event, endpoint;
+                while(monitor_sock.recv(&event, ZMQ_DONTWAIT))
+                {
+                    if(event.more()) monitor_sock.recv(&endpoint);
+                    if(event.size() < 6) continue;
+                    uint16_t id;
+                    int32_t fd;
+                    std::memcpy(&id, event.data(), sizeof(id));
+                    std::memcpy(&fd, static_cast<const char*>(event.data()) + 2, sizeof(fd));
+                    if(id == ZMQ_EVENT_ACCEPTED)
+                        consumers[fd] = std::make_pair(ProxyConsumer{index, peerAddress(fd), 0, false}, 0);
+                    else
+                        consumers.erase(fd);
+                }
+            }
+
+            // messages of the publishers, a bounded batch at a time, not to delay the subscriptions:
+            for(int n = 0; n < 1000 && (items[0].revents & ZMQ_POLLIN); n++)
+            {
+                zmq::message_t msg;
+                if(!proxy_in_sock_.recv(&msg, ZMQ_DONTWAIT)) break;
+                bool more = msg.more();
+                copies.clear();
+                frames.clear();
+                const char *data = static_cast<const char*>(msg.data());
+                size_t size = msg.size();
+                if(!decimator.empty() && more)
+                {
+                    // an envelope sent as a multipart message (see Socket::setMultipartFraming()) is
+                    // its frames one after the other, and the copies are made of the whole envelope:
+                    joined.assign(data, size);
+                    while(more)
+                    {
+                        frames.emplace_back();
+                        proxy_in_sock_.recv(&frames.back());
+                        more = frames.back().more();
+                        joined.append(static_cast<const char*>(frames.back().data()), frames.back().size());
+                    }
+                    data = joined.data();
+                    size = joined.size();
+                }
+                if(!decimator.empty())
+                    decimator.select(data, size, copies);
+                for(auto &c : copies)
+                {
+                    if(c.data)
+                    {
+                        zmq::message_t copy(c.data->data(), c.data->size());
+                        proxy_out_sock_.send(copy);
+                        continue;
+                    }
+                    // the copy is the message, with its header0 line replaced by the name of the channel:
+                    const char *header0_end = static_cast<const char*>(std::memchr(data, '\n', size));
+                    size_t rest = size - (header0_end - data);
+                    zmq::message_t copy(c.channel->size() + rest);
+                    std::memcpy(copy.data(), c.channel->data(), c.channel->size());
+                    std::memcpy(static_cast<char*>(copy.data()) + c.channel->size(), header0_end, rest);
+                    proxy_out_sock_.send(copy);
+                }
+                proxy_out_sock_.send(msg, more || !frames.empty() ? ZMQ_SNDMORE : 0);
+                for(size_t i = 0; i < frames.size(); i++)
+                    proxy_out_sock_.send(frames[i], i + 1 < frames.size() ? ZMQ_SNDMORE : 0);
+                // the remaining frames of a multipart message are passed as they are:
+                while(more)
+                {
+                    proxy_in_sock_.recv(&msg);
+                    more = msg.more();
+                    proxy_out_sock_.send(msg, more ? ZMQ_SNDMORE : 0);
+                }
+            }
+
+            // subscriptions of the subscribers:
+            if(items[1].revents & ZMQ_POLLIN)
+            {
+                zmq::message_t msg;
+                while(proxy_out_sock_.recv(&msg, ZMQ_DONTWAIT))
+                {
+                    std::string sub = decimator.subscription(static_cast<const char*>(msg.data()), msg.size());
+                    zmq::message_t fwd(sub.data(), sub.size());
+                    proxy_in_sock_.send(fwd);
+                }
+            }
+        }
     }
     catch(zmq::error_t &ex)
     {
@@ -283,9 +864,33 @@ void Resolver::pubProxy(int xsub_proxy_port, int xpub_proxy_port)
             logger.error("XPROXY: %s", ex.what());
     }
 
+    zmq_socket_monitor(static_cast<void*>(proxy_out_sock_), nullptr, 0);
     logger.trace("XPROXY: finished");
 }
 
+void Resolver::checkProxyConsumers(int index, std::map<int, std::pair<ProxyConsumer, int> > &consumers, b0::logger::LogInterface &logger)
+{
+    std::vector<ProxyConsumer> snapshot;
+    for(auto &x : consumers)
+    {
+        ProxyConsumer &consumer = x.second.first;
+        int &over = x.second.second;
+        consumer.backlog_bytes = connectionBacklog(x.first);
+        over = consumer.backlog_bytes > slow_consumer_bytes_ ? over + 1 : 0;
+        // a burst of large messages is not enough, the backlog must persist:
+        bool slow = over >= 2;
+        if(slow && !consumer.slow)
+            logger.warn("XPROXY %d: slow subscriber %s (%d bytes behind)", index, consumer.address, consumer.backlog_bytes);
+        else if(!slow && consumer.slow)
+            logger.warn("XPROXY %d: subscriber %s caught up", index, consumer.address);
+        consumer.slow = slow;
+        snapshot.push_back(consumer);
+    }
+
+    boost::mutex::scoped_lock lock(proxy_consumers_mutex_);
+    proxy_consumers_[index].swap(snapshot);
+}
+
 bool Resolver::nodeNameExists(std::string name)
 {
     return name == "node" || nodes_by_name_.find(name) != nodes_by_name_.end();
@@ -316,16 +921,60 @@ resolver::NodeEntry * Resolver::nodeByName(std::string node_name)
 resolver::ServiceEntry * Resolver::serviceByName(std::string service_name)
 {
     auto it = services_by_name_.find(service_name);
-    return it == services_by_name_.end() ? 0 : it->second;
+    return it == services_by_name_.end() ? 0 : it->second.front();
 }
 
 void Resolver::heartbeat(resolver::NodeEntry *node_entry)
 {
     node_entry->last_heartbeat = boost::posix_time::second_clock::local_time();
+    if(node_entry->has_expiry)
+        heartbeat_expiry_.erase(node_entry->expiry);
+    node_entry->expiry = heartbeat_expiry_.insert(std::make_pair(node_entry->last_heartbeat, node_entry));
+    node_entry->has_expiry = true;
+}
+
+std::set<std::string> Resolver::expiredNodes()
+{
+    std::set<std::string> ret;
+    auto now = boost::posix_time::second_clock::local_time();
+    for(auto &x : heartbeat_expiry_)
+    {
+        bool is_alive = (now - x.first) < boost::posix_time::microseconds{minimum_heartbeat_interval_resolver_};
+        if(is_alive) break;
+        if(x.second->name != this->getName())
+            ret.insert(x.second->name);
+    }
+    return ret;
+}
+
+bool Resolver::isLookup(const b0::message::resolv::Request &rq)
+{
+    bool changes = rq.announce_node || rq.shutdown_node || rq.announce_service || rq.announce_topic
+        || rq.heartbeat || rq.node_topic || rq.node_service || rq.announce_sockets || rq.set_param
+        || (rq.content_type_id && !rq.content_type_id->content_type.empty()) || rq.sync_directory;
+    return !changes;
 }
 
 void Resolver::handle(const b0::message::resolv::Request &rq, b0::message::resolv::Response &rsp)
 {
+    // called by the worker threads of resolv_server_: lookups run concurrently
+    boost::shared_lock<boost::shared_mutex> shared_lock(state_mutex_, boost::defer_lock);
+    boost::unique_lock<boost::shared_mutex> unique_lock(state_mutex_, boost::defer_lock);
+    if(isLookup(rq))
+    {
+        shared_lock.lock();
+    }
+    else
+    {
+        unique_lock.lock();
+        // a node turning to the standby has found the primary unresponsive
+        if(standby_ && !(rq.heartbeat && rq.heartbeat->node_name == getName()) && !rq.sync_directory)
+            promote();
+        // (the directories of the other sites are not part of the state)
+        if(!rq.heartbeat && !rq.sync_directory)
+            state_version_++;
+    }
+
 #define MAP_METHOD(m, f, t) \
     if(rq.f) { \
         if(t) trace("Received a " #m "Request"); \
@@ -336,42 +985,116 @@ void Resolver::handle(const b0::message::resolv::Request &rq, b0::message::resol
     MAP_METHOD(ShutdownNode, shutdown_node, 1)
     MAP_METHOD(AnnounceService, announce_service, 1)
     MAP_METHOD(ResolveService, resolve_service, 1)
+    MAP_METHOD(AnnounceTopic, announce_topic, 1)
+    MAP_METHOD(ResolveTopic, resolve_topic, 0)
     MAP_METHOD(Heartbeat, heartbeat, 0)
     MAP_METHOD(NodeTopic, node_topic, 1)
     MAP_METHOD(NodeService, node_service, 1)
     MAP_METHOD(GetGraph, get_graph, 1)
+    MAP_METHOD(GetCompressionDictionary, get_compression_dictionary, 1)
+    MAP_METHOD(AnnounceSockets, announce_sockets, 1)
+    MAP_METHOD(SyncState, sync_state, 0)
+    MAP_METHOD(GetParams, get_params, 0)
+    MAP_METHOD(SetParam, set_param, 1)
+    MAP_METHOD(ContentTypeId, content_type_id, 1)
+    MAP_METHOD(SyncDirectory, sync_directory, 0)
 #undef MAP_METHOD
 }
 
-std::string Resolver::makeUniqueNodeName(std::string nodeName)
+std::string Resolver::makeUniqueNodeName(std::string nodeName, int *suffix)
 {
     if(nodeName == "") nodeName = "node";
-    std::string uniqueNodeName = nodeName;
-    for(int i = 1; true; i++)
+    if(suffix) *suffix = 0;
+    if(!nodeNameExists(nodeName)) return nodeName;
+
+    resolver::NodeNameSuffixes &s = node_name_suffixes_[nodeName];
+    while(true)
     {
-        if(!nodeNameExists(uniqueNodeName)) break;
-        uniqueNodeName = (boost::format("%s-%d") % nodeName % i).str();
+        int i;
+        if(s.free.empty())
+        {
+            i = s.next++;
+        }
+        else
+        {
+            i = *s.free.begin();
+            s.free.erase(s.free.begin());
+        }
+        // the name may have been taken explicitly by some node
+        std::string uniqueNodeName = (boost::format("%s-%d") % nodeName % i).str();
+        if(nodeNameExists(uniqueNodeName)) continue;
+        if(suffix) *suffix = i;
+        return uniqueNodeName;
     }
-    return uniqueNodeName;
+}
+
+void Resolver::releaseNodeName(const std::string &baseName, int suffix)
+{
+    if(suffix <= 0) return;
+    auto it = node_name_suffixes_.find(baseName);
+    if(it == node_name_suffixes_.end()) return;
+    if(suffix == it->second.next - 1)
+        it->second.next--;
+    else
+        it->second.free.insert(suffix);
 }
 
 void Resolver::handleAnnounceNode(const b0::message::resolv::AnnounceNodeRequest &rq, b0::message::resolv::AnnounceNodeResponse &rsp)
 {
-    std::string nodeName = makeUniqueNodeName(rq.node_name);
-    resolver::NodeEntry *e = new resolver::NodeEntry;
-    e->host_id = rq.host_id;
-    e->process_id = rq.process_id;
-    e->name = nodeName;
-    heartbeat(e);
-    nodes_by_name_[nodeName] = e;
-    onNodeConnected(nodeName);
-    onGraphChanged();
-    rsp.node_name = e->name;
+    if(rq.ephemeral)
+    {
+        // only the addresses are needed: the node does not join the graph
+        rsp.node_name = rq.node_name;
+    }
+    else
+    {
+        int suffix;
+        std::string nodeName = makeUniqueNodeName(rq.node_name, &suffix);
+        resolver::NodeEntry *e = new resolver::NodeEntry;
+        e->host_id = rq.host_id;
+        e->process_id = rq.process_id;
+        e->name = nodeName;
+        e->base_name = rq.node_name == "" ? "node" : rq.node_name;
+        e->name_suffix = suffix;
+        heartbeat(e);
+        nodes_by_name_[nodeName] = e;
+        b0::message::graph::GraphNode n;
+        n.host_id = e->host_id;
+        n.process_id = e->process_id;
+        n.node_name = e->name;
+        graph_delta_.nodes_added.push_back(n);
+        onNodeConnected(nodeName);
+        onGraphChanged();
+        rsp.node_name = e->name;
+    }
     rsp.xsub_sock_addr = xsub_proxy_addr_;
     rsp.xpub_sock_addr = xpub_proxy_addr_;
+    rsp.xsub_ipc_addrs = xsub_proxy_ipc_addrs_;
+    rsp.xpub_ipc_addrs = xpub_proxy_ipc_addrs_;
+    if(xpub_proxy_addrs_.size() > 1)
+    {
+        rsp.xsub_sock_addrs = xsub_proxy_addrs_;
+        rsp.xpub_sock_addrs = xpub_proxy_addrs_;
+        for(auto &x : topic_proxy_)
+        {
+            if(x.second < 0 || x.second >= int(xpub_proxy_addrs_.size())) continue;
+            b0::message::resolv::TopicProxy tp;
+            tp.topic_name = x.first;
+            tp.proxy = x.second;
+            rsp.topic_proxies.push_back(tp);
+        }
+    }
+    rsp.xsub_priority_sock_addrs = xsub_priority_addrs_;
+    rsp.xpub_priority_sock_addrs = xpub_priority_addrs_;
+    rsp.xsub_priority_ipc_addrs = xsub_priority_ipc_addrs_;
+    rsp.xpub_priority_ipc_addrs = xpub_priority_ipc_addrs_;
     rsp.minimum_heartbeat_interval = minimum_heartbeat_interval_resolver_;
+    rsp.heartbeat_topic = heartbeat_sub_.getTopicName();
     rsp.ok = true;
-    info("New node has joined: '%s'", e->name);
+    if(rq.ephemeral)
+        debug("Ephemeral node '%s' looked up the proxies", rq.node_name);
+    else
+        info("New node has joined: '%s'", rsp.node_name);
 }
 
 void Resolver::handleShutdownNode(const b0::message::resolv::ShutdownNodeRequest &rq, b0::message::resolv::ShutdownNodeResponse &rsp)
@@ -399,21 +1122,26 @@ void Resolver::handleAnnounceService(const b0::message::resolv::AnnounceServiceR
         error("Invalid node name: %s", rq.node_name);
         return;
     }
-    if(serviceByName(rq.service_name))
+    std::vector<resolver::ServiceEntry*> &servers = services_by_name_[rq.service_name];
+    for(resolver::ServiceEntry *other : servers)
     {
-        rsp.ok = false;
-        error("A service with name '%s' already exists", rq.service_name);
-        return;
+        if(other->addr == rq.sock_addr)
+        {
+            rsp.ok = false;
+            error("Service '%s' already exists at %s", rq.service_name, rq.sock_addr);
+            return;
+        }
     }
     resolver::ServiceEntry *se = new resolver::ServiceEntry;
     se->node = ne;
     se->name = rq.service_name;
     se->addr = rq.sock_addr;
-    services_by_name_[se->name] = se;
+    setIPCAddress(rq.sock_addr, rq.ipc_addr);
+    servers.push_back(se);
     ne->services.push_back(se);
     //onNodeNewService(...);
     rsp.ok = true;
-    trace("Node '%s' announced service '%s' (%s)", ne->name, rq.service_name, rq.sock_addr);
+    trace("Node '%s' announced service '%s' (%s), %d server(s)", ne->name, rq.service_name, rq.sock_addr, servers.size());
 }
 
 void Resolver::handleResolveService(const b0::message::resolv::ResolveServiceRequest &rq, b0::message::resolv::ResolveServiceResponse &rsp)
@@ -421,40 +1149,195 @@ void Resolver::handleResolveService(const b0::message::resolv::ResolveServiceReq
     auto it = services_by_name_.find(rq.service_name);
     if(it == services_by_name_.end())
     {
+        // offered at another site of the federation (the IPC endpoints are only local):
+        const b0::message::resolv::FederationEntry *e = remoteEntry(rq.service_name, false);
+        if(e && !e->sock_addrs.empty())
+        {
+            rsp.ok = true;
+            rsp.sock_addr = e->sock_addrs[0];
+            rsp.sock_addrs = e->sock_addrs;
+            rsp.ipc_addrs.assign(e->sock_addrs.size(), "");
+            trace("Resolution: '%s' -> %s (site %s)", rq.service_name, boost::algorithm::join(rsp.sock_addrs, ", "), e->site);
+            return;
+        }
         rsp.sock_addr = "";
         rsp.ok = false;
         error("Failed to resolve service '%s'", rq.service_name);
         return;
     }
-    resolver::ServiceEntry *se = it->second;
-    trace("Resolution: '%s' -> %s", rq.service_name, se->addr);
     rsp.ok = true;
-    rsp.sock_addr = se->addr;
+    rsp.sock_addr = it->second.front()->addr;
+    rsp.sock_addrs.clear();
+    rsp.ipc_addrs.clear();
+    for(resolver::ServiceEntry *se : it->second)
+    {
+        rsp.sock_addrs.push_back(se->addr);
+        rsp.ipc_addrs.push_back(getIPCAddress(se->addr));
+    }
+    trace("Resolution: '%s' -> %s", rq.service_name, boost::algorithm::join(rsp.sock_addrs, ", "));
 }
 
-void Resolver::handleHeartbeat(const b0::message::resolv::HeartbeatRequest &rq, b0::message::resolv::HeartbeatResponse &rsp)
+void Resolver::handleAnnounceTopic(const b0::message::resolv::AnnounceTopicRequest &rq, b0::message::resolv::AnnounceTopicResponse &rsp)
 {
-    if(rq.node_name == "resolver")
+    resolver::NodeEntry *ne = nodeByName(rq.node_name);
+    if(!ne)
     {
-        // a HeartbeatRequest from "resolver" means to actually perform
-        // the detection and purging of dead nodes
-        std::set<std::string> nodes_shutdown;
-        for(auto i = nodes_by_name_.begin(); i != nodes_by_name_.end(); ++i)
-        {
-            resolver::NodeEntry *e = i->second;
-            bool is_alive = (boost::posix_time::second_clock::local_time() - e->last_heartbeat) < boost::posix_time::microseconds{minimum_heartbeat_interval_resolver_};
-            if(!is_alive && e->name != this->getName())
-                nodes_shutdown.insert(e->name);
-        }
-        if(minimum_heartbeat_interval_resolver_ > 0)
-        {
-            for(auto node_name : nodes_shutdown)
-            {
-                info("Node '%s' disconnected due to timeout.", node_name);
-                resolver::NodeEntry *e = nodeByName(node_name);
+        rsp.ok = false;
+        error("Invalid node name: %s", rq.node_name);
+        return;
+    }
+    topic_publishers_[rq.topic_name].insert(std::make_pair(ne->name, rq.sock_addr));
+    setIPCAddress(rq.sock_addr, rq.ipc_addr);
+    ne->topics.insert(rq.topic_name);
+    rsp.ok = true;
+    trace("Node '%s' announced publisher of topic '%s' (%s)", ne->name, rq.topic_name, rq.sock_addr);
+}
+
+void Resolver::handleResolveTopic(const b0::message::resolv::ResolveTopicRequest &rq, b0::message::resolv::ResolveTopicResponse &rsp)
+{
+    rsp.ok = true;
+    rsp.sock_addr.clear();
+    auto it = topic_publishers_.find(rq.topic_name);
+    if(it == topic_publishers_.end())
+        return;
+    for(auto &x : it->second)
+    {
+        rsp.sock_addr.push_back(x.second);
+        rsp.ipc_addrs.push_back(getIPCAddress(x.second));
+    }
+}
+
+void Resolver::setIPCAddress(const std::string &addr, const std::string &ipc_addr)
+{
+    // an address announced again without IPC endpoint (e.g. a port reused) must forget it
+    if(ipc_addr.empty())
+        ipc_addrs_.erase(addr);
+    else
+        ipc_addrs_[addr] = ipc_addr;
+}
+
+std::string Resolver::getIPCAddress(const std::string &addr) const
+{
+    auto it = ipc_addrs_.find(addr);
+    return it == ipc_addrs_.end() ? std::string() : it->second;
+}
+
+void Resolver::handleGetCompressionDictionary(const b0::message::resolv::GetCompressionDictionaryRequest &rq, b0::message::resolv::GetCompressionDictionaryResponse &rsp)
+{
+    rsp.ok = false;
+    auto it = compression_dictionaries_.find(rq.dictionary_id);
+    if(it == compression_dictionaries_.end())
+    {
+        warn("Compression dictionary '%s' requested, but not known", rq.dictionary_id);
+        return;
+    }
+
+    // the dictionary is binary data, which is hex-encoded to fit in a JSON string:
+    static const char *digits = "0123456789abcdef";
+    rsp.data.resize(it->second.size() * 2);
+    for(size_t i = 0; i < it->second.size(); i++)
+    {
+        unsigned char c = static_cast<unsigned char>(it->second[i]);
+        rsp.data[2 * i] = digits[c >> 4];
+        rsp.data[2 * i + 1] = digits[c & 0xf];
+    }
+    rsp.ok = true;
+}
+
+void Resolver::handleContentTypeId(const b0::message::resolv::ContentTypeIdRequest &rq, b0::message::resolv::ContentTypeIdResponse &rsp)
+{
+    rsp.ok = false;
+    boost::mutex::scoped_lock lock(content_types_mutex_);
+    if(rq.content_type.empty())
+    {
+        if(rq.id < 0 || static_cast<uint64_t>(rq.id) >= content_types_.size())
+        {
+            warn("Content type id %d requested, but not known", rq.id);
+            return;
+        }
+        rsp.ok = true;
+        rsp.content_type = content_types_[rq.id];
+        rsp.id = rq.id;
+        return;
+    }
+
+    auto it = content_type_ids_.find(rq.content_type);
+    if(it == content_type_ids_.end())
+    {
+        // the ids are never reused, so that the ones cached by the nodes stay valid
+        it = content_type_ids_.insert(std::make_pair(rq.content_type, static_cast<int64_t>(content_types_.size()))).first;
+        content_types_.push_back(rq.content_type);
+        debug("Assigned id %d to content type %s", it->second, rq.content_type);
+    }
+    rsp.ok = true;
+    rsp.content_type = it->first;
+    rsp.id = it->second;
+}
+
+void Resolver::handleGetParams(const b0::message::resolv::GetParamsRequest &rq, b0::message::resolv::GetParamsResponse &rsp)
+{
+    rsp.ok = true;
+    rsp.version = params_version_;
+    for(auto it = params_.lower_bound(rq.prefix); it != params_.end() && boost::starts_with(it->first, rq.prefix); ++it)
+    {
+        rsp.params.emplace_back();
+        rsp.params.back().name = it->first;
+        rsp.params.back().value = it->second;
+    }
+}
+
+void Resolver::handleSetParam(const b0::message::resolv::SetParamRequest &rq, b0::message::resolv::SetParamResponse &rsp)
+{
+    if(rq.name.empty())
+    {
+        warn("SetParam request with an empty name");
+        rsp.ok = false;
+        rsp.version = params_version_;
+        return;
+    }
+    changeParameter(rq.name, rq.value, rq.remove);
+    rsp.ok = true;
+    rsp.version = params_version_;
+}
+
+void Resolver::onHeartbeatMessage(const b0::message::resolv::HeartbeatRequest &rq)
+{
+    // the node name of the resolver triggers the sweep, which only the sweeper may do
+    if(rq.node_name == getName()) return;
+
+    boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+    // the nodes publish to the proxy of the resolver they announced to
+    if(standby_) return;
+    b0::message::resolv::HeartbeatResponse rsp;
+    handleHeartbeat(rq, rsp);
+}
+
+void Resolver::handleHeartbeat(const b0::message::resolv::HeartbeatRequest &rq, b0::message::resolv::HeartbeatResponse &rsp)
+{
+    if(rq.node_name == "resolver")
+    {
+        // a HeartbeatRequest from "resolver" means to actually perform
+        // the detection and purging of dead nodes
+        // the nodes of a standby only send heartbeats after it takes over
+        std::set<std::string> nodes_shutdown;
+        if(!standby_)
+            nodes_shutdown = expiredNodes();
+        if(minimum_heartbeat_interval_resolver_ > 0 && !nodes_shutdown.empty())
+        {
+            // the nodes dropped together (e.g. a whole host) make one graph change
+            state_version_++;
+            defer_graph_changes_ = true;
+            graph_changed_ = false;
+            for(auto node_name : nodes_shutdown)
+            {
+                info("Node '%s' disconnected due to timeout.", node_name);
+                resolver::NodeEntry *e = nodeByName(node_name);
                 onNodeDisconnected(node_name);
                 delete e;
             }
+            defer_graph_changes_ = false;
+            if(graph_changed_)
+                onGraphChanged();
         }
     }
     else
@@ -467,6 +1350,23 @@ void Resolver::handleHeartbeat(const b0::message::resolv::HeartbeatRequest &rq,
             return;
         }
         heartbeat(ne);
+
+        // a coalesced heartbeat is for all the nodes of the process
+        for(auto &node_name : rq.other_node_names)
+        {
+            resolver::NodeEntry *e = nodeByName(node_name);
+            if(e) heartbeat(e);
+            else warn("Received a coalesced heartbeat for an invalid node name: %s", node_name);
+        }
+
+        // kept for the graph; not a change of the graph, so not announced in the deltas
+        for(auto &stats : rq.stats)
+        {
+            resolver::NodeEntry *e = stats.node_name == ne->name ? ne : nodeByName(stats.node_name);
+            if(e) e->stats = stats;
+        }
+        if(!rq.stats.empty() && !graph_publish_pending_)
+            invalidateGraphCache();
     }
     rsp.ok = true;
     rsp.time_usec = hardwareTimeUSec();
@@ -474,7 +1374,7 @@ void Resolver::handleHeartbeat(const b0::message::resolv::HeartbeatRequest &rq,
 
 void Resolver::handleNodeTopic(const b0::message::graph::NodeTopicRequest &req, b0::message::graph::NodeTopicResponse &resp)
 {
-    size_t old_sz1 = node_publishes_topic_.size(), old_sz2 = node_subscribes_topic_.size();
+    size_t old_sz = graph_delta_.node_topic_added.size() + graph_delta_.node_topic_removed.size();
     if(req.reverse)
     {
         if(req.active)
@@ -489,13 +1389,13 @@ void Resolver::handleNodeTopic(const b0::message::graph::NodeTopicRequest &req,
         else
             onNodeTopicPublishStop(req.node_name, req.topic_name);
     }
-    if(old_sz1 != node_publishes_topic_.size() || old_sz2 != node_subscribes_topic_.size())
+    if(old_sz != graph_delta_.node_topic_added.size() + graph_delta_.node_topic_removed.size())
         onGraphChanged();
 }
 
 void Resolver::handleNodeService(const b0::message::graph::NodeServiceRequest &req, b0::message::graph::NodeServiceResponse &resp)
 {
-    size_t old_sz1 = node_offers_service_.size(), old_sz2 = node_uses_service_.size();
+    size_t old_sz = graph_delta_.node_service_added.size() + graph_delta_.node_service_removed.size();
     if(req.reverse)
     {
         if(req.active)
@@ -510,64 +1410,878 @@ void Resolver::handleNodeService(const b0::message::graph::NodeServiceRequest &r
         else
             onNodeServiceOfferStop(req.node_name, req.service_name);
     }
-    if(old_sz1 != node_offers_service_.size() || old_sz2 != node_uses_service_.size())
+    if(old_sz != graph_delta_.node_service_added.size() + graph_delta_.node_service_removed.size())
         onGraphChanged();
 }
 
+void Resolver::handleAnnounceSockets(const b0::message::resolv::AnnounceSocketsRequest &rq, b0::message::resolv::AnnounceSocketsResponse &rsp)
+{
+    defer_graph_changes_ = true;
+    graph_changed_ = false;
+    for(auto &rq1 : rq.services)
+    {
+        b0::message::resolv::AnnounceServiceResponse rsp1;
+        handleAnnounceService(rq1, rsp1);
+        if(!rsp1.ok) rsp.failed.push_back(rq1.service_name);
+    }
+    for(auto &rq1 : rq.topics)
+    {
+        b0::message::resolv::AnnounceTopicResponse rsp1;
+        handleAnnounceTopic(rq1, rsp1);
+        if(!rsp1.ok) rsp.failed.push_back(rq1.topic_name);
+    }
+    for(auto &rq1 : rq.node_topics)
+    {
+        b0::message::graph::NodeTopicResponse rsp1;
+        handleNodeTopic(rq1, rsp1);
+    }
+    for(auto &rq1 : rq.node_services)
+    {
+        b0::message::graph::NodeServiceResponse rsp1;
+        handleNodeService(rq1, rsp1);
+    }
+    defer_graph_changes_ = false;
+    if(graph_changed_)
+        onGraphChanged();
+    rsp.ok = rsp.failed.empty();
+    trace("Node '%s' announced %d services, %d topics and %d graph links", rq.node_name, rq.services.size(), rq.topics.size(), rq.node_topics.size() + rq.node_services.size());
+}
+
+void Resolver::handleSyncState(const b0::message::resolv::SyncStateRequest &rq, b0::message::resolv::SyncStateResponse &rsp)
+{
+    rsp.ok = true;
+    rsp.version = state_version_;
+    rsp.changed = rq.version != state_version_;
+    if(!rsp.changed) return;
+
+    getGraph(rsp.graph);
+    for(auto &x : services_by_name_)
+    {
+        for(resolver::ServiceEntry *se : x.second)
+        {
+            b0::message::resolv::AnnounceServiceRequest s;
+            s.node_name = se->node->name;
+            s.service_name = se->name;
+            s.sock_addr = se->addr;
+            s.ipc_addr = getIPCAddress(se->addr);
+            rsp.services.push_back(s);
+        }
+    }
+    for(auto &x : topic_publishers_)
+    {
+        for(auto &y : x.second)
+        {
+            b0::message::resolv::AnnounceTopicRequest t;
+            t.node_name = y.first;
+            t.topic_name = x.first;
+            t.sock_addr = y.second;
+            t.ipc_addr = getIPCAddress(y.second);
+            rsp.topics.push_back(t);
+        }
+    }
+    rsp.params_version = params_version_;
+    for(auto &x : params_)
+    {
+        rsp.params.emplace_back();
+        rsp.params.back().name = x.first;
+        rsp.params.back().value = x.second;
+    }
+    boost::mutex::scoped_lock lock(content_types_mutex_);
+    rsp.content_types = content_types_;
+}
+
+void Resolver::applyState(const b0::message::resolv::SyncStateResponse &state)
+{
+    for(auto &x : nodes_by_name_)
+    {
+        for(resolver::ServiceEntry *se : x.second->services)
+            delete se;
+        delete x.second;
+    }
+    nodes_by_name_.clear();
+    services_by_name_.clear();
+    topic_publishers_.clear();
+    ipc_addrs_.clear();
+    node_links_.clear();
+    links_by_other_.clear();
+    node_name_suffixes_.clear();
+    heartbeat_expiry_.clear();
+
+    for(auto &n : state.graph.nodes)
+    {
+        resolver::NodeEntry *e = new resolver::NodeEntry;
+        e->host_id = n.host_id;
+        e->process_id = n.process_id;
+        e->name = n.node_name;
+        e->base_name = n.node_name;
+        heartbeat(e);
+        nodes_by_name_[e->name] = e;
+    }
+    for(auto &s : state.services)
+    {
+        b0::message::resolv::AnnounceServiceResponse rsp;
+        handleAnnounceService(s, rsp);
+    }
+    for(auto &t : state.topics)
+    {
+        b0::message::resolv::AnnounceTopicResponse rsp;
+        handleAnnounceTopic(t, rsp);
+    }
+    for(auto &l : state.graph.node_topic)
+        addLink(l.node_name, l.reversed ? &resolver::NodeLinks::subscribes_topic : &resolver::NodeLinks::publishes_topic, l.other_name);
+    for(auto &l : state.graph.node_service)
+        addLink(l.node_name, l.reversed ? &resolver::NodeLinks::uses_service : &resolver::NodeLinks::offers_service, l.other_name);
+
+    params_.clear();
+    for(auto &p : state.params)
+        params_[p.name] = p.value;
+    params_version_ = state.params_version;
+
+    {
+        boost::mutex::scoped_lock lock(content_types_mutex_);
+        content_types_ = state.content_types;
+        content_type_ids_.clear();
+        for(size_t i = 0; i < content_types_.size(); i++)
+            content_type_ids_[content_types_[i]] = static_cast<int64_t>(i);
+    }
+
+    state_version_ = state.version;
+    graph_version_ = state.graph.version;
+    graph_delta_ = b0::message::graph::GraphDelta();
+    graph_publish_pending_ = false;
+    invalidateGraphCache();
+    debug("Copied the state of the primary: %d nodes, %d services", nodes_by_name_.size(), state.services.size());
+}
+
+bool Resolver::loadState(b0::message::resolv::ResolverSnapshot &snapshot)
+{
+    if(state_file_.empty()) return false;
+    std::ifstream f(state_file_, std::ios::binary);
+    if(!f) return false;
+    std::stringstream ss;
+    ss << f.rdbuf();
+    if(!spotify::json::try_decode(snapshot, ss.str()))
+    {
+        warn("Ignoring the state file %s: cannot be parsed", state_file_);
+        return false;
+    }
+    return true;
+}
+
+void Resolver::restoreState(const b0::message::resolv::ResolverSnapshot &snapshot)
+{
+    // the entries of this node are made again by its initialization
+    b0::message::resolv::SyncStateResponse state = snapshot.state;
+    std::string self = getName();
+    auto ownNode = [&](const b0::message::graph::GraphNode &n) {return n.node_name == self;};
+    auto ownLink = [&](const b0::message::graph::GraphLink &l) {return l.node_name == self;};
+    auto ownService = [&](const b0::message::resolv::AnnounceServiceRequest &s) {return s.node_name == self;};
+    auto ownTopic = [&](const b0::message::resolv::AnnounceTopicRequest &t) {return t.node_name == self;};
+    state.graph.nodes.erase(std::remove_if(state.graph.nodes.begin(), state.graph.nodes.end(), ownNode), state.graph.nodes.end());
+    state.graph.node_topic.erase(std::remove_if(state.graph.node_topic.begin(), state.graph.node_topic.end(), ownLink), state.graph.node_topic.end());
+    state.graph.node_service.erase(std::remove_if(state.graph.node_service.begin(), state.graph.node_service.end(), ownLink), state.graph.node_service.end());
+    state.services.erase(std::remove_if(state.services.begin(), state.services.end(), ownService), state.services.end());
+    state.topics.erase(std::remove_if(state.topics.begin(), state.topics.end(), ownTopic), state.topics.end());
+
+    // the parameters set before initialization override the saved ones
+    std::map<std::string, std::string> params = params_;
+    applyState(state);
+    for(auto &x : params)
+        params_[x.first] = x.second;
+
+    // like the nodes of a standby taking over, they get a full interval to send a heartbeat (see applyState())
+    info("Restored the state saved in %s: %d nodes, %d services", state_file_, nodes_by_name_.size(), state.services.size());
+}
+
+void Resolver::saveState()
+{
+    if(state_file_.empty() || standby_) return;
+    int64_t now = hardwareTimeUSec();
+    if(now - last_state_save_usec_ < 1000000) return;
+
+    b0::message::resolv::ResolverSnapshot snapshot;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(state_mutex_);
+        if(state_version_ == saved_state_version_) return;
+        b0::message::resolv::SyncStateRequest rq;
+        rq.version = -1;
+        handleSyncState(rq, snapshot.state);
+    }
+    for(auto &addr : xsub_proxy_addrs_)
+        snapshot.xsub_proxy_ports.push_back(addressPort(addr));
+    for(auto &addr : xsub_priority_addrs_)
+        snapshot.xsub_proxy_ports.push_back(addressPort(addr));
+    for(auto &addr : xpub_proxy_addrs_)
+        snapshot.xpub_proxy_ports.push_back(addressPort(addr));
+    for(auto &addr : xpub_priority_addrs_)
+        snapshot.xpub_proxy_ports.push_back(addressPort(addr));
+    last_state_save_usec_ = now;
+
+    // written aside and renamed, so that a crash while writing leaves the previous state
+    std::string s, tmp = state_file_ + ".tmp";
+    b0::message::serialize(snapshot, s);
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        f << s;
+        f.close();
+        if(!f)
+        {
+            error("Cannot write the state file %s", tmp);
+            return;
+        }
+    }
+    if(std::rename(tmp.c_str(), state_file_.c_str()) != 0)
+    {
+        error("Cannot replace the state file %s: %s", state_file_, std::strerror(errno));
+        return;
+    }
+    saved_state_version_ = snapshot.state.version;
+}
+
+void Resolver::promote()
+{
+    if(!standby_) return;
+    standby_ = false;
+    standby_thread_.interrupt();
+
+    // the nodes get a full interval to send their heartbeats here
+    for(auto &x : nodes_by_name_)
+        heartbeat(x.second);
+
+    warn("Taking over from the primary resolver %s", primary_addr_);
+    onGraphChanged();
+}
+
+void Resolver::standbyLoop()
+{
+    set_thread_name("standby");
+    b0::logger::LocalLogger logger(this);
+    logger.trace("standby: started");
+
+    int64_t interval = minimum_heartbeat_interval_resolver_ > 0 ? minimum_heartbeat_interval_resolver_ : 5000000;
+    resolver::Client resolv_cli(this);
+    resolv_cli.setResolverAddress(primary_addr_);
+    resolv_cli.setReadTimeout(interval / 3000);
+    resolv_cli.init();
+
+    int64_t version = -1, last_ok = hardwareTimeUSec();
+    while(standby_ && !shutdownRequested())
+    {
+        try
+        {
+            b0::message::resolv::SyncStateResponse state;
+            resolv_cli.syncState(version, state);
+            last_ok = hardwareTimeUSec();
+            if(state.changed)
+            {
+                boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+                if(!standby_) break;
+                applyState(state);
+            }
+            version = state.version;
+        }
+        catch(boost::thread_interrupted &)
+        {
+            break;
+        }
+        catch(std::exception &ex)
+        {
+            logger.warn("standby: %s", ex.what());
+            if(hardwareTimeUSec() - last_ok >= interval)
+            {
+                boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+                promote();
+                break;
+            }
+        }
+        try
+        {
+            sleepUSec(interval / 3);
+        }
+        catch(boost::thread_interrupted &)
+        {
+            break;
+        }
+    }
+
+    resolv_cli.cleanup();
+    logger.trace("standby: finished");
+}
+
+void Resolver::setPrimary(const std::string &addr)
+{
+    primary_addr_ = addr;
+}
+
+std::string Resolver::getPrimary() const
+{
+    return primary_addr_;
+}
+
+bool Resolver::isStandby() const
+{
+    return standby_;
+}
+
+void Resolver::setParent(const std::string &addr)
+{
+    parent_addr_ = addr;
+}
+
+std::string Resolver::getParent() const
+{
+    return parent_addr_;
+}
+
+void Resolver::setFederationInterval(int64_t interval)
+{
+    if(interval <= 0)
+        throw exception::ArgumentError(std::to_string(interval), "interval");
+    federation_interval_ = interval;
+}
+
+int64_t Resolver::getFederationInterval() const
+{
+    return federation_interval_;
+}
+
+std::vector<std::string> Resolver::getBridgedTopics() const
+{
+    boost::mutex::scoped_lock lock(bridges_mutex_);
+    std::vector<std::string> topics;
+    for(auto &x : bridges_)
+        topics.push_back(x.first);
+    return topics;
+}
+
+void Resolver::handleSyncDirectory(const b0::message::resolv::SyncDirectoryRequest &rq, b0::message::resolv::SyncDirectoryResponse &rsp)
+{
+    resolver::FederationSite &site = child_sites_[rq.site];
+    if(!site.last_sync_usec)
+        info("Child resolver %s joined the federation", rq.site);
+    site.services = rq.services;
+    site.topics = rq.topics;
+    site.last_sync_usec = hardwareTimeUSec();
+    startFederation();
+
+    // everything but the directory of the requester (which includes its children):
+    localDirectory(rsp.services, rsp.topics);
+    for(auto &x : child_sites_)
+    {
+        if(x.first == rq.site) continue;
+        rsp.services.insert(rsp.services.end(), x.second.services.begin(), x.second.services.end());
+        rsp.topics.insert(rsp.topics.end(), x.second.topics.begin(), x.second.topics.end());
+    }
+    rsp.services.insert(rsp.services.end(), parent_site_.services.begin(), parent_site_.services.end());
+    rsp.topics.insert(rsp.topics.end(), parent_site_.topics.begin(), parent_site_.topics.end());
+    rsp.ok = true;
+}
+
+void Resolver::localDirectory(std::vector<b0::message::resolv::FederationEntry> &services, std::vector<b0::message::resolv::FederationEntry> &topics) const
+{
+    // (the services and topics of the resolver itself are only local)
+    for(auto &x : services_by_name_)
+    {
+        b0::message::resolv::FederationEntry e;
+        e.name = x.first;
+        e.site = site_;
+        for(resolver::ServiceEntry *se : x.second)
+            if(se->node->name != getName())
+                e.sock_addrs.push_back(se->addr);
+        if(!e.sock_addrs.empty())
+            services.push_back(e);
+    }
+
+    // only the topics published by the nodes of this site, so that a bridged one is not sent back
+    std::set<std::string> published;
+    for(auto &x : node_links_)
+        if(x.first != getName())
+            published.insert(x.second.publishes_topic.begin(), x.second.publishes_topic.end());
+    for(auto &topic_name : published)
+    {
+        b0::message::resolv::FederationEntry e;
+        e.name = topic_name;
+        e.site = site_;
+        e.sock_addrs.assign(1, getXPUBSocketAddress(topic_name));
+        topics.push_back(e);
+    }
+}
+
+const b0::message::resolv::FederationEntry * Resolver::remoteEntry(const std::string &name, bool topic) const
+{
+    for(auto &x : child_sites_)
+        for(auto &e : topic ? x.second.topics : x.second.services)
+            if(e.name == name) return &e;
+    for(auto &e : topic ? parent_site_.topics : parent_site_.services)
+        if(e.name == name) return &e;
+    return nullptr;
+}
+
+void Resolver::startFederation()
+{
+    if(federation_started_.exchange(true)) return;
+    federation_thread_ = boost::thread(&Resolver::federationLoop, this);
+    bridge_thread_ = boost::thread(&Resolver::bridgeLoop, this);
+}
+
+void Resolver::federationLoop()
+{
+    set_thread_name("federation");
+    b0::logger::LocalLogger logger(this);
+    logger.trace("federation: started");
+
+    std::unique_ptr<resolver::Client> parent_cli;
+    if(!parent_addr_.empty())
+    {
+        parent_cli.reset(new resolver::Client(this));
+        parent_cli->setResolverAddress(parent_addr_);
+        parent_cli->setReadTimeout(int(federation_interval_ / 1000));
+        parent_cli->init();
+    }
+
+    while(!shutdownRequested())
+    {
+        int64_t now = hardwareTimeUSec();
+        try
+        {
+            if(parent_cli)
+            {
+                b0::message::resolv::SyncDirectoryRequest rq;
+                rq.site = site_;
+                {
+                    boost::shared_lock<boost::shared_mutex> lock(state_mutex_);
+                    localDirectory(rq.services, rq.topics);
+                    for(auto &x : child_sites_)
+                    {
+                        rq.services.insert(rq.services.end(), x.second.services.begin(), x.second.services.end());
+                        rq.topics.insert(rq.topics.end(), x.second.topics.begin(), x.second.topics.end());
+                    }
+                }
+                b0::message::resolv::SyncDirectoryResponse rsp;
+                parent_cli->syncDirectory(rq, rsp);
+                boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+                parent_site_.services = std::move(rsp.services);
+                parent_site_.topics = std::move(rsp.topics);
+                parent_site_.last_sync_usec = now;
+            }
+        }
+        catch(boost::thread_interrupted &)
+        {
+            break;
+        }
+        catch(std::exception &ex)
+        {
+            logger.warn("federation: %s", ex.what());
+        }
+
+        // the topics subscribed to at this site, published only at another site:
+        std::map<std::string, std::string> bridges;
+        {
+            boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+            int64_t expiry = 3 * federation_interval_;
+            for(auto it = child_sites_.begin(); it != child_sites_.end(); )
+            {
+                if(now - it->second.last_sync_usec > expiry)
+                {
+                    logger.warn("federation: child resolver %s timed out", it->first);
+                    it = child_sites_.erase(it);
+                }
+                else ++it;
+            }
+            if(parent_site_.last_sync_usec && now - parent_site_.last_sync_usec > expiry)
+            {
+                logger.warn("federation: lost the directory of the parent resolver %s", parent_addr_);
+                parent_site_ = resolver::FederationSite();
+            }
+
+            std::set<std::string> published, subscribed;
+            for(auto &x : node_links_)
+            {
+                published.insert(x.second.publishes_topic.begin(), x.second.publishes_topic.end());
+                subscribed.insert(x.second.subscribes_topic.begin(), x.second.subscribes_topic.end());
+            }
+            for(auto &topic_name : subscribed)
+            {
+                if(published.count(topic_name)) continue;
+                const b0::message::resolv::FederationEntry *e = remoteEntry(topic_name, true);
+                if(e && !e->sock_addrs.empty())
+                    bridges[topic_name] = e->sock_addrs[0];
+            }
+        }
+        {
+            boost::mutex::scoped_lock lock(bridges_mutex_);
+            bridges_.swap(bridges);
+        }
+
+        try
+        {
+            sleepUSec(federation_interval_);
+        }
+        catch(boost::thread_interrupted &)
+        {
+            break;
+        }
+    }
+
+    if(parent_cli)
+        parent_cli->cleanup();
+    logger.trace("federation: finished");
+}
+
+void Resolver::bridgeLoop()
+{
+    set_thread_name("bridge");
+    b0::logger::LocalLogger logger(this);
+    logger.trace("bridge: started");
+
+    zmq::context_t &context_ = *reinterpret_cast<zmq::context_t*>(getContext());
+
+    // a SUB socket connected to the proxy of the other site, and a PUB socket connected to ours
+    struct Bridge
+    {
+        std::string addr;
+        std::unique_ptr<zmq::socket_t> sub, pub;
+    };
+    std::map<std::string, Bridge> bridges;
+    std::vector<zmq::pollitem_t> items;
+    std::vector<Bridge*> polled;
+    try
+    {
+        while(true)
+        {
+            boost::this_thread::interruption_point();
+
+            std::map<std::string, std::string> wanted;
+            {
+                boost::mutex::scoped_lock lock(bridges_mutex_);
+                wanted = bridges_;
+            }
+            for(auto it = bridges.begin(); it != bridges.end(); )
+            {
+                auto w = wanted.find(it->first);
+                if(w == wanted.end() || w->second != it->second.addr)
+                {
+                    logger.info("bridge: stopped bridging topic '%s'", it->first);
+                    it = bridges.erase(it);
+                }
+                else ++it;
+            }
+            for(auto &w : wanted)
+            {
+                if(bridges.count(w.first)) continue;
+                Bridge &b = bridges[w.first];
+                b.addr = w.second;
+                int linger = 0;
+                b.sub.reset(new zmq::socket_t(context_, ZMQ_SUB));
+                b.sub->setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+                b.sub->connect(b.addr);
+                // the whole header0 line, for an exact match (see Subscriber::connect()):
+                std::string filter = w.first + "\n";
+                b.sub->setsockopt(ZMQ_SUBSCRIBE, filter.data(), filter.size());
+                b.pub.reset(new zmq::socket_t(context_, ZMQ_PUB));
+                b.pub->setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+                b.pub->connect(getXSUBSocketAddress(w.first));
+                logger.info("bridge: bridging topic '%s' from %s", w.first, b.addr);
+            }
+
+            if(bridges.empty())
+            {
+                boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+                continue;
+            }
+
+            items.clear();
+            polled.clear();
+            for(auto &x : bridges)
+            {
+                items.push_back({static_cast<void*>(*x.second.sub), 0, ZMQ_POLLIN, 0});
+                polled.push_back(&x.second);
+            }
+            zmq::poll(items.data(), items.size(), 100);
+            for(size_t i = 0; i < items.size(); i++)
+            {
+                if(!(items[i].revents & ZMQ_POLLIN)) continue;
+                zmq::message_t frame;
+                while(polled[i]->sub->recv(&frame, ZMQ_DONTWAIT))
+                {
+                    bool more = frame.more();
+                    polled[i]->pub->send(frame, more ? ZMQ_SNDMORE : 0);
+                    while(more)
+                    {
+                        polled[i]->sub->recv(&frame);
+                        more = frame.more();
+                        polled[i]->pub->send(frame, more ? ZMQ_SNDMORE : 0);
+                    }
+                }
+            }
+        }
+    }
+    catch(boost::thread_interrupted &)
+    {
+    }
+    catch(zmq::error_t &ex)
+    {
+        logger.error("bridge: %s", ex.what());
+    }
+
+    logger.trace("bridge: finished");
+}
+
 void Resolver::handleGetGraph(const b0::message::graph::GetGraphRequest &req, b0::message::graph::GetGraphResponse &resp)
 {
-    getGraph(resp.graph);
+    if(req.if_newer_than_version >= 0 && req.if_newer_than_version == graph_version_)
+    {
+        resp.graph.version = graph_version_;
+        resp.not_modified = true;
+        return;
+    }
+
+    if(req.filtered())
+    {
+        getGraph(req, resp.graph);
+        return;
+    }
+
+    boost::mutex::scoped_lock lock(graph_cache_mutex_);
+    if(!graph_cache_valid_)
+    {
+        graph_cache_ = b0::message::graph::Graph();
+        getGraph(graph_cache_);
+        graph_cache_valid_ = true;
+    }
+    resp.graph = graph_cache_;
 }
 
 void Resolver::getGraph(b0::message::graph::Graph &graph)
 {
+    graph.version = graph_version_;
     for(auto x : nodes_by_name_)
     {
         b0::message::graph::GraphNode n;
         n.host_id = x.second->host_id;
         n.process_id = x.second->process_id;
         n.node_name = x.second->name;
+        n.stats = x.second->stats;
         graph.nodes.push_back(n);
     }
-    for(auto x : node_publishes_topic_)
+    for(auto &x : node_links_)
     {
-        b0::message::graph::GraphLink l;
-        l.node_name = x.first;
-        l.other_name = x.second;
-        l.reversed = false;
-        graph.node_topic.push_back(l);
+        for(auto &y : x.second.publishes_topic)
+            graph.node_topic.push_back(graphLink(x.first, y, false));
+        for(auto &y : x.second.subscribes_topic)
+            graph.node_topic.push_back(graphLink(x.first, y, true));
+        for(auto &y : x.second.offers_service)
+            graph.node_service.push_back(graphLink(x.first, y, false));
+        for(auto &y : x.second.uses_service)
+            graph.node_service.push_back(graphLink(x.first, y, true));
     }
-    for(auto x : node_subscribes_topic_)
+}
+
+void Resolver::getGraph(const b0::message::graph::GetGraphRequest &req, b0::message::graph::Graph &graph)
+{
+    using b0::message::graph::GetGraphRequest;
+
+    graph.version = graph_version_;
+    std::set<std::string> nodes;
+    auto collect = [&](std::unordered_set<std::string> resolver::NodeLinks::*links, bool topic, bool reversed, std::vector<b0::message::graph::GraphLink> &out) {
+        if(!req.selects(topic, reversed)) return;
+        const std::string &pattern = topic ? req.topic_name : req.service_name;
+        auto add = [&](const std::string &node_name, const std::string &other_name) {
+            out.push_back(graphLink(node_name, other_name, reversed));
+            nodes.insert(node_name);
+        };
+        if(!pattern.empty() && pattern.find('*') == std::string::npos)
+        {
+            auto it = links_by_other_.find(pattern);
+            if(it == links_by_other_.end()) return;
+            for(auto &node_name : it->second.*links)
+                if(GetGraphRequest::matches(req.node_name, node_name)) add(node_name, pattern);
+        }
+        else if(!req.node_name.empty() && req.node_name.find('*') == std::string::npos)
+        {
+            auto it = node_links_.find(req.node_name);
+            if(it == node_links_.end()) return;
+            for(auto &other_name : it->second.*links)
+                if(GetGraphRequest::matches(pattern, other_name)) add(req.node_name, other_name);
+        }
+        else
+        {
+            for(auto &x : node_links_)
+            {
+                if(!GetGraphRequest::matches(req.node_name, x.first)) continue;
+                for(auto &other_name : x.second.*links)
+                    if(GetGraphRequest::matches(pattern, other_name)) add(x.first, other_name);
+            }
+        }
+    };
+    collect(&resolver::NodeLinks::publishes_topic, true, false, graph.node_topic);
+    collect(&resolver::NodeLinks::subscribes_topic, true, true, graph.node_topic);
+    collect(&resolver::NodeLinks::offers_service, false, false, graph.node_service);
+    collect(&resolver::NodeLinks::uses_service, false, true, graph.node_service);
+
+    // with a filter on the links, only the nodes of the links; otherwise the nodes matching
+    auto addNode = [&](const resolver::NodeEntry *e) {
+        b0::message::graph::GraphNode n;
+        n.host_id = e->host_id;
+        n.process_id = e->process_id;
+        n.node_name = e->name;
+        n.stats = e->stats;
+        graph.nodes.push_back(n);
+    };
+    if(!req.topic_name.empty() || !req.service_name.empty() || !req.link_type.empty())
     {
-        b0::message::graph::GraphLink l;
-        l.node_name = x.first;
-        l.other_name = x.second;
-        l.reversed = true;
-        graph.node_topic.push_back(l);
+        for(auto &node_name : nodes)
+        {
+            auto it = nodes_by_name_.find(node_name);
+            if(it != nodes_by_name_.end()) addNode(it->second);
+        }
     }
-    for(auto x : node_offers_service_)
+    else if(req.node_name.find('*') == std::string::npos)
     {
-        b0::message::graph::GraphLink l;
-        l.node_name = x.first;
-        l.other_name = x.second;
-        l.reversed = false;
-        graph.node_service.push_back(l);
+        auto it = nodes_by_name_.find(req.node_name);
+        if(it != nodes_by_name_.end()) addNode(it->second);
     }
-    for(auto x : node_uses_service_)
+    else
     {
-        b0::message::graph::GraphLink l;
-        l.node_name = x.first;
-        l.other_name = x.second;
-        l.reversed = true;
-        graph.node_service.push_back(l);
+        // (nodes_by_name_ is sorted: the names with the prefix of the pattern are a range of it)
+        std::string prefix = req.node_name.substr(0, req.node_name.find('*'));
+        for(auto it = nodes_by_name_.lower_bound(prefix); it != nodes_by_name_.end() && boost::starts_with(it->first, prefix); ++it)
+            if(GetGraphRequest::matches(req.node_name, it->first)) addNode(it->second);
     }
 }
 
 void Resolver::onGraphChanged()
 {
-    b0::message::graph::Graph g;
-    getGraph(g);
-    graph_pub_.publish(g);
+    if(defer_graph_changes_)
+    {
+        graph_changed_ = true;
+        return;
+    }
+    // (the other threads, e.g. the workers of setServiceThreads(), do not use the publishers)
+    if(!isNodeThread() || (graph_change_interval_ > 0 && hardwareTimeUSec() - last_graph_publish_usec_ < graph_change_interval_))
+    {
+        // published by flushGraphChanges(), together with the ones which follow
+        graph_publish_pending_ = true;
+        return;
+    }
+    publishGraphChanges();
+}
+
+void Resolver::publishGraphChanges()
+{
+    graph_publish_pending_ = false;
+    last_graph_publish_usec_ = hardwareTimeUSec();
+    graph_delta_.version = ++graph_version_;
+    graph_delta_pub_.publish(graph_delta_);
+    graph_delta_ = b0::message::graph::GraphDelta();
+    invalidateGraphCache();
+    if(graph_snapshots_ || graph_change_interval_ > 0)
+    {
+        // the snapshot fills the cache for the requests which follow it; with throttling, the
+        // graph served stays the one of this version until the next publication
+        boost::mutex::scoped_lock lock(graph_cache_mutex_);
+        getGraph(graph_cache_);
+        graph_cache_valid_ = true;
+        if(graph_snapshots_)
+            graph_pub_.publish(graph_cache_);
+    }
+}
+
+void Resolver::flushGraphChanges()
+{
+    if(!graph_publish_pending_ || hardwareTimeUSec() - last_graph_publish_usec_ < graph_change_interval_)
+        return;
+    boost::unique_lock<boost::shared_mutex> lock(state_mutex_);
+    if(graph_publish_pending_)
+        publishGraphChanges();
+}
+
+void Resolver::flushDeferred()
+{
+    std::vector<std::pair<logger::Level, std::string> > log;
+    std::vector<b0::message::resolv::ParamUpdate> updates;
+    {
+        boost::mutex::scoped_lock lock(deferred_mutex_);
+        log.swap(deferred_log_);
+        updates.swap(deferred_param_updates_);
+    }
+    for(auto &entry : log)
+        Node::log(entry.first, entry.second);
+    for(auto &update : updates)
+        param_pub_.publish(update);
+}
+
+void Resolver::log(logger::Level level, const std::string &message) const
+{
+    if(isNodeThread())
+    {
+        Node::log(level, message);
+        return;
+    }
+    if(!isLevelEnabled(level)) return;
+    boost::mutex::scoped_lock lock(deferred_mutex_);
+    deferred_log_.emplace_back(level, message);
+}
+
+void Resolver::setGraphChangeInterval(int64_t interval)
+{
+    graph_change_interval_ = interval;
+}
+
+int64_t Resolver::getGraphChangeInterval() const
+{
+    return graph_change_interval_;
+}
+
+void Resolver::invalidateGraphCache()
+{
+    boost::mutex::scoped_lock lock(graph_cache_mutex_);
+    graph_cache_ = b0::message::graph::Graph();
+    graph_cache_valid_ = false;
+}
+
+b0::message::graph::GraphLink Resolver::graphLink(const std::string &node_name, const std::string &other_name, bool reversed)
+{
+    b0::message::graph::GraphLink l;
+    l.node_name = node_name;
+    l.other_name = other_name;
+    l.reversed = reversed;
+    return l;
+}
+
+bool Resolver::addLink(const std::string &node_name, std::unordered_set<std::string> resolver::NodeLinks::*links, const std::string &other_name)
+{
+    if(!(node_links_[node_name].*links).insert(other_name).second)
+        return false;
+    (links_by_other_[other_name].*links).insert(node_name);
+    return true;
+}
+
+bool Resolver::removeLink(const std::string &node_name, std::unordered_set<std::string> resolver::NodeLinks::*links, const std::string &other_name)
+{
+    auto it = node_links_.find(node_name);
+    if(it == node_links_.end() || !(it->second.*links).erase(other_name))
+        return false;
+    if(it->second.empty())
+        node_links_.erase(it);
+    auto it2 = links_by_other_.find(other_name);
+    if(it2 != links_by_other_.end())
+    {
+        (it2->second.*links).erase(node_name);
+        if(it2->second.empty())
+            links_by_other_.erase(it2);
+    }
+    return true;
+}
+
+void Resolver::setGraphSnapshots(bool enabled)
+{
+    graph_snapshots_ = enabled;
+}
+
+bool Resolver::getGraphSnapshots() const
+{
+    return graph_snapshots_;
 }
 
 void Resolver::heartbeatSweeper()
@@ -579,6 +2293,7 @@ void Resolver::heartbeatSweeper()
     while(!shutdownRequested())
     {
         resolver::Client resolv_cli(this);
+        resolv_cli.setResolverAddress(resolv_addr_);
         resolv_cli.init();
 
         try
@@ -1,14 +1,54 @@
 #include <b0/service_client.h>
 #include <b0/node.h>
+#include <b0/exceptions.h>
+#include <b0/utils/profiler.h>
+#include <b0/utils/env.h>
+#include <b0/utils/startup_trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#include <boost/algorithm/string/join.hpp>
 
 #include <zmq.hpp>
 
 namespace b0
 {
 
+//! Time after which a pooled connection is not used anymore (as with the service cache)
+static const std::chrono::seconds pooled_connection_ttl{30};
+
+//! A connection of a service client cleaned up, kept for the next one (see b0::setServiceClientPool())
+struct PooledConnection
+{
+    PooledConnection() = default;
+    PooledConnection(PooledConnection &&) = default;
+    PooledConnection & operator=(PooledConnection &&) = default;
+
+    ~PooledConnection()
+    {
+        // a connection dropped by the pool must not hold the context back:
+        if(!socket) return;
+        int linger = 0;
+        socket->setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+    }
+
+    std::unique_ptr<zmq::socket_t> socket;
+    std::vector<std::string> remote_addrs;
+    uint64_t last_correlation_id;
+    std::chrono::steady_clock::time_point released;
+};
+
+//! The pooled connections, by ZeroMQ context and key (see ServiceClient::pool_key_)
+static std::map<std::pair<void*, std::string>, std::vector<PooledConnection> > pooled_connections;
+
+static boost::mutex pooled_connections_mutex;
+
 ServiceClient::ServiceClient(Node *node, const std::string &service_name, bool managed, bool notify_graph)
-    : Socket(node, ZMQ_REQ, service_name, managed),
-      notify_graph_(notify_graph)
+    : Socket(node, ZMQ_DEALER, service_name, managed),
+      notify_graph_(notify_graph),
+      lazy_(notify_graph && b0::env::getBool("B0_LAZY_CONNECT"))
 {
 }
 
@@ -24,19 +64,31 @@ void ServiceClient::log(logger::Level level, const std::string &message) const
 
 void ServiceClient::init()
 {
-    if(Global::getInstance().remapServiceName(getNode(), orig_name_, name_))
-        info("Service name '%s' remapped to '%s'", orig_name_, name_);
+    StartupTrace *startup_trace = node_.startupTrace();
+    {
+        StartupTrace::Scope scope(startup_trace, "remap", orig_name_);
+        if(Global::getInstance().remapServiceName(getNode(), orig_name_, name_))
+            info("Service name '%s' remapped to '%s'", orig_name_, name_);
+    }
 
-    resolve();
-    connect();
+    if(!lazy_)
+    {
+        // (resolves the service, then connects)
+        StartupTrace::Scope scope(startup_trace, "connect", name_);
+        connectNow();
+    }
 
     if(notify_graph_)
+    {
+        StartupTrace::Scope scope(startup_trace, "notify", name_);
         node_.notifyService(name_, true, true);
+    }
 }
 
 void ServiceClient::cleanup()
 {
-    disconnect();
+    if(connected_.exchange(false) && !releasePooledConnection())
+        disconnect();
 
     if(notify_graph_)
         node_.notifyService(name_, true, false);
@@ -49,20 +101,626 @@ std::string ServiceClient::getServiceName()
 
 void ServiceClient::call(const std::string &req, std::string &rep)
 {
-    writeRaw(req);
-    readRaw(rep);
+    std::string reptype;
+    call(req, "", rep, reptype);
 }
 
 void ServiceClient::call(const std::string &req, const std::string &reqtype, std::string &rep, std::string &reptype)
 {
+    if(response_cache_.enabled())
+    {
+        std::vector<b0::message::MessagePart> reqparts(1), repparts;
+        reqparts[0].payload = req;
+        reqparts[0].content_type = reqtype;
+        callCached(reqparts, repparts);
+        if(repparts.empty())
+            throw exception::EnvelopeDecodeError();
+        rep.swap(repparts[0].payload);
+        reptype.swap(repparts[0].content_type);
+        return;
+    }
+    if(ServiceClient *replica = pickReplica()) {replica->call(req, reqtype, rep, reptype); return;}
+    boost::recursive_mutex::scoped_lock lock(mutex_);
     writeRaw(req, reqtype);
-    readRaw(rep, reptype);
+    std::vector<b0::message::MessagePart> parts;
+    readReply(parts);
+    if(parts.empty())
+        throw exception::EnvelopeDecodeError();
+    rep.swap(parts[0].payload);
+    reptype.swap(parts[0].content_type);
 }
 
 void ServiceClient::call(const std::vector<b0::message::MessagePart> &reqparts, std::vector<b0::message::MessagePart> &repparts)
 {
+    if(response_cache_.enabled()) {callCached(reqparts, repparts); return;}
+    if(ServiceClient *replica = pickReplica()) {replica->call(reqparts, repparts); return;}
+    boost::recursive_mutex::scoped_lock lock(mutex_);
     writeRaw(reqparts);
-    readRaw(repparts);
+    readReply(repparts);
+}
+
+void ServiceClient::callCached(const std::vector<b0::message::MessagePart> &reqparts, std::vector<b0::message::MessagePart> &repparts)
+{
+    std::string key = ResponseCache::key(reqparts);
+    ResponseCache::Entry entry;
+    bool fresh = false, found = response_cache_.find(key, entry, fresh);
+    if(found && fresh)
+    {
+        repparts = std::move(entry.parts);
+        return;
+    }
+
+    ServiceClient *target = pickReplica();
+    if(!target) target = this;
+    boost::recursive_mutex::scoped_lock lock(target->mutex_);
+    if(found)
+        target->if_none_match_ = entry.etag;
+    target->writeRaw(reqparts);
+    target->readReply(repparts);
+
+    const auto &headers = target->reply_envelope_.headers;
+    if(found && headers.find("Not-modified") != headers.end())
+    {
+        response_cache_.touch(key);
+        repparts = std::move(entry.parts);
+        return;
+    }
+    auto etag = headers.find("Etag");
+    if(etag != headers.end())
+        response_cache_.insert(key, repparts, etag->second);
+}
+
+void ServiceClient::setResponseCache(size_t max_entries, long ttl, size_t max_bytes)
+{
+    response_cache_.setLimits(max_entries, ttl, max_bytes);
+}
+
+const ResponseCache & ServiceClient::getResponseCache() const
+{
+    return response_cache_;
+}
+
+void ServiceClient::callBatch(const std::vector<b0::message::MessagePart> &reqs, std::vector<b0::message::MessagePart> &reps)
+{
+    reps.clear();
+    if(reqs.empty()) return;
+    if(ServiceClient *replica = pickReplica()) {replica->callBatch(reqs, reps); return;}
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    batch_size_ = reqs.size();
+    writeRaw(reqs);
+    readReply(reps);
+    // readReply() returns as soon as this reply is read, so reply_envelope_ still holds it
+    if(reply_envelope_.headers.find("Batch") == reply_envelope_.headers.end() || reps.size() != reqs.size())
+        throw exception::Exception((boost::format("Service '%s' did not serve the batch of %d requests") % name_ % reqs.size()).str());
+}
+
+void ServiceClient::callAsync(const std::vector<b0::message::MessagePart> &reqparts, CallbackParts callback)
+{
+    if(ServiceClient *replica = pickReplica()) {replica->callAsync(reqparts, callback); return;}
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    writeRaw(reqparts);
+    addPendingCall(PendingCall{last_correlation_id_, [callback](std::vector<b0::message::MessagePart> &parts) {callback(parts);}});
+}
+
+std::future<std::vector<b0::message::MessagePart> > ServiceClient::callAsync(const std::vector<b0::message::MessagePart> &reqparts)
+{
+    if(ServiceClient *replica = pickReplica()) return replica->callAsync(reqparts);
+    std::shared_ptr<std::promise<std::vector<b0::message::MessagePart> > > promise = std::make_shared<std::promise<std::vector<b0::message::MessagePart> > >();
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    writeRaw(reqparts);
+    addPendingCall(PendingCall{last_correlation_id_, [promise](std::vector<b0::message::MessagePart> &parts) {promise->set_value(std::move(parts));},
+            {}, [promise](std::exception_ptr ex) {promise->set_exception(ex);}});
+    return promise->get_future();
+}
+
+void ServiceClient::callStream(const std::vector<b0::message::MessagePart> &reqparts, CallbackStreamChunk callback, size_t window)
+{
+    if(ServiceClient *replica = pickReplica()) {replica->callStream(reqparts, callback, window); return;}
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    stream_window_ = std::max<size_t>(1, window);
+    writeRaw(reqparts);
+    stream_window_ = 0;
+
+    // as in readReply(), the entry stays in the queue if the stream is interrupted
+    uint64_t id = last_correlation_id_;
+    addPendingCall(PendingCall{id, Completion()});
+    auto deadline = pending_.back().deadline;
+    size_t consumed = 0;
+    for(;;)
+    {
+        if(!waitReply(deadline))
+            throw exception::DeadlineExceeded(name_);
+        std::vector<b0::message::MessagePart> parts;
+        auto it = readAnyReply(parts);
+        if(it == pending_.end())
+            continue;
+        if(it->id != id)
+        {
+            Completion completion = std::move(it->completion);
+            removePendingCall(it);
+            if(completion)
+                completion(parts);
+            continue;
+        }
+
+        const auto &headers = reply_envelope_.headers;
+        bool plain_reply = headers.find("Stream-seq") == headers.end();
+        bool end = plain_reply || headers.find("Stream-end") != headers.end();
+        if(plain_reply && headers.count("Busy"))
+        {
+            removePendingCall(it);
+            throw exception::ServerBusy(name_);
+        }
+        auto stream_error = headers.find("Stream-error");
+        if(stream_error != headers.end())
+        {
+            std::string what = stream_error->second;
+            removePendingCall(it);
+            throw exception::Exception("Stream failed: " + what);
+        }
+        if(end)
+            removePendingCall(it);
+        if(end && !plain_reply && parts.empty())
+            return;
+
+        try
+        {
+            callback(parts);
+        }
+        catch(...)
+        {
+            if(!end)
+            {
+                writeStreamControl(id, "Stream-cancel", "1");
+                for(auto it = pending_.begin(); it != pending_.end(); ++it)
+                    if(it->id == id) {removePendingCall(it); break;}
+            }
+            throw;
+        }
+        if(end)
+            return;
+
+        // give credit back in batches, to not send a message per chunk
+        if(++consumed >= std::max<size_t>(1, window / 2))
+        {
+            writeStreamControl(id, "Stream-credit", std::to_string(consumed));
+            consumed = 0;
+        }
+    }
+}
+
+void ServiceClient::writeStreamControl(uint64_t id, const std::string &header, const std::string &value)
+{
+    b0::message::MessageEnvelope env;
+    env.header0 = name_;
+    env.headers["Correlation-id"] = std::to_string(id);
+    env.headers[header] = value;
+    writeRaw(env);
+}
+
+void ServiceClient::setCallDeadline(long ms)
+{
+    call_deadline_ = ms;
+    for(auto &replica : replicas_)
+        replica->setCallDeadline(ms);
+}
+
+long ServiceClient::getCallDeadline() const
+{
+    return call_deadline_;
+}
+
+void ServiceClient::setHedging(bool enabled)
+{
+    hedging_ = enabled;
+}
+
+bool ServiceClient::getHedging() const
+{
+    return hedging_;
+}
+
+const LatencyHistogram & ServiceClient::getCallLatency() const
+{
+    return call_latency_;
+}
+
+uint64_t ServiceClient::getHedgedRequests() const
+{
+    return hedged_requests_.load();
+}
+
+void ServiceClient::writeRaw(const b0::message::MessageEnvelope &env)
+{
+    if(hedging_)
+        last_request_ = env;
+    Socket::writeRaw(env);
+}
+
+size_t ServiceClient::getPendingCalls() const
+{
+    size_t n = num_pending_.load();
+    for(auto &replica : replicas_)
+        n += replica->getPendingCalls();
+    return n;
+}
+
+void ServiceClient::setLoadBalancing(LoadBalancing mode)
+{
+    load_balancing_ = mode;
+}
+
+LoadBalancing ServiceClient::getLoadBalancing() const
+{
+    return load_balancing_;
+}
+
+std::vector<std::string> ServiceClient::getRemoteAddresses() const
+{
+    return remote_addrs_;
+}
+
+void ServiceClient::setLazy(bool lazy)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setLazy() must be called before init()");
+    lazy_ = lazy;
+}
+
+bool ServiceClient::getLazy() const
+{
+    return lazy_;
+}
+
+bool ServiceClient::isConnected() const
+{
+    return connected_.load();
+}
+
+void ServiceClient::connectNow()
+{
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    if(connected_.load()) return;
+
+    pool_key_ = name_ + "\n" + remote_addr_;
+    if(!acquirePooledConnection())
+    {
+        resolve();
+        connect();
+    }
+    connected_.store(true);
+}
+
+bool ServiceClient::acquirePooledConnection()
+{
+    if(Global::getInstance().getServiceClientPool() <= 0) return false;
+
+    PooledConnection conn;
+    {
+        boost::mutex::scoped_lock lock(pooled_connections_mutex);
+        auto it = pooled_connections.find(std::make_pair(node_.getContext(), pool_key_));
+        if(it == pooled_connections.end()) return false;
+        // the most recently used first; the older ones are closed (the servers may have moved)
+        std::vector<PooledConnection> &conns = it->second;
+        auto now = std::chrono::steady_clock::now();
+        while(!conns.empty() && !conn.socket)
+        {
+            if(now - conns.back().released < pooled_connection_ttl)
+                conn = std::move(conns.back());
+            conns.pop_back();
+        }
+        if(conns.empty())
+            pooled_connections.erase(it);
+    }
+    if(!conn.socket) return false;
+
+    swapZMQSocket(*conn.socket);
+    remote_addrs_ = conn.remote_addrs;
+    remote_addr_ = remote_addrs_[0];
+    // the replies to the calls of the previous client, if they ever arrive, are then discarded:
+    last_correlation_id_ = std::max(last_correlation_id_, conn.last_correlation_id);
+    trace("Reusing a pooled connection to %s", boost::algorithm::join(remote_addrs_, ", "));
+    return true;
+}
+
+bool ServiceClient::releasePooledConnection()
+{
+    int max_idle = Global::getInstance().getServiceClientPool();
+    if(max_idle <= 0 || !replicas_.empty() || remote_addrs_.empty()) return false;
+
+    PooledConnection conn;
+    conn.socket.reset(new zmq::socket_t(*reinterpret_cast<zmq::context_t*>(node_.getContext()), ZMQ_DEALER));
+    swapZMQSocket(*conn.socket);
+    conn.remote_addrs = remote_addrs_;
+    conn.last_correlation_id = last_correlation_id_;
+    conn.released = std::chrono::steady_clock::now();
+
+    boost::mutex::scoped_lock lock(pooled_connections_mutex);
+    std::vector<PooledConnection> &conns = pooled_connections[std::make_pair(node_.getContext(), pool_key_)];
+    if(conns.size() >= size_t(max_idle))
+        conns.erase(conns.begin());
+    conns.push_back(std::move(conn));
+    return true;
+}
+
+void ServiceClient::closePooledConnections(void *context)
+{
+    boost::mutex::scoped_lock lock(pooled_connections_mutex);
+    for(auto it = pooled_connections.begin(); it != pooled_connections.end(); )
+    {
+        if(it->first.first == context)
+            it = pooled_connections.erase(it);
+        else ++it;
+    }
+}
+
+bool ServiceClient::waitReplies(long timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    auto remaining = [&]() -> long {
+        if(timeout < 0) return -1;
+        return std::max<long>(0, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count());
+    };
+    for(auto &replica : replicas_)
+        if(!replica->waitReplies(remaining()))
+            return false;
+
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    for(;;)
+    {
+        expirePendingCalls();
+        if(pending_.empty()) break;
+        long wait = -1;
+        if(timeout >= 0)
+        {
+            wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if(wait < 0) break;
+        }
+        // wake up to drop the calls which expire in the meantime
+        long next_deadline = timeToNextDeadline();
+        bool until_deadline = next_deadline >= 0 && (wait < 0 || next_deadline < wait);
+        if(until_deadline) wait = next_deadline;
+        if(!poll(wait))
+        {
+            if(until_deadline) continue;
+            break;
+        }
+        readPendingReply();
+    }
+    return pending_.empty();
+}
+
+void ServiceClient::spinOnce()
+{
+    for(auto &replica : replicas_)
+        replica->spinOnce();
+
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    while(!pending_.empty() && poll())
+        readPendingReply();
+    expirePendingCalls();
+}
+
+bool ServiceClient::hasCallback() const
+{
+    for(auto &replica : replicas_)
+        if(replica->hasCallback())
+            return true;
+    return num_pending_.load() > 0;
+}
+
+size_t ServiceClient::getQueueDepth() const
+{
+    return getPendingCalls();
+}
+
+ServiceClient * ServiceClient::pickReplica()
+{
+    if(!connected_.load())
+    {
+        debug("Connecting on the first call");
+        connectNow();
+    }
+
+    if(replicas_.empty()) return nullptr;
+
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    size_t n = replicas_.size(), best = next_replica_ % n;
+    for(size_t i = 1; i < n; i++)
+    {
+        size_t j = (next_replica_ + i) % n;
+        if(replicas_[j]->getPendingCalls() < replicas_[best]->getPendingCalls())
+            best = j;
+    }
+    next_replica_ = best + 1;
+    return replicas_[best].get();
+}
+
+void ServiceClient::prepareEnvelope(b0::message::MessageEnvelope &env)
+{
+    env.headers["Correlation-id"] = std::to_string(++last_correlation_id_);
+    request_span_ = tracing::Span();
+    if(tracing::startSpan(request_span_, tracing::SpanKind::Client, *this))
+        tracing::inject(env.headers, request_span_);
+    if(stream_window_)
+        env.headers["Stream-window"] = std::to_string(stream_window_);
+    if(batch_size_)
+        env.headers["Batch"] = std::to_string(batch_size_);
+    batch_size_ = 0;
+    if(!if_none_match_.empty())
+        env.headers["If-none-match"] = if_none_match_;
+    if_none_match_.clear();
+    if(call_deadline_ >= 0)
+        env.headers["Deadline"] = std::to_string(node_.timeUSec() + call_deadline_ * 1000);
+}
+
+bool ServiceClient::canWriteFrameInPlace(size_t payload_size) const
+{
+    return !hedging_ && Socket::canWriteFrameInPlace(payload_size);
+}
+
+void ServiceClient::readReply(std::vector<b0::message::MessagePart> &parts)
+{
+    // after a timeout, the entry of this call stays in the queue, so that its
+    // reply, if it ever arrives, is discarded instead of being taken for the
+    // reply of another call
+    using time_point = std::chrono::steady_clock::time_point;
+    uint64_t id = last_correlation_id_, hedge_id = 0;
+    addPendingCall(PendingCall{id, Completion()});
+    time_point t0 = std::chrono::steady_clock::now(), deadline = pending_.back().deadline, hedge_time;
+    // send the request again if it is slower than 95% of the calls; the DEALER
+    // socket writes it to the next server
+    if(hedging_ && replicas_.empty() && remote_addrs_.size() > 1 && call_latency_.count() >= 20)
+        hedge_time = t0 + std::chrono::microseconds(call_latency_.percentile(95));
+    for(;;)
+    {
+        time_point wake = deadline;
+        if(hedge_time != time_point() && (wake == time_point() || hedge_time < wake))
+            wake = hedge_time;
+        if(!waitReply(wake))
+        {
+            if(deadline != time_point() && std::chrono::steady_clock::now() >= deadline)
+                throw exception::DeadlineExceeded(name_);
+            b0::message::MessageEnvelope env(last_request_);
+            hedge_id = ++last_correlation_id_;
+            env.headers["Correlation-id"] = std::to_string(hedge_id);
+            Socket::writeRaw(env);
+            addPendingCall(PendingCall{hedge_id, Completion(), deadline});
+            hedged_requests_++;
+            hedge_time = time_point();
+            continue;
+        }
+        auto it = readAnyReply(parts);
+        if(it == pending_.end())
+            continue;
+        bool own_reply = it->id == id || (hedge_id && it->id == hedge_id);
+        Completion completion = std::move(it->completion);
+        removePendingCall(it);
+        if(own_reply)
+        {
+            // the reply to the other copy of the request will be discarded
+            if(hedge_id)
+                for(auto it = pending_.begin(); it != pending_.end(); ++it)
+                    if(it->id == id || it->id == hedge_id) {removePendingCall(it); break;}
+            if(reply_envelope_.headers.count("Busy"))
+                throw exception::ServerBusy(name_);
+            call_latency_.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count());
+            return;
+        }
+        if(completion)
+            completion(parts);
+    }
+}
+
+bool ServiceClient::waitReply(std::chrono::steady_clock::time_point until)
+{
+    if(until == std::chrono::steady_clock::time_point()) return true;
+    for(;;)
+    {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(until - std::chrono::steady_clock::now()).count();
+        if(us <= 0) return false;
+        if(poll((us + 999) / 1000)) return true;
+    }
+}
+
+void ServiceClient::expirePendingCalls()
+{
+    auto now = std::chrono::steady_clock::now();
+    std::vector<function<void(std::exception_ptr)> > failed;
+    for(auto it = pending_.begin(); it != pending_.end(); )
+    {
+        if(it->deadline == std::chrono::steady_clock::time_point() || now < it->deadline)
+        {
+            ++it;
+            continue;
+        }
+        debug("Call %d not answered before its deadline", it->id);
+        if(it->fail)
+            failed.push_back(std::move(it->fail));
+        it = pending_.erase(it);
+    }
+    num_pending_.store(pending_.size());
+    for(auto &fail : failed)
+        fail(std::make_exception_ptr(exception::DeadlineExceeded(name_)));
+}
+
+long ServiceClient::timeToNextDeadline() const
+{
+    long ms = -1;
+    auto now = std::chrono::steady_clock::now();
+    for(auto &call : pending_)
+    {
+        if(call.deadline == std::chrono::steady_clock::time_point()) continue;
+        long us = std::max<long>(0, std::chrono::duration_cast<std::chrono::microseconds>(call.deadline - now).count());
+        long call_ms = (us + 999) / 1000;
+        if(ms < 0 || call_ms < ms) ms = call_ms;
+    }
+    return ms;
+}
+
+void ServiceClient::readPendingReply()
+{
+    std::vector<b0::message::MessagePart> parts;
+    auto it = readAnyReply(parts);
+    if(it == pending_.end())
+        return;
+    Completion completion = std::move(it->completion);
+    function<void(std::exception_ptr)> fail = std::move(it->fail);
+    removePendingCall(it);
+    // a call rejected by an overloaded server (an asynchronous call without an error
+    // callback gets the empty reply):
+    if(fail && reply_envelope_.headers.count("Busy"))
+    {
+        fail(std::make_exception_ptr(exception::ServerBusy(name_)));
+        return;
+    }
+    if(completion)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        {
+            CallbackProfiler profiler(*this);
+            completion(parts);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        getCounters().callback_duration.record(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+    }
+}
+
+void ServiceClient::addPendingCall(PendingCall &&call)
+{
+    if(call_deadline_ >= 0 && call.deadline == std::chrono::steady_clock::time_point())
+        call.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(call_deadline_);
+    // hedged requests are sent again without prepareEnvelope(), and have no span of their own
+    if(call.id == last_correlation_id_ && request_span_.start_time)
+        call.span = std::move(request_span_);
+    request_span_ = tracing::Span();
+    pending_.push_back(std::move(call));
+    num_pending_.store(pending_.size());
+}
+
+void ServiceClient::removePendingCall(std::deque<PendingCall>::iterator it)
+{
+    tracing::endSpan(it->span);
+    pending_.erase(it);
+    num_pending_.store(pending_.size());
+}
+
+std::deque<ServiceClient::PendingCall>::iterator ServiceClient::readAnyReply(std::vector<b0::message::MessagePart> &parts)
+{
+    b0::message::MessageEnvelope &env = reply_envelope_;
+    readRaw(env);
+    parts.swap(env.parts);
+
+    auto header = env.headers.find("Correlation-id");
+    if(header == env.headers.end())
+        return pending_.begin();
+
+    // ids start from 1, so a malformed one (parsed as 0) matches no call
+    uint64_t id = std::strtoull(header->second.c_str(), nullptr, 10);
+    for(auto it = pending_.begin(); it != pending_.end(); ++it)
+        if(it->id == id) return it;
+    debug("Discarding reply with unknown correlation id %s", header->second);
+    return pending_.end();
 }
 
 void ServiceClient::resolve()
@@ -70,24 +728,58 @@ void ServiceClient::resolve()
     if(!remote_addr_.empty())
     {
         debug("Skipping resolution because remote address (%s) was given", remote_addr_);
+        remote_addrs_.assign(1, remote_addr_);
         return;
     }
 
-    node_.resolveService(name_, remote_addr_);
+    node_.resolveService(name_, remote_addrs_);
+    remote_addr_ = remote_addrs_[0];
 
-    trace("Resolved address: %s", remote_addr_);
+    trace("Resolved address: %s", boost::algorithm::join(remote_addrs_, ", "));
 }
 
 void ServiceClient::connect()
 {
-    trace("Connecting to %s...", remote_addr_);
-    Socket::connect(remote_addr_);
+    if(load_balancing_ == LoadBalancing::LeastOutstanding && remote_addrs_.size() > 1)
+    {
+        // one connection per server, so that each request goes where it is wanted
+        for(const std::string &addr : remote_addrs_)
+        {
+            std::unique_ptr<ServiceClient> replica(new ServiceClient(&node_, name_, false, false));
+            replica->setRemoteAddress(addr);
+            replica->setEnvelopeFormat(getEnvelopeFormat());
+            replica->setMessageCodec(getMessageCodec());
+            replica->setReadTimeout(getReadTimeout());
+            replica->setWriteTimeout(getWriteTimeout());
+            replica->setCallDeadline(getCallDeadline());
+            replica->init();
+            replicas_.push_back(std::move(replica));
+        }
+        return;
+    }
+
+    for(const std::string &addr : remote_addrs_)
+    {
+        trace("Connecting to %s...", addr);
+        Socket::connect(addr);
+    }
 }
 
 void ServiceClient::disconnect()
 {
-    trace("Disconnecting from %s...", remote_addr_);
-    Socket::disconnect(remote_addr_);
+    if(!replicas_.empty())
+    {
+        for(auto &replica : replicas_)
+            replica->cleanup();
+        replicas_.clear();
+        return;
+    }
+
+    for(const std::string &addr : remote_addrs_)
+    {
+        trace("Disconnecting from %s...", addr);
+        Socket::disconnect(addr);
+    }
 }
 
 } // namespace b0
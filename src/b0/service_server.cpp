@@ -1,5 +1,15 @@
 #include <b0/service_server.h>
 #include <b0/node.h>
+#include <b0/exceptions.h>
+#include <b0/utils/thread_name.h>
+#include <b0/utils/thread_config.h>
+#include <b0/utils/profiler.h>
+#include <b0/utils/tracing.h>
+#include <b0/utils/startup_trace.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
 
 #include <zmq.hpp>
 
@@ -12,7 +22,7 @@ ServiceServer::ServiceServer(Node *node, const std::string &service_name, bool m
 }
 
 ServiceServer::ServiceServer(Node *node, const std::string &service_name, CallbackRaw callback, bool managed, bool notify_graph)
-    : Socket(node, ZMQ_REP, service_name, managed),
+    : Socket(node, ZMQ_ROUTER, service_name, managed),
       notify_graph_(notify_graph),
       bind_addr_(""),
       callback_(callback)
@@ -20,7 +30,7 @@ ServiceServer::ServiceServer(Node *node, const std::string &service_name, Callba
 }
 
 ServiceServer::ServiceServer(Node *node, const std::string &service_name, CallbackRawType callback, bool managed, bool notify_graph)
-    : Socket(node, ZMQ_REP, service_name, managed),
+    : Socket(node, ZMQ_ROUTER, service_name, managed),
       notify_graph_(notify_graph),
       bind_addr_(""),
       callback_with_type_(callback)
@@ -28,7 +38,7 @@ ServiceServer::ServiceServer(Node *node, const std::string &service_name, Callba
 }
 
 ServiceServer::ServiceServer(Node *node, const std::string &service_name, CallbackParts callback, bool managed, bool notify_graph)
-    : Socket(node, ZMQ_REP, service_name, managed),
+    : Socket(node, ZMQ_ROUTER, service_name, managed),
       notify_graph_(notify_graph),
       bind_addr_(""),
       callback_multipart_(callback)
@@ -52,6 +62,7 @@ ServiceServer::ServiceServer(Node *node, const std::string &service_name, void (
 
 ServiceServer::~ServiceServer()
 {
+    stopWorkerThreads();
 }
 
 void ServiceServer::log(logger::Level level, const std::string &message) const
@@ -62,18 +73,41 @@ void ServiceServer::log(logger::Level level, const std::string &message) const
 
 void ServiceServer::init()
 {
-    if(Global::getInstance().remapServiceName(getNode(), orig_name_, name_))
-        info("Service name '%s' remapped to '%s'", orig_name_, name_);
+    StartupTrace *startup_trace = node_.startupTrace();
+    {
+        StartupTrace::Scope scope(startup_trace, "remap", orig_name_);
+        if(Global::getInstance().remapServiceName(getNode(), orig_name_, name_))
+            info("Service name '%s' remapped to '%s'", orig_name_, name_);
+    }
 
-    bind();
-    announce();
+    {
+        StartupTrace::Scope scope(startup_trace, "bind", name_);
+        bind();
+    }
+    {
+        StartupTrace::Scope scope(startup_trace, "announce", name_);
+        announce();
+    }
+
+    if(num_worker_threads_ > 0)
+    {
+        trace("Starting %d worker threads...", num_worker_threads_);
+        worker_stop_ = false;
+        for(int i = 0; i < num_worker_threads_; i++)
+            worker_threads_.push_back(boost::thread(&ServiceServer::workerLoop, this));
+    }
 
     if(notify_graph_)
+    {
+        StartupTrace::Scope scope(startup_trace, "notify", name_);
         node_.notifyService(name_, false, true);
+    }
 }
 
 void ServiceServer::cleanup()
 {
+    stopWorkerThreads();
+    backlog_.clear();
     unbind();
 
     if(notify_graph_)
@@ -82,32 +116,733 @@ void ServiceServer::cleanup()
 
 void ServiceServer::spinOnce()
 {
-    if(!callback_ && !callback_with_type_ && !callback_multipart_) return;
+    if(!hasHandler()) return;
+
+    if(!worker_threads_.empty())
+    {
+        dispatchRequests();
+        pumpStreams();
+        return;
+    }
 
-    while(poll())
+    if(admission_limit_ > 0)
     {
-        if(callback_)
+        serveBacklog();
+        pumpStreams();
+        return;
+    }
+
+    startSpinBudget();
+    while(spinBudgetLeft() && poll())
+    {
+        Call call;
+        if(!readRequest(call.reqparts))
+            continue;
+        if(handleStreamControl())
+            continue;
+        if(expired(request_deadline_))
+            continue;
+        if(callback_stream_)
+        {
+            startStream(call.reqparts);
+            continue;
+        }
+        call.batch = request_batch_;
+        call.if_none_match = request_if_none_match_;
+        auto t0 = std::chrono::steady_clock::now();
         {
-            std::string req, rep;
-            readRaw(req);
-            callback_(req, rep);
-            writeRaw(rep);
+            CallbackProfiler profiler(*this);
+            tracing::Scope scope(tracing::SpanKind::Server, *this, request_trace_);
+            handle(call);
         }
-        if(callback_with_type_)
+        recordCallbackDuration(t0);
+        writeReply(call);
+    }
+
+    pumpStreams();
+}
+
+void ServiceServer::serveBacklog()
+{
+    // read all the requests which arrived, so that the ones beyond the limit are rejected
+    // now rather than left to wait in the socket queue:
+    startSpinBudget();
+    while(spinBudgetLeft() && poll())
+    {
+        std::unique_ptr<Call> call = readCall();
+        if(!call) continue;
+        if(backlog_.size() >= admission_limit_)
+            reject();
+        else
+            backlog_.push_back(std::move(call));
+    }
+
+    startSpinBudget();
+    while(!backlog_.empty() && spinBudgetLeft())
+    {
+        std::unique_ptr<Call> call = std::move(backlog_.front());
+        backlog_.pop_front();
+        if(expired(call->deadline))
+            continue;
+        auto t0 = std::chrono::steady_clock::now();
         {
-            std::string req, reqtype, rep, reptype;
-            readRaw(req, reqtype);
-            callback_with_type_(req, reqtype, rep, reptype);
-            writeRaw(rep, reptype);
+            CallbackProfiler profiler(*this);
+            tracing::Scope scope(tracing::SpanKind::Server, *this, call->trace);
+            handle(*call);
         }
+        recordCallbackDuration(t0);
+        setRoute(call->route);
+        correlation_id_ = call->correlation_id;
+        writeReply(*call);
+    }
+}
+
+std::unique_ptr<ServiceServer::Call> ServiceServer::readCall()
+{
+    std::unique_ptr<Call> call(new Call);
+    if(!readRequest(call->reqparts))
+        return nullptr;
+    if(handleStreamControl())
+        return nullptr;
+    if(expired(request_deadline_))
+        return nullptr;
+    if(callback_stream_)
+    {
+        startStream(call->reqparts);
+        return nullptr;
+    }
+    getRoute(call->route);
+    call->correlation_id = correlation_id_;
+    call->deadline = request_deadline_;
+    call->batch = request_batch_;
+    call->if_none_match = request_if_none_match_;
+    call->trace = request_trace_;
+    return call;
+}
+
+void ServiceServer::reject()
+{
+    rejected_requests_++;
+    debug("Rejecting a request, over the limit of %d pending requests", admission_limit_);
+    reply_busy_ = true;
+    writeRaw(std::vector<b0::message::MessagePart>());
+    reply_busy_ = false;
+}
+
+bool ServiceServer::hasHandler() const
+{
+    return callback_ || callback_with_type_ || callback_multipart_ || callback_stream_;
+}
+
+void ServiceServer::setStreamCallback(CallbackStream callback)
+{
+    callback_ = CallbackRaw{};
+    callback_with_type_ = CallbackRawType{};
+    callback_multipart_ = CallbackParts{};
+    callback_stream_ = callback;
+}
+
+bool ServiceServer::handleStreamControl()
+{
+    if(!stream_credit_ && !stream_cancel_) return false;
+
+    std::vector<std::string> route;
+    getRoute(route);
+    for(auto it = streams_.begin(); it != streams_.end(); ++it)
+    {
+        if(it->route != route || it->correlation_id != correlation_id_) continue;
+        if(stream_cancel_)
+        {
+            streams_.erase(it);
+        }
+        else
+        {
+            it->credit += stream_credit_;
+            it->last_credit = std::chrono::steady_clock::now();
+        }
+        break;
+    }
+    // a stream which is over (or unknown) has nothing to do with the message
+    return true;
+}
+
+void ServiceServer::startStream(const std::vector<b0::message::MessagePart> &reqparts)
+{
+    Stream stream;
+    getRoute(stream.route);
+    stream.correlation_id = correlation_id_;
+    stream.credit = stream_window_;
+    stream.seq = 0;
+    stream.last_credit = std::chrono::steady_clock::now();
+
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        CallbackProfiler profiler(*this);
+        tracing::Scope scope(tracing::SpanKind::Server, *this, request_trace_);
+        stream.producer = callback_stream_(reqparts);
+    }
+    recordCallbackDuration(t0);
+
+    if(stream_window_ == 0)
+    {
+        // the client does not read streams: send all the chunks as one reply
+        std::vector<b0::message::MessagePart> repparts, chunk;
+        while(stream.producer && stream.producer(chunk))
+        {
+            std::move(chunk.begin(), chunk.end(), std::back_inserter(repparts));
+            chunk.clear();
+        }
+        writeRaw(repparts);
+        return;
+    }
+
+    if(!stream.producer)
+    {
+        writeStreamFrame(stream, {}, true);
+        return;
+    }
+    streams_.push_back(std::move(stream));
+}
+
+void ServiceServer::pumpStreams()
+{
+    auto now = std::chrono::steady_clock::now();
+    for(auto it = streams_.begin(); it != streams_.end(); )
+    {
+        Stream &stream = *it;
+        bool done = false;
+        while(stream.credit > 0 && !done)
+        {
+            std::vector<b0::message::MessagePart> chunk;
+            try
+            {
+                if(stream.producer(chunk))
+                {
+                    writeStreamFrame(stream, std::move(chunk), false);
+                    stream.credit--;
+                }
+                else
+                {
+                    writeStreamFrame(stream, {}, true);
+                    done = true;
+                }
+            }
+            catch(std::exception &ex)
+            {
+                error("Exception in stream producer: %s", ex.what());
+                writeStreamFrame(stream, {}, true, ex.what());
+                done = true;
+            }
+        }
+        // the client gave up on a stream it does not ask more chunks of:
+        if(!done && now - stream.last_credit > std::chrono::seconds(30))
+        {
+            warn("Dropping stream %s, its client has not asked for more chunks", stream.correlation_id);
+            done = true;
+        }
+        if(done) it = streams_.erase(it);
+        else ++it;
+    }
+
+    bool ready = false;
+    for(auto &stream : streams_)
+        ready = ready || stream.credit > 0;
+    streams_ready_.store(ready);
+}
+
+void ServiceServer::writeStreamFrame(Stream &stream, std::vector<b0::message::MessagePart> &&parts, bool end, const std::string &error)
+{
+    b0::message::MessageEnvelope env;
+    env.header0 = name_;
+    env.parts = std::move(parts);
+    env.headers["Correlation-id"] = stream.correlation_id;
+    env.headers["Stream-seq"] = std::to_string(stream.seq++);
+    if(end)
+        env.headers["Stream-end"] = "1";
+    if(!error.empty())
+        env.headers["Stream-error"] = error;
+    setRoute(stream.route);
+    writeRaw(env);
+}
+
+void ServiceServer::handle(Call &call)
+{
+    if(call.batch)
+    {
+        handleBatch(call);
+        return;
+    }
+
+    if(!response_cache_.enabled())
+    {
+        invokeCallback(call);
+        if(!call.if_none_match.empty())
+            call.etag = ResponseCache::etag(replyParts(call));
+        return;
+    }
+
+    std::string key = ResponseCache::key(call.reqparts);
+    ResponseCache::Entry entry;
+    bool fresh;
+    if(response_cache_.find(key, entry, fresh) && fresh)
+    {
+        call.etag = entry.etag;
+        if(callback_multipart_)
+        {
+            call.repparts = std::move(entry.parts);
+        }
+        else if(!entry.parts.empty())
+        {
+            call.rep.swap(entry.parts[0].payload);
+            call.reptype.swap(entry.parts[0].content_type);
+        }
+        return;
+    }
+    invokeCallback(call);
+    std::vector<b0::message::MessagePart> parts = replyParts(call);
+    call.etag = ResponseCache::etag(parts);
+    response_cache_.insert(key, std::move(parts), call.etag);
+}
+
+void ServiceServer::invokeCallback(Call &call)
+{
+    if(callback_)
+        callback_(call.reqparts[0].payload, call.rep);
+    if(callback_with_type_)
+        callback_with_type_(call.reqparts[0].payload, call.reqparts[0].content_type, call.rep, call.reptype);
+    if(callback_multipart_)
+        callback_multipart_(call.reqparts, call.repparts);
+}
+
+void ServiceServer::handleBatch(Call &call)
+{
+    if(callback_batch_)
+    {
+        callback_batch_(call.reqparts, call.repparts);
+        if(call.repparts.size() != call.batch)
+            throw exception::Exception((boost::format("Batch callback returned %d replies for %d requests") % call.repparts.size() % call.batch).str());
+        return;
+    }
+
+    call.repparts.reserve(call.reqparts.size());
+    for(auto &reqpart : call.reqparts)
+    {
+        Call item;
+        item.reqparts.push_back(std::move(reqpart));
+        handle(item);
+        b0::message::MessagePart reppart;
         if(callback_multipart_)
         {
-            std::vector<b0::message::MessagePart> reqparts, repparts;
-            readRaw(reqparts);
-            callback_multipart_(reqparts, repparts);
-            writeRaw(repparts);
+            // an item's reply is a single part
+            if(!item.repparts.empty())
+                reppart = std::move(item.repparts[0]);
+        }
+        else
+        {
+            reppart.payload.swap(item.rep);
+            reppart.content_type.swap(item.reptype);
+        }
+        call.repparts.push_back(std::move(reppart));
+    }
+}
+
+void ServiceServer::setBatchCallback(CallbackParts callback)
+{
+    callback_batch_ = callback;
+}
+
+std::vector<b0::message::MessagePart> ServiceServer::replyParts(const Call &call) const
+{
+    if(callback_multipart_)
+        return call.repparts;
+    std::vector<b0::message::MessagePart> parts(1);
+    parts[0].payload = call.rep;
+    parts[0].content_type = call.reptype;
+    return parts;
+}
+
+void ServiceServer::setResponseCache(size_t max_entries, long ttl, size_t max_bytes)
+{
+    response_cache_.setLimits(max_entries, ttl, max_bytes);
+}
+
+const ResponseCache & ServiceServer::getResponseCache() const
+{
+    return response_cache_;
+}
+
+void ServiceServer::writeReply(Call &call)
+{
+    if(!call.etag.empty() && call.etag == call.if_none_match)
+    {
+        // the client has this reply already
+        reply_etag_ = call.etag;
+        reply_not_modified_ = true;
+        writeRaw(std::vector<b0::message::MessagePart>());
+        reply_not_modified_ = false;
+        reply_etag_.clear();
+        return;
+    }
+
+    reply_etag_ = call.etag;
+    if(call.batch)
+    {
+        reply_batch_ = call.batch;
+        writeRaw(call.repparts);
+        reply_batch_ = 0;
+    }
+    else if(callback_multipart_)
+        writeRaw(call.repparts);
+    else
+        writeRaw(std::move(call.rep), call.reptype);
+    reply_etag_.clear();
+}
+
+void ServiceServer::dispatchRequests()
+{
+    // the socket is used only from this thread: the workers hand the requests back when done
+    std::deque<std::unique_ptr<Call> > replies;
+    {
+        boost::mutex::scoped_lock lock(worker_mutex_);
+        replies.swap(replies_);
+    }
+    for(auto &call : replies)
+    {
+        setRoute(call->route);
+        correlation_id_ = call->correlation_id;
+        writeReply(*call);
+    }
+
+    bool queued = false;
+    startSpinBudget();
+    for(;;)
+    {
+        if(admission_limit_ > 0)
+        {
+            // the requests beyond the limit are read, to be rejected
+            if(!spinBudgetLeft()) break;
+        }
+        else
+        {
+            boost::mutex::scoped_lock lock(worker_mutex_);
+            if(requests_.size() >= max_queued_requests_) break;
         }
+        if(!poll()) break;
+
+        std::unique_ptr<Call> call = readCall();
+        if(!call)
+            continue;
+
+        boost::mutex::scoped_lock lock(worker_mutex_);
+        if(coalescing_ && !call->batch)
+        {
+            // wait for the identical request already queued or being served, if any:
+            call->coalescing_key = ResponseCache::key(call->reqparts);
+            auto leader = coalescing_leaders_.find(call->coalescing_key);
+            if(leader != coalescing_leaders_.end())
+            {
+                leader->second->followers.push_back(std::move(call));
+                continue;
+            }
+        }
+        if(admission_limit_ > 0 && requests_.size() + in_flight_ >= admission_limit_)
+        {
+            lock.unlock();
+            reject();
+            continue;
+        }
+        if(!call->coalescing_key.empty())
+            coalescing_leaders_[call->coalescing_key] = call.get();
+        requests_.push_back(std::move(call));
+        queued = true;
     }
+
+    if(queued)
+        worker_cond_.notify_all();
+}
+
+void ServiceServer::workerLoop()
+{
+    set_thread_name("SRV");
+
+    std::string thread_config_error = applyThreadConfig("service");
+    if(!thread_config_error.empty())
+        warn("SRV: thread configuration: %s", thread_config_error);
+
+    while(true)
+    {
+        std::unique_ptr<Call> call;
+        {
+            boost::mutex::scoped_lock lock(worker_mutex_);
+            while(requests_.empty() && !worker_stop_)
+                worker_cond_.wait(lock);
+            if(worker_stop_)
+                return;
+            call = std::move(requests_.front());
+            requests_.pop_front();
+            in_flight_++;
+        }
+
+        // the request may have waited in the queue past its deadline (the identical
+        // requests waiting for it may not have)
+        {
+            boost::mutex::scoped_lock lock(worker_mutex_);
+            if(call->followers.empty() && expired(call->deadline))
+            {
+                if(!call->coalescing_key.empty())
+                    coalescing_leaders_.erase(call->coalescing_key);
+                in_flight_--;
+                continue;
+            }
+        }
+
+        try
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            {
+                CallbackProfiler profiler(*this);
+                tracing::Scope scope(tracing::SpanKind::Server, *this, call->trace);
+                handle(*call);
+            }
+            recordCallbackDuration(t0);
+        }
+        catch(std::exception &ex)
+        {
+            error("Exception in callback: %s", ex.what());
+            boost::mutex::scoped_lock lock(worker_mutex_);
+            if(!call->coalescing_key.empty())
+                coalescing_leaders_.erase(call->coalescing_key);
+            in_flight_--;
+            continue;
+        }
+
+        {
+            boost::mutex::scoped_lock lock(worker_mutex_);
+            completeFollowers(*call);
+            replies_.push_back(std::move(call));
+            in_flight_--;
+        }
+
+        // let an event-driven spin() write the reply:
+        node_.wakeUp();
+    }
+}
+
+void ServiceServer::completeFollowers(Call &call)
+{
+    if(call.coalescing_key.empty()) return;
+
+    coalescing_leaders_.erase(call.coalescing_key);
+    for(auto &follower : call.followers)
+    {
+        follower->repparts = call.repparts;
+        follower->rep = call.rep;
+        follower->reptype = call.reptype;
+        // the validation token depends only on the reply
+        follower->etag = call.etag.empty() && !follower->if_none_match.empty() ? ResponseCache::etag(replyParts(call)) : call.etag;
+        replies_.push_back(std::move(follower));
+    }
+    coalesced_requests_ += call.followers.size();
+    call.followers.clear();
+}
+
+void ServiceServer::stopWorkerThreads()
+{
+    if(worker_threads_.empty()) return;
+
+    trace("Stopping worker threads...");
+    {
+        boost::mutex::scoped_lock lock(worker_mutex_);
+        worker_stop_ = true;
+    }
+    worker_cond_.notify_all();
+    for(auto &thread : worker_threads_)
+        thread.join();
+    worker_threads_.clear();
+    requests_.clear();
+    replies_.clear();
+    in_flight_ = 0;
+    coalescing_leaders_.clear();
+}
+
+void ServiceServer::setWorkerThreads(int n, size_t max_queued)
+{
+    if(!worker_threads_.empty())
+        throw exception::Exception("Cannot set the number of worker threads of an already initialized service server");
+
+    num_worker_threads_ = std::max(0, n);
+    max_queued_requests_ = max_queued > 0 ? max_queued : size_t(num_worker_threads_);
+}
+
+int ServiceServer::getWorkerThreads() const
+{
+    return num_worker_threads_;
+}
+
+size_t ServiceServer::getMaxQueuedRequests() const
+{
+    return max_queued_requests_;
+}
+
+void ServiceServer::setReuseMessages(bool enabled)
+{
+    reuse_messages_ = enabled;
+}
+
+bool ServiceServer::getReuseMessages() const
+{
+    return reuse_messages_;
+}
+
+void ServiceServer::setCoalescing(bool enabled)
+{
+    if(!worker_threads_.empty())
+        throw exception::Exception("setCoalescing() must be called before init()");
+
+    coalescing_ = enabled;
+}
+
+bool ServiceServer::getCoalescing() const
+{
+    return coalescing_;
+}
+
+uint64_t ServiceServer::getCoalescedRequests() const
+{
+    return coalesced_requests_.load();
+}
+
+void ServiceServer::setAdmissionLimit(size_t max_pending)
+{
+    admission_limit_ = max_pending;
+}
+
+size_t ServiceServer::getAdmissionLimit() const
+{
+    return admission_limit_;
+}
+
+uint64_t ServiceServer::getRejectedRequests() const
+{
+    return rejected_requests_.load();
+}
+
+uint64_t ServiceServer::getExpiredRequests() const
+{
+    return expired_requests_.load();
+}
+
+bool ServiceServer::expired(int64_t deadline)
+{
+    if(deadline == 0 || node_.timeUSec() < deadline)
+        return false;
+    expired_requests_++;
+    debug("Dropping a request %d us past its deadline", node_.timeUSec() - deadline);
+    return true;
+}
+
+void ServiceServer::readRaw(b0::message::MessageEnvelope &env)
+{
+    Socket::readRaw(env);
+    readHeaders(env.headers);
+}
+
+void ServiceServer::readRaw(b0::message::MessageEnvelopeView &env)
+{
+    Socket::readRaw(env);
+    readHeaders(env.getHeaders());
+}
+
+bool ServiceServer::readRequest(std::vector<b0::message::MessagePart> &parts)
+{
+    // the client of a dropped request times out, as with an expired one
+    b0::message::MessageEnvelope &env = request_envelope_;
+    ReadStatus status = tryReadRaw(env, &read_error_);
+    if(status != ReadStatus::Ok)
+    {
+        readFailed(status, read_error_);
+        return false;
+    }
+    readHeaders(env.headers);
+    parts.swap(env.parts);
+    return true;
+}
+
+void ServiceServer::readHeaders(const std::map<std::string, std::string> &headers)
+{
+    correlation_id_.clear();
+    stream_window_ = 0;
+    stream_credit_ = 0;
+    stream_cancel_ = false;
+    request_deadline_ = 0;
+    request_batch_ = 0;
+    request_if_none_match_.clear();
+    request_trace_ = tracing::TraceContext();
+    for(auto &header : headers)
+    {
+        if(header.first == "Correlation-id")
+            correlation_id_ = header.second;
+        else if(header.first == "Stream-window")
+            stream_window_ = std::strtoull(header.second.c_str(), nullptr, 10);
+        else if(header.first == "Stream-credit")
+            stream_credit_ = std::strtoull(header.second.c_str(), nullptr, 10);
+        else if(header.first == "Stream-cancel")
+            stream_cancel_ = true;
+        else if(header.first == "If-none-match")
+            request_if_none_match_ = header.second;
+        else if(header.first == "Batch")
+            request_batch_ = std::strtoull(header.second.c_str(), nullptr, 10);
+        else if(header.first == "Deadline")
+            request_deadline_ = std::strtoll(header.second.c_str(), nullptr, 10);
+        else if(header.first == tracing::header_name)
+            tracing::TraceContext::fromTraceparent(header.second, request_trace_);
+    }
+}
+
+void ServiceServer::prepareEnvelope(b0::message::MessageEnvelope &env)
+{
+    if(!correlation_id_.empty())
+        env.headers["Correlation-id"] = correlation_id_;
+    if(reply_batch_)
+        env.headers["Batch"] = std::to_string(reply_batch_);
+    if(!reply_etag_.empty())
+        env.headers["Etag"] = reply_etag_;
+    if(reply_not_modified_)
+        env.headers["Not-modified"] = "1";
+    if(reply_busy_)
+        env.headers["Busy"] = "1";
+}
+
+void ServiceServer::recordCallbackDuration(std::chrono::steady_clock::time_point t0)
+{
+    auto t1 = std::chrono::steady_clock::now();
+    getCounters().callback_duration.record(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+}
+
+bool ServiceServer::hasCallback() const
+{
+    if(!hasHandler()) return false;
+    if(worker_threads_.empty() || admission_limit_ > 0) return true;
+
+    boost::mutex::scoped_lock lock(worker_mutex_);
+    return requests_.size() < max_queued_requests_;
+}
+
+bool ServiceServer::hasPendingMessages() const
+{
+    if(streams_ready_.load()) return true;
+    if(worker_threads_.empty()) return !backlog_.empty();
+
+    boost::mutex::scoped_lock lock(worker_mutex_);
+    return !replies_.empty();
+}
+
+size_t ServiceServer::getQueueDepth() const
+{
+    if(worker_threads_.empty()) return backlog_.size();
+
+    boost::mutex::scoped_lock lock(worker_mutex_);
+    return requests_.size();
 }
 
 std::string ServiceServer::getServiceName()
@@ -119,11 +854,11 @@ void ServiceServer::bind()
 {
     boost::format fmt("tcp://%s:%d");
     std::string host = node_.hostname();
-    int port = node_.freeTCPPort();
+    int port = bindEphemeralPort();
     bind_addr_ = (fmt % "*" % port).str();
     remote_addr_ = (fmt % host % port).str();
-    Socket::bind(bind_addr_);
     debug("Bound to %s", bind_addr_);
+    ipc_addr_ = bindIPC(port);
 }
 
 void ServiceServer::unbind()
@@ -134,7 +869,7 @@ void ServiceServer::unbind()
 void ServiceServer::announce()
 {
     trace("Announcing %s to resolver...", remote_addr_);
-    node_.announceService(name_, remote_addr_);
+    node_.announceService(name_, remote_addr_, ipc_addr_);
 }
 
 void ServiceServer::bind(const std::string &address)
@@ -0,0 +1,324 @@
+#include <b0/shm/shared_memory.h>
+#include <b0/exception/message_unpack_error.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <random>
+
+#include <boost/format.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace b0
+{
+
+namespace shm
+{
+
+namespace bip = boost::interprocess;
+
+static const char descriptor_marker = '\x02';
+
+static const char descriptor_version = 1;
+
+static const uint64_t segment_magic = 0x62306d656d736870ull;
+
+//! Header at the start of a segment
+struct SegmentHeader
+{
+    uint64_t magic;
+    uint64_t token;
+    uint64_t slot_size;
+    uint64_t slot_count;
+};
+
+//! Header of each slot, followed by the slot data
+struct alignas(64) SlotHeader
+{
+    //! Generation of the envelope in the slot, or 0 while it is being written
+    std::atomic<uint64_t> generation;
+
+    //! Number of readers using the envelope
+    std::atomic<uint32_t> pins;
+
+    //! Size of the envelope
+    uint64_t size;
+};
+
+static_assert(sizeof(SegmentHeader) <= 64, "segment header exceeds its space");
+
+static size_t slotStride(size_t slot_size)
+{
+    return (sizeof(SlotHeader) + slot_size + 63) / 64 * 64;
+}
+
+static SlotHeader * slotHeader(void *segment, uint64_t slot_size, uint32_t slot)
+{
+    return reinterpret_cast<SlotHeader*>(static_cast<char*>(segment) + 64 + slot * slotStride(slot_size));
+}
+
+static char * putInt(char *p, uint64_t v, int bytes)
+{
+    for(int i = 0; i < bytes; i++, v >>= 8)
+        *p++ = static_cast<char>(v & 0xff);
+    return p;
+}
+
+static uint64_t getInt(const char *&p, int bytes)
+{
+    uint64_t v = 0;
+    for(int i = 0; i < bytes; i++)
+        v |= uint64_t(static_cast<unsigned char>(*p++)) << (8 * i);
+    return v;
+}
+
+bool isDescriptor(const char *data, size_t size)
+{
+    const char *header0_end = static_cast<const char*>(std::memchr(data, '\n', size));
+    return header0_end && header0_end + 1 != data + size && header0_end[1] == descriptor_marker;
+}
+
+void serializeDescriptor(const std::string &header0, const Descriptor &desc, std::string &out)
+{
+    out.resize(header0.size() + 3 + 8 + 4 + 8 + 8 + 2 + desc.host.size() + 2 + desc.segment.size());
+    char *p = &out[0];
+    std::memcpy(p, header0.data(), header0.size());
+    p += header0.size();
+    *p++ = '\n';
+    *p++ = descriptor_marker;
+    *p++ = descriptor_version;
+    p = putInt(p, desc.token, 8);
+    p = putInt(p, desc.slot, 4);
+    p = putInt(p, desc.generation, 8);
+    p = putInt(p, desc.size, 8);
+    p = putInt(p, desc.host.size(), 2);
+    std::memcpy(p, desc.host.data(), desc.host.size());
+    p += desc.host.size();
+    p = putInt(p, desc.segment.size(), 2);
+    std::memcpy(p, desc.segment.data(), desc.segment.size());
+}
+
+void parseDescriptor(Descriptor &desc, const char *data, size_t size)
+{
+    if(!tryParseDescriptor(desc, data, size))
+        throw exception::EnvelopeDecodeError();
+}
+
+bool tryParseDescriptor(Descriptor &desc, const char *data, size_t size)
+{
+    const char *end = data + size;
+    const char *p = static_cast<const char*>(std::memchr(data, '\n', size));
+    const size_t fixed_size = 3 + 8 + 4 + 8 + 8 + 2;
+    if(!p || size_t(end - p) < fixed_size || p[1] != descriptor_marker || p[2] != descriptor_version)
+        return false;
+    p += 3;
+    desc.token = getInt(p, 8);
+    desc.slot = static_cast<uint32_t>(getInt(p, 4));
+    desc.generation = getInt(p, 8);
+    desc.size = getInt(p, 8);
+    size_t host_size = getInt(p, 2);
+    if(size_t(end - p) < host_size + 2)
+        return false;
+    desc.host.assign(p, host_size);
+    p += host_size;
+    size_t segment_size = getInt(p, 2);
+    if(size_t(end - p) != segment_size)
+        return false;
+    desc.segment.assign(p, segment_size);
+    return true;
+}
+
+struct Pool::Private
+{
+    std::string host;
+    std::string name;
+    uint64_t token;
+    size_t slot_size;
+    size_t slot_count;
+    bip::shared_memory_object shm;
+    bip::mapped_region region;
+    uint32_t next_slot{0};
+    uint64_t next_generation{1};
+};
+
+Pool::Pool(const std::string &host, size_t slot_size, size_t slot_count)
+    : private_(new Private)
+{
+    std::random_device rd;
+    private_->host = host;
+    private_->token = ((uint64_t(rd()) << 32) ^ rd() ^ uint64_t(std::chrono::steady_clock::now().time_since_epoch().count())) | 1;
+    private_->name = (boost::format("b0-%016x") % private_->token).str();
+    private_->slot_size = slot_size;
+    private_->slot_count = slot_count;
+
+    private_->shm = bip::shared_memory_object(bip::create_only, private_->name.c_str(), bip::read_write);
+    private_->shm.truncate(64 + slot_count * slotStride(slot_size));
+    private_->region = bip::mapped_region(private_->shm, bip::read_write);
+
+    void *segment = private_->region.get_address();
+    for(uint32_t i = 0; i < slot_count; i++)
+    {
+        SlotHeader *slot = new(slotHeader(segment, slot_size, i)) SlotHeader;
+        slot->generation.store(0);
+        slot->pins.store(0);
+        slot->size = 0;
+    }
+    SegmentHeader *header = static_cast<SegmentHeader*>(segment);
+    header->token = private_->token;
+    header->slot_size = slot_size;
+    header->slot_count = slot_count;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = segment_magic;
+}
+
+Pool::~Pool()
+{
+    bip::shared_memory_object::remove(private_->name.c_str());
+}
+
+size_t Pool::getSlotSize() const
+{
+    return private_->slot_size;
+}
+
+size_t Pool::getSlotCount() const
+{
+    return private_->slot_count;
+}
+
+char * Pool::acquire(size_t size, Descriptor &desc)
+{
+    if(size > private_->slot_size) return nullptr;
+
+    void *segment = private_->region.get_address();
+    for(size_t i = 0; i < private_->slot_count; i++)
+    {
+        uint32_t index = (private_->next_slot + i) % private_->slot_count;
+        SlotHeader *slot = slotHeader(segment, private_->slot_size, index);
+        if(slot->pins.load() != 0) continue;
+
+        // invalidate the slot before checking again for readers: a reader pinning it from now
+        // on will see the generation changed, and one which pinned it in the meantime is seen here
+        uint64_t generation = slot->generation.exchange(0);
+        if(slot->pins.load() != 0)
+        {
+            slot->generation.store(generation);
+            continue;
+        }
+
+        private_->next_slot = (index + 1) % private_->slot_count;
+        desc.host = private_->host;
+        desc.segment = private_->name;
+        desc.token = private_->token;
+        desc.slot = index;
+        desc.generation = private_->next_generation++;
+        desc.size = size;
+        return reinterpret_cast<char*>(slot) + sizeof(SlotHeader);
+    }
+    return nullptr;
+}
+
+void Pool::commit(const Descriptor &desc)
+{
+    SlotHeader *slot = slotHeader(private_->region.get_address(), private_->slot_size, desc.slot);
+    slot->size = desc.size;
+    slot->generation.store(desc.generation, std::memory_order_release);
+}
+
+//! A segment mapped by a reader
+struct Mapping
+{
+    bip::shared_memory_object shm;
+    bip::mapped_region region;
+    uint64_t token;
+    uint64_t slot_size;
+    uint64_t slot_count;
+};
+
+//! Number of mapped segments above which the unused ones are unmapped
+static const size_t max_mappings = 32;
+
+struct Reader::Private
+{
+    //! The segments mapped so far, by name
+    std::map<std::string, std::shared_ptr<Mapping> > mappings;
+};
+
+Reader::Reader()
+    : private_(new Private)
+{
+}
+
+Reader::~Reader()
+{
+}
+
+static std::shared_ptr<Mapping> openSegment(const std::string &name)
+{
+    std::shared_ptr<Mapping> mapping = std::make_shared<Mapping>();
+    try
+    {
+        mapping->shm = bip::shared_memory_object(bip::open_only, name.c_str(), bip::read_write);
+        mapping->region = bip::mapped_region(mapping->shm, bip::read_write);
+    }
+    catch(bip::interprocess_exception &)
+    {
+        return std::shared_ptr<Mapping>();
+    }
+    if(mapping->region.get_size() < 64)
+        return std::shared_ptr<Mapping>();
+    const SegmentHeader *header = static_cast<const SegmentHeader*>(mapping->region.get_address());
+    if(header->magic != segment_magic)
+        return std::shared_ptr<Mapping>();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    mapping->token = header->token;
+    mapping->slot_size = header->slot_size;
+    mapping->slot_count = header->slot_count;
+    if(mapping->region.get_size() < 64 + mapping->slot_count * slotStride(mapping->slot_size))
+        return std::shared_ptr<Mapping>();
+    return mapping;
+}
+
+std::shared_ptr<const void> Reader::pin(const Descriptor &desc, const char *&data)
+{
+    auto it = private_->mappings.find(desc.segment);
+    if(it == private_->mappings.end() || it->second->token != desc.token)
+    {
+        // the segments of the publishers which are gone stay mapped until nothing references them:
+        if(private_->mappings.size() >= max_mappings)
+        {
+            for(auto i = private_->mappings.begin(); i != private_->mappings.end(); )
+            {
+                if(i->second.use_count() == 1) i = private_->mappings.erase(i);
+                else ++i;
+            }
+        }
+        it = private_->mappings.insert(std::make_pair(desc.segment, std::shared_ptr<Mapping>())).first;
+        it->second = openSegment(desc.segment);
+    }
+    std::shared_ptr<Mapping> &mapping = it->second;
+    if(!mapping || mapping->token != desc.token || desc.slot >= mapping->slot_count || desc.size > mapping->slot_size)
+    {
+        private_->mappings.erase(desc.segment);
+        return std::shared_ptr<const void>();
+    }
+
+    SlotHeader *slot = slotHeader(mapping->region.get_address(), mapping->slot_size, desc.slot);
+    slot->pins.fetch_add(1);
+    if(slot->generation.load() != desc.generation)
+    {
+        slot->pins.fetch_sub(1);
+        return std::shared_ptr<const void>();
+    }
+
+    // the mapping stays alive as long as the envelope is pinned, even if the reader drops it
+    data = reinterpret_cast<const char*>(slot) + sizeof(SlotHeader);
+    std::shared_ptr<Mapping> keep = mapping;
+    return std::shared_ptr<const void>(data, [keep, slot](const void *) {slot->pins.fetch_sub(1);});
+}
+
+} // namespace shm
+
+} // namespace b0
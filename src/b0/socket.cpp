@@ -2,8 +2,20 @@
 #include <b0/node.h>
 #include <b0/exceptions.h>
 #include <b0/utils/env.h>
+#include <b0/utils/socket_profile.h>
+#include <b0/utils/buffer_pool.h>
+#include <b0/compress/compress.h>
+#include <b0/message/message_chunk.h>
+#include <b0/shm/shared_memory.h>
+#include <b0/message/metrics/socket_metrics.h>
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <cstring>
 #include <limits>
+#include <new>
+#include <random>
 #include <iostream>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string.hpp>
@@ -17,204 +29,1534 @@ struct Socket::Private
 {
     Private(Node *node, zmq::context_t &context, int type)
         : type_(type),
-          socket_(context, type)
+          socket_(context, type),
+          hostname_(node->hostname()),
+          buffer_allocator_(Global::getInstance().getBufferAllocator()),
+          memory_accounting_(Global::getInstance().getMemoryAccounting())
     {
+        std::random_device rd;
+        chunk_sender_ = (uint64_t(rd()) << 32) ^ rd() ^ uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
     }
 
+    /*!
+     * \brief Send a ZeroMQ message, preceded by the routing frames of the socket type
+     *
+     * A DEALER socket sends the empty delimiter frame expected by REP and ROUTER sockets, and
+     * a ROUTER socket sends the routing frames of the last request received, and the delimiter.
+     * If more is true, the message goes on with the next frame sent, which must then be sent with
+     * continued set (no routing frames before it).
+     */
+    bool sendFrame(zmq::message_t &msg, bool more = false, bool continued = false);
+
+    //! Initialize a message of the given size, with a buffer of buffer_allocator_ if it gives one
+    void newMessage(zmq::message_t &msg, size_t size);
+
+    //! Receive a frame, accounting its buffer (see Socket::setMemoryAccounting())
+    bool recvFrame(zmq::message_t &msg);
+
+    //! Account a buffer allocated by a path of the socket, if memory accounting is enabled
+    void accountAllocation(AllocationCounter &counter, size_t size);
+
+    //! Send a serialized envelope, split into chunks of at most chunk_size bytes if bigger (0: never split)
+    bool send(zmq::message_t &msg, const std::string &header0, size_t chunk_size);
+
+    //! Send the headers and the payloads of an envelope as the frames of one ZeroMQ multipart message
+    bool sendMultipart(std::vector<zmq::message_t> &frames);
+
+    /*!
+     * \brief Receive the next whole serialized envelope
+     *
+     * If it has been reassembled from chunks, or is read from shared memory, keepalive is set
+     * to the owner of its storage, otherwise it points into msg.
+     *
+     * If it has been received as a multipart message (see Socket::setMultipartFraming()), only
+     * its headers are returned, payloads is set to the payload frames, and keepalive to the
+     * owner of all the frames. Otherwise payloads is cleared.
+     *
+     * Return ReadStatus::ReadError or ReadStatus::DecodeError if the frames cannot be read,
+     * and ReadStatus::Incomplete if the frame read is a chunk of an envelope not complete yet,
+     * or a shared memory descriptor which has been discarded.
+     */
+    ReadStatus recv(zmq::message_t &msg, std::shared_ptr<const void> &keepalive, std::vector<boost::string_ref> &payloads, boost::string_ref &wire);
+
+    //! The frames of an envelope received as a multipart message
+    struct MultipartFrames
+    {
+        zmq::message_t headers;
+        std::vector<zmq::message_t> payloads;
+    };
+
+    //! The payload frames of the last envelope received as a multipart message
+    std::vector<boost::string_ref> recv_payloads_;
+
+    //! The frames of the multipart message being written, reused across messages
+    std::vector<zmq::message_t> send_frames_;
+
     int type_;
     zmq::socket_t socket_;
+
+    //! ZMQ_FD of the socket, once read (it does not change); -1 until then
+    mutable int64_t fd_{-1};
+
+    //! Debug dump mode (0: off, 1: on, 2: extended), or -1 if not evaluated yet
+    mutable std::atomic<int> debug_dump_{-1};
+
+    //! Traffic counters
+    SocketCounters counters_;
+
+    //! If true, the buffers allocated by the socket are accounted (see Socket::setMemoryAccounting())
+    std::atomic<bool> memory_accounting_;
+
+    //! Capacities of the part payloads of read_envelope_ before a read (for the memory accounting)
+    std::vector<size_t> part_capacities_;
+
+    //! Compression state and buffers, reused across messages
+    b0::compress::Context compression_context_;
+
+    //! Envelope serializer, reused across messages
+    b0::message::EnvelopeSerializer serializer_;
+
+    //! Envelope the parts and payloads are read into, reused across messages
+    b0::message::MessageEnvelope read_envelope_;
+
+    //! Last ZeroMQ message received into an envelope view, reused when no view references it anymore
+    std::shared_ptr<zmq::message_t> recv_message_;
+
+    //! Envelope built by writeFrame(), reused across messages
+    b0::message::MessageEnvelope frame_envelope_;
+
+    //! Space left for the envelope headers by newFrame(), grown when the headers did not fit
+    size_t frame_header_space_{256};
+
+    //! Size of the last frame, used to allocate the next one
+    size_t frame_size_hint_{0};
+
+    //! Reassembles the chunked envelopes received
+    b0::message::ChunkReassembler reassembler_;
+
+    //! Random id of this socket in the chunks it sends
+    uint64_t chunk_sender_{0};
+
+    //! Sequence number of the last envelope sent in chunks
+    uint64_t chunk_seq_{0};
+
+    //! Host of the node, to tell which shared-memory descriptors can be read
+    std::string hostname_;
+
+    //! Maps the shared-memory segments of the publishers of this host
+    b0::shm::Reader shm_reader_;
+
+    //! Descriptor parsed from the last shared-memory descriptor received
+    b0::shm::Descriptor shm_descriptor_;
+
+    //! Routing frames of the last request received by a ROUTER socket, to send the reply back
+    std::vector<std::string> route_;
+
+    //! The allocator of the messages sent (see b0::setBufferAllocator()), or null
+    std::shared_ptr<BufferAllocator> buffer_allocator_;
+
+    //! Name of the profile applied (see Socket::setProfile())
+    std::string profile_;
+
+    //! 0: no connection monitor, 1: monitor, 2: also log the failures as warnings (see Socket::setConnectionMonitor())
+    int connection_monitor_{0};
+
+    //! The PAIR socket receiving the events of the monitor, once started by the first connect or bind
+    std::unique_ptr<zmq::socket_t> monitor_;
+
+    //! State of the connections to an endpoint, for the connection monitor
+    struct Endpoint
+    {
+        //! Time of the connect() call, of the loss of the connection, or of the connection (for the handshake)
+        int64_t since{0};
+
+        //! True if the connection has been lost, and not established again yet
+        bool lost{false};
+    };
+
+    //! The endpoints seen by the connection monitor
+    std::map<std::string, Endpoint> endpoints_;
+
+    //! Time of the last connect() call, for the endpoints reported by another address (e.g. a resolved host name)
+    int64_t last_connect_{0};
+
+    //! Start the connection monitor, if enabled and not started yet
+    void startMonitor(zmq::context_t &context)
+    {
+        static std::atomic<uint64_t> next_id{0};
+        if(!connection_monitor_ || monitor_) return;
+        std::string addr = "inproc://b0-monitor-" + std::to_string(next_id++);
+        if(zmq_socket_monitor(static_cast<void*>(socket_), addr.c_str(), ZMQ_EVENT_ALL) != 0)
+            return;
+        monitor_.reset(new zmq::socket_t(context, ZMQ_PAIR));
+        monitor_->connect(addr);
+    }
+
+    //! Stop the connection monitor, if started
+    void stopMonitor()
+    {
+        if(!monitor_) return;
+        zmq_socket_monitor(static_cast<void*>(socket_), nullptr, 0);
+        monitor_.reset();
+        endpoints_.clear();
+    }
+
+    //! If true, a message which cannot be queued is dropped and counted (see Socket::setCountWriteDrops())
+    bool count_write_drops_{false};
+
+    //! True if the last message written was dropped
+    bool last_write_dropped_{false};
+
+    //! A frame which ZeroMQ could not queue, waiting to be written (see Socket::setWriteQueueLimit())
+    struct QueuedFrame
+    {
+        zmq::message_t msg;
+
+        //! True on the frames followed by another frame of the same multipart message
+        bool more{false};
+
+        //! True on the last frame of a message, which also carries the sizes accounted when it is written
+        bool last{false};
+        size_t wire_bytes{0};
+        size_t payload_bytes{0};
+    };
+
+    //! The frames waiting to be written, in order
+    std::deque<QueuedFrame> write_queue_;
+
+    //! Total size of the frames of write_queue_
+    std::atomic<size_t> write_queue_bytes_{0};
+
+    //! Maximum size of write_queue_ (0: no write queue)
+    size_t write_queue_limit_{0};
+
+    //! True once a frame of the message being written has been queued (the next ones follow it)
+    bool queued_{false};
+
+    //! Queue a frame, dropping the oldest messages of the queue if it is full
+    void queueFrame(zmq::message_t &msg, bool more = false);
+
+    //! Write the frames of the queue which ZeroMQ accepts, and return true if it is empty
+    bool flushWriteQueue();
+
+    //! Send the frames of a message, accounting it as sent or dropped
+    void send(zmq::message_t &msg, const std::string &header0, size_t chunk_size, size_t payload_bytes);
+
+    //! Account a message as sent, or dropped if sent is false
+    void sent(bool sent, size_t wire_bytes, size_t payload_bytes);
 };
 
-Socket::Socket(Node *node, int type, const std::string &name, bool managed)
-    : private_(new Private(node, *reinterpret_cast<zmq::context_t*>(node->getContext()), type)),
-      node_(*node),
-      name_(name),
-      orig_name_(name),
-      managed_(managed)
+bool Socket::Private::sendFrame(zmq::message_t &msg, bool more, bool continued)
+{
+    int flags = more ? ZMQ_SNDMORE : 0;
+
+    if(write_queue_limit_ > 0 && (type_ == ZMQ_PUB || type_ == ZMQ_XPUB))
+    {
+        // behind the frames already waiting, to keep the order (ZeroMQ accepts the rest of
+        // a multipart message once it has accepted its first frame):
+        if(queued_ || !flushWriteQueue() || !socket_.send(msg, flags | ZMQ_DONTWAIT))
+            queueFrame(msg, more);
+        return true;
+    }
+
+    if(continued)
+    {
+        if(!socket_.send(msg, flags))
+            throw exception::SocketWriteError();
+        return true;
+    }
+
+    if(type_ == ZMQ_ROUTER)
+    {
+        for(const std::string &id : route_)
+        {
+            zmq::message_t id_msg(id.size());
+            std::memcpy(id_msg.data(), id.data(), id.size());
+            if(!socket_.send(id_msg, ZMQ_SNDMORE))
+                throw exception::SocketWriteError();
+        }
+    }
+    if(type_ == ZMQ_DEALER || type_ == ZMQ_ROUTER)
+    {
+        zmq::message_t delimiter;
+        if(!socket_.send(delimiter, ZMQ_SNDMORE))
+            throw exception::SocketWriteError();
+    }
+    if(!socket_.send(msg, flags))
+    {
+        if(count_write_drops_) return false;
+        throw exception::SocketWriteError();
+    }
+    return true;
+}
+
+bool Socket::Private::sendMultipart(std::vector<zmq::message_t> &frames)
+{
+    // not split in chunks: ZeroMQ delivers all the frames of a message, or none
+    for(size_t i = 0; i < frames.size(); i++)
+        if(!sendFrame(frames[i], i + 1 < frames.size(), i > 0))
+            return false;
+    return true;
+}
+
+//! Precedes the data of a message allocated by a BufferAllocator, in its buffer
+struct AllocatedBuffer
+{
+    BufferAllocator *allocator;
+    size_t size;
+};
+
+//! Space taken by AllocatedBuffer, keeping the data aligned
+static const size_t allocated_buffer_header = (sizeof(AllocatedBuffer) + 15) & ~size_t(15);
+
+static void freeAllocatedBuffer(void *data, void *hint)
+{
+    AllocatedBuffer *buffer = static_cast<AllocatedBuffer*>(hint);
+    buffer->allocator->deallocate(buffer, buffer->size);
+}
+
+//! The ZeroMQ messages up to this size are stored in the message itself, without a buffer
+static const size_t zmq_vsm_size = 33;
+
+void Socket::Private::accountAllocation(AllocationCounter &counter, size_t size)
+{
+    if(size > zmq_vsm_size && memory_accounting_.load(std::memory_order_relaxed))
+        counter.add(size);
+}
+
+bool Socket::Private::recvFrame(zmq::message_t &msg)
+{
+    if(!socket_.recv(&msg)) return false;
+    accountAllocation(counters_.receive_allocations, msg.size());
+    return true;
+}
+
+void Socket::Private::newMessage(zmq::message_t &msg, size_t size)
+{
+    accountAllocation(counters_.send_allocations, size);
+    if(buffer_allocator_)
+    {
+        // (the allocators are kept until the process exits, see b0::setBufferAllocator())
+        size_t buffer_size = allocated_buffer_header + size;
+        void *data = buffer_allocator_->allocate(buffer_size);
+        if(data)
+        {
+            AllocatedBuffer *buffer = new(data) AllocatedBuffer{buffer_allocator_.get(), buffer_size};
+            msg.rebuild(static_cast<char*>(data) + allocated_buffer_header, size, &freeAllocatedBuffer, buffer);
+            return;
+        }
+    }
+    msg.rebuild(size);
+}
+
+bool Socket::Private::send(zmq::message_t &msg, const std::string &header0, size_t chunk_size)
+{
+    // only publishers can split a message: the other socket types expect exactly one per request
+    size_t size = msg.size();
+    if(chunk_size == 0 || size <= chunk_size || (type_ != ZMQ_PUB && type_ != ZMQ_XPUB))
+        return sendFrame(msg);
+
+    size_t header_size = b0::message::chunkHeaderSize(header0);
+    size_t data_size = std::max(chunk_size, header_size + 1) - header_size;
+    data_size = std::max<size_t>(data_size, size / std::numeric_limits<uint32_t>::max() + 1);
+    const char *data = static_cast<const char*>(msg.data());
+
+    b0::message::MessageChunk chunk;
+    chunk.sender = chunk_sender_;
+    chunk.seq = ++chunk_seq_;
+    chunk.count = static_cast<uint32_t>((size + data_size - 1) / data_size);
+    chunk.total = size;
+    for(chunk.index = 0; chunk.index < chunk.count; chunk.index++)
+    {
+        size_t offset = size_t(chunk.index) * data_size;
+        size_t n = std::min(data_size, size - offset);
+        zmq::message_t chunk_msg;
+        newMessage(chunk_msg, header_size + n);
+        char *dst = static_cast<char*>(chunk_msg.data());
+        b0::message::writeChunkHeader(dst, header0, chunk);
+        std::memcpy(dst + header_size, data + offset, n);
+        if(!sendFrame(chunk_msg))
+        {
+            // the subscribers discard the chunks sent so far, when the next envelope starts
+            if(count_write_drops_) return false;
+            throw exception::SocketWriteError();
+        }
+    }
+    return true;
+}
+
+void Socket::Private::send(zmq::message_t &msg, const std::string &header0, size_t chunk_size, size_t payload_bytes)
+{
+    size_t wire_bytes = msg.size();
+    sent(send(msg, header0, chunk_size), wire_bytes, payload_bytes);
+}
+
+void Socket::Private::queueFrame(zmq::message_t &msg, bool more)
+{
+    write_queue_.emplace_back();
+    QueuedFrame &frame = write_queue_.back();
+    frame.msg.move(&msg);
+    frame.more = more;
+    write_queue_bytes_ += frame.msg.size();
+    counters_.write_queue.set(write_queue_bytes_);
+    queued_ = true;
+
+    // drop the oldest messages; the one being written (not marked last yet) is always kept
+    while(write_queue_bytes_.load() > write_queue_limit_)
+    {
+        size_t n = 0;
+        while(n < write_queue_.size() && !write_queue_[n].last) n++;
+        if(n == write_queue_.size()) break;
+        // a message whose first frames were written is dropped too (the subscribers discard its chunks)
+        for(size_t i = 0; i <= n; i++)
+        {
+            write_queue_bytes_ -= write_queue_.front().msg.size();
+            write_queue_.pop_front();
+        }
+        counters_.messageDropped();
+        counters_.write_queue.set(write_queue_bytes_);
+    }
+}
+
+bool Socket::Private::flushWriteQueue()
+{
+    while(!write_queue_.empty())
+    {
+        QueuedFrame &frame = write_queue_.front();
+        size_t size = frame.msg.size();
+        if(!socket_.send(frame.msg, ZMQ_DONTWAIT | (frame.more ? ZMQ_SNDMORE : 0)))
+            return false;
+        if(frame.last)
+            counters_.messageSent(frame.wire_bytes, frame.payload_bytes);
+        write_queue_bytes_ -= size;
+        write_queue_.pop_front();
+        counters_.write_queue.set(write_queue_bytes_);
+    }
+    return true;
+}
+
+void Socket::Private::sent(bool sent, size_t wire_bytes, size_t payload_bytes)
+{
+    if(queued_)
+    {
+        // accounted when its last frame is written by flushWriteQueue():
+        QueuedFrame &frame = write_queue_.back();
+        frame.last = true;
+        frame.wire_bytes = wire_bytes;
+        frame.payload_bytes = payload_bytes;
+        queued_ = false;
+        last_write_dropped_ = false;
+        return;
+    }
+
+    last_write_dropped_ = !sent;
+    if(sent)
+        counters_.messageSent(wire_bytes, payload_bytes);
+    else
+        counters_.messageDropped();
+}
+
+ReadStatus Socket::Private::recv(zmq::message_t &msg, std::shared_ptr<const void> &keepalive, std::vector<boost::string_ref> &payloads, boost::string_ref &wire)
+{
+    payloads.clear();
+    if(!recvFrame(msg))
+        return ReadStatus::ReadError;
+
+    // a DEALER socket receives the reply of a REP or ROUTER socket after an empty delimiter frame
+    if(type_ == ZMQ_DEALER)
+    {
+        if(!msg.more() || msg.size() != 0)
+            return ReadStatus::DecodeError;
+        if(!recvFrame(msg))
+            return ReadStatus::ReadError;
+    }
+
+    // a ROUTER socket receives the routing frames of the request (the identity of the
+    // peer, and any added by proxies in between), up to the empty delimiter frame
+    if(type_ == ZMQ_ROUTER)
+    {
+        route_.clear();
+        while(msg.size() != 0)
+        {
+            if(!msg.more())
+                return ReadStatus::DecodeError;
+            route_.emplace_back(static_cast<const char*>(msg.data()), msg.size());
+            if(!recvFrame(msg))
+                return ReadStatus::ReadError;
+        }
+        if(!msg.more())
+            return ReadStatus::DecodeError;
+        if(!recvFrame(msg))
+            return ReadStatus::ReadError;
+    }
+
+    // the headers, followed by one frame per part (see Socket::setMultipartFraming()):
+    if(msg.more())
+    {
+        std::shared_ptr<MultipartFrames> frames = std::make_shared<MultipartFrames>();
+        frames->headers.move(&msg);
+        bool more = true;
+        while(more)
+        {
+            frames->payloads.emplace_back();
+            zmq::message_t &frame = frames->payloads.back();
+            if(!recvFrame(frame))
+                return ReadStatus::ReadError;
+            more = frame.more();
+        }
+        for(auto &frame : frames->payloads)
+            payloads.emplace_back(static_cast<const char*>(frame.data()), frame.size());
+        keepalive = frames;
+        wire = boost::string_ref(static_cast<const char*>(frames->headers.data()), frames->headers.size());
+        return ReadStatus::Ok;
+    }
+
+    const char *data = static_cast<const char*>(msg.data());
+    if(b0::shm::isDescriptor(data, msg.size()))
+    {
+        // the envelope is read in place; a descriptor from another host, or referencing
+        // an envelope which has been overwritten already, is discarded (without waiting
+        // for the next message, which may not come)
+        if(!b0::shm::tryParseDescriptor(shm_descriptor_, data, msg.size()))
+            return ReadStatus::DecodeError;
+        if(shm_descriptor_.host != hostname_)
+            return ReadStatus::Incomplete;
+        const char *envelope;
+        keepalive = shm_reader_.pin(shm_descriptor_, envelope);
+        if(!keepalive)
+            return ReadStatus::Incomplete;
+        wire = boost::string_ref(envelope, shm_descriptor_.size);
+        return ReadStatus::Ok;
+    }
+
+    if(!b0::message::isChunk(data, msg.size()))
+    {
+        wire = boost::string_ref(data, msg.size());
+        return ReadStatus::Ok;
+    }
+
+    // the rest of the chunks is read by the next calls (not waited for here, as it may never come)
+    std::shared_ptr<std::string> reassembled;
+    if(!reassembler_.tryAdd(data, msg.size(), reassembled))
+        return ReadStatus::DecodeError;
+    if(!reassembled)
+        return ReadStatus::Incomplete;
+    accountAllocation(counters_.receive_allocations, reassembled->capacity());
+    keepalive = reassembled;
+    wire = boost::string_ref(*reassembled);
+    return ReadStatus::Ok;
+}
+
+Socket::Socket(Node *node, int type, const std::string &name, bool managed)
+    : private_(new Private(node, *reinterpret_cast<zmq::context_t*>(node->getContext()), type)),
+      node_(*node),
+      name_(name),
+      orig_name_(name),
+      managed_(managed),
+      envelope_format_(b0::message::EnvelopeFormat::Text),
+      message_codec_(b0::message::MessageCodec::JSON)
+{
+    setLingerPeriod(Global::getInstance().getLingerPeriod());
+    // off the I/O thread reserved to the high-priority sockets (see setHighPriority()):
+    if(uint64_t affinity = node_.ioThreadAffinity(false))
+        setAffinity(affinity);
+    spin_budget_messages_ = std::max(0, Global::getInstance().getSpinBudget());
+    if(Global::getInstance().getConnectionMonitor())
+        setConnectionMonitor(true, Global::getInstance().getConnectionMonitorWarnings());
+    for(auto &p : Global::getInstance().getSocketProfilePatterns())
+    {
+        if(!matchesPattern(p.first)) continue;
+        setProfile(p.second);
+        break;
+    }
+
+    if(boost::iequals(b0::env::get("B0_ENVELOPE_FORMAT"), "binary"))
+        envelope_format_ = b0::message::EnvelopeFormat::Binary;
+    else if(boost::iequals(b0::env::get("B0_ENVELOPE_FORMAT"), "binary_ids"))
+        envelope_format_ = b0::message::EnvelopeFormat::BinaryIds;
+
+    if(boost::iequals(b0::env::get("B0_MESSAGE_CODEC"), "msgpack"))
+        message_codec_ = b0::message::MessageCodec::MsgPack;
+
+    chunk_size_ = std::max(0, b0::env::getInt("B0_CHUNK_SIZE"));
+
+    multipart_framing_ = b0::env::getBool("B0_MULTIPART_FRAMING");
+
+    checksum_ = b0::env::getBool("B0_CHECKSUM");
+
+    int max_reassembly_size = b0::env::getInt("B0_MAX_REASSEMBLY_SIZE");
+    if(max_reassembly_size > 0)
+        private_->reassembler_.setMaxSize(max_reassembly_size);
+
+    if(managed_)
+        node_.addSocket(this);
+}
+
+Socket::~Socket()
+{
+    if(managed_)
+        node_.removeSocket(this);
+    private_->stopMonitor();
+}
+
+void Socket::spinOnce()
+{
+}
+
+bool Socket::hasCallback() const
+{
+    return false;
+}
+
+bool Socket::hasPendingMessages() const
+{
+    return false;
+}
+
+bool Socket::isReadInBackground() const
+{
+    return false;
+}
+
+size_t Socket::getQueueDepth() const
+{
+    return 0;
+}
+
+void Socket::setMemoryAccounting(bool enabled)
+{
+    private_->memory_accounting_ = enabled;
+}
+
+bool Socket::getMemoryAccounting() const
+{
+    return private_->memory_accounting_;
+}
+
+void Socket::setSpinBudget(int max_messages, double max_time)
+{
+    spin_budget_messages_ = std::max(0, max_messages);
+    spin_budget_usec_ = max_time > 0 ? int64_t(max_time * 1000000) : 0;
+}
+
+int Socket::getSpinBudgetMessages() const
+{
+    return spin_budget_messages_;
+}
+
+double Socket::getSpinBudgetTime() const
+{
+    return spin_budget_usec_ / 1000000.;
+}
+
+void Socket::setSpinPriority(int priority)
+{
+    spin_priority_ = std::max(1, priority);
+}
+
+int Socket::getSpinPriority() const
+{
+    return spin_priority_;
+}
+
+void Socket::setHighPriority(bool high_priority)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setHighPriority() must be called before init()");
+    high_priority_ = high_priority;
+    uint64_t affinity = node_.ioThreadAffinity(high_priority);
+    if(affinity)
+        setAffinity(affinity);
+}
+
+bool Socket::isHighPriority() const
+{
+    return high_priority_;
+}
+
+static int64_t steadyTimeUSec()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Socket::startSpinBudget()
+{
+    spin_count_ = 0;
+    if(spin_budget_usec_ > 0)
+        spin_deadline_ = steadyTimeUSec() + spin_budget_usec_;
+}
+
+bool Socket::spinBudgetLeft()
+{
+    // the first message is always processed, whatever the budget:
+    if(spin_count_++ == 0) return true;
+    if(spin_budget_messages_ > 0 && spin_count_ > spin_budget_messages_ * spin_priority_) return false;
+    if(spin_budget_usec_ > 0 && steadyTimeUSec() >= spin_deadline_) return false;
+    return true;
+}
+
+void Socket::setStrand(const std::string &strand)
+{
+    strand_ = strand;
+}
+
+const std::string & Socket::getStrand() const
+{
+    return strand_;
+}
+
+void Socket::log(logger::Level level, const std::string &message) const
+{
+    if(isLevelEnabled(level))
+        node_.log(level, message);
+}
+
+bool Socket::isLevelEnabled(logger::Level level) const
+{
+    // the level comparison is cheaper than the thread check, so it goes first:
+    return node_.isLevelEnabled(level) && node_.isNodeThread();
+}
+
+void Socket::setRemoteAddress(const std::string &addr)
+{
+    remote_addr_ = addr;
+}
+
+std::string Socket::getName() const
+{
+    return name_;
+}
+
+Node & Socket::getNode() const
+{
+    return node_;
+}
+
+bool Socket::matchesPattern(const std::string &pattern) const
+{
+    if(pattern == "*") return true;
+    size_t pos = pattern.find('.');
+    if(pos != std::string::npos)
+    {
+        std::string np = pattern.substr(0, pos);
+        std::string sp = pattern.substr(pos + 1);
+        return (np == "*" || np == getNode().getName())
+            && (sp == "*" || sp == getName());
+    }
+    return false;
+}
+
+void Socket::setDebugDump(bool enabled, bool extended)
+{
+    private_->debug_dump_.store(enabled ? (extended ? 2 : 1) : 0);
+}
+
+bool Socket::getDebugDump() const
+{
+    return debugDumpMode() > 0;
+}
+
+int Socket::debugDumpMode() const
+{
+    int mode = private_->debug_dump_.load(std::memory_order_relaxed);
+    if(mode >= 0) return mode;
+
+    // to enable debug for a socket, set B0_DEBUG_SOCKET to nodeName.sockName
+    // wildcards can be used (e.g.: *.sockName, nodeName.*, *.*, *)
+    // multiple patterns can be specified, using ':' as a separator
+    mode = 0;
+    std::string debug_socket = b0::env::get("B0_DEBUG_SOCKET");
+    if(!debug_socket.empty())
+    {
+        std::vector<std::string> debug_socket_v;
+        boost::split(debug_socket_v, debug_socket, boost::is_any_of(":;"));
+        for(auto &x : debug_socket_v) if(matchesPattern(x)) {mode = 1; break;}
+        if(mode && b0::env::getBool("B0_DEBUG_SOCKET_EXTENDED")) mode = 2;
+    }
+    // another thread may have called setDebugDump() in the meantime:
+    int expected = -1;
+    if(!private_->debug_dump_.compare_exchange_strong(expected, mode))
+        mode = expected;
+    return mode;
+}
+
+void Socket::dumpPayload(const char *op, const char *payload, size_t size) const
+{
+    int mode = debugDumpMode();
+    if(!mode) return;
+    bool ext = mode == 2;
+
+    std::stringstream dbg;
+    if(ext)
+    {
+        dbg << "socket " << getNode().getName() << "." << getName() << " " << op << " " << size << " bytes:" << std::endl << std::endl;
+        dbg.write(payload, size);
+        dbg << std::endl;
+    }
+    else
+    {
+        dbg << "B0_DEBUG_SOCKET[sock=" << getNode().getName() << "." << getName() << ", op=" << op << ", len=" << size << "]: ";
+        for(size_t i = 0; i < size; i++)
+        {
+            unsigned char c = payload[i];
+            if(c == '\n')
+                dbg << "\\n";
+            else if(c == '\r')
+                dbg << "\\r";
+            else if(c == '\t')
+                dbg << "\\t";
+            else if(c < 32 || c > 126)
+                dbg << boost::format("\\x%02x") % int(c);
+            else
+                dbg << char(c);
+        }
+    }
+    std::cout << dbg.str() << std::endl;
+}
+
+size_t Socket::dumpFrames(boost::string_ref headers, const std::vector<boost::string_ref> &payloads) const
+{
+    size_t size = headers.size();
+    for(auto &payload : payloads)
+    {
+        dumpPayload("recv frame", payload.data(), payload.size());
+        size += payload.size();
+    }
+    return size;
+}
+
+//! Throw the exception matching a failed read; return false if the envelope was filtered
+static bool throwReadError(ReadStatus status, const std::string &error, const std::string &name)
+{
+    switch(status)
+    {
+    case ReadStatus::Ok: return true;
+    case ReadStatus::Filtered: return false;
+    case ReadStatus::HeaderMismatch: throw exception::HeaderMismatch(error, name);
+    case ReadStatus::ReadError: throw exception::SocketReadError();
+    case ReadStatus::DecodeError: throw exception::EnvelopeDecodeError();
+    case ReadStatus::UnsupportedCompression: throw exception::UnsupportedCompressionAlgorithm(error);
+    case ReadStatus::ChecksumMismatch: throw exception::ChecksumMismatch(error);
+    case ReadStatus::Incomplete: throw exception::SocketReadError();
+    case ReadStatus::DecompressError: break;
+    }
+    throw exception::Exception(error);
+}
+
+static ReadStatus readStatus(b0::message::ParseStatus status)
+{
+    switch(status)
+    {
+    case b0::message::ParseStatus::Ok: return ReadStatus::Ok;
+    case b0::message::ParseStatus::Filtered: return ReadStatus::Filtered;
+    case b0::message::ParseStatus::DecodeError: return ReadStatus::DecodeError;
+    case b0::message::ParseStatus::UnsupportedCompression: return ReadStatus::UnsupportedCompression;
+    case b0::message::ParseStatus::ChecksumMismatch: return ReadStatus::ChecksumMismatch;
+    case b0::message::ParseStatus::DecompressError: break;
+    }
+    return ReadStatus::DecompressError;
+}
+
+void Socket::readRaw(b0::message::MessageEnvelope &env)
+{
+    std::string error;
+    ReadStatus status;
+    // (each call waits for the next frame, until the envelope is complete)
+    do status = tryReadRaw(env, &error);
+    while(status == ReadStatus::Incomplete);
+    throwReadError(status, error, name_);
+}
+
+void Socket::readRaw(b0::message::MessageEnvelopeView &env)
+{
+    readRaw(env, b0::message::HeaderFilter());
+}
+
+bool Socket::readRaw(b0::message::MessageEnvelopeView &env, const b0::message::HeaderFilter &filter)
+{
+    std::string error;
+    ReadStatus status;
+    do status = tryReadRaw(env, filter, &error);
+    while(status == ReadStatus::Incomplete);
+    return throwReadError(status, error, name_);
+}
+
+ReadStatus Socket::tryReadRaw(b0::message::MessageEnvelope &env, std::string *error)
+{
+    zmq::message_t msg_payload;
+    std::shared_ptr<const void> keepalive;
+    const std::vector<boost::string_ref> &payloads = private_->recv_payloads_;
+    boost::string_ref wire;
+    ReadStatus status = private_->recv(msg_payload, keepalive, private_->recv_payloads_, wire);
+    if(status != ReadStatus::Ok)
+    {
+        if(status != ReadStatus::Incomplete)
+            private_->counters_.readError();
+        return status;
+    }
+
+    dumpPayload("recv", wire.data(), wire.size());
+    size_t wire_bytes = dumpFrames(wire, payloads);
+    bool accounting = private_->memory_accounting_.load(std::memory_order_relaxed);
+    std::vector<size_t> &capacities = private_->part_capacities_;
+    if(accounting)
+    {
+        capacities.clear();
+        for(auto &part : env.parts) capacities.push_back(part.payload.capacity());
+    }
+    status = readStatus(tryParse(env, wire.data(), wire.size(), &private_->compression_context_, payloads.empty() ? nullptr : &payloads, error));
+    if(accounting)
+    {
+        // the payloads whose storage has grown, as the parts reuse it across messages
+        static const size_t empty_capacity = std::string().capacity();
+        for(size_t i = 0; i < env.parts.size(); i++)
+        {
+            size_t capacity = env.parts[i].payload.capacity();
+            if(capacity > (i < capacities.size() ? capacities[i] : empty_capacity))
+                private_->accountAllocation(private_->counters_.decode_allocations, capacity);
+        }
+    }
+    if(status == ReadStatus::Ok && !acceptsHeader0(env.header0))
+    {
+        if(error) *error = env.header0;
+        status = ReadStatus::HeaderMismatch;
+    }
+    if(status != ReadStatus::Ok)
+    {
+        private_->counters_.readError();
+        return status;
+    }
+
+    size_t payload_bytes = 0;
+    for(auto &part : env.parts) payload_bytes += part.payload.size();
+    private_->counters_.messageReceived(wire_bytes, payload_bytes);
+    return ReadStatus::Ok;
+}
+
+ReadStatus Socket::tryReadRaw(b0::message::MessageEnvelopeView &env, const b0::message::HeaderFilter &filter, std::string *error)
+{
+    std::shared_ptr<zmq::message_t> &msg_payload = private_->recv_message_;
+    if(env.buffer == msg_payload)
+        env.buffer.reset();
+    if(!msg_payload || msg_payload.use_count() > 1)
+        msg_payload = std::make_shared<zmq::message_t>();
+
+    std::shared_ptr<const void> keepalive;
+    const std::vector<boost::string_ref> &payloads = private_->recv_payloads_;
+    boost::string_ref wire;
+    ReadStatus status = private_->recv(*msg_payload, keepalive, private_->recv_payloads_, wire);
+    if(status != ReadStatus::Ok)
+    {
+        if(status != ReadStatus::Incomplete)
+            private_->counters_.readError();
+        return status;
+    }
+
+    // the envelope keeps the zmq message (or the reassembled buffer, or the shared memory, or
+    // the frames of a multipart message) alive, and its parts point into it
+    dumpPayload("recv", wire.data(), wire.size());
+    size_t wire_bytes = dumpFrames(wire, payloads);
+    if(keepalive)
+        env.buffer = std::move(keepalive);
+    else
+        env.buffer = msg_payload;
+    status = readStatus(tryParse(env, wire.data(), wire.size(), &private_->compression_context_, filter, payloads.empty() ? nullptr : &payloads, error));
+    // (the parts of a view point into the buffer, only the decompressed payloads are allocated)
+    if(private_->memory_accounting_.load(std::memory_order_relaxed))
+        for(auto &payload : env.decompressed_payloads)
+            private_->accountAllocation(private_->counters_.decode_allocations, payload.capacity());
+    // (the headers of a filtered envelope are parsed too)
+    if((status == ReadStatus::Ok || status == ReadStatus::Filtered) && !acceptsHeader0(env.header0))
+    {
+        if(error) *error = env.header0;
+        status = ReadStatus::HeaderMismatch;
+    }
+    if(status != ReadStatus::Ok && status != ReadStatus::Filtered)
+    {
+        private_->counters_.readError();
+        return status;
+    }
+
+    size_t payload_bytes = 0;
+    if(status == ReadStatus::Ok)
+        for(auto &part : env.parts) payload_bytes += part.size;
+    private_->counters_.messageReceived(wire_bytes, payload_bytes);
+    return status;
+}
+
+void Socket::readFailed(ReadStatus status, const std::string &error)
+{
+    switch(status)
+    {
+    case ReadStatus::Ok:
+    case ReadStatus::Filtered:
+    case ReadStatus::Incomplete:
+        return;
+    case ReadStatus::HeaderMismatch:
+        debug("Dropped a message for '%s'", error);
+        return;
+    case ReadStatus::ReadError:
+        debug("Dropped a message which could not be received");
+        return;
+    case ReadStatus::DecodeError:
+        debug("Dropped a malformed message");
+        return;
+    case ReadStatus::UnsupportedCompression:
+        debug("Dropped a message compressed with the unsupported algorithm '%s'", error);
+        return;
+    case ReadStatus::DecompressError:
+        debug("Dropped a message which could not be decompressed: %s", error);
+        return;
+    case ReadStatus::ChecksumMismatch:
+        // (not expected on a healthy link, unlike the other cases)
+        warn("Dropped a message corrupted in transit (checksum mismatch in %s)", error);
+        return;
+    }
+}
+
+boost::string_ref Socket::readWire(std::shared_ptr<const void> &buffer)
+{
+    std::shared_ptr<zmq::message_t> &msg_payload = private_->recv_message_;
+    if(buffer == msg_payload)
+        buffer.reset();
+    if(!msg_payload || msg_payload.use_count() > 1)
+        msg_payload = std::make_shared<zmq::message_t>();
+
+    std::shared_ptr<const void> keepalive;
+    const std::vector<boost::string_ref> &payloads = private_->recv_payloads_;
+    boost::string_ref wire;
+    ReadStatus status;
+    do status = private_->recv(*msg_payload, keepalive, private_->recv_payloads_, wire);
+    while(status == ReadStatus::Incomplete);
+    throwReadError(status, "", name_);
+    dumpPayload("recv", wire.data(), wire.size());
+    dumpFrames(wire, payloads);
+    if(!payloads.empty())
+    {
+        // the headers are those of the contiguous envelope, so it is rebuilt by appending the payloads
+        std::shared_ptr<std::string> joined = std::make_shared<std::string>(wire.data(), wire.size());
+        for(auto &payload : payloads)
+            joined->append(payload.data(), payload.size());
+        private_->accountAllocation(private_->counters_.receive_allocations, joined->capacity());
+        buffer = joined;
+        wire = boost::string_ref(*joined);
+    }
+    else if(keepalive)
+        buffer = std::move(keepalive);
+    else
+        buffer = msg_payload;
+
+    private_->counters_.messageReceived(wire.size(), 0);
+    return wire;
+}
+
+void Socket::readRaw(std::vector<b0::message::MessagePart> &parts)
+{
+    // swapping gives the previous parts back to the envelope, which reuses their storage
+    b0::message::MessageEnvelope &env = private_->read_envelope_;
+    readRaw(env);
+    parts.swap(env.parts);
+}
+
+void Socket::readRaw(std::string &msg)
+{
+    std::string type;
+    readRaw(msg, type);
+}
+
+void Socket::readRaw(std::string &msg, std::string &type)
+{
+    b0::message::MessageEnvelope &env = private_->read_envelope_;
+    readRaw(env);
+    msg.swap(env.parts[0].payload);
+    type.swap(env.parts[0].content_type);
+}
+
+void * Socket::getZMQSocket() const
+{
+    return static_cast<void*>(private_->socket_);
+}
+
+int64_t Socket::getFileDescriptor() const
+{
+    // (cached, so that it can be compared without touching a socket used by another thread)
+    if(private_->fd_ != -1)
+        return private_->fd_;
+#ifdef _WIN32
+    SOCKET fd;
+#else
+    int fd;
+#endif
+    size_t size = sizeof(fd);
+    private_->socket_.getsockopt(ZMQ_FD, &fd, &size);
+    private_->fd_ = static_cast<int64_t>(fd);
+    return private_->fd_;
+}
+
+int Socket::getEvents() const
+{
+    int events = 0;
+    size_t size = sizeof(events);
+    private_->socket_.getsockopt(ZMQ_EVENTS, &events, &size);
+    return events;
+}
+
+bool Socket::poll(long timeout)
+{
+    zmq::socket_t &socket_ = private_->socket_;
+#ifdef __GNUC__
+    zmq::pollitem_t items[] = {{static_cast<void*>(socket_), 0, ZMQ_POLLIN, 0}};
+#else
+    zmq::pollitem_t items[] = {{socket_, 0, ZMQ_POLLIN, 0}};
+#endif
+    zmq::poll(&items[0], sizeof(items) / sizeof(items[0]), timeout);
+    return items[0].revents & ZMQ_POLLIN;
+}
+
+void Socket::writeRaw(const b0::message::MessageEnvelope &env)
+{
+    // serialize directly into the ZeroMQ message, allocated with the exact size
+    b0::message::EnvelopeSerializer &serializer = private_->serializer_;
+    serializer.setChecksum(checksum_);
+    size_t wire_bytes = serializer.prepare(env, envelope_format_, &private_->compression_context_);
+    if(adaptive_compression_)
+        updateCompressionRatio(env, serializer.getContentLengths());
+
+    size_t payload_bytes = 0;
+    for(auto &part : env.parts) payload_bytes += part.payload.size();
+
+    if(multipart_framing_ && !env.parts.empty())
+    {
+        // each payload is copied into its own frame, instead of after the headers
+        std::vector<zmq::message_t> &frames = private_->send_frames_;
+        frames.clear();
+        frames.emplace_back(serializer.getHeaderSize());
+        private_->accountAllocation(private_->counters_.send_allocations, frames[0].size());
+        serializer.writeHeaders(static_cast<char*>(frames[0].data()));
+        for(auto &payload : serializer.getPayloads())
+        {
+            frames.emplace_back();
+            private_->newMessage(frames.back(), payload.size());
+            std::memcpy(frames.back().data(), payload.data(), payload.size());
+        }
+        writeFrames(frames, payload_bytes);
+        return;
+    }
+
+    zmq::message_t msg_payload;
+    private_->newMessage(msg_payload, wire_bytes);
+    serializer.write(static_cast<char*>(msg_payload.data()));
+    dumpPayload("send", static_cast<const char*>(msg_payload.data()), wire_bytes);
+
+    private_->send(msg_payload, env.header0, chunk_size_, payload_bytes);
+}
+
+void Socket::writeFrames(std::vector<zmq::message_t> &frames, size_t payload_bytes)
+{
+    size_t wire_bytes = 0;
+    for(size_t i = 0; i < frames.size(); i++)
+    {
+        dumpPayload(i ? "send frame" : "send", static_cast<const char*>(frames[i].data()), frames[i].size());
+        wire_bytes += frames[i].size();
+    }
+    private_->sent(private_->sendMultipart(frames), wire_bytes, payload_bytes);
+}
+
+void Socket::writeRaw(const std::vector<b0::message::MessagePart> &parts)
+{
+    b0::message::MessageEnvelope env;
+    env.parts = parts;
+    env.header0 = name_;
+    prepareEnvelope(env);
+    writeRaw(env);
+}
+
+void Socket::writeRaw(std::vector<b0::message::MessagePart> &&parts)
+{
+    b0::message::MessageEnvelope env;
+    env.parts = std::move(parts);
+    env.header0 = name_;
+    prepareEnvelope(env);
+    writeRaw(env);
+}
+
+void Socket::writeRaw(const std::string &msg, const std::string &type)
+{
+    private_->accountAllocation(private_->counters_.send_allocations, msg.size());
+    writeRaw(std::string(msg), type);
+}
+
+void Socket::writeRaw(std::string &&msg, const std::string &type)
+{
+    // handed over to ZeroMQ as the payload frame, when the other frames are in place:
+    if(multipart_framing_ && compression_algorithm_.empty() && canWriteFrameInPlace(msg.size()))
+    {
+        std::unique_ptr<std::string> frame(new std::string(std::move(msg)));
+        writeFrame(std::move(frame), 0, type);
+        return;
+    }
+
+    b0::message::MessageEnvelope env;
+    env.parts.resize(1);
+    env.parts[0].payload = std::move(msg);
+    env.parts[0].content_type = type;
+    setPartCompression(env.parts[0]);
+    env.header0 = name_;
+    prepareEnvelope(env);
+    writeRaw(env);
+}
+
+std::unique_ptr<std::string> Socket::newFrame(size_t &header_space)
 {
-    setLingerPeriod(5000);
+    header_space = private_->frame_header_space_;
+    std::unique_ptr<std::string> frame(new std::string);
+    frame->reserve(std::max(private_->frame_size_hint_, header_space));
+    frame->resize(header_space);
+    private_->accountAllocation(private_->counters_.send_allocations, frame->capacity());
+    return frame;
+}
 
-    if(managed_)
-        node_.addSocket(this);
+static void freeFrame(void *data, void *hint)
+{
+    delete static_cast<std::string*>(hint);
 }
 
-Socket::~Socket()
+void Socket::writeFrame(std::unique_ptr<std::string> frame, size_t header_space, const std::string &type)
 {
-    if(managed_)
-        node_.removeSocket(this);
+    private_->frame_size_hint_ = frame->size();
+
+    b0::message::MessageEnvelope &env = private_->frame_envelope_;
+    env.header0 = name_;
+    env.headers.clear();
+    env.parts.resize(1);
+    b0::message::MessagePart &part = env.parts[0];
+    part.content_type = type;
+    part.payload.clear();
+    boost::string_ref payload(frame->data() + header_space, frame->size() - header_space);
+
+    bool in_place = compression_algorithm_.empty() && canWriteFrameInPlace(payload.size());
+    if(!in_place)
+    {
+        part.payload.assign(payload.data(), payload.size());
+        setPartCompression(part);
+        prepareEnvelope(env);
+        writeRaw(env);
+        return;
+    }
+
+    part.compression_algorithm.clear();
+    part.compression_level = 0;
+    part.compression_dictionary.clear();
+    prepareEnvelope(env);
+
+    b0::message::EnvelopeSerializer &serializer = private_->serializer_;
+    serializer.setChecksum(checksum_);
+    size_t header_size = serializer.prepareHeaders(env, envelope_format_, payload);
+    if(multipart_framing_)
+    {
+        // the headers go in their own frame, and the payload frame is the buffer it was encoded into
+        std::vector<zmq::message_t> &frames = private_->send_frames_;
+        frames.clear();
+        frames.emplace_back(header_size);
+        private_->accountAllocation(private_->counters_.send_allocations, header_size);
+        serializer.writeHeaders(static_cast<char*>(frames[0].data()));
+        frames.emplace_back(const_cast<char*>(payload.data()), payload.size(), &freeFrame, frame.release());
+        writeFrames(frames, payload.size());
+        return;
+    }
+    if(header_size > header_space)
+    {
+        // leave more space next time
+        private_->frame_header_space_ = header_size + 64;
+        part.payload.assign(payload.data(), payload.size());
+        writeRaw(env);
+        return;
+    }
+
+    char *wire = &(*frame)[header_space - header_size];
+    size_t wire_bytes = header_size + payload.size();
+    serializer.writeHeaders(wire);
+    dumpPayload("send", wire, wire_bytes);
+
+    // the frame is freed by ZeroMQ once sent
+    std::string *frame_ptr = frame.release();
+    zmq::message_t msg_payload(wire, wire_bytes, &freeFrame, frame_ptr);
+
+    private_->send(msg_payload, env.header0, chunk_size_, payload.size());
 }
 
-void Socket::spinOnce()
+bool Socket::canWriteFrameInPlace(size_t payload_size) const
 {
+    return true;
 }
 
-void Socket::log(logger::Level level, const std::string &message) const
+bool Socket::acceptsHeader0(const std::string &header0) const
 {
-    if(boost::lexical_cast<std::string>(boost::this_thread::get_id()) == node_.threadID())
-        node_.log(level, message);
+    return header0 == name_;
 }
 
-void Socket::setRemoteAddress(const std::string &addr)
+void Socket::writeWire(const char *data, size_t size)
 {
-    remote_addr_ = addr;
+    const char *eol = static_cast<const char*>(std::memchr(data, '\n', size));
+    if(!eol)
+        throw exception::EnvelopeDecodeError();
+
+    zmq::message_t msg_payload;
+    private_->newMessage(msg_payload, size);
+    std::memcpy(msg_payload.data(), data, size);
+    dumpPayload("send", data, size);
+    private_->send(msg_payload, std::string(data, eol), chunk_size_, 0);
 }
 
-std::string Socket::getName() const
+void Socket::writeWire(const char *data, size_t size, const std::string &header0)
 {
-    return name_;
+    const char *eol = static_cast<const char*>(std::memchr(data, '\n', size));
+    if(!eol)
+        throw exception::EnvelopeDecodeError();
+
+    size_t rest = size - (eol - data);
+    zmq::message_t msg_payload;
+    private_->newMessage(msg_payload, header0.size() + rest);
+    char *out = static_cast<char*>(msg_payload.data());
+    std::memcpy(out, header0.data(), header0.size());
+    std::memcpy(out + header0.size(), eol, rest);
+    dumpPayload("send", out, msg_payload.size());
+    private_->send(msg_payload, header0, chunk_size_, 0);
 }
 
-Node & Socket::getNode() const
+static void releaseWire(void *data, void *hint)
 {
-    return node_;
+    delete static_cast<std::shared_ptr<const std::string>*>(hint);
 }
 
-bool Socket::matchesPattern(const std::string &pattern) const
+void Socket::writeWire(const std::shared_ptr<const std::string> &wire)
 {
-    if(pattern == "*") return true;
-    size_t pos = pattern.find('.');
-    if(pos != std::string::npos)
-    {
-        std::string np = pattern.substr(0, pos);
-        std::string sp = pattern.substr(pos + 1);
-        return (np == "*" || np == getNode().getName())
-            && (sp == "*" || sp == getName());
-    }
-    return false;
+    const char *data = wire->data();
+    const char *eol = static_cast<const char*>(std::memchr(data, '\n', wire->size()));
+    if(!eol)
+        throw exception::EnvelopeDecodeError();
+
+    zmq::message_t msg_payload(const_cast<char*>(data), wire->size(), &releaseWire, new std::shared_ptr<const std::string>(wire));
+    dumpPayload("send", data, wire->size());
+    private_->send(msg_payload, std::string(data, eol), chunk_size_, 0);
 }
 
-static void dumpPayload(const Socket &socket, const std::string &op, const std::string &payload)
+void Socket::writeControlFrame(const std::string &frame, size_t payload_bytes)
 {
-    // to enable debug for a socket, set B0_DEBUG_SOCKET to nodeName.sockName
-    // wildcards can be used (e.g.: *.sockName, nodeName.*, *.*, *)
-    // multiple patterns can be specified, using ':' as a separator
-    std::string debug_socket = b0::env::get("B0_DEBUG_SOCKET");
-    bool ext = b0::env::getBool("B0_DEBUG_SOCKET_EXTENDED");
-    std::vector<std::string> debug_socket_v;
-    boost::split(debug_socket_v, debug_socket, boost::is_any_of(":;"));
-    bool debug_enabled = false;
-    for(auto &x : debug_socket_v) if(socket.matchesPattern(x)) {debug_enabled = true; break;}
-    if(!debug_enabled) return;
+    zmq::message_t msg_payload(frame.size());
+    private_->accountAllocation(private_->counters_.send_allocations, frame.size());
+    std::memcpy(msg_payload.data(), frame.data(), frame.size());
+    dumpPayload("send", frame.data(), frame.size());
+    private_->sent(private_->sendFrame(msg_payload), frame.size(), payload_bytes);
+}
 
-    std::stringstream dbg;
-    if(ext)
+void Socket::getRoute(std::vector<std::string> &route) const
+{
+    route = private_->route_;
+}
+
+void Socket::setRoute(const std::vector<std::string> &route)
+{
+    private_->route_ = route;
+}
+
+SocketCounters & Socket::getCounters()
+{
+    return private_->counters_;
+}
+
+const SocketCounters & Socket::getCounters() const
+{
+    return private_->counters_;
+}
+
+void Socket::getMetrics(b0::message::metrics::SocketMetrics &metrics) const
+{
+    const SocketCounters &c = private_->counters_;
+    metrics.name = name_;
+    switch(private_->type_)
     {
-        dbg << "socket " << socket.getNode().getName() << "." << socket.getName() << " " << op << " " << payload.size() << " bytes:" << std::endl << std::endl << payload << std::endl;
+    case ZMQ_PUB:
+    case ZMQ_XPUB: metrics.socket_type = "publisher"; break;
+    case ZMQ_SUB: metrics.socket_type = "subscriber"; break;
+    case ZMQ_REQ:
+    case ZMQ_DEALER: metrics.socket_type = "service_client"; break;
+    case ZMQ_REP:
+    case ZMQ_ROUTER: metrics.socket_type = "service_server"; break;
+    default: metrics.socket_type = "socket"; break;
     }
-    else
+    metrics.messages_sent = c.messages_sent.load();
+    metrics.bytes_sent = c.bytes_sent.load();
+    metrics.payload_bytes_sent = c.payload_bytes_sent.load();
+    metrics.messages_received = c.messages_received.load();
+    metrics.bytes_received = c.bytes_received.load();
+    metrics.payload_bytes_received = c.payload_bytes_received.load();
+    metrics.compression_algorithm = compression_algorithm_;
+    metrics.compression_adaptive = adaptive_compression_;
+    metrics.compression_ratio = c.compression_ratio.load();
+    metrics.compression_skipped = c.compression_skipped.load();
+    metrics.messages_dropped = c.messages_dropped.load();
+    metrics.read_errors = c.read_errors.load();
+    metrics.connects = c.connects.load();
+    metrics.disconnects = c.disconnects.load();
+    metrics.reconnects = c.reconnects.load();
+    metrics.connect_retries = c.connect_retries.load();
+    metrics.handshake_failures = c.handshake_failures.load();
+    metrics.connect_max_usec = c.connect_time.max();
+    metrics.connect_p99_usec = c.connect_time.percentile(99);
+    metrics.handshake_p99_usec = c.handshake_time.percentile(99);
+    metrics.callback_count = c.callback_duration.count();
+    metrics.callback_total_usec = c.callback_duration.total();
+    metrics.callback_max_usec = c.callback_duration.max();
+    metrics.callback_p50_usec = c.callback_duration.percentile(50);
+    metrics.callback_p90_usec = c.callback_duration.percentile(90);
+    metrics.callback_p99_usec = c.callback_duration.percentile(99);
+    metrics.callback_cpu_total_usec = c.callback_cpu.total();
+    metrics.callback_cpu_max_usec = c.callback_cpu.max();
+    metrics.callback_cpu_p99_usec = c.callback_cpu.percentile(99);
+    metrics.queue_depth = getQueueDepth();
+    metrics.receive_allocations = c.receive_allocations.allocations.load();
+    metrics.receive_allocated_bytes = c.receive_allocations.bytes.load();
+    metrics.decode_allocations = c.decode_allocations.allocations.load();
+    metrics.decode_allocated_bytes = c.decode_allocations.bytes.load();
+    metrics.send_allocations = c.send_allocations.allocations.load();
+    metrics.send_allocated_bytes = c.send_allocations.bytes.load();
+    metrics.receive_queue_bytes = c.receive_queue.bytes.load();
+    metrics.receive_queue_peak_bytes = c.receive_queue.peak_bytes.load();
+    metrics.write_queue_bytes = c.write_queue.bytes.load();
+    metrics.write_queue_peak_bytes = c.write_queue.peak_bytes.load();
+}
+
+void Socket::prepareEnvelope(b0::message::MessageEnvelope &env)
+{
+}
+
+void Socket::setCompression(const std::string &algorithm, int level, const std::string &dictionary)
+{
+    compression_algorithm_ = algorithm;
+    compression_level_ = level;
+    compression_dictionary_ = dictionary;
+    adaptive_ratio_ = -1;
+    adaptive_probe_countdown_ = 0;
+}
+
+void Socket::setAdaptiveCompression(bool enabled, size_t min_size, double max_ratio, int probe_interval)
+{
+    adaptive_compression_ = enabled;
+    adaptive_min_size_ = min_size;
+    adaptive_max_ratio_ = max_ratio;
+    adaptive_probe_interval_ = probe_interval > 0 ? probe_interval : 1;
+    adaptive_probe_countdown_ = 0;
+    adaptive_ratio_ = -1;
+}
+
+bool Socket::getAdaptiveCompression() const
+{
+    return adaptive_compression_;
+}
+
+void Socket::setPartCompression(b0::message::MessagePart &part)
+{
+    part.compression_algorithm = compression_algorithm_;
+    part.compression_level = compression_level_;
+    part.compression_dictionary = compression_dictionary_;
+
+    if(!adaptive_compression_ || compression_algorithm_.empty()) return;
+
+    bool compress = part.payload.size() >= adaptive_min_size_;
+    if(compress && adaptive_ratio_ > adaptive_max_ratio_)
     {
-        dbg << "B0_DEBUG_SOCKET[sock=" << socket.getNode().getName() << "." << socket.getName() << ", op=" << op << ", len=" << payload.size() << "]: ";
-        for(size_t i = 0; i < payload.size(); i++)
+        // compression is not paying off: only probe again every now and then
+        if(adaptive_probe_countdown_ > 0)
         {
-            unsigned char c = payload[i];
-            if(c == '\n')
-                dbg << "\\n";
-            else if(c == '\r')
-                dbg << "\\r";
-            else if(c == '\t')
-                dbg << "\\t";
-            else if(c < 32 || c > 126)
-                dbg << boost::format("\\x%02x") % int(c);
-            else
-                dbg << char(c);
+            adaptive_probe_countdown_--;
+            compress = false;
         }
+        else adaptive_probe_countdown_ = adaptive_probe_interval_ - 1;
+    }
+
+    if(!compress)
+    {
+        part.compression_algorithm = "";
+        part.compression_level = 0;
+        part.compression_dictionary = "";
+        private_->counters_.compression_skipped.fetch_add(1, std::memory_order_relaxed);
     }
-    std::cout << dbg.str() << std::endl;
 }
 
-void Socket::readRaw(b0::message::MessageEnvelope &env)
+void Socket::updateCompressionRatio(const b0::message::MessageEnvelope &env, const std::vector<size_t> &content_lengths)
 {
-    zmq::socket_t &socket_ = private_->socket_;
-    zmq::message_t msg_payload;
-
-    if(!socket_.recv(&msg_payload))
-        throw exception::SocketReadError();
-
-    // check zmq single-part
-    if(msg_payload.more())
-        throw exception::MessageTooManyPartsError();
+    for(size_t i = 0; i < env.parts.size() && i < content_lengths.size(); i++)
+    {
+        if(env.parts[i].compression_algorithm.empty() || env.parts[i].payload.empty()) continue;
+        double ratio = double(content_lengths[i]) / env.parts[i].payload.size();
+        bool was_suspended = adaptive_ratio_ > adaptive_max_ratio_;
+        // a probe replaces the average, so that compression resumes as soon as it pays off:
+        adaptive_ratio_ = adaptive_ratio_ < 0 || was_suspended ? ratio : 0.8 * adaptive_ratio_ + 0.2 * ratio;
+        if(adaptive_ratio_ > adaptive_max_ratio_ && !was_suspended)
+            adaptive_probe_countdown_ = adaptive_probe_interval_ - 1;
+        private_->counters_.compression_ratio.store(adaptive_ratio_, std::memory_order_relaxed);
+    }
+}
 
-    std::string payload = std::string(static_cast<char*>(msg_payload.data()), msg_payload.size());
-    dumpPayload(*this, "recv", payload);
-    parse(env, payload);
+void Socket::setEnvelopeFormat(b0::message::EnvelopeFormat format)
+{
+    envelope_format_ = format;
+}
 
-    if(env.header0 != name_)
-        throw exception::HeaderMismatch(env.header0, name_);
+b0::message::EnvelopeFormat Socket::getEnvelopeFormat() const
+{
+    return envelope_format_;
 }
 
-void Socket::readRaw(std::vector<b0::message::MessagePart> &parts)
+void Socket::setMessageCodec(b0::message::MessageCodec codec)
 {
-    b0::message::MessageEnvelope env;
-    readRaw(env);
-    parts = env.parts;
+    message_codec_ = codec;
 }
 
-void Socket::readRaw(std::string &msg)
+b0::message::MessageCodec Socket::getMessageCodec() const
 {
-    std::string type;
-    readRaw(msg, type);
+    return message_codec_;
 }
 
-void Socket::readRaw(std::string &msg, std::string &type)
+void Socket::setMultipartFraming(bool enabled)
 {
-    b0::message::MessageEnvelope env;
-    readRaw(env);
-    msg = env.parts[0].payload;
-    type = env.parts[0].content_type;
+    multipart_framing_ = enabled;
 }
 
-bool Socket::poll(long timeout)
+bool Socket::getMultipartFraming() const
 {
-    zmq::socket_t &socket_ = private_->socket_;
-#ifdef __GNUC__
-    zmq::pollitem_t items[] = {{static_cast<void*>(socket_), 0, ZMQ_POLLIN, 0}};
-#else
-    zmq::pollitem_t items[] = {{socket_, 0, ZMQ_POLLIN, 0}};
-#endif
-    zmq::poll(&items[0], sizeof(items) / sizeof(items[0]), timeout);
-    return items[0].revents & ZMQ_POLLIN;
+    return multipart_framing_;
 }
 
-void Socket::writeRaw(const b0::message::MessageEnvelope &env)
+void Socket::setChecksum(bool enabled)
 {
-    std::string payload;
-    serialize(env, payload);
-    dumpPayload(*this, "send", payload);
+    checksum_ = enabled;
+}
 
-    // write payload
-    zmq::message_t msg_payload(payload.size());
-    std::memcpy(msg_payload.data(), payload.data(), payload.size());
-    zmq::socket_t &socket_ = private_->socket_;
-    if(!socket_.send(msg_payload))
-        throw exception::SocketWriteError();
+bool Socket::getChecksum() const
+{
+    return checksum_;
 }
 
-void Socket::writeRaw(const std::vector<b0::message::MessagePart> &parts)
+void Socket::setChunkSize(size_t size)
 {
-    b0::message::MessageEnvelope env;
-    env.parts = parts;
-    env.header0 = name_;
-    writeRaw(env);
+    chunk_size_ = size;
 }
 
-void Socket::writeRaw(const std::string &msg, const std::string &type)
+size_t Socket::getChunkSize() const
 {
-    zmq::socket_t &socket_ = private_->socket_;
+    return chunk_size_;
+}
 
-    b0::message::MessageEnvelope env;
-    env.parts.resize(1);
-    env.parts[0].payload = msg;
-    env.parts[0].content_type = type;
-    env.parts[0].compression_algorithm = compression_algorithm_;
-    env.parts[0].compression_level = compression_level_;
-    env.header0 = name_;
-    writeRaw(env);
+void Socket::setMaxReassemblySize(size_t size)
+{
+    private_->reassembler_.setMaxSize(size);
 }
 
-void Socket::setCompression(const std::string &algorithm, int level)
+size_t Socket::getMaxReassemblySize() const
 {
-    compression_algorithm_ = algorithm;
-    compression_level_ = level;
+    return private_->reassembler_.getMaxSize();
 }
 
 int Socket::getReadTimeout() const
@@ -297,9 +1639,143 @@ void Socket::setWriteHWM(int n)
     setIntOption(ZMQ_SNDHWM, n);
 }
 
+uint64_t Socket::getAffinity() const
+{
+    uint64_t affinity;
+    size_t len = sizeof(affinity);
+    getsockopt(ZMQ_AFFINITY, &affinity, &len);
+    return affinity;
+}
+
+void Socket::setAffinity(uint64_t affinity)
+{
+    setsockopt(ZMQ_AFFINITY, &affinity, sizeof(affinity));
+}
+
+void Socket::setConnectionMonitor(bool enabled, bool warnings)
+{
+    private_->connection_monitor_ = enabled ? (warnings ? 2 : 1) : 0;
+    if(!enabled)
+        private_->stopMonitor();
+}
+
+bool Socket::getConnectionMonitor() const
+{
+    return private_->connection_monitor_ > 0;
+}
+
+void Socket::pollConnectionEvents()
+{
+    if(!private_->monitor_) return;
+
+    // each event is a frame with its id (16 bit) and value (32 bit), and one with the endpoint
+    zmq::message_t event, endpoint;
+    while(private_->monitor_->recv(&event, ZMQ_DONTWAIT))
+    {
+        if(!event.more() || !private_->monitor_->recv(&endpoint))
+            break;
+        if(event.size() < 6) continue;
+        uint16_t id;
+        std::memcpy(&id, event.data(), sizeof(id));
+        connectionEvent(id, std::string(static_cast<const char*>(endpoint.data()), endpoint.size()));
+    }
+}
+
+void Socket::connectionEvent(int event, const std::string &addr)
+{
+    SocketCounters &c = private_->counters_;
+    int64_t now = steadyTimeUSec();
+    Private::Endpoint &endpoint = private_->endpoints_[addr];
+    bool warnings = private_->connection_monitor_ > 1;
+    switch(event)
+    {
+    case ZMQ_EVENT_CONNECTED:
+        {
+            int64_t since = endpoint.since ? endpoint.since : private_->last_connect_;
+            c.connected(since ? now - since : 0, endpoint.lost);
+            if(endpoint.lost)
+            {
+                if(warnings)
+                    warn("Reconnected to %s after %d ms", addr, (now - since) / 1000);
+                else
+                    debug("Reconnected to %s after %d ms", addr, (now - since) / 1000);
+            }
+            endpoint.lost = false;
+            endpoint.since = now;
+        }
+        break;
+    case ZMQ_EVENT_ACCEPTED:
+        // (the time to connect is the peer's)
+        c.connects.fetch_add(1, std::memory_order_relaxed);
+        endpoint.since = now;
+        break;
+    case ZMQ_EVENT_CONNECT_RETRIED:
+        c.connect_retries.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case ZMQ_EVENT_DISCONNECTED:
+        c.disconnects.fetch_add(1, std::memory_order_relaxed);
+        if(warnings)
+            warn("Disconnected from %s", addr);
+        else
+            debug("Disconnected from %s", addr);
+        endpoint.lost = true;
+        endpoint.since = now;
+        break;
+#ifdef ZMQ_EVENT_HANDSHAKE_SUCCEEDED
+    case ZMQ_EVENT_HANDSHAKE_SUCCEEDED:
+        if(endpoint.since)
+            c.handshake_time.record(now - endpoint.since);
+        break;
+    case ZMQ_EVENT_HANDSHAKE_FAILED_NO_DETAIL:
+    case ZMQ_EVENT_HANDSHAKE_FAILED_PROTOCOL:
+    case ZMQ_EVENT_HANDSHAKE_FAILED_AUTH:
+        c.handshake_failures.fetch_add(1, std::memory_order_relaxed);
+        if(warnings)
+            warn("Handshake with %s failed", addr);
+        else
+            debug("Handshake with %s failed", addr);
+        break;
+#endif
+    }
+}
+
+void Socket::setProfile(const std::string &name)
+{
+    applyProfile(Global::getInstance().getSocketProfile(name));
+    private_->profile_ = name;
+}
+
+std::string Socket::getProfile() const
+{
+    return private_->profile_;
+}
+
+void Socket::applyProfile(const SocketProfile &profile)
+{
+    if(profile.read_hwm) setReadHWM(*profile.read_hwm);
+    if(profile.write_hwm) setWriteHWM(*profile.write_hwm);
+    if(profile.immediate) setImmediate(*profile.immediate);
+    if(profile.conflate) setConflate(*profile.conflate);
+    if(profile.linger) setLingerPeriod(*profile.linger);
+    if(profile.send_buffer) setIntOption(ZMQ_SNDBUF, *profile.send_buffer);
+    if(profile.receive_buffer) setIntOption(ZMQ_RCVBUF, *profile.receive_buffer);
+    if(profile.tcp_keepalive) setIntOption(ZMQ_TCP_KEEPALIVE, *profile.tcp_keepalive);
+    if(profile.tcp_keepalive_idle) setIntOption(ZMQ_TCP_KEEPALIVE_IDLE, *profile.tcp_keepalive_idle);
+    if(profile.tos) setIntOption(ZMQ_TOS, *profile.tos);
+    private_->profile_.clear();
+}
+
 void Socket::connect(const std::string &addr)
 {
     zmq::socket_t &socket_ = private_->socket_;
+    if(private_->connection_monitor_)
+    {
+        private_->startMonitor(*reinterpret_cast<zmq::context_t*>(node_.getContext()));
+        private_->last_connect_ = steadyTimeUSec();
+        Private::Endpoint &endpoint = private_->endpoints_[addr];
+        endpoint.since = private_->last_connect_;
+        endpoint.lost = false;
+    }
     socket_.connect(addr);
 }
 
@@ -312,6 +1788,7 @@ void Socket::disconnect(const std::string &addr)
 void Socket::bind(const std::string &addr)
 {
     zmq::socket_t &socket_ = private_->socket_;
+    private_->startMonitor(*reinterpret_cast<zmq::context_t*>(node_.getContext()));
     socket_.bind(addr);
 }
 
@@ -321,6 +1798,131 @@ void Socket::unbind(const std::string &addr)
     socket_.unbind(addr);
 }
 
+int Socket::bindEphemeralPort()
+{
+    zmq::socket_t &socket_ = private_->socket_;
+    private_->startMonitor(*reinterpret_cast<zmq::context_t*>(node_.getContext()));
+    socket_.bind("tcp://*:*");
+    char endpoint[256];
+    size_t size = sizeof(endpoint);
+    socket_.getsockopt(ZMQ_LAST_ENDPOINT, endpoint, &size);
+    // e.g. "tcp://0.0.0.0:41234"
+    std::string addr(endpoint, size > 0 && endpoint[size - 1] == '\0' ? size - 1 : size);
+    size_t colon = addr.rfind(':');
+    if(colon == std::string::npos)
+        throw exception::Exception("cannot read the bound port from " + addr);
+    return std::stoi(addr.substr(colon + 1));
+}
+
+std::string Socket::bindIPC(int port)
+{
+    std::string addr = node_.ipcAddress(port);
+    if(addr.empty()) return addr;
+    try
+    {
+        private_->socket_.bind(addr);
+    }
+    catch(zmq::error_t &ex)
+    {
+        warn("Cannot bind %s (see B0_IPC_DIR), using TCP only: %s", addr, ex.what());
+        return "";
+    }
+    debug("Bound to %s", addr);
+    return addr;
+}
+
+bool Socket::isMulticastAddress(const std::string &addr)
+{
+    return boost::algorithm::starts_with(addr, "epgm://") || boost::algorithm::starts_with(addr, "pgm://");
+}
+
+void Socket::setCountWriteDrops(bool enabled)
+{
+    private_->count_write_drops_ = enabled;
+}
+
+bool Socket::getLastWriteDropped() const
+{
+    return private_->last_write_dropped_;
+}
+
+void Socket::setWriteQueueLimit(size_t max_bytes)
+{
+    private_->write_queue_limit_ = max_bytes;
+}
+
+size_t Socket::getWriteQueueLimit() const
+{
+    return private_->write_queue_limit_;
+}
+
+size_t Socket::getWriteQueueBytes() const
+{
+    return private_->write_queue_bytes_.load();
+}
+
+bool Socket::flushWriteQueue()
+{
+    return private_->flushWriteQueue();
+}
+
+void Socket::setSocketType(int type)
+{
+    if(type == private_->type_) return;
+
+    // (the monitor is started again by the next connect or bind)
+    private_->stopMonitor();
+    int linger = getLingerPeriod();
+    int read_hwm = getReadHWM(), write_hwm = getWriteHWM();
+    int read_timeout = getReadTimeout(), write_timeout = getWriteTimeout();
+
+    private_->socket_ = zmq::socket_t(*reinterpret_cast<zmq::context_t*>(node_.getContext()), type);
+    private_->type_ = type;
+    private_->fd_ = -1;
+
+    // the other options of the profile (kernel buffers, TOS...) are not carried over below:
+    if(!private_->profile_.empty())
+        setProfile(private_->profile_);
+    setLingerPeriod(linger);
+    setReadHWM(read_hwm);
+    setWriteHWM(write_hwm);
+    setReadTimeout(read_timeout);
+    setWriteTimeout(write_timeout);
+
+    // the node polls the handle of the socket:
+    if(managed_)
+    {
+        node_.removeSocket(this);
+        node_.addSocket(this);
+    }
+}
+
+void Socket::swapZMQSocket(zmq::socket_t &socket)
+{
+    private_->stopMonitor();
+    int linger = getLingerPeriod();
+    int read_hwm = getReadHWM(), write_hwm = getWriteHWM();
+    int read_timeout = getReadTimeout(), write_timeout = getWriteTimeout();
+
+    zmq::socket_t previous(std::move(private_->socket_));
+    private_->socket_ = std::move(socket);
+    socket = std::move(previous);
+    private_->fd_ = -1;
+
+    setLingerPeriod(linger);
+    setReadHWM(read_hwm);
+    setWriteHWM(write_hwm);
+    setReadTimeout(read_timeout);
+    setWriteTimeout(write_timeout);
+
+    // the node polls the handle of the socket:
+    if(managed_)
+    {
+        node_.removeSocket(this);
+        node_.addSocket(this);
+    }
+}
+
 void Socket::setsockopt(int option, const void *optval, size_t optvallen)
 {
     zmq::socket_t &socket_ = private_->socket_;
@@ -0,0 +1,273 @@
+#include <b0/spinner.h>
+#include <b0/node.h>
+#include <b0/exceptions.h>
+#include <b0/utils/thread_name.h>
+#include <b0/utils/thread_config.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include <boost/format.hpp>
+
+#include <zmq.hpp>
+
+namespace b0
+{
+
+//! Maximum time waited in a poll, to notice shutdown() and stop() of the nodes
+static const int64_t max_poll_usec = 100000;
+
+struct Spinner::Private
+{
+    Private(Spinner *spinner)
+        : context_(0),
+          wakeup_rx_(context_, ZMQ_PULL),
+          wakeup_tx_(context_, ZMQ_PUSH)
+    {
+        std::string addr = (boost::format("inproc://b0-spinner-wakeup-%p") % spinner).str();
+        int linger = 0;
+        wakeup_rx_.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+        wakeup_tx_.setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+        wakeup_rx_.bind(addr);
+        wakeup_tx_.connect(addr);
+    }
+
+    //! The context of the wakeup channel (inproc only, it needs no I/O thread)
+    zmq::context_t context_;
+
+    //! Receiving end of the wakeup channel, polled together with the sockets of the nodes
+    zmq::socket_t wakeup_rx_;
+
+    //! Sending end of the wakeup channel (protected by Spinner::mutex_)
+    zmq::socket_t wakeup_tx_;
+};
+
+Spinner::Spinner(int num_threads)
+    : num_threads_(std::max(1, num_threads)),
+      private_(new Private(this))
+{
+}
+
+Spinner::~Spinner()
+{
+    stop();
+    for(auto &thread : threads_)
+        thread.join();
+}
+
+void Spinner::addNode(Node *node)
+{
+    if(!threads_.empty())
+        throw exception::Exception("Cannot add a node to a running spinner");
+    nodes_.push_back(NodeEntry{node, 0, 0, false});
+}
+
+void Spinner::setNumThreads(int num_threads)
+{
+    if(!threads_.empty())
+        throw exception::Exception("Cannot set the number of threads of a running spinner");
+    num_threads_ = std::max(1, num_threads);
+}
+
+int Spinner::getNumThreads() const
+{
+    return num_threads_;
+}
+
+void Spinner::spin()
+{
+    stop_.store(false);
+    error_ = nullptr;
+    for(auto &entry : nodes_)
+    {
+        entry.period = int64_t(1000000. / entry.node->getSpinRate());
+        entry.next_spin = entry.node->hardwareTimeUSec();
+        entry.busy = false;
+    }
+
+    if(num_threads_ > 1)
+        for(int i = 0; i < num_threads_; i++)
+            threads_.push_back(boost::thread(&Spinner::workerLoop, this));
+
+    std::vector<void*> sockets;
+    std::vector<zmq::pollitem_t> items;
+    // for each poll item (but the spinner's wakeup), the node it belongs to, and if it is its wakeup channel:
+    std::vector<size_t> owners;
+    std::vector<bool> wakeups;
+    std::vector<char> idle(nodes_.size());
+
+    while(!stop_.load())
+    {
+        items.clear();
+        owners.clear();
+        wakeups.clear();
+        int64_t timeout = max_poll_usec;
+        bool alive = false;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            for(size_t i = 0; i < nodes_.size(); i++)
+                idle[i] = !nodes_[i].busy;
+        }
+        for(size_t i = 0; i < nodes_.size(); i++)
+        {
+            NodeEntry &entry = nodes_[i];
+            if(entry.node->shutdownRequested())
+            {
+                idle[i] = false;
+                continue;
+            }
+            alive = true;
+            // the sockets of a node being spun by another thread are not polled:
+            if(!idle[i])
+                continue;
+            int64_t wait = entry.next_spin - entry.node->hardwareTimeUSec();
+            int64_t timer = entry.node->nextTimerUSec();
+            if(timer >= 0 && timer < wait)
+                wait = timer;
+            timeout = std::max<int64_t>(0, std::min(timeout, wait));
+            sockets.clear();
+            entry.node->appendPollSockets(sockets);
+            for(size_t j = 0; j < sockets.size(); j++)
+            {
+                zmq::pollitem_t item = {sockets[j], 0, ZMQ_POLLIN, 0};
+                items.push_back(item);
+                owners.push_back(i);
+                wakeups.push_back(j == sockets.size() - 1);
+            }
+        }
+        if(!alive)
+            break;
+
+        // the spinner's wakeup channel is the last item:
+        zmq::pollitem_t item = {static_cast<void*>(private_->wakeup_rx_), 0, ZMQ_POLLIN, 0};
+        items.push_back(item);
+        zmq::poll(&items[0], items.size(), long((timeout + 999) / 1000));
+
+        if(items.back().revents & ZMQ_POLLIN)
+        {
+            zmq::message_t msg;
+            while(private_->wakeup_rx_.recv(&msg, ZMQ_DONTWAIT)) {}
+        }
+
+        std::vector<char> ready(nodes_.size());
+        for(size_t k = 0; k + 1 < items.size(); k++)
+        {
+            if(!(items[k].revents & ZMQ_POLLIN)) continue;
+            ready[owners[k]] = true;
+            if(wakeups[k])
+                nodes_[owners[k]].node->drainWakeUp();
+        }
+
+        bool queued = false;
+        for(size_t i = 0; i < nodes_.size(); i++)
+        {
+            if(!idle[i]) continue;
+            NodeEntry &entry = nodes_[i];
+            if(!ready[i] && entry.node->hardwareTimeUSec() < entry.next_spin && entry.node->nextTimerUSec() != 0)
+                continue;
+            if(threads_.empty())
+            {
+                spinNode(entry);
+                continue;
+            }
+            boost::mutex::scoped_lock lock(mutex_);
+            entry.busy = true;
+            queue_.push_back(&entry);
+            queued = true;
+        }
+        if(queued)
+            cond_.notify_all();
+    }
+
+    // let the threads finish the nodes they are spinning:
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        stop_.store(true);
+        queue_.clear();
+    }
+    cond_.notify_all();
+    for(auto &thread : threads_)
+        thread.join();
+    threads_.clear();
+
+    if(error_)
+        std::rethrow_exception(error_);
+}
+
+void Spinner::stop()
+{
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        stop_.store(true);
+    }
+    cond_.notify_all();
+    wakeUp();
+}
+
+void Spinner::spinNode(NodeEntry &entry)
+{
+    // the callbacks of the node can log from this thread, as from the node's own:
+    Node::setSpinnerNode(entry.node);
+    try
+    {
+        entry.node->spinOnce();
+    }
+    catch(...)
+    {
+        Node::setSpinnerNode(nullptr);
+        throw;
+    }
+    Node::setSpinnerNode(nullptr);
+    // any spin does the periodic work of the node, e.g. flushing its log:
+    entry.next_spin = entry.node->hardwareTimeUSec() + entry.period;
+}
+
+void Spinner::workerLoop()
+{
+    set_thread_name("SP");
+
+    std::string thread_config_error = applyThreadConfig("spin");
+    if(!thread_config_error.empty())
+        std::cerr << "b0: spinner: thread configuration: " << thread_config_error << std::endl;
+
+    while(true)
+    {
+        NodeEntry *entry;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            while(queue_.empty() && !stop_.load())
+                cond_.wait(lock);
+            if(stop_.load())
+                return;
+            entry = queue_.front();
+            queue_.pop_front();
+        }
+
+        try
+        {
+            spinNode(*entry);
+        }
+        catch(...)
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            if(!error_)
+                error_ = std::current_exception();
+            stop_.store(true);
+        }
+
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            entry->busy = false;
+        }
+        wakeUp();
+    }
+}
+
+void Spinner::wakeUp()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    zmq::message_t msg;
+    private_->wakeup_tx_.send(msg, ZMQ_DONTWAIT);
+}
+
+} // namespace b0
@@ -1,11 +1,43 @@
 #include <b0/subscriber.h>
 #include <b0/node.h>
+#include <b0/utils/env.h>
+#include <b0/utils/profiler.h>
+#include <b0/utils/tracing.h>
+#include <b0/exceptions.h>
+#include <b0/compress/delta.h>
+#include <b0/utils/startup_trace.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <vector>
+#include <boost/format.hpp>
 
 #include <zmq.hpp>
 
 namespace b0
 {
 
+//! Size of the payloads of a message, as accounted by Subscriber::setBufferLimit()
+static size_t payloadSize(const b0::message::MessageEnvelopeView &env)
+{
+    size_t size = 0;
+    for(auto &part : env.parts) size += part.size;
+    return size;
+}
+
+struct IntraProcessRegistry
+{
+    boost::mutex mutex_;
+    std::multimap<std::string, Subscriber*> subscribers_;
+};
+
+static IntraProcessRegistry & intraProcessRegistry()
+{
+    static IntraProcessRegistry *registry = new IntraProcessRegistry;
+    return *registry;
+}
+
 Subscriber::Subscriber(Node *node, const std::string &topic_name, bool managed, bool notify_graph)
     : Subscriber(node, topic_name, CallbackRaw{}, managed, notify_graph)
 {
@@ -14,6 +46,12 @@ Subscriber::Subscriber(Node *node, const std::string &topic_name, bool managed,
 Subscriber::Subscriber(Node *node, const std::string &topic_name, CallbackRaw callback, bool managed, bool notify_graph)
     : Socket(node, ZMQ_SUB, topic_name, managed),
       notify_graph_(notify_graph),
+      multicast_(b0::env::getBool("B0_SUBSCRIBER_MULTICAST")),
+      max_rate_(b0::env::getDouble("B0_SUBSCRIBER_MAX_RATE")),
+      lazy_(notify_graph && b0::env::getBool("B0_LAZY_CONNECT")),
+      drop_expired_(b0::env::getBool("B0_SUBSCRIBER_DROP_EXPIRED")),
+      lazy_decompression_(b0::env::getBool("B0_SUBSCRIBER_LAZY_DECOMPRESSION")),
+      prefetch_size_(std::max(0, b0::env::getInt("B0_SUBSCRIBER_PREFETCH"))),
       callback_(callback)
 {
 }
@@ -21,6 +59,12 @@ Subscriber::Subscriber(Node *node, const std::string &topic_name, CallbackRaw ca
 Subscriber::Subscriber(Node *node, const std::string &topic_name, CallbackRawType callback, bool managed, bool notify_graph)
     : Socket(node, ZMQ_SUB, topic_name, managed),
       notify_graph_(notify_graph),
+      multicast_(b0::env::getBool("B0_SUBSCRIBER_MULTICAST")),
+      max_rate_(b0::env::getDouble("B0_SUBSCRIBER_MAX_RATE")),
+      lazy_(notify_graph && b0::env::getBool("B0_LAZY_CONNECT")),
+      drop_expired_(b0::env::getBool("B0_SUBSCRIBER_DROP_EXPIRED")),
+      lazy_decompression_(b0::env::getBool("B0_SUBSCRIBER_LAZY_DECOMPRESSION")),
+      prefetch_size_(std::max(0, b0::env::getInt("B0_SUBSCRIBER_PREFETCH"))),
       callback_with_type_(callback)
 {
 }
@@ -28,10 +72,42 @@ Subscriber::Subscriber(Node *node, const std::string &topic_name, CallbackRawTyp
 Subscriber::Subscriber(Node *node, const std::string &topic_name, CallbackParts callback, bool managed, bool notify_graph)
     : Socket(node, ZMQ_SUB, topic_name, managed),
       notify_graph_(notify_graph),
+      multicast_(b0::env::getBool("B0_SUBSCRIBER_MULTICAST")),
+      max_rate_(b0::env::getDouble("B0_SUBSCRIBER_MAX_RATE")),
+      lazy_(notify_graph && b0::env::getBool("B0_LAZY_CONNECT")),
+      drop_expired_(b0::env::getBool("B0_SUBSCRIBER_DROP_EXPIRED")),
+      lazy_decompression_(b0::env::getBool("B0_SUBSCRIBER_LAZY_DECOMPRESSION")),
+      prefetch_size_(std::max(0, b0::env::getInt("B0_SUBSCRIBER_PREFETCH"))),
       callback_multipart_(callback)
 {
 }
 
+Subscriber::Subscriber(Node *node, const std::string &topic_name, CallbackPartsView callback, bool managed, bool notify_graph)
+    : Socket(node, ZMQ_SUB, topic_name, managed),
+      notify_graph_(notify_graph),
+      multicast_(b0::env::getBool("B0_SUBSCRIBER_MULTICAST")),
+      max_rate_(b0::env::getDouble("B0_SUBSCRIBER_MAX_RATE")),
+      lazy_(notify_graph && b0::env::getBool("B0_LAZY_CONNECT")),
+      drop_expired_(b0::env::getBool("B0_SUBSCRIBER_DROP_EXPIRED")),
+      lazy_decompression_(b0::env::getBool("B0_SUBSCRIBER_LAZY_DECOMPRESSION")),
+      prefetch_size_(std::max(0, b0::env::getInt("B0_SUBSCRIBER_PREFETCH"))),
+      callback_multipart_view_(callback)
+{
+}
+
+Subscriber::Subscriber(Node *node, const std::string &topic_name, CallbackPartsBatch callback, bool managed, bool notify_graph)
+    : Socket(node, ZMQ_SUB, topic_name, managed),
+      notify_graph_(notify_graph),
+      multicast_(b0::env::getBool("B0_SUBSCRIBER_MULTICAST")),
+      max_rate_(b0::env::getDouble("B0_SUBSCRIBER_MAX_RATE")),
+      lazy_(notify_graph && b0::env::getBool("B0_LAZY_CONNECT")),
+      drop_expired_(b0::env::getBool("B0_SUBSCRIBER_DROP_EXPIRED")),
+      lazy_decompression_(b0::env::getBool("B0_SUBSCRIBER_LAZY_DECOMPRESSION")),
+      prefetch_size_(std::max(0, b0::env::getInt("B0_SUBSCRIBER_PREFETCH"))),
+      callback_batch_(callback)
+{
+}
+
 Subscriber::Subscriber(Node *node, const std::string &topic_name, void (*callback)(const std::string&), bool managed, bool notify_graph)
     : Subscriber(node, topic_name, static_cast<CallbackRaw>(callback), managed, notify_graph)
 {
@@ -47,8 +123,22 @@ Subscriber::Subscriber(Node *node, const std::string &topic_name, void (*callbac
 {
 }
 
+Subscriber::Subscriber(Node *node, const std::string &topic_name, void (*callback)(const std::vector<b0::message::MessagePartView>&), bool managed, bool notify_graph)
+    : Subscriber(node, topic_name, static_cast<CallbackPartsView>(callback), managed, notify_graph)
+{
+}
+
+Subscriber::Subscriber(Node *node, const std::string &topic_name, void (*callback)(const std::vector<std::vector<b0::message::MessagePart> >&), bool managed, bool notify_graph)
+    : Subscriber(node, topic_name, static_cast<CallbackPartsBatch>(callback), managed, notify_graph)
+{
+}
+
 Subscriber::~Subscriber()
 {
+    stopPrefetch();
+    unregisterIntraProcess();
+    if(!connected_.load())
+        node_.removeLazySubscriber(this);
 }
 
 void Subscriber::log(logger::Level level, const std::string &message) const
@@ -59,20 +149,91 @@ void Subscriber::log(logger::Level level, const std::string &message) const
 
 void Subscriber::init()
 {
-    if(Global::getInstance().remapTopicName(getNode(), orig_name_, name_))
-        info("Topic name '%s' remapped to '%s'", orig_name_, name_);
+    StartupTrace *startup_trace = node_.startupTrace();
+    {
+        StartupTrace::Scope scope(startup_trace, "remap", orig_name_);
+        if(Global::getInstance().remapTopicName(getNode(), orig_name_, name_))
+            info("Topic name '%s' remapped to '%s'", orig_name_, name_);
+    }
+
+    // the rate limits are applied by the proxy, if it is the only source of the messages:
+    channel_.clear();
+    rate_limit_.setLimits(0, 0);
+    if(max_rate_ > 0 || decimation_ > 1 || !parts_.empty())
+    {
+        if(remote_addr_.empty() && subtopic_filters_.empty() && !multicast_ && !Global::getInstance().getPeerToPeer() && !Global::getInstance().getDecentralized())
+            channel_ = Decimator::channelName(name_, max_rate_, decimation_, parts_);
+        else
+            rate_limit_.setLimits(max_rate_, decimation_);
+    }
+
+    // intra-process delivery is only possible when connected to the resolver's proxy, and
+    // only for the callbacks dispatched by this class (and not rate-limited by the proxy):
+    if(remote_addr_.empty() && channel_.empty() && Global::getInstance().getIntraProcess() && Subscriber::hasCallback() && !isReadInBackground())
+        registerIntraProcess((isHighPriority() ? node_.getPriorityXPUBSocketAddress(name_) : node_.getXPUBSocketAddress(name_)) + "|" + name_);
+
+    // in peer-to-peer mode also connect directly to the publishers of this topic:
+    if(remote_addr_.empty() && Global::getInstance().getPeerToPeer())
+        peer_to_peer_ = true;
+
+    // only the connections to the resolver's proxy are made lazily:
+    bool lazy = lazy_ && remote_addr_.empty() && !Global::getInstance().getDecentralized();
 
     if(remote_addr_.empty())
-        remote_addr_ = node_.getXPUBSocketAddress();
-    connect();
+        remote_addr_ = isHighPriority() ? node_.getPriorityXPUBSocketAddress(name_) : node_.getXPUBSocketAddress(name_);
+    if(lazy)
+    {
+        node_.addLazySubscriber(this);
+    }
+    else
+    {
+        StartupTrace::Scope scope(startup_trace, "connect", name_);
+        connectNow();
+    }
+
+    if(isReadInBackground())
+    {
+        // build the filter now, as from here on it is used by the thread:
+        readFilter();
+        prefetch_thread_ = boost::thread(&Subscriber::prefetchLoop, this);
+    }
 
     if(notify_graph_)
+    {
+        StartupTrace::Scope scope(startup_trace, "notify", name_);
         node_.notifyTopic(name_, true, true);
+    }
+}
+
+void Subscriber::connectNow()
+{
+    {
+        boost::mutex::scoped_lock lock(prefetch_socket_mutex_);
+        connect();
+    }
+    connected_.store(true);
+
+    if(resolvesPeers())
+        connectToPeers();
 }
 
 void Subscriber::cleanup()
 {
-    disconnect();
+    stopPrefetch();
+    unregisterIntraProcess();
+
+    if(connected_.exchange(false))
+    {
+        disconnect();
+
+        for(auto &addr : peer_addrs_)
+            Socket::disconnect(addr);
+        peer_addrs_.clear();
+    }
+    else
+    {
+        node_.removeLazySubscriber(this);
+    }
 
     if(notify_graph_)
         node_.notifyTopic(name_, true, false);
@@ -80,29 +241,957 @@ void Subscriber::cleanup()
 
 void Subscriber::spinOnce()
 {
-    if(!callback_ && !callback_with_type_ && !callback_multipart_) return;
+    if(resolvesPeers() && std::chrono::steady_clock::now() >= next_peers_refresh_)
+        connectToPeers();
+
+    if(!hasCallback()) return;
+
+    dispatchMessages();
+    flushCallbackBatch();
+
+    if(reliable_)
+        requestMissing();
+}
+
+void Subscriber::dispatchMessages()
+{
+    if(isReadInBackground())
+    {
+        dispatchPrefetched();
+        return;
+    }
+
+    if(intra_process_pending_.load())
+    {
+        std::deque<std::shared_ptr<const b0::message::MessageEnvelope> > &queue = intra_process_dispatch_queue_;
+        {
+            boost::mutex::scoped_lock lock(intra_process_mutex_);
+            queue.swap(intra_process_queue_);
+            intra_process_pending_.store(0);
+        }
+        if(keep_latest_ > 0 && queue.size() > keep_latest_)
+        {
+            discarded(queue.size() - keep_latest_);
+            queue.erase(queue.begin(), queue.end() - keep_latest_);
+        }
+        std::vector<b0::message::MessagePartView> &parts = intra_process_parts_;
+        for(auto &env : queue)
+        {
+            if(!acceptIntraProcess(*env))
+                continue;
+            parts.resize(env->parts.size());
+            for(size_t i = 0; i < parts.size(); i++)
+            {
+                parts[i].content_type = env->parts[i].content_type;
+                parts[i].compression_algorithm = env->parts[i].compression_algorithm;
+                parts[i].compression_level = env->parts[i].compression_level;
+                parts[i].compression_dictionary = env->parts[i].compression_dictionary;
+                parts[i].data = env->parts[i].payload.data();
+                parts[i].size = env->parts[i].payload.size();
+            }
+            if(processHeaders(env->headers))
+                timedDispatch(env->headers, parts);
+        }
+        queue.clear();
+    }
+
+    if(keep_latest_ > 0 && buffer_limit_ == 0)
+    {
+        // drain the socket first, then dispatch only the newest messages:
+        std::deque<b0::message::MessageEnvelopeView> &queue = keep_latest_queue_;
+        bufferMessages();
+        for(auto &env : queue)
+        {
+            if(droppedExpired(env)) continue;
+            if(processHeaders(env.getHeaders()))
+                timedDispatch(env.getHeaders(), env.parts);
+        }
+        queue.clear();
+        buffered_bytes_ = 0;
+        buffered_messages_.store(0);
+        getCounters().receive_queue.set(0);
+        return;
+    }
+
+    // at most the budget of messages, the others wait for the next spin (see setSpinBudget()):
+    startSpinBudget();
+
+    if(buffer_limit_ > 0)
+    {
+        // drain the socket again before each callback, so that it never holds a backlog:
+        std::deque<b0::message::MessageEnvelopeView> &queue = keep_latest_queue_;
+        bufferMessages();
+        for(size_t n = queue.size(); n > 0 && !queue.empty() && spinBudgetLeft(); n--)
+        {
+            b0::message::MessageEnvelopeView &env = queue.front();
+            if(!droppedExpired(env) && processHeaders(env.getHeaders()))
+                timedDispatch(env.getHeaders(), env.parts);
+            buffered_bytes_ -= payloadSize(env);
+            queue.pop_front();
+            getCounters().receive_queue.set(buffered_bytes_);
+            bufferMessages();
+        }
+        return;
+    }
+
+    while(spinBudgetLeft() && poll())
+    {
+        b0::message::MessageEnvelopeView &env = receive_envelope_;
+        env.setLazyDecompression(lazy_decompression_);
+        ReadStatus status = tryReadRaw(env, readFilter(), &read_error_);
+        if(status == ReadStatus::Filtered)
+        {
+            filtered();
+            continue;
+        }
+        if(status != ReadStatus::Ok)
+        {
+            readFailed(status, read_error_);
+            continue;
+        }
+
+        if(isOwnIntraProcessMessage(env))
+            continue;
+
+        if(processHeaders(env.getHeaders()))
+            timedDispatch(env.getHeaders(), env.parts);
+    }
+}
+
+bool Subscriber::isOwnIntraProcessMessage(const b0::message::MessageEnvelopeView &env)
+{
+    if(intra_process_key_.empty()) return false;
+    boost::optional<boost::string_ref> source = env.findHeader("Source-process");
+    return source && *source == boost::string_ref(intraProcessSource(node_));
+}
 
+void Subscriber::bufferMessages()
+{
+    std::deque<b0::message::MessageEnvelopeView> &queue = keep_latest_queue_;
     while(poll())
     {
-        if(callback_)
+        queue.emplace_back();
+        queue.back().setLazyDecompression(lazy_decompression_);
+        ReadStatus status = tryReadRaw(queue.back(), readFilter(), &read_error_);
+        if(status != ReadStatus::Ok)
+        {
+            queue.pop_back();
+            if(status == ReadStatus::Filtered)
+                filtered();
+            else
+                readFailed(status, read_error_);
+            continue;
+        }
+        if(isOwnIntraProcessMessage(queue.back()))
+        {
+            queue.pop_back();
+            continue;
+        }
+        buffered_bytes_ += payloadSize(queue.back());
+        getCounters().receive_queue.set(buffered_bytes_);
+        // the newest message is always kept:
+        while(queue.size() > 1 && ((keep_latest_ > 0 && queue.size() > keep_latest_) || (buffer_limit_ > 0 && buffered_bytes_ > buffer_limit_)))
+        {
+            buffered_bytes_ -= payloadSize(queue.front());
+            queue.pop_front();
+            discarded(1);
+        }
+    }
+    buffered_messages_.store(queue.size());
+    getCounters().receive_queue.set(buffered_bytes_);
+}
+
+void Subscriber::prefetchLoop()
+{
+    std::list<b0::message::MessageEnvelopeView> item;
+    try
+    {
+        while(!boost::this_thread::interruption_requested())
+        {
+            {
+                boost::mutex::scoped_lock lock(prefetch_mutex_);
+                // with setKeepLatest() the oldest messages make room instead:
+                while(keep_latest_ == 0 && prefetch_queue_.size() >= prefetch_size_)
+                    prefetch_cond_.wait(lock);
+                if(item.empty())
+                {
+                    if(prefetch_free_.empty())
+                        item.emplace_back();
+                    else
+                        item.splice(item.end(), prefetch_free_, prefetch_free_.begin());
+                }
+            }
+
+            b0::message::MessageEnvelopeView &env = item.front();
+            env.setLazyDecompression(lazy_decompression_);
+            ReadStatus status;
+            {
+                // (with a short timeout, as the node's thread waits for the socket meanwhile)
+                boost::mutex::scoped_lock lock(prefetch_socket_mutex_);
+                if(!poll(10)) continue;
+                status = tryReadRaw(env, readFilter(), &read_error_);
+            }
+            if(status == ReadStatus::Filtered)
+            {
+                filtered();
+                continue;
+            }
+            if(status != ReadStatus::Ok)
+            {
+                readFailed(status, read_error_);
+                continue;
+            }
+
+            {
+                boost::mutex::scoped_lock lock(prefetch_mutex_);
+                prefetch_bytes_ += payloadSize(item.front());
+                prefetch_queue_.splice(prefetch_queue_.end(), item);
+                size_t n = std::min(keep_latest_, prefetch_size_);
+                if(n > 0 && prefetch_queue_.size() > n)
+                {
+                    prefetch_bytes_ -= payloadSize(prefetch_queue_.front());
+                    prefetch_free_.splice(prefetch_free_.end(), prefetch_queue_, prefetch_queue_.begin());
+                    discarded(1);
+                }
+                else
+                {
+                    prefetch_pending_++;
+                }
+                getCounters().receive_queue.set(prefetch_bytes_);
+            }
+            node_.wakeUp();
+        }
+    }
+    catch(boost::thread_interrupted &)
+    {
+    }
+}
+
+void Subscriber::dispatchPrefetched()
+{
+    std::list<b0::message::MessageEnvelopeView> &queue = prefetch_dispatch_queue_;
+    if(queue.empty())
+    {
+        boost::mutex::scoped_lock lock(prefetch_mutex_);
+        queue.splice(queue.end(), prefetch_queue_);
+        prefetch_cond_.notify_one();
+    }
+
+    // at most the budget of messages, the others wait for the next spin (see setSpinBudget()):
+    startSpinBudget();
+    while(!queue.empty() && spinBudgetLeft())
+    {
+        b0::message::MessageEnvelopeView &env = queue.front();
+        if(!droppedExpired(env) && processHeaders(env.getHeaders()))
+            timedDispatch(env.getHeaders(), env.parts);
+        prefetch_pending_--;
+        boost::mutex::scoped_lock lock(prefetch_mutex_);
+        prefetch_bytes_ -= payloadSize(env);
+        getCounters().receive_queue.set(prefetch_bytes_);
+        prefetch_free_.splice(prefetch_free_.end(), queue, queue.begin());
+    }
+}
+
+void Subscriber::stopPrefetch()
+{
+    if(!prefetch_thread_.joinable()) return;
+    prefetch_thread_.interrupt();
+    prefetch_thread_.join();
+    prefetch_queue_.clear();
+    prefetch_dispatch_queue_.clear();
+    prefetch_free_.clear();
+    prefetch_pending_.store(0);
+    prefetch_bytes_ = 0;
+    getCounters().receive_queue.set(0);
+}
+
+void Subscriber::discarded(uint64_t n)
+{
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    stats_.discarded += n;
+}
+
+void Subscriber::filtered()
+{
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    if(last_expired_)
+        stats_.expired++;
+    else
+        stats_.filtered++;
+    last_expired_ = false;
+}
+
+bool Subscriber::isExpired(const b0::message::MessageEnvelopeView &env)
+{
+    boost::optional<boost::string_ref> expires = env.findHeader("Expires");
+    if(!expires) return false;
+    char *end = nullptr;
+    std::string value(expires->data(), expires->size());
+    long long t = std::strtoll(value.c_str(), &end, 10);
+    if(end == value.c_str() || *end) return false;
+    return node_.timeUSec() >= t;
+}
+
+bool Subscriber::droppedExpired(const b0::message::MessageEnvelopeView &env)
+{
+    if(!drop_expired_ || !isExpired(env)) return false;
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    stats_.expired++;
+    return true;
+}
+
+const b0::message::HeaderFilter & Subscriber::readFilter()
+{
+    if(!drop_expired_ && !rate_limit_.enabled()) return header_filter_;
+    if(!read_filter_)
+    {
+        read_filter_ = [this](const b0::message::MessageEnvelopeView &env) {
+            if(drop_expired_ && isExpired(env))
+            {
+                last_expired_ = true;
+                return false;
+            }
+            if(header_filter_ && !header_filter_(env))
+                return false;
+            return !rate_limit_.enabled() || rate_limit_.admit();
+        };
+    }
+    return read_filter_;
+}
+
+bool Subscriber::acceptIntraProcess(const b0::message::MessageEnvelope &env)
+{
+    const b0::message::HeaderFilter &filter = readFilter();
+    if(!filter) return true;
+    b0::message::MessageEnvelopeView &view = filter_envelope_;
+    view.header0 = env.header0;
+    view.setRawHeaders(boost::string_ref(), false);
+    view.getHeaders() = env.headers;
+    if(filter(view)) return true;
+    filtered();
+    return false;
+}
+
+void Subscriber::setMulticast(bool enabled)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setMulticast() must be called before init()");
+    multicast_ = enabled;
+}
+
+bool Subscriber::getMulticast() const
+{
+    return multicast_;
+}
+
+void Subscriber::setMaxRate(double max_rate)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setMaxRate() must be called before init()");
+    if(max_rate < 0)
+        throw exception::ArgumentError(std::to_string(max_rate), "max_rate");
+    max_rate_ = max_rate;
+}
+
+double Subscriber::getMaxRate() const
+{
+    return max_rate_;
+}
+
+void Subscriber::setDecimation(unsigned every)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setDecimation() must be called before init()");
+    decimation_ = every;
+}
+
+unsigned Subscriber::getDecimation() const
+{
+    return decimation_;
+}
+
+void Subscriber::setParts(const std::vector<std::string> &parts)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setParts() must be called before init()");
+    parts_ = parts;
+}
+
+std::vector<std::string> Subscriber::getParts() const
+{
+    return parts_;
+}
+
+void Subscriber::setSubtopicFilters(const std::vector<std::string> &filters)
+{
+    bool connected = connected_.load();
+    if(connected) subscribeSubtopics(ZMQ_UNSUBSCRIBE);
+    subtopic_filters_ = filters;
+    if(connected) subscribeSubtopics(ZMQ_SUBSCRIBE);
+}
+
+const std::vector<std::string> & Subscriber::getSubtopicFilters() const
+{
+    return subtopic_filters_;
+}
+
+void Subscriber::setLazy(bool lazy)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setLazy() must be called before init()");
+    lazy_ = lazy;
+}
+
+bool Subscriber::getLazy() const
+{
+    return lazy_;
+}
+
+bool Subscriber::isConnected() const
+{
+    return connected_.load();
+}
+
+void Subscriber::setHeaderFilter(const b0::message::HeaderFilter &filter)
+{
+    header_filter_ = filter;
+}
+
+void Subscriber::setDropExpired(bool enabled)
+{
+    drop_expired_ = enabled;
+}
+
+bool Subscriber::getDropExpired() const
+{
+    return drop_expired_;
+}
+
+void Subscriber::setReliable(bool enabled, int64_t timeout_usec)
+{
+    if(timeout_usec <= 0)
+        throw exception::ArgumentError(std::to_string(timeout_usec), "timeout_usec");
+
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    reliable_ = enabled;
+    reliable_timeout_usec_ = timeout_usec;
+    missing_.clear();
+}
+
+bool Subscriber::getReliable() const
+{
+    return reliable_;
+}
+
+void Subscriber::setLazyDecompression(bool enabled)
+{
+    lazy_decompression_ = enabled;
+}
+
+bool Subscriber::getLazyDecompression() const
+{
+    return lazy_decompression_;
+}
+
+void Subscriber::setPrefetch(size_t queue_size)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setPrefetch() must be called before init()");
+    prefetch_size_ = queue_size;
+}
+
+size_t Subscriber::getPrefetch() const
+{
+    return prefetch_size_;
+}
+
+void Subscriber::setCallbackBatchSize(size_t max_count)
+{
+    callback_batch_size_ = max_count;
+}
+
+size_t Subscriber::getCallbackBatchSize() const
+{
+    return callback_batch_size_;
+}
+
+void Subscriber::setKeepLatest(size_t count)
+{
+    keep_latest_ = count;
+}
+
+size_t Subscriber::getKeepLatest() const
+{
+    return keep_latest_;
+}
+
+void Subscriber::setBufferLimit(size_t max_bytes)
+{
+    buffer_limit_ = max_bytes;
+}
+
+size_t Subscriber::getBufferLimit() const
+{
+    return buffer_limit_;
+}
+
+void Subscriber::timedDispatch(const std::map<std::string, std::string> &headers, const std::vector<b0::message::MessagePartView> &received_parts)
+{
+    const std::vector<b0::message::MessagePartView> *decoded = decodeDelta(headers, received_parts);
+    if(!decoded) return;
+    const std::vector<b0::message::MessagePartView> &parts = *decoded;
+
+    tracing::TraceContext trace;
+    tracing::extract(headers, trace);
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        CallbackProfiler profiler(*this);
+        tracing::Scope scope(tracing::SpanKind::Consumer, *this, trace);
+        if(!parts_.empty() && channel_.empty() && !headers.count("Batch"))
+        {
+            // the parts were not selected by the proxy:
+            std::vector<b0::message::MessagePartView> &selected = selected_parts_;
+            selected.clear();
+            for(size_t i = 0; i < parts.size(); i++)
+                if(Decimator::selectsPart(parts_, i, parts[i].content_type))
+                    selected.push_back(parts[i]);
+            if(!selected.empty())
+                dispatch(selected);
+        }
+        else if(headers.count("Batch"))
+        {
+            // the parts of a batch are messages on their own (see Publisher::publishBatch())
+            std::vector<b0::message::MessagePartView> &part = batch_part_;
+            part.resize(1);
+            for(auto &p : parts)
+            {
+                part[0] = p;
+                dispatch(part);
+            }
+        }
+        else dispatch(parts);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    getCounters().callback_duration.record(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+}
+
+bool Subscriber::processHeaders(const std::map<std::string, std::string> &headers)
+{
+    last_send_time_ = -1;
+    last_seq_value_ = 0;
+
+    auto it_time = headers.find("Send-time"), it_seq = headers.find("Seq");
+    if(it_time == headers.end() || it_seq == headers.end()) return true;
+
+    try
+    {
+        last_send_time_ = std::stoll(it_time->second);
+        last_seq_value_ = std::stoull(it_seq->second);
+    }
+    catch(std::exception &ex)
+    {
+        warn("Invalid Send-time/Seq headers: %s", ex.what());
+        last_send_time_ = -1;
+        last_seq_value_ = 0;
+        return true;
+    }
+
+    int64_t latency = node_.timeUSec() - last_send_time_;
+
+    auto it_pub = headers.find("Publisher");
+    std::string publisher = it_pub == headers.end() ? std::string() : it_pub->second;
+
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    uint64_t &last_seq = last_seq_[publisher];
+    // a latched message sent again for another subscriber:
+    if(last_seq && last_seq_value_ <= last_seq && headers.count("Latched"))
+        return false;
+    // a message sent again (see setReliable()), or a copy of one already received:
+    if(headers.count("Retransmitted") || (reliable_ && last_seq && last_seq_value_ <= last_seq))
+    {
+        auto it_missing = missing_.find(publisher);
+        if(!reliable_ || it_missing == missing_.end() || !it_missing->second.seqs.erase(last_seq_value_))
         {
-            std::string msg;
-            readRaw(msg);
-            callback_(msg);
+            stats_.duplicates++;
+            return false;
         }
-        if(callback_with_type_)
+        if(it_missing->second.seqs.empty())
+            missing_.erase(it_missing);
+        stats_.recovered++;
+        stats_.received++;
+        return true;
+    }
+    if(last_seq && last_seq_value_ > last_seq + 1)
+    {
+        stats_.gaps += last_seq_value_ - last_seq - 1;
+        if(reliable_)
+            missed(publisher, last_seq + 1, last_seq_value_ - 1);
+    }
+    last_seq = last_seq_value_;
+    stats_.received++;
+    stats_.last_latency = latency;
+    stats_.total_latency += latency;
+    if(stats_.received == 1 || latency > stats_.max_latency)
+        stats_.max_latency = latency;
+    return true;
+}
+
+const std::vector<b0::message::MessagePartView> * Subscriber::decodeDelta(const std::map<std::string, std::string> &headers, const std::vector<b0::message::MessagePartView> &parts)
+{
+    auto it_delta = headers.find("Delta");
+    bool keyframe = headers.count("Keyframe");
+    if(!keyframe && it_delta == headers.end()) return &parts;
+
+    auto it_pub = headers.find("Publisher");
+    DeltaBase &base = delta_bases_[it_pub == headers.end() ? std::string() : it_pub->second];
+    if(keyframe)
+    {
+        base.payloads.resize(parts.size());
+        for(size_t i = 0; i < parts.size(); i++)
         {
-            std::string msg, type;
-            readRaw(msg, type);
-            callback_with_type_(msg, type);
+            boost::string_ref payload = parts[i].payload();
+            base.payloads[i].assign(payload.data(), payload.size());
         }
-        if(callback_multipart_)
+        base.seq = last_seq_value_;
+        return &parts;
+    }
+
+    auto it_base = headers.find("Delta-base");
+    bool ok = base.seq && it_base != headers.end() && it_base->second == std::to_string(base.seq) && parts.size() == base.payloads.size();
+    std::string error = "missed the message it applies to";
+    std::vector<std::string> &decoded = delta_scratch_;
+    decoded.resize(parts.size());
+    for(size_t i = 0; i < parts.size() && ok; i++)
+    {
+        boost::string_ref payload = parts[i].payload();
+        ok = compress::decodeDelta(it_delta->second, base.payloads[i], payload.data(), payload.size(), decoded[i], &error);
+    }
+    if(!ok)
+    {
+        trace("Dropping delta %d: %s", last_seq_value_, error);
+        base.seq = 0;
+        {
+            boost::mutex::scoped_lock lock(stats_mutex_);
+            stats_.delta_dropped++;
+        }
+        requestKeyframe(base);
+        return nullptr;
+    }
+
+    base.payloads.swap(decoded);
+    base.seq = last_seq_value_;
+    std::vector<b0::message::MessagePartView> &views = delta_parts_;
+    views.resize(parts.size());
+    for(size_t i = 0; i < parts.size(); i++)
+    {
+        views[i] = parts[i];
+        views[i].data = base.payloads[i].data();
+        views[i].size = base.payloads[i].size();
+    }
+    return &views;
+}
+
+void Subscriber::requestKeyframe(DeltaBase &base)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(now - base.last_request < std::chrono::milliseconds{100}) return;
+    base.last_request = now;
+
+    // a subscription of its own, which the proxy forwards to the publishers (see Publisher::spinOnce()):
+    std::string filter = keyframeRequestFilter(name_) + intraProcessSource(node_) + "/" + std::to_string(++keyframe_requests_);
+    debug("Requesting a keyframe");
+    boost::mutex::scoped_lock lock(prefetch_socket_mutex_);
+    Socket::setsockopt(ZMQ_SUBSCRIBE, filter.data(), filter.size());
+    Socket::setsockopt(ZMQ_UNSUBSCRIBE, filter.data(), filter.size());
+}
+
+std::string Subscriber::keyframeRequestFilter(const std::string &topic)
+{
+    return "\x7f" "keyframe " + topic + " ";
+}
+
+void Subscriber::missed(const std::string &publisher, uint64_t first, uint64_t last)
+{
+    // (a publisher restarted, or a very long outage: only the last messages are asked for)
+    static const uint64_t max_missing = 65536;
+    if(last - first >= max_missing)
+    {
+        stats_.lost += last - first + 1 - max_missing;
+        first = last - max_missing + 1;
+    }
+
+    MissingMessages &missing = missing_[publisher];
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::microseconds{reliable_timeout_usec_};
+    for(uint64_t seq = first; seq <= last; seq++)
+        missing.seqs.emplace(seq, deadline);
+    // asked for by the next spinOnce()
+    missing.last_request = std::chrono::steady_clock::time_point();
+}
+
+void Subscriber::requestMissing()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::vector<std::string> filters;
+    {
+        boost::mutex::scoped_lock lock(stats_mutex_);
+        for(auto it = missing_.begin(); it != missing_.end(); )
         {
-            std::vector<b0::message::MessagePart> parts;
-            readRaw(parts);
-            callback_multipart_(parts);
+            MissingMessages &missing = it->second;
+            for(auto it_seq = missing.seqs.begin(); it_seq != missing.seqs.end(); )
+            {
+                if(now < it_seq->second) {++it_seq; continue;}
+                stats_.lost++;
+                it_seq = missing.seqs.erase(it_seq);
+            }
+            if(missing.seqs.empty())
+            {
+                it = missing_.erase(it);
+                continue;
+            }
+            if(now - missing.last_request >= std::chrono::milliseconds{100})
+            {
+                missing.last_request = now;
+                // one request per range of consecutive messages
+                auto it_seq = missing.seqs.begin();
+                while(it_seq != missing.seqs.end())
+                {
+                    uint64_t first = it_seq->first, last = first;
+                    for(++it_seq; it_seq != missing.seqs.end() && it_seq->first == last + 1; ++it_seq)
+                        last = it_seq->first;
+                    filters.push_back((boost::format("%s%s %d %d %s/%d") % retransmitRequestFilter(name_) % it->first % first % last % intraProcessSource(node_) % ++retransmit_requests_).str());
+                }
+            }
+            ++it;
         }
     }
+
+    if(filters.empty()) return;
+    // subscriptions of their own, which the proxy forwards to the publishers (see Publisher::spinOnce()):
+    debug("Asking for the missed messages (%d ranges)", filters.size());
+    boost::mutex::scoped_lock lock(prefetch_socket_mutex_);
+    for(const std::string &filter : filters)
+    {
+        Socket::setsockopt(ZMQ_SUBSCRIBE, filter.data(), filter.size());
+        Socket::setsockopt(ZMQ_UNSUBSCRIBE, filter.data(), filter.size());
+    }
+}
+
+std::string Subscriber::retransmitRequestFilter(const std::string &topic)
+{
+    return "\x7f" "retransmit " + topic + " ";
+}
+
+Subscriber::Statistics Subscriber::getStatistics() const
+{
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    return stats_;
+}
+
+void Subscriber::resetStatistics()
+{
+    boost::mutex::scoped_lock lock(stats_mutex_);
+    stats_ = Statistics();
+    last_seq_.clear();
+    missing_.clear();
+}
+
+int64_t Subscriber::getLastSendTime() const
+{
+    return last_send_time_;
+}
+
+uint64_t Subscriber::getLastSeq() const
+{
+    return last_seq_value_;
+}
+
+void Subscriber::dispatch(const std::vector<b0::message::MessagePartView> &parts)
+{
+    if(callback_)
+    {
+        boost::string_ref payload = parts.at(0).payload();
+        dispatch_payload_.assign(payload.data(), payload.size());
+        callback_(dispatch_payload_);
+    }
+    if(callback_with_type_)
+    {
+        boost::string_ref payload = parts.at(0).payload();
+        dispatch_payload_.assign(payload.data(), payload.size());
+        callback_with_type_(dispatch_payload_, parts.at(0).content_type);
+    }
+    if(callback_multipart_)
+    {
+        std::vector<b0::message::MessagePart> &parts1 = dispatch_parts_;
+        parts1.resize(parts.size());
+        for(size_t i = 0; i < parts.size(); i++)
+        {
+            parts1[i].content_type = parts[i].content_type;
+            parts1[i].compression_algorithm = parts[i].compression_algorithm;
+            parts1[i].compression_level = parts[i].compression_level;
+            parts1[i].compression_dictionary = parts[i].compression_dictionary;
+            boost::string_ref payload = parts[i].payload();
+            parts1[i].payload.assign(payload.data(), payload.size());
+        }
+        callback_multipart_(parts1);
+    }
+    if(callback_multipart_view_)
+    {
+        callback_multipart_view_(parts);
+    }
+    if(callback_batch_)
+    {
+        callback_batch_parts_.emplace_back();
+        if(!callback_batch_free_.empty())
+        {
+            callback_batch_parts_.back().swap(callback_batch_free_.back());
+            callback_batch_free_.pop_back();
+        }
+        std::vector<b0::message::MessagePart> &parts1 = callback_batch_parts_.back();
+        parts1.resize(parts.size());
+        for(size_t i = 0; i < parts.size(); i++)
+        {
+            parts1[i].content_type = parts[i].content_type;
+            parts1[i].compression_algorithm = parts[i].compression_algorithm;
+            parts1[i].compression_level = parts[i].compression_level;
+            parts1[i].compression_dictionary = parts[i].compression_dictionary;
+            boost::string_ref payload = parts[i].payload();
+            parts1[i].payload.assign(payload.data(), payload.size());
+        }
+        if(callback_batch_size_ > 0 && callback_batch_parts_.size() >= callback_batch_size_)
+            flushCallbackBatch();
+    }
+}
+
+void Subscriber::flushCallbackBatch()
+{
+    if(callback_batch_parts_.empty()) return;
+
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        CallbackProfiler profiler(*this);
+        callback_batch_(callback_batch_parts_);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    getCounters().callback_duration.record(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+
+    // the messages go back to the free list, keeping their buffers for the next batches:
+    for(auto &parts : callback_batch_parts_)
+    {
+        callback_batch_free_.emplace_back();
+        callback_batch_free_.back().swap(parts);
+    }
+    callback_batch_parts_.clear();
+}
+
+bool Subscriber::hasCallback() const
+{
+    return callback_ || callback_with_type_ || callback_multipart_ || callback_multipart_view_ || callback_batch_;
+}
+
+bool Subscriber::hasPendingMessages() const
+{
+    if(resolvesPeers() && std::chrono::steady_clock::now() >= next_peers_refresh_)
+        return true;
+    return intra_process_pending_.load() > 0 || buffered_messages_.load() > 0 || prefetch_pending_.load() > 0;
+}
+
+bool Subscriber::isReadInBackground() const
+{
+    return prefetch_size_ > 0 && Subscriber::hasCallback();
+}
+
+size_t Subscriber::getQueueDepth() const
+{
+    return intra_process_pending_.load() + buffered_messages_.load() + prefetch_pending_.load();
+}
+
+void Subscriber::connectToPeers()
+{
+    next_peers_refresh_ = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+
+    std::vector<std::string> addrs;
+    try
+    {
+        node_.resolveTopic(name_, addrs);
+    }
+    catch(exception::Exception &ex)
+    {
+        warn("Failed to resolve publishers of topic: %s", ex.what());
+        return;
+    }
+
+    boost::mutex::scoped_lock lock(prefetch_socket_mutex_);
+    for(auto &addr : addrs)
+    {
+        bool multicast = isMulticastAddress(addr);
+        if(multicast ? !multicast_ : !peer_to_peer_) continue;
+        if(!peer_addrs_.insert(addr).second) continue;
+        trace("Connecting to %s %s...", multicast ? "multicast group" : "publisher", addr);
+        Socket::connect(addr);
+    }
+}
+
+bool Subscriber::resolvesPeers() const
+{
+    return (peer_to_peer_ || multicast_) && connected_.load();
+}
+
+void Subscriber::registerIntraProcess(const std::string &key)
+{
+    IntraProcessRegistry &registry = intraProcessRegistry();
+    boost::mutex::scoped_lock lock(registry.mutex_);
+    intra_process_key_ = key;
+    registry.subscribers_.insert(std::make_pair(key, this));
+}
+
+void Subscriber::unregisterIntraProcess()
+{
+    if(intra_process_key_.empty()) return;
+
+    IntraProcessRegistry &registry = intraProcessRegistry();
+    boost::mutex::scoped_lock lock(registry.mutex_);
+    auto range = registry.subscribers_.equal_range(intra_process_key_);
+    for(auto it = range.first; it != range.second; ++it)
+    {
+        if(it->second == this)
+        {
+            registry.subscribers_.erase(it);
+            break;
+        }
+    }
+    intra_process_key_.clear();
+}
+
+void Subscriber::deliverIntraProcess(const std::shared_ptr<const b0::message::MessageEnvelope> &env)
+{
+    {
+        boost::mutex::scoped_lock lock(intra_process_mutex_);
+        intra_process_queue_.push_back(env);
+        intra_process_pending_++;
+    }
+    node_.wakeUp();
+}
+
+bool Subscriber::hasIntraProcessSubscribers(const std::string &key)
+{
+    IntraProcessRegistry &registry = intraProcessRegistry();
+    boost::mutex::scoped_lock lock(registry.mutex_);
+    return registry.subscribers_.count(key) > 0;
+}
+
+void Subscriber::publishIntraProcess(const std::string &key, const std::shared_ptr<const b0::message::MessageEnvelope> &env)
+{
+    IntraProcessRegistry &registry = intraProcessRegistry();
+    boost::mutex::scoped_lock lock(registry.mutex_);
+    auto range = registry.subscribers_.equal_range(key);
+    for(auto it = range.first; it != range.second; ++it)
+        it->second->deliverIntraProcess(env);
+}
+
+const std::string & Subscriber::intraProcessSource(Node &node)
+{
+    static const std::string source = (boost::format("%s/%d") % node.hostname() % node.pid()).str();
+    return source;
 }
 
 std::string Subscriber::getTopicName()
@@ -112,16 +1201,47 @@ std::string Subscriber::getTopicName()
 
 void Subscriber::connect()
 {
-    trace("Connecting to %s...", remote_addr_);
-    Socket::connect(remote_addr_);
-    Socket::setsockopt(ZMQ_SUBSCRIBE, name_.data(), name_.size());
+    // without a resolver (see b0::setDecentralized()) there is no proxy, only the peers
+    if(!remote_addr_.empty())
+    {
+        trace("Connecting to %s...", remote_addr_);
+        Socket::connect(remote_addr_);
+    }
+    // subscribe to the whole header0 line, including its terminator, for an exact match:
+    std::string filter = (channel_.empty() ? name_ : channel_) + "\n";
+    Socket::setsockopt(ZMQ_SUBSCRIBE, filter.data(), filter.size());
+    subscribeSubtopics(ZMQ_SUBSCRIBE);
 }
 
 void Subscriber::disconnect()
 {
-    trace("Disconnecting from %s...", remote_addr_);
-    Socket::setsockopt(ZMQ_UNSUBSCRIBE, name_.data(), name_.size());
-    Socket::disconnect(remote_addr_);
+    std::string filter = (channel_.empty() ? name_ : channel_) + "\n";
+    Socket::setsockopt(ZMQ_UNSUBSCRIBE, filter.data(), filter.size());
+    subscribeSubtopics(ZMQ_UNSUBSCRIBE);
+    if(!remote_addr_.empty())
+    {
+        trace("Disconnecting from %s...", remote_addr_);
+        Socket::disconnect(remote_addr_);
+    }
+}
+
+void Subscriber::subscribeSubtopics(int option)
+{
+    // a prefix of the header0 line, matching all the subtopics starting with the filter:
+    for(auto &subtopic : subtopic_filters_)
+    {
+        std::string filter = name_ + "/" + subtopic;
+        Socket::setsockopt(option, filter.data(), filter.size());
+    }
+}
+
+bool Subscriber::acceptsHeader0(const std::string &header0) const
+{
+    // the subtopics of the former filters can still be queued (see setSubtopicFilters()):
+    if(header0.size() > name_.size() && header0[name_.size()] == '/' && header0.compare(0, name_.size(), name_) == 0)
+        return true;
+    if(channel_.empty()) return Socket::acceptsHeader0(header0);
+    return header0 == channel_;
 }
 
 } // namespace b0
@@ -0,0 +1,443 @@
+#include <b0/utils/buffer_pool.h>
+#include <b0/exceptions.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace b0
+{
+
+//! Size of the huge pages
+static const size_t huge_page_size = 2 << 20;
+
+//! Protects pools
+static boost::mutex pools_mutex;
+
+//! The live pools, by id, for the thread caches to give their buffers back when the thread exits
+static std::map<uint64_t, BufferPool*> pools;
+
+static std::atomic<uint64_t> next_pool_id{1};
+
+/*
+ * The buffers kept by a thread, by pool id and size class. When the thread exits, they are
+ * given back to the shared cache of their pool, if it still exists (otherwise they are lost).
+ */
+struct ThreadBufferCache
+{
+    std::map<std::pair<uint64_t, int>, std::vector<void*> > buffers;
+
+    ~ThreadBufferCache()
+    {
+        boost::mutex::scoped_lock lock(pools_mutex);
+        for(auto &x : buffers)
+        {
+            auto it = pools.find(x.first.first);
+            if(it == pools.end()) continue;
+            BufferPool *pool = it->second;
+            for(void *data : x.second)
+            {
+                pool->bytes_in_thread_caches_ -= pool->classSize(x.first.second);
+                pool->putShared(data, x.first.second);
+            }
+        }
+    }
+};
+
+static thread_local ThreadBufferCache thread_cache;
+
+BufferAllocator::~BufferAllocator()
+{
+}
+
+BufferPool::BufferPool(size_t min_size, size_t max_size)
+    : min_size_(std::max<size_t>(min_size, 4096)),
+      max_size_(std::max(max_size, min_size)),
+      id_(next_pool_id++)
+{
+    // four classes per power of two, rounded up to the page size
+    for(double s = double(min_size_); ; s *= std::pow(2.0, 0.25))
+    {
+        size_t size = (size_t(std::ceil(s)) + 4095) & ~size_t(4095);
+        if(class_sizes_.empty() || size > class_sizes_.back())
+            class_sizes_.push_back(size);
+        if(size >= max_size_) break;
+    }
+    shared_.resize(class_sizes_.size());
+
+    boost::mutex::scoped_lock lock(pools_mutex);
+    pools[id_] = this;
+}
+
+BufferPool::~BufferPool()
+{
+    {
+        boost::mutex::scoped_lock lock(pools_mutex);
+        pools.erase(id_);
+    }
+    // (the buffers of the thread caches of the other threads cannot be reached)
+    for(auto &x : thread_cache.buffers)
+    {
+        if(x.first.first != id_) continue;
+        for(void *data : x.second)
+            freeBuffer(data, x.first.second);
+        x.second.clear();
+    }
+    trim();
+}
+
+void * BufferPool::allocate(size_t size)
+{
+    int cls = sizeClass(size);
+    if(cls < 0) return nullptr;
+
+    allocations_++;
+    bytes_in_use_ += classSize(cls);
+
+    auto it = thread_cache.buffers.find(std::make_pair(id_, cls));
+    if(it != thread_cache.buffers.end() && !it->second.empty())
+    {
+        void *data = it->second.back();
+        it->second.pop_back();
+        bytes_in_thread_caches_ -= classSize(cls);
+        thread_cache_hits_++;
+        return data;
+    }
+
+    void *data = takeShared(cls);
+    if(data)
+    {
+        shared_cache_hits_++;
+        return data;
+    }
+
+    data = newBuffer(cls);
+    if(!data)
+    {
+        allocations_--;
+        bytes_in_use_ -= classSize(cls);
+        return nullptr;
+    }
+    fresh_allocations_++;
+    return data;
+}
+
+void BufferPool::deallocate(void *data, size_t size)
+{
+    int cls = sizeClass(size);
+    if(cls < 0 || !data) return;
+
+    bytes_in_use_ -= classSize(cls);
+
+    std::vector<void*> &cache = thread_cache.buffers[std::make_pair(id_, cls)];
+    if(cache.size() < thread_cache_size_.load())
+    {
+        cache.push_back(data);
+        bytes_in_thread_caches_ += classSize(cls);
+        return;
+    }
+    putShared(data, cls);
+}
+
+size_t BufferPool::getMinimumSize() const
+{
+    return min_size_;
+}
+
+size_t BufferPool::getMaximumSize() const
+{
+    return max_size_;
+}
+
+void BufferPool::setHugePages(bool enabled)
+{
+    if(allocations_.load() > 0)
+        throw exception::Exception("setHugePages() must be called before the first allocation");
+    huge_pages_ = enabled;
+}
+
+bool BufferPool::getHugePages() const
+{
+    return huge_pages_;
+}
+
+void BufferPool::setNUMANode(int node)
+{
+    if(allocations_.load() > 0)
+        throw exception::Exception("setNUMANode() must be called before the first allocation");
+    if(node < -1)
+        throw exception::ArgumentError(std::to_string(node), "node");
+    numa_node_ = node;
+}
+
+int BufferPool::getNUMANode() const
+{
+    return numa_node_;
+}
+
+void BufferPool::setThreadCacheSize(size_t count)
+{
+    thread_cache_size_ = count;
+}
+
+size_t BufferPool::getThreadCacheSize() const
+{
+    return thread_cache_size_;
+}
+
+void BufferPool::setMaximumCachedBytes(size_t bytes)
+{
+    max_cached_bytes_ = bytes;
+}
+
+size_t BufferPool::getMaximumCachedBytes() const
+{
+    return max_cached_bytes_;
+}
+
+BufferPool::Stats BufferPool::getStats() const
+{
+    Stats stats;
+    stats.allocations = allocations_;
+    stats.thread_cache_hits = thread_cache_hits_;
+    stats.shared_cache_hits = shared_cache_hits_;
+    stats.fresh_allocations = fresh_allocations_;
+    stats.huge_page_allocations = huge_page_allocations_;
+    stats.releases = releases_;
+    stats.bytes_in_use = uint64_t(std::max<int64_t>(0, bytes_in_use_));
+    boost::mutex::scoped_lock lock(mutex_);
+    stats.bytes_cached = shared_bytes_ + uint64_t(std::max<int64_t>(0, bytes_in_thread_caches_));
+    return stats;
+}
+
+void BufferPool::trim()
+{
+    std::vector<std::vector<void*> > shared;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        shared.swap(shared_);
+        shared_.resize(class_sizes_.size());
+        shared_bytes_ = 0;
+    }
+    for(size_t cls = 0; cls < shared.size(); cls++)
+        for(void *data : shared[cls])
+            freeBuffer(data, int(cls));
+}
+
+int BufferPool::sizeClass(size_t size) const
+{
+    if(size < min_size_ || size > max_size_) return -1;
+    auto it = std::lower_bound(class_sizes_.begin(), class_sizes_.end(), size);
+    if(it == class_sizes_.end()) return -1;
+    return int(it - class_sizes_.begin());
+}
+
+size_t BufferPool::classSize(int cls) const
+{
+    return class_sizes_[cls];
+}
+
+size_t BufferPool::mappingSize(int cls) const
+{
+    size_t size = classSize(cls);
+    if(huge_pages_ && size >= huge_page_size)
+        size = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+    return size;
+}
+
+void * BufferPool::newBuffer(int cls)
+{
+#ifdef __linux__
+    size_t size = mappingSize(cls);
+    // (the pages are faulted in after the binding to the NUMA node, if any)
+    int populate_flag = numa_node_ < 0 ? MAP_POPULATE : 0;
+    if(huge_pages_ && size >= huge_page_size)
+    {
+        // from the reserved huge pages, if any
+        void *data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate_flag, -1, 0);
+        if(data != MAP_FAILED)
+        {
+            if(!populate_flag) populate(static_cast<char*>(data), size);
+            huge_page_allocations_++;
+            return data;
+        }
+
+        // otherwise transparent huge pages, which need a mapping aligned to their size
+        char *raw = static_cast<char*>(::mmap(nullptr, size + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if(raw == MAP_FAILED) return nullptr;
+        char *aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(raw) + huge_page_size - 1) & ~uintptr_t(huge_page_size - 1));
+        if(aligned > raw)
+            ::munmap(raw, aligned - raw);
+        size_t tail = (raw + size + huge_page_size) - (aligned + size);
+        if(tail > 0)
+            ::munmap(aligned + size, tail);
+        if(::madvise(aligned, size, MADV_HUGEPAGE) == 0)
+            huge_page_allocations_++;
+        populate(aligned, size);
+        return aligned;
+    }
+
+    void *data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | populate_flag, -1, 0);
+    if(data == MAP_FAILED) return nullptr;
+    if(!populate_flag) populate(static_cast<char*>(data), size);
+    return data;
+#else
+    return std::malloc(classSize(cls));
+#endif
+}
+
+void BufferPool::populate(char *data, size_t size)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    int node = numa_node_;
+    if(node >= 0)
+    {
+        // (MPOL_BIND, from numaif.h, to not depend on libnuma; if it fails, the memory is from any node)
+        const int mpol_bind = 2;
+        const size_t bits = 8 * sizeof(unsigned long);
+        std::vector<unsigned long> mask(node / bits + 1, 0);
+        mask[node / bits] |= 1UL << (node % bits);
+        ::syscall(SYS_mbind, data, size, mpol_bind, mask.data(), mask.size() * bits + 1, 0);
+    }
+#endif
+    // fault the pages in now, rather than while a message is written
+    for(size_t offset = 0; offset < size; offset += 4096)
+        data[offset] = 0;
+}
+
+void BufferPool::freeBuffer(void *data, int cls)
+{
+#ifdef __linux__
+    ::munmap(data, mappingSize(cls));
+#else
+    std::free(data);
+#endif
+}
+
+void * BufferPool::takeShared(int cls)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    std::vector<void*> &buffers = shared_[cls];
+    if(buffers.empty()) return nullptr;
+    void *data = buffers.back();
+    buffers.pop_back();
+    shared_bytes_ -= classSize(cls);
+    return data;
+}
+
+void BufferPool::putShared(void *data, int cls)
+{
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        if(shared_bytes_ + classSize(cls) <= max_cached_bytes_)
+        {
+            shared_[cls].push_back(data);
+            shared_bytes_ += classSize(cls);
+            return;
+        }
+    }
+    releases_++;
+    freeBuffer(data, cls);
+}
+
+FixedBufferPool::FixedBufferPool(size_t buffer_size, size_t count, size_t min_size)
+    : buffer_size_(buffer_size),
+      count_(count),
+      min_size_(std::min(min_size, buffer_size)),
+      slot_size_((buffer_size + 63) & ~size_t(63))
+{
+    if(buffer_size == 0)
+        throw exception::ArgumentError("0", "buffer_size");
+    if(count == 0) return;
+
+    size_t size = slot_size_ * count_;
+#ifdef __linux__
+    void *data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if(data == MAP_FAILED)
+        throw exception::Exception("FixedBufferPool: cannot allocate " + std::to_string(size) + " bytes");
+    memory_ = static_cast<char*>(data);
+#else
+    memory_ = static_cast<char*>(std::malloc(size));
+    if(!memory_)
+        throw exception::Exception("FixedBufferPool: cannot allocate " + std::to_string(size) + " bytes");
+    // fault the pages in now, rather than while a message is written
+    for(size_t offset = 0; offset < size; offset += 4096)
+        memory_[offset] = 0;
+#endif
+
+    free_.reserve(count_);
+    for(size_t i = count_; i > 0; i--)
+        free_.push_back(memory_ + (i - 1) * slot_size_);
+}
+
+FixedBufferPool::~FixedBufferPool()
+{
+    if(!memory_) return;
+#ifdef __linux__
+    ::munmap(memory_, slot_size_ * count_);
+#else
+    std::free(memory_);
+#endif
+}
+
+void * FixedBufferPool::allocate(size_t size)
+{
+    if(size < min_size_) return nullptr;
+
+    boost::mutex::scoped_lock lock(mutex_);
+    if(size > buffer_size_ || free_.empty())
+    {
+        misses_++;
+        return nullptr;
+    }
+    void *data = free_.back();
+    free_.pop_back();
+    allocations_++;
+    peak_in_use_ = std::max<uint64_t>(peak_in_use_, count_ - free_.size());
+    return data;
+}
+
+void FixedBufferPool::deallocate(void *data, size_t size)
+{
+    char *p = static_cast<char*>(data);
+    if(!p || p < memory_ || p >= memory_ + slot_size_ * count_) return;
+
+    boost::mutex::scoped_lock lock(mutex_);
+    free_.push_back(data);
+}
+
+size_t FixedBufferPool::getBufferSize() const
+{
+    return buffer_size_;
+}
+
+size_t FixedBufferPool::getBufferCount() const
+{
+    return count_;
+}
+
+size_t FixedBufferPool::getMinimumSize() const
+{
+    return min_size_;
+}
+
+FixedBufferPool::Stats FixedBufferPool::getStats() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    Stats stats;
+    stats.allocations = allocations_;
+    stats.misses = misses_;
+    stats.buffers_in_use = count_ - free_.size();
+    stats.peak_buffers_in_use = peak_in_use_;
+    return stats;
+}
+
+} // namespace b0
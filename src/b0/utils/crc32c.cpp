@@ -0,0 +1,156 @@
+#include <b0/utils/crc32c.h>
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(_MSC_VER))
+#define B0_CRC32C_SSE42
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__GNUC__) && (defined(__linux__) || defined(__APPLE__))
+#define B0_CRC32C_ARMV8
+#include <arm_acle.h>
+#ifdef __linux__
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+namespace b0
+{
+
+//! \cond HIDDEN_SYMBOLS
+
+//! The reflected Castagnoli polynomial
+static const uint32_t crc32c_polynomial = 0x82f63b78;
+
+struct Crc32cTables
+{
+    Crc32cTables()
+    {
+        for(uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for(int j = 0; j < 8; j++)
+                crc = (crc >> 1) ^ (crc & 1 ? crc32c_polynomial : 0);
+            table[0][i] = crc;
+        }
+        for(uint32_t i = 0; i < 256; i++)
+            for(int k = 1; k < 8; k++)
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+    }
+
+    uint32_t table[8][256];
+};
+
+//! \endcond
+
+static uint32_t crc32cSoftware(const unsigned char *p, size_t size, uint32_t crc)
+{
+    static const Crc32cTables tables;
+    const uint32_t (&t)[8][256] = tables.table;
+    for(; size >= 8; p += 8, size -= 8)
+    {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap32(lo);
+        hi = __builtin_bswap32(hi);
+#endif
+        lo ^= crc;
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+    for(; size; p++, size--)
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+    return crc;
+}
+
+#if defined(B0_CRC32C_SSE42)
+
+#ifdef __GNUC__
+__attribute__((target("sse4.2")))
+#endif
+static uint32_t crc32cHw(const unsigned char *p, size_t size, uint32_t crc)
+{
+    uint64_t crc64 = crc;
+    for(; size >= 8; p += 8, size -= 8)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        crc64 = _mm_crc32_u64(crc64, v);
+    }
+    uint32_t crc32 = static_cast<uint32_t>(crc64);
+    for(; size; p++, size--)
+        crc32 = _mm_crc32_u8(crc32, *p);
+    return crc32;
+}
+
+static bool detectHardware()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#elif defined(B0_CRC32C_ARMV8)
+
+__attribute__((target("+crc")))
+static uint32_t crc32cHw(const unsigned char *p, size_t size, uint32_t crc)
+{
+    for(; size >= 8; p += 8, size -= 8)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+    }
+    for(; size; p++, size--)
+        crc = __crc32cb(crc, *p);
+    return crc;
+}
+
+static bool detectHardware()
+{
+#ifdef __linux__
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+    // (all the 64-bit Apple CPUs have it)
+    return true;
+#endif
+}
+
+#else
+
+static uint32_t crc32cHw(const unsigned char *p, size_t size, uint32_t crc)
+{
+    return crc32cSoftware(p, size, crc);
+}
+
+static bool detectHardware()
+{
+    return false;
+}
+
+#endif
+
+bool crc32cHardware()
+{
+    static const bool hardware = detectHardware();
+    return hardware;
+}
+
+uint32_t crc32c(const void *data, size_t size, uint32_t crc)
+{
+    const unsigned char *p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    crc = crc32cHardware() ? crc32cHw(p, size, crc) : crc32cSoftware(p, size, crc);
+    return ~crc;
+}
+
+} // namespace b0
@@ -0,0 +1,252 @@
+#include <b0/utils/decimator.h>
+#include <b0/message/message_chunk.h>
+#include <b0/exception/message_unpack_error.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/format.hpp>
+
+namespace b0
+{
+
+void RateLimit::setLimits(double max_rate, unsigned every)
+{
+    interval_ = std::chrono::steady_clock::duration(0);
+    if(max_rate > 0)
+        interval_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1. / max_rate));
+    every_ = every;
+    next_ = std::chrono::steady_clock::time_point();
+    count_ = 0;
+}
+
+bool RateLimit::enabled() const
+{
+    return interval_.count() > 0 || every_ > 1;
+}
+
+bool RateLimit::admit()
+{
+    if(every_ > 1 && count_++ % every_ != 0)
+        return false;
+    if(interval_.count() == 0)
+        return true;
+    auto now = std::chrono::steady_clock::now();
+    if(now < next_)
+        return false;
+    // keep the average rate, unless the messages were missing for more than an interval:
+    next_ = std::max(next_ + interval_, now);
+    return true;
+}
+
+static const char *max_rate_tag = "@max-rate=";
+
+static const char *every_tag = ";every=";
+
+static const char *parts_tag = ";parts=";
+
+std::string Decimator::channelName(const std::string &topic, double max_rate, unsigned every, const std::vector<std::string> &parts)
+{
+    boost::format fmt("%s%s%g%s%u");
+    std::string name = (fmt % topic % max_rate_tag % std::max(0., max_rate) % every_tag % every).str();
+    if(!parts.empty())
+    {
+        name += parts_tag;
+        for(size_t i = 0; i < parts.size(); i++)
+            name += (i ? "," : "") + parts[i];
+    }
+    return name;
+}
+
+bool Decimator::parseChannelName(const std::string &name, std::string &topic, double &max_rate, unsigned &every, std::vector<std::string> &parts)
+{
+    size_t pos = name.rfind(max_rate_tag);
+    if(pos == std::string::npos) return false;
+    const char *p = name.c_str() + pos + std::strlen(max_rate_tag);
+    char *end = nullptr;
+    max_rate = std::strtod(p, &end);
+    if(end == p || std::strncmp(end, every_tag, std::strlen(every_tag)) != 0) return false;
+    p = end + std::strlen(every_tag);
+    every = static_cast<unsigned>(std::strtoul(p, &end, 10));
+    if(end == p) return false;
+    parts.clear();
+    if(*end)
+    {
+        if(std::strncmp(end, parts_tag, std::strlen(parts_tag)) != 0) return false;
+        std::string list(end + std::strlen(parts_tag));
+        for(size_t begin = 0; begin <= list.size(); )
+        {
+            size_t comma = std::min(list.find(',', begin), list.size());
+            parts.push_back(list.substr(begin, comma - begin));
+            begin = comma + 1;
+        }
+    }
+    topic = name.substr(0, pos);
+    return true;
+}
+
+bool Decimator::selectsPart(const std::vector<std::string> &parts, size_t index, const std::string &content_type)
+{
+    if(parts.empty()) return true;
+    std::string i = std::to_string(index);
+    for(auto &part : parts)
+        if(part == i || part == content_type)
+            return true;
+    return false;
+}
+
+std::string Decimator::subscription(const char *data, size_t size)
+{
+    std::string msg(data, size);
+    // the subscription filters of b0 are the whole header0 line (see Subscriber::connect())
+    if(size < 2 || (data[0] != 0 && data[0] != 1) || data[size - 1] != '\n')
+        return msg;
+
+    std::string topic;
+    double max_rate;
+    unsigned every;
+    std::vector<std::string> parts;
+    std::string name(data + 1, size - 2);
+    if(!parseChannelName(name, topic, max_rate, every, parts))
+        return msg;
+
+    std::vector<Channel> &channels = channels_[topic];
+    auto it = std::find_if(channels.begin(), channels.end(), [&](const Channel &c) {return c.name == name;});
+    if(data[0] == 1 && it == channels.end())
+    {
+        channels.emplace_back();
+        channels.back().name = name;
+        channels.back().limit.setLimits(max_rate, every);
+        channels.back().parts = parts;
+    }
+    else if(data[0] == 0 && it != channels.end())
+    {
+        channels.erase(it);
+    }
+    if(channels.empty())
+    {
+        channels_.erase(topic);
+        reassemblers_.erase(topic);
+    }
+
+    return std::string(1, data[0]) + topic + "\n";
+}
+
+bool Decimator::empty() const
+{
+    return channels_.empty();
+}
+
+void Decimator::select(const char *data, size_t size, std::vector<Copy> &copies)
+{
+    copies.clear();
+    const char *header0_end = static_cast<const char*>(std::memchr(data, '\n', size));
+    if(!header0_end) return;
+    auto it = channels_.find(std::string(data, header0_end));
+    if(it == channels_.end()) return;
+
+    b0::message::MessageChunk chunk;
+    bool chunked = b0::message::isChunk(data, size);
+    bool selecting = false;
+    for(auto &channel : it->second)
+        selecting = selecting || !channel.parts.empty();
+    // the whole envelope, for the channels selecting parts:
+    std::shared_ptr<std::string> whole;
+    const char *env_data = data;
+    size_t env_size = size;
+    try
+    {
+        if(chunked)
+        {
+            b0::message::parseChunk(chunk, data, size);
+            if(selecting)
+            {
+                whole = reassemblers_[it->first].add(data, size);
+                env_data = whole ? whole->data() : nullptr;
+                env_size = whole ? whole->size() : 0;
+            }
+        }
+    }
+    catch(exception::EnvelopeDecodeError &)
+    {
+        return;
+    }
+
+    // parsed on demand, by the first channel selecting parts which admits the envelope:
+    int parsed = 0;
+    for(auto &channel : it->second)
+    {
+        if(!channel.parts.empty())
+        {
+            if(!env_data || !channel.limit.admit())
+                continue;
+            if(parsed == 0)
+            {
+                try
+                {
+                    b0::message::parse(envelope_, env_data, env_size, compression_context_);
+                    parsed = 1;
+                }
+                catch(std::exception &)
+                {
+                    parsed = -1;
+                }
+            }
+            if(parsed < 0)
+                continue;
+            const char *end = env_data + env_size;
+            const char *h0_end = std::find(env_data, end, '\n');
+            if(selectParts(channel, h0_end != end && h0_end + 1 != end && h0_end[1] == '\0'))
+                copies.push_back(Copy{&channel.name, &channel.buffer});
+            continue;
+        }
+        if(chunked && chunk.index > 0)
+        {
+            auto c = channel.chunked.find(chunk.sender);
+            if(c == channel.chunked.end() || c->second != chunk.seq)
+                continue;
+            if(chunk.index + 1 == chunk.count)
+                channel.chunked.erase(c);
+            copies.push_back(Copy{&channel.name, nullptr});
+            continue;
+        }
+        if(!channel.limit.admit())
+        {
+            if(chunked) channel.chunked.erase(chunk.sender);
+            continue;
+        }
+        if(chunked && chunk.count > 1)
+            channel.chunked[chunk.sender] = chunk.seq;
+        copies.push_back(Copy{&channel.name, nullptr});
+    }
+}
+
+bool Decimator::selectParts(Channel &channel, bool binary)
+{
+    b0::message::MessageEnvelope &env = copy_;
+    env.header0 = channel.name;
+    env.headers = envelope_.getHeaders();
+    // the parts of a batch are messages on their own (see b0::Publisher::publishBatch()), all kept:
+    bool batch = env.headers.count("Batch") > 0;
+    env.parts.clear();
+    for(size_t i = 0; i < envelope_.parts.size(); i++)
+    {
+        const b0::message::MessagePartView &view = envelope_.parts[i];
+        if(!batch && !selectsPart(channel.parts, i, view.content_type))
+            continue;
+        env.parts.emplace_back();
+        b0::message::MessagePart &part = env.parts.back();
+        part.content_type = view.content_type;
+        part.compression_algorithm = view.compression_algorithm;
+        part.compression_level = view.compression_level;
+        part.compression_dictionary = view.compression_dictionary;
+        part.payload.assign(view.data, view.size);
+    }
+    if(env.parts.empty())
+        return false;
+    b0::message::serialize(env, channel.buffer, binary ? b0::message::EnvelopeFormat::Binary : b0::message::EnvelopeFormat::Text, content_lengths_, compression_context_);
+    return true;
+}
+
+} // namespace b0
@@ -0,0 +1,315 @@
+#include <b0/utils/graph_layout.h>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <functional>
+
+namespace b0
+{
+
+namespace graph
+{
+
+using Kind = LayoutVertex::Kind;
+
+static const double pi = 3.14159265358979323846;
+
+//! A direction which depends only on the id, to separate vertices at the same place
+static void direction(const std::string &id, double &dx, double &dy)
+{
+    double angle = (std::hash<std::string>()(id) % 3600) * pi / 1800;
+    dx = std::cos(angle);
+    dy = std::sin(angle);
+}
+
+std::string GraphLayout::vertexId(Kind kind, const std::string &name)
+{
+    switch(kind)
+    {
+    case Kind::Node: return "N:" + name;
+    case Kind::Topic: return "T:" + name;
+    case Kind::Service: return "S:" + name;
+    }
+    return name;
+}
+
+bool GraphLayout::update(const b0::message::graph::Graph &graph)
+{
+    std::map<std::string, LayoutVertex> vertices;
+    std::set<std::pair<std::string, std::string> > edges;
+    for(auto &n : graph.nodes)
+    {
+        LayoutVertex &v = vertices[vertexId(Kind::Node, n.node_name)];
+        v.kind = Kind::Node;
+        v.name = n.node_name;
+        v.host = n.host_id;
+    }
+    auto addLinks = [&](const std::vector<b0::message::graph::GraphLink> &links, Kind kind)
+    {
+        for(auto &l : links)
+        {
+            std::string node = vertexId(Kind::Node, l.node_name), other = vertexId(kind, l.other_name);
+            LayoutVertex &v = vertices[other];
+            v.kind = kind;
+            v.name = l.other_name;
+            // (links of nodes not in the graph yet)
+            if(!vertices.count(node))
+            {
+                LayoutVertex &n = vertices[node];
+                n.kind = Kind::Node;
+                n.name = l.node_name;
+            }
+            edges.insert(l.reversed ? std::make_pair(other, node) : std::make_pair(node, other));
+        }
+    };
+    addLinks(graph.node_topic, Kind::Topic);
+    addLinks(graph.node_service, Kind::Service);
+
+    changed_.clear();
+    removed_.clear();
+    bool modified = edges != edges_;
+
+    // the neighbors of the vertices removed move to fill the gap:
+    std::set<std::string> active;
+    for(auto it = vertices_.begin(); it != vertices_.end(); )
+    {
+        if(vertices.count(it->first))
+        {
+            ++it;
+            continue;
+        }
+        removed_.insert(it->first);
+        for(auto &n : neighbors_[it->first])
+            active.insert(n);
+        neighbors_.erase(it->first);
+        it = vertices_.erase(it);
+        modified = true;
+    }
+
+    // the neighbors of the vertices whose edges changed too:
+    std::map<std::string, std::set<std::string> > neighbors;
+    for(auto &e : edges)
+    {
+        neighbors[e.first].insert(e.second);
+        neighbors[e.second].insert(e.first);
+    }
+    for(auto &n : neighbors)
+        if(vertices_.count(n.first) && neighbors_[n.first] != n.second)
+            active.insert(n.first);
+    for(auto &n : neighbors_)
+        if(vertices_.count(n.first) && !n.second.empty() && !neighbors.count(n.first))
+            active.insert(n.first);
+    neighbors_.swap(neighbors);
+    edges_.swap(edges);
+
+    std::vector<std::string> added;
+    for(auto &v : vertices)
+    {
+        auto it = vertices_.find(v.first);
+        if(it != vertices_.end())
+        {
+            it->second.host = v.second.host;
+            continue;
+        }
+        vertices_.insert(v);
+        added.push_back(v.first);
+        modified = true;
+    }
+    if(!modified) return false;
+
+    // first the vertices next to placed ones, so that each new part grows from where it is attached:
+    std::set<std::string> placed;
+    for(auto &v : vertices_)
+        placed.insert(v.first);
+    for(auto &id : added)
+        placed.erase(id);
+    std::set<std::string> pending(added.begin(), added.end());
+    std::deque<std::string> ready;
+    for(auto &id : added)
+        for(auto &n : neighbors_[id])
+            if(placed.count(n))
+            {
+                ready.push_back(id);
+                break;
+            }
+    while(!pending.empty())
+    {
+        if(ready.empty())
+            ready.push_back(*pending.begin());
+        std::string id = ready.front();
+        ready.pop_front();
+        if(!pending.erase(id)) continue;
+        place(id, vertices_[id], placed);
+        placed.insert(id);
+        active.insert(id);
+        for(auto &n : neighbors_[id])
+        {
+            active.insert(n);
+            if(pending.count(n))
+                ready.push_back(n);
+        }
+    }
+
+    for(auto it = active.begin(); it != active.end(); )
+        it = vertices_.count(*it) ? std::next(it) : active.erase(it);
+    relax(active);
+    changed_ = active;
+    return true;
+}
+
+void GraphLayout::place(const std::string &id, LayoutVertex &v, const std::set<std::string> &placed)
+{
+    double x = 0, y = 0;
+    int count = 0;
+    for(auto &n : neighbors_[id])
+    {
+        if(!placed.count(n)) continue;
+        const LayoutVertex &u = vertices_.at(n);
+        x += u.x;
+        y += u.y;
+        count++;
+    }
+    // a node without placed neighbors goes next to the nodes of its host:
+    if(!count && v.kind == Kind::Node && !v.host.empty())
+    {
+        for(auto &u : vertices_)
+        {
+            if(!placed.count(u.first) || u.second.host != v.host || u.second.kind != Kind::Node) continue;
+            x += u.second.x;
+            y += u.second.y;
+            count++;
+        }
+    }
+    double dx, dy;
+    direction(id, dx, dy);
+    if(count)
+    {
+        v.x = x / count + dx * edge_length_ * 0.5;
+        v.y = y / count + dy * edge_length_ * 0.5;
+        return;
+    }
+    // the others on a spiral, away from the rest:
+    double r = edge_length_ * 2 * std::sqrt(double(++spiral_));
+    double angle = spiral_ * 2.39996; // the golden angle
+    v.x = r * std::cos(angle);
+    v.y = r * std::sin(angle);
+}
+
+void GraphLayout::relax(const std::set<std::string> &active)
+{
+    if(active.empty()) return;
+
+    const double k = edge_length_, cell = 2 * k;
+    auto cellOf = [&](const LayoutVertex &v) {
+        return std::make_pair(int(std::floor(v.x / cell)), int(std::floor(v.y / cell)));
+    };
+    std::map<std::pair<int, int>, std::vector<std::pair<const std::string*, LayoutVertex*> > > grid;
+    for(auto &v : vertices_)
+        grid[cellOf(v.second)].push_back(std::make_pair(&v.first, &v.second));
+
+    std::vector<std::pair<const std::string*, LayoutVertex*> > moving;
+    for(auto &id : active)
+    {
+        auto it = vertices_.find(id);
+        moving.push_back(std::make_pair(&it->first, &it->second));
+    }
+    std::vector<std::pair<double, double> > disp(moving.size());
+
+    for(int i = 0; i < iterations_; i++)
+    {
+        // the maximum displacement, decreasing linearly:
+        double temperature = k * (1.0 - 0.95 * i / std::max(1, iterations_ - 1));
+        for(size_t j = 0; j < moving.size(); j++)
+        {
+            const std::string &id = *moving[j].first;
+            const LayoutVertex &v = *moving[j].second;
+            double fx = 0, fy = 0;
+            auto c = cellOf(v);
+            for(int cx = c.first - 1; cx <= c.first + 1; cx++)
+            for(int cy = c.second - 1; cy <= c.second + 1; cy++)
+            {
+                auto g = grid.find(std::make_pair(cx, cy));
+                if(g == grid.end()) continue;
+                for(auto &u : g->second)
+                {
+                    if(u.second == &v) continue;
+                    double dx = v.x - u.second->x, dy = v.y - u.second->y;
+                    double d = std::sqrt(dx * dx + dy * dy);
+                    if(d >= cell) continue;
+                    if(d < 0.01)
+                    {
+                        direction(id + *u.first, dx, dy);
+                        d = 0.01;
+                    }
+                    else
+                    {
+                        dx /= d;
+                        dy /= d;
+                    }
+                    fx += dx * k * k / d;
+                    fy += dy * k * k / d;
+                }
+            }
+            for(auto &n : neighbors_[id])
+            {
+                const LayoutVertex &u = vertices_[n];
+                double dx = v.x - u.x, dy = v.y - u.y;
+                double d = std::sqrt(dx * dx + dy * dy);
+                fx -= dx * d / k;
+                fy -= dy * d / k;
+            }
+            disp[j] = std::make_pair(fx, fy);
+        }
+        for(size_t j = 0; j < moving.size(); j++)
+        {
+            LayoutVertex &v = *moving[j].second;
+            double fx = disp[j].first, fy = disp[j].second;
+            double f = std::sqrt(fx * fx + fy * fy);
+            if(f < 1e-9) continue;
+            auto before = cellOf(v);
+            double step = std::min(f, temperature) / f;
+            v.x += fx * step;
+            v.y += fy * step;
+            auto after = cellOf(v);
+            if(after == before) continue;
+            auto &from = grid[before];
+            from.erase(std::find(from.begin(), from.end(), moving[j]));
+            grid[after].push_back(moving[j]);
+        }
+    }
+}
+
+const std::map<std::string, LayoutVertex> & GraphLayout::vertices() const
+{
+    return vertices_;
+}
+
+const std::set<std::pair<std::string, std::string> > & GraphLayout::edges() const
+{
+    return edges_;
+}
+
+const std::set<std::string> & GraphLayout::changed() const
+{
+    return changed_;
+}
+
+const std::set<std::string> & GraphLayout::removed() const
+{
+    return removed_;
+}
+
+void GraphLayout::setEdgeLength(double length)
+{
+    edge_length_ = length;
+}
+
+void GraphLayout::setIterations(int iterations)
+{
+    iterations_ = iterations;
+}
+
+} // namespace graph
+
+} // namespace b0
@@ -0,0 +1,74 @@
+#include <b0/utils/graph_tracker.h>
+
+#include <algorithm>
+#include <set>
+#include <tuple>
+
+namespace b0
+{
+
+namespace graph
+{
+
+using b0::message::graph::GraphLink;
+using b0::message::graph::GraphNode;
+
+static std::tuple<std::string, std::string, bool> key(const GraphLink &l)
+{
+    return std::make_tuple(l.node_name, l.other_name, l.reversed);
+}
+
+static void update(std::vector<GraphLink> &links, const std::vector<GraphLink> &removed, const std::vector<GraphLink> &added)
+{
+    if(!removed.empty())
+    {
+        std::set<std::tuple<std::string, std::string, bool> > keys;
+        for(auto &l : removed) keys.insert(key(l));
+        links.erase(std::remove_if(links.begin(), links.end(), [&](const GraphLink &l) {return keys.count(key(l)) > 0;}), links.end());
+    }
+    links.insert(links.end(), added.begin(), added.end());
+}
+
+void GraphTracker::reset(const b0::message::graph::Graph &graph)
+{
+    graph_ = graph;
+    valid_ = true;
+}
+
+bool GraphTracker::apply(const b0::message::graph::GraphDelta &delta)
+{
+    if(!valid_) return false;
+    if(delta.version <= graph_.version) return true;
+    if(delta.version != graph_.version + 1) return false;
+
+    if(!delta.nodes_removed.empty())
+    {
+        std::set<std::string> names(delta.nodes_removed.begin(), delta.nodes_removed.end());
+        auto &nodes = graph_.nodes;
+        nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [&](const GraphNode &n) {return names.count(n.node_name) > 0;}), nodes.end());
+    }
+    graph_.nodes.insert(graph_.nodes.end(), delta.nodes_added.begin(), delta.nodes_added.end());
+    update(graph_.node_topic, delta.node_topic_removed, delta.node_topic_added);
+    update(graph_.node_service, delta.node_service_removed, delta.node_service_added);
+    graph_.version = delta.version;
+    return true;
+}
+
+bool GraphTracker::valid() const
+{
+    return valid_;
+}
+
+int64_t GraphTracker::version() const
+{
+    return graph_.version;
+}
+
+const b0::message::graph::Graph & GraphTracker::graph() const
+{
+    return graph_;
+}
+
+} // namespace graph
+
+} // namespace b0
@@ -3,6 +3,7 @@
 #include <cstdlib>
 #include <fstream>
 #include <sstream>
+#include <vector>
 #include <iostream>
 #include <boost/format.hpp>
 #ifdef HAVE_BOOST_PROCESS
@@ -38,19 +39,51 @@ static std::string id(const std::string &t, const std::string &name)
     return (fmt % t % normalize(name)).str();
 }
 
+static std::string nodeLabel(const b0::message::graph::GraphNode &node, const GraphvizOutputOptions &opts)
+{
+    if(!opts.show_stats || !node.stats) return node.node_name;
+    const b0::message::graph::NodeStats &s = *node.stats;
+    std::string label = (boost::format("%s\\ncpu %.0f%% rss %.1fM\\ntx %.0f/s rx %.0f/s")
+            % node.node_name % (s.cpu_usage * 100) % (s.rss / 1048576.0)
+            % s.messages_sent_rate % s.messages_received_rate).str();
+    if(s.spin_overruns)
+        label += (boost::format("\\n%d overruns") % s.spin_overruns).str();
+    return label;
+}
+
+//! The position attribute of a vertex, if a layout is given
+static std::string pos(LayoutVertex::Kind kind, const std::string &name, const GraphvizOutputOptions &opts)
+{
+    if(!opts.layout) return "";
+    auto it = opts.layout->vertices().find(GraphLayout::vertexId(kind, name));
+    if(it == opts.layout->vertices().end()) return "";
+    return (boost::format(", pos=\"%.1f,%.1f!\"") % it->second.x % -it->second.y).str();
+}
+
+static bool isHot(const b0::message::graph::GraphNode &node, const GraphvizOutputOptions &opts)
+{
+    return opts.show_stats && node.stats && node.stats->cpu_usage >= opts.hot_cpu_usage;
+}
+
 void toGraphviz(const b0::message::graph::Graph &graph, const std::string &filename, const GraphvizOutputOptions &opts)
 {
     std::ofstream f;
     f.open(filename);
     f << "digraph G {" << std::endl;
-    f << "    graph [overlap=false, splines=true, bgcolor=\"transparent\"];" << std::endl;
+    // with the positions given, the edges are not routed around the vertices (which is what takes time):
+    if(opts.layout)
+        f << "    graph [splines=line, bgcolor=\"transparent\"];" << std::endl;
+    else
+        f << "    graph [overlap=false, splines=true, bgcolor=\"transparent\"];" << std::endl;
     f << std::endl;
     std::set<std::string> hosts;
     std::map<std::string, std::set<std::string> > nodes_by_host;
-    for(auto x : graph.nodes)
+    std::map<std::string, const b0::message::graph::GraphNode*> nodes_by_name;
+    for(auto &x : graph.nodes)
     {
         hosts.insert(x.host_id);
         nodes_by_host[x.host_id].insert(x.node_name);
+        nodes_by_name[x.node_name] = &x;
     }
     std::map<std::string, std::set<std::string> > services_by_node;
     for(auto x : graph.node_service)
@@ -69,13 +102,17 @@ void toGraphviz(const b0::message::graph::Graph &graph, const std::string &filen
         f << "        node [shape=box, color=" << opts.outline_color << ", fontcolor=" << opts.outline_color << "];" << std::endl;
         for(auto node : nodes_by_host[host])
         {
-            f << "        " << id("N", node) << " [label=\"" << node << "\"];" << std::endl;
+            const b0::message::graph::GraphNode &n = *nodes_by_name[node];
+            f << "        " << id("N", node) << " [label=\"" << nodeLabel(n, opts) << "\"" << pos(LayoutVertex::Kind::Node, node, opts);
+            if(isHot(n, opts))
+                f << ", color=" << opts.hot_color << ", fontcolor=" << opts.hot_color;
+            f << "];" << std::endl;
         }
         f << "        node [shape=diamond, color=" << opts.service_color << "];" << std::endl;
         for(auto node : nodes_by_host[host])
         for(auto service : services_by_node[node])
         {
-            f << "        " << id("S", service) << " [label=\"" << service << "\", fontcolor=" << opts.service_color << "];" << std::endl;
+            f << "        " << id("S", service) << " [label=\"" << service << "\", fontcolor=" << opts.service_color << pos(LayoutVertex::Kind::Service, service, opts) << "];" << std::endl;
         }
         if(opts.cluster_hosts)
         {
@@ -86,7 +123,7 @@ void toGraphviz(const b0::message::graph::Graph &graph, const std::string &filen
     f << "    node [shape=ellipse, color=" << opts.topic_color << "];" << std::endl;
     for(auto x : graph.node_topic)
     {
-        f << "    " << id("T", x.other_name) << " [label=\"" << x.other_name << "\", fontcolor=" << opts.topic_color << "];" << std::endl;
+        f << "    " << id("T", x.other_name) << " [label=\"" << x.other_name << "\", fontcolor=" << opts.topic_color << pos(LayoutVertex::Kind::Topic, x.other_name, opts) << "];" << std::endl;
     }
     f << std::endl;
     f << "    edge [color=" << opts.outline_color << "];" << std::endl;
@@ -111,7 +148,10 @@ void toGraphviz(const b0::message::graph::Graph &graph, const std::string &filen
 int renderGraphviz(const std::string &input, const std::string &output, const GraphvizRenderOptions &opts)
 {
 #ifdef HAVE_BOOST_PROCESS
-    boost::process::child c(boost::process::search_path(opts.program), "-T", opts.output_format, boost::process::std_out > output, boost::process::std_in < input);
+    std::vector<std::string> args{"-T", opts.output_format};
+    // (-n: the positions are in points, as given by GraphLayout)
+    if(opts.pinned) args.push_back("-n");
+    boost::process::child c(boost::process::search_path(opts.program), boost::process::args(args), boost::process::std_out > output, boost::process::std_in < input);
     c.wait();
     return c.exit_code();
 #else
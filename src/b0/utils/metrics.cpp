@@ -0,0 +1,192 @@
+#include <b0/utils/metrics.h>
+
+namespace b0
+{
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if(value < 8) return value;
+    int e = 63;
+    while(!(value >> e)) e--;
+    size_t sub = (value >> (e - 3)) & 7;
+    return 8 + (e - 3) * 8 + sub;
+}
+
+int64_t LatencyHistogram::bucketValue(size_t index)
+{
+    if(index < 8) return index;
+    size_t e = (index - 8) / 8 + 3, sub = (index - 8) % 8;
+    return int64_t((8 + sub) << (e - 3));
+}
+
+void LatencyHistogram::record(int64_t value)
+{
+    if(value < 0) value = 0;
+    buckets_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(value, std::memory_order_relaxed);
+    int64_t m = max_.load(std::memory_order_relaxed);
+    while(value > m && !max_.compare_exchange_weak(m, value, std::memory_order_relaxed));
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::total() const
+{
+    return total_.load(std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::max() const
+{
+    return max_.load(std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::percentile(double p) const
+{
+    uint64_t n = 0;
+    for(size_t i = 0; i < num_buckets_; i++)
+        n += buckets_[i].load(std::memory_order_relaxed);
+    if(n == 0) return 0;
+
+    uint64_t rank = uint64_t(p / 100.0 * n + 0.5);
+    if(rank < 1) rank = 1;
+    if(rank > n) rank = n;
+    uint64_t acc = 0;
+    for(size_t i = 0; i < num_buckets_; i++)
+    {
+        acc += buckets_[i].load(std::memory_order_relaxed);
+        if(acc >= rank) return bucketValue(i);
+    }
+    return max();
+}
+
+void LatencyHistogram::reset()
+{
+    for(size_t i = 0; i < num_buckets_; i++)
+        buckets_[i].store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    total_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+AllocationCounter::AllocationCounter()
+{
+    reset();
+}
+
+void AllocationCounter::add(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void AllocationCounter::reset()
+{
+    allocations.store(0, std::memory_order_relaxed);
+    bytes.store(0, std::memory_order_relaxed);
+}
+
+QueueGauge::QueueGauge()
+{
+    bytes.store(0, std::memory_order_relaxed);
+    peak_bytes.store(0, std::memory_order_relaxed);
+}
+
+void QueueGauge::set(size_t size)
+{
+    bytes.store(size, std::memory_order_relaxed);
+    uint64_t m = peak_bytes.load(std::memory_order_relaxed);
+    while(size > m && !peak_bytes.compare_exchange_weak(m, size, std::memory_order_relaxed));
+}
+
+void QueueGauge::reset()
+{
+    peak_bytes.store(bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+SocketCounters::SocketCounters()
+{
+    reset();
+}
+
+void SocketCounters::messageSent(size_t wire_bytes, size_t payload_bytes)
+{
+    messages_sent.fetch_add(1, std::memory_order_relaxed);
+    bytes_sent.fetch_add(wire_bytes, std::memory_order_relaxed);
+    payload_bytes_sent.fetch_add(payload_bytes, std::memory_order_relaxed);
+}
+
+void SocketCounters::messageDropped()
+{
+    messages_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SocketCounters::messageReceived(size_t wire_bytes, size_t payload_bytes)
+{
+    messages_received.fetch_add(1, std::memory_order_relaxed);
+    bytes_received.fetch_add(wire_bytes, std::memory_order_relaxed);
+    payload_bytes_received.fetch_add(payload_bytes, std::memory_order_relaxed);
+}
+
+void SocketCounters::readError()
+{
+    read_errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SocketCounters::connected(int64_t connect_usec, bool reconnected)
+{
+    connects.fetch_add(1, std::memory_order_relaxed);
+    if(reconnected)
+        reconnects.fetch_add(1, std::memory_order_relaxed);
+    connect_time.record(connect_usec);
+}
+
+void SocketCounters::reset()
+{
+    messages_sent.store(0, std::memory_order_relaxed);
+    bytes_sent.store(0, std::memory_order_relaxed);
+    payload_bytes_sent.store(0, std::memory_order_relaxed);
+    messages_dropped.store(0, std::memory_order_relaxed);
+    messages_received.store(0, std::memory_order_relaxed);
+    bytes_received.store(0, std::memory_order_relaxed);
+    payload_bytes_received.store(0, std::memory_order_relaxed);
+    read_errors.store(0, std::memory_order_relaxed);
+    compression_skipped.store(0, std::memory_order_relaxed);
+    compression_ratio.store(0, std::memory_order_relaxed);
+    connects.store(0, std::memory_order_relaxed);
+    disconnects.store(0, std::memory_order_relaxed);
+    reconnects.store(0, std::memory_order_relaxed);
+    connect_retries.store(0, std::memory_order_relaxed);
+    handshake_failures.store(0, std::memory_order_relaxed);
+    connect_time.reset();
+    handshake_time.reset();
+    callback_duration.reset();
+    callback_cpu.reset();
+    receive_allocations.reset();
+    decode_allocations.reset();
+    send_allocations.reset();
+    receive_queue.reset();
+    write_queue.reset();
+}
+
+SpinCounters::SpinCounters()
+{
+    reset();
+}
+
+void SpinCounters::reset()
+{
+    iterations.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+    jitter.reset();
+}
+
+} // namespace b0
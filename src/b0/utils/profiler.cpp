@@ -0,0 +1,130 @@
+#include <b0/utils/profiler.h>
+#include <b0/utils/metrics.h>
+#include <b0/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+namespace b0
+{
+
+static std::atomic<ProfilerHook*> profiler_hook{nullptr};
+
+ProfilerHook::~ProfilerHook()
+{
+}
+
+void setProfilerHook(ProfilerHook *hook)
+{
+    profiler_hook.store(hook);
+}
+
+ProfilerHook * getProfilerHook()
+{
+    return profiler_hook.load();
+}
+
+int64_t threadCPUTimeUSec()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if(!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return 0;
+    // in 100 ns units
+    uint64_t k = (uint64_t(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+    uint64_t u = (uint64_t(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+    return int64_t((k + u) / 10);
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#else
+    return 0;
+#endif
+}
+
+int64_t processCPUTimeUSec()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if(!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0;
+    // in 100 ns units
+    uint64_t k = (uint64_t(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+    uint64_t u = (uint64_t(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+    return int64_t((k + u) / 10);
+#elif defined(CLOCK_PROCESS_CPUTIME_ID)
+    struct timespec ts;
+    if(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#else
+    return 0;
+#endif
+}
+
+int64_t processRSS()
+{
+#if defined(__linux__)
+    // "size resident shared text lib data dt", in pages
+    int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return 0;
+    char buf[128];
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if(n <= 0) return 0;
+    buf[n] = '\0';
+    long long size, resident;
+    if(sscanf(buf, "%lld %lld", &size, &resident) != 2)
+        return 0;
+    return int64_t(resident) * sysconf(_SC_PAGESIZE);
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS)
+        return 0;
+    return int64_t(info.resident_size);
+#else
+    return 0;
+#endif
+}
+
+#ifdef ENABLE_PROFILING
+
+static int64_t wallTimeUSec()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CallbackProfiler::CallbackProfiler(Socket &socket)
+    : socket_(socket),
+      hook_(profiler_hook.load(std::memory_order_relaxed)),
+      wall0_(wallTimeUSec()),
+      cpu0_(threadCPUTimeUSec())
+{
+    if(hook_) hook_->beginCallback(socket_);
+}
+
+CallbackProfiler::~CallbackProfiler()
+{
+    int64_t cpu = threadCPUTimeUSec() - cpu0_;
+    socket_.getCounters().callback_cpu.record(cpu);
+    if(hook_) hook_->endCallback(socket_, wallTimeUSec() - wall0_, cpu);
+}
+
+#endif // ENABLE_PROFILING
+
+} // namespace b0
@@ -0,0 +1,142 @@
+#include <b0/utils/response_cache.h>
+
+#include <boost/format.hpp>
+
+namespace b0
+{
+
+static size_t payloadBytes(const std::vector<b0::message::MessagePart> &parts)
+{
+    size_t n = 0;
+    for(auto &part : parts) n += part.payload.size();
+    return n;
+}
+
+void ResponseCache::setLimits(size_t max_entries, long ttl, size_t max_bytes)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    max_entries_ = max_entries;
+    ttl_ = ttl;
+    max_bytes_ = max_bytes;
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+bool ResponseCache::enabled() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return max_entries_ > 0;
+}
+
+bool ResponseCache::find(const std::string &key, Entry &entry, bool &fresh)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    auto it = index_.find(key);
+    if(it == index_.end())
+    {
+        misses_++;
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    entry = it->second->second;
+    fresh = ttl_ < 0 || std::chrono::steady_clock::now() - entry.stored < std::chrono::milliseconds(ttl_);
+    if(fresh) hits_++;
+    else misses_++;
+    return true;
+}
+
+void ResponseCache::insert(const std::string &key, std::vector<b0::message::MessagePart> parts, const std::string &etag)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    if(max_entries_ == 0) return;
+    // a reply which alone exceeds the size limit is not worth evicting the others for
+    if(max_bytes_ > 0 && payloadBytes(parts) > max_bytes_) return;
+
+    auto it = index_.find(key);
+    if(it != index_.end())
+    {
+        bytes_ -= payloadBytes(it->second->second.parts);
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+    Entry entry;
+    bytes_ += payloadBytes(parts);
+    entry.parts = std::move(parts);
+    entry.etag = etag;
+    entry.stored = std::chrono::steady_clock::now();
+    lru_.emplace_front(key, std::move(entry));
+    index_[key] = lru_.begin();
+    evict();
+}
+
+void ResponseCache::touch(const std::string &key)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    auto it = index_.find(key);
+    if(it != index_.end())
+        it->second->second.stored = std::chrono::steady_clock::now();
+}
+
+void ResponseCache::clear()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+size_t ResponseCache::size() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return lru_.size();
+}
+
+uint64_t ResponseCache::hits() const
+{
+    return hits_.load();
+}
+
+uint64_t ResponseCache::misses() const
+{
+    return misses_.load();
+}
+
+std::string ResponseCache::key(const std::vector<b0::message::MessagePart> &parts)
+{
+    // length-prefixed, so that different splits of the same bytes give different keys
+    std::string k;
+    for(auto &part : parts)
+    {
+        k += std::to_string(part.content_type.size()) + ":" + part.content_type;
+        k += std::to_string(part.payload.size()) + ":" + part.payload;
+    }
+    return k;
+}
+
+std::string ResponseCache::etag(const std::vector<b0::message::MessagePart> &parts)
+{
+    uint64_t h = 14695981039346656037ULL;
+    auto hash = [&](const std::string &s) {
+        for(unsigned char c : s) {h ^= c; h *= 1099511628211ULL;}
+        h ^= s.size(); h *= 1099511628211ULL;
+    };
+    for(auto &part : parts)
+    {
+        hash(part.content_type);
+        hash(part.payload);
+    }
+    return (boost::format("%016x") % h).str();
+}
+
+void ResponseCache::evict()
+{
+    while(!lru_.empty() && (lru_.size() > max_entries_ || (max_bytes_ > 0 && bytes_ > max_bytes_)))
+    {
+        bytes_ -= payloadBytes(lru_.back().second.parts);
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+} // namespace b0
@@ -0,0 +1,52 @@
+#include <b0/utils/socket_profile.h>
+
+namespace b0
+{
+
+//! IP type-of-service byte of a DSCP
+static int dscp(int codepoint)
+{
+    return codepoint << 2;
+}
+
+static std::map<std::string, SocketProfile> makeBuiltins()
+{
+    std::map<std::string, SocketProfile> profiles;
+    profiles["default"] = SocketProfile();
+
+    SocketProfile &low_latency = profiles["low-latency"];
+    low_latency.read_hwm = 100;
+    low_latency.write_hwm = 100;
+    low_latency.immediate = true;
+    low_latency.linger = 0;
+    low_latency.tcp_keepalive = 1;
+    low_latency.tcp_keepalive_idle = 10;
+    low_latency.tos = dscp(46); // EF
+
+    SocketProfile &bulk = profiles["bulk"];
+    bulk.read_hwm = 100000;
+    bulk.write_hwm = 100000;
+    bulk.send_buffer = 4 * 1024 * 1024;
+    bulk.receive_buffer = 4 * 1024 * 1024;
+    bulk.tos = dscp(10); // AF11
+
+    SocketProfile &lossy_latest = profiles["lossy-latest"];
+    lossy_latest.read_hwm = 1;
+    lossy_latest.write_hwm = 1;
+    lossy_latest.immediate = true;
+    lossy_latest.linger = 0;
+    lossy_latest.tos = dscp(34); // AF41
+
+    SocketProfile &background = profiles["background"];
+    background.tos = dscp(8); // CS1
+
+    return profiles;
+}
+
+const std::map<std::string, SocketProfile> & SocketProfile::builtins()
+{
+    static const std::map<std::string, SocketProfile> profiles = makeBuiltins();
+    return profiles;
+}
+
+} // namespace b0
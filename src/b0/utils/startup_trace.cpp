@@ -0,0 +1,128 @@
+#include <b0/utils/startup_trace.h>
+#include <b0/exceptions.h>
+
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <boost/format.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace b0
+{
+
+static int64_t nowUsec()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+StartupTrace::Scope::Scope(StartupTrace *trace, const std::string &name, const std::string &socket)
+    : trace_(trace),
+      index_(0),
+      start_(0)
+{
+    if(!trace_) return;
+    start_ = nowUsec();
+    index_ = trace_->phases_.size();
+    trace_->phases_.emplace_back();
+    Phase &phase = trace_->phases_.back();
+    phase.name = name;
+    phase.socket = socket;
+    phase.depth = trace_->depth_++;
+    phase.start_usec = start_;
+}
+
+StartupTrace::Scope::~Scope()
+{
+    if(!trace_) return;
+    trace_->depth_--;
+    // (the trace may have been cleared meanwhile)
+    if(index_ < trace_->phases_.size())
+        trace_->phases_[index_].duration_usec = nowUsec() - start_;
+}
+
+void StartupTrace::clear()
+{
+    phases_.clear();
+    depth_ = 0;
+}
+
+const std::vector<StartupTrace::Phase> & StartupTrace::getPhases() const
+{
+    return phases_;
+}
+
+int64_t StartupTrace::getTotalDuration() const
+{
+    int64_t total = 0;
+    for(auto &phase : phases_)
+        if(phase.depth == 0) total += phase.duration_usec;
+    return total;
+}
+
+static void appendJSONString(std::string &s, const std::string &value)
+{
+    s += '"';
+    for(char c : value)
+    {
+        switch(c)
+        {
+        case '"': s += "\\\""; break;
+        case '\\': s += "\\\\"; break;
+        case '\n': s += "\\n"; break;
+        case '\r': s += "\\r"; break;
+        case '\t': s += "\\t"; break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20)
+                s += (boost::format("\\u%04x") % int(c)).str();
+            else
+                s += c;
+        }
+    }
+    s += '"';
+}
+
+std::string StartupTrace::toChromeTraceEvents(int pid, int tid, const std::string &thread_name) const
+{
+    std::string ids = ",\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(tid);
+    std::string s = "{\"name\":\"thread_name\",\"ph\":\"M\"" + ids + ",\"args\":{\"name\":";
+    appendJSONString(s, thread_name);
+    s += "}}";
+    for(auto &phase : phases_)
+    {
+        s += ",\n{\"name\":";
+        appendJSONString(s, phase.socket.empty() ? phase.name : phase.name + " " + phase.socket);
+        s += ",\"cat\":\"b0.init\",\"ph\":\"X\",\"ts\":" + std::to_string(phase.start_usec);
+        s += ",\"dur\":" + std::to_string(phase.duration_usec) + ids;
+        if(!phase.socket.empty())
+        {
+            s += ",\"args\":{\"socket\":";
+            appendJSONString(s, phase.socket);
+            s += '}';
+        }
+        s += '}';
+    }
+    return s;
+}
+
+void StartupTrace::appendChromeTrace(const std::string &path, int pid, int tid, const std::string &thread_name) const
+{
+    // (the nodes of this process append one after the other)
+    static boost::mutex mutex;
+    boost::mutex::scoped_lock lock(mutex);
+
+    std::FILE *f = std::fopen(path.c_str(), "ab");
+    if(!f)
+        throw exception::Exception((boost::format("Cannot open startup trace file %s: %s") % path % std::strerror(errno)).str());
+    std::fseek(f, 0, SEEK_END);
+    std::string s = std::ftell(f) == 0 ? "[\n" : "";
+    s += toChromeTraceEvents(pid, tid, thread_name);
+    s += ",\n";
+    bool ok = std::fwrite(s.data(), 1, s.size(), f) == s.size();
+    ok = std::fclose(f) == 0 && ok;
+    if(!ok)
+        throw exception::Exception((boost::format("Cannot write startup trace file: %s") % std::strerror(errno)).str());
+}
+
+} // namespace b0
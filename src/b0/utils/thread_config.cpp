@@ -0,0 +1,235 @@
+#include <b0/utils/thread_config.h>
+#include <b0/exceptions.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/trim.hpp>
+
+#include <zmq.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace b0
+{
+
+bool ThreadConfig::empty() const
+{
+    return cpus.empty() && policy.empty() && numa_node < 0 && numa_interface.empty();
+}
+
+int ThreadConfig::resolvedNUMANode() const
+{
+    if(numa_node >= 0) return numa_node;
+    if(!numa_interface.empty()) return numaNodeOfInterface(numa_interface);
+    return -1;
+}
+
+std::vector<int> ThreadConfig::resolvedCPUs() const
+{
+    if(!cpus.empty()) return cpus;
+    int node = resolvedNUMANode();
+    if(node >= 0) return numaNodeCPUs(node);
+    return {};
+}
+
+void ThreadConfig::validate() const
+{
+    if(!policy.empty() && policy != "other" && policy != "fifo" && policy != "rr")
+        throw exception::ArgumentError(policy, "policy");
+    if(priority < 0 || (policy == "other" && priority != 0))
+        throw exception::ArgumentError(std::to_string(priority), "priority");
+    for(int cpu : cpus)
+        if(cpu < 0)
+            throw exception::ArgumentError(std::to_string(cpu), "cpus");
+    if(numa_node < -1)
+        throw exception::ArgumentError(std::to_string(numa_node), "numa_node");
+    if(numa_interface.find('/') != std::string::npos)
+        throw exception::ArgumentError(numa_interface, "numa_interface");
+}
+
+std::vector<int> ThreadConfig::parseCPUList(const std::string &list)
+{
+    std::vector<int> cpus;
+    std::vector<std::string> items;
+    boost::split(items, list, boost::is_any_of(","));
+    for(std::string item : items)
+    {
+        boost::trim(item);
+        if(item.empty()) continue;
+        try
+        {
+            size_t dash = item.find('-');
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            if(first < 0 || last < first)
+                throw exception::ArgumentError(list, "cpus");
+            for(int cpu = first; cpu <= last; cpu++)
+                cpus.push_back(cpu);
+        }
+        catch(std::logic_error &)
+        {
+            throw exception::ArgumentError(list, "cpus");
+        }
+    }
+    return cpus;
+}
+
+//! Return the first line of a file, or an empty string if it cannot be read
+static std::string readLine(const std::string &path)
+{
+    std::ifstream f(path);
+    std::string line;
+    std::getline(f, line);
+    return boost::trim_copy(line);
+}
+
+int ThreadConfig::numaNodeOfInterface(const std::string &interface_name)
+{
+#ifdef __linux__
+    if(interface_name.empty() || interface_name.find('/') != std::string::npos) return -1;
+    // (-1 for the virtual interfaces, and on the machines with a single NUMA node)
+    std::string node = readLine("/sys/class/net/" + interface_name + "/device/numa_node");
+    try
+    {
+        return node.empty() ? -1 : std::max(-1, std::stoi(node));
+    }
+    catch(std::logic_error &)
+    {
+        return -1;
+    }
+#else
+    return -1;
+#endif
+}
+
+std::vector<int> ThreadConfig::numaNodeCPUs(int node)
+{
+#ifdef __linux__
+    if(node < 0) return {};
+    std::string list = readLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    try
+    {
+        return parseCPUList(list);
+    }
+    catch(exception::ArgumentError &)
+    {
+        return {};
+    }
+#else
+    return {};
+#endif
+}
+
+const std::vector<std::string> & ThreadConfig::roles()
+{
+    static const std::vector<std::string> roles{"spin", "heartbeat", "callback", "service", "log", "io"};
+    return roles;
+}
+
+#ifndef _WIN32
+static int schedPolicy(const std::string &policy)
+{
+    if(policy == "fifo") return SCHED_FIFO;
+    if(policy == "rr") return SCHED_RR;
+    return SCHED_OTHER;
+}
+#endif
+
+//! Make the allocations of the calling thread prefer the memory of a NUMA node
+static bool setNUMAMemoryPolicy(int node)
+{
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    // (MPOL_PREFERRED, from numaif.h, to not depend on libnuma)
+    const int mpol_preferred = 1;
+    const size_t bits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(node / bits + 1, 0);
+    mask[node / bits] |= 1UL << (node % bits);
+    return ::syscall(SYS_set_mempolicy, mpol_preferred, mask.data(), mask.size() * bits + 1) == 0;
+#else
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+std::string applyThreadConfig(const std::string &role)
+{
+    ThreadConfig config = getThreadConfig(role);
+    std::vector<std::string> errors;
+
+    std::vector<int> cpus = config.resolvedCPUs();
+    int numa_node = config.cpus.empty() ? config.resolvedNUMANode() : -1;
+    if(config.cpus.empty() && (config.numa_node >= 0 || !config.numa_interface.empty()) && cpus.empty())
+    {
+        if(numa_node < 0)
+            errors.push_back("unknown NUMA node of network interface " + config.numa_interface);
+        else
+            errors.push_back("unknown NUMA node " + std::to_string(numa_node));
+        numa_node = -1;
+    }
+
+    if(!cpus.empty())
+    {
+#ifdef HAVE_PTHREAD_SETAFFINITY
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(int cpu : cpus)
+            CPU_SET(cpu, &set);
+        int r = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if(r != 0)
+            errors.push_back(std::string("cannot set CPU affinity: ") + std::strerror(r));
+#else
+        errors.push_back("CPU affinity not supported on this platform");
+#endif
+    }
+
+    if(numa_node >= 0 && !setNUMAMemoryPolicy(numa_node))
+        errors.push_back(std::string("cannot set NUMA memory policy: ") + std::strerror(errno));
+
+    if(!config.policy.empty())
+    {
+#ifndef _WIN32
+        sched_param param;
+        param.sched_priority = config.policy == "other" ? 0 : config.priority;
+        int r = pthread_setschedparam(pthread_self(), schedPolicy(config.policy), &param);
+        if(r != 0)
+            errors.push_back(std::string("cannot set scheduling policy: ") + std::strerror(r));
+#else
+        errors.push_back("scheduling policy not supported on this platform");
+#endif
+    }
+
+    return boost::algorithm::join(errors, "; ");
+}
+
+void configureIOThreads(void *zmq_context)
+{
+    ThreadConfig config = getThreadConfig("io");
+#ifdef ZMQ_THREAD_AFFINITY_CPU_ADD
+    for(int cpu : config.resolvedCPUs())
+        zmq_ctx_set(zmq_context, ZMQ_THREAD_AFFINITY_CPU_ADD, cpu);
+#endif
+#if defined(ZMQ_THREAD_SCHED_POLICY) && !defined(_WIN32)
+    if(!config.policy.empty())
+    {
+        zmq_ctx_set(zmq_context, ZMQ_THREAD_SCHED_POLICY, schedPolicy(config.policy));
+        if(config.policy != "other")
+            zmq_ctx_set(zmq_context, ZMQ_THREAD_PRIORITY, config.priority);
+    }
+#endif
+}
+
+} // namespace b0
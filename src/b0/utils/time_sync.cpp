@@ -1,15 +1,53 @@
 #include <b0/utils/time_sync.h>
 #include <b0/utils/env.h>
 
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
 #include <boost/format.hpp>
-#include <boost/date_time/gregorian/gregorian.hpp>
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/algorithm/string.hpp>
 
 namespace b0
 {
 
+#if defined(CLOCK_REALTIME) && !defined(_WIN32)
+#define B0_HAVE_CLOCK_GETTIME
+#endif
+
+#ifdef B0_HAVE_CLOCK_GETTIME
+static inline int64_t clockUSec(clockid_t clock_id)
+{
+    struct timespec ts;
+    clock_gettime(clock_id, &ts);
+    return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+static inline int64_t realtimeUSec()
+{
+#ifdef B0_HAVE_CLOCK_GETTIME
+    return clockUSec(CLOCK_REALTIME);
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+#endif
+}
+
 TimeSync::TimeSync()
+    : seq_(0),
+      window_(std::max(1, b0::env::getInt("B0_TIMESYNC_WINDOW", 8))),
+      delay_(0),
+      clock_source_(ClockSource::Realtime),
+      monotonic_base_(0),
+      simulated_(false),
+      simulated_time_(0)
 {
+    std::string clock_source = b0::env::get("B0_CLOCK_SOURCE");
+    if(boost::iequals(clock_source, "realtime_coarse"))
+        setClockSource(ClockSource::RealtimeCoarse);
+    else if(boost::iequals(clock_source, "monotonic_raw"))
+        setClockSource(ClockSource::MonotonicRaw);
+
     target_offset_ = 0;
     max_acceptable_offset_ = b0::env::getInt("B0_TIMESYNC_MAX_OFFSET", 5 * 1000 * 1000);
     last_offset_time_ = hardwareTimeUSec();
@@ -28,50 +66,161 @@ void TimeSync::setMaxSlope(double max_slope)
     if(max_slope > 1)
         throw std::runtime_error("max_slope must not be greater than one");
 
-    max_slope_ = max_slope;
+    boost::mutex::scoped_lock lock(mutex_);
+    seq_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    max_slope_.store(max_slope, std::memory_order_relaxed);
+    seq_.fetch_add(1, std::memory_order_release);
+}
+
+void TimeSync::setClockSource(ClockSource source)
+{
+    clock_source_ = ClockSource::Realtime;
+#ifdef B0_HAVE_CLOCK_GETTIME
+#ifdef CLOCK_REALTIME_COARSE
+    if(source == ClockSource::RealtimeCoarse)
+        clock_source_ = source;
+#endif
+#ifdef CLOCK_MONOTONIC_RAW
+    if(source == ClockSource::MonotonicRaw)
+    {
+        monotonic_base_ = clockUSec(CLOCK_REALTIME) - clockUSec(CLOCK_MONOTONIC_RAW);
+        clock_source_ = source;
+    }
+#endif
+#endif
+}
+
+ClockSource TimeSync::getClockSource() const
+{
+    return clock_source_;
+}
+
+void TimeSync::setSimulated(bool simulated)
+{
+    simulated_.store(simulated);
+}
+
+bool TimeSync::isSimulated() const
+{
+    return simulated_.load();
+}
+
+void TimeSync::setSimulatedTimeUSec(int64_t time_usec)
+{
+    {
+        boost::mutex::scoped_lock lock(simulated_mutex_);
+        if(time_usec <= simulated_time_.load()) return;
+        simulated_time_.store(time_usec);
+    }
+    simulated_cond_.notify_all();
+}
+
+bool TimeSync::waitUntilUSec(int64_t until, int64_t max_wait_usec)
+{
+    boost::mutex::scoped_lock lock(simulated_mutex_);
+    if(simulated_time_.load() >= until) return true;
+    simulated_cond_.wait_for(lock, boost::chrono::microseconds{std::max<int64_t>(0, max_wait_usec)});
+    return simulated_time_.load() >= until;
 }
 
 int64_t TimeSync::hardwareTimeUSec() const
 {
-    static boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
-    boost::posix_time::ptime t = boost::posix_time::microsec_clock::universal_time();
-    return (t - epoch).total_microseconds();
+    if(simulated_.load(std::memory_order_relaxed))
+        return simulated_time_.load(std::memory_order_relaxed);
+#ifdef B0_HAVE_CLOCK_GETTIME
+    switch(clock_source_)
+    {
+#ifdef CLOCK_REALTIME_COARSE
+    case ClockSource::RealtimeCoarse:
+        return clockUSec(CLOCK_REALTIME_COARSE);
+#endif
+#ifdef CLOCK_MONOTONIC_RAW
+    case ClockSource::MonotonicRaw:
+        return clockUSec(CLOCK_MONOTONIC_RAW) + monotonic_base_;
+#endif
+    default:
+        break;
+    }
+#endif
+    return realtimeUSec();
 }
 
 int64_t TimeSync::timeUSec()
 {
+    if(simulated_.load(std::memory_order_relaxed))
+        return simulated_time_.load(std::memory_order_relaxed);
     return hardwareTimeUSec() + constantRateAdjustedOffset();
 }
 
 int64_t TimeSync::constantRateAdjustedOffset()
 {
-    boost::mutex::scoped_lock lock(mutex_);
+    int64_t target_offset, last_offset_value, last_offset_time;
+    double max_slope;
+    while(true)
+    {
+        uint32_t seq0 = seq_.load(std::memory_order_acquire);
+        if(seq0 & 1) continue; // a writer is updating the state
+        target_offset = target_offset_.load(std::memory_order_relaxed);
+        last_offset_value = last_offset_value_.load(std::memory_order_relaxed);
+        last_offset_time = last_offset_time_.load(std::memory_order_relaxed);
+        max_slope = max_slope_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(seq_.load(std::memory_order_relaxed) == seq0) break;
+    }
 
-    int64_t offset_delta = target_offset_ - last_offset_value_;
-    int64_t slope_time = abs(offset_delta) / max_slope_;
-    int64_t t = hardwareTimeUSec() - last_offset_time_;
+    int64_t offset_delta = target_offset - last_offset_value;
+    int64_t slope_time = abs(offset_delta) / max_slope;
+    int64_t t = hardwareTimeUSec() - last_offset_time;
     if(t >= slope_time)
-        return target_offset_;
+        return target_offset;
     else
-        return last_offset_value_ + offset_delta * t / slope_time;
+        return last_offset_value + offset_delta * t / slope_time;
 }
 
 void TimeSync::updateTime(int64_t remoteTime)
 {
+    updateTime(remoteTime, 0);
+}
+
+void TimeSync::updateTime(int64_t remoteTime, int64_t delay)
+{
+    // the simulated clock is the reference of all the nodes following it
+    if(simulated_.load()) return;
+
     int64_t last_offset_value = constantRateAdjustedOffset();
     int64_t local_time = hardwareTimeUSec();
 
     {
         boost::mutex::scoped_lock lock(mutex_);
 
-        last_offset_value_ = last_offset_value;
-        last_offset_time_ = local_time;
-        target_offset_ = remoteTime - local_time;
-
-        if(max_acceptable_offset_ > 0 && abs(target_offset_) > max_acceptable_offset_)
-            throw std::runtime_error((boost::format("Clock offset (%ld usec) is larger in absolute value than B0_TIMESYNC_MAX_OFFSET (%ld usec)") % target_offset_ % max_acceptable_offset_).str());
+        // minimum delay selection over the window of samples (the clock filter of NTP)
+        samples_.push_back(std::make_pair(remoteTime - local_time, std::max<int64_t>(0, delay)));
+        while(samples_.size() > window_)
+            samples_.pop_front();
+        auto best = samples_.begin();
+        for(auto it = samples_.begin(); it != samples_.end(); ++it)
+            if(it->second <= best->second)
+                best = it;
+        int64_t target_offset = best->first;
+        delay_.store(best->second, std::memory_order_relaxed);
+
+        seq_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        last_offset_value_.store(last_offset_value, std::memory_order_relaxed);
+        last_offset_time_.store(local_time, std::memory_order_relaxed);
+        target_offset_.store(target_offset, std::memory_order_relaxed);
+        seq_.fetch_add(1, std::memory_order_release);
+
+        if(max_acceptable_offset_ > 0 && abs(target_offset) > max_acceptable_offset_)
+            throw std::runtime_error((boost::format("Clock offset (%ld usec) is larger in absolute value than B0_TIMESYNC_MAX_OFFSET (%ld usec)") % target_offset % max_acceptable_offset_).str());
     }
 }
 
+int64_t TimeSync::getDelay() const
+{
+    return delay_.load(std::memory_order_relaxed);
+}
+
 } // namespace b0
 
@@ -0,0 +1,462 @@
+#include <b0/utils/tracing.h>
+#include <b0/socket.h>
+#include <b0/node.h>
+#include <b0/exceptions.h>
+#include <b0/message/message_envelope.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/format.hpp>
+
+namespace b0
+{
+
+namespace tracing
+{
+
+//! Number of queued spans waking up the export thread
+static const size_t batch_size = 512;
+
+//! Maximum number of queued spans; more are dropped
+static const size_t max_queue_size = 16384;
+
+//! Period of the export thread, when there are not enough spans for a batch
+static const boost::chrono::milliseconds export_period(1000);
+
+/*!
+ * \brief Queue of the recorded spans, exported in batches by a background thread
+ */
+struct Processor
+{
+    ~Processor()
+    {
+        stopThread();
+        flush();
+    }
+
+    void setExporter(std::shared_ptr<SpanExporter> e)
+    {
+        stopThread();
+        flush();
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            exporter = e;
+            stop = false;
+        }
+        enabled.store(e != nullptr);
+        if(e)
+            thread = boost::thread(&Processor::run, this);
+    }
+
+    void push(Span &&span)
+    {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            if(queue.size() >= max_queue_size)
+            {
+                dropped++;
+                return;
+            }
+            queue.push_back(std::move(span));
+            if(queue.size() != batch_size)
+                return;
+        }
+        cond.notify_one();
+    }
+
+    void flush()
+    {
+        std::vector<Span> batch;
+        std::shared_ptr<SpanExporter> e;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            batch.swap(queue);
+            e = exporter;
+        }
+        exportBatch(e, batch);
+    }
+
+    void exportBatch(const std::shared_ptr<SpanExporter> &e, const std::vector<Span> &batch)
+    {
+        if(!e || batch.empty()) return;
+        boost::mutex::scoped_lock lock(export_mutex);
+        try
+        {
+            e->exportSpans(batch);
+        }
+        catch(std::exception &ex)
+        {
+            std::cerr << "b0: tracing: failed to export " << batch.size() << " spans: " << ex.what() << std::endl;
+        }
+    }
+
+    void run()
+    {
+        std::vector<Span> batch;
+        for(;;)
+        {
+            std::shared_ptr<SpanExporter> e;
+            {
+                boost::mutex::scoped_lock lock(mutex);
+                if(!stop && queue.size() < batch_size)
+                    cond.wait_for(lock, export_period);
+                if(stop) return;
+                batch.clear();
+                batch.swap(queue);
+                e = exporter;
+            }
+            exportBatch(e, batch);
+        }
+    }
+
+    void stopThread()
+    {
+        if(!thread.joinable()) return;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            stop = true;
+        }
+        cond.notify_one();
+        thread.join();
+    }
+
+    //! Protects all the fields but export_mutex and the atomics
+    boost::mutex mutex;
+
+    //! Serializes the calls to the exporter
+    boost::mutex export_mutex;
+
+    boost::condition_variable cond;
+    std::shared_ptr<SpanExporter> exporter;
+    std::vector<Span> queue;
+    boost::thread thread;
+    bool stop{false};
+    std::atomic<bool> enabled{false};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<double> sample_ratio{1.0};
+};
+
+static Processor & processor()
+{
+    static Processor p;
+    return p;
+}
+
+//! The context of the callback running in this thread
+static thread_local TraceContext current_context;
+
+static std::mt19937_64 & generator()
+{
+    static thread_local std::mt19937_64 g([]() {
+        std::random_device rd;
+        return (uint64_t(rd()) << 32) ^ rd() ^ uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+    }());
+    return g;
+}
+
+static uint64_t randomId()
+{
+    uint64_t id;
+    do id = generator()(); while(id == 0);
+    return id;
+}
+
+static int64_t unixTimeUSec()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void appendHex(std::string &s, uint64_t value)
+{
+    static const char digits[] = "0123456789abcdef";
+    for(int shift = 60; shift >= 0; shift -= 4)
+        s += digits[(value >> shift) & 0xf];
+}
+
+static bool parseHex(const char *s, size_t n, uint64_t &value)
+{
+    value = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        char c = s[i];
+        int d;
+        if(c >= '0' && c <= '9') d = c - '0';
+        else if(c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else return false;
+        value = (value << 4) | d;
+    }
+    return true;
+}
+
+bool TraceContext::isValid() const
+{
+    return (trace_id_high || trace_id_low) && span_id;
+}
+
+std::string TraceContext::traceIdHex() const
+{
+    std::string s;
+    s.reserve(32);
+    appendHex(s, trace_id_high);
+    appendHex(s, trace_id_low);
+    return s;
+}
+
+std::string TraceContext::spanIdHex() const
+{
+    std::string s;
+    s.reserve(16);
+    appendHex(s, span_id);
+    return s;
+}
+
+std::string TraceContext::toTraceparent() const
+{
+    std::string s;
+    s.reserve(55);
+    s += "00-";
+    appendHex(s, trace_id_high);
+    appendHex(s, trace_id_low);
+    s += '-';
+    appendHex(s, span_id);
+    s += sampled ? "-01" : "-00";
+    return s;
+}
+
+bool TraceContext::fromTraceparent(boost::string_ref value, TraceContext &context)
+{
+    // version "00" has exactly this size; later versions may append fields
+    if(value.size() < 55 || value[2] != '-' || value[35] != '-' || value[52] != '-')
+        return false;
+    boost::string_ref version = value.substr(0, 2);
+    if(version == "ff" || (version == "00" && value.size() != 55))
+        return false;
+    const char *s = value.data();
+    uint64_t flags;
+    TraceContext c;
+    if(!parseHex(s + 3, 16, c.trace_id_high) || !parseHex(s + 19, 16, c.trace_id_low)
+            || !parseHex(s + 36, 16, c.span_id) || !parseHex(s + 53, 2, flags))
+        return false;
+    c.sampled = flags & 1;
+    if(!c.isValid())
+        return false;
+    context = c;
+    return true;
+}
+
+SpanExporter::~SpanExporter()
+{
+}
+
+static void appendJSONString(std::string &s, const std::string &value)
+{
+    s += '"';
+    for(char c : value)
+    {
+        switch(c)
+        {
+        case '"': s += "\\\""; break;
+        case '\\': s += "\\\\"; break;
+        case '\n': s += "\\n"; break;
+        case '\r': s += "\\r"; break;
+        case '\t': s += "\\t"; break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20)
+                s += (boost::format("\\u%04x") % int(c)).str();
+            else
+                s += c;
+        }
+    }
+    s += '"';
+}
+
+static void appendStringAttribute(std::string &s, const char *key, const std::string &value)
+{
+    s += "{\"key\":\"";
+    s += key;
+    s += "\",\"value\":{\"stringValue\":";
+    appendJSONString(s, value);
+    s += "}}";
+}
+
+FileSpanExporter::FileSpanExporter(const std::string &path, const std::string &service_name)
+    : file_(std::fopen(path.c_str(), "ab")),
+      service_name_(service_name)
+{
+    if(!file_)
+        throw exception::Exception((boost::format("Cannot open trace file %s: %s") % path % std::strerror(errno)).str());
+}
+
+FileSpanExporter::~FileSpanExporter()
+{
+    std::fclose(file_);
+}
+
+void FileSpanExporter::exportSpans(const std::vector<Span> &spans)
+{
+    std::string s;
+    s.reserve(128 + spans.size() * 300);
+    s += "{\"resourceSpans\":[{\"resource\":{\"attributes\":[";
+    appendStringAttribute(s, "service.name", service_name_);
+    s += "]},\"scopeSpans\":[{\"scope\":{\"name\":\"bluezero\"},\"spans\":[";
+    for(size_t i = 0; i < spans.size(); i++)
+    {
+        const Span &span = spans[i];
+        if(i) s += ',';
+        s += "{\"traceId\":\"";
+        s += span.context.traceIdHex();
+        s += "\",\"spanId\":\"";
+        s += span.context.spanIdHex();
+        s += '"';
+        if(span.parent_span_id)
+        {
+            s += ",\"parentSpanId\":\"";
+            appendHex(s, span.parent_span_id);
+            s += '"';
+        }
+        s += ",\"name\":";
+        appendJSONString(s, span.name);
+        s += ",\"kind\":" + std::to_string(static_cast<int>(span.kind));
+        s += ",\"startTimeUnixNano\":\"" + std::to_string(span.start_time) + "000\"";
+        s += ",\"endTimeUnixNano\":\"" + std::to_string(span.end_time) + "000\"";
+        s += ",\"attributes\":[";
+        appendStringAttribute(s, "b0.node", span.node_name);
+        s += ']';
+        s += '}';
+    }
+    s += "]}]}]}\n";
+    if(std::fwrite(s.data(), 1, s.size(), file_) != s.size() || std::fflush(file_) != 0)
+        throw exception::Exception((boost::format("Cannot write trace file: %s") % std::strerror(errno)).str());
+}
+
+void setExporter(std::shared_ptr<SpanExporter> exporter)
+{
+    processor().setExporter(exporter);
+}
+
+bool isEnabled()
+{
+    return processor().enabled.load(std::memory_order_relaxed);
+}
+
+void setSampleRatio(double ratio)
+{
+    if(ratio < 0 || ratio > 1)
+        throw exception::ArgumentError(std::to_string(ratio), "ratio");
+    processor().sample_ratio.store(ratio);
+}
+
+double getSampleRatio()
+{
+    return processor().sample_ratio.load();
+}
+
+void flush()
+{
+    processor().flush();
+}
+
+uint64_t getDroppedSpanCount()
+{
+    return processor().dropped.load();
+}
+
+TraceContext currentContext()
+{
+    return current_context;
+}
+
+bool startSpan(Span &span, SpanKind kind, const Socket &socket, const TraceContext &parent)
+{
+    const TraceContext &p = parent.isValid() ? parent : current_context;
+    bool enabled = isEnabled();
+    if(p.isValid())
+    {
+        if(!enabled || !p.sampled)
+        {
+            // not recorded: the propagated span stays the parent
+            span.context = p;
+            span.start_time = 0;
+            return true;
+        }
+        span.context = p;
+        span.parent_span_id = p.span_id;
+    }
+    else
+    {
+        if(!enabled)
+            return false;
+        span.context.trace_id_high = randomId();
+        span.context.trace_id_low = randomId();
+        double ratio = getSampleRatio();
+        span.context.sampled = ratio >= 1 || std::uniform_real_distribution<double>(0, 1)(generator()) < ratio;
+        span.parent_span_id = 0;
+    }
+    span.context.span_id = randomId();
+    span.kind = kind;
+    span.start_time = span.context.sampled ? unixTimeUSec() : 0;
+    if(span.start_time)
+    {
+        span.name = socket.getName();
+        span.node_name = socket.getNode().getName();
+    }
+    return true;
+}
+
+void endSpan(Span &span)
+{
+    if(!span.start_time) return;
+    span.end_time = unixTimeUSec();
+    processor().push(std::move(span));
+    span.start_time = 0;
+}
+
+void inject(std::map<std::string, std::string> &headers, const Span &span)
+{
+    if(span.context.isValid())
+        headers[header_name] = span.context.toTraceparent();
+}
+
+bool extract(const std::map<std::string, std::string> &headers, TraceContext &context)
+{
+    auto it = headers.find(header_name);
+    return it != headers.end() && TraceContext::fromTraceparent(it->second, context);
+}
+
+bool extract(const b0::message::MessageEnvelopeView &env, TraceContext &context)
+{
+    auto value = env.findHeader(header_name);
+    return value && TraceContext::fromTraceparent(*value, context);
+}
+
+Scope::Scope(SpanKind kind, const Socket &socket, const TraceContext &parent)
+    : active_(false)
+{
+    // fast path: nothing to propagate nor to record
+    if(!parent.isValid() && !current_context.isValid() && !isEnabled())
+        return;
+    if(!startSpan(span_, kind, socket, parent))
+        return;
+    previous_ = current_context;
+    current_context = span_.context;
+    active_ = true;
+}
+
+Scope::~Scope()
+{
+    if(!active_) return;
+    current_context = previous_;
+    endSpan(span_);
+}
+
+} // namespace tracing
+
+} // namespace b0
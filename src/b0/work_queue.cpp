@@ -0,0 +1,369 @@
+#include <b0/work_queue.h>
+#include <b0/node.h>
+#include <b0/exceptions.h>
+
+#include <cstdlib>
+
+#include <boost/format.hpp>
+
+#include <zmq.hpp>
+
+namespace b0
+{
+
+//! Period of the heartbeats of the workers
+static const std::chrono::seconds heartbeat_period{1};
+
+//! Time after which a silent worker is forgotten
+static const std::chrono::seconds worker_timeout{5};
+
+WorkQueueProducer::WorkQueueProducer(Node *node, const std::string &queue_name, bool managed, bool notify_graph)
+    : Socket(node, ZMQ_ROUTER, queue_name, managed),
+      notify_graph_(notify_graph)
+{
+}
+
+WorkQueueProducer::~WorkQueueProducer()
+{
+}
+
+void WorkQueueProducer::log(logger::Level level, const std::string &message) const
+{
+    boost::format fmt("WorkQueueProducer(%s): %s");
+    Socket::log(level, (fmt % name_ % message).str());
+}
+
+void WorkQueueProducer::init()
+{
+    if(Global::getInstance().remapServiceName(getNode(), orig_name_, name_))
+        info("Work queue name '%s' remapped to '%s'", orig_name_, name_);
+
+    boost::format fmt("tcp://%s:%d");
+    int port = bindEphemeralPort();
+    bind_addr_ = (fmt % "*" % port).str();
+    remote_addr_ = (fmt % node_.hostname() % port).str();
+    debug("Bound to %s", bind_addr_);
+    ipc_addr_ = bindIPC(port);
+
+    trace("Announcing %s to resolver...", remote_addr_);
+    node_.announceService(name_, remote_addr_, ipc_addr_);
+
+    if(notify_graph_)
+        node_.notifyService(name_, false, true);
+}
+
+void WorkQueueProducer::cleanup()
+{
+    if(!jobs_.empty())
+        warn("%d jobs were never sent", jobs_.size());
+
+    if(notify_graph_)
+        node_.notifyService(name_, false, false);
+}
+
+void WorkQueueProducer::spinOnce()
+{
+    readCredits();
+    expireWorkers();
+    sendJobs();
+}
+
+bool WorkQueueProducer::hasCallback() const
+{
+    return true;
+}
+
+bool WorkQueueProducer::hasPendingMessages() const
+{
+    if(jobs_.empty()) return false;
+    for(auto &w : workers_)
+        if(w.second.credit > 0) return true;
+    return false;
+}
+
+std::string WorkQueueProducer::getQueueName()
+{
+    return name_;
+}
+
+bool WorkQueueProducer::push(std::vector<b0::message::MessagePart> &&parts)
+{
+    // the jobs are sent in order: a new one waits behind the others
+    if(jobs_.empty())
+    {
+        readCredits();
+        if(sendJob(parts))
+            return true;
+    }
+
+    if(jobs_.size() >= queue_limit_)
+    {
+        dropped_++;
+        return false;
+    }
+    jobs_.push_back(std::move(parts));
+    return true;
+}
+
+bool WorkQueueProducer::push(const std::string &job, const std::string &type)
+{
+    std::vector<b0::message::MessagePart> parts(1);
+    parts[0].payload = job;
+    parts[0].content_type = type;
+    setPartCompression(parts[0]);
+    return push(std::move(parts));
+}
+
+void WorkQueueProducer::setQueueLimit(size_t max_jobs)
+{
+    if(max_jobs == 0)
+        throw exception::ArgumentError("0", "max_jobs");
+    queue_limit_ = max_jobs;
+}
+
+size_t WorkQueueProducer::getQueueLimit() const
+{
+    return queue_limit_;
+}
+
+size_t WorkQueueProducer::getQueueSize() const
+{
+    return jobs_.size();
+}
+
+size_t WorkQueueProducer::getWorkerCount() const
+{
+    return workers_.size();
+}
+
+uint64_t WorkQueueProducer::getSentCount() const
+{
+    return sent_;
+}
+
+uint64_t WorkQueueProducer::getDroppedCount() const
+{
+    return dropped_;
+}
+
+void WorkQueueProducer::sendJobs()
+{
+    while(!jobs_.empty() && sendJob(jobs_.front()))
+        jobs_.pop_front();
+}
+
+bool WorkQueueProducer::sendJob(std::vector<b0::message::MessagePart> &parts)
+{
+    if(workers_.empty()) return false;
+
+    // round-robin over the workers with credits left, starting after the last one used:
+    auto it = workers_.upper_bound(last_worker_);
+    for(size_t n = 0; n < workers_.size(); n++, ++it)
+    {
+        if(it == workers_.end())
+            it = workers_.begin();
+        Worker &w = it->second;
+        if(w.credit == 0) continue;
+
+        setRoute(w.route);
+        writeRaw(parts);
+        w.credit--;
+        last_worker_ = it->first;
+        sent_++;
+        return true;
+    }
+    return false;
+}
+
+void WorkQueueProducer::readCredits()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    while(poll())
+    {
+        ReadStatus status = tryReadRaw(read_envelope_, &read_error_);
+        if(status != ReadStatus::Ok)
+        {
+            readFailed(status, read_error_);
+            continue;
+        }
+
+        std::vector<std::string> route;
+        getRoute(route);
+        Worker &w = workers_[route];
+        if(w.route.empty())
+        {
+            w.route = route;
+            debug("New worker (%d workers)", workers_.size());
+        }
+        w.last_seen = now;
+
+        // a credit message gives credits back, a heartbeat of an idle worker states all its credits:
+        const std::map<std::string, std::string> &headers = read_envelope_.headers;
+        auto total = headers.find("Credit-total");
+        auto credit = headers.find("Credit");
+        if(total != headers.end())
+            w.credit = unsigned(std::strtoul(total->second.c_str(), nullptr, 10));
+        else if(credit != headers.end())
+            w.credit += unsigned(std::strtoul(credit->second.c_str(), nullptr, 10));
+    }
+}
+
+void WorkQueueProducer::expireWorkers()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for(auto it = workers_.begin(); it != workers_.end(); )
+    {
+        if(now - it->second.last_seen > worker_timeout)
+        {
+            debug("Worker timed out (%d credits lost)", it->second.credit);
+            it = workers_.erase(it);
+        }
+        else ++it;
+    }
+}
+
+WorkQueueWorker::WorkQueueWorker(Node *node, const std::string &queue_name, CallbackRaw callback, bool managed, bool notify_graph)
+    : Socket(node, ZMQ_DEALER, queue_name, managed),
+      notify_graph_(notify_graph),
+      callback_(callback)
+{
+}
+
+WorkQueueWorker::WorkQueueWorker(Node *node, const std::string &queue_name, CallbackParts callback, bool managed, bool notify_graph)
+    : Socket(node, ZMQ_DEALER, queue_name, managed),
+      notify_graph_(notify_graph),
+      callback_multipart_(callback)
+{
+}
+
+WorkQueueWorker::~WorkQueueWorker()
+{
+}
+
+void WorkQueueWorker::log(logger::Level level, const std::string &message) const
+{
+    boost::format fmt("WorkQueueWorker(%s): %s");
+    Socket::log(level, (fmt % name_ % message).str());
+}
+
+void WorkQueueWorker::init()
+{
+    if(Global::getInstance().remapServiceName(getNode(), orig_name_, name_))
+        info("Work queue name '%s' remapped to '%s'", orig_name_, name_);
+
+    if(remote_addr_.empty())
+        node_.resolveService(name_, remote_addrs_);
+    else
+        remote_addrs_.assign(1, remote_addr_);
+    for(const std::string &addr : remote_addrs_)
+    {
+        trace("Connecting to %s...", addr);
+        Socket::connect(addr);
+    }
+
+    sendCredit(credit_, true);
+    next_heartbeat_ = std::chrono::steady_clock::now() + heartbeat_period;
+
+    if(notify_graph_)
+        node_.notifyService(name_, true, true);
+}
+
+void WorkQueueWorker::cleanup()
+{
+    for(const std::string &addr : remote_addrs_)
+    {
+        trace("Disconnecting from %s...", addr);
+        Socket::disconnect(addr);
+    }
+
+    if(notify_graph_)
+        node_.notifyService(name_, true, false);
+}
+
+void WorkQueueWorker::spinOnce()
+{
+    if(!hasCallback()) return;
+
+    startSpinBudget();
+    while(spinBudgetLeft() && poll())
+    {
+        busy_ = true;
+        ReadStatus status = tryReadRaw(read_envelope_, &read_error_);
+        if(status != ReadStatus::Ok)
+        {
+            readFailed(status, read_error_);
+        }
+        else
+        {
+            const std::vector<b0::message::MessagePart> &parts = read_envelope_.parts;
+            if(callback_ && !parts.empty())
+                callback_(parts[0].payload);
+            if(callback_multipart_)
+                callback_multipart_(parts);
+            processed_++;
+        }
+        // the job took a credit, even if it could not be read:
+        sendCredit(1, false);
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(now >= next_heartbeat_)
+    {
+        // after a whole period without jobs none is in flight, so the producer can be told
+        // all the credits (which it lost if it restarted)
+        sendCredit(busy_ ? 0 : credit_, !busy_);
+        busy_ = false;
+        next_heartbeat_ = now + heartbeat_period;
+    }
+}
+
+bool WorkQueueWorker::hasCallback() const
+{
+    return callback_ || callback_multipart_;
+}
+
+bool WorkQueueWorker::hasPendingMessages() const
+{
+    return std::chrono::steady_clock::now() >= next_heartbeat_;
+}
+
+std::string WorkQueueWorker::getQueueName()
+{
+    return name_;
+}
+
+void WorkQueueWorker::setCredit(unsigned credit)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setCredit() must be called before init()");
+    if(credit == 0)
+        throw exception::ArgumentError("0", "credit");
+    credit_ = credit;
+}
+
+unsigned WorkQueueWorker::getCredit() const
+{
+    return credit_;
+}
+
+uint64_t WorkQueueWorker::getProcessedCount() const
+{
+    return processed_;
+}
+
+void WorkQueueWorker::setRemoteAddress(const std::string &addr)
+{
+    if(node_.getState() != NodeState::Created)
+        throw exception::Exception("setRemoteAddress() must be called before init()");
+    remote_addr_ = addr;
+}
+
+void WorkQueueWorker::sendCredit(unsigned credit, bool absolute)
+{
+    b0::message::MessageEnvelope env;
+    env.header0 = name_;
+    env.headers[absolute ? "Credit-total" : "Credit"] = std::to_string(credit);
+    writeRaw(env);
+}
+
+} // namespace b0
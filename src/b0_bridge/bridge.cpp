@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <zmq.h>
+
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/exceptions.h>
+
+/*
+ * Links two sites, each running its own resolver, over one connection:
+ *
+ *   site A: b0_bridge send --link tcp://site-b:24000 -t topic1 -t topic2 ...
+ *   site B: b0_bridge receive --link tcp://*:24000
+ *
+ * The sending side subscribes to the topics on its resolver, and sends their messages
+ * (the serialized envelopes, as they are) in compressed batches. The receiving side
+ * republishes them on its resolver, with the same topic names. A topic must not be
+ * bridged in both directions.
+ */
+
+//! The connection between the two sides: a PUSH socket connected to a bound PULL socket
+class Link : public b0::Socket
+{
+public:
+    Link(b0::Node *node, int type, const std::string &addr)
+        : Socket(node, type, "b0_bridge.link", false),
+          addr_(addr)
+    {
+        // (the batches are never dropped by the socket: the sender checks it can write first)
+        setWriteTimeout(-1);
+    }
+
+    void init() override
+    {
+        if(getSocketType() == ZMQ_PULL)
+            bind(addr_);
+        else
+            connect(addr_);
+    }
+
+    void cleanup() override
+    {
+        if(getSocketType() == ZMQ_PULL)
+            unbind(addr_);
+        else
+            disconnect(addr_);
+    }
+
+    //! Return true if a batch can be written without blocking
+    bool writable() const
+    {
+        return getEvents() & ZMQ_POLLOUT;
+    }
+
+private:
+    int getSocketType() const
+    {
+        return getIntOption(ZMQ_TYPE);
+    }
+
+    std::string addr_;
+};
+
+//! A token bucket, for the rate and bandwidth caps (a rate of 0 means no cap)
+struct Bucket
+{
+    double rate{0};
+    double tokens{0};
+    int64_t last_usec{0};
+
+    void setRate(double r)
+    {
+        rate = r;
+        tokens = r;
+    }
+
+    //! Return true if the cap allows more now (the tokens may go negative, e.g. after a large message)
+    bool available(int64_t now_usec)
+    {
+        if(rate <= 0) return true;
+        // bursts of up to one second worth of tokens
+        tokens = std::min(rate, tokens + rate * (now_usec - last_usec) / 1e6);
+        last_usec = now_usec;
+        return tokens > 0;
+    }
+
+    void take(double n)
+    {
+        if(rate > 0) tokens -= n;
+    }
+};
+
+//! The state of a bridged topic, on the sending side
+struct Topic
+{
+    std::unique_ptr<b0::Subscriber> sub;
+    std::deque<std::string> pending;
+    Bucket rate, bandwidth;
+    uint64_t forwarded{0};
+    uint64_t conflated{0};
+};
+
+//! Parse a "topic=value" option
+static std::pair<std::string, double> parseCap(const std::string &arg)
+{
+    size_t eq = arg.rfind('=');
+    if(eq == std::string::npos || eq == 0)
+        throw b0::exception::ArgumentError(arg, "topic=value");
+    try
+    {
+        double value = std::stod(arg.substr(eq + 1));
+        if(value < 0) throw std::invalid_argument(arg);
+        return std::make_pair(arg.substr(0, eq), value);
+    }
+    catch(std::logic_error &)
+    {
+        throw b0::exception::ArgumentError(arg, "topic=value");
+    }
+}
+
+static void appendRecord(std::string &batch, const std::string &wire)
+{
+    uint32_t size = uint32_t(wire.size());
+    char header[4];
+    for(int i = 0; i < 4; i++)
+        header[i] = char((size >> (8 * i)) & 0xff);
+    batch.append(header, 4);
+    batch.append(wire);
+}
+
+//! The options of the sending side
+struct SendOptions
+{
+    std::vector<std::string> topic_names, rates, bandwidths;
+    double link_bandwidth{0};
+    int batch_bytes{65536}, batch_delay_ms{5}, queue_limit{100};
+    std::string compression;
+    int compression_level{3};
+};
+
+static int send(b0::Node &node, const std::string &link_addr, const SendOptions &opts)
+{
+    const std::vector<std::string> &topic_names = opts.topic_names;
+    const int batch_bytes = opts.batch_bytes, batch_delay_ms = opts.batch_delay_ms, queue_limit = opts.queue_limit;
+
+    if(topic_names.empty())
+        throw b0::exception::ArgumentError("", "topic-name");
+
+    std::map<std::string, Topic> topics;
+    for(auto &name : topic_names)
+        topics[name].sub.reset(new b0::Subscriber(&node, name));
+    for(auto &arg : opts.rates)
+    {
+        auto cap = parseCap(arg);
+        if(!topics.count(cap.first))
+            throw b0::exception::ArgumentError(arg, "topic-rate");
+        topics[cap.first].rate.setRate(cap.second);
+    }
+    for(auto &arg : opts.bandwidths)
+    {
+        auto cap = parseCap(arg);
+        if(!topics.count(cap.first))
+            throw b0::exception::ArgumentError(arg, "topic-bandwidth");
+        topics[cap.first].bandwidth.setRate(cap.second);
+    }
+    Bucket link_bucket;
+    link_bucket.setRate(opts.link_bandwidth);
+
+    Link link(&node, ZMQ_PUSH, link_addr);
+    if(!opts.compression.empty())
+        link.setCompression(opts.compression, opts.compression_level);
+    node.init();
+    link.init();
+
+    std::shared_ptr<const void> buffer;
+    std::string batch;
+    int64_t batch_start = 0;
+    uint64_t batches = 0, link_bytes = 0;
+    auto flush = [&]()
+    {
+        if(batch.empty()) return;
+        size_t size = batch.size();
+        link.writeRaw(std::move(batch), "b0_bridge.batch");
+        link_bucket.take(double(link.getCounters().bytes_sent.load() - link_bytes));
+        link_bytes = link.getCounters().bytes_sent.load();
+        node.log(b0::logger::Level::trace, (boost::format("Sent a batch of %d bytes") % size).str());
+        batch.clear();
+        batches++;
+    };
+
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+
+        // read all that arrived:
+        bool idle = true;
+        for(auto &t : topics)
+        {
+            b0::Subscriber &sub = *t.second.sub;
+            while(sub.poll())
+            {
+                boost::string_ref wire = sub.readWire(buffer);
+                t.second.pending.emplace_back(wire.data(), wire.size());
+                if(t.second.pending.size() > size_t(queue_limit))
+                {
+                    t.second.pending.pop_front();
+                    t.second.conflated++;
+                }
+                idle = false;
+            }
+        }
+
+        // batch what the caps allow, one message of each topic in turn:
+        int64_t now = node.hardwareTimeUSec();
+        bool saturated = !link.writable() || !link_bucket.available(now);
+        bool more = !saturated;
+        while(more)
+        {
+            more = false;
+            for(auto &t : topics)
+            {
+                Topic &topic = t.second;
+                if(topic.pending.empty() || !topic.rate.available(now) || !topic.bandwidth.available(now))
+                    continue;
+                if(batch.empty())
+                    batch_start = now;
+                appendRecord(batch, topic.pending.front());
+                topic.rate.take(1);
+                topic.bandwidth.take(double(topic.pending.front().size()));
+                topic.pending.pop_front();
+                topic.forwarded++;
+                if(batch.size() >= size_t(batch_bytes))
+                {
+                    flush();
+                    if(!link.writable() || !link_bucket.available(now))
+                    {
+                        saturated = true;
+                        break;
+                    }
+                }
+                more = true;
+            }
+            if(saturated) break;
+        }
+        if(!batch.empty() && !saturated && now - batch_start >= batch_delay_ms * 1000)
+            flush();
+
+        // what could not be sent collapses to the newest message of each topic:
+        for(auto &t : topics)
+        {
+            Topic &topic = t.second;
+            while(topic.pending.size() > 1)
+            {
+                topic.pending.pop_front();
+                topic.conflated++;
+            }
+        }
+
+        if(idle)
+            node.responsiveSleepUSec(std::min(1000, batch_delay_ms * 1000));
+    }
+    flush();
+
+    for(auto &t : topics)
+        std::cerr << boost::format("%s: %d forwarded, %d conflated") % t.first % t.second.forwarded % t.second.conflated << std::endl;
+    std::cerr << boost::format("%d batches, %d bytes sent") % batches % link.getCounters().bytes_sent.load() << std::endl;
+
+    link.cleanup();
+    node.cleanup();
+    return 0;
+}
+
+static int receive(b0::Node &node, const std::string &link_addr)
+{
+    Link link(&node, ZMQ_PULL, link_addr);
+    node.init();
+    link.init();
+
+    // the publishers are created as the topics arrive, so they are not managed by the node
+    std::map<std::string, std::unique_ptr<b0::Publisher>> pubs;
+    uint64_t received = 0, malformed = 0;
+    std::string batch, type;
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        if(!link.poll(100)) continue;
+        while(link.poll())
+        {
+            link.readRaw(batch, type);
+            size_t pos = 0;
+            while(pos + 4 <= batch.size())
+            {
+                uint32_t size = 0;
+                for(int i = 0; i < 4; i++)
+                    size |= uint32_t(static_cast<unsigned char>(batch[pos + i])) << (8 * i);
+                pos += 4;
+                const char *wire = batch.data() + pos;
+                const char *eol = size <= batch.size() - pos ? static_cast<const char*>(std::memchr(wire, '\n', size)) : nullptr;
+                if(!eol)
+                {
+                    malformed++;
+                    break;
+                }
+                pos += size;
+                std::string topic(wire, eol);
+                std::unique_ptr<b0::Publisher> &pub = pubs[topic];
+                if(!pub)
+                {
+                    pub.reset(new b0::Publisher(&node, topic, false));
+                    pub->init();
+                    node.log(b0::logger::Level::info, "Bridging topic " + topic);
+                }
+                pub->writeWire(wire, size);
+                received++;
+            }
+        }
+    }
+    std::cerr << boost::format("%d messages republished on %d topics (%d malformed batches)") % received % pubs.size() % malformed << std::endl;
+
+    for(auto &p : pubs)
+        p.second->cleanup();
+    link.cleanup();
+    node.cleanup();
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::string mode, node_name = "b0_bridge", link_addr, resolver;
+    SendOptions opts;
+    b0::addOptionString("mode", "send (subscribe to the topics and send them) or receive (republish them)", &mode, true);
+    b0::addOptionString("node-name,n", "name of node", &node_name);
+    b0::addOptionString("link,l", "address of the link: the receiving side binds it, the sending side connects to it", &link_addr, true);
+    b0::addOptionString("resolver,r", "address of the resolver of this site (default: B0_RESOLVER)", &resolver);
+    b0::addOptionStringVector("topic-name,t", "(send) topic to bridge (can be repeated)", &opts.topic_names);
+    b0::addOptionStringVector("topic-rate", "(send) cap of a topic, in messages per second, as topic=rate (can be repeated)", &opts.rates);
+    b0::addOptionStringVector("topic-bandwidth", "(send) cap of a topic, in bytes per second (before compression), as topic=bytes (can be repeated)", &opts.bandwidths);
+    b0::addOptionDouble("link-bandwidth", "(send) cap of the link, in bytes per second (after compression, 0 = no cap)", &opts.link_bandwidth, false, 0);
+    b0::addOptionInt("batch-bytes", "(send) size of the batches of messages sent at once", &opts.batch_bytes, false, 65536);
+    b0::addOptionInt("batch-delay", "(send) maximum time a message waits for its batch to fill, in milliseconds", &opts.batch_delay_ms, false, 5);
+    b0::addOptionInt("queue-limit", "(send) maximum number of messages of a topic waiting to be sent", &opts.queue_limit, false, 100);
+    b0::addOptionString("compression", "(send) compression algorithm of the batches (empty for none)", &opts.compression, false, "zstd");
+    b0::addOptionInt("compression-level", "(send) compression level", &opts.compression_level, false, 3);
+    b0::setPositionalOption("mode");
+    b0::init(argc, argv);
+
+    if(opts.batch_bytes < 1)
+        throw b0::exception::ArgumentError(std::to_string(opts.batch_bytes), "batch-bytes");
+    if(opts.batch_delay_ms < 0)
+        throw b0::exception::ArgumentError(std::to_string(opts.batch_delay_ms), "batch-delay");
+    if(opts.queue_limit < 1)
+        throw b0::exception::ArgumentError(std::to_string(opts.queue_limit), "queue-limit");
+
+    b0::Node node(node_name);
+    if(!resolver.empty())
+        node.setResolverAddress(resolver);
+    if(mode == "send")
+        return send(node, link_addr, opts);
+    if(mode == "receive")
+        return receive(node, link_addr);
+    throw b0::exception::ArgumentError(mode, "mode");
+}
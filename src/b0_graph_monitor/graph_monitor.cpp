@@ -3,6 +3,7 @@
 #include <b0/node.h>
 #include <b0/subscriber.h>
 #include <b0/resolver/client.h>
+#include <b0/utils/graph_tracker.h>
 #include <b0/utils/graphviz.h>
 #include <b0/utils/env.h>
 #ifdef HAVE_BOOST_PROCESS
@@ -18,10 +19,12 @@ namespace graph
 class Console : public b0::Node
 {
 public:
-    Console()
+    Console(double stats_interval, double min_redraw_interval)
         : Node("graph_monitor"),
           resolv_cli_(this),
-          sub_(this, "graph", &Console::onGraphChanged, this)
+          sub_(this, "graph_delta", &Console::onGraphChanged, this),
+          stats_interval_(int64_t(stats_interval * 1000000)),
+          min_redraw_interval_(int64_t(min_redraw_interval * 1000000))
     {
     }
 
@@ -33,38 +36,55 @@ public:
     {
         Node::init();
 
-        init_time_ = hardwareTimeUSec();
-
         resolv_cli_.init();
+
+        requestGraph();
+        redraw("Current graph");
     }
 
     void spinOnce() override
     {
         Node::spinOnce();
 
-        if(!graph_received_ && (hardwareTimeUSec() - init_time_) > 2000000)
+        // the stats of the nodes are not in the deltas: they come with a whole graph
+        if(stats_interval_ > 0 && hardwareTimeUSec() - last_request_ >= stats_interval_)
         {
-            // if a graph has not been received within first few seconds
-            // manually request it via resolv service:
-            info("Requesting graph");
+            requestGraph();
+            if(pending_.empty()) pending_ = "Node stats";
+        }
 
-            b0::message::graph::Graph graph;
-            resolv_cli_.getGraph(graph);
-            printOrDisplayGraph("Current graph", graph);
+        // the changes coming in a burst (e.g. many nodes starting) are drawn once:
+        if(!pending_.empty() && hardwareTimeUSec() - last_redraw_ >= min_redraw_interval_)
+            redraw(pending_);
+    }
 
-            graph_received_ = true;
-        }
+    void redraw(const std::string &message)
+    {
+        printOrDisplayGraph(message, tracker_.graph());
+        pending_.clear();
+        last_redraw_ = hardwareTimeUSec();
     }
 
-    void onGraphChanged(const b0::message::graph::Graph &graph)
+    void requestGraph()
     {
-        printOrDisplayGraph("Graph has changed", graph);
+        info("Requesting graph");
+
+        b0::message::graph::Graph graph;
+        resolv_cli_.getGraph(graph);
+        tracker_.reset(graph);
+        last_request_ = hardwareTimeUSec();
     }
 
-    void printOrDisplayGraph(std::string message, const b0::message::graph::Graph &graph)
+    void onGraphChanged(const b0::message::graph::GraphDelta &delta)
     {
-        graph_received_ = true;
+        // the changes are applied to the local copy, which is requested whole only if some were missed
+        if(!tracker_.apply(delta))
+            requestGraph();
+        pending_ = "Graph has changed";
+    }
 
+    void printOrDisplayGraph(std::string message, const b0::message::graph::Graph &graph)
+    {
         if(termHasImageCapability())
         {
             info(message);
@@ -73,6 +93,13 @@ public:
         else
         {
             info("%s: %d nodes", message, graph.nodes.size());
+            for(auto &node : graph.nodes)
+            {
+                if(!node.stats) continue;
+                info("  %s: cpu %.1f%%, rss %.1fMB, tx %.1f/s, rx %.1f/s, %d overruns", node.node_name,
+                        node.stats->cpu_usage * 100, node.stats->rss / 1048576.0,
+                        node.stats->messages_sent_rate, node.stats->messages_received_rate, node.stats->spin_overruns);
+            }
         }
     }
 
@@ -83,9 +110,16 @@ public:
         outputOpts.setTopicColor("cyan");
         outputOpts.setServiceColor("red");
         outputOpts.setClusterHosts(b0::hasOption("cluster"));
+        GraphvizRenderOptions renderOpts;
+        // the clusters need a full layout by dot; otherwise only the changed part is laid out again:
+        if(!b0::hasOption("cluster"))
+        {
+            layout_.update(graph);
+            outputOpts.setLayout(&layout_);
+            renderOpts.setPinned(true);
+        }
         toGraphviz(graph, "graph.gv", outputOpts);
 
-        GraphvizRenderOptions renderOpts;
         if(renderGraphviz("graph.gv", "graph.png", renderOpts) == 0)
         {
             displayInlineImage("graph.png");
@@ -118,8 +152,23 @@ public:
 protected:
     b0::resolver::Client resolv_cli_;
     b0::Subscriber sub_;
-    int64_t init_time_;
-    bool graph_received_{false};
+    b0::graph::GraphTracker tracker_;
+    b0::graph::GraphLayout layout_;
+
+    //! Microseconds between the requests of the whole graph, to refresh the node stats (0 = never)
+    int64_t stats_interval_;
+
+    //! Time of the last request of the whole graph
+    int64_t last_request_{0};
+
+    //! Minimum microseconds between two redraws
+    int64_t min_redraw_interval_;
+
+    //! Time of the last redraw
+    int64_t last_redraw_{0};
+
+    //! Message of the redraw to do, if the graph changed since the last one
+    std::string pending_;
 };
 
 } // namespace graph
@@ -128,9 +177,12 @@ protected:
 
 int main(int argc, char **argv)
 {
-    b0::addOption("cluster,c", "Group (cluster) nodes by host");
+    double stats_interval = 0, min_redraw_interval = 1;
+    b0::addOption("cluster,c", "Group (cluster) nodes by host (laying out the whole graph at each redraw)");
+    b0::addOptionDouble("stats-interval,s", "refresh the resource usage of the nodes (see B0_HEARTBEAT_STATS) every this many seconds (0 = only when the graph changes)", &stats_interval, false, 0);
+    b0::addOptionDouble("min-redraw-interval,r", "redraw the graph at most once every this many seconds", &min_redraw_interval, false, 1);
     b0::init(argc, argv);
-    b0::graph::Console console;
+    b0::graph::Console console(stats_interval, min_redraw_interval);
     console.init();
     console.spin();
     console.cleanup();
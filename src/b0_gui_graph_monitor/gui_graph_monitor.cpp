@@ -1,72 +1,256 @@
 #include <b0/node.h>
 #include <b0/subscriber.h>
 #include <b0/message/graph/graph.h>
-#include <b0/utils/graphviz.h>
+#include <b0/utils/graph_tracker.h>
+#include <b0/utils/graph_layout.h>
+
+#include <cmath>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+#include <boost/format.hpp>
 
 #include <QApplication>
 #include <QMainWindow>
-#include <QScrollArea>
-#include <QLabel>
+#include <QGraphicsScene>
+#include <QGraphicsView>
+#include <QGraphicsEllipseItem>
+#include <QGraphicsPathItem>
+#include <QGraphicsPolygonItem>
+#include <QGraphicsRectItem>
+#include <QGraphicsSimpleTextItem>
+#include <QPainterPath>
 #include <QTimer>
 
+using Kind = b0::graph::LayoutVertex::Kind;
+
 class GraphConsoleWindow : public QMainWindow
 {
 public:
-    GraphConsoleWindow(b0::Node &node)
+    GraphConsoleWindow(b0::Node &node, double min_redraw_interval)
         : QMainWindow(),
           node_(node)
     {
         setWindowTitle("BlueZero graph console");
 
-        imageWidget = new QLabel;
-        imageWidget->setBackgroundRole(QPalette::Base);
-        imageWidget->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
-        imageWidget->setScaledContents(true);
+        scene_ = new QGraphicsScene(this);
+        view_ = new QGraphicsView(scene_);
+        view_->setRenderHint(QPainter::Antialiasing);
+        view_->setDragMode(QGraphicsView::ScrollHandDrag);
+        // (with hundreds of items moving, the index costs more than it saves)
+        scene_->setItemIndexMethod(QGraphicsScene::NoIndex);
 
-        scrollArea = new QScrollArea;
-        scrollArea->setBackgroundRole(QPalette::Dark);
-        scrollArea->setWidget(imageWidget);
-
-        setCentralWidget(scrollArea);
+        setCentralWidget(view_);
 
         QTimer *timer = new QTimer(this);
         connect(timer, &QTimer::timeout, [this](){this->node_.spinOnce();});
         timer->start(100);
+
+        // the deltas only mark the graph as changed: it is redrawn at most at this rate
+        QTimer *redraw_timer = new QTimer(this);
+        connect(redraw_timer, &QTimer::timeout, [this](){if(this->dirty_) this->render();});
+        redraw_timer->start(int(min_redraw_interval * 1000));
+
+        // the stats of the nodes are not in the deltas: they come with a whole graph
+        QTimer *stats_timer = new QTimer(this);
+        connect(stats_timer, &QTimer::timeout, [this](){if(this->requestGraph()) this->updateLabels();});
+        stats_timer->start(5000);
     }
 
-    void onGraphChanged(const b0::message::graph::Graph &graph)
+    //! Request the whole graph; return true if it has some node stats
+    bool requestGraph()
     {
-        b0::graph::toGraphviz(graph, "graph.gv");
+        b0::message::graph::Graph graph;
+        node_.getGraph(graph);
+        tracker_.reset(graph);
+        dirty_ = true;
+        for(auto &node : graph.nodes)
+            if(node.stats) return true;
+        return false;
+    }
 
-        if(b0::graph::renderGraphviz("graph.gv", "graph.png") == 0)
+    void onGraphChanged(const b0::message::graph::GraphDelta &delta)
+    {
+        // only if some changes were missed the whole graph is requested
+        if(!tracker_.apply(delta))
+            requestGraph();
+        dirty_ = true;
+    }
+
+    //! Update the items of the vertices and edges changed since the last time
+    void render()
+    {
+        dirty_ = false;
+        if(!layout_.update(tracker_.graph())) return;
+
+        for(auto &id : layout_.removed())
+        {
+            auto it = vertex_items_.find(id);
+            if(it == vertex_items_.end()) continue;
+            delete it->second;
+            vertex_items_.erase(it);
+        }
+        for(auto &id : layout_.changed())
+        {
+            const b0::graph::LayoutVertex &v = layout_.vertices().at(id);
+            QAbstractGraphicsShapeItem *&item = vertex_items_[id];
+            if(!item) item = createVertexItem(v);
+            item->setPos(v.x, v.y);
+        }
+
+        // the edges of the vertices which moved, and the new ones:
+        for(auto it = edge_items_.begin(); it != edge_items_.end(); )
+        {
+            if(layout_.edges().count(it->first))
+            {
+                ++it;
+                continue;
+            }
+            delete it->second;
+            it = edge_items_.erase(it);
+        }
+        for(auto &e : layout_.edges())
         {
-            QPixmap img("graph.png");
-            imageWidget->setPixmap(img);
-            imageWidget->adjustSize();
+            auto it = edge_items_.find(e);
+            if(it != edge_items_.end() && !layout_.changed().count(e.first) && !layout_.changed().count(e.second)) continue;
+            QGraphicsPathItem *&item = edge_items_[e];
+            if(!item)
+            {
+                item = scene_->addPath(QPainterPath());
+                item->setZValue(-1);
+            }
+            item->setPath(edgePath(layout_.vertices().at(e.first), layout_.vertices().at(e.second)));
+        }
+
+        updateLabels();
+        scene_->setSceneRect(scene_->itemsBoundingRect().adjusted(-50, -50, 50, 50));
+    }
+
+    //! Set the labels (and the colors) of the nodes from their stats
+    void updateLabels()
+    {
+        for(auto &node : tracker_.graph().nodes)
+        {
+            auto it = vertex_items_.find(b0::graph::GraphLayout::vertexId(Kind::Node, node.node_name));
+            if(it == vertex_items_.end()) continue;
+            bool hot = node.stats && node.stats->cpu_usage >= 0.8;
+            QColor color = hot ? QColor(255, 165, 0) : QColor(Qt::black);
+            it->second->setPen(QPen(color));
+            for(auto child : it->second->childItems())
+            {
+                QGraphicsSimpleTextItem *text = static_cast<QGraphicsSimpleTextItem*>(child);
+                text->setText(QString::fromStdString(nodeLabel(node)));
+                text->setBrush(color);
+                fitToText(it->second, text);
+            }
         }
     }
 
 private:
+    static std::string nodeLabel(const b0::message::graph::GraphNode &node)
+    {
+        if(!node.stats) return node.node_name;
+        const b0::message::graph::NodeStats &s = *node.stats;
+        return (boost::format("%s\ncpu %.0f%% rss %.1fM\ntx %.0f/s rx %.0f/s")
+                % node.node_name % (s.cpu_usage * 100) % (s.rss / 1048576.0)
+                % s.messages_sent_rate % s.messages_received_rate).str();
+    }
+
+    QAbstractGraphicsShapeItem * createVertexItem(const b0::graph::LayoutVertex &v)
+    {
+        QAbstractGraphicsShapeItem *item;
+        QColor color;
+        switch(v.kind)
+        {
+        case Kind::Node:
+            item = new QGraphicsRectItem;
+            color = Qt::black;
+            break;
+        case Kind::Topic:
+            item = new QGraphicsEllipseItem;
+            color = Qt::blue;
+            break;
+        case Kind::Service:
+        default:
+            item = new QGraphicsPolygonItem;
+            color = Qt::red;
+            break;
+        }
+        item->setPen(QPen(color));
+        item->setBrush(Qt::white);
+        item->setToolTip(QString::fromStdString(v.host.empty() ? v.name : v.name + " (" + v.host + ")"));
+        QGraphicsSimpleTextItem *text = new QGraphicsSimpleTextItem(QString::fromStdString(v.name), item);
+        text->setBrush(color);
+        fitToText(item, text);
+        scene_->addItem(item);
+        return item;
+    }
+
+    //! Center the label on the vertex, and size the shape around it
+    static void fitToText(QAbstractGraphicsShapeItem *item, QGraphicsSimpleTextItem *text)
+    {
+        QRectF r = text->boundingRect();
+        text->setPos(-r.width() / 2, -r.height() / 2);
+        QRectF b = r.translated(-r.width() / 2, -r.height() / 2).adjusted(-8, -4, 8, 4);
+        if(auto rect = dynamic_cast<QGraphicsRectItem*>(item))
+            rect->setRect(b);
+        else if(auto ellipse = dynamic_cast<QGraphicsEllipseItem*>(item))
+            ellipse->setRect(b.adjusted(-6, -3, 6, 3));
+        else if(auto polygon = dynamic_cast<QGraphicsPolygonItem*>(item))
+            polygon->setPolygon(QPolygonF() << QPointF(b.left() - 10, 0) << QPointF(0, b.top() - 8)
+                    << QPointF(b.right() + 10, 0) << QPointF(0, b.bottom() + 8));
+    }
+
+    //! A line from a vertex to the other, with an arrow in the middle
+    static QPainterPath edgePath(const b0::graph::LayoutVertex &from, const b0::graph::LayoutVertex &to)
+    {
+        QPainterPath path(QPointF(from.x, from.y));
+        path.lineTo(to.x, to.y);
+        double dx = to.x - from.x, dy = to.y - from.y, d = std::sqrt(dx * dx + dy * dy);
+        if(d < 1) return path;
+        dx /= d;
+        dy /= d;
+        QPointF tip((from.x + to.x) / 2 + dx * 5, (from.y + to.y) / 2 + dy * 5);
+        path.moveTo(tip);
+        path.lineTo(tip.x() - dx * 10 - dy * 5, tip.y() - dy * 10 + dx * 5);
+        path.moveTo(tip);
+        path.lineTo(tip.x() - dx * 10 + dy * 5, tip.y() - dy * 10 - dx * 5);
+        return path;
+    }
+
     b0::Node &node_;
-    QScrollArea *scrollArea;
-    QLabel *imageWidget;
+    b0::graph::GraphTracker tracker_;
+    b0::graph::GraphLayout layout_;
+    QGraphicsScene *scene_;
+    QGraphicsView *view_;
+    std::map<std::string, QAbstractGraphicsShapeItem*> vertex_items_;
+    std::map<std::pair<std::string, std::string>, QGraphicsPathItem*> edge_items_;
+
+    //! The graph changed since the last render()
+    bool dirty_{false};
 };
 
 int main(int argc, char **argv)
 {
+    double min_redraw_interval = 0.5;
+    b0::addOptionDouble("min-redraw-interval,r", "redraw the graph at most once every this many seconds", &min_redraw_interval, false, 0.5);
     b0::init(argc, argv);
 
     QApplication app(argc, argv);
 
     b0::Node graphConsoleNode("gui_graph_monitor");
 
-    GraphConsoleWindow graphConsoleWindow(graphConsoleNode);
+    GraphConsoleWindow graphConsoleWindow(graphConsoleNode, min_redraw_interval);
 
-    b0::Subscriber logSub(&graphConsoleNode, "graph", &GraphConsoleWindow::onGraphChanged, &graphConsoleWindow);
+    b0::Subscriber logSub(&graphConsoleNode, "graph_delta", &GraphConsoleWindow::onGraphChanged, &graphConsoleWindow);
 
     graphConsoleNode.init();
 
-    graphConsoleWindow.resize(800, 340);
+    graphConsoleWindow.requestGraph();
+
+    graphConsoleWindow.resize(1000, 700);
     graphConsoleWindow.show();
 
     int ret = app.exec();
@@ -1,32 +1,297 @@
+#include <algorithm>
+#include <array>
+#include <deque>
 #include <iostream>
+#include <map>
 #include <string>
 #include <vector>
 
 #include <b0/node.h>
 #include <b0/subscriber.h>
+#include <b0/logger/logger.h>
 #include <b0/message/log/log_entry.h>
+#include <b0/message/log/log_entry_batch.h>
 
 #include <QRegExp>
 #include <QApplication>
 #include <QMainWindow>
 #include <QWidget>
-#include <QTableWidget>
+#include <QTableView>
+#include <QAbstractTableModel>
+#include <QItemSelectionModel>
 #include <QComboBox>
 #include <QLabel>
 #include <QLineEdit>
 #include <QHeaderView>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
+#include <QScrollBar>
 #include <QTimer>
 #include <QAction>
 #include <QClipboard>
 
+//! Number of log levels (see b0::logger::Level)
+static const size_t num_levels = 6;
+
+static size_t levelIndex(b0::logger::Level level)
+{
+    return std::min<size_t>(static_cast<int>(level) / 10, num_levels - 1);
+}
+
+/*!
+ * The entries shown: a level and above, and the nodes whose name contains one of some words
+ */
+struct LogFilter
+{
+    b0::logger::Level min_level = b0::logger::Level::trace;
+    std::vector<std::string> node_words;
+
+    bool selectsNode(const std::string &node_name) const
+    {
+        if(node_words.empty()) return true;
+        for(auto &word : node_words)
+            if(node_name.find(word) != std::string::npos) return true;
+        return false;
+    }
+};
+
+/*!
+ * The last entries received, in a ring buffer, indexed by node and level
+ *
+ * Each entry gets a sequence number, from 0; the entries from firstSeq() to endSeq() are
+ * stored, the older ones are evicted.
+ */
+class LogStore
+{
+public:
+    struct Entry
+    {
+        int64_t receive_time;
+        b0::logger::Level level;
+        //! Index of the name of the node (see nodeName())
+        uint32_t node;
+        std::string message;
+    };
+
+    explicit LogStore(size_t capacity)
+        : capacity_(std::max<size_t>(1, capacity))
+    {
+        ring_.reserve(capacity_);
+    }
+
+    size_t capacity() const
+    {
+        return capacity_;
+    }
+
+    uint64_t firstSeq() const
+    {
+        return end_seq_ - ring_.size();
+    }
+
+    uint64_t endSeq() const
+    {
+        return end_seq_;
+    }
+
+    const Entry & at(uint64_t seq) const
+    {
+        return ring_[seq % capacity_];
+    }
+
+    const std::string & nodeName(uint32_t node) const
+    {
+        return node_names_[node];
+    }
+
+    size_t nodeCount() const
+    {
+        return node_names_.size();
+    }
+
+    //! Add an entry, evicting the oldest one if full, and return its sequence number
+    uint64_t add(const b0::message::log::LogEntry &entry, int64_t receive_time)
+    {
+        auto it = node_ids_.find(entry.node_name);
+        if(it == node_ids_.end())
+        {
+            it = node_ids_.emplace(entry.node_name, static_cast<uint32_t>(node_names_.size())).first;
+            node_names_.push_back(entry.node_name);
+            index_.emplace_back();
+        }
+
+        Entry e{receive_time, b0::logger::levelInfo(entry.level).level, it->second, entry.message};
+        uint64_t seq = end_seq_++;
+        if(ring_.size() < capacity_)
+        {
+            ring_.push_back(std::move(e));
+        }
+        else
+        {
+            // the oldest entry is the first of its node and level:
+            Entry &old = ring_[seq % capacity_];
+            index_[old.node][levelIndex(old.level)].pop_front();
+            old = std::move(e);
+        }
+        index_[it->second][levelIndex(ring_[seq % capacity_].level)].push_back(seq);
+        return seq;
+    }
+
+    //! Return the sequence numbers of the entries selected by filter, in order
+    void select(const LogFilter &filter, std::deque<uint64_t> &seqs) const
+    {
+        // only the index of the nodes and levels selected is visited:
+        std::vector<uint64_t> selected;
+        for(size_t node = 0; node < node_names_.size(); node++)
+        {
+            if(!filter.selectsNode(node_names_[node])) continue;
+            for(size_t level = levelIndex(filter.min_level); level < num_levels; level++)
+                selected.insert(selected.end(), index_[node][level].begin(), index_[node][level].end());
+        }
+        std::sort(selected.begin(), selected.end());
+        seqs.assign(selected.begin(), selected.end());
+    }
+
+private:
+    size_t capacity_;
+    std::vector<Entry> ring_;
+    uint64_t end_seq_ = 0;
+    std::vector<std::string> node_names_;
+    std::map<std::string, uint32_t> node_ids_;
+    //! Sequence numbers of the stored entries, by node and level
+    std::vector<std::array<std::deque<uint64_t>, num_levels> > index_;
+};
+
+/*!
+ * The entries of a LogStore selected by a LogFilter, as a table
+ *
+ * The entries received are added by update(), in one batch, so that the view is updated
+ * at a fixed rate however many entries arrive.
+ */
+class LogModel : public QAbstractTableModel
+{
+public:
+    LogModel(size_t capacity, QObject *parent = nullptr)
+        : QAbstractTableModel(parent),
+          store_(capacity)
+    {
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : static_cast<int>(rows_.size());
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : 4;
+    }
+
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override
+    {
+        if(role != Qt::DisplayRole || !index.isValid() || size_t(index.row()) >= rows_.size())
+            return QVariant();
+        const LogStore::Entry &e = store_.at(rows_[index.row()]);
+        switch(index.column())
+        {
+        case 0: return QString::number(e.receive_time);
+        case 1: return QString::fromStdString(store_.nodeName(e.node));
+        case 2: return QString::fromStdString(b0::logger::levelInfo(e.level).str);
+        case 3: return QString::fromStdString(e.message);
+        }
+        return QVariant();
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override
+    {
+        static const char *labels[] = {"Time", "Node", "Level", "Message"};
+        if(role != Qt::DisplayRole || orientation != Qt::Horizontal || section < 0 || section >= 4)
+            return QVariant();
+        return QString(labels[section]);
+    }
+
+    //! Queue an entry, added to the table by the next update()
+    void add(const b0::message::log::LogEntry &entry, int64_t receive_time)
+    {
+        pending_.emplace_back(entry, receive_time);
+        // the older ones would be evicted by update() anyway:
+        if(pending_.size() > store_.capacity())
+            pending_.pop_front();
+    }
+
+    //! Add the entries queued, and remove the rows of those evicted
+    void update()
+    {
+        if(pending_.empty()) return;
+
+        std::vector<uint64_t> added;
+        for(auto &p : pending_)
+        {
+            uint64_t seq = store_.add(p.first, p.second);
+            if(filter_.selectsNode(p.first.node_name) && b0::logger::levelInfo(p.first.level).level >= filter_.min_level)
+                added.push_back(seq);
+        }
+        pending_.clear();
+
+        size_t evicted = 0;
+        while(evicted < rows_.size() && rows_[evicted] < store_.firstSeq())
+            evicted++;
+        if(evicted)
+        {
+            beginRemoveRows(QModelIndex(), 0, static_cast<int>(evicted) - 1);
+            rows_.erase(rows_.begin(), rows_.begin() + evicted);
+            endRemoveRows();
+        }
+        // (the entries added and already evicted are not shown)
+        added.erase(added.begin(), std::lower_bound(added.begin(), added.end(), store_.firstSeq()));
+        if(!added.empty())
+        {
+            beginInsertRows(QModelIndex(), static_cast<int>(rows_.size()), static_cast<int>(rows_.size() + added.size()) - 1);
+            rows_.insert(rows_.end(), added.begin(), added.end());
+            endInsertRows();
+        }
+    }
+
+    void setFilter(const LogFilter &filter)
+    {
+        beginResetModel();
+        filter_ = filter;
+        store_.select(filter_, rows_);
+        endResetModel();
+    }
+
+    const LogFilter & filter() const
+    {
+        return filter_;
+    }
+
+    //! Return the text of a row, for the clipboard
+    QString rowText(int row) const
+    {
+        const LogStore::Entry &e = store_.at(rows_[row]);
+        return QString("%1 [%2] %3: %4")
+            .arg(e.receive_time)
+            .arg(QString::fromStdString(store_.nodeName(e.node)))
+            .arg(QString::fromStdString(b0::logger::levelInfo(e.level).str))
+            .arg(QString::fromStdString(e.message));
+    }
+
+private:
+    LogStore store_;
+    LogFilter filter_;
+    //! Sequence numbers of the entries shown
+    std::deque<uint64_t> rows_;
+    //! Entries received since the last update()
+    std::deque<std::pair<b0::message::log::LogEntry, int64_t> > pending_;
+};
+
 class LogConsoleWindow : public QMainWindow
 {
 public:
-    LogConsoleWindow(b0::Node &node)
+    LogConsoleWindow(b0::Node &node, size_t max_entries, int refresh_rate)
         : QMainWindow(),
-          node_(node)
+          node_(node),
+          model_(max_entries)
     {
         setWindowTitle("BlueZero log console");
 
@@ -47,14 +312,20 @@ public:
         {
             QVBoxLayout *layout = new QVBoxLayout;
             layout->addWidget(filterToolBar);
-            tableWidget = new QTableWidget;
-            tableWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
-            tableWidget->setSelectionMode(QAbstractItemView::ContiguousSelection);
-            tableWidget->setContextMenuPolicy(Qt::ActionsContextMenu);
+            tableView = new QTableView;
+            tableView->setModel(&model_);
+            tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+            tableView->setSelectionMode(QAbstractItemView::ContiguousSelection);
+            tableView->setContextMenuPolicy(Qt::ActionsContextMenu);
+            // a fixed row height, so that the view does not measure the rows:
+            tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+            tableView->verticalHeader()->setDefaultSectionSize(tableView->fontMetrics().height() + 4);
+            tableView->verticalHeader()->hide();
+            tableView->horizontalHeader()->setStretchLastSection(true);
             QAction *action1 = new QAction("Copy selected entries", this);
             connect(action1, &QAction::triggered, this, &LogConsoleWindow::copySelectedEntries);
-            tableWidget->insertAction(0, action1);
-            layout->addWidget(tableWidget);
+            tableView->insertAction(0, action1);
+            layout->addWidget(tableView);
             centralWidget->setLayout(layout);
         }
 
@@ -68,35 +339,22 @@ public:
         connect(comboLevel, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &LogConsoleWindow::comboLevelChanged);
         connect(textNode, &QLineEdit::textChanged, this, &LogConsoleWindow::textNodeChanged);
 
-        QStringList labels;
-        labels << "Time" << "Node" << "Level" << "Message";
-        tableWidget->setColumnCount(labels.size());
-        tableWidget->horizontalHeader()->setStretchLastSection(true);
-        tableWidget->verticalHeader()->hide();
-        tableWidget->setHorizontalHeaderLabels(labels);
-
+        // the entries received while spinning are shown at once:
         QTimer *timer = new QTimer(this);
-        connect(timer, &QTimer::timeout, [this](){this->node_.spinOnce();});
-        timer->start(100);
+        connect(timer, &QTimer::timeout, [this](){this->node_.spinOnce(); this->updateEntries();});
+        timer->start(1000 / std::max(1, refresh_rate));
     }
 
     void copySelectedEntries()
     {
-        QModelIndexList selection = tableWidget->selectionModel()->selectedRows();
         QString s;
 
-        foreach(QTableWidgetSelectionRange range, tableWidget->selectedRanges())
+        foreach(QItemSelectionRange range, tableView->selectionModel()->selection())
         {
-            for(int row = range.topRow(); row <= range.bottomRow(); row++)
+            for(int row = range.top(); row <= range.bottom(); row++)
             {
                 if(s.length()) s += "\n";
-                s += tableWidget->item(row, 0)->text();
-                s += " [";
-                s += tableWidget->item(row, 1)->text();
-                s += "] ";
-                s += tableWidget->item(row, 2)->text();
-                s += ": ";
-                s += tableWidget->item(row, 3)->text();
+                s += model_.rowText(row);
             }
         }
 
@@ -104,80 +362,94 @@ public:
         clipboard->setText(s);
     }
 
+    void onLogMessage(const std::string &payload, const std::string &type)
+    {
+        b0::message::log::LogEntryBatch batch;
+        if(type == batch.type())
+        {
+            b0::message::parse(batch, payload, type);
+            for(auto &entry : batch.entries)
+                onLogEntry(entry);
+        }
+        else
+        {
+            b0::message::log::LogEntry entry;
+            b0::message::parse(entry, payload, type);
+            onLogEntry(entry);
+        }
+    }
+
     void onLogEntry(const b0::message::log::LogEntry &entry)
     {
-        all_entries_.push_back(entry);
-        if(!filter(entry))
-            addEntry(entry);
+        model_.add(entry, node_.timeUSec());
     }
 
-    void addEntry(const b0::message::log::LogEntry &entry)
+    void updateEntries()
     {
-        int n = tableWidget->rowCount();
-        tableWidget->setRowCount(n + 1);
-        tableWidget->setItem(n, 0, new QTableWidgetItem(QString::number(node_.timeUSec())));
-        tableWidget->setItem(n, 1, new QTableWidgetItem(QString::fromStdString(entry.node_name)));
-        tableWidget->setItem(n, 2, new QTableWidgetItem(QString::fromStdString(entry.level)));
-        tableWidget->setItem(n, 3, new QTableWidgetItem(QString::fromStdString(entry.message)));
+        // follow the new entries, unless scrolled up:
+        QScrollBar *scrollBar = tableView->verticalScrollBar();
+        bool follow = scrollBar->value() == scrollBar->maximum();
+        model_.update();
+        if(follow)
+            tableView->scrollToBottom();
     }
 
     void comboLevelChanged(int newIndex)
     {
-        filterLevel = b0::logger::levelInfo(comboLevel->currentText().toStdString()).level;
-        refilter();
+        LogFilter filter = model_.filter();
+        filter.min_level = b0::logger::levelInfo(comboLevel->currentText().toStdString()).level;
+        model_.setFilter(filter);
+        resubscribe();
     }
 
     void textNodeChanged(const QString &txt)
     {
         QStringList words = textNode->text().split(QRegExp("\\s+"), QString::SkipEmptyParts);
-        filterNodeNames.clear();
+        LogFilter filter = model_.filter();
+        filter.node_words.clear();
         foreach(QString s, words)
-            filterNodeNames.push_back(s.toStdString());
-        refilter();
+            filter.node_words.push_back(s.toStdString());
+        model_.setFilter(filter);
     }
 
-    bool filter(const b0::message::log::LogEntry &entry)
+    void setSubscriber(b0::Subscriber *sub)
     {
-        if(b0::logger::levelInfo(entry.level).level < filterLevel) return true;
-
-        if(filterNodeNames.empty()) return false;
-        else
-        {
-            for(std::string s : filterNodeNames)
-                if(entry.node_name.find(s) != std::string::npos) return false;
-            return true;
-        }
+        sub_ = sub;
+        resubscribe();
     }
 
-    void refilter()
+    void resubscribe()
     {
-        tableWidget->setRowCount(0);
-        for(b0::message::log::LogEntry &entry : all_entries_)
-            if(!filter(entry))
-                addEntry(entry);
+        // the entries sent to the subtopics of the log (see b0::setHierarchicalLogTopics()) are
+        // selected by the proxy; the node names are matched anywhere in the name, thus by the model:
+        if(sub_)
+            sub_->setSubtopicFilters(b0::logger::logSubtopicFilters(model_.filter().min_level));
     }
 
 private:
     b0::Node &node_;
-    QTableWidget *tableWidget;
+    b0::Subscriber *sub_ = nullptr;
+    LogModel model_;
+    QTableView *tableView;
     QComboBox *comboLevel;
     QLineEdit *textNode;
-    std::vector<b0::message::log::LogEntry> all_entries_;
-    std::vector<std::string> filterNodeNames;
-    b0::logger::Level filterLevel = b0::logger::Level::trace;
 };
 
 int main(int argc, char **argv)
 {
+    int max_entries = 100000, refresh_rate = 10;
+    b0::addOptionInt("max-entries,m", "number of entries kept, the oldest ones being discarded", &max_entries, false, 100000);
+    b0::addOptionInt("refresh-rate,r", "updates of the table per second", &refresh_rate, false, 10);
     b0::init(argc, argv);
 
     QApplication app(argc, argv);
 
     b0::Node logConsoleNode("gui_logger_monitor");
 
-    LogConsoleWindow logConsoleWindow(logConsoleNode);
+    LogConsoleWindow logConsoleWindow(logConsoleNode, std::max(1, max_entries), refresh_rate);
 
-    b0::Subscriber logSub(&logConsoleNode, "log", &LogConsoleWindow::onLogEntry, &logConsoleWindow);
+    b0::Subscriber logSub(&logConsoleNode, "log", &LogConsoleWindow::onLogMessage, &logConsoleWindow);
+    logConsoleWindow.setSubscriber(&logSub);
 
     logConsoleNode.init();
 
@@ -190,4 +462,3 @@ int main(int argc, char **argv)
 
     return ret;
 }
-
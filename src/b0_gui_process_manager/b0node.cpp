@@ -13,7 +13,17 @@ void B0Node::onGraphChanged(const b0::message::graph::Graph &msg)
 
 void B0Node::onActiveNodesChanged(const b0::process_manager::ActiveNodes &msg)
 {
-    Q_EMIT activeNodesChanged(msg);
+    // the HUB sends only the changes between its full snapshots: keep the complete list here
+    if(msg.full) activeNodes_.clear();
+    for(auto &host : msg.left)
+        activeNodes_.erase(host);
+    for(auto &act : msg.nodes)
+        activeNodes_[act.host_name] = act;
+
+    b0::process_manager::ActiveNodes all;
+    for(auto &x : activeNodes_)
+        all.nodes.push_back(x.second);
+    Q_EMIT activeNodesChanged(all);
 }
 
 void B0Node::run()
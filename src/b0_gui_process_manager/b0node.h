@@ -39,7 +39,7 @@ private:
     std::unique_ptr<b0::Subscriber> graph_sub_;
     std::unique_ptr<b0::Subscriber> active_nodes_sub_;
     std::unique_ptr<b0::ServiceClient> pm_cli_;
-    QSet<QString> activeNodes_;
+    std::map<std::string, b0::process_manager::NodeActivity> activeNodes_;
 };
 
 #endif // B0NODE_H__INCLUDED
@@ -0,0 +1,127 @@
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <b0/b0.h>
+#include <b0/exceptions.h>
+#include <b0/bag/bag.h>
+#include <b0/logger/logger.h>
+#include <b0/message/message_envelope.h>
+#include <b0/message/log/log_entry.h>
+#include <b0/message/log/log_entry_batch.h>
+
+//! The entries to print
+struct Filter
+{
+    b0::logger::Level min_level;
+    std::vector<std::string> node_names;
+    std::string text;
+    int64_t start, end;
+
+    //! Return true if the entries of a topic ("log" or one of its subtopics) can pass the filter
+    bool selectsTopic(const std::string &topic) const
+    {
+        if(topic == "log") return true;
+        if(topic.compare(0, 4, "log/") != 0) return false;
+        std::string subtopic = topic.substr(4);
+        for(auto &filter : b0::logger::logSubtopicFilters(min_level, node_names))
+            if(subtopic.compare(0, filter.size(), filter) == 0)
+                return true;
+        return false;
+    }
+
+    bool selects(const b0::message::log::LogEntry &entry) const
+    {
+        if(b0::logger::levelInfo(entry.level).level < min_level) return false;
+        if(!text.empty() && entry.message.find(text) == std::string::npos) return false;
+        if(node_names.empty()) return true;
+        for(auto &node_name : node_names)
+            if(entry.node_name.compare(0, node_name.size(), node_name) == 0) return true;
+        return false;
+    }
+};
+
+void print(const b0::message::log::LogEntry &entry, bool color)
+{
+    const b0::logger::LevelInfo &info = b0::logger::levelInfo(entry.level);
+    std::time_t time = std::time_t(entry.time_usec / 1000000);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", std::localtime(&time));
+    if(color) std::cout << info.ansiEscape();
+    std::cout << stamp << (boost::format(".%06d") % (entry.time_usec % 1000000)) << " [" << entry.node_name << "] " << info.str << ": " << entry.message;
+    if(color) std::cout << info.ansiReset();
+    std::cout << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> input_files;
+    std::string level, text;
+    std::vector<std::string> node_names;
+    double start = 0, end = 0;
+    b0::addOptionStringVector("input,i", "bag file written by b0_logger_monitor --output (can be repeated, in order)", &input_files, true);
+    b0::addOptionString("level,l", "lowest level of the entries printed", &level, false, "trace");
+    b0::addOptionStringVector("node,n", "print only the entries of the nodes whose name starts with this", &node_names);
+    b0::addOptionString("grep,g", "print only the entries whose message contains this", &text);
+    b0::addOptionDouble("start,s", "print only the entries received from this time (seconds since the epoch)", &start, false, 0);
+    b0::addOptionDouble("end,e", "print only the entries received until this time (seconds since the epoch, 0 = no limit)", &end, false, 0);
+    b0::addOption("color,c", "color the entries by level");
+    b0::setPositionalOption("input", -1);
+    b0::init(argc, argv);
+
+    Filter filter{b0::logger::levelInfo(level).level, node_names, text, int64_t(start * 1000000), end > 0 ? int64_t(end * 1000000) : INT64_MAX};
+    bool color = b0::hasOption("color");
+
+    b0::message::MessageEnvelope env;
+    b0::message::log::LogEntry entry;
+    b0::message::log::LogEntryBatch batch;
+    uint64_t count = 0;
+    for(auto &input_file : input_files)
+    {
+        b0::bag::Reader reader(input_file);
+        if(!reader.isIndexed())
+            std::cerr << "Warning: " << input_file << " has no index (still being written?)" << std::endl;
+
+        // the chunks of the other levels and nodes are skipped, when logged to subtopics:
+        std::set<std::string> topics;
+        for(auto &topic : reader.getTopics())
+            if(filter.selectsTopic(topic.first))
+                topics.insert(topic.first);
+        if(topics.empty()) continue;
+        reader.setTopics(topics);
+        reader.seekTime(filter.start);
+
+        b0::bag::Record record;
+        while(reader.next(record) && record.time <= filter.end)
+        {
+            b0::message::parse(env, record.wire.data(), record.wire.size());
+            for(auto &part : env.parts)
+            {
+                if(part.content_type == batch.type())
+                {
+                    b0::message::parse(batch, part.payload, part.content_type);
+                }
+                else
+                {
+                    // a single entry, handled as a batch of one:
+                    b0::message::parse(entry, part.payload, part.content_type);
+                    batch.entries.assign(1, entry);
+                }
+                for(auto &e : batch.entries)
+                {
+                    if(!filter.selects(e)) continue;
+                    print(e, color);
+                    count++;
+                }
+            }
+        }
+    }
+    std::cout << std::flush;
+    std::cerr << count << " entries" << std::endl;
+    return 0;
+}
@@ -1,10 +1,14 @@
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <b0/node.h>
 #include <b0/subscriber.h>
 #include <b0/logger/logger.h>
+#include <b0/exceptions.h>
+#include <b0/bag/bag.h>
 #include <b0/message/log/log_entry.h>
+#include <b0/message/log/log_entry_batch.h>
 
 namespace b0
 {
@@ -15,37 +19,133 @@ namespace logger
 class Console : public Node
 {
 public:
-    Console()
+    Console(Level min_level, const std::vector<std::string> &node_names)
         : Node("logger_monitor"),
-          sub_(this, "log", &Console::onLogMessage, this)
+          sub_(this, "log", &Console::onLogMessage, this),
+          min_level_(min_level),
+          node_names_(node_names)
     {
+        // the entries sent to the subtopics of the log (see b0::setHierarchicalLogTopics())
+        // are selected by the proxy, the other ones by filter():
+        sub_.setSubtopicFilters(logSubtopicFilters(min_level_, node_names_));
     }
 
     ~Console()
     {
     }
 
-    void onLogMessage(const b0::message::log::LogEntry &entry)
+    void onLogMessage(const std::string &payload, const std::string &type)
     {
+        b0::message::log::LogEntryBatch batch;
+        if(type == batch.type())
+        {
+            b0::message::parse(batch, payload, type);
+            for(auto &entry : batch.entries)
+                onLogEntry(entry);
+        }
+        else
+        {
+            b0::message::log::LogEntry entry;
+            b0::message::parse(entry, payload, type);
+            onLogEntry(entry);
+        }
+    }
+
+    bool filter(const b0::message::log::LogEntry &entry)
+    {
+        if(levelInfo(entry.level).level < min_level_) return true;
+        if(node_names_.empty()) return false;
+        for(auto &node_name : node_names_)
+            if(entry.node_name.compare(0, node_name.size(), node_name) == 0) return false;
+        return true;
+    }
+
+    void onLogEntry(const b0::message::log::LogEntry &entry)
+    {
+        if(filter(entry)) return;
         LevelInfo info = levelInfo(entry.level);
         std::cout << info.ansiEscape() << "[" << entry.node_name << "] " << info.str << ": " << entry.message << info.ansiReset() << std::endl;
     }
 
 protected:
     b0::Subscriber sub_;
+
+    //! The lowest level of the entries printed
+    Level min_level_;
+
+    //! Prefixes of the names of the nodes whose entries are printed (empty for all)
+    std::vector<std::string> node_names_;
 };
 
+/*!
+ * Write the log entries, as received, to rotating bag files (see b0::bag::RotatingWriter),
+ * to be read with b0_log_dump
+ *
+ * The entries sent to the log topic itself are all written: the level and node filters only
+ * select the subtopics (see b0::setHierarchicalLogTopics()).
+ */
+void sink(Level min_level, const std::vector<std::string> &node_names, b0::bag::RotatingWriter &writer)
+{
+    b0::Node node("logger_monitor");
+    b0::Subscriber sub(&node, "log");
+    // the entries are queued by the socket and the writer, never dropped:
+    sub.setReadHWM(0);
+    sub.setSubtopicFilters(logSubtopicFilters(min_level, node_names));
+    node.init();
+
+    std::shared_ptr<const void> buffer;
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        if(!sub.poll(100)) continue;
+        while(sub.poll())
+        {
+            boost::string_ref wire = sub.readWire(buffer);
+            writer.write(node.timeUSec(), wire.data(), wire.size());
+        }
+    }
+    node.cleanup();
+}
+
 } // namespace logger
 
 } // namespace b0
 
 int main(int argc, char **argv)
 {
+    std::string level, output, compression_algorithm;
+    std::vector<std::string> node_names;
+    int max_size_mb = 256, max_files = 0, compression_level = -1;
+    double max_duration = 3600;
+    b0::addOptionString("level,l", "lowest level of the entries printed", &level, false, "trace");
+    b0::addOptionStringVector("node,n", "print only the entries of the nodes whose name starts with this", &node_names, false, {});
+    b0::addOptionString("output,o", "write the entries to bag files named after this prefix, instead of printing them", &output);
+    b0::addOptionInt("max-size,s", "start a new file after this many MiB of entries", &max_size_mb, false, 256);
+    b0::addOptionDouble("max-duration,d", "start a new file after this many seconds (0 = no limit)", &max_duration, false, 3600);
+    b0::addOptionInt("max-files,k", "delete the oldest files beyond this number (0 = keep all)", &max_files, false, 0);
+    b0::addOptionString("compression,z", "compression algorithm of the files (e.g. lz4, zstd)", &compression_algorithm, false, "lz4");
+    b0::addOptionInt("compression-level", "compression level", &compression_level, false, -1);
     b0::init(argc, argv);
-    b0::logger::Console console;
-    console.init();
-    console.spin();
-    console.cleanup();
+
+    if(output.empty())
+    {
+        b0::logger::Console console(b0::logger::levelInfo(level).level, node_names);
+        console.init();
+        console.spin();
+        console.cleanup();
+        return 0;
+    }
+
+    if(max_size_mb <= 0)
+        throw b0::exception::ArgumentError(std::to_string(max_size_mb), "max-size");
+    if(max_duration < 0)
+        throw b0::exception::ArgumentError(std::to_string(max_duration), "max-duration");
+    if(max_files < 0)
+        throw b0::exception::ArgumentError(std::to_string(max_files), "max-files");
+    b0::bag::RotatingWriter writer(output, uint64_t(max_size_mb) * 1024 * 1024, int64_t(max_duration * 1000000), max_files, 4 * 1024 * 1024, compression_algorithm, compression_level);
+    b0::logger::sink(b0::logger::levelInfo(level).level, node_names, writer);
+    writer.close();
+    std::cerr << "Wrote " << writer.getMessageCount() << " log messages to " << writer.getFiles().size() << " files" << std::endl;
     return 0;
 }
 
@@ -0,0 +1,429 @@
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <zmq.hpp>
+
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/exceptions.h>
+#include <b0/resolver/client.h>
+#include <b0/message/graph/graph.h>
+#include <b0/message/metrics/node_metrics.h>
+
+//! The metrics service of a node, and its last snapshot
+struct Target
+{
+    std::unique_ptr<b0::ServiceClient> cli;
+    b0::message::metrics::NodeMetrics metrics;
+    bool ok{false};
+    int64_t scrape_usec{0};
+};
+
+//! Escape a label value of the Prometheus text format
+static std::string label(const std::string &value)
+{
+    std::string s;
+    s.reserve(value.size() + 2);
+    s += '"';
+    for(char c : value)
+    {
+        if(c == '\\') s += "\\\\";
+        else if(c == '"') s += "\\\"";
+        else if(c == '\n') s += "\\n";
+        else s += c;
+    }
+    s += '"';
+    return s;
+}
+
+/*!
+ * \brief Writes one metric family: its HELP and TYPE lines, then its samples
+ */
+class Family
+{
+public:
+    Family(std::ostream &os, const std::string &name, const std::string &type, const std::string &help)
+        : os_(os), name_(name)
+    {
+        os_ << "# HELP " << name << " " << help << "\n";
+        os_ << "# TYPE " << name << " " << type << "\n";
+    }
+
+    template<typename T>
+    void sample(const std::string &labels, T value, const std::string &suffix = "")
+    {
+        os_ << name_ << suffix << "{" << labels << "} " << value << "\n";
+    }
+
+private:
+    std::ostream &os_;
+    std::string name_;
+};
+
+static std::string socketLabels(const std::string &node, const b0::message::metrics::SocketMetrics &s)
+{
+    return "node=" + label(node) + ",socket=" + label(s.name) + ",type=" + label(s.socket_type);
+}
+
+//! Render the snapshots in the Prometheus text exposition format (version 0.0.4)
+static std::string render(const std::map<std::string, Target> &targets)
+{
+    using b0::message::metrics::SocketMetrics;
+
+    std::ostringstream os;
+    os.precision(9);
+
+    {
+        Family f(os, "b0_scrape_success", "gauge", "Whether the metrics service of the node answered the last scrape");
+        for(auto &t : targets)
+            f.sample("node=" + label(t.first), t.second.ok ? 1 : 0);
+    }
+    {
+        Family f(os, "b0_scrape_duration_seconds", "gauge", "Duration of the last call to the metrics service of the node");
+        for(auto &t : targets)
+            f.sample("node=" + label(t.first), t.second.scrape_usec / 1e6);
+    }
+
+    struct Counter
+    {
+        const char *name;
+        const char *help;
+        uint64_t SocketMetrics::*field;
+    };
+    static const Counter counters[] = {
+        {"b0_messages_sent_total", "Messages sent by the socket", &SocketMetrics::messages_sent},
+        {"b0_bytes_sent_total", "Bytes sent by the socket (serialized envelopes, after compression)", &SocketMetrics::bytes_sent},
+        {"b0_payload_bytes_sent_total", "Payload bytes sent by the socket (before compression)", &SocketMetrics::payload_bytes_sent},
+        {"b0_messages_dropped_total", "Messages dropped because they could not be queued", &SocketMetrics::messages_dropped},
+        {"b0_messages_received_total", "Messages received by the socket", &SocketMetrics::messages_received},
+        {"b0_bytes_received_total", "Bytes received by the socket (serialized envelopes, before decompression)", &SocketMetrics::bytes_received},
+        {"b0_payload_bytes_received_total", "Payload bytes received by the socket (after decompression)", &SocketMetrics::payload_bytes_received},
+        {"b0_read_errors_total", "Messages received which could not be read", &SocketMetrics::read_errors},
+        {"b0_compression_skipped_total", "Payloads left uncompressed by the adaptive compression", &SocketMetrics::compression_skipped},
+        {"b0_connects_total", "Connections established or accepted by the socket", &SocketMetrics::connects},
+        {"b0_disconnects_total", "Connections of the socket lost", &SocketMetrics::disconnects},
+        {"b0_reconnects_total", "Connections of the socket established again after being lost", &SocketMetrics::reconnects},
+        {"b0_connect_retries_total", "Connection attempts of the socket retried", &SocketMetrics::connect_retries},
+        {"b0_handshake_failures_total", "Failed handshakes of the connections of the socket", &SocketMetrics::handshake_failures},
+        {"b0_receive_allocations_total", "Buffers allocated to receive messages (with memory accounting)", &SocketMetrics::receive_allocations},
+        {"b0_receive_allocated_bytes_total", "Bytes allocated to receive messages (with memory accounting)", &SocketMetrics::receive_allocated_bytes},
+        {"b0_decode_allocations_total", "Buffers allocated to decode messages (with memory accounting)", &SocketMetrics::decode_allocations},
+        {"b0_decode_allocated_bytes_total", "Bytes allocated to decode messages (with memory accounting)", &SocketMetrics::decode_allocated_bytes},
+        {"b0_send_allocations_total", "Buffers allocated to send messages (with memory accounting)", &SocketMetrics::send_allocations},
+        {"b0_send_allocated_bytes_total", "Bytes allocated to send messages (with memory accounting)", &SocketMetrics::send_allocated_bytes},
+    };
+    for(auto &c : counters)
+    {
+        Family f(os, c.name, "counter", c.help);
+        for(auto &t : targets)
+        {
+            if(!t.second.ok) continue;
+            for(auto &s : t.second.metrics.sockets)
+                f.sample(socketLabels(t.first, s), s.*c.field);
+        }
+    }
+
+    {
+        Family f(os, "b0_queue_depth", "gauge", "Messages or calls waiting in a queue of the socket");
+        for(auto &t : targets)
+        {
+            if(!t.second.ok) continue;
+            for(auto &s : t.second.metrics.sockets)
+                f.sample(socketLabels(t.first, s), s.queue_depth);
+        }
+    }
+    static const Counter queue_gauges[] = {
+        {"b0_receive_queue_bytes", "Payload bytes waiting to be dispatched by the socket", &SocketMetrics::receive_queue_bytes},
+        {"b0_receive_queue_peak_bytes", "Peak of the payload bytes waiting to be dispatched by the socket", &SocketMetrics::receive_queue_peak_bytes},
+        {"b0_write_queue_bytes", "Bytes waiting in the write queue of the socket", &SocketMetrics::write_queue_bytes},
+        {"b0_write_queue_peak_bytes", "Peak of the bytes waiting in the write queue of the socket", &SocketMetrics::write_queue_peak_bytes},
+    };
+    for(auto &c : queue_gauges)
+    {
+        Family f(os, c.name, "gauge", c.help);
+        for(auto &t : targets)
+        {
+            if(!t.second.ok) continue;
+            for(auto &s : t.second.metrics.sockets)
+                f.sample(socketLabels(t.first, s), s.*c.field);
+        }
+    }
+    {
+        // the histogram of the node is summarized by percentiles: exposed as a summary
+        Family f(os, "b0_callback_duration_seconds", "summary", "Duration of the callbacks of the socket (for a service server, the request handling latency)");
+        for(auto &t : targets)
+        {
+            if(!t.second.ok) continue;
+            for(auto &s : t.second.metrics.sockets)
+            {
+                if(!s.callback_count) continue;
+                std::string l = socketLabels(t.first, s);
+                f.sample(l + ",quantile=\"0.5\"", s.callback_p50_usec / 1e6);
+                f.sample(l + ",quantile=\"0.9\"", s.callback_p90_usec / 1e6);
+                f.sample(l + ",quantile=\"0.99\"", s.callback_p99_usec / 1e6);
+                f.sample(l, s.callback_total_usec / 1e6, "_sum");
+                f.sample(l, s.callback_count, "_count");
+            }
+        }
+    }
+    {
+        Family f(os, "b0_callback_duration_max_seconds", "gauge", "Maximum duration of a callback of the socket");
+        for(auto &t : targets)
+        {
+            if(!t.second.ok) continue;
+            for(auto &s : t.second.metrics.sockets)
+                if(s.callback_count) f.sample(socketLabels(t.first, s), s.callback_max_usec / 1e6);
+        }
+    }
+    {
+        Family f(os, "b0_connect_duration_max_seconds", "gauge", "Maximum time of the socket to (re)connect");
+        for(auto &t : targets)
+        {
+            if(!t.second.ok) continue;
+            for(auto &s : t.second.metrics.sockets)
+                if(s.connects) f.sample(socketLabels(t.first, s), s.connect_max_usec / 1e6);
+        }
+    }
+    {
+        Family f(os, "b0_handshake_duration_p99_seconds", "gauge", "99th percentile of the duration of the handshakes of the socket");
+        for(auto &t : targets)
+        {
+            if(!t.second.ok) continue;
+            for(auto &s : t.second.metrics.sockets)
+                if(s.connects) f.sample(socketLabels(t.first, s), s.handshake_p99_usec / 1e6);
+        }
+    }
+    {
+        Family f(os, "b0_callback_cpu_seconds_total", "counter", "CPU time spent in the callbacks of the socket (if built with ENABLE_PROFILING)");
+        for(auto &t : targets)
+        {
+            if(!t.second.ok) continue;
+            for(auto &s : t.second.metrics.sockets)
+                if(s.callback_count) f.sample(socketLabels(t.first, s), s.callback_cpu_total_usec / 1e6);
+        }
+    }
+    {
+        Family f(os, "b0_spin_iterations_total", "counter", "Iterations of the spin loop of the node");
+        for(auto &t : targets)
+            if(t.second.ok) f.sample("node=" + label(t.first), t.second.metrics.spin_iterations);
+    }
+    {
+        Family f(os, "b0_spin_overruns_total", "counter", "Iterations of the spin loop of the node which overran the period");
+        for(auto &t : targets)
+            if(t.second.ok) f.sample("node=" + label(t.first), t.second.metrics.spin_overruns);
+    }
+    {
+        Family f(os, "b0_spin_jitter_seconds", "summary", "Lateness of the iterations of the spin loop of the node");
+        for(auto &t : targets)
+        {
+            if(!t.second.ok) continue;
+            const b0::message::metrics::NodeMetrics &m = t.second.metrics;
+            std::string l = "node=" + label(t.first);
+            f.sample(l + ",quantile=\"0.5\"", m.spin_jitter_p50_usec / 1e6);
+            f.sample(l + ",quantile=\"0.99\"", m.spin_jitter_p99_usec / 1e6);
+            f.sample(l + ",quantile=\"1\"", m.spin_jitter_max_usec / 1e6);
+        }
+    }
+    {
+        Family f(os, "b0_heartbeat_age_seconds", "gauge", "Time since the last heartbeat of the node, as seen by the resolver");
+        for(auto &t : targets)
+        {
+            if(!t.second.ok) continue;
+            for(auto &hb : t.second.metrics.heartbeats)
+                f.sample("node=" + label(hb.node_name) + ",resolver=" + label(t.first), hb.age_usec / 1e6);
+        }
+    }
+    return os.str();
+}
+
+//! Call the metrics service of every node of the graph
+static void scrape(b0::Node &node, b0::resolver::Client &resolv_cli, std::map<std::string, Target> &targets, int timeout)
+{
+    std::set<std::string> names;
+    try
+    {
+        b0::message::graph::Graph graph;
+        resolv_cli.getGraph(graph);
+        for(auto &n : graph.nodes)
+            if(n.node_name != node.getName())
+                names.insert(n.node_name);
+    }
+    catch(std::exception &ex)
+    {
+        node.error("Cannot get the graph: %s", ex.what());
+        return;
+    }
+
+    // forget the nodes which are gone
+    for(auto it = targets.begin(); it != targets.end(); )
+    {
+        if(names.count(it->first)) {++it; continue;}
+        if(it->second.cli) it->second.cli->cleanup();
+        it = targets.erase(it);
+    }
+
+    for(auto &name : names)
+    {
+        Target &t = targets[name];
+        int64_t t0 = node.hardwareTimeUSec();
+        try
+        {
+            if(!t.cli)
+            {
+                // nodes offer it only with B0_METRICS_SERVICE=1, and not in the graph
+                t.cli.reset(new b0::ServiceClient(&node, name + ".metrics", false, false));
+                t.cli->setCallDeadline(timeout);
+                t.cli->init();
+            }
+            std::string rep, reptype;
+            t.cli->call(std::string(), std::string(), rep, reptype);
+            b0::message::parse(t.metrics, rep, reptype);
+            t.ok = true;
+        }
+        catch(std::exception &ex)
+        {
+            if(t.ok) node.warn("Cannot read the metrics of node %s: %s", name, ex.what());
+            t.ok = false;
+            // resolve again next time: the node may have restarted elsewhere
+            if(t.cli)
+            {
+                try {t.cli->cleanup();} catch(std::exception &) {}
+                t.cli.reset();
+            }
+        }
+        t.scrape_usec = node.hardwareTimeUSec() - t0;
+    }
+}
+
+//! Answer the HTTP requests received on a ZMQ_STREAM socket
+class HTTPServer
+{
+public:
+    HTTPServer(zmq::context_t &context, const std::string &address)
+        : socket_(context, ZMQ_STREAM)
+    {
+        socket_.bind(address);
+    }
+
+    //! Wait up to timeout milliseconds for a request; answer GET /metrics with page
+    void poll(long timeout, const std::string &page)
+    {
+        zmq::pollitem_t item{static_cast<void*>(socket_), 0, ZMQ_POLLIN, 0};
+        zmq::poll(&item, 1, timeout);
+        while(item.revents & ZMQ_POLLIN)
+        {
+            zmq::message_t id, data;
+            socket_.recv(&id);
+            socket_.recv(&data);
+            std::string key(static_cast<const char*>(id.data()), id.size());
+            // an empty frame notifies a connection or a disconnection
+            if(data.size() == 0)
+            {
+                requests_.erase(key);
+            }
+            else
+            {
+                std::string &req = requests_[key];
+                req.append(static_cast<const char*>(data.data()), data.size());
+                if(req.find("\r\n\r\n") != std::string::npos)
+                {
+                    reply(key, req, page);
+                    requests_.erase(key);
+                }
+                else if(req.size() > 65536)
+                {
+                    close(key);
+                    requests_.erase(key);
+                }
+            }
+            zmq::poll(&item, 1, 0);
+        }
+    }
+
+private:
+    void reply(const std::string &key, const std::string &req, const std::string &page)
+    {
+        std::string status = "200 OK", type = "text/plain; version=0.0.4; charset=utf-8", body = page;
+        if(req.compare(0, 4, "GET ") != 0)
+        {
+            status = "405 Method Not Allowed";
+            type = "text/plain";
+            body = "only GET is supported\n";
+        }
+        else if(req.compare(4, 9, "/metrics ") != 0 && req.compare(4, 9, "/metrics?") != 0)
+        {
+            status = "404 Not Found";
+            type = "text/plain";
+            body = "metrics are served at /metrics\n";
+        }
+        std::string rep = (boost::format("HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\nConnection: close\r\n\r\n") % status % type % body.size()).str() + body;
+        socket_.send(key.data(), key.size(), ZMQ_SNDMORE);
+        socket_.send(rep.data(), rep.size());
+        close(key);
+    }
+
+    void close(const std::string &key)
+    {
+        socket_.send(key.data(), key.size(), ZMQ_SNDMORE);
+        socket_.send("", 0);
+    }
+
+    zmq::socket_t socket_;
+
+    //! The requests being received, by connection
+    std::map<std::string, std::string> requests_;
+};
+
+int main(int argc, char **argv)
+{
+    std::string node_name = "b0_metrics_exporter", listen = "tcp://*:9464";
+    double interval = 5.0;
+    int timeout = 1000;
+    b0::addOptionString("node-name,n", "name of node", &node_name);
+    b0::addOptionString("listen,l", "address of the HTTP endpoint (ZeroMQ syntax)", &listen, false, "tcp://*:9464");
+    b0::addOptionDouble("interval,i", "seconds between scrapes of the nodes", &interval, false, 5.0);
+    b0::addOptionInt("timeout,t", "timeout of the call to the metrics service of each node, in milliseconds", &timeout, false, 1000);
+    b0::init(argc, argv);
+
+    if(interval <= 0)
+        throw b0::exception::ArgumentError(std::to_string(interval), "interval");
+    if(timeout <= 0)
+        throw b0::exception::ArgumentError(std::to_string(timeout), "timeout");
+
+    b0::Node node(node_name);
+    b0::resolver::Client resolv_cli(&node);
+    node.init();
+    resolv_cli.init();
+
+    HTTPServer http(*static_cast<zmq::context_t*>(node.getContext()), listen);
+    node.info("Serving the metrics of the nodes at %s/metrics", listen);
+
+    // the page is rendered after each scrape, not for each HTTP request
+    std::map<std::string, Target> targets;
+    std::string page = render(targets);
+    int64_t next_scrape = node.hardwareTimeUSec();
+    while(!node.shutdownRequested())
+    {
+        if(node.hardwareTimeUSec() >= next_scrape)
+        {
+            scrape(node, resolv_cli, targets, timeout);
+            page = render(targets);
+            next_scrape = node.hardwareTimeUSec() + int64_t(interval * 1e6);
+        }
+        node.spinOnce();
+        http.poll(100, page);
+    }
+
+    for(auto &t : targets)
+        if(t.second.cli) t.second.cli->cleanup();
+    resolv_cli.cleanup();
+    node.cleanup();
+    return 0;
+}
@@ -1,28 +1,52 @@
+#include <algorithm>
 #include <set>
 #include <iostream>
+#include <boost/format.hpp>
 #include <b0/node.h>
 #include <b0/resolver/client.h>
 #include <b0/message/graph/graph_node.h>
 
 int main(int argc, char **argv)
 {
+    b0::addOption("stats,s", "show the resource usage reported by the nodes (see B0_HEARTBEAT_STATS), busiest first");
     b0::init(argc, argv);
+    bool show_stats = b0::hasOption("stats");
     b0::Node node("node_list");
     b0::resolver::Client resolv_cli(&node);
+    node.setEphemeral(true);
     node.init();
     resolv_cli.init();
     b0::message::graph::Graph graph;
     resolv_cli.getGraph(graph);
     std::set<std::string> nodes;
+    std::vector<const b0::message::graph::GraphNode*> list;
     for(auto &n : graph.nodes)
     {
         if(n.node_name == node.getName()) continue;
         if(nodes.find(n.node_name) != nodes.end()) continue;
         nodes.insert(n.node_name);
-        std::cout << n.node_name << std::endl;
+        list.push_back(&n);
+    }
+    if(show_stats)
+    {
+        std::stable_sort(list.begin(), list.end(), [](const b0::message::graph::GraphNode *a, const b0::message::graph::GraphNode *b) {
+            double ua = a->stats ? a->stats->cpu_usage : -1, ub = b->stats ? b->stats->cpu_usage : -1;
+            return ua > ub;
+        });
+        std::cout << boost::format("%-32s %8s %6s %10s %10s %10s %9s") % "NODE" % "PID" % "CPU%" % "RSS(MB)" % "TX/s" % "RX/s" % "OVERRUNS" << std::endl;
+    }
+    for(auto n : list)
+    {
+        if(!show_stats)
+            std::cout << n->node_name << std::endl;
+        else if(!n->stats)
+            std::cout << boost::format("%-32s %8d %6s %10s %10s %10s %9s") % n->node_name % n->process_id % "-" % "-" % "-" % "-" % "-" << std::endl;
+        else
+            std::cout << boost::format("%-32s %8d %6.1f %10.1f %10.1f %10.1f %9d") % n->node_name % n->process_id
+                % (n->stats->cpu_usage * 100) % (n->stats->rss / 1048576.0)
+                % n->stats->messages_sent_rate % n->stats->messages_received_rate % n->stats->spin_overruns << std::endl;
     }
     resolv_cli.cleanup();
     node.cleanup();
     return 0;
 }
-
@@ -1,12 +1,20 @@
 #include <sstream>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <map>
+#include <memory>
+#include <set>
 #include <iostream>
+#include <boost/format.hpp>
 #include <b0/node.h>
 #include <b0/service_client.h>
 #include <b0/service_server.h>
 #include <b0/publisher.h>
 #include <b0/subscriber.h>
+#include <b0/message/graph/graph.h>
+#include <b0/message/graph/get_graph_request.h>
 #include "protocol.h"
 
 namespace b0
@@ -41,13 +49,42 @@ public:
         else
         {
             auto &client = it->second;
-            client.last_active_ = timeUSec();
+            expiry_.erase(std::make_pair(client.last_active_, it->first));
+            client.last_active_ = hardwareTimeUSec();
+            expiry_.insert(std::make_pair(client.last_active_, it->first));
+            client.beacon_ = beacon;
+            // the load sampled since accounts for the processes placed a while ago
+            int64_t t = client.last_active_ - placement_memory_;
+            client.placed_.erase(std::remove_if(client.placed_.begin(), client.placed_.end(), [t](int64_t x) {return x < t;}), client.placed_.end());
         }
     }
 
     void handleRequest(const HUBRequest &req, HUBResponse &rsp)
     {
-        auto it = clients_.find(req.host_name);
+        if(req.launch)
+        {
+            rsp.launch.emplace();
+            launch(*req.launch, *rsp.launch);
+            rsp.success = rsp.launch->success;
+            return;
+        }
+
+        std::string host_name = req.host_name;
+        if(host_name.empty() && req.placement)
+        {
+            std::string err;
+            host_name = place(*req.placement, err);
+            if(host_name.empty())
+            {
+                error("placement: %s", err);
+                rsp.success = false;
+                rsp.error_message = err;
+                return;
+            }
+            info("placement: chose %s", host_name);
+        }
+
+        auto it = clients_.find(host_name);
         if(it == clients_.end())
         {
             error("bad request: unknown host");
@@ -62,51 +99,349 @@ public:
         client.cli_->call(req1, rsp1);
         rsp = rsp1;
         rsp.success = true;
+        if(req.host_name.empty())
+            rsp.host_name = host_name;
+    }
+
+    /*
+     * Choose the host of a process: the least loaded of the ones matching the constraints.
+     * Return an empty string, and the reason in err, if there is none.
+     */
+    std::string place(const Placement &placement, std::string &err)
+    {
+        // the hosts of the publishers of the topic, from the resolver
+        std::set<std::string> near_hosts;
+        if(!placement.near_topic.empty())
+        {
+            b0::message::graph::GetGraphRequest query;
+            query.topic_name = placement.near_topic;
+            query.link_type = "publishes";
+            b0::message::graph::Graph graph;
+            try
+            {
+                getGraph(graph, query);
+            }
+            catch(std::exception &ex)
+            {
+                err = std::string("cannot get the graph: ") + ex.what();
+                return "";
+            }
+            for(auto &n : graph.nodes)
+                near_hosts.insert(n.host_id);
+            if(near_hosts.empty())
+            {
+                err = "no publisher of topic '" + placement.near_topic + "'";
+                return "";
+            }
+        }
+
+        std::string best;
+        std::pair<double, double> best_load;
+        for(auto &x : clients_)
+        {
+            const Beacon &b = x.second.beacon_;
+            bool match = true;
+            for(auto &label : placement.labels)
+                if(std::find(b.labels.begin(), b.labels.end(), label) == b.labels.end())
+                    match = false;
+            if(!near_hosts.empty() && !near_hosts.count(x.first))
+                match = false;
+            if(placement.min_memory_available > 0 && (!b.memory_available || *b.memory_available < placement.min_memory_available))
+                match = false;
+            if(!match) continue;
+
+            std::pair<double, double> load = hostLoad(x.second);
+            if(best.empty() || load < best_load)
+            {
+                best = x.first;
+                best_load = load;
+            }
+        }
+        if(best.empty())
+        {
+            err = "no host matches the placement constraints";
+            return "";
+        }
+        // until the load of the host shows it (see onBeacon())
+        clients_[best].placed_.push_back(hardwareTimeUSec());
+        return best;
+    }
+
+    /*
+     * Assign each process its dependency level (0 for no dependencies); return an error
+     * message if the ids are not unique, a dependency is unknown, or there is a cycle
+     */
+    static std::string computeLevels(const LaunchRequest &req, std::vector<int> &levels)
+    {
+        std::map<std::string, size_t> index;
+        for(size_t i = 0; i < req.processes.size(); i++)
+            if(!index.insert(std::make_pair(req.processes[i].id, i)).second)
+                return "duplicate process id '" + req.processes[i].id + "'";
+
+        // -1: not visited, -2: being visited (a cycle if reached again)
+        levels.assign(req.processes.size(), -1);
+        std::function<std::string(size_t)> visit = [&](size_t i) -> std::string {
+            if(levels[i] == -2) return "dependency cycle through '" + req.processes[i].id + "'";
+            if(levels[i] >= 0) return "";
+            levels[i] = -2;
+            int level = 0;
+            for(auto &dep : req.processes[i].depends_on)
+            {
+                auto it = index.find(dep);
+                if(it == index.end())
+                    return "unknown dependency '" + dep + "' of '" + req.processes[i].id + "'";
+                std::string err = visit(it->second);
+                if(!err.empty()) return err;
+                level = std::max(level, levels[it->second] + 1);
+            }
+            levels[i] = level;
+            return "";
+        };
+        for(size_t i = 0; i < req.processes.size(); i++)
+        {
+            std::string err = visit(i);
+            if(!err.empty()) return err;
+        }
+        return "";
+    }
+
+    void launch(const LaunchRequest &req, LaunchResponse &rsp)
+    {
+        rsp.success = false;
+        rsp.processes.resize(req.processes.size());
+        for(size_t i = 0; i < req.processes.size(); i++)
+            rsp.processes[i].id = req.processes[i].id;
+
+        std::vector<int> levels;
+        std::string err = computeLevels(req, levels);
+        if(err.empty() && req.ready_timeout <= 0)
+            err = "bad ready_timeout";
+        if(!err.empty())
+        {
+            error("launch: %s", err);
+            rsp.error_message = err;
+            return;
+        }
+
+        int num_levels = levels.empty() ? 0 : *std::max_element(levels.begin(), levels.end()) + 1;
+        for(int level = 0; level < num_levels; level++)
+        {
+            std::vector<size_t> procs;
+            for(size_t i = 0; i < levels.size(); i++)
+                if(levels[i] == level) procs.push_back(i);
+            info("launch: starting level %d (%d processes)", level, procs.size());
+
+            if(!startLevel(req, procs, rsp) || !waitReady(req, procs, rsp))
+            {
+                for(size_t i = 0; i < levels.size(); i++)
+                    if(levels[i] > level)
+                        rsp.processes[i].error_message = "not started: a dependency failed";
+                rsp.error_message = (boost::format("level %d failed") % level).str();
+                return;
+            }
+        }
+        rsp.success = true;
+    }
+
+    //! Start the processes of a level, with one request to each host, sent in parallel
+    bool startLevel(const LaunchRequest &req, const std::vector<size_t> &procs, LaunchResponse &rsp)
+    {
+        std::map<std::string, std::vector<size_t> > procs_by_host;
+        bool ok = true;
+        for(size_t i : procs)
+        {
+            std::string host_name = req.processes[i].host_name;
+            if(host_name.empty())
+            {
+                std::string err = "no host_name nor placement";
+                if(req.processes[i].placement)
+                    host_name = place(*req.processes[i].placement, err);
+                if(host_name.empty())
+                {
+                    rsp.processes[i].error_message = err;
+                    ok = false;
+                    continue;
+                }
+                info("launch: placed '%s' on %s", req.processes[i].id, host_name);
+            }
+            rsp.processes[i].host_name = host_name;
+            procs_by_host[host_name].push_back(i);
+        }
+
+        // the replies may arrive after the wait gives up, so they go to a shared copy
+        struct HostCall
+        {
+            std::vector<size_t> procs;
+            std::shared_ptr<boost::optional<Response> > reply;
+        };
+        std::map<std::string, HostCall> calls;
+        for(auto &x : procs_by_host)
+        {
+            auto it = clients_.find(x.first);
+            if(it == clients_.end())
+            {
+                for(size_t i : x.second)
+                    rsp.processes[i].error_message = "unknown host";
+                ok = false;
+                continue;
+            }
+            Request r;
+            r.start_processes.emplace();
+            for(size_t i : x.second)
+                r.start_processes->processes.push_back(req.processes[i].process);
+            HostCall &call = calls[x.first];
+            call.procs = x.second;
+            call.reply = std::make_shared<boost::optional<Response> >();
+            auto reply = call.reply;
+            it->second.cli_->callAsync<Response>(r, [reply](const Response &r) {*reply = r;});
+        }
+
+        int64_t deadline = hardwareTimeUSec() + int64_t(req.ready_timeout * 1000000);
+        for(auto &x : calls)
+        {
+            long timeout = long(std::max<int64_t>(0, deadline - hardwareTimeUSec()) / 1000);
+            clients_[x.first].cli_->waitReplies(timeout);
+            const boost::optional<Response> &reply = *x.second.reply;
+            const std::vector<size_t> &ps = x.second.procs;
+            if(!reply || !reply->start_processes || reply->start_processes->processes.size() != ps.size())
+            {
+                for(size_t i : ps)
+                    rsp.processes[i].error_message = "no reply from the process manager of " + x.first;
+                ok = false;
+                continue;
+            }
+            for(size_t k = 0; k < ps.size(); k++)
+            {
+                const StartProcessResponse &r = reply->start_processes->processes[k];
+                LaunchResult &res = rsp.processes[ps[k]];
+                res.started = r.success;
+                res.pid = r.pid;
+                res.error_message = r.error_message;
+                if(!r.success) ok = false;
+                else if(req.processes[ps[k]].ready_nodes.empty()) res.ready = true;
+            }
+        }
+        return ok;
+    }
+
+    //! Wait until the nodes of the processes of a level appear in the graph
+    bool waitReady(const LaunchRequest &req, const std::vector<size_t> &procs, LaunchResponse &rsp)
+    {
+        int64_t deadline = hardwareTimeUSec() + int64_t(req.ready_timeout * 1000000);
+        for(;;)
+        {
+            b0::message::graph::Graph graph;
+            try
+            {
+                getGraph(graph);
+            }
+            catch(std::exception &ex)
+            {
+                warn("launch: cannot get the graph: %s", ex.what());
+            }
+            std::set<std::string> nodes;
+            for(auto &n : graph.nodes)
+                nodes.insert(n.node_name);
+
+            bool all_ready = true;
+            for(size_t i : procs)
+            {
+                if(rsp.processes[i].ready) continue;
+                bool ready = true;
+                for(auto &name : req.processes[i].ready_nodes)
+                    if(!nodes.count(name)) ready = false;
+                rsp.processes[i].ready = ready;
+                all_ready = all_ready && ready;
+            }
+            if(all_ready) return true;
+
+            if(hardwareTimeUSec() >= deadline || shutdownRequested())
+            {
+                for(size_t i : procs)
+                    if(!rsp.processes[i].ready)
+                        rsp.processes[i].error_message = "not ready in time";
+                return false;
+            }
+            sleepUSec(100000);
+        }
     }
 
     void add(const Beacon &beacon)
     {
-        clients_[beacon.host_name].last_active_ = timeUSec();
-        clients_[beacon.host_name].cli_.reset(new b0::ServiceClient(this, beacon.service_name, false));
+        Client &client = clients_[beacon.host_name];
+        client.last_active_ = hardwareTimeUSec();
+        client.node_name_ = beacon.node_name;
+        client.service_name_ = beacon.service_name;
+        client.beacon_ = beacon;
+        client.cli_.reset(new b0::ServiceClient(this, beacon.service_name, false));
         info("added new entry: %s -> %s", beacon.host_name, beacon.service_name);
-        clients_[beacon.host_name].cli_->init();
+        client.cli_->init();
+        expiry_.insert(std::make_pair(client.last_active_, beacon.host_name));
+        joined_.push_back(beacon.host_name);
     }
 
     void remove(const std::string &host_name)
     {
         auto it = clients_.find(host_name);
         if(it == clients_.end()) return;
-        clients_[host_name].cli_->cleanup();
+        expiry_.erase(std::make_pair(it->second.last_active_, host_name));
+        it->second.cli_->cleanup();
         clients_.erase(it);
         info("removed entry: %s", host_name);
+        left_.push_back(host_name);
     }
 
+    //! Remove the entries without a beacon for more than inactive_timeout_ (oldest first)
     void removeInactive()
     {
-        std::vector<std::string> removed;
-        for(auto it = clients_.begin(); it != clients_.end(); ++it)
-        {
-            auto &client = it->second;
-            int64_t diff = timeUSec() - client.last_active_;
-            if(diff > 1000000)
-                removed.push_back(it->first);
-        }
-        for(auto &x : removed)
-            remove(x);
+        int64_t t = hardwareTimeUSec() - inactive_timeout_;
+        while(!expiry_.empty() && expiry_.begin()->first < t)
+            remove(expiry_.begin()->second);
+    }
+
+    void fillActivity(const std::string &host_name, NodeActivity &act)
+    {
+        const Client &client = clients_[host_name];
+        act.host_name = host_name;
+        act.node_name = client.node_name_;
+        act.service_name = client.service_name_;
+        // as a (synchronized) timeUSec()
+        act.last_active = timeUSec() - (hardwareTimeUSec() - client.last_active_);
     }
 
+    /*
+     * Publish the entries which joined and left since the last call, if any, and a full
+     * snapshot every full_interval_, for the subscribers which joined in the meantime
+     */
     void broadcastActive()
     {
         ActiveNodes msg;
-        for(auto it = clients_.begin(); it != clients_.end(); ++it)
+        int64_t now = hardwareTimeUSec();
+        if(now - last_full_ >= full_interval_)
         {
-            NodeActivity act;
-            act.host_name = it->first;
-            //TODO: act.node_name = ...;
-            //TODO: act.service_name = ...;
-            act.last_active = it->second.last_active_;
-            msg.nodes.push_back(act);
+            last_full_ = now;
+            msg.full = true;
+            for(auto &x : clients_)
+            {
+                msg.nodes.emplace_back();
+                fillActivity(x.first, msg.nodes.back());
+            }
         }
+        else
+        {
+            if(joined_.empty() && left_.empty()) return;
+            msg.full = false;
+            for(auto &h : joined_)
+            {
+                // it may have left since
+                if(!clients_.count(h)) continue;
+                msg.nodes.emplace_back();
+                fillActivity(h, msg.nodes.back());
+            }
+            msg.left = left_;
+        }
+        joined_.clear();
+        left_.clear();
         active_nodes_pub_.publish(msg);
     }
 
@@ -121,10 +456,53 @@ protected:
     struct Client
     {
         std::unique_ptr<b0::ServiceClient> cli_;
+        std::string node_name_;
+        std::string service_name_;
+        //! Time of the last beacon (hardware time)
         int64_t last_active_;
+        //! The last beacon, with the labels and the load
+        Beacon beacon_;
+        //! When processes were placed on this host (hardware time), for the ones its load does not show yet
+        std::vector<int64_t> placed_;
     };
 
+    /*
+     * The load of a host, for comparing hosts: the highest of the CPU usage (counting one
+     * CPU for each process placed recently) and of the memory usage, in percents, and the
+     * network rate for the ties. A host not reporting its CPU usage counts as busy.
+     */
+    static std::pair<double, double> hostLoad(const Client &client)
+    {
+        const Beacon &b = client.beacon_;
+        double cpu = b.cpu_usage ? *b.cpu_usage : 1.0;
+        cpu += double(client.placed_.size()) / std::max(1, b.num_cpus ? *b.num_cpus : 1);
+        double mem = 0;
+        if(b.memory_total && b.memory_available && *b.memory_total > 0)
+            mem = 1.0 - double(*b.memory_available) / double(*b.memory_total);
+        double net = (b.net_rx_rate ? *b.net_rx_rate : 0) + (b.net_tx_rate ? *b.net_tx_rate : 0);
+        return std::make_pair(std::round(100 * std::max(cpu, mem)), net);
+    }
+
     std::map<std::string, Client> clients_;
+
+    //! The entries by time of their last beacon, to expire them in order
+    std::set<std::pair<int64_t, std::string> > expiry_;
+
+    //! The entries which joined and left since the last broadcastActive()
+    std::vector<std::string> joined_, left_;
+
+    //! Time of the last full snapshot (hardware time)
+    int64_t last_full_{0};
+
+    //! Period of the full snapshots (in microseconds)
+    int64_t full_interval_{5000000};
+
+    //! Time after which an entry without beacons is removed (in microseconds)
+    int64_t inactive_timeout_{1000000};
+
+    //! Time after which the load of a host accounts for a process placed on it (in microseconds; the load is sampled every second)
+    int64_t placement_memory_{2000000};
+
     b0::ServiceServer srv_;
     b0::Subscriber beacon_sub_;
     b0::Publisher active_nodes_pub_;
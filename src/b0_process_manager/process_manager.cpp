@@ -1,18 +1,39 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
 #include <map>
+#include <sstream>
 #include <b0/node.h>
 #include <b0/service_server.h>
 #include <b0/publisher.h>
+#include <b0/exceptions.h>
+#include <b0/utils/thread_config.h>
+#include <b0/logger/logger.h>
 #include "protocol.h"
 #ifdef HAVE_BOOST_PROCESS
 #ifdef HAVE_POSIX_SIGNALS
 #include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #endif // HAVE_POSIX_SIGNALS
+#ifdef __linux__
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#endif // __linux__
 #include <boost/process.hpp>
+#include <boost/process/extend.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/format.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/dll.hpp>
+#include <boost/thread.hpp>
 
 namespace bp = boost::process;
 
@@ -26,13 +47,193 @@ class ProcessManager;
 
 ProcessManager *instance = nullptr;
 
+#ifdef HAVE_POSIX_SIGNALS
+//! Written to by the SIGCHLD handler, to wake up the thread monitoring the children
+int sigchld_pipe[2] = {-1, -1};
+#endif // HAVE_POSIX_SIGNALS
+
+/*
+ * The settings of a StartProcessRequest applied in the child process, after fork() and
+ * before exec(), so that the program runs with them from its first instruction.
+ *
+ * Everything is prepared in the parent: only system calls are made in the child.
+ */
+struct SpawnSettings : bp::extend::handler
+{
+#ifdef HAVE_POSIX_SIGNALS
+    template<class Executor>
+    void on_exec_setup(Executor &exec) const
+    {
+        // SIGCHLD is blocked in the process manager (see main()), and the mask is inherited
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGCHLD);
+        sigprocmask(SIG_UNBLOCK, &set, nullptr);
+        applyLinuxSettings(exec);
+    }
+#else
+    template<class Executor>
+    void on_exec_setup(Executor &exec) const
+    {
+        applyLinuxSettings(exec);
+    }
+#endif // HAVE_POSIX_SIGNALS
+
+    template<class Executor>
+    void applyLinuxSettings(Executor &exec) const
+    {
+#ifdef __linux__
+        // first, so that the limits apply to everything the process does
+        if(cgroup_procs_fd >= 0 && ::write(cgroup_procs_fd, "0", 1) != 1)
+            fail(exec, "cannot move the process to its cgroup");
+        if(set_affinity && sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+            fail(exec, "cannot set the CPU affinity");
+        if(set_sched)
+        {
+            sched_param param;
+            param.sched_priority = sched_priority;
+            if(sched_setscheduler(0, sched_policy, &param) != 0)
+                fail(exec, "cannot set the scheduling policy");
+        }
+        if(set_nice && setpriority(PRIO_PROCESS, 0, nice) != 0)
+            fail(exec, "cannot set the nice value");
+#endif // __linux__
+    }
+
+#ifdef __linux__
+    //! The CPU affinity (if set_affinity)
+    cpu_set_t cpus;
+    bool set_affinity{false};
+
+    //! The nice value (if set_nice)
+    int nice{0};
+    bool set_nice{false};
+
+    //! The scheduling policy and priority (if set_sched)
+    int sched_policy{SCHED_OTHER};
+    int sched_priority{0};
+    bool set_sched{false};
+
+    //! The cgroup.procs file of the cgroup of the process, open for writing (-1: none)
+    int cgroup_procs_fd{-1};
+
+    //! Report the error to the parent (which throws bp::process_error) and exit
+    template<class Executor>
+    static void fail(Executor &exec, const char *msg)
+    {
+        exec.set_error(std::error_code(errno, std::system_category()), msg);
+        ::_exit(EXIT_FAILURE);
+    }
+#endif // __linux__
+};
+
+/*
+ * The load of the host, sampled for the beacons (see Beacon): CPU usage since the previous
+ * sample, memory, and network rates since the previous sample. Only implemented on Linux
+ * (from /proc); elsewhere the beacons carry no load.
+ */
+class HostLoad
+{
+public:
+    //! Sample the load (now is the hardware time, for the rates)
+    void sample(int64_t now)
+    {
+#ifdef __linux__
+
+        uint64_t total = 0, idle = 0;
+        {
+            // first line: "cpu  user nice system idle iowait irq softirq steal guest guest_nice"
+            std::ifstream f("/proc/stat");
+            std::string cpu;
+            f >> cpu;
+            for(int i = 0; i < 8 && f; i++)
+            {
+                uint64_t v = 0;
+                f >> v;
+                total += v;
+                if(i == 3 || i == 4) idle += v;
+            }
+        }
+        if(last_total_ && total > last_total_)
+            cpu_usage_ = 1.0 - double(idle - last_idle_) / double(total - last_total_);
+        last_total_ = total;
+        last_idle_ = idle;
+
+        {
+            std::ifstream f("/proc/meminfo");
+            std::string key;
+            int64_t value;
+            std::string unit;
+            while(f >> key >> value >> unit)
+            {
+                if(key == "MemTotal:") memory_total_ = value * 1024;
+                else if(key == "MemAvailable:") memory_available_ = value * 1024;
+            }
+        }
+
+        uint64_t rx = 0, tx = 0;
+        {
+            // two header lines, then "iface: rx_bytes packets errs drop fifo frame compressed multicast tx_bytes ..."
+            std::ifstream f("/proc/net/dev");
+            std::string line;
+            for(int i = 0; i < 2; i++) std::getline(f, line);
+            while(std::getline(f, line))
+            {
+                size_t colon = line.find(':');
+                if(colon == std::string::npos) continue;
+                if(boost::algorithm::trim_copy(line.substr(0, colon)) == "lo") continue;
+                std::istringstream ss(line.substr(colon + 1));
+                uint64_t v[9] = {0};
+                for(int i = 0; i < 9; i++) ss >> v[i];
+                rx += v[0];
+                tx += v[8];
+            }
+        }
+        if(last_sample_ && now > last_sample_)
+        {
+            double dt = double(now - last_sample_) / 1e6;
+            net_rx_rate_ = double(rx - last_rx_) / dt;
+            net_tx_rate_ = double(tx - last_tx_) / dt;
+        }
+        last_rx_ = rx;
+        last_tx_ = tx;
+        last_sample_ = now;
+
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        if(n > 0) num_cpus_ = int(n);
+#endif // __linux__
+    }
+
+    //! Copy the last sample into the beacon
+    void fill(Beacon &beacon) const
+    {
+        beacon.cpu_usage = cpu_usage_;
+        beacon.num_cpus = num_cpus_;
+        beacon.memory_total = memory_total_;
+        beacon.memory_available = memory_available_;
+        beacon.net_rx_rate = net_rx_rate_;
+        beacon.net_tx_rate = net_tx_rate_;
+    }
+
+private:
+    boost::optional<double> cpu_usage_;
+    boost::optional<int> num_cpus_;
+    boost::optional<int64_t> memory_total_, memory_available_;
+    boost::optional<double> net_rx_rate_, net_tx_rate_;
+    uint64_t last_total_{0}, last_idle_{0}, last_rx_{0}, last_tx_{0};
+    int64_t last_sample_{0};
+};
+
 class ProcessManager : public b0::Node
 {
 public:
-    ProcessManager()
+    ProcessManager(const std::string &cgroup_parent, const std::vector<std::string> &labels)
         : Node("process_manager@%h"),
           beacon_pub_(this, "process_manager/beacon"),
-          srv_(this, "%n/control", &ProcessManager::handleRequest, this)
+          events_pub_(this, "%n/events"),
+          srv_(this, "%n/control", &ProcessManager::handleRequest, this),
+          cgroup_parent_(cgroup_parent),
+          labels_(labels)
     {
         if(instance)
             throw std::runtime_error("ProcessManager constructed multiple times");
@@ -40,6 +241,45 @@ public:
         instance = this;
     }
 
+    void init() override
+    {
+        Node::init();
+
+#ifdef __linux__
+        if(!cgroup_parent_.empty())
+        {
+            // the controllers must be enabled for the children of the parent cgroup
+            // (this fails if they already are, or if they are not available)
+            try
+            {
+                writeFile(cgroup_parent_ + "/cgroup.subtree_control", "+cpu +memory");
+            }
+            catch(std::exception &ex)
+            {
+                warn("%s", ex.what());
+            }
+        }
+#endif // __linux__
+
+#ifdef HAVE_POSIX_SIGNALS
+        monitor_thread_ = boost::thread(&ProcessManager::monitorLoop, this);
+#endif // HAVE_POSIX_SIGNALS
+    }
+
+    void cleanup() override
+    {
+#ifdef HAVE_POSIX_SIGNALS
+        if(monitor_thread_.joinable())
+        {
+            monitor_stop_ = true;
+            ssize_t r = ::write(sigchld_pipe[1], "q", 1);
+            (void)r;
+            monitor_thread_.join();
+        }
+#endif // HAVE_POSIX_SIGNALS
+        Node::cleanup();
+    }
+
     ~ProcessManager()
     {
         instance = nullptr;
@@ -50,6 +290,7 @@ public:
         if(0) {}
 #define HANDLER(N) else if(req.N) { rep.N.emplace(); handle_##N(*req.N, *rep.N); }
         HANDLER(start_process)
+        HANDLER(start_processes)
         HANDLER(stop_process)
         HANDLER(query_process_status)
         HANDLER(list_active_processes)
@@ -69,15 +310,153 @@ public:
             rep.error_message = "permission denied";
             return;
         }
-        auto c = new bp::child(req.path, req.args);
-        children_[c->id()].child_ = std::shared_ptr<bp::child>(c);
-        info("Process %d (%s) started.", c->id(), req.path);
-        rep.success = true;
-        rep.pid = c->id();
+
+        SpawnSettings settings;
+        std::string cgroup;
+        try
+        {
+            prepareSettings(req, settings, cgroup);
+
+            bp::environment env = boost::this_process::environment();
+            for(auto &e : req.env)
+                env[e.first] = e.second;
+
+            // held until the child is registered, so that the monitor sees it when it exits
+            boost::mutex::scoped_lock lock(children_mutex_);
+            std::shared_ptr<bp::child> c;
+            try
+            {
+                c.reset(new bp::child(req.path, req.args, env, settings));
+            }
+            catch(...)
+            {
+                releaseSettings(settings, cgroup, true);
+                throw;
+            }
+            releaseSettings(settings, cgroup, false);
+            Child &child = children_[c->id()];
+            child.child_ = c;
+            child.cgroup_ = cgroup;
+            info("Process %d (%s) started.", c->id(), req.path);
+            rep.success = true;
+            rep.pid = c->id();
+        }
+        catch(std::exception &ex)
+        {
+            error("Failed to launch %s: %s", req.path, ex.what());
+            rep.success = false;
+            rep.error_message = ex.what();
+        }
+    }
+
+    void handle_start_processes(const StartProcessesRequest &req, StartProcessesResponse &rep)
+    {
+        rep.processes.resize(req.processes.size());
+        for(size_t i = 0; i < req.processes.size(); i++)
+            handle_start_process(req.processes[i], rep.processes[i]);
     }
 
+    /*
+     * Validate the spawn settings of a request and prepare them; create the cgroup
+     * of the process if there are limits.
+     */
+    void prepareSettings(const StartProcessRequest &req, SpawnSettings &settings, std::string &cgroup)
+    {
+        ThreadConfig config;
+        config.cpus = req.cpus;
+        config.policy = req.sched_policy;
+        config.priority = req.sched_priority;
+        config.validate();
+        if(req.nice && (*req.nice < -20 || *req.nice > 19))
+            throw exception::ArgumentError(std::to_string(*req.nice), "nice");
+        if(req.cpu_limit && *req.cpu_limit <= 0)
+            throw exception::ArgumentError(std::to_string(*req.cpu_limit), "cpu_limit");
+        if(req.memory_limit && *req.memory_limit <= 0)
+            throw exception::ArgumentError(std::to_string(*req.memory_limit), "memory_limit");
+
+#ifdef __linux__
+        if(!req.cpus.empty())
+        {
+            CPU_ZERO(&settings.cpus);
+            for(int cpu : req.cpus)
+            {
+                if(cpu >= CPU_SETSIZE)
+                    throw exception::ArgumentError(std::to_string(cpu), "cpus");
+                CPU_SET(cpu, &settings.cpus);
+            }
+            settings.set_affinity = true;
+        }
+        if(!req.sched_policy.empty())
+        {
+            settings.sched_policy = req.sched_policy == "fifo" ? SCHED_FIFO : req.sched_policy == "rr" ? SCHED_RR : SCHED_OTHER;
+            settings.sched_priority = settings.sched_policy == SCHED_OTHER ? 0 : req.sched_priority;
+            settings.set_sched = true;
+        }
+        if(req.nice)
+        {
+            settings.nice = *req.nice;
+            settings.set_nice = true;
+        }
+        if(req.cpu_limit || req.memory_limit)
+        {
+            if(cgroup_parent_.empty())
+                throw exception::Exception("cpu_limit and memory_limit need a parent cgroup (see the --cgroup-parent option)");
+            cgroup = (boost::format("%s/b0-%d") % cgroup_parent_ % next_cgroup_++).str();
+            if(mkdir(cgroup.c_str(), 0755) != 0 && errno != EEXIST)
+                throw exception::Exception((boost::format("cannot create cgroup %s: %s") % cgroup % std::strerror(errno)).str());
+            try
+            {
+                // cpu.max is "<quota> <period>", in microseconds
+                if(req.cpu_limit)
+                    writeFile(cgroup + "/cpu.max", (boost::format("%d 100000") % int64_t(*req.cpu_limit * 100000)).str());
+                if(req.memory_limit)
+                    writeFile(cgroup + "/memory.max", std::to_string(*req.memory_limit));
+                settings.cgroup_procs_fd = open((cgroup + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+                if(settings.cgroup_procs_fd < 0)
+                    throw exception::Exception((boost::format("cannot open %s/cgroup.procs: %s") % cgroup % std::strerror(errno)).str());
+            }
+            catch(...)
+            {
+                rmdir(cgroup.c_str());
+                throw;
+            }
+        }
+#else
+        if(!req.cpus.empty() || !req.sched_policy.empty() || req.nice || req.cpu_limit || req.memory_limit)
+            throw exception::Exception("cpus, nice, sched_policy, cpu_limit and memory_limit are only supported on Linux");
+#endif // __linux__
+    }
+
+    //! Release what prepareSettings() allocated, once the process is spawned (or failed to)
+    void releaseSettings(SpawnSettings &settings, std::string &cgroup, bool failed)
+    {
+#ifdef __linux__
+        if(settings.cgroup_procs_fd >= 0)
+            close(settings.cgroup_procs_fd);
+        settings.cgroup_procs_fd = -1;
+        if(failed && !cgroup.empty())
+        {
+            rmdir(cgroup.c_str());
+            cgroup.clear();
+        }
+#endif // __linux__
+    }
+
+#ifdef __linux__
+    static void writeFile(const std::string &path, const std::string &value)
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        bool ok = fd >= 0 && ::write(fd, value.data(), value.size()) == ssize_t(value.size());
+        int err = errno;
+        if(fd >= 0) close(fd);
+        if(!ok)
+            throw exception::Exception((boost::format("cannot write '%s' to %s: %s") % value % path % std::strerror(err)).str());
+    }
+#endif // __linux__
+
     void handle_stop_process(const StopProcessRequest &req, StopProcessResponse &rep)
     {
+        boost::mutex::scoped_lock lock(children_mutex_);
         auto it = children_.find(req.pid);
         if(it == children_.end())
         {
@@ -87,6 +466,11 @@ public:
             return;
         }
         auto c = it->second.child_;
+        if(it->second.exited_)
+        {
+            rep.success = true;
+            return;
+        }
 #ifdef HAVE_POSIX_SIGNALS
         info("Sending SIGINT to process %d...", c->id());
         kill(c->id(), SIGINT);
@@ -100,6 +484,7 @@ public:
 
     void handle_query_process_status(const QueryProcessStatusRequest &req, QueryProcessStatusResponse &rep)
     {
+        boost::mutex::scoped_lock lock(children_mutex_);
         auto it = children_.find(req.pid);
         if(it == children_.end())
         {
@@ -107,19 +492,20 @@ public:
             rep.error_message = "no such pid";
             return;
         }
-        auto c = it->second.child_;
-        rep.running = c->running();
-        if(!rep.running)
-            rep.exit_code = c->exit_code();
+        // the state is kept up to date by reapChildren()
+        rep.running = !it->second.exited_;
+        if(!*rep.running)
+            rep.exit_code = it->second.exit_code_;
         rep.success = true;
     }
 
     void handle_list_active_processes(const ListActiveProcessesRequest &req, ListActiveProcessesResponse &rep)
     {
+        boost::mutex::scoped_lock lock(children_mutex_);
         for(auto &p : children_)
         {
-            auto c = p.second.child_;
-            rep.pids.push_back(c->id());
+            if(p.second.exited_) continue;
+            rep.pids.push_back(p.first);
         }
     }
 
@@ -147,38 +533,130 @@ public:
         return true;
     }
 
-    void cleanup()
+    /*
+     * Collect the children which have exited, and publish their ProcessExit events.
+     *
+     * With POSIX signals, this runs in the monitor thread, woken up by SIGCHLD, and is the
+     * only place where the children are waited for; otherwise it polls from spinOnce().
+     */
+    void reapChildren(b0::logger::LogInterface &log)
     {
-        for(auto it = children_.begin(); it != children_.end(); )
+        std::vector<ProcessExit> exits;
         {
-            auto c = it->second.child_;
-            if(c->running())
+            boost::mutex::scoped_lock lock(children_mutex_);
+            for(auto &p : children_)
             {
+                Child &child = p.second;
+                if(child.exited_) continue;
+                ProcessExit e;
+                e.pid = p.first;
 #ifdef HAVE_POSIX_SIGNALS
-                // after 5s from SIGINT, try with SIGTERM
-                if(it->second.int_requested_ && timeUSec() - it->second.int_requested_ > 5000000)
+                int status;
+                if(waitpid(p.first, &status, WNOHANG) != p.first) continue;
+                if(WIFSIGNALED(status))
                 {
-                    warn("Escalating to SIGTERM for process %d...", c->id());
-                    kill(c->id(), SIGTERM);
-                    it->second.term_requested_ = timeUSec();
+                    e.signal = WTERMSIG(status);
+                    e.exit_code = 128 + *e.signal;
                 }
+                else e.exit_code = WEXITSTATUS(status);
+                // waited for here: boost must not wait for it again
+                child.child_->detach();
+#else
+                if(child.child_->running()) continue;
+                child.child_->wait();
+                e.exit_code = child.child_->exit_code();
+#endif // HAVE_POSIX_SIGNALS
+                child.exited_ = true;
+                child.exit_code_ = e.exit_code;
+                child.exit_time_ = hardwareTimeUSec();
+#ifdef __linux__
+                // the cgroup can be removed once it has no processes
+                if(!child.cgroup_.empty() && rmdir(child.cgroup_.c_str()) != 0)
+                    log.warn("Cannot remove cgroup %s: %s", child.cgroup_, std::strerror(errno));
+#endif // __linux__
+                exits.push_back(e);
+            }
+        }
 
-                // after 5s from SIGTERM, try with SIGKILL
-                if(it->second.term_requested_ && timeUSec() - it->second.term_requested_ > 5000000)
+        for(auto &e : exits)
+        {
+            if(e.signal)
+                log.info("Process %d killed by signal %d.", e.pid, *e.signal);
+            else
+                log.info("Process %d finished with exit code %d.", e.pid, e.exit_code);
+            e.host_name = hostname();
+            e.node_name = getName();
+            e.time_usec = timeUSec();
+            events_pub_.publish(e);
+        }
+    }
+
+#ifdef HAVE_POSIX_SIGNALS
+    //! Wait for SIGCHLD (through sigchld_pipe), and reap the children
+    void monitorLoop()
+    {
+        b0::logger::LocalLogger logger(this);
+
+        // SIGCHLD is only handled by this thread, so that it interrupts no other
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGCHLD);
+        pthread_sigmask(SIG_UNBLOCK, &set, nullptr);
+
+        // the children which exited before the thread started
+        reapChildren(logger);
+        while(!monitor_stop_)
+        {
+            pollfd pfd;
+            pfd.fd = sigchld_pipe[0];
+            pfd.events = POLLIN;
+            if(poll(&pfd, 1, -1) < 0)
+                continue; // EINTR
+            char buf[64];
+            while(::read(sigchld_pipe[0], buf, sizeof(buf)) > 0) {}
+            reapChildren(logger);
+        }
+    }
+#endif // HAVE_POSIX_SIGNALS
+
+    //! Escalate the stop requests not honored, and forget the children which exited long ago
+    void checkChildren()
+    {
+        boost::mutex::scoped_lock lock(children_mutex_);
+        int64_t now = hardwareTimeUSec();
+        for(auto it = children_.begin(); it != children_.end(); )
+        {
+            Child &child = it->second;
+            if(child.exited_)
+            {
+                // kept for a while so that its exit code can be queried
+                if(now - child.exit_time_ > 60000000)
                 {
-                    warn("Escalating to SIGKILL for process %d...", c->id());
-                    c->terminate();
+                    it = children_.erase(it);
+                    continue;
                 }
-#endif
-
-                ++it;
             }
+#ifdef HAVE_POSIX_SIGNALS
             else
             {
-                c->wait();
-                info("Process %d finished with exit code %d.", c->id(), c->exit_code());
-                it = children_.erase(it);
+                // after 5s from SIGINT, try with SIGTERM
+                if(child.int_requested_ && !child.term_requested_ && timeUSec() - child.int_requested_ > 5000000)
+                {
+                    warn("Escalating to SIGTERM for process %d...", it->first);
+                    kill(it->first, SIGTERM);
+                    child.term_requested_ = timeUSec();
+                }
+
+                // after 5s from SIGTERM, try with SIGKILL
+                if(child.term_requested_ && !child.kill_requested_ && timeUSec() - child.term_requested_ > 5000000)
+                {
+                    warn("Escalating to SIGKILL for process %d...", it->first);
+                    kill(it->first, SIGKILL);
+                    child.kill_requested_ = true;
+                }
             }
+#endif
+            ++it;
         }
     }
 
@@ -188,23 +666,36 @@ public:
         beacon.host_name = hostname();
         beacon.node_name = getName();
         beacon.service_name = srv_.getName();
+        beacon.labels = labels_;
+        // the load is sampled once per second, and sent with every beacon
+        int64_t now = hardwareTimeUSec();
+        if(now - last_load_sample_ >= 1000000)
+        {
+            last_load_sample_ = now;
+            host_load_.sample(now);
+        }
+        host_load_.fill(beacon);
         beacon_pub_.publish(beacon);
     }
 
     void spinOnce()
     {
         Node::spinOnce();
-        cleanup();
+#ifndef HAVE_POSIX_SIGNALS
+        reapChildren(*this);
+#endif
+        checkChildren();
         sendBeacon();
     }
 
     void killChildren(int signal)
     {
-        for(auto it = children_.begin(); it != children_.end(); )
+        // called from a signal handler: children_mutex_ cannot be taken
+        for(auto it = children_.begin(); it != children_.end(); ++it)
         {
-            auto c = it->second.child_;
 #ifdef HAVE_POSIX_SIGNALS
-            kill(c->id(), signal);
+            if(!it->second.exited_)
+                kill(it->first, signal);
 #endif
         }
     }
@@ -215,11 +706,47 @@ protected:
         std::shared_ptr<bp::child> child_;
         int64_t int_requested_ = 0;
         int64_t term_requested_ = 0;
+        bool kill_requested_ = false;
+        //! The cgroup created for the process (empty if none)
+        std::string cgroup_;
+        //! True once the process has exited (see reapChildren())
+        bool exited_ = false;
+        int exit_code_ = 0;
+        //! When it exited (hardware time)
+        int64_t exit_time_ = 0;
     };
 
     b0::ServiceServer srv_;
     b0::Publisher beacon_pub_;
+
+    //! Publishes a ProcessExit when a child exits
+    b0::Publisher events_pub_;
+
+    //! Protects children_, which the monitor thread updates
+    boost::mutex children_mutex_;
+
     std::map<pid_t, Child> children_;
+
+#ifdef HAVE_POSIX_SIGNALS
+    //! Reaps the children as soon as they exit (see monitorLoop())
+    boost::thread monitor_thread_;
+    std::atomic<bool> monitor_stop_{false};
+#endif // HAVE_POSIX_SIGNALS
+
+    //! The cgroup (v2) directory under which the processes with limits get their cgroup
+    std::string cgroup_parent_;
+
+    //! Number of the next cgroup created
+    int next_cgroup_{0};
+
+    //! The labels sent in the beacons
+    std::vector<std::string> labels_;
+
+    //! Samples the load of the host
+    HostLoad host_load_;
+
+    //! Time of the last load sample (hardware time)
+    int64_t last_load_sample_{0};
 };
 
 } // namespace process_manager
@@ -232,9 +759,40 @@ void signalHandler(int signum)
         b0::process_manager::instance->killChildren(signum);
 }
 
+#ifdef HAVE_POSIX_SIGNALS
+void sigchldHandler(int)
+{
+    int saved_errno = errno;
+    ssize_t r = write(b0::process_manager::sigchld_pipe[1], "c", 1);
+    (void)r;
+    errno = saved_errno;
+}
+#endif // HAVE_POSIX_SIGNALS
+
 void registerSignalHandlers()
 {
 #ifdef HAVE_POSIX_SIGNALS
+    int *p = b0::process_manager::sigchld_pipe;
+    if(pipe(p) != 0)
+        throw std::runtime_error("cannot create the SIGCHLD pipe");
+    for(int i = 0; i < 2; i++)
+    {
+        fcntl(p[i], F_SETFL, fcntl(p[i], F_GETFL) | O_NONBLOCK);
+        fcntl(p[i], F_SETFD, FD_CLOEXEC);
+    }
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigchldHandler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, nullptr);
+
+    // blocked in all the threads (which inherit the mask) but the monitor thread
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
     signal(SIGKILL, signalHandler);
@@ -248,8 +806,12 @@ void registerSignalHandlers()
 int main(int argc, char **argv)
 {
     registerSignalHandlers();
+    std::string cgroup_parent;
+    std::vector<std::string> labels;
+    b0::addOptionString("cgroup-parent,g", "cgroup (v2) directory where the processes with CPU or memory limits get their own cgroup, e.g. /sys/fs/cgroup/b0 (must be writable by the process manager)", &cgroup_parent);
+    b0::addOptionStringVector("label,l", "label of this host, matched by the placement constraints of the HUB (can be repeated)", &labels);
     b0::init(argc, argv);
-    b0::process_manager::ProcessManager node;
+    b0::process_manager::ProcessManager node(cgroup_parent, labels);
     node.init();
     node.spin();
     node.cleanup();
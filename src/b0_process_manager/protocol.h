@@ -1,6 +1,7 @@
 #ifndef B0__PROCESS_MANAGER__PROTOCOL_H__INCLUDED
 #define B0__PROCESS_MANAGER__PROTOCOL_H__INCLUDED
 
+#include <map>
 #include <string>
 #include <b0/message/message.h>
 
@@ -16,7 +17,30 @@ public:
     std::string path;
     std::vector<std::string> args;
 
-    std::string type() const override {return "b0::process_manager::StartProcessRequest";}
+    //! CPUs the process may run on (empty: unchanged)
+    std::vector<int> cpus;
+
+    //! Nice value of the process (-20 to 19)
+    boost::optional<int> nice;
+
+    //! Scheduling policy of the process: "other", "fifo" or "rr" (empty: unchanged)
+    std::string sched_policy;
+
+    //! Priority, for the "fifo" and "rr" policies
+    int sched_priority{0};
+
+    //! Maximum CPU usage in a cgroup, in CPUs (e.g. 1.5)
+    boost::optional<double> cpu_limit;
+
+    //! Maximum memory usage in a cgroup, in bytes
+    boost::optional<int64_t> memory_limit;
+
+    //! Environment variables to set, in addition to the process manager's
+    std::map<std::string, std::string> env;
+
+    static constexpr const char *b0_type = "b0::process_manager::StartProcessRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 class StartProcessResponse : public b0::message::Message
@@ -26,7 +50,30 @@ public:
     boost::optional<std::string> error_message;
     boost::optional<int> pid;
 
-    std::string type() const override {return "b0::process_manager::StartProcessResponse";}
+    static constexpr const char *b0_type = "b0::process_manager::StartProcessResponse";
+
+    std::string type() const override {return b0_type;}
+};
+
+//! Start several processes at once (answered with one StartProcessResponse per process, in the same order)
+class StartProcessesRequest : public b0::message::Message
+{
+public:
+    std::vector<StartProcessRequest> processes;
+
+    static constexpr const char *b0_type = "b0::process_manager::StartProcessesRequest";
+
+    std::string type() const override {return b0_type;}
+};
+
+class StartProcessesResponse : public b0::message::Message
+{
+public:
+    std::vector<StartProcessResponse> processes;
+
+    static constexpr const char *b0_type = "b0::process_manager::StartProcessesResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 class StopProcessRequest : public b0::message::Message
@@ -34,7 +81,9 @@ class StopProcessRequest : public b0::message::Message
 public:
     int pid;
 
-    std::string type() const override {return "b0::process_manager::StopProcessRequest";}
+    static constexpr const char *b0_type = "b0::process_manager::StopProcessRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 class StopProcessResponse : public b0::message::Message
@@ -43,7 +92,9 @@ public:
     bool success;
     boost::optional<std::string> error_message;
 
-    std::string type() const override {return "b0::process_manager::StopProcessResponse";}
+    static constexpr const char *b0_type = "b0::process_manager::StopProcessResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 class QueryProcessStatusRequest : public b0::message::Message
@@ -51,7 +102,9 @@ class QueryProcessStatusRequest : public b0::message::Message
 public:
     int pid;
 
-    std::string type() const override {return "b0::process_manager::QueryProcessStatusRequest";}
+    static constexpr const char *b0_type = "b0::process_manager::QueryProcessStatusRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 class QueryProcessStatusResponse : public b0::message::Message
@@ -62,14 +115,18 @@ public:
     boost::optional<bool> running;
     boost::optional<int> exit_code;
 
-    std::string type() const override {return "b0::process_manager::QueryProcessStatusResponse";}
+    static constexpr const char *b0_type = "b0::process_manager::QueryProcessStatusResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 class ListActiveProcessesRequest : public b0::message::Message
 {
 public:
 
-    std::string type() const override {return "b0::process_manager::ListActiveProcessesRequest";}
+    static constexpr const char *b0_type = "b0::process_manager::ListActiveProcessesRequest";
+
+    std::string type() const override {return b0_type;}
 };
 
 class ListActiveProcessesResponse : public b0::message::Message
@@ -77,35 +134,151 @@ class ListActiveProcessesResponse : public b0::message::Message
 public:
     std::vector<int> pids;
 
-    std::string type() const override {return "b0::process_manager::ListActiveProcessesResponse";}
+    static constexpr const char *b0_type = "b0::process_manager::ListActiveProcessesResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 class Request : public b0::message::Message
 {
 public:
     boost::optional<StartProcessRequest> start_process;
+    boost::optional<StartProcessesRequest> start_processes;
     boost::optional<StopProcessRequest> stop_process;
     boost::optional<QueryProcessStatusRequest> query_process_status;
     boost::optional<ListActiveProcessesRequest> list_active_processes;
 
-    std::string type() const override {return "b0::process_manager::Request";}
+    static constexpr const char *b0_type = "b0::process_manager::Request";
+
+    std::string type() const override {return b0_type;}
 };
 
 class Response : public b0::message::Message
 {
 public:
     boost::optional<StartProcessResponse> start_process;
+    boost::optional<StartProcessesResponse> start_processes;
     boost::optional<StopProcessResponse> stop_process;
     boost::optional<QueryProcessStatusResponse> query_process_status;
     boost::optional<ListActiveProcessesResponse> list_active_processes;
 
-    std::string type() const override {return "b0::process_manager::Response";}
+    static constexpr const char *b0_type = "b0::process_manager::Response";
+
+    std::string type() const override {return b0_type;}
+};
+
+/*!
+ * Where the HUB may start a process whose host is not given: among the process managers
+ * which have all the labels, run on the host of a publisher of near_topic (if not empty) and
+ * have at least min_memory_available bytes of memory available, the least loaded one
+ */
+class Placement : public b0::message::Message
+{
+public:
+    //! The labels the process manager must have (see its --label option)
+    std::vector<std::string> labels;
+
+    //! If not empty, the topic whose publishers the process must be co-located with
+    std::string near_topic;
+
+    //! Minimum memory available on the host, in bytes
+    int64_t min_memory_available{0};
+
+    static constexpr const char *b0_type = "b0::process_manager::Placement";
+
+    std::string type() const override {return b0_type;}
+};
+
+//! A process of a LaunchRequest
+class LaunchProcess : public b0::message::Message
+{
+public:
+    //! Identifies the process in depends_on (unique within the request)
+    std::string id;
+
+    //! The host of the process manager which starts it (empty: chosen by the HUB, see placement)
+    std::string host_name;
+
+    //! The constraints on the host chosen by the HUB, if host_name is empty
+    boost::optional<Placement> placement;
+
+    //! The program, its arguments and spawn settings
+    StartProcessRequest process;
+
+    //! The ids of the processes which must be ready before this one starts
+    std::vector<std::string> depends_on;
+
+    //! The names of the nodes which must appear in the resolver's graph for the process to be ready (none: ready once started)
+    std::vector<std::string> ready_nodes;
+
+    static constexpr const char *b0_type = "b0::process_manager::LaunchProcess";
+
+    std::string type() const override {return b0_type;}
+};
+
+/*!
+ * Start a set of processes on any hosts, in the order of their dependencies
+ *
+ * The processes are started by levels: first the ones without dependencies, then the ones
+ * depending only on those, and so on. All the processes of a level are started at the same
+ * time (one request to each process manager, sent in parallel), and the next level starts
+ * once all their ready_nodes are in the graph. If a process fails to start or to get ready
+ * in time, the later levels are not started.
+ */
+class LaunchRequest : public b0::message::Message
+{
+public:
+    std::vector<LaunchProcess> processes;
+
+    //! Maximum time to wait for each level to get ready, in seconds
+    double ready_timeout{30};
+
+    static constexpr const char *b0_type = "b0::process_manager::LaunchRequest";
+
+    std::string type() const override {return b0_type;}
+};
+
+//! The outcome of a LaunchProcess
+class LaunchResult : public b0::message::Message
+{
+public:
+    std::string id;
+    //! The host it was started on
+    std::string host_name;
+    bool started{false};
+    bool ready{false};
+    boost::optional<int> pid;
+    boost::optional<std::string> error_message;
+
+    static constexpr const char *b0_type = "b0::process_manager::LaunchResult";
+
+    std::string type() const override {return b0_type;}
+};
+
+class LaunchResponse : public b0::message::Message
+{
+public:
+    bool success;
+    boost::optional<std::string> error_message;
+
+    //! The results, in the order of the request
+    std::vector<LaunchResult> processes;
+
+    static constexpr const char *b0_type = "b0::process_manager::LaunchResponse";
+
+    std::string type() const override {return b0_type;}
 };
 
 class HUBRequest : public Request
 {
 public:
+    //! The target host (not needed for launch, nor with a placement)
     std::string host_name;
+
+    //! The constraints on the host chosen by the HUB (see Placement), if host_name is empty
+    boost::optional<Placement> placement;
+
+    boost::optional<LaunchRequest> launch;
 };
 
 class HUBResponse : public Response
@@ -113,6 +286,10 @@ class HUBResponse : public Response
 public:
     bool success;
     boost::optional<std::string> error_message;
+    boost::optional<LaunchResponse> launch;
+
+    //! The host the request was sent to, if chosen by the HUB (see HUBRequest::placement)
+    boost::optional<std::string> host_name;
 
     inline void operator=(const Response &rhs)
     {
@@ -127,7 +304,46 @@ public:
     std::string node_name;
     std::string service_name;
 
-    std::string type() const override {return "b0::process_manager::Beacon";}
+    //! The labels of the process manager, for the placement of processes (see Placement)
+    std::vector<std::string> labels;
+
+    //! Fraction of the time the CPUs were busy during the last second (if known)
+    boost::optional<double> cpu_usage;
+
+    //! Number of CPUs of the host
+    boost::optional<int> num_cpus;
+
+    //! Memory of the host, and memory available, in bytes (if known)
+    boost::optional<int64_t> memory_total;
+    boost::optional<int64_t> memory_available;
+
+    //! Bytes received and sent per second by the network interfaces (but loopback) during the last second (if known)
+    boost::optional<double> net_rx_rate;
+    boost::optional<double> net_tx_rate;
+
+    static constexpr const char *b0_type = "b0::process_manager::Beacon";
+
+    std::string type() const override {return b0_type;}
+};
+
+/*!
+ * Published by the process manager on "<node name>/events" when one of its children exits
+ */
+class ProcessExit : public b0::message::Message
+{
+public:
+    std::string host_name;
+    std::string node_name;
+    int pid;
+    //! The exit code (128 + the signal number if killed by a signal)
+    int exit_code;
+    //! The signal which killed the process, if any
+    boost::optional<int> signal;
+    int64_t time_usec;
+
+    static constexpr const char *b0_type = "b0::process_manager::ProcessExit";
+
+    std::string type() const override {return b0_type;}
 };
 
 class NodeActivity : public b0::message::Message
@@ -138,15 +354,32 @@ public:
     std::string service_name;
     int64_t last_active;
 
-    std::string type() const override {return "b0::process_manager::NodeActivity";}
+    static constexpr const char *b0_type = "b0::process_manager::NodeActivity";
+
+    std::string type() const override {return b0_type;}
 };
 
+/*!
+ * Published by the HUB on "process_manager_hub/active_nodes"
+ *
+ * When full is true, nodes lists all the active process managers (a snapshot, sent
+ * periodically); otherwise nodes lists the ones which joined and left the ones which left
+ * since the previous message, and the message is sent only when something changed.
+ */
 class ActiveNodes : public b0::message::Message
 {
 public:
     std::vector<NodeActivity> nodes;
 
-    std::string type() const override {return "b0::process_manager::ActiveNodes";}
+    //! True if nodes lists all the active process managers
+    bool full{true};
+
+    //! Host names of the process managers which left (if not full)
+    std::vector<std::string> left;
+
+    static constexpr const char *b0_type = "b0::process_manager::ActiveNodes";
+
+    std::string type() const override {return b0_type;}
 };
 
 } // namespace process_manager
@@ -165,6 +398,22 @@ struct default_codec_t<b0::process_manager::StartProcessRequest> {
         auto codec = codec::object<b0::process_manager::StartProcessRequest>();
         codec.required("path", &b0::process_manager::StartProcessRequest::path);
         codec.required("args", &b0::process_manager::StartProcessRequest::args);
+        codec.optional("cpus", &b0::process_manager::StartProcessRequest::cpus);
+        codec.optional("nice", &b0::process_manager::StartProcessRequest::nice);
+        codec.optional("sched_policy", &b0::process_manager::StartProcessRequest::sched_policy);
+        codec.optional("sched_priority", &b0::process_manager::StartProcessRequest::sched_priority);
+        codec.optional("cpu_limit", &b0::process_manager::StartProcessRequest::cpu_limit);
+        codec.optional("memory_limit", &b0::process_manager::StartProcessRequest::memory_limit);
+        codec.optional("env", &b0::process_manager::StartProcessRequest::env);
+        return codec;
+    }
+};
+
+template <>
+struct default_codec_t<b0::process_manager::StartProcessesRequest> {
+    static codec::object_t<b0::process_manager::StartProcessesRequest> codec() {
+        auto codec = codec::object<b0::process_manager::StartProcessesRequest>();
+        codec.required("processes", &b0::process_manager::StartProcessesRequest::processes);
         return codec;
     }
 };
@@ -200,6 +449,7 @@ struct default_codec_t<b0::process_manager::Request> {
     static codec::object_t<b0::process_manager::Request> codec() {
         auto codec = codec::object<b0::process_manager::Request>();
         codec.optional("start_process", &b0::process_manager::Request::start_process);
+        codec.optional("start_processes", &b0::process_manager::Request::start_processes);
         codec.optional("stop_process", &b0::process_manager::Request::stop_process);
         codec.optional("query_process_status", &b0::process_manager::Request::query_process_status);
         codec.optional("list_active_processes", &b0::process_manager::Request::list_active_processes);
@@ -207,12 +457,50 @@ struct default_codec_t<b0::process_manager::Request> {
     }
 };
 
+template <>
+struct default_codec_t<b0::process_manager::Placement> {
+    static codec::object_t<b0::process_manager::Placement> codec() {
+        auto codec = codec::object<b0::process_manager::Placement>();
+        codec.optional("labels", &b0::process_manager::Placement::labels);
+        codec.optional("near_topic", &b0::process_manager::Placement::near_topic);
+        codec.optional("min_memory_available", &b0::process_manager::Placement::min_memory_available);
+        return codec;
+    }
+};
+
+template <>
+struct default_codec_t<b0::process_manager::LaunchProcess> {
+    static codec::object_t<b0::process_manager::LaunchProcess> codec() {
+        auto codec = codec::object<b0::process_manager::LaunchProcess>();
+        codec.required("id", &b0::process_manager::LaunchProcess::id);
+        codec.optional("host_name", &b0::process_manager::LaunchProcess::host_name);
+        codec.required("process", &b0::process_manager::LaunchProcess::process);
+        codec.optional("depends_on", &b0::process_manager::LaunchProcess::depends_on);
+        codec.optional("ready_nodes", &b0::process_manager::LaunchProcess::ready_nodes);
+        codec.optional("placement", &b0::process_manager::LaunchProcess::placement);
+        return codec;
+    }
+};
+
+template <>
+struct default_codec_t<b0::process_manager::LaunchRequest> {
+    static codec::object_t<b0::process_manager::LaunchRequest> codec() {
+        auto codec = codec::object<b0::process_manager::LaunchRequest>();
+        codec.required("processes", &b0::process_manager::LaunchRequest::processes);
+        codec.optional("ready_timeout", &b0::process_manager::LaunchRequest::ready_timeout);
+        return codec;
+    }
+};
+
 template <>
 struct default_codec_t<b0::process_manager::HUBRequest> {
     static codec::object_t<b0::process_manager::HUBRequest> codec() {
         auto codec = codec::object<b0::process_manager::HUBRequest>();
-        codec.required("host_name", &b0::process_manager::HUBRequest::host_name);
+        codec.optional("host_name", &b0::process_manager::HUBRequest::host_name);
+        codec.optional("placement", &b0::process_manager::HUBRequest::placement);
+        codec.optional("launch", &b0::process_manager::HUBRequest::launch);
         codec.optional("start_process", &b0::process_manager::HUBRequest::start_process);
+        codec.optional("start_processes", &b0::process_manager::HUBRequest::start_processes);
         codec.optional("stop_process", &b0::process_manager::HUBRequest::stop_process);
         codec.optional("query_process_status", &b0::process_manager::HUBRequest::query_process_status);
         codec.optional("list_active_processes", &b0::process_manager::HUBRequest::list_active_processes);
@@ -231,6 +519,15 @@ struct default_codec_t<b0::process_manager::StartProcessResponse> {
     }
 };
 
+template <>
+struct default_codec_t<b0::process_manager::StartProcessesResponse> {
+    static codec::object_t<b0::process_manager::StartProcessesResponse> codec() {
+        auto codec = codec::object<b0::process_manager::StartProcessesResponse>();
+        codec.required("processes", &b0::process_manager::StartProcessesResponse::processes);
+        return codec;
+    }
+};
+
 template <>
 struct default_codec_t<b0::process_manager::StopProcessResponse> {
     static codec::object_t<b0::process_manager::StopProcessResponse> codec() {
@@ -267,6 +564,7 @@ struct default_codec_t<b0::process_manager::Response> {
     static codec::object_t<b0::process_manager::Response> codec() {
         auto codec = codec::object<b0::process_manager::Response>();
         codec.optional("start_process", &b0::process_manager::Response::start_process);
+        codec.optional("start_processes", &b0::process_manager::Response::start_processes);
         codec.optional("stop_process", &b0::process_manager::Response::stop_process);
         codec.optional("query_process_status", &b0::process_manager::Response::query_process_status);
         codec.optional("list_active_processes", &b0::process_manager::Response::list_active_processes);
@@ -274,13 +572,41 @@ struct default_codec_t<b0::process_manager::Response> {
     }
 };
 
+template <>
+struct default_codec_t<b0::process_manager::LaunchResult> {
+    static codec::object_t<b0::process_manager::LaunchResult> codec() {
+        auto codec = codec::object<b0::process_manager::LaunchResult>();
+        codec.required("id", &b0::process_manager::LaunchResult::id);
+        codec.optional("host_name", &b0::process_manager::LaunchResult::host_name);
+        codec.required("started", &b0::process_manager::LaunchResult::started);
+        codec.required("ready", &b0::process_manager::LaunchResult::ready);
+        codec.optional("pid", &b0::process_manager::LaunchResult::pid);
+        codec.optional("error_message", &b0::process_manager::LaunchResult::error_message);
+        return codec;
+    }
+};
+
+template <>
+struct default_codec_t<b0::process_manager::LaunchResponse> {
+    static codec::object_t<b0::process_manager::LaunchResponse> codec() {
+        auto codec = codec::object<b0::process_manager::LaunchResponse>();
+        codec.required("success", &b0::process_manager::LaunchResponse::success);
+        codec.optional("error_message", &b0::process_manager::LaunchResponse::error_message);
+        codec.required("processes", &b0::process_manager::LaunchResponse::processes);
+        return codec;
+    }
+};
+
 template <>
 struct default_codec_t<b0::process_manager::HUBResponse> {
     static codec::object_t<b0::process_manager::HUBResponse> codec() {
         auto codec = codec::object<b0::process_manager::HUBResponse>();
         codec.required("success", &b0::process_manager::HUBResponse::success);
         codec.optional("error_message", &b0::process_manager::HUBResponse::error_message);
+        codec.optional("launch", &b0::process_manager::HUBResponse::launch);
+        codec.optional("host_name", &b0::process_manager::HUBResponse::host_name);
         codec.optional("start_process", &b0::process_manager::HUBResponse::start_process);
+        codec.optional("start_processes", &b0::process_manager::HUBResponse::start_processes);
         codec.optional("stop_process", &b0::process_manager::HUBResponse::stop_process);
         codec.optional("query_process_status", &b0::process_manager::HUBResponse::query_process_status);
         codec.optional("list_active_processes", &b0::process_manager::HUBResponse::list_active_processes);
@@ -295,6 +621,27 @@ struct default_codec_t<b0::process_manager::Beacon> {
         codec.required("host_name", &b0::process_manager::Beacon::host_name);
         codec.required("node_name", &b0::process_manager::Beacon::node_name);
         codec.required("service_name", &b0::process_manager::Beacon::service_name);
+        codec.optional("labels", &b0::process_manager::Beacon::labels);
+        codec.optional("cpu_usage", &b0::process_manager::Beacon::cpu_usage);
+        codec.optional("num_cpus", &b0::process_manager::Beacon::num_cpus);
+        codec.optional("memory_total", &b0::process_manager::Beacon::memory_total);
+        codec.optional("memory_available", &b0::process_manager::Beacon::memory_available);
+        codec.optional("net_rx_rate", &b0::process_manager::Beacon::net_rx_rate);
+        codec.optional("net_tx_rate", &b0::process_manager::Beacon::net_tx_rate);
+        return codec;
+    }
+};
+
+template <>
+struct default_codec_t<b0::process_manager::ProcessExit> {
+    static codec::object_t<b0::process_manager::ProcessExit> codec() {
+        auto codec = codec::object<b0::process_manager::ProcessExit>();
+        codec.required("host_name", &b0::process_manager::ProcessExit::host_name);
+        codec.required("node_name", &b0::process_manager::ProcessExit::node_name);
+        codec.required("pid", &b0::process_manager::ProcessExit::pid);
+        codec.required("exit_code", &b0::process_manager::ProcessExit::exit_code);
+        codec.optional("signal", &b0::process_manager::ProcessExit::signal);
+        codec.required("time_usec", &b0::process_manager::ProcessExit::time_usec);
         return codec;
     }
 };
@@ -316,6 +663,8 @@ struct default_codec_t<b0::process_manager::ActiveNodes> {
     static codec::object_t<b0::process_manager::ActiveNodes> codec() {
         auto codec = codec::object<b0::process_manager::ActiveNodes>();
         codec.required("nodes", &b0::process_manager::ActiveNodes::nodes);
+        codec.optional("full", &b0::process_manager::ActiveNodes::full);
+        codec.optional("left", &b0::process_manager::ActiveNodes::left);
         return codec;
     }
 };
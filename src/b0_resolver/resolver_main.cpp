@@ -1,11 +1,20 @@
 #include <string>
+#include <fstream>
+#include <sstream>
 #include <iostream>
 
+#include <boost/lexical_cast.hpp>
+
 #include <b0/resolver/resolver.h>
 
 int main(int argc, char **argv)
 {
     b0::addOptionInt64("minimum-heartbeat-interval,o", "set the minimum heartbeat interval, in microseconds (an interval of 0us will disable online monitoring)", nullptr, false, 30000000);
+    b0::addOptionInt("proxies,x", "set the number of XSUB/XPUB proxies, to spread topics across threads (a value of 0 will use B0_RESOLVER_PROXIES or 1)", nullptr, false, 0);
+    b0::addOptionInt("threads,j", "set the number of threads serving the lookups concurrently (a value of 0 will use B0_RESOLVER_THREADS or none)", nullptr, false, 0);
+    b0::addOptionStringVector("topic-proxy,t", "assign a topic to a proxy, in the form topic=index", nullptr, false, {});
+    b0::addOptionStringVector("compression-dictionary,d", "distribute a compression dictionary to the nodes, in the form id=file (see b0_train_dictionary)", nullptr, false, {});
+    b0::addOptionStringVector("param,p", "set a parameter served to the nodes, in the form name=value", nullptr, false, {});
     b0::init(argc, argv);
 
     b0::resolver::Resolver node;
@@ -17,6 +26,55 @@ int main(int argc, char **argv)
             node.warn("Online monitoring is disabled");
     }
 
+    if(b0::hasOption("proxies") && b0::getOptionInt("proxies") > 0)
+        node.setNumProxies(b0::getOptionInt("proxies"));
+    if(b0::hasOption("threads") && b0::getOptionInt("threads") > 0)
+        node.setServiceThreads(b0::getOptionInt("threads"));
+    if(b0::hasOption("topic-proxy"))
+    {
+        for(const std::string &tp : b0::getOptionStringVector("topic-proxy"))
+        {
+            size_t pos = tp.rfind('=');
+            if(pos == std::string::npos)
+            {
+                node.error("Invalid topic-proxy option value: %s", tp);
+                return 1;
+            }
+            node.setTopicProxy(tp.substr(0, pos), boost::lexical_cast<int>(tp.substr(pos + 1)));
+        }
+    }
+
+    if(b0::hasOption("compression-dictionary"))
+    {
+        for(const std::string &cd : b0::getOptionStringVector("compression-dictionary"))
+        {
+            size_t pos = cd.find('=');
+            std::ifstream f(pos == std::string::npos ? "" : cd.substr(pos + 1), std::ios::binary);
+            if(!f)
+            {
+                node.error("Invalid compression-dictionary option value: %s", cd);
+                return 1;
+            }
+            std::stringstream ss;
+            ss << f.rdbuf();
+            node.addCompressionDictionary(cd.substr(0, pos), ss.str());
+        }
+    }
+
+    if(b0::hasOption("param"))
+    {
+        for(const std::string &p : b0::getOptionStringVector("param"))
+        {
+            size_t pos = p.find('=');
+            if(pos == std::string::npos || pos == 0)
+            {
+                node.error("Invalid param option value: %s", p);
+                return 1;
+            }
+            node.setParameter(p.substr(0, pos), p.substr(pos + 1));
+        }
+    }
+
     node.init();
     node.spin();
     node.cleanup();
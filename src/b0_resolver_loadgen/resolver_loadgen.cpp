@@ -0,0 +1,343 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include <b0/node.h>
+#include <b0/exceptions.h>
+#include <b0/resolver/client.h>
+#include <b0/message/resolv/request.h>
+#include <b0/message/resolv/response.h>
+#include <b0/utils/metrics.h>
+
+/*
+ * Simulates many nodes against a running resolver: each virtual node announces itself, its
+ * topics and services, and sends heartbeats; nodes are shut down and re-announced at the
+ * churn rate, and graphs are queried at the given rate. The requests are made directly
+ * with the resolver::Client request methods, with the virtual node names, so that one process
+ * can simulate thousands of nodes. The latency of each kind of request, and the CPU usage
+ * of the resolver (with --resolver-pid, on Linux), are reported periodically as JSON lines.
+ */
+
+struct Options
+{
+    int nodes = 1000;
+    int topics = 5;
+    int services = 2;
+    int threads = 8;
+    double heartbeat_interval = 1.0;
+    double churn = 0;
+    double graph_queries = 1;
+    double duration = 30;
+    double report_interval = 5;
+    int resolver_pid = 0;
+};
+
+Options opts;
+
+std::atomic<bool> stop{false};
+
+//! A resolver client making requests on behalf of the virtual nodes
+class LoadClient : public b0::resolver::Client
+{
+public:
+    LoadClient(b0::Node *node) : b0::resolver::Client(node) {}
+
+    using b0::resolver::Client::callResolver;
+};
+
+//! Latencies and errors for each kind of request
+struct RequestStats
+{
+    b0::LatencyHistogram latency;
+    std::atomic<uint64_t> errors{0};
+};
+
+std::map<std::string, std::unique_ptr<RequestStats>> stats;
+
+static int64_t nowUSec()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! Call the resolver, accounting the request under the given kind
+template<typename TRq, typename TRsp>
+static bool call(LoadClient &cli, const std::string &kind, boost::optional<TRq> b0::message::resolv::Request::*rq_field, const TRq &rq, boost::optional<TRsp> b0::message::resolv::Response::*rsp_field, TRsp *rsp_out = nullptr)
+{
+    b0::message::resolv::Request rq0;
+    rq0.*rq_field = rq;
+    b0::message::resolv::Response rsp0;
+    (rsp0.*rsp_field).emplace();
+    RequestStats &s = *stats.at(kind);
+    int64_t t0 = nowUSec();
+    try
+    {
+        cli.callResolver(rq0, rsp0);
+    }
+    catch(b0::exception::Exception &)
+    {
+        s.errors++;
+        return false;
+    }
+    s.latency.record(nowUSec() - t0);
+    if(rsp_out) *rsp_out = *(rsp0.*rsp_field);
+    return true;
+}
+
+struct VirtualNode
+{
+    std::string name;
+    int index;
+    bool announced = false;
+    int64_t next_heartbeat = 0;
+};
+
+class Simulator
+{
+public:
+    Simulator(int thread_index, int first, int count)
+        : node_((boost::format("b0_resolver_loadgen_%d") % thread_index).str()),
+          cli_(&node_),
+          rng_(thread_index)
+    {
+        for(int i = first; i < first + count; i++)
+        {
+            VirtualNode v;
+            v.index = i;
+            vnodes_.push_back(v);
+        }
+    }
+
+    void run()
+    {
+        node_.init();
+        cli_.init();
+
+        for(auto &v : vnodes_)
+        {
+            if(stop) break;
+            announce(v);
+        }
+
+        int n_threads = opts.threads;
+        double churn_per_thread = opts.churn / n_threads, graph_per_thread = opts.graph_queries / n_threads;
+        std::exponential_distribution<double> churn_wait(churn_per_thread > 0 ? churn_per_thread : 1);
+        std::exponential_distribution<double> graph_wait(graph_per_thread > 0 ? graph_per_thread : 1);
+        std::uniform_int_distribution<size_t> pick(0, vnodes_.size() - 1);
+        int64_t now = nowUSec();
+        int64_t next_churn = churn_per_thread > 0 ? now + int64_t(churn_wait(rng_) * 1e6) : INT64_MAX;
+        int64_t next_graph = graph_per_thread > 0 ? now + int64_t(graph_wait(rng_) * 1e6) : INT64_MAX;
+
+        while(!stop)
+        {
+            now = nowUSec();
+            bool idle = true;
+            for(auto &v : vnodes_)
+            {
+                if(!v.announced || now < v.next_heartbeat) continue;
+                b0::message::resolv::HeartbeatRequest rq;
+                rq.node_name = v.name;
+                call(cli_, "heartbeat", &b0::message::resolv::Request::heartbeat, rq, &b0::message::resolv::Response::heartbeat);
+                v.next_heartbeat = now + int64_t(opts.heartbeat_interval * 1e6);
+                idle = false;
+            }
+            if(now >= next_churn && !vnodes_.empty())
+            {
+                VirtualNode &v = vnodes_[pick(rng_)];
+                shutdown(v);
+                announce(v);
+                next_churn = now + int64_t(churn_wait(rng_) * 1e6);
+                idle = false;
+            }
+            if(now >= next_graph)
+            {
+                b0::message::graph::GetGraphRequest rq;
+                call(cli_, "get_graph", &b0::message::resolv::Request::get_graph, rq, &b0::message::resolv::Response::get_graph);
+                next_graph = now + int64_t(graph_wait(rng_) * 1e6);
+                idle = false;
+            }
+            if(idle)
+                boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+        }
+
+        for(auto &v : vnodes_)
+            shutdown(v);
+        cli_.cleanup();
+        node_.cleanup();
+    }
+
+private:
+    void announce(VirtualNode &v)
+    {
+        using namespace b0::message;
+
+        resolv::AnnounceNodeRequest rq;
+        rq.host_id = "loadgen-" + node_.hostname();
+        rq.process_id = node_.pid();
+        rq.node_name = (boost::format("vnode_%d") % v.index).str();
+        resolv::AnnounceNodeResponse rsp;
+        if(!call(cli_, "announce_node", &resolv::Request::announce_node, rq, &resolv::Response::announce_node, &rsp) || !rsp.ok)
+            return;
+        v.name = rsp.node_name;
+        v.announced = true;
+        v.next_heartbeat = nowUSec() + int64_t(opts.heartbeat_interval * 1e6);
+
+        // fake (never connected to) addresses, unique by virtual node
+        int port = 30000 + v.index % 30000;
+        for(int i = 0; i < opts.topics; i++)
+        {
+            std::string topic = (boost::format("loadgen/topic_%d") % ((v.index + i) % 1000)).str();
+            resolv::AnnounceTopicRequest rq_t;
+            rq_t.node_name = v.name;
+            rq_t.topic_name = topic;
+            rq_t.sock_addr = (boost::format("tcp://%s:%d") % node_.hostname() % port).str();
+            call(cli_, "announce_topic", &resolv::Request::announce_topic, rq_t, &resolv::Response::announce_topic);
+
+            graph::NodeTopicRequest rq_n;
+            rq_n.node_name = v.name;
+            rq_n.topic_name = topic;
+            rq_n.reverse = i % 2 == 1;
+            rq_n.active = true;
+            call(cli_, "node_topic", &resolv::Request::node_topic, rq_n, &resolv::Response::node_topic);
+        }
+        for(int i = 0; i < opts.services; i++)
+        {
+            std::string service = (boost::format("loadgen/%s/service_%d") % v.name % i).str();
+            resolv::AnnounceServiceRequest rq_s;
+            rq_s.node_name = v.name;
+            rq_s.service_name = service;
+            rq_s.sock_addr = (boost::format("tcp://%s:%d") % node_.hostname() % (port + i + 1)).str();
+            call(cli_, "announce_service", &resolv::Request::announce_service, rq_s, &resolv::Response::announce_service);
+
+            graph::NodeServiceRequest rq_n;
+            rq_n.node_name = v.name;
+            rq_n.service_name = service;
+            rq_n.reverse = false;
+            rq_n.active = true;
+            call(cli_, "node_service", &resolv::Request::node_service, rq_n, &resolv::Response::node_service);
+
+            resolv::ResolveServiceRequest rq_r;
+            rq_r.service_name = service;
+            call(cli_, "resolve_service", &resolv::Request::resolve_service, rq_r, &resolv::Response::resolve_service);
+        }
+    }
+
+    void shutdown(VirtualNode &v)
+    {
+        if(!v.announced) return;
+        b0::message::resolv::ShutdownNodeRequest rq;
+        rq.node_name = v.name;
+        call(cli_, "shutdown_node", &b0::message::resolv::Request::shutdown_node, rq, &b0::message::resolv::Response::shutdown_node);
+        v.announced = false;
+    }
+
+    b0::Node node_;
+    LoadClient cli_;
+    std::mt19937 rng_;
+    std::vector<VirtualNode> vnodes_;
+};
+
+//! Return the CPU time (user + system) of a process, in seconds, or -1 if not available
+static double cpuTime(int pid)
+{
+#ifdef __linux__
+    std::ifstream f("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat;
+    if(!std::getline(f, stat)) return -1;
+    // the fields following the command name (which can contain spaces) start after ')'
+    size_t p = stat.rfind(')');
+    if(p == std::string::npos) return -1;
+    std::istringstream is(stat.substr(p + 2));
+    std::string field;
+    unsigned long utime = 0, stime = 0;
+    for(int i = 3; i <= 15 && is >> field; i++)
+    {
+        if(i == 14) utime = std::stoul(field);
+        if(i == 15) stime = std::stoul(field);
+    }
+    return double(utime + stime) / sysconf(_SC_CLK_TCK);
+#else
+    return -1;
+#endif
+}
+
+static void report(double elapsed, double cpu)
+{
+    std::cout << "{\"elapsed\": " << elapsed;
+    if(cpu >= 0)
+        std::cout << ", \"resolver_cpu\": " << cpu;
+    for(auto &p : stats)
+    {
+        RequestStats &s = *p.second;
+        boost::format fmt(", \"%s\": {\"count\": %d, \"errors\": %d, \"per_sec\": %.1f, \"p50_us\": %d, \"p99_us\": %d, \"p999_us\": %d, \"max_us\": %d}");
+        std::cout << (fmt % p.first % s.latency.count() % s.errors.load() % (s.latency.count() / opts.report_interval)
+                % s.latency.percentile(50) % s.latency.percentile(99) % s.latency.percentile(99.9) % s.latency.max()).str();
+        s.latency.reset();
+        s.errors = 0;
+    }
+    std::cout << "}" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    b0::addOptionInt("nodes,N", "number of virtual nodes", &opts.nodes, false, opts.nodes);
+    b0::addOptionInt("topics,t", "topics announced by each node", &opts.topics, false, opts.topics);
+    b0::addOptionInt("services,s", "services announced by each node", &opts.services, false, opts.services);
+    b0::addOptionInt("threads,T", "threads making the requests", &opts.threads, false, opts.threads);
+    b0::addOptionDouble("heartbeat-interval,b", "seconds between the heartbeats of a node", &opts.heartbeat_interval, false, opts.heartbeat_interval);
+    b0::addOptionDouble("churn,c", "nodes shut down and announced again, per second", &opts.churn, false, opts.churn);
+    b0::addOptionDouble("graph-queries,g", "graph queries per second", &opts.graph_queries, false, opts.graph_queries);
+    b0::addOptionDouble("duration,d", "seconds to run", &opts.duration, false, opts.duration);
+    b0::addOptionDouble("report-interval,i", "seconds between reports", &opts.report_interval, false, opts.report_interval);
+    b0::addOptionInt("resolver-pid,p", "process id of the resolver, to report its CPU usage", &opts.resolver_pid);
+    b0::init(argc, argv);
+
+    if(opts.nodes < 1 || opts.threads < 1)
+        throw b0::exception::ArgumentError(std::to_string(opts.nodes) + "/" + std::to_string(opts.threads), "nodes/threads");
+    if(opts.heartbeat_interval <= 0 || opts.report_interval <= 0)
+        throw b0::exception::ArgumentError("interval", "heartbeat-interval/report-interval");
+    opts.threads = std::min(opts.threads, opts.nodes);
+
+    for(std::string kind : {"announce_node", "announce_topic", "node_topic", "announce_service", "node_service", "resolve_service", "heartbeat", "get_graph", "shutdown_node"})
+        stats[kind].reset(new RequestStats);
+
+    std::vector<std::unique_ptr<Simulator>> simulators;
+    boost::thread_group group;
+    for(int t = 0, first = 0; t < opts.threads; t++)
+    {
+        int count = opts.nodes / opts.threads + (t < opts.nodes % opts.threads ? 1 : 0);
+        simulators.emplace_back(new Simulator(t, first, count));
+        group.create_thread(boost::bind(&Simulator::run, simulators.back().get()));
+        first += count;
+    }
+
+    int64_t start = nowUSec(), next_report = start + int64_t(opts.report_interval * 1e6);
+    double cpu0 = opts.resolver_pid ? cpuTime(opts.resolver_pid) : -1;
+    while(nowUSec() - start < int64_t(opts.duration * 1e6))
+    {
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{50});
+        if(nowUSec() < next_report) continue;
+        double cpu1 = opts.resolver_pid ? cpuTime(opts.resolver_pid) : -1;
+        // CPU usage of the resolver over the interval, in cores
+        report((nowUSec() - start) / 1e6, cpu0 >= 0 && cpu1 >= 0 ? (cpu1 - cpu0) / opts.report_interval : -1);
+        cpu0 = cpu1;
+        next_report += int64_t(opts.report_interval * 1e6);
+    }
+    stop = true;
+    group.join_all();
+    return 0;
+}
@@ -4,6 +4,7 @@
 
 #include <b0/node.h>
 #include <b0/service_client.h>
+#include <b0/utils/env.h>
 
 int main(int argc, char **argv)
 {
@@ -14,6 +15,10 @@ int main(int argc, char **argv)
     b0::setPositionalOption("service-name");
     b0::init(argc, argv);
 
+    // the reply is already read when exiting: do not wait on unreachable peers
+    if(b0::env::get("B0_LINGER_PERIOD").empty())
+        b0::setLingerPeriod(100);
+
     std::cin >> std::noskipws;
     std::istream_iterator<char> it(std::cin);
     std::istream_iterator<char> end;
@@ -21,6 +26,7 @@ int main(int argc, char **argv)
 
     b0::Node node(node_name);
     b0::ServiceClient cli(&node, service_name);
+    node.setEphemeral(true);
     node.init();
     cli.call(request, content_type, response, response_type);
     if(content_type != "")
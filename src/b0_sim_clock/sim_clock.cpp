@@ -0,0 +1,63 @@
+#include <iostream>
+#include <string>
+
+#include <boost/format.hpp>
+
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/exceptions.h>
+#include <b0/message/sim/clock.h>
+
+/*
+ * Publishes a simulated clock, for the nodes following it (see b0::Node::setSimulatedTime()):
+ *
+ *   b0_sim_clock --speed 20 --rate 200
+ *
+ * The clock advances by a fixed step at each tick, so that the simulated times are the
+ * same from run to run, however late the ticks are on this computer's clock.
+ */
+
+int main(int argc, char **argv)
+{
+    std::string node_name = "b0_sim_clock", topic_name = "clock";
+    double speed = 1, rate = 100;
+    int64_t start = -1, step = 0, duration = 0;
+    b0::addOptionString("node-name,n", "name of node", &node_name);
+    b0::addOptionString("topic-name,t", "name of topic", &topic_name, false, "clock");
+    b0::addOptionDouble("speed,s", "simulated seconds per real second", &speed, false, 1);
+    b0::addOptionDouble("rate,r", "ticks per real second", &rate, false, 100);
+    b0::addOptionInt64("start", "simulated time of the first tick, in microseconds (default: the current time)", &start, false, -1);
+    b0::addOptionInt64("step", "simulated microseconds per tick (default: speed / rate)", &step);
+    b0::addOptionInt64("duration,d", "simulated microseconds to run, then exit (0 = no limit)", &duration);
+    b0::init(argc, argv);
+
+    if(speed <= 0)
+        throw b0::exception::ArgumentError(std::to_string(speed), "speed");
+    if(rate <= 0)
+        throw b0::exception::ArgumentError(std::to_string(rate), "rate");
+    if(step < 0)
+        throw b0::exception::ArgumentError(std::to_string(step), "step");
+    if(step == 0)
+        step = int64_t(1000000 * speed / rate);
+    if(step == 0)
+        throw b0::exception::ArgumentError(std::to_string(step), "step");
+
+    b0::Node node(node_name);
+    node.setSimulatedTime(false);
+    b0::Publisher pub(&node, topic_name);
+    node.init();
+
+    b0::message::sim::Clock clock;
+    clock.time_usec = start >= 0 ? start : node.hardwareTimeUSec();
+    const int64_t end = duration > 0 ? clock.time_usec + duration : -1;
+    std::cerr << boost::format("Publishing the clock on %s: %d usec every %f seconds (%fx)") % topic_name % step % (1 / rate) % (step * rate / 1e6) << std::endl;
+    node.spin([&]() {
+        pub.publish(clock);
+        if(end >= 0 && clock.time_usec >= end)
+            node.shutdown();
+        clock.time_usec += step;
+    }, rate);
+
+    node.cleanup();
+    return 0;
+}
@@ -1,44 +1,168 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <vector>
-#include <map>
-#include <boost/lexical_cast.hpp>
-#include <boost/algorithm/string/regex.hpp>
-#include <boost/regex.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * The /proc files are opened once, and read again from the start with pread() for each
+ * sample, into a fixed buffer: only the beginning of the files is needed.
+ */
+class ProcFile
+{
+public:
+    explicit ProcFile(const std::string &path)
+        : fd_(::open(path.c_str(), O_RDONLY | O_CLOEXEC))
+    {
+    }
+
+    ~ProcFile()
+    {
+        if(fd_ >= 0) ::close(fd_);
+    }
+
+    ProcFile(const ProcFile &) = delete;
+    ProcFile & operator=(const ProcFile &) = delete;
+
+    bool isOpen() const
+    {
+        return fd_ >= 0;
+    }
+
+    //! Read the beginning of the file, null-terminated; return nullptr if it cannot be read (e.g. the process exited)
+    const char * read()
+    {
+        if(fd_ < 0) return nullptr;
+        ssize_t n;
+        do n = ::pread(fd_, buf_, sizeof(buf_) - 1, 0); while(n < 0 && errno == EINTR);
+        if(n <= 0) return nullptr;
+        buf_[n] = '\0';
+        return buf_;
+    }
+
+private:
+    int fd_;
+    char buf_[4096];
+};
+
+static const char * readProcFile(ProcFile &file, const char *path)
+{
+    const char *s = file.read();
+    if(!s)
+        throw std::runtime_error(std::string("Could not read ") + path);
+    return s;
+}
 
 std::vector<float> getLoadAverages()
 {
-    std::vector<std::string> lines = readSubprocessOutput("uptime");
-    if(lines.size() == 0)
-        throw std::runtime_error("Could not read output of 'uptime' program");
-    const int n = 3;
-    std::vector<float> avgs;
-    boost::match_results<std::string::const_iterator> matches;
-    boost::regex e(".*load average: ([^ ]+), ([^ ]+), ([^ ]+)");
-    if(boost::regex_match(lines[0], matches, e, boost::match_default | boost::match_partial) && matches.size() == n + 1)
-    {
-        avgs.resize(n);
-        for(int i = 0; i < n; i++)
-            avgs[i] = boost::lexical_cast<float>(matches[i + 1]);
-    }
-    else throw std::runtime_error("Could not parse output of 'uptime' program");
+    // e.g. "0.52 0.58 0.59 1/467 12345"
+    static ProcFile file("/proc/loadavg");
+    const char *s = readProcFile(file, "/proc/loadavg");
+    std::vector<float> avgs(3);
+    for(int i = 0; i < 3; i++)
+    {
+        char *end;
+        avgs[i] = std::strtof(s, &end);
+        if(end == s)
+            throw std::runtime_error("Could not parse /proc/loadavg");
+        s = end;
+    }
     return avgs;
 }
 
-int getFreeMemory()
+int64_t getFreeMemory()
+{
+    static ProcFile file("/proc/meminfo");
+    const char *s = readProcFile(file, "/proc/meminfo");
+    // MemAvailable accounts for the reclaimable caches; older kernels only have MemFree
+    const char *p = std::strstr(s, "MemAvailable:");
+    if(!p) p = std::strstr(s, "MemFree:");
+    if(!p)
+        throw std::runtime_error("Could not parse /proc/meminfo");
+    p = std::strchr(p, ':') + 1;
+    return int64_t(std::strtoull(p, nullptr, 10)) * 1024;
+}
+
+double getCPUUsage()
+{
+    // first line: "cpu  user nice system idle iowait irq softirq steal guest guest_nice"
+    static ProcFile file("/proc/stat");
+    static uint64_t last_total = 0, last_idle = 0;
+    const char *s = readProcFile(file, "/proc/stat");
+    if(std::strncmp(s, "cpu ", 4) != 0)
+        throw std::runtime_error("Could not parse /proc/stat");
+    s += 4;
+    uint64_t total = 0, idle = 0;
+    // guest and guest_nice are already counted in user and nice
+    for(int i = 0; i < 8; i++)
+    {
+        char *end;
+        uint64_t v = std::strtoull(s, &end, 10);
+        if(end == s) break;
+        s = end;
+        total += v;
+        if(i == 3 || i == 4) idle += v;
+    }
+    double usage = -1;
+    if(last_total && total > last_total)
+        usage = 1.0 - double(idle - last_idle) / double(total - last_total);
+    last_total = total;
+    last_idle = idle;
+    return usage;
+}
+
+/*
+ * Read the CPU time (user + system, in microseconds) and the resident set size (in bytes)
+ * of a process. Return false if it does not exist (anymore).
+ */
+//! The open /proc/<pid>/stat files, by pid
+static std::map<int, std::unique_ptr<ProcFile> > process_files;
+
+bool getProcessUsage(int pid, int64_t &cpu_usec, int64_t &rss)
+{
+    static const long ticks = sysconf(_SC_CLK_TCK), page_size = sysconf(_SC_PAGESIZE);
+
+    std::unique_ptr<ProcFile> &file = process_files[pid];
+    if(!file)
+        file.reset(new ProcFile("/proc/" + std::to_string(pid) + "/stat"));
+    const char *s = file->read();
+    if(!s)
+    {
+        // the descriptor refers to the process it was opened for: if it exited, its pid
+        // may be reused by another process, which is opened again next time
+        process_files.erase(pid);
+        return false;
+    }
+
+    // the command name (2nd field) can contain spaces and parentheses: skip to the last ')'
+    s = std::strrchr(s, ')');
+    if(!s) return false;
+    s++;
+    // fields after the command name, starting from the 3rd (state): utime is the 14th,
+    // stime the 15th, and rss the 24th
+    uint64_t utime = 0, stime = 0, rss_pages = 0;
+    for(int field = 3; field <= 24; field++)
+    {
+        while(*s == ' ') s++;
+        if(!*s) return false;
+        if(field == 14) utime = std::strtoull(s, nullptr, 10);
+        else if(field == 15) stime = std::strtoull(s, nullptr, 10);
+        else if(field == 24) rss_pages = std::strtoull(s, nullptr, 10);
+        while(*s && *s != ' ') s++;
+    }
+    cpu_usec = int64_t((utime + stime) * 1000000 / ticks);
+    rss = int64_t(rss_pages) * page_size;
+    return true;
+}
+
+//! Close the file of a process which is not monitored anymore
+void forgetProcess(int pid)
 {
-    std::vector<std::string> lines = readSubprocessOutput("free", {"-b"});
-    if(lines.size() == 0)
-        throw std::runtime_error("Could not read output of 'free' program");
-    int r = -1, pgsz = 1;
-    boost::match_results<std::string::const_iterator> matches;
-    for(auto &line : lines)
-    {
-        boost::regex e("^Mem: +([^ ]+) +([^ ]+) +([^ ]+) +.*");
-        if(boost::regex_match(line, matches, e) && matches.size() == 3)
-        {
-            return boost::lexical_cast<int>(matches[3]);
-        }
-    }
-    return -1;
+    process_files.erase(pid);
 }
@@ -25,26 +25,40 @@ std::vector<float> getLoadAverages()
     return avgs;
 }
 
-int getFreeMemory()
+int64_t getFreeMemory()
 {
     std::vector<std::string> lines = readSubprocessOutput("vm_stat");
     if(lines.size() == 0)
         throw std::runtime_error("Could not read output of 'vm_stat' program");
-    int r = -1, pgsz = 1;
+    int64_t r = -1, pgsz = 1;
     boost::match_results<std::string::const_iterator> matches;
     boost::regex e("Mach Virtual Memory Statistics: \\(page size of ([0-9]+) bytes\\)");
     if(!boost::regex_match(lines[0], matches, e, boost::match_default | boost::match_partial) || matches.size() != 2)
         throw std::runtime_error("Could not parse output of 'vm_stat' program");
     pgsz = boost::lexical_cast<int>(matches[1]);
-    std::map<std::string, int> stats;
+    std::map<std::string, int64_t> stats;
     for(int i = 1; i < lines.size(); i++)
     {
         std::vector<std::string> pair;
         boost::algorithm::split_regex(pair, lines[i], boost::regex(": *"));
-        stats[pair[0]] = int(boost::lexical_cast<float>(pair[1]));
+        stats[pair[0]] = int64_t(boost::lexical_cast<double>(pair[1]));
     }
     auto it = stats.find("Pages free");
     if(it != stats.end())
         r = it->second * pgsz;
     return r;
 }
+
+double getCPUUsage()
+{
+    return -1;
+}
+
+bool getProcessUsage(int pid, int64_t &cpu_usec, int64_t &rss)
+{
+    return false;
+}
+
+void forgetProcess(int pid)
+{
+}
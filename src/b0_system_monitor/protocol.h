@@ -10,11 +10,50 @@ namespace b0
 namespace system_monitor
 {
 
+//! Resource usage of a process running b0 nodes
+class ProcessLoad : public b0::message::Message
+{
+public:
+    //! The process id
+    int pid;
+
+    //! The names of the nodes of the process
+    std::vector<std::string> node_names;
+
+    //! CPU usage since the previous sample (1.0 = one CPU fully used)
+    double cpu_usage;
+
+    //! Resident set size (in bytes)
+    int64_t rss;
+
+    std::string type() const override {return "b0::system_monitor::ProcessLoad";}
+};
+
+/*!
+ * Load of the host, published on the "system_monitor" topic (in MessagePack)
+ *
+ * To keep the messages small, the processes are sent as deltas: when full is false,
+ * processes lists only the ones which changed noticeably, and exited_processes the ones
+ * which are gone, since the previous message. A full message, listing all the processes,
+ * is sent periodically so that new subscribers get the complete state.
+ */
 class Load : public b0::message::Message
 {
 public:
     std::vector<float> load_averages;
-    int free_memory;
+    int64_t free_memory;
+
+    //! CPU usage of the host since the previous sample (between 0 and 1, -1 if unknown)
+    double cpu_usage{-1};
+
+    //! True if processes lists all the processes
+    bool full{true};
+
+    //! The processes (all of them, or only the ones which changed, see full)
+    std::vector<ProcessLoad> processes;
+
+    //! The processes which exited since the previous message
+    std::vector<int> exited_processes;
 
     std::string type() const override {return "b0::system_monitor::Load";}
 };
@@ -29,12 +68,38 @@ namespace spotify
 namespace json
 {
 
+template <>
+struct default_codec_t<b0::system_monitor::ProcessLoad> {
+    template<typename Codec>
+    static void describe(Codec &codec) {
+        codec.required("pid", &b0::system_monitor::ProcessLoad::pid);
+        codec.required("node_names", &b0::system_monitor::ProcessLoad::node_names);
+        codec.required("cpu_usage", &b0::system_monitor::ProcessLoad::cpu_usage);
+        codec.required("rss", &b0::system_monitor::ProcessLoad::rss);
+    }
+
+    static codec::object_t<b0::system_monitor::ProcessLoad> codec() {
+        auto codec = codec::object<b0::system_monitor::ProcessLoad>();
+        describe(codec);
+        return codec;
+    }
+};
+
 template <>
 struct default_codec_t<b0::system_monitor::Load> {
-    static codec::object_t<b0::system_monitor::Load> codec() {
-        auto codec = codec::object<b0::system_monitor::Load>();
+    template<typename Codec>
+    static void describe(Codec &codec) {
         codec.required("load_averages", &b0::system_monitor::Load::load_averages);
         codec.required("free_memory", &b0::system_monitor::Load::free_memory);
+        codec.optional("cpu_usage", &b0::system_monitor::Load::cpu_usage);
+        codec.optional("full", &b0::system_monitor::Load::full);
+        codec.optional("processes", &b0::system_monitor::Load::processes);
+        codec.optional("exited_processes", &b0::system_monitor::Load::exited_processes);
+    }
+
+    static codec::object_t<b0::system_monitor::Load> codec() {
+        auto codec = codec::object<b0::system_monitor::Load>();
+        describe(codec);
         return codec;
     }
 };
@@ -1,10 +1,15 @@
+#include <cmath>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 #include <map>
 #include <b0/node.h>
 #include <b0/publisher.h>
+#include <b0/exceptions.h>
+#include <b0/message/graph/graph.h>
 #include "protocol.h"
+#if defined(__linux__) || defined(HAVE_BOOST_PROCESS)
 #ifdef HAVE_BOOST_PROCESS
 #include <boost/process.hpp>
 #include <boost/lexical_cast.hpp>
@@ -24,13 +29,22 @@ std::vector<std::string> readSubprocessOutput(const std::string &exe, const std:
     output.pipe().close();
     return lines;
 }
+#endif // HAVE_BOOST_PROCESS
 
 /*
  * Platform-specific implementation of system monitor has to provide
  * the following functions:
  *
  *  - std::vector<float> getLoadAverages();
- *  - int getFreeMemory();
+ *  - int64_t getFreeMemory();
+ *  - double getCPUUsage(); (fraction of the time the CPUs were busy since the previous
+ *    call, -1 if unknown)
+ *  - bool getProcessUsage(int pid, int64_t &cpu_usec, int64_t &rss); (total CPU time
+ *    and resident set size of a process, false if not available)
+ *  - void forgetProcess(int pid); (the process is not monitored anymore)
+ *
+ * These are called at every sample, so they should not spawn processes when the
+ * information is available otherwise (e.g. the linux implementation reads /proc).
  */
 #ifdef _WIN32
 #include "impl/win32.cpp"
@@ -50,13 +64,23 @@ namespace b0
 namespace system_monitor
 {
 
+//! Minimum change of the CPU usage of a process to be sent in a delta
+static const double cpu_usage_threshold = 0.01;
+
+//! Minimum relative change of the RSS of a process to be sent in a delta
+static const double rss_threshold = 0.01;
+
 class SystemMonitor : public b0::Node
 {
 public:
-    SystemMonitor()
-        : Node("system_monitor"),
-          pub_(this, "system_monitor")
+    SystemMonitor(const std::string &node_name, double graph_interval, int full_interval)
+        : Node(node_name),
+          pub_(this, "system_monitor"),
+          graph_interval_(int64_t(graph_interval * 1000000)),
+          full_interval_(full_interval)
     {
+        // the messages are sent often, and mostly contain numbers
+        pub_.setMessageCodec(b0::message::MessageCodec::MsgPack);
     }
 
     ~SystemMonitor()
@@ -72,6 +96,8 @@ public:
             Load load_msg;
             load_msg.load_averages = getLoadAverages();
             load_msg.free_memory = getFreeMemory();
+            load_msg.cpu_usage = getCPUUsage();
+            sampleProcesses(load_msg);
             pub_.publish(load_msg);
         }
         catch(std::exception &ex)
@@ -81,7 +107,143 @@ public:
     }
 
 protected:
+    //! A monitored process
+    struct Process
+    {
+        //! The names of its nodes
+        std::vector<std::string> node_names;
+
+        //! CPU time at the previous sample (-1 if not sampled yet)
+        int64_t cpu_usec{-1};
+
+        //! Time of the previous sample
+        int64_t sample_time{0};
+
+        //! The last values sent
+        ProcessLoad sent;
+
+        //! True if it has been sent since it was found or its nodes changed
+        bool sent_once{false};
+    };
+
+    //! Find the processes of this host running b0 nodes, from the graph
+    void refreshProcesses()
+    {
+        b0::message::graph::Graph graph;
+        try
+        {
+            getGraph(graph);
+        }
+        catch(std::exception &ex)
+        {
+            warn("Cannot get the graph: %s", ex.what());
+            return;
+        }
+
+        std::string host = hostname();
+        std::map<int, std::vector<std::string> > node_names;
+        for(auto &node : graph.nodes)
+            if(node.host_id == host)
+                node_names[node.process_id].push_back(node.node_name);
+
+        for(auto it = processes_.begin(); it != processes_.end(); )
+        {
+            if(node_names.count(it->first))
+            {
+                ++it;
+                continue;
+            }
+            exited_.insert(it->first);
+            forgetProcess(it->first);
+            it = processes_.erase(it);
+        }
+        for(auto &p : node_names)
+        {
+            Process &process = processes_[p.first];
+            if(process.node_names != p.second)
+            {
+                process.node_names = p.second;
+                process.sent_once = false;
+            }
+        }
+    }
+
+    //! Sample the monitored processes, adding to the message the ones to send
+    void sampleProcesses(Load &load_msg)
+    {
+        int64_t now = hardwareTimeUSec();
+        if(!last_refresh_ || now - last_refresh_ >= graph_interval_)
+        {
+            refreshProcesses();
+            last_refresh_ = now;
+        }
+
+        load_msg.full = samples_ % full_interval_ == 0;
+        samples_++;
+
+        for(auto it = processes_.begin(); it != processes_.end(); )
+        {
+            Process &process = it->second;
+            int64_t cpu_usec, rss;
+            if(!getProcessUsage(it->first, cpu_usec, rss))
+            {
+                // exited since the graph was read (or not available on this platform)
+                if(process.sent_once) exited_.insert(it->first);
+                forgetProcess(it->first);
+                it = processes_.erase(it);
+                continue;
+            }
+
+            ProcessLoad p;
+            p.pid = it->first;
+            p.node_names = process.node_names;
+            p.rss = rss;
+            p.cpu_usage = 0;
+            if(process.cpu_usec >= 0 && now > process.sample_time)
+                p.cpu_usage = double(cpu_usec - process.cpu_usec) / double(now - process.sample_time);
+            process.cpu_usec = cpu_usec;
+            process.sample_time = now;
+
+            if(load_msg.full || !process.sent_once || changed(process.sent, p))
+            {
+                process.sent = p;
+                process.sent_once = true;
+                load_msg.processes.push_back(std::move(p));
+            }
+            ++it;
+        }
+
+        if(!load_msg.full)
+            load_msg.exited_processes.assign(exited_.begin(), exited_.end());
+        exited_.clear();
+    }
+
+    //! Return true if the change from the last values sent is worth a delta
+    static bool changed(const ProcessLoad &a, const ProcessLoad &b)
+    {
+        return std::fabs(a.cpu_usage - b.cpu_usage) >= cpu_usage_threshold
+            || std::fabs(double(a.rss - b.rss)) >= rss_threshold * double(a.rss);
+    }
+
     b0::Publisher pub_;
+
+    //! The monitored processes, by pid
+    std::map<int, Process> processes_;
+
+    //! The processes which exited since the previous message
+    std::set<int> exited_;
+
+    //! Microseconds between the reads of the graph
+    int64_t graph_interval_;
+
+    //! Send all the processes every this many samples
+    int full_interval_;
+
+    //! Time of the last read of the graph
+    int64_t last_refresh_{0};
+
+    //! Number of samples taken
+    int64_t samples_{0};
 };
 
 } // namespace system_monitor
@@ -90,15 +252,30 @@ protected:
 
 int main(int argc, char **argv)
 {
+    std::string node_name = "system_monitor";
+    double interval = 1.0, graph_interval = 5.0;
+    int full_interval = 10;
+    b0::addOptionString("node-name,n", "name of node", &node_name, false, "system_monitor");
+    b0::addOptionDouble("interval,i", "seconds between samples", &interval, false, 1.0);
+    b0::addOptionDouble("graph-interval,g", "seconds between reads of the graph, to find the processes to monitor", &graph_interval, false, 5.0);
+    b0::addOptionInt("full-interval,f", "send all the processes every this many samples (the others only send the changes)", &full_interval, false, 10);
     b0::init(argc, argv);
-    b0::system_monitor::SystemMonitor node;
+
+    if(interval <= 0)
+        throw b0::exception::ArgumentError(std::to_string(interval), "interval");
+    if(graph_interval <= 0)
+        throw b0::exception::ArgumentError(std::to_string(graph_interval), "graph-interval");
+    if(full_interval <= 0)
+        throw b0::exception::ArgumentError(std::to_string(full_interval), "full-interval");
+
+    b0::system_monitor::SystemMonitor node(node_name, graph_interval, full_interval);
     node.init();
-    node.spin();
+    node.spin({}, 1.0 / interval);
     node.cleanup();
     return 0;
 }
 
-#else // HAVE_BOOST_PROCESS
+#else // defined(__linux__) || defined(HAVE_BOOST_PROCESS)
 
 #include <iostream>
 
@@ -108,4 +285,4 @@ int main()
     return 1;
 }
 
-#endif // HAVE_BOOST_PROCESS
+#endif // defined(__linux__) || defined(HAVE_BOOST_PROCESS)
@@ -1,26 +1,120 @@
+#include <cstdio>
 #include <iostream>
 
+#include <boost/format.hpp>
+
 #include <b0/node.h>
 #include <b0/subscriber.h>
+#include <b0/exceptions.h>
+#include <b0/compress/compress.h>
+#include <b0/message/message_envelope.h>
 
-void callback(const std::string &payload)
+//! Print a hexdump-like preview of a payload
+static void printHex(const char *data, size_t size)
 {
-    std::cout << payload << std::flush;
+    for(size_t i = 0; i < size; i += 16)
+    {
+        std::cout << boost::format("%08x ") % i;
+        for(size_t j = i; j < i + 16; j++)
+        {
+            if(j < size) std::cout << boost::format(" %02x") % int(static_cast<unsigned char>(data[j]));
+            else std::cout << "   ";
+        }
+        std::cout << "  |";
+        for(size_t j = i; j < i + 16 && j < size; j++)
+            std::cout << (data[j] >= 32 && data[j] < 127 ? data[j] : '.');
+        std::cout << "|\n";
+    }
 }
 
 int main(int argc, char **argv)
 {
-    std::string node_name = "b0_topic_echo", topic_name = "";
+    std::string node_name = "b0_topic_echo", topic_name = "", output_file = "";
+    int every = 1;
+    int64_t max_bytes = -1;
     b0::addOptionString("node-name,n", "name of node", &node_name);
     b0::addOptionString("topic-name,t", "name of topic", &topic_name);
+    b0::addOption("headers,H", "print the headers and the envelope size instead of the payloads");
+    b0::addOption("hex,x", "print a hex preview of the payloads (the first 256 bytes, unless --max-bytes)");
+    b0::addOptionInt64("max-bytes,m", "print at most this number of bytes of each payload", &max_bytes, false, -1);
+    b0::addOptionInt("every,e", "print only one message every N", &every, false, 1);
+    b0::addOption("per-second,s", "print at most one message per second");
+    b0::addOptionString("output,o", "append the raw payloads to this file, with buffered writes (instead of printing them)", &output_file);
     b0::setPositionalOption("topic-name");
     b0::init(argc, argv);
 
+    if(every < 1)
+        throw b0::exception::ArgumentError(std::to_string(every), "every");
+    bool headers = b0::hasOption("headers"), hex = b0::hasOption("hex"), per_second = b0::hasOption("per-second");
+    if(hex && max_bytes < 0)
+        max_bytes = 256;
+
+    std::FILE *output = nullptr;
+    if(!output_file.empty())
+    {
+        output = std::fopen(output_file.c_str(), "ab");
+        if(!output)
+            throw b0::exception::Exception("cannot open " + output_file);
+        std::setvbuf(output, nullptr, _IOFBF, 1 << 20);
+    }
+
     b0::Node node(node_name);
-    b0::Subscriber sub(&node, topic_name, callback);
+    b0::Subscriber sub(&node, topic_name);
     node.init();
-    node.spin();
+
+    // the messages are read as raw envelopes, and parsed only when sampled
+    std::shared_ptr<const void> buffer;
+    b0::message::MessageEnvelopeView env;
+    b0::compress::Context context;
+    uint64_t received = 0;
+    int64_t next_sample = 0;
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        if(!sub.poll(100)) continue;
+        while(sub.poll())
+        {
+            boost::string_ref wire = sub.readWire(buffer);
+            if(received++ % every != 0) continue;
+            if(per_second)
+            {
+                int64_t now = node.hardwareTimeUSec();
+                if(now < next_sample) continue;
+                next_sample = now + 1000000;
+            }
+
+            if(headers)
+            {
+                // the parts are neither located nor decompressed
+                b0::message::parse(env, wire.data(), wire.size(), context, [&](const b0::message::MessageEnvelopeView &e) {
+                    std::cout << e.header0 << "\n";
+                    for(auto &h : e.getHeaders())
+                        std::cout << "  " << h.first << ": " << h.second << "\n";
+                    return false;
+                });
+                std::cout << "  (" << wire.size() << " bytes)" << std::endl;
+                continue;
+            }
+
+            b0::message::parse(env, wire.data(), wire.size(), context);
+            if(!env.parts.empty())
+            {
+                auto &part = env.parts[0];
+                size_t size = max_bytes >= 0 ? std::min<size_t>(part.size, max_bytes) : part.size;
+                if(output)
+                    std::fwrite(part.data, 1, size, output);
+                else if(hex)
+                    printHex(part.data, size);
+                else
+                    std::cout.write(part.data, size);
+            }
+            if(!output)
+                std::cout << std::flush;
+        }
+    }
+
+    if(output)
+        std::fclose(output);
     node.cleanup();
     return 0;
 }
-
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <b0/node.h>
+#include <b0/subscriber.h>
+#include <b0/exceptions.h>
+#include <b0/compress/compress.h>
+#include <b0/message/message_envelope.h>
+
+//! A message received, as accounted in the window
+struct Sample
+{
+    int64_t time;
+    size_t size;
+    int64_t latency; // -1 if not stamped
+};
+
+struct TopicStats
+{
+    std::unique_ptr<b0::Subscriber> sub;
+    std::deque<Sample> window;
+};
+
+static std::string rate(double bytes_per_sec)
+{
+    static const char *units[] = {"B/s", "KB/s", "MB/s", "GB/s"};
+    int i = 0;
+    while(bytes_per_sec >= 1000 && i < 3)
+    {
+        bytes_per_sec /= 1000;
+        i++;
+    }
+    return (boost::format("%.2f %s") % bytes_per_sec % units[i]).str();
+}
+
+static void report(const std::string &topic, const std::deque<Sample> &window)
+{
+    if(window.size() < 2)
+    {
+        std::cout << topic << ": no messages" << std::endl;
+        return;
+    }
+
+    double span = (window.back().time - window.front().time) / 1e6;
+    uint64_t bytes = 0;
+    size_t min_size = SIZE_MAX, max_size = 0;
+    int64_t min_dt = INT64_MAX, max_dt = 0;
+    double sum_dt2 = 0;
+    std::vector<int64_t> latencies;
+    for(size_t i = 0; i < window.size(); i++)
+    {
+        const Sample &s = window[i];
+        bytes += s.size;
+        min_size = std::min(min_size, s.size);
+        max_size = std::max(max_size, s.size);
+        if(s.latency >= 0) latencies.push_back(s.latency);
+        if(i == 0) continue;
+        int64_t dt = s.time - window[i - 1].time;
+        min_dt = std::min(min_dt, dt);
+        max_dt = std::max(max_dt, dt);
+        sum_dt2 += double(dt) * dt;
+    }
+    size_t n = window.size() - 1;
+    double mean_dt = span * 1e6 / n;
+    double stddev_dt = std::sqrt(std::max(0.0, sum_dt2 / n - mean_dt * mean_dt));
+
+    boost::format fmt("%s: %.2f msg/s, %s, size min %d mean %d max %d B, interval min %.3f mean %.3f max %.3f stddev %.3f ms (window %d msgs)");
+    std::cout << (fmt % topic % (n / span) % rate((bytes - window.front().size) / span)
+            % min_size % (bytes / window.size()) % max_size
+            % (min_dt / 1e3) % (mean_dt / 1e3) % (max_dt / 1e3) % (stddev_dt / 1e3)
+            % window.size()).str() << std::endl;
+
+    if(!latencies.empty())
+    {
+        std::sort(latencies.begin(), latencies.end());
+        auto pct = [&](double p) { return latencies[std::min(latencies.size() - 1, size_t(p / 100 * latencies.size()))]; };
+        boost::format fmt2("%s: latency p50 %d p90 %d p99 %d max %d us (%d stamped)");
+        std::cout << (fmt2 % topic % pct(50) % pct(90) % pct(99) % latencies.back() % latencies.size()).str() << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string node_name = "b0_topic_hz";
+    std::vector<std::string> topic_names;
+    int window_size = 10000;
+    double window_duration = 10.0, interval = 1.0;
+    b0::addOptionString("node-name,n", "name of node", &node_name);
+    b0::addOptionInt("window-size,w", "maximum number of messages of the sliding window", &window_size, false, 10000);
+    b0::addOptionDouble("window-duration,d", "maximum duration of the sliding window, in seconds", &window_duration, false, 10.0);
+    b0::addOptionDouble("interval,i", "seconds between reports", &interval, false, 1.0);
+    b0::addOptionStringVector("topic-name,t", "name of topic (can be repeated)", &topic_names, true);
+    b0::setPositionalOption("topic-name", -1);
+    b0::init(argc, argv);
+
+    if(window_size < 2)
+        throw b0::exception::ArgumentError(std::to_string(window_size), "window-size");
+    if(interval <= 0)
+        throw b0::exception::ArgumentError(std::to_string(interval), "interval");
+
+    b0::Node node(node_name);
+    std::vector<TopicStats> topics(topic_names.size());
+    for(size_t i = 0; i < topic_names.size(); i++)
+        topics[i].sub.reset(new b0::Subscriber(&node, topic_names[i], true, false));
+    node.init();
+
+    // payloads are not decoded: only the headers are parsed, for the Send-time stamp
+    std::shared_ptr<const void> buffer;
+    b0::message::MessageEnvelopeView env;
+    b0::compress::Context context;
+    int64_t next_report = node.timeUSec() + int64_t(interval * 1e6);
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        bool idle = true;
+        for(auto &t : topics)
+        {
+            while(t.sub->poll())
+            {
+                boost::string_ref wire = t.sub->readWire(buffer);
+                Sample s;
+                s.time = node.timeUSec();
+                s.size = wire.size();
+                s.latency = -1;
+                try
+                {
+                    // rejecting the envelope once the headers are parsed skips the parts
+                    b0::message::parse(env, wire.data(), wire.size(), context, [&](const b0::message::MessageEnvelopeView &e) {
+                        if(auto send_time = e.findHeader("Send-time"))
+                            s.latency = s.time - boost::lexical_cast<int64_t>(send_time->to_string());
+                        return false;
+                    });
+                }
+                catch(std::exception &)
+                {
+                }
+                t.window.push_back(s);
+                while(t.window.size() > size_t(window_size) || s.time - t.window.front().time > int64_t(window_duration * 1e6))
+                    t.window.pop_front();
+                idle = false;
+            }
+        }
+
+        int64_t now = node.timeUSec();
+        if(now >= next_report)
+        {
+            for(size_t i = 0; i < topics.size(); i++)
+                report(topic_names[i], topics[i].window);
+            next_report += int64_t(interval * 1e6);
+        }
+        else if(idle)
+        {
+            node.sleepUSec(std::min<int64_t>(1000, next_report - now));
+        }
+    }
+
+    node.cleanup();
+    return 0;
+}
@@ -11,7 +11,9 @@ int main(int argc, char **argv)
     node.init();
     resolv_cli.init();
     b0::message::graph::Graph graph;
-    resolv_cli.getGraph(graph);
+    b0::message::graph::GetGraphRequest query;
+    query.link_type = "topic";
+    resolv_cli.getGraph(graph, query);
     std::set<std::string> topics;
     for(auto &link : graph.node_topic)
         topics.insert(link.other_name);
@@ -1,36 +1,126 @@
 #include <string>
+#include <fstream>
 #include <iostream>
 #include <iterator>
+#include <random>
+#include <vector>
 
 #include <boost/thread.hpp>
 
 #include <b0/node.h>
 #include <b0/publisher.h>
+#include <b0/exceptions.h>
+#include <b0/bag/bag.h>
+#include <b0/utils/env.h>
 
 int main(int argc, char **argv)
 {
-    std::string node_name = "b0_topic_publish", topic_name = "", content_type = "";
+    std::string node_name = "b0_topic_publish", topic_name = "", content_type = "", file = "", bag_file = "";
+    double rate = -1, duration = 0;
+    int64_t count = 0;
+    int random_size = -1;
     b0::addOptionString("node-name,n", "name of node", &node_name);
     b0::addOptionString("topic-name,t", "name of topic", &topic_name);
     b0::addOptionString("content-type,c", "content type", &content_type);
     b0::addOption("one-shot,1", "publish once and exit");
+    b0::addOptionDouble("rate,r", "messages per second (0 = as fast as possible, default: the node's spin rate)", &rate, false, -1);
+    b0::addOptionInt64("count,N", "number of messages to publish, then exit (0 = no limit)", &count);
+    b0::addOptionDouble("duration,d", "seconds to publish, then exit (0 = no limit)", &duration);
+    b0::addOptionString("file,f", "publish the content of this file (instead of stdin)", &file);
+    b0::addOptionInt("random,R", "publish random payloads of this size (instead of stdin)", &random_size, false, -1);
+    b0::addOptionString("bag,b", "publish the payloads recorded in this bag file, in turn (instead of stdin)", &bag_file);
     b0::setPositionalOption("topic-name");
     b0::init(argc, argv);
 
-    std::cin >> std::noskipws;
-    std::istream_iterator<char> it(std::cin);
-    std::istream_iterator<char> end;
-    std::string payload(it, end);
+    // enough to flush the last messages to the proxy, without waiting on unreachable peers
+    if(b0::env::get("B0_LINGER_PERIOD").empty())
+        b0::setLingerPeriod(500);
+
+    if(b0::hasOption("one-shot"))
+        count = 1;
+
+    // the payloads to publish, in turn
+    std::vector<std::vector<b0::message::MessagePart>> payloads;
+    auto addPayload = [&](std::string &&payload) {
+        b0::message::MessagePart part;
+        part.content_type = content_type;
+        part.compression_level = 0;
+        part.payload = std::move(payload);
+        payloads.push_back({part});
+    };
+    if(!bag_file.empty())
+    {
+        // the messages of this topic, or of all the topics if it was not recorded
+        b0::bag::Reader reader(bag_file);
+        if(reader.getTopics().count(topic_name))
+            reader.setTopics({topic_name});
+        b0::bag::Record record;
+        while(reader.next(record))
+        {
+            b0::message::MessageEnvelope env;
+            b0::message::parse(env, record.wire.data(), record.wire.size());
+            payloads.push_back(env.parts);
+        }
+        if(payloads.empty())
+            throw b0::exception::Exception(bag_file + " has no messages");
+    }
+    else if(random_size >= 0)
+    {
+        std::mt19937 rng(std::random_device{}());
+        std::uniform_int_distribution<int> byte(0, 255);
+        for(int i = 0; i < 16; i++)
+        {
+            std::string payload(random_size, '\0');
+            for(auto &c : payload) c = static_cast<char>(byte(rng));
+            addPayload(std::move(payload));
+        }
+    }
+    else
+    {
+        std::ifstream f;
+        if(!file.empty())
+        {
+            f.open(file, std::ios::binary);
+            if(!f)
+                throw b0::exception::Exception("cannot open " + file);
+        }
+        std::istream &in = file.empty() ? std::cin : f;
+        in >> std::noskipws;
+        std::istream_iterator<char> it(in);
+        std::istream_iterator<char> end;
+        addPayload(std::string(it, end));
+    }
 
     b0::Node node(node_name);
     b0::Publisher pub(&node, topic_name);
+    node.setEphemeral(true);
     node.init();
-    node.spin([&]() {
-        pub.publish(payload, content_type);
-        if(b0::hasOption("one-shot"))
+
+    int64_t sent = 0, bytes = 0, start = node.hardwareTimeUSec(), end = duration > 0 ? start + int64_t(duration * 1e6) : INT64_MAX;
+    auto publishNext = [&]() {
+        const auto &parts = payloads[sent % payloads.size()];
+        pub.publish(parts);
+        sent++;
+        for(auto &part : parts) bytes += part.payload.size();
+        if((count > 0 && sent >= count) || node.hardwareTimeUSec() >= end)
             node.shutdown();
-    });
+    };
+    if(rate == 0)
+    {
+        while(!node.shutdownRequested())
+            publishNext();
+    }
+    else
+    {
+        node.spin(publishNext, rate);
+    }
+
+    // report the rate actually achieved
+    double elapsed = (node.hardwareTimeUSec() - start) / 1e6;
+    if(count != 1)
+        std::cerr << "Published " << sent << " messages (" << bytes << " bytes) in " << elapsed << " s: "
+            << (elapsed > 0 ? sent / elapsed : 0) << " msg/s, " << (elapsed > 0 ? bytes / elapsed : 0) << " B/s" << std::endl;
+
     node.cleanup();
     return 0;
 }
-
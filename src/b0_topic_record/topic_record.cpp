@@ -0,0 +1,57 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <b0/node.h>
+#include <b0/subscriber.h>
+#include <b0/exceptions.h>
+#include <b0/bag/bag.h>
+
+int main(int argc, char **argv)
+{
+    std::string node_name = "b0_topic_record", output_file = "", compression_algorithm = "";
+    std::vector<std::string> topic_names;
+    int chunk_size_kb = 4096, compression_level = -1;
+    b0::addOptionString("node-name,n", "name of node", &node_name);
+    b0::addOptionString("output,o", "bag file to write", &output_file, true);
+    b0::addOptionInt("chunk-size,c", "size of the chunks of the file, in KiB", &chunk_size_kb, false, 4096);
+    b0::addOptionString("compression,z", "compression algorithm of the chunks (e.g. lz4, zstd)", &compression_algorithm);
+    b0::addOptionInt("compression-level,l", "compression level", &compression_level, false, -1);
+    b0::addOptionStringVector("topic-name,t", "name of topic (can be repeated)", &topic_names, true);
+    b0::setPositionalOption("topic-name", -1);
+    b0::init(argc, argv);
+
+    if(chunk_size_kb <= 0)
+        throw b0::exception::ArgumentError(std::to_string(chunk_size_kb), "chunk-size");
+
+    b0::Node node(node_name);
+    std::vector<std::unique_ptr<b0::Subscriber>> subs;
+    for(auto &topic_name : topic_names)
+        subs.emplace_back(new b0::Subscriber(&node, topic_name));
+    node.init();
+
+    b0::bag::Writer writer(output_file, size_t(chunk_size_kb) * 1024, compression_algorithm, compression_level);
+    std::shared_ptr<const void> buffer;
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        bool idle = true;
+        for(auto &sub : subs)
+        {
+            while(sub->poll())
+            {
+                boost::string_ref wire = sub->readWire(buffer);
+                writer.write(node.timeUSec(), wire.data(), wire.size());
+                idle = false;
+            }
+        }
+        if(idle)
+            node.sleepUSec(1000);
+    }
+    writer.close();
+    std::cerr << "Recorded " << writer.getMessageCount() << " messages (" << writer.getByteCount() << " bytes) to " << output_file << std::endl;
+
+    node.cleanup();
+    return 0;
+}
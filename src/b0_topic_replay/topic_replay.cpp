@@ -0,0 +1,70 @@
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/exceptions.h>
+#include <b0/bag/bag.h>
+
+int main(int argc, char **argv)
+{
+    std::string node_name = "b0_topic_replay", input_file = "";
+    std::vector<std::string> topic_names;
+    double rate = 1.0, delay = 1.0, start = 0.0, duration = 0.0;
+    b0::addOptionString("node-name,n", "name of node", &node_name);
+    b0::addOptionString("input,i", "bag file to read", &input_file, true);
+    b0::addOptionDouble("rate,r", "replay rate (1 = real time, 0 = as fast as possible)", &rate, false, 1.0);
+    b0::addOptionDouble("delay,d", "seconds to wait before replaying, for the subscribers to connect", &delay, false, 1.0);
+    b0::addOptionStringVector("topic-name,t", "replay only this topic (can be repeated)", &topic_names);
+    b0::addOptionDouble("start,s", "seconds from the beginning of the recording to start from", &start, false, 0.0);
+    b0::addOptionDouble("duration,u", "seconds of the recording to replay (0 = until the end)", &duration, false, 0.0);
+    b0::addOption("loop,l", "replay the file in a loop");
+    b0::setPositionalOption("input");
+    b0::init(argc, argv);
+
+    if(rate < 0)
+        throw b0::exception::ArgumentError(std::to_string(rate), "rate");
+
+    b0::bag::Reader reader(input_file);
+    if(!reader.isIndexed())
+        std::cerr << "Warning: " << input_file << " has no index (recording interrupted?)" << std::endl;
+
+    std::set<std::string> topics(topic_names.begin(), topic_names.end());
+    reader.setTopics(topics);
+
+    b0::Node node(node_name);
+    std::map<std::string, std::unique_ptr<b0::Publisher>> pubs;
+    for(auto &topic : reader.getTopics())
+        if(topics.empty() || topics.count(topic.first))
+            pubs[topic.first].reset(new b0::Publisher(&node, topic.first));
+    node.init();
+
+    node.responsiveSleepUSec(int64_t(delay * 1000000));
+
+    uint64_t count = 0;
+    do
+    {
+        int64_t t0_bag = reader.getStartTime() + int64_t(start * 1000000), t0 = node.timeUSec();
+        int64_t t1_bag = duration > 0 ? t0_bag + int64_t(duration * 1000000) : INT64_MAX;
+        reader.seekTime(t0_bag);
+        b0::bag::Record record;
+        while(!node.shutdownRequested() && reader.next(record) && record.time <= t1_bag)
+        {
+            if(rate > 0)
+                node.responsiveSleepUntilUSec(t0 + int64_t((record.time - t0_bag) / rate));
+            auto it = pubs.find(record.topic.to_string());
+            if(it == pubs.end()) continue;
+            it->second->writeWire(record.wire.data(), record.wire.size());
+            count++;
+        }
+    }
+    while(b0::hasOption("loop") && !node.shutdownRequested());
+    std::cerr << "Replayed " << count << " messages from " << input_file << std::endl;
+
+    node.cleanup();
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+#include <b0/node.h>
+#include <b0/subscriber.h>
+#include <b0/compress/compress.h>
+
+int main(int argc, char **argv)
+{
+    std::string node_name = "b0_train_dictionary", topic_name = "", output = "", algorithm = "zstd";
+    int num_samples = 1000, max_size = 16384;
+    b0::addOptionString("node-name,n", "name of node", &node_name);
+    b0::addOptionString("topic-name,t", "name of topic to capture the samples from", &topic_name);
+    b0::addOptionString("output,o", "file to write the dictionary to", &output, true);
+    b0::addOptionString("algorithm,a", "compression algorithm", &algorithm, false, "zstd");
+    b0::addOptionInt("samples,s", "number of messages to capture", &num_samples, false, 1000);
+    b0::addOptionInt("max-size,m", "maximum size of the dictionary, in bytes", &max_size, false, 16384);
+    b0::setPositionalOption("topic-name");
+    b0::init(argc, argv);
+
+    std::vector<std::string> samples;
+    b0::Node node(node_name);
+    b0::Subscriber::CallbackRaw callback = [&](const std::string &payload) {
+        samples.push_back(payload);
+        if(samples.size() >= num_samples)
+            node.shutdown();
+    };
+    b0::Subscriber sub(&node, topic_name, callback);
+    node.init();
+    node.spin();
+    node.cleanup();
+
+    std::string dictionary = b0::compress::trainDictionary(algorithm, samples, max_size);
+    std::ofstream f(output, std::ios::binary);
+    f.write(dictionary.data(), dictionary.size());
+    if(!f)
+    {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+    std::cout << "Trained a " << dictionary.size() << " bytes dictionary from " << samples.size() << " messages" << std::endl;
+    return 0;
+}
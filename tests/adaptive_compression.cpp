@@ -0,0 +1,74 @@
+#include <iostream>
+#include <cstdlib>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void check(bool cond, const std::string &what, const b0::SocketCounters &c)
+{
+    std::cout << what << ": skipped=" << c.compression_skipped << " ratio=" << c.compression_ratio << std::endl;
+    if(!cond)
+    {
+        std::cerr << "check failed: " << what << std::endl;
+        exit(1);
+    }
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "A");
+    pub.setCompression("zlib");
+    pub.setAdaptiveCompression(true, 256, 0.9, 10);
+    node.init();
+    const b0::SocketCounters &c = pub.getCounters();
+
+    // incompressible payloads: compression must be suspended, except for the probes
+    for(int i = 0; i < 100; i++)
+    {
+        std::string payload(1000, '\0');
+        for(auto &x : payload) x = static_cast<char>(rand());
+        pub.publish(payload);
+    }
+    check(c.compression_skipped >= 80 && c.compression_ratio > 0.9, "random payloads", c);
+
+    // compressible payloads: compression must resume after the next probe
+    uint64_t skipped = c.compression_skipped;
+    for(int i = 0; i < 100; i++)
+        pub.publish(std::string(1000, 'x'));
+    check(c.compression_skipped - skipped <= 10 && c.compression_ratio < 0.5, "compressible payloads", c);
+
+    // small payloads are never compressed
+    skipped = c.compression_skipped;
+    for(int i = 0; i < 10; i++)
+        pub.publish(std::string(50, 'x'));
+    check(c.compression_skipped - skipped == 10, "small payloads", c);
+
+    exit(0);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&pub_thread);
+    t0.join();
+}
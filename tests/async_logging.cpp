@@ -0,0 +1,58 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/logger/logger.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+class TestNode : public b0::Node
+{
+public:
+    TestNode() : b0::Node("node") {}
+
+    uint64_t droppedCount() const
+    {
+        return dynamic_cast<b0::logger::Logger*>(p_logger_)->getDroppedCount();
+    }
+};
+
+void node_thread()
+{
+    TestNode node;
+    node.init();
+
+    // B0_ASYNC_LOGGING_QUEUE_SIZE is set to a small value by the test, so that a burst
+    // must overflow the queue; logging must not block, and drops must be counted:
+    for(int i = 0; i < 10000; i++)
+        node.info("message %d", i);
+
+    uint64_t dropped = node.droppedCount();
+    std::cout << "dropped: " << dropped << std::endl;
+    node.cleanup();
+    exit(dropped > 0 ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+    b0::setAsyncLogging(true);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&node_thread);
+    t0.join();
+}
@@ -0,0 +1,155 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include <b0/b0.h>
+#include <b0/bag/bag.h>
+#include <b0/exceptions.h>
+
+void check(bool cond, const std::string &what)
+{
+    if(!cond)
+    {
+        std::cerr << "Test failed: " << what << std::endl;
+        exit(1);
+    }
+}
+
+b0::message::MessageEnvelope envelope(int i)
+{
+    b0::message::MessageEnvelope env;
+    env.header0 = i % 3 ? "A" : "B";
+    b0::message::MessagePart part;
+    part.content_type = "text/plain";
+    part.payload = std::string(100 + i, 'a' + i % 26);
+    env.parts.push_back(part);
+    return env;
+}
+
+std::string wire(int i)
+{
+    std::string w;
+    serialize(envelope(i), w);
+    return w;
+}
+
+void checkRecords(b0::bag::Reader &reader, int n, const std::string &name)
+{
+    b0::bag::Record record;
+    for(int i = 0; i < n; i++)
+    {
+        check(reader.next(record), name + ": record " + std::to_string(i));
+        check(record.time == 1000 * i, name + ": time");
+        check(record.wire == wire(i), name + ": envelope");
+        check(record.topic == (i % 3 ? "A" : "B"), name + ": topic");
+    }
+    check(!reader.next(record), name + ": end");
+}
+
+int main(int argc, char **argv)
+{
+    std::string algo = "";
+    b0::addOptionString("algorithm,a", "compression algorithm of the chunks", &algo);
+    b0::setPositionalOption("algorithm");
+    b0::init(argc, argv);
+
+    const int n = 1000;
+    std::string path = "b0_test.bag";
+
+    {
+        // small chunks to get several of them
+        b0::bag::Writer writer(path, 10000, algo);
+        for(int i = 0; i < n; i++)
+        {
+            std::string w = wire(i);
+            if(i % 2)
+                writer.write(1000 * i, w.data(), w.size());
+            else
+                writer.write(1000 * i, envelope(i));
+        }
+        check(writer.getMessageCount() == n, "writer message count");
+
+        // not closed yet: readable without index, up to the last chunk written
+        writer.flush();
+        b0::bag::Reader reader(path);
+        check(!reader.isIndexed(), "unclosed file has no index");
+        check(reader.getMessageCount() == n, "unclosed file message count");
+        check(reader.getTopics().at("A") + reader.getTopics().at("B") == n, "unclosed file topics");
+        checkRecords(reader, n, "unclosed file");
+
+        writer.close();
+    }
+
+    b0::bag::Reader reader(path);
+    check(reader.isIndexed(), "closed file has an index");
+    check(reader.getChunks().size() > 1, "chunk count");
+    check(reader.getMessageCount() == n, "message count");
+    check(reader.getTopics().size() == 2 && reader.getTopics().at("B") == (n + 2) / 3, "topics");
+    check(reader.getStartTime() == 0 && reader.getEndTime() == 1000 * (n - 1), "time span");
+    checkRecords(reader, n, "closed file");
+    reader.rewind();
+    checkRecords(reader, n, "rewound file");
+
+    b0::bag::Record record;
+    reader.seekTime(500500);
+    check(reader.next(record) && record.time == 501000, "seek to time");
+
+    reader.setTopics({"B"});
+    int count = 0;
+    while(reader.next(record))
+    {
+        check(record.topic == "B" && record.wire == wire(record.time / 1000), "topic filter");
+        count++;
+    }
+    check(count == (n + 2) / 3, "topic filter count");
+    reader.seekTime(600000);
+    check(reader.next(record) && record.topic == "B" && record.time == 600000, "seek with topic filter");
+
+    try
+    {
+        b0::bag::Reader bad(argv[0]);
+        check(false, "a non-bag file must not be opened");
+    }
+    catch(b0::exception::Exception &ex) {}
+
+    std::remove(path.c_str());
+
+    {
+        // small files to get several of them, the oldest deleted
+        b0::bag::RotatingWriter writer("b0_test_rotating", 20000, 0, 3, 5000, algo);
+        for(int i = 0; i < n; i++)
+        {
+            std::string w = wire(i);
+            writer.write(1000 * i, w.data(), w.size());
+        }
+        writer.flush();
+        check(writer.getMessageCount() == n, "rotating writer message count");
+        std::vector<std::string> files = writer.getFiles();
+        check(files.size() == 3, "rotating writer file count");
+        writer.close();
+
+        // the files kept hold the last messages, in order
+        int i = n;
+        for(auto it = files.rbegin(); it != files.rend(); ++it)
+        {
+            b0::bag::Reader reader(*it);
+            check(reader.isIndexed(), "rotated file has an index");
+            i -= reader.getMessageCount();
+        }
+        check(i > 0, "oldest files deleted");
+        for(auto &file : files)
+        {
+            b0::bag::Reader reader(file);
+            b0::bag::Record record;
+            while(reader.next(record))
+            {
+                check(record.time == 1000 * i && record.wire == wire(i), "rotated file records");
+                i++;
+            }
+            std::remove(file.c_str());
+        }
+        check(i == n, "rotated files end");
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/utils/buffer_pool.h>
+
+std::string big_payload(4 << 20, 'x');
+
+std::atomic<int> received{0};
+std::atomic<bool> done{false};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", static_cast<b0::Subscriber::CallbackRaw>([&](const std::string &payload) {
+        if(payload == big_payload) received++;
+    }));
+    node.init();
+    while(!node.shutdownRequested() && !done)
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+    node.cleanup();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{20});
+    exit(1);
+}
+
+bool check(bool cond, const std::string &what)
+{
+    std::cout << what << ": " << (cond ? "ok" : "FAILED") << std::endl;
+    return cond;
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    bool ok = true;
+
+    {
+        b0::BufferPool pool;
+        ok &= check(pool.allocate(100) == nullptr, "small buffers are left to ZeroMQ");
+
+        void *a = pool.allocate(1 << 20);
+        pool.deallocate(a, 1 << 20);
+        void *b = pool.allocate(1 << 20);
+        b0::BufferPool::Stats stats = pool.getStats();
+        ok &= check(a == b && stats.thread_cache_hits == 1 && stats.fresh_allocations == 1, "reuse from the thread cache");
+        // a slightly smaller buffer is of the same class
+        pool.deallocate(b, 1 << 20);
+        void *c = pool.allocate((1 << 20) - 1000);
+        ok &= check(c == a, "same size class");
+        pool.deallocate(c, (1 << 20) - 1000);
+
+        pool.setThreadCacheSize(0);
+        void *d = pool.allocate(3 << 20);
+        pool.deallocate(d, 3 << 20);
+        void *e = pool.allocate(3 << 20);
+        stats = pool.getStats();
+        ok &= check(d == e && stats.shared_cache_hits == 1, "reuse from the shared cache");
+        pool.deallocate(e, 3 << 20);
+        stats = pool.getStats();
+        ok &= check(stats.bytes_in_use == 0 && stats.bytes_cached >= (4 << 20), "bytes cached");
+        pool.trim();
+    }
+
+    // the buffers of the messages sent are reused:
+    std::shared_ptr<b0::BufferPool> pool = std::make_shared<b0::BufferPool>();
+    b0::setBufferAllocator(pool);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+
+    {
+        b0::Node node("pub");
+        b0::Publisher pub(&node, "topic1");
+        node.init();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+        const int n = 40;
+        for(int i = 0; i < n; i++)
+        {
+            pub.publish(big_payload);
+            boost::this_thread::sleep_for(boost::chrono::milliseconds{20});
+        }
+        for(int i = 0; i < 50 && received < n / 2; i++)
+            boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+        node.cleanup();
+
+        b0::BufferPool::Stats stats = pool->getStats();
+        std::cout << "received " << received << ", allocations " << stats.allocations << ", fresh " << stats.fresh_allocations << std::endl;
+        ok &= check(received > 0, "messages received");
+        ok &= check(stats.allocations >= uint64_t(n) && stats.fresh_allocations < stats.allocations / 2, "buffers reused");
+    }
+
+    done = true;
+    t2.join();
+    b0::setBufferAllocator(nullptr);
+
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,94 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/bindings/c.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0_node *node = b0_node_new("pub");
+    b0_publisher *pub = b0_publisher_new(node, "topic1");
+    b0_node_init(node);
+    b0_message_ref msgs[3] = {
+        {"a", 1, "text/plain"},
+        {"bb", 2, nullptr},
+        {"ccc", 3, nullptr}
+    };
+    for(;;)
+    {
+        b0_publisher_publish_batch(pub, msgs, 3);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+void sub_thread()
+{
+    b0_node *node = b0_node_new("sub");
+    b0_subscriber *sub = b0_subscriber_new(node, "topic1", nullptr);
+    b0_node_init(node);
+
+    // smaller than a batch: the rest of a batch comes with the next call
+    std::vector<std::string> received;
+    while(received.size() < 30)
+    {
+        b0_message_ref msgs[2];
+        size_t count;
+        b0_message *msg = b0_subscriber_read_batch(sub, msgs, 2, &count, 1000);
+        if(!msg) exit(1);
+        for(size_t i = 0; i < count; i++)
+        {
+            received.push_back(std::string(static_cast<const char *>(msgs[i].data), msgs[i].size));
+            if(received.back() == "a" && std::strcmp(msgs[i].type, "text/plain") != 0)
+            {
+                std::cerr << "bad type: " << msgs[i].type << std::endl;
+                exit(1);
+            }
+        }
+        b0_message_release(msg);
+    }
+
+    // whatever the first message received, the batches then follow in order
+    size_t first = 0;
+    while(received[first] != "a") first++;
+    const char *expected[] = {"a", "bb", "ccc"};
+    for(size_t i = first; i < received.size(); i++)
+    {
+        if(received[i] != expected[(i - first) % 3])
+        {
+            std::cerr << "message " << i << ": " << received[i] << std::endl;
+            exit(1);
+        }
+    }
+    exit(0);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0_init(&argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
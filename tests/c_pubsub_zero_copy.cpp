@@ -0,0 +1,107 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/bindings/c.h>
+
+std::atomic<int> freed{0};
+
+void free_owned(void *data, void *hint)
+{
+    std::free(data);
+    freed++;
+}
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0_node *node = b0_node_new("pub");
+    b0_publisher *pub = b0_publisher_new(node, "topic1");
+    b0_node_init(node);
+    for(;;)
+    {
+        // written directly into the frame sent
+        void *data;
+        b0_frame *frame = b0_publisher_frame_new(pub, 11, &data);
+        std::memcpy(data, "hello-frame", 11);
+        b0_publisher_publish_frame(pub, frame);
+
+        // handed over to the library
+        void *owned = std::malloc(11);
+        std::memcpy(owned, "hello-owned", 11);
+        b0_publisher_publish_owned(pub, owned, 11, &free_owned, nullptr);
+
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+void sub_thread()
+{
+    b0_node *node = b0_node_new("sub");
+    b0_subscriber *sub = b0_subscriber_new(node, "topic1", nullptr);
+    b0_node_init(node);
+
+    const void *data;
+    size_t size;
+    b0_message *msg = b0_subscriber_read_lend(sub, &data, &size);
+    if(!msg || size != 11 || std::memcmp(data, "hello-", 6) != 0)
+    {
+        std::cerr << "bad lent message" << std::endl;
+        exit(1);
+    }
+    b0_message_release(msg);
+
+    char small[5];
+    if(!b0_subscriber_read_into(sub, small, sizeof(small), &size) || size != 11 || std::memcmp(small, "hello", 5) != 0)
+    {
+        std::cerr << "bad truncated message" << std::endl;
+        exit(1);
+    }
+
+    bool got_frame = false, got_owned = false;
+    while(!got_frame || !got_owned)
+    {
+        char buf[64];
+        if(!b0_subscriber_read_into(sub, buf, sizeof(buf), &size))
+            exit(1);
+        std::string s(buf, size);
+        if(s == "hello-frame") got_frame = true;
+        else if(s == "hello-owned") got_owned = true;
+        else
+        {
+            std::cerr << "bad message: " << s << std::endl;
+            exit(1);
+        }
+    }
+    exit(freed > 0 ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0_init(&argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,78 @@
+#include <iostream>
+#include <atomic>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub_slow(&node, "slow");
+    b0::Publisher pub_fast(&node, "fast");
+    node.init();
+    for(;;)
+    {
+        pub_slow.publish(std::string("x"));
+        pub_fast.publish(std::string("y"));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{20});
+    }
+}
+
+std::atomic<bool> slow_running(false);
+std::atomic<int> fast_received(0);
+
+void slow_callback(const std::string &msg)
+{
+    // stall this socket for longer than the test timeout
+    slow_running = true;
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+}
+
+void fast_callback(const std::string &msg)
+{
+    // the other socket must still be served while the slow callback runs
+    if(slow_running && ++fast_received == 10)
+    {
+        std::cout << "fast callback not stalled" << std::endl;
+        exit(0);
+    }
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub_slow(&node, "slow", &slow_callback);
+    b0::Subscriber sub_fast(&node, "fast", &fast_callback);
+    node.setCallbackThreads(2);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,103 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/utils/metrics.h>
+#include <b0/utils/profiler.h>
+
+class CountingHook : public b0::ProfilerHook
+{
+public:
+    void beginCallback(const b0::Socket &socket) override
+    {
+        if(inside.exchange(true)) nested = true;
+    }
+
+    void endCallback(const b0::Socket &socket, int64_t wall_usec, int64_t cpu_usec) override
+    {
+        if(!inside.exchange(false)) nested = true;
+        if(wall_usec < 0 || cpu_usec < 0) negative = true;
+        count++;
+    }
+
+    std::atomic<bool> inside{false};
+    std::atomic<bool> nested{false};
+    std::atomic<bool> negative{false};
+    std::atomic<int> count{0};
+};
+
+CountingHook hook;
+
+int received = 0;
+
+void callback(const std::string &msg)
+{
+    // burn some CPU, so that the measured CPU time is not zero
+    volatile double x = 0;
+    for(int i = 0; i < 1000000; i++) x = x + i;
+    received++;
+}
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    for(;;)
+    {
+        pub.publish(std::string("msg"));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", &callback);
+    node.init();
+    while(received < 10)
+        node.spinOnce();
+
+    int64_t cpu_total = sub.getCounters().callback_cpu.total();
+    bool ok = hook.count == received && !hook.nested && !hook.negative
+        && sub.getCounters().callback_cpu.count() == uint64_t(received) && cpu_total > 0;
+    std::cout << "hook calls: " << hook.count << ", callbacks: " << received
+        << ", callback CPU time: " << cpu_total << "us: " << (ok ? "ok" : "mismatch") << std::endl;
+    exit(ok ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+#ifndef ENABLE_PROFILING
+    std::cout << "built without ENABLE_PROFILING, skipping" << std::endl;
+    return 0;
+#else
+    b0::init(argc, argv);
+    b0::setProfilerHook(&hook);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+#endif
+}
@@ -0,0 +1,105 @@
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+#include <b0/exceptions.h>
+
+const int num_calls = 8;
+
+std::atomic<uint64_t> rejected_workers{0}, rejected_serial{0};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void srv_thread(const std::string &service, int workers, size_t limit, std::atomic<uint64_t> *rejected)
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, service, b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{200});
+        rep = req + "_";
+    }));
+    srv.setWorkerThreads(workers);
+    srv.setAdmissionLimit(limit);
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        *rejected = srv.getRejectedRequests();
+        node.sleepUSec(1000);
+    }
+}
+
+bool burst(b0::ServiceClient &cli, const std::string &title, std::atomic<uint64_t> &rejected)
+{
+    std::vector<std::future<std::vector<b0::message::MessagePart> > > futures;
+    for(int i = 0; i < num_calls; i++)
+    {
+        std::vector<b0::message::MessagePart> parts(1);
+        parts[0].payload = "req" + std::to_string(i);
+        futures.push_back(cli.callAsync(parts));
+    }
+    cli.waitReplies(5000);
+
+    int served = 0, busy = 0;
+    for(auto &f : futures)
+    {
+        try
+        {
+            f.get();
+            served++;
+        }
+        catch(b0::exception::ServerBusy &)
+        {
+            busy++;
+        }
+    }
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+    std::cout << title << ": " << served << " served, " << busy << " busy, " << rejected << " rejected by the server" << std::endl;
+    return served >= 1 && served <= 4 && served + busy == num_calls && rejected == uint64_t(busy);
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli1(&node, "workers");
+    b0::ServiceClient cli2(&node, "serial");
+    node.init();
+
+    bool ok = burst(cli1, "worker threads", rejected_workers);
+    ok &= burst(cli2, "no worker threads", rejected_serial);
+
+    // once the burst is over, the calls are served again:
+    std::string rep;
+    cli1.call(std::string("again"), rep);
+    ok &= rep == "again_";
+    exit(ok ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread, "workers", 1, 2, &rejected_workers);
+    boost::thread t3(&srv_thread, "serial", 0, 1, &rejected_serial);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t4(&cli_thread);
+    t0.join();
+}
@@ -0,0 +1,85 @@
+#include <chrono>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void slow_callback(const std::string &req, std::string &rep)
+{
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    rep = req + "_";
+}
+
+void srv_thread(std::string name)
+{
+    b0::Node node("srv-" + name);
+    b0::ServiceServer srv(&node, name, &slow_callback);
+    node.init();
+    node.spin();
+}
+
+std::vector<b0::message::MessagePart> request(const std::string &payload)
+{
+    std::vector<b0::message::MessagePart> parts(1);
+    parts[0].payload = payload;
+    return parts;
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli1(&node, "service1"), cli2(&node, "service2"), cli3(&node, "service3");
+    node.init();
+
+    // the three calls are in flight at the same time, so they take the time of the slowest one
+    auto t0 = std::chrono::steady_clock::now();
+    auto rep1 = cli1.callAsync(request("a"));
+    auto rep2 = cli2.callAsync(request("b"));
+    std::string rep3;
+    cli3.callAsync(request("c"), [&](const std::vector<b0::message::MessagePart> &parts) {rep3 = parts[0].payload;});
+    bool ok = cli1.waitReplies(2000) && cli2.waitReplies(2000) && cli3.waitReplies(2000);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    ok = ok && rep1.get()[0].payload == "a_" && rep2.get()[0].payload == "b_" && rep3 == "c_";
+    std::cout << "fan-out: " << (ok ? "ok" : "failed") << ", " << ms << " ms" << std::endl;
+    if(!ok || ms > 1200) exit(1);
+
+    // several requests in flight on the same client, and a blocking call after them
+    auto rep4 = cli1.callAsync(request("d"));
+    auto rep5 = cli1.callAsync(request("e"));
+    std::string rep6;
+    cli1.call(std::string("f"), rep6);
+    ok = cli1.getPendingCalls() == 0 && rep4.get()[0].payload == "d_" && rep5.get()[0].payload == "e_" && rep6 == "f_";
+    std::cout << "pipelined: " << (ok ? "ok" : "failed") << std::endl;
+    exit(ok ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{8});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread, "service1");
+    boost::thread t3(&srv_thread, "service2");
+    boost::thread t4(&srv_thread, "service3");
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t5(&cli_thread);
+    t0.join();
+}
@@ -0,0 +1,95 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+std::atomic<int> item_calls{0}, batch_calls{0};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+
+    // items served one by one by the callback
+    b0::ServiceServer srv1(&node, "service1", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {
+        item_calls++;
+        rep = req + "_";
+    }));
+
+    // items served by a batch callback
+    b0::ServiceServer srv2(&node, "service2", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {
+        rep = "not batched";
+    }));
+    srv2.setBatchCallback([](const std::vector<b0::message::MessagePart> &reqs, std::vector<b0::message::MessagePart> &reps) {
+        batch_calls++;
+        reps.resize(reqs.size());
+        for(size_t i = 0; i < reqs.size(); i++)
+            reps[i].payload = reqs[i].payload + "+";
+    });
+
+    node.init();
+    node.spin();
+}
+
+std::vector<b0::message::MessagePart> items(int n)
+{
+    std::vector<b0::message::MessagePart> parts(n);
+    for(int i = 0; i < n; i++)
+        parts[i].payload = "p" + std::to_string(i);
+    return parts;
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli1(&node, "service1");
+    b0::ServiceClient cli2(&node, "service2");
+    node.init();
+
+    // a batch of 100 costs a single request
+    std::vector<b0::message::MessagePart> reps;
+    uint64_t sent = cli1.getCounters().messages_sent;
+    cli1.callBatch(items(100), reps);
+    bool ok = reps.size() == 100 && cli1.getCounters().messages_sent == sent + 1 && item_calls == 100;
+    for(int i = 0; ok && i < 100; i++)
+        ok = reps[i].payload == "p" + std::to_string(i) + "_";
+    std::cout << "per-item callback: " << (ok ? "ok" : "failed") << std::endl;
+    if(!ok) exit(1);
+
+    cli2.callBatch(items(50), reps);
+    ok = reps.size() == 50 && batch_calls == 1 && reps[49].payload == "p49+";
+    std::string rep;
+    cli2.call(std::string("x"), rep);
+    ok = ok && rep == "not batched";
+    std::cout << "batch callback: " << (ok ? "ok" : "failed") << std::endl;
+    exit(ok ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{8});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
@@ -0,0 +1,89 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+// counts the service resolutions which reach the resolver
+std::atomic<int> resolutions{0};
+
+class CountingResolver : public b0::resolver::Resolver
+{
+public:
+    void handleResolveService(const b0::message::resolv::ResolveServiceRequest &rq, b0::message::resolv::ResolveServiceResponse &rsp) override
+    {
+        resolutions++;
+        Resolver::handleResolveService(rq, rsp);
+    }
+};
+
+void resolver_thread()
+{
+    CountingResolver node;
+    node.init();
+    node.spin();
+}
+
+void srv_thread(std::string service)
+{
+    b0::Node node("srv-" + service);
+    b0::ServiceServer srv(&node, service, b0::ServiceServer::CallbackRaw([=](const std::string &req, std::string &rep) {rep = service;}));
+    node.init();
+    node.spin();
+}
+
+bool call(b0::Node &node, const std::string &service)
+{
+    b0::ServiceClient cli(&node, service, false);
+    cli.init();
+    std::string rep;
+    cli.call(std::string("x"), rep);
+    cli.cleanup();
+    return rep == service;
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    node.init();
+
+    // the first graph seen clears the cache, as there is nothing to compare it with
+    bool ok = call(node, "service1");
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    ok = ok && call(node, "service1");
+    int n = resolutions;
+
+    // the clients come and go without asking the resolver again
+    ok = ok && call(node, "service1") && call(node, "service1") && call(node, "service1") && resolutions == n;
+    std::cout << "cached: " << (ok ? "ok" : "failed") << " (" << resolutions << " resolutions)" << std::endl;
+    if(!ok) exit(1);
+
+    // a new service in the graph invalidates the cache
+    boost::thread t(&srv_thread, "service2");
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    ok = call(node, "service1") && resolutions == n + 1 && call(node, "service2") && call(node, "service1") && resolutions == n + 2;
+    std::cout << "invalidated: " << (ok ? "ok" : "failed") << " (" << resolutions << " resolutions)" << std::endl;
+    exit(ok ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{6});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread, "service1");
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
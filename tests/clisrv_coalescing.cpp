@@ -0,0 +1,93 @@
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+std::atomic<int> calls{0};
+std::atomic<uint64_t> coalesced{0};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "map", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {
+        // an expensive computation:
+        calls++;
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{300});
+        rep = req + "_";
+    }));
+    srv.setWorkerThreads(4);
+    srv.setCoalescing(true);
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        coalesced = srv.getCoalescedRequests();
+        node.sleepUSec(1000);
+    }
+}
+
+void cli_thread(std::atomic<int> *ok)
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "map");
+    node.init();
+
+    // a burst of identical requests, and another one:
+    std::vector<std::string> reqs = {"tile-1", "tile-1", "tile-1", "tile-2", "tile-1", "tile-2"};
+    std::vector<std::future<std::vector<b0::message::MessagePart> > > futures;
+    for(auto &req : reqs)
+    {
+        std::vector<b0::message::MessagePart> parts(1);
+        parts[0].payload = req;
+        futures.push_back(cli.callAsync(parts));
+    }
+    cli.waitReplies(5000);
+    for(size_t i = 0; i < reqs.size(); i++)
+    {
+        std::vector<b0::message::MessagePart> rep = futures[i].get();
+        if(!rep.empty() && rep[0].payload == reqs[i] + "_")
+            (*ok)++;
+    }
+    node.cleanup();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    // two clients, each with its own burst:
+    std::atomic<int> ok1{0}, ok2{0};
+    boost::thread t3(&cli_thread, &ok1);
+    boost::thread t4(&cli_thread, &ok2);
+    t3.join();
+    t4.join();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+
+    std::cout << "replies ok: " << ok1 + ok2 << ", callback calls: " << calls << ", coalesced requests: " << coalesced << std::endl;
+    // each distinct request is computed once (or twice, if a client's burst arrives after the first is done):
+    exit(ok1 == 6 && ok2 == 6 && calls >= 2 && calls <= 4 && coalesced == uint64_t(12 - calls) ? 0 : 1);
+}
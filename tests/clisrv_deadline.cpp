@@ -0,0 +1,127 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+#include <b0/exceptions.h>
+
+std::atomic<uint64_t> expired_requests{0};
+std::atomic<bool> srv_a_slow{false};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void deadline_srv_thread()
+{
+    // the "slow" request keeps the server busy past the deadline of the next one
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {
+        if(req == "slow") boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+        rep = req + "_";
+    }));
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        expired_requests = srv.getExpiredRequests();
+        node.sleepUSec(1000);
+    }
+}
+
+void hedging_srv_thread(std::string name)
+{
+    b0::Node node(name);
+    b0::ServiceServer srv(&node, "service2", b0::ServiceServer::CallbackRaw([=](const std::string &req, std::string &rep) {
+        if(name == "srv-a" && srv_a_slow) boost::this_thread::sleep_for(boost::chrono::seconds{1});
+        rep = name;
+    }));
+    node.init();
+    node.spin();
+}
+
+long elapsed_ms(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool call_expires(b0::ServiceClient &cli, const std::string &req)
+{
+    std::string rep;
+    try
+    {
+        cli.call(req, rep);
+        return false;
+    }
+    catch(b0::exception::DeadlineExceeded &ex)
+    {
+        return true;
+    }
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli1(&node, "service1");
+    b0::ServiceClient cli2(&node, "service2");
+    node.init();
+
+    // deadlines: the client gives up in time, and the server drops the request which expired
+    // while it was busy, without serving it
+    cli1.setCallDeadline(200);
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = call_expires(cli1, "slow") && call_expires(cli1, "fast");
+    long ms = elapsed_ms(t0);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    std::string rep;
+    cli1.call(std::string("fast"), rep);
+    ok = ok && rep == "fast_" && expired_requests.load() == 1;
+    std::cout << "deadline: " << (ok ? "ok" : "failed") << ", " << ms << " ms, "
+        << expired_requests.load() << " expired requests" << std::endl;
+    if(!ok || ms > 600) exit(1);
+
+    // hedging: learn the latency from fast calls, then make a server slow; the requests it
+    // gets are sent again to the other server
+    for(int i = 0; i < 40; i++)
+        cli2.call(std::string("x"), rep);
+    srv_a_slow = true;
+    cli2.setHedging(true);
+    t0 = std::chrono::steady_clock::now();
+    for(int i = 0; i < 6; i++)
+    {
+        cli2.call(std::string("x"), rep);
+        ok = ok && rep == "srv-b";
+    }
+    ms = elapsed_ms(t0);
+    std::cout << "hedging: " << (ok ? "ok" : "failed") << ", " << ms << " ms, "
+        << cli2.getHedgedRequests() << " hedged requests" << std::endl;
+    exit(ok && ms < 500 && cli2.getHedgedRequests() >= 3 ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&deadline_srv_thread);
+    boost::thread t3(&hedging_srv_thread, "srv-a");
+    boost::thread t4(&hedging_srv_thread, "srv-b");
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t5(&cli_thread);
+    t0.join();
+}
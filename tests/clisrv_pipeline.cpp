@@ -0,0 +1,89 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void srv_thread()
+{
+    // read the requests in batches of 4, and reply to them in reverse order
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1");
+    node.init();
+    for(;;)
+    {
+        std::vector<b0::message::MessageEnvelope> reqs(4);
+        for(auto &req : reqs) srv.readRaw(req);
+        for(auto it = reqs.rbegin(); it != reqs.rend(); ++it)
+        {
+            b0::message::MessageEnvelope rep;
+            rep.header0 = srv.getServiceName();
+            rep.headers["Correlation-id"] = it->headers["Correlation-id"];
+            rep.parts.resize(1);
+            rep.parts[0].payload = it->parts[0].payload + "_";
+            srv.writeRaw(rep);
+        }
+    }
+}
+
+std::vector<b0::message::MessagePart> request(const std::string &payload)
+{
+    std::vector<b0::message::MessagePart> parts(1);
+    parts[0].payload = payload;
+    return parts;
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "service1");
+    node.init();
+
+    std::vector<std::future<std::vector<b0::message::MessagePart> > > reps;
+    for(auto payload : {"a", "b", "c", "d"})
+        reps.push_back(cli.callAsync(request(payload)));
+    bool ok = cli.waitReplies(2000);
+    ok = ok && reps[0].get()[0].payload == "a_" && reps[1].get()[0].payload == "b_"
+        && reps[2].get()[0].payload == "c_" && reps[3].get()[0].payload == "d_";
+    std::cout << "out of order: " << (ok ? "ok" : "failed") << std::endl;
+    if(!ok) exit(1);
+
+    // the reply of the blocking call comes first, before the ones of the calls still in flight
+    reps.clear();
+    for(auto payload : {"e", "f", "g"})
+        reps.push_back(cli.callAsync(request(payload)));
+    std::string rep;
+    cli.call(std::string("h"), rep);
+    ok = rep == "h_" && cli.getPendingCalls() == 3 && cli.waitReplies(2000);
+    ok = ok && reps[0].get()[0].payload == "e_" && reps[1].get()[0].payload == "f_" && reps[2].get()[0].payload == "g_";
+    std::cout << "blocking call: " << (ok ? "ok" : "failed") << std::endl;
+    exit(ok ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{6});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+const int num_clients = 20;
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {
+        rep = req + "_";
+    }));
+    node.init();
+    node.spin();
+}
+
+//! Make calls with short-lived clients; return the average time of one, in microseconds
+long transientCalls(b0::Node &node, bool &ok)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for(int i = 0; i < num_clients; i++)
+    {
+        b0::ServiceClient cli(&node, "service1", false, false);
+        cli.init();
+        std::string req = "req" + std::to_string(i), rep;
+        cli.call(req, rep);
+        ok = ok && rep == req + "_";
+        cli.cleanup();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() / num_clients;
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    node.init();
+
+    bool ok = true;
+    long unpooled_usec = transientCalls(node, ok);
+    b0::setServiceClientPool(2);
+    long pooled_usec = transientCalls(node, ok);
+
+    std::cout << "replies " << (ok ? "ok" : "failed") << ", " << unpooled_usec << " us per client without pool, "
+        << pooled_usec << " us with pool" << std::endl;
+    node.cleanup();
+    exit(ok && pooled_usec < unpooled_usec ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
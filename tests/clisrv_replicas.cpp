@@ -0,0 +1,87 @@
+#include <iostream>
+#include <set>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void srv_thread(std::string name)
+{
+    // both servers announce the same service, and reply with their name
+    b0::Node node(name);
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([=](const std::string &req, std::string &rep) {rep = name;}));
+    node.init();
+    node.spin();
+}
+
+std::vector<b0::message::MessagePart> request()
+{
+    return std::vector<b0::message::MessagePart>(1);
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli_rr(&node, "service1");
+    b0::ServiceClient cli_lo(&node, "service1");
+    cli_lo.setLoadBalancing(b0::LoadBalancing::LeastOutstanding);
+    node.init();
+
+    bool ok = cli_rr.getRemoteAddresses().size() == 2 && cli_lo.getRemoteAddresses().size() == 2;
+    std::cout << "resolved: " << (ok ? "ok" : "failed") << std::endl;
+    if(!ok) exit(1);
+
+    // round-robin: the requests go to both servers
+    std::set<std::string> servers;
+    for(int i = 0; i < 10; i++)
+    {
+        std::string rep;
+        cli_rr.call(std::string("x"), rep);
+        servers.insert(rep);
+    }
+    ok = servers.size() == 2;
+    std::cout << "round-robin: " << (ok ? "ok" : "failed") << std::endl;
+    if(!ok) exit(1);
+
+    // least outstanding: while a request is pending on a server, the next ones go to the other
+    auto pending = cli_lo.callAsync(request());
+    servers.clear();
+    for(int i = 0; i < 4; i++)
+    {
+        std::string rep;
+        cli_lo.call(std::string("x"), rep);
+        servers.insert(rep);
+    }
+    ok = servers.size() == 1 && cli_lo.waitReplies(2000) && servers.count(pending.get()[0].payload) == 0;
+    std::cout << "least outstanding: " << (ok ? "ok" : "failed") << std::endl;
+    exit(ok ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{6});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread, "srv-a");
+    boost::thread t3(&srv_thread, "srv-b");
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t4(&cli_thread);
+    t0.join();
+}
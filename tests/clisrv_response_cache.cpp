@@ -0,0 +1,89 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+std::atomic<int> callback_calls{0};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {
+        callback_calls++;
+        rep = req + std::string(100000, '=');
+    }));
+    srv.setResponseCache(16);
+    node.init();
+    node.spin();
+}
+
+bool check(const std::string &what, bool ok)
+{
+    std::cout << what << ": " << (ok ? "ok" : "failed") << std::endl;
+    if(!ok) exit(1);
+    return ok;
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli1(&node, "service1");
+    b0::ServiceClient cli2(&node, "service1");
+    b0::ServiceClient cli3(&node, "service1");
+    cli2.setResponseCache(16);
+    cli3.setResponseCache(16, -1);
+    node.init();
+
+    // server cache: the callback is called once for the same request
+    std::string rep1, rep2;
+    cli1.call(std::string("a"), rep1);
+    cli1.call(std::string("a"), rep2);
+    cli1.call(std::string("b"), rep2);
+    check("server cache", callback_calls == 2 && rep1.size() == 100001 && rep2[0] == 'b');
+
+    // client cache, always validated: the second reply is not sent again
+    cli2.call(std::string("a"), rep2);
+    uint64_t received = cli2.getCounters().payload_bytes_received;
+    cli2.call(std::string("a"), rep2);
+    uint64_t received2 = cli2.getCounters().payload_bytes_received - received;
+    std::cout << "validated reply: " << received2 << " bytes" << std::endl;
+    check("client cache (validated)", rep2 == rep1 && received2 < 1000);
+
+    // client cache, never expiring: the second call does not reach the server
+    cli3.call(std::string("a"), rep2);
+    uint64_t sent = cli3.getCounters().messages_sent;
+    cli3.call(std::string("a"), rep2);
+    check("client cache (fresh)", rep2 == rep1 && cli3.getCounters().messages_sent == sent && cli3.getResponseCache().hits() == 1);
+
+    exit(callback_calls == 2 ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{8});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
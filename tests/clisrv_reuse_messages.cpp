@@ -0,0 +1,151 @@
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/optional.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+class NamesRequest : public b0::message::Message
+{
+public:
+    std::vector<std::string> names;
+    boost::optional<std::string> tag;
+
+    std::string type() const override {return "NamesRequest";}
+};
+
+class NamesReply : public b0::message::Message
+{
+public:
+    std::vector<int> lengths;
+
+    std::string type() const override {return "NamesReply";}
+};
+
+namespace spotify
+{
+
+namespace json
+{
+
+template <>
+struct default_codec_t<NamesRequest> {
+    template<typename Codec>
+    static void describe(Codec &codec) {
+        codec.required("names", &NamesRequest::names);
+        codec.optional("tag", &NamesRequest::tag);
+    }
+
+    static codec::object_t<NamesRequest> codec() {
+        auto codec = codec::object<NamesRequest>();
+        describe(codec);
+        return codec;
+    }
+};
+
+template <>
+struct default_codec_t<NamesReply> {
+    template<typename Codec>
+    static void describe(Codec &codec) {
+        codec.required("lengths", &NamesReply::lengths);
+    }
+
+    static codec::object_t<NamesReply> codec() {
+        auto codec = codec::object<NamesReply>();
+        describe(codec);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+void check(bool cond, const std::string &what)
+{
+    if(!cond)
+    {
+        std::cerr << "Test failed: " << what << std::endl;
+        exit(1);
+    }
+}
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+const NamesRequest *last_req = nullptr;
+const NamesReply *last_rep = nullptr;
+int calls = 0;
+
+void callback(const NamesRequest &req, NamesReply &rep)
+{
+    // the second call gets the same instances, reset
+    if(calls++ > 0)
+    {
+        check(&req == last_req && &rep == last_rep, "messages reused");
+        check(!req.tag, "optional field of the previous request reset");
+        check(rep.lengths.empty() && rep.lengths.capacity() >= 3, "reply reset, keeping its capacity");
+    }
+    last_req = &req;
+    last_rep = &rep;
+    for(auto &name : req.names)
+        rep.lengths.push_back(name.size());
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", &callback);
+    srv.setMessageCodec(b0::message::MessageCodec::MsgPack);
+    srv.setReuseMessages(true);
+    node.init();
+    node.spin();
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "service1");
+    cli.setMessageCodec(b0::message::MessageCodec::MsgPack);
+    node.init();
+
+    NamesRequest req;
+    NamesReply rep;
+    req.names = {"a", "bb", "ccc"};
+    req.tag = std::string("x");
+    cli.call(req, rep);
+    check(rep.lengths == std::vector<int>({1, 2, 3}), "first reply");
+
+    req.names = {"dddd"};
+    req.tag = boost::none;
+    cli.call(req, rep);
+    check(rep.lengths == std::vector<int>({4}), "second reply");
+
+    std::cout << "ok" << std::endl;
+    exit(0);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
@@ -0,0 +1,92 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+const int num_chunks = 100;
+const size_t window = 4;
+
+std::atomic<int> produced{0};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+b0::ServiceServer::StreamProducer count_to(const std::vector<b0::message::MessagePart> &req)
+{
+    int n = std::stoi(req.at(0).payload);
+    std::shared_ptr<int> i = std::make_shared<int>(0);
+    return [n, i](std::vector<b0::message::MessagePart> &chunk) {
+        if(*i == n) return false;
+        chunk.resize(1);
+        chunk[0].payload = std::to_string((*i)++);
+        produced++;
+        return true;
+    };
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1");
+    srv.setStreamCallback(&count_to);
+    node.init();
+    node.spin();
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "service1");
+    node.init();
+
+    std::vector<b0::message::MessagePart> req(1);
+    req[0].payload = std::to_string(num_chunks);
+
+    // the server does not run ahead of the consumer by more than the window
+    bool ok = true;
+    int consumed = 0, max_ahead = 0;
+    cli.callStream(req, [&](const std::vector<b0::message::MessagePart> &chunk) {
+        ok = ok && chunk.size() == 1 && chunk[0].payload == std::to_string(consumed);
+        consumed++;
+        max_ahead = std::max(max_ahead, produced.load() - consumed);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{2});
+    }, window);
+    std::cout << "stream: " << consumed << " chunks, at most " << max_ahead << " ahead" << std::endl;
+    ok = ok && consumed == num_chunks && max_ahead <= int(window);
+
+    // a plain call gets all the chunks in one reply
+    std::vector<b0::message::MessagePart> rep;
+    req[0].payload = "3";
+    cli.call(req, rep);
+    std::cout << "plain call: " << rep.size() << " parts" << std::endl;
+    ok = ok && rep.size() == 3 && rep[2].payload == "2";
+
+    exit(ok ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
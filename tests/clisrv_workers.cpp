@@ -0,0 +1,80 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+std::atomic<int> running{0}, max_running{0};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void slow_callback(const std::string &req, std::string &rep)
+{
+    int n = ++running;
+    int m = max_running.load();
+    while(n > m && !max_running.compare_exchange_weak(m, n));
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{300});
+    --running;
+    rep = req + "_";
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", &slow_callback);
+    srv.setWorkerThreads(4);
+    node.setSpinMode(b0::SpinMode::EventDriven);
+    node.init();
+    node.spin();
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "service1");
+    node.init();
+
+    // 8 requests served by 4 workers take two rounds, instead of 8 in a row
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::future<std::vector<b0::message::MessagePart> > > reps;
+    for(int i = 0; i < 8; i++)
+    {
+        std::vector<b0::message::MessagePart> req(1);
+        req[0].payload = std::to_string(i);
+        reps.push_back(cli.callAsync(req));
+    }
+    bool ok = cli.waitReplies(3000);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    for(int i = 0; ok && i < 8; i++)
+        ok = reps[i].get()[0].payload == std::to_string(i) + "_";
+    std::cout << (ok ? "ok" : "failed") << ", " << ms << " ms, max " << max_running.load() << " concurrent calls" << std::endl;
+    exit(ok && ms < 1500 && max_running.load() == 4 ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{8});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
@@ -1,4 +1,5 @@
 #include <sstream>
+#include <vector>
 #include <iostream>
 #include <iomanip>
 
@@ -18,18 +19,35 @@ int main(int argc, char **argv)
 {
     std::string algo;
     b0::addOptionString("algorithm,a", "compression algorithm to test", &algo, true);
+    int min_level = -1;
+    b0::addOptionInt("min-level,l", "lowest compression level to test", &min_level, false, -1);
+    b0::addOption("dictionary,d", "test compression with a trained dictionary");
     b0::setPositionalOption("algorithm");
     b0::init(argc, argv);
 
+    std::string dict;
+    if(b0::hasOption("dictionary"))
+    {
+        std::vector<std::string> samples;
+        for(int i = 0; i < 1000; i++)
+        {
+            std::stringstream ss;
+            ss << "{\"sensor\": \"imu\", \"seq\": " << i << ", \"temperature\": " << (20 + i % 7) << "." << (i % 10) << "}";
+            samples.push_back(ss.str());
+        }
+        b0::compress::addDictionary("test", b0::compress::trainDictionary(algo, samples, 4096));
+        dict = "test";
+    }
+
     size_t size[] = {100, 500, 2000, 8000, 25000, 100000, 1000000, 5000000};
     for(int j = 0; j < sizeof(size)/sizeof(size[0]); j++)
     {
-        for(int level = -1; level <= 9; level++)
+        for(int level = min_level; level <= 9; level++)
         {
             std::cout << "Testing " << algo << " level " << level << std::endl;
             std::string in = generatePayload(size[j]);
             std::cout << "    in size: " << in.size() << std::endl;
-            std::string out = b0::compress::compress(algo, in, level);
+            std::string out = b0::compress::compress(algo, in, level, dict);
             std::cout << "    out size: " << out.size() << std::endl;
             if(in == out)
             {
@@ -40,7 +58,7 @@ int main(int argc, char **argv)
             {
                 std::cerr << "warning: compression algorithm produced an output bigger than the input" << std::endl;
             }
-            std::string in2 = b0::compress::decompress(algo, out);
+            std::string in2 = b0::compress::decompress(algo, out, 0, dict);
             std::cout << "    in2 size: " << in2.size() << std::endl;
             if(in != in2)
             {
@@ -0,0 +1,75 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/message/metrics/socket_metrics.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        pub.publish(std::string("msg"));
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+std::atomic<long> received{0}, connects{0}, connect_usec{-1};
+std::atomic<bool> monitored{false};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", b0::Subscriber::CallbackRaw([&](const std::string &msg) {
+        received++;
+    }));
+    monitored = sub.getConnectionMonitor();
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        b0::message::metrics::SocketMetrics metrics;
+        sub.getMetrics(metrics);
+        connects = metrics.connects;
+        connect_usec = metrics.connect_max_usec;
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+    b0::setConnectionMonitor(true);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    // the subscriber connects to the proxy of the resolver, and its connect() is timed:
+    std::cout << "monitored: " << monitored << ", received: " << received << ", connects: " << connects << ", connect time: " << connect_usec << " us" << std::endl;
+    exit(monitored && received > 10 && connects >= 1 && connect_usec >= 0 && connect_usec < 1000000 ? 0 : 1);
+}
@@ -0,0 +1,147 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+#include <b0/coroutine.h>
+
+class Counter : public b0::message::Message
+{
+public:
+    int n;
+
+    std::string type() const override {return "Counter";}
+};
+
+namespace spotify
+{
+
+namespace json
+{
+
+template <>
+struct default_codec_t<Counter> {
+    static codec::object_t<Counter> codec() {
+        auto codec = codec::object<Counter>();
+        codec.required("n", &Counter::n);
+        return codec;
+    }
+};
+
+} // namespace json
+
+} // namespace spotify
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void callback(const Counter &req, Counter &rep)
+{
+    rep.n = req.n + 1;
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", &callback);
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    for(int i = 0; !node.shutdownRequested(); i++)
+    {
+        Counter msg;
+        msg.n = i;
+        pub.publish(msg);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{50});
+    }
+}
+
+const int num_calls = 1000;
+int completed = 0;
+bool failed = false;
+
+b0::coro::Task<Counter> chain(b0::ServiceClient &cli, Counter req)
+{
+    // each coroutine is resumed by spinOnce() when the reply to its call arrives
+    Counter rep1 = co_await b0::coro::call<Counter>(cli, req);
+    Counter rep2 = co_await b0::coro::call<Counter>(cli, rep1);
+    co_return rep2;
+}
+
+b0::coro::Task<> request(b0::ServiceClient &cli, int i)
+{
+    Counter req;
+    req.n = i;
+    Counter rep = co_await chain(cli, req);
+    if(rep.n != i + 2) failed = true;
+    completed++;
+}
+
+b0::coro::Task<> receive(b0::coro::Subscriber<Counter> &sub, int &received)
+{
+    int last = -1;
+    for(int i = 0; i < 3; i++)
+    {
+        Counter msg = co_await sub.next();
+        if(msg.n <= last) failed = true;
+        last = msg.n;
+        received++;
+    }
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "service1");
+    b0::coro::Subscriber<Counter> sub(&node, "topic1");
+    node.init();
+
+    // all the calls are in flight at the same time, on this thread
+    for(int i = 0; i < num_calls; i++)
+        b0::coro::spawn(request(cli, i));
+    int received = 0;
+    b0::coro::spawn(receive(sub, received));
+    std::cout << "pending calls: " << cli.getPendingCalls() << std::endl;
+    if(cli.getPendingCalls() != num_calls) exit(1);
+
+    while((completed < num_calls || received < 3) && !failed)
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+    std::cout << "completed: " << completed << ", received: " << received << std::endl;
+    exit(failed ? 1 : 0);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{8});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t4(&cli_thread);
+    t0.join();
+}
@@ -0,0 +1,67 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/service_client.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+b0::Publisher *ppub = nullptr;
+
+void node_thread()
+{
+    // B0_DEBUG_SOCKET_SERVICE is set by the test, so this node offers "node1.debug_socket"
+    b0::Node node("node1");
+    b0::Publisher pub(&node, "topic1");
+    ppub = &pub;
+    node.init();
+    node.spin();
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "node1.debug_socket");
+    node.init();
+
+    std::string rep;
+    cli.call(std::string("*.topic1 on"), rep);
+    std::cout << "server response: " << rep << std::endl;
+    if(rep != "ok: 1 sockets" || !ppub->getDebugDump())
+        exit(1);
+
+    cli.call(std::string("node1.topic1 off"), rep);
+    std::cout << "server response: " << rep << std::endl;
+    if(rep != "ok: 1 sockets" || ppub->getDebugDump())
+        exit(1);
+
+    cli.call(std::string("*.topic1 bogus"), rep);
+    std::cout << "server response: " << rep << std::endl;
+    exit(rep.compare(0, 6, "error:") == 0 ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&node_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
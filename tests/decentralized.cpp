@@ -0,0 +1,62 @@
+#include <cstdlib>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {rep = req + "_";}));
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        pub.publish(std::string("hello"));
+        node.sleepUSec(100000);
+    }
+    node.cleanup();
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "service1");
+    b0::Subscriber sub(&node, "topic1");
+    node.init();
+
+    std::string rep;
+    cli.call(std::string("foo"), rep);
+    std::cout << "server response: " << rep << std::endl;
+
+    std::string msg;
+    sub.readRaw(msg);
+    std::cout << "message: " << msg << std::endl;
+
+    exit(rep == "foo_" && msg == "hello" ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    // no resolver is running
+    setenv("B0_DECENTRALIZED", "1", 1);
+    setenv("B0_DISCOVERY_ADDRESS", "127.0.0.1", 1);
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&cli_thread);
+    t0.join();
+}
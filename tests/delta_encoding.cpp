@@ -0,0 +1,98 @@
+#include <atomic>
+#include <iostream>
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/compress/delta.h>
+
+bool roundTrip(const std::string &method, const std::string &base, const std::string &data)
+{
+    std::string delta, decoded;
+    if(!b0::compress::encodeDelta(method, base, data.data(), data.size(), delta)) return false;
+    return b0::compress::decodeDelta(method, base, delta.data(), delta.size(), decoded) && decoded == data;
+}
+
+std::string grid(int n)
+{
+    // a mostly constant payload, with a counter at the start
+    std::string payload(1000, '.');
+    std::string counter = (boost::format("%08d") % n).str();
+    payload.replace(0, counter.size(), counter);
+    return payload;
+}
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+std::atomic<long> sent_msgs{0}, sent_bytes{0};
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "grid");
+    pub.setDeltaEncoding("ranges", 50);
+    node.init();
+    for(int n = 0; !node.shutdownRequested(); n++)
+    {
+        pub.publish(grid(n));
+        node.spinOnce();
+        sent_msgs = pub.getCounters().messages_sent.load();
+        sent_bytes = pub.getCounters().bytes_sent.load();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+    }
+}
+
+std::atomic<long> received{0}, corrupt{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "grid", b0::Subscriber::CallbackRaw([&](const std::string &msg) {
+        if(msg.size() == 1000 && msg == grid(std::stoi(msg.substr(0, 8))))
+            received++;
+        else
+            corrupt++;
+    }));
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    std::string a = grid(1), b = grid(2);
+    bool codec_ok = roundTrip("xor", a, b) && roundTrip("ranges", a, b) && roundTrip("ranges", a, b + "grown")
+        && roundTrip("ranges", a, b.substr(0, 10)) && roundTrip("ranges", "", b) && !roundTrip("xor", a, b + "grown");
+    std::string delta, decoded;
+    b0::compress::encodeDelta("ranges", a, b.data(), b.size(), delta);
+    codec_ok = codec_ok && delta.size() < 10 && !b0::compress::decodeDelta("ranges", a, delta.data(), delta.size() - 1, decoded);
+    std::cout << "codec: " << (codec_ok ? "ok" : "failed") << std::endl;
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    // joins late: its first messages are deltas of messages it never got, until it gets a keyframe
+    boost::thread t3(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    long avg_bytes = sent_msgs ? sent_bytes / sent_msgs : 0;
+    std::cout << "received: " << received << ", corrupt: " << corrupt << ", average message size: " << avg_bytes << " bytes" << std::endl;
+    exit(codec_ok && received > 50 && corrupt == 0 && avg_bytes > 0 && avg_bytes < 500 ? 0 : 1);
+}
@@ -0,0 +1,140 @@
+#include <cstdlib>
+#include <iostream>
+#include <atomic>
+#include <boost/thread.hpp>
+#include <boost/filesystem.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/utils/buffer_pool.h>
+
+std::atomic<int> heartbeats{0};
+
+// counts the heartbeats of node "a"
+class Resolver : public b0::resolver::Resolver
+{
+public:
+    Resolver()
+    {
+        setMinimumHeartbeatInterval(1000000);
+    }
+
+    void handleHeartbeat(const b0::message::resolv::HeartbeatRequest &rq, b0::message::resolv::HeartbeatResponse &rsp) override
+    {
+        if(rq.node_name == "a") heartbeats++;
+        b0::resolver::Resolver::handleHeartbeat(rq, rsp);
+    }
+
+    void onHeartbeatMessage(const b0::message::resolv::HeartbeatRequest &rq) override
+    {
+        if(rq.node_name == "a") heartbeats++;
+        b0::resolver::Resolver::onHeartbeatMessage(rq);
+    }
+};
+
+void resolver_thread()
+{
+    Resolver node;
+    node.init();
+    node.spin();
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{20});
+    exit(1);
+}
+
+int threadCount()
+{
+    int count = 0;
+#ifdef __linux__
+    for(boost::filesystem::directory_iterator it("/proc/self/task"), end; it != end; ++it)
+        count++;
+#endif
+    return count;
+}
+
+void spinFor(b0::Node &node, int msec)
+{
+    for(int i = 0; i < msec / 10; i++)
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+bool alive(b0::Node &node, const std::string &name)
+{
+    b0::message::graph::Graph graph;
+    node.getGraph(graph);
+    for(auto &n : graph.nodes)
+        if(n.node_name == name) return true;
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    bool ok = true;
+
+    // the fixed pool: 2 buffers of 4096 bytes, for the buffers of 256 bytes or more
+    {
+        b0::FixedBufferPool pool(4096, 2);
+        void *small = pool.allocate(100);
+        void *p1 = pool.allocate(1000);
+        void *p2 = pool.allocate(4096);
+        void *p3 = pool.allocate(1000);
+        void *big = pool.allocate(5000);
+        ok = check("small buffers left to ZeroMQ", !small) && ok;
+        ok = check("buffers served", p1 && p2 && p1 != p2) && ok;
+        ok = check("no more buffers", !p3 && !big && pool.getStats().misses == 2) && ok;
+        pool.deallocate(p1, 1000);
+        void *p4 = pool.allocate(2000);
+        ok = check("buffer reused", p4 == p1) && ok;
+        pool.deallocate(p2, 4096);
+        pool.deallocate(p4, 2000);
+        b0::FixedBufferPool::Stats stats = pool.getStats();
+        ok = check("pool stats", stats.allocations == 3 && stats.buffers_in_use == 0 && stats.peak_buffers_in_use == 2) && ok;
+    }
+
+    b0::setEmbeddedProfile(true);
+    ok = check("inline heartbeats", b0::getInlineHeartbeats()) && ok;
+    ok = check("no async logging", !b0::getAsyncLogging() && !b0::getProcessAgent()) && ok;
+    ok = check("fixed buffer pool", bool(std::dynamic_pointer_cast<b0::FixedBufferPool>(b0::getBufferAllocator()))) && ok;
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    int threads_before = threadCount();
+    b0::Node a("a");
+    ok = check("node inline heartbeat", a.getInlineHeartbeat()) && ok;
+    a.init();
+    // (the I/O thread and the reaper thread of the ZeroMQ context of the node)
+    int threads = threadCount() - threads_before;
+    std::cout << "threads started by init(): " << threads << std::endl;
+#ifdef __linux__
+    ok = check("no heartbeat thread", threads <= 2) && ok;
+#endif
+
+    // several heartbeat intervals: the node is kept alive by spinOnce()
+    spinFor(a, 3000);
+    int sent = heartbeats.load();
+    std::cout << "heartbeats: " << sent << std::endl;
+    ok = check("heartbeats sent by spinOnce()", sent >= 5) && ok;
+    ok = check("node alive", alive(a, "a")) && ok;
+
+    // without spinning, no heartbeat is sent
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{1500});
+    ok = check("no heartbeats without spinning", heartbeats.load() == sent) && ok;
+
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,346 @@
+#include <iostream>
+#include <vector>
+
+#include <b0/b0.h>
+#include <b0/message/message_envelope.h>
+#include <b0/message/content_type_ids.h>
+#include <b0/exception/message_unpack_error.h>
+#include <b0/exception/unsupported_compression_algorithm.h>
+#include <b0/compress/compress.h>
+#include <b0/utils/crc32c.h>
+
+void check(bool cond, const std::string &what)
+{
+    if(!cond)
+    {
+        std::cerr << "Test failed: " << what << std::endl;
+        exit(1);
+    }
+}
+
+void test(const b0::message::MessageEnvelope &env, b0::message::EnvelopeFormat format, const std::string &name)
+{
+    std::string serialized;
+    serialize(env, serialized, format);
+    std::cout << name << ": serialized size: " << serialized.size() << std::endl;
+    check(serialized.compare(0, env.header0.size() + 1, env.header0 + "\n") == 0, name + ": header0 prefix");
+
+    b0::message::EnvelopeSerializer serializer;
+    std::vector<char> buffer(serializer.prepare(env, format));
+    serializer.write(buffer.data());
+    check(std::string(buffer.begin(), buffer.end()) == serialized, name + ": EnvelopeSerializer output");
+
+    b0::message::MessageEnvelope env2;
+    parse(env2, serialized);
+    check(env2.header0 == env.header0, name + ": header0");
+    check(env2.parts.size() == env.parts.size(), name + ": part count");
+    for(size_t i = 0; i < env.parts.size(); i++)
+    {
+        check(env2.parts[i].content_type == env.parts[i].content_type, name + ": content type");
+        check(env2.parts[i].compression_algorithm == env.parts[i].compression_algorithm, name + ": compression algorithm");
+        check(env2.parts[i].payload == env.parts[i].payload, name + ": payload");
+    }
+    check(env2.headers == env.headers, name + ": headers");
+
+    b0::message::MessageEnvelopeView view;
+    parse(view, serialized.data(), serialized.size());
+    check(view.parts.size() == env.parts.size(), name + ": view part count");
+    for(auto &pair : env.headers)
+    {
+        boost::optional<boost::string_ref> value = view.findHeader(pair.first);
+        check(value && *value == boost::string_ref(pair.second), name + ": view header lookup");
+    }
+    check(!view.findHeader("Content-length"), name + ": view header lookup of a consumed header");
+    check(view.getHeaders() == env.headers, name + ": view headers");
+
+    // the headers and the payloads in separate buffers, as sent with multipart framing:
+    std::string headers(buffer.begin(), buffer.begin() + serializer.getHeaderSize());
+    std::vector<std::string> payloads;
+    for(auto &payload : serializer.getPayloads())
+        payloads.emplace_back(payload.data(), payload.size());
+    std::vector<boost::string_ref> refs(payloads.begin(), payloads.end());
+    b0::compress::Context context;
+    b0::message::MessageEnvelopeView split;
+    parse(split, headers.data(), headers.size(), refs, context);
+    check(split.header0 == env.header0 && split.parts.size() == env.parts.size(), name + ": split part count");
+    for(size_t i = 0; i < env.parts.size(); i++)
+    {
+        check(split.parts[i].str() == env.parts[i].payload, name + ": split payload");
+        if(env.parts[i].compression_algorithm.empty())
+            check(split.parts[i].data == payloads[i].data(), name + ": split payload referenced in place");
+    }
+    check(split.getHeaders() == env.headers, name + ": split headers");
+    std::string joined = headers;
+    for(auto &payload : payloads) joined += payload;
+    check(joined == serialized, name + ": split frames joined");
+    refs.pop_back();
+    bool failed = false;
+    try
+    {
+        parse(split, headers.data(), headers.size(), refs, context);
+    }
+    catch(b0::exception::EnvelopeDecodeError &ex)
+    {
+        failed = true;
+    }
+    check(failed, name + ": split with a missing payload");
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    b0::message::MessageEnvelope env;
+    env.header0 = "topic1";
+    env.parts.resize(3);
+    env.parts[0].content_type = "b0.message.log.LogEntry";
+    env.parts[0].payload = std::string("\x00\n\n\x01 foo", 8);
+    env.parts[1].content_type = "CustomType";
+    env.parts[1].payload = std::string(1000, 'x');
+#ifdef ZLIB_FOUND
+    env.parts[1].compression_algorithm = "zlib";
+    env.parts[1].compression_level = 9;
+#endif
+    env.headers["Custom-header"] = "value";
+
+    test(env, b0::message::EnvelopeFormat::Text, "text");
+    test(env, b0::message::EnvelopeFormat::Binary, "binary");
+
+#ifdef ZLIB_FOUND
+    // large multipart message (compressed in parallel, if B0_COMPRESSION_THREADS is set):
+    b0::message::MessageEnvelope env_large;
+    env_large.header0 = "stereo";
+    env_large.parts.resize(3);
+    for(size_t i = 0; i < env_large.parts.size(); i++)
+    {
+        std::string &payload = env_large.parts[i].payload;
+        for(size_t j = 0; j < 200000; j++)
+            payload.push_back(static_cast<char>((j * (i + 3)) % 251));
+        env_large.parts[i].content_type = "Image";
+        env_large.parts[i].compression_algorithm = "zlib";
+    }
+    test(env_large, b0::message::EnvelopeFormat::Text, "large text");
+    test(env_large, b0::message::EnvelopeFormat::Binary, "large binary");
+#endif
+
+#ifdef ZLIB_FOUND
+    // contexts and scratch buffers reused across messages of different sizes and levels:
+    b0::compress::Context cctx, dctx;
+    for(int k = 0; k < 6; k++)
+    {
+        b0::message::MessageEnvelope env_k;
+        env_k.header0 = "topic2";
+        env_k.parts.resize(1 + k % 2);
+        for(auto &part : env_k.parts)
+        {
+            part.payload = std::string(100 + 5000 * (k % 3), 'a' + k);
+            part.compression_algorithm = "zlib";
+            part.compression_level = 1 + k;
+        }
+        std::string serialized;
+        std::vector<size_t> content_lengths;
+        serialize(env_k, serialized, b0::message::EnvelopeFormat::Binary, content_lengths, cctx);
+        b0::message::MessageEnvelope env_k2;
+        parse(env_k2, serialized.data(), serialized.size(), dctx);
+        check(env_k2.parts.size() == env_k.parts.size(), "context reuse: part count");
+        for(size_t i = 0; i < env_k.parts.size(); i++)
+            check(env_k2.parts[i].payload == env_k.parts[i].payload, "context reuse: payload");
+    }
+#endif
+
+    // payload encoded in place after the space left for the headers:
+    for(int k = 0; k < 2; k++)
+    {
+        b0::message::EnvelopeFormat format = k ? b0::message::EnvelopeFormat::Binary : b0::message::EnvelopeFormat::Text;
+        b0::message::MessageEnvelope env_f;
+        env_f.header0 = "topic4";
+        env_f.headers["Seq"] = "12";
+        env_f.parts.resize(1);
+        env_f.parts[0].content_type = "b0.message.log.LogEntry";
+        std::string payload(3000, 'p');
+        const size_t header_space = 200;
+        std::string frame(header_space, '\0');
+        frame += payload;
+        b0::message::EnvelopeSerializer serializer;
+        size_t header_size = serializer.prepareHeaders(env_f, format, boost::string_ref(frame.data() + header_space, payload.size()));
+        check(header_size <= header_space, "in place: header size");
+        serializer.writeHeaders(&frame[header_space - header_size]);
+        env_f.parts[0].payload = payload;
+        std::string serialized;
+        serialize(env_f, serialized, format);
+        check(frame.compare(header_space - header_size, std::string::npos, serialized) == 0, "in place: output");
+    }
+
+    // the same envelopes parsed over and over, with parts and fields appearing and disappearing:
+    b0::message::MessageEnvelopeView view_r;
+    b0::message::MessageEnvelope env_r;
+    for(int k = 0; k < 8; k++)
+    {
+        b0::message::MessageEnvelope env_k;
+        env_k.header0 = "topic3";
+        env_k.parts.resize(1 + (k * 5) % 3);
+        for(size_t i = 0; i < env_k.parts.size(); i++)
+        {
+            b0::message::MessagePart &part = env_k.parts[i];
+            part.payload = std::string(50 + 100 * i + k, 'a' + i);
+            if((k + i) % 2) part.content_type = "Type" + std::to_string(i);
+#ifdef ZLIB_FOUND
+            if((k + i) % 3 == 0) part.compression_algorithm = "zlib";
+#endif
+        }
+        b0::message::EnvelopeFormat format = k % 4 < 2 ? b0::message::EnvelopeFormat::Text : b0::message::EnvelopeFormat::Binary;
+        std::string serialized;
+        serialize(env_k, serialized, format);
+        parse(view_r, serialized.data(), serialized.size());
+        parse(env_r, serialized);
+        check(view_r.parts.size() == env_k.parts.size() && env_r.parts.size() == env_k.parts.size(), "reused envelope: part count");
+        for(size_t i = 0; i < env_k.parts.size(); i++)
+        {
+            check(view_r.parts[i].content_type == env_k.parts[i].content_type, "reused envelope view: content type");
+            check(view_r.parts[i].compression_algorithm == env_k.parts[i].compression_algorithm, "reused envelope view: compression algorithm");
+            check(view_r.parts[i].str() == env_k.parts[i].payload, "reused envelope view: payload");
+            check(env_r.parts[i].content_type == env_k.parts[i].content_type, "reused envelope: content type");
+            check(env_r.parts[i].payload == env_k.parts[i].payload, "reused envelope: payload");
+        }
+        check(view_r.getHeaders().empty() && env_r.headers.empty(), "reused envelope: headers");
+    }
+
+    std::string truncated;
+    serialize(env, truncated, b0::message::EnvelopeFormat::Binary);
+    truncated.resize(truncated.size() - 1);
+    try
+    {
+        b0::message::MessageEnvelope env2;
+        parse(env2, truncated);
+        check(false, "truncated binary envelope must not parse");
+    }
+    catch(b0::exception::EnvelopeDecodeError &ex) {}
+
+    // content types with an id take two bytes, the others are still sent by name:
+    b0::message::MessageEnvelope env_ids;
+    env_ids.header0 = "topic1";
+    env_ids.parts.resize(2);
+    env_ids.parts[0].content_type = "example.geometry.PoseWithCovariance";
+    env_ids.parts[0].payload = "pose";
+    env_ids.parts[1].content_type = "example.Unregistered";
+    env_ids.parts[1].payload = "other";
+    std::string by_name, by_id;
+    serialize(env_ids, by_name, b0::message::EnvelopeFormat::Binary);
+    b0::message::addContentTypeId(env_ids.parts[0].content_type, 7);
+    test(env_ids, b0::message::EnvelopeFormat::BinaryIds, "binary with ids");
+    serialize(env_ids, by_id, b0::message::EnvelopeFormat::BinaryIds);
+    check(by_id.size() + env_ids.parts[0].content_type.size() == by_name.size(), "binary with ids: size");
+
+    // an id the receiver cannot resolve:
+    b0::message::MessageEnvelope env_unknown = env_ids;
+    env_unknown.parts[0].content_type = "example.Unknown";
+    b0::message::addContentTypeId(env_unknown.parts[0].content_type, 8);
+    std::string unknown;
+    serialize(env_unknown, unknown, b0::message::EnvelopeFormat::BinaryIds);
+    unknown[unknown.find('\n') + 4] = 0x8f; // id 15 (1024 + 15 as a varint: 0x8f 0x08)
+    try
+    {
+        b0::message::MessageEnvelope env2;
+        parse(env2, unknown);
+        check(false, "binary envelope with an unknown content type id must not parse");
+    }
+    catch(b0::exception::EnvelopeDecodeError &ex) {}
+
+    // the status-returning variants report the same failures without throwing:
+    {
+        std::string error;
+        b0::message::MessageEnvelope env2;
+        check(tryParse(env2, truncated.data(), truncated.size()) == b0::message::ParseStatus::DecodeError, "tryParse: truncated");
+        b0::message::MessageEnvelope env_z;
+        env_z.header0 = "topic1";
+        env_z.parts.resize(1);
+        env_z.parts[0].payload = std::string(1000, 'z');
+        env_z.parts[0].compression_algorithm = "zlib";
+        std::string compressed;
+        serialize(env_z, compressed);
+        check(tryParse(env2, compressed.data(), compressed.size()) == b0::message::ParseStatus::Ok && env2.parts[0].payload == env_z.parts[0].payload, "tryParse: compressed");
+        std::string corrupt = compressed;
+        corrupt[corrupt.size() - 1] ^= 0x55; // the checksum of the zlib stream
+        check(tryParse(env2, corrupt.data(), corrupt.size(), nullptr, nullptr, &error) == b0::message::ParseStatus::DecompressError && !error.empty(), "tryParse: corrupt payload");
+        std::string unsupported = compressed;
+        unsupported.replace(unsupported.find(": zlib"), 6, ": bogu");
+        check(tryParse(env2, unsupported.data(), unsupported.size(), nullptr, nullptr, &error) == b0::message::ParseStatus::UnsupportedCompression && error == "bogu", "tryParse: unsupported algorithm");
+        try
+        {
+            parse(env2, unsupported);
+            check(false, "envelope with an unsupported algorithm must not parse");
+        }
+        catch(b0::exception::UnsupportedCompressionAlgorithm &ex) {}
+        std::string out;
+        check(b0::compress::tryDecompress("zlib", "garbage", 7, out, 0, "", &error) == b0::compress::DecompressStatus::Error && !error.empty(), "tryDecompress: garbage");
+        check(b0::compress::tryDecompress("bogus", "garbage", 7, out) == b0::compress::DecompressStatus::UnsupportedAlgorithm, "tryDecompress: unsupported algorithm");
+    }
+
+    // with lazy decompression, only the parts which are read are decompressed:
+    for(auto format : {b0::message::EnvelopeFormat::Text, b0::message::EnvelopeFormat::Binary})
+    {
+        b0::message::MessageEnvelope env_l;
+        env_l.header0 = "topic1";
+        env_l.parts.resize(2);
+        env_l.parts[0].compression_level = 0;
+        env_l.parts[0].payload = "metadata";
+        env_l.parts[1].payload = std::string(5000, 'i');
+        env_l.parts[1].compression_algorithm = "zlib";
+        env_l.parts[1].compression_level = 6;
+        std::string wire;
+        serialize(env_l, wire, format);
+        b0::message::MessageEnvelopeView view_l;
+        view_l.setLazyDecompression(true);
+        parse(view_l, wire.data(), wire.size());
+        check(!view_l.parts[0].isCompressed() && view_l.parts[0].str() == "metadata", "lazy decompression: uncompressed part");
+        check(view_l.parts[1].isCompressed() && view_l.parts[1].size < 5000, "lazy decompression: part left compressed");
+        check(view_l.parts[1].payload() == env_l.parts[1].payload && !view_l.parts[1].isCompressed() && view_l.parts[1].size == 5000, "lazy decompression: payload");
+        std::string corrupt = wire;
+        corrupt[corrupt.size() - 1] ^= 0x55;
+        parse(view_l, corrupt.data(), corrupt.size());
+        try
+        {
+            view_l.parts[1].payload();
+            check(false, "lazy decompression: corrupt part must throw");
+        }
+        catch(b0::exception::Exception &ex) {}
+    }
+
+    // with checksums, a payload corrupted in transit is caught before decompressing it:
+    check(b0::crc32c("123456789", 9) == 0xe3069283, "crc32c: check value");
+    check(b0::crc32c("56789", 5, b0::crc32c("1234", 4)) == 0xe3069283, "crc32c: continued");
+    for(auto format : {b0::message::EnvelopeFormat::Text, b0::message::EnvelopeFormat::Binary})
+    {
+        b0::message::MessageEnvelope env_c;
+        env_c.header0 = "topic1";
+        env_c.parts.resize(2);
+        env_c.parts[0].payload = "metadata";
+        env_c.parts[1].payload = std::string(5000, 'c');
+        env_c.parts[1].compression_algorithm = "zlib";
+        env_c.headers["custom"] = "value";
+        b0::message::EnvelopeSerializer serializer;
+        serializer.setChecksum(true);
+        std::string wire(serializer.prepare(env_c, format), '\0');
+        serializer.write(&wire[0]);
+        b0::message::MessageEnvelopeView view_c;
+        check(tryParse(view_c, wire.data(), wire.size()) == b0::message::ParseStatus::Ok, "checksum: parse");
+        check(view_c.parts[0].str() == "metadata" && view_c.parts[1].str() == env_c.parts[1].payload, "checksum: payloads");
+        check(view_c.getHeaders() == env_c.headers && !view_c.findHeader("Checksum-0"), "checksum: not a customized header");
+        std::string corrupt = wire;
+        corrupt[wire.size() - serializer.getContentLengths()[1] - 1] ^= 0x01; // the last byte of the first part
+        std::string error;
+        check(tryParse(view_c, corrupt.data(), corrupt.size(), nullptr, b0::message::HeaderFilter(), nullptr, &error) == b0::message::ParseStatus::ChecksumMismatch && error == "part 0", "checksum: corrupt part");
+        b0::message::MessageEnvelope env2;
+        try
+        {
+            parse(env2, corrupt);
+            check(false, "checksum: corrupt envelope must not parse");
+        }
+        catch(b0::exception::ChecksumMismatch &ex) {}
+        std::string plain;
+        serialize(env_c, plain, format);
+        check(plain.size() < wire.size() && plain.find("Checksum-") == std::string::npos, "checksum: off by default");
+    }
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <set>
+#include <tuple>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/service_server.h>
+#include <b0/utils/graph_tracker.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.setGraphSnapshots(false);
+    node.init();
+    node.spin();
+}
+
+void node_thread()
+{
+    // some nodes join and leave the network, and the monitor follows the changes
+    b0::Node node("a");
+    b0::Publisher pub(&node, "topic1");
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {rep = req;}));
+    node.init();
+    {
+        b0::Node node2("b");
+        b0::Subscriber sub(&node2, "topic1", b0::Subscriber::CallbackRaw([](const std::string &msg) {}));
+        node2.init();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+        node2.cleanup();
+    }
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    node.cleanup();
+}
+
+std::set<std::tuple<std::string, std::string, bool> > links(const b0::message::graph::Graph &graph)
+{
+    std::set<std::tuple<std::string, std::string, bool> > ret;
+    for(auto &l : graph.node_topic)
+        ret.insert(std::make_tuple(l.node_name, "t:" + l.other_name, l.reversed));
+    for(auto &l : graph.node_service)
+        ret.insert(std::make_tuple(l.node_name, "s:" + l.other_name, l.reversed));
+    for(auto &n : graph.nodes)
+        ret.insert(std::make_tuple(n.node_name, "", false));
+    return ret;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    b0::Node mon("mon");
+    b0::graph::GraphTracker tracker;
+    int deltas = 0, snapshots = 0;
+    b0::Subscriber sub(&mon, "graph_delta", static_cast<b0::Subscriber::CallbackMsg<b0::message::graph::GraphDelta> >([&](const b0::message::graph::GraphDelta &delta) {
+        if(tracker.apply(delta))
+        {
+            deltas++;
+            return;
+        }
+        b0::message::graph::Graph graph;
+        mon.getGraph(graph);
+        tracker.reset(graph);
+        snapshots++;
+    }));
+    mon.init();
+
+    boost::thread t2(&node_thread);
+    for(int i = 0; i < 30; i++)
+    {
+        mon.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{50});
+    }
+    t2.join();
+    for(int i = 0; i < 10; i++)
+    {
+        mon.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{50});
+    }
+
+    b0::message::graph::Graph graph;
+    mon.getGraph(graph);
+    bool ok = tracker.valid() && tracker.version() == graph.version && links(tracker.graph()) == links(graph);
+    std::cout << deltas << " deltas applied, " << snapshots << " snapshots, graph version " << graph.version << ": " << (ok ? "ok" : "failed") << std::endl;
+    exit(ok && deltas > 0 ? 0 : 1);
+}
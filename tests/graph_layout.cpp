@@ -0,0 +1,76 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include <b0/b0.h>
+#include <b0/utils/graph_layout.h>
+
+using b0::graph::GraphLayout;
+using Kind = b0::graph::LayoutVertex::Kind;
+
+void check(bool cond, const std::string &what)
+{
+    if(!cond)
+    {
+        std::cerr << "Test failed: " << what << std::endl;
+        exit(1);
+    }
+}
+
+void addNode(b0::message::graph::Graph &graph, const std::string &name, const std::string &topic, bool subscriber)
+{
+    b0::message::graph::GraphNode n;
+    n.node_name = name;
+    n.host_id = "host" + std::to_string(graph.nodes.size() % 5);
+    graph.nodes.push_back(n);
+    b0::message::graph::GraphLink l;
+    l.node_name = name;
+    l.other_name = topic;
+    l.reversed = subscriber;
+    graph.node_topic.push_back(l);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    b0::message::graph::Graph graph;
+    for(int i = 0; i < 300; i++)
+        addNode(graph, "node" + std::to_string(i), "topic" + std::to_string(i / 3), i % 2);
+
+    GraphLayout layout;
+    check(layout.update(graph), "first update");
+    check(layout.vertices().size() == 400, "vertices: " + std::to_string(layout.vertices().size()));
+    check(layout.edges().size() == 300, "edges: " + std::to_string(layout.edges().size()));
+    check(layout.changed().size() == 400, "all vertices placed");
+    check(layout.edges().count(std::make_pair(GraphLayout::vertexId(Kind::Topic, "topic0"), GraphLayout::vertexId(Kind::Node, "node1"))), "edge direction");
+    for(auto &v : layout.vertices())
+        check(std::isfinite(v.second.x) && std::isfinite(v.second.y), "position of " + v.first);
+
+    check(!layout.update(graph), "update without changes");
+    check(layout.changed().empty() && layout.removed().empty(), "nothing moved");
+
+    // a new node moves only itself and its topic:
+    auto before = layout.vertices();
+    addNode(graph, "new_node", "topic5", false);
+    check(layout.update(graph), "update with a new node");
+    check(layout.changed().size() <= 2, "changed: " + std::to_string(layout.changed().size()));
+    for(auto &v : layout.vertices())
+    {
+        if(layout.changed().count(v.first)) continue;
+        auto it = before.find(v.first);
+        check(it != before.end() && it->second.x == v.second.x && it->second.y == v.second.y, "still " + v.first);
+    }
+    const b0::graph::LayoutVertex &added = layout.vertices().at(GraphLayout::vertexId(Kind::Node, "new_node"));
+    const b0::graph::LayoutVertex &topic = layout.vertices().at(GraphLayout::vertexId(Kind::Topic, "topic5"));
+    check(std::hypot(added.x - topic.x, added.y - topic.y) < 300, "new node next to its topic");
+
+    graph.nodes.pop_back();
+    graph.node_topic.pop_back();
+    check(layout.update(graph), "update with a node removed");
+    check(layout.removed().size() == 1 && layout.removed().count(GraphLayout::vertexId(Kind::Node, "new_node")), "removed");
+    check(!layout.vertices().count(GraphLayout::vertexId(Kind::Node, "new_node")), "removed vertex");
+
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <iostream>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <vector>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/utils/graph_tracker.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.setGraphSnapshots(false);
+    node.setGraphChangeInterval(500000);
+    node.init();
+    node.spin();
+}
+
+void nodes_thread()
+{
+    // a burst of nodes starting together, some of them leaving at once
+    std::vector<std::unique_ptr<b0::Node> > nodes;
+    std::vector<std::unique_ptr<b0::Publisher> > pubs;
+    for(int i = 0; i < 10; i++)
+    {
+        nodes.emplace_back(new b0::Node("n"));
+        pubs.emplace_back(new b0::Publisher(nodes.back().get(), "topic" + std::to_string(i)));
+        nodes.back()->init();
+        if(i % 3 == 0)
+        {
+            nodes.back()->cleanup();
+            pubs.pop_back();
+            nodes.pop_back();
+        }
+    }
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+    for(auto &node : nodes)
+        node->cleanup();
+}
+
+std::set<std::tuple<std::string, std::string, bool> > links(const b0::message::graph::Graph &graph)
+{
+    std::set<std::tuple<std::string, std::string, bool> > ret;
+    for(auto &l : graph.node_topic)
+        ret.insert(std::make_tuple(l.node_name, l.other_name, l.reversed));
+    for(auto &n : graph.nodes)
+        ret.insert(std::make_tuple(n.node_name, "", false));
+    return ret;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    b0::Node mon("mon");
+    b0::graph::GraphTracker tracker;
+    int deltas = 0, snapshots = 0;
+    b0::Subscriber sub(&mon, "graph_delta", static_cast<b0::Subscriber::CallbackMsg<b0::message::graph::GraphDelta> >([&](const b0::message::graph::GraphDelta &delta) {
+        if(tracker.apply(delta))
+        {
+            deltas++;
+            return;
+        }
+        b0::message::graph::Graph graph;
+        mon.getGraph(graph);
+        tracker.reset(graph);
+        snapshots++;
+    }));
+    mon.init();
+    // let the subscription reach the proxy, and the graph change of the monitor be published
+    for(int i = 0; i < 20; i++)
+    {
+        mon.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{50});
+    }
+    int deltas0 = deltas;
+
+    boost::thread t2(&nodes_thread);
+    for(int i = 0; i < 30; i++)
+    {
+        mon.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{50});
+    }
+
+    // during the burst, the graph follows the throttled publications
+    b0::message::graph::Graph graph;
+    mon.getGraph(graph);
+    bool ok = tracker.valid() && tracker.version() == graph.version && links(tracker.graph()) == links(graph);
+    int burst = deltas - deltas0;
+    std::cout << burst << " deltas for the burst, " << snapshots << " snapshots, graph version " << graph.version << ", " << graph.nodes.size() << " nodes: " << (ok ? "ok" : "failed") << std::endl;
+    ok = ok && burst > 0 && burst <= 5;
+
+    t2.join();
+    for(int i = 0; i < 20; i++)
+    {
+        mon.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{50});
+    }
+    mon.getGraph(graph);
+    ok = ok && links(tracker.graph()) == links(graph);
+    std::cout << "after the nodes left: " << graph.nodes.size() << " nodes: " << (ok ? "ok" : "failed") << std::endl;
+    exit(ok ? 0 : 1);
+}
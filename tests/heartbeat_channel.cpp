@@ -0,0 +1,80 @@
+#include <cstdlib>
+#include <iostream>
+#include <atomic>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+
+std::atomic<int> handled{0}, messages{0};
+
+// counts the heartbeats handled, and those of them received on the heartbeat topic
+class Resolver : public b0::resolver::Resolver
+{
+public:
+    Resolver()
+    {
+        setMinimumHeartbeatInterval(1000000);
+    }
+
+    void handleHeartbeat(const b0::message::resolv::HeartbeatRequest &rq, b0::message::resolv::HeartbeatResponse &rsp) override
+    {
+        if(rq.node_name == "a") handled++;
+        b0::resolver::Resolver::handleHeartbeat(rq, rsp);
+    }
+
+    void onHeartbeatMessage(const b0::message::resolv::HeartbeatRequest &rq) override
+    {
+        if(rq.node_name == "a") messages++;
+        b0::resolver::Resolver::onHeartbeatMessage(rq);
+    }
+};
+
+void resolver_thread()
+{
+    Resolver node;
+    node.init();
+    node.spin();
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    // only the first heartbeat asks for the time
+    setenv("B0_HEARTBEAT_TIME_SYNC_INTERVAL", "1000", 1);
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    b0::Node a("a"), b("b");
+    a.init();
+    b.init();
+
+    // several heartbeat intervals: "a" is only kept alive by the heartbeat topic
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+
+    b0::message::graph::Graph graph;
+    b.getGraph(graph);
+    bool alive = false;
+    for(auto &n : graph.nodes)
+        if(n.node_name == "a") alive = true;
+
+    bool ok = check("node alive", alive);
+    ok = check("heartbeats on the topic", messages.load() >= 5) && ok;
+    ok = check("one time sync request", handled.load() - messages.load() == 1) && ok;
+
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <set>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+
+boost::mutex senders_mutex;
+std::set<std::string> senders;
+
+// records which nodes send the heartbeats
+class Resolver : public b0::resolver::Resolver
+{
+public:
+    Resolver()
+    {
+        setMinimumHeartbeatInterval(2000000);
+    }
+
+    void handleHeartbeat(const b0::message::resolv::HeartbeatRequest &rq, b0::message::resolv::HeartbeatResponse &rsp) override
+    {
+        if(rq.node_name != "resolver")
+        {
+            boost::mutex::scoped_lock lock(senders_mutex);
+            senders.insert(rq.node_name);
+        }
+        b0::resolver::Resolver::handleHeartbeat(rq, rsp);
+    }
+};
+
+void resolver_thread()
+{
+    Resolver node;
+    node.init();
+    node.spin();
+}
+
+std::set<std::string> nodes(b0::Node &node)
+{
+    b0::message::graph::Graph graph;
+    node.getGraph(graph);
+    std::set<std::string> ret;
+    for(auto &n : graph.nodes)
+        ret.insert(n.node_name);
+    return ret;
+}
+
+std::set<std::string> getSenders()
+{
+    boost::mutex::scoped_lock lock(senders_mutex);
+    return senders;
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+    b0::setHeartbeatCoalescing(true);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    b0::Node a("a"), b("b"), c("c");
+    a.init();
+    b.init();
+    c.init();
+
+    // only the first node sends the heartbeats, and none of the nodes expires
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+    std::set<std::string> n = nodes(b);
+    bool ok = check("one sender", getSenders() == std::set<std::string>{"a"});
+    ok = check("nodes alive", n.count("a") && n.count("b") && n.count("c")) && ok;
+
+    // when it leaves, another node takes over
+    a.cleanup();
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+    n = nodes(b);
+    ok = check("takeover", getSenders().size() == 2 && !n.count("a") && n.count("b") && n.count("c")) && ok;
+
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <map>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+class Resolver : public b0::resolver::Resolver
+{
+public:
+    Resolver()
+    {
+        setMinimumHeartbeatInterval(1500000);
+    }
+};
+
+void resolver_thread()
+{
+    Resolver node;
+    node.init();
+    node.spin();
+}
+
+std::map<std::string, b0::message::graph::NodeStats> stats(b0::Node &node)
+{
+    b0::message::graph::Graph graph;
+    node.getGraph(graph);
+    std::map<std::string, b0::message::graph::NodeStats> ret;
+    for(auto &n : graph.nodes)
+        if(n.stats) ret[n.node_name] = *n.stats;
+    return ret;
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+void callback(const std::string &msg)
+{
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+    b0::setHeartbeatStats(true);
+    // the stats of the other nodes are piggy-backed on the heartbeats of the first
+    b0::setHeartbeatCoalescing(true);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    b0::Node a("a"), b("b"), c("c");
+    b0::Publisher pub(&a, "stats_topic");
+    b0::Subscriber sub(&b, "stats_topic", &callback);
+    a.init();
+    b.init();
+    c.init();
+
+    // publish for a few heartbeats
+    int64_t t_end = a.hardwareTimeUSec() + 3000000;
+    while(a.hardwareTimeUSec() < t_end)
+    {
+        pub.publish(std::string("x"));
+        b.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+    }
+
+    std::map<std::string, b0::message::graph::NodeStats> s = stats(c);
+    bool ok = check("all nodes report", s.count("a") && s.count("b") && s.count("c"));
+    if(ok)
+    {
+        ok = check("publisher rate", s["a"].messages_sent_rate > 10) && ok;
+        ok = check("subscriber rate", s["b"].messages_received_rate > 10) && ok;
+        ok = check("idle node rate", s["c"].messages_sent_rate == 0 && s["c"].messages_received_rate == 0) && ok;
+        ok = check("cpu time", s["a"].cpu_time_usec > 0) && ok;
+#ifdef __linux__
+        ok = check("rss", s["a"].rss > 0) && ok;
+#endif
+    }
+
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+#include <zmq.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {rep = "re: " + req;}));
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        pub.publish(std::string("msg-data"));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{50});
+    }
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "service1");
+    bool received = false;
+    b0::Subscriber sub(&node, "topic1", b0::Subscriber::CallbackRaw([&](const std::string &msg) {received = msg == "msg-data";}));
+    node.init();
+
+    // all the nodes are on this host: the TCP addresses are replaced with IPC endpoints
+    bool ok = boost::starts_with(cli.getRemoteAddresses().at(0), "ipc://") &&
+        boost::starts_with(node.getXPUBSocketAddress(), "ipc://") &&
+        boost::starts_with(node.getXSUBSocketAddress(), "ipc://");
+    std::cout << "resolved to IPC: " << (ok ? "ok" : "failed") << std::endl;
+    if(!ok) exit(1);
+
+    std::string rep;
+    cli.call(std::string("hello"), rep);
+    ok = rep == "re: hello";
+    std::cout << "call: " << (ok ? "ok" : "failed") << std::endl;
+    if(!ok) exit(1);
+
+    while(!received)
+        node.spinOnce();
+    std::cout << "pubsub: ok" << std::endl;
+    exit(0);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{6});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+#ifdef ZMQ_HAS_CAPABILITIES
+    if(!zmq_has("ipc"))
+    {
+        std::cout << "ZeroMQ built without IPC support, skipping" << std::endl;
+        return 0;
+    }
+#endif
+    b0::setIPC(true);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
@@ -0,0 +1,127 @@
+#include <iostream>
+#include <string>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/json_decoder.h>
+#include <b0/message/resolv/response.h>
+#include <b0/message/graph/graph.h>
+#include <b0/message/metrics/socket_metrics.h>
+#include <b0/exception/message_unpack_error.h>
+
+void check(bool cond, const std::string &what)
+{
+    if(!cond)
+    {
+        std::cerr << "Test failed: " << what << std::endl;
+        exit(1);
+    }
+}
+
+// decode the JSON encoding of a message in place, and compare its JSON encoding with the original one
+template<class TMsg>
+void test(const TMsg &msg, const std::string &name)
+{
+    std::string json;
+    serialize(msg, json);
+
+    TMsg msg2;
+    b0::message::json_decoder::decode(msg2, json.data(), json.size());
+    std::string json2;
+    serialize(msg2, json2);
+    check(json2 == json, name + ": round trip");
+
+    // decoding again into the same message gives the same message:
+    b0::message::json_decoder::decode(msg2, json.data(), json.size());
+    serialize(msg2, json2);
+    check(json2 == json, name + ": round trip into a reused message");
+
+    bool thrown = false;
+    try {b0::message::json_decoder::decode(msg2, json.data(), json.size() - 1);}
+    catch(b0::exception::MessageUnpackError &ex) {thrown = true;}
+    check(thrown, name + ": truncated payload");
+
+    // parse() falls back to the codec, which agrees:
+    TMsg msg3;
+    b0::setInPlaceJSONDecoding(false);
+    parse(msg3, json);
+    b0::setInPlaceJSONDecoding(true);
+    serialize(msg3, json2);
+    check(json2 == json, name + ": codec round trip");
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    b0::message::resolv::Response rep;
+    rep.announce_node = b0::message::resolv::AnnounceNodeResponse();
+    rep.announce_node->ok = true;
+    rep.announce_node->node_name = "node \"quoted\" \\ with\tescapes \xc3\xa9";
+    rep.announce_node->xsub_sock_addr = "tcp://localhost:22000";
+    rep.announce_node->xpub_sock_addr = "tcp://localhost:22001";
+    rep.announce_node->minimum_heartbeat_interval = -1;
+    rep.announce_node->xsub_sock_addrs.push_back(rep.announce_node->xsub_sock_addr);
+    rep.announce_node->xpub_sock_addrs.push_back(rep.announce_node->xpub_sock_addr);
+    test(rep, "Response");
+
+    b0::message::graph::Graph graph;
+    for(int i = 0; i < 20; i++)
+    {
+        b0::message::graph::GraphNode node;
+        node.host_id = "host";
+        node.process_id = 100000 + i;
+        node.node_name = "node" + std::to_string(i);
+        graph.nodes.push_back(node);
+        b0::message::graph::GraphLink link;
+        link.node_name = node.node_name;
+        link.other_name = "topic";
+        link.reversed = i % 2;
+        graph.node_topic.push_back(link);
+    }
+    test(graph, "Graph");
+
+    b0::message::metrics::SocketMetrics metrics;
+    metrics.name = "pub";
+    metrics.socket_type = "Publisher";
+    metrics.messages_sent = 5000000000ull;
+    metrics.bytes_sent = 300;
+    metrics.payload_bytes_sent = 70000;
+    metrics.messages_received = 0;
+    metrics.bytes_received = 0;
+    metrics.payload_bytes_received = 0;
+    metrics.compression_algorithm = "zlib";
+    metrics.compression_adaptive = false;
+    metrics.compression_ratio = 0.4375;
+    metrics.compression_skipped = 1;
+    metrics.callback_count = 2;
+    metrics.callback_total_usec = 40000;
+    metrics.callback_max_usec = -100;
+    metrics.callback_p50_usec = -40000;
+    metrics.callback_p90_usec = -3000000000ll;
+    metrics.callback_p99_usec = 127;
+    test(metrics, "SocketMetrics");
+
+    // unknown fields are skipped, whatever their value, and \u escapes are decoded:
+    b0::message::graph::GraphNode node;
+    std::string json = R"({"unknown": {"a": [1, -2.5e3, "x\"]", {}], "b": null}, "host_id": "h\u00e9\ud83d\ude00",
+        "process_id": 42, "node_name": "n"})";
+    b0::message::json_decoder::decode(node, json.data(), json.size());
+    check(node.host_id == "h\xc3\xa9\xf0\x9f\x98\x80" && node.process_id == 42 && node.node_name == "n", "unknown fields and escapes");
+
+    // a missing required field is an error
+    bool thrown = false;
+    json = R"({"host_id": "h", "process_id": 42})";
+    try {b0::message::json_decoder::decode(node, json.data(), json.size());}
+    catch(b0::exception::MessageUnpackError &ex) {thrown = true;}
+    check(thrown, "missing required field");
+
+    // so is a fraction in an integer field
+    thrown = false;
+    json = R"({"host_id": "h", "process_id": 1e3, "node_name": "n"})";
+    try {b0::message::json_decoder::decode(node, json.data(), json.size());}
+    catch(b0::exception::MessageUnpackError &ex) {thrown = true;}
+    check(thrown, "fraction in an integer field");
+
+    return 0;
+}
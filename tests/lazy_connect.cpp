@@ -0,0 +1,86 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {rep = req + "!";}));
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        pub.publish(std::string("msg"));
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+    }
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    bool received = false;
+    b0::Subscriber sub(&node, "topic1", b0::Subscriber::CallbackRaw([&](const std::string &msg) {received = true;}));
+    sub.setLazy(true);
+    b0::ServiceClient cli(&node, "service1");
+    cli.setLazy(true);
+    // there is no server of service1 yet, so a non-lazy client would fail here:
+    node.init();
+    if(sub.isConnected() || cli.isConnected())
+    {
+        std::cout << "lazy sockets connected at init" << std::endl;
+        exit(1);
+    }
+
+    boost::thread t(&pub_thread);
+
+    std::string rep;
+    while(!received || rep.empty())
+    {
+        node.spinOnce();
+        if(sub.isConnected() && rep.empty())
+        {
+            try
+            {
+                cli.call(std::string("hello"), rep);
+            }
+            catch(b0::exception::Exception &ex)
+            {
+                std::cout << "call failed: " << ex.what() << std::endl;
+            }
+        }
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+    std::cout << "server response: " << rep << std::endl;
+    exit(rep == "hello!" && cli.isConnected() ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    t0.join();
+}
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/subscriber.h>
+#include <b0/message/log/log_entry_batch.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void node_thread()
+{
+    b0::Node node("node");
+    node.init();
+    // B0_LOG_BATCH_SIZE is set by the test: 20 entries are sent as two full batches,
+    // and the last 5 entries when the batch interval has elapsed (checked by spinOnce())
+    for(int i = 0; i < 25; i++)
+        node.info("message %d", i);
+    node.spin();
+}
+
+int received = 0;
+
+void callback(const std::string &payload, const std::string &type)
+{
+    b0::message::log::LogEntryBatch batch;
+    if(type != batch.type())
+    {
+        std::cerr << "unexpected content type: " << type << std::endl;
+        exit(1);
+    }
+    b0::message::parse(batch, payload, type);
+    for(auto &entry : batch.entries)
+        if(entry.node_name == "node" && entry.message.compare(0, 8, "message ") == 0)
+            received++;
+    if(received == 25)
+        exit(0);
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "log", &callback, true, false);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&node_thread);
+    t0.join();
+}
@@ -0,0 +1,93 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/subscriber.h>
+#include <b0/logger/logger.h>
+#include <b0/message/log/log_entry.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void fail(const std::string &what)
+{
+    std::cerr << what << std::endl;
+    exit(1);
+}
+
+void log_thread()
+{
+    b0::Node node("log_node");
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.info("info entry");
+        node.warn("warn entry");
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+std::atomic<long> warn_received{0};
+std::atomic<long> info_received{0};
+std::atomic<long> flat_received{0};
+std::atomic<bool> select_info{false};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "log", b0::Subscriber::CallbackMsg<b0::message::log::LogEntry>([&](const b0::message::log::LogEntry &entry) {
+        if(entry.node_name != "log_node") fail("entry of another node: " + entry.node_name);
+        if(entry.level == "warn") warn_received++;
+        else if(entry.level == "info" && select_info.load()) info_received++;
+        else fail("entry of an unselected level: " + entry.level);
+    }));
+    sub.setSubtopicFilters(b0::logger::logSubtopicFilters(b0::logger::Level::warn, {"log_node"}));
+    // without filters, only the entries sent to the log topic itself:
+    b0::Subscriber flat(&node, "log", b0::Subscriber::CallbackRaw([&](const std::string &msg) {
+        flat_received++;
+    }));
+    node.init();
+    bool info_selected = false;
+    while(!node.shutdownRequested())
+    {
+        if(select_info.load() && !info_selected)
+        {
+            sub.setSubtopicFilters(b0::logger::logSubtopicFilters(b0::logger::Level::info, {"log_node"}));
+            info_selected = true;
+        }
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::setHierarchicalLogTopics(true);
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&log_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+    long warn_before = warn_received;
+    select_info.store(true);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    std::cout << "warn: " << warn_received << " (" << warn_before << " before selecting info), info: " << info_received << ", flat: " << flat_received << std::endl;
+    exit(warn_before >= 50 && info_received >= 50 && flat_received == 0 ? 0 : 1);
+}
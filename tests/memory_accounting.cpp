@@ -0,0 +1,87 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/utils/metrics.h>
+#include <b0/message/metrics/node_metrics.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int received = 0;
+
+void callback(const std::string &msg)
+{
+    received++;
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+    b0::setMemoryAccounting(true);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    b0::Node node("node1");
+    b0::Publisher pub(&node, "topic1");
+    b0::Subscriber sub(&node, "topic1", &callback);
+    b0::Publisher quiet(&node, "topic2");
+    quiet.setMemoryAccounting(false);
+    // the messages wait in the queue of the subscriber until dispatched:
+    sub.setKeepLatest(100);
+    node.init();
+
+    std::string payload(1000, 'x');
+    while(received < 20)
+    {
+        pub.publish(payload);
+        pub.publish(payload);
+        quiet.publish(payload);
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+
+    bool ok = true;
+
+    const b0::SocketCounters &pc = pub.getCounters();
+    ok &= check("send allocations", pc.send_allocations.allocations >= pc.messages_sent && pc.send_allocations.bytes >= 1000 * pc.messages_sent);
+    ok &= check("no receive allocations of a publisher", pc.receive_allocations.allocations == 0);
+
+    const b0::SocketCounters &sc = sub.getCounters();
+    ok &= check("receive allocations", sc.receive_allocations.allocations >= sc.messages_received && sc.receive_allocations.bytes >= 1000 * sc.messages_received);
+    ok &= check("receive queue peak", sc.receive_queue.peak_bytes >= 1000 && sc.receive_queue.bytes == 0);
+
+    ok &= check("not accounted", quiet.getCounters().send_allocations.allocations == 0);
+
+    b0::message::metrics::NodeMetrics metrics;
+    node.getMetrics(metrics, "*.topic1");
+    bool reported = false;
+    for(auto &s : metrics.sockets)
+        if(s.socket_type == "subscriber")
+            reported = s.receive_allocations == sc.receive_allocations.allocations && s.receive_queue_peak_bytes == sc.receive_queue.peak_bytes;
+    ok &= check("metrics", reported);
+
+    node.cleanup();
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/message/metrics/node_metrics.h>
+
+void resolver_thread()
+{
+    // B0_METRICS_SERVICE is set by the test, so the resolver offers "resolver.metrics"
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void node_thread()
+{
+    b0::Node node("node1");
+    node.init();
+    node.spin();
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "resolver.metrics");
+    node.init();
+
+    std::string rep, reptype;
+    cli.call(std::string(), std::string(), rep, reptype);
+    std::cout << "server response: " << rep << std::endl;
+
+    b0::message::metrics::NodeMetrics metrics;
+    b0::message::parse(metrics, rep, reptype);
+    if(metrics.node_name != "resolver")
+        exit(1);
+
+    // the requests of the nodes are handled by the "resolv" service
+    bool found_resolv = false;
+    for(auto &s : metrics.sockets)
+        if(s.name == "resolv" && s.socket_type == "service_server" && s.callback_count > 0)
+            found_resolv = true;
+
+    bool found_node1 = false;
+    for(auto &hb : metrics.heartbeats)
+        if(hb.node_name == "node1" && hb.age_usec >= 0 && hb.age_usec < 10000000)
+            found_node1 = true;
+
+    std::cout << "resolv service: " << found_resolv << ", heartbeat of node1: " << found_node1 << std::endl;
+    exit(found_resolv && found_node1 ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&node_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/service_client.h>
+#include <b0/message/metrics/node_metrics.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void callback(const std::string &msg)
+{
+}
+
+void node_thread()
+{
+    // B0_METRICS_SERVICE is set by the test, so this node offers "node1.metrics"
+    b0::Node node("node1");
+    b0::Publisher pub(&node, "topic1");
+    b0::Subscriber sub(&node, "topic1", &callback);
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        pub.publish(std::string(1000, 'x'));
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "node1.metrics");
+    node.init();
+
+    std::string rep, reptype;
+    cli.call(std::string("*.topic1"), std::string(), rep, reptype);
+    std::cout << "server response: " << rep << std::endl;
+
+    b0::message::metrics::NodeMetrics metrics;
+    b0::message::parse(metrics, rep, reptype);
+    if(metrics.node_name != "node1" || metrics.sockets.size() != 2)
+        exit(1);
+
+    for(auto &s : metrics.sockets)
+    {
+        if(s.socket_type == "publisher" && (s.messages_sent == 0 || s.payload_bytes_sent < 1000 * s.messages_sent))
+            exit(1);
+        if(s.socket_type == "subscriber" && (s.messages_received == 0 || s.callback_count != s.messages_received))
+            exit(1);
+    }
+    exit(0);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&node_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
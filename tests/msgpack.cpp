@@ -0,0 +1,139 @@
+#include <iostream>
+#include <string>
+
+#include <b0/b0.h>
+#include <b0/message/message.h>
+#include <b0/message/resolv/request.h>
+#include <b0/message/resolv/response.h>
+#include <b0/message/graph/graph.h>
+#include <b0/message/metrics/socket_metrics.h>
+#include <b0/exception/message_unpack_error.h>
+
+void check(bool cond, const std::string &what)
+{
+    if(!cond)
+    {
+        std::cerr << "Test failed: " << what << std::endl;
+        exit(1);
+    }
+}
+
+// round trip a message through msgpack, and compare its JSON encoding with the original one
+template<class TMsg>
+void test(const TMsg &msg, const std::string &name)
+{
+    std::string payload, type;
+    serialize(msg, payload, type, b0::message::MessageCodec::MsgPack);
+    check(type == msg.type() + "+msgpack", name + ": content type");
+
+    std::string json, json_type;
+    serialize(msg, json, json_type);
+    std::cout << name << ": msgpack size: " << payload.size() << ", json size: " << json.size() << std::endl;
+
+    TMsg msg2;
+    parse(msg2, payload, type);
+    std::string json2;
+    serialize(msg2, json2);
+    check(json2 == json, name + ": round trip");
+
+    TMsg msg3;
+    parse(msg3, payload);
+    serialize(msg3, json2);
+    check(json2 == json, name + ": round trip with detected codec");
+
+    parse(msg3, json);
+    serialize(msg3, json2);
+    check(json2 == json, name + ": json with detected codec");
+
+    bool thrown = false;
+    try {parse(msg3, payload.substr(0, payload.size() - 1), type);}
+    catch(b0::exception::MessageUnpackError &ex) {thrown = true;}
+    check(thrown, name + ": truncated payload");
+
+    thrown = false;
+    try {parse(msg3, payload, json_type);}
+    catch(b0::exception::MessageUnpackError &ex) {thrown = true;}
+    check(thrown, name + ": msgpack payload with json content type");
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    b0::message::resolv::Request req;
+    req.announce_node = b0::message::resolv::AnnounceNodeRequest();
+    req.announce_node->host_id = "host";
+    req.announce_node->process_id = 1234;
+    req.announce_node->node_name = "node with a name longer than thirty-two bytes";
+    test(req, "Request");
+
+    b0::message::resolv::Response rep;
+    rep.announce_node = b0::message::resolv::AnnounceNodeResponse();
+    rep.announce_node->ok = true;
+    rep.announce_node->node_name = "node";
+    rep.announce_node->xsub_sock_addr = "tcp://localhost:22000";
+    rep.announce_node->xpub_sock_addr = "tcp://localhost:22001";
+    rep.announce_node->minimum_heartbeat_interval = -1;
+    rep.announce_node->xsub_sock_addrs.push_back(rep.announce_node->xsub_sock_addr);
+    rep.announce_node->xpub_sock_addrs.push_back(rep.announce_node->xpub_sock_addr);
+    test(rep, "Response");
+
+    b0::message::graph::Graph graph;
+    for(int i = 0; i < 20; i++)
+    {
+        b0::message::graph::GraphNode node;
+        node.host_id = "host";
+        node.process_id = 100000 + i;
+        node.node_name = "node" + std::to_string(i);
+        graph.nodes.push_back(node);
+        b0::message::graph::GraphLink link;
+        link.node_name = node.node_name;
+        link.other_name = "topic";
+        link.reversed = i % 2;
+        graph.node_topic.push_back(link);
+    }
+    test(graph, "Graph");
+
+    b0::message::metrics::SocketMetrics metrics;
+    metrics.name = "pub";
+    metrics.socket_type = "Publisher";
+    metrics.messages_sent = 5000000000ull;
+    metrics.bytes_sent = 300;
+    metrics.payload_bytes_sent = 70000;
+    metrics.messages_received = 0;
+    metrics.bytes_received = 0;
+    metrics.payload_bytes_received = 0;
+    metrics.compression_algorithm = "zlib";
+    metrics.compression_adaptive = false;
+    metrics.compression_ratio = 0.4375;
+    metrics.compression_skipped = 1;
+    metrics.callback_count = 2;
+    metrics.callback_total_usec = 40000;
+    metrics.callback_max_usec = -100;
+    metrics.callback_p50_usec = -40000;
+    metrics.callback_p90_usec = -3000000000ll;
+    metrics.callback_p99_usec = 127;
+    test(metrics, "SocketMetrics");
+
+    // the content type is known at compile time
+    static_assert(b0::message::MessageType<b0::message::resolv::Request>::length() == 25, "static type length");
+    static_assert(b0::message::MessageType<b0::message::resolv::Request>::hash() == b0::message::typeHash("b0.message.resolv.Request"), "static type hash");
+    check(b0::message::typeHash(boost::string_ref(req.type())) == b0::message::MessageType<b0::message::resolv::Request>::hash(), "runtime type hash");
+    {
+        bool thrown = false;
+        std::string payload, type;
+        serialize(rep, payload, type);
+        try {parse(req, payload, type);}
+        catch(b0::exception::MessageUnpackError &ex) {thrown = true;}
+        check(thrown, "wrong content type");
+    }
+
+    // a missing required field is an error
+    b0::message::graph::GraphNode node;
+    bool thrown = false;
+    try {parse(node, std::string("\x81\xa4" "host" "\x01", 7));}
+    catch(b0::exception::MessageUnpackError &ex) {thrown = true;}
+    check(thrown, "missing required field");
+
+    return 0;
+}
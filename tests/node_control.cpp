@@ -0,0 +1,91 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/service_client.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+b0::Node *pnode = nullptr;
+b0::Publisher *ppub = nullptr;
+b0::Subscriber *psub = nullptr;
+
+void node_thread()
+{
+    // B0_CONTROL_SERVICE is set by the test, so this node offers "node1.control"
+    b0::Node node("node1");
+    b0::Publisher pub(&node, "topic1");
+    b0::Subscriber sub(&node, "topic2", b0::Subscriber::CallbackRaw([](const std::string &msg) {}));
+    pnode = &node;
+    ppub = &pub;
+    psub = &sub;
+    node.init();
+    node.spin();
+}
+
+void check(b0::ServiceClient &cli, const std::string &req, const std::string &expected)
+{
+    std::string rep;
+    cli.call(req, rep);
+    std::cout << req << " -> " << rep << std::endl;
+    if(rep.compare(0, expected.size(), expected) != 0)
+        exit(1);
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::ServiceClient cli(&node, "node1.control");
+    node.init();
+
+    check(cli, "spin-rate 50", "ok");
+    if(pnode->getSpinRate() != 50)
+        exit(1);
+
+    check(cli, "write-hwm node1.topic1 42", "ok: 1 sockets");
+    if(ppub->getWriteHWM() != 42)
+        exit(1);
+
+    check(cli, "conflate *.topic2 on", "ok: 1 subscribers");
+    if(!psub->getConflate())
+        exit(1);
+
+    check(cli, "compression node1.topic1 zlib 5", "ok: 1 sockets");
+
+    check(cli, "metrics *.topic1", "ok\n");
+    check(cli, "console-loglevel warn", "ok");
+    check(cli, "remote-loglevel warn", "ok");
+    if(pnode->isLevelEnabled(b0::logger::Level::info) || !pnode->isLevelEnabled(b0::logger::Level::warn))
+        exit(1);
+
+    check(cli, "console-loglevel bogus", "error:");
+    check(cli, "spin-rate", "error:");
+    exit(0);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&node_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
@@ -0,0 +1,96 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/resolver/client.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+#include <b0/message/graph/graph.h>
+
+std::atomic<bool> done{false};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void server_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([&](const std::string &req, std::string &rep) {
+        rep = "re:" + req;
+    }));
+    node.init();
+    while(!node.shutdownRequested() && !done)
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+    node.cleanup();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&server_thread);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+
+    bool ok = true;
+    {
+        b0::Node node("tool");
+        b0::ServiceClient cli(&node, "service1");
+        b0::resolver::Client resolv_cli(&node);
+        node.setEphemeral(true);
+        node.init();
+        resolv_cli.init();
+
+        std::string rep, rep_type;
+        cli.call(std::string("hello"), "", rep, rep_type);
+        std::cout << "reply: " << rep << std::endl;
+        ok &= rep == "re:hello";
+
+        // the ephemeral node did not join the graph:
+        b0::message::graph::Graph graph;
+        resolv_cli.getGraph(graph);
+        for(auto &n : graph.nodes)
+        {
+            std::cout << "node in graph: " << n.node_name << std::endl;
+            ok &= n.node_name != "tool";
+        }
+        for(auto &l : graph.node_service)
+            ok &= l.node_name != "tool";
+
+        // and it cannot offer services:
+        bool refused = false;
+        try
+        {
+            node.announceService("service2", "tcp://localhost:1", "");
+        }
+        catch(b0::exception::Exception &)
+        {
+            refused = true;
+        }
+        std::cout << "announce refused: " << refused << std::endl;
+        ok &= refused;
+
+        resolv_cli.cleanup();
+        node.cleanup();
+    }
+
+    done = true;
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,136 @@
+#include <cstdlib>
+#include <iostream>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/process_agent.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+const int num_nodes = 4;
+
+std::atomic<int> coalesced{0}, single{0};
+
+// counts the heartbeats, and those of them sent on behalf of all the nodes
+class Resolver : public b0::resolver::Resolver
+{
+public:
+    Resolver()
+    {
+        setMinimumHeartbeatInterval(1000000);
+    }
+
+    void count(const b0::message::resolv::HeartbeatRequest &rq)
+    {
+        if(rq.node_name == "resolver") return;
+        if(rq.other_node_names.size() == num_nodes - 1) coalesced++;
+        else single++;
+    }
+
+    void handleHeartbeat(const b0::message::resolv::HeartbeatRequest &rq, b0::message::resolv::HeartbeatResponse &rsp) override
+    {
+        count(rq);
+        b0::resolver::Resolver::handleHeartbeat(rq, rsp);
+    }
+
+    void onHeartbeatMessage(const b0::message::resolv::HeartbeatRequest &rq) override
+    {
+        count(rq);
+        b0::resolver::Resolver::onHeartbeatMessage(rq);
+    }
+};
+
+void resolver_thread()
+{
+    Resolver node;
+    node.init();
+    node.spin();
+}
+
+std::atomic<bool> server_ready{false}, done{false};
+
+void server_thread()
+{
+    b0::Node node("node0");
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([&](const std::string &req, std::string &rep) {
+        rep = "re:" + req;
+    }));
+    node.init();
+    server_ready = true;
+    while(!done)
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+    node.cleanup();
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+    b0::setProcessAgent(true);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    boost::thread t2(&server_thread);
+    while(!server_ready)
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+
+    std::vector<std::unique_ptr<b0::Node> > nodes;
+    for(int i = 1; i < num_nodes; i++)
+        nodes.emplace_back(new b0::Node("node" + std::to_string(i)));
+    b0::ServiceClient cli(nodes[0].get(), "service1");
+    for(auto &node : nodes)
+        node->init();
+
+    bool ok = check("one agent", b0::ProcessAgent::getInstanceCount() == 1);
+
+    // the resolver requests go through the agent:
+    std::string rep, rep_type;
+    cli.call(std::string("hello"), "", rep, rep_type);
+    ok = check("service call", rep == "re:hello") && ok;
+    coalesced = 0;
+    single = 0;
+
+    // several heartbeat intervals: the nodes are kept alive by the heartbeats of the agent
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+
+    b0::message::graph::Graph graph;
+    nodes[1]->getGraph(graph);
+    int alive = 0;
+    bool agent_in_graph = false;
+    for(auto &n : graph.nodes)
+    {
+        if(n.node_name.compare(0, 4, "node") == 0) alive++;
+        if(n.node_name == "b0_agent") agent_in_graph = true;
+    }
+    ok = check("nodes alive", alive == num_nodes) && ok;
+    ok = check("agent not in graph", !agent_in_graph) && ok;
+    std::cout << "heartbeats: " << coalesced << " coalesced, " << single << " others" << std::endl;
+    ok = check("coalesced heartbeats", coalesced.load() >= 3 && single.load() <= 1) && ok;
+
+    for(auto &node : nodes)
+        node->cleanup();
+    done = true;
+    t2.join();
+
+    exit(ok ? 0 : 1);
+}
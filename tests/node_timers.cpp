@@ -0,0 +1,64 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+bool run(b0::SpinMode mode, const std::string &mode_name)
+{
+    b0::Node node("timers");
+    node.setSpinMode(mode);
+    node.init();
+
+    int fast = 0, slow = 0, once = 0, cancelled = 0;
+    node.createTimer(50000, [&] {fast++;});
+    node.createTimer(130000, [&] {slow++;});
+    node.createTimer(200000, [&] {once++;}, true);
+    int id = node.createTimer(300000, [&] {cancelled++;});
+    node.createTimer(100000, [&] {node.cancelTimer(id);}, true);
+    node.createTimer(1000000, [&] {node.shutdown();}, true);
+
+    // a spin rate far below the timers' rates
+    node.spin({}, 2.0);
+    node.cleanup();
+
+    std::cout << mode_name << ": fast=" << fast << " slow=" << slow << " once=" << once << " cancelled=" << cancelled << std::endl;
+    bool ok = check(mode_name + " fast timer", fast >= 17 && fast <= 21);
+    ok = check(mode_name + " slow timer", slow >= 6 && slow <= 8) && ok;
+    ok = check(mode_name + " one-shot timer", once == 1) && ok;
+    ok = check(mode_name + " cancelled timer", cancelled == 0) && ok;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    bool ok = run(b0::SpinMode::FixedRate, "fixed rate");
+    ok = run(b0::SpinMode::EventDriven, "event driven") && ok;
+
+    exit(ok ? 0 : 1);
+}
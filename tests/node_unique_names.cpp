@@ -0,0 +1,57 @@
+#include <iostream>
+#include <memory>
+#include <set>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+std::unique_ptr<b0::Node> start(const std::string &name)
+{
+    std::unique_ptr<b0::Node> node(new b0::Node(name));
+    node->init();
+    return node;
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    // a name with a suffix taken explicitly is skipped
+    auto x = start("w-1");
+    auto a = start("w"), b = start("w"), c = start("w");
+    bool ok = check("suffixes", a->getName() == "w" && b->getName() == "w-2" && c->getName() == "w-3");
+
+    // the suffix of a node which has left is given again
+    b->cleanup();
+    auto d = start("w");
+    auto e = start("w");
+    ok = check("reuse", d->getName() == "w-2" && e->getName() == "w-4") && ok;
+
+    for(auto n : {x.get(), a.get(), c.get(), d.get(), e.get()})
+        n->cleanup();
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.setParameter("robot.speed", "1.5");
+    node.setParameter("camera.fps", "30");
+    node.init();
+    node.spin();
+}
+
+void setter_thread()
+{
+    b0::Node node("setter");
+    node.init();
+    // let the cache of the other node subscribe to the changes
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    node.setParameter("robot.mode", "auto");
+    node.setParameter("camera.fps", "60");
+    node.removeParameter("robot.speed");
+    node.cleanup();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{6});
+    exit(1);
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    b0::Node node("cache");
+    node.addParameterPrefix("robot.");
+    int changes = 0;
+    node.setParameterCallback([&](const std::string &name, const std::string *value) {
+        std::cout << "changed: " << name << " = " << (value ? *value : "(removed)") << std::endl;
+        changes++;
+    });
+    node.init();
+
+    // fetched in bulk by init():
+    bool ok = check("fetched", node.getParameter<double>("robot.speed", 0) == 1.5);
+    std::string value;
+    ok = check("other prefix not cached", !node.getParameter("camera.fps", value)) && ok;
+
+    boost::thread t2(&setter_thread);
+    while(changes < 2)
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+
+    ok = check("pushed change", node.getParameter<std::string>("robot.mode", "") == "auto") && ok;
+    ok = check("pushed removal", !node.getParameter("robot.speed", value)) && ok;
+    ok = check("other prefix still not cached", !node.getParameter("camera.fps", value)) && ok;
+
+    node.setParameter("robot.mode", "manual");
+    ok = check("own change", node.getParameter<std::string>("robot.mode", "") == "manual") && ok;
+
+    t2.join();
+    node.cleanup();
+    exit(ok ? 0 : 1);
+}
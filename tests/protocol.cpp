@@ -1,8 +1,10 @@
 #include <iostream>
 
 #include <b0/message/resolv/announce_node_request.h>
+#include <b0/message/resolv/announce_sockets_request.h>
 #include <b0/message/log/log_entry.h>
 #include <b0/message/graph/graph.h>
+#include <b0/message/graph/graph_delta.h>
 #include <b0/message/graph/graph_link.h>
 
 bool verbose = true;
@@ -75,6 +77,35 @@ int main(int argc, char **argv)
         test(g1);
     }
 
+    {
+        b0::message::graph::GraphDelta msg;
+        msg.version = 42;
+        b0::message::graph::GraphLink l1;
+        l1.node_name = "a";
+        l1.other_name = "t";
+        l1.reversed = false;
+        msg.node_topic_added.push_back(l1);
+        msg.nodes_removed.push_back("b");
+        test(msg);
+    }
+
+    {
+        b0::message::resolv::AnnounceSocketsRequest msg;
+        msg.node_name = "a";
+        b0::message::resolv::AnnounceServiceRequest s1;
+        s1.node_name = "a";
+        s1.service_name = "s";
+        s1.sock_addr = "tcp://a:1234";
+        msg.services.push_back(s1);
+        b0::message::graph::NodeTopicRequest t1;
+        t1.node_name = "a";
+        t1.topic_name = "t";
+        t1.reverse = true;
+        t1.active = true;
+        msg.node_topics.push_back(t1);
+        test(msg);
+    }
+
     return 0;
 }
 
@@ -0,0 +1,85 @@
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/message/sim/clock.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setCompression("zlib");
+    pub.setAsync(16, b0::Publisher::AsyncOverflow::Block);
+    b0::Publisher pub_typed(&node, "topic2");
+    pub_typed.setAsync(16);
+    node.init();
+    long seq = 0;
+    while(!node.shutdownRequested())
+    {
+        // compressed by the thread of the publisher:
+        pub.publish(std::to_string(seq) + std::string(100000, 'x'));
+        b0::message::sim::Clock clock;
+        clock.time_usec = seq;
+        pub_typed.publish(clock);
+        seq++;
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+    }
+}
+
+std::atomic<long> received{0}, received_typed{0}, out_of_order{0}, bad_payload{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    long last = -1, last_typed = -1;
+    b0::Subscriber sub(&node, "topic1", b0::Subscriber::CallbackRaw([&](const std::string &msg) {
+        long seq = std::stol(msg);
+        if(seq <= last) out_of_order++;
+        last = seq;
+        if(msg.size() != std::to_string(seq).size() + 100000) bad_payload++;
+        received++;
+    }));
+    b0::Subscriber sub_typed(&node, "topic2", b0::Subscriber::CallbackMsg<b0::message::sim::Clock>([&](const b0::message::sim::Clock &clock) {
+        if(clock.time_usec <= last_typed) out_of_order++;
+        last_typed = clock.time_usec;
+        received_typed++;
+    }));
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    // the raw and the typed messages are serialized by the threads of the publishers, in order:
+    std::cout << "received: " << received << ", typed: " << received_typed << ", out of order: " << out_of_order << ", bad payloads: " << bad_payload << std::endl;
+    exit(received > 20 && received_typed > 20 && out_of_order == 0 && bad_payload == 0 ? 0 : 1);
+}
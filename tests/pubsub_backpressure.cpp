@@ -0,0 +1,63 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{20});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+    // the queues are per subscriber only when connected directly
+    b0::setPeerToPeer(true);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    // a subscriber which never reads
+    b0::Node sub_node("sub");
+    b0::Subscriber sub(&sub_node, "topic1");
+    sub.setReadHWM(10);
+    sub_node.init();
+
+    b0::Node pub_node("pub");
+    b0::Publisher pub(&pub_node, "topic1");
+    pub.setWriteHWM(10);
+    pub.setBackpressure(b0::Publisher::Backpressure::Count);
+    pub_node.init();
+
+    // let the subscriber connect to the publisher
+    for(int i = 0; i < 20; i++)
+    {
+        sub_node.spinOnce();
+        pub_node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+    }
+
+    bool congested = false;
+    std::string payload(64 * 1024, 'x');
+    for(int i = 0; i < 5000 && !congested; i++)
+    {
+        pub.publish(payload);
+        congested = pub.getCongested();
+    }
+
+    uint64_t dropped = pub.getDroppedCount();
+    std::cout << "congested: " << congested << ", dropped: " << dropped << ", sent: " << pub.getCounters().messages_sent.load() << std::endl;
+    exit(congested && dropped > 0 ? 0 : 1);
+}
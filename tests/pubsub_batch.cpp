@@ -0,0 +1,73 @@
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    // batches flushed both when full and when too old:
+    pub.setBatchPolicy(10, 0, 5000);
+    node.init();
+    for(long i = 1; ; i++)
+    {
+        pub.publishBatch(boost::lexical_cast<std::string>(i));
+        if(i % 7 == 0)
+        {
+            node.spinOnce();
+            boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+        }
+    }
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    long last = 0, received = 0;
+    b0::Subscriber::CallbackRaw callback = [&](const std::string &msg) {
+        long i = boost::lexical_cast<long>(msg);
+        // the first batches may be lost while connecting, but then nothing is
+        if(last && i != last + 1)
+        {
+            std::cerr << "expected " << (last + 1) << ", got " << i << std::endl;
+            exit(1);
+        }
+        last = i;
+        if(++received == 200)
+            exit(0);
+    };
+    b0::Subscriber sub(&node, "topic1", callback);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
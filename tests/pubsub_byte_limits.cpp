@@ -0,0 +1,136 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+#include <zmq.hpp>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void fail(const std::string &what)
+{
+    std::cerr << what << std::endl;
+    exit(1);
+}
+
+void pub_queue_test()
+{
+    b0::Node node("pub-queue");
+    b0::Publisher pub(&node, "topic2");
+    pub.setBackpressure(b0::Publisher::Backpressure::Queue);
+    pub.setQueueLimit(250000);
+    pub.setWriteHWM(1);
+
+    // a subscriber which does not read, so that the queues of ZeroMQ fill up at once:
+    zmq::socket_t sink(*reinterpret_cast<zmq::context_t*>(node.getContext()), ZMQ_SUB);
+    int one = 1, zero = 0;
+    sink.setsockopt(ZMQ_RCVHWM, &one, sizeof(one));
+    sink.setsockopt(ZMQ_LINGER, &zero, sizeof(zero));
+    sink.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+    sink.bind("inproc://pubsub_byte_limits");
+    pub.setRemoteAddress("inproc://pubsub_byte_limits");
+    node.init();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{200});
+
+    for(int i = 0; i < 10; i++)
+    {
+        pub.publish(std::string(100000, 'x'));
+        std::cout << "queued: " << pub.getQueueBytes() << " bytes" << std::endl;
+        if(pub.getQueueBytes() > pub.getQueueLimit())
+            fail("queue of the publisher over its limit");
+    }
+    if(!pub.getCongested() || pub.getDroppedCount() == 0)
+        fail("publisher not congested");
+    std::cout << "dropped: " << pub.getDroppedCount() << std::endl;
+
+    // the queue is written as the subscriber reads:
+    int received = 0;
+    for(int i = 0; i < 200 && (pub.getQueueBytes() > 0 || received == 0); i++)
+    {
+        zmq::message_t msg;
+        while(sink.recv(&msg, ZMQ_DONTWAIT)) received++;
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+    std::cout << "received: " << received << std::endl;
+    if(pub.getQueueBytes() > 0 || received < 3)
+        fail("queue of the publisher not written");
+}
+
+std::atomic<long> pub_max{0};
+
+void pub_thread()
+{
+    // small status messages mixed with large frames:
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    for(long i = 1; ; i++)
+    {
+        std::vector<b0::message::MessagePart> parts(2);
+        parts[0].payload = boost::lexical_cast<std::string>(i);
+        parts[1].payload = std::string(i % 2 ? 100 : 200000, 'x');
+        pub.publish(parts);
+        pub_max = i;
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+    }
+}
+
+std::atomic<long> received{0};
+std::atomic<long> max_lag{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber::CallbackParts callback = [&](const std::vector<b0::message::MessagePart> &parts) {
+        long i = boost::lexical_cast<long>(parts.at(0).payload);
+        if(parts.size() != 2 || parts[1].payload.size() != (i % 2 ? 100 : 200000))
+            fail("bad message");
+        long lag = pub_max - i;
+        std::cout << "recv: " << i << " (lag " << lag << ")" << std::endl;
+        if(received++ > 0 && lag > max_lag) max_lag = lag;
+        // a slow consumer:
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+    };
+    b0::Subscriber sub(&node, "topic1", callback);
+    // about two large frames, or many small messages:
+    sub.setBufferLimit(500000);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&pub_queue_test);
+    t2.join();
+
+    boost::thread t3(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t4(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{3});
+
+    // without a bound, the backlog would grow by ~20 messages per callback
+    std::cout << "received " << received << ", max lag " << max_lag << std::endl;
+    exit(received >= 5 && max_lag <= 30 ? 0 : 1);
+}
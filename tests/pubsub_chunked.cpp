@@ -0,0 +1,109 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+// big payloads are sent in chunks of 64 KiB, interleaved with small ones
+std::string big_payload;
+std::string small_payload("small");
+
+std::atomic<int> big_received{0}, small_received{0}, capped_small_received{0};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setChunkSize(64 * 1024);
+    node.init();
+    for(;;)
+    {
+        pub.publish(big_payload);
+        pub.publish(small_payload);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{50});
+    }
+}
+
+void check_done()
+{
+    if(big_received > 0 && small_received > 0 && capped_small_received > 1)
+    {
+        std::cout << "ok" << std::endl;
+        exit(0);
+    }
+}
+
+void callback(const std::string &payload)
+{
+    if(payload == big_payload) big_received++;
+    else if(payload == small_payload) small_received++;
+    else
+    {
+        std::cout << "mismatch: " << payload.size() << " bytes" << std::endl;
+        exit(1);
+    }
+    check_done();
+}
+
+void capped_callback(const std::string &payload)
+{
+    // envelopes bigger than the reassembly cap are discarded
+    if(payload != small_payload)
+    {
+        std::cout << "capped subscriber received " << payload.size() << " bytes" << std::endl;
+        exit(1);
+    }
+    capped_small_received++;
+    check_done();
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", &callback);
+    node.init();
+    node.spin();
+}
+
+void capped_sub_thread()
+{
+    b0::Node node("capped-sub");
+    b0::Subscriber sub(&node, "topic1", &capped_callback);
+    sub.setMaxReassemblySize(1024 * 1024);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{6});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    big_payload.resize(4 * 1024 * 1024);
+    for(size_t i = 0; i < big_payload.size(); i++)
+        big_payload[i] = char(i * 7 + i / 1000);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::thread t3(&capped_sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t4(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,88 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/message/content_type_ids.h>
+
+static const std::string content_type = "example.geometry.Pose";
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void fail(const std::string &what)
+{
+    std::cerr << what << std::endl;
+    exit(1);
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setEnvelopeFormat(b0::message::EnvelopeFormat::BinaryIds);
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        pub.publish("pose", content_type);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+std::atomic<long> received{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", b0::Subscriber::CallbackRawType([&](const std::string &msg, const std::string &type) {
+        if(msg != "pose" || type != content_type) fail("wrong message or content type: " + type);
+        received++;
+    }));
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    // the id registered by the publisher is known to the resolver, for any other node:
+    b0::Node mon("mon");
+    mon.init();
+    int64_t id = -1;
+    bool ok = b0::message::getContentTypeId(content_type, id) && id >= 0;
+    std::string looked_up;
+    int64_t looked_up_id = id;
+    ok = ok && mon.getContentTypeId(looked_up, looked_up_id) && looked_up == content_type;
+    std::string other = "example.geometry.Twist";
+    int64_t other_id = -1;
+    ok = ok && mon.getContentTypeId(other, other_id) && other_id >= 0 && other_id != id;
+
+    std::cout << "received: " << received << ", id: " << id << ", other id: " << other_id << std::endl;
+    exit(ok && received >= 50 ? 0 : 1);
+}
@@ -0,0 +1,75 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        pub.publish(std::string("msg"));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+    }
+}
+
+std::atomic<long> received_all{0}, received_rate{0}, received_decimated{0};
+std::atomic<uint64_t> filtered{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub_all(&node, "topic1", b0::Subscriber::CallbackRaw([&](const std::string &msg) {received_all++;}));
+    b0::Subscriber sub_rate(&node, "topic1", b0::Subscriber::CallbackRaw([&](const std::string &msg) {received_rate++;}));
+    sub_rate.setMaxRate(10);
+    b0::Subscriber sub_decimated(&node, "topic1", b0::Subscriber::CallbackRaw([&](const std::string &msg) {received_decimated++;}));
+    sub_decimated.setDecimation(10);
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        // the messages are dropped by the proxy, not here:
+        filtered = sub_rate.getStatistics().filtered + sub_decimated.getStatistics().filtered;
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{3});
+
+    long all = received_all, rate = received_rate, decimated = received_decimated;
+    std::cout << "all: " << all << ", max-rate: " << rate << ", decimated: " << decimated << ", filtered: " << filtered << std::endl;
+    bool ok = all >= 100
+        && rate >= 15 && rate <= 35
+        && decimated >= all / 10 - 5 && decimated <= all / 10 + 5
+        && filtered == 0;
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub1(&node, "camera");
+    b0::Publisher pub2(&node, "camera_raw");
+    node.init();
+    while(true)
+    {
+        pub2.publish(std::string("camera_raw"));
+        pub1.publish(std::string("camera"));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+int received = 0;
+
+void callback(const std::string &msg)
+{
+    // a subscriber of "camera" must not receive the messages of "camera_raw"
+    if(msg != "camera")
+    {
+        std::cerr << "received a message of another topic: " << msg << std::endl;
+        exit(1);
+    }
+    if(++received == 50)
+        exit(0);
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "camera", &callback);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,75 @@
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+const std::string message(10000, 'x');
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setCompression("zlib", 6);
+    node.init();
+    for(;;)
+    {
+        pub.publish(message, "text");
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+void relay_thread()
+{
+    // the envelopes of topic1 are republished on topic2, still compressed
+    b0::Node node("relay");
+    b0::Subscriber sub(&node, "topic1");
+    b0::Publisher pub(&node, "topic2");
+    node.init();
+    std::shared_ptr<const void> buffer;
+    for(;;)
+    {
+        boost::string_ref wire = sub.readWire(buffer);
+        if(wire.size() >= message.size())
+            exit(1);
+        pub.forward(wire);
+    }
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic2");
+    node.init();
+    b0::message::MessageEnvelope env;
+    sub.readRaw(env);
+    exit(env.header0 == "topic2" && env.parts.size() == 1 && env.parts[0].payload == message && env.parts[0].content_type == "text" ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::thread t3(&relay_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t4(&pub_thread);
+    t0.join();
+}
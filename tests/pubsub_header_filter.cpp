@@ -0,0 +1,78 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/message/message_envelope.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "sensors");
+    node.init();
+    for(int i = 0; ; i++)
+    {
+        std::string id = i % 2 ? "imu-left" : "imu-right";
+        b0::message::MessageEnvelope env;
+        env.header0 = pub.getTopicName();
+        env.headers["Sensor-id"] = id;
+        env.parts.resize(1);
+        env.parts[0].payload = id;
+        pub.writeRaw(env);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    std::atomic<int> received{0};
+    b0::Subscriber::CallbackRaw callback = [&](const std::string &msg) {
+        if(msg != "imu-left")
+        {
+            std::cerr << "received a message rejected by the filter: " << msg << std::endl;
+            exit(1);
+        }
+        received++;
+    };
+    b0::Subscriber sub(&node, "sensors", callback);
+    sub.setHeaderFilter([](const b0::message::MessageEnvelopeView &env) {
+        auto id = env.findHeader("Sensor-id");
+        return id && *id == "imu-left";
+    });
+    node.init();
+    while(received < 50)
+        node.spinOnce();
+    uint64_t filtered = sub.getStatistics().filtered;
+    std::cout << "received " << received << ", filtered " << filtered << std::endl;
+    exit(filtered >= 40 ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,78 @@
+#include <iostream>
+#include <atomic>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+const int num_messages = 10;
+const int history = 4;
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    // published once, then only kept for the subscribers joining later
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "trajectory");
+    pub.setHistory(history);
+    node.init();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    for(int i = 0; i < num_messages; i++)
+        pub.publish("pose-" + std::to_string(i));
+    node.spin();
+}
+
+std::atomic<int> early_received{0};
+std::atomic<int> late_received{0};
+
+void sub_thread(const std::string &name, std::atomic<int> *received, int first)
+{
+    b0::Node node(name);
+    b0::Subscriber::CallbackRaw callback = [=](const std::string &msg) {
+        // the messages arrive once each, in order:
+        std::string expected = "pose-" + std::to_string(first + *received);
+        if(msg != expected)
+        {
+            std::cerr << name << ": unexpected message: " << msg << " (expected " << expected << ")" << std::endl;
+            exit(1);
+        }
+        (*received)++;
+    };
+    b0::Subscriber sub(&node, "trajectory", callback);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread, "early", &early_received, 0);
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    // long after the messages were published:
+    boost::thread t4(&sub_thread, "late", &late_received, num_messages - history);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    std::cout << "early subscriber received " << early_received << ", late subscriber received " << late_received << std::endl;
+    // the early subscriber drops the history sent for the late one:
+    exit(early_received == num_messages && late_received == history ? 0 : 1);
+}
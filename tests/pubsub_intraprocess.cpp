@@ -0,0 +1,72 @@
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    for(int i = 0; ; i++)
+    {
+        pub.publish(boost::lexical_cast<std::string>(i));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+int last = -1, received = 0;
+
+void callback(const std::string &msg)
+{
+    // messages must arrive exactly once: the copy coming back from the proxy must be discarded
+    int i = boost::lexical_cast<int>(msg);
+    if(i <= last)
+    {
+        std::cerr << "duplicate or out of order message: " << i << " after " << last << std::endl;
+        exit(1);
+    }
+    last = i;
+    if(++received == 100)
+        exit(0);
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", &callback);
+    node.setSpinMode(b0::SpinMode::EventDriven);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+    b0::setIntraProcess(true);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,83 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+std::atomic<long> pub_max{0};
+
+void pub_thread()
+{
+    // multipart messages, split in chunks: ZMQ_CONFLATE would break both
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setChunkSize(256);
+    node.init();
+    for(long i = 1; ; i++)
+    {
+        std::vector<b0::message::MessagePart> parts(2);
+        parts[0].payload = boost::lexical_cast<std::string>(i);
+        parts[1].payload = std::string(1000, 'x');
+        pub.publish(parts);
+        pub_max = i;
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+std::atomic<long> received{0};
+std::atomic<long> max_lag{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber::CallbackParts callback = [&](const std::vector<b0::message::MessagePart> &parts) {
+        if(parts.size() != 2 || parts[1].payload.size() != 1000)
+        {
+            std::cerr << "bad message" << std::endl;
+            exit(1);
+        }
+        long lag = pub_max - boost::lexical_cast<long>(parts[0].payload);
+        std::cout << "recv: " << parts[0].payload << " (lag " << lag << ")" << std::endl;
+        if(received++ > 0 && lag > max_lag) max_lag = lag;
+        // a slow consumer:
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{200});
+    };
+    b0::Subscriber sub(&node, "topic1", callback);
+    sub.setKeepLatest(1);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{3});
+
+    // without keep-latest, the lag would grow by ~20 messages per callback
+    std::cout << "received " << received << ", max lag " << max_lag << std::endl;
+    exit(received >= 5 && max_lag <= 5 ? 0 : 1);
+}
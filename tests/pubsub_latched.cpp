@@ -0,0 +1,72 @@
+#include <iostream>
+#include <atomic>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    // published once, then only kept for the subscribers joining later
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "config");
+    pub.setLatched(true);
+    node.init();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    pub.publish(std::string("config-1"));
+    node.spin();
+}
+
+std::atomic<int> early_received{0};
+std::atomic<int> late_received{0};
+
+void sub_thread(const std::string &name, std::atomic<int> *received)
+{
+    b0::Node node(name);
+    b0::Subscriber::CallbackRaw callback = [=](const std::string &msg) {
+        if(msg != "config-1")
+        {
+            std::cerr << name << ": unexpected message: " << msg << std::endl;
+            exit(1);
+        }
+        (*received)++;
+    };
+    b0::Subscriber sub(&node, "config", callback);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread, "early", &early_received);
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    // long after the message was published:
+    boost::thread t4(&sub_thread, "late", &late_received);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    std::cout << "early subscriber received " << early_received << ", late subscriber received " << late_received << std::endl;
+    // the early subscriber drops the copy sent for the late one:
+    exit(early_received == 1 && late_received == 1 ? 0 : 1);
+}
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <map>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/multi_subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher imu0(&node, "sensors/imu/0");
+    b0::Publisher imu1(&node, "sensors/imu/1");
+    b0::Publisher gps(&node, "sensors/gps");
+    b0::Publisher status(&node, "status");
+    node.init();
+    while(true)
+    {
+        imu0.publish(std::string("sensors/imu/0"));
+        imu1.publish(std::string("sensors/imu/1"));
+        gps.publish(std::string("sensors/gps"));
+        status.publish(std::string("status"));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::MultiSubscriber sub(&node, "sensors");
+    std::map<std::string, int> received;
+    auto callback = [&](const std::string &topic, const std::string &msg) {
+        // the payload is the name of the topic it was published on
+        if(msg != topic || topic == "sensors/gps")
+        {
+            std::cerr << "unexpected message on " << topic << ": " << msg << std::endl;
+            exit(1);
+        }
+        received[topic]++;
+    };
+    sub.subscribe("sensors/imu/*", callback);
+    sub.subscribe("status", callback);
+    node.init();
+    while(received["sensors/imu/0"] < 20 || received["sensors/imu/1"] < 20 || received["status"] < 20)
+        node.spinOnce();
+    exit(0);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/utils/env.h>
+
+#include <zmq.h>
+
+std::string multicast_address;
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setMulticast(multicast_address, 10000);
+    node.init();
+    while(true)
+    {
+        pub.publish(std::string("msg-data"));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{50});
+    }
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber::CallbackRaw callback = [&](const std::string &msg) {
+        std::cout << "Received: " << msg << std::endl;
+        exit(msg == "msg-data" ? 0 : 1);
+    };
+    b0::Subscriber sub(&node, "topic1", callback);
+    sub.setMulticast(true);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+#ifdef ZMQ_HAS_CAPABILITIES
+    if(!zmq_has("pgm"))
+#endif
+    {
+        std::cout << "ZeroMQ built without PGM support, skipping" << std::endl;
+        return 0;
+    }
+
+    b0::init(argc, argv);
+
+    std::string iface = b0::env::get("B0_TEST_MULTICAST_INTERFACE", "127.0.0.1");
+    multicast_address = "epgm://" + iface + ";239.192.1.1:5555";
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&sub_thread);
+    t0.join();
+}
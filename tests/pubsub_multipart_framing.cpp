@@ -0,0 +1,114 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/message/log/log_entry.h>
+
+std::string payload0("\x00\x01\x02\x03 foo", 8);
+std::string payload1(100000, 'x');
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setMultipartFraming(true);
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        // a message encoded in place, a raw payload moved in, and several parts (one compressed):
+        b0::message::log::LogEntry entry;
+        entry.node_name = "pub";
+        entry.message = payload0;
+        pub.publish(entry);
+        pub.publish(std::string(payload1), "B");
+        std::vector<b0::message::MessagePart> parts(3);
+        parts[0].content_type = "A";
+        parts[0].payload = payload0;
+        parts[2].content_type = "B";
+        parts[2].payload = payload1;
+        parts[2].compression_algorithm = "zlib";
+        parts[2].compression_level = 9;
+        pub.publish(std::move(parts));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+std::atomic<long> received_entries{0}, received_raw{0}, received_parts{0}, received_decimated{0};
+
+void fail(const std::string &what)
+{
+    std::cerr << what << std::endl;
+    exit(1);
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", b0::Subscriber::CallbackPartsView([&](const std::vector<b0::message::MessagePartView> &parts) {
+        if(parts.size() == 3)
+        {
+            if(parts[0].content_type != "A" || parts[0].str() != payload0 || parts[1].size != 0 || parts[2].str() != payload1)
+                fail("mismatch of the parts");
+            received_parts++;
+        }
+        else if(parts.size() == 1 && parts[0].content_type == "B")
+        {
+            if(parts[0].str() != payload1)
+                fail("mismatch of the raw payload");
+            received_raw++;
+        }
+        else if(parts.size() == 1)
+        {
+            b0::message::log::LogEntry entry;
+            b0::message::parse(entry, parts[0].str(), parts[0].content_type);
+            if(entry.message != payload0)
+                fail("mismatch of the message");
+            received_entries++;
+        }
+        else fail("wrong number of parts");
+    }));
+    // the copies of the proxy are made of the whole envelope:
+    b0::Subscriber sub_decimated(&node, "topic1", b0::Subscriber::CallbackRawType([&](const std::string &msg, const std::string &type) {
+        received_decimated++;
+    }));
+    sub_decimated.setDecimation(3);
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    std::cout << "entries: " << received_entries << ", raw: " << received_raw << ", parts: " << received_parts << ", decimated: " << received_decimated << std::endl;
+    exit(received_entries >= 50 && received_raw >= 50 && received_parts >= 50 && received_decimated >= 20 ? 0 : 1);
+}
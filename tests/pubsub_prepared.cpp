@@ -0,0 +1,83 @@
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+const std::string message(10000, 'p');
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    // serialized and compressed once, then sent on topic1 as it is, and on topic2 with its header0 replaced
+    b0::Node node("pub");
+    b0::Publisher pub1(&node, "topic1");
+    b0::Publisher pub2(&node, "topic2");
+    pub1.setCompression("zlib", 6);
+    node.init();
+    b0::PreparedMessage prepared = pub1.prepare(message, "text");
+    if(!prepared.valid() || prepared.wire().size() >= message.size() || !prepared.wire().starts_with("topic1\n"))
+        exit(1);
+    for(;;)
+    {
+        pub1.publish(prepared);
+        pub2.publish(prepared);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+bool received(const std::string &topic)
+{
+    b0::Node node("sub-" + topic);
+    b0::Subscriber sub(&node, topic);
+    node.init();
+    b0::message::MessageEnvelope env;
+    for(int i = 0; i < 3; i++)
+    {
+        sub.readRaw(env);
+        if(env.header0 != topic || env.parts.size() != 1 || env.parts[0].payload != message || env.parts[0].content_type != "text")
+            return false;
+    }
+    return true;
+}
+
+bool ok1 = false, ok2 = false;
+
+void sub1_thread()
+{
+    ok1 = received("topic1");
+}
+
+void sub2_thread()
+{
+    ok2 = received("topic2");
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub1_thread);
+    boost::thread t3(&sub2_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t4(&pub_thread);
+    t2.join();
+    t3.join();
+    exit(ok1 && ok2 ? 0 : 1);
+}
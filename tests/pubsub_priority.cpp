@@ -0,0 +1,92 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+typedef boost::chrono::steady_clock clock_type;
+
+static long nowUSec()
+{
+    return long(boost::chrono::duration_cast<boost::chrono::microseconds>(clock_type::now().time_since_epoch()).count());
+}
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.setNumPriorityProxies(1);
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub_bulk(&node, "bulk");
+    b0::Publisher pub_control(&node, "control");
+    pub_control.setHighPriority(true);
+    node.init();
+    if(node.getPriorityXSUBSocketAddress("control") == node.getXSUBSocketAddress("control"))
+    {
+        std::cerr << "no high-priority proxy" << std::endl;
+        exit(1);
+    }
+    std::string frame(20 * 1024 * 1024, 'x');
+    int i = 0;
+    while(!node.shutdownRequested())
+    {
+        // a large frame every 100 ms, keeping the bulk proxy and connections busy:
+        if(i++ % 10 == 0)
+            pub_bulk.publish(frame);
+        pub_control.publish(std::to_string(nowUSec()));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+std::atomic<long> received_bulk{0}, received_control{0}, max_latency_usec{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub_bulk(&node, "bulk", b0::Subscriber::CallbackRaw([&](const std::string &msg) {
+        received_bulk++;
+    }));
+    b0::Subscriber sub_control(&node, "control", b0::Subscriber::CallbackRaw([&](const std::string &msg) {
+        // (the first ones may have waited for the connections)
+        long latency = nowUSec() - std::stol(msg);
+        if(received_control++ > 10 && latency > max_latency_usec) max_latency_usec = latency;
+    }));
+    sub_control.setHighPriority(true);
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+    b0::setPriorityIOThread(true);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{3});
+
+    std::cout << "bulk: " << received_bulk << ", control: " << received_control << ", max latency: " << max_latency_usec << " us" << std::endl;
+    exit(received_bulk >= 5 && received_control >= 100 && max_latency_usec < 100000 ? 0 : 1);
+}
@@ -0,0 +1,81 @@
+#include <atomic>
+#include <iostream>
+#include <set>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+const int count = 100;
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+std::atomic<bool> sub_ready{false};
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setReliable(1000);
+    node.init();
+    while(!sub_ready)
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    for(int n = 1; !node.shutdownRequested(); n++)
+    {
+        if(n <= count)
+            pub.publish(std::to_string(n));
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+    }
+}
+
+void sub_thread()
+{
+    std::set<int> received;
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", b0::Subscriber::CallbackRaw([&](const std::string &msg) {
+        received.insert(std::stoi(msg));
+    }));
+    sub.setReliable(true);
+    // every fifth message is lost on its first transmission:
+    sub.setHeaderFilter([](const b0::message::MessageEnvelopeView &env) {
+        auto seq = env.findHeader("Seq");
+        return !seq || env.findHeader("Retransmitted") || std::stoull(seq->to_string()) % 5 != 3;
+    });
+    node.init();
+    sub_ready = true;
+    while(received.size() < count)
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+    b0::Subscriber::Statistics stats = sub.getStatistics();
+    std::cout << "received: " << received.size() << ", recovered: " << stats.recovered << ", duplicates: " << stats.duplicates << ", lost: " << stats.lost << std::endl;
+    exit(*received.begin() == 1 && *received.rbegin() == count && stats.recovered == count / 5 && stats.lost == 0 ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
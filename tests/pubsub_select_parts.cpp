@@ -0,0 +1,91 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void fail(const std::string &what)
+{
+    std::cerr << what << std::endl;
+    exit(1);
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    for(long i = 1; !node.shutdownRequested(); i++)
+    {
+        // a small metadata part, and a large payload part:
+        std::vector<b0::message::MessagePart> parts(2);
+        parts[0].content_type = "Meta";
+        parts[0].payload = boost::lexical_cast<std::string>(i);
+        parts[1].content_type = "Image";
+        parts[1].payload = std::string(200000, 'x');
+        pub.publish(parts);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+std::atomic<long> received_all{0}, received_meta{0};
+std::atomic<uint64_t> bytes_all{0}, bytes_meta{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub_all(&node, "topic1", b0::Subscriber::CallbackParts([&](const std::vector<b0::message::MessagePart> &parts) {
+        if(parts.size() != 2) fail("expected all the parts");
+        received_all++;
+    }));
+    b0::Subscriber sub_meta(&node, "topic1", b0::Subscriber::CallbackParts([&](const std::vector<b0::message::MessagePart> &parts) {
+        if(parts.size() != 1 || parts[0].content_type != "Meta") fail("expected the metadata part only");
+        boost::lexical_cast<long>(parts[0].payload);
+        received_meta++;
+    }));
+    sub_meta.setParts({"Meta"});
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        bytes_all = sub_all.getCounters().bytes_received.load();
+        bytes_meta = sub_meta.getCounters().bytes_received.load();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{3});
+
+    std::cout << "all: " << received_all << " (" << bytes_all << " bytes), meta: " << received_meta << " (" << bytes_meta << " bytes)" << std::endl;
+    // the payload parts never reached the metadata subscriber:
+    bool ok = received_all >= 50 && received_meta >= received_all / 2
+        && bytes_meta * 100 < bytes_all;
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <atomic>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+b0::resolver::Resolver *resolver = nullptr;
+std::atomic<bool> resolver_ready{false};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.setNumProxies(3);
+    node.setTopicProxy("topic1", 2);
+    resolver = &node;
+    node.init();
+    resolver_ready = true;
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub1(&node, "topic1");
+    b0::Publisher pub2(&node, "topic2");
+    node.init();
+
+    // the node must agree with the resolver on the proxy of each topic:
+    if(node.getXSUBSocketAddress("topic1") != resolver->getXSUBSocketAddress("topic1") ||
+            node.getXSUBSocketAddress("topic2") != resolver->getXSUBSocketAddress("topic2"))
+    {
+        std::cerr << "node and resolver disagree on topic proxies" << std::endl;
+        exit(1);
+    }
+    if(node.getXSUBSocketAddress("topic1") == node.getXSUBSocketAddress())
+    {
+        std::cerr << "explicit topic proxy not used" << std::endl;
+        exit(1);
+    }
+
+    for(int i = 0; ; i++)
+    {
+        pub1.publish(boost::lexical_cast<std::string>(i));
+        pub2.publish(boost::lexical_cast<std::string>(i));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+int received1 = 0, received2 = 0;
+
+void check()
+{
+    if(received1 >= 20 && received2 >= 20)
+        exit(0);
+}
+
+void callback1(const std::string &msg)
+{
+    received1++;
+    check();
+}
+
+void callback2(const std::string &msg)
+{
+    received2++;
+    check();
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub1(&node, "topic1", &callback1);
+    b0::Subscriber sub2(&node, "topic2", &callback2);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    while(!resolver_ready) boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,82 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+std::string payload;
+
+std::atomic<b0::Publisher*> publisher{nullptr};
+
+std::atomic<int> received{0};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setSharedMemory(true, 1024 * 1024, 4);
+    node.init();
+    publisher = &pub;
+    for(;;)
+    {
+        pub.publish(payload);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{20});
+    }
+}
+
+void callback(const std::vector<b0::message::MessagePartView> &parts)
+{
+    if(parts.size() != 1 || parts[0].str() != payload)
+    {
+        std::cout << "mismatch" << std::endl;
+        exit(1);
+    }
+    if(++received < 5) return;
+
+    // only the descriptors went through ZeroMQ
+    b0::SocketCounters &counters = publisher.load()->getCounters();
+    uint64_t messages = counters.messages_sent.load(), bytes = counters.bytes_sent.load();
+    std::cout << messages << " messages sent, " << bytes << " bytes" << std::endl;
+    exit(bytes < messages * 1024 ? 0 : 1);
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", &callback);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{8});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    payload.resize(512 * 1024);
+    for(size_t i = 0; i < payload.size(); i++)
+        payload[i] = char(i * 13 + i / 777);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "A");
+    pub.setStampMessages(true);
+    node.init();
+    while(true)
+    {
+        pub.publish(std::string("msg"));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+b0::Subscriber *sub = nullptr;
+uint64_t last_seq = 0;
+
+void callback(const std::string &msg)
+{
+    if(sub->getLastSendTime() < 0 || sub->getLastSeq() == 0)
+    {
+        std::cerr << "received a message without Send-time/Seq headers" << std::endl;
+        exit(1);
+    }
+    if(last_seq && sub->getLastSeq() <= last_seq)
+    {
+        std::cerr << "sequence number did not increase: " << last_seq << " -> " << sub->getLastSeq() << std::endl;
+        exit(1);
+    }
+    last_seq = sub->getLastSeq();
+
+    b0::Subscriber::Statistics stats = sub->getStatistics();
+    if(stats.received == 50)
+    {
+        if(stats.last_latency < 0 || stats.max_latency < stats.last_latency)
+        {
+            std::cerr << "bad latency statistics: last=" << stats.last_latency << " max=" << stats.max_latency << std::endl;
+            exit(1);
+        }
+        exit(0);
+    }
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber s(&node, "A", &callback);
+    sub = &s;
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+const int num_workers = 4;
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void worker_thread(b0::Publisher *pub, int i)
+{
+    std::string msg = "worker" + std::to_string(i);
+    for(;;)
+    {
+        pub->publish(msg);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+    }
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setThreadSafe(true);
+    node.init();
+
+    // the workers publish directly, while the node's thread publishes too:
+    for(int i = 0; i < num_workers; i++)
+        boost::thread(&worker_thread, &pub, i).detach();
+    for(;;)
+    {
+        pub.publish(std::string("node"));
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+    }
+}
+
+void sub_thread()
+{
+    int received[num_workers + 1] = {0};
+
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1");
+    node.init();
+    while(1)
+    {
+        std::string m;
+        sub.readRaw(m);
+        if(m == "node") received[num_workers]++;
+        for(int i = 0; i < num_workers; i++)
+            if(m == "worker" + std::to_string(i)) received[i]++;
+
+        bool all = true;
+        for(int i = 0; i <= num_workers; i++)
+            all = all && received[i] >= 10;
+        if(all)
+            exit(0);
+    }
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{6});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,82 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void fail(const std::string &what)
+{
+    std::cerr << what << std::endl;
+    exit(1);
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setTimeToLive(50000);
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        pub.publish(boost::lexical_cast<std::string>(node.timeUSec()));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+    }
+}
+
+std::atomic<long> received{0};
+std::atomic<uint64_t> expired{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber *psub = nullptr;
+    b0::Subscriber::CallbackRaw callback = [&](const std::string &msg) {
+        int64_t age = node.timeUSec() - boost::lexical_cast<int64_t>(msg);
+        std::cout << "recv: age " << age << "us" << std::endl;
+        // the message was checked before the callback, with some slack for the reading:
+        if(age > 50000 + 20000)
+            fail("expired message dispatched");
+        received++;
+        expired = psub->getStatistics().expired;
+        // a slow consumer, so that the messages waiting in the socket expire:
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+    };
+    b0::Subscriber sub(&node, "topic1", callback);
+    psub = &sub;
+    sub.setDropExpired(true);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{3});
+
+    std::cout << "received " << received << ", expired " << expired << std::endl;
+    exit(received >= 5 && expired > 0 ? 0 : 1);
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+std::string payload0("\x00\x01\x02\x03 foo", 8);
+std::string payload1(10000, 'x');
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    for(;;)
+    {
+        std::vector<b0::message::MessagePart> parts(2);
+        parts[0].content_type = "A";
+        parts[0].payload = payload0;
+        parts[1].content_type = "B";
+        parts[1].payload = payload1;
+        parts[1].compression_algorithm = "zlib";
+        parts[1].compression_level = 9;
+        pub.publish(std::move(parts));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+void callback(const std::vector<b0::message::MessagePartView> &parts)
+{
+    bool ok = parts.size() == 2
+        && parts[0].content_type == "A" && parts[0].str() == payload0
+        && parts[1].content_type == "B" && parts[1].str() == payload1;
+    std::cout << "received " << parts.size() << " parts: " << (ok ? "ok" : "mismatch") << std::endl;
+    exit(ok ? 0 : 1);
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", &callback);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
@@ -0,0 +1,92 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+const int num_sockets = 10;
+
+// counts the announcements which reach the resolver, one by one or batched
+std::atomic<int> service_announces{0}, batches{0};
+
+class CountingResolver : public b0::resolver::Resolver
+{
+public:
+    void handleAnnounceService(const b0::message::resolv::AnnounceServiceRequest &rq, b0::message::resolv::AnnounceServiceResponse &rsp) override
+    {
+        service_announces++;
+        Resolver::handleAnnounceService(rq, rsp);
+    }
+
+    void handleAnnounceSockets(const b0::message::resolv::AnnounceSocketsRequest &rq, b0::message::resolv::AnnounceSocketsResponse &rsp) override
+    {
+        batches++;
+        Resolver::handleAnnounceSockets(rq, rsp);
+    }
+};
+
+void resolver_thread()
+{
+    CountingResolver node;
+    node.init();
+    node.spin();
+}
+
+void node_thread()
+{
+    b0::Node node("many-sockets");
+    std::vector<std::unique_ptr<b0::Socket> > sockets;
+    for(int i = 0; i < num_sockets; i++)
+    {
+        std::string n = std::to_string(i);
+        sockets.emplace_back(new b0::Publisher(&node, "topic" + n));
+        sockets.emplace_back(new b0::Subscriber(&node, "topic" + n, b0::Subscriber::CallbackRaw([](const std::string &msg) {})));
+        sockets.emplace_back(new b0::ServiceServer(&node, "service" + n, b0::ServiceServer::CallbackRaw([=](const std::string &req, std::string &rep) {rep = n;})));
+    }
+    // a client of a service of the same node resolves it during init: the announcements
+    // collected so far are sent first, and those after it in a second batch
+    b0::ServiceClient cli(&node, "service0");
+    node.init();
+
+    b0::message::graph::Graph graph;
+    node.getGraph(graph);
+    std::cout << "batches: " << batches << ", services announced: " << service_announces
+        << ", graph: " << graph.node_topic.size() << " topic links, " << graph.node_service.size() << " service links" << std::endl;
+    bool ok = batches == 2 && service_announces == num_sockets
+        && graph.node_topic.size() >= 2 * num_sockets && graph.node_service.size() >= num_sockets + 1;
+
+    boost::thread spin_thread([&] {node.spin();});
+    std::string rep;
+    for(int i = 0; ok && i < num_sockets; i++)
+    {
+        b0::ServiceClient cli1(&node, "service" + std::to_string(i), false);
+        cli1.init();
+        cli1.call(std::string("x"), rep);
+        ok = rep == std::to_string(i);
+        cli1.cleanup();
+    }
+    std::cout << "calls: " << (ok ? "ok" : "failed") << std::endl;
+    exit(ok ? 0 : 1);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&node_thread);
+    t0.join();
+}
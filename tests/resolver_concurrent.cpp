@@ -0,0 +1,83 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+const int num_clients = 8;
+
+// resolutions in progress, and the most seen at once
+std::atomic<int> resolving{0}, peak_resolving{0};
+
+// makes each service resolution take a while, and counts the ones overlapping
+class SlowResolver : public b0::resolver::Resolver
+{
+public:
+    void handleResolveService(const b0::message::resolv::ResolveServiceRequest &rq, b0::message::resolv::ResolveServiceResponse &rsp) override
+    {
+        int n = ++resolving;
+        int peak = peak_resolving;
+        while(n > peak && !peak_resolving.compare_exchange_weak(peak, n)) {}
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{200});
+        resolving--;
+        Resolver::handleResolveService(rq, rsp);
+    }
+};
+
+void resolver_thread()
+{
+    SlowResolver node;
+    node.setServiceThreads(4);
+    node.init();
+    node.spin();
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {rep = req + "_";}));
+    node.init();
+    node.spin();
+}
+
+std::atomic<int> ok_clients{0};
+
+void cli_thread(int i)
+{
+    b0::Node node("cli" + std::to_string(i));
+    b0::ServiceClient cli(&node, "service1");
+    node.init();
+    std::string rep;
+    cli.call(std::string("x"), rep);
+    if(rep == "x_") ok_clients++;
+    node.cleanup();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    // the resolutions are served by 4 threads, so some of the 8 overlap
+    std::vector<boost::thread> clients;
+    for(int i = 0; i < num_clients; i++)
+        clients.emplace_back(&cli_thread, i);
+    for(auto &client : clients)
+        client.join();
+    std::cout << ok_clients << " clients ok, up to " << peak_resolving << " resolutions at once" << std::endl;
+    exit(ok_clients == num_clients && peak_resolving >= 2 ? 0 : 1);
+}
@@ -0,0 +1,134 @@
+#include <atomic>
+#include <iostream>
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+const int parent_port = 22600;
+const int child_port = 22700;
+
+std::atomic<bool> done{false};
+std::atomic<int> received{0};
+b0::resolver::Resolver *child_resolver = nullptr;
+
+std::string resolverAddress(int port)
+{
+    return (boost::format("tcp://localhost:%d") % port).str();
+}
+
+void parent_resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.setResolverPort(parent_port);
+    node.setFederationInterval(200000);
+    node.init();
+    node.spin();
+}
+
+void child_resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.setResolverPort(child_port);
+    node.setParent(resolverAddress(parent_port));
+    node.setFederationInterval(200000);
+    child_resolver = &node;
+    node.init();
+    node.spin();
+}
+
+// the nodes of the parent site:
+void parent_site_thread()
+{
+    b0::Node node("parent-site");
+    node.setResolverAddress(resolverAddress(parent_port));
+    b0::ServiceServer srv(&node, "federated-service", b0::ServiceServer::CallbackRaw([&](const std::string &req, std::string &rep) {
+        rep = "re:" + req;
+    }));
+    b0::Publisher pub(&node, "federated-topic");
+    node.init();
+    std::string payload = "payload";
+    while(!node.shutdownRequested() && !done)
+    {
+        node.spinOnce();
+        pub.publish(payload);
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+    node.cleanup();
+}
+
+// the subscriber of the child site:
+void child_sub_thread()
+{
+    b0::Node node("child-sub");
+    node.setResolverAddress(resolverAddress(child_port));
+    b0::Subscriber sub(&node, "federated-topic", static_cast<b0::Subscriber::CallbackRaw>([&](const std::string &payload) {
+        if(payload == "payload") received++;
+    }));
+    node.init();
+    while(!node.shutdownRequested() && !done)
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+    node.cleanup();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+bool check(bool cond, const std::string &what)
+{
+    std::cout << what << ": " << (cond ? "ok" : "FAILED") << std::endl;
+    return cond;
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&parent_resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&child_resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&parent_site_thread);
+    boost::thread t4(&child_sub_thread);
+    // let a few directory syncs go by:
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    bool ok = true;
+
+    // a service of the parent site, called from the child site:
+    {
+        b0::Node node("child-cli");
+        node.setResolverAddress(resolverAddress(child_port));
+        b0::ServiceClient cli(&node, "federated-service");
+        node.init();
+        std::string req = "hello", rep;
+        cli.call(req, rep);
+        ok &= check(rep == "re:hello", "service of the parent site");
+        node.cleanup();
+    }
+
+    // a topic of the parent site, received at the child site through a bridge:
+    for(int i = 0; i < 50 && received == 0; i++)
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+    ok &= check(received > 0, "topic of the parent site");
+    std::vector<std::string> bridged = child_resolver->getBridgedTopics();
+    ok &= check(bridged.size() == 1 && bridged[0] == "federated-topic", "bridged topics");
+
+    done = true;
+    t3.join();
+    t4.join();
+
+    exit(ok ? 0 : 1);
+}
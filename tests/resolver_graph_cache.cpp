@@ -0,0 +1,67 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    b0::Node mon("mon");
+    mon.init();
+
+    b0::message::graph::Graph graph;
+    if(!check("first request gets the graph", mon.getGraph(graph, -1) && !graph.nodes.empty()))
+        return 1;
+
+    // the same version again, served from the cache:
+    b0::message::graph::Graph again;
+    mon.getGraph(again);
+    bool ok = again.version == graph.version && again.nodes.size() == graph.nodes.size();
+    if(!check("unconditional request gets the same graph", ok))
+        return 1;
+
+    b0::message::graph::Graph unchanged;
+    unchanged.version = -2;
+    ok = !mon.getGraph(unchanged, graph.version) && unchanged.version == -2;
+    if(!check("request at the current version is not modified", ok))
+        return 1;
+
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+
+    b0::message::graph::Graph changed;
+    ok = mon.getGraph(changed, graph.version) && changed.version > graph.version && changed.nodes.size() == graph.nodes.size() + 1;
+    if(!check("request after a change gets the new graph", ok))
+        return 1;
+
+    node.cleanup();
+    mon.cleanup();
+    return 0;
+}
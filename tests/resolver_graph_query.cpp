@@ -0,0 +1,106 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/service_server.h>
+#include <b0/message/graph/get_graph_request.h>
+#include <b0/exceptions.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    b0::Node a("node-a");
+    b0::Publisher pub1(&a, "topic1");
+    b0::Subscriber sub2(&a, "topic2");
+    b0::ServiceServer srv(&a, "service1", b0::ServiceServer::CallbackRaw([&](const std::string &req, std::string &rep) {
+        rep = req;
+    }));
+    a.init();
+    b0::Node b("node-b");
+    b0::Subscriber sub1(&b, "topic1");
+    b0::Publisher pub3(&b, "other3");
+    b.init();
+    b0::Node mon("mon");
+    mon.init();
+
+    bool ok = true;
+    b0::message::graph::GetGraphRequest query;
+    b0::message::graph::Graph graph;
+
+    query.node_name = "node-a";
+    mon.getGraph(graph, query);
+    ok &= check("one node", graph.nodes.size() == 1 && graph.nodes[0].node_name == "node-a"
+            && graph.node_topic.size() == 2 && graph.node_service.size() == 1);
+
+    query = b0::message::graph::GetGraphRequest();
+    query.topic_name = "topic1";
+    query.link_type = "publishes";
+    graph = b0::message::graph::Graph();
+    mon.getGraph(graph, query);
+    ok &= check("publishers of a topic", graph.node_topic.size() == 1 && graph.node_topic[0].node_name == "node-a"
+            && !graph.node_topic[0].reversed && graph.nodes.size() == 1 && graph.node_service.empty());
+
+    query = b0::message::graph::GetGraphRequest();
+    query.topic_name = "topic*";
+    graph = b0::message::graph::Graph();
+    mon.getGraph(graph, query);
+    ok &= check("topic pattern", graph.node_topic.size() == 3 && graph.node_service.empty() && graph.nodes.size() == 2);
+
+    query = b0::message::graph::GetGraphRequest();
+    query.node_name = "node-*";
+    query.link_type = "service";
+    graph = b0::message::graph::Graph();
+    mon.getGraph(graph, query);
+    ok &= check("services of the nodes matching", graph.node_service.size() == 1 && graph.node_service[0].other_name == "service1"
+            && graph.node_topic.empty() && graph.nodes.size() == 1);
+
+    query = b0::message::graph::GetGraphRequest();
+    query.node_name = "*-b";
+    graph = b0::message::graph::Graph();
+    mon.getGraph(graph, query);
+    ok &= check("node pattern", graph.nodes.size() == 1 && graph.nodes[0].node_name == "node-b" && graph.node_topic.size() == 2);
+
+    query = b0::message::graph::GetGraphRequest();
+    query.link_type = "bogus";
+    bool thrown = false;
+    try {mon.getGraph(graph, query);} catch(b0::exception::ArgumentError &) {thrown = true;}
+    ok &= check("bad link type", thrown);
+
+    b.cleanup();
+    query = b0::message::graph::GetGraphRequest();
+    query.topic_name = "topic1";
+    graph = b0::message::graph::Graph();
+    mon.getGraph(graph, query);
+    ok &= check("index updated", graph.node_topic.size() == 1 && graph.node_topic[0].node_name == "node-a");
+
+    a.cleanup();
+    mon.cleanup();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/message/resolv/resolver_snapshot.h>
+
+const char *state_file = "resolver_persistence.state";
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.setStateFile(state_file);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{20});
+    exit(1);
+}
+
+bool savedNode(const std::string &node_name)
+{
+    std::ifstream f(state_file);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    b0::message::resolv::ResolverSnapshot snapshot;
+    if(!spotify::json::try_decode(snapshot, ss.str()))
+    {
+        std::cout << "cannot parse the state file" << std::endl;
+        exit(1);
+    }
+    for(auto &n : snapshot.state.graph.nodes)
+        if(n.node_name == node_name)
+            return true;
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    // the state of a previous run, with a node which has been killed meanwhile
+    b0::message::resolv::ResolverSnapshot snapshot;
+    snapshot.state.ok = true;
+    snapshot.state.version = 1;
+    snapshot.state.changed = true;
+    snapshot.state.graph.nodes.emplace_back();
+    snapshot.state.graph.nodes.back().host_id = "localhost";
+    snapshot.state.graph.nodes.back().process_id = 1;
+    snapshot.state.graph.nodes.back().node_name = "srv";
+    snapshot.state.services.emplace_back();
+    snapshot.state.services.back().node_name = "srv";
+    snapshot.state.services.back().service_name = "persisted";
+    snapshot.state.services.back().sock_addr = "tcp://localhost:12345";
+    std::string s;
+    b0::message::serialize(snapshot, s);
+    std::ofstream(state_file) << s;
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    b0::Node node("cli");
+    node.init();
+    std::string addr;
+    node.resolveService("persisted", addr);
+    std::cout << "resolved the restored service at " << addr << std::endl;
+    if(addr != "tcp://localhost:12345")
+        return 1;
+
+    // the restored node does not send heartbeats: it is removed, and the file updated
+    boost::this_thread::sleep_for(boost::chrono::seconds{8});
+    bool kept = savedNode("srv");
+    std::cout << "node srv " << (kept ? "still in" : "removed from") << " the state file" << std::endl;
+    node.cleanup();
+    std::remove(state_file);
+    return kept ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+#include <zmq.hpp>
+
+b0::resolver::Resolver *resolver = nullptr;
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    resolver = &node;
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        pub.publish(std::string(100000, 'x'));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+std::atomic<long> received{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", b0::Subscriber::CallbackRaw([&](const std::string &msg) {received++;}));
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{20});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::thread t3(&pub_thread);
+
+    // a subscriber on a "bad link": it never reads, with tiny buffers
+    zmq::context_t context(1);
+    zmq::socket_t bad(context, ZMQ_SUB);
+    int one = 1, small = 4096, zero = 0;
+    bad.setsockopt(ZMQ_RCVHWM, &one, sizeof(one));
+    bad.setsockopt(ZMQ_RCVBUF, &small, sizeof(small));
+    bad.setsockopt(ZMQ_LINGER, &zero, sizeof(zero));
+    bad.setsockopt(ZMQ_SUBSCRIBE, "topic1\n", 7);
+    bad.connect(resolver->getXPUBSocketAddress());
+
+    bool slow = false;
+    for(int i = 0; i < 100 && !slow; i++)
+    {
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+        for(auto &c : resolver->getProxyConsumers())
+            if(c.slow)
+            {
+                std::cout << "slow subscriber: " << c.address << " (" << c.backlog_bytes << " bytes behind)" << std::endl;
+                slow = true;
+            }
+    }
+
+    // the other subscriber is not held back:
+    long n0 = received;
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    long n = received - n0;
+    std::cout << "received " << n << " messages in 1s" << std::endl;
+#ifdef __linux__
+    exit(slow && n >= 50 ? 0 : 1);
+#else
+    exit(n >= 50 ? 0 : 1);
+#endif
+}
@@ -0,0 +1,95 @@
+#include <cstdlib>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+
+class Resolver : public b0::resolver::Resolver
+{
+public:
+    Resolver(int port, const std::string &primary)
+    {
+        setResolverPort(port);
+        setMinimumHeartbeatInterval(1500000);
+        setPrimary(primary);
+    }
+};
+
+Resolver *primary = nullptr, *standby = nullptr;
+
+void primary_thread()
+{
+    Resolver node(22000, "");
+    primary = &node;
+    node.init();
+    node.spin();
+    node.cleanup();
+}
+
+void standby_thread()
+{
+    Resolver node(22100, "tcp://localhost:22000");
+    standby = &node;
+    node.init();
+    node.spin();
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", b0::ServiceServer::CallbackRaw([](const std::string &req, std::string &rep) {rep = req + "_";}));
+    node.init();
+    node.spin();
+}
+
+bool call(const std::string &name)
+{
+    b0::Node node(name);
+    b0::ServiceClient cli(&node, "service1");
+    node.init();
+    std::string rep;
+    cli.call(std::string("x"), rep);
+    node.cleanup();
+    return rep == "x_";
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{20});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    // the nodes know both resolvers
+    setenv("B0_RESOLVER", "tcp://localhost:22000,tcp://localhost:22100", 1);
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&primary_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&standby_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{1500});
+
+    bool ok = check("call via primary", call("cli1"));
+    ok = check("standby", standby->isStandby()) && ok;
+
+    // the standby has copied the service, and takes over when the primary is gone
+    primary->shutdown();
+    t1.join();
+    ok = check("call after failover", call("cli2")) && ok;
+    ok = check("taken over", !standby->isStandby()) && ok;
+
+    exit(ok ? 0 : 1);
+}
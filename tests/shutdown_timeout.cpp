@@ -0,0 +1,51 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/service_client.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    // well below the default linger period of the unreachable client
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t0(&timeout_thread);
+
+    uint64_t dropped;
+    {
+        b0::Node node("client");
+        node.setShutdownTimeout(200);
+        b0::ServiceClient cli(&node, "unreachable");
+        // nothing listens there: the requests stay queued
+        cli.setRemoteAddress("tcp://127.0.0.1:1");
+        cli.setLingerPeriod(60000);
+        node.init();
+        for(int i = 0; i < 3; i++)
+        {
+            b0::message::MessagePart part;
+            part.payload = "request";
+            cli.callAsync({part}, [](const std::vector<b0::message::MessagePart> &parts) {});
+        }
+        node.cleanup();
+        dropped = node.getShutdownDroppedCount();
+    }
+
+    std::cout << "dropped: " << dropped << std::endl;
+    exit(dropped == 3 ? 0 : 1);
+}
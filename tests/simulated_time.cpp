@@ -0,0 +1,82 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/message/sim/clock.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+// 100 ms of simulated time every 5 ms: 20x
+const int64_t start = 1000000000, step = 100000;
+
+void clock_thread()
+{
+    b0::Node node("clock");
+    b0::Publisher pub(&node, "clock");
+    node.init();
+    b0::message::sim::Clock clock;
+    clock.time_usec = start;
+    while(!node.shutdownRequested())
+    {
+        pub.publish(clock);
+        clock.time_usec += step;
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+    }
+}
+
+std::atomic<long> ticks{0}, misaligned{0}, sleep_ms{-1};
+
+void sim_thread()
+{
+    b0::Node node("sim");
+    node.setSimulatedTime(true);
+    node.init();
+
+    // wait for the clock:
+    while(node.timeUSec() == 0)
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+
+    // two simulated seconds:
+    auto t0 = std::chrono::steady_clock::now();
+    node.sleepUSec(2000000);
+    sleep_ms = long(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count());
+
+    node.createTimer(1000000, [&]() {
+        ticks++;
+        // the time advances by the steps of the clock only:
+        if((node.timeUSec() - start) % step != 0)
+            misaligned++;
+    });
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sim_thread);
+    boost::thread t3(&clock_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{3});
+
+    // about 50 simulated seconds went by, the sleep took about 100 ms:
+    std::cout << "ticks: " << ticks << ", misaligned: " << misaligned << ", sleep of 2 simulated seconds: " << sleep_ms << " ms" << std::endl;
+    exit(ticks >= 20 && misaligned == 0 && sleep_ms >= 0 && sleep_ms < 1000 ? 0 : 1);
+}
@@ -0,0 +1,73 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+std::atomic<long> sent{0}, skipped{0}, received{0};
+std::atomic<bool> subscribed{false};
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setSkipUnsubscribed(true);
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        pub.publish(std::string("msg"));
+        node.spinOnce();
+        sent = long(pub.getCounters().messages_sent.load());
+        skipped = long(pub.getSkippedCount());
+        subscribed = pub.hasSubscribers();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", b0::Subscriber::CallbackRaw([&](const std::string &msg) {
+        received++;
+    }));
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    // nobody is subscribed: nothing is sent
+    bool ok = !subscribed && sent == 0 && skipped > 10;
+    std::cout << "without subscribers: sent: " << sent << ", skipped: " << skipped << std::endl;
+
+    boost::thread t3(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    ok = ok && subscribed && sent > 10 && received > 10;
+    std::cout << "with a subscriber: sent: " << sent << ", skipped: " << skipped << ", received: " << received << std::endl;
+    exit(ok ? 0 : 1);
+}
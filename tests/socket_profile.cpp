@@ -0,0 +1,49 @@
+#include <iostream>
+
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/exceptions.h>
+#include <b0/utils/socket_profile.h>
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    bool ok = true;
+
+    b0::SocketProfile custom;
+    custom.read_hwm = 7;
+    custom.write_hwm = 8;
+    b0::setSocketProfile("custom", custom);
+    b0::addSocketProfilePattern("*.control", "low-latency");
+    b0::addSocketProfilePattern("*.*", "custom");
+
+    bool thrown = false;
+    try {b0::addSocketProfilePattern("*.images", "no-such-profile");}
+    catch(b0::exception::ArgumentError &) {thrown = true;}
+    ok &= check("unknown profile", thrown);
+
+    b0::Node node("node");
+    // the first matching pattern wins:
+    b0::Publisher pub_control(&node, "control");
+    ok &= check("pattern profile", pub_control.getProfile() == "low-latency");
+    ok &= check("pattern options", pub_control.getWriteHWM() == 100 && pub_control.getImmediate() && pub_control.getLingerPeriod() == 0);
+    b0::Subscriber sub_other(&node, "other", b0::Subscriber::CallbackRaw());
+    ok &= check("fallback pattern", sub_other.getProfile() == "custom" && sub_other.getReadHWM() == 7 && sub_other.getWriteHWM() == 8);
+
+    // an explicit profile, then an explicit option on top of it:
+    sub_other.setProfile("lossy-latest");
+    sub_other.setReadHWM(3);
+    ok &= check("explicit profile", sub_other.getProfile() == "lossy-latest" && sub_other.getReadHWM() == 3 && sub_other.getWriteHWM() == 1);
+
+    ok &= check("builtins", b0::SocketProfile::builtins().count("bulk") && b0::getSocketProfile("bulk").tos && *b0::getSocketProfile("bulk").tos == (10 << 2));
+
+    return ok ? 0 : 1;
+}
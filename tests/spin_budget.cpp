@@ -0,0 +1,87 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+typedef boost::chrono::steady_clock clock_type;
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+std::atomic<bool> flooded{false};
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub_bulk(&node, "bulk");
+    b0::Publisher pub_control(&node, "control");
+    pub_bulk.setWriteHWM(0);
+    node.init();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    // a burst which takes the subscriber a few seconds to process:
+    for(int i = 0; i < 20000; i++)
+        pub_bulk.publish(std::string(100, 'x'));
+    flooded = true;
+    while(!node.shutdownRequested())
+    {
+        // the send time, to measure the latency (same process, same clock):
+        auto now = clock_type::now().time_since_epoch();
+        pub_control.publish(std::to_string(boost::chrono::duration_cast<boost::chrono::microseconds>(now).count()));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{20});
+    }
+}
+
+std::atomic<long> received_bulk{0}, received_control{0}, max_latency_usec{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub_bulk(&node, "bulk", b0::Subscriber::CallbackRaw([&](const std::string &msg) {
+        boost::this_thread::sleep_for(boost::chrono::microseconds{200});
+        received_bulk++;
+    }));
+    sub_bulk.setReadHWM(0);
+    sub_bulk.setSpinBudget(10);
+    b0::Subscriber sub_control(&node, "control", b0::Subscriber::CallbackRaw([&](const std::string &msg) {
+        if(!flooded) return;
+        auto now = boost::chrono::duration_cast<boost::chrono::microseconds>(clock_type::now().time_since_epoch()).count();
+        long latency = long(now - std::stoll(msg));
+        if(latency > max_latency_usec) max_latency_usec = latency;
+        received_control++;
+    }));
+    sub_control.setSpinPriority(2);
+    node.init();
+    while(!node.shutdownRequested())
+        node.spinOnce();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{3});
+
+    // without the budget the control messages would wait for the whole burst (about 4 s):
+    std::cout << "bulk: " << received_bulk << ", control: " << received_control << ", max latency: " << max_latency_usec << " us" << std::endl;
+    exit(received_control >= 50 && max_latency_usec < 200000 && received_bulk > 1000 ? 0 : 1);
+}
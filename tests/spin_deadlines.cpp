@@ -0,0 +1,64 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+// spin at 100Hz for one second, with a callback taking busy_usec (slow_usec every 10th time)
+void run(int64_t busy_usec, int64_t slow_usec, uint64_t &iterations, uint64_t &overruns)
+{
+    b0::Node node("spinner");
+    node.init();
+    int n = 0;
+    node.createTimer(1000000, [&] {node.shutdown();}, true);
+    node.spin([&] {
+        node.sleepUSec(++n % 10 == 0 ? slow_usec : busy_usec);
+    }, 100.0);
+    iterations = node.getSpinCounters().iterations.load();
+    overruns = node.getSpinCounters().overruns.load();
+    node.cleanup();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    uint64_t iterations, overruns;
+
+    // the time spent in the callback does not make the schedule drift
+    run(3000, 3000, iterations, overruns);
+    std::cout << "iterations=" << iterations << " overruns=" << overruns << std::endl;
+    bool ok = check("no drift", iterations >= 98 && iterations <= 102);
+    ok = check("no overruns", overruns == 0) && ok;
+
+    // the slow iterations are counted, and the missed deadlines are skipped
+    run(3000, 15000, iterations, overruns);
+    std::cout << "iterations=" << iterations << " overruns=" << overruns << std::endl;
+    ok = check("overruns counted", overruns >= 8 && overruns <= 11) && ok;
+    ok = check("missed deadlines skipped", iterations >= 85 && iterations <= 95) && ok;
+
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+int64_t now()
+{
+    return boost::chrono::duration_cast<boost::chrono::microseconds>(boost::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    for(;;)
+    {
+        pub.publish(boost::lexical_cast<std::string>(now()));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{50});
+    }
+}
+
+int received = 0;
+
+void callback(const std::string &msg)
+{
+    int64_t latency = now() - boost::lexical_cast<int64_t>(msg);
+    std::cout << "latency: " << latency << "usec" << std::endl;
+    // with a spin rate of 1Hz, a fixed-rate spin would have an average latency of 500ms
+    if(latency > 200000)
+    {
+        std::cerr << "latency too high" << std::endl;
+        exit(1);
+    }
+    if(++received == 10)
+        exit(0);
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::Subscriber sub(&node, "topic1", &callback);
+    node.setSpinMode(b0::SpinMode::EventDriven);
+    node.init();
+    node.spin({}, 1.0);
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{5});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    t0.join();
+}
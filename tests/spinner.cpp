@@ -0,0 +1,87 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/spinner.h>
+
+const int num_nodes = 4;
+const int num_messages = 20;
+
+std::atomic<int> received[num_nodes];
+std::atomic<int> ticks[num_nodes];
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    for(;;)
+    {
+        pub.publish(std::string("msg"));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{20});
+    }
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    std::vector<std::unique_ptr<b0::Node> > nodes;
+    std::vector<std::unique_ptr<b0::Subscriber> > subs;
+    b0::Spinner spinner(2);
+    for(int i = 0; i < num_nodes; i++)
+    {
+        received[i] = 0;
+        ticks[i] = 0;
+        b0::Node *node = new b0::Node("sub");
+        nodes.emplace_back(node);
+        subs.emplace_back(new b0::Subscriber(node, "topic1", b0::Subscriber::CallbackRaw([=](const std::string &msg) {
+            // logging from the threads of the pool is allowed while spinning the node
+            if(++received[i] == num_messages)
+                node->info("received %d messages", num_messages);
+        })));
+        node->init();
+        node->createTimer(100000, [=] {
+            ticks[i]++;
+            if(received[i] >= num_messages && ticks[i] >= 3)
+                node->shutdown();
+        });
+        spinner.addNode(node);
+    }
+
+    boost::thread t2(&pub_thread);
+
+    // returns when all the nodes are shut down
+    spinner.spin();
+
+    bool ok = true;
+    for(int i = 0; i < num_nodes; i++)
+    {
+        std::cout << "node " << i << ": received=" << received[i] << " ticks=" << ticks[i] << std::endl;
+        ok = ok && received[i] >= num_messages && ticks[i] >= 3;
+    }
+    for(auto &node : nodes)
+        node->cleanup();
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,95 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/service_server.h>
+#include <b0/utils/startup_trace.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+void callback(const std::string &msg)
+{
+}
+
+void handler(const std::string &req, std::string &rep)
+{
+}
+
+bool hasPhase(const b0::StartupTrace &trace, const std::string &name, const std::string &socket, int min_depth)
+{
+    for(auto &phase : trace.getPhases())
+        if(phase.name == name && phase.socket == socket && phase.depth >= min_depth && phase.duration_usec >= 0)
+            return true;
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    std::string path = "startup_trace_test.json";
+    std::remove(path.c_str());
+#ifdef _WIN32
+    _putenv_s("B0_STARTUP_TRACE_FILE", path.c_str());
+#else
+    setenv("B0_STARTUP_TRACE_FILE", path.c_str(), 1);
+#endif
+
+    b0::init(argc, argv);
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+
+    bool ok = true;
+
+    b0::Node node("traced");
+    b0::Publisher pub(&node, "topic1");
+    b0::Subscriber sub(&node, "topic1", &callback);
+    b0::ServiceServer srv(&node, "service1", &handler);
+    ok &= check("enabled by the file", node.getStartupTracing());
+    node.init();
+
+    const b0::StartupTrace &trace = node.getStartupTrace();
+    ok &= check("node phases", hasPhase(trace, "resolver client", "", 0) && hasPhase(trace, "announce node", "", 0) && hasPhase(trace, "sockets", "", 0));
+    ok &= check("socket phases", hasPhase(trace, "init", "topic1", 1) && hasPhase(trace, "connect", "topic1", 2));
+    ok &= check("service phases", hasPhase(trace, "bind", "service1", 2) && hasPhase(trace, "announce", "service1", 2));
+    ok &= check("total", trace.getTotalDuration() > 0);
+    node.cleanup();
+
+    b0::Node untraced("untraced");
+    untraced.setStartupTracing(false);
+    untraced.init();
+    ok &= check("disabled", untraced.getStartupTrace().getPhases().empty());
+    untraced.cleanup();
+
+    std::ifstream f(path);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    std::string json = ss.str();
+    ok &= check("trace file", json.compare(0, 2, "[\n") == 0 && json.find("\"thread_name\"") != std::string::npos && json.find("\"name\":\"connect topic1\"") != std::string::npos && json.find("\"untraced\"") == std::string::npos);
+    std::remove(path.c_str());
+
+    exit(ok ? 0 : 1);
+}
@@ -0,0 +1,81 @@
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    long seq = 0;
+    while(!node.shutdownRequested())
+    {
+        // bursts, which the subscriber receives in a few batches each:
+        for(int i = 0; i < 50; i++)
+            pub.publish(std::to_string(seq++));
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{20});
+    }
+}
+
+std::atomic<long> received{0}, batches{0}, max_batch{0}, out_of_order{0};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    long last = -1;
+    b0::Subscriber sub(&node, "topic1", b0::Subscriber::CallbackPartsBatch([&](const std::vector<std::vector<b0::message::MessagePart> > &msgs) {
+        for(auto &parts : msgs)
+        {
+            long seq = std::stol(parts.at(0).payload);
+            if(seq <= last) out_of_order++;
+            last = seq;
+        }
+        received += msgs.size();
+        batches++;
+        if(long(msgs.size()) > max_batch) max_batch = msgs.size();
+    }));
+    sub.setCallbackBatchSize(16);
+    node.init();
+    while(!node.shutdownRequested())
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    // several messages per callback, never more than the batch size, in order:
+    std::cout << "received: " << received << ", batches: " << batches << ", largest batch: " << max_batch << ", out of order: " << out_of_order << std::endl;
+    exit(received > 100 && batches < received / 2 && max_batch <= 16 && out_of_order == 0 ? 0 : 1);
+}
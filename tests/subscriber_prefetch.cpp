@@ -0,0 +1,75 @@
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    pub.setCompression("zlib");
+    node.init();
+    long seq = 0;
+    while(!node.shutdownRequested())
+    {
+        // large and compressible, so that decoding takes a while:
+        pub.publish(std::to_string(seq++) + std::string(100000, 'x'));
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+    }
+}
+
+std::atomic<long> received{0}, out_of_order{0}, bad_payload{0};
+std::atomic<bool> background{false};
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    long last = -1;
+    b0::Subscriber sub(&node, "topic1", b0::Subscriber::CallbackRaw([&](const std::string &msg) {
+        long seq = std::stol(msg);
+        if(seq <= last) out_of_order++;
+        last = seq;
+        if(msg.size() != std::to_string(seq).size() + 100000) bad_payload++;
+        received++;
+    }));
+    sub.setPrefetch(4);
+    node.init();
+    background = sub.isReadInBackground();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&pub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{2});
+
+    // the messages are decoded by the thread of the subscriber, and dispatched in order:
+    std::cout << "background: " << background << ", received: " << received << ", out of order: " << out_of_order << ", bad payloads: " << bad_payload << std::endl;
+    exit(background && received > 20 && out_of_order == 0 && bad_payload == 0 ? 0 : 1);
+}
@@ -1,5 +1,6 @@
 #include "test_protobuf.pb.h"
 
+#include <atomic>
 #include <iostream>
 #include <boost/thread.hpp>
 
@@ -28,6 +29,18 @@ void pub_thread()
         pub.publish(msg);
 }
 
+// the test passes when both subscribers have received the message
+std::atomic<int> received{0};
+
+void passed()
+{
+    if(++received == 2)
+    {
+        std::cerr << "test passed" << std::endl;
+        exit(0);
+    }
+}
+
 void sub_thread()
 {
     b0::Node node("sub");
@@ -37,8 +50,7 @@ void sub_thread()
     sub.read(&sub, msg);
     if(msg.a() == "Hello" && msg.b() == 42)
     {
-        std::cerr << "test passed" << std::endl;
-        exit(0);
+        passed();
     }
     else
     {
@@ -47,6 +59,29 @@ void sub_thread()
     }
 }
 
+void callback(const b0::test::protobuf::Message &msg)
+{
+    if(msg.a() != "Hello" || msg.b() != 42)
+    {
+        std::cerr << "test failed: bad payload in callback (a=" << msg.a() << ", b=" << msg.b() << ")" << std::endl;
+        exit(1);
+    }
+    static bool once = false;
+    if(!once)
+    {
+        once = true;
+        passed();
+    }
+}
+
+void sub_callback_thread()
+{
+    b0::Node node("sub-callback");
+    b0::protobuf::Subscriber<b0::test::protobuf::Message> sub(&node, "topicp1", &callback);
+    node.init();
+    node.spin();
+}
+
 void timeout_thread()
 {
     boost::this_thread::sleep_for(boost::chrono::seconds{4});
@@ -62,6 +97,7 @@ int main(int argc, char **argv)
     boost::thread t1(&resolver_thread);
     boost::this_thread::sleep_for(boost::chrono::seconds{1});
     boost::thread t2(&sub_thread);
+    boost::thread t4(&sub_callback_thread);
     boost::this_thread::sleep_for(boost::chrono::seconds{1});
     boost::thread t3(&pub_thread);
     t0.join();
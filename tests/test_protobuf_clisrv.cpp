@@ -0,0 +1,72 @@
+#include "test_protobuf.pb.h"
+
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/protobuf/service_client.h>
+#include <b0/protobuf/service_server.h>
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void cli_thread()
+{
+    b0::Node node("cli");
+    b0::protobuf::ServiceClient<b0::test::protobuf::Message, b0::test::protobuf::Message> cli(&node, "service1");
+    node.init();
+    b0::test::protobuf::Message req, rep;
+    for(int i = 0; i < 3; i++)
+    {
+        req.set_a("foo");
+        req.set_b(i);
+        cli.call(req, rep);
+        std::cout << "server response: a=" << rep.a() << ", b=" << rep.b() << std::endl;
+        if(rep.a() != "foo_" || rep.b() != i + 1)
+        {
+            std::cerr << "test failed: bad reply" << std::endl;
+            exit(1);
+        }
+    }
+    std::cerr << "test passed" << std::endl;
+    exit(0);
+}
+
+void handle(const b0::test::protobuf::Message &req, b0::test::protobuf::Message &rep)
+{
+    rep.set_a(req.a() + "_");
+    rep.set_b(req.b() + 1);
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::protobuf::ServiceServer<b0::test::protobuf::Message, b0::test::protobuf::Message> srv(&node, "service1", &handle);
+    node.init();
+    node.spin();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{4});
+    std::cerr << "test failed: timeout" << std::endl;
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t3(&cli_thread);
+    t0.join();
+}
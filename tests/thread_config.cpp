@@ -0,0 +1,91 @@
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/exceptions.h>
+#include <b0/utils/thread_config.h>
+
+#ifdef HAVE_PTHREAD_SETAFFINITY
+#include <sched.h>
+#endif
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{10});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+    boost::thread t0(timeout_thread);
+
+    bool ok = true;
+
+    ok &= check("cpu list", b0::ThreadConfig::parseCPUList("0, 2-4,7") == std::vector<int>({0, 2, 3, 4, 7}));
+
+    bool thrown = false;
+    try {b0::ThreadConfig::parseCPUList("3-1");}
+    catch(b0::exception::ArgumentError &) {thrown = true;}
+    ok &= check("bad cpu list", thrown);
+
+    b0::ThreadConfig bad;
+    bad.policy = "deadline";
+    thrown = false;
+    try {b0::setThreadConfig("spin", bad);}
+    catch(b0::exception::ArgumentError &) {thrown = true;}
+    ok &= check("bad policy", thrown);
+
+    ok &= check("default", b0::getThreadConfig("spin").empty());
+
+    b0::ThreadConfig numa;
+    numa.numa_node = 0;
+    ok &= check("numa not empty", !numa.empty());
+    ok &= check("numa cpus", numa.resolvedCPUs() == b0::ThreadConfig::numaNodeCPUs(0));
+    numa.cpus = {1};
+    ok &= check("cpus over numa", numa.resolvedCPUs() == std::vector<int>({1}));
+    ok &= check("unknown numa node", b0::ThreadConfig::numaNodeCPUs(100000).empty());
+    ok &= check("numa node of loopback", b0::ThreadConfig::numaNodeOfInterface("lo") == -1);
+    b0::ThreadConfig bad_numa;
+    bad_numa.numa_interface = "../eth0";
+    thrown = false;
+    try {bad_numa.validate();}
+    catch(b0::exception::ArgumentError &) {thrown = true;}
+    ok &= check("bad numa interface", thrown);
+
+#ifdef HAVE_PTHREAD_SETAFFINITY
+    b0::ThreadConfig config;
+    config.cpus = {0};
+    b0::setThreadConfig("spin", config);
+    ok &= check("get", b0::getThreadConfig("spin").cpus == config.cpus);
+
+    boost::thread t1(resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+
+    b0::Node node("pinned");
+    node.init();
+    int cpu = -1;
+    node.spin([&] {
+        cpu = sched_getcpu();
+        node.shutdown();
+    });
+    node.cleanup();
+    ok &= check("spin thread pinned", cpu == 0);
+#endif
+
+    exit(ok ? 0 : 1);
+}
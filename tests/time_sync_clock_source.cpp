@@ -0,0 +1,45 @@
+#include <b0/utils/time_sync.h>
+
+#include <boost/thread.hpp>
+
+#include <iostream>
+#include <cstdlib>
+
+// unit-test for the hardware clock sources of TimeSync:
+// every source must count time since the epoch, close to the real time clock
+
+int main(int argc, char **argv)
+{
+    b0::TimeSync reference;
+    reference.setClockSource(b0::ClockSource::Realtime);
+
+    for(b0::ClockSource source : {b0::ClockSource::Realtime, b0::ClockSource::RealtimeCoarse, b0::ClockSource::MonotonicRaw})
+    {
+        b0::TimeSync ts;
+        ts.setClockSource(source);
+
+        int64_t t_ref = reference.hardwareTimeUSec();
+        int64_t t = ts.hardwareTimeUSec();
+        std::cout << "source " << int(source) << " (using " << int(ts.getClockSource()) << "): " << t << ", realtime: " << t_ref << std::endl;
+        // coarse clocks have a resolution of a few milliseconds:
+        if(std::abs(t - t_ref) > 50000)
+        {
+            std::cerr << "clock source " << int(source) << " is too far from the real time clock" << std::endl;
+            return 1;
+        }
+
+        int64_t last = t;
+        for(int i = 0; i < 100; i++)
+        {
+            boost::this_thread::sleep_for(boost::chrono::microseconds{100});
+            int64_t now = ts.hardwareTimeUSec();
+            if(now < last && source == b0::ClockSource::MonotonicRaw)
+            {
+                std::cerr << "monotonic clock went backwards" << std::endl;
+                return 1;
+            }
+            last = now;
+        }
+    }
+    return 0;
+}
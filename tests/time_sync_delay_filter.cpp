@@ -0,0 +1,40 @@
+#include <b0/utils/time_sync.h>
+
+#include <boost/thread.hpp>
+
+#include <cstdlib>
+#include <iostream>
+
+// unit-test for the selection of the sample with the smallest round-trip time
+// (does not cover time synchronization between nodes)
+
+bool check(const std::string &title, bool ok)
+{
+    std::cout << title << ": " << (ok ? "ok" : "failed") << std::endl;
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    b0::TimeSync c;
+    c.setMaxSlope(1.0);
+
+    // one accurate sample, then samples of requests delayed by a queue, off by half of the delay
+    c.updateTime(c.hardwareTimeUSec(), 1000);
+    for(int i = 0; i < 5; i++)
+        c.updateTime(c.hardwareTimeUSec() + 50000, 100000);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+    int64_t offset = c.constantRateAdjustedOffset();
+    bool ok = check("the accurate sample is kept", c.getDelay() == 1000 && std::abs(offset) < 1000);
+
+    // once out of the window, the best of the remaining samples is used
+    for(int i = 0; i < 8; i++)
+        c.updateTime(c.hardwareTimeUSec() + 50000, 100000);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+    offset = c.constantRateAdjustedOffset();
+    ok = check("the accurate sample expires", c.getDelay() == 100000 && std::abs(offset - 50000) < 1000) && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+#include <atomic>
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/publisher.h>
+#include <b0/subscriber.h>
+#include <b0/service_client.h>
+#include <b0/service_server.h>
+#include <b0/utils/tracing.h>
+
+using b0::tracing::Span;
+using b0::tracing::SpanKind;
+using b0::tracing::TraceContext;
+
+class MemoryExporter : public b0::tracing::SpanExporter
+{
+public:
+    void exportSpans(const std::vector<Span> &batch) override
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        spans.insert(spans.end(), batch.begin(), batch.end());
+    }
+
+    boost::mutex mutex;
+    std::vector<Span> spans;
+};
+
+std::shared_ptr<MemoryExporter> exporter = std::make_shared<MemoryExporter>();
+TraceContext sub_context, srv_context;
+std::atomic<bool> done{false};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void srv_callback(const std::string &req, std::string &rep)
+{
+    srv_context = b0::tracing::currentContext();
+    rep = req + "_";
+}
+
+void srv_thread()
+{
+    b0::Node node("srv");
+    b0::ServiceServer srv(&node, "service1", &srv_callback);
+    node.init();
+    node.spin();
+}
+
+void pub_thread()
+{
+    b0::Node node("pub");
+    b0::Publisher pub(&node, "topic1");
+    node.init();
+    for(;;)
+    {
+        pub.publish(std::string("msg"));
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+}
+
+b0::ServiceClient *cli = nullptr;
+
+void sub_callback(const std::string &msg)
+{
+    if(done) return;
+    sub_context = b0::tracing::currentContext();
+    std::string rep;
+    cli->call(msg, rep);
+    done = true;
+}
+
+void sub_thread()
+{
+    b0::Node node("sub");
+    b0::ServiceClient client(&node, "service1");
+    cli = &client;
+    b0::Subscriber sub(&node, "topic1", &sub_callback);
+    node.init();
+    while(!done)
+        node.spinOnce();
+}
+
+const Span * find(SpanKind kind, uint64_t span_id)
+{
+    for(auto &span : exporter->spans)
+        if(span.kind == kind && span.context.span_id == span_id)
+            return &span;
+    return nullptr;
+}
+
+const Span * findChild(SpanKind kind, const Span *parent)
+{
+    for(auto &span : exporter->spans)
+        if(span.kind == kind && span.parent_span_id == parent->context.span_id)
+            return &span;
+    return nullptr;
+}
+
+bool check()
+{
+    // the chain publish -> receive -> call -> handle, in a single trace
+    const Span *consumer = find(SpanKind::Consumer, sub_context.span_id);
+    if(!consumer) {std::cout << "no consumer span" << std::endl; return false;}
+    const Span *producer = find(SpanKind::Producer, consumer->parent_span_id);
+    if(!producer) {std::cout << "no producer span" << std::endl; return false;}
+    const Span *client = findChild(SpanKind::Client, consumer);
+    if(!client) {std::cout << "no client span" << std::endl; return false;}
+    const Span *server = find(SpanKind::Server, srv_context.span_id);
+    if(!server || server->parent_span_id != client->context.span_id) {std::cout << "no server span child of the client span" << std::endl; return false;}
+    for(const Span *span : {producer, consumer, client, server})
+    {
+        if(span->context.trace_id_high != producer->context.trace_id_high || span->context.trace_id_low != producer->context.trace_id_low)
+        {
+            std::cout << "trace id mismatch" << std::endl;
+            return false;
+        }
+        if(span->end_time < span->start_time)
+        {
+            std::cout << "bad span times" << std::endl;
+            return false;
+        }
+    }
+    if(producer->parent_span_id != 0 || producer->name != "topic1" || server->name != "service1" || server->node_name != "srv")
+    {
+        std::cout << "bad span attributes" << std::endl;
+        return false;
+    }
+    std::cout << "trace " << producer->context.traceIdHex() << ": ok" << std::endl;
+    return true;
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{8});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+    b0::tracing::setExporter(exporter);
+
+    TraceContext c, p;
+    c.trace_id_high = 0x0af7651916cd43dd;
+    c.trace_id_low = 0x8448eb211c80319c;
+    c.span_id = 0xb7ad6b7169203331;
+    c.sampled = true;
+    if(c.toTraceparent() != "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01"
+            || !TraceContext::fromTraceparent(c.toTraceparent(), p) || p.span_id != c.span_id
+            || TraceContext::fromTraceparent("00-00000000000000000000000000000000-b7ad6b7169203331-01", p))
+    {
+        std::cout << "Traceparent format error" << std::endl;
+        return 1;
+    }
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&srv_thread);
+    boost::thread t3(&sub_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t4(&pub_thread);
+    t3.join();
+
+    b0::tracing::flush();
+    boost::mutex::scoped_lock lock(exporter->mutex);
+    exit(check() ? 0 : 1);
+}
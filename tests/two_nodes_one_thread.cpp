@@ -16,6 +16,11 @@ void resolver_thread()
 void node_thread()
 {
     b0::Node n1("testnode-1"), n2("testnode-2");
+    if(b0::getSharedContext() != (n1.getContext() == n2.getContext()))
+    {
+        std::cerr << "unexpected context sharing" << std::endl;
+        exit(3);
+    }
     n1.init();
     try
     {
@@ -0,0 +1,116 @@
+#include <atomic>
+#include <iostream>
+#include <set>
+#include <boost/thread.hpp>
+
+#include <b0/resolver/resolver.h>
+#include <b0/node.h>
+#include <b0/work_queue.h>
+
+const int num_jobs = 300;
+const int num_workers = 3;
+
+boost::mutex jobs_mutex;
+std::multiset<std::string> jobs_done;
+std::atomic<int> worker_jobs[num_workers];
+std::atomic<int> workers_ready{0};
+std::atomic<bool> done{false};
+
+void resolver_thread()
+{
+    b0::resolver::Resolver node;
+    node.init();
+    node.spin();
+}
+
+void producer_thread()
+{
+    b0::Node node("producer");
+    b0::WorkQueueProducer producer(&node, "jobs");
+    node.init();
+    // wait for all the workers to grant their credits:
+    while(!node.shutdownRequested() && producer.getWorkerCount() < num_workers)
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{10});
+    }
+    for(int i = 0; i < num_jobs; i++)
+        producer.push("job-" + std::to_string(i));
+    while(!node.shutdownRequested() && !done)
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+    node.cleanup();
+}
+
+void worker_thread(int id)
+{
+    b0::Node node("worker");
+    b0::WorkQueueWorker worker(&node, "jobs", b0::WorkQueueWorker::CallbackRaw([&](const std::string &job) {
+        {
+            boost::mutex::scoped_lock lock(jobs_mutex);
+            jobs_done.insert(job);
+        }
+        worker_jobs[id]++;
+        // a slow job, so that the others get their share:
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{2});
+    }));
+    worker.setCredit(2);
+    node.init();
+    workers_ready++;
+    while(!node.shutdownRequested() && !done)
+    {
+        node.spinOnce();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{1});
+    }
+    node.cleanup();
+}
+
+void timeout_thread()
+{
+    boost::this_thread::sleep_for(boost::chrono::seconds{15});
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    b0::init(argc, argv);
+
+    for(int i = 0; i < num_workers; i++)
+        worker_jobs[i] = 0;
+
+    boost::thread t0(&timeout_thread);
+    boost::thread t1(&resolver_thread);
+    boost::this_thread::sleep_for(boost::chrono::seconds{1});
+    boost::thread t2(&producer_thread);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    boost::thread_group workers;
+    for(int i = 0; i < num_workers; i++)
+        workers.create_thread(boost::bind(&worker_thread, i));
+
+    while(true)
+    {
+        boost::this_thread::sleep_for(boost::chrono::milliseconds{100});
+        boost::mutex::scoped_lock lock(jobs_mutex);
+        if(jobs_done.size() >= num_jobs) break;
+    }
+    // let duplicates, if any, arrive:
+    boost::this_thread::sleep_for(boost::chrono::milliseconds{500});
+    done = true;
+
+    bool ok = true;
+    {
+        boost::mutex::scoped_lock lock(jobs_mutex);
+        for(int i = 0; i < num_jobs; i++)
+            ok &= jobs_done.count("job-" + std::to_string(i)) == 1;
+        std::cout << "jobs done: " << jobs_done.size() << " (each once: " << ok << ")" << std::endl;
+    }
+    for(int i = 0; i < num_workers; i++)
+    {
+        std::cout << "worker " << i << ": " << worker_jobs[i] << " jobs" << std::endl;
+        ok &= worker_jobs[i] > 0;
+    }
+
+    exit(ok && jobs_done.size() == num_jobs ? 0 : 1);
+}